@@ -2,8 +2,12 @@ bin_PROGRAMS += controller-vtep/ovn-controller-vtep
 controller_vtep_ovn_controller_vtep_SOURCES = \
 	controller-vtep/binding.c \
 	controller-vtep/binding.h \
+	controller-vtep/en-vtep.c \
+	controller-vtep/en-vtep.h \
 	controller-vtep/gateway.c \
 	controller-vtep/gateway.h \
+	controller-vtep/inc-proc-vtep.c \
+	controller-vtep/inc-proc-vtep.h \
 	controller-vtep/ovn-controller-vtep.c \
 	controller-vtep/ovn-controller-vtep.h \
 	controller-vtep/vtep.c \
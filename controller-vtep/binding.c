@@ -20,6 +20,7 @@
 #include "lib/smap.h"
 #include "lib/util.h"
 #include "openvswitch/vlog.h"
+#include "gateway.h"
 #include "ovn-controller-vtep.h"
 #include "lib/ovn-sb-idl.h"
 #include "vtep/vtep-idl.h"
@@ -27,7 +28,7 @@
 VLOG_DEFINE_THIS_MODULE(binding);
 
 /*
- * This module scans through the Port_Binding table in ovnsb.  If there is a
+ * This module scans through the "vtep" port bindings in ovnsb.  If there is a
  * logical port binding entry for logical switch in vtep gateway chassis's
  * 'vtep_logical_switches' column, sets the binding's chassis column to the
  * corresponding vtep gateway chassis.
@@ -117,10 +118,110 @@ update_pb_chassis(const struct sbrec_port_binding *port_binding_rec,
 }
 
 
+/* Stores the 'chassis' and the 'ls_to_pb' map related to
+ * a vtep physcial switch. */
+struct ps {
+    const struct sbrec_chassis *chassis_rec;
+    struct shash ls_to_pb;
+};
+
+/* Checks and updates the binding of 'port_binding_rec', of type "vtep", to
+ * the vtep logical switch of the physical switch in 'ps_map' it names in its
+ * options.  See binding_run() for 'ls_to_db'. */
+static void
+binding_sync_vtep_pb(struct shash *ps_map, struct shash *ls_to_db,
+                     const struct sbrec_port_binding *port_binding_rec)
+{
+    const char *vtep_pswitch = smap_get(&port_binding_rec->options,
+                                        "vtep-physical-switch");
+    const char *vtep_lswitch = smap_get(&port_binding_rec->options,
+                                        "vtep-logical-switch");
+    struct ps *ps
+        = vtep_pswitch ? shash_find_data(ps_map, vtep_pswitch) : NULL;
+    bool found_ls
+        = ps && vtep_lswitch && shash_find(&ps->ls_to_pb, vtep_lswitch);
+
+    if (found_ls) {
+        bool pb_conflict, db_conflict;
+
+        pb_conflict = check_pb_conflict(&ps->ls_to_pb, port_binding_rec,
+                                        ps->chassis_rec->name,
+                                        vtep_lswitch);
+        db_conflict = check_db_conflict(ls_to_db, port_binding_rec,
+                                        ps->chassis_rec->name,
+                                        vtep_lswitch);
+        /* Updates port binding's chassis column when there
+         * is no conflict. */
+        if (!pb_conflict && !db_conflict) {
+            update_pb_chassis(port_binding_rec, ps->chassis_rec);
+        }
+    } else if (port_binding_rec->chassis
+               && shash_find(ps_map, port_binding_rec->chassis->name)) {
+        /* Resets 'port_binding_rec' since it is no longer bound to
+         * any vtep logical switch. */
+        update_pb_chassis(port_binding_rec, NULL);
+    }
+}
+
+/* Resets the port bindings, other than the ones of type "vtep", that are
+ * bound to the vtep gateway chassis 'chassis_rec'. */
+static void
+binding_reset_non_vtep_pbs(
+    struct ovsdb_idl_index *sbrec_port_binding_by_chassis,
+    const struct sbrec_chassis *chassis_rec)
+{
+    const struct sbrec_port_binding **pbs = NULL;
+    size_t n_pbs = 0, allocated_pbs = 0;
+
+    /* Collects them first, as resetting their chassis updates the index. */
+    struct sbrec_port_binding *target =
+        sbrec_port_binding_index_init_row(sbrec_port_binding_by_chassis);
+    sbrec_port_binding_index_set_chassis(target, chassis_rec);
+
+    const struct sbrec_port_binding *port_binding_rec;
+    SBREC_PORT_BINDING_FOR_EACH_EQUAL (port_binding_rec, target,
+                                       sbrec_port_binding_by_chassis) {
+        if (strcmp(port_binding_rec->type, "vtep")) {
+            if (n_pbs >= allocated_pbs) {
+                pbs = x2nrealloc(pbs, &allocated_pbs, sizeof *pbs);
+            }
+            pbs[n_pbs++] = port_binding_rec;
+        }
+    }
+    sbrec_port_binding_index_destroy_row(target);
+
+    for (size_t i = 0; i < n_pbs; i++) {
+        update_pb_chassis(pbs[i], NULL);
+    }
+    free(pbs);
+}
+
+/* Returns true if a change to 'port_binding_rec' may change its binding to
+ * a vtep gateway chassis, i.e. if it is of type "vtep" or bound to a vtep
+ * gateway chassis.  The other port bindings are left alone by
+ * binding_run(). */
+bool
+binding_pb_is_vtep_relevant(const struct sbrec_port_binding *port_binding_rec)
+{
+    if (!strcmp(port_binding_rec->type, "vtep")) {
+        return true;
+    }
+    return (!sbrec_port_binding_is_deleted(port_binding_rec)
+            && port_binding_rec->chassis
+            && gateway_is_vtep_chassis(port_binding_rec->chassis->name));
+}
+
 /* Checks and updates logical port to vtep logical switch bindings for each
- * physical switch in VTEP. */
+ * physical switch in VTEP.
+ *
+ * Only the port bindings of type "vtep", looked up through
+ * 'sbrec_port_binding_by_type', and the ones bound to the vtep gateway
+ * chassis, looked up through 'sbrec_port_binding_by_chassis', are checked,
+ * not the whole Port_Binding table. */
 void
-binding_run(struct controller_vtep_ctx *ctx)
+binding_run(struct controller_vtep_ctx *ctx,
+            struct ovsdb_idl_index *sbrec_port_binding_by_type,
+            struct ovsdb_idl_index *sbrec_port_binding_by_chassis)
 {
     if (!ctx->ovnsb_idl_txn) {
         return;
@@ -143,12 +244,6 @@ binding_run(struct controller_vtep_ctx *ctx)
      */
     struct shash ls_to_db = SHASH_INITIALIZER(&ls_to_db);
 
-    /* Stores the 'chassis' and the 'ls_to_pb' map related to
-     * a vtep physcial switch. */
-    struct ps {
-        const struct sbrec_chassis *chassis_rec;
-        struct shash ls_to_pb;
-    };
     struct shash ps_map = SHASH_INITIALIZER(&ps_map);
     const struct vteprec_physical_switch *pswitch;
     VTEPREC_PHYSICAL_SWITCH_FOR_EACH (pswitch, ctx->vtep_idl) {
@@ -174,44 +269,25 @@ binding_run(struct controller_vtep_ctx *ctx)
     const struct sbrec_port_binding *port_binding_rec;
     /* Port binding for vtep gateway chassis must have type "vtep",
      * and matched physical switch name and logical switch name. */
-    SBREC_PORT_BINDING_FOR_EACH(port_binding_rec, ctx->ovnsb_idl) {
-        const char *type = port_binding_rec->type;
-        const char *vtep_pswitch = smap_get(&port_binding_rec->options,
-                                            "vtep-physical-switch");
-        const char *vtep_lswitch = smap_get(&port_binding_rec->options,
-                                            "vtep-logical-switch");
-        struct ps *ps
-            = vtep_pswitch ? shash_find_data(&ps_map, vtep_pswitch) : NULL;
-        bool found_ls
-            = ps && vtep_lswitch && shash_find(&ps->ls_to_pb, vtep_lswitch);
-
-        if (!strcmp(type, "vtep") && found_ls) {
-            bool pb_conflict, db_conflict;
-
-            pb_conflict = check_pb_conflict(&ps->ls_to_pb, port_binding_rec,
-                                            ps->chassis_rec->name,
-                                            vtep_lswitch);
-            db_conflict = check_db_conflict(&ls_to_db, port_binding_rec,
-                                            ps->chassis_rec->name,
-                                            vtep_lswitch);
-            /* Updates port binding's chassis column when there
-             * is no conflict. */
-            if (!pb_conflict && !db_conflict) {
-                update_pb_chassis(port_binding_rec, ps->chassis_rec);
-            }
-        } else if (port_binding_rec->chassis
-                   && shash_find(&ps_map, port_binding_rec->chassis->name)) {
-            /* Resets 'port_binding_rec' since it is no longer bound to
-             * any vtep logical switch. */
-            update_pb_chassis(port_binding_rec, NULL);
-        }
+    struct sbrec_port_binding *target =
+        sbrec_port_binding_index_init_row(sbrec_port_binding_by_type);
+    sbrec_port_binding_index_set_type(target, "vtep");
+    SBREC_PORT_BINDING_FOR_EACH_EQUAL (port_binding_rec, target,
+                                       sbrec_port_binding_by_type) {
+        binding_sync_vtep_pb(&ps_map, &ls_to_db, port_binding_rec);
     }
+    sbrec_port_binding_index_destroy_row(target);
 
     struct shash_node *iter;
     SHASH_FOR_EACH_SAFE (iter, &ps_map) {
         struct ps *ps = iter->data;
         struct shash_node *node;
 
+        /* The other port bindings cannot be bound to a vtep gateway
+         * chassis. */
+        binding_reset_non_vtep_pbs(sbrec_port_binding_by_chassis,
+                                   ps->chassis_rec);
+
         SHASH_FOR_EACH (node, &ps->ls_to_pb) {
             if (!node->data) {
                 static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
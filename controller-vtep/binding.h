@@ -20,8 +20,13 @@
 #include <stdbool.h>
 
 struct controller_vtep_ctx;
+struct ovsdb_idl_index;
+struct sbrec_port_binding;
 
-void binding_run(struct controller_vtep_ctx *);
+void binding_run(struct controller_vtep_ctx *,
+                 struct ovsdb_idl_index *sbrec_port_binding_by_type,
+                 struct ovsdb_idl_index *sbrec_port_binding_by_chassis);
+bool binding_pb_is_vtep_relevant(const struct sbrec_port_binding *);
 bool binding_cleanup(struct controller_vtep_ctx *);
 
 #endif /* ovn/controller-gw/binding.h */
@@ -0,0 +1,211 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include "binding.h"
+#include "en-vtep.h"
+#include "gateway.h"
+#include "lib/inc-proc-eng.h"
+#include "lib/ovn-sb-idl.h"
+#include "ovn-controller-vtep.h"
+#include "vtep.h"
+#include "vtep/vtep-idl.h"
+
+/* The ovn-controller-vtep engine nodes have no data of their own: each of
+ * them runs one of the modules only when one of the tables it reads from
+ * changed.  The gateway and binding nodes ignore the changes that don't
+ * concern the vtep gateway chassis, e.g. the ones to the chassis and ports
+ * of the hypervisors, and the vtep node only syncs the MACs of the vtep
+ * logical switches affected by the changes, see vtep_run(). */
+
+static struct controller_vtep_ctx *
+controller_vtep_ctx_get(void)
+{
+    return engine_get_context()->client_ctx;
+}
+
+/* Returns true if one of the chassis tracked in the 'SB_chassis' input of
+ * 'node' is a vtep gateway chassis. */
+static bool
+vtep_chassis_changed(struct engine_node *node)
+{
+    const struct sbrec_chassis_table *chassis_table =
+        EN_OVSDB_GET(engine_get_input("SB_chassis", node));
+
+    const struct sbrec_chassis *chassis_rec;
+    SBREC_CHASSIS_TABLE_FOR_EACH_TRACKED (chassis_rec, chassis_table) {
+        if (gateway_is_vtep_chassis(chassis_rec->name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Gateway: VTEP Physical_Switch to SB Chassis. */
+void *
+en_gateway_init(struct engine_node *node OVS_UNUSED,
+                struct engine_arg *arg OVS_UNUSED)
+{
+    return NULL;
+}
+
+void
+en_gateway_run(struct engine_node *node, void *data OVS_UNUSED)
+{
+    gateway_run(controller_vtep_ctx_get());
+    engine_set_node_state(node, EN_UPDATED);
+}
+
+void
+en_gateway_cleanup(void *data OVS_UNUSED)
+{
+}
+
+bool
+gateway_sb_chassis_handler(struct engine_node *node, void *data OVS_UNUSED)
+{
+    return !vtep_chassis_changed(node);
+}
+
+bool
+gateway_sb_encap_handler(struct engine_node *node, void *data OVS_UNUSED)
+{
+    const struct sbrec_encap_table *encap_table =
+        EN_OVSDB_GET(engine_get_input("SB_encap", node));
+
+    const struct sbrec_encap *encap_rec;
+    SBREC_ENCAP_TABLE_FOR_EACH_TRACKED (encap_rec, encap_table) {
+        if (gateway_is_vtep_chassis(encap_rec->chassis_name)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* The gateway module only reads the names of the vtep logical switches, the
+ * logical switches that are added or removed also change the vlan bindings
+ * of the physical ports. */
+bool
+gateway_vtep_logical_switch_handler(struct engine_node *node,
+                                    void *data OVS_UNUSED)
+{
+    const struct vteprec_logical_switch_table *lswitch_table =
+        EN_OVSDB_GET(engine_get_input("VTEP_logical_switch", node));
+
+    const struct vteprec_logical_switch *vtep_ls;
+    VTEPREC_LOGICAL_SWITCH_TABLE_FOR_EACH_TRACKED (vtep_ls, lswitch_table) {
+        if (!vteprec_logical_switch_is_new(vtep_ls)
+            && !vteprec_logical_switch_is_deleted(vtep_ls)
+            && vteprec_logical_switch_is_updated(
+                   vtep_ls, VTEPREC_LOGICAL_SWITCH_COL_NAME)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Binding: SB Port_Binding of type "vtep" to the vtep gateway chassis. */
+void *
+en_binding_init(struct engine_node *node OVS_UNUSED,
+                struct engine_arg *arg OVS_UNUSED)
+{
+    return NULL;
+}
+
+void
+en_binding_run(struct engine_node *node, void *data OVS_UNUSED)
+{
+    struct engine_node *pb_node = engine_get_input("SB_port_binding", node);
+
+    binding_run(controller_vtep_ctx_get(),
+                engine_ovsdb_node_get_index(pb_node, "type"),
+                engine_ovsdb_node_get_index(pb_node, "chassis"));
+    engine_set_node_state(node, EN_UPDATED);
+}
+
+void
+en_binding_cleanup(void *data OVS_UNUSED)
+{
+}
+
+bool
+binding_sb_chassis_handler(struct engine_node *node, void *data OVS_UNUSED)
+{
+    return !vtep_chassis_changed(node);
+}
+
+bool
+binding_sb_port_binding_handler(struct engine_node *node,
+                                void *data OVS_UNUSED)
+{
+    const struct sbrec_port_binding_table *pb_table =
+        EN_OVSDB_GET(engine_get_input("SB_port_binding", node));
+
+    const struct sbrec_port_binding *pb;
+    SBREC_PORT_BINDING_TABLE_FOR_EACH_TRACKED (pb, pb_table) {
+        if (binding_pb_is_vtep_relevant(pb)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Vtep: SB Port_Binding and Chassis to VTEP Logical_Switch tunnel keys and
+ * remote MACs. */
+void *
+en_vtep_init(struct engine_node *node OVS_UNUSED,
+             struct engine_arg *arg OVS_UNUSED)
+{
+    return NULL;
+}
+
+void
+en_vtep_run(struct engine_node *node, void *data OVS_UNUSED)
+{
+    /* vtep_run() only syncs the MACs of the logical switches whose port
+     * bindings changed since its last run, which a full recompute, e.g.
+     * after a failed commit, cannot rely on. */
+    if (engine_get_force_recompute()) {
+        vtep_force_full_sync();
+    }
+    vtep_run(controller_vtep_ctx_get());
+    engine_set_node_state(node, EN_UPDATED);
+}
+
+void
+en_vtep_cleanup(void *data OVS_UNUSED)
+{
+}
+
+/* 'controller_vtep_output' is the root of the ovn-controller-vtep engine
+ * graph, it only makes sure all the other nodes are run. */
+void *
+en_controller_vtep_output_init(struct engine_node *node OVS_UNUSED,
+                               struct engine_arg *arg OVS_UNUSED)
+{
+    return NULL;
+}
+
+void
+en_controller_vtep_output_run(struct engine_node *node,
+                              void *data OVS_UNUSED)
+{
+    engine_set_node_state(node, EN_UPDATED);
+}
+
+void
+en_controller_vtep_output_cleanup(void *data OVS_UNUSED)
+{
+}
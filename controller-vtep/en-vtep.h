@@ -0,0 +1,30 @@
+#ifndef EN_VTEP_H
+#define EN_VTEP_H 1
+
+#include <config.h>
+
+#include "lib/inc-proc-eng.h"
+
+void *en_gateway_init(struct engine_node *, struct engine_arg *);
+void en_gateway_run(struct engine_node *, void *data);
+void en_gateway_cleanup(void *data);
+bool gateway_sb_chassis_handler(struct engine_node *, void *data);
+bool gateway_sb_encap_handler(struct engine_node *, void *data);
+bool gateway_vtep_logical_switch_handler(struct engine_node *, void *data);
+
+void *en_binding_init(struct engine_node *, struct engine_arg *);
+void en_binding_run(struct engine_node *, void *data);
+void en_binding_cleanup(void *data);
+bool binding_sb_chassis_handler(struct engine_node *, void *data);
+bool binding_sb_port_binding_handler(struct engine_node *, void *data);
+
+void *en_vtep_init(struct engine_node *, struct engine_arg *);
+void en_vtep_run(struct engine_node *, void *data);
+void en_vtep_cleanup(void *data);
+
+void *en_controller_vtep_output_init(struct engine_node *,
+                                     struct engine_arg *);
+void en_controller_vtep_output_run(struct engine_node *, void *data);
+void en_controller_vtep_output_cleanup(void *data);
+
+#endif /* EN_VTEP_H */
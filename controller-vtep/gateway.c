@@ -203,6 +203,14 @@ gateway_run(struct controller_vtep_ctx *ctx)
     update_vtep_logical_switches(ctx);
 }
 
+/* Returns true if 'chassis_name' is the name of a chassis registered by the
+ * gateway module for a vtep physical switch. */
+bool
+gateway_is_vtep_chassis(const char *chassis_name)
+{
+    return simap_contains(&gw_chassis_map, chassis_name);
+}
+
 /* Destroys the chassis table entries for vtep physical switches.
  * Returns true when done (i.e. there is no change made to 'ctx->ovnsb_idl'),
  * otherwise returns false. */
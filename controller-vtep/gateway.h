@@ -21,6 +21,7 @@
 struct controller_vtep_ctx;
 
 void gateway_run(struct controller_vtep_ctx *);
+bool gateway_is_vtep_chassis(const char *chassis_name);
 bool gateway_cleanup(struct controller_vtep_ctx *);
 
 #endif /* ovn/controller-gw/gateway.h */
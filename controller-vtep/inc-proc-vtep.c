@@ -0,0 +1,199 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "en-vtep.h"
+#include "inc-proc-vtep.h"
+#include "lib/inc-proc-eng.h"
+#include "lib/ovn-sb-idl.h"
+#include "openvswitch/poll-loop.h"
+#include "openvswitch/vlog.h"
+#include "util.h"
+#include "vtep/vtep-idl.h"
+
+VLOG_DEFINE_THIS_MODULE(inc_proc_vtep);
+
+#define SB_NODES \
+    SB_NODE(chassis, "chassis") \
+    SB_NODE(encap, "encap") \
+    SB_NODE(datapath_binding, "datapath_binding") \
+    SB_NODE(port_binding, "port_binding")
+
+#define VTEP_NODES \
+    VTEP_NODE(physical_switch, "physical_switch") \
+    VTEP_NODE(physical_port, "physical_port") \
+    VTEP_NODE(logical_switch, "logical_switch") \
+    VTEP_NODE(ucast_macs_remote, "ucast_macs_remote") \
+    VTEP_NODE(mcast_macs_remote, "mcast_macs_remote") \
+    VTEP_NODE(physical_locator, "physical_locator") \
+    VTEP_NODE(physical_locator_set, "physical_locator_set")
+
+/* Define engine node functions for nodes that represent the tables of the
+ * two databases
+ *
+ * en_<DB>_<TABLE_NAME>_run()
+ * en_<DB>_<TABLE_NAME>_init()
+ * en_<DB>_<TABLE_NAME>_cleanup()
+ */
+#define SB_NODE(NAME, NAME_STR) ENGINE_FUNC_SB(NAME);
+    SB_NODES
+#undef SB_NODE
+
+#define VTEP_NODE(NAME, NAME_STR) ENGINE_FUNC_VTEP(NAME);
+    VTEP_NODES
+#undef VTEP_NODE
+
+/* Define engine nodes for the tables
+ *
+ * struct engine_node en_<DB>_<TABLE_NAME>
+ *
+ * Define nodes as static to avoid sparse errors.
+ */
+#define SB_NODE(NAME, NAME_STR) static ENGINE_NODE_SB(NAME, NAME_STR);
+    SB_NODES
+#undef SB_NODE
+
+#define VTEP_NODE(NAME, NAME_STR) static ENGINE_NODE_VTEP(NAME, NAME_STR);
+    VTEP_NODES
+#undef VTEP_NODE
+
+/* Define engine nodes for other nodes. They should be defined as static to
+ * avoid sparse errors. */
+static ENGINE_NODE(gateway, "gateway");
+static ENGINE_NODE(binding, "binding");
+static ENGINE_NODE(vtep, "vtep");
+static ENGINE_NODE(controller_vtep_output, "controller_vtep_output");
+
+void inc_proc_vtep_init(struct ovsdb_idl_loop *vtep,
+                        struct ovsdb_idl_loop *sb)
+{
+    /* The binding node only looks up the port bindings of type "vtep" and
+     * the ones bound to the vtep gateway chassis. */
+    struct ovsdb_idl_index *sbrec_port_binding_by_type
+        = ovsdb_idl_index_create1(sb->idl, &sbrec_port_binding_col_type);
+    struct ovsdb_idl_index *sbrec_port_binding_by_chassis
+        = ovsdb_idl_index_create1(sb->idl, &sbrec_port_binding_col_chassis);
+
+    /* Define relationships between nodes where first argument is dependent
+     * on the second argument.  The gateway and binding nodes are only
+     * recomputed for the changes that concern the vtep gateway chassis.
+     * The vtep node runs for all the changes of its inputs but only syncs
+     * the MACs they affect. */
+    engine_add_input(&en_gateway, &en_vtep_physical_switch, NULL);
+    engine_add_input(&en_gateway, &en_vtep_physical_port, NULL);
+    engine_add_input(&en_gateway, &en_vtep_logical_switch,
+                     gateway_vtep_logical_switch_handler);
+    engine_add_input(&en_gateway, &en_sb_chassis,
+                     gateway_sb_chassis_handler);
+    engine_add_input(&en_gateway, &en_sb_encap, gateway_sb_encap_handler);
+
+    engine_add_input(&en_binding, &en_gateway, NULL);
+    engine_add_input(&en_binding, &en_vtep_physical_switch, NULL);
+    engine_add_input(&en_binding, &en_sb_chassis,
+                     binding_sb_chassis_handler);
+    engine_add_input(&en_binding, &en_sb_port_binding,
+                     binding_sb_port_binding_handler);
+
+    /* The vtep node must run after the binding node, which updates the
+     * chassis of the port bindings it syncs the MACs of.  The changes made
+     * by the binding node come back as Port_Binding changes anyway. */
+    engine_add_input(&en_vtep, &en_binding, engine_noop_handler);
+    engine_add_input(&en_vtep, &en_vtep_physical_switch, NULL);
+    engine_add_input(&en_vtep, &en_vtep_logical_switch, NULL);
+    engine_add_input(&en_vtep, &en_sb_chassis, NULL);
+    engine_add_input(&en_vtep, &en_sb_encap, NULL);
+    engine_add_input(&en_vtep, &en_sb_datapath_binding, NULL);
+    engine_add_input(&en_vtep, &en_sb_port_binding, NULL);
+    /* ovn-controller-vtep is the only writer of the remote MACs and their
+     * locators, which change after each sync. */
+    engine_add_input(&en_vtep, &en_vtep_ucast_macs_remote,
+                     engine_noop_handler);
+    engine_add_input(&en_vtep, &en_vtep_mcast_macs_remote,
+                     engine_noop_handler);
+    engine_add_input(&en_vtep, &en_vtep_physical_locator,
+                     engine_noop_handler);
+    engine_add_input(&en_vtep, &en_vtep_physical_locator_set,
+                     engine_noop_handler);
+
+    engine_add_input(&en_controller_vtep_output, &en_gateway,
+                     engine_noop_handler);
+    engine_add_input(&en_controller_vtep_output, &en_binding,
+                     engine_noop_handler);
+    engine_add_input(&en_controller_vtep_output, &en_vtep,
+                     engine_noop_handler);
+
+    struct engine_arg engine_arg = {
+        .sb_idl = sb->idl,
+        .vtep_idl = vtep->idl,
+    };
+
+    engine_init(&en_controller_vtep_output, &engine_arg);
+
+    engine_ovsdb_node_add_index(&en_sb_port_binding, "type",
+                                sbrec_port_binding_by_type);
+    engine_ovsdb_node_add_index(&en_sb_port_binding, "chassis",
+                                sbrec_port_binding_by_chassis);
+}
+
+void inc_proc_vtep_run(struct controller_vtep_ctx *ctx, bool recompute)
+{
+    engine_init_run();
+
+    /* Force a full recompute if instructed to, for example, after a
+     * reconnection to one of the databases.  However, make sure we don't
+     * overwrite an existing force-recompute request if 'recompute' is
+     * false. */
+    if (recompute) {
+        engine_set_force_recompute(recompute);
+    }
+
+    struct engine_context eng_ctx = {
+        .ovnsb_idl_txn = ctx->ovnsb_idl_txn,
+        .client_ctx = ctx,
+    };
+
+    engine_set_context(&eng_ctx);
+
+    if (ctx->ovnsb_idl_txn && ctx->vtep_idl_txn) {
+        engine_run(true);
+    }
+
+    if (!engine_has_run()) {
+        if (engine_need_run()) {
+            VLOG_DBG("engine did not run, force recompute next time.");
+            engine_set_force_recompute(true);
+            poll_immediate_wake();
+        } else {
+            VLOG_DBG("engine did not run, and it was not needed");
+        }
+    } else if (engine_aborted()) {
+        VLOG_DBG("engine was aborted, force recompute next time.");
+        engine_set_force_recompute(true);
+        poll_immediate_wake();
+    } else {
+        engine_set_force_recompute(false);
+    }
+
+    engine_set_context(NULL);
+}
+
+void inc_proc_vtep_cleanup(void)
+{
+    engine_cleanup();
+    engine_set_context(NULL);
+}
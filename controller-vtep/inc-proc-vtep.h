@@ -0,0 +1,14 @@
+#ifndef INC_PROC_VTEP_H
+#define INC_PROC_VTEP_H 1
+
+#include <config.h>
+
+#include "ovn-controller-vtep.h"
+#include "ovsdb-idl.h"
+
+void inc_proc_vtep_init(struct ovsdb_idl_loop *vtep,
+                        struct ovsdb_idl_loop *sb);
+void inc_proc_vtep_run(struct controller_vtep_ctx *ctx, bool recompute);
+void inc_proc_vtep_cleanup(void);
+
+#endif /* INC_PROC_VTEP_H */
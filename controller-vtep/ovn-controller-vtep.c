@@ -43,6 +43,7 @@
 
 #include "binding.h"
 #include "gateway.h"
+#include "inc-proc-vtep.h"
 #include "vtep.h"
 #include "ovn-controller-vtep.h"
 
@@ -88,6 +89,25 @@ check_northd_version(struct ovsdb_idl *vtep_idl, struct ovsdb_idl *ovnsb_idl,
     return true;
 }
 
+/* Returns true if 'idl', connected to the database named 'db_name',
+ * reconnected since the last call, which resets its condition sequence
+ * number, stored in '*cond_seqno'. */
+static bool
+idl_reconnected(struct ovsdb_idl *idl, const char *db_name,
+                unsigned int *cond_seqno)
+{
+    unsigned int new_cond_seqno = ovsdb_idl_get_condition_seqno(idl);
+    if (new_cond_seqno == *cond_seqno) {
+        return false;
+    }
+    *cond_seqno = new_cond_seqno;
+    if (!new_cond_seqno) {
+        VLOG_INFO("%s IDL reconnected, force recompute.", db_name);
+        return true;
+    }
+    return false;
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -125,9 +145,20 @@ main(int argc, char *argv[])
         ovsdb_idl_create(ovnsb_remote, &sbrec_idl_class, true, true));
     ovsdb_idl_get_initial_snapshot(ovnsb_idl_loop.idl);
 
+    /* The modules are only run for the changes of the tables they read from,
+     * see inc-proc-vtep.c. */
+    ovsdb_idl_track_add_all(vtep_idl_loop.idl);
+    ovsdb_idl_track_add_all(ovnsb_idl_loop.idl);
+
+    inc_proc_vtep_init(&vtep_idl_loop, &ovnsb_idl_loop);
+
     char *ovn_version = ovn_get_internal_version();
     VLOG_INFO("OVN internal version is : [%s]", ovn_version);
 
+    unsigned int vtep_cond_seqno = UINT_MAX;
+    unsigned int ovnsb_cond_seqno = UINT_MAX;
+    bool recompute = false;
+
     /* Main loop. */
     exiting = false;
     while (!exiting) {
@@ -147,14 +178,26 @@ main(int argc, char *argv[])
             simap_destroy(&usage);
         }
 
+        bool reconnected =
+            idl_reconnected(ctx.vtep_idl, "VTEP", &vtep_cond_seqno);
+        reconnected |=
+            idl_reconnected(ctx.ovnsb_idl, "OVN SB", &ovnsb_cond_seqno);
+        if (reconnected) {
+            recompute = true;
+        }
+
         if (ovsdb_idl_has_ever_connected(ovnsb_idl_loop.idl) &&
             ovsdb_idl_has_ever_connected(vtep_idl_loop.idl) &&
             check_northd_version(vtep_idl_loop.idl, ovnsb_idl_loop.idl,
                                  ovn_version)) {
-            gateway_run(&ctx);
-            binding_run(&ctx);
-            vtep_run(&ctx);
+            inc_proc_vtep_run(&ctx, recompute);
+            recompute = false;
+        } else {
+            /* The changes tracked meanwhile are dropped below. */
+            recompute = true;
         }
+        ovsdb_idl_track_clear(vtep_idl_loop.idl);
+        ovsdb_idl_track_clear(ovnsb_idl_loop.idl);
 
         unixctl_server_run(unixctl);
 
@@ -163,8 +206,16 @@ main(int argc, char *argv[])
         if (exiting) {
             poll_immediate_wake();
         }
-        ovsdb_idl_loop_commit_and_wait(&vtep_idl_loop);
-        ovsdb_idl_loop_commit_and_wait(&ovnsb_idl_loop);
+        /* If there are any errors, we force a full recompute in order
+         * to ensure we handle all changes. */
+        if (!ovsdb_idl_loop_commit_and_wait(&vtep_idl_loop)) {
+            VLOG_INFO("VTEP commit failed, force recompute next time.");
+            recompute = true;
+        }
+        if (!ovsdb_idl_loop_commit_and_wait(&ovnsb_idl_loop)) {
+            VLOG_INFO("OVNSB commit failed, force recompute next time.");
+            recompute = true;
+        }
         poll_block();
         if (should_service_stop()) {
             exiting = true;
@@ -195,6 +246,7 @@ main(int argc, char *argv[])
         poll_block();
     }
 
+    inc_proc_vtep_cleanup();
     unixctl_server_destroy(unixctl);
 
     ovsdb_idl_loop_destroy(&vtep_idl_loop);
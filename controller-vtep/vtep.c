@@ -42,6 +42,10 @@ struct mmr_hash_node_data {
     struct shash physical_locators;
 };
 
+/* Whether the next vtep_run() must sync the MACs of all the vtep logical
+ * switches, instead of only the ones whose port bindings changed. */
+static bool macs_need_full_sync = true;
+
 /*
  * Scans through the Binding table in ovnsb, and updates the vtep logical
  * switch tunnel keys and the 'Ucast_Macs_Remote' table in the VTEP
@@ -265,11 +269,15 @@ vtep_lswitch_run(struct shash *vtep_pbs, struct sset *vtep_pswitches,
 }
 
 /* Updates the vtep 'Ucast_Macs_Remote' and 'Mcast_Macs_Remote' tables based
- * on non-vtep port bindings. */
+ * on non-vtep port bindings.  If 'lswitches_to_sync' is nonnull, only the
+ * MACs of the vtep logical switches it contains are updated, and
+ * 'ucast_macs_rmts' and 'mcast_macs_rmts' only need to contain their
+ * entries. */
 static void
 vtep_macs_run(struct ovsdb_idl_txn *vtep_idl_txn, struct shash *ucast_macs_rmts,
               struct shash *mcast_macs_rmts, struct shash *physical_locators,
-              struct shash *vtep_lswitches, struct shash *non_vtep_pbs)
+              struct shash *vtep_lswitches, struct shash *non_vtep_pbs,
+              const struct hmapx *lswitches_to_sync)
 {
     struct shash_node *node;
     struct hmap ls_map;
@@ -298,7 +306,9 @@ vtep_macs_run(struct ovsdb_idl_txn *vtep_idl_txn, struct shash *ucast_macs_rmts,
         const struct vteprec_logical_switch *vtep_ls = node->data;
         struct ls_hash_node *ls_node;
 
-        if (!vtep_ls->n_tunnel_key) {
+        if (!vtep_ls->n_tunnel_key
+            || (lswitches_to_sync
+                && !hmapx_contains(lswitches_to_sync, vtep_ls))) {
             continue;
         }
         ls_node = xmalloc(sizeof *ls_node);
@@ -520,12 +530,68 @@ vtep_mcast_macs_cleanup(struct ovsdb_idl *vtep_idl)
     return true;
 }
 
-/* Updates vtep logical switch tunnel keys. */
-void
+/* Returns true if a change requires the MACs of all the vtep logical
+ * switches to be synced: the chassis and their encaps give the locators of
+ * all the MACs, and the datapaths and the vtep logical switches, with their
+ * tunnel keys, map the port bindings to the vtep logical switches.
+ *
+ * The 'Ucast_Macs_Remote', 'Mcast_Macs_Remote' and 'Physical_Locator'
+ * tables are not checked: ovn-controller-vtep is their only writer, and they
+ * change after each sync. */
+static bool
+vtep_macs_need_full_sync(const struct controller_vtep_ctx *ctx)
+{
+    return (sbrec_chassis_track_get_first(ctx->ovnsb_idl)
+            || sbrec_encap_track_get_first(ctx->ovnsb_idl)
+            || sbrec_datapath_binding_track_get_first(ctx->ovnsb_idl)
+            || vteprec_logical_switch_track_get_first(ctx->vtep_idl)
+            || vteprec_physical_switch_track_get_first(ctx->vtep_idl));
+}
+
+/* Adds to 'lswitches_to_sync' the vtep logical switches, out of
+ * 'vtep_lswitches', attached to the datapaths of the port bindings that
+ * changed.  Returns false if a change cannot be mapped to its vtep logical
+ * switch, in which case all of them must be synced. */
+static bool
+vtep_collect_changed_lswitches(const struct controller_vtep_ctx *ctx,
+                               const struct shash *vtep_lswitches,
+                               struct hmapx *lswitches_to_sync)
+{
+    const struct sbrec_port_binding *pb;
+    SBREC_PORT_BINDING_FOR_EACH_TRACKED (pb, ctx->ovnsb_idl) {
+        if (!strcmp(pb->type, "vtep")) {
+            /* Only changes the tunnel keys of the vtep logical switches,
+             * which are checked on their own. */
+            continue;
+        }
+        if (!strcmp(pb->type, "chassisredirect")
+            || !strcmp(pb->type, "patch") || !pb->datapath) {
+            /* Their MACs belong to the peer of another port binding. */
+            return false;
+        }
+
+        struct shash_node *node;
+        SHASH_FOR_EACH (node, vtep_lswitches) {
+            const struct vteprec_logical_switch *vtep_ls = node->data;
+            if (vtep_ls->n_tunnel_key
+                && vtep_ls->tunnel_key[0] == pb->datapath->tunnel_key) {
+                hmapx_add(lswitches_to_sync,
+                          CONST_CAST(struct vteprec_logical_switch *,
+                                     vtep_ls));
+            }
+        }
+    }
+    return true;
+}
+
+/* Updates vtep logical switch tunnel keys and the remote MACs.  Returns true
+ * if it processed the changes tracked in 'ctx->ovnsb_idl' and
+ * 'ctx->vtep_idl', false if it could not run. */
+bool
 vtep_run(struct controller_vtep_ctx *ctx)
 {
     if (!ctx->vtep_idl_txn) {
-        return;
+        return false;
     }
 
     struct sset vtep_pswitches = SSET_INITIALIZER(&vtep_pswitches);
@@ -552,8 +618,23 @@ vtep_run(struct controller_vtep_ctx *ctx)
         shash_add(&vtep_lswitches, vtep_ls->name, vtep_ls);
     }
 
+    /* Unless a full sync is needed, only the MACs of the vtep logical
+     * switches whose port bindings changed are synced, and only their
+     * entries in the remote MAC tables are collected below. */
+    struct hmapx changed_lswitches = HMAPX_INITIALIZER(&changed_lswitches);
+    const struct hmapx *lswitches_to_sync = NULL;
+    if (!macs_need_full_sync && !vtep_macs_need_full_sync(ctx)
+        && vtep_collect_changed_lswitches(ctx, &vtep_lswitches,
+                                          &changed_lswitches)) {
+        lswitches_to_sync = &changed_lswitches;
+    }
+
     /* Collects 'Ucast_Macs_Remote's. */
     VTEPREC_UCAST_MACS_REMOTE_FOR_EACH (umr, ctx->vtep_idl) {
+        if (lswitches_to_sync
+            && !hmapx_contains(lswitches_to_sync, umr->logical_switch)) {
+            continue;
+        }
         char *mac_ip_tnlkey =
             xasprintf("%s_%s_%"PRId64, umr->MAC,
                       umr->locator ? umr->locator->dst_ip : "",
@@ -566,6 +647,10 @@ vtep_run(struct controller_vtep_ctx *ctx)
 
     /* Collects 'Mcast_Macs_Remote's. */
     VTEPREC_MCAST_MACS_REMOTE_FOR_EACH (mmr, ctx->vtep_idl) {
+        if (lswitches_to_sync
+            && !hmapx_contains(lswitches_to_sync, mmr->logical_switch)) {
+            continue;
+        }
         struct mmr_hash_node_data *mmr_ext = xmalloc(sizeof *mmr_ext);
         hmapx_add(&mcast_macs_ptrs, mmr_ext);
         char *mac_tnlkey =
@@ -610,9 +695,12 @@ vtep_run(struct controller_vtep_ctx *ctx)
                               "tunnel keys and 'ucast_macs_remote's");
 
     vtep_lswitch_run(&vtep_pbs, &vtep_pswitches, &vtep_lswitches);
-    vtep_macs_run(ctx->vtep_idl_txn, &ucast_macs_rmts,
-                  &mcast_macs_rmts, &physical_locators,
-                  &vtep_lswitches, &non_vtep_pbs);
+    if (!lswitches_to_sync || !hmapx_is_empty(lswitches_to_sync)) {
+        vtep_macs_run(ctx->vtep_idl_txn, &ucast_macs_rmts,
+                      &mcast_macs_rmts, &physical_locators,
+                      &vtep_lswitches, &non_vtep_pbs, lswitches_to_sync);
+    }
+    macs_need_full_sync = false;
 
     sset_destroy(&vtep_pswitches);
     shash_destroy(&vtep_lswitches);
@@ -628,6 +716,17 @@ vtep_run(struct controller_vtep_ctx *ctx)
     shash_destroy(&physical_locators);
     shash_destroy(&vtep_pbs);
     shash_destroy(&non_vtep_pbs);
+    hmapx_destroy(&changed_lswitches);
+
+    return true;
+}
+
+/* Makes the next vtep_run() sync the MACs of all the vtep logical switches,
+ * e.g. because the changes made by the previous one were not committed. */
+void
+vtep_force_full_sync(void)
+{
+    macs_need_full_sync = true;
 }
 
 /* Cleans up all related entries in vtep.  Returns true when done (i.e. there
@@ -21,7 +21,8 @@
 
 struct controller_vtep_ctx;
 
-void vtep_run(struct controller_vtep_ctx *);
+bool vtep_run(struct controller_vtep_ctx *);
+void vtep_force_full_sync(void);
 bool vtep_cleanup(struct controller_vtep_ctx *);
 
 #endif /* ovn/controller-vtep/vtep.h */
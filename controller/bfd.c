@@ -19,15 +19,47 @@
 #include "lport.h"
 
 #include "lib/hash.h"
+#include "lib/simap.h"
 #include "lib/sset.h"
 #include "lib/util.h"
+#include "lib/uuid.h"
 #include "lib/vswitch-idl.h"
+#include "openvswitch/hmap.h"
 #include "openvswitch/vlog.h"
 #include "lib/ovn-sb-idl.h"
 #include "ovn-controller.h"
 
 VLOG_DEFINE_THIS_MODULE(ovn_bfd);
 
+/* bfd_run() keeps, across runs, the chassis with which each HA chassis group
+ * requires BFD sessions, and normally only updates the groups whose records
+ * changed and the tunnels to the chassis that entered or left the union of
+ * these sets.  Everything is recomputed, and all the tunnels reconciled, as
+ * they used to be on every run, when this is set: on the first run, when
+ * this chassis, the integration bridge or the BFD parameters changed, when
+ * HA_Chassis or Chassis records changed, when OVN tunnel ports or their BFD
+ * configuration were changed by someone else, when changes could not be
+ * handled because the OVS database was not writable, and after any run that
+ * modified the tunnels, to make sure the modifications were committed. */
+static bool bfd_full_run = true;
+
+/* Inputs of the last run that apply to all the tunnels. */
+static struct uuid bfd_chassis_uuid;
+static struct uuid bfd_br_int_uuid;
+static struct smap bfd_params = SMAP_INITIALIZER(&bfd_params);
+
+/* An HA_Chassis_Group that requires BFD sessions from this chassis. */
+struct bfd_group {
+    struct hmap_node node;      /* In 'bfd_groups', by 'uuid'. */
+    struct uuid uuid;
+    struct sset chassis;        /* Names of the chassis to monitor. */
+};
+static struct hmap bfd_groups = HMAP_INITIALIZER(&bfd_groups);
+
+/* The union of the 'chassis' of 'bfd_groups', with the number of groups that
+ * contain each chassis. */
+static struct simap bfd_chassis = SIMAP_INITIALIZER(&bfd_chassis);
+
 void
 bfd_register_ovs_idl(struct ovsdb_idl *ovs_idl)
 {
@@ -90,9 +122,8 @@ bfd_calculate_active_tunnels(const struct ovsrec_bridge *br_int,
     }
 }
 
-/* Loops through the HA chassis groups in the SB DB and returns
- * the set of chassis which the call can establish the BFD sessions
- * with.
+/* Adds to 'bfd_chassis' the chassis with which 'our_chassis' must establish
+ * BFD sessions for 'ha_chassis_grp'.
  * Eg.
  * If there are 2 HA chassis groups.
  * Group name - hapgrp1
@@ -103,120 +134,166 @@ bfd_calculate_active_tunnels(const struct ovsrec_bridge *br_int,
  *   - HA chassis - (HA1, HA4, HA5)
  *   - ref chassis - (C1, C3, C4)
  *
- * If 'our_chassis' is HA1 then this function returns
+ * If 'our_chassis' is HA1 then the union of the sets of both groups is
  *  bfd chassis set - (HA2, HA3, HA4 HA5, C1, C2, C3, C4)
  *
- * If 'our_chassis' is C1 then this function returns
+ * If 'our_chassis' is C1 then it is
  *  bfd chassis set - (HA1, HA2, HA3, HA4, HA5)
  *
- * If 'our_chassis' is HA5 then this function returns
+ * If 'our_chassis' is HA5 then it is
  *  bfd chassis set - (HA1, HA4, C1, C3, C4)
  *
- * If 'our_chassis' is C2 then this function returns
+ * If 'our_chassis' is C2 then it is
  *  bfd chassis set - (HA1, HA2, HA3)
  *
- * If 'our_chassis' is C5 then this function returns empty bfd set.
+ * If 'our_chassis' is C5 then both sets are empty.
  */
 static void
-bfd_calculate_chassis(
+bfd_group_calculate_chassis(
     const struct sbrec_chassis *our_chassis,
-    const struct sbrec_ha_chassis_group_table *ha_chassis_grp_table,
-    struct sset *bfd_chassis)
+    const struct sbrec_ha_chassis_group *ha_chassis_grp,
+    struct sset *bfd_chassis_set)
 {
-    const struct sbrec_ha_chassis_group *ha_chassis_grp;
-    SBREC_HA_CHASSIS_GROUP_TABLE_FOR_EACH (ha_chassis_grp,
-                                           ha_chassis_grp_table) {
-        bool is_ha_chassis = false;
-        struct sset grp_chassis = SSET_INITIALIZER(&grp_chassis);
-        const struct sbrec_ha_chassis *ha_ch;
-        bool bfd_setup_required = false;
-        if (ha_chassis_grp->n_ha_chassis < 2) {
-            /* No need to consider the chassis group for BFD if
-             * there is  1 or no chassis in it. */
+    if (ha_chassis_grp->n_ha_chassis < 2) {
+        /* No need to consider the chassis group for BFD if
+         * there is  1 or no chassis in it. */
+        return;
+    }
+
+    bool is_ha_chassis = false;
+    struct sset grp_chassis = SSET_INITIALIZER(&grp_chassis);
+    const struct sbrec_ha_chassis *ha_ch;
+    bool bfd_setup_required = false;
+    for (size_t i = 0; i < ha_chassis_grp->n_ha_chassis; i++) {
+        ha_ch = ha_chassis_grp->ha_chassis[i];
+        if (!ha_ch->chassis) {
             continue;
         }
-        for (size_t i = 0; i < ha_chassis_grp->n_ha_chassis; i++) {
-            ha_ch = ha_chassis_grp->ha_chassis[i];
-            if (!ha_ch->chassis) {
+        sset_add(&grp_chassis, ha_ch->chassis->name);
+        if (our_chassis == ha_ch->chassis) {
+            is_ha_chassis = true;
+            bfd_setup_required = true;
+        }
+    }
+
+    if (is_ha_chassis) {
+        /* It's an HA chassis. So add the ref_chassis to the bfd set. */
+        for (size_t i = 0; i < ha_chassis_grp->n_ref_chassis; i++) {
+            struct sbrec_chassis *ref_ch = ha_chassis_grp->ref_chassis[i];
+            if (smap_get_bool(&ref_ch->other_config, "is-remote", false)) {
                 continue;
             }
-            sset_add(&grp_chassis, ha_ch->chassis->name);
-            if (our_chassis == ha_ch->chassis) {
-                is_ha_chassis = true;
+            sset_add(&grp_chassis, ref_ch->name);
+        }
+    } else {
+        /* This is not an HA chassis. Check if this chassis is present
+         * in the ref_chassis list. If so add the ha_chassis to the
+         * sset .*/
+        for (size_t i = 0; i < ha_chassis_grp->n_ref_chassis; i++) {
+            if (our_chassis == ha_chassis_grp->ref_chassis[i]) {
                 bfd_setup_required = true;
+                break;
             }
         }
+    }
 
-        if (is_ha_chassis) {
-            /* It's an HA chassis. So add the ref_chassis to the bfd set. */
-            for (size_t i = 0; i < ha_chassis_grp->n_ref_chassis; i++) {
-                struct sbrec_chassis *ref_ch = ha_chassis_grp->ref_chassis[i];
-                if (smap_get_bool(&ref_ch->other_config, "is-remote", false)) {
-                    continue;
-                }
-                sset_add(&grp_chassis, ref_ch->name);
-            }
-        } else {
-            /* This is not an HA chassis. Check if this chassis is present
-             * in the ref_chassis list. If so add the ha_chassis to the
-             * sset .*/
-            for (size_t i = 0; i < ha_chassis_grp->n_ref_chassis; i++) {
-                if (our_chassis == ha_chassis_grp->ref_chassis[i]) {
-                    bfd_setup_required = true;
-                    break;
-                }
-            }
+    if (bfd_setup_required) {
+        const char *name;
+        SSET_FOR_EACH (name, &grp_chassis) {
+            sset_add(bfd_chassis_set, name);
         }
+    }
+    sset_destroy(&grp_chassis);
+}
 
-        if (bfd_setup_required) {
-            const char *name;
-            SSET_FOR_EACH (name, &grp_chassis) {
-                sset_add(bfd_chassis, name);
-            }
+static struct bfd_group *
+bfd_group_find(const struct uuid *uuid)
+{
+    struct bfd_group *group;
+    HMAP_FOR_EACH_WITH_HASH (group, node, uuid_hash(uuid), &bfd_groups) {
+        if (uuid_equals(&group->uuid, uuid)) {
+            return group;
         }
-        sset_destroy(&grp_chassis);
     }
+    return NULL;
 }
 
-void
-bfd_run(const struct ovsrec_interface_table *interface_table,
-        const struct ovsrec_bridge *br_int,
-        const struct sbrec_chassis *chassis_rec,
-        const struct sbrec_ha_chassis_group_table *ha_chassis_grp_table,
-        const struct sbrec_sb_global_table *sb_global_table)
+/* Removes the group with 'uuid', if any, adding to 'changed_chassis' the
+ * chassis that no other group requires BFD sessions with. */
+static void
+bfd_group_remove(const struct uuid *uuid, struct sset *changed_chassis)
 {
-    if (!chassis_rec) {
+    struct bfd_group *group = bfd_group_find(uuid);
+    if (!group) {
         return;
     }
-    struct sset bfd_chassis = SSET_INITIALIZER(&bfd_chassis);
-    bfd_calculate_chassis(chassis_rec, ha_chassis_grp_table,
-                          &bfd_chassis);
 
-    /* Identify tunnels ports(connected to remote chassis id) to enable bfd */
-    struct sset tunnels = SSET_INITIALIZER(&tunnels);
-    struct sset bfd_ifaces = SSET_INITIALIZER(&bfd_ifaces);
-    for (size_t k = 0; k < br_int->n_ports; k++) {
-        const char *tunnel_id = smap_get(&br_int->ports[k]->external_ids,
-                                          "ovn-chassis-id");
-        if (tunnel_id) {
-            char *chassis_name = NULL;
-            char *port_name = br_int->ports[k]->name;
+    const char *name;
+    SSET_FOR_EACH (name, &group->chassis) {
+        struct simap_node *node = simap_find(&bfd_chassis, name);
+        if (!--node->data) {
+            simap_delete(&bfd_chassis, node);
+            sset_add(changed_chassis, name);
+        }
+    }
+    hmap_remove(&bfd_groups, &group->node);
+    sset_destroy(&group->chassis);
+    free(group);
+}
 
-            sset_add(&tunnels, port_name);
+/* Recalculates the chassis that 'ha_chassis_grp' requires BFD sessions with,
+ * adding to 'changed_chassis' the chassis that entered or left
+ * 'bfd_chassis'. */
+static void
+bfd_group_update(const struct sbrec_chassis *our_chassis,
+                 const struct sbrec_ha_chassis_group *ha_chassis_grp,
+                 struct sset *changed_chassis)
+{
+    bfd_group_remove(&ha_chassis_grp->header_.uuid, changed_chassis);
 
-            if (encaps_tunnel_id_parse(tunnel_id, &chassis_name, NULL)) {
-                if (sset_contains(&bfd_chassis, chassis_name)) {
-                    sset_add(&bfd_ifaces, port_name);
-                }
-                free(chassis_name);
-            }
+    struct sset chassis = SSET_INITIALIZER(&chassis);
+    bfd_group_calculate_chassis(our_chassis, ha_chassis_grp, &chassis);
+    if (sset_is_empty(&chassis)) {
+        sset_destroy(&chassis);
+        return;
+    }
+
+    struct bfd_group *group = xmalloc(sizeof *group);
+    group->uuid = ha_chassis_grp->header_.uuid;
+    sset_init(&group->chassis);
+    sset_swap(&group->chassis, &chassis);
+    sset_destroy(&chassis);
+    hmap_insert(&bfd_groups, &group->node, uuid_hash(&group->uuid));
+
+    const char *name;
+    SSET_FOR_EACH (name, &group->chassis) {
+        if (!simap_get(&bfd_chassis, name)) {
+            sset_add(changed_chassis, name);
         }
+        simap_increase(&bfd_chassis, name, 1);
     }
+}
+
+static void
+bfd_groups_clear(void)
+{
+    struct bfd_group *group;
+    HMAP_FOR_EACH_POP (group, node, &bfd_groups) {
+        sset_destroy(&group->chassis);
+        free(group);
+    }
+    simap_clear(&bfd_chassis);
+}
 
+/* Builds in 'params' the BFD configuration of the tunnels from the options of
+ * the SB_Global record. */
+static void
+bfd_get_params(const struct sbrec_sb_global_table *sb_global_table,
+               struct smap *params)
+{
     const struct sbrec_sb_global *sb
         = sbrec_sb_global_table_first(sb_global_table);
-    struct smap bfd = SMAP_INITIALIZER(&bfd);
-    smap_add(&bfd, "enable", "true");
+    smap_add(params, "enable", "true");
 
     if (sb) {
         const char *min_rx = smap_get(&sb->options, "bfd-min-rx");
@@ -224,33 +301,179 @@ bfd_run(const struct ovsrec_interface_table *interface_table,
         const char *min_tx = smap_get(&sb->options, "bfd-min-tx");
         const char *mult = smap_get(&sb->options, "bfd-mult");
         if (min_rx) {
-            smap_add(&bfd, "min_rx", min_rx);
+            smap_add(params, "min_rx", min_rx);
         }
         if (decay_min_rx) {
-            smap_add(&bfd, "decay_min_rx", decay_min_rx);
+            smap_add(params, "decay_min_rx", decay_min_rx);
         }
         if (min_tx) {
-            smap_add(&bfd, "min_tx", min_tx);
+            smap_add(params, "min_tx", min_tx);
         }
         if (mult) {
-            smap_add(&bfd, "mult", mult);
+            smap_add(params, "mult", mult);
+        }
+    }
+}
+
+/* Returns true if the changes since the last run require a full run, see
+ * 'bfd_full_run'. */
+static bool
+bfd_collect_changes(const struct ovsrec_port_table *port_table,
+                    const struct ovsrec_interface_table *iface_table,
+                    const struct ovsrec_bridge *br_int,
+                    const struct sbrec_chassis *chassis_rec,
+                    const struct sbrec_chassis_table *chassis_table,
+                    const struct sbrec_ha_chassis_table *ha_chassis_table,
+                    const struct sbrec_sb_global_table *sb_global_table)
+{
+    bool full_run = false;
+
+    struct uuid br_int_uuid = br_int ? br_int->header_.uuid : UUID_ZERO;
+    if (!uuid_equals(&br_int_uuid, &bfd_br_int_uuid)) {
+        bfd_br_int_uuid = br_int_uuid;
+        full_run = true;
+    }
+
+    if (!uuid_equals(&chassis_rec->header_.uuid, &bfd_chassis_uuid)) {
+        bfd_chassis_uuid = chassis_rec->header_.uuid;
+        full_run = true;
+    }
+
+    struct smap params = SMAP_INITIALIZER(&params);
+    bfd_get_params(sb_global_table, &params);
+    if (!smap_equal(&params, &bfd_params)) {
+        smap_swap(&params, &bfd_params);
+        full_run = true;
+    }
+    smap_destroy(&params);
+
+    /* The HA chassis of a group and the "is-remote" option of its reference
+     * chassis are not part of the HA_Chassis_Group record itself. */
+    const struct sbrec_ha_chassis *ha_ch;
+    SBREC_HA_CHASSIS_TABLE_FOR_EACH_TRACKED (ha_ch, ha_chassis_table) {
+        full_run = true;
+    }
+
+    const struct sbrec_chassis *chassis;
+    SBREC_CHASSIS_TABLE_FOR_EACH_TRACKED (chassis, chassis_table) {
+        if (sbrec_chassis_is_updated(chassis,
+                                     SBREC_CHASSIS_COL_OTHER_CONFIG)) {
+            full_run = true;
+        }
+    }
+
+    const struct ovsrec_port *port;
+    OVSREC_PORT_TABLE_FOR_EACH_TRACKED (port, port_table) {
+        if (smap_get(&port->external_ids, "ovn-chassis-id")) {
+            full_run = true;
         }
     }
 
-    /* Enable or disable bfd */
     const struct ovsrec_interface *iface;
-    OVSREC_INTERFACE_TABLE_FOR_EACH (iface, interface_table) {
-        if (sset_contains(&tunnels, iface->name)) {
-            if (sset_contains(&bfd_ifaces, iface->name)) {
+    OVSREC_INTERFACE_TABLE_FOR_EACH_TRACKED (iface, iface_table) {
+        if (smap_get(&iface->options, "remote_ip")
+            && (ovsrec_interface_is_new(iface)
+                || ovsrec_interface_is_deleted(iface)
+                || ovsrec_interface_is_updated(iface,
+                                               OVSREC_INTERFACE_COL_BFD))) {
+            full_run = true;
+        }
+    }
+
+    return full_run;
+}
+
+void
+bfd_run(struct ovsdb_idl_txn *ovs_idl_txn,
+        const struct ovsrec_port_table *port_table,
+        const struct ovsrec_interface_table *interface_table,
+        const struct ovsrec_bridge *br_int,
+        const struct sbrec_chassis *chassis_rec,
+        const struct sbrec_chassis_table *chassis_table,
+        const struct sbrec_ha_chassis_table *ha_chassis_table,
+        const struct sbrec_ha_chassis_group_table *ha_chassis_grp_table,
+        const struct sbrec_sb_global_table *sb_global_table)
+{
+    if (!chassis_rec) {
+        return;
+    }
+
+    if (bfd_collect_changes(port_table, interface_table, br_int, chassis_rec,
+                            chassis_table, ha_chassis_table,
+                            sb_global_table)) {
+        bfd_full_run = true;
+    }
+
+    /* Keep the groups up to date even if the tunnels can't be, they are
+     * reconciled in a full run once possible. */
+    struct sset changed_chassis = SSET_INITIALIZER(&changed_chassis);
+    const struct sbrec_ha_chassis_group *ha_chassis_grp;
+    if (bfd_full_run) {
+        bfd_groups_clear();
+        SBREC_HA_CHASSIS_GROUP_TABLE_FOR_EACH (ha_chassis_grp,
+                                               ha_chassis_grp_table) {
+            bfd_group_update(chassis_rec, ha_chassis_grp, &changed_chassis);
+        }
+    } else {
+        SBREC_HA_CHASSIS_GROUP_TABLE_FOR_EACH_TRACKED (ha_chassis_grp,
+                                                       ha_chassis_grp_table) {
+            if (sbrec_ha_chassis_group_is_deleted(ha_chassis_grp)) {
+                bfd_group_remove(&ha_chassis_grp->header_.uuid,
+                                 &changed_chassis);
+            } else {
+                bfd_group_update(chassis_rec, ha_chassis_grp,
+                                 &changed_chassis);
+            }
+        }
+    }
+
+    if (!ovs_idl_txn || !br_int) {
+        if (!sset_is_empty(&changed_chassis)) {
+            bfd_full_run = true;
+        }
+        sset_destroy(&changed_chassis);
+        return;
+    }
+
+    if (!bfd_full_run && sset_is_empty(&changed_chassis)) {
+        sset_destroy(&changed_chassis);
+        return;
+    }
+
+    /* Enable or disable bfd on the tunnels (connected to remote chassis id)
+     * to the chassis that changed, or on all of them in a full run. */
+    bool modified = false;
+    for (size_t k = 0; k < br_int->n_ports; k++) {
+        const struct ovsrec_port *port = br_int->ports[k];
+        const char *tunnel_id = smap_get(&port->external_ids,
+                                         "ovn-chassis-id");
+        char *chassis_name = NULL;
+        if (!tunnel_id
+            || !encaps_tunnel_id_parse(tunnel_id, &chassis_name, NULL)) {
+            continue;
+        }
+
+        bool update = bfd_full_run
+                      || sset_contains(&changed_chassis, chassis_name);
+        bool enable = simap_contains(&bfd_chassis, chassis_name);
+        free(chassis_name);
+        if (!update) {
+            continue;
+        }
+
+        for (size_t i = 0; i < port->n_interfaces; i++) {
+            const struct ovsrec_interface *iface = port->interfaces[i];
+            if (enable) {
                 /* We need to enable BFD for this interface. Configure the
                  * BFD params if
                  *  - If BFD was disabled earlier
                  *  - Or if CMS has updated BFD config options.
                  */
-                if (!smap_equal(&iface->bfd, &bfd)) {
+                if (!smap_equal(&iface->bfd, &bfd_params)) {
                     ovsrec_interface_verify_bfd(iface);
-                    ovsrec_interface_set_bfd(iface, &bfd);
+                    ovsrec_interface_set_bfd(iface, &bfd_params);
                     VLOG_INFO("Enabled BFD on interface %s", iface->name);
+                    modified = true;
                 }
             } else {
                 /* We need to disable BFD for this interface if it was enabled
@@ -259,13 +482,12 @@ bfd_run(const struct ovsrec_interface_table *interface_table,
                     ovsrec_interface_verify_bfd(iface);
                     ovsrec_interface_set_bfd(iface, NULL);
                     VLOG_INFO("Disabled BFD on interface %s", iface->name);
+                    modified = true;
                 }
             }
         }
     }
 
-    smap_destroy(&bfd);
-    sset_destroy(&tunnels);
-    sset_destroy(&bfd_ifaces);
-    sset_destroy(&bfd_chassis);
+    bfd_full_run = modified;
+    sset_destroy(&changed_chassis);
 }
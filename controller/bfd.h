@@ -19,19 +19,27 @@
 struct hmap;
 struct ovsdb_idl;
 struct ovsdb_idl_index;
+struct ovsdb_idl_txn;
 struct ovsrec_bridge;
 struct ovsrec_interface_table;
 struct ovsrec_open_vswitch_table;
+struct ovsrec_port_table;
 struct sbrec_chassis;
+struct sbrec_chassis_table;
 struct sbrec_sb_global_table;
+struct sbrec_ha_chassis_table;
 struct sbrec_ha_chassis_group_table;
 struct sset;
 
 void bfd_register_ovs_idl(struct ovsdb_idl *);
 
-void bfd_run(const struct ovsrec_interface_table *,
+void bfd_run(struct ovsdb_idl_txn *ovs_idl_txn,
+             const struct ovsrec_port_table *,
+             const struct ovsrec_interface_table *,
              const struct ovsrec_bridge *,
              const struct sbrec_chassis *,
+             const struct sbrec_chassis_table *,
+             const struct sbrec_ha_chassis_table *,
              const struct sbrec_ha_chassis_group_table *,
              const struct sbrec_sb_global_table *);
 
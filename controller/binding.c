@@ -17,6 +17,7 @@
 
 /* OVS includes. */
 #include "lib/bitmap.h"
+#include "lib/hash.h"
 #include "openvswitch/poll-loop.h"
 #include "lib/sset.h"
 #include "lib/util.h"
@@ -450,10 +451,7 @@ static void
 update_related_lport(const struct sbrec_port_binding *pb,
                      struct binding_ctx_out *b_ctx)
 {
-    char buf[16];
-    get_unique_lport_key(pb->datapath->tunnel_key, pb->tunnel_key,
-                         buf, sizeof(buf));
-    if (sset_add(&b_ctx->related_lports->lport_ids, buf) != NULL) {
+    if (related_lport_id_add(b_ctx->related_lports, pb)) {
         b_ctx->related_lports_changed = true;
 
         if (b_ctx->tracked_dp_bindings) {
@@ -472,12 +470,9 @@ static void
 remove_related_lport(const struct sbrec_port_binding *pb,
                      struct binding_ctx_out *b_ctx)
 {
-    char buf[16];
-    get_unique_lport_key(pb->datapath->tunnel_key, pb->tunnel_key,
-                         buf, sizeof(buf));
     sset_find_and_delete(&b_ctx->related_lports->lport_names,
                          pb->logical_port);
-    if (sset_find_and_delete(&b_ctx->related_lports->lport_ids, buf)) {
+    if (related_lport_id_remove(b_ctx->related_lports, pb)) {
         b_ctx->related_lports_changed = true;
 
         if (b_ctx->tracked_dp_bindings) {
@@ -581,14 +576,79 @@ void
 related_lports_init(struct related_lports *rp)
 {
     sset_init(&rp->lport_names);
-    sset_init(&rp->lport_ids);
+    hmap_init(&rp->lport_ids);
 }
 
 void
 related_lports_destroy(struct related_lports *rp)
 {
     sset_destroy(&rp->lport_names);
-    sset_destroy(&rp->lport_ids);
+
+    struct related_lport_id *id;
+    HMAP_FOR_EACH_POP (id, hmap_node, &rp->lport_ids) {
+        free(id);
+    }
+    hmap_destroy(&rp->lport_ids);
+}
+
+static struct related_lport_id *
+related_lport_id_find(const struct related_lports *rp, uint32_t dp_key,
+                      uint32_t port_key)
+{
+    struct related_lport_id *id;
+    HMAP_FOR_EACH_WITH_HASH (id, hmap_node, hash_2words(dp_key, port_key),
+                             &rp->lport_ids) {
+        if (id->dp_key == dp_key && id->port_key == port_key) {
+            return id;
+        }
+    }
+    return NULL;
+}
+
+/* Returns true if the port with tunnel key 'port_key' in the datapath with
+ * tunnel key 'dp_key' is relevant to the local chassis. */
+bool
+related_lports_contains(const struct related_lports *rp, uint32_t dp_key,
+                        uint32_t port_key)
+{
+    return related_lport_id_find(rp, dp_key, port_key) != NULL;
+}
+
+/* Adds the pair of tunnel keys of 'pb' to 'rp''s 'lport_ids'.  Returns false
+ * if it was already there. */
+static bool
+related_lport_id_add(struct related_lports *rp,
+                     const struct sbrec_port_binding *pb)
+{
+    uint32_t dp_key = pb->datapath->tunnel_key;
+    uint32_t port_key = pb->tunnel_key;
+
+    if (related_lport_id_find(rp, dp_key, port_key)) {
+        return false;
+    }
+
+    struct related_lport_id *id = xmalloc(sizeof *id);
+    id->dp_key = dp_key;
+    id->port_key = port_key;
+    hmap_insert(&rp->lport_ids, &id->hmap_node, hash_2words(dp_key, port_key));
+    return true;
+}
+
+/* Removes the pair of tunnel keys of 'pb' from 'rp''s 'lport_ids'.  Returns
+ * false if it wasn't there. */
+static bool
+related_lport_id_remove(struct related_lports *rp,
+                        const struct sbrec_port_binding *pb)
+{
+    struct related_lport_id *id =
+        related_lport_id_find(rp, pb->datapath->tunnel_key, pb->tunnel_key);
+
+    if (!id) {
+        return false;
+    }
+    hmap_remove(&rp->lport_ids, &id->hmap_node);
+    free(id);
+    return true;
 }
 
 void
@@ -1078,11 +1138,26 @@ consider_vif_lport_(const struct sbrec_port_binding *pb,
             const struct sbrec_port_binding *parent_pb =
                 binding_lport_get_parent_pb(b_lport);
 
-            if (!claim_lport(pb, parent_pb, b_ctx_in->chassis_rec,
-                             b_lport->lbinding->iface,
-                             !b_ctx_in->ovnsb_idl_txn,
-                             !parent_pb, b_ctx_out->tracked_dp_bindings,
-                             b_ctx_out->if_mgr)){
+            if (claim_lport(pb, parent_pb, b_ctx_in->chassis_rec,
+                            b_lport->lbinding->iface,
+                            !b_ctx_in->ovnsb_idl_txn,
+                            !parent_pb, b_ctx_out->tracked_dp_bindings,
+                            b_ctx_out->if_mgr)) {
+                if (b_ctx_out->postponed_ports) {
+                    sset_find_and_delete(b_ctx_out->postponed_ports,
+                                         pb->logical_port);
+                }
+            } else if (b_ctx_out->postponed_ports) {
+                /* The SB transaction of this iteration is not available,
+                 * e.g., because the previous one is still in progress.
+                 * Bind the lport locally right away and let
+                 * binding_claim_postponed_ports() update the SB in a later
+                 * iteration, so that a burst of new VIFs is claimed in a
+                 * single transaction instead of triggering recomputes. */
+                sset_add(b_ctx_out->postponed_ports, pb->logical_port);
+                update_lport_tracking(pb, b_ctx_out->tracked_dp_bindings,
+                                      true);
+            } else {
                 return false;
             }
 
@@ -1117,6 +1192,10 @@ consider_vif_lport_(const struct sbrec_port_binding *pb,
         }
     }
 
+    if ((!lbinding_set || !can_bind) && b_ctx_out->postponed_ports) {
+        sset_find_and_delete(b_ctx_out->postponed_ports, pb->logical_port);
+    }
+
     if (pb->chassis == b_ctx_in->chassis_rec) {
         /* Release the lport if there is no lbinding. */
         if (!lbinding_set || !can_bind) {
@@ -2008,12 +2087,18 @@ binding_handle_ovs_interface_changes(struct binding_ctx_in *b_ctx_in,
     const struct ovsrec_interface *iface_rec;
     OVSREC_INTERFACE_TABLE_FOR_EACH_TRACKED (iface_rec,
                                              b_ctx_in->iface_table) {
-        if (!is_iface_vif(iface_rec)) {
-            /* Right now we are not handling ovs_interface changes of
-             * other types. This can be enhanced to handle of
-             * types - patch and tunnel. */
-            handled = false;
-            break;
+        if (!is_iface_vif(iface_rec)
+            && !smap_get(&iface_rec->external_ids, "iface-id")
+            && !smap_get(b_ctx_out->local_iface_ids, iface_rec->name)) {
+            /* Interfaces that are not bound to a logical port, e.g. patch
+             * ports, don't affect the local bindings.  Tunnel interfaces
+             * do, through the active tunnels and egress interfaces, so
+             * they are not handled incrementally yet. */
+            if (smap_get(&iface_rec->options, "remote_ip")) {
+                handled = false;
+                break;
+            }
+            continue;
         }
 
         if (smap_get(&iface_rec->external_ids, "ovn-egress-iface") ||
@@ -2569,6 +2654,39 @@ delete_done:
     return handled;
 }
 
+/* Writes to the SB the claims of the lports in 'postponed_ports', which were
+ * bound locally while the SB database was read-only.  Must be called with an
+ * SB transaction open, after the engine processed the latest changes to
+ * 'lbinding_data'.  Lports that are no longer bound locally are skipped.
+ * Clears 'postponed_ports'. */
+void
+binding_claim_postponed_ports(const struct sbrec_chassis *chassis_rec,
+                              struct local_binding_data *lbinding_data,
+                              struct sset *postponed_ports,
+                              struct if_status_mgr *if_mgr)
+{
+    const char *name;
+    SSET_FOR_EACH (name, postponed_ports) {
+        struct binding_lport *b_lport =
+            binding_lport_find(&lbinding_data->lports, name);
+        if (!b_lport || !b_lport->pb || !is_lbinding_set(b_lport->lbinding)) {
+            continue;
+        }
+
+        if (b_lport->type != LP_VIRTUAL &&
+            !lport_can_bind_on_this_chassis(chassis_rec, b_lport->pb)) {
+            continue;
+        }
+
+        const struct sbrec_port_binding *parent_pb =
+            binding_lport_get_parent_pb(b_lport);
+        claim_lport(b_lport->pb, parent_pb, chassis_rec,
+                    b_lport->lbinding->iface, false, !parent_pb, NULL,
+                    if_mgr);
+    }
+    sset_clear(postponed_ports);
+}
+
 /* Static functions for local_lbindind and binding_lport. */
 static struct local_binding *
 local_binding_create(const char *name, const struct ovsrec_interface *iface)
@@ -63,13 +63,24 @@ struct binding_ctx_in {
  */
 struct related_lports {
     struct sset lport_names; /* Set of port names. */
-    struct sset lport_ids;   /* Set of <datapath-tunnel-key>_<port-tunnel-key>
-                              * IDs for fast lookup.
+    struct hmap lport_ids;   /* Set of 'struct related_lport_id', hashed by
+                              * datapath and port tunnel keys, for fast
+                              * lookup.
                               */
 };
 
+/* A <datapath-tunnel-key, port-tunnel-key> pair in
+ * 'struct related_lports''s 'lport_ids'. */
+struct related_lport_id {
+    struct hmap_node hmap_node;
+    uint32_t dp_key;
+    uint32_t port_key;
+};
+
 void related_lports_init(struct related_lports *);
 void related_lports_destroy(struct related_lports *);
+bool related_lports_contains(const struct related_lports *,
+                             uint32_t dp_key, uint32_t port_key);
 
 struct binding_ctx_out {
     struct hmap *local_datapaths;
@@ -103,6 +114,11 @@ struct binding_ctx_out {
     struct hmap *tracked_dp_bindings;
 
     struct if_status_mgr *if_mgr;
+
+    /* sset of lports bound locally whose claim could not be written to the
+     * SB yet because it was read-only.  If NULL, such claims fail instead,
+     * see binding_claim_postponed_ports(). */
+    struct sset *postponed_ports;
 };
 
 /* Local bindings. binding.c module binds the logical port (represented by
@@ -170,6 +186,10 @@ bool binding_handle_ovs_interface_changes(struct binding_ctx_in *,
 bool binding_handle_port_binding_changes(struct binding_ctx_in *,
                                          struct binding_ctx_out *);
 void binding_tracked_dp_destroy(struct hmap *tracked_datapaths);
+void binding_claim_postponed_ports(const struct sbrec_chassis *,
+                                   struct local_binding_data *,
+                                   struct sset *postponed_ports,
+                                   struct if_status_mgr *);
 
 void binding_dump_local_bindings(struct local_binding_data *, struct ds *);
 
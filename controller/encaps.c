@@ -16,12 +16,14 @@
 #include <config.h>
 #include "encaps.h"
 
+#include "lib/chassis-index.h"
 #include "lib/hash.h"
 #include "lib/sset.h"
 #include "lib/util.h"
 #include "lib/vswitch-idl.h"
 #include "openvswitch/vlog.h"
 #include "lib/ovn-sb-idl.h"
+#include "lib/ovn-util.h"
 #include "ovn-controller.h"
 #include "smap.h"
 
@@ -34,6 +36,22 @@ VLOG_DEFINE_THIS_MODULE(encaps);
  */
 #define	OVN_MVTEP_CHASSISID_DELIM '@'
 
+/* encaps_run() normally only handles the chassis whose Chassis or Encap
+ * records changed since its last run.  All the tunnels are reconciled with
+ * all the chassis, as they used to be on every run, when this is set: on the
+ * first run, when the configuration that applies to all the tunnels changed,
+ * when OVN tunnel ports were changed by someone else, when changes could not
+ * be handled because the OVS database was not writable, and after any run
+ * that modified the tunnels, to make sure the modifications were committed.
+ */
+static bool encaps_full_run = true;
+
+/* Inputs of the last run that apply to all the tunnels. */
+static struct uuid encaps_br_int_uuid;
+static struct sset encaps_transport_zones =
+    SSET_INITIALIZER(&encaps_transport_zones);
+static char *encaps_global_config;
+
 void
 encaps_register_ovs_idl(struct ovsdb_idl *ovs_idl)
 {
@@ -61,6 +79,8 @@ struct tunnel_ctx {
     struct ovsdb_idl_txn *ovs_txn;
     const struct ovsrec_bridge *br_int;
     const struct sbrec_chassis *this_chassis;
+
+    bool ovs_changed;   /* Whether the tunnels were modified in 'ovs_txn'. */
 };
 
 struct chassis_node {
@@ -276,6 +296,7 @@ tunnel_add(struct tunnel_ctx *tc, const struct sbrec_sb_global *sbg,
     ovsrec_bridge_update_ports_addvalue(tc->br_int, port);
 
     sset_add_and_free(&tc->port_names, port_name);
+    tc->ovs_changed = true;
 
 exit:
     free(tunnel_entry_id);
@@ -364,17 +385,165 @@ chassis_tzones_overlap(const struct sset *transport_zones,
     return false;
 }
 
+/* Creates the tunnels to 'chassis_rec', unless it is this chassis or no
+ * tunnel should be formed with it. */
+static void
+encaps_add_chassis(const struct sbrec_chassis *chassis_rec,
+                   const struct sbrec_sb_global *sbg,
+                   const struct ovsrec_open_vswitch_table *ovs_table,
+                   struct tunnel_ctx *tc,
+                   const struct sset *transport_zones)
+{
+    const struct sbrec_chassis *this_chassis = tc->this_chassis;
+
+    if (!strcmp(chassis_rec->name, this_chassis->name)) {
+        return;
+    }
+
+    /* Create tunnels to the other Chassis belonging to the
+     * same transport zone */
+    if (!chassis_tzones_overlap(transport_zones, chassis_rec)) {
+        VLOG_DBG("Skipping encap creation for Chassis '%s' because "
+                 "it belongs to different transport zones",
+                 chassis_rec->name);
+        return;
+    }
+
+    if (smap_get_bool(&chassis_rec->other_config, "is-remote", false)
+        && !smap_get_bool(&this_chassis->other_config, "is-interconn",
+                          false)) {
+        VLOG_DBG("Skipping encap creation for Chassis '%s' because "
+                 "it is remote but this chassis is not interconn.",
+                 chassis_rec->name);
+        return;
+    }
+
+    if (chassis_tunnel_add(chassis_rec, sbg, ovs_table, tc,
+                           this_chassis) == 0) {
+        VLOG_INFO("Creating encap for '%s' failed", chassis_rec->name);
+    }
+}
+
+/* Returns true if the inputs that apply to all the tunnels changed since the
+ * last call, or if OVN tunnel ports were modified in the OVS database.
+ * Otherwise, adds to 'changed_chassis' the names of the other chassis whose
+ * Chassis or Encap records changed. */
+static bool
+encaps_collect_changes(const struct ovsrec_bridge *br_int,
+                       const struct ovsrec_port_table *port_table,
+                       const struct ovsrec_interface_table *iface_table,
+                       const struct sbrec_chassis_table *chassis_table,
+                       const struct sbrec_encap_table *encap_table,
+                       const struct sbrec_chassis *this_chassis,
+                       const struct sbrec_sb_global *sbg,
+                       const struct ovsrec_open_vswitch_table *ovs_table,
+                       const struct sset *transport_zones,
+                       struct sset *changed_chassis)
+{
+    bool full_run = false;
+
+    struct uuid br_int_uuid = br_int ? br_int->header_.uuid : UUID_ZERO;
+    if (!uuid_equals(&br_int_uuid, &encaps_br_int_uuid)) {
+        encaps_br_int_uuid = br_int_uuid;
+        full_run = true;
+    }
+
+    if (!sset_equals(transport_zones, &encaps_transport_zones)) {
+        sset_destroy(&encaps_transport_zones);
+        sset_clone(&encaps_transport_zones, transport_zones);
+        full_run = true;
+    }
+
+    const struct ovsrec_open_vswitch *cfg =
+        ovsrec_open_vswitch_table_first(ovs_table);
+    const struct smap *external_ids = cfg ? &cfg->external_ids : NULL;
+    char *global_config = xasprintf(
+        "ipsec=%d tos=%s df_default=%s set-local-ip=%d",
+        sbg ? sbg->ipsec : false,
+        external_ids ? smap_get_def(external_ids, "ovn-encap-tos", "none")
+                     : "none",
+        external_ids ? smap_get_def(external_ids, "ovn-encap-df_default", "")
+                     : "",
+        external_ids ? smap_get_bool(external_ids, "ovn-set-local-ip", false)
+                     : false);
+    if (!encaps_global_config || strcmp(global_config, encaps_global_config)) {
+        free(encaps_global_config);
+        encaps_global_config = global_config;
+        full_run = true;
+    } else {
+        free(global_config);
+    }
+
+    const struct ovsrec_port *port;
+    OVSREC_PORT_TABLE_FOR_EACH_TRACKED (port, port_table) {
+        if (smap_get(&port->external_ids, "ovn-chassis-id")) {
+            full_run = true;
+        }
+    }
+
+    const struct ovsrec_interface *iface;
+    OVSREC_INTERFACE_TABLE_FOR_EACH_TRACKED (iface, iface_table) {
+        if (get_tunnel_type(iface->type)
+            || !strncmp(iface->name, "ovn-", 4)) {
+            full_run = true;
+        }
+    }
+
+    const struct sbrec_chassis *chassis_rec;
+    SBREC_CHASSIS_TABLE_FOR_EACH_TRACKED (chassis_rec, chassis_table) {
+        if (!strcmp(chassis_rec->name, this_chassis->name)) {
+            full_run = true;
+        } else {
+            sset_add(changed_chassis, chassis_rec->name);
+        }
+    }
+
+    const struct sbrec_encap *encap;
+    SBREC_ENCAP_TABLE_FOR_EACH_TRACKED (encap, encap_table) {
+        if (!strcmp(encap->chassis_name, this_chassis->name)) {
+            full_run = true;
+        } else {
+            sset_add(changed_chassis, encap->chassis_name);
+        }
+    }
+
+    return full_run;
+}
+
 void
 encaps_run(struct ovsdb_idl_txn *ovs_idl_txn,
            const struct ovsrec_bridge_table *bridge_table,
            const struct ovsrec_bridge *br_int,
+           const struct ovsrec_port_table *port_table,
+           const struct ovsrec_interface_table *iface_table,
            const struct sbrec_chassis_table *chassis_table,
+           const struct sbrec_encap_table *encap_table,
+           struct ovsdb_idl_index *sbrec_chassis_by_name,
            const struct sbrec_chassis *this_chassis,
            const struct sbrec_sb_global *sbg,
            const struct ovsrec_open_vswitch_table *ovs_table,
            const struct sset *transport_zones)
 {
+    struct sset changed_chassis = SSET_INITIALIZER(&changed_chassis);
+
+    if (encaps_collect_changes(br_int, port_table, iface_table,
+                               chassis_table, encap_table, this_chassis, sbg,
+                               ovs_table, transport_zones, &changed_chassis)) {
+        encaps_full_run = true;
+    }
+
     if (!ovs_idl_txn || !br_int) {
+        /* The changes are not tracked anymore after this iteration, handle
+         * them in a full run once possible. */
+        if (!sset_is_empty(&changed_chassis)) {
+            encaps_full_run = true;
+        }
+        sset_destroy(&changed_chassis);
+        return;
+    }
+
+    if (!encaps_full_run && sset_is_empty(&changed_chassis)) {
+        sset_destroy(&changed_chassis);
         return;
     }
 
@@ -395,7 +564,8 @@ encaps_run(struct ovsdb_idl_txn *ovs_idl_txn,
 
     /* Collect all port names into tc.port_names.
      *
-     * Collect all the OVN-created tunnels into tc.tunnel_hmap. */
+     * Collect the OVN-created tunnels into tc.chassis: all of them on a full
+     * run, only the ones to the changed chassis otherwise. */
     OVSREC_BRIDGE_TABLE_FOR_EACH (br, bridge_table) {
         for (size_t i = 0; i < br->n_ports; i++) {
             const struct ovsrec_port *port = br->ports[i];
@@ -406,45 +576,49 @@ encaps_run(struct ovsdb_idl_txn *ovs_idl_txn,
              * combination of <chassis_name><delim><encap_ip>
              */
             const char *id = smap_get(&port->external_ids, "ovn-chassis-id");
-            if (id) {
-                if (!shash_find(&tc.chassis, id)) {
-                    struct chassis_node *chassis = xzalloc(sizeof *chassis);
-                    chassis->bridge = br;
-                    chassis->port = port;
-                    shash_add_assert(&tc.chassis, id, chassis);
-                } else {
-                    /* Duplicate port for ovn-chassis-id.  Arbitrarily choose
-                     * to delete this one. */
-                    ovsrec_bridge_update_ports_delvalue(br, port);
-                }
+            if (!id) {
+                continue;
             }
-        }
-    }
 
-    SBREC_CHASSIS_TABLE_FOR_EACH (chassis_rec, chassis_table) {
-        if (strcmp(chassis_rec->name, this_chassis->name)) {
-            /* Create tunnels to the other Chassis belonging to the
-             * same transport zone */
-            if (!chassis_tzones_overlap(transport_zones, chassis_rec)) {
-                VLOG_DBG("Skipping encap creation for Chassis '%s' because "
-                         "it belongs to different transport zones",
-                         chassis_rec->name);
-                continue;
+            if (!encaps_full_run) {
+                char *chassis_id = NULL;
+                bool changed =
+                    encaps_tunnel_id_parse(id, &chassis_id, NULL)
+                    && sset_contains(&changed_chassis, chassis_id);
+                free(chassis_id);
+                if (!changed) {
+                    continue;
+                }
             }
 
-            if (smap_get_bool(&chassis_rec->other_config, "is-remote", false)
-                && !smap_get_bool(&this_chassis->other_config, "is-interconn",
-                                  false)) {
-                VLOG_DBG("Skipping encap creation for Chassis '%s' because "
-                         "it is remote but this chassis is not interconn.",
-                         chassis_rec->name);
-                continue;
+            if (!shash_find(&tc.chassis, id)) {
+                struct chassis_node *chassis = xzalloc(sizeof *chassis);
+                chassis->bridge = br;
+                chassis->port = port;
+                shash_add_assert(&tc.chassis, id, chassis);
+            } else {
+                /* Duplicate port for ovn-chassis-id.  Arbitrarily choose
+                 * to delete this one. */
+                ovsrec_bridge_update_ports_delvalue(br, port);
+                tc.ovs_changed = true;
             }
+        }
+    }
 
-            if (chassis_tunnel_add(chassis_rec, sbg, ovs_table, &tc,
-                                   this_chassis) == 0) {
-                VLOG_INFO("Creating encap for '%s' failed", chassis_rec->name);
-                continue;
+    if (encaps_full_run) {
+        SBREC_CHASSIS_TABLE_FOR_EACH (chassis_rec, chassis_table) {
+            encaps_add_chassis(chassis_rec, sbg, ovs_table, &tc,
+                               transport_zones);
+        }
+    } else {
+        const char *name;
+        SSET_FOR_EACH (name, &changed_chassis) {
+            /* Deleted chassis are not found, their tunnels are left in
+             * tc.chassis and deleted below. */
+            chassis_rec = chassis_lookup_by_name(sbrec_chassis_by_name, name);
+            if (chassis_rec) {
+                encaps_add_chassis(chassis_rec, sbg, ovs_table, &tc,
+                                   transport_zones);
             }
         }
     }
@@ -456,9 +630,13 @@ encaps_run(struct ovsdb_idl_txn *ovs_idl_txn,
         ovsrec_bridge_update_ports_delvalue(chassis->bridge, chassis->port);
         shash_delete(&tc.chassis, node);
         free(chassis);
+        tc.ovs_changed = true;
     }
     shash_destroy(&tc.chassis);
     sset_destroy(&tc.port_names);
+    sset_destroy(&changed_chassis);
+
+    encaps_full_run = tc.ovs_changed;
 }
 
 /* Returns true if the database is all cleaned up, false if more work is
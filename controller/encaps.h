@@ -19,10 +19,14 @@
 #include <stdbool.h>
 
 struct ovsdb_idl;
+struct ovsdb_idl_index;
 struct ovsdb_idl_txn;
 struct ovsrec_bridge;
 struct ovsrec_bridge_table;
+struct ovsrec_interface_table;
+struct ovsrec_port_table;
 struct sbrec_chassis_table;
+struct sbrec_encap_table;
 struct sbrec_chassis;
 struct sbrec_sb_global;
 struct ovsrec_open_vswitch_table;
@@ -32,7 +36,11 @@ void encaps_register_ovs_idl(struct ovsdb_idl *);
 void encaps_run(struct ovsdb_idl_txn *ovs_idl_txn,
                 const struct ovsrec_bridge_table *,
                 const struct ovsrec_bridge *br_int,
+                const struct ovsrec_port_table *,
+                const struct ovsrec_interface_table *,
                 const struct sbrec_chassis_table *,
+                const struct sbrec_encap_table *,
+                struct ovsdb_idl_index *sbrec_chassis_by_name,
                 const struct sbrec_chassis *,
                 const struct sbrec_sb_global *,
                 const struct ovsrec_open_vswitch_table *,
@@ -16,12 +16,35 @@
 #include <config.h>
 
 #include "ha-chassis.h"
+#include "coverage.h"
 #include "lib/sset.h"
+#include "lib/uuid.h"
 #include "openvswitch/vlog.h"
 #include "lib/ovn-sb-idl.h"
 
 VLOG_DEFINE_THIS_MODULE(ha_chassis);
 
+COVERAGE_DEFINE(ha_chassis_cache_hit);
+COVERAGE_DEFINE(ha_chassis_cache_miss);
+
+/* Cache of the result of ha_chassis_group_is_active(), per HA chassis group,
+ * so that the HA chassis of a group are not filtered and sorted again for
+ * every chassisredirect port that uses it.
+ *
+ * The result depends on the HA chassis group, on the local chassis and on
+ * the active tunnels, i.e. the BFD status of the tunnels.  The cache is
+ * flushed by ha_chassis_cache_flush() whenever one of them may have
+ * changed. */
+struct ha_chassis_cache_entry {
+    struct hmap_node hmap_node;         /* In 'ha_chassis_cache'. */
+    struct uuid group_uuid;
+    struct uuid local_chassis_uuid;
+    const struct sset *active_tunnels;
+    bool is_active;
+};
+
+static struct hmap ha_chassis_cache = HMAP_INITIALIZER(&ha_chassis_cache);
+
 static int
 compare_chassis_prio_(const void *a_, const void *b_)
 {
@@ -164,6 +187,33 @@ is_local_chassis_only_candidate(const struct sbrec_ha_chassis_group *ha_ch_grp,
     return (local_chassis_present && n_active_ha_chassis == 1);
 }
 
+static bool
+ha_chassis_group_is_active__(const struct sbrec_ha_chassis_group *ha_ch_grp,
+                             const struct sset *active_tunnels,
+                             const struct sbrec_chassis *local_chassis)
+{
+    if (is_local_chassis_only_candidate(ha_ch_grp, local_chassis)) {
+        return true;
+    }
+
+    if (sset_is_empty(active_tunnels)) {
+        /* If active tunnel sset is empty, it means it has lost
+         * connectivity with other chassis. */
+        return false;
+    }
+
+    struct ha_chassis_ordered *ordered_ha_ch =
+        get_ordered_ha_chassis_list(ha_ch_grp, active_tunnels, local_chassis);
+    if (!ordered_ha_ch) {
+        return false;
+    }
+
+    struct sbrec_chassis *active_ch = ordered_ha_ch->ha_ch[0].chassis;
+    ha_chassis_destroy_ordered(ordered_ha_ch);
+
+    return (active_ch == local_chassis);
+}
+
 /* Returns true if the local_chassis is the master of
  * the HA chassis group, false otherwise. */
 bool
@@ -180,26 +230,66 @@ ha_chassis_group_is_active(
         return (ha_ch_grp->ha_chassis[0]->chassis == local_chassis);
     }
 
-    if (is_local_chassis_only_candidate(ha_ch_grp, local_chassis)) {
-        return true;
+    const struct uuid *group_uuid = &ha_ch_grp->header_.uuid;
+    const struct uuid *local_uuid = (local_chassis
+                                     ? &local_chassis->header_.uuid
+                                     : &UUID_ZERO);
+    uint32_t hash = uuid_hash(group_uuid);
+    struct ha_chassis_cache_entry *entry;
+    HMAP_FOR_EACH_WITH_HASH (entry, hmap_node, hash, &ha_chassis_cache) {
+        if (uuid_equals(&entry->group_uuid, group_uuid)) {
+            break;
+        }
     }
 
-    if (sset_is_empty(active_tunnels)) {
-        /* If active tunnel sset is empty, it means it has lost
-         * connectivity with other chassis. */
-        return false;
+    if (entry && uuid_equals(&entry->local_chassis_uuid, local_uuid)
+        && entry->active_tunnels == active_tunnels) {
+        COVERAGE_INC(ha_chassis_cache_hit);
+        return entry->is_active;
     }
 
-    struct ha_chassis_ordered *ordered_ha_ch =
-        get_ordered_ha_chassis_list(ha_ch_grp, active_tunnels, local_chassis);
-    if (!ordered_ha_ch) {
-        return false;
+    COVERAGE_INC(ha_chassis_cache_miss);
+    if (!entry) {
+        entry = xmalloc(sizeof *entry);
+        entry->group_uuid = *group_uuid;
+        hmap_insert(&ha_chassis_cache, &entry->hmap_node, hash);
     }
+    entry->local_chassis_uuid = *local_uuid;
+    entry->active_tunnels = active_tunnels;
+    entry->is_active = ha_chassis_group_is_active__(ha_ch_grp, active_tunnels,
+                                                    local_chassis);
+    return entry->is_active;
+}
 
-    struct sbrec_chassis *active_ch = ordered_ha_ch->ha_ch[0].chassis;
-    ha_chassis_destroy_ordered(ordered_ha_ch);
+/* Flushes the cache of ha_chassis_group_is_active() results.  Must be called
+ * whenever the HA chassis groups, their HA chassis or the active tunnels may
+ * have changed. */
+void
+ha_chassis_cache_flush(void)
+{
+    struct ha_chassis_cache_entry *entry;
+    HMAP_FOR_EACH_POP (entry, hmap_node, &ha_chassis_cache) {
+        free(entry);
+    }
+}
 
-    return (active_ch == local_chassis);
+/* Flushes the cache of ha_chassis_group_is_active() results if any HA
+ * chassis group or HA chassis changed in the Southbound database. */
+void
+ha_chassis_cache_run(const struct sbrec_ha_chassis_group_table *group_table,
+                     const struct sbrec_ha_chassis_table *ha_ch_table)
+{
+    if (sbrec_ha_chassis_group_table_track_get_first(group_table)
+        || sbrec_ha_chassis_table_track_get_first(ha_ch_table)) {
+        ha_chassis_cache_flush();
+    }
+}
+
+void
+ha_chassis_cache_destroy(void)
+{
+    ha_chassis_cache_flush();
+    hmap_destroy(&ha_chassis_cache);
 }
 
 bool
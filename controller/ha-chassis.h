@@ -22,6 +22,8 @@
 
 struct sbrec_chassis;
 struct sbrec_ha_chassis_group;
+struct sbrec_ha_chassis_group_table;
+struct sbrec_ha_chassis_table;
 struct sset;
 
 struct ha_chassis_ordered {
@@ -47,4 +49,10 @@ struct ha_chassis_ordered *ha_chassis_get_ordered(
 void ha_chassis_destroy_ordered(
     struct ha_chassis_ordered *ordered_ha_ch);
 
+void ha_chassis_cache_run(
+    const struct sbrec_ha_chassis_group_table *,
+    const struct sbrec_ha_chassis_table *);
+void ha_chassis_cache_flush(void);
+void ha_chassis_cache_destroy(void);
+
 #endif /* OVN_HA_CHASSIS_H */
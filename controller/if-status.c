@@ -19,10 +19,12 @@
 #include "if-status.h"
 #include "ofctrl-seqno.h"
 #include "simap.h"
+#include "sset.h"
 
 #include "lib/hmapx.h"
 #include "lib/util.h"
 #include "timeval.h"
+#include "openvswitch/dynamic-string.h"
 #include "openvswitch/vlog.h"
 
 VLOG_DEFINE_THIS_MODULE(if_status);
@@ -50,6 +52,15 @@ VLOG_DEFINE_THIS_MODULE(if_status);
  * C. At every iteration, based on ofctrl_seqno updates, handled in
  *    if_status_mgr_run():
  * - the flows for a previously claimed interface have been installed in OVS.
+ *
+ * The interfaces are handled in batches: all the interfaces claimed in an
+ * iteration share the same ofctrl seqno, and the "up"/"down" updates of all
+ * the interfaces are written in the iterations where both the Southbound and
+ * OVS databases are writable, so that each batch results in a single
+ * transaction to each database instead of partial updates.
+ *
+ * For each interface, the time between its claim and its binding being
+ * confirmed "up" is recorded, see if_status_mgr_get_stats().
  */
 
 enum if_state {
@@ -85,6 +96,26 @@ struct ovs_iface {
                              * be fully programmed in OVS.  Only used in state
                              * OIF_INSTALL_FLOWS.
                              */
+    long long int claim_time;  /* time_msec() of the last claim. */
+    long long int up_msec;     /* Time it took, in msec, from the last claim
+                                * to state OIF_INSTALLED, -1 if not there
+                                * yet. */
+};
+
+/* Buckets of the "time to up" histogram, by upper bound in msec. */
+static const long long int up_buckets_msec[] = {
+    100, 500, 1000, 5000, 10000, LLONG_MAX,
+};
+static const char *up_bucket_names[] = {
+    "<100ms", "<500ms", "<1s", "<5s", "<10s", ">=10s",
+};
+BUILD_ASSERT_DECL(ARRAY_SIZE(up_buckets_msec) == ARRAY_SIZE(up_bucket_names));
+
+struct if_status_up_stats {
+    uint64_t count;
+    uint64_t total_msec;
+    uint64_t max_msec;
+    uint64_t buckets[ARRAY_SIZE(up_buckets_msec)];
 };
 
 static uint64_t ifaces_usage;
@@ -104,6 +135,14 @@ struct if_status_mgr {
      * interfaces have been installed.
      */
     uint32_t iface_seqno;
+
+    /* "Time to up" of the interfaces, from their claim to their binding
+     * being confirmed "up". */
+    struct if_status_up_stats up_stats;
+
+    /* Time from the claim of each interface to its flows being installed
+     * in OVS. */
+    struct ofctrl_latency *install_latency;
 };
 
 static struct ovs_iface *ovs_iface_create(struct if_status_mgr *,
@@ -116,13 +155,16 @@ static void ovs_iface_set_state(struct if_status_mgr *, struct ovs_iface *,
 static void if_status_mgr_update_bindings(
     struct if_status_mgr *mgr, struct local_binding_data *binding_data,
     bool sb_readonly, bool ovs_readonly);
+static void if_status_mgr_account_up(struct if_status_mgr *,
+                                     struct ovs_iface *);
 
 struct if_status_mgr *
 if_status_mgr_create(void)
 {
     struct if_status_mgr *mgr = xzalloc(sizeof *mgr);
 
-    mgr->iface_seq_type_pb_cfg = ofctrl_seqno_add_type();
+    mgr->iface_seq_type_pb_cfg = ofctrl_seqno_add_type("port_binding");
+    mgr->install_latency = ofctrl_latency_get("port_claim");
     for (size_t i = 0; i < ARRAY_SIZE(mgr->ifaces_per_state); i++) {
         hmapx_init(&mgr->ifaces_per_state[i]);
     }
@@ -174,6 +216,8 @@ if_status_mgr_claim_iface(struct if_status_mgr *mgr, const char *iface_id)
     case OIF_INSTALLED:
     case OIF_MARK_DOWN:
         ovs_iface_set_state(mgr, iface, OIF_CLAIMED);
+        iface->claim_time = time_msec();
+        iface->up_msec = -1;
         break;
     case OIF_MAX:
         OVS_NOT_REACHED();
@@ -264,6 +308,7 @@ if_status_mgr_update(struct if_status_mgr *mgr,
 
         if (local_binding_is_up(bindings, iface->id)) {
             ovs_iface_set_state(mgr, iface, OIF_INSTALLED);
+            if_status_mgr_account_up(mgr, iface);
         }
     }
 
@@ -323,6 +368,8 @@ if_status_mgr_run(struct if_status_mgr *mgr,
                                           iface->install_seqno)) {
             continue;
         }
+        ofctrl_latency_record(mgr->install_latency,
+                              time_msec() - iface->claim_time);
         ovs_iface_set_state(mgr, iface, OIF_MARK_UP);
     }
     ofctrl_acked_seqnos_destroy(acked_seqnos);
@@ -352,6 +399,8 @@ ovs_iface_create(struct if_status_mgr *mgr, const char *iface_id,
 
     VLOG_DBG("Interface %s create.", iface_id);
     iface->id = xstrdup(iface_id);
+    iface->claim_time = time_msec();
+    iface->up_msec = -1;
     shash_add_nocopy(&mgr->ifaces, iface->id, iface);
     ovs_iface_set_state(mgr, iface, state);
     ovs_iface_account_mem(iface_id, false);
@@ -396,6 +445,13 @@ if_status_mgr_update_bindings(struct if_status_mgr *mgr,
         return;
     }
 
+    /* Write the whole batch of updates in an iteration where both databases
+     * are writable, rather than part of them now and the rest later, each
+     * update would otherwise cost a transaction per database. */
+    if (sb_readonly || ovs_readonly) {
+        return;
+    }
+
     struct shash *bindings = &binding_data->bindings;
     struct hmapx_node *node;
 
@@ -431,6 +487,44 @@ if_status_mgr_update_bindings(struct if_status_mgr *mgr,
     }
 }
 
+static void
+if_status_mgr_account_up(struct if_status_mgr *mgr, struct ovs_iface *iface)
+{
+    struct if_status_up_stats *stats = &mgr->up_stats;
+    long long int up_msec = MAX(time_msec() - iface->claim_time, 0);
+
+    iface->up_msec = up_msec;
+    stats->count++;
+    stats->total_msec += up_msec;
+    stats->max_msec = MAX(stats->max_msec, up_msec);
+    for (size_t i = 0; i < ARRAY_SIZE(up_buckets_msec); i++) {
+        if (up_msec < up_buckets_msec[i]) {
+            stats->buckets[i]++;
+            break;
+        }
+    }
+    VLOG_DBG("Interface %s up %lld ms after its claim", iface->id, up_msec);
+}
+
+/* Adds to 'iface_ids' the ids of the interfaces that were claimed but whose
+ * flows are not fully installed in OVS yet. */
+void
+if_status_mgr_get_pending_ifaces(const struct if_status_mgr *mgr,
+                                 struct sset *iface_ids)
+{
+    static const enum if_state pending_states[] = {
+        OIF_CLAIMED, OIF_INSTALL_FLOWS,
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(pending_states); i++) {
+        struct hmapx_node *node;
+        HMAPX_FOR_EACH (node, &mgr->ifaces_per_state[pending_states[i]]) {
+            struct ovs_iface *iface = node->data;
+            sset_add(iface_ids, iface->id);
+        }
+    }
+}
+
 void
 if_status_mgr_get_memory_usage(struct if_status_mgr *mgr,
                                struct simap *usage)
@@ -446,3 +540,49 @@ if_status_mgr_get_memory_usage(struct if_status_mgr *mgr,
     simap_increase(usage, "if_status_mgr_ifaces_state_usage-KB",
                    ROUND_UP(ifaces_state_usage, 1024) / 1024);
 }
+
+/* Appends to 'ds' the number of interfaces per state, the "time to up"
+ * statistics and, for each interface, its state and its time to up, or the
+ * time elapsed since its claim if it is not up yet. */
+void
+if_status_mgr_get_stats(const struct if_status_mgr *mgr, struct ds *ds)
+{
+    const struct if_status_up_stats *stats = &mgr->up_stats;
+
+    ds_put_format(ds, "Interfaces: %"PRIuSIZE"\n", shash_count(&mgr->ifaces));
+    for (size_t i = 0; i < OIF_MAX; i++) {
+        ds_put_format(ds, "- %s: %"PRIuSIZE"\n", if_state_names[i],
+                      hmapx_count(&mgr->ifaces_per_state[i]));
+    }
+
+    ds_put_format(ds, "Time to up (ms): count %"PRIu64", avg %"PRIu64
+                  ", max %"PRIu64"\n", stats->count,
+                  stats->count ? stats->total_msec / stats->count : 0,
+                  stats->max_msec);
+    for (size_t i = 0; i < ARRAY_SIZE(up_buckets_msec); i++) {
+        ds_put_format(ds, "%s%s: %"PRIu64, i ? ", " : "- ",
+                      up_bucket_names[i], stats->buckets[i]);
+    }
+    ds_put_char(ds, '\n');
+
+    const struct shash_node **nodes = shash_sort(&mgr->ifaces);
+    long long int now = time_msec();
+    for (size_t i = 0; i < shash_count(&mgr->ifaces); i++) {
+        const struct ovs_iface *iface = nodes[i]->data;
+
+        ds_put_format(ds, "%s: %s, ", iface->id, if_state_names[iface->state]);
+        if (iface->up_msec >= 0) {
+            ds_put_format(ds, "up %lld ms after claim\n", iface->up_msec);
+        } else {
+            ds_put_format(ds, "claimed %lld ms ago\n",
+                          now - iface->claim_time);
+        }
+    }
+    free(nodes);
+}
+
+void
+if_status_mgr_clear_stats(struct if_status_mgr *mgr)
+{
+    memset(&mgr->up_stats, 0, sizeof mgr->up_stats);
+}
@@ -20,8 +20,10 @@
 
 #include "binding.h"
 
+struct ds;
 struct if_status_mgr;
 struct simap;
+struct sset;
 
 struct if_status_mgr *if_status_mgr_create(void);
 void if_status_mgr_clear(struct if_status_mgr *);
@@ -34,7 +36,11 @@ void if_status_mgr_delete_iface(struct if_status_mgr *, const char *iface_id);
 void if_status_mgr_update(struct if_status_mgr *, struct local_binding_data *);
 void if_status_mgr_run(struct if_status_mgr *mgr, struct local_binding_data *,
                        bool sb_readonly, bool ovs_readonly);
+void if_status_mgr_get_pending_ifaces(const struct if_status_mgr *,
+                                      struct sset *iface_ids);
 void if_status_mgr_get_memory_usage(struct if_status_mgr *mgr,
                                     struct simap *usage);
+void if_status_mgr_get_stats(const struct if_status_mgr *, struct ds *);
+void if_status_mgr_clear_stats(struct if_status_mgr *);
 
 # endif /* controller/if-status.h */
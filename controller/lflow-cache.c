@@ -22,18 +22,25 @@
 #endif
 
 #include "coverage.h"
+#include "flow.h"
+#include "hash.h"
 #include "lflow-cache.h"
 #include "lib/uuid.h"
+#include "openvswitch/list.h"
 #include "openvswitch/poll-loop.h"
 #include "openvswitch/vlog.h"
+#include "ovn/actions.h"
 #include "ovn/expr.h"
 #include "timeval.h"
 
 VLOG_DEFINE_THIS_MODULE(lflow_cache);
 
 COVERAGE_DEFINE(lflow_cache_flush);
+COVERAGE_DEFINE(lflow_cache_add_actions);
 COVERAGE_DEFINE(lflow_cache_add_expr);
 COVERAGE_DEFINE(lflow_cache_add_matches);
+COVERAGE_DEFINE(lflow_cache_add_packed_matches);
+COVERAGE_DEFINE(lflow_cache_free_actions);
 COVERAGE_DEFINE(lflow_cache_free_expr);
 COVERAGE_DEFINE(lflow_cache_free_matches);
 COVERAGE_DEFINE(lflow_cache_add);
@@ -43,13 +50,39 @@ COVERAGE_DEFINE(lflow_cache_delete);
 COVERAGE_DEFINE(lflow_cache_full);
 COVERAGE_DEFINE(lflow_cache_mem_full);
 COVERAGE_DEFINE(lflow_cache_made_room);
+COVERAGE_DEFINE(lflow_cache_not_admitted);
 COVERAGE_DEFINE(lflow_cache_trim);
+COVERAGE_DEFINE(lflow_cache_orphan);
+COVERAGE_DEFINE(lflow_cache_adopt);
+COVERAGE_DEFINE(lflow_cache_free_orphan);
 
 static const char *lflow_cache_type_names[LCACHE_T_MAX] = {
+    [LCACHE_T_ACTIONS] = "cache-actions",
     [LCACHE_T_EXPR]    = "cache-expr",
     [LCACHE_T_MATCHES] = "cache-matches",
 };
 
+/* Short type names used for the per type statistics. */
+static const char *lflow_cache_type_short_names[LCACHE_T_MAX] = {
+    [LCACHE_T_ACTIONS] = "actions",
+    [LCACHE_T_EXPR]    = "expr",
+    [LCACHE_T_MATCHES] = "matches",
+};
+
+/* Access frequency sketch (count-min) used to decide whether a new entry
+ * should replace an existing entry of the same type when the cache is full.
+ * Every lookup increments, for each row, one small saturating counter chosen
+ * by hashing the lflow UUID; the estimated frequency is the minimum over the
+ * rows.  Once every LFLOW_CACHE_SKETCH_SAMPLES increments all the counters
+ * are halved so that flows that stopped being used lose their priority. */
+#define LFLOW_CACHE_SKETCH_ROWS 4
+#define LFLOW_CACHE_SKETCH_WIDTH 4096 /* Must be a power of 2. */
+#define LFLOW_CACHE_SKETCH_MAX 15
+#define LFLOW_CACHE_SKETCH_SAMPLES (10 * LFLOW_CACHE_SKETCH_WIDTH)
+
+/* Maximum value of the CLOCK reference counter of an entry. */
+#define LFLOW_CACHE_REF_MAX 3
+
 static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
 
 struct lflow_cache {
@@ -66,18 +99,61 @@ struct lflow_cache {
     long long int last_active_ms;
     bool recently_active;
     bool enabled;
+    bool pack_matches;
+
+    /* If true, the entries are keyed by the content of the logical flows
+     * instead of their UUIDs, see lflow_cache_delete(). */
+    bool by_content;
+
+    /* Entries of the logical flows deleted while 'by_content' is true, in
+     * the order they were orphaned.  They are deleted after
+     * 'trim_timeout_ms', unless a new logical flow with the same content
+     * looks them up first. */
+    struct ovs_list orphans;
+
+    /* Entries of each type, in CLOCK order.  The front of each list is the
+     * position of the clock hand. */
+    struct ovs_list clock[LCACHE_T_MAX];
+
+    uint8_t sketch[LFLOW_CACHE_SKETCH_ROWS][LFLOW_CACHE_SKETCH_WIDTH];
+    uint32_t n_sketch_samples;
+
+    uint64_t n_hits[LCACHE_T_MAX];
+    uint64_t n_misses;
+    uint64_t n_evictions[LCACHE_T_MAX];
+    uint64_t n_rejected;
 };
 
 struct lflow_cache_entry {
     struct hmap_node node;
+    struct ovs_list clock_node; /* In 'struct lflow_cache' 'clock'. */
     struct uuid lflow_uuid; /* key */
     size_t size;
+    uint8_t ref;                /* CLOCK reference counter. */
+
+    /* In 'struct lflow_cache' 'orphans', if 'orphaned_ms' is nonzero. */
+    struct ovs_list orphan_node;
+    long long int orphaned_ms;
 
     struct lflow_cache_value value;
 };
 
 static bool lflow_cache_make_room__(struct lflow_cache *lc,
-                                    enum lflow_cache_type type);
+                                    enum lflow_cache_type type,
+                                    const struct uuid *lflow_uuid);
+static struct lflow_cache_entry *lflow_cache_lookup__(
+    const struct lflow_cache *lc, const struct uuid *lflow_uuid);
+static struct lflow_cache_entry *lflow_cache_lookup_type__(
+    const struct lflow_cache *lc, enum lflow_cache_type type,
+    const struct uuid *lflow_uuid);
+static void lflow_cache_sketch_record__(struct lflow_cache *lc,
+                                        const struct uuid *lflow_uuid);
+static uint8_t lflow_cache_sketch_estimate__(const struct lflow_cache *lc,
+                                             const struct uuid *lflow_uuid);
+static struct lflow_cache_packed_matches *lflow_cache_pack_matches__(
+    const struct hmap *matches, size_t *size);
+static void lflow_cache_packed_matches_destroy__(
+    struct lflow_cache_packed_matches *);
 static struct lflow_cache_value *lflow_cache_add__(
     struct lflow_cache *lc, const struct uuid *lflow_uuid,
     enum lflow_cache_type type, uint64_t value_size);
@@ -85,6 +161,7 @@ static void lflow_cache_delete__(struct lflow_cache *lc,
                                  struct lflow_cache_entry *lce);
 static void lflow_cache_trim__(struct lflow_cache *lc, bool force);
 static void lflow_cache_record_activity__(struct lflow_cache *lc);
+static void lflow_cache_adopt__(struct lflow_cache_entry *lce);
 
 struct lflow_cache *
 lflow_cache_create(void)
@@ -93,7 +170,9 @@ lflow_cache_create(void)
 
     for (size_t i = 0; i < LCACHE_T_MAX; i++) {
         hmap_init(&lc->entries[i]);
+        ovs_list_init(&lc->clock[i]);
     }
+    ovs_list_init(&lc->orphans);
 
     return lc;
 }
@@ -133,7 +212,8 @@ lflow_cache_destroy(struct lflow_cache *lc)
 void
 lflow_cache_enable(struct lflow_cache *lc, bool enabled, uint32_t capacity,
                    uint64_t max_mem_usage_kb, uint32_t lflow_trim_limit,
-                   uint32_t trim_wmark_perc, uint32_t trim_timeout_ms)
+                   uint32_t trim_wmark_perc, uint32_t trim_timeout_ms,
+                   bool pack_matches, bool by_content)
 {
     if (!lc) {
         return;
@@ -158,6 +238,7 @@ lflow_cache_enable(struct lflow_cache *lc, bool enabled, uint32_t capacity,
     bool need_trim = false;
 
     if ((lc->enabled && !enabled)
+            || lc->by_content != by_content
             || capacity < lc->n_entries
             || max_mem_usage < lc->mem_usage) {
         need_flush = true;
@@ -174,6 +255,12 @@ lflow_cache_enable(struct lflow_cache *lc, bool enabled, uint32_t capacity,
     lc->trim_wmark_perc = trim_wmark_perc;
     lc->trim_timeout_ms = trim_timeout_ms;
 
+    /* Entries that are already cached keep their current form. */
+    lc->pack_matches = pack_matches;
+
+    /* The keys of the entries change, so they are all flushed. */
+    lc->by_content = by_content;
+
     if (need_flush) {
         lflow_cache_record_activity__(lc);
         lflow_cache_flush(lc);
@@ -189,6 +276,15 @@ lflow_cache_is_enabled(const struct lflow_cache *lc)
     return lc && lc->enabled;
 }
 
+/* Returns true if the entries of 'lc' are keyed by a hash of the content of
+ * the logical flows instead of by their UUIDs.  The caller is responsible
+ * for computing the keys accordingly. */
+bool
+lflow_cache_is_by_content(const struct lflow_cache *lc)
+{
+    return lflow_cache_is_enabled(lc) && lc->by_content;
+}
+
 void
 lflow_cache_get_stats(const struct lflow_cache *lc, struct ds *output)
 {
@@ -212,6 +308,23 @@ lflow_cache_get_stats(const struct lflow_cache *lc, struct ds *output)
                       hmap_count(&lc->entries[i]));
     }
     ds_put_format(output, "%-16s: %"PRIu64"\n", "trim count", lc->trim_count);
+    for (size_t i = 0; i < LCACHE_T_MAX; i++) {
+        char *name = xasprintf("hits-%s", lflow_cache_type_short_names[i]);
+        ds_put_format(output, "%-16s: %"PRIu64"\n", name, lc->n_hits[i]);
+        free(name);
+    }
+    ds_put_format(output, "%-16s: %"PRIu64"\n", "misses", lc->n_misses);
+    for (size_t i = 0; i < LCACHE_T_MAX; i++) {
+        char *name = xasprintf("evicted-%s", lflow_cache_type_short_names[i]);
+        ds_put_format(output, "%-16s: %"PRIu64"\n", name,
+                      lc->n_evictions[i]);
+        free(name);
+    }
+    ds_put_format(output, "%-16s: %"PRIu64"\n", "rejected", lc->n_rejected);
+    if (lc->by_content) {
+        ds_put_format(output, "%-16s: %"PRIuSIZE"\n", "orphans",
+                      ovs_list_size(&lc->orphans));
+    }
     ds_put_format(output, "%-16s: %"PRIu64"\n", "Mem usage (KB)",
                   ROUND_UP(lc->mem_usage, 1024) / 1024);
 }
@@ -236,20 +349,67 @@ lflow_cache_add_matches(struct lflow_cache *lc, const struct uuid *lflow_uuid,
                         uint32_t conj_id_ofs, uint32_t n_conjs,
                         struct hmap *matches, size_t matches_sz)
 {
+    struct lflow_cache_packed_matches *packed = NULL;
+
+    if (matches && lflow_uuid && lflow_cache_is_enabled(lc)
+        && lc->pack_matches) {
+        packed = lflow_cache_pack_matches__(matches, &matches_sz);
+        expr_matches_destroy(matches);
+        free(matches);
+        matches = NULL;
+    }
+
     struct lflow_cache_value *lcv =
         lflow_cache_add__(lc, lflow_uuid, LCACHE_T_MATCHES, matches_sz);
 
     if (!lcv) {
         expr_matches_destroy(matches);
         free(matches);
+        lflow_cache_packed_matches_destroy__(packed);
         return;
     }
     COVERAGE_INC(lflow_cache_add_matches);
-    lcv->expr_matches = matches;
+    if (packed) {
+        COVERAGE_INC(lflow_cache_add_packed_matches);
+        lcv->packed = true;
+        lcv->packed_matches = packed;
+    } else {
+        lcv->expr_matches = matches;
+    }
     lcv->n_conjs = n_conjs;
     lcv->conj_id_ofs = conj_id_ofs;
 }
 
+/* Adds to 'lc' the actions of the logical flow 'lflow_uuid', parsed into
+ * 'ovnacts' with the prerequisites 'prereqs'.  Takes ownership of the
+ * contents of 'ovnacts' and of 'prereqs'. */
+void
+lflow_cache_add_actions(struct lflow_cache *lc, const struct uuid *lflow_uuid,
+                        struct ofpbuf *ovnacts, struct expr *prereqs,
+                        size_t actions_sz)
+{
+    struct lflow_cache_value *lcv =
+        lflow_cache_add__(lc, lflow_uuid, LCACHE_T_ACTIONS,
+                          sizeof *lcv->actions + actions_sz);
+
+    if (!lcv) {
+        ovnacts_free(ovnacts->data, ovnacts->size);
+        ofpbuf_uninit(ovnacts);
+        expr_destroy(prereqs);
+        return;
+    }
+    COVERAGE_INC(lflow_cache_add_actions);
+    lcv->actions = xmalloc(sizeof *lcv->actions);
+    ofpbuf_init(&lcv->actions->ovnacts, ovnacts->size);
+    if (ovnacts->size) {
+        ofpbuf_put(&lcv->actions->ovnacts, ovnacts->data, ovnacts->size);
+    }
+    ofpbuf_uninit(ovnacts);
+    lcv->actions->prereqs = prereqs;
+}
+
+/* Returns the cached expr tree or matches of the logical flow
+ * 'lflow_uuid', or NULL if there are none. */
 struct lflow_cache_value *
 lflow_cache_get(struct lflow_cache *lc, const struct uuid *lflow_uuid)
 {
@@ -257,57 +417,217 @@ lflow_cache_get(struct lflow_cache *lc, const struct uuid *lflow_uuid)
         return NULL;
     }
 
-    size_t hash = uuid_hash(lflow_uuid);
+    lflow_cache_sketch_record__(lc, lflow_uuid);
 
-    for (size_t i = 0; i < LCACHE_T_MAX; i++) {
-        struct lflow_cache_entry *lce;
+    struct lflow_cache_entry *lce = lflow_cache_lookup__(lc, lflow_uuid);
+    if (!lce) {
+        COVERAGE_INC(lflow_cache_miss);
+        lc->n_misses++;
+        return NULL;
+    }
 
-        HMAP_FOR_EACH_WITH_HASH (lce, node, hash, &lc->entries[i]) {
-            if (uuid_equals(&lce->lflow_uuid, lflow_uuid)) {
-                COVERAGE_INC(lflow_cache_hit);
-                return &lce->value;
-            }
-        }
+    COVERAGE_INC(lflow_cache_hit);
+    lc->n_hits[lce->value.type]++;
+    if (lce->ref < LFLOW_CACHE_REF_MAX) {
+        lce->ref++;
     }
-    COVERAGE_INC(lflow_cache_miss);
-    return NULL;
+    lflow_cache_adopt__(lce);
+    return &lce->value;
+}
+
+/* Returns the cached parsed actions of the logical flow 'lflow_uuid', or
+ * NULL if there are none.  The actions must not be modified and must not be
+ * used after adding entries to 'lc' or deleting the ones of 'lflow_uuid'. */
+const struct lflow_cache_actions *
+lflow_cache_get_actions(struct lflow_cache *lc, const struct uuid *lflow_uuid)
+{
+    if (!lflow_cache_is_enabled(lc)) {
+        return NULL;
+    }
+
+    struct lflow_cache_entry *lce =
+        lflow_cache_lookup_type__(lc, LCACHE_T_ACTIONS, lflow_uuid);
+    if (!lce) {
+        COVERAGE_INC(lflow_cache_miss);
+        lc->n_misses++;
+        return NULL;
+    }
+
+    COVERAGE_INC(lflow_cache_hit);
+    lc->n_hits[LCACHE_T_ACTIONS]++;
+    if (lce->ref < LFLOW_CACHE_REF_MAX) {
+        lce->ref++;
+    }
+    lflow_cache_adopt__(lce);
+    return lce->value.actions;
 }
 
+/* Fills 'm' with the contents of 'pm', for adding it to the flow table.
+ * 'm' points to the conjunctions and the address set name of 'pm', so it
+ * must not be destroyed and must not outlive the cache entry. */
 void
-lflow_cache_delete(struct lflow_cache *lc, const struct uuid *lflow_uuid)
+lflow_cache_packed_match_expand(const struct lflow_cache_packed_match *pm,
+                                struct expr_match *m)
 {
-    if (!lc) {
+    minimatch_expand(&pm->match, &m->match);
+    m->conjunctions = CONST_CAST(struct cls_conjunction *, pm->conjunctions);
+    m->n = m->allocated = pm->n;
+    m->as_name = CONST_CAST(char *, pm->as_name);
+    m->as_ip = pm->as_ip;
+    m->as_mask = pm->as_mask;
+}
+
+/* Marks 'lce', whose logical flow was deleted, as an orphan. */
+static void
+lflow_cache_orphan__(struct lflow_cache *lc, struct lflow_cache_entry *lce)
+{
+    if (!lce->orphaned_ms) {
+        COVERAGE_INC(lflow_cache_orphan);
+        lce->orphaned_ms = time_msec();
+        ovs_list_push_back(&lc->orphans, &lce->orphan_node);
+    }
+}
+
+/* Takes 'lce' back from the orphans, if it is one, because a logical flow
+ * with the same content uses it. */
+static void
+lflow_cache_adopt__(struct lflow_cache_entry *lce)
+{
+    if (lce->orphaned_ms) {
+        COVERAGE_INC(lflow_cache_adopt);
+        lce->orphaned_ms = 0;
+        ovs_list_remove(&lce->orphan_node);
+    }
+}
+
+/* Deletes the cached expr tree or matches of the logical flow 'lflow_uuid',
+ * and its parsed actions if 'actions' is true.  If 'orphan' is true and the
+ * cache is keyed by content, the entries are only marked as orphans. */
+static void
+lflow_cache_delete_lflow__(struct lflow_cache *lc,
+                           const struct uuid *lflow_uuid, bool actions,
+                           bool orphan)
+{
+    if (!lflow_cache_is_enabled(lc)) {
         return;
     }
 
-    struct lflow_cache_value *lcv = lflow_cache_get(lc, lflow_uuid);
-    if (lcv) {
+    struct lflow_cache_entry *lce = lflow_cache_lookup__(lc, lflow_uuid);
+    struct lflow_cache_entry *actions_lce =
+        actions
+        ? lflow_cache_lookup_type__(lc, LCACHE_T_ACTIONS, lflow_uuid)
+        : NULL;
+    if (orphan && lc->by_content) {
+        if (lce) {
+            lflow_cache_orphan__(lc, lce);
+        }
+        if (actions_lce) {
+            lflow_cache_orphan__(lc, actions_lce);
+        }
+    } else if (lce || actions_lce) {
         COVERAGE_INC(lflow_cache_delete);
-        lflow_cache_delete__(lc, CONTAINER_OF(lcv, struct lflow_cache_entry,
-                                              value));
+        if (lce) {
+            lflow_cache_delete__(lc, lce);
+        }
+        if (actions_lce) {
+            lflow_cache_delete__(lc, actions_lce);
+        }
         lflow_cache_trim__(lc, false);
         lflow_cache_record_activity__(lc);
     }
 }
 
+/* Deletes the cache entries of the logical flow 'lflow_uuid', because it
+ * was deleted.
+ *
+ * If the cache is keyed by content, 'lflow_uuid' is the content key of the
+ * logical flow and the entries are kept as orphans for 'trim_timeout_ms'
+ * instead, since other logical flows may have the same content: northd
+ * recreates identical logical flows with new UUIDs, e.g. after a failover or
+ * when the datapath groups change. */
+void
+lflow_cache_delete(struct lflow_cache *lc, const struct uuid *lflow_uuid)
+{
+    lflow_cache_delete_lflow__(lc, lflow_uuid, true, true);
+}
+
+/* Same as lflow_cache_delete() but keeps the parsed actions, and always
+ * deletes the entries. */
+void
+lflow_cache_delete_matches(struct lflow_cache *lc,
+                           const struct uuid *lflow_uuid)
+{
+    lflow_cache_delete_lflow__(lc, lflow_uuid, false, false);
+}
+
+/* Deletes all the cached parsed actions, e.g. because the options that the
+ * actions refer to changed. */
+void
+lflow_cache_flush_actions(struct lflow_cache *lc)
+{
+    if (!lflow_cache_is_enabled(lc)) {
+        return;
+    }
+
+    struct lflow_cache_entry *lce;
+    HMAP_FOR_EACH_SAFE (lce, node, &lc->entries[LCACHE_T_ACTIONS]) {
+        lflow_cache_delete__(lc, lce);
+    }
+    lflow_cache_trim__(lc, false);
+}
+
+/* Returns the entry of type 'type' that the CLOCK policy selects for
+ * eviction, that is, the first one from the clock hand that wasn't hit since
+ * the hand last passed over it.  Entries that were hit are given a second
+ * chance. */
+static struct lflow_cache_entry *
+lflow_cache_clock_victim__(struct lflow_cache *lc, enum lflow_cache_type type)
+{
+    struct ovs_list *clock = &lc->clock[type];
+
+    while (!ovs_list_is_empty(clock)) {
+        struct lflow_cache_entry *lce =
+            CONTAINER_OF(ovs_list_front(clock), struct lflow_cache_entry,
+                         clock_node);
+        if (!lce->ref) {
+            return lce;
+        }
+        lce->ref--;
+        ovs_list_remove(&lce->clock_node);
+        ovs_list_push_back(clock, &lce->clock_node);
+    }
+    return NULL;
+}
+
 static bool
-lflow_cache_make_room__(struct lflow_cache *lc, enum lflow_cache_type type)
+lflow_cache_make_room__(struct lflow_cache *lc, enum lflow_cache_type type,
+                        const struct uuid *lflow_uuid)
 {
     /* When the cache becomes full, the rule is to prefer more "important"
      * cache entries over less "important" ones.  That is, evict entries of
-     * type LCACHE_T_EXPR if there's no room to add an entry of type
-     * LCACHE_T_MATCHES.
+     * type LCACHE_T_ACTIONS, then LCACHE_T_EXPR, if there's no room to add
+     * an entry of type LCACHE_T_MATCHES.
      */
+    struct lflow_cache_entry *victim;
     for (size_t i = 0; i < type; i++) {
-        if (hmap_count(&lc->entries[i]) > 0) {
-            struct lflow_cache_entry *lce =
-                CONTAINER_OF(hmap_first(&lc->entries[i]),
-                             struct lflow_cache_entry, node);
-
-            lflow_cache_delete__(lc, lce);
+        victim = lflow_cache_clock_victim__(lc, i);
+        if (victim) {
+            lc->n_evictions[i]++;
+            lflow_cache_delete__(lc, victim);
             return true;
         }
     }
+
+    /* Otherwise, only replace an entry of the same type if the new one is
+     * looked up more often, so that flows that are recompiled over and over
+     * are not pushed out by flows that are used only once. */
+    victim = lflow_cache_clock_victim__(lc, type);
+    if (victim && lflow_cache_sketch_estimate__(lc, lflow_uuid)
+                  > lflow_cache_sketch_estimate__(lc, &victim->lflow_uuid)) {
+        lc->n_evictions[type]++;
+        lflow_cache_delete__(lc, victim);
+        return true;
+    }
     return false;
 }
 
@@ -327,11 +647,21 @@ lflow_cache_get_memory_usage(const struct lflow_cache *lc, struct simap *usage)
 void
 lflow_cache_run(struct lflow_cache *lc)
 {
+    long long int now = time_msec();
+
+    struct lflow_cache_entry *lce;
+    LIST_FOR_EACH_SAFE (lce, orphan_node, &lc->orphans) {
+        if (now - lce->orphaned_ms < lc->trim_timeout_ms) {
+            break;
+        }
+        COVERAGE_INC(lflow_cache_free_orphan);
+        lflow_cache_delete__(lc, lce);
+    }
+
     if (!lc->recently_active) {
         return;
     }
 
-    long long int now = time_msec();
     if (now < lc->last_active_ms || now < lc->trim_timeout_ms) {
         VLOG_WARN_RL(&rl, "Detected cache last active timestamp overflow");
         lc->recently_active = false;
@@ -358,6 +688,13 @@ lflow_cache_run(struct lflow_cache *lc)
 void
 lflow_cache_wait(struct lflow_cache *lc)
 {
+    if (!ovs_list_is_empty(&lc->orphans)) {
+        struct lflow_cache_entry *lce =
+            CONTAINER_OF(ovs_list_front(&lc->orphans),
+                         struct lflow_cache_entry, orphan_node);
+        poll_timer_wait_until(lce->orphaned_ms + lc->trim_timeout_ms);
+    }
+
     if (!lc->recently_active) {
         return;
     }
@@ -372,20 +709,38 @@ lflow_cache_add__(struct lflow_cache *lc, const struct uuid *lflow_uuid,
         return NULL;
     }
 
+    /* Logical flows with the same content share their entries, the first
+     * one added is kept. */
+    if (lc->by_content
+        && (type == LCACHE_T_ACTIONS
+            ? lflow_cache_lookup_type__(lc, type, lflow_uuid)
+            : lflow_cache_lookup__(lc, lflow_uuid))) {
+        return NULL;
+    }
+
     struct lflow_cache_entry *lce;
     size_t size = sizeof *lce + value_size;
-    if (size + lc->mem_usage > lc->max_mem_usage) {
+    if (size > lc->max_mem_usage) {
         COVERAGE_INC(lflow_cache_mem_full);
+        lc->n_rejected++;
         return NULL;
     }
 
-    if (lc->n_entries == lc->capacity) {
-        if (!lflow_cache_make_room__(lc, type)) {
-            COVERAGE_INC(lflow_cache_full);
+    while (lc->n_entries >= lc->capacity
+           || size + lc->mem_usage > lc->max_mem_usage) {
+        bool mem_full = lc->n_entries < lc->capacity;
+
+        if (!lflow_cache_make_room__(lc, type, lflow_uuid)) {
+            if (mem_full) {
+                COVERAGE_INC(lflow_cache_mem_full);
+            } else {
+                COVERAGE_INC(lflow_cache_full);
+            }
+            COVERAGE_INC(lflow_cache_not_admitted);
+            lc->n_rejected++;
             return NULL;
-        } else {
-            COVERAGE_INC(lflow_cache_made_room);
         }
+        COVERAGE_INC(lflow_cache_made_room);
     }
 
     lflow_cache_record_activity__(lc);
@@ -397,6 +752,9 @@ lflow_cache_add__(struct lflow_cache *lc, const struct uuid *lflow_uuid,
     lce->size = size;
     lce->value.type = type;
     hmap_insert(&lc->entries[type], &lce->node, uuid_hash(lflow_uuid));
+    /* New entries are inserted right behind the clock hand so that they are
+     * the last ones to be considered for eviction. */
+    ovs_list_push_back(&lc->clock[type], &lce->clock_node);
     lc->n_entries++;
     lc->high_watermark = MAX(lc->high_watermark, lc->n_entries);
     return &lce->value;
@@ -407,19 +765,35 @@ lflow_cache_delete__(struct lflow_cache *lc, struct lflow_cache_entry *lce)
 {
     ovs_assert(lc->n_entries > 0);
     hmap_remove(&lc->entries[lce->value.type], &lce->node);
+    ovs_list_remove(&lce->clock_node);
+    if (lce->orphaned_ms) {
+        ovs_list_remove(&lce->orphan_node);
+    }
     lc->n_entries--;
     switch (lce->value.type) {
     case LCACHE_T_NONE:
         OVS_NOT_REACHED();
         break;
+    case LCACHE_T_ACTIONS:
+        COVERAGE_INC(lflow_cache_free_actions);
+        ovnacts_free(lce->value.actions->ovnacts.data,
+                     lce->value.actions->ovnacts.size);
+        ofpbuf_uninit(&lce->value.actions->ovnacts);
+        expr_destroy(lce->value.actions->prereqs);
+        free(lce->value.actions);
+        break;
     case LCACHE_T_EXPR:
         COVERAGE_INC(lflow_cache_free_expr);
         expr_destroy(lce->value.expr);
         break;
     case LCACHE_T_MATCHES:
         COVERAGE_INC(lflow_cache_free_matches);
-        expr_matches_destroy(lce->value.expr_matches);
-        free(lce->value.expr_matches);
+        if (lce->value.packed) {
+            lflow_cache_packed_matches_destroy__(lce->value.packed_matches);
+        } else {
+            expr_matches_destroy(lce->value.expr_matches);
+            free(lce->value.expr_matches);
+        }
         break;
     }
 
@@ -428,6 +802,150 @@ lflow_cache_delete__(struct lflow_cache *lc, struct lflow_cache_entry *lce)
     free(lce);
 }
 
+static struct lflow_cache_entry *
+lflow_cache_lookup_type__(const struct lflow_cache *lc,
+                          enum lflow_cache_type type,
+                          const struct uuid *lflow_uuid)
+{
+    struct lflow_cache_entry *lce;
+
+    HMAP_FOR_EACH_WITH_HASH (lce, node, uuid_hash(lflow_uuid),
+                             &lc->entries[type]) {
+        if (uuid_equals(&lce->lflow_uuid, lflow_uuid)) {
+            return lce;
+        }
+    }
+    return NULL;
+}
+
+/* Looks up the expr tree or matches entry of 'lflow_uuid'.  The parsed
+ * actions are cached in a separate entry. */
+static struct lflow_cache_entry *
+lflow_cache_lookup__(const struct lflow_cache *lc,
+                     const struct uuid *lflow_uuid)
+{
+    for (size_t i = LCACHE_T_ACTIONS + 1; i < LCACHE_T_MAX; i++) {
+        struct lflow_cache_entry *lce =
+            lflow_cache_lookup_type__(lc, i, lflow_uuid);
+        if (lce) {
+            return lce;
+        }
+    }
+    return NULL;
+}
+
+static void
+lflow_cache_sketch_record__(struct lflow_cache *lc,
+                            const struct uuid *lflow_uuid)
+{
+    uint32_t hash = uuid_hash(lflow_uuid);
+
+    for (size_t i = 0; i < LFLOW_CACHE_SKETCH_ROWS; i++) {
+        uint8_t *counter =
+            &lc->sketch[i][hash_int(hash, i) & (LFLOW_CACHE_SKETCH_WIDTH - 1)];
+        if (*counter < LFLOW_CACHE_SKETCH_MAX) {
+            (*counter)++;
+        }
+    }
+
+    if (++lc->n_sketch_samples == LFLOW_CACHE_SKETCH_SAMPLES) {
+        for (size_t i = 0; i < LFLOW_CACHE_SKETCH_ROWS; i++) {
+            for (size_t j = 0; j < LFLOW_CACHE_SKETCH_WIDTH; j++) {
+                lc->sketch[i][j] /= 2;
+            }
+        }
+        lc->n_sketch_samples = 0;
+    }
+}
+
+static uint8_t
+lflow_cache_sketch_estimate__(const struct lflow_cache *lc,
+                              const struct uuid *lflow_uuid)
+{
+    uint32_t hash = uuid_hash(lflow_uuid);
+    uint8_t estimate = LFLOW_CACHE_SKETCH_MAX;
+
+    for (size_t i = 0; i < LFLOW_CACHE_SKETCH_ROWS; i++) {
+        estimate = MIN(estimate,
+                       lc->sketch[i][hash_int(hash, i)
+                                     & (LFLOW_CACHE_SKETCH_WIDTH - 1)]);
+    }
+    return estimate;
+}
+
+/* Returns a packed copy of 'matches' and stores in '*size' the memory it
+ * uses. */
+static struct lflow_cache_packed_matches *
+lflow_cache_pack_matches__(const struct hmap *matches, size_t *size)
+{
+    const struct expr_match *m;
+    size_t n_conjunctions = 0;
+    size_t names_len = 0;
+
+    HMAP_FOR_EACH (m, hmap_node, matches) {
+        n_conjunctions += m->n;
+        if (m->as_name) {
+            names_len += strlen(m->as_name) + 1;
+        }
+    }
+
+    size_t n = hmap_count(matches);
+    struct lflow_cache_packed_matches *packed;
+    size_t alloc_size = (sizeof *packed + n * sizeof packed->matches[0]
+                         + n_conjunctions * sizeof(struct cls_conjunction)
+                         + names_len);
+    packed = xmalloc(alloc_size);
+    packed->n = n;
+    *size = alloc_size;
+
+    struct cls_conjunction *conjunctions =
+        (struct cls_conjunction *) &packed->matches[n];
+    char *names = (char *) &conjunctions[n_conjunctions];
+    size_t i = 0;
+
+    HMAP_FOR_EACH (m, hmap_node, matches) {
+        struct lflow_cache_packed_match *pm = &packed->matches[i++];
+
+        /* The flow and the mask of a minimatch share the same map. */
+        minimatch_init(&pm->match, &m->match);
+        *size += 2 * (sizeof *pm->match.flow
+                      + MINIFLOW_VALUES_SIZE(
+                            miniflow_n_values(pm->match.flow)));
+
+        pm->conjunctions = conjunctions;
+        pm->n = m->n;
+        if (m->n) {
+            memcpy(conjunctions, m->conjunctions,
+                   m->n * sizeof *conjunctions);
+            conjunctions += m->n;
+        }
+
+        pm->as_name = NULL;
+        if (m->as_name) {
+            size_t len = strlen(m->as_name) + 1;
+            memcpy(names, m->as_name, len);
+            pm->as_name = names;
+            names += len;
+        }
+        pm->as_ip = m->as_ip;
+        pm->as_mask = m->as_mask;
+    }
+    return packed;
+}
+
+static void
+lflow_cache_packed_matches_destroy__(struct lflow_cache_packed_matches *packed)
+{
+    if (!packed) {
+        return;
+    }
+
+    for (size_t i = 0; i < packed->n; i++) {
+        minimatch_destroy(&packed->matches[i].match);
+    }
+    free(packed);
+}
+
 static void
 lflow_cache_trim__(struct lflow_cache *lc, bool force)
 {
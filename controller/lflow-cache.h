@@ -18,11 +18,17 @@
 #ifndef LFLOW_CACHE_H
 #define LFLOW_CACHE_H 1
 
+#include <netinet/in.h>
 #include "openvswitch/dynamic-string.h"
 #include "openvswitch/hmap.h"
+#include "openvswitch/match.h"
+#include "openvswitch/ofpbuf.h"
 #include "openvswitch/uuid.h"
 #include "simap.h"
 
+struct cls_conjunction;
+struct expr;
+struct expr_match;
 struct lflow_cache;
 
 /* Various lflow cache types which
@@ -33,14 +39,46 @@ struct lflow_cache;
  *     (1) expr tree if the logical flow doesn't have port group/address set
  *         references but has other references (such as lport).
  *     (2) expr matches if the logical flow doesn't have any references.
+ *
+ *  - Independently of (1) and (2), caches the parsed actions of the logical
+ *    flow, which don't depend on the datapath the flow is applied to.
+ *    They are the least expensive to recompute, so they are evicted first.
  */
 enum lflow_cache_type {
+    LCACHE_T_ACTIONS, /* Parsed actions of the logical flow are cached. */
     LCACHE_T_EXPR,    /* Expr tree of the logical flow is cached. */
     LCACHE_T_MATCHES, /* Expression matches are cached. */
     LCACHE_T_MAX,
     LCACHE_T_NONE = LCACHE_T_MAX, /* Not found in cache. */
 };
 
+/* A packed copy of one of the 'struct expr_match'es of a LCACHE_T_MATCHES
+ * entry.  The match is stored as a minimatch, which only keeps the fields
+ * that are actually matched on. */
+struct lflow_cache_packed_match {
+    struct minimatch match;
+    const struct cls_conjunction *conjunctions;
+    size_t n;
+
+    /* Tracked address set information. */
+    const char *as_name;
+    struct in6_addr as_ip;
+    struct in6_addr as_mask;
+};
+
+/* The packed form of the matches of a LCACHE_T_MATCHES entry.  The matches,
+ * their conjunctions and address set names share a single allocation. */
+struct lflow_cache_packed_matches {
+    size_t n;
+    struct lflow_cache_packed_match matches[];
+};
+
+/* The parsed actions of a LCACHE_T_ACTIONS entry. */
+struct lflow_cache_actions {
+    struct ofpbuf ovnacts;      /* Parsed "struct ovnact"s. */
+    struct expr *prereqs;       /* Prerequisites of the actions, or NULL. */
+};
+
 struct lflow_cache_value {
     enum lflow_cache_type type;
 
@@ -50,9 +88,15 @@ struct lflow_cache_value {
     uint32_t n_conjs;
     uint32_t conj_id_ofs;
 
+    /* LCACHE_T_MATCHES only: true if the matches are stored in
+     * 'packed_matches' instead of 'expr_matches'. */
+    bool packed;
+
     union {
         struct hmap *expr_matches;
+        struct lflow_cache_packed_matches *packed_matches;
         struct expr *expr;
+        struct lflow_cache_actions *actions;
     };
 };
 
@@ -61,8 +105,10 @@ void lflow_cache_flush(struct lflow_cache *);
 void lflow_cache_destroy(struct lflow_cache *);
 void lflow_cache_enable(struct lflow_cache *, bool enabled, uint32_t capacity,
                         uint64_t max_mem_usage_kb, uint32_t lflow_trim_limit,
-                        uint32_t trim_wmark_perc, uint32_t trim_timeout_ms);
+                        uint32_t trim_wmark_perc, uint32_t trim_timeout_ms,
+                        bool pack_matches, bool by_content);
 bool lflow_cache_is_enabled(const struct lflow_cache *);
+bool lflow_cache_is_by_content(const struct lflow_cache *);
 void lflow_cache_get_stats(const struct lflow_cache *, struct ds *output);
 
 void lflow_cache_add_expr(struct lflow_cache *, const struct uuid *lflow_uuid,
@@ -71,10 +117,21 @@ void lflow_cache_add_matches(struct lflow_cache *,
                              const struct uuid *lflow_uuid,
                              uint32_t conj_id_ofs, uint32_t n_conjs,
                              struct hmap *matches, size_t matches_sz);
+void lflow_cache_add_actions(struct lflow_cache *,
+                             const struct uuid *lflow_uuid,
+                             struct ofpbuf *ovnacts, struct expr *prereqs,
+                             size_t actions_sz);
 
 struct lflow_cache_value *lflow_cache_get(struct lflow_cache *,
                                           const struct uuid *lflow_uuid);
+const struct lflow_cache_actions *lflow_cache_get_actions(
+    struct lflow_cache *, const struct uuid *lflow_uuid);
+void lflow_cache_packed_match_expand(const struct lflow_cache_packed_match *,
+                                     struct expr_match *);
 void lflow_cache_delete(struct lflow_cache *, const struct uuid *lflow_uuid);
+void lflow_cache_delete_matches(struct lflow_cache *,
+                                const struct uuid *lflow_uuid);
+void lflow_cache_flush_actions(struct lflow_cache *);
 
 void lflow_cache_get_memory_usage(const struct lflow_cache *,
                                   struct simap *usage);
@@ -26,10 +26,20 @@ COVERAGE_DEFINE(lflow_conj_alloc_specified);
 COVERAGE_DEFINE(lflow_conj_free);
 COVERAGE_DEFINE(lflow_conj_free_unexpected);
 
-/* Node in struct conj_ids.conj_id_allocations. */
-struct conj_id_node {
-    struct hmap_node hmap_node;
-    uint32_t conj_id;
+/* Conjunction ids are tracked in blocks of CONJ_ID_BLOCK_SIZE consecutive
+ * ids, so that checking or updating a range of ids costs one lookup per block
+ * instead of one per id, and a probe that hits a conflict skips right past
+ * the conflicting id. */
+#define CONJ_ID_BLOCK_SIZE 64
+
+/* Node in struct conj_ids.conj_id_allocations.  Blocks without any allocated
+ * id are freed. */
+struct conj_id_block {
+    struct hmap_node hmap_node; /* Hashed by 'base'. */
+    uint32_t base;              /* First id, a multiple of
+                                 * CONJ_ID_BLOCK_SIZE. */
+    uint64_t map;               /* Bit 'i' is set if id 'base + i' is
+                                 * allocated. */
 };
 
 struct lflow_conj_node {
@@ -64,6 +74,12 @@ static void lflow_conj_ids_free_for_lflow_dp(struct conj_ids *,
                                              const struct uuid *dp_uuid);
 static struct lflow_to_dps_node *lflow_to_dps_find(struct conj_ids *,
                                                    const struct uuid *);
+static bool conj_ids_find_used(const struct conj_ids *, uint32_t start_conj_id,
+                               uint32_t n_conjs, uint32_t *used_conj_id);
+static uint32_t conj_ids_find_free(const struct conj_ids *,
+                                   uint32_t conj_id);
+static void conj_ids_set(struct conj_ids *, uint32_t start_conj_id,
+                         uint32_t n_conjs, bool allocated);
 static inline uint32_t
 hash_lflow_dp(const struct uuid *lflow_uuid, const struct uuid *dp_uuid)
 {
@@ -89,11 +105,12 @@ lflow_conj_ids_set_test_mode(bool mode)
  *
  * The algorithm tries to allocate the hash result of the combination of the
  * lflow_uuid and dp_uuid as the first conjunction id. If it is unavailable, or
- * any of the subsequent n_conjs - 1 ids are unavailable, iterate until the
- * next available n_conjs ids are found.  Given that n_conjs is very small (in
- * most cases will be 1), the algorithm should be efficient enough and in most
- * cases just return the hash value, which ensures conjunction ids are
- * consistent for the same logical flow + DP in most cases.
+ * any of the subsequent n_conjs - 1 ids are unavailable, the next candidate
+ * range starts right after the first unavailable id, until n_conjs available
+ * ids are found.  Given that n_conjs is very small (in most cases will be 1),
+ * the algorithm should be efficient enough and in most cases just return the
+ * hash value, which ensures conjunction ids are consistent for the same
+ * logical flow + DP in most cases.
  *
  * The performance will degrade if most of the uint32_t are allocated because
  * conflicts will happen a lot. In practice this is not expected to happen in
@@ -111,52 +128,48 @@ lflow_conj_ids_alloc(struct conj_ids *conj_ids, const struct uuid *lflow_uuid,
     lflow_conj_ids_free_for_lflow_dp(conj_ids, lflow_uuid, dp_uuid);
 
     COVERAGE_INC(lflow_conj_alloc);
+    conj_ids->n_allocs++;
 
     uint32_t start_conj_id = hash_lflow_dp(lflow_uuid, dp_uuid);
     if (start_conj_id == 0) {
         start_conj_id++;
     }
-    uint32_t initial_id = start_conj_id;
-    bool initial = true;
+
+    /* Number of candidate start ids skipped so far, to give up once all of
+     * them were checked (extreme situation, not expected in real
+     * environment). */
+    uint64_t n_skipped = 0;
     while (true) {
-        if (start_conj_id == 0) {
-            start_conj_id++;
-        }
-        bool available = true;
-        uint32_t conj_id = start_conj_id;
-        for (uint32_t i = 0; i < n_conjs; i++) {
-            if (conj_id == 0) {
-                /* Overflow. Consider the current range as unavailable because
-                 * we need a continuous range. Start over from 1 (0 is
-                 * skipped). */
-                available = false;
-                break;
-            }
-            if (!initial && conj_id == initial_id) {
-                /* It has checked all ids (extreme situation, not expected in
-                 * real environment). */
-                return 0;
-            }
-            initial = false;
-            struct conj_id_node *conj_id_node;
-            /* conj_id is both the key and the hash */
-            HMAP_FOR_EACH_WITH_HASH (conj_id_node, hmap_node, conj_id,
-                                     &conj_ids->conj_id_allocations) {
-                if (conj_id_node->conj_id == conj_id) {
-                    available = false;
-                    COVERAGE_INC(lflow_conj_conflict);
-                    break;
-                }
-            }
-            if (!available) {
-                break;
+        conj_ids->n_probes++;
+        uint32_t used_conj_id;
+        if ((uint64_t) start_conj_id + n_conjs - 1 > UINT32_MAX) {
+            /* Overflow. Consider the current range as unavailable because
+             * we need a continuous range. Start over from 1 (0 is
+             * skipped). */
+            n_skipped += (uint64_t) UINT32_MAX - start_conj_id + 1;
+            start_conj_id = 1;
+        } else if (conj_ids_find_used(conj_ids, start_conj_id, n_conjs,
+                                      &used_conj_id)) {
+            /* No range starting before the end of the run of allocated ids
+             * that contains 'used_conj_id' is available either. */
+            COVERAGE_INC(lflow_conj_conflict);
+            conj_ids->n_conflicts++;
+            uint32_t next_conj_id = conj_ids_find_free(conj_ids,
+                                                       used_conj_id);
+            if (!next_conj_id) {
+                n_skipped += (uint64_t) UINT32_MAX - start_conj_id + 1;
+                start_conj_id = 1;
+            } else {
+                n_skipped += next_conj_id - start_conj_id;
+                start_conj_id = next_conj_id;
             }
-            conj_id++;
-        }
-        if (available) {
+        } else {
             break;
         }
-        start_conj_id = conj_id + 1;
+
+        if (n_skipped >= UINT32_MAX) {
+            return 0;
+        }
     }
     lflow_conj_ids_insert_(conj_ids, lflow_uuid, dp_uuid, start_conj_id,
                            n_conjs);
@@ -179,19 +192,14 @@ lflow_conj_ids_alloc_specified(struct conj_ids *conj_ids,
     }
     lflow_conj_ids_free_for_lflow_dp(conj_ids, lflow_uuid, dp_uuid);
 
-    uint32_t conj_id = start_conj_id;
-    for (uint32_t i = 0; i < n_conjs; i++) {
-        if (!conj_id) {
-            return false;
-        }
-        struct conj_id_node *conj_id_node;
-        HMAP_FOR_EACH_WITH_HASH (conj_id_node, hmap_node, conj_id,
-                                 &conj_ids->conj_id_allocations) {
-            if (conj_id_node->conj_id == conj_id) {
-                return false;
-            }
-        }
-        conj_id++;
+    if (!start_conj_id
+        || (uint64_t) start_conj_id + n_conjs - 1 > UINT32_MAX) {
+        return false;
+    }
+
+    uint32_t used_conj_id;
+    if (conj_ids_find_used(conj_ids, start_conj_id, n_conjs, &used_conj_id)) {
+        return false;
     }
     lflow_conj_ids_insert_(conj_ids, lflow_uuid, dp_uuid, start_conj_id,
                            n_conjs);
@@ -212,6 +220,27 @@ lflow_conj_ids_find(struct conj_ids *conj_ids, const struct uuid *lflow_uuid,
     return lflow_conj ? lflow_conj->start_conj_id : 0;
 }
 
+/* Returns true if 'conj_id' is one of the conjunction IDs used by
+ * 'lflow_uuid', on any of its DPs. */
+bool
+lflow_conj_ids_contains(struct conj_ids *conj_ids,
+                        const struct uuid *lflow_uuid, uint32_t conj_id)
+{
+    struct lflow_to_dps_node *ltd = lflow_to_dps_find(conj_ids, lflow_uuid);
+    if (!ltd) {
+        return false;
+    }
+
+    struct lflow_conj_node *lflow_conj;
+    LIST_FOR_EACH (lflow_conj, list_node, &ltd->dps) {
+        if (conj_id >= lflow_conj->start_conj_id
+            && conj_id - lflow_conj->start_conj_id < lflow_conj->n_conjs) {
+            return true;
+        }
+    }
+    return false;
+}
+
 /* Frees the conjunction IDs used by lflow_uuid. */
 void
 lflow_conj_ids_free(struct conj_ids *conj_ids, const struct uuid *lflow_uuid)
@@ -234,15 +263,17 @@ lflow_conj_ids_init(struct conj_ids *conj_ids)
     hmap_init(&conj_ids->conj_id_allocations);
     hmap_init(&conj_ids->lflow_conj_ids);
     hmap_init(&conj_ids->lflow_to_dps);
+    conj_ids->n_allocs = 0;
+    conj_ids->n_conflicts = 0;
+    conj_ids->n_probes = 0;
 }
 
 void
 lflow_conj_ids_destroy(struct conj_ids *conj_ids) {
-    struct conj_id_node *conj_id_node;
-    HMAP_FOR_EACH_SAFE (conj_id_node, hmap_node,
-                        &conj_ids->conj_id_allocations) {
-        hmap_remove(&conj_ids->conj_id_allocations, &conj_id_node->hmap_node);
-        free(conj_id_node);
+    struct conj_id_block *block;
+    HMAP_FOR_EACH_SAFE (block, hmap_node, &conj_ids->conj_id_allocations) {
+        hmap_remove(&conj_ids->conj_id_allocations, &block->hmap_node);
+        free(block);
     }
     hmap_destroy(&conj_ids->conj_id_allocations);
 
@@ -290,11 +321,24 @@ lflow_conj_ids_dump(struct conj_ids *conj_ids, struct ds *out_data)
     ds_put_cstr(out_data, "---\n");
     ds_put_format(out_data, "Total %"PRIuSIZE" IDs used.\n", count);
 
-    size_t allocated = hmap_count(&conj_ids->conj_id_allocations);
+    size_t allocated = 0;
+    struct conj_id_block *block;
+    HMAP_FOR_EACH (block, hmap_node, &conj_ids->conj_id_allocations) {
+        allocated += count_1bits(block->map);
+    }
     if (count != allocated) {
         ds_put_format(out_data, "WARNING: mismatch - %"PRIuSIZE" allocated\n",
                       allocated);
     }
+
+    size_t n_blocks = hmap_count(&conj_ids->conj_id_allocations);
+    ds_put_format(out_data, "Blocks: %"PRIuSIZE" of %d IDs, utilization: "
+                  "%"PRIuSIZE"%%\n", n_blocks, CONJ_ID_BLOCK_SIZE,
+                  n_blocks ? allocated * 100 / (n_blocks * CONJ_ID_BLOCK_SIZE)
+                           : 0);
+    ds_put_format(out_data, "Allocations: %"PRIu64", probes: %"PRIu64
+                  ", conflicts: %"PRIu64"\n", conj_ids->n_allocs,
+                  conj_ids->n_probes, conj_ids->n_conflicts);
 }
 
 static struct lflow_to_dps_node *
@@ -319,14 +363,8 @@ lflow_conj_ids_insert_(struct conj_ids *conj_ids,
                        uint32_t start_conj_id, uint32_t n_conjs)
 {
     ovs_assert(n_conjs);
-    uint32_t conj_id = start_conj_id;
-    for (uint32_t i = 0; i < n_conjs; i++) {
-        ovs_assert(conj_id);
-        struct conj_id_node *node = xzalloc(sizeof *node);
-        node->conj_id = conj_id;
-        hmap_insert(&conj_ids->conj_id_allocations, &node->hmap_node, conj_id);
-        conj_id++;
-    }
+    ovs_assert(start_conj_id);
+    conj_ids_set(conj_ids, start_conj_id, n_conjs, true);
 
     struct lflow_conj_node *lflow_conj = xzalloc(sizeof *lflow_conj);
     lflow_conj->lflow_uuid = *lflow_uuid;
@@ -370,21 +408,8 @@ lflow_conj_ids_free_(struct conj_ids *conj_ids,
 {
     ovs_assert(lflow_conj->n_conjs);
     COVERAGE_INC(lflow_conj_free);
-    uint32_t conj_id = lflow_conj->start_conj_id;
-    for (uint32_t i = 0; i < lflow_conj->n_conjs; i++) {
-        ovs_assert(conj_id);
-        struct conj_id_node *conj_id_node;
-        HMAP_FOR_EACH_WITH_HASH (conj_id_node, hmap_node, conj_id,
-                                 &conj_ids->conj_id_allocations) {
-            if (conj_id_node->conj_id == conj_id) {
-                hmap_remove(&conj_ids->conj_id_allocations,
-                            &conj_id_node->hmap_node);
-                free(conj_id_node);
-                break;
-            }
-        }
-        conj_id++;
-    }
+    conj_ids_set(conj_ids, lflow_conj->start_conj_id, lflow_conj->n_conjs,
+                 false);
 
     hmap_remove(&conj_ids->lflow_conj_ids, &lflow_conj->hmap_node);
     ovs_list_remove(&lflow_conj->list_node);
@@ -409,3 +434,125 @@ lflow_conj_ids_free_for_lflow_dp(struct conj_ids *conj_ids,
     COVERAGE_INC(lflow_conj_free_unexpected);
     lflow_conj_ids_free_(conj_ids, lflow_conj);
 }
+
+static struct conj_id_block *
+conj_id_block_find(const struct conj_ids *conj_ids, uint32_t base)
+{
+    struct conj_id_block *block;
+    HMAP_FOR_EACH_WITH_HASH (block, hmap_node, hash_int(base, 0),
+                             &conj_ids->conj_id_allocations) {
+        if (block->base == base) {
+            return block;
+        }
+    }
+    return NULL;
+}
+
+/* Returns the bits of the block starting at 'base' that correspond to the ids
+ * in [start_conj_id, end_conj_id], which must overlap the block. */
+static uint64_t
+conj_id_block_mask(uint32_t base, uint32_t start_conj_id,
+                   uint32_t end_conj_id)
+{
+    unsigned int first = MAX(start_conj_id, base) - base;
+    unsigned int last = MIN(end_conj_id, base + CONJ_ID_BLOCK_SIZE - 1) - base;
+
+    uint64_t mask = UINT64_MAX << first;
+    if (last < CONJ_ID_BLOCK_SIZE - 1) {
+        mask &= (UINT64_C(1) << (last + 1)) - 1;
+    }
+    return mask;
+}
+
+/* Returns true if any of the 'n_conjs' ids starting at 'start_conj_id' is
+ * allocated, and stores the first of them in '*used_conj_id'.  The range must
+ * not wrap around. */
+static bool
+conj_ids_find_used(const struct conj_ids *conj_ids, uint32_t start_conj_id,
+                   uint32_t n_conjs, uint32_t *used_conj_id)
+{
+    uint32_t end_conj_id = start_conj_id + n_conjs - 1;
+    uint32_t base = start_conj_id - start_conj_id % CONJ_ID_BLOCK_SIZE;
+
+    for (;;) {
+        const struct conj_id_block *block = conj_id_block_find(conj_ids,
+                                                               base);
+        if (block) {
+            uint64_t used = block->map & conj_id_block_mask(base,
+                                                            start_conj_id,
+                                                            end_conj_id);
+            if (used) {
+                *used_conj_id = base + raw_ctz(used);
+                return true;
+            }
+        }
+        if (end_conj_id - base < CONJ_ID_BLOCK_SIZE) {
+            return false;
+        }
+        base += CONJ_ID_BLOCK_SIZE;
+    }
+}
+
+/* Returns the first id from 'conj_id' on that is not allocated, or 0 if all
+ * of them up to UINT32_MAX are. */
+static uint32_t
+conj_ids_find_free(const struct conj_ids *conj_ids, uint32_t conj_id)
+{
+    uint32_t base = conj_id - conj_id % CONJ_ID_BLOCK_SIZE;
+
+    for (;;) {
+        const struct conj_id_block *block = conj_id_block_find(conj_ids,
+                                                               base);
+        if (!block) {
+            return MAX(conj_id, base);
+        }
+
+        uint64_t free_ids = ~block->map & conj_id_block_mask(base, conj_id,
+                                                             UINT32_MAX);
+        if (free_ids) {
+            return base + raw_ctz(free_ids);
+        }
+        if (UINT32_MAX - base < CONJ_ID_BLOCK_SIZE) {
+            return 0;
+        }
+        base += CONJ_ID_BLOCK_SIZE;
+    }
+}
+
+/* Marks the 'n_conjs' ids starting at 'start_conj_id' as 'allocated' or
+ * free.  The range must not wrap around. */
+static void
+conj_ids_set(struct conj_ids *conj_ids, uint32_t start_conj_id,
+             uint32_t n_conjs, bool allocated)
+{
+    uint32_t end_conj_id = start_conj_id + n_conjs - 1;
+    uint32_t base = start_conj_id - start_conj_id % CONJ_ID_BLOCK_SIZE;
+
+    for (;;) {
+        uint64_t mask = conj_id_block_mask(base, start_conj_id, end_conj_id);
+        struct conj_id_block *block = conj_id_block_find(conj_ids, base);
+
+        if (allocated) {
+            if (!block) {
+                block = xzalloc(sizeof *block);
+                block->base = base;
+                hmap_insert(&conj_ids->conj_id_allocations, &block->hmap_node,
+                            hash_int(base, 0));
+            }
+            ovs_assert(!(block->map & mask));
+            block->map |= mask;
+        } else if (block) {
+            block->map &= ~mask;
+            if (!block->map) {
+                hmap_remove(&conj_ids->conj_id_allocations,
+                            &block->hmap_node);
+                free(block);
+            }
+        }
+
+        if (end_conj_id - base < CONJ_ID_BLOCK_SIZE) {
+            break;
+        }
+        base += CONJ_ID_BLOCK_SIZE;
+    }
+}
@@ -22,7 +22,8 @@
 #include "uuid.h"
 
 struct conj_ids {
-    /* Allocated conjunction ids. Contains struct conj_id_node. */
+    /* Allocated conjunction ids, by block of consecutive ids. Contains struct
+     * conj_id_block. */
     struct hmap conj_id_allocations;
     /* A map from lflow + DP to the conjunction ids used. Contains struct
      * lflow_conj_node. */
@@ -30,6 +31,11 @@ struct conj_ids {
     /* A map from lflow to the list of DPs this lflow belongs to. Contains
      * struct lflow_to_dps_node. */
     struct hmap lflow_to_dps;
+
+    /* Statistics reported by lflow_conj_ids_dump(). */
+    uint64_t n_allocs;     /* Calls to lflow_conj_ids_alloc(). */
+    uint64_t n_probes;     /* Candidate ranges checked by them. */
+    uint64_t n_conflicts;  /* Candidate ranges that were not available. */
 };
 
 uint32_t lflow_conj_ids_alloc(struct conj_ids *, const struct uuid *lflow_uuid,
@@ -41,6 +47,8 @@ bool lflow_conj_ids_alloc_specified(struct conj_ids *,
 void lflow_conj_ids_free(struct conj_ids *, const struct uuid *lflow_uuid);
 uint32_t lflow_conj_ids_find(struct conj_ids *, const struct uuid *lflow_uuid,
                              const struct uuid *dp_uuid);
+bool lflow_conj_ids_contains(struct conj_ids *,
+                             const struct uuid *lflow_uuid, uint32_t conj_id);
 void lflow_conj_ids_init(struct conj_ids *);
 void lflow_conj_ids_destroy(struct conj_ids *);
 void lflow_conj_ids_clear(struct conj_ids *);
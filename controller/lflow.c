@@ -17,7 +17,6 @@
 #include "binding.h"
 #include "lflow.h"
 #include "coverage.h"
-#include "ha-chassis.h"
 #include "lib/id-pool.h"
 #include "lflow-cache.h"
 #include "local_data.h"
@@ -33,11 +32,16 @@
 #include "lib/lb.h"
 #include "lib/ovn-l7.h"
 #include "lib/ovn-sb-idl.h"
+#include "lib/ovn-util.h"
+#include "lib/ovn-usdt-probes.h"
 #include "lib/extend-table.h"
+#include "lib/ovn-parallel-hmap.h"
+#include "hash.h"
 #include "packets.h"
 #include "physical.h"
 #include "simap.h"
 #include "sset.h"
+#include "timeval.h"
 
 VLOG_DEFINE_THIS_MODULE(lflow);
 
@@ -49,6 +53,16 @@ COVERAGE_DEFINE(consider_logical_flow);
 /* Contains "struct expr_symbol"s for fields supported by OVN lflows. */
 static struct shash symtab;
 
+/* Worker threads used by lflow_run(), NULL if lflow_set_n_threads() didn't
+ * ask for more than one thread. */
+#define LFLOW_MAX_N_THREADS 256
+static struct worker_pool *lflow_compile_pool = NULL;
+
+/* Maximum time, in msec, that lflow_run() spends on the logical flows before
+ * returning to let the main loop do other work, 0 for no limit.  See
+ * lflow_set_run_slice(). */
+static unsigned int lflow_run_slice_msec = 0;
+
 void
 lflow_init(void)
 {
@@ -65,10 +79,9 @@ struct lookup_port_aux {
 };
 
 struct condition_aux {
-    struct ovsdb_idl_index *sbrec_port_binding_by_name;
     const struct sbrec_datapath_binding *dp;
-    const struct sbrec_chassis *chassis;
-    const struct sset *active_tunnels;
+    /* Names of the lports resident on this chassis. */
+    const struct sset *resident_lports;
     const struct sbrec_logical_flow *lflow;
     /* Resource reference to store the port name referenced
      * in is_chassis_resident() to the logical flow. */
@@ -84,7 +97,9 @@ convert_match_to_expr(const struct sbrec_logical_flow *,
 static void
 add_matches_to_flow_table(const struct sbrec_logical_flow *,
                           const struct local_datapath *,
-                          struct hmap *matches, uint8_t ptable,
+                          struct hmap *matches,
+                          const struct lflow_cache_packed_matches *,
+                          uint8_t ptable,
                           uint8_t output_ptable, struct ofpbuf *ovnacts,
                           bool ingress, struct lflow_ctx_in *,
                           struct lflow_ctx_out *);
@@ -114,12 +129,29 @@ static struct lflow_ref_node *lflow_ref_lookup(struct hmap *lflow_ref_table,
 static void ref_lflow_node_destroy(struct ref_lflow_node *);
 static void lflow_resource_destroy_lflow(struct lflow_resource_ref *,
                                          const struct uuid *lflow_uuid);
+static void lflow_resource_merge(struct lflow_resource_ref *dst,
+                                 const struct lflow_resource_ref *src);
+static void consider_logical_flows_parallel(
+    struct hmap *dhcp_opts, struct hmap *dhcpv6_opts,
+    struct hmap *nd_ra_opts,
+    struct controller_event_options *controller_event_opts,
+    struct lflow_ctx_in *, struct lflow_ctx_out *);
 
 static void add_port_sec_flows(const struct shash *binding_lports,
                                const struct sbrec_chassis *,
-                               struct ovn_desired_flow_table *);
+                               struct ovn_desired_flow_table *,
+                               struct conj_ids *);
 static void consider_port_sec_flows(const struct sbrec_port_binding *pb,
-                                    struct ovn_desired_flow_table *);
+                                    struct ovn_desired_flow_table *,
+                                    struct conj_ids *);
+static void add_lazy_datapath_flow(const struct sbrec_datapath_binding *,
+                                   struct ovn_desired_flow_table *);
+static void consider_port_template_lflow(
+    const struct sbrec_logical_flow *, const struct sbrec_datapath_binding *,
+    struct hmap *dhcp_opts, struct hmap *dhcpv6_opts,
+    struct hmap *nd_ra_opts,
+    struct controller_event_options *controller_event_opts,
+    struct lflow_ctx_in *, struct lflow_ctx_out *);
 
 static bool
 lookup_port_cb(const void *aux_, const char *port_name, unsigned int *portp)
@@ -195,30 +227,13 @@ is_chassis_resident_cb(const void *c_aux_, const char *port_name)
     lflow_resource_add(c_aux->lfrr, REF_TYPE_PORTBINDING, port_name,
                        &c_aux->lflow->header_.uuid, 0);
 
-    const struct sbrec_port_binding *pb
-        = lport_lookup_by_name(c_aux->sbrec_port_binding_by_name, port_name);
-    if (!pb) {
-        return false;
-    }
-
-    if (strcmp(pb->type, "chassisredirect")) {
-        /* for non-chassisredirect ports */
-        return pb->chassis && pb->chassis == c_aux->chassis;
-    } else {
-        if (ha_chassis_group_contains(pb->ha_chassis_group,
-                                      c_aux->chassis)) {
-            bool active = ha_chassis_group_is_active(pb->ha_chassis_group,
-                                                     c_aux->active_tunnels,
-                                                     c_aux->chassis);
-            return active;
-        }
-        return false;
-    }
+    return sset_contains(c_aux->resident_lports, port_name);
 }
 
 void
 lflow_resource_init(struct lflow_resource_ref *lfrr)
 {
+    memset(lfrr, 0, sizeof *lfrr);
     hmap_init(&lfrr->ref_lflow_table);
     hmap_init(&lfrr->lflow_ref_table);
 }
@@ -227,24 +242,20 @@ void
 lflow_resource_destroy(struct lflow_resource_ref *lfrr)
 {
     struct ref_lflow_node *rlfn;
-    HMAP_FOR_EACH_SAFE (rlfn, node, &lfrr->ref_lflow_table) {
-        struct lflow_ref_list_node *lrln;
-        HMAP_FOR_EACH_SAFE (lrln, hmap_node, &rlfn->lflow_uuids) {
-            ovs_list_remove(&lrln->list_node);
-            hmap_remove(&rlfn->lflow_uuids, &lrln->hmap_node);
-            free(lrln);
-        }
-        hmap_remove(&lfrr->ref_lflow_table, &rlfn->node);
+    HMAP_FOR_EACH_POP (rlfn, node, &lfrr->ref_lflow_table) {
         ref_lflow_node_destroy(rlfn);
     }
     hmap_destroy(&lfrr->ref_lflow_table);
 
     struct lflow_ref_node *lfrn;
-    HMAP_FOR_EACH_SAFE (lfrn, node, &lfrr->lflow_ref_table) {
-        hmap_remove(&lfrr->lflow_ref_table, &lfrn->node);
+    HMAP_FOR_EACH_POP (lfrn, node, &lfrr->lflow_ref_table) {
+        free(lfrn->refs);
         free(lfrn);
     }
     hmap_destroy(&lfrr->lflow_ref_table);
+
+    free(lfrr->resources);
+    free(lfrr->free_ids);
 }
 
 void
@@ -284,6 +295,52 @@ lflow_ref_lookup(struct hmap *lflow_ref_table,
     return NULL;
 }
 
+/* Creates the resource 'type' 'ref_name' in 'lfrr' and assigns it an id,
+ * reusing the id of a resource no longer referenced if possible. */
+static struct ref_lflow_node *
+ref_lflow_node_create(struct lflow_resource_ref *lfrr, enum ref_type type,
+                      const char *ref_name)
+{
+    struct ref_lflow_node *rlfn = xzalloc(sizeof *rlfn);
+    rlfn->type = type;
+    rlfn->ref_name = xstrdup(ref_name);
+
+    if (lfrr->n_free_ids) {
+        rlfn->id = lfrr->free_ids[--lfrr->n_free_ids];
+    } else {
+        if (lfrr->n_resources == lfrr->allocated_resources) {
+            lfrr->resources = x2nrealloc(lfrr->resources,
+                                         &lfrr->allocated_resources,
+                                         sizeof *lfrr->resources);
+        }
+        rlfn->id = lfrr->n_resources++;
+    }
+    lfrr->resources[rlfn->id] = rlfn;
+
+    hmap_insert(&lfrr->ref_lflow_table, &rlfn->node,
+                hash_string(ref_name, type));
+    return rlfn;
+}
+
+/* Removes 'rlfn', which must not be referenced by any lflow, from 'lfrr'
+ * and frees it. */
+static void
+ref_lflow_node_remove(struct lflow_resource_ref *lfrr,
+                      struct ref_lflow_node *rlfn)
+{
+    ovs_assert(!rlfn->n_lflows);
+
+    lfrr->resources[rlfn->id] = NULL;
+    if (lfrr->n_free_ids == lfrr->allocated_free_ids) {
+        lfrr->free_ids = x2nrealloc(lfrr->free_ids, &lfrr->allocated_free_ids,
+                                    sizeof *lfrr->free_ids);
+    }
+    lfrr->free_ids[lfrr->n_free_ids++] = rlfn->id;
+
+    hmap_remove(&lfrr->ref_lflow_table, &rlfn->node);
+    ref_lflow_node_destroy(rlfn);
+}
+
 static void
 lflow_resource_add(struct lflow_resource_ref *lfrr, enum ref_type type,
                    const char *ref_name, const struct uuid *lflow_uuid,
@@ -294,46 +351,78 @@ lflow_resource_add(struct lflow_resource_ref *lfrr, enum ref_type type,
     struct lflow_ref_node *lfrn = lflow_ref_lookup(&lfrr->lflow_ref_table,
                                                    lflow_uuid);
     if (rlfn && lfrn) {
-        /* Check if the mapping already existed before adding a new one. */
-        struct lflow_ref_list_node *n;
-        HMAP_FOR_EACH_WITH_HASH (n, hmap_node, uuid_hash(lflow_uuid),
-                                 &rlfn->lflow_uuids) {
-            if (uuid_equals(&n->lflow_uuid, lflow_uuid)) {
-                return;
+        /* Check if the mapping already existed before adding a new one,
+         * scanning the shorter of the two adjacency arrays. */
+        if (lfrn->n_refs <= rlfn->n_lflows) {
+            for (size_t i = 0; i < lfrn->n_refs; i++) {
+                if (lfrn->refs[i].res_id == rlfn->id) {
+                    return;
+                }
+            }
+        } else {
+            for (size_t i = 0; i < rlfn->n_lflows; i++) {
+                if (rlfn->lflows[i].lfrn == lfrn) {
+                    return;
+                }
             }
         }
     }
 
     if (!rlfn) {
-        rlfn = xzalloc(sizeof *rlfn);
-        rlfn->node.hash = hash_string(ref_name, type);
-        rlfn->type = type;
-        rlfn->ref_name = xstrdup(ref_name);
-        hmap_init(&rlfn->lflow_uuids);
-        hmap_insert(&lfrr->ref_lflow_table, &rlfn->node, rlfn->node.hash);
+        rlfn = ref_lflow_node_create(lfrr, type, ref_name);
     }
 
     if (!lfrn) {
         lfrn = xzalloc(sizeof *lfrn);
-        lfrn->node.hash = uuid_hash(lflow_uuid);
         lfrn->lflow_uuid = *lflow_uuid;
-        ovs_list_init(&lfrn->lflow_ref_head);
-        hmap_insert(&lfrr->lflow_ref_table, &lfrn->node, lfrn->node.hash);
+        hmap_insert(&lfrr->lflow_ref_table, &lfrn->node,
+                    uuid_hash(lflow_uuid));
     }
 
-    struct lflow_ref_list_node *lrln = xzalloc(sizeof *lrln);
-    lrln->lflow_uuid = *lflow_uuid;
-    lrln->ref_count = ref_count;
-    lrln->rlfn = rlfn;
-    hmap_insert(&rlfn->lflow_uuids, &lrln->hmap_node, uuid_hash(lflow_uuid));
-    ovs_list_push_back(&lfrn->lflow_ref_head, &lrln->list_node);
+    if (rlfn->n_lflows == rlfn->allocated_lflows) {
+        rlfn->lflows = x2nrealloc(rlfn->lflows, &rlfn->allocated_lflows,
+                                  sizeof *rlfn->lflows);
+    }
+    if (lfrn->n_refs == lfrn->allocated_refs) {
+        lfrn->refs = x2nrealloc(lfrn->refs, &lfrn->allocated_refs,
+                                sizeof *lfrn->refs);
+    }
+    rlfn->lflows[rlfn->n_lflows] = (struct ref_lflow_entry) {
+        .lfrn = lfrn,
+        .idx = lfrn->n_refs,
+        .ref_count = ref_count,
+    };
+    lfrn->refs[lfrn->n_refs] = (struct lflow_ref_entry) {
+        .res_id = rlfn->id,
+        .idx = rlfn->n_lflows,
+    };
+    rlfn->n_lflows++;
+    lfrn->n_refs++;
+}
+
+/* Adds all the references in 'src' to 'dst'. */
+static void
+lflow_resource_merge(struct lflow_resource_ref *dst,
+                     const struct lflow_resource_ref *src)
+{
+    const struct lflow_ref_node *lfrn;
+    HMAP_FOR_EACH (lfrn, node, &src->lflow_ref_table) {
+        for (size_t i = 0; i < lfrn->n_refs; i++) {
+            const struct lflow_ref_entry *ref = &lfrn->refs[i];
+            const struct ref_lflow_node *rlfn = src->resources[ref->res_id];
+
+            lflow_resource_add(dst, rlfn->type, rlfn->ref_name,
+                               &lfrn->lflow_uuid,
+                               rlfn->lflows[ref->idx].ref_count);
+        }
+    }
 }
 
 static void
 ref_lflow_node_destroy(struct ref_lflow_node *rlfn)
 {
     free(rlfn->ref_name);
-    hmap_destroy(&rlfn->lflow_uuids);
+    free(rlfn->lflows);
     free(rlfn);
 }
 
@@ -348,28 +437,39 @@ lflow_resource_destroy_lflow(struct lflow_resource_ref *lfrr,
     }
 
     hmap_remove(&lfrr->lflow_ref_table, &lfrn->node);
-    struct lflow_ref_list_node *lrln;
-    LIST_FOR_EACH_SAFE (lrln, list_node, &lfrn->lflow_ref_head) {
-        ovs_list_remove(&lrln->list_node);
-        hmap_remove(&lrln->rlfn->lflow_uuids, &lrln->hmap_node);
+    for (size_t i = 0; i < lfrn->n_refs; i++) {
+        const struct lflow_ref_entry *ref = &lfrn->refs[i];
+        struct ref_lflow_node *rlfn = lfrr->resources[ref->res_id];
+
+        /* Move the last lflow of the resource into the removed slot. */
+        struct ref_lflow_entry *last = &rlfn->lflows[--rlfn->n_lflows];
+        if (ref->idx != rlfn->n_lflows) {
+            rlfn->lflows[ref->idx] = *last;
+            last->lfrn->refs[last->idx].idx = ref->idx;
+        }
 
         /* Clean up the node in ref_lflow_table if the resource is not
          * referred by any logical flows. */
-        if (hmap_is_empty(&lrln->rlfn->lflow_uuids)) {
-            hmap_remove(&lfrr->ref_lflow_table, &lrln->rlfn->node);
-            ref_lflow_node_destroy(lrln->rlfn);
+        if (!rlfn->n_lflows) {
+            ref_lflow_node_remove(lfrr, rlfn);
         }
-
-        free(lrln);
     }
+    free(lfrn->refs);
     free(lfrn);
 }
 
-/* Adds the logical flows from the Logical_Flow table to flow tables. */
-static void
+/* Adds the logical flows from the Logical_Flow table to flow tables.
+ *
+ * Without worker threads, stops once 'deadline' has passed and records in
+ * 'l_ctx_out->run_progress' the first logical flow left to process.  If
+ * 'l_ctx_out->run_progress' shows that a previous call stopped early,
+ * resumes from there.  Returns true if all the logical flows were
+ * processed. */
+static bool
 add_logical_flows(struct lflow_ctx_in *l_ctx_in,
-                  struct lflow_ctx_out *l_ctx_out)
+                  struct lflow_ctx_out *l_ctx_out, long long int deadline)
 {
+    struct lflow_run_progress *progress = l_ctx_out->run_progress;
     const struct sbrec_logical_flow *lflow;
 
     struct hmap dhcp_opts = HMAP_INITIALIZER(&dhcp_opts);
@@ -395,16 +495,71 @@ add_logical_flows(struct lflow_ctx_in *l_ctx_in,
     struct controller_event_options controller_event_opts;
     controller_event_opts_init(&controller_event_opts);
 
-    SBREC_LOGICAL_FLOW_TABLE_FOR_EACH (lflow, l_ctx_in->logical_flow_table) {
-        consider_logical_flow(lflow, &dhcp_opts, &dhcpv6_opts,
-                              &nd_ra_opts, &controller_event_opts, true,
-                              l_ctx_in, l_ctx_out);
+    if (lflow_compile_pool && !progress->in_progress) {
+        consider_logical_flows_parallel(&dhcp_opts, &dhcpv6_opts, &nd_ra_opts,
+                                        &controller_event_opts,
+                                        l_ctx_in, l_ctx_out);
+    } else {
+        if (progress->in_progress) {
+            /* The engine only resumes lflow_run() if the Logical_Flow table
+             * didn't change in the meantime. */
+            lflow = sbrec_logical_flow_table_get_for_uuid(
+                l_ctx_in->logical_flow_table, &progress->next_lflow);
+            ovs_assert(lflow);
+            progress->in_progress = false;
+        } else {
+            lflow = sbrec_logical_flow_table_first(
+                l_ctx_in->logical_flow_table);
+        }
+
+        while (lflow) {
+            consider_logical_flow(lflow, &dhcp_opts, &dhcpv6_opts,
+                                  &nd_ra_opts, &controller_event_opts, true,
+                                  l_ctx_in, l_ctx_out);
+            lflow = sbrec_logical_flow_next(lflow);
+            if (lflow && time_msec() >= deadline) {
+                progress->in_progress = true;
+                progress->next_lflow = lflow->header_.uuid;
+                break;
+            }
+        }
     }
 
     dhcp_opts_destroy(&dhcp_opts);
     dhcp_opts_destroy(&dhcpv6_opts);
     nd_ra_opts_destroy(&nd_ra_opts);
     controller_event_opts_destroy(&controller_event_opts);
+
+    return !progress->in_progress;
+}
+
+/* Returns the key of 'lflow' in 'lc': its UUID or, if 'lc' is keyed by
+ * content, a hash of the parts of 'lflow' that its cached actions and
+ * matches depend on, stored in '*key'.  The 32-bit ovn_logical_flow_hash()
+ * of the flow seeds two 64-bit hashes, of the match and of the actions, so
+ * that different flows practically never share a key. */
+static const struct uuid *
+lflow_cache_key(const struct lflow_cache *lc,
+                const struct sbrec_logical_flow *lflow, struct uuid *key)
+{
+    if (!lflow_cache_is_by_content(lc)) {
+        return &lflow->header_.uuid;
+    }
+
+    enum ovn_pipeline pipeline = (!strcmp(lflow->pipeline, "ingress")
+                                  ? P_IN : P_OUT);
+    uint32_t basis = ovn_logical_flow_hash(lflow->table_id, pipeline, 0,
+                                           lflow->match, lflow->actions);
+    ovs_u128 match_hash, actions_hash;
+    hash_bytes128(lflow->match, strlen(lflow->match), basis, &match_hash);
+    hash_bytes128(lflow->actions, strlen(lflow->actions), basis,
+                  &actions_hash);
+
+    key->parts[0] = match_hash.u32[0];
+    key->parts[1] = match_hash.u32[1];
+    key->parts[2] = actions_hash.u32[0];
+    key->parts[3] = actions_hash.u32[1];
+    return key;
 }
 
 bool
@@ -457,8 +612,10 @@ lflow_handle_changed_flows(struct lflow_ctx_in *l_ctx_in,
                     uuid_hash(&ofrn->sb_uuid));
         if (!sbrec_logical_flow_is_new(lflow)) {
             if (lflow_cache_is_enabled(l_ctx_out->lflow_cache)) {
+                struct uuid key;
                 lflow_cache_delete(l_ctx_out->lflow_cache,
-                                   &lflow->header_.uuid);
+                                   lflow_cache_key(l_ctx_out->lflow_cache,
+                                                   lflow, &key));
             }
         }
     }
@@ -566,9 +723,9 @@ consider_lflow_for_added_as_ips__(
     bool handled = true;
     struct local_datapath *ldp = get_local_datapath(l_ctx_in->local_datapaths,
                                                     dp->tunnel_key);
-    if (!ldp) {
-        VLOG_DBG("Skip lflow "UUID_FMT" for non-local datapath %"PRId64,
-                 UUID_ARGS(&lflow->header_.uuid), dp->tunnel_key);
+    if (!ldp || ldp->lazy) {
+        VLOG_DBG("Skip lflow "UUID_FMT" for non-local or lazy datapath "
+                 "%"PRId64, UUID_ARGS(&lflow->header_.uuid), dp->tunnel_key);
         return true;
     }
 
@@ -620,10 +777,8 @@ consider_lflow_for_added_as_ips__(
         .lfrr = l_ctx_out->lfrr,
     };
     struct condition_aux cond_aux = {
-        .sbrec_port_binding_by_name = l_ctx_in->sbrec_port_binding_by_name,
         .dp = dp,
-        .chassis = l_ctx_in->chassis,
-        .active_tunnels = l_ctx_in->active_tunnels,
+        .resident_lports = l_ctx_in->resident_lports,
         .lflow = lflow,
         .lfrr = l_ctx_out->lfrr,
     };
@@ -734,8 +889,9 @@ consider_lflow_for_added_as_ips__(
         }
         expr_matches_prepare(&matches, start_conj_id - 1);
     }
-    add_matches_to_flow_table(lflow, ldp, &matches, ptable, output_ptable,
-                              &ovnacts, ingress, l_ctx_in, l_ctx_out);
+    add_matches_to_flow_table(lflow, ldp, &matches, NULL, ptable,
+                              output_ptable, &ovnacts, ingress,
+                              l_ctx_in, l_ctx_out);
 done:
     expr_destroy(prereqs);
     ovnacts_free(ovnacts.data, ovnacts.size);
@@ -808,9 +964,10 @@ as_update_can_be_handled(const char *as_name, struct addr_set_diff *as_diff,
         return false;
     }
 
-    /* If the size of the diff is too big, reprocessing may be more
-     * efficient than incrementally processing the diffs.  */
-    if ((n_added + n_deleted) >= as->n_values) {
+    /* If the number of added addresses is too big, reprocessing may be more
+     * efficient than parsing the lflows for them.  Deleted addresses don't
+     * need any parsing, they are always handled incrementally. */
+    if (n_added >= as->n_values) {
         return false;
     }
 
@@ -829,9 +986,9 @@ as_update_can_be_handled(const char *as_name, struct addr_set_diff *as_diff,
  *   doesn't impact performance because the size of the address set is already
  *   very small.
  *
- * - The size of the change is equal or bigger than the new size. In this case
- *   it doesn't make sense to incrementally processing the changes because
- *   reprocessing can be faster.
+ * - The number of added addresses is equal or bigger than the new size. In
+ *   this case it doesn't make sense to incrementally processing the changes
+ *   because reprocessing can be faster.
  *
  * - When the address set information couldn't be properly tracked during lflow
  *   parsing. The typical cases are:
@@ -850,19 +1007,17 @@ as_update_can_be_handled(const char *as_name, struct addr_set_diff *as_diff,
  *
  *        All these could have been split into separate lflows.
  *
- *      - Conjunctions overlapping between lflows, which can be caused by
- *        overlapping address sets or same address set used by multiple lflows
- *        that could have been combined. e.g.:
+ *      - The same conjunctive flow is generated more than once by the lflow.
  *
- *          lflow1: ip.src == $as1 && tcp.dst == {p1, p2}
- *          lflow2: ip.src == $as1 && tcp.dst == {p3, p4}
+ * Conjunctions overlapping between lflows, which can be caused by overlapping
+ * address sets or same address set used by multiple lflows, e.g.:
  *
- *        It could have been combined as:
+ *     lflow1: ip.src == $as1 && tcp.dst == {p1, p2}
+ *     lflow2: ip.src == $as1 && tcp.dst == {p3, p4}
  *
- *          ip.src == $as1 && tcp.dst == {p1, p2, p3, p4}
- *
- *        Note: addresses additions still can be processed incrementally in
- *        this case, although deletions cannot.
+ * are handled incrementally, for both additions and deletions: a deleted
+ * address only removes the lflow's own conjunction actions from the shared
+ * flow.
  */
 bool
 lflow_handle_addr_set_update(const char *as_name,
@@ -911,37 +1066,41 @@ lflow_handle_addr_set_update(const char *as_name,
     }
 
     bool ret = true;
-    struct lflow_ref_list_node *lrln;
-    HMAP_FOR_EACH (lrln, hmap_node, &rlfn->lflow_uuids) {
-        if (lflows_processed_find(l_ctx_out->lflows_processed,
-                                  &lrln->lflow_uuid)) {
+    /* 'rlfn->lflows' may be reallocated while processing the lflows, so
+     * access it by index. */
+    for (size_t i = 0; i < rlfn->n_lflows; i++) {
+        const struct uuid *lflow_uuid = &rlfn->lflows[i].lfrn->lflow_uuid;
+        size_t ref_count = rlfn->lflows[i].ref_count;
+
+        if (lflows_processed_find(l_ctx_out->lflows_processed, lflow_uuid)) {
             VLOG_DBG("lflow "UUID_FMT"has been processed, skip.",
-                     UUID_ARGS(&lrln->lflow_uuid));
+                     UUID_ARGS(lflow_uuid));
             continue;
         }
         const struct sbrec_logical_flow *lflow =
             sbrec_logical_flow_table_get_for_uuid(l_ctx_in->logical_flow_table,
-                                                  &lrln->lflow_uuid);
+                                                  lflow_uuid);
         if (!lflow) {
             /* lflow deletion should be handled in the corresponding input
              * handler, so we can skip here. */
             VLOG_DBG("lflow "UUID_FMT" not found while handling updates of "
                      "address set %s, skip.",
-                     UUID_ARGS(&lrln->lflow_uuid), as_name);
+                     UUID_ARGS(lflow_uuid), as_name);
             continue;
         }
         *changed = true;
 
         if (as_diff->deleted) {
             struct addrset_info as_info;
-            for (size_t i = 0; i < as_diff->deleted->n_values; i++) {
-                union expr_constant *c = &as_diff->deleted->values[i];
+            for (size_t j = 0; j < as_diff->deleted->n_values; j++) {
+                union expr_constant *c = &as_diff->deleted->values[j];
                 if (!as_info_from_expr_const(as_name, c, &as_info)) {
                     continue;
                 }
                 if (!ofctrl_remove_flows_for_as_ip(l_ctx_out->flow_table,
-                                                   &lrln->lflow_uuid, &as_info,
-                                                   lrln->ref_count)) {
+                                                   &lflow->header_.uuid,
+                                                   &as_info, ref_count,
+                                                   l_ctx_out->conj_ids)) {
                     ret = false;
                     goto done;
                 }
@@ -949,8 +1108,7 @@ lflow_handle_addr_set_update(const char *as_name,
         }
 
         if (as_diff->added) {
-            if (!consider_lflow_for_added_as_ips(lflow, as_name,
-                                                 lrln->ref_count,
+            if (!consider_lflow_for_added_as_ips(lflow, as_name, ref_count,
                                                  as_diff->added, &dhcp_opts,
                                                  &dhcpv6_opts, &nd_ra_opts,
                                                  &controller_event_opts,
@@ -989,21 +1147,17 @@ lflow_handle_changed_ref(enum ref_type ref_type, const char *ref_name,
     *changed = false;
     bool ret = true;
 
-    struct ovs_list lflows_todo = OVS_LIST_INITIALIZER(&lflows_todo);
-
-    struct lflow_ref_list_node *lrln, *lrln_uuid;
-    HMAP_FOR_EACH (lrln, hmap_node, &rlfn->lflow_uuids) {
-        if (lflows_processed_find(l_ctx_out->lflows_processed,
-                                  &lrln->lflow_uuid)) {
-            continue;
+    /* Copy the lflow uuids, 'rlfn' is modified while reprocessing them. */
+    struct uuid *lflows_todo = xmalloc(rlfn->n_lflows * sizeof *lflows_todo);
+    size_t n_lflows_todo = 0;
+    for (size_t i = 0; i < rlfn->n_lflows; i++) {
+        const struct uuid *lflow_uuid = &rlfn->lflows[i].lfrn->lflow_uuid;
+        if (!lflows_processed_find(l_ctx_out->lflows_processed, lflow_uuid)) {
+            lflows_todo[n_lflows_todo++] = *lflow_uuid;
         }
-        /* Use lflow_ref_list_node as list node to store the uuid.
-         * Other fields are not used here. */
-        lrln_uuid = xmalloc(sizeof *lrln_uuid);
-        lrln_uuid->lflow_uuid = lrln->lflow_uuid;
-        ovs_list_push_back(&lflows_todo, &lrln_uuid->list_node);
     }
-    if (ovs_list_is_empty(&lflows_todo)) {
+    if (!n_lflows_todo) {
+        free(lflows_todo);
         return true;
     }
     *changed = true;
@@ -1033,15 +1187,13 @@ lflow_handle_changed_ref(enum ref_type ref_type, const char *ref_name,
     /* Re-parse the related lflows. */
     /* Firstly, flood remove the flows from desired flow table. */
     struct hmap flood_remove_nodes = HMAP_INITIALIZER(&flood_remove_nodes);
-    LIST_FOR_EACH_SAFE (lrln_uuid, list_node, &lflows_todo) {
+    for (size_t i = 0; i < n_lflows_todo; i++) {
         VLOG_DBG("Reprocess lflow "UUID_FMT" for resource type: %d,"
                  " name: %s.",
-                 UUID_ARGS(&lrln_uuid->lflow_uuid),
-                 ref_type, ref_name);
-        ofctrl_flood_remove_add_node(&flood_remove_nodes,
-                                     &lrln_uuid->lflow_uuid);
-        free(lrln_uuid);
+                 UUID_ARGS(&lflows_todo[i]), ref_type, ref_name);
+        ofctrl_flood_remove_add_node(&flood_remove_nodes, &lflows_todo[i]);
     }
+    free(lflows_todo);
     ofctrl_flood_remove_flows(l_ctx_out->flow_table, &flood_remove_nodes);
 
     /* Secondly, for each lflow that is actually removed, reprocessing it. */
@@ -1127,10 +1279,77 @@ get_common_nat_zone(const struct local_datapath *ldp)
     }
 }
 
+static void
+add_match_to_flow_table(const struct sbrec_logical_flow *lflow,
+                        const struct local_datapath *ldp,
+                        struct expr_match *m, uint8_t ptable,
+                        const struct ofpbuf *ofpacts, uint32_t ctrl_meter_id,
+                        bool ingress, struct lflow_ctx_in *l_ctx_in,
+                        struct lflow_ctx_out *l_ctx_out)
+{
+    match_set_metadata(&m->match, htonll(ldp->datapath->tunnel_key));
+    if (ldp->is_switch) {
+        unsigned int reg_index
+            = (ingress ? MFF_LOG_INPORT : MFF_LOG_OUTPORT) - MFF_REG0;
+        int64_t port_id = m->match.flow.regs[reg_index];
+        if (port_id) {
+            int64_t dp_id = ldp->datapath->tunnel_key;
+            if (!related_lports_contains(l_ctx_in->related_lports,
+                                         dp_id, port_id)) {
+                VLOG_DBG("lflow "UUID_FMT
+                         " port %"PRId64"_%"PRId64" in match is not local, "
+                         "skip", UUID_ARGS(&lflow->header_.uuid),
+                         dp_id, port_id);
+                return;
+            }
+        }
+    }
+
+    struct addrset_info as_info = {
+        .name = m->as_name,
+        .ip = m->as_ip,
+        .mask = m->as_mask
+    };
+    if (!m->n) {
+        ofctrl_add_flow_metered(l_ctx_out->flow_table, ptable,
+                                lflow->priority,
+                                lflow->header_.uuid.parts[0], &m->match,
+                                ofpacts, &lflow->header_.uuid,
+                                ctrl_meter_id,
+                                as_info.name ? &as_info : NULL);
+    } else {
+        if (m->n > 1) {
+            ovs_assert(!as_info.name);
+        }
+        uint64_t conj_stubs[64 / 8];
+        struct ofpbuf conj;
+
+        ofpbuf_use_stub(&conj, conj_stubs, sizeof conj_stubs);
+        for (int i = 0; i < m->n; i++) {
+            const struct cls_conjunction *src = &m->conjunctions[i];
+            struct ofpact_conjunction *dst;
+
+            dst = ofpact_put_CONJUNCTION(&conj);
+            dst->id = src->id;
+            dst->clause = src->clause;
+            dst->n_clauses = src->n_clauses;
+        }
+
+        ofctrl_add_or_append_flow(l_ctx_out->flow_table, ptable,
+                                  lflow->priority, 0,
+                                  &m->match, &conj, &lflow->header_.uuid,
+                                  ctrl_meter_id,
+                                  as_info.name ? &as_info : NULL);
+        ofpbuf_uninit(&conj);
+    }
+}
+
 static void
 add_matches_to_flow_table(const struct sbrec_logical_flow *lflow,
                           const struct local_datapath *ldp,
-                          struct hmap *matches, uint8_t ptable,
+                          struct hmap *matches,
+                          const struct lflow_cache_packed_matches *packed,
+                          uint8_t ptable,
                           uint8_t output_ptable, struct ofpbuf *ovnacts,
                           bool ingress, struct lflow_ctx_in *l_ctx_in,
                           struct lflow_ctx_out *l_ctx_out)
@@ -1182,64 +1401,20 @@ add_matches_to_flow_table(const struct sbrec_logical_flow *lflow,
     };
     ovnacts_encode(ovnacts->data, ovnacts->size, &ep, &ofpacts);
 
-    struct expr_match *m;
-    HMAP_FOR_EACH (m, hmap_node, matches) {
-        match_set_metadata(&m->match, htonll(ldp->datapath->tunnel_key));
-        if (ldp->is_switch) {
-            unsigned int reg_index
-                = (ingress ? MFF_LOG_INPORT : MFF_LOG_OUTPORT) - MFF_REG0;
-            int64_t port_id = m->match.flow.regs[reg_index];
-            if (port_id) {
-                int64_t dp_id = ldp->datapath->tunnel_key;
-                char buf[16];
-                get_unique_lport_key(dp_id, port_id, buf, sizeof(buf));
-                if (!sset_contains(l_ctx_in->related_lport_ids, buf)) {
-                    VLOG_DBG("lflow "UUID_FMT
-                             " port %s in match is not local, skip",
-                             UUID_ARGS(&lflow->header_.uuid),
-                             buf);
-                    continue;
-                }
-            }
+    if (matches) {
+        struct expr_match *m;
+        HMAP_FOR_EACH (m, hmap_node, matches) {
+            add_match_to_flow_table(lflow, ldp, m, ptable, &ofpacts,
+                                    ctrl_meter_id, ingress,
+                                    l_ctx_in, l_ctx_out);
         }
+    }
+    for (size_t i = 0; packed && i < packed->n; i++) {
+        struct expr_match m;
 
-        struct addrset_info as_info = {
-            .name = m->as_name,
-            .ip = m->as_ip,
-            .mask = m->as_mask
-        };
-        if (!m->n) {
-            ofctrl_add_flow_metered(l_ctx_out->flow_table, ptable,
-                                    lflow->priority,
-                                    lflow->header_.uuid.parts[0], &m->match,
-                                    &ofpacts, &lflow->header_.uuid,
-                                    ctrl_meter_id,
-                                    as_info.name ? &as_info : NULL);
-        } else {
-            if (m->n > 1) {
-                ovs_assert(!as_info.name);
-            }
-            uint64_t conj_stubs[64 / 8];
-            struct ofpbuf conj;
-
-            ofpbuf_use_stub(&conj, conj_stubs, sizeof conj_stubs);
-            for (int i = 0; i < m->n; i++) {
-                const struct cls_conjunction *src = &m->conjunctions[i];
-                struct ofpact_conjunction *dst;
-
-                dst = ofpact_put_CONJUNCTION(&conj);
-                dst->id = src->id;
-                dst->clause = src->clause;
-                dst->n_clauses = src->n_clauses;
-            }
-
-            ofctrl_add_or_append_flow(l_ctx_out->flow_table, ptable,
-                                      lflow->priority, 0,
-                                      &m->match, &conj, &lflow->header_.uuid,
-                                      ctrl_meter_id,
-                                      as_info.name ? &as_info : NULL);
-            ofpbuf_uninit(&conj);
-        }
+        lflow_cache_packed_match_expand(&packed->matches[i], &m);
+        add_match_to_flow_table(lflow, ldp, &m, ptable, &ofpacts,
+                                ctrl_meter_id, ingress, l_ctx_in, l_ctx_out);
     }
 
     ofpbuf_uninit(&ofpacts);
@@ -1305,113 +1480,287 @@ convert_match_to_expr(const struct sbrec_logical_flow *lflow,
     return expr_simplify(e);
 }
 
-static void
-consider_logical_flow__(const struct sbrec_logical_flow *lflow,
-                        const struct sbrec_datapath_binding *dp,
-                        struct hmap *dhcp_opts, struct hmap *dhcpv6_opts,
-                        struct hmap *nd_ra_opts,
-                        struct controller_event_options *controller_event_opts,
-                        struct lflow_ctx_in *l_ctx_in,
-                        struct lflow_ctx_out *l_ctx_out)
+/* Parses the actions of 'lflow' into 'ovnacts' and '*prereqs'.  Returns
+ * false, after logging the error, if the actions can't be parsed. */
+static bool
+lflow_parse_actions(const struct sbrec_logical_flow *lflow,
+                    const struct hmap *dhcp_opts,
+                    const struct hmap *dhcpv6_opts,
+                    const struct hmap *nd_ra_opts,
+                    const struct controller_event_options *event_opts,
+                    struct ofpbuf *ovnacts, struct expr **prereqs)
 {
-    struct local_datapath *ldp = get_local_datapath(l_ctx_in->local_datapaths,
-                                                    dp->tunnel_key);
-    if (!ldp) {
-        VLOG_DBG("Skip lflow "UUID_FMT" for non-local datapath %"PRId64,
-                 UUID_ARGS(&lflow->header_.uuid), dp->tunnel_key);
-        return;
-    }
-
-    const char *io_port = smap_get(&lflow->tags, "in_out_port");
-    if (io_port) {
-        lflow_resource_add(l_ctx_out->lfrr, REF_TYPE_PORTBINDING, io_port,
-                           &lflow->header_.uuid, 0);
-        const struct sbrec_port_binding *pb
-            = lport_lookup_by_name(l_ctx_in->sbrec_port_binding_by_name,
-                                   io_port);
-        if (!pb) {
-            VLOG_DBG("lflow "UUID_FMT" matches inport/outport %s that's not "
-                     "found, skip", UUID_ARGS(&lflow->header_.uuid), io_port);
-            return;
-        }
-        char buf[16];
-        get_unique_lport_key(dp->tunnel_key, pb->tunnel_key, buf, sizeof buf);
-        if (!sset_contains(l_ctx_in->related_lport_ids, buf)) {
-            VLOG_DBG("lflow "UUID_FMT" matches inport/outport %s that's not "
-                     "local, skip", UUID_ARGS(&lflow->header_.uuid), io_port);
-            return;
-        }
-    }
-
-    /* Determine translation of logical table IDs to physical table IDs. */
     bool ingress = !strcmp(lflow->pipeline, "ingress");
 
-    /* Determine translation of logical table IDs to physical table IDs. */
-    uint8_t first_ptable = (ingress
-                            ? OFTABLE_LOG_INGRESS_PIPELINE
-                            : OFTABLE_LOG_EGRESS_PIPELINE);
-    uint8_t ptable = first_ptable + lflow->table_id;
-    uint8_t output_ptable = (ingress
-                             ? OFTABLE_REMOTE_OUTPUT
-                             : OFTABLE_SAVE_INPORT);
-
-    /* Parse OVN logical actions.
-     *
-     * XXX Deny changes to 'outport' in egress pipeline. */
-    uint64_t ovnacts_stub[1024 / 8];
-    struct ofpbuf ovnacts = OFPBUF_STUB_INITIALIZER(ovnacts_stub);
+    /* XXX Deny changes to 'outport' in egress pipeline. */
     struct ovnact_parse_params pp = {
         .symtab = &symtab,
         .dhcp_opts = dhcp_opts,
         .dhcpv6_opts = dhcpv6_opts,
         .nd_ra_opts = nd_ra_opts,
-        .controller_event_opts = controller_event_opts,
+        .controller_event_opts = event_opts,
 
         .pipeline = ingress ? OVNACT_P_INGRESS : OVNACT_P_EGRESS,
         .n_tables = LOG_PIPELINE_LEN,
         .cur_ltable = lflow->table_id,
     };
-    struct expr *prereqs = NULL;
-    char *error;
 
-    error = ovnacts_parse_string(lflow->actions, &pp, &ovnacts, &prereqs);
+    char *error = ovnacts_parse_string(lflow->actions, &pp, ovnacts, prereqs);
     if (error) {
         static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
         VLOG_WARN_RL(&rl, "error parsing actions \"%s\": %s",
                      lflow->actions, error);
         free(error);
-        ovnacts_free(ovnacts.data, ovnacts.size);
-        ofpbuf_uninit(&ovnacts);
-        return;
+        ovnacts_free(ovnacts->data, ovnacts->size);
+        return false;
+    }
+    return true;
+}
+
+/* Returns true if the inport/outport 'io_port' of 'lflow' on 'dp' is
+ * related to this chassis. */
+static bool
+lflow_io_port_is_local(const struct sbrec_logical_flow *lflow,
+                       const struct sbrec_datapath_binding *dp,
+                       const char *io_port,
+                       const struct lflow_ctx_in *l_ctx_in)
+{
+    const struct sbrec_port_binding *pb
+        = lport_lookup_by_name(l_ctx_in->sbrec_port_binding_by_name, io_port);
+    if (!pb) {
+        VLOG_DBG("lflow "UUID_FMT" matches inport/outport %s that's not "
+                 "found, skip", UUID_ARGS(&lflow->header_.uuid), io_port);
+        return false;
     }
+    if (!related_lports_contains(l_ctx_in->related_lports, dp->tunnel_key,
+                                 pb->tunnel_key)) {
+        VLOG_DBG("lflow "UUID_FMT" matches inport/outport %s that's not "
+                 "local, skip", UUID_ARGS(&lflow->header_.uuid), io_port);
+        return false;
+    }
+    return true;
+}
 
+/* Converts the match of 'lflow' on 'ldp' to OpenFlow matches, starting from
+ * 'cached' if there's a cached expression for it.  Consumes '*prereqs'.
+ *
+ * References to the resources used by the match are only added to 'lfrr' and
+ * the SB database is only read, so that this can run in the worker threads
+ * of add_logical_flows().  '*pg_addr_set_ref' tells whether the expression
+ * refers to address sets or port groups.  If it doesn't and 'cache_enabled',
+ * '*cached_expr' returns a copy of it that the caller may add to the lflow
+ * cache.
+ *
+ * Returns NULL if the match can't be parsed or doesn't result in any
+ * OpenFlow match. */
+static struct hmap *
+lflow_match_to_matches(const struct sbrec_logical_flow *lflow,
+                       const struct local_datapath *ldp,
+                       struct expr **prereqs, const struct expr *cached,
+                       bool cache_enabled, const struct lflow_ctx_in *l_ctx_in,
+                       struct lflow_resource_ref *lfrr,
+                       struct expr **cached_expr, bool *pg_addr_set_ref,
+                       uint32_t *n_conjs)
+{
+    const struct sbrec_datapath_binding *dp = ldp->datapath;
     struct lookup_port_aux aux = {
         .sbrec_multicast_group_by_name_datapath
             = l_ctx_in->sbrec_multicast_group_by_name_datapath,
         .sbrec_port_binding_by_name = l_ctx_in->sbrec_port_binding_by_name,
         .dp = dp,
         .lflow = lflow,
-        .lfrr = l_ctx_out->lfrr,
+        .lfrr = lfrr,
     };
     struct condition_aux cond_aux = {
-        .sbrec_port_binding_by_name = l_ctx_in->sbrec_port_binding_by_name,
         .dp = dp,
-        .chassis = l_ctx_in->chassis,
-        .active_tunnels = l_ctx_in->active_tunnels,
+        .resident_lports = l_ctx_in->resident_lports,
         .lflow = lflow,
-        .lfrr = l_ctx_out->lfrr,
+        .lfrr = lfrr,
     };
 
+    *cached_expr = NULL;
+    *pg_addr_set_ref = false;
+    *n_conjs = 0;
+
+    /* Get match expr, either from cache or from lflow match. */
+    struct expr *expr;
+    if (cached) {
+        expr = expr_clone(cached);
+    } else {
+        expr = convert_match_to_expr(lflow, ldp, prereqs, l_ctx_in->addr_sets,
+                                     l_ctx_in->port_groups, lfrr,
+                                     pg_addr_set_ref);
+        if (!expr) {
+            return NULL;
+        }
+
+        /* If caching is enabled and this is a not cached expr that doesn't
+         * refer to address sets or port groups, save it to potentially cache
+         * it later. */
+        if (cache_enabled && !*pg_addr_set_ref) {
+            *cached_expr = expr_clone(expr);
+        }
+    }
+
+    /* Normalize expression. */
+    expr = expr_evaluate_condition(expr, is_chassis_resident_cb, &cond_aux);
+    expr = expr_normalize(expr);
+
+    struct hmap *matches = xmalloc(sizeof *matches);
+    *n_conjs = expr_to_matches(expr, lookup_port_cb, &aux, matches);
+    expr_destroy(expr);
+    if (hmap_is_empty(matches)) {
+        VLOG_DBG("lflow "UUID_FMT" matches are empty, skip",
+                 UUID_ARGS(&lflow->header_.uuid));
+        expr_matches_destroy(matches);
+        free(matches);
+        expr_destroy(*cached_expr);
+        *cached_expr = NULL;
+        return NULL;
+    }
+    return matches;
+}
+
+/* The part of the processing of a logical flow on one of its datapaths that
+ * add_logical_flows() hands over to a worker thread. */
+struct lflow_compile_job {
+    const struct sbrec_logical_flow *lflow;
+    const struct sbrec_datapath_binding *dp;
+    bool compile_match;         /* Set when the lflow isn't in the cache. */
+
+    /* Results. */
+    bool actions_parsed;        /* False if the lflow must be skipped. */
+    struct ofpbuf ovnacts;
+    struct expr *prereqs;
+    bool match_compiled;        /* True if the fields below are valid. */
+    struct hmap *matches;       /* NULL if the lflow must be skipped. */
+    struct expr *cached_expr;
+    bool pg_addr_set_ref;
+    uint32_t n_conjs;
+    struct lflow_resource_ref refs; /* References found by the match. */
+};
+
+/* The OpenFlow matches of a logical flow that is applied to a datapath group,
+ * computed for the first local datapath of the group and shared by the
+ * others.  The metadata is only filled in by add_matches_to_flow_table().
+ * Only matches that don't depend on the datapath are shared, i.e. the same
+ * ones that the lflow cache would keep as LCACHE_T_MATCHES.  This avoids
+ * converting the match again for each datapath when the lflow cache is
+ * disabled or full. */
+struct lflow_shared_matches {
+    struct hmap *matches;
+    uint32_t conj_id_ofs;
+    uint32_t n_conjs;
+};
+
+#define LFLOW_SHARED_MATCHES_INITIALIZER { .matches = NULL }
+
+static void
+lflow_shared_matches_destroy(struct lflow_shared_matches *shared)
+{
+    expr_matches_destroy(shared->matches);
+    free(shared->matches);
+}
+
+static void
+consider_lflow_job__(const struct sbrec_logical_flow *lflow,
+                     const struct sbrec_datapath_binding *dp,
+                     struct hmap *dhcp_opts, struct hmap *dhcpv6_opts,
+                     struct hmap *nd_ra_opts,
+                     struct controller_event_options *controller_event_opts,
+                     struct lflow_compile_job *job,
+                     struct lflow_shared_matches *shared,
+                     struct lflow_ctx_in *l_ctx_in,
+                     struct lflow_ctx_out *l_ctx_out)
+{
+    struct local_datapath *ldp = get_local_datapath(l_ctx_in->local_datapaths,
+                                                    dp->tunnel_key);
+    if (!ldp || ldp->lazy) {
+        VLOG_DBG("Skip lflow "UUID_FMT" for non-local or lazy datapath "
+                 "%"PRId64, UUID_ARGS(&lflow->header_.uuid), dp->tunnel_key);
+        return;
+    }
+
+    const char *io_port = smap_get(&lflow->tags, "in_out_port");
+    if (io_port) {
+        lflow_resource_add(l_ctx_out->lfrr, REF_TYPE_PORTBINDING, io_port,
+                           &lflow->header_.uuid, 0);
+        if (job ? !job->actions_parsed
+                : !lflow_io_port_is_local(lflow, dp, io_port, l_ctx_in)) {
+            return;
+        }
+    }
+
+    if (sbrec_logical_flow_is_port_template(lflow)) {
+        consider_port_template_lflow(lflow, dp, dhcp_opts, dhcpv6_opts,
+                                     nd_ra_opts, controller_event_opts,
+                                     l_ctx_in, l_ctx_out);
+        return;
+    }
+
+    /* Determine translation of logical table IDs to physical table IDs. */
+    bool ingress = !strcmp(lflow->pipeline, "ingress");
+
+    /* Determine translation of logical table IDs to physical table IDs. */
+    uint8_t first_ptable = (ingress
+                            ? OFTABLE_LOG_INGRESS_PIPELINE
+                            : OFTABLE_LOG_EGRESS_PIPELINE);
+    uint8_t ptable = first_ptable + lflow->table_id;
+    uint8_t output_ptable = (ingress
+                             ? OFTABLE_REMOTE_OUTPUT
+                             : OFTABLE_SAVE_INPORT);
+
+    /* Parse OVN logical actions, unless a worker thread already did or they
+     * are cached. */
+    uint64_t ovnacts_stub[1024 / 8];
+    struct ofpbuf ovnacts_buf = OFPBUF_STUB_INITIALIZER(ovnacts_stub);
+    struct ofpbuf *ovnacts = &ovnacts_buf;
+    struct expr *prereqs = NULL;
+    const struct lflow_cache_actions *cached_actions = NULL;
+    bool cache_actions = false;
+    struct expr *cache_prereqs = NULL;
+    struct uuid cache_key_buf;
+    const struct uuid *cache_key = lflow_cache_key(l_ctx_out->lflow_cache,
+                                                   lflow, &cache_key_buf);
+
+    if (job) {
+        if (!job->actions_parsed) {
+            return;
+        }
+        ovnacts = &job->ovnacts;
+        prereqs = job->prereqs;
+        job->prereqs = NULL;
+    } else if ((cached_actions = lflow_cache_get_actions(
+                    l_ctx_out->lflow_cache, cache_key))) {
+        ovnacts = CONST_CAST(struct ofpbuf *, &cached_actions->ovnacts);
+        if (cached_actions->prereqs) {
+            prereqs = expr_clone(cached_actions->prereqs);
+        }
+    } else if (!lflow_parse_actions(lflow, dhcp_opts, dhcpv6_opts,
+                                    nd_ra_opts, controller_event_opts,
+                                    ovnacts, &prereqs)) {
+        ofpbuf_uninit(ovnacts);
+        return;
+    } else if (lflow_cache_is_enabled(l_ctx_out->lflow_cache)) {
+        /* The match consumes the prerequisites, keep a copy for the
+         * cache. */
+        cache_actions = true;
+        if (prereqs) {
+            cache_prereqs = expr_clone(prereqs);
+        }
+    }
+
     struct lflow_cache_value *lcv =
-        lflow_cache_get(l_ctx_out->lflow_cache, &lflow->header_.uuid);
+        lflow_cache_get(l_ctx_out->lflow_cache, cache_key);
     enum lflow_cache_type lcv_type =
         lcv ? lcv->type : LCACHE_T_NONE;
 
-    struct expr *cached_expr = NULL, *expr = NULL;
+    struct expr *cached_expr = NULL;
     struct hmap *matches = NULL;
+    const struct lflow_cache_packed_matches *packed = NULL;
     size_t matches_size = 0;
-
     bool pg_addr_set_ref = false;
+    bool shared_used = false;
 
     if (lcv_type == LCACHE_T_MATCHES
         && lcv->n_conjs
@@ -1423,59 +1772,47 @@ consider_logical_flow__(const struct sbrec_logical_flow *lflow,
         VLOG_DBG("lflow "UUID_FMT" match cached with conjunctions, but the"
                  " cached ids are not available anymore. Drop the cache.",
                  UUID_ARGS(&lflow->header_.uuid));
-        lflow_cache_delete(l_ctx_out->lflow_cache, &lflow->header_.uuid);
+        lflow_cache_delete_matches(l_ctx_out->lflow_cache, cache_key);
         lcv_type = LCACHE_T_NONE;
     }
 
-    /* Get match expr, either from cache or from lflow match. */
-    switch (lcv_type) {
-    case LCACHE_T_NONE:
-        expr = convert_match_to_expr(lflow, ldp, &prereqs, l_ctx_in->addr_sets,
-                                     l_ctx_in->port_groups, l_ctx_out->lfrr,
-                                     &pg_addr_set_ref);
-        if (!expr) {
-            goto done;
-        }
-        break;
-    case LCACHE_T_EXPR:
-        expr = expr_clone(lcv->expr);
-        break;
-    case LCACHE_T_MATCHES:
-        break;
-    }
-
-    /* If caching is enabled and this is a not cached expr that doesn't refer
-     * to address sets or port groups, save it to potentially cache it later.
-     */
-    if (lcv_type == LCACHE_T_NONE
-            && lflow_cache_is_enabled(l_ctx_out->lflow_cache)
-            && !pg_addr_set_ref) {
-        cached_expr = expr_clone(expr);
-    }
-
-    /* Normalize expression if needed. */
-    switch (lcv_type) {
-    case LCACHE_T_NONE:
-    case LCACHE_T_EXPR:
-        expr = expr_evaluate_condition(expr, is_chassis_resident_cb,
-                                       &cond_aux);
-        expr = expr_normalize(expr);
-        break;
-    case LCACHE_T_MATCHES:
-        break;
-    }
-
-    /* Get matches, either from cache or from expr computed above. */
+    /* Get matches, either from cache or from the lflow match. */
     uint32_t start_conj_id = 0;
     uint32_t n_conjs = 0;
     switch (lcv_type) {
     case LCACHE_T_NONE:
     case LCACHE_T_EXPR:
-        matches = xmalloc(sizeof *matches);
-        n_conjs = expr_to_matches(expr, lookup_port_cb, &aux, matches);
-        if (hmap_is_empty(matches)) {
-            VLOG_DBG("lflow "UUID_FMT" matches are empty, skip",
-                     UUID_ARGS(&lflow->header_.uuid));
+        if (lcv_type == LCACHE_T_NONE && shared && shared->matches
+            && (!shared->n_conjs
+                || lflow_conj_ids_alloc_specified(l_ctx_out->conj_ids,
+                                                  &lflow->header_.uuid,
+                                                  &dp->header_.uuid,
+                                                  shared->conj_id_ofs,
+                                                  shared->n_conjs))) {
+            /* Already converted for another datapath of the group. */
+            matches = shared->matches;
+            shared_used = true;
+            break;
+        }
+        if (job && job->match_compiled && lcv_type == LCACHE_T_NONE) {
+            /* Converted by a worker thread, which only recorded the
+             * resource references on the side. */
+            lflow_resource_merge(l_ctx_out->lfrr, &job->refs);
+            matches = job->matches;
+            cached_expr = job->cached_expr;
+            pg_addr_set_ref = job->pg_addr_set_ref;
+            n_conjs = job->n_conjs;
+            job->matches = NULL;
+            job->cached_expr = NULL;
+        } else {
+            matches = lflow_match_to_matches(
+                lflow, ldp, &prereqs,
+                lcv_type == LCACHE_T_EXPR ? lcv->expr : NULL,
+                lflow_cache_is_enabled(l_ctx_out->lflow_cache),
+                l_ctx_in, l_ctx_out->lfrr, &cached_expr, &pg_addr_set_ref,
+                &n_conjs);
+        }
+        if (!matches) {
             goto done;
         }
         if (n_conjs) {
@@ -1491,34 +1828,58 @@ consider_logical_flow__(const struct sbrec_logical_flow *lflow,
         }
         break;
     case LCACHE_T_MATCHES:
-        matches = lcv->expr_matches;
+        if (lcv->packed) {
+            packed = lcv->packed_matches;
+        } else {
+            matches = lcv->expr_matches;
+        }
         break;
     }
 
-    add_matches_to_flow_table(lflow, ldp, matches, ptable, output_ptable,
-                              &ovnacts, ingress, l_ctx_in, l_ctx_out);
+    add_matches_to_flow_table(lflow, ldp, matches, packed, ptable,
+                              output_ptable, ovnacts, ingress,
+                              l_ctx_in, l_ctx_out);
 
     /* Update cache if needed. */
     switch (lcv_type) {
     case LCACHE_T_NONE:
-        /* Cache new entry if caching is enabled. */
+        if (shared_used) {
+            matches = NULL;
+            break;
+        }
+
+        /* Cache new entry if caching is enabled.  The conjunction ids of
+         * cached matches are allocated to this logical flow only, so if the
+         * cache is keyed by content, which logical flows on other datapaths
+         * may share, matches with conjunctions only cache their expr. */
         if (lflow_cache_is_enabled(l_ctx_out->lflow_cache)) {
             if (cached_expr
                 && !lflow_ref_lookup(&l_ctx_out->lfrr->lflow_ref_table,
-                                     &lflow->header_.uuid)) {
+                                     &lflow->header_.uuid)
+                && !(n_conjs
+                     && lflow_cache_is_by_content(l_ctx_out->lflow_cache))) {
                 lflow_cache_add_matches(l_ctx_out->lflow_cache,
-                                        &lflow->header_.uuid, start_conj_id,
+                                        cache_key, start_conj_id,
                                         n_conjs, matches, matches_size);
                 matches = NULL;
             } else if (cached_expr) {
-                lflow_cache_add_expr(l_ctx_out->lflow_cache,
-                                     &lflow->header_.uuid,
+                lflow_cache_add_expr(l_ctx_out->lflow_cache, cache_key,
                                      cached_expr, expr_size(cached_expr));
                 cached_expr = NULL;
             }
         }
-        break;
+        /* Fall through. */
     case LCACHE_T_EXPR:
+        /* Let the other datapaths of the group reuse the matches, unless
+         * they depend on the datapath. */
+        if (matches && shared && !shared->matches && !pg_addr_set_ref
+            && !lflow_ref_lookup(&l_ctx_out->lfrr->lflow_ref_table,
+                                 &lflow->header_.uuid)) {
+            shared->matches = matches;
+            shared->conj_id_ofs = start_conj_id;
+            shared->n_conjs = n_conjs;
+            matches = NULL;
+        }
         break;
     case LCACHE_T_MATCHES:
         /* Cached matches were used, don't destroy them. */
@@ -1528,14 +1889,280 @@ consider_logical_flow__(const struct sbrec_logical_flow *lflow,
 
 done:
     expr_destroy(prereqs);
-    ovnacts_free(ovnacts.data, ovnacts.size);
-    ofpbuf_uninit(&ovnacts);
-    expr_destroy(expr);
+    if (cache_actions) {
+        /* Done with the actions, the other datapaths of the lflow and the
+         * next times it is processed can reuse them. */
+        size_t actions_size = (ovnacts->size
+                               + (cache_prereqs ? expr_size(cache_prereqs)
+                                                : 0));
+        lflow_cache_add_actions(l_ctx_out->lflow_cache, cache_key,
+                                ovnacts, cache_prereqs, actions_size);
+    } else if (!job && !cached_actions) {
+        ovnacts_free(ovnacts->data, ovnacts->size);
+        ofpbuf_uninit(ovnacts);
+    }
     expr_destroy(cached_expr);
     expr_matches_destroy(matches);
     free(matches);
 }
 
+static void
+consider_logical_flow__(const struct sbrec_logical_flow *lflow,
+                        const struct sbrec_datapath_binding *dp,
+                        struct hmap *dhcp_opts, struct hmap *dhcpv6_opts,
+                        struct hmap *nd_ra_opts,
+                        struct controller_event_options *controller_event_opts,
+                        struct lflow_ctx_in *l_ctx_in,
+                        struct lflow_ctx_out *l_ctx_out)
+{
+    consider_lflow_job__(lflow, dp, dhcp_opts, dhcpv6_opts, nd_ra_opts,
+                         controller_event_opts, NULL, NULL,
+                         l_ctx_in, l_ctx_out);
+}
+
+/* Expands the port template 'lflow' for every Ethernet address of the VIFs
+ * of 'dp'.  The expansions are processed like the logical flows that
+ * ovn-northd would have generated instead, except that they are not cached,
+ * because they all share the UUID of the template.  For the same reason,
+ * their matches must not need conjunctive flows. */
+static void
+consider_port_template_lflow(
+    const struct sbrec_logical_flow *lflow,
+    const struct sbrec_datapath_binding *dp,
+    struct hmap *dhcp_opts, struct hmap *dhcpv6_opts,
+    struct hmap *nd_ra_opts,
+    struct controller_event_options *controller_event_opts,
+    struct lflow_ctx_in *l_ctx_in, struct lflow_ctx_out *l_ctx_out)
+{
+    /* Expand the template again when the ports of 'dp' change. */
+    char dp_key[32];
+    snprintf(dp_key, sizeof dp_key, "%"PRId64, dp->tunnel_key);
+    lflow_resource_add(l_ctx_out->lfrr, REF_TYPE_DP_PORTS, dp_key,
+                       &lflow->header_.uuid, 0);
+
+    struct lflow_ctx_out ctx_out = *l_ctx_out;
+    ctx_out.lflow_cache = NULL;
+
+    struct ovsdb_idl_index *pbs_by_dp =
+        l_ctx_in->sbrec_port_binding_by_datapath;
+    struct sbrec_port_binding *target =
+        sbrec_port_binding_index_init_row(pbs_by_dp);
+    sbrec_port_binding_index_set_datapath(target, dp);
+
+    const struct sbrec_port_binding *pb;
+    SBREC_PORT_BINDING_FOR_EACH_EQUAL (pb, target, pbs_by_dp) {
+        if (pb->type[0]) {
+            continue;
+        }
+        for (size_t i = 0; i < pb->n_mac; i++) {
+            struct eth_addr mac;
+            if (!ovs_scan(pb->mac[i], ETH_ADDR_SCAN_FMT,
+                          ETH_ADDR_SCAN_ARGS(mac))) {
+                continue;
+            }
+
+            struct sbrec_logical_flow expansion = *lflow;
+            expansion.match = ovn_port_template_expand(lflow->match,
+                                                       pb->logical_port,
+                                                       &mac);
+            expansion.actions = ovn_port_template_expand(lflow->actions,
+                                                         pb->logical_port,
+                                                         &mac);
+            smap_init(&expansion.tags);
+            consider_lflow_job__(&expansion, dp, dhcp_opts, dhcpv6_opts,
+                                 nd_ra_opts, controller_event_opts, NULL,
+                                 NULL, l_ctx_in, &ctx_out);
+            free(expansion.match);
+            free(expansion.actions);
+        }
+    }
+    sbrec_port_binding_index_destroy_row(target);
+}
+
+static void
+lflow_compile_job_destroy(struct lflow_compile_job *job)
+{
+    if (job->actions_parsed) {
+        ovnacts_free(job->ovnacts.data, job->ovnacts.size);
+    }
+    ofpbuf_uninit(&job->ovnacts);
+    expr_destroy(job->prereqs);
+    expr_matches_destroy(job->matches);
+    free(job->matches);
+    expr_destroy(job->cached_expr);
+    lflow_resource_destroy(&job->refs);
+}
+
+/* Everything the worker threads of lflow_run() need, shared by all of
+ * them. */
+struct lflow_compile_info {
+    struct lflow_compile_job *jobs;
+    size_t n_jobs;
+
+    const struct hmap *dhcp_opts;
+    const struct hmap *dhcpv6_opts;
+    const struct hmap *nd_ra_opts;
+    const struct controller_event_options *controller_event_opts;
+    const struct lflow_ctx_in *l_ctx_in;
+    bool cache_enabled;
+};
+
+/* Does the part of consider_lflow_job__() that doesn't modify any state
+ * shared between logical flows: checking that the lflow is relevant to this
+ * chassis, parsing its actions and converting its match.  The main thread
+ * is waiting for the workers meanwhile, so the SB IDL, its indexes and the
+ * other inputs are only read. */
+static void
+lflow_compile_job_run(struct lflow_compile_job *job,
+                      const struct lflow_compile_info *info)
+{
+    const struct lflow_ctx_in *l_ctx_in = info->l_ctx_in;
+    const struct sbrec_logical_flow *lflow = job->lflow;
+
+    const struct local_datapath *ldp =
+        get_local_datapath(l_ctx_in->local_datapaths, job->dp->tunnel_key);
+    if (!ldp || ldp->lazy) {
+        return;
+    }
+
+    const char *io_port = smap_get(&lflow->tags, "in_out_port");
+    if (io_port && !lflow_io_port_is_local(lflow, job->dp, io_port,
+                                           l_ctx_in)) {
+        return;
+    }
+
+    /* The main thread expands the port templates. */
+    if (sbrec_logical_flow_is_port_template(lflow)) {
+        return;
+    }
+
+    if (!lflow_parse_actions(lflow, info->dhcp_opts, info->dhcpv6_opts,
+                             info->nd_ra_opts, info->controller_event_opts,
+                             &job->ovnacts, &job->prereqs)) {
+        return;
+    }
+    job->actions_parsed = true;
+
+    if (job->compile_match) {
+        job->matches = lflow_match_to_matches(lflow, ldp, &job->prereqs,
+                                              NULL, info->cache_enabled,
+                                              l_ctx_in, &job->refs,
+                                              &job->cached_expr,
+                                              &job->pg_addr_set_ref,
+                                              &job->n_conjs);
+        job->match_compiled = true;
+    }
+}
+
+static void *
+lflow_compile_thread(void *arg)
+{
+    struct worker_control *control = arg;
+
+    while (!stop_parallel_processing()) {
+        wait_for_work(control);
+        struct lflow_compile_info *info = control->data;
+        if (stop_parallel_processing()) {
+            return NULL;
+        }
+        size_t i;
+        while (info && worker_next_task(control, &i)) {
+            lflow_compile_job_run(&info->jobs[i], info);
+        }
+        post_completed_work(control);
+    }
+    return NULL;
+}
+
+static size_t
+lflow_n_datapaths(const struct sbrec_logical_flow *lflow)
+{
+    if (lflow->logical_datapath) {
+        return 1;
+    }
+    return lflow->logical_dp_group ? lflow->logical_dp_group->n_datapaths : 0;
+}
+
+/* Does the same as calling consider_logical_flow() for all the logical flows
+ * during a full recompute, but parses the actions and converts the matches
+ * in the threads of 'lflow_compile_pool'.  The results are then added to the
+ * flow table, the resource references and the lflow cache by the main
+ * thread, in the same order as the serial version, so that the allocated
+ * conjunction ids don't depend on the threads. */
+static void
+consider_logical_flows_parallel(
+    struct hmap *dhcp_opts, struct hmap *dhcpv6_opts,
+    struct hmap *nd_ra_opts,
+    struct controller_event_options *controller_event_opts,
+    struct lflow_ctx_in *l_ctx_in, struct lflow_ctx_out *l_ctx_out)
+{
+    const struct sbrec_logical_flow *lflow;
+    size_t n_jobs = 0;
+
+    SBREC_LOGICAL_FLOW_TABLE_FOR_EACH (lflow, l_ctx_in->logical_flow_table) {
+        n_jobs += lflow_n_datapaths(lflow);
+    }
+
+    struct lflow_compile_job *jobs = xcalloc(n_jobs, sizeof *jobs);
+    size_t n = 0;
+    SBREC_LOGICAL_FLOW_TABLE_FOR_EACH (lflow, l_ctx_in->logical_flow_table) {
+        /* Cached lflows can skip the conversion of the match. */
+        struct uuid key;
+        bool compile_match = !lflow_cache_get(
+            l_ctx_out->lflow_cache,
+            lflow_cache_key(l_ctx_out->lflow_cache, lflow, &key));
+        size_t n_dps = lflow_n_datapaths(lflow);
+        for (size_t i = 0; i < n_dps; i++) {
+            struct lflow_compile_job *job = &jobs[n++];
+
+            job->lflow = lflow;
+            job->dp = (lflow->logical_datapath
+                       ? lflow->logical_datapath
+                       : lflow->logical_dp_group->datapaths[i]);
+            job->compile_match = compile_match;
+            ofpbuf_init(&job->ovnacts, 0);
+            lflow_resource_init(&job->refs);
+        }
+    }
+
+    struct lflow_compile_info info = {
+        .jobs = jobs,
+        .n_jobs = n_jobs,
+        .dhcp_opts = dhcp_opts,
+        .dhcpv6_opts = dhcpv6_opts,
+        .nd_ra_opts = nd_ra_opts,
+        .controller_event_opts = controller_event_opts,
+        .l_ctx_in = l_ctx_in,
+        .cache_enabled = lflow_cache_is_enabled(l_ctx_out->lflow_cache),
+    };
+    for (size_t i = 0; i < lflow_compile_pool->size; i++) {
+        lflow_compile_pool->controls[i].data = &info;
+    }
+    pool_set_tasks(lflow_compile_pool, n_jobs);
+    run_pool(lflow_compile_pool);
+
+    n = 0;
+    SBREC_LOGICAL_FLOW_TABLE_FOR_EACH (lflow, l_ctx_in->logical_flow_table) {
+        if (!lflow->logical_datapath && !lflow->logical_dp_group) {
+            VLOG_DBG("lflow "UUID_FMT" has no datapath binding, skip",
+                     UUID_ARGS(&lflow->header_.uuid));
+            continue;
+        }
+
+        COVERAGE_INC(consider_logical_flow);
+        struct lflow_shared_matches shared = LFLOW_SHARED_MATCHES_INITIALIZER;
+        size_t n_dps = lflow_n_datapaths(lflow);
+        for (size_t i = 0; i < n_dps; i++, n++) {
+            consider_lflow_job__(lflow, jobs[n].dp, dhcp_opts, dhcpv6_opts,
+                                 nd_ra_opts, controller_event_opts, &jobs[n],
+                                 &shared, l_ctx_in, l_ctx_out);
+            lflow_compile_job_destroy(&jobs[n]);
+        }
+        lflow_shared_matches_destroy(&shared);
+    }
+    free(jobs);
+}
+
 static struct lflow_processed_node *
 lflows_processed_find(struct hmap *lflows_processed,
                       const struct uuid *lflow_uuid)
@@ -1605,19 +2232,27 @@ consider_logical_flow(const struct sbrec_logical_flow *lflow,
                              &lflow->header_.uuid);
     }
 
+    size_t n_dps = dp ? 1 : dp_group->n_datapaths;
+    OVN_USDT_PROBE(lflow, consider_logical_flow_begin, &lflow->header_.uuid,
+                   lflow->table_id, n_dps);
     if (dp) {
         consider_logical_flow__(lflow, dp,
                                 dhcp_opts, dhcpv6_opts, nd_ra_opts,
                                 controller_event_opts,
                                 l_ctx_in, l_ctx_out);
-        return;
-    }
-    for (size_t i = 0; dp_group && i < dp_group->n_datapaths; i++) {
-        consider_logical_flow__(lflow, dp_group->datapaths[i],
-                                dhcp_opts,  dhcpv6_opts, nd_ra_opts,
-                                controller_event_opts,
-                                l_ctx_in, l_ctx_out);
+    } else {
+        struct lflow_shared_matches shared =
+            LFLOW_SHARED_MATCHES_INITIALIZER;
+        for (size_t i = 0; i < dp_group->n_datapaths; i++) {
+            consider_lflow_job__(lflow, dp_group->datapaths[i],
+                                 dhcp_opts, dhcpv6_opts, nd_ra_opts,
+                                 controller_event_opts, NULL, &shared,
+                                 l_ctx_in, l_ctx_out);
+        }
+        lflow_shared_matches_destroy(&shared);
     }
+    OVN_USDT_PROBE(lflow, consider_logical_flow_end, &lflow->header_.uuid,
+                   lflow->table_id, n_dps);
 }
 
 static void
@@ -1734,29 +2369,65 @@ consider_neighbor_flow(struct ovsdb_idl_index *sbrec_port_binding_by_name,
     ofpbuf_uninit(&ofpacts);
 }
 
-/* Adds an OpenFlow flow to flow tables for each MAC binding in the OVN
- * southbound database. */
+/* Adds OpenFlow flows to flow tables for each MAC binding of datapath 'dp'
+ * in the OVN southbound database. */
 static void
-add_neighbor_flows(struct ovsdb_idl_index *sbrec_port_binding_by_name,
-                   const struct sbrec_mac_binding_table *mac_binding_table,
-                   const struct sbrec_static_mac_binding_table *smb_table,
-                   const struct hmap *local_datapaths,
-                   struct ovn_desired_flow_table *flow_table)
+add_neighbor_flows_for_datapath(
+    struct ovsdb_idl_index *sbrec_port_binding_by_name,
+    struct ovsdb_idl_index *sbrec_mac_binding_by_datapath,
+    struct ovsdb_idl_index *sbrec_static_mac_binding_by_datapath,
+    const struct sbrec_datapath_binding *dp,
+    const struct hmap *local_datapaths,
+    struct ovn_desired_flow_table *flow_table)
 {
     /* Add flows for learnt MAC bindings */
-    const struct sbrec_mac_binding *b;
-    SBREC_MAC_BINDING_TABLE_FOR_EACH (b, mac_binding_table) {
+    struct sbrec_mac_binding *mb_index_row = sbrec_mac_binding_index_init_row(
+        sbrec_mac_binding_by_datapath);
+    sbrec_mac_binding_index_set_datapath(mb_index_row, dp);
+    const struct sbrec_mac_binding *mb;
+    SBREC_MAC_BINDING_FOR_EACH_EQUAL (mb, mb_index_row,
+                                      sbrec_mac_binding_by_datapath) {
         consider_neighbor_flow(sbrec_port_binding_by_name, local_datapaths,
-                               b, NULL, flow_table, 100);
+                               mb, NULL, flow_table, 100);
     }
+    sbrec_mac_binding_index_destroy_row(mb_index_row);
 
     /* Add flows for statically configured MAC bindings */
+    struct sbrec_static_mac_binding *smb_index_row =
+        sbrec_static_mac_binding_index_init_row(
+            sbrec_static_mac_binding_by_datapath);
+    sbrec_static_mac_binding_index_set_datapath(smb_index_row, dp);
     const struct sbrec_static_mac_binding *smb;
-    SBREC_STATIC_MAC_BINDING_TABLE_FOR_EACH (smb, smb_table) {
+    SBREC_STATIC_MAC_BINDING_FOR_EACH_EQUAL (
+        smb, smb_index_row, sbrec_static_mac_binding_by_datapath) {
         consider_neighbor_flow(sbrec_port_binding_by_name, local_datapaths,
                                NULL, smb, flow_table,
                                smb->override_dynamic_mac ? 150 : 50);
     }
+    sbrec_static_mac_binding_index_destroy_row(smb_index_row);
+}
+
+/* Adds OpenFlow flows to flow tables for each MAC binding of the local
+ * datapaths in the OVN southbound database.  The bindings of the other
+ * datapaths don't generate flows, so they aren't visited at all, which
+ * matters when all the MAC bindings are monitored, e.g. with
+ * ovn-monitor-all. */
+static void
+add_neighbor_flows(
+    struct ovsdb_idl_index *sbrec_port_binding_by_name,
+    struct ovsdb_idl_index *sbrec_mac_binding_by_datapath,
+    struct ovsdb_idl_index *sbrec_static_mac_binding_by_datapath,
+    const struct hmap *local_datapaths,
+    struct ovn_desired_flow_table *flow_table)
+{
+    const struct local_datapath *ld;
+    HMAP_FOR_EACH (ld, hmap_node, local_datapaths) {
+        add_neighbor_flows_for_datapath(sbrec_port_binding_by_name,
+                                        sbrec_mac_binding_by_datapath,
+                                        sbrec_static_mac_binding_by_datapath,
+                                        ld->datapath, local_datapaths,
+                                        flow_table);
+    }
 }
 
 /* Builds the "learn()" action to be triggered by packets initiating a
@@ -1943,6 +2614,7 @@ add_lb_vip_hairpin_flows(struct ovn_controller_lb *lb,
                          struct ovn_lb_backend *lb_backend,
                          uint8_t lb_proto,
                          bool check_ct_label_for_lb_hairpin,
+                         const struct uuid *flow_uuid,
                          struct ovn_desired_flow_table *flow_table)
 {
     uint64_t stub[1024 / 8];
@@ -2039,7 +2711,7 @@ add_lb_vip_hairpin_flows(struct ovn_controller_lb *lb,
 
     ofctrl_add_flow(flow_table, OFTABLE_CHK_LB_HAIRPIN, 100,
                     lb->slb->header_.uuid.parts[0], &hairpin_match,
-                    &ofpacts, &lb->slb->header_.uuid);
+                    &ofpacts, flow_uuid);
 
     /* The below flow is identical to the above except that it checks
      * ct_label.natted instead of ct_mark.natted, for backward compatibility
@@ -2053,7 +2725,7 @@ add_lb_vip_hairpin_flows(struct ovn_controller_lb *lb,
 
         ofctrl_add_flow(flow_table, OFTABLE_CHK_LB_HAIRPIN, 100,
                         lb->slb->header_.uuid.parts[0], &hairpin_match,
-                        &ofpacts, &lb->slb->header_.uuid);
+                        &ofpacts, flow_uuid);
     }
 
     ofpbuf_uninit(&ofpacts);
@@ -2154,6 +2826,7 @@ add_lb_ct_snat_hairpin_vip_flow(struct ovn_controller_lb *lb,
                                 uint32_t id,
                                 struct ovn_lb_vip *lb_vip,
                                 uint8_t lb_proto,
+                                const struct uuid *flow_uuid,
                                 struct ovn_desired_flow_table *flow_table)
 {
     uint64_t stub[1024 / 8];
@@ -2262,28 +2935,124 @@ add_lb_ct_snat_hairpin_vip_flow(struct ovn_controller_lb *lb,
      * LBs */
     ofctrl_add_or_append_flow(flow_table, OFTABLE_CT_SNAT_HAIRPIN, priority,
                               lb->slb->header_.uuid.parts[0],
-                              &match, &ofpacts, &lb->slb->header_.uuid,
+                              &match, &ofpacts, flow_uuid,
                               NX_CTLR_NO_METER, NULL);
     ofpbuf_uninit(&ofpacts);
 
 }
 
-/* When a packet is sent to a LB VIP from a backend and the LB selects that
+/* The hairpin flows of a load balancer are linked to a uuid derived from
+ * the load balancer's uuid and from the VIP, for the ct_snat flow of the VIP,
+ * or from the VIP and the backend, for the hairpin detection flows of the
+ * backend.  This way, a change to the VIPs of the load balancer only
+ * removes and adds the flows of the VIPs and backends that changed.  The
+ * flows that depend on the whole load balancer, i.e. the per datapath
+ * ct_snat flows, are linked to the load balancer's uuid. */
+struct lb_hairpin_flows {
+    struct hmap_node hmap_node; /* In lflow_ctx_out 'hairpin_lbs'. */
+    struct uuid lb_uuid;
+    struct sset keys;           /* Keys of the VIPs and backends. */
+};
+
+static struct lb_hairpin_flows *
+lb_hairpin_flows_find(const struct hmap *hairpin_lbs,
+                      const struct uuid *lb_uuid)
+{
+    struct lb_hairpin_flows *lbh;
+    HMAP_FOR_EACH_WITH_HASH (lbh, hmap_node, uuid_hash(lb_uuid),
+                             hairpin_lbs) {
+        if (uuid_equals(&lbh->lb_uuid, lb_uuid)) {
+            return lbh;
+        }
+    }
+    return NULL;
+}
+
+static void
+lb_hairpin_flows_key_uuid(const struct uuid *lb_uuid, const char *key,
+                          struct uuid *flow_uuid)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(flow_uuid->parts); i++) {
+        flow_uuid->parts[i] = hash_string(key, lb_uuid->parts[i]);
+    }
+}
+
+static char *
+lb_hairpin_vip_key(const struct ovn_lb_vip *lb_vip)
+{
+    return xasprintf("%s:%"PRIu16, lb_vip->vip_str, lb_vip->vip_port);
+}
+
+static char *
+lb_hairpin_backend_key(const struct ovn_lb_vip *lb_vip,
+                       const struct ovn_lb_backend *lb_backend)
+{
+    return xasprintf("%s:%"PRIu16" %s:%"PRIu16,
+                     lb_vip->vip_str, lb_vip->vip_port,
+                     lb_backend->ip_str, lb_backend->port);
+}
+
+/* Removes the flows of 'lbh' from 'flow_table' and frees it. */
+static void
+lb_hairpin_flows_remove(struct ovn_desired_flow_table *flow_table,
+                        struct hmap *hairpin_lbs,
+                        struct lb_hairpin_flows *lbh)
+{
+    const char *key;
+    SSET_FOR_EACH (key, &lbh->keys) {
+        struct uuid flow_uuid;
+        lb_hairpin_flows_key_uuid(&lbh->lb_uuid, key, &flow_uuid);
+        ofctrl_remove_flows(flow_table, &flow_uuid);
+    }
+    ofctrl_remove_flows(flow_table, &lbh->lb_uuid);
+
+    hmap_remove(hairpin_lbs, &lbh->hmap_node);
+    sset_destroy(&lbh->keys);
+    free(lbh);
+}
+
+/* Frees the tracking of the hairpin flows in 'hairpin_lbs', without
+ * removing the flows, e.g. because the flow table is cleared. */
+void
+lflow_hairpin_lbs_clear(struct hmap *hairpin_lbs)
+{
+    struct lb_hairpin_flows *lbh;
+    HMAP_FOR_EACH_POP (lbh, hmap_node, hairpin_lbs) {
+        sset_destroy(&lbh->keys);
+        free(lbh);
+    }
+}
+
+static uint8_t
+lb_hairpin_proto(const struct ovn_controller_lb *lb)
+{
+    if (lb->slb->protocol && lb->slb->protocol[0]) {
+        if (!strcmp(lb->slb->protocol, "udp")) {
+            return IPPROTO_UDP;
+        } else if (!strcmp(lb->slb->protocol, "sctp")) {
+            return IPPROTO_SCTP;
+        }
+    }
+    return IPPROTO_TCP;
+}
+
+/* Adds the hairpin flows of the VIPs and backends of 'lb' whose keys are
+ * not in 'lbh' yet, and adds their keys to 'lbh'.
+ *
+ * When a packet is sent to a LB VIP from a backend and the LB selects that
  * same backend as the target, this is a hairpin flow. The source address of
  * hairpin flows needs to be updated via SNAT so as it seems that the packet is
  * being sent from either a) the LB VIP or b) "hairpin_snat_ip" as specified in
  * the LB entry in the NBDB.
  *
- * add_lb_ct_snat_hairpin_flows() adds OpenFlow flows for each LB in order to
- * achieve this behaviour.
- *
  * Note: 'conjunctive_id' must be a unique identifier for each LB as it is used
  * as a conjunctive flow id. */
 static void
-add_lb_ct_snat_hairpin_flows(struct ovn_controller_lb *lb,
-                             uint32_t conjunctive_id,
-                             uint8_t lb_proto,
-                             struct ovn_desired_flow_table *flow_table)
+add_lb_hairpin_vip_flows(struct ovn_controller_lb *lb,
+                         uint32_t conjunctive_id,
+                         bool check_ct_label_for_lb_hairpin,
+                         struct lb_hairpin_flows *lbh,
+                         struct ovn_desired_flow_table *flow_table)
 {
     /* We must add a flow for each LB VIP. In the general case, this flow
        is added to the OFTABLE_CT_SNAT_HAIRPIN table. If it matches, we
@@ -2316,13 +3085,37 @@ add_lb_ct_snat_hairpin_flows(struct ovn_controller_lb *lb,
        configuration in OVN, it is a nonsense configuration as two LBs with the
        same VIP should not be added to the same datapath. */
 
-    for (int i = 0; i < lb->n_vips; i++) {
+    uint8_t lb_proto = lb_hairpin_proto(lb);
+    struct uuid flow_uuid;
+
+    for (size_t i = 0; i < lb->n_vips; i++) {
         struct ovn_lb_vip *lb_vip = &lb->vips[i];
-        add_lb_ct_snat_hairpin_vip_flow(lb, conjunctive_id,
-                                        lb_vip, lb_proto, flow_table);
-    }
 
-    add_lb_ct_snat_hairpin_dp_flows(lb, conjunctive_id, flow_table);
+        char *key = lb_hairpin_vip_key(lb_vip);
+        if (!sset_contains(&lbh->keys, key)) {
+            lb_hairpin_flows_key_uuid(&lbh->lb_uuid, key, &flow_uuid);
+            add_lb_ct_snat_hairpin_vip_flow(lb, conjunctive_id, lb_vip,
+                                            lb_proto, &flow_uuid, flow_table);
+            sset_add_and_free(&lbh->keys, key);
+        } else {
+            free(key);
+        }
+
+        for (size_t j = 0; j < lb_vip->n_backends; j++) {
+            struct ovn_lb_backend *lb_backend = &lb_vip->backends[j];
+
+            key = lb_hairpin_backend_key(lb_vip, lb_backend);
+            if (sset_contains(&lbh->keys, key)) {
+                free(key);
+                continue;
+            }
+            lb_hairpin_flows_key_uuid(&lbh->lb_uuid, key, &flow_uuid);
+            add_lb_vip_hairpin_flows(lb, lb_vip, lb_backend, lb_proto,
+                                     check_ct_label_for_lb_hairpin,
+                                     &flow_uuid, flow_table);
+            sset_add_and_free(&lbh->keys, key);
+        }
+    }
 }
 
 static void
@@ -2330,8 +3123,15 @@ consider_lb_hairpin_flows(const struct sbrec_load_balancer *sbrec_lb,
                           const struct hmap *local_datapaths,
                           bool check_ct_label_for_lb_hairpin,
                           struct ovn_desired_flow_table *flow_table,
-                          struct simap *ids)
+                          struct simap *ids,
+                          struct hmap *hairpin_lbs)
 {
+    /* The flows of the load balancer may already have been added for
+     * another of its datapaths. */
+    if (lb_hairpin_flows_find(hairpin_lbs, &sbrec_lb->header_.uuid)) {
+        return;
+    }
+
     int id = simap_get(ids, sbrec_lb->name);
     VLOG_DBG("Load Balancer %s has conjunctive flow id %u",
              sbrec_lb->name, id);
@@ -2351,33 +3151,89 @@ consider_lb_hairpin_flows(const struct sbrec_load_balancer *sbrec_lb,
         return;
     }
 
+    struct lb_hairpin_flows *lbh = xmalloc(sizeof *lbh);
+    lbh->lb_uuid = sbrec_lb->header_.uuid;
+    sset_init(&lbh->keys);
+    hmap_insert(hairpin_lbs, &lbh->hmap_node, uuid_hash(&lbh->lb_uuid));
+
+    struct ovn_controller_lb *lb = ovn_controller_lb_create(sbrec_lb);
+    add_lb_hairpin_vip_flows(lb, id, check_ct_label_for_lb_hairpin, lbh,
+                             flow_table);
+    add_lb_ct_snat_hairpin_dp_flows(lb, id, flow_table);
+    ovn_controller_lb_destroy(lb);
+}
+
+/* Updates the hairpin flows 'lbh' of 'sbrec_lb', of which only the VIPs
+ * changed: removes the flows of the VIPs and backends that are gone and
+ * adds the flows of the new ones. */
+static void
+update_lb_hairpin_vip_flows(const struct sbrec_load_balancer *sbrec_lb,
+                            bool check_ct_label_for_lb_hairpin,
+                            struct ovn_desired_flow_table *flow_table,
+                            struct simap *ids,
+                            struct lb_hairpin_flows *lbh)
+{
     struct ovn_controller_lb *lb = ovn_controller_lb_create(sbrec_lb);
-    uint8_t lb_proto = IPPROTO_TCP;
-    if (lb->slb->protocol && lb->slb->protocol[0]) {
-        if (!strcmp(lb->slb->protocol, "udp")) {
-            lb_proto = IPPROTO_UDP;
-        } else if (!strcmp(lb->slb->protocol, "sctp")) {
-            lb_proto = IPPROTO_SCTP;
-        }
-    }
 
-    for (i = 0; i < lb->n_vips; i++) {
+    struct sset keys = SSET_INITIALIZER(&keys);
+    for (size_t i = 0; i < lb->n_vips; i++) {
         struct ovn_lb_vip *lb_vip = &lb->vips[i];
 
+        sset_add_and_free(&keys, lb_hairpin_vip_key(lb_vip));
         for (size_t j = 0; j < lb_vip->n_backends; j++) {
-            struct ovn_lb_backend *lb_backend = &lb_vip->backends[j];
-
-            add_lb_vip_hairpin_flows(lb, lb_vip, lb_backend, lb_proto,
-                                     check_ct_label_for_lb_hairpin,
-                                     flow_table);
+            sset_add_and_free(&keys,
+                              lb_hairpin_backend_key(lb_vip,
+                                                     &lb_vip->backends[j]));
         }
     }
 
-    add_lb_ct_snat_hairpin_flows(lb, id, lb_proto, flow_table);
+    /* Remove the stale flows first, in case a new flow is identical to one
+     * of them. */
+    const char *key;
+    SSET_FOR_EACH_SAFE (key, &lbh->keys) {
+        if (!sset_contains(&keys, key)) {
+            struct uuid flow_uuid;
+            lb_hairpin_flows_key_uuid(&lbh->lb_uuid, key, &flow_uuid);
+            ofctrl_remove_flows(flow_table, &flow_uuid);
+            sset_delete(&lbh->keys, SSET_NODE_FROM_NAME(key));
+        }
+    }
+    sset_destroy(&keys);
 
+    add_lb_hairpin_vip_flows(lb, simap_get(ids, sbrec_lb->name),
+                             check_ct_label_for_lb_hairpin, lbh, flow_table);
     ovn_controller_lb_destroy(lb);
 }
 
+/* Returns true if the VIPs are the only column of 'lb' that changed, in
+ * which case its hairpin flows can be updated per VIP and backend. */
+static bool
+lb_only_vips_updated(const struct sbrec_load_balancer *lb)
+{
+    return (!sbrec_load_balancer_is_updated(lb, SBREC_LOAD_BALANCER_COL_NAME)
+            && !sbrec_load_balancer_is_updated(
+                   lb, SBREC_LOAD_BALANCER_COL_PROTOCOL)
+            && !sbrec_load_balancer_is_updated(
+                   lb, SBREC_LOAD_BALANCER_COL_DATAPATHS)
+            && !sbrec_load_balancer_is_updated(
+                   lb, SBREC_LOAD_BALANCER_COL_OPTIONS));
+}
+
+/* Removes all the hairpin flows of the load balancer with 'lb_uuid'. */
+static void
+remove_lb_hairpin_flows(struct ovn_desired_flow_table *flow_table,
+                        struct hmap *hairpin_lbs,
+                        const struct uuid *lb_uuid)
+{
+    struct lb_hairpin_flows *lbh = lb_hairpin_flows_find(hairpin_lbs,
+                                                         lb_uuid);
+    if (lbh) {
+        lb_hairpin_flows_remove(flow_table, hairpin_lbs, lbh);
+    } else {
+        ofctrl_remove_flows(flow_table, lb_uuid);
+    }
+}
+
 /* Adds OpenFlow flows to flow tables for each Load balancer VIPs and
  * backends to handle the load balanced hairpin traffic. */
 static void
@@ -2386,7 +3242,8 @@ add_lb_hairpin_flows(const struct sbrec_load_balancer_table *lb_table,
                      bool check_ct_label_for_lb_hairpin,
                      struct ovn_desired_flow_table *flow_table,
                      struct simap *ids,
-                     struct id_pool *pool)
+                     struct id_pool *pool,
+                     struct hmap *hairpin_lbs)
 {
     uint32_t id;
     const struct sbrec_load_balancer *lb;
@@ -2408,8 +3265,9 @@ add_lb_hairpin_flows(const struct sbrec_load_balancer_table *lb_table,
         }
         consider_lb_hairpin_flows(lb, local_datapaths,
                                   check_ct_label_for_lb_hairpin,
-                                  flow_table, ids);
+                                  flow_table, ids, hairpin_lbs);
     }
+    ovn_lb_cache_sweep();
 }
 
 /* Handles neighbor changes in mac_binding table. */
@@ -2532,27 +3390,48 @@ add_fdb_flows(const struct sbrec_fdb_table *fdb_table,
 
 
 /* Translates logical flows in the Logical_Flow table in the OVN_SB database
- * into OpenFlow flows.  See ovn-architecture(7) for more information. */
-void
+ * into OpenFlow flows.  See ovn-architecture(7) for more information.
+ *
+ * Returns false if it stopped early because of lflow_set_run_slice(), in
+ * which case it must be called again, with the same 'l_ctx_out' and
+ * unchanged inputs, to resume. */
+bool
 lflow_run(struct lflow_ctx_in *l_ctx_in, struct lflow_ctx_out *l_ctx_out)
 {
-    COVERAGE_INC(lflow_run);
+    long long int deadline = (lflow_run_slice_msec
+                              ? time_msec() + lflow_run_slice_msec
+                              : LLONG_MAX);
+
+    if (!l_ctx_out->run_progress->in_progress) {
+        COVERAGE_INC(lflow_run);
+    }
+
+    if (!add_logical_flows(l_ctx_in, l_ctx_out, deadline)) {
+        return false;
+    }
 
-    add_logical_flows(l_ctx_in, l_ctx_out);
+    const struct local_datapath *ldp;
+    HMAP_FOR_EACH (ldp, hmap_node, l_ctx_in->local_datapaths) {
+        if (ldp->lazy) {
+            add_lazy_datapath_flow(ldp->datapath, l_ctx_out->flow_table);
+        }
+    }
     add_neighbor_flows(l_ctx_in->sbrec_port_binding_by_name,
-                       l_ctx_in->mac_binding_table,
-                       l_ctx_in->static_mac_binding_table,
+                       l_ctx_in->sbrec_mac_binding_by_datapath,
+                       l_ctx_in->sbrec_static_mac_binding_by_datapath,
                        l_ctx_in->local_datapaths,
                        l_ctx_out->flow_table);
     add_lb_hairpin_flows(l_ctx_in->lb_table, l_ctx_in->local_datapaths,
                          l_ctx_in->check_ct_label_for_lb_hairpin,
                          l_ctx_out->flow_table,
                          l_ctx_out->hairpin_lb_ids,
-                         l_ctx_out->hairpin_id_pool);
+                         l_ctx_out->hairpin_id_pool,
+                         l_ctx_out->hairpin_lbs);
     add_fdb_flows(l_ctx_in->fdb_table, l_ctx_in->local_datapaths,
                   l_ctx_out->flow_table);
     add_port_sec_flows(l_ctx_in->binding_lports, l_ctx_in->chassis,
-                       l_ctx_out->flow_table);
+                       l_ctx_out->flow_table, l_ctx_out->conj_ids);
+    return true;
 }
 
 /* Should be called at every ovn-controller iteration before IDL tracked
@@ -2567,16 +3446,69 @@ lflow_handle_cached_flows(struct lflow_cache *lc,
 
     SBREC_LOGICAL_FLOW_TABLE_FOR_EACH_TRACKED (lflow, flow_table) {
         if (sbrec_logical_flow_is_deleted(lflow)) {
-            lflow_cache_delete(lc, &lflow->header_.uuid);
+            struct uuid key;
+            lflow_cache_delete(lc, lflow_cache_key(lc, lflow, &key));
         }
     }
 }
 
+/* Sets the number of threads that lflow_run() uses to parse the logical
+ * flows.  With 1, the default, everything runs in the main thread. */
+void
+lflow_set_n_threads(size_t n_threads)
+{
+    n_threads = MIN(MAX(n_threads, 1), LFLOW_MAX_N_THREADS);
+    update_worker_pool(n_threads, &lflow_compile_pool, lflow_compile_thread);
+}
+
+/* Sets the maximum time, in msec, that lflow_run() spends on the logical
+ * flows before returning false, to be called again to resume.  With 0, the
+ * default, lflow_run() processes all the logical flows at once.  The
+ * logical flows are not split when they are parsed in worker threads. */
+void
+lflow_set_run_slice(unsigned int msec)
+{
+    lflow_run_slice_msec = msec;
+}
+
 void
 lflow_destroy(void)
 {
     expr_symtab_destroy(&symtab);
     shash_destroy(&symtab);
+    ovn_lb_cache_clear();
+}
+
+/* Adds the flow that reports to pinctrl the packets that enter the lazy
+ * datapath 'dp', in place of its logical flows, so that they get compiled.
+ * The packets themselves are dropped. */
+static void
+add_lazy_datapath_flow(const struct sbrec_datapath_binding *dp,
+                       struct ovn_desired_flow_table *flow_table)
+{
+    struct match match = MATCH_CATCHALL_INITIALIZER;
+    match_set_metadata(&match, htonll(dp->tunnel_key));
+
+    uint64_t stub[64 / 8];
+    struct ofpbuf ofpacts = OFPBUF_STUB_INITIALIZER(stub);
+    size_t ofs = ofpacts.size;
+    struct ofpact_controller *oc = ofpact_put_CONTROLLER(&ofpacts);
+    oc->max_len = UINT16_MAX;
+    oc->reason = OFPR_ACTION;
+    oc->meter_id = NX_CTLR_NO_METER;
+
+    struct action_header ah = {
+        .opcode = htonl(ACTION_OPCODE_LAZY_DATAPATH),
+    };
+    ofpbuf_put(&ofpacts, &ah, sizeof ah);
+    oc = ofpbuf_at_assert(&ofpacts, ofs, sizeof *oc);
+    ofpacts.header = oc;
+    oc->userdata_len = ofpacts.size - (ofs + sizeof *oc);
+    ofpact_finish_CONTROLLER(&ofpacts, &oc);
+
+    ofctrl_add_flow(flow_table, OFTABLE_LOG_INGRESS_PIPELINE, 0, 0, &match,
+                    &ofpacts, &dp->header_.uuid);
+    ofpbuf_uninit(&ofpacts);
 }
 
 bool
@@ -2586,6 +3518,16 @@ lflow_add_flows_for_datapath(const struct sbrec_datapath_binding *dp,
                              struct lflow_ctx_in *l_ctx_in,
                              struct lflow_ctx_out *l_ctx_out)
 {
+    const struct local_datapath *ldp =
+        get_local_datapath(l_ctx_in->local_datapaths, dp->tunnel_key);
+    if (ldp && ldp->lazy) {
+        add_lazy_datapath_flow(dp, l_ctx_out->flow_table);
+        return true;
+    }
+
+    /* The datapath may have been lazy until now. */
+    ofctrl_remove_flows(l_ctx_out->flow_table, &dp->header_.uuid);
+
     bool handled = true;
     struct hmap dhcp_opts = HMAP_INITIALIZER(&dhcp_opts);
     struct hmap dhcpv6_opts = HMAP_INITIALIZER(&dhcpv6_opts);
@@ -2674,31 +3616,11 @@ lflow_add_flows_for_datapath(const struct sbrec_datapath_binding *dp,
     }
     sbrec_fdb_index_destroy_row(fdb_index_row);
 
-    struct sbrec_mac_binding *mb_index_row = sbrec_mac_binding_index_init_row(
-        l_ctx_in->sbrec_mac_binding_by_datapath);
-    sbrec_mac_binding_index_set_datapath(mb_index_row, dp);
-    const struct sbrec_mac_binding *mb;
-    SBREC_MAC_BINDING_FOR_EACH_EQUAL (
-        mb, mb_index_row, l_ctx_in->sbrec_mac_binding_by_datapath) {
-        consider_neighbor_flow(l_ctx_in->sbrec_port_binding_by_name,
-                               l_ctx_in->local_datapaths,
-                               mb, NULL, l_ctx_out->flow_table, 100);
-    }
-    sbrec_mac_binding_index_destroy_row(mb_index_row);
-
-    struct sbrec_static_mac_binding *smb_index_row =
-        sbrec_static_mac_binding_index_init_row(
-            l_ctx_in->sbrec_static_mac_binding_by_datapath);
-    sbrec_static_mac_binding_index_set_datapath(smb_index_row, dp);
-    const struct sbrec_static_mac_binding *smb;
-    SBREC_STATIC_MAC_BINDING_FOR_EACH_EQUAL (
-        smb, smb_index_row, l_ctx_in->sbrec_static_mac_binding_by_datapath) {
-        consider_neighbor_flow(l_ctx_in->sbrec_port_binding_by_name,
-                               l_ctx_in->local_datapaths,
-                               NULL, smb, l_ctx_out->flow_table,
-                               smb->override_dynamic_mac ? 150 : 50);
-    }
-    sbrec_static_mac_binding_index_destroy_row(smb_index_row);
+    add_neighbor_flows_for_datapath(
+        l_ctx_in->sbrec_port_binding_by_name,
+        l_ctx_in->sbrec_mac_binding_by_datapath,
+        l_ctx_in->sbrec_static_mac_binding_by_datapath,
+        dp, l_ctx_in->local_datapaths, l_ctx_out->flow_table);
 
     dhcp_opts_destroy(&dhcp_opts);
     dhcp_opts_destroy(&dhcpv6_opts);
@@ -2711,7 +3633,8 @@ lflow_add_flows_for_datapath(const struct sbrec_datapath_binding *dp,
         consider_lb_hairpin_flows(dp_lbs[i], l_ctx_in->local_datapaths,
                                   l_ctx_in->check_ct_label_for_lb_hairpin,
                                   l_ctx_out->flow_table,
-                                  l_ctx_out->hairpin_lb_ids);
+                                  l_ctx_out->hairpin_lb_ids,
+                                  l_ctx_out->hairpin_lbs);
     }
 
     return handled;
@@ -2739,15 +3662,18 @@ lflow_handle_flows_for_lport(const struct sbrec_port_binding *pb,
      * port binding'uuid', then this function should handle it properly.
      */
     ofctrl_remove_flows(l_ctx_out->flow_table, &pb->header_.uuid);
+    lflow_conj_ids_free(l_ctx_out->conj_ids, &pb->header_.uuid);
 
     if (pb->n_port_security && shash_find(l_ctx_in->binding_lports,
                                           pb->logical_port)) {
-        consider_port_sec_flows(pb, l_ctx_out->flow_table);
+        consider_port_sec_flows(pb, l_ctx_out->flow_table,
+                                l_ctx_out->conj_ids);
     }
     return true;
 }
 
-/* Handles port-binding add/deletions. */
+/* Handles port-binding add/deletions, and the changes of the addresses and
+ * types of the ports for the port template lflows. */
 bool
 lflow_handle_changed_port_bindings(struct lflow_ctx_in *l_ctx_in,
                                    struct lflow_ctx_out *l_ctx_out)
@@ -2757,15 +3683,33 @@ lflow_handle_changed_port_bindings(struct lflow_ctx_in *l_ctx_in,
     const struct sbrec_port_binding *pb;
     SBREC_PORT_BINDING_TABLE_FOR_EACH_TRACKED (pb,
                                                l_ctx_in->port_binding_table) {
-        if (!sbrec_port_binding_is_new(pb)
-            && !sbrec_port_binding_is_deleted(pb)) {
-            continue;
-        }
-        if (!lflow_handle_changed_ref(REF_TYPE_PORTBINDING, pb->logical_port,
-                                      l_ctx_in, l_ctx_out, &changed)) {
+        bool added_or_deleted = (sbrec_port_binding_is_new(pb)
+                                 || sbrec_port_binding_is_deleted(pb));
+        if (added_or_deleted
+            && !lflow_handle_changed_ref(REF_TYPE_PORTBINDING,
+                                         pb->logical_port, l_ctx_in,
+                                         l_ctx_out, &changed)) {
             ret = false;
             break;
         }
+
+        /* The port template lflows of the datapath expand to the VIFs and
+         * their addresses. */
+        if (pb->datapath
+            && (added_or_deleted
+                || sbrec_port_binding_is_updated(
+                       pb, SBREC_PORT_BINDING_COL_MAC)
+                || sbrec_port_binding_is_updated(
+                       pb, SBREC_PORT_BINDING_COL_TYPE))) {
+            char dp_key[32];
+            snprintf(dp_key, sizeof dp_key, "%"PRId64,
+                     pb->datapath->tunnel_key);
+            if (!lflow_handle_changed_ref(REF_TYPE_DP_PORTS, dp_key,
+                                          l_ctx_in, l_ctx_out, &changed)) {
+                ret = false;
+                break;
+            }
+        }
     }
     return ret;
 }
@@ -2802,14 +3746,17 @@ lflow_handle_changed_lbs(struct lflow_ctx_in *l_ctx_in,
     const struct sbrec_load_balancer *lb;
     struct id_pool *pool = l_ctx_out->hairpin_id_pool;
     struct simap *ids = l_ctx_out->hairpin_lb_ids;
+    struct hmap *hairpin_lbs = l_ctx_out->hairpin_lbs;
 
     SBREC_LOAD_BALANCER_TABLE_FOR_EACH_TRACKED (lb, l_ctx_in->lb_table) {
         if (sbrec_load_balancer_is_deleted(lb)) {
             VLOG_DBG("Remove hairpin flows for deleted load balancer "UUID_FMT,
                      UUID_ARGS(&lb->header_.uuid));
-            ofctrl_remove_flows(l_ctx_out->flow_table, &lb->header_.uuid);
+            remove_lb_hairpin_flows(l_ctx_out->flow_table, hairpin_lbs,
+                                    &lb->header_.uuid);
             id_pool_free_id(pool, simap_get(ids, lb->name));
             simap_find_and_delete(ids, lb->name);
+            ovn_lb_cache_remove(&lb->header_.uuid);
         }
     }
 
@@ -2819,9 +3766,21 @@ lflow_handle_changed_lbs(struct lflow_ctx_in *l_ctx_in,
         }
 
         if (!sbrec_load_balancer_is_new(lb)) {
+            struct lb_hairpin_flows *lbh =
+                lb_hairpin_flows_find(hairpin_lbs, &lb->header_.uuid);
+            if (lbh && lb_only_vips_updated(lb)) {
+                VLOG_DBG("Update hairpin flows for the VIPs of load balancer "
+                         UUID_FMT, UUID_ARGS(&lb->header_.uuid));
+                update_lb_hairpin_vip_flows(
+                    lb, l_ctx_in->check_ct_label_for_lb_hairpin,
+                    l_ctx_out->flow_table, ids, lbh);
+                continue;
+            }
+
             VLOG_DBG("Remove hairpin flows for updated load balancer "UUID_FMT,
                      UUID_ARGS(&lb->header_.uuid));
-            ofctrl_remove_flows(l_ctx_out->flow_table, &lb->header_.uuid);
+            remove_lb_hairpin_flows(l_ctx_out->flow_table, hairpin_lbs,
+                                    &lb->header_.uuid);
         } else {
             /* Allocate a unique 32-bit integer to this load-balancer. This
              * will be used as a conjunctive flow id in the
@@ -2842,7 +3801,7 @@ lflow_handle_changed_lbs(struct lflow_ctx_in *l_ctx_in,
         consider_lb_hairpin_flows(lb, l_ctx_in->local_datapaths,
                                   l_ctx_in->check_ct_label_for_lb_hairpin,
                                   l_ctx_out->flow_table,
-                                  l_ctx_out->hairpin_lb_ids);
+                                  l_ctx_out->hairpin_lb_ids, hairpin_lbs);
     }
 
     return true;
@@ -2885,7 +3844,8 @@ lflow_handle_changed_fdbs(struct lflow_ctx_in *l_ctx_in,
 static void
 add_port_sec_flows(const struct shash *binding_lports,
                    const struct sbrec_chassis *chassis,
-                   struct ovn_desired_flow_table *flow_table)
+                   struct ovn_desired_flow_table *flow_table,
+                   struct conj_ids *conj_ids)
 {
     const struct shash_node *node;
     SHASH_FOR_EACH (node, binding_lports) {
@@ -2894,7 +3854,7 @@ add_port_sec_flows(const struct shash *binding_lports,
             continue;
         }
 
-        consider_port_sec_flows(b_lport->pb, flow_table);
+        consider_port_sec_flows(b_lport->pb, flow_table, conj_ids);
     }
 }
 
@@ -3048,7 +4008,7 @@ build_in_port_sec_no_ip_flows(const struct sbrec_port_binding *pb,
 
 static void
 build_in_port_sec_ip4_flows(const struct sbrec_port_binding *pb,
-                           struct lport_addresses *ps_addr,
+                           struct lport_addresses *ps_addr, bool ip_conj,
                            struct match *m, struct ofpbuf *ofpacts,
                            struct ovn_desired_flow_table *flow_table)
 {
@@ -3067,27 +4027,29 @@ build_in_port_sec_ip4_flows(const struct sbrec_port_binding *pb,
      *         ip4.src == {ps_addr.ipv4_addrs}"
      * action - "port_sec_failed = 0;"
      */
-    for (size_t j = 0; j < ps_addr->n_ipv4_addrs; j++) {
-        reset_match_for_port_sec_flows(pb, MFF_LOG_INPORT, m);
-        match_set_dl_src(m, ps_addr->ea);
-        match_set_dl_type(m, htons(ETH_TYPE_IP));
+    if (!ip_conj) {
+        for (size_t j = 0; j < ps_addr->n_ipv4_addrs; j++) {
+            reset_match_for_port_sec_flows(pb, MFF_LOG_INPORT, m);
+            match_set_dl_src(m, ps_addr->ea);
+            match_set_dl_type(m, htons(ETH_TYPE_IP));
 
-        ovs_be32 mask = ps_addr->ipv4_addrs[j].mask;
-        /* When the netmask is applied, if the host portion is
-         * non-zero, the host can only use the specified
-         * address.  If zero, the host is allowed to use any
-         * address in the subnet.
-         */
-        if (ps_addr->ipv4_addrs[j].plen == 32 ||
-                ps_addr->ipv4_addrs[j].addr & ~mask) {
-            match_set_nw_src(m, ps_addr->ipv4_addrs[j].addr);
-        } else {
-            match_set_nw_src_masked(m, ps_addr->ipv4_addrs[j].addr, mask);
-        }
+            ovs_be32 mask = ps_addr->ipv4_addrs[j].mask;
+            /* When the netmask is applied, if the host portion is
+             * non-zero, the host can only use the specified
+             * address.  If zero, the host is allowed to use any
+             * address in the subnet.
+             */
+            if (ps_addr->ipv4_addrs[j].plen == 32 ||
+                    ps_addr->ipv4_addrs[j].addr & ~mask) {
+                match_set_nw_src(m, ps_addr->ipv4_addrs[j].addr);
+            } else {
+                match_set_nw_src_masked(m, ps_addr->ipv4_addrs[j].addr, mask);
+            }
 
-        ofctrl_add_flow(flow_table, OFTABLE_CHK_IN_PORT_SEC, 90,
-                        pb->header_.uuid.parts[0], m, ofpacts,
-                        &pb->header_.uuid);
+            ofctrl_add_flow(flow_table, OFTABLE_CHK_IN_PORT_SEC, 90,
+                            pb->header_.uuid.parts[0], m, ofpacts,
+                            &pb->header_.uuid);
+        }
     }
 
     /* Add the below logical flow equivalent OF rules in in_port_sec.
@@ -3118,7 +4080,7 @@ build_in_port_sec_ip4_flows(const struct sbrec_port_binding *pb,
 /* Adds the OF rules to allow ARP packets in 'in_port_sec_nd' table. */
 static void
 build_in_port_sec_arp_flows(const struct sbrec_port_binding *pb,
-                           struct lport_addresses *ps_addr,
+                           struct lport_addresses *ps_addr, bool ip_conj,
                            struct match *m, struct ofpbuf *ofpacts,
                            struct ovn_desired_flow_table *flow_table)
 {
@@ -3154,28 +4116,30 @@ build_in_port_sec_arp_flows(const struct sbrec_port_binding *pb,
      *         arp && arp.sha == ps_addr.ea && arp.spa == {ps_addr.ipv4_addrs}"
      * action - "port_sec_failed = 0;"
      */
-    for (size_t j = 0; j < ps_addr->n_ipv4_addrs; j++) {
-        reset_match_for_port_sec_flows(pb, MFF_LOG_INPORT, m);
-        match_set_dl_src(m, ps_addr->ea);
-        match_set_dl_type(m, htons(ETH_TYPE_ARP));
-        match_set_arp_sha(m, ps_addr->ea);
+    if (!ip_conj) {
+        for (size_t j = 0; j < ps_addr->n_ipv4_addrs; j++) {
+            reset_match_for_port_sec_flows(pb, MFF_LOG_INPORT, m);
+            match_set_dl_src(m, ps_addr->ea);
+            match_set_dl_type(m, htons(ETH_TYPE_ARP));
+            match_set_arp_sha(m, ps_addr->ea);
 
-        ovs_be32 mask = ps_addr->ipv4_addrs[j].mask;
-        if (ps_addr->ipv4_addrs[j].plen == 32 ||
-                ps_addr->ipv4_addrs[j].addr & ~mask) {
-            match_set_nw_src(m, ps_addr->ipv4_addrs[j].addr);
-        } else {
-            match_set_nw_src_masked(m, ps_addr->ipv4_addrs[j].addr, mask);
+            ovs_be32 mask = ps_addr->ipv4_addrs[j].mask;
+            if (ps_addr->ipv4_addrs[j].plen == 32 ||
+                    ps_addr->ipv4_addrs[j].addr & ~mask) {
+                match_set_nw_src(m, ps_addr->ipv4_addrs[j].addr);
+            } else {
+                match_set_nw_src_masked(m, ps_addr->ipv4_addrs[j].addr, mask);
+            }
+            ofctrl_add_flow(flow_table, OFTABLE_CHK_IN_PORT_SEC_ND, 90,
+                            pb->header_.uuid.parts[0], m, ofpacts,
+                            &pb->header_.uuid);
         }
-        ofctrl_add_flow(flow_table, OFTABLE_CHK_IN_PORT_SEC_ND, 90,
-                        pb->header_.uuid.parts[0], m, ofpacts,
-                        &pb->header_.uuid);
     }
 }
 
 static void
 build_in_port_sec_ip6_flows(const struct sbrec_port_binding *pb,
-                           struct lport_addresses *ps_addr,
+                           struct lport_addresses *ps_addr, bool ip_conj,
                            struct match *m, struct ofpbuf *ofpacts,
                            struct ovn_desired_flow_table *flow_table)
 {
@@ -3195,23 +4159,25 @@ build_in_port_sec_ip6_flows(const struct sbrec_port_binding *pb,
      */
     build_port_sec_adv_nd_check(ofpacts);
 
-    for (size_t j = 0; j < ps_addr->n_ipv6_addrs; j++) {
-        reset_match_for_port_sec_flows(pb, MFF_LOG_INPORT, m);
-        match_set_dl_src(m, ps_addr->ea);
-        match_set_dl_type(m, htons(ETH_TYPE_IPV6));
+    if (!ip_conj) {
+        for (size_t j = 0; j < ps_addr->n_ipv6_addrs; j++) {
+            reset_match_for_port_sec_flows(pb, MFF_LOG_INPORT, m);
+            match_set_dl_src(m, ps_addr->ea);
+            match_set_dl_type(m, htons(ETH_TYPE_IPV6));
 
-        if (ps_addr->ipv6_addrs[j].plen == 128
-            || !ipv6_addr_is_host_zero(&ps_addr->ipv6_addrs[j].addr,
-                                        &ps_addr->ipv6_addrs[j].mask)) {
-            match_set_ipv6_src(m, &ps_addr->ipv6_addrs[j].addr);
-        } else {
-            match_set_ipv6_src_masked(m, &ps_addr->ipv6_addrs[j].network,
-                                        &ps_addr->ipv6_addrs[j].mask);
-        }
+            if (ps_addr->ipv6_addrs[j].plen == 128
+                || !ipv6_addr_is_host_zero(&ps_addr->ipv6_addrs[j].addr,
+                                            &ps_addr->ipv6_addrs[j].mask)) {
+                match_set_ipv6_src(m, &ps_addr->ipv6_addrs[j].addr);
+            } else {
+                match_set_ipv6_src_masked(m, &ps_addr->ipv6_addrs[j].network,
+                                            &ps_addr->ipv6_addrs[j].mask);
+            }
 
-        ofctrl_add_flow(flow_table, OFTABLE_CHK_IN_PORT_SEC, 90,
-                        pb->header_.uuid.parts[0], m, ofpacts,
-                        &pb->header_.uuid);
+            ofctrl_add_flow(flow_table, OFTABLE_CHK_IN_PORT_SEC, 90,
+                            pb->header_.uuid.parts[0], m, ofpacts,
+                            &pb->header_.uuid);
+        }
     }
 
     reset_match_for_port_sec_flows(pb, MFF_LOG_INPORT, m);
@@ -3400,7 +4366,7 @@ build_out_port_sec_no_ip_flows(const struct sbrec_port_binding *pb,
 
 static void
 build_out_port_sec_ip4_flows(const struct sbrec_port_binding *pb,
-                            struct lport_addresses *ps_addr,
+                            struct lport_addresses *ps_addr, bool ip_conj,
                             struct match *m, struct ofpbuf *ofpacts,
                             struct ovn_desired_flow_table *flow_table)
 {
@@ -3472,6 +4438,10 @@ build_out_port_sec_ip4_flows(const struct sbrec_port_binding *pb,
                                     mask);
         }
 
+        if (ip_conj) {
+            /* Added by build_port_sec_conj_flows(). */
+            continue;
+        }
         ofctrl_add_flow(flow_table, OFTABLE_CHK_OUT_PORT_SEC, 95,
                         pb->header_.uuid.parts[0], m, ofpacts,
                         &pb->header_.uuid);
@@ -3498,7 +4468,7 @@ build_out_port_sec_ip4_flows(const struct sbrec_port_binding *pb,
 
 static void
 build_out_port_sec_ip6_flows(const struct sbrec_port_binding *pb,
-                            struct lport_addresses *ps_addr,
+                            struct lport_addresses *ps_addr, bool ip_conj,
                             struct match *m, struct ofpbuf *ofpacts,
                             struct ovn_desired_flow_table *flow_table)
 {
@@ -3537,23 +4507,25 @@ build_out_port_sec_ip6_flows(const struct sbrec_port_binding *pb,
      * action - "port_sec_failed = 0;"
      */
     build_port_sec_allow_action(ofpacts);
-    for (size_t j = 0; j < ps_addr->n_ipv6_addrs; j++) {
-        reset_match_for_port_sec_flows(pb, MFF_LOG_OUTPORT, m);
-        match_set_dl_dst(m, ps_addr->ea);
-        match_set_dl_type(m, htons(ETH_TYPE_IPV6));
+    if (!ip_conj) {
+        for (size_t j = 0; j < ps_addr->n_ipv6_addrs; j++) {
+            reset_match_for_port_sec_flows(pb, MFF_LOG_OUTPORT, m);
+            match_set_dl_dst(m, ps_addr->ea);
+            match_set_dl_type(m, htons(ETH_TYPE_IPV6));
 
-        if (ps_addr->ipv6_addrs[j].plen == 128
-            || !ipv6_addr_is_host_zero(&ps_addr->ipv6_addrs[j].addr,
-                                        &ps_addr->ipv6_addrs[j].mask)) {
-            match_set_ipv6_dst(m, &ps_addr->ipv6_addrs[j].addr);
-        } else {
-            match_set_ipv6_dst_masked(m, &ps_addr->ipv6_addrs[j].network,
-                                      &ps_addr->ipv6_addrs[j].mask);
-        }
+            if (ps_addr->ipv6_addrs[j].plen == 128
+                || !ipv6_addr_is_host_zero(&ps_addr->ipv6_addrs[j].addr,
+                                            &ps_addr->ipv6_addrs[j].mask)) {
+                match_set_ipv6_dst(m, &ps_addr->ipv6_addrs[j].addr);
+            } else {
+                match_set_ipv6_dst_masked(m, &ps_addr->ipv6_addrs[j].network,
+                                          &ps_addr->ipv6_addrs[j].mask);
+            }
 
-        ofctrl_add_flow(flow_table, OFTABLE_CHK_OUT_PORT_SEC, 95,
-                        pb->header_.uuid.parts[0], m, ofpacts,
-                        &pb->header_.uuid);
+            ofctrl_add_flow(flow_table, OFTABLE_CHK_OUT_PORT_SEC, 95,
+                            pb->header_.uuid.parts[0], m, ofpacts,
+                            &pb->header_.uuid);
+        }
     }
 
     struct in6_addr lla;
@@ -3577,9 +4549,256 @@ build_out_port_sec_ip6_flows(const struct sbrec_port_binding *pb,
                     &pb->header_.uuid);
 }
 
+/* Returns true if port security entries 'a' and 'b' allow exactly the same
+ * IP addresses. */
+static bool
+port_sec_same_ips(const struct lport_addresses *a,
+                  const struct lport_addresses *b)
+{
+    if (a->n_ipv4_addrs != b->n_ipv4_addrs
+        || a->n_ipv6_addrs != b->n_ipv6_addrs) {
+        return false;
+    }
+
+    for (size_t i = 0; i < a->n_ipv4_addrs; i++) {
+        if (a->ipv4_addrs[i].addr != b->ipv4_addrs[i].addr
+            || a->ipv4_addrs[i].plen != b->ipv4_addrs[i].plen) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < a->n_ipv6_addrs; i++) {
+        if (!ipv6_addr_equals(&a->ipv6_addrs[i].addr,
+                              &b->ipv6_addrs[i].addr)
+            || a->ipv6_addrs[i].plen != b->ipv6_addrs[i].plen) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Returns true if the IP checks of the 'n_macs' port security entries that
+ * allow the IPs of 'ps_addr' take fewer flows as conjunctive matches, i.e.
+ * one flow per MAC, one per IP and the conjunction flow, than with one flow
+ * per MAC and IP pair. */
+static bool
+port_sec_use_conj(const struct lport_addresses *ps_addr, size_t n_macs)
+{
+    size_t n_ips = ps_addr->n_ipv4_addrs + ps_addr->n_ipv6_addrs;
+    return n_macs > 1 && n_macs * n_ips > n_macs + n_ips + 1;
+}
+
+/* Number of conjunction ids used by build_port_sec_conj_flows() for each
+ * group of port security entries. */
+#define PORT_SEC_N_CONJS 5
+
 static void
-consider_port_sec_flows(const struct sbrec_port_binding *pb,
+match_set_port_sec_ip4(struct match *m, const struct ipv4_netaddr *ip4,
+                       bool src)
+{
+    /* Same as the per MAC flows: If the host portion is non-zero, only the
+     * specified address is allowed, otherwise the whole subnet is. */
+    ovs_be32 mask = ip4->plen == 32 || ip4->addr & ~ip4->mask
+                    ? OVS_BE32_MAX : ip4->mask;
+    if (src) {
+        match_set_nw_src_masked(m, ip4->addr, mask);
+    } else {
+        match_set_nw_dst_masked(m, ip4->addr, mask);
+    }
+}
+
+static void
+match_set_port_sec_ip6(struct match *m, const struct ipv6_netaddr *ip6,
+                       bool src)
+{
+    bool host = ip6->plen == 128
+                || !ipv6_addr_is_host_zero(&ip6->addr, &ip6->mask);
+    const struct in6_addr *addr = host ? &ip6->addr : &ip6->network;
+    const struct in6_addr *mask = host ? &in6addr_exact : &ip6->mask;
+    if (src) {
+        match_set_ipv6_src_masked(m, addr, mask);
+    } else {
+        match_set_ipv6_dst_masked(m, addr, mask);
+    }
+}
+
+/* Adds the conjunctive flows of conjunction 'id' in 'table', which match
+ * packets that match both one of the 'n_macs' matches in 'macs' and one of
+ * the 'n_ips' matches in 'ips', and the flow that applies 'ofpacts' to
+ * them. */
+static void
+add_port_sec_conj_flows(const struct sbrec_port_binding *pb, uint8_t table,
+                        uint16_t priority, uint32_t id,
+                        const struct match *macs, size_t n_macs,
+                        const struct match *ips, size_t n_ips,
+                        const struct ofpbuf *ofpacts,
                         struct ovn_desired_flow_table *flow_table)
+{
+    uint64_t stub[64 / 8];
+    struct ofpbuf conj_acts = OFPBUF_STUB_INITIALIZER(stub);
+    struct ofpact_conjunction *conj = ofpact_put_CONJUNCTION(&conj_acts);
+    conj->id = id;
+    conj->n_clauses = 2;
+
+    /* A MAC or an IP may be shared with another group of the same port, in
+     * which case its flow gets one conjunction action per group. */
+    conj->clause = 0;
+    for (size_t i = 0; i < n_macs; i++) {
+        ofctrl_add_or_append_flow(flow_table, table, priority,
+                                  pb->header_.uuid.parts[0], &macs[i],
+                                  &conj_acts, &pb->header_.uuid,
+                                  NX_CTLR_NO_METER, NULL);
+    }
+
+    conj->clause = 1;
+    for (size_t i = 0; i < n_ips; i++) {
+        ofctrl_add_or_append_flow(flow_table, table, priority,
+                                  pb->header_.uuid.parts[0], &ips[i],
+                                  &conj_acts, &pb->header_.uuid,
+                                  NX_CTLR_NO_METER, NULL);
+    }
+    ofpbuf_uninit(&conj_acts);
+
+    struct match conj_match = MATCH_CATCHALL_INITIALIZER;
+    match_set_conj_id(&conj_match, id);
+    ofctrl_add_flow(flow_table, table, priority, pb->header_.uuid.parts[0],
+                    &conj_match, ofpacts, &pb->header_.uuid);
+}
+
+/* Adds the flows that allow the IPs of the 'n_members' port security
+ * entries of 'ps_addrs' listed in 'members', which all allow the same IPs,
+ * as conjunctive matches between their MACs and those IPs, using the
+ * conjunction ids starting at 'conj_id'.  These replace the per MAC and IP
+ * flows that build_in_port_sec_ip4_flows() and its siblings add otherwise,
+ * so that the number of flows grows with the number of MACs plus the number
+ * of IPs instead of their product.
+ *
+ * The conjunctive flows use a priority just below the one of the per MAC
+ * flows they replace, so that they never overlap with a non conjunctive
+ * flow of the same priority. */
+static void
+build_port_sec_conj_flows(const struct sbrec_port_binding *pb,
+                          const struct lport_addresses *ps_addrs,
+                          const size_t *members, size_t n_members,
+                          uint32_t conj_id, struct ofpbuf *ofpacts,
+                          struct ovn_desired_flow_table *flow_table)
+{
+    const struct lport_addresses *ips = &ps_addrs[members[0]];
+    size_t n_ips = MAX(ips->n_ipv4_addrs, ips->n_ipv6_addrs);
+    struct match *mac_matches = xmalloc(n_members * sizeof *mac_matches);
+    struct match *ip_matches = xmalloc(n_ips * sizeof *ip_matches);
+
+    if (ips->n_ipv4_addrs) {
+        /* in_port_sec: "inport == pb->port && eth.src == {MACs} &&
+         *               ip4.src == {IPs}" -> "port_sec_failed = 0;" */
+        for (size_t i = 0; i < n_members; i++) {
+            struct match *m = &mac_matches[i];
+            reset_match_for_port_sec_flows(pb, MFF_LOG_INPORT, m);
+            match_set_dl_src(m, ps_addrs[members[i]].ea);
+            match_set_dl_type(m, htons(ETH_TYPE_IP));
+        }
+        for (size_t i = 0; i < ips->n_ipv4_addrs; i++) {
+            struct match *m = &ip_matches[i];
+            reset_match_for_port_sec_flows(pb, MFF_LOG_INPORT, m);
+            match_set_dl_type(m, htons(ETH_TYPE_IP));
+            match_set_port_sec_ip4(m, &ips->ipv4_addrs[i], true);
+        }
+        build_port_sec_allow_action(ofpacts);
+        add_port_sec_conj_flows(pb, OFTABLE_CHK_IN_PORT_SEC, 89, conj_id,
+                                mac_matches, n_members,
+                                ip_matches, ips->n_ipv4_addrs,
+                                ofpacts, flow_table);
+
+        /* in_port_sec_nd: "inport == pb->port && eth.src == {MACs} && arp &&
+         *                  arp.sha == eth.src && arp.spa == {IPs}"
+         *                  -> "port_sec_failed = 0;" */
+        for (size_t i = 0; i < n_members; i++) {
+            struct match *m = &mac_matches[i];
+            reset_match_for_port_sec_flows(pb, MFF_LOG_INPORT, m);
+            match_set_dl_src(m, ps_addrs[members[i]].ea);
+            match_set_dl_type(m, htons(ETH_TYPE_ARP));
+            match_set_arp_sha(m, ps_addrs[members[i]].ea);
+        }
+        for (size_t i = 0; i < ips->n_ipv4_addrs; i++) {
+            struct match *m = &ip_matches[i];
+            reset_match_for_port_sec_flows(pb, MFF_LOG_INPORT, m);
+            match_set_dl_type(m, htons(ETH_TYPE_ARP));
+            match_set_port_sec_ip4(m, &ips->ipv4_addrs[i], true);
+        }
+        add_port_sec_conj_flows(pb, OFTABLE_CHK_IN_PORT_SEC_ND, 89,
+                                conj_id + 1, mac_matches, n_members,
+                                ip_matches, ips->n_ipv4_addrs,
+                                ofpacts, flow_table);
+
+        /* out_port_sec: "outport == pb->port && eth.dst == {MACs} &&
+         *                ip4.dst == {IPs}" -> "port_sec_failed = 0;" */
+        for (size_t i = 0; i < n_members; i++) {
+            struct match *m = &mac_matches[i];
+            reset_match_for_port_sec_flows(pb, MFF_LOG_OUTPORT, m);
+            match_set_dl_dst(m, ps_addrs[members[i]].ea);
+            match_set_dl_type(m, htons(ETH_TYPE_IP));
+        }
+        for (size_t i = 0; i < ips->n_ipv4_addrs; i++) {
+            struct match *m = &ip_matches[i];
+            reset_match_for_port_sec_flows(pb, MFF_LOG_OUTPORT, m);
+            match_set_dl_type(m, htons(ETH_TYPE_IP));
+            match_set_port_sec_ip4(m, &ips->ipv4_addrs[i], false);
+        }
+        add_port_sec_conj_flows(pb, OFTABLE_CHK_OUT_PORT_SEC, 94,
+                                conj_id + 2, mac_matches, n_members,
+                                ip_matches, ips->n_ipv4_addrs,
+                                ofpacts, flow_table);
+    }
+
+    if (ips->n_ipv6_addrs) {
+        /* in_port_sec: "inport == pb->port && eth.src == {MACs} &&
+         *               ip6.src == {IPs}" -> "next;" (ND check) */
+        for (size_t i = 0; i < n_members; i++) {
+            struct match *m = &mac_matches[i];
+            reset_match_for_port_sec_flows(pb, MFF_LOG_INPORT, m);
+            match_set_dl_src(m, ps_addrs[members[i]].ea);
+            match_set_dl_type(m, htons(ETH_TYPE_IPV6));
+        }
+        for (size_t i = 0; i < ips->n_ipv6_addrs; i++) {
+            struct match *m = &ip_matches[i];
+            reset_match_for_port_sec_flows(pb, MFF_LOG_INPORT, m);
+            match_set_dl_type(m, htons(ETH_TYPE_IPV6));
+            match_set_port_sec_ip6(m, &ips->ipv6_addrs[i], true);
+        }
+        build_port_sec_adv_nd_check(ofpacts);
+        add_port_sec_conj_flows(pb, OFTABLE_CHK_IN_PORT_SEC, 89,
+                                conj_id + 3, mac_matches, n_members,
+                                ip_matches, ips->n_ipv6_addrs,
+                                ofpacts, flow_table);
+
+        /* out_port_sec: "outport == pb->port && eth.dst == {MACs} &&
+         *                ip6.dst == {IPs}" -> "port_sec_failed = 0;" */
+        for (size_t i = 0; i < n_members; i++) {
+            struct match *m = &mac_matches[i];
+            reset_match_for_port_sec_flows(pb, MFF_LOG_OUTPORT, m);
+            match_set_dl_dst(m, ps_addrs[members[i]].ea);
+            match_set_dl_type(m, htons(ETH_TYPE_IPV6));
+        }
+        for (size_t i = 0; i < ips->n_ipv6_addrs; i++) {
+            struct match *m = &ip_matches[i];
+            reset_match_for_port_sec_flows(pb, MFF_LOG_OUTPORT, m);
+            match_set_dl_type(m, htons(ETH_TYPE_IPV6));
+            match_set_port_sec_ip6(m, &ips->ipv6_addrs[i], false);
+        }
+        build_port_sec_allow_action(ofpacts);
+        add_port_sec_conj_flows(pb, OFTABLE_CHK_OUT_PORT_SEC, 94,
+                                conj_id + 4, mac_matches, n_members,
+                                ip_matches, ips->n_ipv6_addrs,
+                                ofpacts, flow_table);
+    }
+
+    free(mac_matches);
+    free(ip_matches);
+}
+
+static void
+consider_port_sec_flows(const struct sbrec_port_binding *pb,
+                        struct ovn_desired_flow_table *flow_table,
+                        struct conj_ids *conj_ids)
 {
     if (!pb->n_port_security) {
         return;
@@ -3611,17 +4830,78 @@ consider_port_sec_flows(const struct sbrec_port_binding *pb,
     uint64_t stub[1024 / 8];
     struct ofpbuf ofpacts = OFPBUF_STUB_INITIALIZER(stub);
 
+    /* Group the entries that allow the same IPs, e.g. the MACs of a VRRP
+     * instance.  'members' lists the entries group by group, the entries of
+     * group 'g' being members[group_ofs[g]] to members[group_ofs[g + 1] - 1].
+     */
+    size_t *members = xmalloc(n_ps_addrs * sizeof *members);
+    size_t *group_ofs = xmalloc((n_ps_addrs + 1) * sizeof *group_ofs);
+    bool *grouped = xcalloc(n_ps_addrs, sizeof *grouped);
+    size_t n_members = 0;
+    size_t n_groups = 0;
+    size_t n_conj_groups = 0;
+
+    for (size_t i = 0; i < n_ps_addrs; i++) {
+        if (grouped[i]) {
+            continue;
+        }
+
+        group_ofs[n_groups++] = n_members;
+        for (size_t j = i; j < n_ps_addrs; j++) {
+            if (!grouped[j] && port_sec_same_ips(&ps_addrs[i],
+                                                 &ps_addrs[j])) {
+                grouped[j] = true;
+                members[n_members++] = j;
+            }
+        }
+        if (port_sec_use_conj(&ps_addrs[i],
+                              n_members - group_ofs[n_groups - 1])) {
+            n_conj_groups++;
+        }
+    }
+    group_ofs[n_groups] = n_members;
+
+    uint32_t start_conj_id = 0;
+    if (n_conj_groups) {
+        start_conj_id = lflow_conj_ids_alloc(conj_ids, &pb->header_.uuid,
+                                             &pb->datapath->header_.uuid,
+                                             n_conj_groups *
+                                             PORT_SEC_N_CONJS);
+        if (!start_conj_id) {
+            /* Fall back to the per MAC and IP flows. */
+            VLOG_ERR("32-bit conjunction ids exhausted!");
+        }
+    }
+
+    /* 'ip_conj[i]' is true if the IP checks of entry 'i' are done by the
+     * conjunctive flows of its group. */
+    bool *ip_conj = xcalloc(n_ps_addrs, sizeof *ip_conj);
+    uint32_t id = start_conj_id;
+    for (size_t g = 0; start_conj_id && g < n_groups; g++) {
+        const size_t *group = &members[group_ofs[g]];
+        size_t n = group_ofs[g + 1] - group_ofs[g];
+
+        if (port_sec_use_conj(&ps_addrs[group[0]], n)) {
+            build_port_sec_conj_flows(pb, ps_addrs, group, n, id,
+                                      &ofpacts, flow_table);
+            id += PORT_SEC_N_CONJS;
+            for (size_t j = 0; j < n; j++) {
+                ip_conj[group[j]] = true;
+            }
+        }
+    }
+
     build_in_port_sec_default_flows(pb, &match, &ofpacts, flow_table);
 
     for (size_t i = 0; i < n_ps_addrs; i++) {
         build_in_port_sec_no_ip_flows(pb, &ps_addrs[i], &match, &ofpacts,
                                       flow_table);
-        build_in_port_sec_ip4_flows(pb, &ps_addrs[i], &match, &ofpacts,
-                                    flow_table);
-        build_in_port_sec_arp_flows(pb, &ps_addrs[i], &match, &ofpacts,
-                                    flow_table);
-        build_in_port_sec_ip6_flows(pb, &ps_addrs[i], &match, &ofpacts,
-                                    flow_table);
+        build_in_port_sec_ip4_flows(pb, &ps_addrs[i], ip_conj[i], &match,
+                                    &ofpacts, flow_table);
+        build_in_port_sec_arp_flows(pb, &ps_addrs[i], ip_conj[i], &match,
+                                    &ofpacts, flow_table);
+        build_in_port_sec_ip6_flows(pb, &ps_addrs[i], ip_conj[i], &match,
+                                    &ofpacts, flow_table);
         build_in_port_sec_nd_flows(pb, &ps_addrs[i], &match, &ofpacts,
                                    flow_table);
     }
@@ -3644,13 +4924,17 @@ consider_port_sec_flows(const struct sbrec_port_binding *pb,
     for (size_t i = 0; i < n_ps_addrs; i++) {
         build_out_port_sec_no_ip_flows(pb, &ps_addrs[i], &match, &ofpacts,
                                        flow_table);
-        build_out_port_sec_ip4_flows(pb, &ps_addrs[i], &match, &ofpacts,
-                                       flow_table);
-        build_out_port_sec_ip6_flows(pb, &ps_addrs[i], &match, &ofpacts,
-                                       flow_table);
+        build_out_port_sec_ip4_flows(pb, &ps_addrs[i], ip_conj[i], &match,
+                                     &ofpacts, flow_table);
+        build_out_port_sec_ip6_flows(pb, &ps_addrs[i], ip_conj[i], &match,
+                                     &ofpacts, flow_table);
     }
 
     ofpbuf_uninit(&ofpacts);
+    free(members);
+    free(group_ofs);
+    free(grouped);
+    free(ip_conj);
     for (size_t i = 0; i < n_ps_addrs; i++) {
         destroy_lport_addresses(&ps_addrs[i]);
     }
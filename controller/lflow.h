@@ -45,6 +45,7 @@ struct ovsdb_idl_index;
 struct ovn_desired_flow_table;
 struct hmap;
 struct hmap_node;
+struct related_lports;
 struct sbrec_chassis;
 struct sbrec_dhcp_options_table;
 struct sbrec_dhcpv6_options_table;
@@ -84,49 +85,76 @@ enum ref_type {
     REF_TYPE_ADDRSET,
     REF_TYPE_PORTGROUP,
     REF_TYPE_PORTBINDING,
-    REF_TYPE_MC_GROUP
+    REF_TYPE_MC_GROUP,
+    REF_TYPE_DP_PORTS       /* The VIF ports of a datapath, by tunnel key, for
+                             * the port template lflows. */
 };
 
+/* A logical flow referencing a resource, in ref_lflow_node.lflows. */
+struct ref_lflow_entry {
+    struct lflow_ref_node *lfrn;
+    uint32_t idx;       /* Index of the pair in 'lfrn->refs'. */
+    uint32_t ref_count; /* Reference count of the resource by this lflow.
+                           Currently used for the resource type
+                           REF_TYPE_ADDRSET only, and for other types it is
+                           always 0. */
+};
+
+/* A resource referenced by a logical flow, in lflow_ref_node.refs. */
+struct lflow_ref_entry {
+    uint32_t res_id;    /* Index in lflow_resource_ref.resources. */
+    uint32_t idx;       /* Index of the pair in the resource's 'lflows'. */
+};
+
+/* A named resource referenced by logical flows.  Resources are interned to
+ * a small integer 'id', by which the logical flows refer to them. */
 struct ref_lflow_node {
     struct hmap_node node; /* node in lflow_resource_ref.ref_lflow_table. */
     enum ref_type type; /* key */
     char *ref_name; /* key */
-    struct hmap lflow_uuids; /* Contains lflow_ref_list_node. Use hmap instead
-                                of list so that lflow_resource_add() can check
-                                and avoid adding redundant entires in O(1). */
+    uint32_t id;
+
+    /* The logical flows referencing the resource, in no particular order. */
+    struct ref_lflow_entry *lflows;
+    size_t n_lflows;
+    size_t allocated_lflows;
 };
 
 struct lflow_ref_node {
     struct hmap_node node; /* node in lflow_resource_ref.lflow_ref_table. */
     struct uuid lflow_uuid; /* key */
-    struct ovs_list lflow_ref_head; /* Contains lflow_ref_list_node. */
-};
 
-/* Maintains the relationship for a pair of named resource and
- * a lflow, indexed by both ref_lflow_table and lflow_ref_table. */
-struct lflow_ref_list_node {
-    struct ovs_list list_node; /* node in lflow_ref_node.lflow_ref_head. */
-    struct hmap_node hmap_node; /* node in ref_lflow_node.lflow_uuids. */
-    struct uuid lflow_uuid;
-    size_t ref_count; /* Reference count of the resource by this lflow.
-                         Currently used for the resource type REF_TYPE_ADDRSET
-                         only, and for other types it is always 0. */
-    struct ref_lflow_node *rlfn;
+    /* The resources referenced by the logical flow, in no particular
+     * order. */
+    struct lflow_ref_entry *refs;
+    size_t n_refs;
+    size_t allocated_refs;
 };
 
+/* Maintains the relationship between named resources and the lflows
+ * referencing them.  Each pair is stored once in the adjacency array of the
+ * resource and once in the one of the lflow, each entry holding the index
+ * of its counterpart so that a pair is removed in constant time. */
 struct lflow_resource_ref {
     /* A map from a referenced resource type & name (e.g. address_set AS1)
-     * to a list of lflows that are referencing the named resource. Data
-     * type of each node in this hmap is struct ref_lflow_node. The
-     * ref_lflow_head in each node points to a list of
-     * lflow_ref_list_node.ref_list. */
+     * to the lflows that are referencing the named resource. Data
+     * type of each node in this hmap is struct ref_lflow_node. */
     struct hmap ref_lflow_table;
 
-    /* A map from a lflow uuid to a list of named resources that are
-     * referenced by the lflow. Data type of each node in this hmap is
-     * struct lflow_ref_node. The lflow_ref_head in each node points to
-     * a list of lflow_ref_list_node.lflow_list. */
+    /* A map from a lflow uuid to the named resources that are referenced
+     * by the lflow. Data type of each node in this hmap is
+     * struct lflow_ref_node. */
     struct hmap lflow_ref_table;
+
+    /* The resources of 'ref_lflow_table' indexed by their id.  The ids of
+     * the resources no longer referenced are NULL and kept in 'free_ids'
+     * for reuse. */
+    struct ref_lflow_node **resources;
+    size_t n_resources;
+    size_t allocated_resources;
+    uint32_t *free_ids;
+    size_t n_free_ids;
+    size_t allocated_free_ids;
 };
 
 void lflow_resource_init(struct lflow_resource_ref *);
@@ -138,6 +166,7 @@ struct lflow_ctx_in {
     struct ovsdb_idl_index *sbrec_logical_flow_by_logical_datapath;
     struct ovsdb_idl_index *sbrec_logical_flow_by_logical_dp_group;
     struct ovsdb_idl_index *sbrec_port_binding_by_name;
+    struct ovsdb_idl_index *sbrec_port_binding_by_datapath;
     struct ovsdb_idl_index *sbrec_fdb_by_dp_key;
     struct ovsdb_idl_index *sbrec_mac_binding_by_datapath;
     struct ovsdb_idl_index *sbrec_static_mac_binding_by_datapath;
@@ -145,24 +174,30 @@ struct lflow_ctx_in {
     const struct sbrec_dhcp_options_table *dhcp_options_table;
     const struct sbrec_dhcpv6_options_table *dhcpv6_options_table;
     const struct sbrec_datapath_binding_table *dp_binding_table;
-    const struct sbrec_mac_binding_table *mac_binding_table;
     const struct sbrec_logical_flow_table *logical_flow_table;
     const struct sbrec_logical_dp_group_table *logical_dp_group_table;
     const struct sbrec_multicast_group_table *mc_group_table;
     const struct sbrec_fdb_table *fdb_table;
     const struct sbrec_chassis *chassis;
     const struct sbrec_load_balancer_table *lb_table;
-    const struct sbrec_static_mac_binding_table *static_mac_binding_table;
     const struct hmap *local_datapaths;
     const struct shash *addr_sets;
     const struct shash *port_groups;
     const struct sset *active_tunnels;
-    const struct sset *related_lport_ids;
+    const struct sset *resident_lports;
+    const struct related_lports *related_lports;
     const struct shash *binding_lports;
     const struct hmap *chassis_tunnels;
     bool check_ct_label_for_lb_hairpin;
 };
 
+/* Progress of a lflow_run() that returned before processing all the logical
+ * flows. */
+struct lflow_run_progress {
+    bool in_progress;
+    struct uuid next_lflow;     /* First logical flow left to process. */
+};
+
 struct lflow_ctx_out {
     struct ovn_desired_flow_table *flow_table;
     struct ovn_extend_table *group_table;
@@ -173,6 +208,8 @@ struct lflow_ctx_out {
     struct hmap *lflows_processed;
     struct simap *hairpin_lb_ids;
     struct id_pool *hairpin_id_pool;
+    struct hmap *hairpin_lbs;
+    struct lflow_run_progress *run_progress;
 };
 
 struct lflow_processed_node {
@@ -182,7 +219,9 @@ struct lflow_processed_node {
 void lflows_processed_destroy(struct hmap *lflows_processed);
 
 void lflow_init(void);
-void lflow_run(struct lflow_ctx_in *, struct lflow_ctx_out *);
+void lflow_set_n_threads(size_t n_threads);
+void lflow_set_run_slice(unsigned int msec);
+bool lflow_run(struct lflow_ctx_in *, struct lflow_ctx_out *);
 void lflow_handle_cached_flows(struct lflow_cache *,
                                const struct sbrec_logical_flow_table *);
 bool lflow_handle_changed_flows(struct lflow_ctx_in *, struct lflow_ctx_out *);
@@ -210,6 +249,7 @@ void lflow_handle_changed_static_mac_bindings(
     const struct hmap *local_datapaths,
     struct ovn_desired_flow_table *);
 bool lflow_handle_changed_lbs(struct lflow_ctx_in *, struct lflow_ctx_out *);
+void lflow_hairpin_lbs_clear(struct hmap *hairpin_lbs);
 bool lflow_handle_changed_fdbs(struct lflow_ctx_in *, struct lflow_ctx_out *);
 void lflow_destroy(void);
 
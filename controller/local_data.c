@@ -19,6 +19,7 @@
 #include "include/openvswitch/json.h"
 #include "lib/hmapx.h"
 #include "lib/flow.h"
+#include "lib/sset.h"
 #include "lib/util.h"
 #include "lib/vswitch-idl.h"
 #include "openvswitch/vlog.h"
@@ -34,6 +35,22 @@
 
 VLOG_DEFINE_THIS_MODULE(ldata);
 
+/* Whether the datapaths that are only reachable over patch ports are lazy.
+ * Read from external_ids:ovn-lazy-peer-datapaths. */
+static bool lazy_peer_datapaths = false;
+
+/* The lazy datapaths that were activated by a packet, by tunnel key.  They
+ * are not lazy anymore when the local datapaths are computed again. */
+struct activated_datapath {
+    struct hmap_node hmap_node;   /* In 'activated_datapaths'. */
+    uint32_t tunnel_key;
+};
+
+static struct hmap activated_datapaths =
+    HMAP_INITIALIZER(&activated_datapaths);
+
+static bool local_datapath_is_activated(uint32_t tunnel_key);
+
 static void add_local_datapath__(
     struct ovsdb_idl_index *sbrec_datapath_binding_by_key,
     struct ovsdb_idl_index *sbrec_port_binding_by_datapath,
@@ -168,6 +185,53 @@ add_local_datapath(struct ovsdb_idl_index *sbrec_datapath_binding_by_key,
                          tracked_datapaths);
 }
 
+/* Sets whether the datapaths that are only reachable over patch ports are
+ * lazy.  Returns true if the setting changed, in which case the local
+ * datapaths must be computed again. */
+bool
+local_datapaths_set_lazy(bool lazy)
+{
+    if (lazy == lazy_peer_datapaths) {
+        return false;
+    }
+    lazy_peer_datapaths = lazy;
+
+    struct activated_datapath *ad;
+    HMAP_FOR_EACH_POP (ad, hmap_node, &activated_datapaths) {
+        free(ad);
+    }
+    return true;
+}
+
+/* Marks the datapath with 'tunnel_key' as activated, because a packet
+ * entered it.  Returns true if it was not activated yet, in which case the
+ * local datapaths must be computed again to compile its logical flows. */
+bool
+local_datapath_activate(uint32_t tunnel_key)
+{
+    if (!lazy_peer_datapaths || local_datapath_is_activated(tunnel_key)) {
+        return false;
+    }
+
+    struct activated_datapath *ad = xmalloc(sizeof *ad);
+    ad->tunnel_key = tunnel_key;
+    hmap_insert(&activated_datapaths, &ad->hmap_node, tunnel_key);
+    return true;
+}
+
+static bool
+local_datapath_is_activated(uint32_t tunnel_key)
+{
+    const struct activated_datapath *ad;
+    HMAP_FOR_EACH_WITH_HASH (ad, hmap_node, tunnel_key,
+                             &activated_datapaths) {
+        if (ad->tunnel_key == tunnel_key) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void
 add_local_datapath_peer_port(
     const struct sbrec_port_binding *pb,
@@ -472,6 +536,68 @@ get_chassis_tunnel_ofport(const struct hmap *chassis_tunnels,
 }
 
 
+static bool
+chassis_tunnels_contain(const struct hmap *chassis_tunnels,
+                        const struct chassis_tunnel *target)
+{
+    const struct chassis_tunnel *tun;
+    HMAP_FOR_EACH_WITH_HASH (tun, hmap_node, target->hmap_node.hash,
+                             chassis_tunnels) {
+        if (!strcmp(tun->chassis_id, target->chassis_id)
+            && tun->ofport == target->ofport && tun->type == target->type) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void
+chassis_tunnels_diff__(const struct hmap *a, const struct hmap *b,
+                       struct sset *chassis_names)
+{
+    const struct chassis_tunnel *tun;
+    HMAP_FOR_EACH (tun, hmap_node, a) {
+        char *chassis_name;
+        if (!chassis_tunnels_contain(b, tun)
+            && encaps_tunnel_id_parse(tun->chassis_id, &chassis_name, NULL)) {
+            sset_add_and_free(chassis_names, chassis_name);
+        }
+    }
+}
+
+/* Adds to 'chassis_names' the names of the chassis whose tunnels differ
+ * between 'old_tunnels' and 'new_tunnels', i.e. the chassis to which a tunnel
+ * was added or removed, or whose tunnel OpenFlow port or type changed. */
+void
+chassis_tunnels_get_changes(const struct hmap *old_tunnels,
+                            const struct hmap *new_tunnels,
+                            struct sset *chassis_names)
+{
+    chassis_tunnels_diff__(old_tunnels, new_tunnels, chassis_names);
+    chassis_tunnels_diff__(new_tunnels, old_tunnels, chassis_names);
+}
+
+/* Adds to 'lport_names' the names of the localnet and l2gateway ports whose
+ * OVS patch port differs between 'old_patch_ofports' and
+ * 'new_patch_ofports', i.e. was added, removed or got a new OpenFlow port. */
+void
+patch_ofports_get_changes(const struct simap *old_patch_ofports,
+                          const struct simap *new_patch_ofports,
+                          struct sset *lport_names)
+{
+    const struct simap_node *node;
+    SIMAP_FOR_EACH (node, old_patch_ofports) {
+        if (simap_get(new_patch_ofports, node->name) != node->data) {
+            sset_add(lport_names, node->name);
+        }
+    }
+    SIMAP_FOR_EACH (node, new_patch_ofports) {
+        if (!simap_contains(old_patch_ofports, node->name)) {
+            sset_add(lport_names, node->name);
+        }
+    }
+}
+
 void
 chassis_tunnels_destroy(struct hmap *chassis_tunnels)
 {
@@ -525,12 +651,23 @@ add_local_datapath__(struct ovsdb_idl_index *sbrec_datapath_binding_by_key,
     uint32_t dp_key = dp->tunnel_key;
     struct local_datapath *ld = get_local_datapath(local_datapaths, dp_key);
     if (ld) {
+        if (ld->lazy && !depth) {
+            /* A local port needs the datapath now, report it as new so that
+             * its logical flows get compiled. */
+            ld->lazy = false;
+            if (tracked_datapaths) {
+                tracked_datapath_add(ld->datapath, TRACKED_RESOURCE_NEW,
+                                     tracked_datapaths);
+            }
+        }
         return;
     }
 
     ld = local_datapath_alloc(dp);
     hmap_insert(local_datapaths, &ld->hmap_node, dp_key);
     ld->datapath = dp;
+    ld->lazy = (depth && lazy_peer_datapaths
+                && !local_datapath_is_activated(dp_key));
 
     if (tracked_datapaths) {
         tracked_datapath_add(ld->datapath, TRACKED_RESOURCE_NEW,
@@ -30,6 +30,7 @@ struct sbrec_chassis;
 struct ovsdb_idl_index;
 struct ovsrec_bridge;
 struct ovsrec_interface_table;
+struct sset;
 
 /* A logical datapath that has some relevance to this hypervisor.  A logical
  * datapath D is relevant to hypervisor H if:
@@ -46,6 +47,12 @@ struct local_datapath {
     bool is_switch;
     bool is_transit_switch;
 
+    /* If external_ids:ovn-lazy-peer-datapaths is set, a datapath that is only
+     * reachable over patch ports is lazy: its logical flows are not compiled
+     * until a local port is bound to it or a packet enters it, see
+     * local_datapath_activate(). */
+    bool lazy;
+
     /* The localnet port in this datapath, if any (at most one is allowed). */
     const struct sbrec_port_binding *localnet_port;
 
@@ -79,6 +86,8 @@ void add_local_datapath(
     struct hmap *tracked_datapaths);
 
 void local_datapaths_destroy(struct hmap *local_datapaths);
+bool local_datapaths_set_lazy(bool lazy);
+bool local_datapath_activate(uint32_t tunnel_key);
 void local_datapath_destroy(struct local_datapath *ld);
 void add_local_datapath_peer_port(
     const struct sbrec_port_binding *,
@@ -133,6 +142,12 @@ struct chassis_tunnel {
     enum chassis_tunnel_type type;
 };
 
+void chassis_tunnels_get_changes(const struct hmap *old_tunnels,
+                                 const struct hmap *new_tunnels,
+                                 struct sset *chassis_names);
+void patch_ofports_get_changes(const struct simap *old_patch_ofports,
+                               const struct simap *new_patch_ofports,
+                               struct sset *lport_names);
 void local_nonvif_data_run(const struct ovsrec_bridge *br_int,
                            const struct sbrec_chassis *,
                            struct simap *patch_ofports,
@@ -80,12 +80,23 @@ lport_is_chassis_resident(struct ovsdb_idl_index *sbrec_port_binding_by_name,
     if (!pb || !pb->chassis) {
         return false;
     }
+    return lport_pb_is_chassis_resident(pb, chassis, active_tunnels);
+}
+
+/* Returns true if 'pb' is resident on 'chassis', i.e. if it is bound to it
+ * or, for a chassisredirect port, if 'chassis' is the active chassis of its
+ * HA chassis group. */
+bool
+lport_pb_is_chassis_resident(const struct sbrec_port_binding *pb,
+                             const struct sbrec_chassis *chassis,
+                             const struct sset *active_tunnels)
+{
     if (strcmp(pb->type, "chassisredirect")) {
-        return pb->chassis == chassis;
-    } else {
-        return ha_chassis_group_is_active(pb->ha_chassis_group,
-                                          active_tunnels, chassis);
+        return pb->chassis && pb->chassis == chassis;
     }
+    return (ha_chassis_group_contains(pb->ha_chassis_group, chassis)
+            && ha_chassis_group_is_active(pb->ha_chassis_group,
+                                          active_tunnels, chassis));
 }
 
 const struct sbrec_port_binding *
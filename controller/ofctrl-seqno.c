@@ -15,9 +15,15 @@
 
 #include <config.h>
 
+#include <stdlib.h>
+
 #include "hash.h"
 #include "ofctrl-seqno.h"
+#include "openvswitch/dynamic-string.h"
+#include "openvswitch/json.h"
 #include "openvswitch/list.h"
+#include "openvswitch/shash.h"
+#include "timeval.h"
 #include "util.h"
 
 /* A sequence number update request, i.e., when the barrier corresponding to
@@ -34,6 +40,7 @@ struct ofctrl_seqno_update {
                                 * application.
                                 */
     uint64_t req_cfg;          /* Application specific seqno. */
+    long long int create_time; /* time_msec() at creation. */
 };
 
 /* List of in flight sequence number updates. */
@@ -49,12 +56,29 @@ struct ofctrl_seqno_state {
                                  */
     uint64_t cur_cfg;           /* Last acked application seqno. */
     uint64_t req_cfg;           /* Last requested application seqno. */
+    struct ofctrl_latency *latency; /* Time from request to ack. */
 };
 
 /* Per application seqno type states. */
 static size_t n_ofctrl_seqno_states;
 static struct ofctrl_seqno_state *ofctrl_seqno_states;
 
+/* Number of most recent samples kept, per latency, to compute the
+ * percentiles. */
+#define OFCTRL_LATENCY_N_SAMPLES 1024
+
+struct ofctrl_latency {
+    char *name;
+    uint64_t n_samples;         /* Number of samples ever recorded. */
+    long long int max_msec;     /* Maximum of all the samples. */
+    long long int samples[OFCTRL_LATENCY_N_SAMPLES]; /* Ring buffer of the
+                                                      * most recent samples.
+                                                      */
+};
+
+/* All the latencies, by name. */
+static struct shash ofctrl_latencies = SHASH_INITIALIZER(&ofctrl_latencies);
+
 /* ofctrl_acked_seqnos related static function prototypes. */
 static void ofctrl_acked_seqnos_init(struct ofctrl_acked_seqnos *seqnos,
                                      uint64_t last_acked);
@@ -124,9 +148,10 @@ ofctrl_seqno_init(void)
     ovs_list_init(&ofctrl_seqno_updates);
 }
 
-/* Adds a new type of application specific seqno updates. */
+/* Adds a new type of application specific seqno updates.  The latency of
+ * its updates is recorded under 'name'. */
 size_t
-ofctrl_seqno_add_type(void)
+ofctrl_seqno_add_type(const char *name)
 {
     size_t new_type = n_ofctrl_seqno_states;
     n_ofctrl_seqno_states++;
@@ -137,8 +162,10 @@ ofctrl_seqno_add_type(void)
     for (size_t i = 0; i < n_ofctrl_seqno_states - 1; i++) {
         ovs_list_move(&new_states[i].acked_cfgs,
                       &ofctrl_seqno_states[i].acked_cfgs);
+        new_states[i].latency = ofctrl_seqno_states[i].latency;
     }
     ovs_list_init(&new_states[new_type].acked_cfgs);
+    new_states[new_type].latency = ofctrl_latency_get(name);
 
     free(ofctrl_seqno_states);
     ofctrl_seqno_states = new_states;
@@ -232,6 +259,7 @@ ofctrl_seqno_update_create__(size_t seqno_type, uint64_t req_cfg)
     update->seqno_type = seqno_type;
     update->flow_cfg = ofctrl_req_seqno;
     update->req_cfg = req_cfg;
+    update->create_time = time_msec();
 }
 
 static void
@@ -248,7 +276,113 @@ static void
 ofctrl_seqno_cfg_run(size_t seqno_type, struct ofctrl_seqno_update *update)
 {
     ovs_assert(seqno_type < n_ofctrl_seqno_states);
-    ovs_list_push_back(&ofctrl_seqno_states[seqno_type].acked_cfgs,
-                       &update->list_node);
-    ofctrl_seqno_states[seqno_type].cur_cfg = update->req_cfg;
+    struct ofctrl_seqno_state *state = &ofctrl_seqno_states[seqno_type];
+
+    ovs_list_push_back(&state->acked_cfgs, &update->list_node);
+    state->cur_cfg = update->req_cfg;
+    ofctrl_latency_record(state->latency, time_msec() - update->create_time);
+}
+
+/* Returns the latency named 'name', creating it if needed. */
+struct ofctrl_latency *
+ofctrl_latency_get(const char *name)
+{
+    struct ofctrl_latency *latency = shash_find_data(&ofctrl_latencies, name);
+
+    if (!latency) {
+        latency = xzalloc(sizeof *latency);
+        latency->name = xstrdup(name);
+        shash_add(&ofctrl_latencies, name, latency);
+    }
+    return latency;
+}
+
+void
+ofctrl_latency_record(struct ofctrl_latency *latency, long long int msec)
+{
+    msec = MAX(msec, 0);
+    latency->samples[latency->n_samples % OFCTRL_LATENCY_N_SAMPLES] = msec;
+    latency->n_samples++;
+    latency->max_msec = MAX(latency->max_msec, msec);
+}
+
+/* Clears the samples of all the latencies. */
+void
+ofctrl_latency_clear(void)
+{
+    struct shash_node *node;
+
+    SHASH_FOR_EACH (node, &ofctrl_latencies) {
+        struct ofctrl_latency *latency = node->data;
+
+        latency->n_samples = 0;
+        latency->max_msec = 0;
+    }
+}
+
+static int
+compare_msec(const void *a_, const void *b_)
+{
+    const long long int *a = a_;
+    const long long int *b = b_;
+
+    return *a < *b ? -1 : *a > *b;
+}
+
+static const unsigned int ofctrl_latency_percentiles[] = { 50, 90, 99 };
+
+/* Appends to 'ds' a summary of all the latencies, in plain text or, if
+ * 'as_json' is true, as a JSON object indexed by latency name.  The
+ * percentiles are computed over the most recent samples. */
+void
+ofctrl_latency_format(struct ds *ds, bool as_json)
+{
+    const struct shash_node **nodes = shash_sort(&ofctrl_latencies);
+    struct json *json = as_json ? json_object_create() : NULL;
+
+    for (size_t i = 0; i < shash_count(&ofctrl_latencies); i++) {
+        const struct ofctrl_latency *latency = nodes[i]->data;
+        size_t n = MIN(latency->n_samples, OFCTRL_LATENCY_N_SAMPLES);
+        long long int *sorted = xmemdup(latency->samples,
+                                        n * sizeof *sorted);
+        struct json *summary = NULL;
+
+        qsort(sorted, n, sizeof *sorted, compare_msec);
+
+        if (json) {
+            summary = json_object_create();
+            json_object_put(summary, "samples",
+                            json_integer_create(latency->n_samples));
+            json_object_put(summary, "max",
+                            json_integer_create(latency->max_msec));
+            json_object_put(json, latency->name, summary);
+        } else {
+            ds_put_format(ds, "%s: samples %"PRIu64, latency->name,
+                          latency->n_samples);
+        }
+        for (size_t j = 0; j < ARRAY_SIZE(ofctrl_latency_percentiles); j++) {
+            unsigned int pct = ofctrl_latency_percentiles[j];
+            /* Nearest-rank percentile. */
+            long long int msec = n ? sorted[(n * pct + 99) / 100 - 1] : 0;
+
+            if (summary) {
+                char *key = xasprintf("p%u", pct);
+                json_object_put(summary, key, json_integer_create(msec));
+                free(key);
+            } else {
+                ds_put_format(ds, ", p%u %lld ms", pct, msec);
+            }
+        }
+        if (!json) {
+            ds_put_format(ds, ", max %lld ms\n", latency->max_msec);
+        }
+        free(sorted);
+    }
+    free(nodes);
+
+    if (json) {
+        json_to_ds(json, JSSF_SORT, ds);
+        ds_put_char(ds, '\n');
+        json_destroy(json);
+    }
 }
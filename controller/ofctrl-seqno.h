@@ -16,10 +16,13 @@
 #ifndef OFCTRL_SEQNO_H
 #define OFCTRL_SEQNO_H 1
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include <openvswitch/hmap.h>
 
+struct ds;
+
 /* Collection of acked ofctrl_seqno_update requests and the most recent
  * 'last_acked' value.
  */
@@ -40,10 +43,21 @@ bool ofctrl_acked_seqnos_contains(const struct ofctrl_acked_seqnos *seqnos,
                                   uint32_t val);
 
 void ofctrl_seqno_init(void);
-size_t ofctrl_seqno_add_type(void);
+size_t ofctrl_seqno_add_type(const char *name);
 void ofctrl_seqno_update_create(size_t seqno_type, uint64_t new_cfg);
 void ofctrl_seqno_run(uint64_t flow_cfg);
 uint64_t ofctrl_seqno_get_req_cfg(void);
 void ofctrl_seqno_flush(void);
 
+/* Latency samples, in milliseconds, of operations that complete when their
+ * flows are installed in OVS.  Each seqno type records, under its name, the
+ * time from the creation of its update requests to their ack; other modules
+ * can record their own samples. */
+struct ofctrl_latency;
+
+struct ofctrl_latency *ofctrl_latency_get(const char *name);
+void ofctrl_latency_record(struct ofctrl_latency *, long long int msec);
+void ofctrl_latency_clear(void);
+void ofctrl_latency_format(struct ds *, bool as_json);
+
 #endif /* controller/ofctrl-seqno.h */
@@ -14,14 +14,18 @@
  */
 
 #include <config.h>
+#include <errno.h>
+#include <unistd.h>
 #include "bitmap.h"
 #include "byte-order.h"
+#include "coverage.h"
 #include "dirs.h"
 #include "dp-packet.h"
 #include "flow.h"
 #include "hash.h"
 #include "hindex.h"
 #include "lflow.h"
+#include "lflow-conj-ids.h"
 #include "ofctrl.h"
 #include "openflow/openflow.h"
 #include "openvswitch/dynamic-string.h"
@@ -43,33 +47,61 @@
 #include "ovn-controller.h"
 #include "ovn/actions.h"
 #include "lib/extend-table.h"
+#include "lib/ovn-dirs.h"
+#include "lib/ovn-usdt-probes.h"
 #include "openvswitch/poll-loop.h"
 #include "physical.h"
 #include "openvswitch/rconn.h"
 #include "socket-util.h"
+#include "sset.h"
 #include "timeval.h"
 #include "util.h"
 #include "vswitch-idl.h"
 
 VLOG_DEFINE_THIS_MODULE(ofctrl);
 
+COVERAGE_DEFINE(ofctrl_flood_remove_sb_uuids);
+COVERAGE_DEFINE(ofctrl_flood_remove_flows);
+
 /* An OpenFlow flow. */
 struct ovn_flow {
     /* Key. */
     uint8_t table_id;
     uint16_t priority;
-    struct minimatch match;
+    const struct minimatch *match;      /* Shared, see ovn_flow_match. */
 
     /* Hash. */
     uint32_t hash;
 
     /* Data. */
-    struct ofpact *ofpacts;
+    const struct ofpact *ofpacts;       /* Shared, see ovn_flow_ofpacts. */
     size_t ofpacts_len;
     uint64_t cookie;
     uint32_t ctrl_meter_id; /* Meter to be used for controller actions. */
 };
 
+/* The matches and actions of the desired and installed flows are interned:
+ * a desired flow and the installed flow it is linked to always have the same
+ * match, and the same actions are repeated over many flows, so each distinct
+ * match and each distinct list of actions is stored only once, with a
+ * reference count.  Since they are interned, two flows have the same match
+ * if and only if they point to the same one. */
+struct ovn_flow_match {
+    struct hmap_node hmap_node; /* In 'flow_matches', by minimatch_hash(). */
+    size_t refcount;
+    struct minimatch match;
+};
+
+struct ovn_flow_ofpacts {
+    struct hmap_node hmap_node; /* In 'flow_ofpacts'. */
+    size_t refcount;
+    size_t len;
+    uint64_t ofpacts[];         /* 'len' bytes of "struct ofpact"s. */
+};
+
+static struct hmap flow_matches = HMAP_INITIALIZER(&flow_matches);
+static struct hmap flow_ofpacts = HMAP_INITIALIZER(&flow_ofpacts);
+
 /* A desired flow, in struct ovn_desired_flow_table, calculated by the
  * incremental processing engine.
  * - They are added/removed incrementally when I-P engine is able to process
@@ -239,6 +271,7 @@ struct ofctrl_mem_stats {
     uint64_t sb_flow_ref_usage;
     uint64_t desired_flow_usage;
     uint64_t installed_flow_usage;
+    uint64_t flow_data_usage;   /* Interned matches and actions. */
     uint64_t oflow_update_usage;
 };
 
@@ -275,13 +308,18 @@ static size_t installed_flow_size(const struct installed_flow *);
 static struct desired_flow *installed_flow_get_active(struct installed_flow *);
 
 static uint32_t ovn_flow_match_hash(const struct ovn_flow *);
+static const struct minimatch *ovn_flow_match_intern(struct minimatch *);
+static const struct ofpact *ovn_flow_ofpacts_intern(const void *ofpacts,
+                                                    size_t len);
+static void ovn_flow_ofpacts_unref(const struct ofpact *);
 static char *ovn_flow_to_string(const struct ovn_flow *);
 static void ovn_flow_log(const struct ovn_flow *, const char *action);
 
+struct flood_remove_ctx;
 static void remove_flows_from_sb_to_flow(struct ovn_desired_flow_table *,
                                          struct sb_to_flow *,
                                          const char *log_msg,
-                                         struct hmap *flood_remove_nodes);
+                                         struct flood_remove_ctx *);
 
 /* OpenFlow connection to the switch. */
 static struct rconn *swconn;
@@ -299,6 +337,7 @@ static unsigned int seqno;
     STATE(S_TLV_TABLE_REQUESTED)                \
     STATE(S_TLV_TABLE_MOD_SENT)                 \
     STATE(S_WAIT_BEFORE_CLEAR)                  \
+    STATE(S_DUMP_FLOWS)                         \
     STATE(S_CLEAR_FLOWS)                        \
     STATE(S_UPDATE_FLOWS)
 enum ofctrl_state {
@@ -352,6 +391,54 @@ static long long int wait_before_clear_expire = 0;
 /* Transaction IDs for messages in flight to the switch. */
 static ovs_be32 xid, xid2;
 
+/* Maximum number of flow modifications in a single bundle, 0 for no limit.
+ * Read from external_ids: ovn-ofctrl-bundle-max-flows. */
+static unsigned int bundle_max_flows = 0;
+
+/* Whether the flows of the newly bound ports are sent to the switch before
+ * the other flow changes.  Read from external_ids:
+ * ovn-ofctrl-prioritize-new-ports. */
+static bool prioritize_new_ports = false;
+
+/* Maximum number of conntrack zone flushes sent to the switch at once, 0 for
+ * no limit.  When limited, the next batch is only sent once the switch
+ * completed the previous one, so that a burst of new zones does not block
+ * the switch with thousands of flushes in a row.  Read from external_ids:
+ * ovn-ofctrl-ct-flush-batch-size. */
+static unsigned int ct_flush_batch_size = 0;
+
+/* The numbers of conntrack zones waiting to be flushed and of flushes in
+ * flight, as of the last ofctrl_put(). */
+static size_t ct_flush_n_queued;
+static size_t ct_flush_n_in_flight;
+
+/* Statistics of the conntrack zone flushes.  The times are measured from the
+ * queuing of a zone to the completion of its flush. */
+struct ct_flush_stats {
+    uint64_t n_batches;     /* Batches sent. */
+    uint64_t n_flushes;     /* Flushes completed. */
+    uint64_t total_msec;    /* Sum of the times of the flushes. */
+    uint64_t max_msec;      /* Maximum time of a flush. */
+};
+
+static struct ct_flush_stats ct_flush_stats;
+
+/* The bundle used for the flow updates of ofctrl_put().  When the size of
+ * bundles is limited, the update is split into several bundles. */
+static int bundle_id = 0;
+static struct ofpbuf *bundle_open_msg;
+static unsigned int bundle_n_flows;
+static bool bundle_split;
+
+/* Messages composed by ofctrl_put() that were not sent to the switch yet.
+ * When the size of bundles is limited, the messages that follow a bundle
+ * commit are only sent after the switch replied to that commit, so that the
+ * switch handles one bundle at a time instead of being flooded with all of
+ * them. */
+static struct ovs_list pending_msgs;
+static bool bundle_commit_in_flight;
+static ovs_be32 bundle_commit_xid;
+
 /* Counter for in-flight OpenFlow messages on 'swconn'.  We only send a new
  * round of flow table modifications to the switch when the counter falls to
  * zero, to avoid unbounded buffering. */
@@ -383,6 +470,14 @@ struct meter_band_entry {
 
 static struct shash meter_bands;
 
+/* Names of the SB meters that changed since the meters were last synced by
+ * ofctrl_put(), as recorded by ofctrl_meters_track().  Only the bands of
+ * these meters are compared against the installed ones, unless
+ * 'meters_full_sync' is set, e.g. after a snapshot restored the installed
+ * bands of all the meters. */
+static struct sset meters_changed;
+static bool meters_full_sync = true;
+
 static void ofctrl_meter_bands_destroy(void);
 static void ofctrl_meter_bands_clear(void);
 
@@ -397,6 +492,42 @@ static enum mf_field_id mff_ovn_geneve;
  * (e.g. after OVS restart). */
 static bool ofctrl_initial_clear;
 
+/* Whether the installed flows, groups and meters are saved to a snapshot
+ * file on exit, so that the next ovn-controller instance can start from them
+ * instead of clearing the switch.  Read from external_ids:
+ * ovn-ofctrl-warm-start. */
+static bool warm_start = false;
+
+/* Set once the first connection to the switch went through S_CLEAR_FLOWS.
+ * A snapshot is only valid for the first connection after a restart. */
+static bool snapshot_checked = false;
+
+/* Set in S_TLV_TABLE_REQUESTED if the switch already had our Geneve option
+ * mapped, which means that it wasn't restarted since it got our flows. */
+static bool tlv_mapping_found = false;
+
+/* Whether, on a reconnection to a switch that kept our flows, the flows are
+ * dumped from the switch and reconciled with the desired ones instead of
+ * being cleared and installed again.  Read from external_ids:
+ * ovn-ofctrl-reconcile-on-reconnect. */
+static bool reconcile_on_reconnect = false;
+
+/* The flows dumped from the switch in S_DUMP_FLOWS.  They are moved to
+ * installed_lflows or installed_pflows, depending on the desired flow table
+ * they belong to, by the next ofctrl_put(), which is flagged by
+ * 'flows_dumped'. */
+static struct hmap dumped_flows;
+static bool flows_dumped;
+
+#define OFCTRL_SNAPSHOT_HEADER "ovn-ofctrl-snapshot-1"
+
+static char *ofctrl_snapshot_file_name(void);
+static bool ofctrl_snapshot_is_usable(void);
+static bool ofctrl_restore_snapshot(void);
+
+static bool ofctrl_can_reconcile(void);
+static void ofctrl_assign_dumped_flows(struct ovn_desired_flow_table *);
+
 static ovs_be32 queue_msg(struct ofpbuf *);
 
 static struct ofpbuf *encode_flow_mod(struct ofputil_flow_mod *);
@@ -405,11 +536,16 @@ static struct ofpbuf *encode_group_mod(const struct ofputil_group_mod *);
 
 static struct ofpbuf *encode_meter_mod(const struct ofputil_meter_mod *);
 
+static struct installed_flow *installed_flow_create(
+    uint8_t table_id, uint16_t priority, uint64_t cookie,
+    struct minimatch *match, const struct ofpact *ofpacts,
+    size_t ofpacts_len);
 static void ovn_installed_flow_table_clear(void);
 static void ovn_installed_flow_table_destroy(void);
 
 
 static void ofctrl_recv(const struct ofp_header *, enum ofptype);
+static void ofctrl_send_pending_msgs(void);
 
 void
 ofctrl_init(struct ovn_extend_table *group_table,
@@ -421,11 +557,14 @@ ofctrl_init(struct ovn_extend_table *group_table,
     tx_counter = rconn_packet_counter_create();
     hmap_init(&installed_lflows);
     hmap_init(&installed_pflows);
+    hmap_init(&dumped_flows);
     ovs_list_init(&flow_updates);
+    ovs_list_init(&pending_msgs);
     ovn_init_symtab(&symtab);
     groups = group_table;
     meters = meter_table;
     shash_init(&meter_bands);
+    sset_init(&meters_changed);
 }
 
 /* S_NEW, for a new connection.
@@ -439,6 +578,7 @@ run_S_NEW(void)
     struct ofpbuf *buf = ofpraw_alloc(OFPRAW_NXT_TLV_TABLE_REQUEST,
                                       rconn_get_version(swconn), 0);
     xid = queue_msg(buf);
+    tlv_mapping_found = false;
     state = S_TLV_TABLE_REQUESTED;
 }
 
@@ -495,6 +635,7 @@ process_tlv_table_reply(const struct ofputil_tlv_table_reply *reply)
                 return false;
             } else {
                 mff_ovn_geneve = MFF_TUN_METADATA0 + map->index;
+                tlv_mapping_found = true;
                 state = S_WAIT_BEFORE_CLEAR;
                 return true;
             }
@@ -624,11 +765,35 @@ error:
 /* S_WAIT_BEFORE_CLEAR, we are almost ready to set up flows, but just wait for
  * a while until the initial flow compute to complete before we clear the
  * existing flows in OVS, so that we won't end up with an empty flow table,
- * which may cause data plane down time. */
+ * which may cause data plane down time.  There is no need to wait if the
+ * flows are going to be restored from a snapshot or reconciled with the ones
+ * of the switch, because they are not cleared in these cases.
+ *
+ * Transitions to S_DUMP_FLOWS, after sending an OFPST_FLOW request, if the
+ * flows are reconciled, and to S_CLEAR_FLOWS otherwise. */
 static void
 run_S_WAIT_BEFORE_CLEAR(void)
 {
-    if (!wait_before_clear_time ||
+    if (ofctrl_can_reconcile()) {
+        VLOG_DBG("dumping all flows");
+        wait_before_clear_expire = 0;
+
+        struct ofputil_flow_stats_request fsr = {
+            .out_port = OFPP_ANY,
+            .out_group = OFPG_ANY,
+            .table_id = OFPTT_ALL,
+        };
+        match_init_catchall(&fsr.match);
+        xid = queue_msg(ofputil_encode_flow_stats_request(
+                            &fsr, OFPUTIL_P_OF15_OXM));
+
+        /* The flows are rebuilt from the dump. */
+        ovn_installed_flow_table_clear();
+        state = S_DUMP_FLOWS;
+        return;
+    }
+
+    if (!wait_before_clear_time || ofctrl_snapshot_is_usable() ||
         (wait_before_clear_expire &&
          time_msec() >= wait_before_clear_expire)) {
         wait_before_clear_expire = 0;
@@ -650,6 +815,92 @@ recv_S_WAIT_BEFORE_CLEAR(const struct ofp_header *oh, enum ofptype type,
     ofctrl_recv(oh, type);
 }
 
+/* S_DUMP_FLOWS, when an OFPST_FLOW request has been sent after a
+ * reconnection to a switch that kept our flows, groups and meters, and we're
+ * waiting for the replies.
+ *
+ * Collects the flows of the replies into 'dumped_flows' and, after the last
+ * one, transitions to S_UPDATE_FLOWS.  The groups and meters are known to be
+ * in sync with the switch, so they are kept as they are.
+ *
+ * If we receive an OFPT_ERROR or a reply that cannot be decoded, transitions
+ * to S_CLEAR_FLOWS to install all the flows again. */
+
+static void
+run_S_DUMP_FLOWS(void)
+{
+}
+
+static bool
+ofctrl_parse_dumped_flows(const struct ofp_header *oh)
+{
+    struct ofpbuf b = ofpbuf_const_initializer(oh, ntohs(oh->length));
+    uint64_t ofpacts_stub[1024 / 8];
+    struct ofpbuf ofpacts = OFPBUF_STUB_INITIALIZER(ofpacts_stub);
+    bool ok = true;
+
+    for (;;) {
+        struct ofputil_flow_stats fs;
+        int retval = ofputil_decode_flow_stats_reply(&fs, &b, false,
+                                                     &ofpacts);
+        if (retval) {
+            if (retval != EOF) {
+                VLOG_WARN("failed to decode the dumped flows (%s)",
+                          ofperr_to_string(retval));
+                ok = false;
+            }
+            break;
+        }
+
+        struct minimatch match;
+        minimatch_init(&match, &fs.match);
+        struct installed_flow *i = installed_flow_create(
+            fs.table_id, fs.priority, ntohll(fs.cookie), &match,
+            fs.ofpacts, fs.ofpacts_len);
+        if (installed_flow_lookup(&i->flow, &dumped_flows)) {
+            installed_flow_destroy(i);
+        } else {
+            hmap_insert(&dumped_flows, &i->match_hmap_node, i->flow.hash);
+        }
+    }
+    ofpbuf_uninit(&ofpacts);
+    return ok;
+}
+
+static void
+recv_S_DUMP_FLOWS(const struct ofp_header *oh, enum ofptype type,
+                  struct shash *pending_ct_zones OVS_UNUSED)
+{
+    if (oh->xid != xid) {
+        ofctrl_recv(oh, type);
+        return;
+    } else if (type == OFPTYPE_FLOW_STATS_REPLY) {
+        if (ofctrl_parse_dumped_flows(oh)) {
+            if (!ofpmp_more(oh)) {
+                VLOG_INFO("reconciling the %"PRIuSIZE" flows dumped from the "
+                          "switch", hmap_count(&dumped_flows));
+                flows_dumped = true;
+                state = S_UPDATE_FLOWS;
+
+                /* Give a chance for the main loop to call ofctrl_put(). */
+                poll_immediate_wake();
+            }
+            return;
+        }
+    } else if (type == OFPTYPE_ERROR) {
+        VLOG_WARN("switch refused to dump the flows (%s)",
+                  ofperr_to_string(ofperr_decode_msg(oh, NULL)));
+    } else {
+        char *s = ofp_to_string(oh, ntohs(oh->length), NULL, NULL, 1);
+        VLOG_WARN("unexpected reply to flow dump request (%s)", s);
+        free(s);
+    }
+
+    /* Error path. */
+    ovn_installed_flow_table_clear();
+    state = S_CLEAR_FLOWS;
+}
+
 /* S_CLEAR_FLOWS, after we've established a Geneve metadata field ID and it's
  * time to set up some flows.
  *
@@ -687,6 +938,24 @@ run_S_CLEAR_FLOWS(void)
         ovs_list_remove(&fup->list_node);
         free(fup);
     }
+    ofpbuf_list_delete(&pending_msgs);
+    bundle_commit_in_flight = false;
+
+    /* On the first connection, start from the flows, groups and meters that
+     * the previous instance installed, if the switch still has them, so that
+     * the first ofctrl_put() only sends the differences. */
+    if (!snapshot_checked) {
+        snapshot_checked = true;
+        if (ofctrl_snapshot_is_usable() && ofctrl_restore_snapshot()) {
+            ofctrl_initial_clear = false;
+            meters_full_sync = true;
+        } else {
+            /* Never use a stale snapshot after the flows got cleared. */
+            char *file_name = ofctrl_snapshot_file_name();
+            unlink(file_name);
+            free(file_name);
+        }
+    }
 
     state = S_UPDATE_FLOWS;
 
@@ -722,10 +991,22 @@ static void
 recv_S_UPDATE_FLOWS(const struct ofp_header *oh, enum ofptype type,
                     struct shash *pending_ct_zones)
 {
-    if (type == OFPTYPE_BARRIER_REPLY && !ovs_list_is_empty(&flow_updates)) {
+    if (bundle_commit_in_flight && oh->xid == bundle_commit_xid) {
+        /* The switch is done with the previous bundle (whether it succeeded
+         * or not), send the next one. */
+        bundle_commit_in_flight = false;
+        OVN_USDT_PROBE(ofctrl, bundle_commit_ack, ntohl(oh->xid),
+                       type == OFPTYPE_ERROR);
+        ofctrl_send_pending_msgs();
+        if (type == OFPTYPE_ERROR) {
+            ofctrl_recv(oh, type);
+        }
+    } else if (type == OFPTYPE_BARRIER_REPLY
+               && !ovs_list_is_empty(&flow_updates)) {
         struct ofctrl_flow_update *fup = ofctrl_flow_update_from_list_node(
             ovs_list_front(&flow_updates));
         if (fup->xid == oh->xid) {
+            OVN_USDT_PROBE(ofctrl, put_ack, ntohl(oh->xid), fup->req_cfg);
             if (fup->req_cfg >= cur_cfg) {
                 cur_cfg = fup->req_cfg;
             }
@@ -742,6 +1023,11 @@ recv_S_UPDATE_FLOWS(const struct ofp_header *oh, enum ofptype type,
             struct ct_zone_pending_entry *ctzpe = iter->data;
             if (ctzpe->state == CT_ZONE_OF_SENT && ctzpe->of_xid == oh->xid) {
                 ctzpe->state = CT_ZONE_DB_QUEUED;
+
+                uint64_t msec = time_msec() - ctzpe->queued_msec;
+                ct_flush_stats.n_flushes++;
+                ct_flush_stats.total_msec += msec;
+                ct_flush_stats.max_msec = MAX(ct_flush_stats.max_msec, msec);
             }
         }
     } else {
@@ -756,8 +1042,8 @@ ofctrl_get_mf_field_id(void)
     if (!rconn_is_connected(swconn)) {
         return 0;
     }
-    return (state == S_CLEAR_FLOWS || state == S_UPDATE_FLOWS
-            ? mff_ovn_geneve : 0);
+    return (state == S_DUMP_FLOWS || state == S_CLEAR_FLOWS
+            || state == S_UPDATE_FLOWS ? mff_ovn_geneve : 0);
 }
 
 /* Runs the OpenFlow state machine against 'br_int', which is local to the
@@ -803,6 +1089,18 @@ ofctrl_run(const struct ovsrec_bridge *br_int,
                   _wait_before_clear_time, wait_before_clear_time);
         wait_before_clear_time = _wait_before_clear_time;
     }
+    warm_start = smap_get_bool(&cfg->external_ids, "ovn-ofctrl-warm-start",
+                               false);
+    reconcile_on_reconnect = smap_get_bool(&cfg->external_ids,
+                                           "ovn-ofctrl-reconcile-on-reconnect",
+                                           false);
+    bundle_max_flows = smap_get_uint(&cfg->external_ids,
+                                     "ovn-ofctrl-bundle-max-flows", 0);
+    prioritize_new_ports = smap_get_bool(&cfg->external_ids,
+                                         "ovn-ofctrl-prioritize-new-ports",
+                                         false);
+    ct_flush_batch_size = smap_get_uint(&cfg->external_ids,
+                                        "ovn-ofctrl-ct-flush-batch-size", 0);
 
     bool progress = true;
     for (int i = 0; progress && i < 50; i++) {
@@ -864,11 +1162,13 @@ void
 ofctrl_destroy(void)
 {
     rconn_destroy(swconn);
+    ofpbuf_list_delete(&pending_msgs);
     ovn_installed_flow_table_destroy();
     rconn_packet_counter_destroy(tx_counter);
     expr_symtab_destroy(&symtab);
     shash_destroy(&symtab);
     ofctrl_meter_bands_destroy();
+    sset_destroy(&meters_changed);
 }
 
 uint64_t
@@ -876,6 +1176,275 @@ ofctrl_get_cur_cfg(void)
 {
     return cur_cfg;
 }
+
+static char *
+ofctrl_snapshot_file_name(void)
+{
+    return xasprintf("%s/ovn-controller-flows.snapshot", ovn_rundir());
+}
+
+static void
+ofctrl_snapshot_put_flows(struct ds *s, const char *type,
+                          const struct hmap *installed_flows)
+{
+    struct installed_flow *i;
+    HMAP_FOR_EACH (i, match_hmap_node, installed_flows) {
+        const struct ovn_flow *f = &i->flow;
+
+        ds_put_format(s, "%s cookie=%#"PRIx64",table=%"PRIu8","
+                      "priority=%"PRIu16",", type, f->cookie, f->table_id,
+                      f->priority);
+        minimatch_format(f->match, NULL, NULL, s, OFP_DEFAULT_PRIORITY);
+        ds_put_cstr(s, " actions=");
+        struct ofpact_format_params fp = { .s = s };
+        ofpacts_format(f->ofpacts, f->ofpacts_len, &fp);
+        ds_put_char(s, '\n');
+    }
+}
+
+/* Saves the flows, groups and meters installed in the switch to the snapshot
+ * file, if external_ids:ovn-ofctrl-warm-start is enabled.  Nothing is saved
+ * unless the switch acknowledged all the updates sent to it, as the snapshot
+ * must match what the switch has.
+ *
+ * This must be called before the group and meter tables are destroyed. */
+void
+ofctrl_save_snapshot(void)
+{
+    if (!warm_start) {
+        return;
+    }
+
+    char *file_name = ofctrl_snapshot_file_name();
+    if (!rconn_is_connected(swconn) || state != S_UPDATE_FLOWS
+        || ofctrl_initial_clear || ofctrl_has_backlog()
+        || !ovs_list_is_empty(&flow_updates) || !mff_ovn_geneve) {
+        VLOG_INFO("%s: flows are not in sync with the switch, not saving "
+                  "a snapshot", file_name);
+        unlink(file_name);
+        free(file_name);
+        return;
+    }
+
+    struct ds s = DS_EMPTY_INITIALIZER;
+    ds_put_format(&s, OFCTRL_SNAPSHOT_HEADER" %d\n",
+                  mff_ovn_geneve - MFF_TUN_METADATA0);
+
+    struct ovn_extend_table_info *e;
+    HMAP_FOR_EACH (e, hmap_node, &groups->existing) {
+        ds_put_format(&s, "group %"PRIu32" %s\n", e->table_id, e->name);
+    }
+    HMAP_FOR_EACH (e, hmap_node, &meters->existing) {
+        ds_put_format(&s, "meter %"PRIu32" %s\n", e->table_id, e->name);
+    }
+
+    struct shash_node *node;
+    SHASH_FOR_EACH (node, &meter_bands) {
+        const struct meter_band_entry *mb = node->data;
+        for (size_t i = 0; i < mb->n_bands; i++) {
+            ds_put_format(&s, "meter-band %"PRId64" %"PRId64" %s\n",
+                          mb->bands[i].rate, mb->bands[i].burst_size,
+                          node->name);
+        }
+    }
+
+    ofctrl_snapshot_put_flows(&s, "lflow", &installed_lflows);
+    ofctrl_snapshot_put_flows(&s, "pflow", &installed_pflows);
+
+    /* Write to a temporary file first so that a partial snapshot is never
+     * read back. */
+    char *tmp_name = xasprintf("%s.tmp", file_name);
+    FILE *stream = fopen(tmp_name, "w");
+    if (!stream) {
+        VLOG_WARN("%s: open failed (%s)", tmp_name, ovs_strerror(errno));
+    } else {
+        bool ok = fwrite(s.string, 1, s.length, stream) == s.length;
+        ok = !fclose(stream) && ok;
+        if (!ok || rename(tmp_name, file_name)) {
+            VLOG_WARN("%s: failed to save the flows snapshot (%s)",
+                      file_name, ovs_strerror(errno));
+            unlink(tmp_name);
+        } else {
+            VLOG_INFO("%s: saved %"PRIuSIZE" flows, %"PRIuSIZE" groups and "
+                      "%"PRIuSIZE" meters", file_name,
+                      hmap_count(&installed_lflows)
+                      + hmap_count(&installed_pflows),
+                      hmap_count(&groups->existing),
+                      hmap_count(&meters->existing));
+        }
+    }
+    free(tmp_name);
+    ds_destroy(&s);
+    free(file_name);
+}
+
+/* Returns true if there is a snapshot that can be restored on this
+ * connection. */
+static bool
+ofctrl_snapshot_is_usable(void)
+{
+    if (!warm_start || snapshot_checked || !tlv_mapping_found) {
+        return false;
+    }
+
+    char *file_name = ofctrl_snapshot_file_name();
+    bool exists = !access(file_name, R_OK);
+    free(file_name);
+    return exists;
+}
+
+static char * OVS_WARN_UNUSED_RESULT
+ofctrl_snapshot_parse_flow(const char *s, struct hmap *installed_flows)
+{
+    struct ofputil_flow_mod fm;
+    enum ofputil_protocol usable_protocols;
+    char *error = parse_ofp_flow_mod_str(&fm, s, NULL, NULL, OFPFC_ADD,
+                                         &usable_protocols);
+    if (error) {
+        return error;
+    }
+
+    struct installed_flow *i = installed_flow_create(
+        fm.table_id, fm.priority, ntohll(fm.new_cookie), &fm.match,
+        fm.ofpacts, fm.ofpacts_len);
+    free(fm.ofpacts);
+
+    if (installed_flow_lookup(&i->flow, installed_flows)) {
+        installed_flow_destroy(i);
+        return xstrdup("duplicate flow");
+    }
+    hmap_insert(installed_flows, &i->match_hmap_node, i->flow.hash);
+    return NULL;
+}
+
+static char * OVS_WARN_UNUSED_RESULT
+ofctrl_snapshot_parse_line(const char *s)
+{
+    int64_t rate, burst_size;
+    uint32_t id;
+    int n = 0;
+
+    if (ovs_scan(s, "meter-band %"SCNd64" %"SCNd64" %n",
+                 &rate, &burst_size, &n)) {
+        struct meter_band_entry *mb = shash_find_data(&meter_bands, s + n);
+        if (!mb) {
+            mb = xzalloc(sizeof *mb);
+            shash_add(&meter_bands, s + n, mb);
+        }
+        mb->bands = xrealloc(mb->bands,
+                             (mb->n_bands + 1) * sizeof *mb->bands);
+        mb->bands[mb->n_bands].rate = rate;
+        mb->bands[mb->n_bands].burst_size = burst_size;
+        mb->n_bands++;
+    } else if (ovs_scan(s, "group %"SCNu32" %n", &id, &n)) {
+        if (!ovn_extend_table_add_existing(groups, s + n, id)) {
+            return xasprintf("invalid group id %"PRIu32, id);
+        }
+    } else if (ovs_scan(s, "meter %"SCNu32" %n", &id, &n)) {
+        if (!ovn_extend_table_add_existing(meters, s + n, id)) {
+            return xasprintf("invalid meter id %"PRIu32, id);
+        }
+    } else if (!strncmp(s, "lflow ", 6)) {
+        return ofctrl_snapshot_parse_flow(s + 6, &installed_lflows);
+    } else if (!strncmp(s, "pflow ", 6)) {
+        return ofctrl_snapshot_parse_flow(s + 6, &installed_pflows);
+    } else {
+        return xstrdup("unexpected record");
+    }
+    return NULL;
+}
+
+/* Restores the flows, groups and meters saved by ofctrl_save_snapshot() as
+ * the ones installed in the switch, and removes the snapshot file.  Returns
+ * false, leaving them all empty, if the snapshot couldn't be restored. */
+static bool
+ofctrl_restore_snapshot(void)
+{
+    char *file_name = ofctrl_snapshot_file_name();
+    FILE *stream = fopen(file_name, "r");
+    if (!stream) {
+        VLOG_WARN("%s: open failed (%s)", file_name, ovs_strerror(errno));
+        free(file_name);
+        return false;
+    }
+    unlink(file_name);
+
+    struct ds line = DS_EMPTY_INITIALIZER;
+    char *error = NULL;
+    int line_number = 0;
+
+    while (!error && !ds_get_line(&line, stream)) {
+        const char *s = ds_cstr(&line);
+        int geneve_index;
+
+        if (++line_number > 1) {
+            error = ofctrl_snapshot_parse_line(s);
+        } else if (!ovs_scan(s, OFCTRL_SNAPSHOT_HEADER" %d", &geneve_index)) {
+            error = xstrdup("unknown snapshot format");
+        } else if (geneve_index != mff_ovn_geneve - MFF_TUN_METADATA0) {
+            error = xasprintf("Geneve option index changed from %d",
+                              geneve_index);
+        }
+    }
+    if (!error && !line_number) {
+        error = xstrdup("empty snapshot");
+    }
+    ds_destroy(&line);
+    fclose(stream);
+
+    if (error) {
+        VLOG_WARN("%s:%d: not restoring the flows snapshot: %s", file_name,
+                  line_number, error);
+        free(error);
+        free(file_name);
+
+        ovn_installed_flow_table_clear();
+        ovn_extend_table_clear(groups, true);
+        ovn_extend_table_clear(meters, true);
+        ofctrl_meter_bands_clear();
+        return false;
+    }
+
+    VLOG_INFO("%s: restored %"PRIuSIZE" flows, %"PRIuSIZE" groups and "
+              "%"PRIuSIZE" meters", file_name,
+              hmap_count(&installed_lflows) + hmap_count(&installed_pflows),
+              hmap_count(&groups->existing), hmap_count(&meters->existing));
+    free(file_name);
+    return true;
+}
+
+/* Returns true if the flows of the switch can be dumped and reconciled with
+ * the desired ones on this connection, instead of being cleared.  This is
+ * only the case on a reconnection to a switch that still has our Geneve
+ * option mapping, i.e. that was not restarted, and that acknowledged all the
+ * updates sent to it before, so that the groups and meters that we believe
+ * installed are the ones that it has. */
+static bool
+ofctrl_can_reconcile(void)
+{
+    return (reconcile_on_reconnect && snapshot_checked && tlv_mapping_found
+            && mff_ovn_geneve && !ofctrl_initial_clear
+            && ovs_list_is_empty(&flow_updates)
+            && ovs_list_is_empty(&pending_msgs)
+            && !bundle_commit_in_flight);
+}
+
+/* Moves the flows dumped from the switch to installed_pflows, if they are
+ * desired in 'pflow_table', and to installed_lflows otherwise, which deletes
+ * them if they are not desired at all. */
+static void
+ofctrl_assign_dumped_flows(struct ovn_desired_flow_table *pflow_table)
+{
+    struct installed_flow *i;
+    HMAP_FOR_EACH_SAFE (i, match_hmap_node, &dumped_flows) {
+        hmap_remove(&dumped_flows, &i->match_hmap_node);
+        struct hmap *installed_flows =
+            desired_flow_lookup(pflow_table, &i->flow)
+            ? &installed_pflows : &installed_lflows;
+        hmap_insert(installed_flows, &i->match_hmap_node, i->flow.hash);
+    }
+    flows_dumped = false;
+}
 
 static ovs_be32
 queue_msg(struct ofpbuf *msg)
@@ -1289,30 +1858,20 @@ ofctrl_add_or_append_flow(struct ovn_desired_flow_table *desired_flows,
                    existing->flow.ofpacts_len);
         ofpbuf_put(&compound, f->flow.ofpacts, f->flow.ofpacts_len);
 
-        mem_stats.desired_flow_usage -= desired_flow_size(existing);
-        free(existing->flow.ofpacts);
-        existing->flow.ofpacts = xmemdup(compound.data, compound.size);
+        ovn_flow_ofpacts_unref(existing->flow.ofpacts);
+        existing->flow.ofpacts = ovn_flow_ofpacts_intern(compound.data,
+                                                         compound.size);
         existing->flow.ofpacts_len = compound.size;
-        mem_stats.desired_flow_usage += desired_flow_size(existing);
 
         ofpbuf_uninit(&compound);
         desired_flow_destroy(f);
         f = existing;
 
-        /* Since the flow now shared by more than one SB lflows, don't track
-         * it with address set ips. So remove any existed as_info tracking, and
-         * then add the new sb link without as_info.
-         *
-         * XXX: this may still be tracked if the flow is shared by different
-         * lflows, but we need to remove the related conjunction from the
-         * actions properly when handle addrset ip deletion, instead of simply
-         * delete the flow. */
-        struct sb_flow_ref *sfr;
-        LIST_FOR_EACH (sfr, sb_list, &f->references) {
-            ovs_list_remove(&sfr->as_ip_flow_list);
-            ovs_list_init(&sfr->as_ip_flow_list);
-        }
-        link_flow_to_sb(desired_flows, f, sb_uuid, NULL);
+        /* The flow is now shared by more than one SB lflow, each of them
+         * keeps tracking it with its own address set ip, if any: when the ip
+         * is deleted, ofctrl_remove_flows_for_as_ip() only removes the
+         * conjunction actions of that lflow from the flow. */
+        link_flow_to_sb(desired_flows, f, sb_uuid, as_info);
     } else {
         hmap_insert(&desired_flows->match_flow_table, &f->match_hmap_node,
                     f->flow.hash);
@@ -1365,42 +1924,52 @@ ofctrl_flood_remove_add_node(struct hmap *flood_remove_nodes,
     hmap_insert(flood_remove_nodes, &ofrn->hmap_node, uuid_hash(sb_uuid));
 }
 
+/* State of ofctrl_flood_remove_flows().  The sb_uuids whose flows are
+ * removed are added to 'nodes' and queued, instead of being processed
+ * recursively, so that the stack does not grow with the length of the
+ * chains of shared flows. */
+struct flood_remove_ctx {
+    struct hmap *nodes;         /* Contains ofctrl_flood_remove_nodes. */
+    struct uuid *queue;         /* sb_uuids of 'nodes' left to process. */
+    size_t n_queue;
+    size_t allocated_queue;
+};
+
 static void
-flood_remove_flows_for_sb_uuid(struct ovn_desired_flow_table *flow_table,
-                               const struct uuid *sb_uuid,
-                               struct hmap *flood_remove_nodes)
+flood_remove_enqueue(struct flood_remove_ctx *ctx, const struct uuid *sb_uuid)
 {
-    struct sb_to_flow *stf = sb_to_flow_find(&flow_table->uuid_flow_table,
-                                             sb_uuid);
-    if (!stf) {
-        return;
+    if (ctx->n_queue >= ctx->allocated_queue) {
+        ctx->queue = x2nrealloc(ctx->queue, &ctx->allocated_queue,
+                                sizeof *ctx->queue);
     }
-
-    remove_flows_from_sb_to_flow(flow_table, stf, "flood remove",
-                                 flood_remove_nodes);
+    ctx->queue[ctx->n_queue++] = *sb_uuid;
 }
 
 void
 ofctrl_flood_remove_flows(struct ovn_desired_flow_table *flow_table,
                           struct hmap *flood_remove_nodes)
 {
-    struct ofctrl_flood_remove_node *ofrn;
-    int i, n = 0;
+    struct flood_remove_ctx ctx = {
+        .nodes = flood_remove_nodes,
+    };
 
-    /* flood_remove_flows_for_sb_uuid() will modify the 'flood_remove_nodes'
-     * hash map by inserting new items, so we can't use it for iteration.
-     * Copying the sb_uuids into an array. */
-    struct uuid *sb_uuids;
-    sb_uuids = xmalloc(hmap_count(flood_remove_nodes) * sizeof *sb_uuids);
+    struct ofctrl_flood_remove_node *ofrn;
     HMAP_FOR_EACH (ofrn, hmap_node, flood_remove_nodes) {
-        sb_uuids[n++] = ofrn->sb_uuid;
+        flood_remove_enqueue(&ctx, &ofrn->sb_uuid);
     }
 
-    for (i = 0; i < n; i++) {
-        flood_remove_flows_for_sb_uuid(flow_table, &sb_uuids[i],
-                                       flood_remove_nodes);
+    /* remove_flows_from_sb_to_flow() appends to the queue the sb_uuids that
+     * share the flows it removes. */
+    for (size_t i = 0; i < ctx.n_queue; i++) {
+        struct sb_to_flow *stf = sb_to_flow_find(&flow_table->uuid_flow_table,
+                                                 &ctx.queue[i]);
+        if (stf) {
+            remove_flows_from_sb_to_flow(flow_table, stf, "flood remove",
+                                         &ctx);
+        }
     }
-    free(sb_uuids);
+    COVERAGE_ADD(ofctrl_flood_remove_sb_uuids, ctx.n_queue);
+    free(ctx.queue);
 
     /* remove any related group and meter info */
     HMAP_FOR_EACH (ofrn, hmap_node, flood_remove_nodes) {
@@ -1409,16 +1978,55 @@ ofctrl_flood_remove_flows(struct ovn_desired_flow_table *flow_table,
     }
 }
 
+/* Removes from the conjunctive flow 'f' the conjunction actions that belong
+ * to 'lflow_uuid', according to 'conj_ids'.  Returns false if there was none
+ * to remove. */
+static bool
+desired_flow_remove_lflow_conjs(struct desired_flow *f,
+                                struct conj_ids *conj_ids,
+                                const struct uuid *lflow_uuid)
+{
+    uint64_t ofpacts_stub[64 / 8];
+    struct ofpbuf ofpacts;
+    bool removed = false;
+
+    ofpbuf_use_stub(&ofpacts, ofpacts_stub, sizeof ofpacts_stub);
+
+    const struct ofpact *a;
+    OFPACT_FOR_EACH (a, f->flow.ofpacts, f->flow.ofpacts_len) {
+        if (a->type == OFPACT_CONJUNCTION
+            && lflow_conj_ids_contains(conj_ids, lflow_uuid,
+                                       ofpact_get_CONJUNCTION(a)->id)) {
+            removed = true;
+            continue;
+        }
+        ofpbuf_put(&ofpacts, a, OFPACT_ALIGN(a->len));
+    }
+
+    if (removed) {
+        ovn_flow_ofpacts_unref(f->flow.ofpacts);
+        f->flow.ofpacts = ovn_flow_ofpacts_intern(ofpacts.data, ofpacts.size);
+        f->flow.ofpacts_len = ofpacts.size;
+    }
+    ofpbuf_uninit(&ofpacts);
+    return removed;
+}
+
 /* Remove desired flows related to the specified 'addrset_info' for the
  * 'lflow_uuid'. Returns true if it can be processed completely, otherwise
  * returns false, which would trigger a reprocessing of the lflow of
  * 'lflow_uuid'. The expected_count is checked against the actual flows
- * deleted, and if it doesn't match, return false, too. */
+ * deleted, and if it doesn't match, return false, too.
+ *
+ * A conjunctive flow that is shared with other lflows is kept, with only the
+ * conjunction actions of 'lflow_uuid' removed from it, as found in
+ * 'conj_ids'. */
 bool
 ofctrl_remove_flows_for_as_ip(struct ovn_desired_flow_table *flow_table,
                               const struct uuid *lflow_uuid,
                               const struct addrset_info *as_info,
-                              size_t expected_count)
+                              size_t expected_count,
+                              struct conj_ids *conj_ids)
 {
     struct sb_to_flow *stf = sb_to_flow_find(&flow_table->uuid_flow_table,
                                              lflow_uuid);
@@ -1453,25 +2061,39 @@ ofctrl_remove_flows_for_as_ip(struct ovn_desired_flow_table *flow_table,
     struct sb_flow_ref *sfr;
     size_t count = 0;
     LIST_FOR_EACH_SAFE (sfr, as_ip_flow_list, &itfn->flows) {
-        /* If the desired flow is referenced by multiple sb lflows, it
-         * shouldn't have been indexed by address set. */
-        ovs_assert(ovs_list_is_short(&sfr->sb_list));
+        struct desired_flow *f = sfr->flow;
+
+        /* If the flow is shared, this lflow's part of it is told apart by its
+         * conjunction ids, which is not possible if the lflow references the
+         * flow more than once. */
+        struct sb_flow_ref *other;
+        LIST_FOR_EACH (other, sb_list, &f->references) {
+            if (other != sfr && uuid_equals(&other->sb_uuid, lflow_uuid)) {
+                return false;
+            }
+        }
 
         ovs_list_remove(&sfr->sb_list);
         ovs_list_remove(&sfr->flow_list);
         ovs_list_remove(&sfr->as_ip_flow_list);
-
-        struct desired_flow *f = sfr->flow;
         mem_stats.sb_flow_ref_usage -= sb_flow_ref_size(sfr);
         free(sfr);
+        count++;
+
+        if (!ovs_list_is_empty(&f->references)) {
+            if (!desired_flow_remove_lflow_conjs(f, conj_ids, lflow_uuid)) {
+                return false;
+            }
+            ovn_flow_log(&f->flow, "remove_flows_for_as_ip (conjunction)");
+            track_flow_add_or_modify(flow_table, f);
+            continue;
+        }
 
         ovs_assert(ovs_list_is_empty(&f->list_node));
-        ovs_assert(ovs_list_is_empty(&f->references));
         ovn_flow_log(&f->flow, "remove_flows_for_as_ip");
         hmap_remove(&flow_table->match_flow_table,
                     &f->match_hmap_node);
         track_or_destroy_for_flow_del(flow_table, f);
-        count++;
     }
 
     hmap_remove(&sar->as_ip_to_flow_map, &itfn->hmap_node);
@@ -1487,7 +2109,7 @@ static void
 remove_flows_from_sb_to_flow(struct ovn_desired_flow_table *flow_table,
                              struct sb_to_flow *stf,
                              const char *log_msg,
-                             struct hmap *flood_remove_nodes)
+                             struct flood_remove_ctx *flood_ctx)
 {
     /* ovn_flows that have other references and waiting to be removed. */
     struct ovs_list to_be_removed = OVS_LIST_INITIALIZER(&to_be_removed);
@@ -1503,6 +2125,9 @@ remove_flows_from_sb_to_flow(struct ovn_desired_flow_table *flow_table,
         free(sfr);
 
         ovs_assert(ovs_list_is_empty(&f->list_node));
+        if (flood_ctx) {
+            COVERAGE_INC(ofctrl_flood_remove_flows);
+        }
         if (ovs_list_is_empty(&f->references)) {
             if (log_msg) {
                 ovn_flow_log(&f->flow, log_msg);
@@ -1510,7 +2135,7 @@ remove_flows_from_sb_to_flow(struct ovn_desired_flow_table *flow_table,
             hmap_remove(&flow_table->match_flow_table,
                         &f->match_hmap_node);
             track_or_destroy_for_flow_del(flow_table, f);
-        } else if (flood_remove_nodes) {
+        } else if (flood_ctx) {
             ovs_list_insert(&to_be_removed, &f->list_node);
         }
     }
@@ -1535,27 +2160,20 @@ remove_flows_from_sb_to_flow(struct ovn_desired_flow_table *flow_table,
     mem_stats.sb_flow_ref_usage -= sb_to_flow_size(stf);
     free(stf);
 
-    /* Traverse other referencing sb_uuids for the flows in the to_be_removed
-     * list. */
-
-    /* Detach the items in f->references from the sfr.flow_list lists,
-     * so that recursive calls will not mess up the sfr.sb_list list. */
+    /* Remove the flows in the to_be_removed list from the other sb_uuids
+     * that reference them, and queue these sb_uuids to have their other
+     * flows removed too. */
     struct desired_flow *f;
-    LIST_FOR_EACH (f, list_node, &to_be_removed) {
-        ovs_assert(!ovs_list_is_empty(&f->references));
-        LIST_FOR_EACH (sfr, sb_list, &f->references) {
-            ovs_list_remove(&sfr->flow_list);
-            ovs_list_remove(&sfr->as_ip_flow_list);
-        }
-    }
     LIST_FOR_EACH_SAFE (f, list_node, &to_be_removed) {
+        ovs_assert(!ovs_list_is_empty(&f->references));
         LIST_FOR_EACH_SAFE (sfr, sb_list, &f->references) {
-            if (!flood_remove_find_node(flood_remove_nodes, &sfr->sb_uuid)) {
-                ofctrl_flood_remove_add_node(flood_remove_nodes,
+            if (!flood_remove_find_node(flood_ctx->nodes, &sfr->sb_uuid)) {
+                ofctrl_flood_remove_add_node(flood_ctx->nodes,
                                              &sfr->sb_uuid);
-                flood_remove_flows_for_sb_uuid(flow_table, &sfr->sb_uuid,
-                                               flood_remove_nodes);
+                flood_remove_enqueue(flood_ctx, &sfr->sb_uuid);
             }
+            ovs_list_remove(&sfr->flow_list);
+            ovs_list_remove(&sfr->as_ip_flow_list);
             ovs_list_remove(&sfr->sb_list);
             mem_stats.sb_flow_ref_usage -= sb_flow_ref_size(sfr);
             free(sfr);
@@ -1572,15 +2190,121 @@ remove_flows_from_sb_to_flow(struct ovn_desired_flow_table *flow_table,
 
 /* flow operations. */
 
+static size_t
+ovn_flow_match_size(const struct ovn_flow_match *m)
+{
+    /* minimatch_init() allocates the flow and the mask together, with the
+     * same number of values. */
+    return sizeof *m + 2 * (sizeof(struct miniflow)
+                            + MINIFLOW_VALUES_SIZE(
+                                  miniflow_n_values(m->match.flow)));
+}
+
+/* Returns the interned copy of 'match' and takes ownership of it: 'match' is
+ * either moved into a new interned match or destroyed.  The caller must
+ * release the returned match with ovn_flow_match_unref(). */
+static const struct minimatch *
+ovn_flow_match_intern(struct minimatch *match)
+{
+    uint32_t hash = minimatch_hash(match, 0);
+    struct ovn_flow_match *m;
+    HMAP_FOR_EACH_WITH_HASH (m, hmap_node, hash, &flow_matches) {
+        if (minimatch_equal(&m->match, match)) {
+            minimatch_destroy(match);
+            m->refcount++;
+            return &m->match;
+        }
+    }
+
+    m = xmalloc(sizeof *m);
+    m->refcount = 1;
+    m->match = *match;
+    hmap_insert(&flow_matches, &m->hmap_node, hash);
+    mem_stats.flow_data_usage += ovn_flow_match_size(m);
+    return &m->match;
+}
+
+static const struct minimatch *
+ovn_flow_match_ref(const struct minimatch *match)
+{
+    struct ovn_flow_match *m = CONTAINER_OF(match, struct ovn_flow_match,
+                                            match);
+    m->refcount++;
+    return match;
+}
+
+static void
+ovn_flow_match_unref(const struct minimatch *match)
+{
+    struct ovn_flow_match *m = CONTAINER_OF(match, struct ovn_flow_match,
+                                            match);
+    if (!--m->refcount) {
+        mem_stats.flow_data_usage -= ovn_flow_match_size(m);
+        hmap_remove(&flow_matches, &m->hmap_node);
+        minimatch_destroy(&m->match);
+        free(m);
+    }
+}
+
+/* Returns the interned copy of the 'len' bytes of actions in 'ofpacts'.  The
+ * caller must release it with ovn_flow_ofpacts_unref(). */
+static const struct ofpact *
+ovn_flow_ofpacts_intern(const void *ofpacts, size_t len)
+{
+    uint32_t hash = hash_bytes(ofpacts, len, 0);
+    struct ovn_flow_ofpacts *a;
+    HMAP_FOR_EACH_WITH_HASH (a, hmap_node, hash, &flow_ofpacts) {
+        if (ofpacts_equal((const struct ofpact *) a->ofpacts, a->len,
+                          ofpacts, len)) {
+            a->refcount++;
+            return (const struct ofpact *) a->ofpacts;
+        }
+    }
+
+    a = xmalloc(sizeof *a + len);
+    a->refcount = 1;
+    a->len = len;
+    if (len) {
+        memcpy(a->ofpacts, ofpacts, len);
+    }
+    hmap_insert(&flow_ofpacts, &a->hmap_node, hash);
+    mem_stats.flow_data_usage += sizeof *a + len;
+    return (const struct ofpact *) a->ofpacts;
+}
+
+static const struct ofpact *
+ovn_flow_ofpacts_ref(const struct ofpact *ofpacts)
+{
+    struct ovn_flow_ofpacts *a = CONTAINER_OF(ofpacts, struct ovn_flow_ofpacts,
+                                              ofpacts);
+    a->refcount++;
+    return ofpacts;
+}
+
+static void
+ovn_flow_ofpacts_unref(const struct ofpact *ofpacts)
+{
+    struct ovn_flow_ofpacts *a = CONTAINER_OF(ofpacts, struct ovn_flow_ofpacts,
+                                              ofpacts);
+    if (!--a->refcount) {
+        mem_stats.flow_data_usage -= sizeof *a + a->len;
+        hmap_remove(&flow_ofpacts, &a->hmap_node);
+        free(a);
+    }
+}
+
 static void
 ovn_flow_init(struct ovn_flow *f, uint8_t table_id, uint16_t priority,
               uint64_t cookie, const struct match *match,
               const struct ofpbuf *actions, uint32_t meter_id)
 {
+    struct minimatch minimatch;
+    minimatch_init(&minimatch, match);
+
     f->table_id = table_id;
     f->priority = priority;
-    minimatch_init(&f->match, match);
-    f->ofpacts = xmemdup(actions->data, actions->size);
+    f->match = ovn_flow_match_intern(&minimatch);
+    f->ofpacts = ovn_flow_ofpacts_intern(actions->data, actions->size);
     f->ofpacts_len = actions->size;
     f->hash = ovn_flow_match_hash(f);
     f->cookie = cookie;
@@ -1590,7 +2314,7 @@ ovn_flow_init(struct ovn_flow *f, uint8_t table_id, uint16_t priority,
 static size_t
 desired_flow_size(const struct desired_flow *f)
 {
-    return sizeof *f + f->flow.ofpacts_len;
+    return sizeof *f;
 }
 
 static struct desired_flow *
@@ -1616,14 +2340,17 @@ desired_flow_alloc(uint8_t table_id, uint16_t priority, uint64_t cookie,
 static uint32_t
 ovn_flow_match_hash(const struct ovn_flow *f)
 {
+    const struct ovn_flow_match *m = CONTAINER_OF(f->match,
+                                                  struct ovn_flow_match,
+                                                  match);
     return hash_2words((f->table_id << 16) | f->priority,
-                       minimatch_hash(&f->match, 0));
+                       m->hmap_node.hash);
 }
 
 static size_t
 installed_flow_size(const struct installed_flow *f)
 {
-    return sizeof *f + f->flow.ofpacts_len;
+    return sizeof *f;
 }
 
 /* Duplicate a desired flow to an installed flow. */
@@ -1634,8 +2361,8 @@ installed_flow_dup(struct desired_flow *src)
     ovs_list_init(&dst->desired_refs);
     dst->flow.table_id = src->flow.table_id;
     dst->flow.priority = src->flow.priority;
-    minimatch_clone(&dst->flow.match, &src->flow.match);
-    dst->flow.ofpacts = xmemdup(src->flow.ofpacts, src->flow.ofpacts_len);
+    dst->flow.match = ovn_flow_match_ref(src->flow.match);
+    dst->flow.ofpacts = ovn_flow_ofpacts_ref(src->flow.ofpacts);
     dst->flow.ofpacts_len = src->flow.ofpacts_len;
     dst->flow.hash = src->flow.hash;
     dst->flow.cookie = src->flow.cookie;
@@ -1668,7 +2395,7 @@ desired_flow_lookup__(struct ovn_desired_flow_table *flow_table,
         if (f->table_id == target->table_id
             && f->priority == target->priority
             && f->ctrl_meter_id == target->ctrl_meter_id
-            && minimatch_equal(&f->match, &target->match)) {
+            && f->match == target->match) {
 
             if (!match_cb || match_cb(d, arg)) {
                 return d;
@@ -1751,7 +2478,7 @@ installed_flow_lookup(const struct ovn_flow *target,
         struct ovn_flow *f = &i->flow;
         if (f->table_id == target->table_id
             && f->priority == target->priority
-            && minimatch_equal(&f->match, &target->match)) {
+            && f->match == target->match) {
             return i;
         }
     }
@@ -1766,7 +2493,7 @@ ovn_flow_to_string(const struct ovn_flow *f)
     ds_put_format(&s, "cookie=%"PRIx64", ", f->cookie);
     ds_put_format(&s, "table_id=%"PRIu8", ", f->table_id);
     ds_put_format(&s, "priority=%"PRIu16", ", f->priority);
-    minimatch_format(&f->match, NULL, NULL, &s, OFP_DEFAULT_PRIORITY);
+    minimatch_format(f->match, NULL, NULL, &s, OFP_DEFAULT_PRIORITY);
     ds_put_cstr(&s, ", actions=");
     struct ofpact_format_params fp = { .s = &s };
     ofpacts_format(f->ofpacts, f->ofpacts_len, &fp);
@@ -1786,8 +2513,8 @@ ovn_flow_log(const struct ovn_flow *f, const char *action)
 static void
 ovn_flow_uninit(struct ovn_flow *f)
 {
-    minimatch_destroy(&f->match);
-    free(f->ofpacts);
+    ovn_flow_match_unref(f->match);
+    ovn_flow_ofpacts_unref(f->ofpacts);
 }
 
 static void
@@ -1802,6 +2529,26 @@ desired_flow_destroy(struct desired_flow *f)
     }
 }
 
+/* Creates an installed flow, that takes ownership of 'match'. */
+static struct installed_flow *
+installed_flow_create(uint8_t table_id, uint16_t priority, uint64_t cookie,
+                      struct minimatch *match, const struct ofpact *ofpacts,
+                      size_t ofpacts_len)
+{
+    struct installed_flow *i = xmalloc(sizeof *i);
+    ovs_list_init(&i->desired_refs);
+    i->flow.table_id = table_id;
+    i->flow.priority = priority;
+    i->flow.match = ovn_flow_match_intern(match);
+    i->flow.ofpacts = ovn_flow_ofpacts_intern(ofpacts, ofpacts_len);
+    i->flow.ofpacts_len = ofpacts_len;
+    i->flow.hash = ovn_flow_match_hash(&i->flow);
+    i->flow.cookie = cookie;
+    i->flow.ctrl_meter_id = NX_CTLR_NO_METER;
+    mem_stats.installed_flow_usage += installed_flow_size(i);
+    return i;
+}
+
 static void
 installed_flow_destroy(struct installed_flow *f)
 {
@@ -1870,6 +2617,12 @@ ovn_installed_flow_table_clear(void)
         unlink_all_refs_for_installed_flow(f);
         installed_flow_destroy(f);
     }
+
+    HMAP_FOR_EACH_SAFE (f, match_hmap_node, &dumped_flows) {
+        hmap_remove(&dumped_flows, &f->match_hmap_node);
+        installed_flow_destroy(f);
+    }
+    flows_dumped = false;
 }
 
 static void
@@ -1878,6 +2631,7 @@ ovn_installed_flow_table_destroy(void)
     ovn_installed_flow_table_clear();
     hmap_destroy(&installed_lflows);
     hmap_destroy(&installed_pflows);
+    hmap_destroy(&dumped_flows);
 }
 
 /* Flow table update. */
@@ -1902,6 +2656,37 @@ encode_bundle_add(struct ofpbuf *msg, struct ofputil_bundle_ctrl_msg *bc)
     return ofputil_encode_bundle_add(OFP15_VERSION, &bam);
 }
 
+/* Appends to 'msgs' a request to open the bundle 'bc'. */
+static void
+bundle_open(struct ofputil_bundle_ctrl_msg *bc, struct ovs_list *msgs)
+{
+    bc->bundle_id = bundle_id++;
+    bc->type = OFPBCT_OPEN_REQUEST;
+    bundle_open_msg = ofputil_encode_bundle_ctrl_request(OFP15_VERSION, bc);
+    ovs_list_push_back(msgs, &bundle_open_msg->list_node);
+    bundle_n_flows = 0;
+}
+
+/* Appends to 'msgs' a request to commit the bundle 'bc', or removes the
+ * request to open it if nothing was added to it. */
+static void
+bundle_commit(struct ofputil_bundle_ctrl_msg *bc, struct ovs_list *msgs)
+{
+    if (ovs_list_back(msgs) == &bundle_open_msg->list_node) {
+        /* No flow updates.  Removing the bundle open request. */
+        ovs_list_pop_back(msgs);
+        ofpbuf_delete(bundle_open_msg);
+    } else {
+        bc->type = OFPBCT_COMMIT_REQUEST;
+        struct ofpbuf *commit_msg =
+            ofputil_encode_bundle_ctrl_request(OFP15_VERSION, bc);
+        const struct ofp_header *oh OVS_UNUSED = commit_msg->data;
+        OVN_USDT_PROBE(ofctrl, bundle_commit, bc->bundle_id, ntohl(oh->xid));
+        ovs_list_push_back(msgs, &commit_msg->list_node);
+    }
+    bundle_open_msg = NULL;
+}
+
 static void
 add_flow_mod(struct ofputil_flow_mod *fm,
              struct ofputil_bundle_ctrl_msg *bc,
@@ -1911,6 +2696,12 @@ add_flow_mod(struct ofputil_flow_mod *fm,
     struct ofpbuf *bundle_msg = encode_bundle_add(msg, bc);
     ofpbuf_delete(msg);
     ovs_list_push_back(msgs, &bundle_msg->list_node);
+
+    if (bundle_split && ++bundle_n_flows >= bundle_max_flows) {
+        /* Continue in a new bundle. */
+        bundle_commit(bc, msgs);
+        bundle_open(bc, msgs);
+    }
 }
 
 /* group_table. */
@@ -2192,18 +2983,28 @@ ofctrl_meter_bands_erase(struct ovn_extend_table_info *entry,
     }
 }
 
+static const struct sbrec_meter *
+sb_meter_lookup_by_name(struct ovsdb_idl_index *sbrec_meter_by_name,
+                        const char *name)
+{
+    struct sbrec_meter *target = sbrec_meter_index_init_row(
+        sbrec_meter_by_name);
+    sbrec_meter_index_set_name(target, name);
+
+    const struct sbrec_meter *retval = sbrec_meter_index_find(
+        sbrec_meter_by_name, target);
+
+    sbrec_meter_index_destroy_row(target);
+    return retval;
+}
+
 static void
 ofctrl_meter_bands_sync(struct ovn_extend_table_info *m_existing,
-                        const struct sbrec_meter_table *meter_table,
+                        struct ovsdb_idl_index *sbrec_meter_by_name,
                         struct ovs_list *msgs)
 {
-    const struct sbrec_meter *sb_meter;
-    SBREC_METER_TABLE_FOR_EACH (sb_meter, meter_table) {
-        if (!strcmp(m_existing->name, sb_meter->name)) {
-            break;
-        }
-    }
-
+    const struct sbrec_meter *sb_meter =
+        sb_meter_lookup_by_name(sbrec_meter_by_name, m_existing->name);
     if (sb_meter) {
         /* OFPMC13_ADD or OFPMC13_MODIFY */
         ofctrl_meter_bands_update(sb_meter, m_existing, msgs);
@@ -2215,16 +3016,11 @@ ofctrl_meter_bands_sync(struct ovn_extend_table_info *m_existing,
 
 static void
 add_meter(struct ovn_extend_table_info *m_desired,
-          const struct sbrec_meter_table *meter_table,
+          struct ovsdb_idl_index *sbrec_meter_by_name,
           struct ovs_list *msgs)
 {
-    const struct sbrec_meter *sb_meter;
-    SBREC_METER_TABLE_FOR_EACH (sb_meter, meter_table) {
-        if (!strcmp(m_desired->name, sb_meter->name)) {
-            break;
-        }
-    }
-
+    const struct sbrec_meter *sb_meter =
+        sb_meter_lookup_by_name(sbrec_meter_by_name, m_desired->name);
     if (!sb_meter) {
         static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
         VLOG_ERR_RL(&rl, "could not find meter named \"%s\"", m_desired->name);
@@ -2234,6 +3030,31 @@ add_meter(struct ovn_extend_table_info *m_desired,
     ofctrl_meter_bands_alloc(sb_meter, m_desired, msgs);
 }
 
+/* Records the SB meters that changed in 'meter_table' since the last call,
+ * so that the next ofctrl_put() only compares the bands of these meters
+ * against the installed ones.  Must be called on every main loop iteration
+ * in which the SB IDL was run, since the tracked changes are cleared at the
+ * end of each iteration. */
+void
+ofctrl_meters_track(const struct sbrec_meter_table *meter_table,
+                    const struct sbrec_meter_band_table *meter_band_table)
+{
+    const struct sbrec_meter *sb_meter;
+    SBREC_METER_TABLE_FOR_EACH_TRACKED (sb_meter, meter_table) {
+        sset_add(&meters_changed, sb_meter->name);
+    }
+
+    /* A band modified in place does not tell which meters refer to it. */
+    const struct sbrec_meter_band *sb_band;
+    SBREC_METER_BAND_TABLE_FOR_EACH_TRACKED (sb_band, meter_band_table) {
+        if (!sbrec_meter_band_is_new(sb_band)
+            && !sbrec_meter_band_is_deleted(sb_band)) {
+            meters_full_sync = true;
+            break;
+        }
+    }
+}
+
 static void
 installed_flow_add(struct ovn_flow *d,
                    struct ofputil_bundle_ctrl_msg *bc,
@@ -2241,10 +3062,10 @@ installed_flow_add(struct ovn_flow *d,
 {
     /* Send flow_mod to add flow. */
     struct ofputil_flow_mod fm = {
-        .match = d->match,
+        .match = *d->match,
         .priority = d->priority,
         .table_id = d->table_id,
-        .ofpacts = d->ofpacts,
+        .ofpacts = CONST_CAST(struct ofpact *, d->ofpacts),
         .ofpacts_len = d->ofpacts_len,
         .new_cookie = htonll(d->cookie),
         .command = OFPFC_ADD,
@@ -2259,10 +3080,10 @@ installed_flow_mod(struct ovn_flow *i, struct ovn_flow *d,
 {
     /* Update actions in installed flow. */
     struct ofputil_flow_mod fm = {
-        .match = i->match,
+        .match = *i->match,
         .priority = i->priority,
         .table_id = i->table_id,
-        .ofpacts = d->ofpacts,
+        .ofpacts = CONST_CAST(struct ofpact *, d->ofpacts),
         .ofpacts_len = d->ofpacts_len,
         .command = OFPFC_MODIFY_STRICT,
     };
@@ -2276,9 +3097,8 @@ installed_flow_mod(struct ovn_flow *i, struct ovn_flow *d,
     add_flow_mod(&fm, bc, msgs);
 
     /* Replace 'i''s actions and cookie by 'd''s. */
-    mem_stats.installed_flow_usage -= i->ofpacts_len - d->ofpacts_len;
-    free(i->ofpacts);
-    i->ofpacts = xmemdup(d->ofpacts, d->ofpacts_len);
+    ovn_flow_ofpacts_unref(i->ofpacts);
+    i->ofpacts = ovn_flow_ofpacts_ref(d->ofpacts);
     i->ofpacts_len = d->ofpacts_len;
     i->cookie = d->cookie;
 }
@@ -2289,7 +3109,7 @@ installed_flow_del(struct ovn_flow *i,
                    struct ovs_list *msgs)
 {
     struct ofputil_flow_mod fm = {
-        .match = i->match,
+        .match = *i->match,
         .priority = i->priority,
         .table_id = i->table_id,
         .command = OFPFC_DELETE_STRICT,
@@ -2297,13 +3117,58 @@ installed_flow_del(struct ovn_flow *i,
     add_flow_mod(&fm, bc, msgs);
 }
 
+/* Installs the desired flow 'd' if it is not in 'installed_flows' yet. */
+static void
+install_desired_flow(struct desired_flow *d,
+                     struct ofputil_bundle_ctrl_msg *bc,
+                     struct hmap *installed_flows,
+                     struct ovs_list *msgs)
+{
+    struct installed_flow *i = installed_flow_lookup(&d->flow,
+                                                     installed_flows);
+    if (!i) {
+        ovn_flow_log(&d->flow, "adding installed");
+        installed_flow_add(&d->flow, bc, msgs);
+
+        /* Copy 'd' from 'flow_table' to installed_flows. */
+        i = installed_flow_dup(d);
+        hmap_insert(installed_flows, &i->match_hmap_node, i->flow.hash);
+        link_installed_to_desired(i, d);
+    } else if (!d->installed_flow) {
+        /* This is a desired_flow that conflicts with one installed
+         * previously but not linked yet.  However, if this flow becomes
+         * active, e.g., it is less restrictive than the previous active
+         * flow then modify the installed flow.
+         */
+        if (link_installed_to_desired(i, d)) {
+            installed_flow_mod(&i->flow, &d->flow, bc, msgs);
+            ovn_flow_log(&i->flow, "updating installed (conflict)");
+        }
+    }
+}
+
 static void
 update_installed_flows_by_compare(struct ovn_desired_flow_table *flow_table,
                                   struct ofputil_bundle_ctrl_msg *bc,
                                   struct hmap *installed_flows,
+                                  const struct uuid *prio_sb_uuids,
+                                  size_t n_prio_sb_uuids,
                                   struct ovs_list *msgs)
 {
     ovs_assert(ovs_list_is_empty(&flow_table->tracked_flows));
+
+    /* Add the missing flows of the prioritized SB rows first. */
+    for (size_t n = 0; n < n_prio_sb_uuids; n++) {
+        struct sb_to_flow *stf = sb_to_flow_find(&flow_table->uuid_flow_table,
+                                                 &prio_sb_uuids[n]);
+        if (stf) {
+            struct sb_flow_ref *sfr;
+            LIST_FOR_EACH (sfr, flow_list, &stf->flows) {
+                install_desired_flow(sfr->flow, bc, installed_flows, msgs);
+            }
+        }
+    }
+
     /* Iterate through all of the installed flows.  If any of them are no
      * longer desired, delete them; if any of them should have different
      * actions, update them. */
@@ -2335,26 +3200,7 @@ update_installed_flows_by_compare(struct ovn_desired_flow_table *flow_table,
      * in the installed flow table. */
     struct desired_flow *d;
     HMAP_FOR_EACH (d, match_hmap_node, &flow_table->match_flow_table) {
-        i = installed_flow_lookup(&d->flow, installed_flows);
-        if (!i) {
-            ovn_flow_log(&d->flow, "adding installed");
-            installed_flow_add(&d->flow, bc, msgs);
-
-            /* Copy 'd' from 'flow_table' to installed_flows. */
-            i = installed_flow_dup(d);
-            hmap_insert(installed_flows, &i->match_hmap_node, i->flow.hash);
-            link_installed_to_desired(i, d);
-        } else if (!d->installed_flow) {
-            /* This is a desired_flow that conflicts with one installed
-             * previously but not linked yet.  However, if this flow becomes
-             * active, e.g., it is less restrictive than the previous active
-             * flow then modify the installed flow.
-             */
-            if (link_installed_to_desired(i, d)) {
-                installed_flow_mod(&i->flow, &d->flow, bc, msgs);
-                ovn_flow_log(&i->flow, "updating installed (conflict)");
-            }
-        }
+        install_desired_flow(d, bc, installed_flows, msgs);
     }
 }
 
@@ -2370,7 +3216,7 @@ deleted_flow_lookup(struct hmap *deleted_flows, struct ovn_flow *target)
         struct ovn_flow *f = &d->flow;
         if (f->table_id == target->table_id
             && f->priority == target->priority
-            && minimatch_equal(&f->match, &target->match)
+            && f->match == target->match
             && f->cookie == target->cookie
             && ofpacts_equal(f->ofpacts, f->ofpacts_len, target->ofpacts,
                              target->ofpacts_len)) {
@@ -2439,13 +3285,42 @@ merge_tracked_flows(struct ovn_desired_flow_table *flow_table)
     hmap_destroy(&deleted_flows);
 }
 
+/* Moves the tracked flows of the SB rows 'prio_sb_uuids' to the front of the
+ * tracked flows of 'flow_table', so that they are installed first. */
+static void
+prioritize_tracked_flows(struct ovn_desired_flow_table *flow_table,
+                         const struct uuid *prio_sb_uuids,
+                         size_t n_prio_sb_uuids)
+{
+    for (size_t i = 0; i < n_prio_sb_uuids; i++) {
+        struct sb_to_flow *stf = sb_to_flow_find(&flow_table->uuid_flow_table,
+                                                 &prio_sb_uuids[i]);
+        if (!stf) {
+            continue;
+        }
+
+        struct sb_flow_ref *sfr;
+        LIST_FOR_EACH (sfr, flow_list, &stf->flows) {
+            struct desired_flow *f = sfr->flow;
+            if (!ovs_list_is_empty(&f->track_list_node)) {
+                ovs_list_remove(&f->track_list_node);
+                ovs_list_push_front(&flow_table->tracked_flows,
+                                    &f->track_list_node);
+            }
+        }
+    }
+}
+
 static void
 update_installed_flows_by_track(struct ovn_desired_flow_table *flow_table,
                                 struct ofputil_bundle_ctrl_msg *bc,
                                 struct hmap *installed_flows,
+                                const struct uuid *prio_sb_uuids,
+                                size_t n_prio_sb_uuids,
                                 struct ovs_list *msgs)
 {
     merge_tracked_flows(flow_table);
+    prioritize_tracked_flows(flow_table, prio_sb_uuids, n_prio_sb_uuids);
     struct desired_flow *f;
     LIST_FOR_EACH_SAFE (f, track_list_node,
                         &flow_table->tracked_flows) {
@@ -2511,10 +3386,45 @@ update_installed_flows_by_track(struct ovn_desired_flow_table *flow_table,
     }
 }
 
+/* Returns true if 'msg' is a bundle commit request. */
+static bool
+is_bundle_commit(const struct ofpbuf *msg)
+{
+    const struct ofp_header *oh = msg->data;
+    struct ofputil_bundle_ctrl_msg bc;
+    enum ofptype type;
+
+    return (!ofptype_decode(&type, oh)
+            && type == OFPTYPE_BUNDLE_CONTROL
+            && !ofputil_decode_bundle_ctrl(oh, &bc)
+            && bc.type == OFPBCT_COMMIT_REQUEST);
+}
+
+/* Sends the messages in 'pending_msgs' to the switch.  If the size of
+ * bundles is limited, stops after the first bundle commit, the remaining
+ * messages are sent when the switch replies to it. */
+static void
+ofctrl_send_pending_msgs(void)
+{
+    struct ofpbuf *msg;
+    LIST_FOR_EACH_POP (msg, list_node, &pending_msgs) {
+        bool wait_reply = (bundle_max_flows && is_bundle_commit(msg)
+                           && !ovs_list_is_empty(&pending_msgs));
+        ovs_be32 xid_ = queue_msg(msg);
+        if (wait_reply) {
+            OVN_USDT_PROBE(ofctrl, bundle_commit_send, ntohl(xid_));
+            bundle_commit_in_flight = true;
+            bundle_commit_xid = xid_;
+            return;
+        }
+    }
+}
+
 bool
 ofctrl_has_backlog(void)
 {
     if (rconn_packet_counter_n_packets(tx_counter)
+        || !ovs_list_is_empty(&pending_msgs)
         || rconn_get_version(swconn) < 0) {
         return true;
     }
@@ -2538,28 +3448,38 @@ ofctrl_can_put(void)
 /* Replaces the flow table on the switch, if possible, by the flows added
  * with ofctrl_add_flow().
  *
+ * If external_ids:ovn-ofctrl-prioritize-new-ports is enabled, the flows of
+ * the 'n_new_pb_uuids' port bindings in 'new_pb_uuids', which are the ones
+ * that were just bound, are sent to the switch before the other changes.
+ *
  * Replaces the group table and meter table on the switch, if possible,
- * by the contents of '->desired'.
+ * by the contents of '->desired'.  The bands of the installed meters are only
+ * compared against the SB, looked up in 'sbrec_meter_by_name', for the meters
+ * recorded by ofctrl_meters_track().
  *
  * Sends conntrack flush messages to each zone in 'pending_ct_zones' that
  * is in the CT_ZONE_OF_QUEUED state and then moves the zone into the
- * CT_ZONE_OF_SENT state.
+ * CT_ZONE_OF_SENT state.  If external_ids:ovn-ofctrl-ct-flush-batch-size is
+ * set, at most that many zones are flushed at once, and only when the
+ * previous flushes completed.
  *
  * This should be called after ofctrl_run() within the main loop. */
 void
 ofctrl_put(struct ovn_desired_flow_table *lflow_table,
            struct ovn_desired_flow_table *pflow_table,
            struct shash *pending_ct_zones,
-           const struct sbrec_meter_table *meter_table,
+           struct ovsdb_idl_index *sbrec_meter_by_name,
            uint64_t req_cfg,
            bool lflows_changed,
-           bool pflows_changed)
+           bool pflows_changed,
+           const struct uuid *new_pb_uuids,
+           size_t n_new_pb_uuids)
 {
     static bool skipped_last_time = false;
     static uint64_t old_req_cfg = 0;
     bool need_put = false;
     if (lflows_changed || pflows_changed || skipped_last_time ||
-        ofctrl_initial_clear) {
+        ofctrl_initial_clear || flows_dumped || ct_flush_n_queued) {
         need_put = true;
         old_req_cfg = req_cfg;
     } else if (req_cfg != old_req_cfg) {
@@ -2591,16 +3511,39 @@ ofctrl_put(struct ovn_desired_flow_table *lflow_table,
     /* OpenFlow messages to send to the switch to bring it up-to-date. */
     struct ovs_list msgs = OVS_LIST_INITIALIZER(&msgs);
 
-    /* Iterate through ct zones that need to be flushed. */
+    /* Iterate through ct zones that need to be flushed, in batches of
+     * limited size if so configured. */
     struct shash_node *iter;
+    size_t n_queued = 0, n_in_flight = 0;
     SHASH_FOR_EACH(iter, pending_ct_zones) {
-        struct ct_zone_pending_entry *ctzpe = iter->data;
+        const struct ct_zone_pending_entry *ctzpe = iter->data;
         if (ctzpe->state == CT_ZONE_OF_QUEUED) {
-            add_ct_flush_zone(ctzpe->zone, &msgs);
-            ctzpe->state = CT_ZONE_OF_SENT;
-            ctzpe->of_xid = 0;
+            n_queued++;
+        } else if (ctzpe->state == CT_ZONE_OF_SENT) {
+            n_in_flight++;
+        }
+    }
+    size_t n_flushes = n_queued;
+    if (ct_flush_batch_size) {
+        n_flushes = n_in_flight ? 0 : MIN(n_queued, ct_flush_batch_size);
+    }
+    if (n_flushes) {
+        size_t n_sent = 0;
+        SHASH_FOR_EACH(iter, pending_ct_zones) {
+            struct ct_zone_pending_entry *ctzpe = iter->data;
+            if (ctzpe->state == CT_ZONE_OF_QUEUED) {
+                add_ct_flush_zone(ctzpe->zone, &msgs);
+                ctzpe->state = CT_ZONE_OF_SENT;
+                ctzpe->of_xid = 0;
+                if (++n_sent == n_flushes) {
+                    break;
+                }
+            }
         }
+        ct_flush_stats.n_batches++;
     }
+    ct_flush_n_queued = n_queued - n_flushes;
+    ct_flush_n_in_flight = n_in_flight + n_flushes;
 
     if (ofctrl_initial_clear) {
         /* Send a meter_mod to delete all meters.
@@ -2615,37 +3558,57 @@ ofctrl_put(struct ovn_desired_flow_table *lflow_table,
         add_meter_mod(&mm, &msgs);
     }
 
-    /* Iterate through all the desired meters. If there are new ones,
-     * add them to the switch. */
-    struct ovn_extend_table_info *m_desired;
-    HMAP_FOR_EACH (m_desired, hmap_node, &meters->desired) {
-        struct ovn_extend_table_info *m_existing =
-            ovn_extend_table_lookup(&meters->existing, m_desired);
-        if (!m_existing) {
-            if (!strncmp(m_desired->name, "__string: ", 10)) {
-                /* The "set-meter" action creates a meter entry name that
-                 * describes the meter itself. */
-                add_meter_string(m_desired, &msgs);
-            } else {
-                add_meter(m_desired, meter_table, &msgs);
-            }
+    /* Iterate through the desired meters added since the last sync and add
+     * them to the switch. */
+    struct hmapx_node *node;
+    EXTEND_TABLE_FOR_EACH_UNINSTALLED (node, meters) {
+        struct ovn_extend_table_info *m_desired = node->data;
+        if (!strncmp(m_desired->name, "__string: ", 10)) {
+            /* The "set-meter" action creates a meter entry name that
+             * describes the meter itself. */
+            add_meter_string(m_desired, &msgs);
         } else {
-            ofctrl_meter_bands_sync(m_existing, meter_table, &msgs);
+            add_meter(m_desired, sbrec_meter_by_name, &msgs);
         }
     }
 
-    /* Add all flow updates into a bundle. */
-    static int bundle_id = 0;
+    /* Bring the bands of the installed meters up-to-date with their SB
+     * counterpart, only for the meters that changed in the SB. */
+    if (meters_full_sync) {
+        struct ovn_extend_table_info *m_existing;
+        HMAP_FOR_EACH (m_existing, hmap_node, &meters->existing) {
+            if (strncmp(m_existing->name, "__string: ", 10)
+                && ovn_extend_table_lookup(&meters->desired, m_existing)) {
+                ofctrl_meter_bands_sync(m_existing, sbrec_meter_by_name,
+                                        &msgs);
+            }
+        }
+    } else {
+        const char *name;
+        SSET_FOR_EACH (name, &meters_changed) {
+            struct ovn_extend_table_info *m_desired =
+                ovn_extend_table_desired_lookup_by_name(meters, name);
+            struct ovn_extend_table_info *m_existing = m_desired
+                ? ovn_extend_table_lookup(&meters->existing, m_desired)
+                : NULL;
+            if (m_existing) {
+                ofctrl_meter_bands_sync(m_existing, sbrec_meter_by_name,
+                                        &msgs);
+            }
+        }
+    }
+    sset_clear(&meters_changed);
+    meters_full_sync = false;
+
+    /* Add all flow updates into a bundle, or into several ones if their size
+     * is limited.  The update that replaces all the flows after a
+     * (re)connection is never split, otherwise the switch would have no flows
+     * until all the bundles are committed. */
     struct ofputil_bundle_ctrl_msg bc = {
-        .bundle_id = bundle_id++,
-        .flags     = OFPBF_ORDERED | OFPBF_ATOMIC,
+        .flags = OFPBF_ORDERED | OFPBF_ATOMIC,
     };
-    struct ofpbuf *bundle_open, *bundle_commit;
-
-    /* Open a new bundle. */
-    bc.type = OFPBCT_OPEN_REQUEST;
-    bundle_open = ofputil_encode_bundle_ctrl_request(OFP15_VERSION, &bc);
-    ovs_list_push_back(&msgs, &bundle_open->list_node);
+    bundle_split = bundle_max_flows && !ofctrl_initial_clear;
+    bundle_open(&bc, &msgs);
 
     if (ofctrl_initial_clear) {
         /* Send a flow_mod to delete all flows. */
@@ -2670,10 +3633,10 @@ ofctrl_put(struct ovn_desired_flow_table *lflow_table,
         ofctrl_initial_clear = false;
     }
 
-    /* Iterate through all the desired groups. If there are new ones,
-     * add them to the switch. */
-    struct ovn_extend_table_info *desired;
-    EXTEND_TABLE_FOR_EACH_UNINSTALLED (desired, groups) {
+    /* Iterate through the desired groups added since the last sync. If
+     * there are new ones, add them to the switch. */
+    EXTEND_TABLE_FOR_EACH_UNINSTALLED (node, groups) {
+        struct ovn_extend_table_info *desired = node->data;
         /* Create and install new group. */
         struct ofputil_group_mod gm;
         enum ofputil_protocol usable_protocols;
@@ -2693,39 +3656,75 @@ ofctrl_put(struct ovn_desired_flow_table *lflow_table,
         ofputil_uninit_group_mod(&gm);
     }
 
+    if (!prioritize_new_ports) {
+        n_new_pb_uuids = 0;
+    }
+
+    /* If the installed flows were just dumped from the switch, compare them
+     * all to the desired ones, after applying the pending tracked changes, if
+     * any. */
+    bool reconcile = flows_dumped;
+    if (reconcile) {
+        ofctrl_assign_dumped_flows(pflow_table);
+        if (lflow_table->change_tracked) {
+            update_installed_flows_by_track(lflow_table, &bc,
+                                            &installed_lflows,
+                                            new_pb_uuids, n_new_pb_uuids,
+                                            &msgs);
+        }
+        update_installed_flows_by_compare(lflow_table, &bc,
+                                          &installed_lflows,
+                                          new_pb_uuids, n_new_pb_uuids,
+                                          &msgs);
+        if (pflow_table->change_tracked) {
+            update_installed_flows_by_track(pflow_table, &bc,
+                                            &installed_pflows,
+                                            new_pb_uuids, n_new_pb_uuids,
+                                            &msgs);
+        }
+        update_installed_flows_by_compare(pflow_table, &bc,
+                                          &installed_pflows,
+                                          new_pb_uuids, n_new_pb_uuids,
+                                          &msgs);
+    }
+
     /* If skipped last time, then process the flow table
      * (tracked) flows even if lflows_changed is not set.
      * Same for pflows_changed. */
-    if (lflows_changed || skipped_last_time) {
+    if (!reconcile && (lflows_changed || skipped_last_time)) {
         if (lflow_table->change_tracked) {
             update_installed_flows_by_track(lflow_table, &bc,
                                             &installed_lflows,
+                                            new_pb_uuids, n_new_pb_uuids,
                                             &msgs);
         } else {
             update_installed_flows_by_compare(lflow_table, &bc,
                                               &installed_lflows,
+                                              new_pb_uuids, n_new_pb_uuids,
                                               &msgs);
         }
     }
 
-    if (pflows_changed || skipped_last_time) {
+    if (!reconcile && (pflows_changed || skipped_last_time)) {
         if (pflow_table->change_tracked) {
             update_installed_flows_by_track(pflow_table, &bc,
                                             &installed_pflows,
+                                            new_pb_uuids, n_new_pb_uuids,
                                             &msgs);
         } else {
             update_installed_flows_by_compare(pflow_table, &bc,
                                               &installed_pflows,
+                                              new_pb_uuids, n_new_pb_uuids,
                                               &msgs);
         }
     }
 
     skipped_last_time = false;
 
-    /* Iterate through the installed groups from previous runs. If they
-     * are not needed delete them. */
-    struct ovn_extend_table_info *installed;
-    EXTEND_TABLE_FOR_EACH_INSTALLED (installed, groups) {
+    /* Iterate through the installed groups that lost their desired
+     * counterpart since the last sync. If they are not needed delete them. */
+    EXTEND_TABLE_FOR_EACH_INSTALLED (node, groups) {
+        struct ovn_extend_table_info *installed = node->data;
         /* Delete the group. */
         struct ofputil_group_mod gm;
         enum ofputil_protocol usable_protocols;
@@ -2747,24 +3746,15 @@ ofctrl_put(struct ovn_desired_flow_table *lflow_table,
         ovn_extend_table_remove_existing(groups, installed);
     }
 
-    if (ovs_list_back(&msgs) == &bundle_open->list_node) {
-        /* No flow updates.  Removing the bundle open request. */
-        ovs_list_pop_back(&msgs);
-        ofpbuf_delete(bundle_open);
-    } else {
-        /* Committing the bundle. */
-        bc.type = OFPBCT_COMMIT_REQUEST;
-        bundle_commit = ofputil_encode_bundle_ctrl_request(OFP15_VERSION, &bc);
-        ovs_list_push_back(&msgs, &bundle_commit->list_node);
-    }
+    bundle_commit(&bc, &msgs);
 
     /* Sync the contents of groups->desired to groups->existing. */
     ovn_extend_table_sync(groups);
 
-    /* Iterate through the installed meters from previous runs. If they
-     * are not needed delete them. */
-    struct ovn_extend_table_info *m_installed;
-    EXTEND_TABLE_FOR_EACH_INSTALLED (m_installed, meters) {
+    /* Iterate through the installed meters that lost their desired
+     * counterpart since the last sync. If they are not needed delete them. */
+    EXTEND_TABLE_FOR_EACH_INSTALLED (node, meters) {
+        struct ovn_extend_table_info *m_installed = node->data;
         /* Delete the meter. */
         ofctrl_meter_bands_erase(m_installed, &msgs);
         if (!strncmp(m_installed->name, "__string: ", 10)) {
@@ -2788,10 +3778,9 @@ ofctrl_put(struct ovn_desired_flow_table *lflow_table,
         ovs_list_push_back(&msgs, &barrier->list_node);
 
         /* Queue the messages. */
-        struct ofpbuf *msg;
-        LIST_FOR_EACH_POP (msg, list_node, &msgs) {
-            queue_msg(msg);
-        }
+        OVN_USDT_PROBE(ofctrl, put_send, ntohl(xid_), req_cfg);
+        ovs_list_push_back_all(&pending_msgs, &msgs);
+        ofctrl_send_pending_msgs();
 
         /* Store the barrier's xid with any newly sent ct flushes. */
         SHASH_FOR_EACH(iter, pending_ct_zones) {
@@ -2855,6 +3844,40 @@ ofctrl_put(struct ovn_desired_flow_table *lflow_table,
     ovs_assert(ovs_list_is_empty(&pflow_table->tracked_flows));
 }
 
+/* Brings the installed logical flows up-to-date with 'flow_table', by its
+ * tracked changes or by comparing the tables, the same way ofctrl_put()
+ * does, but discards the resulting OpenFlow messages instead of sending
+ * them to the switch.  Returns the number of messages.
+ *
+ * This is only meant for the tests and benchmarks of the flow table
+ * reconciliation, which run without a connection to a switch. */
+size_t
+ofctrl_sync_flows_for_test(struct ovn_desired_flow_table *flow_table)
+{
+    struct ovs_list msgs = OVS_LIST_INITIALIZER(&msgs);
+    struct ofputil_bundle_ctrl_msg bc = {
+        .flags = OFPBF_ORDERED | OFPBF_ATOMIC,
+    };
+
+    bundle_split = false;
+    bundle_open(&bc, &msgs);
+    if (flow_table->change_tracked) {
+        update_installed_flows_by_track(flow_table, &bc, &installed_lflows,
+                                        NULL, 0, &msgs);
+    } else {
+        update_installed_flows_by_compare(flow_table, &bc, &installed_lflows,
+                                          NULL, 0, &msgs);
+    }
+    bundle_commit(&bc, &msgs);
+
+    size_t n_msgs = ovs_list_size(&msgs);
+    ofpbuf_list_delete(&msgs);
+
+    flow_table->change_tracked = true;
+    ovs_assert(ovs_list_is_empty(&flow_table->tracked_flows));
+    return n_msgs;
+}
+
 /* Looks up the logical port with the name 'port_name' in 'br_int_'.  If
  * found, returns true and sets '*portp' to the OpenFlow port number
  * assigned to the port.  Otherwise, returns false. */
@@ -2964,6 +3987,30 @@ ofctrl_set_probe_interval(int probe_interval)
     }
 }
 
+/* Appends to 'ds' the backlog of conntrack zone flushes and the statistics
+ * of the completed ones. */
+void
+ofctrl_ct_flush_get_stats(struct ds *ds)
+{
+    const struct ct_flush_stats *stats = &ct_flush_stats;
+
+    ds_put_format(ds, "Batch size: %u\n", ct_flush_batch_size);
+    ds_put_format(ds, "Queued zones: %"PRIuSIZE"\n", ct_flush_n_queued);
+    ds_put_format(ds, "Flushes in flight: %"PRIuSIZE"\n",
+                  ct_flush_n_in_flight);
+    ds_put_format(ds, "Batches sent: %"PRIu64"\n", stats->n_batches);
+    ds_put_format(ds, "Time to flush (ms): count %"PRIu64", avg %"PRIu64
+                  ", max %"PRIu64"\n", stats->n_flushes,
+                  stats->n_flushes ? stats->total_msec / stats->n_flushes : 0,
+                  stats->max_msec);
+}
+
+void
+ofctrl_ct_flush_clear_stats(void)
+{
+    memset(&ct_flush_stats, 0, sizeof ct_flush_stats);
+}
+
 void
 ofctrl_get_memory_usage(struct simap *usage)
 {
@@ -2973,6 +4020,8 @@ ofctrl_get_memory_usage(struct simap *usage)
                    ROUND_UP(mem_stats.desired_flow_usage, 1024) / 1024);
     simap_increase(usage, "ofctrl_installed_flow_usage-KB",
                    ROUND_UP(mem_stats.installed_flow_usage, 1024) / 1024);
+    simap_increase(usage, "ofctrl_flow_data_usage-KB",
+                   ROUND_UP(mem_stats.flow_data_usage, 1024) / 1024);
     simap_increase(usage, "oflow_update_usage-KB",
                    ROUND_UP(mem_stats.oflow_update_usage, 1024) / 1024);
     simap_increase(usage, "ofctrl_rconn_packet_counter-KB",
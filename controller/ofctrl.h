@@ -23,12 +23,16 @@
 #include "ovsdb-idl.h"
 #include "hindex.h"
 
+struct conj_ids;
+struct ds;
 struct ovn_extend_table;
 struct hmap;
 struct match;
 struct ofpbuf;
+struct ovsdb_idl_index;
 struct ovsrec_bridge;
 struct ovsrec_open_vswitch_table;
+struct sbrec_meter_band_table;
 struct sbrec_meter_table;
 struct shash;
 
@@ -57,14 +61,19 @@ enum mf_field_id ofctrl_get_mf_field_id(void);
 void ofctrl_put(struct ovn_desired_flow_table *lflow_table,
                 struct ovn_desired_flow_table *pflow_table,
                 struct shash *pending_ct_zones,
-                const struct sbrec_meter_table *,
+                struct ovsdb_idl_index *sbrec_meter_by_name,
                 uint64_t nb_cfg,
                 bool lflow_changed,
-                bool pflow_changed);
+                bool pflow_changed,
+                const struct uuid *new_pb_uuids,
+                size_t n_new_pb_uuids);
+void ofctrl_meters_track(const struct sbrec_meter_table *,
+                         const struct sbrec_meter_band_table *);
 bool ofctrl_has_backlog(void);
 void ofctrl_wait(void);
 void ofctrl_destroy(void);
 uint64_t ofctrl_get_cur_cfg(void);
+void ofctrl_save_snapshot(void);
 
 void ofctrl_ct_flush_zone(uint16_t zone_id);
 
@@ -129,7 +138,8 @@ void ofctrl_flood_remove_add_node(struct hmap *flood_remove_nodes,
 bool ofctrl_remove_flows_for_as_ip(struct ovn_desired_flow_table *,
                                    const struct uuid *lflow_uuid,
                                    const struct addrset_info *,
-                                   size_t expected_count);
+                                   size_t expected_count,
+                                   struct conj_ids *);
 
 void ovn_desired_flow_table_init(struct ovn_desired_flow_table *);
 void ovn_desired_flow_table_clear(struct ovn_desired_flow_table *);
@@ -148,4 +158,9 @@ bool ofctrl_is_connected(void);
 void ofctrl_set_probe_interval(int probe_interval);
 void ofctrl_get_memory_usage(struct simap *usage);
 
+void ofctrl_ct_flush_get_stats(struct ds *);
+void ofctrl_ct_flush_clear_stats(void);
+
+size_t ofctrl_sync_flows_for_test(struct ovn_desired_flow_table *);
+
 #endif /* controller/ofctrl.h */
@@ -33,6 +33,7 @@
 #include "openvswitch/dynamic-string.h"
 #include "encaps.h"
 #include "fatal-signal.h"
+#include "ha-chassis.h"
 #include "lib/id-pool.h"
 #include "if-status.h"
 #include "ip-mcast.h"
@@ -49,6 +50,7 @@
 #include "openvswitch/vconn.h"
 #include "openvswitch/vlog.h"
 #include "ovn/actions.h"
+#include "ovn/expr.h"
 #include "ovn/features.h"
 #include "lib/chassis-index.h"
 #include "lib/extend-table.h"
@@ -69,6 +71,7 @@
 #include "sset.h"
 #include "stream-ssl.h"
 #include "stream.h"
+#include "svec.h"
 #include "unixctl.h"
 #include "util.h"
 #include "timeval.h"
@@ -92,6 +95,16 @@ static unixctl_cb_func debug_dump_local_bindings;
 static unixctl_cb_func debug_dump_lflow_conj_ids;
 static unixctl_cb_func lflow_cache_flush_cmd;
 static unixctl_cb_func lflow_cache_show_stats_cmd;
+static unixctl_cb_func bfd_show_stats_cmd;
+static unixctl_cb_func sb_monitor_show_stats_cmd;
+static unixctl_cb_func if_status_mgr_show_stats_cmd;
+static unixctl_cb_func if_status_mgr_clear_stats_cmd;
+static unixctl_cb_func ct_flush_show_stats_cmd;
+static unixctl_cb_func ct_flush_clear_stats_cmd;
+static unixctl_cb_func coalesce_show_stats_cmd;
+static unixctl_cb_func coalesce_clear_stats_cmd;
+static unixctl_cb_func ofctrl_latency_show_cmd;
+static unixctl_cb_func ofctrl_latency_clear_cmd;
 static unixctl_cb_func debug_delay_nb_cfg_report;
 
 #define DEFAULT_BRIDGE_NAME "br-int"
@@ -146,12 +159,16 @@ struct pending_pkt {
 /* Registered ofctrl seqno type for nb_cfg propagation. */
 static size_t ofctrl_seq_type_nb_cfg;
 
+/* Southbound monitoring mode last set by update_sb_monitors(), reported by
+ * "sb-monitor/show-stats". */
+static const char *sb_monitor_mode = "conditional";
+
 static unsigned int
 update_sb_monitors(struct ovsdb_idl *ovnsb_idl,
                    const struct sbrec_chassis *chassis,
                    const struct sset *local_ifaces,
                    struct hmap *local_datapaths,
-                   bool monitor_all)
+                   bool monitor_all, bool monitor_local_only)
 {
     /* Monitor Port_Bindings rows for local interfaces and local datapaths.
      *
@@ -167,17 +184,27 @@ update_sb_monitors(struct ovsdb_idl *ovnsb_idl,
      * We always monitor patch ports because they allow us to see the linkages
      * between related logical datapaths.  That way, when we know that we have
      * a VIF on a particular logical switch, we immediately know to monitor all
-     * the connected logical routers and logical switches. */
+     * the connected logical routers and logical switches.
+     *
+     * With 'monitor_local_only', FDB and Load_Balancer are also limited to
+     * the local datapaths, and instead of all the patch ports only the peers
+     * of the patch ports of the local datapaths are monitored.  The connected
+     * datapaths are then discovered one hop per condition change instead of
+     * immediately, in exchange for not downloading the patch ports of the
+     * whole deployment. */
     struct ovsdb_idl_condition pb = OVSDB_IDL_CONDITION_INIT(&pb);
     struct ovsdb_idl_condition lf = OVSDB_IDL_CONDITION_INIT(&lf);
     struct ovsdb_idl_condition ldpg = OVSDB_IDL_CONDITION_INIT(&ldpg);
     struct ovsdb_idl_condition mb = OVSDB_IDL_CONDITION_INIT(&mb);
+    struct ovsdb_idl_condition smb = OVSDB_IDL_CONDITION_INIT(&smb);
     struct ovsdb_idl_condition mg = OVSDB_IDL_CONDITION_INIT(&mg);
     struct ovsdb_idl_condition dns = OVSDB_IDL_CONDITION_INIT(&dns);
     struct ovsdb_idl_condition ce =  OVSDB_IDL_CONDITION_INIT(&ce);
     struct ovsdb_idl_condition ip_mcast = OVSDB_IDL_CONDITION_INIT(&ip_mcast);
     struct ovsdb_idl_condition igmp = OVSDB_IDL_CONDITION_INIT(&igmp);
     struct ovsdb_idl_condition chprv = OVSDB_IDL_CONDITION_INIT(&chprv);
+    struct ovsdb_idl_condition fdb = OVSDB_IDL_CONDITION_INIT(&fdb);
+    struct ovsdb_idl_condition lb = OVSDB_IDL_CONDITION_INIT(&lb);
 
     /* Always monitor all logical datapath groups. Otherwise, DPG updates may
      * be received *after* the lflows using it are seen by ovn-controller.
@@ -189,16 +216,27 @@ update_sb_monitors(struct ovsdb_idl *ovnsb_idl,
         ovsdb_idl_condition_add_clause_true(&pb);
         ovsdb_idl_condition_add_clause_true(&lf);
         ovsdb_idl_condition_add_clause_true(&mb);
+        ovsdb_idl_condition_add_clause_true(&smb);
         ovsdb_idl_condition_add_clause_true(&mg);
         ovsdb_idl_condition_add_clause_true(&dns);
         ovsdb_idl_condition_add_clause_true(&ce);
         ovsdb_idl_condition_add_clause_true(&ip_mcast);
         ovsdb_idl_condition_add_clause_true(&igmp);
         ovsdb_idl_condition_add_clause_true(&chprv);
+        ovsdb_idl_condition_add_clause_true(&fdb);
+        ovsdb_idl_condition_add_clause_true(&lb);
+        sb_monitor_mode = "all";
         goto out;
     }
 
-    sbrec_port_binding_add_clause_type(&pb, OVSDB_F_EQ, "patch");
+    if (monitor_local_only) {
+        sb_monitor_mode = "local-only";
+    } else {
+        sbrec_port_binding_add_clause_type(&pb, OVSDB_F_EQ, "patch");
+        ovsdb_idl_condition_add_clause_true(&fdb);
+        ovsdb_idl_condition_add_clause_true(&lb);
+        sb_monitor_mode = "conditional";
+    }
     /* XXX: We can optimize this, if we find a way to only monitor
      * ports that have a Gateway_Chassis that point's to our own
      * chassis */
@@ -255,10 +293,32 @@ update_sb_monitors(struct ovsdb_idl *ovnsb_idl,
             sbrec_logical_flow_add_clause_logical_datapath(&lf, OVSDB_F_EQ,
                                                            uuid);
             sbrec_mac_binding_add_clause_datapath(&mb, OVSDB_F_EQ, uuid);
+            sbrec_static_mac_binding_add_clause_datapath(&smb, OVSDB_F_EQ,
+                                                         uuid);
             sbrec_multicast_group_add_clause_datapath(&mg, OVSDB_F_EQ, uuid);
             sbrec_dns_add_clause_datapaths(&dns, OVSDB_F_INCLUDES, &uuid, 1);
             sbrec_ip_multicast_add_clause_datapath(&ip_mcast, OVSDB_F_EQ,
                                                    uuid);
+            if (monitor_local_only) {
+                sbrec_fdb_add_clause_dp_key(&fdb, OVSDB_F_EQ,
+                                            ld->datapath->tunnel_key);
+                sbrec_load_balancer_add_clause_datapaths(&lb, OVSDB_F_INCLUDES,
+                                                         &uuid, 1);
+            }
+        }
+
+        if (monitor_local_only) {
+            const struct sbrec_port_binding *patch;
+            SBREC_PORT_BINDING_FOR_EACH (patch, ovnsb_idl) {
+                const char *peer = smap_get(&patch->options, "peer");
+                if (peer && patch->datapath && !strcmp(patch->type, "patch")
+                    && get_local_datapath(local_datapaths,
+                                          patch->datapath->tunnel_key)) {
+                    sbrec_port_binding_add_clause_logical_port(&pb,
+                                                               OVSDB_F_EQ,
+                                                               peer);
+                }
+            }
         }
 
         /* Datapath groups are immutable, which means a new group record is
@@ -278,12 +338,15 @@ out:;
         sbrec_logical_flow_set_condition(ovnsb_idl, &lf),
         sbrec_logical_dp_group_set_condition(ovnsb_idl, &ldpg),
         sbrec_mac_binding_set_condition(ovnsb_idl, &mb),
+        sbrec_static_mac_binding_set_condition(ovnsb_idl, &smb),
         sbrec_multicast_group_set_condition(ovnsb_idl, &mg),
         sbrec_dns_set_condition(ovnsb_idl, &dns),
         sbrec_controller_event_set_condition(ovnsb_idl, &ce),
         sbrec_ip_multicast_set_condition(ovnsb_idl, &ip_mcast),
         sbrec_igmp_group_set_condition(ovnsb_idl, &igmp),
         sbrec_chassis_private_set_condition(ovnsb_idl, &chprv),
+        sbrec_fdb_set_condition(ovnsb_idl, &fdb),
+        sbrec_load_balancer_set_condition(ovnsb_idl, &lb),
     };
 
     unsigned int expected_cond_seqno = 0;
@@ -295,12 +358,15 @@ out:;
     ovsdb_idl_condition_destroy(&lf);
     ovsdb_idl_condition_destroy(&ldpg);
     ovsdb_idl_condition_destroy(&mb);
+    ovsdb_idl_condition_destroy(&smb);
     ovsdb_idl_condition_destroy(&mg);
     ovsdb_idl_condition_destroy(&dns);
     ovsdb_idl_condition_destroy(&ce);
     ovsdb_idl_condition_destroy(&ip_mcast);
     ovsdb_idl_condition_destroy(&igmp);
     ovsdb_idl_condition_destroy(&chprv);
+    ovsdb_idl_condition_destroy(&fdb);
+    ovsdb_idl_condition_destroy(&lb);
     return expected_cond_seqno;
 }
 
@@ -522,11 +588,87 @@ get_ofctrl_probe_interval(struct ovsdb_idl *ovs_idl)
                                OFCTRL_DEFAULT_PROBE_INTERVAL_SEC);
 }
 
+/* Coalescing of the main loop wakeups, see
+ * external_ids:ovn-coalesce-max-delay-ms.
+ *
+ * When the runs that process changes of the databases follow each other
+ * within COALESCE_BURST_MSEC, or within twice the current delay, the next
+ * run is held back by 'delay' msec so that the changes received in the
+ * meantime are processed together.  The delay starts at 1 msec and doubles
+ * for as long as the burst lasts, up to 'max_delay'.  It is halved by each
+ * run that processes changes outside of a burst, and reset once no change
+ * was processed for 'max_delay' msec. */
+#define COALESCE_BURST_MSEC 10
+#define COALESCE_MAX_DELAY_MSEC 1000
+
+static struct {
+    unsigned int max_delay;     /* Configured maximum, 0 disables. */
+    unsigned int delay;         /* Current delay. */
+    long long int last_change;  /* End of the last run with changes. */
+    long long int hold_until;   /* Runs are held back until then. */
+
+    /* Statistics. */
+    uint64_t n_runs;            /* Runs that processed changes. */
+    uint64_t n_holds;           /* Runs followed by a delay. */
+    uint64_t n_held_wakeups;    /* Wakeups that were held back. */
+    unsigned int peak_delay;
+} coalesce;
+
+static void
+coalesce_set_max_delay(unsigned int max_delay)
+{
+    coalesce.max_delay = MIN(max_delay, COALESCE_MAX_DELAY_MSEC);
+    coalesce.delay = MIN(coalesce.delay, coalesce.max_delay);
+}
+
+/* Returns true if this main loop iteration has to be held back, in which
+ * case it arranges for the poll loop to wake up once the delay expires. */
+static bool
+coalesce_hold(void)
+{
+    if (!coalesce.delay || time_msec() >= coalesce.hold_until) {
+        return false;
+    }
+    coalesce.n_held_wakeups++;
+    poll_timer_wait_until(coalesce.hold_until);
+    return true;
+}
+
+/* Adapts the delay at the end of a main loop iteration, which processed
+ * changes of the databases if 'changed' is true. */
+static void
+coalesce_run(bool changed)
+{
+    long long int now = time_msec();
+
+    if (!changed) {
+        if (now - coalesce.last_change > coalesce.max_delay) {
+            coalesce.delay = 0;
+        }
+        return;
+    }
+
+    coalesce.n_runs++;
+    if (coalesce.max_delay && now - coalesce.last_change
+                              < MAX(2 * coalesce.delay, COALESCE_BURST_MSEC)) {
+        coalesce.delay = MIN(MAX(2 * coalesce.delay, 1), coalesce.max_delay);
+    } else {
+        coalesce.delay /= 2;
+    }
+    if (coalesce.delay) {
+        coalesce.n_holds++;
+        coalesce.hold_until = now + coalesce.delay;
+        coalesce.peak_delay = MAX(coalesce.peak_delay, coalesce.delay);
+    }
+    coalesce.last_change = now;
+}
+
 /* Retrieves the pointer to the OVN Southbound database from 'ovs_idl' and
  * updates 'sbdb_idl' with that pointer. */
 static void
 update_sb_db(struct ovsdb_idl *ovs_idl, struct ovsdb_idl *ovnsb_idl,
-             bool *monitor_all_p, bool *reset_ovnsb_idl_min_index,
+             bool *monitor_all_p, bool *monitor_local_only_p,
+             bool *reset_ovnsb_idl_min_index,
              struct controller_engine_ctx *ctx,
              unsigned int *sb_cond_seqno)
 {
@@ -554,7 +696,7 @@ update_sb_db(struct ovsdb_idl *ovs_idl, struct ovsdb_idl *ovnsb_idl,
          * extra cost. Instead, it is called after the engine execution only
          * when it is necessary. */
         unsigned int next_cond_seqno =
-            update_sb_monitors(ovnsb_idl, NULL, NULL, NULL, true);
+            update_sb_monitors(ovnsb_idl, NULL, NULL, NULL, true, false);
         if (sb_cond_seqno) {
             *sb_cond_seqno = next_cond_seqno;
         }
@@ -562,6 +704,14 @@ update_sb_db(struct ovsdb_idl *ovs_idl, struct ovsdb_idl *ovnsb_idl,
     if (monitor_all_p) {
         *monitor_all_p = monitor_all;
     }
+    bool monitor_local_only = smap_get_bool(&cfg->external_ids,
+                                            "ovn-monitor-local-only", false);
+    if (monitor_local_only_p && *monitor_local_only_p != monitor_local_only) {
+        /* Force a recompute so that the monitor conditions get updated with
+         * the new mode after the engine run. */
+        engine_set_force_recompute(true);
+        *monitor_local_only_p = monitor_local_only;
+    }
     if (reset_ovnsb_idl_min_index && *reset_ovnsb_idl_min_index) {
         VLOG_INFO("Resetting southbound database cluster state");
         engine_set_force_recompute(true);
@@ -588,7 +738,52 @@ update_sb_db(struct ovsdb_idl *ovs_idl, struct ovsdb_idl *ovnsb_idl,
                                          DEFAULT_LFLOW_CACHE_WMARK_PERC),
                            smap_get_uint(&cfg->external_ids,
                                          "ovn-trim-timeout-ms",
-                                         DEFAULT_LFLOW_CACHE_TRIM_TO_MS));
+                                         DEFAULT_LFLOW_CACHE_TRIM_TO_MS),
+                           smap_get_bool(&cfg->external_ids,
+                                         "ovn-pack-lflow-cache",
+                                         false),
+                           smap_get_bool(&cfg->external_ids,
+                                         "ovn-lflow-cache-by-content",
+                                         false));
+        lflow_set_n_threads(smap_get_uint(&cfg->external_ids,
+                                          "ovn-lflow-n-threads", 1));
+        engine_set_n_threads(smap_get_uint(&cfg->external_ids,
+                                           "ovn-engine-n-threads", 1));
+        lflow_set_run_slice(smap_get_uint(&cfg->external_ids,
+                                          "ovn-lflow-recompute-slice-ms", 0));
+        coalesce_set_max_delay(smap_get_uint(&cfg->external_ids,
+                                             "ovn-coalesce-max-delay-ms", 0));
+        pinctrl_set_n_threads(smap_get_uint(&cfg->external_ids,
+                                            "ovn-pinctrl-n-threads", 1));
+        pinctrl_set_mac_binding_rate_limit(
+            smap_get_uint(&cfg->external_ids, "ovn-mac-binding-rate-limit",
+                          0));
+        pinctrl_set_mac_binding_limits(
+            smap_get_uint(&cfg->external_ids, "ovn-mac-binding-idle-timeout",
+                          0),
+            smap_get_uint(&cfg->external_ids,
+                          "ovn-mac-binding-max-per-datapath", 0));
+        pinctrl_set_fdb_limits(
+            smap_get_uint(&cfg->external_ids, "ovn-fdb-idle-timeout", 0),
+            smap_get_uint(&cfg->external_ids, "ovn-fdb-max-per-datapath",
+                          0));
+
+        /* Datapaths only become lazy, or stop being lazy, when the local
+         * datapaths are computed again. */
+        if (local_datapaths_set_lazy(
+                smap_get_bool(&cfg->external_ids, "ovn-lazy-peer-datapaths",
+                              false))) {
+            engine_set_force_recompute(true);
+        }
+
+        /* Flows generated with the previous setting, including the cached
+         * ones, have to be regenerated. */
+        if (expr_set_flow_optimization(
+                smap_get_bool(&cfg->external_ids,
+                              "ovn-optimize-expr-flows", false))) {
+            lflow_cache_flush(ctx->lflow_cache);
+            engine_set_force_recompute(true);
+        }
     }
 }
 
@@ -604,6 +799,7 @@ add_pending_ct_zone_entry(struct shash *pending_ct_zones,
     pending->state = state; /* Skip flushing zone. */
     pending->zone = zone;
     pending->add = add;
+    pending->queued_msec = time_msec();
 
     /* Its important that we add only one entry for the key 'name'.
      * Replace 'pending' with 'existing' and free up 'existing'.
@@ -623,12 +819,22 @@ alloc_id_to_ct_zone(const char *zone_name, struct simap *ct_zones,
                     unsigned long *ct_zone_bitmap, int *scan_start,
                     struct shash *pending_ct_zones)
 {
-    /* We assume that there are 64K zones and that we own them all. */
+    /* We assume that there are 64K zones and that we own them all.
+     *
+     * Zones are handed out next-fit from '*scan_start', which the caller
+     * keeps across calls, so that allocating a zone doesn't rescan all the
+     * zones that are already in use.  Zones freed below '*scan_start' are
+     * only reused once the end of the range is reached, which also avoids
+     * immediately handing out a zone whose conntrack entries may still be
+     * around. */
     int zone = bitmap_scan(ct_zone_bitmap, 0, *scan_start, MAX_CT_ZONES + 1);
     if (zone == MAX_CT_ZONES + 1) {
-        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
-        VLOG_WARN_RL(&rl, "exhausted all ct zones");
-        return false;
+        zone = bitmap_scan(ct_zone_bitmap, 0, 1, *scan_start);
+        if (zone == *scan_start) {
+            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
+            VLOG_WARN_RL(&rl, "exhausted all ct zones");
+            return false;
+        }
     }
 
     *scan_start = zone + 1;
@@ -651,15 +857,16 @@ static void
 update_ct_zones(const struct shash *binding_lports,
                 const struct hmap *local_datapaths,
                 struct simap *ct_zones, unsigned long *ct_zone_bitmap,
-                struct shash *pending_ct_zones)
+                int *scan_start, struct shash *pending_ct_zones)
 {
     struct simap_node *ct_zone;
-    int scan_start = 1;
     const char *user;
     struct sset all_users = SSET_INITIALIZER(&all_users);
     struct simap req_snat_zones = SIMAP_INITIALIZER(&req_snat_zones);
     unsigned long unreq_snat_zones[BITMAP_N_LONGS(MAX_CT_ZONES)];
 
+    memset(unreq_snat_zones, 0, sizeof unreq_snat_zones);
+
     struct shash_node *shash_node;
     SHASH_FOR_EACH (shash_node, binding_lports) {
         sset_add(&all_users, shash_node->name);
@@ -753,7 +960,7 @@ update_ct_zones(const struct shash *binding_lports,
             continue;
         }
 
-        alloc_id_to_ct_zone(user, ct_zones, ct_zone_bitmap, &scan_start,
+        alloc_id_to_ct_zone(user, ct_zones, ct_zone_bitmap, scan_start,
                             pending_ct_zones);
     }
 
@@ -982,7 +1189,9 @@ ctrl_register_ovs_idl(struct ovsdb_idl *ovs_idl)
     SB_NODE(load_balancer, "load_balancer") \
     SB_NODE(fdb, "fdb") \
     SB_NODE(meter, "meter") \
-    SB_NODE(static_mac_binding, "static_mac_binding")
+    SB_NODE(static_mac_binding, "static_mac_binding") \
+    SB_NODE(ha_chassis_group, "ha_chassis_group") \
+    SB_NODE(ha_chassis, "ha_chassis")
 
 enum sb_engine_node {
 #define SB_NODE(NAME, NAME_STR) SB_##NAME,
@@ -1155,6 +1364,9 @@ struct ed_type_runtime_data {
     struct sset egress_ifaces;
     struct smap local_iface_ids;
 
+    /* Lports bound locally whose claim is still to be written to the SB. */
+    struct sset postponed_ports;
+
     /* Tracked data. See below for more details and comments. */
     bool tracked;
     bool local_lports_changed;
@@ -1210,15 +1422,15 @@ struct ed_type_runtime_data {
  *  ---------------------------------------------------------------------
  * | local_iface_ids  | This is used internally within the runtime data  |
  * | egress_ifaces    | engine (used only in binding.c) and hence there  |
- * |                  | there is no need to track.                       |
+ * | postponed_ports  | there is no need to track.                       |
  *  ---------------------------------------------------------------------
  * |                  | Active tunnels is built in the                   |
  * |                  | bfd_calculate_active_tunnels() for the tunnel    |
- * |                  | OVS interfaces. Any changes to non VIF OVS       |
+ * |                  | OVS interfaces. Any changes to tunnel OVS        |
  * |                  | interfaces results in triggering the full        |
  * | active_tunnels   | recompute of runtime data engine and hence there |
  * |                  | the tracked data doesn't track it. When we       |
- * |                  | support handling changes to non VIF OVS          |
+ * |                  | support handling changes to tunnel OVS           |
  * |                  | interfaces we need to track the changes to the   |
  * |                  | active tunnels.                                  |
  *  ---------------------------------------------------------------------
@@ -1236,6 +1448,22 @@ en_runtime_data_clear_tracked_data(void *data_)
     data->tracked = false;
 }
 
+static void
+en_runtime_data_get_memory_usage(const void *data_, struct simap *usage)
+{
+    const struct ed_type_runtime_data *data = data_;
+
+    simap_increase(usage, "local_datapaths",
+                   hmap_count(&data->local_datapaths));
+    simap_increase(usage, "local_bindings",
+                   shash_count(&data->lbinding_data.bindings));
+    simap_increase(usage, "local_lports", sset_count(&data->local_lports));
+    simap_increase(usage, "related_lports",
+                   sset_count(&data->related_lports.lport_names));
+    simap_increase(usage, "local_iface_ids",
+                   smap_count(&data->local_iface_ids));
+}
+
 static void *
 en_runtime_data_init(struct engine_node *node OVS_UNUSED,
                      struct engine_arg *arg OVS_UNUSED)
@@ -1248,6 +1476,7 @@ en_runtime_data_init(struct engine_node *node OVS_UNUSED,
     sset_init(&data->active_tunnels);
     sset_init(&data->egress_ifaces);
     smap_init(&data->local_iface_ids);
+    sset_init(&data->postponed_ports);
     local_binding_data_init(&data->lbinding_data);
     shash_init(&data->local_active_ports_ipv6_pd);
     shash_init(&data->local_active_ports_ras);
@@ -1268,6 +1497,7 @@ en_runtime_data_cleanup(void *data)
     sset_destroy(&rt_data->active_tunnels);
     sset_destroy(&rt_data->egress_ifaces);
     smap_destroy(&rt_data->local_iface_ids);
+    sset_destroy(&rt_data->postponed_ports);
     local_datapaths_destroy(&rt_data->local_datapaths);
     shash_destroy_free_data(&rt_data->local_active_ports_ipv6_pd);
     shash_destroy_free_data(&rt_data->local_active_ports_ras);
@@ -1364,6 +1594,7 @@ init_binding_ctx(struct engine_node *node,
     b_ctx_out->local_iface_ids = &rt_data->local_iface_ids;
     b_ctx_out->tracked_dp_bindings = NULL;
     b_ctx_out->if_mgr = ctrl_ctx->if_mgr;
+    b_ctx_out->postponed_ports = &rt_data->postponed_ports;
 }
 
 static void
@@ -1396,6 +1627,7 @@ en_runtime_data_run(struct engine_node *node, void *data)
         sset_init(active_tunnels);
         sset_init(&rt_data->egress_ifaces);
         smap_init(&rt_data->local_iface_ids);
+        sset_clear(&rt_data->postponed_ports);
         local_binding_data_init(&rt_data->lbinding_data);
     }
 
@@ -1415,6 +1647,8 @@ en_runtime_data_run(struct engine_node *node, void *data)
          * connected. */
         bfd_calculate_active_tunnels(b_ctx_in.br_int, active_tunnels);
     }
+    /* The active HA chassis depend on the active tunnels. */
+    ha_chassis_cache_flush();
 
     binding_run(&b_ctx_in, &b_ctx_out);
 
@@ -1494,8 +1728,38 @@ runtime_data_sb_datapath_binding_handler(struct engine_node *node OVS_UNUSED,
     return true;
 }
 
+/* The runtime data only depends on the local chassis record, changes to the
+ * other chassis, e.g. a remote chassis being added or deleted, don't require
+ * a recompute. */
+static bool
+runtime_data_sb_chassis_handler(struct engine_node *node,
+                                void *data OVS_UNUSED)
+{
+    struct sbrec_chassis_table *chassis_table =
+        (struct sbrec_chassis_table *)EN_OVSDB_GET(
+            engine_get_input("SB_chassis", node));
+    struct ovsrec_open_vswitch_table *ovs_table =
+        (struct ovsrec_open_vswitch_table *)EN_OVSDB_GET(
+            engine_get_input("OVS_open_vswitch", node));
+    const char *chassis_id = get_ovs_chassis_id(ovs_table);
+
+    const struct sbrec_chassis *ch;
+    SBREC_CHASSIS_TABLE_FOR_EACH_TRACKED (ch, chassis_table) {
+        if (!chassis_id || !strcmp(ch->name, chassis_id)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 struct ed_type_addr_sets {
     struct shash addr_sets;
+
+    /* A copy of the addresses of each SB address_set, as a sset, so that an
+     * update only needs to convert the addresses that changed. */
+    struct shash addr_set_ssets;
+
     bool change_tracked;
     struct sset new;
     struct sset deleted;
@@ -1509,6 +1773,7 @@ en_addr_sets_init(struct engine_node *node OVS_UNUSED,
     struct ed_type_addr_sets *as = xzalloc(sizeof *as);
 
     shash_init(&as->addr_sets);
+    shash_init(&as->addr_set_ssets);
     as->change_tracked = false;
     sset_init(&as->new);
     sset_init(&as->deleted);
@@ -1516,6 +1781,64 @@ en_addr_sets_init(struct engine_node *node OVS_UNUSED,
     return as;
 }
 
+/* Replaces the addresses of 'as' in 'addr_set_ssets'.  If 'added' and
+ * 'deleted' are nonnull, appends to them the addresses that are new and the
+ * ones that are gone, respectively. */
+static void
+addr_set_ssets_add_or_update(struct shash *addr_set_ssets,
+                             const struct sbrec_address_set *as,
+                             struct svec *added, struct svec *deleted)
+{
+    struct sset *old = shash_find_data(addr_set_ssets, as->name);
+    struct sset *new = xzalloc(sizeof *new);
+    sset_init(new);
+
+    for (size_t i = 0; i < as->n_addresses; i++) {
+        sset_add(new, as->addresses[i]);
+        if (added && (!old || !sset_contains(old, as->addresses[i]))) {
+            svec_add(added, as->addresses[i]);
+        }
+    }
+
+    if (old) {
+        if (deleted) {
+            const char *address;
+            SSET_FOR_EACH (address, old) {
+                if (!sset_contains(new, address)) {
+                    svec_add(deleted, address);
+                }
+            }
+        }
+        sset_destroy(old);
+        free(old);
+    }
+    shash_replace(addr_set_ssets, as->name, new);
+}
+
+static void
+addr_set_ssets_delete(struct shash *addr_set_ssets, const char *name)
+{
+    struct sset *addresses = shash_find_and_delete(addr_set_ssets, name);
+    if (addresses) {
+        sset_destroy(addresses);
+        free(addresses);
+    }
+}
+
+/* Delete and free all ssets in 'addr_set_ssets', but not destroying the shash
+ * itself. */
+static void
+addr_set_ssets_clear(struct shash *addr_set_ssets)
+{
+    struct shash_node *node;
+    SHASH_FOR_EACH_SAFE (node, addr_set_ssets) {
+        struct sset *addresses = node->data;
+        shash_delete(addr_set_ssets, node);
+        sset_destroy(addresses);
+        free(addresses);
+    }
+}
+
 static void
 en_addr_sets_clear_tracked_data(void *data)
 {
@@ -1534,6 +1857,20 @@ en_addr_sets_clear_tracked_data(void *data)
     as->change_tracked = false;
 }
 
+static void
+en_addr_sets_get_memory_usage(const void *data, struct simap *usage)
+{
+    const struct ed_type_addr_sets *as = data;
+    size_t n_addresses = 0;
+
+    struct shash_node *node;
+    SHASH_FOR_EACH (node, &as->addr_set_ssets) {
+        n_addresses += sset_count(node->data);
+    }
+    simap_increase(usage, "addr_sets", shash_count(&as->addr_sets));
+    simap_increase(usage, "addr_set_addresses", n_addresses);
+}
+
 static void
 en_addr_sets_cleanup(void *data)
 {
@@ -1542,6 +1879,8 @@ en_addr_sets_cleanup(void *data)
     struct ed_type_addr_sets *as = data;
     expr_const_sets_destroy(&as->addr_sets);
     shash_destroy(&as->addr_sets);
+    addr_set_ssets_clear(&as->addr_set_ssets);
+    shash_destroy(&as->addr_set_ssets);
     sset_destroy(&as->new);
     sset_destroy(&as->deleted);
     shash_destroy(&as->updated);
@@ -1551,53 +1890,61 @@ en_addr_sets_cleanup(void *data)
  * corresponding symtab entries as necessary. */
 static void
 addr_sets_init(const struct sbrec_address_set_table *address_set_table,
-               struct shash *addr_sets)
+               struct shash *addr_sets, struct shash *addr_set_ssets)
 {
     const struct sbrec_address_set *as;
     SBREC_ADDRESS_SET_TABLE_FOR_EACH (as, address_set_table) {
         expr_const_sets_add_integers(addr_sets, as->name,
                                      (const char *const *) as->addresses,
                                      as->n_addresses);
+        addr_set_ssets_add_or_update(addr_set_ssets, as, NULL, NULL);
     }
 }
 
 static void
 addr_sets_update(const struct sbrec_address_set_table *address_set_table,
-                 struct shash *addr_sets, struct sset *added,
-                 struct sset *deleted, struct shash *updated)
+                 struct shash *addr_sets, struct shash *addr_set_ssets,
+                 struct sset *added, struct sset *deleted,
+                 struct shash *updated)
 {
     const struct sbrec_address_set *as;
     SBREC_ADDRESS_SET_TABLE_FOR_EACH_TRACKED (as, address_set_table) {
         if (sbrec_address_set_is_deleted(as)) {
             expr_const_sets_remove(addr_sets, as->name);
+            addr_set_ssets_delete(addr_set_ssets, as->name);
             sset_add(deleted, as->name);
         } else {
-            struct expr_constant_set *cs_old = shash_find_data(addr_sets,
-                                                               as->name);
-            if (!cs_old) {
+            struct expr_constant_set *cs = shash_find_data(addr_sets,
+                                                           as->name);
+            if (!cs) {
                 sset_add(added, as->name);
                 expr_const_sets_add_integers(addr_sets, as->name,
                     (const char *const *) as->addresses, as->n_addresses);
+                addr_set_ssets_add_or_update(addr_set_ssets, as, NULL, NULL);
             } else {
-                /* Find out the diff for the updated address set. */
-                struct expr_constant_set *cs_new =
-                    expr_constant_set_create_integers(
-                        (const char *const *) as->addresses, as->n_addresses);
+                /* Only convert the addresses that changed, and apply them to
+                 * the constant set in place, finding out the diff. */
+                struct svec added_addrs = SVEC_EMPTY_INITIALIZER;
+                struct svec deleted_addrs = SVEC_EMPTY_INITIALIZER;
+                addr_set_ssets_add_or_update(addr_set_ssets, as,
+                                             &added_addrs, &deleted_addrs);
+
                 struct addr_set_diff *as_diff = xmalloc(sizeof *as_diff);
-                expr_constant_set_integers_diff(cs_old, cs_new,
-                                                &as_diff->added,
-                                                &as_diff->deleted);
+                expr_constant_set_integers_update(
+                    cs, (const char *const *) added_addrs.names,
+                    added_addrs.n,
+                    (const char *const *) deleted_addrs.names,
+                    deleted_addrs.n, &as_diff->added, &as_diff->deleted);
+                svec_destroy(&added_addrs);
+                svec_destroy(&deleted_addrs);
                 if (!as_diff->added && !as_diff->deleted) {
                     /* The address set may have been updated, but the change
                      * doesn't has any impact to the generated constant-set.
                      * For example, ff::01 is changed to ff::00:01. */
                     free(as_diff);
-                    expr_constant_set_destroy(cs_new);
-                    free(cs_new);
                     continue;
                 }
                 shash_add(updated, as->name, as_diff);
-                expr_const_sets_add(addr_sets, as->name, cs_new);
             }
         }
     }
@@ -1609,12 +1956,13 @@ en_addr_sets_run(struct engine_node *node, void *data)
     struct ed_type_addr_sets *as = data;
 
     expr_const_sets_destroy(&as->addr_sets);
+    addr_set_ssets_clear(&as->addr_set_ssets);
 
     struct sbrec_address_set_table *as_table =
         (struct sbrec_address_set_table *)EN_OVSDB_GET(
             engine_get_input("SB_address_set", node));
 
-    addr_sets_init(as_table, &as->addr_sets);
+    addr_sets_init(as_table, &as->addr_sets, &as->addr_set_ssets);
 
     as->change_tracked = false;
     engine_set_node_state(node, EN_UPDATED);
@@ -1629,8 +1977,8 @@ addr_sets_sb_address_set_handler(struct engine_node *node, void *data)
         (struct sbrec_address_set_table *)EN_OVSDB_GET(
             engine_get_input("SB_address_set", node));
 
-    addr_sets_update(as_table, &as->addr_sets, &as->new,
-                     &as->deleted, &as->updated);
+    addr_sets_update(as_table, &as->addr_sets, &as->addr_set_ssets,
+                     &as->new, &as->deleted, &as->updated);
 
     if (!sset_is_empty(&as->new) || !sset_is_empty(&as->deleted) ||
             !shash_is_empty(&as->updated)) {
@@ -1748,6 +2096,40 @@ port_groups_init(const struct sbrec_port_group_table *port_group_table,
     }
 }
 
+/* Rebuilds the const set of local lports for 'pg' in 'port_groups_cs_local'.
+ * Returns true if the set of local lports of 'pg' changed, i.e. if the
+ * logical flows referencing it need to be reprocessed.  Membership changes
+ * that only concern non-local lports don't affect the generated flows. */
+static bool
+port_groups_cs_local_update(struct shash *port_groups_cs_local,
+                            const struct sbrec_port_group *pg,
+                            const struct sset *local_lports)
+{
+    struct expr_constant_set *cs = shash_find_data(port_groups_cs_local,
+                                                   pg->name);
+    struct sset old_lports = SSET_INITIALIZER(&old_lports);
+    bool existed = cs != NULL;
+
+    if (cs) {
+        for (size_t i = 0; i < cs->n_values; i++) {
+            sset_add(&old_lports, cs->values[i].string);
+        }
+    }
+
+    expr_const_sets_add_strings(port_groups_cs_local, pg->name,
+                                (const char *const *) pg->ports,
+                                pg->n_ports, local_lports);
+
+    cs = shash_find_data(port_groups_cs_local, pg->name);
+    bool changed = !existed || cs->n_values != sset_count(&old_lports);
+    for (size_t i = 0; !changed && i < cs->n_values; i++) {
+        changed = !sset_contains(&old_lports, cs->values[i].string);
+    }
+
+    sset_destroy(&old_lports);
+    return changed;
+}
+
 static void
 port_groups_update(const struct sbrec_port_group_table *port_group_table,
                    const struct sset *local_lports,
@@ -1768,12 +2150,11 @@ port_groups_update(const struct sbrec_port_group_table *port_group_table,
     SBREC_PORT_GROUP_TABLE_FOR_EACH_TRACKED (pg, port_group_table) {
         if (!sbrec_port_group_is_deleted(pg)) {
             port_group_ssets_add_or_update(port_group_ssets, pg);
-            expr_const_sets_add_strings(port_groups_cs_local, pg->name,
-                                        (const char *const *) pg->ports,
-                                        pg->n_ports, local_lports);
+            bool changed = port_groups_cs_local_update(port_groups_cs_local,
+                                                       pg, local_lports);
             if (sbrec_port_group_is_new(pg)) {
                 sset_add(new, pg->name);
-            } else {
+            } else if (changed) {
                 sset_add(updated, pg->name);
             }
         }
@@ -1790,6 +2171,22 @@ en_port_groups_clear_tracked_data(void *data_)
     pg->change_tracked = false;
 }
 
+static void
+en_port_groups_get_memory_usage(const void *data, struct simap *usage)
+{
+    const struct ed_type_port_groups *pg = data;
+    size_t n_lports = 0;
+
+    struct shash_node *node;
+    SHASH_FOR_EACH (node, &pg->port_group_ssets) {
+        n_lports += sset_count(node->data);
+    }
+    simap_increase(usage, "port_groups", shash_count(&pg->port_group_ssets));
+    simap_increase(usage, "port_group_lports", n_lports);
+    simap_increase(usage, "port_groups_local",
+                   shash_count(&pg->port_groups_cs_local));
+}
+
 static void
 en_port_groups_run(struct engine_node *node, void *data)
 {
@@ -1881,11 +2278,10 @@ port_groups_runtime_data_handler(struct engine_node *node, void *data)
                 break;
             }
         }
-        if (need_update) {
-            expr_const_sets_add_strings(&pg->port_groups_cs_local, pg_sb->name,
-                                        (const char *const *) pg_sb->ports,
-                                        pg_sb->n_ports,
-                                        &rt_data->related_lports.lport_names);
+        if (need_update
+            && port_groups_cs_local_update(
+                   &pg->port_groups_cs_local, pg_sb,
+                   &rt_data->related_lports.lport_names)) {
             sset_add(&pg->updated, pg_sb->name);
         }
     }
@@ -1904,6 +2300,7 @@ out:
 /* Connection tracking zones. */
 struct ed_type_ct_zones {
     unsigned long bitmap[BITMAP_N_LONGS(MAX_CT_ZONES)];
+    int scan_start;         /* Next zone to try when allocating a zone. */
     struct shash pending;
     struct simap current;
 
@@ -1927,6 +2324,7 @@ en_ct_zones_init(struct engine_node *node, struct engine_arg *arg OVS_UNUSED)
 
     memset(data->bitmap, 0, sizeof data->bitmap);
     bitmap_set1(data->bitmap, 0); /* Zone 0 is reserved. */
+    data->scan_start = 1;
     restore_ct_zones(bridge_table, ovs_table, &data->current, data->bitmap);
     return data;
 }
@@ -1956,7 +2354,7 @@ en_ct_zones_run(struct engine_node *node, void *data)
 
     update_ct_zones(&rt_data->lbinding_data.lports, &rt_data->local_datapaths,
                     &ct_zones_data->current, ct_zones_data->bitmap,
-                    &ct_zones_data->pending);
+                    &ct_zones_data->scan_start, &ct_zones_data->pending);
 
 
     ct_zones_data->recomputed = true;
@@ -2031,14 +2429,31 @@ ct_zones_runtime_data_handler(struct engine_node *node, void *data)
 
     struct hmap *tracked_dp_bindings = &rt_data->tracked_dp_bindings;
     struct tracked_datapath *tdp;
-    int scan_start = 0;
 
     bool updated = false;
 
     HMAP_FOR_EACH (tdp, node, tracked_dp_bindings) {
         if (tdp->tracked_type == TRACKED_RESOURCE_NEW) {
-            /* A new datapath has been added. Fall back to full recompute. */
-            return false;
+            /* A new local datapath needs its DNAT and SNAT zones.  A
+             * requested SNAT zone may have to be taken away from another
+             * user, so leave that case to a full recompute. */
+            if (get_snat_ct_zone(tdp->dp) >= 0) {
+                return false;
+            }
+
+            static const char *nat_types[] = { "dnat", "snat" };
+            for (size_t i = 0; i < ARRAY_SIZE(nat_types); i++) {
+                char *key = alloc_nat_zone_key(&tdp->dp->header_.uuid,
+                                               nat_types[i]);
+                if (!simap_contains(&ct_zones_data->current, key)) {
+                    alloc_id_to_ct_zone(key, &ct_zones_data->current,
+                                        ct_zones_data->bitmap,
+                                        &ct_zones_data->scan_start,
+                                        &ct_zones_data->pending);
+                    updated = true;
+                }
+                free(key);
+            }
         }
 
         struct shash_node *shash_node;
@@ -2056,7 +2471,8 @@ ct_zones_runtime_data_handler(struct engine_node *node, void *data)
                                     t_lport->pb->logical_port)) {
                     alloc_id_to_ct_zone(t_lport->pb->logical_port,
                                         &ct_zones_data->current,
-                                        ct_zones_data->bitmap, &scan_start,
+                                        ct_zones_data->bitmap,
+                                        &ct_zones_data->scan_start,
                                         &ct_zones_data->pending);
                     updated = true;
                 }
@@ -2069,25 +2485,390 @@ ct_zones_runtime_data_handler(struct engine_node *node, void *data)
                         &ct_zones_data->pending, CT_ZONE_DB_QUEUED,
                         ct_zone->data, false, ct_zone->name);
 
-                    bitmap_set0(ct_zones_data->bitmap, ct_zone->data);
-                    simap_delete(&ct_zones_data->current, ct_zone);
-                    updated = true;
+                    bitmap_set0(ct_zones_data->bitmap, ct_zone->data);
+                    simap_delete(&ct_zones_data->current, ct_zone);
+                    updated = true;
+                }
+            }
+        }
+    }
+
+    if (updated) {
+        engine_set_node_state(node, EN_UPDATED);
+    }
+
+    return true;
+}
+
+/* The data in the ct_zones node is always valid (i.e., no stale pointers). */
+static bool
+en_ct_zones_is_valid(struct engine_node *node OVS_UNUSED)
+{
+    return true;
+}
+
+/* Patch ports between the integration bridge and the physical bridges. */
+struct ed_type_patch_ports {
+    /* Desired patch ports, as 'struct desired_patch_port *' indexed by port
+     * name. */
+    struct shash desired;
+
+    /* True if the OVS database may not match 'desired' and
+     * patch_ports_commit() must run. */
+    bool commit_needed;
+};
+
+static void *
+en_patch_ports_init(struct engine_node *node OVS_UNUSED,
+                    struct engine_arg *arg OVS_UNUSED)
+{
+    struct ed_type_patch_ports *data = xzalloc(sizeof *data);
+
+    shash_init(&data->desired);
+    return data;
+}
+
+static void
+en_patch_ports_cleanup(void *data)
+{
+    struct ed_type_patch_ports *patch_data = data;
+
+    patch_ports_clear(&patch_data->desired);
+    shash_destroy(&patch_data->desired);
+}
+
+static void
+en_patch_ports_run(struct engine_node *node, void *data)
+{
+    struct ed_type_patch_ports *patch_data = data;
+    struct ed_type_runtime_data *rt_data =
+        engine_get_input_data("runtime_data", node);
+    struct ovsrec_open_vswitch_table *ovs_table =
+        (struct ovsrec_open_vswitch_table *)EN_OVSDB_GET(
+            engine_get_input("OVS_open_vswitch", node));
+    struct ovsrec_bridge_table *bridge_table =
+        (struct ovsrec_bridge_table *)EN_OVSDB_GET(
+            engine_get_input("OVS_bridge", node));
+
+    const struct ovsrec_bridge *br_int = get_br_int(bridge_table, ovs_table);
+    const char *chassis_id = get_ovs_chassis_id(ovs_table);
+    ovs_assert(br_int && chassis_id);
+
+    struct ovsdb_idl_index *sbrec_chassis_by_name =
+        engine_ovsdb_node_get_index(
+            engine_get_input("SB_chassis", node),
+            "name");
+    struct ovsdb_idl_index *sbrec_port_binding_by_type =
+        engine_ovsdb_node_get_index(
+            engine_get_input("SB_port_binding", node),
+            "type");
+
+    const struct sbrec_chassis *chassis
+        = chassis_lookup_by_name(sbrec_chassis_by_name, chassis_id);
+    ovs_assert(chassis);
+
+    patch_ports_compute(sbrec_port_binding_by_type, bridge_table, ovs_table,
+                        br_int, chassis, &rt_data->local_datapaths,
+                        &patch_data->desired);
+    patch_data->commit_needed = true;
+    engine_set_node_state(node, EN_UPDATED);
+}
+
+/* Only localnet and l2gateway port bindings need patch ports.  Changes to
+ * them fall back to a full recompute of the patch_ports node, which is
+ * limited to these port bindings. */
+static bool
+patch_ports_sb_port_binding_handler(struct engine_node *node,
+                                    void *data OVS_UNUSED)
+{
+    const struct sbrec_port_binding_table *pb_table =
+        EN_OVSDB_GET(engine_get_input("SB_port_binding", node));
+    const struct sbrec_port_binding *pb;
+
+    SBREC_PORT_BINDING_TABLE_FOR_EACH_TRACKED (pb, pb_table) {
+        if (patch_ports_is_relevant_pb(pb)
+            || sbrec_port_binding_is_updated(pb,
+                                             SBREC_PORT_BINDING_COL_TYPE)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* The localnet ports of a datapath need patch ports only while the datapath
+ * is local, so adding or removing a local datapath requires a recompute. */
+static bool
+patch_ports_runtime_data_handler(struct engine_node *node,
+                                 void *data OVS_UNUSED)
+{
+    struct ed_type_runtime_data *rt_data =
+        engine_get_input_data("runtime_data", node);
+
+    if (!rt_data->tracked) {
+        return false;
+    }
+
+    struct tracked_datapath *tdp;
+    HMAP_FOR_EACH (tdp, node, &rt_data->tracked_dp_bindings) {
+        if (tdp->tracked_type == TRACKED_RESOURCE_NEW
+            || tdp->tracked_type == TRACKED_RESOURCE_REMOVED) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Changes to the patch ports in the OVS database, e.g. their deletion by
+ * an administrator, don't change the desired patch ports, but they must be
+ * reconciled by patch_ports_commit(). */
+static bool
+patch_ports_ovs_port_handler(struct engine_node *node, void *data)
+{
+    struct ed_type_patch_ports *patch_data = data;
+    const struct ovsrec_port_table *port_table =
+        EN_OVSDB_GET(engine_get_input("OVS_port", node));
+    const struct ovsrec_port *port;
+
+    OVSREC_PORT_TABLE_FOR_EACH_TRACKED (port, port_table) {
+        if (patch_ports_is_managed_port(port)
+            || shash_find(&patch_data->desired, port->name)) {
+            patch_data->commit_needed = true;
+            break;
+        }
+    }
+    return true;
+}
+
+/* The patch_ports data doesn't reference any IDL row, so it is always
+ * valid, and the patch ports it holds can be committed even if the engine
+ * was aborted. */
+static bool
+en_patch_ports_is_valid(struct engine_node *node OVS_UNUSED)
+{
+    return true;
+}
+
+/* Logical ports resident on this chassis, as evaluated by the
+ * is_chassis_resident() predicate of the logical flows. */
+struct ed_type_resident_lports {
+    /* Names of the lports of the local datapaths that are bound to this
+     * chassis or, for chassisredirect ports, for which this chassis is the
+     * active HA chassis. */
+    struct sset resident;
+
+    /* Tracked data.  Names of the lports whose residency changed.  Both the
+     * handlers and a recompute track them, by comparing with the previous
+     * 'resident', so that the logical flows that depend on them can always
+     * be reprocessed incrementally. */
+    struct sset changed;
+};
+
+static void *
+en_resident_lports_init(struct engine_node *node OVS_UNUSED,
+                        struct engine_arg *arg OVS_UNUSED)
+{
+    struct ed_type_resident_lports *data = xzalloc(sizeof *data);
+
+    sset_init(&data->resident);
+    sset_init(&data->changed);
+    return data;
+}
+
+static void
+en_resident_lports_cleanup(void *data)
+{
+    struct ed_type_resident_lports *rl_data = data;
+
+    sset_destroy(&rl_data->resident);
+    sset_destroy(&rl_data->changed);
+}
+
+static void
+en_resident_lports_clear_tracked_data(void *data)
+{
+    struct ed_type_resident_lports *rl_data = data;
+
+    sset_clear(&rl_data->changed);
+}
+
+static const struct sbrec_chassis *
+resident_lports_get_chassis(struct engine_node *node)
+{
+    struct ovsrec_open_vswitch_table *ovs_table =
+        (struct ovsrec_open_vswitch_table *)EN_OVSDB_GET(
+            engine_get_input("OVS_open_vswitch", node));
+    struct ovsdb_idl_index *sbrec_chassis_by_name =
+        engine_ovsdb_node_get_index(
+            engine_get_input("SB_chassis", node),
+            "name");
+
+    const char *chassis_id = get_ovs_chassis_id(ovs_table);
+    ovs_assert(chassis_id);
+
+    const struct sbrec_chassis *chassis
+        = chassis_lookup_by_name(sbrec_chassis_by_name, chassis_id);
+    ovs_assert(chassis);
+    return chassis;
+}
+
+/* Updates the residency of 'pb' in 'rl_data'.  Returns true if it changed. */
+static bool
+resident_lports_update(struct ed_type_resident_lports *rl_data,
+                       const struct sbrec_port_binding *pb, bool resident)
+{
+    bool changed = (resident
+                    ? sset_add(&rl_data->resident, pb->logical_port) != NULL
+                    : sset_find_and_delete(&rl_data->resident,
+                                           pb->logical_port));
+    if (changed) {
+        sset_add(&rl_data->changed, pb->logical_port);
+    }
+    return changed;
+}
+
+/* Evaluates the residency of all the lports of 'dp' into 'resident'. */
+static void
+resident_lports_add_datapath(struct ovsdb_idl_index *sbrec_pb_by_datapath,
+                             const struct sbrec_datapath_binding *dp,
+                             const struct sbrec_chassis *chassis,
+                             const struct sset *active_tunnels,
+                             struct sset *resident)
+{
+    struct sbrec_port_binding *target =
+        sbrec_port_binding_index_init_row(sbrec_pb_by_datapath);
+    sbrec_port_binding_index_set_datapath(target, dp);
+
+    const struct sbrec_port_binding *pb;
+    SBREC_PORT_BINDING_FOR_EACH_EQUAL (pb, target, sbrec_pb_by_datapath) {
+        if (lport_pb_is_chassis_resident(pb, chassis, active_tunnels)) {
+            sset_add(resident, pb->logical_port);
+        }
+    }
+    sbrec_port_binding_index_destroy_row(target);
+}
+
+static void
+en_resident_lports_run(struct engine_node *node, void *data)
+{
+    struct ed_type_resident_lports *rl_data = data;
+    struct ed_type_runtime_data *rt_data =
+        engine_get_input_data("runtime_data", node);
+    struct ovsdb_idl_index *sbrec_port_binding_by_datapath =
+        engine_ovsdb_node_get_index(
+            engine_get_input("SB_port_binding", node),
+            "datapath");
+    const struct sbrec_chassis *chassis = resident_lports_get_chassis(node);
+
+    struct sset resident = SSET_INITIALIZER(&resident);
+    const struct local_datapath *ld;
+    HMAP_FOR_EACH (ld, hmap_node, &rt_data->local_datapaths) {
+        resident_lports_add_datapath(sbrec_port_binding_by_datapath,
+                                     ld->datapath, chassis,
+                                     &rt_data->active_tunnels, &resident);
+    }
+
+    /* Track the difference with the previous run. */
+    const char *name;
+    SSET_FOR_EACH (name, &resident) {
+        if (!sset_contains(&rl_data->resident, name)) {
+            sset_add(&rl_data->changed, name);
+        }
+    }
+    SSET_FOR_EACH (name, &rl_data->resident) {
+        if (!sset_contains(&resident, name)) {
+            sset_add(&rl_data->changed, name);
+        }
+    }
+    sset_swap(&rl_data->resident, &resident);
+    sset_destroy(&resident);
+
+    engine_set_node_state(node, sset_is_empty(&rl_data->changed)
+                                ? EN_UNCHANGED : EN_UPDATED);
+}
+
+static bool
+resident_lports_runtime_data_handler(struct engine_node *node, void *data)
+{
+    struct ed_type_resident_lports *rl_data = data;
+    struct ed_type_runtime_data *rt_data =
+        engine_get_input_data("runtime_data", node);
+
+    /* The active tunnels are only computed on a recompute of the runtime
+     * data, which doesn't track its changes. */
+    if (!rt_data->tracked) {
+        return false;
+    }
+
+    struct ovsdb_idl_index *sbrec_port_binding_by_datapath =
+        engine_ovsdb_node_get_index(
+            engine_get_input("SB_port_binding", node),
+            "datapath");
+    const struct sbrec_chassis *chassis = resident_lports_get_chassis(node);
+    bool changed = false;
+
+    struct tracked_datapath *tdp;
+    HMAP_FOR_EACH (tdp, node, &rt_data->tracked_dp_bindings) {
+        if (tdp->tracked_type == TRACKED_RESOURCE_REMOVED) {
+            return false;
+        }
+        if (tdp->tracked_type == TRACKED_RESOURCE_NEW) {
+            struct sset resident = SSET_INITIALIZER(&resident);
+            resident_lports_add_datapath(sbrec_port_binding_by_datapath,
+                                         tdp->dp, chassis,
+                                         &rt_data->active_tunnels,
+                                         &resident);
+            const char *name;
+            SSET_FOR_EACH (name, &resident) {
+                if (sset_add(&rl_data->resident, name)) {
+                    sset_add(&rl_data->changed, name);
+                    changed = true;
                 }
             }
+            sset_destroy(&resident);
+        }
+
+        struct shash_node *shash_node;
+        SHASH_FOR_EACH (shash_node, &tdp->lports) {
+            struct tracked_lport *lport = shash_node->data;
+            bool resident = (lport->tracked_type != TRACKED_RESOURCE_REMOVED
+                             && lport_pb_is_chassis_resident(
+                                    lport->pb, chassis,
+                                    &rt_data->active_tunnels));
+            changed |= resident_lports_update(rl_data, lport->pb, resident);
         }
     }
 
-    if (updated) {
+    if (changed) {
         engine_set_node_state(node, EN_UPDATED);
     }
-
     return true;
 }
 
-/* The data in the ct_zones node is always valid (i.e., no stale pointers). */
 static bool
-en_ct_zones_is_valid(struct engine_node *node OVS_UNUSED)
+resident_lports_sb_port_binding_handler(struct engine_node *node, void *data)
 {
+    struct ed_type_resident_lports *rl_data = data;
+    struct ed_type_runtime_data *rt_data =
+        engine_get_input_data("runtime_data", node);
+    const struct sbrec_port_binding_table *pb_table =
+        EN_OVSDB_GET(engine_get_input("SB_port_binding", node));
+    const struct sbrec_chassis *chassis = resident_lports_get_chassis(node);
+    bool changed = false;
+
+    const struct sbrec_port_binding *pb;
+    SBREC_PORT_BINDING_TABLE_FOR_EACH_TRACKED (pb, pb_table) {
+        bool resident = (!sbrec_port_binding_is_deleted(pb)
+                         && pb->datapath
+                         && get_local_datapath(&rt_data->local_datapaths,
+                                               pb->datapath->tunnel_key)
+                         && lport_pb_is_chassis_resident(
+                                pb, chassis, &rt_data->active_tunnels));
+        changed |= resident_lports_update(rl_data, pb, resident);
+    }
+
+    if (changed) {
+        engine_set_node_state(node, EN_UPDATED);
+    }
     return true;
 }
 
@@ -2228,6 +3009,12 @@ struct ed_type_non_vif_data {
     struct simap patch_ofports; /* simap of patch ovs ports. */
     struct hmap chassis_tunnels; /* hmap of 'struct chassis_tunnel' from the
                                   * tunnel OVS ports. */
+
+    /* Tracked data. */
+    /* Names of the localnet and l2gateway ports whose patch ports changed. */
+    struct sset changed_patch_ofports;
+    /* Names of the chassis whose tunnels changed. */
+    struct sset changed_tunnel_chassis;
 };
 
 static void *
@@ -2237,6 +3024,8 @@ en_non_vif_data_init(struct engine_node *node OVS_UNUSED,
     struct ed_type_non_vif_data *data = xzalloc(sizeof *data);
     simap_init(&data->patch_ofports);
     hmap_init(&data->chassis_tunnels);
+    sset_init(&data->changed_patch_ofports);
+    sset_init(&data->changed_tunnel_chassis);
     return data;
 }
 
@@ -2246,14 +3035,28 @@ en_non_vif_data_cleanup(void *data OVS_UNUSED)
     struct ed_type_non_vif_data *ed_non_vif_data = data;
     simap_destroy(&ed_non_vif_data->patch_ofports);
     chassis_tunnels_destroy(&ed_non_vif_data->chassis_tunnels);
+    sset_destroy(&ed_non_vif_data->changed_patch_ofports);
+    sset_destroy(&ed_non_vif_data->changed_tunnel_chassis);
+}
+
+static void
+en_non_vif_data_clear_tracked_data(void *data)
+{
+    struct ed_type_non_vif_data *ed_non_vif_data = data;
+    sset_clear(&ed_non_vif_data->changed_patch_ofports);
+    sset_clear(&ed_non_vif_data->changed_tunnel_chassis);
 }
 
 static void
 en_non_vif_data_run(struct engine_node *node, void *data)
 {
     struct ed_type_non_vif_data *ed_non_vif_data = data;
-    simap_destroy(&ed_non_vif_data->patch_ofports);
-    chassis_tunnels_destroy(&ed_non_vif_data->chassis_tunnels);
+
+    /* Keep the previous data to track what changed. */
+    struct simap old_patch_ofports;
+    struct hmap old_chassis_tunnels;
+    simap_swap(&old_patch_ofports, &ed_non_vif_data->patch_ofports);
+    hmap_swap(&old_chassis_tunnels, &ed_non_vif_data->chassis_tunnels);
     simap_init(&ed_non_vif_data->patch_ofports);
     hmap_init(&ed_non_vif_data->chassis_tunnels);
 
@@ -2279,6 +3082,16 @@ en_non_vif_data_run(struct engine_node *node, void *data)
 
     local_nonvif_data_run(br_int, chassis, &ed_non_vif_data->patch_ofports,
                           &ed_non_vif_data->chassis_tunnels);
+
+    patch_ofports_get_changes(&old_patch_ofports,
+                              &ed_non_vif_data->patch_ofports,
+                              &ed_non_vif_data->changed_patch_ofports);
+    chassis_tunnels_get_changes(&old_chassis_tunnels,
+                                &ed_non_vif_data->chassis_tunnels,
+                                &ed_non_vif_data->changed_tunnel_chassis);
+    simap_destroy(&old_patch_ofports);
+    chassis_tunnels_destroy(&old_chassis_tunnels);
+
     engine_set_node_state(node, EN_UPDATED);
 }
 
@@ -2358,6 +3171,8 @@ struct lflow_output_persistent_data {
 struct lflow_output_hairpin_data {
     struct id_pool *pool;
     struct simap   ids;
+    /* The hairpin flows installed per load balancer, VIP and backend. */
+    struct hmap    lbs;
 };
 
 struct ed_type_lflow_output {
@@ -2383,6 +3198,10 @@ struct ed_type_lflow_output {
 
     /* Data for managing hairpin flow conjunctive flow ids. */
     struct lflow_output_hairpin_data hd;
+
+    /* Progress of a recompute split in several engine runs, see
+     * lflow_set_run_slice(). */
+    struct lflow_run_progress run_progress;
 };
 
 static void
@@ -2396,6 +3215,11 @@ init_lflow_ctx(struct engine_node *node,
                 engine_get_input("SB_port_binding", node),
                 "name");
 
+    struct ovsdb_idl_index *sbrec_port_binding_by_datapath =
+        engine_ovsdb_node_get_index(
+                engine_get_input("SB_port_binding", node),
+                "datapath");
+
     struct ovsdb_idl_index *sbrec_logical_flow_by_dp =
         engine_ovsdb_node_get_index(
                 engine_get_input("SB_logical_flow", node),
@@ -2438,10 +3262,6 @@ init_lflow_ctx(struct engine_node *node,
         (struct sbrec_dhcpv6_options_table *)EN_OVSDB_GET(
             engine_get_input("SB_dhcpv6_options", node));
 
-    struct sbrec_mac_binding_table *mac_binding_table =
-        (struct sbrec_mac_binding_table *)EN_OVSDB_GET(
-            engine_get_input("SB_mac_binding", node));
-
     struct sbrec_logical_flow_table *logical_flow_table =
         (struct sbrec_logical_flow_table *)EN_OVSDB_GET(
             engine_get_input("SB_logical_flow", node));
@@ -2462,10 +3282,6 @@ init_lflow_ctx(struct engine_node *node,
         (struct sbrec_fdb_table *)EN_OVSDB_GET(
             engine_get_input("SB_fdb", node));
 
-    struct sbrec_static_mac_binding_table *smb_table =
-        (struct sbrec_static_mac_binding_table *)EN_OVSDB_GET(
-            engine_get_input("SB_static_mac_binding", node));
-
     struct ovsrec_open_vswitch_table *ovs_table =
         (struct ovsrec_open_vswitch_table *)EN_OVSDB_GET(
             engine_get_input("OVS_open_vswitch", node));
@@ -2485,6 +3301,9 @@ init_lflow_ctx(struct engine_node *node,
     struct ed_type_runtime_data *rt_data =
         engine_get_input_data("runtime_data", node);
 
+    struct ed_type_resident_lports *rl_data =
+        engine_get_input_data("resident_lports", node);
+
     struct ed_type_non_vif_data *non_vif_data =
         engine_get_input_data("non_vif_data", node);
 
@@ -2507,6 +3326,7 @@ init_lflow_ctx(struct engine_node *node,
     l_ctx_in->sbrec_logical_flow_by_logical_dp_group =
         sbrec_logical_flow_by_dp_group;
     l_ctx_in->sbrec_port_binding_by_name = sbrec_port_binding_by_name;
+    l_ctx_in->sbrec_port_binding_by_datapath = sbrec_port_binding_by_datapath;
     l_ctx_in->sbrec_fdb_by_dp_key = sbrec_fdb_by_dp_key;
     l_ctx_in->sbrec_mac_binding_by_datapath = sbrec_mac_binding_by_datapath;
     l_ctx_in->sbrec_static_mac_binding_by_datapath =
@@ -2514,19 +3334,18 @@ init_lflow_ctx(struct engine_node *node,
     l_ctx_in->port_binding_table = port_binding_table;
     l_ctx_in->dhcp_options_table  = dhcp_table;
     l_ctx_in->dhcpv6_options_table = dhcpv6_table;
-    l_ctx_in->mac_binding_table = mac_binding_table;
     l_ctx_in->logical_flow_table = logical_flow_table;
     l_ctx_in->logical_dp_group_table = logical_dp_group_table;
     l_ctx_in->mc_group_table = multicast_group_table;
     l_ctx_in->fdb_table = fdb_table,
     l_ctx_in->chassis = chassis;
     l_ctx_in->lb_table = lb_table;
-    l_ctx_in->static_mac_binding_table = smb_table;
     l_ctx_in->local_datapaths = &rt_data->local_datapaths;
     l_ctx_in->addr_sets = addr_sets;
     l_ctx_in->port_groups = port_groups;
     l_ctx_in->active_tunnels = &rt_data->active_tunnels;
-    l_ctx_in->related_lport_ids = &rt_data->related_lports.lport_ids;
+    l_ctx_in->resident_lports = &rl_data->resident;
+    l_ctx_in->related_lports = &rt_data->related_lports;
     l_ctx_in->binding_lports = &rt_data->lbinding_data.lports;
     l_ctx_in->chassis_tunnels = &non_vif_data->chassis_tunnels;
     l_ctx_in->check_ct_label_for_lb_hairpin =
@@ -2541,6 +3360,8 @@ init_lflow_ctx(struct engine_node *node,
     l_ctx_out->lflow_cache = fo->pd.lflow_cache;
     l_ctx_out->hairpin_id_pool = fo->hd.pool;
     l_ctx_out->hairpin_lb_ids = &fo->hd.ids;
+    l_ctx_out->hairpin_lbs = &fo->hd.lbs;
+    l_ctx_out->run_progress = &fo->run_progress;
 }
 
 static void *
@@ -2555,6 +3376,7 @@ en_lflow_output_init(struct engine_node *node OVS_UNUSED,
     lflow_conj_ids_init(&data->conj_ids);
     hmap_init(&data->lflows_processed);
     simap_init(&data->hd.ids);
+    hmap_init(&data->hd.lbs);
     data->hd.pool = id_pool_create(1, UINT32_MAX - 1);
     return data;
 }
@@ -2567,6 +3389,23 @@ en_lflow_output_clear_tracked_data(void *data)
     hmap_init(&flow_output_data->lflows_processed);
 }
 
+static void
+en_lflow_output_get_memory_usage(const void *data, struct simap *usage)
+{
+    const struct ed_type_lflow_output *fo = data;
+
+    simap_increase(usage, "lflow_output_flows",
+                   hmap_count(&fo->flow_table.match_flow_table));
+    simap_increase(usage, "lflow_output_groups",
+                   hmap_count(&fo->group_table.desired));
+    simap_increase(usage, "lflow_output_meters",
+                   hmap_count(&fo->meter_table.desired));
+    simap_increase(usage, "lflow_resource_refs",
+                   hmap_count(&fo->lflow_resource_ref.ref_lflow_table));
+    simap_increase(usage, "lflow_refs",
+                   hmap_count(&fo->lflow_resource_ref.lflow_ref_table));
+}
+
 static void
 en_lflow_output_cleanup(void *data)
 {
@@ -2579,6 +3418,8 @@ en_lflow_output_cleanup(void *data)
     lflows_processed_destroy(&flow_output_data->lflows_processed);
     lflow_cache_destroy(flow_output_data->pd.lflow_cache);
     simap_destroy(&flow_output_data->hd.ids);
+    lflow_hairpin_lbs_clear(&flow_output_data->hd.lbs);
+    hmap_destroy(&flow_output_data->hd.lbs);
     id_pool_destroy(flow_output_data->hd.pool);
 }
 
@@ -2612,25 +3453,46 @@ en_lflow_output_run(struct engine_node *node, void *data)
     struct ovn_extend_table *meter_table = &fo->meter_table;
     struct lflow_resource_ref *lfrr = &fo->lflow_resource_ref;
 
+    /* Resume the recompute that yielded in the previous engine run, if
+     * any, otherwise start over. */
+    if (!engine_node_resuming(node)) {
+        fo->run_progress.in_progress = false;
+    }
+
     static bool first_run = true;
     if (first_run) {
         first_run = false;
-    } else {
+    } else if (!fo->run_progress.in_progress) {
         ovn_desired_flow_table_clear(lflow_table);
         ovn_extend_table_clear(group_table, false /* desired */);
         ovn_extend_table_clear(meter_table, false /* desired */);
         lflow_resource_clear(lfrr);
         lflow_conj_ids_clear(&fo->conj_ids);
+        lflow_hairpin_lbs_clear(&fo->hd.lbs);
     }
 
     struct controller_engine_ctx *ctrl_ctx = engine_get_context()->client_ctx;
 
     fo->pd.lflow_cache = ctrl_ctx->lflow_cache;
 
+    /* The cached parsed actions depend on the DHCP options, which are only
+     * handled by a recompute. */
+    if (engine_node_changed(engine_get_input("SB_dhcp_options", node))
+        || engine_node_changed(engine_get_input("SB_dhcpv6_options", node))) {
+        lflow_cache_flush_actions(ctrl_ctx->lflow_cache);
+    }
+
     struct lflow_ctx_in l_ctx_in;
     struct lflow_ctx_out l_ctx_out;
     init_lflow_ctx(node, fo, &l_ctx_in, &l_ctx_out);
-    lflow_run(&l_ctx_in, &l_ctx_out);
+    if (!lflow_run(&l_ctx_in, &l_ctx_out)) {
+        /* Let the main loop service ofctrl, pinctrl, BFD and unixctl
+         * before going on.  The flows are only installed once all of them
+         * are added. */
+        engine_yield(node);
+        return;
+    }
+    lport_addresses_cache_sweep();
 
     engine_set_node_state(node, EN_UPDATED);
 }
@@ -2898,6 +3760,33 @@ lflow_output_runtime_data_handler(struct engine_node *node,
     return true;
 }
 
+/* Reprocesses the logical flows whose is_chassis_resident() predicates
+ * refer to lports whose residency changed, e.g. on a gateway failover. */
+static bool
+lflow_output_resident_lports_handler(struct engine_node *node, void *data)
+{
+    struct ed_type_resident_lports *rl_data =
+        engine_get_input_data("resident_lports", node);
+
+    struct lflow_ctx_in l_ctx_in;
+    struct lflow_ctx_out l_ctx_out;
+    struct ed_type_lflow_output *fo = data;
+    init_lflow_ctx(node, fo, &l_ctx_in, &l_ctx_out);
+
+    const char *name;
+    SSET_FOR_EACH (name, &rl_data->changed) {
+        bool changed;
+        if (!lflow_handle_changed_ref(REF_TYPE_PORTBINDING, name,
+                                      &l_ctx_in, &l_ctx_out, &changed)) {
+            return false;
+        }
+        if (changed) {
+            engine_set_node_state(node, EN_UPDATED);
+        }
+    }
+    return true;
+}
+
 static bool
 lflow_output_sb_load_balancer_handler(struct engine_node *node, void *data)
 {
@@ -2961,6 +3850,11 @@ static void init_physical_ctx(struct engine_node *node,
                 engine_get_input("SB_port_binding", node),
                 "name");
 
+    struct ovsdb_idl_index *sbrec_port_binding_by_datapath =
+        engine_ovsdb_node_get_index(
+                engine_get_input("SB_port_binding", node),
+                "datapath");
+
     struct sbrec_multicast_group_table *multicast_group_table =
         (struct sbrec_multicast_group_table *)EN_OVSDB_GET(
             engine_get_input("SB_multicast_group", node));
@@ -3000,6 +3894,7 @@ static void init_physical_ctx(struct engine_node *node,
     struct simap *ct_zones = &ct_zones_data->current;
 
     p_ctx->sbrec_port_binding_by_name = sbrec_port_binding_by_name;
+    p_ctx->sbrec_port_binding_by_datapath = sbrec_port_binding_by_datapath;
     p_ctx->port_binding_table = port_binding_table;
     p_ctx->mc_group_table = multicast_group_table;
     p_ctx->br_int = br_int;
@@ -3153,6 +4048,75 @@ pflow_output_runtime_data_handler(struct engine_node *node, void *data)
     return true;
 }
 
+static bool
+pflow_output_non_vif_data_handler(struct engine_node *node, void *data)
+{
+    struct ed_type_non_vif_data *non_vif_data =
+        engine_get_input_data("non_vif_data", node);
+
+    if (sset_is_empty(&non_vif_data->changed_patch_ofports)
+        && sset_is_empty(&non_vif_data->changed_tunnel_chassis)) {
+        return true;
+    }
+
+    struct ed_type_runtime_data *rt_data =
+        engine_get_input_data("runtime_data", node);
+    struct ed_type_pflow_output *pfo = data;
+
+    struct physical_ctx p_ctx;
+    init_physical_ctx(node, rt_data, non_vif_data, &p_ctx);
+
+    if (!physical_handle_patch_ofport_changes(
+            &p_ctx, &non_vif_data->changed_patch_ofports,
+            &pfo->flow_table)) {
+        return false;
+    }
+
+    if (!physical_handle_chassis_tunnel_changes(
+            &p_ctx, &non_vif_data->changed_tunnel_chassis,
+            &pfo->flow_table)) {
+        return false;
+    }
+
+    engine_set_node_state(node, EN_UPDATED);
+    return true;
+}
+
+/* Handles sbrec_chassis changes for the physical flows.  The tunnels to a
+ * new or deleted chassis are handled through the non_vif_data changes, once
+ * their OVS ports are created or deleted, so only the remote chassis MAC
+ * mappings and VTEP gateways, which are not tracked, require a full
+ * recompute. */
+static bool
+pflow_output_sb_chassis_handler(struct engine_node *node,
+                                void *data OVS_UNUSED)
+{
+    struct sbrec_chassis_table *chassis_table =
+        (struct sbrec_chassis_table *)EN_OVSDB_GET(
+            engine_get_input("SB_chassis", node));
+
+    const struct sbrec_chassis *ch;
+    SBREC_CHASSIS_TABLE_FOR_EACH_TRACKED (ch, chassis_table) {
+        if ((sbrec_chassis_is_deleted(ch) || sbrec_chassis_is_new(ch))
+            && (smap_get(&ch->other_config, "ovn-chassis-mac-mappings")
+                || smap_get_bool(&ch->other_config, "is-vtep", false))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Encap changes only affect the physical flows through the tunnels, which
+ * are created, updated or deleted accordingly and handled through the
+ * non_vif_data changes. */
+static bool
+pflow_output_sb_encap_handler(struct engine_node *node OVS_UNUSED,
+                              void *data OVS_UNUSED)
+{
+    return true;
+}
+
 static bool
 pflow_output_ct_zones_handler(struct engine_node *node OVS_UNUSED,
                                     void *data OVS_UNUSED)
@@ -3279,6 +4243,33 @@ check_northd_version(struct ovsdb_idl *ovs_idl, struct ovsdb_idl *ovnsb_idl,
     return true;
 }
 
+/* Stores in '*pb_uuids' the uuids of the port bindings of the interfaces that
+ * were claimed but whose flows are not installed yet and returns their
+ * number.  The caller must free '*pb_uuids'. */
+static size_t
+get_pending_port_bindings(const struct if_status_mgr *if_mgr,
+                          struct ovsdb_idl_index *sbrec_port_binding_by_name,
+                          struct uuid **pb_uuids)
+{
+    struct sset iface_ids = SSET_INITIALIZER(&iface_ids);
+    if_status_mgr_get_pending_ifaces(if_mgr, &iface_ids);
+
+    size_t n = 0;
+    *pb_uuids = xmalloc(MAX(sset_count(&iface_ids), 1) * sizeof **pb_uuids);
+
+    const char *iface_id;
+    SSET_FOR_EACH (iface_id, &iface_ids) {
+        const struct sbrec_port_binding *pb =
+            lport_lookup_by_name(sbrec_port_binding_by_name, iface_id);
+        if (pb) {
+            (*pb_uuids)[n++] = pb->header_.uuid;
+        }
+    }
+    sset_destroy(&iface_ids);
+
+    return n;
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -3293,6 +4284,7 @@ main(int argc, char *argv[])
     service_start(&argc, &argv);
     char *ovs_remote = parse_options(argc, argv);
     fatal_ignore_sigpipe();
+    lport_addresses_cache_enable();
 
     daemonize_start(true);
 
@@ -3308,7 +4300,11 @@ main(int argc, char *argv[])
     daemonize_complete();
 
     /* Register ofctrl seqno types. */
-    ofctrl_seq_type_nb_cfg = ofctrl_seqno_add_type();
+    ofctrl_seq_type_nb_cfg = ofctrl_seqno_add_type("nb_cfg");
+    unixctl_command_register("ofctrl-seqno/show-latency", "[json]", 0, 1,
+                             ofctrl_latency_show_cmd, NULL);
+    unixctl_command_register("ofctrl-seqno/clear-latency", "", 0, 0,
+                             ofctrl_latency_clear_cmd, NULL);
 
     patch_init();
     pinctrl_init();
@@ -3386,6 +4382,9 @@ main(int argc, char *argv[])
     struct ovsdb_idl_index *sbrec_static_mac_binding_by_datapath
         = ovsdb_idl_index_create1(ovnsb_idl_loop.idl,
                                   &sbrec_static_mac_binding_col_datapath);
+    struct ovsdb_idl_index *sbrec_meter_by_name
+        = ovsdb_idl_index_create1(ovnsb_idl_loop.idl,
+                                  &sbrec_meter_col_name);
 
     ovsdb_idl_track_add_all(ovnsb_idl_loop.idl);
     ovsdb_idl_omit_alert(ovnsb_idl_loop.idl,
@@ -3432,7 +4431,7 @@ main(int argc, char *argv[])
     ovsdb_idl_omit(ovnsb_idl_loop.idl,
                    &sbrec_chassis_private_col_external_ids);
 
-    update_sb_monitors(ovnsb_idl_loop.idl, NULL, NULL, NULL, false);
+    update_sb_monitors(ovnsb_idl_loop.idl, NULL, NULL, NULL, false, false);
 
     stopwatch_create(CONTROLLER_LOOP_STOPWATCH_NAME, SW_MS);
     stopwatch_create(OFCTRL_PUT_STOPWATCH_NAME, SW_MS);
@@ -3444,20 +4443,45 @@ main(int argc, char *argv[])
     stopwatch_create(OFCTRL_SEQNO_RUN_STOPWATCH_NAME, SW_MS);
     stopwatch_create(BFD_RUN_STOPWATCH_NAME, SW_MS);
     stopwatch_create(VIF_PLUG_RUN_STOPWATCH_NAME, SW_MS);
-
-    /* Define inc-proc-engine nodes. */
-    ENGINE_NODE_WITH_CLEAR_TRACK_DATA_IS_VALID(ct_zones, "ct_zones");
+    stopwatch_create(VIF_PLUG_COMMIT_STOPWATCH_NAME, SW_MS);
+
+    /* Define inc-proc-engine nodes.  The nodes marked thread-safe only
+     * update their own data, so they can run concurrently when
+     * "ovn-engine-n-threads" is above 1. */
+    ENGINE_NODE_DEF_START(ct_zones, "ct_zones")
+        .clear_tracked_data = en_ct_zones_clear_tracked_data,
+        .is_valid = en_ct_zones_is_valid,
+        .thread_safe = true,
+    ENGINE_NODE_DEF_END
     ENGINE_NODE_WITH_CLEAR_TRACK_DATA(ovs_interface_shadow,
                                       "ovs_interface_shadow");
-    ENGINE_NODE_WITH_CLEAR_TRACK_DATA(runtime_data, "runtime_data");
-    ENGINE_NODE(non_vif_data, "non_vif_data");
+    ENGINE_NODE_DEF_START(patch_ports, "patch_ports")
+        .is_valid = en_patch_ports_is_valid,
+    ENGINE_NODE_DEF_END
+    ENGINE_NODE_DEF_START(runtime_data, "runtime_data")
+        .clear_tracked_data = en_runtime_data_clear_tracked_data,
+        .get_memory_usage = en_runtime_data_get_memory_usage,
+    ENGINE_NODE_DEF_END
+    ENGINE_NODE_WITH_CLEAR_TRACK_DATA(resident_lports, "resident_lports");
+    ENGINE_NODE_WITH_CLEAR_TRACK_DATA(non_vif_data, "non_vif_data");
     ENGINE_NODE(mff_ovn_geneve, "mff_ovn_geneve");
     ENGINE_NODE(ofctrl_is_connected, "ofctrl_is_connected");
     ENGINE_NODE(pflow_output, "physical_flow_output");
-    ENGINE_NODE_WITH_CLEAR_TRACK_DATA(lflow_output, "logical_flow_output");
+    ENGINE_NODE_DEF_START(lflow_output, "logical_flow_output")
+        .clear_tracked_data = en_lflow_output_clear_tracked_data,
+        .get_memory_usage = en_lflow_output_get_memory_usage,
+    ENGINE_NODE_DEF_END
     ENGINE_NODE(flow_output, "flow_output");
-    ENGINE_NODE_WITH_CLEAR_TRACK_DATA(addr_sets, "addr_sets");
-    ENGINE_NODE_WITH_CLEAR_TRACK_DATA(port_groups, "port_groups");
+    ENGINE_NODE_DEF_START(addr_sets, "addr_sets")
+        .clear_tracked_data = en_addr_sets_clear_tracked_data,
+        .get_memory_usage = en_addr_sets_get_memory_usage,
+        .thread_safe = true,
+    ENGINE_NODE_DEF_END
+    ENGINE_NODE_DEF_START(port_groups, "port_groups")
+        .clear_tracked_data = en_port_groups_clear_tracked_data,
+        .get_memory_usage = en_port_groups_get_memory_usage,
+        .thread_safe = true,
+    ENGINE_NODE_DEF_END
     ENGINE_NODE(northd_internal_version, "northd_internal_version");
 
 #define SB_NODE(NAME, NAME_STR) ENGINE_NODE_SB(NAME, NAME_STR);
@@ -3489,11 +4513,11 @@ main(int argc, char *argv[])
      * be handled before any ct_zone changes.
      */
     engine_add_input(&en_pflow_output, &en_non_vif_data,
-                     NULL);
+                     pflow_output_non_vif_data_handler);
     engine_add_input(&en_pflow_output, &en_ct_zones,
                      pflow_output_ct_zones_handler);
     engine_add_input(&en_pflow_output, &en_sb_chassis,
-                     pflow_lflow_output_sb_chassis_handler);
+                     pflow_output_sb_chassis_handler);
 
     engine_add_input(&en_pflow_output, &en_sb_port_binding,
                      pflow_output_sb_port_binding_handler);
@@ -3502,7 +4526,8 @@ main(int argc, char *argv[])
 
     engine_add_input(&en_pflow_output, &en_runtime_data,
                      pflow_output_runtime_data_handler);
-    engine_add_input(&en_pflow_output, &en_sb_encap, NULL);
+    engine_add_input(&en_pflow_output, &en_sb_encap,
+                     pflow_output_sb_encap_handler);
     engine_add_input(&en_pflow_output, &en_mff_ovn_geneve, NULL);
     engine_add_input(&en_pflow_output, &en_ovs_open_vswitch, NULL);
     engine_add_input(&en_pflow_output, &en_ovs_bridge, NULL);
@@ -3526,6 +4551,8 @@ main(int argc, char *argv[])
                      lflow_output_port_groups_handler);
     engine_add_input(&en_lflow_output, &en_runtime_data,
                      lflow_output_runtime_data_handler);
+    engine_add_input(&en_lflow_output, &en_resident_lports,
+                     lflow_output_resident_lports_handler);
     engine_add_input(&en_lflow_output, &en_non_vif_data,
                      NULL);
 
@@ -3579,7 +4606,8 @@ main(int argc, char *argv[])
     engine_add_input(&en_runtime_data, &en_ovs_bridge, NULL);
     engine_add_input(&en_runtime_data, &en_ovs_qos, NULL);
 
-    engine_add_input(&en_runtime_data, &en_sb_chassis, NULL);
+    engine_add_input(&en_runtime_data, &en_sb_chassis,
+                     runtime_data_sb_chassis_handler);
     engine_add_input(&en_runtime_data, &en_sb_datapath_binding,
                      runtime_data_sb_datapath_binding_handler);
     engine_add_input(&en_runtime_data, &en_sb_port_binding,
@@ -3597,10 +4625,32 @@ main(int argc, char *argv[])
     engine_add_input(&en_runtime_data, &en_ovs_interface_shadow,
                      runtime_data_ovs_interface_shadow_handler);
 
+    engine_add_input(&en_resident_lports, &en_ovs_open_vswitch, NULL);
+    engine_add_input(&en_resident_lports, &en_sb_chassis, NULL);
+    engine_add_input(&en_resident_lports, &en_sb_ha_chassis_group, NULL);
+    engine_add_input(&en_resident_lports, &en_sb_ha_chassis, NULL);
+    engine_add_input(&en_resident_lports, &en_runtime_data,
+                     resident_lports_runtime_data_handler);
+    engine_add_input(&en_resident_lports, &en_sb_port_binding,
+                     resident_lports_sb_port_binding_handler);
+
+    engine_add_input(&en_patch_ports, &en_ovs_open_vswitch, NULL);
+    engine_add_input(&en_patch_ports, &en_ovs_bridge, NULL);
+    engine_add_input(&en_patch_ports, &en_sb_chassis, NULL);
+    engine_add_input(&en_patch_ports, &en_sb_port_binding,
+                     patch_ports_sb_port_binding_handler);
+    engine_add_input(&en_patch_ports, &en_runtime_data,
+                     patch_ports_runtime_data_handler);
+    engine_add_input(&en_patch_ports, &en_ovs_port,
+                     patch_ports_ovs_port_handler);
+
     engine_add_input(&en_flow_output, &en_lflow_output,
                      flow_output_lflow_output_handler);
     engine_add_input(&en_flow_output, &en_pflow_output,
                      flow_output_pflow_output_handler);
+    /* The patch ports are committed to the OVS database outside of the
+     * engine, they don't affect the flows directly. */
+    engine_add_input(&en_flow_output, &en_patch_ports, engine_noop_handler);
 
     struct engine_arg engine_arg = {
         .sb_idl = ovnsb_idl_loop.idl,
@@ -3621,6 +4671,8 @@ main(int argc, char *argv[])
                                 sbrec_port_binding_by_key);
     engine_ovsdb_node_add_index(&en_sb_port_binding, "datapath",
                                 sbrec_port_binding_by_datapath);
+    engine_ovsdb_node_add_index(&en_sb_port_binding, "type",
+                                sbrec_port_binding_by_type);
     engine_ovsdb_node_add_index(&en_sb_datapath_binding, "key",
                                 sbrec_datapath_binding_by_key);
     engine_ovsdb_node_add_index(&en_sb_fdb, "dp_key",
@@ -3655,6 +4707,14 @@ main(int argc, char *argv[])
     unixctl_command_register("ct-zone-list", "", 0, 0,
                              ct_zone_list,
                              &ct_zones_data->current);
+    unixctl_command_register("ct-flush/show-stats", "", 0, 0,
+                             ct_flush_show_stats_cmd, NULL);
+    unixctl_command_register("ct-flush/clear-stats", "", 0, 0,
+                             ct_flush_clear_stats_cmd, NULL);
+    unixctl_command_register("coalesce/show-stats", "", 0, 0,
+                             coalesce_show_stats_cmd, NULL);
+    unixctl_command_register("coalesce/clear-stats", "", 0, 0,
+                             coalesce_clear_stats_cmd, NULL);
 
     struct pending_pkt pending_pkt = { .conn = NULL };
     unixctl_command_register("inject-pkt", "MICROFLOW", 1, 1, inject_pkt,
@@ -3674,6 +4734,12 @@ main(int argc, char *argv[])
                              lflow_cache_show_stats_cmd,
                              &lflow_output_data->pd);
 
+    unixctl_command_register("bfd/show-stats", "", 0, 0,
+                             bfd_show_stats_cmd, NULL);
+
+    unixctl_command_register("sb-monitor/show-stats", "", 0, 0,
+                             sb_monitor_show_stats_cmd, ovnsb_idl_loop.idl);
+
     bool reset_ovnsb_idl_min_index = false;
     unixctl_command_register("sb-cluster-state-reset", "", 0, 0,
                              cluster_state_reset_cmd,
@@ -3701,6 +4767,8 @@ main(int argc, char *argv[])
 
     unsigned int ovs_cond_seqno = UINT_MAX;
     unsigned int ovnsb_cond_seqno = UINT_MAX;
+    unsigned int ovs_seqno = 0;
+    unsigned int ovnsb_seqno = 0;
     unsigned int ovnsb_expected_cond_seqno = UINT_MAX;
 
     struct controller_engine_ctx ctrl_engine_ctx = {
@@ -3709,6 +4777,11 @@ main(int argc, char *argv[])
     };
     struct if_status_mgr *if_mgr = ctrl_engine_ctx.if_mgr;
 
+    unixctl_command_register("if-status-mgr/show-stats", "", 0, 0,
+                             if_status_mgr_show_stats_cmd, if_mgr);
+    unixctl_command_register("if-status-mgr/clear-stats", "", 0, 0,
+                             if_status_mgr_clear_stats_cmd, if_mgr);
+
     struct shash vif_plug_deleted_iface_ids =
         SHASH_INITIALIZER(&vif_plug_deleted_iface_ids);
     struct shash vif_plug_changed_iface_ids =
@@ -3722,6 +4795,7 @@ main(int argc, char *argv[])
     restart = false;
     int64_t startup_ts = time_wall_msec();
     bool sb_monitor_all = false;
+    bool sb_monitor_local_only = false;
     while (!exiting) {
         memory_run();
         if (memory_should_report()) {
@@ -3731,6 +4805,7 @@ main(int argc, char *argv[])
             ofctrl_get_memory_usage(&usage);
             if_status_mgr_get_memory_usage(if_mgr, &usage);
             local_datapath_memory_usage(&usage);
+            engine_get_memory_usage(&usage);
             ovsdb_idl_get_memory_usage(ovnsb_idl_loop.idl, &usage);
             ovsdb_idl_get_memory_usage(ovs_idl_loop.idl, &usage);
             memory_report(&usage);
@@ -3746,6 +4821,13 @@ main(int argc, char *argv[])
             goto loop_done;
         }
 
+        /* Let the changes of a burst accumulate before processing them. */
+        if (coalesce_hold()) {
+            unixctl_server_run(unixctl);
+            unixctl_server_wait(unixctl);
+            goto loop_done;
+        }
+
         engine_init_run();
 
         struct ovsdb_idl_txn *ovs_idl_txn = ovsdb_idl_loop_run(&ovs_idl_loop);
@@ -3760,7 +4842,7 @@ main(int argc, char *argv[])
         }
 
         update_sb_db(ovs_idl_loop.idl, ovnsb_idl_loop.idl, &sb_monitor_all,
-                     &reset_ovnsb_idl_min_index,
+                     &sb_monitor_local_only, &reset_ovnsb_idl_min_index,
                      &ctrl_engine_ctx, &ovnsb_expected_cond_seqno);
         update_ssl_config(ovsrec_ssl_table_get(ovs_idl_loop.idl));
         ofctrl_set_probe_interval(get_ofctrl_probe_interval(ovs_idl_loop.idl));
@@ -3777,6 +4859,21 @@ main(int argc, char *argv[])
             }
             ovnsb_cond_seqno = new_ovnsb_cond_seqno;
         }
+        bool idl_changed
+            = ovsdb_idl_get_seqno(ovs_idl_loop.idl) != ovs_seqno
+              || ovsdb_idl_get_seqno(ovnsb_idl_loop.idl) != ovnsb_seqno;
+        ovs_seqno = ovsdb_idl_get_seqno(ovs_idl_loop.idl);
+        ovnsb_seqno = ovsdb_idl_get_seqno(ovnsb_idl_loop.idl);
+        ha_chassis_cache_run(
+            sbrec_ha_chassis_group_table_get(ovnsb_idl_loop.idl),
+            sbrec_ha_chassis_table_get(ovnsb_idl_loop.idl));
+        ofctrl_meters_track(sbrec_meter_table_get(ovnsb_idl_loop.idl),
+                            sbrec_meter_band_table_get(ovnsb_idl_loop.idl));
+
+        /* Packets entered lazy datapaths, compile their logical flows. */
+        if (pinctrl_activate_lazy_datapaths()) {
+            engine_set_force_recompute(true);
+        }
 
         struct engine_context eng_ctx = {
             .ovs_idl_txn = ovs_idl_txn,
@@ -3862,7 +4959,11 @@ main(int argc, char *argv[])
                 if (chassis) {
                     encaps_run(ovs_idl_txn,
                                bridge_table, br_int,
+                               ovsrec_port_table_get(ovs_idl_loop.idl),
+                               ovsrec_interface_table_get(ovs_idl_loop.idl),
                                sbrec_chassis_table_get(ovnsb_idl_loop.idl),
+                               sbrec_encap_table_get(ovnsb_idl_loop.idl),
+                               sbrec_chassis_by_name,
                                chassis,
                                sbrec_sb_global_first(ovnsb_idl_loop.idl),
                                ovs_table,
@@ -3901,33 +5002,40 @@ main(int argc, char *argv[])
                     stopwatch_stop(CONTROLLER_LOOP_STOPWATCH_NAME,
                                    time_msec());
                     ct_zones_data = engine_get_data(&en_ct_zones);
-                    if (ovs_idl_txn) {
-                        if (ct_zones_data) {
-                            stopwatch_start(CT_ZONE_COMMIT_STOPWATCH_NAME,
-                                            time_msec());
-                            commit_ct_zones(br_int, &ct_zones_data->pending);
-                            stopwatch_stop(CT_ZONE_COMMIT_STOPWATCH_NAME,
-                                           time_msec());
-                        }
-                        stopwatch_start(BFD_RUN_STOPWATCH_NAME, time_msec());
-                        bfd_run(ovsrec_interface_table_get(ovs_idl_loop.idl),
-                                br_int, chassis,
-                                sbrec_ha_chassis_group_table_get(
-                                    ovnsb_idl_loop.idl),
-                                sbrec_sb_global_table_get(ovnsb_idl_loop.idl));
-                        stopwatch_stop(BFD_RUN_STOPWATCH_NAME, time_msec());
+                    if (ovs_idl_txn && ct_zones_data) {
+                        stopwatch_start(CT_ZONE_COMMIT_STOPWATCH_NAME,
+                                        time_msec());
+                        commit_ct_zones(br_int, &ct_zones_data->pending);
+                        stopwatch_stop(CT_ZONE_COMMIT_STOPWATCH_NAME,
+                                       time_msec());
                     }
-
-                    runtime_data = engine_get_data(&en_runtime_data);
-                    if (runtime_data) {
+                    stopwatch_start(BFD_RUN_STOPWATCH_NAME, time_msec());
+                    bfd_run(ovs_idl_txn,
+                            ovsrec_port_table_get(ovs_idl_loop.idl),
+                            ovsrec_interface_table_get(ovs_idl_loop.idl),
+                            br_int, chassis,
+                            sbrec_chassis_table_get(ovnsb_idl_loop.idl),
+                            sbrec_ha_chassis_table_get(ovnsb_idl_loop.idl),
+                            sbrec_ha_chassis_group_table_get(
+                                ovnsb_idl_loop.idl),
+                            sbrec_sb_global_table_get(ovnsb_idl_loop.idl));
+                    stopwatch_stop(BFD_RUN_STOPWATCH_NAME, time_msec());
+
+                    struct ed_type_patch_ports *patch_ports_data =
+                        engine_get_data(&en_patch_ports);
+                    if (ovs_idl_txn && patch_ports_data
+                        && patch_ports_data->commit_needed) {
                         stopwatch_start(PATCH_RUN_STOPWATCH_NAME, time_msec());
-                        patch_run(ovs_idl_txn,
-                            sbrec_port_binding_by_type,
+                        patch_ports_commit(ovs_idl_txn,
                             ovsrec_bridge_table_get(ovs_idl_loop.idl),
-                            ovsrec_open_vswitch_table_get(ovs_idl_loop.idl),
                             ovsrec_port_table_get(ovs_idl_loop.idl),
-                            br_int, chassis, &runtime_data->local_datapaths);
+                            &patch_ports_data->desired);
+                        patch_ports_data->commit_needed = false;
                         stopwatch_stop(PATCH_RUN_STOPWATCH_NAME, time_msec());
+                    }
+
+                    runtime_data = engine_get_data(&en_runtime_data);
+                    if (runtime_data) {
                         if (vif_plug_provider_has_providers() && ovs_idl_txn) {
                             struct vif_plug_ctx_in vif_plug_ctx_in = {
                                 .ovs_idl_txn = ovs_idl_txn,
@@ -3967,9 +5075,14 @@ main(int argc, char *argv[])
                                     sbrec_port_binding_by_key,
                                     sbrec_port_binding_by_name,
                                     sbrec_mac_binding_by_lport_ip,
+                                    sbrec_mac_binding_by_datapath,
                                     sbrec_igmp_group,
                                     sbrec_ip_multicast,
                                     sbrec_fdb_by_dp_key_mac,
+                                    sbrec_fdb_by_dp_key,
+                                    sbrec_mac_binding_table_get(
+                                        ovnsb_idl_loop.idl),
+                                    sbrec_fdb_table_get(ovnsb_idl_loop.idl),
                                     sbrec_dns_table_get(ovnsb_idl_loop.idl),
                                     sbrec_controller_event_table_get(
                                         ovnsb_idl_loop.idl),
@@ -3983,16 +5096,28 @@ main(int argc, char *argv[])
                                     &runtime_data->local_active_ports_ras);
                         stopwatch_stop(PINCTRL_RUN_STOPWATCH_NAME,
                                        time_msec());
+                        if (ovnsb_idl_txn &&
+                            !sset_is_empty(&runtime_data->postponed_ports)) {
+                            binding_claim_postponed_ports(
+                                chassis, &runtime_data->lbinding_data,
+                                &runtime_data->postponed_ports, if_mgr);
+                        }
                         /* Updating monitor conditions if runtime data or
-                         * logical datapath goups changed. */
+                         * logical datapath goups changed.  When monitoring
+                         * only local datapaths, the patch port peers are
+                         * discovered through Port_Binding updates, so those
+                         * also require updating the conditions. */
                         if (engine_node_changed(&en_runtime_data)
-                            || engine_node_changed(&en_sb_logical_dp_group)) {
+                            || engine_node_changed(&en_sb_logical_dp_group)
+                            || (sb_monitor_local_only
+                                && engine_node_changed(
+                                       &en_sb_port_binding))) {
                             ovnsb_expected_cond_seqno =
                                 update_sb_monitors(
                                     ovnsb_idl_loop.idl, chassis,
                                     &runtime_data->local_lports,
                                     &runtime_data->local_datapaths,
-                                    sb_monitor_all);
+                                    sb_monitor_all, sb_monitor_local_only);
                         }
                     }
 
@@ -4015,16 +5140,24 @@ main(int argc, char *argv[])
                     pflow_output_data = engine_get_data(&en_pflow_output);
                     if (lflow_output_data && pflow_output_data &&
                         ct_zones_data) {
+                        struct uuid *new_pb_uuids;
+                        size_t n_new_pb_uuids =
+                            get_pending_port_bindings(
+                                if_mgr, sbrec_port_binding_by_name,
+                                &new_pb_uuids);
+
                         stopwatch_start(OFCTRL_PUT_STOPWATCH_NAME,
                                         time_msec());
                         ofctrl_put(&lflow_output_data->flow_table,
                                    &pflow_output_data->flow_table,
                                    &ct_zones_data->pending,
-                                   sbrec_meter_table_get(ovnsb_idl_loop.idl),
+                                   sbrec_meter_by_name,
                                    ofctrl_seqno_get_req_cfg(),
                                    engine_node_changed(&en_lflow_output),
-                                   engine_node_changed(&en_pflow_output));
+                                   engine_node_changed(&en_pflow_output),
+                                   new_pb_uuids, n_new_pb_uuids);
                         stopwatch_stop(OFCTRL_PUT_STOPWATCH_NAME, time_msec());
+                        free(new_pb_uuids);
                     }
                     stopwatch_start(OFCTRL_SEQNO_RUN_STOPWATCH_NAME,
                                     time_msec());
@@ -4059,6 +5192,10 @@ main(int argc, char *argv[])
                 poll_immediate_wake();
             } else {
                 engine_set_force_recompute(false);
+                if (engine_yielded()) {
+                    /* Resume the recompute in the next iteration. */
+                    poll_immediate_wake();
+                }
             }
 
             store_nb_cfg(ovnsb_idl_txn, ovs_idl_txn, chassis_private,
@@ -4152,6 +5289,7 @@ main(int argc, char *argv[])
 
         lflow_cache_run(ctrl_engine_ctx.lflow_cache);
         lflow_cache_wait(ctrl_engine_ctx.lflow_cache);
+        coalesce_run(idl_changed);
 
 loop_done:
         memory_wait();
@@ -4161,6 +5299,10 @@ loop_done:
         }
     }
 
+    /* Save the flows before the group and meter tables go away with the
+     * engine data. */
+    ofctrl_save_snapshot();
+
     engine_set_context(NULL);
     engine_cleanup();
 
@@ -4169,7 +5311,7 @@ loop_done:
         bool done = !ovsdb_idl_has_ever_connected(ovnsb_idl_loop.idl);
         while (!done) {
             update_sb_db(ovs_idl_loop.idl, ovnsb_idl_loop.idl,
-                         NULL, NULL, NULL, NULL);
+                         NULL, NULL, NULL, NULL, NULL);
             update_ssl_config(ovsrec_ssl_table_get(ovs_idl_loop.idl));
 
             struct ovsdb_idl_txn *ovs_idl_txn
@@ -4222,6 +5364,7 @@ loop_done:
     ofctrl_destroy();
     pinctrl_destroy();
     patch_destroy();
+    ha_chassis_cache_destroy();
     if_status_mgr_destroy(if_mgr);
     shash_destroy(&vif_plug_deleted_iface_ids);
     shash_destroy(&vif_plug_changed_iface_ids);
@@ -4449,6 +5592,151 @@ lflow_cache_show_stats_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
     ds_destroy(&ds);
 }
 
+static void
+bfd_show_stats_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                   const char *argv[] OVS_UNUSED, void *arg OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+
+    pinctrl_bfd_get_stats(&ds);
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
+static void
+sb_monitor_show_stats_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                          const char *argv[] OVS_UNUSED, void *ovnsb_idl_)
+{
+    struct ovsdb_idl *ovnsb_idl = ovnsb_idl_;
+    static const struct ovsdb_idl_table_class *tables[] = {
+        &sbrec_table_port_binding,
+        &sbrec_table_logical_flow,
+        &sbrec_table_mac_binding,
+        &sbrec_table_static_mac_binding,
+        &sbrec_table_multicast_group,
+        &sbrec_table_dns,
+        &sbrec_table_ip_multicast,
+        &sbrec_table_fdb,
+        &sbrec_table_load_balancer,
+    };
+    struct ds ds = DS_EMPTY_INITIALIZER;
+
+    ds_put_format(&ds, "Monitor mode: %s\n", sb_monitor_mode);
+    ds_put_cstr(&ds, "Rows received:\n");
+    for (size_t i = 0; i < ARRAY_SIZE(tables); i++) {
+        const struct ovsdb_idl_row *row;
+        size_t n_rows = 0;
+
+        for (row = ovsdb_idl_first_row(ovnsb_idl, tables[i]); row;
+             row = ovsdb_idl_next_row(row)) {
+            n_rows++;
+        }
+        ds_put_format(&ds, "  %-20s: %"PRIuSIZE"\n", tables[i]->name, n_rows);
+    }
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
+static void
+if_status_mgr_show_stats_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                             const char *argv[] OVS_UNUSED, void *if_mgr_)
+{
+    struct if_status_mgr *if_mgr = if_mgr_;
+    struct ds ds = DS_EMPTY_INITIALIZER;
+
+    if_status_mgr_get_stats(if_mgr, &ds);
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
+static void
+if_status_mgr_clear_stats_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                              const char *argv[] OVS_UNUSED, void *if_mgr_)
+{
+    struct if_status_mgr *if_mgr = if_mgr_;
+
+    if_status_mgr_clear_stats(if_mgr);
+    unixctl_command_reply(conn, NULL);
+}
+
+static void
+ct_flush_show_stats_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                        const char *argv[] OVS_UNUSED, void *arg OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+
+    ofctrl_ct_flush_get_stats(&ds);
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
+static void
+ct_flush_clear_stats_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                         const char *argv[] OVS_UNUSED, void *arg OVS_UNUSED)
+{
+    ofctrl_ct_flush_clear_stats();
+    unixctl_command_reply(conn, NULL);
+}
+
+static void
+coalesce_show_stats_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                        const char *argv[] OVS_UNUSED, void *arg OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+
+    ds_put_format(&ds, "Maximum delay: %u ms\n", coalesce.max_delay);
+    ds_put_format(&ds, "Current delay: %u ms\n", coalesce.delay);
+    ds_put_format(&ds, "Peak delay: %u ms\n", coalesce.peak_delay);
+    ds_put_format(&ds, "Runs with changes: %"PRIu64"\n", coalesce.n_runs);
+    ds_put_format(&ds, "Runs followed by a delay: %"PRIu64"\n",
+                  coalesce.n_holds);
+    ds_put_format(&ds, "Wakeups held back: %"PRIu64"\n",
+                  coalesce.n_held_wakeups);
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
+static void
+coalesce_clear_stats_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                         const char *argv[] OVS_UNUSED, void *arg OVS_UNUSED)
+{
+    coalesce.n_runs = 0;
+    coalesce.n_holds = 0;
+    coalesce.n_held_wakeups = 0;
+    coalesce.peak_delay = 0;
+    unixctl_command_reply(conn, NULL);
+}
+
+static void
+ofctrl_latency_show_cmd(struct unixctl_conn *conn, int argc,
+                        const char *argv[], void *arg OVS_UNUSED)
+{
+    bool as_json = false;
+
+    if (argc > 1) {
+        if (strcmp(argv[1], "json")) {
+            unixctl_command_reply_error(conn, "unknown format, "
+                                        "only \"json\" is supported");
+            return;
+        }
+        as_json = true;
+    }
+
+    struct ds ds = DS_EMPTY_INITIALIZER;
+
+    ofctrl_latency_format(&ds, as_json);
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
+static void
+ofctrl_latency_clear_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                         const char *argv[] OVS_UNUSED, void *arg OVS_UNUSED)
+{
+    ofctrl_latency_clear();
+    unixctl_command_reply(conn, NULL);
+}
+
 static void
 cluster_state_reset_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
                const char *argv[] OVS_UNUSED, void *idl_reset_)
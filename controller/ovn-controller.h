@@ -38,6 +38,7 @@ struct ct_zone_pending_entry {
     bool add;             /* Is the entry being added? */
     ovs_be32 of_xid;      /* Transaction id for barrier. */
     enum ct_zone_pending_state state;
+    long long int queued_msec; /* When the entry was added. */
 };
 
 const struct ovsrec_bridge *get_bridge(const struct ovsrec_bridge_table *,
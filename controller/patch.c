@@ -161,11 +161,32 @@ add_ovs_bridge_mappings(const struct ovsrec_open_vswitch_table *ovs_table,
     }
 }
 
+/* Adds to 'desired_ports' a patch port named 'name' in bridge 'bridge', whose
+ * peer is 'peer' in bridge 'peer_bridge'. */
 static void
-add_bridge_mappings_by_type(struct ovsdb_idl_txn *ovs_idl_txn,
-                            struct ovsdb_idl_index *sbrec_port_binding_by_type,
+add_desired_patch_port(struct shash *desired_ports, const char *key,
+                       const char *logical_port,
+                       const char *bridge, const char *name,
+                       const char *peer_bridge, const char *peer)
+{
+    if (shash_find(desired_ports, name)) {
+        return;
+    }
+
+    struct desired_patch_port *dpp = xmalloc(sizeof *dpp);
+    dpp->name = xstrdup(name);
+    dpp->bridge = xstrdup(bridge);
+    dpp->peer = xstrdup(peer);
+    dpp->peer_bridge = xstrdup(peer_bridge);
+    dpp->key = key;
+    dpp->logical_port = xstrdup(logical_port);
+    shash_add(desired_ports, name, dpp);
+}
+
+static void
+add_bridge_mappings_by_type(struct ovsdb_idl_index *sbrec_port_binding_by_type,
                             const struct ovsrec_bridge *br_int,
-                            struct shash *existing_ports,
+                            struct shash *desired_ports,
                             const struct sbrec_chassis *chassis,
                             struct shash *bridge_mappings,
                             const char *pb_type, const char *patch_port_id,
@@ -221,38 +242,43 @@ add_bridge_mappings_by_type(struct ovsdb_idl_txn *ovs_idl_txn,
 
         char *name1 = patch_port_name(br_int->name, binding->logical_port);
         char *name2 = patch_port_name(binding->logical_port, br_int->name);
-        create_patch_port(ovs_idl_txn, patch_port_id, binding->logical_port,
-                          br_int, name1, br_ln, name2, existing_ports);
-        create_patch_port(ovs_idl_txn, patch_port_id, binding->logical_port,
-                          br_ln, name2, br_int, name1, existing_ports);
+        add_desired_patch_port(desired_ports, patch_port_id,
+                               binding->logical_port,
+                               br_int->name, name1, br_ln->name, name2);
+        add_desired_patch_port(desired_ports, patch_port_id,
+                               binding->logical_port,
+                               br_ln->name, name2, br_int->name, name1);
         free(name1);
         free(name2);
     }
     sbrec_port_binding_index_destroy_row(target);
 }
 
-/* Obtains external-ids:ovn-bridge-mappings from OVSDB and adds patch ports for
- * the local bridge mappings.  Removes any patch ports for bridge mappings that
- * already existed from 'existing_ports'. */
-static void
-add_bridge_mappings(struct ovsdb_idl_txn *ovs_idl_txn,
-                    struct ovsdb_idl_index *sbrec_port_binding_by_type,
+/* Obtains external-ids:ovn-bridge-mappings from OVSDB and fills
+ * 'desired_ports' with the patch ports that should exist for the local bridge
+ * mappings, i.e. for the localnet ports of the local datapaths and the
+ * l2gateway ports bound to 'chassis'.  The previous content of
+ * 'desired_ports' is discarded. */
+void
+patch_ports_compute(struct ovsdb_idl_index *sbrec_port_binding_by_type,
                     const struct ovsrec_bridge_table *bridge_table,
                     const struct ovsrec_open_vswitch_table *ovs_table,
                     const struct ovsrec_bridge *br_int,
-                    struct shash *existing_ports,
                     const struct sbrec_chassis *chassis,
-                    const struct hmap *local_datapaths)
+                    const struct hmap *local_datapaths,
+                    struct shash *desired_ports)
 {
+    patch_ports_clear(desired_ports);
+
     /* Get ovn-bridge-mappings. */
     struct shash bridge_mappings = SHASH_INITIALIZER(&bridge_mappings);
 
     add_ovs_bridge_mappings(ovs_table, bridge_table, &bridge_mappings);
 
-    add_bridge_mappings_by_type(ovs_idl_txn, sbrec_port_binding_by_type,
-                                br_int, existing_ports, chassis,
-                                &bridge_mappings, "l2gateway",
-                                "ovn-l2gateway-port", local_datapaths, true);
+    add_bridge_mappings_by_type(sbrec_port_binding_by_type, br_int,
+                                desired_ports, chassis, &bridge_mappings,
+                                "l2gateway", "ovn-l2gateway-port",
+                                local_datapaths, true);
 
     /* Since having localnet ports that are not mapped on some chassis is a
      * supported configuration used to implement multisegment switches with
@@ -260,40 +286,55 @@ add_bridge_mappings(struct ovsdb_idl_txn *ovs_idl_txn,
      * run but don't unnecessarily pollute the log file; pass
      * 'log_missing_bridge = false'.
      */
-    add_bridge_mappings_by_type(ovs_idl_txn, sbrec_port_binding_by_type,
-                                br_int, existing_ports, NULL,
-                                &bridge_mappings, "localnet",
-                                "ovn-localnet-port", local_datapaths, false);
+    add_bridge_mappings_by_type(sbrec_port_binding_by_type, br_int,
+                                desired_ports, NULL, &bridge_mappings,
+                                "localnet", "ovn-localnet-port",
+                                local_datapaths, false);
     shash_destroy(&bridge_mappings);
 }
 
+/* Returns true if 'pb' may need a patch port, i.e. if adding, updating or
+ * removing it may change the result of patch_ports_compute(). */
+bool
+patch_ports_is_relevant_pb(const struct sbrec_port_binding *pb)
+{
+    return !strcmp(pb->type, "localnet") || !strcmp(pb->type, "l2gateway");
+}
+
+/* Returns true if 'port' is, or may be, a patch port managed by
+ * ovn-controller.
+ *
+ * ovn-controller does not create or use ports of type "ovn-l3gateway-port"
+ * or "ovn-logical-patch-port", but older version did.  We still recognize
+ * them here, so that patch_ports_commit() deletes them, to avoid leaving
+ * useless ports on upgrade. */
+bool
+patch_ports_is_managed_port(const struct ovsrec_port *port)
+{
+    return (smap_get(&port->external_ids, "ovn-localnet-port")
+            || smap_get(&port->external_ids, "ovn-l2gateway-port")
+            || smap_get(&port->external_ids, "ovn-l3gateway-port")
+            || smap_get(&port->external_ids, "ovn-logical-patch-port"));
+}
+
+/* Makes the patch ports managed by ovn-controller in the OVS database match
+ * 'desired_ports': creates the missing ones and deletes the ones that should
+ * not exist anymore. */
 void
-patch_run(struct ovsdb_idl_txn *ovs_idl_txn,
-          struct ovsdb_idl_index *sbrec_port_binding_by_type,
-          const struct ovsrec_bridge_table *bridge_table,
-          const struct ovsrec_open_vswitch_table *ovs_table,
-          const struct ovsrec_port_table *port_table,
-          const struct ovsrec_bridge *br_int,
-          const struct sbrec_chassis *chassis,
-          const struct hmap *local_datapaths)
+patch_ports_commit(struct ovsdb_idl_txn *ovs_idl_txn,
+                   const struct ovsrec_bridge_table *bridge_table,
+                   const struct ovsrec_port_table *port_table,
+                   const struct shash *desired_ports)
 {
     if (!ovs_idl_txn) {
         return;
     }
 
-    /* Figure out what patch ports already exist.
-     *
-     * ovn-controller does not create or use ports of type "ovn-l3gateway-port"
-     * or "ovn-logical-patch-port", but older version did.  We still recognize
-     * them here, so that we delete them at the end of this function, to avoid
-     * leaving useless ports on upgrade. */
+    /* Figure out what patch ports already exist. */
     struct shash existing_ports = SHASH_INITIALIZER(&existing_ports);
     const struct ovsrec_port *port;
     OVSREC_PORT_TABLE_FOR_EACH (port, port_table) {
-        if (smap_get(&port->external_ids, "ovn-localnet-port")
-            || smap_get(&port->external_ids, "ovn-l2gateway-port")
-            || smap_get(&port->external_ids, "ovn-l3gateway-port")
-            || smap_get(&port->external_ids, "ovn-logical-patch-port")) {
+        if (patch_ports_is_managed_port(port)) {
             shash_add(&existing_ports, port->name, port);
         }
     }
@@ -301,17 +342,43 @@ patch_run(struct ovsdb_idl_txn *ovs_idl_txn,
     /* Create in the database any patch ports that should exist.  Remove from
      * 'existing_ports' any patch ports that do exist in the database and
      * should be there. */
-    add_bridge_mappings(ovs_idl_txn, sbrec_port_binding_by_type, bridge_table,
-                        ovs_table, br_int, &existing_ports, chassis,
-                        local_datapaths);
+    struct shash_node *node;
+    SHASH_FOR_EACH (node, desired_ports) {
+        const struct desired_patch_port *dpp = node->data;
+        const struct ovsrec_bridge *src = get_bridge(bridge_table,
+                                                     dpp->bridge);
+        const struct ovsrec_bridge *dst = get_bridge(bridge_table,
+                                                     dpp->peer_bridge);
+        if (src && dst) {
+            create_patch_port(ovs_idl_txn, dpp->key, dpp->logical_port,
+                              src, dpp->name, dst, dpp->peer,
+                              &existing_ports);
+        }
+    }
 
     /* Now 'existing_ports' only still contains patch ports that exist in the
      * database but shouldn't.  Delete them from the database. */
-    struct shash_node *port_node;
-    SHASH_FOR_EACH_SAFE (port_node, &existing_ports) {
-        port = port_node->data;
-        shash_delete(&existing_ports, port_node);
+    SHASH_FOR_EACH_SAFE (node, &existing_ports) {
+        port = node->data;
+        shash_delete(&existing_ports, node);
         remove_port(bridge_table, port);
     }
     shash_destroy(&existing_ports);
 }
+
+/* Removes and frees all the desired patch ports in 'desired_ports'. */
+void
+patch_ports_clear(struct shash *desired_ports)
+{
+    struct shash_node *node;
+    SHASH_FOR_EACH_SAFE (node, desired_ports) {
+        struct desired_patch_port *dpp = node->data;
+        shash_delete(desired_ports, node);
+        free(dpp->name);
+        free(dpp->bridge);
+        free(dpp->peer);
+        free(dpp->peer_bridge);
+        free(dpp->logical_port);
+        free(dpp);
+    }
+}
@@ -16,6 +16,8 @@
 #ifndef OVN_PATCH_H
 #define OVN_PATCH_H 1
 
+#include <stdbool.h>
+
 /* Patch Ports
  * ===========
  *
@@ -28,22 +30,40 @@ struct ovsdb_idl_index;
 struct ovsrec_bridge;
 struct ovsrec_bridge_table;
 struct ovsrec_open_vswitch_table;
+struct ovsrec_port;
 struct ovsrec_port_table;
-struct sbrec_port_binding_table;
+struct sbrec_port_binding;
 struct sbrec_chassis;
 struct shash;
 
+/* A patch port that should exist in the OVS database, as computed by
+ * patch_ports_compute(). */
+struct desired_patch_port {
+    char *name;              /* Name of the patch port. */
+    char *bridge;            /* Name of the bridge of the patch port. */
+    char *peer;              /* Name of the peer patch port. */
+    char *peer_bridge;       /* Name of the bridge of the peer. */
+    const char *key;         /* "ovn-localnet-port" or "ovn-l2gateway-port". */
+    char *logical_port;      /* Value of external-ids:'key'. */
+};
+
 void add_ovs_bridge_mappings(const struct ovsrec_open_vswitch_table *ovs_table,
                              const struct ovsrec_bridge_table *bridge_table,
                              struct shash *bridge_mappings);
-void patch_run(struct ovsdb_idl_txn *ovs_idl_txn,
-               struct ovsdb_idl_index *sbrec_port_binding_by_type,
-               const struct ovsrec_bridge_table *,
-               const struct ovsrec_open_vswitch_table *,
-               const struct ovsrec_port_table *,
-               const struct ovsrec_bridge *br_int,
-               const struct sbrec_chassis *,
-               const struct hmap *local_datapaths);
+void patch_ports_compute(struct ovsdb_idl_index *sbrec_port_binding_by_type,
+                         const struct ovsrec_bridge_table *,
+                         const struct ovsrec_open_vswitch_table *,
+                         const struct ovsrec_bridge *br_int,
+                         const struct sbrec_chassis *,
+                         const struct hmap *local_datapaths,
+                         struct shash *desired_ports);
+bool patch_ports_is_relevant_pb(const struct sbrec_port_binding *);
+bool patch_ports_is_managed_port(const struct ovsrec_port *);
+void patch_ports_commit(struct ovsdb_idl_txn *ovs_idl_txn,
+                        const struct ovsrec_bridge_table *,
+                        const struct ovsrec_port_table *,
+                        const struct shash *desired_ports);
+void patch_ports_clear(struct shash *desired_ports);
 void patch_init(void);
 void patch_destroy(void);
 
@@ -52,6 +52,7 @@
 VLOG_DEFINE_THIS_MODULE(physical);
 
 COVERAGE_DEFINE(physical_run);
+COVERAGE_DEFINE(physical_mc_flows_unchanged);
 
 /* Datapath zone IDs for connection tracking and NAT */
 struct zone_ids {
@@ -69,6 +70,26 @@ static int64_t get_vxlan_port_key(int64_t port_key);
 /* UUID to identify OF flows not associated with ovsdb rows. */
 static struct uuid *hc_uuid = NULL;
 
+/* UUIDs to identify the OF flows that receive from the tunnels to a remote
+ * chassis, so that they can be updated when these tunnels change.  Maps from
+ * a chassis name to a "struct uuid". */
+static struct shash tunnel_flow_uuids = SHASH_INITIALIZER(&tunnel_flow_uuids);
+
+/* The flows of a multicast group in tables 37 and 38, as last added to the
+ * desired flow table.  Most changes of a multicast group, e.g., a port
+ * bound to a chassis that is already in the group joining or leaving it,
+ * don't change the flows on this chassis, in which case they are left
+ * alone instead of being removed and added back. */
+struct mc_group_flows {
+    struct hmap_node hmap_node;   /* In 'mc_group_flows', by uuid. */
+    struct uuid mc_uuid;
+    struct match match;
+    struct ofpbuf local_ofpacts;  /* Table 38 actions, empty if no flow. */
+    struct ofpbuf remote_ofpacts; /* Table 37 actions, empty if no flow. */
+};
+
+static struct hmap mc_group_flows = HMAP_INITIALIZER(&mc_group_flows);
+
 #define CHASSIS_MAC_TO_ROUTER_MAC_CONJID        100
 
 void
@@ -1432,6 +1453,97 @@ chassis_is_vtep(const struct sbrec_chassis *chassis)
     return smap_get_bool(&chassis->other_config, "is-vtep", false);
 }
 
+static struct mc_group_flows *
+mc_group_flows_find(const struct uuid *mc_uuid)
+{
+    struct mc_group_flows *f;
+    HMAP_FOR_EACH_WITH_HASH (f, hmap_node, uuid_hash(mc_uuid),
+                             &mc_group_flows) {
+        if (uuid_equals(&f->mc_uuid, mc_uuid)) {
+            return f;
+        }
+    }
+    return NULL;
+}
+
+static void
+mc_group_flows_destroy(struct mc_group_flows *f)
+{
+    ofpbuf_uninit(&f->local_ofpacts);
+    ofpbuf_uninit(&f->remote_ofpacts);
+    free(f);
+}
+
+/* Forgets the flows of all the multicast groups, which must be called when
+ * the desired flow table is cleared. */
+static void
+mc_group_flows_clear(void)
+{
+    struct mc_group_flows *f;
+    HMAP_FOR_EACH_POP (f, hmap_node, &mc_group_flows) {
+        mc_group_flows_destroy(f);
+    }
+}
+
+static void
+mc_group_remove_flows(struct ovn_desired_flow_table *flow_table,
+                      const struct uuid *mc_uuid)
+{
+    struct mc_group_flows *f = mc_group_flows_find(mc_uuid);
+    if (f) {
+        hmap_remove(&mc_group_flows, &f->hmap_node);
+        mc_group_flows_destroy(f);
+    }
+    ofctrl_remove_flows(flow_table, mc_uuid);
+}
+
+/* Sets the flows of multicast group 'mc' in tables 37 and 38 to the ones
+ * with 'match' and the given actions, if not empty.  The flows are only
+ * replaced in 'flow_table' if they differ from the current ones. */
+static void
+mc_group_update_flows(struct ovn_desired_flow_table *flow_table,
+                      const struct sbrec_multicast_group *mc,
+                      const struct match *match,
+                      const struct ofpbuf *local_ofpacts,
+                      const struct ofpbuf *remote_ofpacts)
+{
+    const struct uuid *mc_uuid = &mc->header_.uuid;
+    struct mc_group_flows *f = mc_group_flows_find(mc_uuid);
+
+    if (f) {
+        if (match_equal(&f->match, match)
+            && ofpacts_equal(f->local_ofpacts.data, f->local_ofpacts.size,
+                             local_ofpacts->data, local_ofpacts->size)
+            && ofpacts_equal(f->remote_ofpacts.data, f->remote_ofpacts.size,
+                             remote_ofpacts->data, remote_ofpacts->size)) {
+            COVERAGE_INC(physical_mc_flows_unchanged);
+            return;
+        }
+        ofctrl_remove_flows(flow_table, mc_uuid);
+        ofpbuf_clear(&f->local_ofpacts);
+        ofpbuf_clear(&f->remote_ofpacts);
+    } else {
+        f = xmalloc(sizeof *f);
+        f->mc_uuid = *mc_uuid;
+        ofpbuf_init(&f->local_ofpacts, local_ofpacts->size);
+        ofpbuf_init(&f->remote_ofpacts, remote_ofpacts->size);
+        hmap_insert(&mc_group_flows, &f->hmap_node, uuid_hash(mc_uuid));
+    }
+    f->match = *match;
+    ofpbuf_put(&f->local_ofpacts, local_ofpacts->data, local_ofpacts->size);
+    ofpbuf_put(&f->remote_ofpacts, remote_ofpacts->data,
+               remote_ofpacts->size);
+
+    if (local_ofpacts->size) {
+        ofctrl_add_flow(flow_table, OFTABLE_LOCAL_OUTPUT, 100,
+                        mc_uuid->parts[0], match, local_ofpacts, mc_uuid);
+    }
+    if (remote_ofpacts->size) {
+        ofctrl_add_flow(flow_table, OFTABLE_REMOTE_OUTPUT, 100,
+                        mc_uuid->parts[0], match, remote_ofpacts, mc_uuid);
+    }
+}
+
 static void
 consider_mc_group(struct ovsdb_idl_index *sbrec_port_binding_by_name,
                   enum mf_field_id mff_ovn_geneve,
@@ -1447,6 +1559,7 @@ consider_mc_group(struct ovsdb_idl_index *sbrec_port_binding_by_name,
     uint32_t dp_key = mc->datapath->tunnel_key;
     struct local_datapath *ldp = get_local_datapath(local_datapaths, dp_key);
     if (!ldp) {
+        mc_group_remove_flows(flow_table, &mc->header_.uuid);
         return;
     }
 
@@ -1567,10 +1680,6 @@ consider_mc_group(struct ovsdb_idl_index *sbrec_port_binding_by_name,
         /* Following delivery to local logical ports, restore the multicast
          * group as the logical output port. */
         put_load(mc->tunnel_key, MFF_LOG_OUTPORT, 0, 32, &ofpacts);
-
-        ofctrl_add_flow(flow_table, OFTABLE_LOCAL_OUTPUT, 100,
-                        mc->header_.uuid.parts[0],
-                        &match, &ofpacts, &mc->header_.uuid);
     }
 
     /* Table 37, priority 100.
@@ -1594,15 +1703,12 @@ consider_mc_group(struct ovsdb_idl_index *sbrec_port_binding_by_name,
                           mc->datapath, mc->tunnel_key, true,
                           &remote_ofpacts);
 
-        if (remote_ofpacts.size) {
-            if (local_ports) {
-                put_resubmit(OFTABLE_LOCAL_OUTPUT, &remote_ofpacts);
-            }
-            ofctrl_add_flow(flow_table, OFTABLE_REMOTE_OUTPUT, 100,
-                            mc->header_.uuid.parts[0],
-                            &match, &remote_ofpacts, &mc->header_.uuid);
+        if (remote_ofpacts.size && local_ports) {
+            put_resubmit(OFTABLE_LOCAL_OUTPUT, &remote_ofpacts);
         }
     }
+    mc_group_update_flows(flow_table, mc, &match, &ofpacts, &remote_ofpacts);
+
     ofpbuf_uninit(&ofpacts);
     ofpbuf_uninit(&remote_ofpacts);
     sset_destroy(&remote_chassis);
@@ -1627,6 +1733,91 @@ physical_eval_port_binding(struct physical_ctx *p_ctx,
     ofpbuf_uninit(&ofpacts);
 }
 
+static void
+physical_reconsider_port_binding(struct physical_ctx *p_ctx,
+                                 const struct sbrec_port_binding *pb,
+                                 struct ovn_desired_flow_table *flow_table)
+{
+    ofctrl_remove_flows(flow_table, &pb->header_.uuid);
+    physical_eval_port_binding(p_ctx, pb, flow_table);
+}
+
+/* The flows of a local datapath that depend on its localnet port or on the
+ * OVS patch ports of its localnet and l2gateway ports are those of:
+ *
+ *   - its port bindings, which are reached through the localnet port when
+ *     they are remote;
+ *
+ *   - the chassisredirect ports of the peer routers, which are bridged to
+ *     the localnet port when they are remote;
+ *
+ *   - its multicast groups.
+ *
+ * Regenerates them for the datapath of 'bridged_pb', a localnet or l2gateway
+ * port which has already been handled itself.  Returns false if the changes
+ * cannot be handled incrementally. */
+static bool
+physical_handle_bridged_port_changes(
+    struct physical_ctx *p_ctx, const struct sbrec_port_binding *bridged_pb,
+    struct ovn_desired_flow_table *flow_table)
+{
+    const struct local_datapath *ld =
+        get_local_datapath(p_ctx->local_datapaths,
+                           bridged_pb->datapath->tunnel_key);
+    if (!ld) {
+        return true;
+    }
+
+    struct ovsdb_idl_index *pbs_by_dp = p_ctx->sbrec_port_binding_by_datapath;
+    struct sbrec_port_binding *target =
+        sbrec_port_binding_index_init_row(pbs_by_dp);
+    sbrec_port_binding_index_set_datapath(target, ld->datapath);
+
+    const struct sbrec_port_binding *pb;
+    SBREC_PORT_BINDING_FOR_EACH_EQUAL (pb, target, pbs_by_dp) {
+        if (!strcmp(pb->type, "vtep")) {
+            /* Cannot handle changes to vtep lports (yet). */
+            sbrec_port_binding_index_destroy_row(target);
+            return false;
+        }
+        if (pb != bridged_pb) {
+            physical_reconsider_port_binding(p_ctx, pb, flow_table);
+        }
+    }
+    sbrec_port_binding_index_destroy_row(target);
+
+    for (size_t i = 0; i < ld->n_peer_ports; i++) {
+        char *cr_name = xasprintf("cr-%s",
+                                  ld->peer_ports[i].remote->logical_port);
+        const struct sbrec_port_binding *cr_pb =
+            lport_lookup_by_name(p_ctx->sbrec_port_binding_by_name, cr_name);
+        free(cr_name);
+        if (cr_pb) {
+            physical_reconsider_port_binding(p_ctx, cr_pb, flow_table);
+        }
+    }
+
+    const struct sbrec_multicast_group *mc;
+    SBREC_MULTICAST_GROUP_TABLE_FOR_EACH (mc, p_ctx->mc_group_table) {
+        if (mc->datapath == ld->datapath) {
+            consider_mc_group(p_ctx->sbrec_port_binding_by_name,
+                              p_ctx->mff_ovn_geneve, p_ctx->ct_zones,
+                              p_ctx->local_datapaths, p_ctx->local_bindings,
+                              p_ctx->patch_ofports, p_ctx->chassis,
+                              mc, p_ctx->chassis_tunnels,
+                              flow_table);
+        }
+    }
+
+    return true;
+}
+
+static bool
+port_binding_is_bridged(const struct sbrec_port_binding *pb)
+{
+    return !strcmp(pb->type, "localnet") || !strcmp(pb->type, "l2gateway");
+}
+
 bool
 physical_handle_flows_for_lport(const struct sbrec_port_binding *pb,
                                 bool removed, struct physical_ctx *p_ctx,
@@ -1664,6 +1855,38 @@ physical_handle_flows_for_lport(const struct sbrec_port_binding *pb,
         }
     }
 
+    if (port_binding_is_bridged(pb)) {
+        return physical_handle_bridged_port_changes(p_ctx, pb, flow_table);
+    }
+
+    return true;
+}
+
+/* Handles the changes of the OVS patch ports of the localnet and l2gateway
+ * ports named in 'lport_names', i.e. patch ports that were added, removed or
+ * whose OpenFlow port changed.
+ *
+ * Returns false if the changes cannot be handled incrementally. */
+bool
+physical_handle_patch_ofport_changes(struct physical_ctx *p_ctx,
+                                     const struct sset *lport_names,
+                                     struct ovn_desired_flow_table *flow_table)
+{
+    const char *lport_name;
+    SSET_FOR_EACH (lport_name, lport_names) {
+        const struct sbrec_port_binding *pb =
+            lport_lookup_by_name(p_ctx->sbrec_port_binding_by_name,
+                                 lport_name);
+        if (!pb || !port_binding_is_bridged(pb)) {
+            /* The port binding was deleted, which is handled through the
+             * port binding changes, or the patch port is stale and
+             * doesn't affect the flows. */
+            continue;
+        }
+        if (!physical_handle_flows_for_lport(pb, false, p_ctx, flow_table)) {
+            return false;
+        }
+    }
     return true;
 }
 
@@ -1674,11 +1897,8 @@ physical_handle_mc_group_changes(struct physical_ctx *p_ctx,
     const struct sbrec_multicast_group *mc;
     SBREC_MULTICAST_GROUP_TABLE_FOR_EACH_TRACKED (mc, p_ctx->mc_group_table) {
         if (sbrec_multicast_group_is_deleted(mc)) {
-            ofctrl_remove_flows(flow_table, &mc->header_.uuid);
+            mc_group_remove_flows(flow_table, &mc->header_.uuid);
         } else {
-            if (!sbrec_multicast_group_is_new(mc)) {
-                ofctrl_remove_flows(flow_table, &mc->header_.uuid);
-            }
             consider_mc_group(p_ctx->sbrec_port_binding_by_name,
                               p_ctx->mff_ovn_geneve, p_ctx->ct_zones,
                               p_ctx->local_datapaths, p_ctx->local_bindings,
@@ -1690,6 +1910,205 @@ physical_handle_mc_group_changes(struct physical_ctx *p_ctx,
     }
 }
 
+/* Returns the uuid of the flows that receive from the tunnels to
+ * 'chassis_name', creating it if needed. */
+static const struct uuid *
+get_tunnel_flow_uuid(const char *chassis_name)
+{
+    struct uuid *uuid = shash_find_data(&tunnel_flow_uuids, chassis_name);
+    if (!uuid) {
+        uuid = xmalloc(sizeof *uuid);
+        uuid_generate(uuid);
+        shash_add(&tunnel_flow_uuids, chassis_name, uuid);
+    }
+    return uuid;
+}
+
+/* Adds the flows that process the packets received from the tunnel 'tun'. */
+static void
+put_chassis_tunnel_flows(const struct physical_ctx *p_ctx,
+                         const struct chassis_tunnel *tun,
+                         const struct uuid *tun_uuid,
+                         struct ofpbuf *ofpacts,
+                         struct ovn_desired_flow_table *flow_table)
+{
+    /* Add flows for Geneve, STT and VXLAN encapsulations.  Geneve and STT
+     * encapsulations have metadata about the ingress and egress logical ports.
+     * VXLAN encapsulations have metadata about the egress logical port only.
+     * We set MFF_LOG_DATAPATH, MFF_LOG_INPORT, and MFF_LOG_OUTPORT from the
+     * tunnel key data where possible, then resubmit to table 38 to handle
+     * packets to the local hypervisor. */
+    struct match match = MATCH_CATCHALL_INITIALIZER;
+    match_set_in_port(&match, tun->ofport);
+
+    ofpbuf_clear(ofpacts);
+    if (tun->type == GENEVE) {
+        put_move(MFF_TUN_ID, 0,  MFF_LOG_DATAPATH, 0, 24, ofpacts);
+        put_move(p_ctx->mff_ovn_geneve, 16, MFF_LOG_INPORT, 0, 15,
+                 ofpacts);
+        put_move(p_ctx->mff_ovn_geneve, 0, MFF_LOG_OUTPORT, 0, 16,
+                 ofpacts);
+    } else if (tun->type == STT) {
+        put_move(MFF_TUN_ID, 40, MFF_LOG_INPORT,   0, 15, ofpacts);
+        put_move(MFF_TUN_ID, 24, MFF_LOG_OUTPORT,  0, 16, ofpacts);
+        put_move(MFF_TUN_ID,  0, MFF_LOG_DATAPATH, 0, 24, ofpacts);
+    } else if (tun->type == VXLAN) {
+        /* Add flows for non-VTEP tunnels. Split VNI into two 12-bit
+         * sections and use them for datapath and outport IDs. */
+        put_move(MFF_TUN_ID, 12, MFF_LOG_OUTPORT,  0, 12, ofpacts);
+        put_move(MFF_TUN_ID, 0, MFF_LOG_DATAPATH, 0, 12, ofpacts);
+    } else {
+        OVS_NOT_REACHED();
+    }
+
+    put_resubmit(OFTABLE_LOCAL_OUTPUT, ofpacts);
+
+    ofctrl_add_flow(flow_table, OFTABLE_PHY_TO_LOG, 100, 0, &match,
+                    ofpacts, tun_uuid);
+
+    if (tun->type != VXLAN) {
+        return;
+    }
+
+    /* Add VXLAN specific rules to transform port keys
+     * from 12 bits to 16 bits used elsewhere. */
+    ofpbuf_clear(ofpacts);
+
+    match_init_catchall(&match);
+    match_set_in_port(&match, tun->ofport);
+    ovs_be64 mcast_bits = htonll((OVN_VXLAN_MIN_MULTICAST << 12));
+    match_set_tun_id_masked(&match, mcast_bits, mcast_bits);
+
+    put_load(1, MFF_LOG_OUTPORT, 15, 1, ofpacts);
+    put_move(MFF_TUN_ID, 12, MFF_LOG_OUTPORT,  0, 11, ofpacts);
+    put_move(MFF_TUN_ID, 0, MFF_LOG_DATAPATH, 0, 12, ofpacts);
+    put_resubmit(OFTABLE_LOCAL_OUTPUT, ofpacts);
+
+    ofctrl_add_flow(flow_table, OFTABLE_PHY_TO_LOG, 105, 0,
+                    &match, ofpacts, tun_uuid);
+
+    /* Handle ramp switch encapsulations. */
+    const struct sbrec_port_binding *binding;
+    SBREC_PORT_BINDING_TABLE_FOR_EACH (binding, p_ctx->port_binding_table) {
+        if (strcmp(binding->type, "vtep")) {
+            continue;
+        }
+
+        if (!binding->chassis ||
+            !encaps_tunnel_id_match(tun->chassis_id,
+                                    binding->chassis->name, NULL)) {
+            continue;
+        }
+
+        match_init_catchall(&match);
+        match_set_in_port(&match, tun->ofport);
+        ofpbuf_clear(ofpacts);
+
+        /* Add flows for ramp switches.  The VNI is used to populate
+         * MFF_LOG_DATAPATH.  The gateway's logical port is set to
+         * MFF_LOG_INPORT.  Then the packet is resubmitted to table 8
+         * to determine the logical egress port. */
+        match_set_tun_id(&match, htonll(binding->datapath->tunnel_key));
+
+        put_move(MFF_TUN_ID, 0,  MFF_LOG_DATAPATH, 0, 24, ofpacts);
+        put_load(binding->tunnel_key, MFF_LOG_INPORT, 0, 15, ofpacts);
+        /* For packets received from a ramp tunnel, set a flag to that
+         * effect. */
+        put_load(1, MFF_LOG_FLAGS, MLF_RCV_FROM_RAMP_BIT, 1, ofpacts);
+        put_resubmit(OFTABLE_LOG_INGRESS_PIPELINE, ofpacts);
+
+        ofctrl_add_flow(flow_table, OFTABLE_PHY_TO_LOG, 110,
+                        binding->header_.uuid.parts[0],
+                        &match, ofpacts, tun_uuid);
+    }
+}
+
+/* Returns true if the flows of 'pb' may use the tunnels to one of the
+ * chassis in 'chassis_names'. */
+static bool
+port_binding_uses_tunnels(const struct sbrec_port_binding *pb,
+                          const struct sset *chassis_names)
+{
+    return (pb->ha_chassis_group
+            || (pb->chassis && sset_contains(chassis_names,
+                                             pb->chassis->name)));
+}
+
+/* Handles the changes of the tunnels to the chassis in 'chassis_names', i.e.
+ * tunnels that were added, removed or whose OpenFlow port changed.  Only the
+ * flows that receive from these tunnels, the flows of the port bindings that
+ * are bound to these chassis or to an HA chassis group, and the flows of the
+ * local multicast groups are regenerated.
+ *
+ * Returns false if the changes cannot be handled incrementally. */
+bool
+physical_handle_chassis_tunnel_changes(
+    struct physical_ctx *p_ctx, const struct sset *chassis_names,
+    struct ovn_desired_flow_table *flow_table)
+{
+    struct ofpbuf ofpacts;
+    ofpbuf_init(&ofpacts, 0);
+
+    const char *chassis_name;
+    SSET_FOR_EACH (chassis_name, chassis_names) {
+        const struct uuid *tun_uuid = get_tunnel_flow_uuid(chassis_name);
+        ofctrl_remove_flows(flow_table, tun_uuid);
+
+        bool found = false;
+        struct chassis_tunnel *tun;
+        HMAP_FOR_EACH_WITH_HASH (tun, hmap_node, hash_string(chassis_name, 0),
+                                 p_ctx->chassis_tunnels) {
+            if (encaps_tunnel_id_match(tun->chassis_id, chassis_name, NULL)) {
+                put_chassis_tunnel_flows(p_ctx, tun, tun_uuid, &ofpacts,
+                                         flow_table);
+                found = true;
+            }
+        }
+        if (!found) {
+            free(shash_find_and_delete(&tunnel_flow_uuids, chassis_name));
+        }
+    }
+    ofpbuf_uninit(&ofpacts);
+
+    struct ovsdb_idl_index *pbs_by_dp = p_ctx->sbrec_port_binding_by_datapath;
+    struct sbrec_port_binding *target =
+        sbrec_port_binding_index_init_row(pbs_by_dp);
+    const struct local_datapath *ld;
+    HMAP_FOR_EACH (ld, hmap_node, p_ctx->local_datapaths) {
+        sbrec_port_binding_index_set_datapath(target, ld->datapath);
+
+        const struct sbrec_port_binding *pb;
+        SBREC_PORT_BINDING_FOR_EACH_EQUAL (pb, target, pbs_by_dp) {
+            if (port_binding_uses_tunnels(pb, chassis_names)
+                && !physical_handle_flows_for_lport(pb, false, p_ctx,
+                                                    flow_table)) {
+                sbrec_port_binding_index_destroy_row(target);
+                return false;
+            }
+        }
+    }
+    sbrec_port_binding_index_destroy_row(target);
+
+    /* The remote chassis fanned out by a multicast group are those of its
+     * ports, which may not reference the chassis anymore, so all the local
+     * multicast groups are regenerated. */
+    const struct sbrec_multicast_group *mc;
+    SBREC_MULTICAST_GROUP_TABLE_FOR_EACH (mc, p_ctx->mc_group_table) {
+        if (!get_local_datapath(p_ctx->local_datapaths,
+                                mc->datapath->tunnel_key)) {
+            continue;
+        }
+        consider_mc_group(p_ctx->sbrec_port_binding_by_name,
+                          p_ctx->mff_ovn_geneve, p_ctx->ct_zones,
+                          p_ctx->local_datapaths, p_ctx->local_bindings,
+                          p_ctx->patch_ofports, p_ctx->chassis,
+                          mc, p_ctx->chassis_tunnels,
+                          flow_table);
+    }
+
+    return true;
+}
+
 void
 physical_run(struct physical_ctx *p_ctx,
              struct ovn_desired_flow_table *flow_table)
@@ -1721,6 +2140,7 @@ physical_run(struct physical_ctx *p_ctx,
     }
 
     /* Handle output to multicast groups, in tables 37 and 38. */
+    mc_group_flows_clear();
     const struct sbrec_multicast_group *mc;
     SBREC_MULTICAST_GROUP_TABLE_FOR_EACH (mc, p_ctx->mc_group_table) {
         consider_mc_group(p_ctx->sbrec_port_binding_by_name,
@@ -1731,108 +2151,20 @@ physical_run(struct physical_ctx *p_ctx,
                           flow_table);
     }
 
-    /* Table 0, priority 100.
-     * ======================
+    /* Table 0, priority 100, 105 and 110.
+     * ===================================
      *
      * Process packets that arrive from a remote hypervisor (by matching
      * on tunnel in_port). */
-
-    /* Add flows for Geneve, STT and VXLAN encapsulations.  Geneve and STT
-     * encapsulations have metadata about the ingress and egress logical ports.
-     * VXLAN encapsulations have metadata about the egress logical port only.
-     * We set MFF_LOG_DATAPATH, MFF_LOG_INPORT, and MFF_LOG_OUTPORT from the
-     * tunnel key data where possible, then resubmit to table 38 to handle
-     * packets to the local hypervisor. */
+    shash_clear_free_data(&tunnel_flow_uuids);
     struct chassis_tunnel *tun;
     HMAP_FOR_EACH (tun, hmap_node, p_ctx->chassis_tunnels) {
-        struct match match = MATCH_CATCHALL_INITIALIZER;
-        match_set_in_port(&match, tun->ofport);
-
-        ofpbuf_clear(&ofpacts);
-        if (tun->type == GENEVE) {
-            put_move(MFF_TUN_ID, 0,  MFF_LOG_DATAPATH, 0, 24, &ofpacts);
-            put_move(p_ctx->mff_ovn_geneve, 16, MFF_LOG_INPORT, 0, 15,
-                     &ofpacts);
-            put_move(p_ctx->mff_ovn_geneve, 0, MFF_LOG_OUTPORT, 0, 16,
-                     &ofpacts);
-        } else if (tun->type == STT) {
-            put_move(MFF_TUN_ID, 40, MFF_LOG_INPORT,   0, 15, &ofpacts);
-            put_move(MFF_TUN_ID, 24, MFF_LOG_OUTPORT,  0, 16, &ofpacts);
-            put_move(MFF_TUN_ID,  0, MFF_LOG_DATAPATH, 0, 24, &ofpacts);
-        } else if (tun->type == VXLAN) {
-            /* Add flows for non-VTEP tunnels. Split VNI into two 12-bit
-             * sections and use them for datapath and outport IDs. */
-            put_move(MFF_TUN_ID, 12, MFF_LOG_OUTPORT,  0, 12, &ofpacts);
-            put_move(MFF_TUN_ID, 0, MFF_LOG_DATAPATH, 0, 12, &ofpacts);
-        } else {
-            OVS_NOT_REACHED();
-        }
-
-        put_resubmit(OFTABLE_LOCAL_OUTPUT, &ofpacts);
-
-        ofctrl_add_flow(flow_table, OFTABLE_PHY_TO_LOG, 100, 0, &match,
-                        &ofpacts, hc_uuid);
-    }
-
-    /* Add VXLAN specific rules to transform port keys
-     * from 12 bits to 16 bits used elsewhere. */
-    HMAP_FOR_EACH (tun, hmap_node, p_ctx->chassis_tunnels) {
-        if (tun->type == VXLAN) {
-            ofpbuf_clear(&ofpacts);
-
-            struct match match = MATCH_CATCHALL_INITIALIZER;
-            match_set_in_port(&match, tun->ofport);
-            ovs_be64 mcast_bits = htonll((OVN_VXLAN_MIN_MULTICAST << 12));
-            match_set_tun_id_masked(&match, mcast_bits, mcast_bits);
-
-            put_load(1, MFF_LOG_OUTPORT, 15, 1, &ofpacts);
-            put_move(MFF_TUN_ID, 12, MFF_LOG_OUTPORT,  0, 11, &ofpacts);
-            put_move(MFF_TUN_ID, 0, MFF_LOG_DATAPATH, 0, 12, &ofpacts);
-            put_resubmit(OFTABLE_LOCAL_OUTPUT, &ofpacts);
-
-            ofctrl_add_flow(flow_table, OFTABLE_PHY_TO_LOG, 105, 0,
-                            &match, &ofpacts, hc_uuid);
-        }
-    }
-
-    /* Handle ramp switch encapsulations. */
-    HMAP_FOR_EACH (tun, hmap_node, p_ctx->chassis_tunnels) {
-        if (tun->type != VXLAN) {
-            continue;
-        }
-
-        SBREC_PORT_BINDING_TABLE_FOR_EACH (binding,
-                                           p_ctx->port_binding_table) {
-            if (strcmp(binding->type, "vtep")) {
-                continue;
-            }
-
-            if (!binding->chassis ||
-                !encaps_tunnel_id_match(tun->chassis_id,
-                                        binding->chassis->name, NULL)) {
-                continue;
-            }
-
-            struct match match = MATCH_CATCHALL_INITIALIZER;
-            match_set_in_port(&match, tun->ofport);
-            ofpbuf_clear(&ofpacts);
-
-            /* Add flows for ramp switches.  The VNI is used to populate
-             * MFF_LOG_DATAPATH.  The gateway's logical port is set to
-             * MFF_LOG_INPORT.  Then the packet is resubmitted to table 8
-             * to determine the logical egress port. */
-            match_set_tun_id(&match, htonll(binding->datapath->tunnel_key));
-
-            put_move(MFF_TUN_ID, 0,  MFF_LOG_DATAPATH, 0, 24, &ofpacts);
-            put_load(binding->tunnel_key, MFF_LOG_INPORT, 0, 15, &ofpacts);
-            /* For packets received from a ramp tunnel, set a flag to that
-             * effect. */
-            put_load(1, MFF_LOG_FLAGS, MLF_RCV_FROM_RAMP_BIT, 1, &ofpacts);
-            put_resubmit(OFTABLE_LOG_INGRESS_PIPELINE, &ofpacts);
-
-            ofctrl_add_flow(flow_table, OFTABLE_PHY_TO_LOG, 110,
-                            binding->header_.uuid.parts[0],
-                            &match, &ofpacts, hc_uuid);
+        char *chassis_name;
+        if (encaps_tunnel_id_parse(tun->chassis_id, &chassis_name, NULL)) {
+            put_chassis_tunnel_flows(p_ctx, tun,
+                                     get_tunnel_flow_uuid(chassis_name),
+                                     &ofpacts, flow_table);
+            free(chassis_name);
         }
     }
 
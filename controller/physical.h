@@ -45,6 +45,7 @@ struct local_nonvif_data;
 
 struct physical_ctx {
     struct ovsdb_idl_index *sbrec_port_binding_by_name;
+    struct ovsdb_idl_index *sbrec_port_binding_by_datapath;
     const struct sbrec_port_binding_table *port_binding_table;
     const struct sbrec_multicast_group_table *mc_group_table;
     const struct ovsrec_bridge *br_int;
@@ -69,4 +70,10 @@ bool physical_handle_flows_for_lport(const struct sbrec_port_binding *,
                                      bool removed,
                                      struct physical_ctx *,
                                      struct ovn_desired_flow_table *);
+bool physical_handle_patch_ofport_changes(struct physical_ctx *,
+                                          const struct sset *lport_names,
+                                          struct ovn_desired_flow_table *);
+bool physical_handle_chassis_tunnel_changes(struct physical_ctx *,
+                                            const struct sset *chassis_names,
+                                            struct ovn_desired_flow_table *);
 #endif /* controller/physical.h */
@@ -16,6 +16,8 @@
 
 #include <config.h>
 
+#include <ctype.h>
+
 #include "pinctrl.h"
 
 #include "coverage.h"
@@ -25,6 +27,8 @@
 #include "encaps.h"
 #include "flow.h"
 #include "ha-chassis.h"
+#include "hash.h"
+#include "heap.h"
 #include "local_data.h"
 #include "lport.h"
 #include "mac-learn.h"
@@ -33,6 +37,7 @@
 #include "lib/packets.h"
 #include "lib/sset.h"
 #include "openvswitch/ofp-actions.h"
+#include "openvswitch/ofp-flow.h"
 #include "openvswitch/ofp-msgs.h"
 #include "openvswitch/ofp-packet.h"
 #include "openvswitch/ofp-print.h"
@@ -51,12 +56,16 @@
 #include "lib/mcast-group-index.h"
 #include "lib/ovn-l7.h"
 #include "lib/ovn-util.h"
+#include "lib/ovn-usdt-probes.h"
 #include "ovn/logical-fields.h"
 #include "openvswitch/poll-loop.h"
 #include "openvswitch/rconn.h"
+#include "ovs-atomic.h"
+#include "ovs-rcu.h"
 #include "socket-util.h"
 #include "seq.h"
 #include "timeval.h"
+#include "token-bucket.h"
 #include "vswitch-idl.h"
 #include "lflow.h"
 #include "ip-mcast.h"
@@ -79,11 +88,13 @@ VLOG_DEFINE_THIS_MODULE(pinctrl);
  *
  *   - dns_lookup -     In order to do a DNS lookup, this action needs
  *                      to access the 'DNS' table. pinctrl_run() builds a
- *                      local DNS cache - 'dns_cache'. See sync_dns_cache()
- *                      for more details.
+ *                      local DNS cache - 'dns_cache' - and publishes the
+ *                      answers built from it with RCU - 'dns_answers'.
+ *                      See sync_dns_cache() for more details.
  *                      The function 'pinctrl_handle_dns_lookup()' (which is
  *                      called with in the pinctrl_handler thread) looks into
- *                      the local DNS cache to resolve the DNS requests.
+ *                      the published answers, without taking any lock, to
+ *                      resolve the DNS requests.
  *
  *   - put_arp/put_nd - These actions stores the IPv4/IPv6 and MAC addresses
  *                      in the 'MAC_Binding' table.
@@ -144,7 +155,8 @@ VLOG_DEFINE_THIS_MODULE(pinctrl);
  *                    contents and stores them in mcast_query_list.
  *
  *                    pinctrl_handler thread sends the periodic IGMP queries
- *                    by walking the mcast_query_list.
+ *                    of the mcast_query_list entries that are due, see
+ *                    'mcast_query_timers'.
  *
  * Notification between pinctrl_handler() and pinctrl_run()
  * -------------------------------------------------------
@@ -158,6 +170,19 @@ VLOG_DEFINE_THIS_MODULE(pinctrl);
  *  'pinctrl_main_seq' is used by pinctrl_handler() thread to wake up
  *  the main thread from poll_block() when mac bindings/igmp groups need to
  *  be updated in the Southboubd DB.
+ *
+ * Packet-in worker threads
+ * ------------------------
+ * With pinctrl_set_n_threads() asking for more than one thread,
+ * pinctrl_handler() starts packet-in worker threads and hands them over
+ * the packet-ins whose handling doesn't depend on state that only
+ * pinctrl_handler() may access, e.g. DHCP, DNS, ICMP and ACL logging
+ * (see pin_opcode_is_offloadable()), through the bounded 'pin_queue'.
+ * Those handlers either don't use any shared state, read an RCU-protected
+ * snapshot of it published by pinctrl_run(), such as 'dns_answers', or
+ * lock 'pinctrl_mutex' around it.  The other packet-ins, in particular BFD
+ * and service monitor replies, are still handled directly by
+ * pinctrl_handler(), so they don't wait behind a storm of DHCP requests.
  * */
 
 static struct ovs_mutex pinctrl_mutex = OVS_MUTEX_INITIALIZER;
@@ -171,10 +196,19 @@ struct pinctrl {
     pthread_t pinctrl_thread;
     /* Latch to destroy the 'pinctrl_thread' */
     struct latch pinctrl_thread_exit;
+    /* Number of threads handling packet-ins, including 'pinctrl_thread'.
+     * Protected by pinctrl_mutex. */
+    size_t n_threads;
 };
 
 static struct pinctrl pinctrl;
 
+/* Maximum number of threads handling packet-ins, see
+ * pinctrl_set_n_threads(). */
+#define PINCTRL_MAX_N_THREADS 64
+
+static void init_pin_queue(void);
+static void destroy_pin_queue(void);
 static void init_buffered_packets_map(void);
 static void destroy_buffered_packets_map(void);
 static void
@@ -192,7 +226,8 @@ static void run_put_mac_bindings(
     struct ovsdb_idl_txn *ovnsb_idl_txn,
     struct ovsdb_idl_index *sbrec_datapath_binding_by_key,
     struct ovsdb_idl_index *sbrec_port_binding_by_key,
-    struct ovsdb_idl_index *sbrec_mac_binding_by_lport_ip)
+    struct ovsdb_idl_index *sbrec_mac_binding_by_lport_ip,
+    struct ovsdb_idl_index *sbrec_mac_binding_by_datapath)
     OVS_REQUIRES(pinctrl_mutex);
 static void wait_put_mac_bindings(struct ovsdb_idl_txn *ovnsb_idl_txn);
 static void send_mac_binding_buffered_pkts(struct rconn *swconn)
@@ -328,10 +363,10 @@ static void notify_pinctrl_main(void);
 static void notify_pinctrl_handler(void);
 
 static bool bfd_monitor_should_inject(void);
-static void bfd_monitor_wait(long long int timeout);
+static void bfd_monitor_wait(void);
 static void bfd_monitor_init(void);
 static void bfd_monitor_destroy(void);
-static void bfd_monitor_send_msg(struct rconn *swconn, long long int *bfd_time)
+static void bfd_monitor_send_msg(struct rconn *swconn)
                                  OVS_REQUIRES(pinctrl_mutex);
 static void
 pinctrl_handle_bfd_msg(struct rconn *swconn, const struct flow *ip_flow,
@@ -350,22 +385,112 @@ static const struct sbrec_fdb *fdb_lookup(
     uint32_t dp_key, const char *mac);
 static void run_put_fdb(struct ovsdb_idl_txn *ovnsb_idl_txn,
                         struct ovsdb_idl_index *sbrec_fdb_by_dp_key_mac,
+                        struct ovsdb_idl_index *sbrec_fdb_by_dp_key,
                         const struct fdb_entry *fdb_e)
                         OVS_REQUIRES(pinctrl_mutex);
 static void run_put_fdbs(struct ovsdb_idl_txn *ovnsb_idl_txn,
-                        struct ovsdb_idl_index *sbrec_fdb_by_dp_key_mac)
+                        struct ovsdb_idl_index *sbrec_fdb_by_dp_key_mac,
+                        struct ovsdb_idl_index *sbrec_fdb_by_dp_key)
                         OVS_REQUIRES(pinctrl_mutex);
 static void wait_put_fdbs(struct ovsdb_idl_txn *ovnsb_idl_txn);
 static void pinctrl_handle_put_fdb(const struct flow *md,
                                    const struct flow *headers)
                                    OVS_REQUIRES(pinctrl_mutex);
 
+/* Tunnel keys of the lazy datapaths that packets entered, waiting for the
+ * main thread to activate them in pinctrl_activate_lazy_datapaths(). */
+static uint32_t lazy_dp_misses[64] OVS_GUARDED_BY(pinctrl_mutex);
+static size_t n_lazy_dp_misses OVS_GUARDED_BY(pinctrl_mutex);
+
+static void pinctrl_handle_lazy_datapath(const struct flow *md)
+    OVS_REQUIRES(pinctrl_mutex);
+
+/* Aging and size limit of the MAC_Bindings or FDB entries learnt by
+ * ovn-controller.
+ *
+ * The pinctrl_handler thread periodically dumps the statistics of the
+ * OpenFlow flows that ovn-controller installs in 'table_id' for each
+ * learnt entry, whose cookie is the first 32 bits of the entry's SB uuid.
+ * An entry whose flow did not match any packet for 'idle_timeout' ms is
+ * marked idle, and the main thread deletes idle entries from the SB.
+ *
+ * No more than 'max_per_dp' entries are learnt per datapath, if nonzero. */
+struct learnt_aging_entry {
+    struct hmap_node hmap_node; /* In 'struct learnt_aging' 'entries'. */
+    uint32_t cookie;
+    uint64_t n_packets;         /* Flow packet count when last dumped. */
+    uint64_t dump_packets;      /* Packet count in the current dump. */
+    long long int last_used;    /* Last time 'n_packets' changed, in ms. */
+    unsigned int round;         /* Last dump that included the flow. */
+    bool idle;
+};
+
+struct learnt_aging {
+    const char *name;
+    uint8_t table_id;
+    unsigned int idle_timeout;  /* In ms, 0 disables aging. */
+    unsigned int max_per_dp;    /* 0 means no limit. */
+
+    struct hmap entries;        /* Contains "struct learnt_aging_entry"s. */
+    unsigned int round;         /* Number of the current dump. */
+    long long int next_dump;    /* Time of the next dump request, in ms. */
+    ovs_be32 xid;               /* Pending dump request, 0 if none. */
+    bool check_idle;            /* Main thread has idle 'entries' to age. */
+};
+
+static struct learnt_aging mac_binding_aging
+    OVS_GUARDED_BY(pinctrl_mutex) = {
+    .name = "MAC_Binding",
+    .table_id = OFTABLE_MAC_BINDING,
+};
+static struct learnt_aging fdb_aging
+    OVS_GUARDED_BY(pinctrl_mutex) = {
+    .name = "FDB",
+    .table_id = OFTABLE_LOOKUP_FDB,
+};
+
+static void init_learnt_aging(void);
+static void destroy_learnt_aging(void);
+static void learnt_aging_run(struct rconn *swconn,
+                             long long int *aging_next_run_time)
+    OVS_REQUIRES(pinctrl_mutex);
+static void learnt_aging_wait(long long int aging_next_run_time);
+static void learnt_aging_handle_stats_reply(const struct ofp_header *oh);
+static void run_learnt_aging(
+    struct ovsdb_idl_txn *ovnsb_idl_txn,
+    struct ovsdb_idl_index *sbrec_datapath_binding_by_key,
+    struct ovsdb_idl_index *sbrec_port_binding_by_key,
+    struct ovsdb_idl_index *sbrec_port_binding_by_name,
+    const struct sbrec_mac_binding_table *mac_binding_table,
+    const struct sbrec_fdb_table *fdb_table,
+    const struct sbrec_chassis *chassis,
+    const struct sset *active_tunnels)
+    OVS_REQUIRES(pinctrl_mutex);
+
 COVERAGE_DEFINE(pinctrl_drop_put_mac_binding);
+COVERAGE_DEFINE(pinctrl_dedup_put_mac_binding);
+COVERAGE_DEFINE(pinctrl_defer_put_mac_binding);
+COVERAGE_DEFINE(pinctrl_limit_put_mac_binding);
+COVERAGE_DEFINE(pinctrl_limit_put_fdb);
+COVERAGE_DEFINE(pinctrl_age_mac_binding);
+COVERAGE_DEFINE(pinctrl_age_fdb);
 COVERAGE_DEFINE(pinctrl_drop_buffered_packets_map);
+COVERAGE_DEFINE(pinctrl_drop_buffered_packets_mem);
+COVERAGE_DEFINE(pinctrl_buffered_packets_expired);
+COVERAGE_DEFINE(pinctrl_buffered_resolved_lt_10ms);
+COVERAGE_DEFINE(pinctrl_buffered_resolved_lt_100ms);
+COVERAGE_DEFINE(pinctrl_buffered_resolved_lt_1s);
+COVERAGE_DEFINE(pinctrl_buffered_resolved_ge_1s);
 COVERAGE_DEFINE(pinctrl_drop_controller_event);
 COVERAGE_DEFINE(pinctrl_drop_put_vport_binding);
 COVERAGE_DEFINE(pinctrl_notify_main_thread);
 COVERAGE_DEFINE(pinctrl_total_pin_pkts);
+COVERAGE_DEFINE(pinctrl_queued_pin_pkts);
+COVERAGE_DEFINE(pinctrl_drop_pin_queue_full);
+COVERAGE_DEFINE(pinctrl_tx_backlogged);
+COVERAGE_DEFINE(pinctrl_svc_monitor_probes);
+COVERAGE_DEFINE(pinctrl_svc_monitor_timeouts);
+COVERAGE_DEFINE(pinctrl_svc_monitor_state_changes);
 
 struct empty_lb_backends_event {
     struct hmap_node hmap_node;
@@ -528,7 +653,11 @@ pinctrl_init(void)
     init_svc_monitors();
     bfd_monitor_init();
     init_fdb_entries();
+    init_learnt_aging();
     pinctrl.br_int_name = NULL;
+    pinctrl.n_threads = 1;
+    init_pin_queue();
+    pinctrl_tx_counter = rconn_packet_counter_create();
     pinctrl_handler_seq = seq_create();
     pinctrl_main_seq = seq_create();
 
@@ -537,13 +666,55 @@ pinctrl_init(void)
                                                 &pinctrl);
 }
 
+/* Counts the messages sent to the switch that are still waiting in the
+ * rconn's transmit queue. */
+static struct rconn_packet_counter *pinctrl_tx_counter;
+
+/* Maximum number of messages waiting in the switch connection's transmit
+ * queue for pinctrl_handler() to read more packet-ins.  Above that, the
+ * switch is not keeping up with our packet-outs and reading more packet-ins
+ * would only grow the queue. */
+#define PINCTRL_TX_BACKLOG_MAX 1000
+
+/* The messages queued by queue_msg() in the current thread since
+ * tx_batch_start(), or NULL to send them right away. */
+DEFINE_STATIC_PER_THREAD_DATA(struct ovs_list *, tx_batch, NULL);
+
+/* Starts collecting the messages that the current thread queues with
+ * queue_msg() into 'batch', until tx_batch_flush() hands them over to the
+ * switch connection all at once, once the current batch of packet-ins and
+ * periodic messages has been processed. */
+static void
+tx_batch_start(struct ovs_list *batch)
+{
+    ovs_list_init(batch);
+    *tx_batch_get() = batch;
+}
+
+static void
+tx_batch_flush(struct rconn *swconn)
+{
+    struct ovs_list **batchp = tx_batch_get();
+    struct ofpbuf *msg;
+
+    LIST_FOR_EACH_POP (msg, list_node, *batchp) {
+        rconn_send(swconn, msg, pinctrl_tx_counter);
+    }
+    *batchp = NULL;
+}
+
 static ovs_be32
 queue_msg(struct rconn *swconn, struct ofpbuf *msg)
 {
     const struct ofp_header *oh = msg->data;
     ovs_be32 xid = oh->xid;
 
-    rconn_send(swconn, msg, NULL);
+    struct ovs_list *batch = *tx_batch_get();
+    if (batch) {
+        ovs_list_push_back(batch, &msg->list_node);
+    } else {
+        rconn_send(swconn, msg, pinctrl_tx_counter);
+    }
     return xid;
 }
 
@@ -1373,37 +1544,64 @@ struct buffer_info {
 struct buffered_packets {
     struct hmap_node hmap_node;
     struct ovs_list list;
+    struct ovs_list lru_node;   /* In 'buffered_packets_lru'. */
 
     /* key */
     struct in6_addr ip;
     struct eth_addr ea;
 
-    long long int timestamp;
+    long long int created;      /* When the first packet was buffered. */
+    long long int timestamp;    /* When the last packet was buffered. */
 
     struct buffer_info data[BUFFER_QUEUE_DEPTH];
     uint32_t head, tail;
 };
 
+/* Packets are buffered for at most BUFFER_MAP_TIMEOUT ms after the last
+ * packet for the same destination, and all the buffered packets together
+ * use at most BUFFERED_PACKETS_MAX_BYTES. */
+#define BUFFER_MAP_TIMEOUT   10000
+#define BUFFERED_PACKETS_MAX_BYTES (8 * 1024 * 1024)
+
 static struct hmap buffered_packets_map;
 static struct ovs_list buffered_mac_bindings;
 
+/* The 'buffered_packets_map' entries, least recently updated first, which
+ * is also their expiration order. */
+static struct ovs_list buffered_packets_lru;
+
+/* Memory used by all the buffered packets, including the ones in
+ * 'buffered_mac_bindings'. */
+static size_t buffered_packets_bytes;
+
 static void
 init_buffered_packets_map(void)
 {
     hmap_init(&buffered_packets_map);
     ovs_list_init(&buffered_mac_bindings);
+    ovs_list_init(&buffered_packets_lru);
+    buffered_packets_bytes = 0;
+}
+
+static size_t
+buffer_info_size(const struct buffer_info *bi)
+{
+    return dp_packet_get_allocated(bi->p) + bi->ofpacts.allocated;
 }
 
 static void
-destroy_buffered_packets(struct buffered_packets *bp)
+buffer_info_destroy(struct buffer_info *bi)
 {
-    struct buffer_info *bi;
+    buffered_packets_bytes -= buffer_info_size(bi);
+    dp_packet_delete(bi->p);
+    ofpbuf_uninit(&bi->ofpacts);
+}
 
+static void
+destroy_buffered_packets(struct buffered_packets *bp)
+{
     while (bp->head != bp->tail) {
-        bi = &bp->data[bp->head];
-        dp_packet_delete(bi->p);
-        ofpbuf_uninit(&bi->ofpacts);
-
+        buffer_info_destroy(&bp->data[bp->head]);
         bp->head = (bp->head + 1) % BUFFER_QUEUE_DEPTH;
     }
 }
@@ -1433,7 +1631,7 @@ buffered_push_packet(struct buffered_packets *bp,
     uint32_t next = (bp->tail + 1) % BUFFER_QUEUE_DEPTH;
     struct buffer_info *bi = &bp->data[bp->tail];
 
-    ofpbuf_init(&bi->ofpacts, 4096);
+    ofpbuf_init(&bi->ofpacts, 0);
 
     reload_metadata(&bi->ofpacts, md);
     /* reload pkt_mark field */
@@ -1447,12 +1645,14 @@ buffered_push_packet(struct buffered_packets *bp,
     resubmit->in_port = OFPP_CONTROLLER;
     resubmit->table_id = OFTABLE_REMOTE_OUTPUT;
 
+    /* Don't keep the slack of the growing ofpacts around for as long as the
+     * packet stays buffered. */
+    ofpbuf_trim(&bi->ofpacts);
     bi->p = packet;
+    buffered_packets_bytes += buffer_info_size(bi);
 
     if (next == bp->head) {
-        bi = &bp->data[bp->head];
-        dp_packet_delete(bi->p);
-        ofpbuf_uninit(&bi->ofpacts);
+        buffer_info_destroy(&bp->data[bp->head]);
         bp->head = (bp->head + 1) % BUFFER_QUEUE_DEPTH;
     }
     bp->tail = next;
@@ -1480,27 +1680,51 @@ buffered_send_packets(struct rconn *swconn, struct buffered_packets *bp,
         match_set_in_port(&po.flow_metadata, bi->ofp_port);
         queue_msg(swconn, ofputil_encode_packet_out(&po, proto));
 
-        ofpbuf_uninit(&bi->ofpacts);
-        dp_packet_delete(bi->p);
+        buffer_info_destroy(bi);
 
         bp->head = (bp->head + 1) % BUFFER_QUEUE_DEPTH;
     }
 }
 
-#define BUFFER_MAP_TIMEOUT   10000
 static void
 buffered_packets_map_gc(void)
 {
     struct buffered_packets *cur_qp;
     long long int now = time_msec();
 
-    HMAP_FOR_EACH_SAFE (cur_qp, hmap_node, &buffered_packets_map) {
-        if (now > cur_qp->timestamp + BUFFER_MAP_TIMEOUT) {
-            destroy_buffered_packets(cur_qp);
-            hmap_remove(&buffered_packets_map, &cur_qp->hmap_node);
-            free(cur_qp);
+    /* Only the expired entries, at the front, have to be looked at. */
+    LIST_FOR_EACH_SAFE (cur_qp, lru_node, &buffered_packets_lru) {
+        if (now <= cur_qp->timestamp + BUFFER_MAP_TIMEOUT) {
+            break;
         }
+        COVERAGE_INC(pinctrl_buffered_packets_expired);
+        destroy_buffered_packets(cur_qp);
+        ovs_list_remove(&cur_qp->lru_node);
+        hmap_remove(&buffered_packets_map, &cur_qp->hmap_node);
+        free(cur_qp);
+    }
+}
+
+/* Moves 'bp', whose destination got resolved, from 'buffered_packets_map'
+ * to 'buffered_mac_bindings' and accounts for its resolution time. */
+static void
+buffered_packets_resolved(struct buffered_packets *bp, long long int now)
+{
+    long long int delay = now - bp->created;
+
+    if (delay < 10) {
+        COVERAGE_INC(pinctrl_buffered_resolved_lt_10ms);
+    } else if (delay < 100) {
+        COVERAGE_INC(pinctrl_buffered_resolved_lt_100ms);
+    } else if (delay < 1000) {
+        COVERAGE_INC(pinctrl_buffered_resolved_lt_1s);
+    } else {
+        COVERAGE_INC(pinctrl_buffered_resolved_ge_1s);
     }
+
+    ovs_list_remove(&bp->lru_node);
+    hmap_remove(&buffered_packets_map, &bp->hmap_node);
+    ovs_list_push_back(&buffered_mac_bindings, &bp->list);
 }
 
 static struct buffered_packets *
@@ -1534,6 +1758,13 @@ pinctrl_handle_buffered_packets(struct dp_packet *pkt_in,
         memcpy(&addr, &ip6, sizeof addr);
     }
 
+    if (buffered_packets_bytes + dp_packet_size(pkt_in)
+        > BUFFERED_PACKETS_MAX_BYTES) {
+        COVERAGE_INC(pinctrl_drop_buffered_packets_mem);
+        return -ENOMEM;
+    }
+
+    long long int now = time_msec();
     uint32_t hash = hash_bytes(&addr, sizeof addr, 0);
     bp = pinctrl_find_buffered_packets(&addr, hash);
     if (!bp) {
@@ -1546,8 +1777,12 @@ pinctrl_handle_buffered_packets(struct dp_packet *pkt_in,
         hmap_insert(&buffered_packets_map, &bp->hmap_node, hash);
         bp->head = bp->tail = 0;
         bp->ip = addr;
+        bp->created = now;
+    } else {
+        ovs_list_remove(&bp->lru_node);
     }
-    bp->timestamp = time_msec();
+    bp->timestamp = now;
+    ovs_list_push_back(&buffered_packets_lru, &bp->lru_node);
     /* clone the packet to send it later with correct L2 address */
     clone = dp_packet_clone_data(dp_packet_data(pkt_in),
                                  dp_packet_size(pkt_in));
@@ -2679,78 +2914,71 @@ struct dns_data {
     bool delete;
 };
 
-static struct shash dns_cache = SHASH_INITIALIZER(&dns_cache);
-
-/* Called by pinctrl_run(). Runs within the main ovn-controller
- * thread context. */
-static void
-sync_dns_cache(const struct sbrec_dns_table *dns_table)
-    OVS_REQUIRES(pinctrl_mutex)
-{
-    struct shash_node *iter;
-    SHASH_FOR_EACH (iter, &dns_cache) {
-        struct dns_data *d = iter->data;
-        d->delete = true;
-    }
+/* The answers for DNS queries of name 'name' on datapath 'dp_key', built
+ * from the records in 'dns_cache'.  The answer records are pre-encoded in
+ * wire format, except for their NAME, which pinctrl_handle_dns_lookup()
+ * copies from the query. */
+struct dns_answer {
+    struct hmap_node hmap_node; /* In 'struct dns_answers'. */
+    uint64_t dp_key;
+    char *name;                 /* Lowercase. */
+
+    /* Each of these contains the TYPE, CLASS, TTL, RDLENGTH and RDATA fields
+     * of the answer records of the given type, one after the other. */
+    struct ofpbuf a_rrs;        /* 'n_a' TYPE A records. */
+    struct ofpbuf aaaa_rrs;     /* 'n_aaaa' TYPE AAAA records. */
+    struct ofpbuf ptr_rr;       /* One TYPE PTR record. */
+    uint16_t n_a;
+    uint16_t n_aaaa;
+};
 
-    const struct sbrec_dns *sbrec_dns;
-    SBREC_DNS_TABLE_FOR_EACH (sbrec_dns, dns_table) {
-        const char *dns_id = smap_get(&sbrec_dns->external_ids, "dns_id");
-        if (!dns_id) {
-            continue;
-        }
+/* A snapshot of the answers for all the DNS records in 'dns_cache'.  It is
+ * never modified once published in 'dns_answers'. */
+struct dns_answers {
+    struct hmap answers;        /* Contains "struct dns_answer"s, indexed by
+                                 * dns_answer_hash(). */
+};
 
-        struct dns_data *dns_data = shash_find_data(&dns_cache, dns_id);
-        if (!dns_data) {
-            dns_data = xmalloc(sizeof *dns_data);
-            smap_init(&dns_data->records);
-            shash_add(&dns_cache, dns_id, dns_data);
-            dns_data->n_dps = 0;
-            dns_data->dps = NULL;
-        } else {
-            free(dns_data->dps);
-        }
+/* Only accessed by the main ovn-controller thread, see sync_dns_cache(). */
+static struct shash dns_cache = SHASH_INITIALIZER(&dns_cache);
 
-        dns_data->delete = false;
+/* The answers built from the current content of 'dns_cache'.
+ *
+ * sync_dns_cache() publishes a new snapshot whenever 'dns_cache' changes and
+ * frees the previous one after an RCU grace period, so that the
+ * pinctrl_handler() thread and the packet-in worker threads look up the
+ * answers without taking any lock, even while the main thread processes a
+ * big update of the DNS table.  NULL if there are no DNS records. */
+static OVSRCU_TYPE(struct dns_answers *) dns_answers;
 
-        if (!smap_equal(&dns_data->records, &sbrec_dns->records)) {
-            smap_destroy(&dns_data->records);
-            smap_clone(&dns_data->records, &sbrec_dns->records);
-        }
+static uint32_t
+dns_answer_hash(uint64_t dp_key, const char *name)
+{
+    return hash_string(name, hash_uint64(dp_key));
+}
 
-        dns_data->n_dps = sbrec_dns->n_datapaths;
-        dns_data->dps = xcalloc(dns_data->n_dps, sizeof(uint64_t));
-        for (size_t i = 0; i < sbrec_dns->n_datapaths; i++) {
-            dns_data->dps[i] = sbrec_dns->datapaths[i]->tunnel_key;
-        }
+static const struct dns_answer *
+dns_answer_find(const struct dns_answers *answers, uint64_t dp_key,
+                const char *name)
+{
+    if (!answers) {
+        return NULL;
     }
 
-    SHASH_FOR_EACH_SAFE (iter, &dns_cache) {
-        struct dns_data *d = iter->data;
-        if (d->delete) {
-            shash_delete(&dns_cache, iter);
-            smap_destroy(&d->records);
-            free(d->dps);
-            free(d);
+    const struct dns_answer *answer;
+    HMAP_FOR_EACH_WITH_HASH (answer, hmap_node,
+                             dns_answer_hash(dp_key, name),
+                             &answers->answers) {
+        if (answer->dp_key == dp_key && !strcmp(answer->name, name)) {
+            return answer;
         }
     }
+    return NULL;
 }
 
-static void
-destroy_dns_cache(void)
-{
-    struct shash_node *iter;
-    SHASH_FOR_EACH_SAFE (iter, &dns_cache) {
-        struct dns_data *d = iter->data;
-        shash_delete(&dns_cache, iter);
-        smap_destroy(&d->records);
-        free(d->dps);
-        free(d);
-    }
-}
-
-/* Populates dns_answer struct with base data.
- * Copy the answer section
+/* Appends to 'rrs' the fields that follow the NAME in an answer record of
+ * type 'type' with data 'rdata'.
+ *
  * Format of the answer section is
  *  - NAME     -> The domain name
  *  - TYPE     -> 2 octets containing one of the RR type codes
@@ -2765,52 +2993,22 @@ destroy_dns_cache(void)
  *                describes the resource.
  */
 static void
-dns_build_base_answer(
-    struct ofpbuf *dns_answer, const uint8_t *in_queryname,
-    uint16_t query_length, int query_type)
-{
-    ofpbuf_put(dns_answer, in_queryname, query_length);
-    put_be16(dns_answer, htons(query_type));
-    put_be16(dns_answer, htons(DNS_CLASS_IN));
-    put_be32(dns_answer, htonl(DNS_DEFAULT_RR_TTL));
-}
-
-/* Populates dns_answer struct with a TYPE A answer. */
-static void
-dns_build_a_answer(
-    struct ofpbuf *dns_answer, const uint8_t *in_queryname,
-    uint16_t query_length, const ovs_be32 addr)
-{
-    dns_build_base_answer(dns_answer, in_queryname, query_length,
-                          DNS_QUERY_TYPE_A);
-    put_be16(dns_answer, htons(sizeof(ovs_be32)));
-    put_be32(dns_answer, addr);
-}
-
-/* Populates dns_answer struct with a TYPE AAAA answer. */
-static void
-dns_build_aaaa_answer(
-    struct ofpbuf *dns_answer, const uint8_t *in_queryname,
-    uint16_t query_length, const struct in6_addr *addr)
+dns_put_rr(struct ofpbuf *rrs, int type, const void *rdata, uint16_t rdlength)
 {
-    dns_build_base_answer(dns_answer, in_queryname, query_length,
-                          DNS_QUERY_TYPE_AAAA);
-    put_be16(dns_answer, htons(sizeof(*addr)));
-    ofpbuf_put(dns_answer, addr, sizeof(*addr));
+    put_be16(rrs, htons(type));
+    put_be16(rrs, htons(DNS_CLASS_IN));
+    put_be32(rrs, htonl(DNS_DEFAULT_RR_TTL));
+    put_be16(rrs, htons(rdlength));
+    ofpbuf_put(rrs, rdata, rdlength);
 }
 
-/* Populates dns_answer struct with a TYPE PTR answer. */
+/* Appends to 'rrs' a TYPE PTR answer record for 'answer_data'. */
 static void
-dns_build_ptr_answer(
-    struct ofpbuf *dns_answer, const uint8_t *in_queryname,
-    uint16_t query_length, const char *answer_data)
+dns_put_ptr_rr(struct ofpbuf *rrs, const char *answer_data)
 {
     char *encoded_answer;
     uint16_t encoded_answer_length;
 
-    dns_build_base_answer(dns_answer, in_queryname, query_length,
-                          DNS_QUERY_TYPE_PTR);
-
     /* Initialize string 2 chars longer than real answer:
      * first label length and terminating zero-length label.
      * If the answer_data is - vm1tst.ovn.org, it will be encoded as
@@ -2822,7 +3020,6 @@ dns_build_ptr_answer(
     encoded_answer_length = strlen(answer_data) + 2;
     encoded_answer = (char *)xzalloc(encoded_answer_length);
 
-    put_be16(dns_answer, htons(encoded_answer_length));
     uint8_t label_len_index = 0;
     uint16_t label_len = 0;
     char *encoded_answer_ptr = (char *)encoded_answer + 1;
@@ -2845,174 +3042,364 @@ dns_build_ptr_answer(
         encoded_answer[label_len_index] = label_len;
     }
 
-    ofpbuf_put(dns_answer, encoded_answer, encoded_answer_length);
+    dns_put_rr(rrs, DNS_QUERY_TYPE_PTR, encoded_answer,
+               encoded_answer_length);
     free(encoded_answer);
 }
 
-/* Called with in the pinctrl_handler thread context. */
+/* Adds to 'answers' the answers for 'name' on datapath 'dp_key', from DNS
+ * record value 'answer_data', unless some other DNS record already provided
+ * them. */
 static void
-pinctrl_handle_dns_lookup(
-    struct rconn *swconn,
-    struct dp_packet *pkt_in, struct ofputil_packet_in *pin,
-    struct ofpbuf *userdata, struct ofpbuf *continuation)
-    OVS_REQUIRES(pinctrl_mutex)
+dns_answer_add(struct dns_answers *answers, uint64_t dp_key,
+               const char *name, const char *answer_data)
 {
-    static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
-    enum ofp_version version = rconn_get_version(swconn);
-    enum ofputil_protocol proto = ofputil_protocol_from_ofp_version(version);
-    struct dp_packet *pkt_out_ptr = NULL;
-    uint32_t success = 0;
-
-    /* Parse result field. */
-    const struct mf_field *f;
-    enum ofperr ofperr = nx_pull_header(userdata, NULL, &f, NULL);
-    if (ofperr) {
-       VLOG_WARN_RL(&rl, "bad result OXM (%s)", ofperr_to_string(ofperr));
-       goto exit;
+    /* DNS records in SBDB are stored in lowercase, but make sure. */
+    char *name_lower = str_tolower(name);
+    if (dns_answer_find(answers, dp_key, name_lower)) {
+        free(name_lower);
+        return;
     }
 
-    /* Parse result offset. */
-    ovs_be32 *ofsp = ofpbuf_try_pull(userdata, sizeof *ofsp);
-    if (!ofsp) {
-        VLOG_WARN_RL(&rl, "offset not present in the userdata");
-        goto exit;
+    struct dns_answer *answer = xmalloc(sizeof *answer);
+    answer->dp_key = dp_key;
+    answer->name = name_lower;
+    ofpbuf_init(&answer->a_rrs, 0);
+    ofpbuf_init(&answer->aaaa_rrs, 0);
+    ofpbuf_init(&answer->ptr_rr, 0);
+    answer->n_a = 0;
+    answer->n_aaaa = 0;
+
+    /* A record is either for PTR queries, in which case 'answer_data' is a
+     * name, or for A, AAAA and ANY queries, in which case it is a list of
+     * IP addresses.  We don't know which one until we get a query, so
+     * prepare both. */
+    dns_put_ptr_rr(&answer->ptr_rr, answer_data);
+
+    struct lport_addresses ip_addrs;
+    if (extract_ip_addresses(answer_data, &ip_addrs)) {
+        for (size_t i = 0; i < ip_addrs.n_ipv4_addrs; i++) {
+            ovs_be32 addr = ip_addrs.ipv4_addrs[i].addr;
+            dns_put_rr(&answer->a_rrs, DNS_QUERY_TYPE_A, &addr, sizeof addr);
+            answer->n_a++;
+        }
+        for (size_t i = 0; i < ip_addrs.n_ipv6_addrs; i++) {
+            const struct in6_addr *addr = &ip_addrs.ipv6_addrs[i].addr;
+            dns_put_rr(&answer->aaaa_rrs, DNS_QUERY_TYPE_AAAA, addr,
+                       sizeof *addr);
+            answer->n_aaaa++;
+        }
+        destroy_lport_addresses(&ip_addrs);
     }
 
-    /* Check that the result is valid and writable. */
-    struct mf_subfield dst = { .field = f, .ofs = ntohl(*ofsp), .n_bits = 1 };
-    ofperr = mf_check_dst(&dst, NULL);
-    if (ofperr) {
-        VLOG_WARN_RL(&rl, "bad result bit (%s)", ofperr_to_string(ofperr));
-        goto exit;
-    }
+    hmap_insert(&answers->answers, &answer->hmap_node,
+                dns_answer_hash(dp_key, name_lower));
+}
 
-    /* Check that the packet stores at least the minimal headers. */
-    if (dp_packet_l4_size(pkt_in) < (UDP_HEADER_LEN + DNS_HEADER_LEN)) {
-        VLOG_WARN_RL(&rl, "truncated dns packet");
-        goto exit;
+static void
+dns_answers_destroy(struct dns_answers *answers)
+{
+    if (!answers) {
+        return;
     }
 
-    /* Extract the DNS header */
-    struct dns_header const *in_dns_header = dp_packet_get_udp_payload(pkt_in);
-    if (!in_dns_header) {
-        VLOG_WARN_RL(&rl, "truncated dns packet");
-        goto exit;
+    struct dns_answer *answer;
+    HMAP_FOR_EACH_POP (answer, hmap_node, &answers->answers) {
+        free(answer->name);
+        ofpbuf_uninit(&answer->a_rrs);
+        ofpbuf_uninit(&answer->aaaa_rrs);
+        ofpbuf_uninit(&answer->ptr_rr);
+        free(answer);
     }
+    hmap_destroy(&answers->answers);
+    free(answers);
+}
 
-    /* Check if it is DNS request or not */
-    if (in_dns_header->lo_flag & 0x80) {
-        /* It's a DNS response packet which we are not interested in */
-        goto exit;
+/* Replaces the published 'dns_answers' by 'answers', freeing the previous
+ * snapshot once no thread can be using it anymore. */
+static void
+dns_answers_publish(struct dns_answers *answers)
+{
+    struct dns_answers *old = ovsrcu_get_protected(struct dns_answers *,
+                                                   &dns_answers);
+    ovsrcu_set(&dns_answers, answers);
+    if (old) {
+        ovsrcu_postpone(dns_answers_destroy, old);
     }
+}
 
-    /* Check if at least one query request is present */
-    if (!in_dns_header->qdcount) {
-        goto exit;
+/* Builds a new snapshot of the answers from 'dns_cache' and publishes it in
+ * 'dns_answers'.  The DNS rows are visited in name order, so that the answer
+ * picked for a name defined by several of them doesn't depend on the hash
+ * order. */
+static void
+dns_answers_rebuild(void)
+{
+    if (shash_is_empty(&dns_cache)) {
+        dns_answers_publish(NULL);
+        return;
     }
 
-    struct udp_header *in_udp = dp_packet_l4(pkt_in);
-    size_t udp_len = ntohs(in_udp->udp_len);
-    size_t l4_len = dp_packet_l4_size(pkt_in);
-    uint8_t *end = (uint8_t *)in_udp + MIN(udp_len, l4_len);
-    uint8_t *in_dns_data = (uint8_t *)(in_dns_header + 1);
-    uint8_t *in_queryname = in_dns_data;
-    uint16_t idx = 0;
-    struct ds query_name;
-    ds_init(&query_name);
-    /* Extract the query_name. If the query name is - 'www.ovn.org' it would be
-     * encoded as (in hex) - 03 77 77 77 03 6f 76 63 03 6f 72 67 00.
-     */
-    while ((in_dns_data + idx) < end && in_dns_data[idx]) {
-        uint8_t label_len = in_dns_data[idx++];
-        if (in_dns_data + idx + label_len > end) {
-            ds_destroy(&query_name);
-            goto exit;
-        }
-        ds_put_buffer(&query_name, (const char *) in_dns_data + idx, label_len);
-        idx += label_len;
-        ds_put_char(&query_name, '.');
-    }
+    struct dns_answers *answers = xmalloc(sizeof *answers);
+    hmap_init(&answers->answers);
 
-    idx++;
-    ds_chomp(&query_name, '.');
-    in_dns_data += idx;
+    const struct shash_node **nodes = shash_sort(&dns_cache);
+    for (size_t i = 0; i < shash_count(&dns_cache); i++) {
+        const struct dns_data *d = nodes[i]->data;
+        const struct smap_node *record;
 
-    /* Query should have TYPE and CLASS fields */
-    if (in_dns_data + (2 * sizeof(ovs_be16)) > end) {
-        ds_destroy(&query_name);
-        goto exit;
+        SMAP_FOR_EACH (record, &d->records) {
+            for (size_t j = 0; j < d->n_dps; j++) {
+                dns_answer_add(answers, d->dps[j], record->key,
+                               record->value);
+            }
+        }
     }
+    free(nodes);
 
-    uint16_t query_type = ntohs(get_unaligned_be16((void *) in_dns_data));
-    /* Supported query types - A, AAAA, ANY and PTR */
-    if (!(query_type == DNS_QUERY_TYPE_A || query_type == DNS_QUERY_TYPE_AAAA
-          || query_type == DNS_QUERY_TYPE_ANY
-          || query_type == DNS_QUERY_TYPE_PTR)) {
-        ds_destroy(&query_name);
-        goto exit;
-    }
+    dns_answers_publish(answers);
+}
+
+/* Called by pinctrl_run(). Runs within the main ovn-controller
+ * thread context. */
+static void
+sync_dns_cache(const struct sbrec_dns_table *dns_table)
+{
+    bool changed = false;
 
-    uint64_t dp_key = ntohll(pin->flow_metadata.flow.metadata);
-    const char *answer_data = NULL;
     struct shash_node *iter;
     SHASH_FOR_EACH (iter, &dns_cache) {
         struct dns_data *d = iter->data;
-        for (size_t i = 0; i < d->n_dps; i++) {
-            if (d->dps[i] == dp_key) {
-                /* DNS records in SBDB are stored in lowercase. Convert to
-                 * lowercase to perform case insensitive lookup
-                 */
-                char *query_name_lower = str_tolower(ds_cstr(&query_name));
-                answer_data = smap_get(&d->records, query_name_lower);
-                free(query_name_lower);
-                if (answer_data) {
-                    break;
-                }
-            }
+        d->delete = true;
+    }
+
+    const struct sbrec_dns *sbrec_dns;
+    SBREC_DNS_TABLE_FOR_EACH (sbrec_dns, dns_table) {
+        const char *dns_id = smap_get(&sbrec_dns->external_ids, "dns_id");
+        if (!dns_id) {
+            continue;
         }
 
-        if (answer_data) {
-            break;
+        struct dns_data *dns_data = shash_find_data(&dns_cache, dns_id);
+        if (!dns_data) {
+            dns_data = xmalloc(sizeof *dns_data);
+            smap_init(&dns_data->records);
+            shash_add(&dns_cache, dns_id, dns_data);
+            dns_data->n_dps = 0;
+            dns_data->dps = NULL;
+            changed = true;
+        }
+
+        dns_data->delete = false;
+
+        if (!smap_equal(&dns_data->records, &sbrec_dns->records)) {
+            smap_destroy(&dns_data->records);
+            smap_clone(&dns_data->records, &sbrec_dns->records);
+            changed = true;
+        }
+
+        uint64_t *dps = xcalloc(sbrec_dns->n_datapaths, sizeof *dps);
+        for (size_t i = 0; i < sbrec_dns->n_datapaths; i++) {
+            dps[i] = sbrec_dns->datapaths[i]->tunnel_key;
+        }
+        if (dns_data->n_dps != sbrec_dns->n_datapaths
+            || (dns_data->n_dps
+                && memcmp(dns_data->dps, dps,
+                          dns_data->n_dps * sizeof *dps))) {
+            changed = true;
+        }
+        free(dns_data->dps);
+        dns_data->dps = dps;
+        dns_data->n_dps = sbrec_dns->n_datapaths;
+    }
+
+    SHASH_FOR_EACH_SAFE (iter, &dns_cache) {
+        struct dns_data *d = iter->data;
+        if (d->delete) {
+            shash_delete(&dns_cache, iter);
+            smap_destroy(&d->records);
+            free(d->dps);
+            free(d);
+            changed = true;
         }
     }
 
-    ds_destroy(&query_name);
-    if (!answer_data) {
+    if (changed) {
+        dns_answers_rebuild();
+    }
+}
+
+static void
+destroy_dns_cache(void)
+{
+    struct shash_node *iter;
+
+    SHASH_FOR_EACH_SAFE (iter, &dns_cache) {
+        struct dns_data *d = iter->data;
+        shash_delete(&dns_cache, iter);
+        smap_destroy(&d->records);
+        free(d->dps);
+        free(d);
+    }
+    dns_answers_publish(NULL);
+}
+
+/* Appends to 'dns_answer' the 'n' pre-encoded answer records in 'rrs', each
+ * preceded by the query name 'in_queryname' of length 'query_length'. */
+static void
+dns_put_answers(struct ofpbuf *dns_answer, const uint8_t *in_queryname,
+                uint16_t query_length, const struct ofpbuf *rrs, size_t n)
+{
+    size_t rr_len = rrs->size / n;
+    const uint8_t *rr = rrs->data;
+
+    for (size_t i = 0; i < n; i++) {
+        ofpbuf_put(dns_answer, in_queryname, query_length);
+        ofpbuf_put(dns_answer, rr, rr_len);
+        rr += rr_len;
+    }
+}
+
+/* Called with in the pinctrl_handler thread or a packet-in worker thread
+ * context. */
+static void
+pinctrl_handle_dns_lookup(
+    struct rconn *swconn,
+    struct dp_packet *pkt_in, struct ofputil_packet_in *pin,
+    struct ofpbuf *userdata, struct ofpbuf *continuation)
+{
+    static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+    enum ofp_version version = rconn_get_version(swconn);
+    enum ofputil_protocol proto = ofputil_protocol_from_ofp_version(version);
+    struct dp_packet *pkt_out_ptr = NULL;
+    uint32_t success = 0;
+
+    /* Parse result field. */
+    const struct mf_field *f;
+    enum ofperr ofperr = nx_pull_header(userdata, NULL, &f, NULL);
+    if (ofperr) {
+       VLOG_WARN_RL(&rl, "bad result OXM (%s)", ofperr_to_string(ofperr));
+       goto exit;
+    }
+
+    /* Parse result offset. */
+    ovs_be32 *ofsp = ofpbuf_try_pull(userdata, sizeof *ofsp);
+    if (!ofsp) {
+        VLOG_WARN_RL(&rl, "offset not present in the userdata");
+        goto exit;
+    }
+
+    /* Check that the result is valid and writable. */
+    struct mf_subfield dst = { .field = f, .ofs = ntohl(*ofsp), .n_bits = 1 };
+    ofperr = mf_check_dst(&dst, NULL);
+    if (ofperr) {
+        VLOG_WARN_RL(&rl, "bad result bit (%s)", ofperr_to_string(ofperr));
+        goto exit;
+    }
+
+    /* Check that the packet stores at least the minimal headers. */
+    if (dp_packet_l4_size(pkt_in) < (UDP_HEADER_LEN + DNS_HEADER_LEN)) {
+        VLOG_WARN_RL(&rl, "truncated dns packet");
+        goto exit;
+    }
+
+    /* Extract the DNS header */
+    struct dns_header const *in_dns_header = dp_packet_get_udp_payload(pkt_in);
+    if (!in_dns_header) {
+        VLOG_WARN_RL(&rl, "truncated dns packet");
+        goto exit;
+    }
+
+    /* Check if it is DNS request or not */
+    if (in_dns_header->lo_flag & 0x80) {
+        /* It's a DNS response packet which we are not interested in */
+        goto exit;
+    }
+
+    /* Check if at least one query request is present */
+    if (!in_dns_header->qdcount) {
+        goto exit;
+    }
+
+    struct udp_header *in_udp = dp_packet_l4(pkt_in);
+    size_t udp_len = ntohs(in_udp->udp_len);
+    size_t l4_len = dp_packet_l4_size(pkt_in);
+    uint8_t *end = (uint8_t *)in_udp + MIN(udp_len, l4_len);
+    uint8_t *in_dns_data = (uint8_t *)(in_dns_header + 1);
+    uint8_t *in_queryname = in_dns_data;
+    uint16_t idx = 0;
+    struct ds query_name;
+    ds_init(&query_name);
+    /* Extract the query_name. If the query name is - 'www.ovn.org' it would be
+     * encoded as (in hex) - 03 77 77 77 03 6f 76 63 03 6f 72 67 00.
+     */
+    while ((in_dns_data + idx) < end && in_dns_data[idx]) {
+        uint8_t label_len = in_dns_data[idx++];
+        if (in_dns_data + idx + label_len > end) {
+            ds_destroy(&query_name);
+            goto exit;
+        }
+        /* DNS names are case insensitive and the answers are indexed on
+         * lowercase names. */
+        for (uint8_t i = 0; i < label_len; i++) {
+            ds_put_char(&query_name, tolower(in_dns_data[idx + i]));
+        }
+        idx += label_len;
+        ds_put_char(&query_name, '.');
+    }
+
+    idx++;
+    ds_chomp(&query_name, '.');
+    in_dns_data += idx;
+
+    /* Query should have TYPE and CLASS fields */
+    if (in_dns_data + (2 * sizeof(ovs_be16)) > end) {
+        ds_destroy(&query_name);
+        goto exit;
+    }
+
+    uint16_t query_type = ntohs(get_unaligned_be16((void *) in_dns_data));
+    /* Supported query types - A, AAAA, ANY and PTR */
+    if (!(query_type == DNS_QUERY_TYPE_A || query_type == DNS_QUERY_TYPE_AAAA
+          || query_type == DNS_QUERY_TYPE_ANY
+          || query_type == DNS_QUERY_TYPE_PTR)) {
+        ds_destroy(&query_name);
         goto exit;
     }
 
+    /* The snapshot stays valid at least until this thread quiesces, i.e. for
+     * as long as this packet-in is being handled. */
+    const struct dns_answers *answers = ovsrcu_get(struct dns_answers *,
+                                                   &dns_answers);
+    uint64_t dp_key = ntohll(pin->flow_metadata.flow.metadata);
+    const struct dns_answer *answer = dns_answer_find(answers, dp_key,
+                                                      ds_cstr(&query_name));
+    ds_destroy(&query_name);
+    if (!answer) {
+        goto exit;
+    }
 
     uint16_t ancount = 0;
     uint64_t dns_ans_stub[128 / 8];
     struct ofpbuf dns_answer = OFPBUF_STUB_INITIALIZER(dns_ans_stub);
 
     if (query_type == DNS_QUERY_TYPE_PTR) {
-        dns_build_ptr_answer(&dns_answer, in_queryname, idx, answer_data);
+        dns_put_answers(&dns_answer, in_queryname, idx, &answer->ptr_rr, 1);
         ancount++;
     } else {
-        struct lport_addresses ip_addrs;
-        if (!extract_ip_addresses(answer_data, &ip_addrs)) {
-            goto exit;
+        if ((query_type == DNS_QUERY_TYPE_A ||
+             query_type == DNS_QUERY_TYPE_ANY) && answer->n_a) {
+            dns_put_answers(&dns_answer, in_queryname, idx, &answer->a_rrs,
+                            answer->n_a);
+            ancount += answer->n_a;
         }
 
-        if (query_type == DNS_QUERY_TYPE_A ||
-            query_type == DNS_QUERY_TYPE_ANY) {
-            for (size_t i = 0; i < ip_addrs.n_ipv4_addrs; i++) {
-                dns_build_a_answer(&dns_answer, in_queryname, idx,
-                                   ip_addrs.ipv4_addrs[i].addr);
-                ancount++;
-            }
+        if ((query_type == DNS_QUERY_TYPE_AAAA ||
+             query_type == DNS_QUERY_TYPE_ANY) && answer->n_aaaa) {
+            dns_put_answers(&dns_answer, in_queryname, idx,
+                            &answer->aaaa_rrs, answer->n_aaaa);
+            ancount += answer->n_aaaa;
         }
-
-        if (query_type == DNS_QUERY_TYPE_AAAA ||
-            query_type == DNS_QUERY_TYPE_ANY) {
-            for (size_t i = 0; i < ip_addrs.n_ipv6_addrs; i++) {
-                dns_build_aaaa_answer(&dns_answer, in_queryname, idx,
-                                      &ip_addrs.ipv6_addrs[i].addr);
-                ancount++;
-            }
-        }
-        destroy_lport_addresses(&ip_addrs);
     }
 
     if (!ancount) {
@@ -3100,7 +3487,9 @@ exit:
     dp_packet_uninit(pkt_out_ptr);
 }
 
-/* Called with in the pinctrl_handler thread context. */
+/* Called with in the pinctrl_handler thread or a packet-in worker thread
+ * context.  The opcodes that pin_opcode_is_offloadable() accepts must not
+ * depend on state that only pinctrl_handler() accesses. */
 static void
 process_packet_in(struct rconn *swconn, const struct ofp_header *msg)
 {
@@ -3133,6 +3522,8 @@ process_packet_in(struct rconn *swconn, const struct ofp_header *msg)
     struct flow headers;
     flow_extract(&packet, &headers);
 
+    OVN_USDT_PROBE(pinctrl, packet_in_begin, ntohl(ah->opcode),
+                   pin.packet_len);
     switch (ntohl(ah->opcode)) {
     case ACTION_OPCODE_ARP:
         pinctrl_handle_arp(swconn, &headers, &packet, &pin.flow_metadata,
@@ -3184,10 +3575,8 @@ process_packet_in(struct rconn *swconn, const struct ofp_header *msg)
         break;
 
     case ACTION_OPCODE_DNS_LOOKUP:
-        ovs_mutex_lock(&pinctrl_mutex);
         pinctrl_handle_dns_lookup(swconn, &packet, &pin, &userdata,
                                   &continuation);
-        ovs_mutex_unlock(&pinctrl_mutex);
         break;
 
     case ACTION_OPCODE_LOG:
@@ -3269,12 +3658,18 @@ process_packet_in(struct rconn *swconn, const struct ofp_header *msg)
         ovs_mutex_unlock(&pinctrl_mutex);
         break;
 
+    case ACTION_OPCODE_LAZY_DATAPATH:
+        ovs_mutex_lock(&pinctrl_mutex);
+        pinctrl_handle_lazy_datapath(&pin.flow_metadata.flow);
+        ovs_mutex_unlock(&pinctrl_mutex);
+        break;
+
     default:
         VLOG_WARN_RL(&rl, "unrecognized packet-in opcode %"PRIu32,
                      ntohl(ah->opcode));
         break;
     }
-
+    OVN_USDT_PROBE(pinctrl, packet_in_end, ntohl(ah->opcode));
 
     if (VLOG_IS_DBG_ENABLED()) {
         struct ds pin_str = DS_EMPTY_INITIALIZER;
@@ -3326,6 +3721,8 @@ pinctrl_recv(struct rconn *swconn, const struct ofp_header *oh,
     } else if (type == OFPTYPE_PACKET_IN) {
         COVERAGE_INC(pinctrl_total_pin_pkts);
         process_packet_in(swconn, oh);
+    } else if (type == OFPTYPE_FLOW_STATS_REPLY) {
+        learnt_aging_handle_stats_reply(oh);
     } else {
         if (VLOG_IS_DBG_ENABLED()) {
             static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(30, 300);
@@ -3353,6 +3750,49 @@ notify_pinctrl_main(void)
     seq_change(pinctrl_main_seq);
 }
 
+/* Called with in the pinctrl_handler thread context. */
+static void
+pinctrl_handle_lazy_datapath(const struct flow *md)
+    OVS_REQUIRES(pinctrl_mutex)
+{
+    uint32_t dp_key = ntohll(md->metadata);
+    for (size_t i = 0; i < n_lazy_dp_misses; i++) {
+        if (lazy_dp_misses[i] == dp_key) {
+            return;
+        }
+    }
+
+    /* If there are too many datapaths already, the next packet that enters
+     * this one reports it again. */
+    if (n_lazy_dp_misses < ARRAY_SIZE(lazy_dp_misses)) {
+        lazy_dp_misses[n_lazy_dp_misses++] = dp_key;
+        notify_pinctrl_main();
+    }
+}
+
+/* Called by ovn-controller main thread.
+ *
+ * Activates the lazy datapaths that packets entered since the last call.
+ * Returns true if any got activated, in which case the local datapaths must
+ * be computed again to compile their logical flows. */
+bool
+pinctrl_activate_lazy_datapaths(void)
+{
+    bool activated = false;
+
+    ovs_mutex_lock(&pinctrl_mutex);
+    for (size_t i = 0; i < n_lazy_dp_misses; i++) {
+        if (local_datapath_activate(lazy_dp_misses[i])) {
+            VLOG_DBG("activating lazy datapath %"PRIu32, lazy_dp_misses[i]);
+            activated = true;
+        }
+    }
+    n_lazy_dp_misses = 0;
+    ovs_mutex_unlock(&pinctrl_mutex);
+
+    return activated;
+}
+
 static void
 pinctrl_rconn_setup(struct rconn *swconn, const char *br_int_name)
     OVS_REQUIRES(pinctrl_mutex)
@@ -3370,6 +3810,234 @@ pinctrl_rconn_setup(struct rconn *swconn, const char *br_int_name)
     }
 }
 
+/* Maximum number of packet-ins waiting for a worker thread.  Packet-ins
+ * received while the queue is full are dropped, as the switch would do if
+ * pinctrl_handler() didn't keep up; DHCP and DNS clients retry anyway. */
+#define PIN_QUEUE_MAX_LEN 1000
+
+/* Packet-ins handed over by pinctrl_handler() to the packet-in worker
+ * threads. */
+struct pin_queue {
+    struct ovs_mutex mutex;
+    struct ovs_list msgs OVS_GUARDED;   /* Contains "struct ofpbuf"s. */
+    size_t n_msgs OVS_GUARDED;
+    bool exit OVS_GUARDED;              /* Set to stop the workers. */
+    struct seq *seq;                    /* Changes on push and on 'exit'. */
+};
+
+static struct pin_queue pin_queue;
+
+/* The packet-in worker threads.  Only pinctrl_handler() starts and stops
+ * them. */
+static pthread_t *pin_workers;
+static size_t n_pin_workers;
+
+static void
+init_pin_queue(void)
+{
+    ovs_mutex_init(&pin_queue.mutex);
+    ovs_list_init(&pin_queue.msgs);
+    pin_queue.n_msgs = 0;
+    pin_queue.exit = false;
+    pin_queue.seq = seq_create();
+}
+
+static void
+destroy_pin_queue(void)
+{
+    ovs_assert(ovs_list_is_empty(&pin_queue.msgs));
+    seq_destroy(pin_queue.seq);
+    ovs_mutex_destroy(&pin_queue.mutex);
+}
+
+/* Returns true if packet-ins with action 'opcode' may be processed by a
+ * packet-in worker thread.  That excludes the ones that need state that
+ * only pinctrl_handler() accesses without locking (e.g. IGMP snooping), the
+ * ones that update the state synced to the Southbound database under
+ * 'pinctrl_mutex', where offloading doesn't buy anything, and BFD and
+ * service monitor replies, which are latency sensitive. */
+static bool
+pin_opcode_is_offloadable(uint32_t opcode)
+{
+    switch (opcode) {
+    case ACTION_OPCODE_ARP:
+    case ACTION_OPCODE_PUT_DHCP_OPTS:
+    case ACTION_OPCODE_ND_NA:
+    case ACTION_OPCODE_ND_NA_ROUTER:
+    case ACTION_OPCODE_PUT_DHCPV6_OPTS:
+    case ACTION_OPCODE_DNS_LOOKUP:
+    case ACTION_OPCODE_LOG:
+    case ACTION_OPCODE_PUT_ND_RA_OPTS:
+    case ACTION_OPCODE_ND_NS:
+    case ACTION_OPCODE_ICMP:
+    case ACTION_OPCODE_ICMP4_ERROR:
+    case ACTION_OPCODE_ICMP6_ERROR:
+    case ACTION_OPCODE_TCP_RESET:
+    case ACTION_OPCODE_SCTP_ABORT:
+    case ACTION_OPCODE_REJECT:
+    case ACTION_OPCODE_PUT_ICMP4_FRAG_MTU:
+    case ACTION_OPCODE_PUT_ICMP6_FRAG_MTU:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/* Called with in the pinctrl_handler thread context.
+ *
+ * Queues packet-in 'msg' for the packet-in worker threads, if there are any
+ * and it is one they may process.  Returns true if it took ownership of
+ * 'msg', false if the caller should process the packet-in itself. */
+static bool
+pin_queue_push(struct ofpbuf *msg)
+{
+    if (!n_pin_workers) {
+        return false;
+    }
+
+    struct ofputil_packet_in pin;
+    if (ofputil_decode_packet_in(msg->data, true, NULL, NULL, &pin,
+                                 NULL, NULL, NULL)
+        || pin.reason != OFPR_ACTION) {
+        return false;
+    }
+
+    struct ofpbuf userdata = ofpbuf_const_initializer(pin.userdata,
+                                                      pin.userdata_len);
+    const struct action_header *ah = ofpbuf_pull(&userdata, sizeof *ah);
+    if (!ah || !pin_opcode_is_offloadable(ntohl(ah->opcode))) {
+        return false;
+    }
+
+    ovs_mutex_lock(&pin_queue.mutex);
+    if (pin_queue.n_msgs >= PIN_QUEUE_MAX_LEN) {
+        ovs_mutex_unlock(&pin_queue.mutex);
+        COVERAGE_INC(pinctrl_drop_pin_queue_full);
+        ofpbuf_delete(msg);
+        return true;
+    }
+    ovs_list_push_back(&pin_queue.msgs, &msg->list_node);
+    pin_queue.n_msgs++;
+    ovs_mutex_unlock(&pin_queue.mutex);
+
+    COVERAGE_INC(pinctrl_queued_pin_pkts);
+    seq_change(pin_queue.seq);
+    return true;
+}
+
+/* Maximum number of packet-ins that a packet-in worker thread takes from
+ * 'pin_queue' at once. */
+#define PIN_WORKER_BATCH 50
+
+/* Moves up to 'max' of the oldest packet-ins from 'pin_queue' to 'msgs' and
+ * returns how many were moved.  Returns 0 if the queue is empty or, if
+ * 'exit' is nonnull, if the workers are asked to stop, which is then
+ * reported in '*exit'. */
+static size_t
+pin_queue_pop(struct ovs_list *msgs, size_t max, bool *exit)
+{
+    size_t n = 0;
+
+    ovs_list_init(msgs);
+    ovs_mutex_lock(&pin_queue.mutex);
+    if (exit) {
+        *exit = pin_queue.exit;
+    }
+    if (!exit || !*exit) {
+        while (n < max && !ovs_list_is_empty(&pin_queue.msgs)) {
+            ovs_list_push_back(msgs, ovs_list_pop_front(&pin_queue.msgs));
+            n++;
+        }
+        pin_queue.n_msgs -= n;
+    }
+    ovs_mutex_unlock(&pin_queue.mutex);
+
+    return n;
+}
+
+/* Processes the packet-ins in 'msgs' and frees them.  The replies are sent
+ * as a single batch. */
+static void
+pin_process_batch(struct rconn *swconn, struct ovs_list *msgs)
+{
+    struct ovs_list batch;
+    struct ofpbuf *msg;
+
+    tx_batch_start(&batch);
+    LIST_FOR_EACH_POP (msg, list_node, msgs) {
+        process_packet_in(swconn, msg->data);
+        ofpbuf_delete(msg);
+    }
+    tx_batch_flush(swconn);
+}
+
+/* Packet-in worker pthread function. */
+static void *
+pin_worker(void *swconn_)
+{
+    struct rconn *swconn = swconn_;
+
+    for (;;) {
+        uint64_t seq = seq_read(pin_queue.seq);
+        struct ovs_list msgs;
+        bool exit;
+
+        size_t n = pin_queue_pop(&msgs, PIN_WORKER_BATCH, &exit);
+        if (exit) {
+            break;
+        }
+        if (n) {
+            pin_process_batch(swconn, &msgs);
+            continue;
+        }
+
+        seq_wait(pin_queue.seq, seq);
+        poll_block();
+    }
+    return NULL;
+}
+
+/* Called with in the pinctrl_handler thread context.
+ *
+ * Stops the current packet-in worker threads, processes the packet-ins they
+ * left in the queue and then starts 'n_workers' new ones. */
+static void
+pin_workers_set(struct rconn *swconn, size_t n_workers)
+{
+    if (n_pin_workers) {
+        ovs_mutex_lock(&pin_queue.mutex);
+        pin_queue.exit = true;
+        ovs_mutex_unlock(&pin_queue.mutex);
+        seq_change(pin_queue.seq);
+
+        for (size_t i = 0; i < n_pin_workers; i++) {
+            xpthread_join(pin_workers[i], NULL);
+        }
+        free(pin_workers);
+        pin_workers = NULL;
+        n_pin_workers = 0;
+
+        ovs_mutex_lock(&pin_queue.mutex);
+        pin_queue.exit = false;
+        ovs_mutex_unlock(&pin_queue.mutex);
+    }
+
+    struct ovs_list msgs;
+    while (pin_queue_pop(&msgs, SIZE_MAX, NULL)) {
+        pin_process_batch(swconn, &msgs);
+    }
+
+    if (n_workers) {
+        VLOG_INFO("using %"PRIuSIZE" packet-in worker threads", n_workers);
+        pin_workers = xmalloc(n_workers * sizeof *pin_workers);
+        for (size_t i = 0; i < n_workers; i++) {
+            pin_workers[i] = ovs_thread_create("ovn_pinctrl_pin", pin_worker,
+                                               swconn);
+        }
+        n_pin_workers = n_workers;
+    }
+}
+
 /* pinctrl_handler pthread function. */
 static void *
 pinctrl_handler(void *arg_)
@@ -3391,18 +4059,30 @@ pinctrl_handler(void *arg_)
     static long long int send_mcast_query_time = LLONG_MAX;
     static long long int svc_monitors_next_run_time = LLONG_MAX;
     static long long int send_prefixd_time = LLONG_MAX;
+    /* Next learnt MAC_Binding and FDB aging stats request in ms. */
+    static long long int aging_next_run_time = LLONG_MAX;
 
     swconn = rconn_create(5, 0, DSCP_DEFAULT, 1 << OFP15_VERSION);
 
     while (!latch_is_set(&pctrl->pinctrl_thread_exit)) {
-        long long int bfd_time = LLONG_MAX;
-
         ovs_mutex_lock(&pinctrl_mutex);
         pinctrl_rconn_setup(swconn, pctrl->br_int_name);
         ip_mcast_snoop_run();
+        size_t n_workers = pctrl->n_threads - 1;
         ovs_mutex_unlock(&pinctrl_mutex);
 
+        if (n_workers != n_pin_workers) {
+            pin_workers_set(swconn, n_workers);
+        }
+
         rconn_run(swconn);
+
+        /* Send the replies to the packet-ins received below and the periodic
+         * messages in one batch, after processing all of them. */
+        struct ovs_list tx_batch;
+        tx_batch_start(&tx_batch);
+        bool tx_backlogged = false;
+
         if (rconn_is_connected(swconn)) {
             if (conn_seq_no != rconn_get_connection_seqno(swconn)) {
                 pinctrl_setup(swconn);
@@ -3410,6 +4090,13 @@ pinctrl_handler(void *arg_)
             }
 
             for (int i = 0; i < 50; i++) {
+                if (rconn_packet_counter_n_packets(pinctrl_tx_counter)
+                    >= PINCTRL_TX_BACKLOG_MAX) {
+                    COVERAGE_INC(pinctrl_tx_backlogged);
+                    tx_backlogged = true;
+                    break;
+                }
+
                 struct ofpbuf *msg = rconn_recv(swconn);
                 if (!msg) {
                     break;
@@ -3419,6 +4106,11 @@ pinctrl_handler(void *arg_)
                 enum ofptype type;
 
                 ofptype_decode(&type, oh);
+                if (type == OFPTYPE_PACKET_IN && pin_queue_push(msg)) {
+                    /* A packet-in worker thread will process it. */
+                    COVERAGE_INC(pinctrl_total_pin_pkts);
+                    continue;
+                }
                 pinctrl_recv(swconn, oh, type);
                 ofpbuf_delete(msg);
             }
@@ -3429,7 +4121,7 @@ pinctrl_handler(void *arg_)
                 send_ipv6_ras(swconn, &send_ipv6_ra_time);
                 send_ipv6_prefixd(swconn, &send_prefixd_time);
                 send_mac_binding_buffered_pkts(swconn);
-                bfd_monitor_send_msg(swconn, &bfd_time);
+                bfd_monitor_send_msg(swconn);
                 ovs_mutex_unlock(&pinctrl_mutex);
 
                 ip_mcast_querier_run(swconn, &send_mcast_query_time);
@@ -3438,16 +4130,26 @@ pinctrl_handler(void *arg_)
 
         ovs_mutex_lock(&pinctrl_mutex);
         svc_monitors_run(swconn, &svc_monitors_next_run_time);
+        if (rconn_is_connected(swconn)) {
+            learnt_aging_run(swconn, &aging_next_run_time);
+        }
         ovs_mutex_unlock(&pinctrl_mutex);
 
+        tx_batch_flush(swconn);
+
         rconn_run_wait(swconn);
-        rconn_recv_wait(swconn);
+        if (!tx_backlogged) {
+            /* Otherwise, rconn_run_wait() wakes us up once the switch
+             * has read some of the backlog. */
+            rconn_recv_wait(swconn);
+        }
         send_garp_rarp_wait(send_garp_rarp_time);
         ipv6_ra_wait(send_ipv6_ra_time);
         ip_mcast_querier_wait(send_mcast_query_time);
         svc_monitors_wait(svc_monitors_next_run_time);
         ipv6_prefixd_wait(send_prefixd_time);
-        bfd_monitor_wait(bfd_time);
+        bfd_monitor_wait();
+        learnt_aging_wait(aging_next_run_time);
 
         new_seq = seq_read(pinctrl_handler_seq);
         seq_wait(pinctrl_handler_seq, new_seq);
@@ -3456,6 +4158,7 @@ pinctrl_handler(void *arg_)
         poll_block();
     }
 
+    pin_workers_set(swconn, 0);
     rconn_destroy(swconn);
     return NULL;
 }
@@ -3482,6 +4185,23 @@ pinctrl_set_br_int_name(char *br_int_name)
     ovs_mutex_unlock(&pinctrl_mutex);
 }
 
+/* Sets the number of threads that handle packet-ins to 'n_threads',
+ * including the pinctrl_handler thread itself.  With more than one thread,
+ * pinctrl_handler() offloads most packet-ins to 'n_threads - 1' worker
+ * threads. */
+void
+pinctrl_set_n_threads(size_t n_threads)
+{
+    n_threads = MIN(MAX(n_threads, 1), PINCTRL_MAX_N_THREADS);
+
+    ovs_mutex_lock(&pinctrl_mutex);
+    if (pinctrl.n_threads != n_threads) {
+        pinctrl.n_threads = n_threads;
+        notify_pinctrl_handler();
+    }
+    ovs_mutex_unlock(&pinctrl_mutex);
+}
+
 /* Called by ovn-controller. */
 void
 pinctrl_run(struct ovsdb_idl_txn *ovnsb_idl_txn,
@@ -3490,9 +4210,13 @@ pinctrl_run(struct ovsdb_idl_txn *ovnsb_idl_txn,
             struct ovsdb_idl_index *sbrec_port_binding_by_key,
             struct ovsdb_idl_index *sbrec_port_binding_by_name,
             struct ovsdb_idl_index *sbrec_mac_binding_by_lport_ip,
+            struct ovsdb_idl_index *sbrec_mac_binding_by_datapath,
             struct ovsdb_idl_index *sbrec_igmp_groups,
             struct ovsdb_idl_index *sbrec_ip_multicast_opts,
             struct ovsdb_idl_index *sbrec_fdb_by_dp_key_mac,
+            struct ovsdb_idl_index *sbrec_fdb_by_dp_key,
+            const struct sbrec_mac_binding_table *mac_binding_table,
+            const struct sbrec_fdb_table *fdb_table,
             const struct sbrec_dns_table *dns_table,
             const struct sbrec_controller_event_table *ce_table,
             const struct sbrec_service_monitor_table *svc_mon_table,
@@ -3508,7 +4232,8 @@ pinctrl_run(struct ovsdb_idl_txn *ovnsb_idl_txn,
     pinctrl_set_br_int_name_(br_int->name);
     run_put_mac_bindings(ovnsb_idl_txn, sbrec_datapath_binding_by_key,
                          sbrec_port_binding_by_key,
-                         sbrec_mac_binding_by_lport_ip);
+                         sbrec_mac_binding_by_lport_ip,
+                         sbrec_mac_binding_by_datapath);
     run_put_vport_bindings(ovnsb_idl_txn, sbrec_datapath_binding_by_key,
                            sbrec_port_binding_by_key, chassis);
     send_garp_rarp_prepare(ovnsb_idl_txn, sbrec_port_binding_by_datapath,
@@ -3532,14 +4257,89 @@ pinctrl_run(struct ovsdb_idl_txn *ovnsb_idl_txn,
                       chassis);
     bfd_monitor_run(ovnsb_idl_txn, bfd_table, sbrec_port_binding_by_name,
                     chassis, active_tunnels);
-    run_put_fdbs(ovnsb_idl_txn, sbrec_fdb_by_dp_key_mac);
+    run_put_fdbs(ovnsb_idl_txn, sbrec_fdb_by_dp_key_mac, sbrec_fdb_by_dp_key);
+    run_learnt_aging(ovnsb_idl_txn, sbrec_datapath_binding_by_key,
+                     sbrec_port_binding_by_key, sbrec_port_binding_by_name,
+                     mac_binding_table, fdb_table, chassis, active_tunnels);
     ovs_mutex_unlock(&pinctrl_mutex);
 }
 
+/* Deadline queues for the periodic packets sent by the pinctrl_handler
+ * thread.  Each queue is a heap ordered on the earliest deadline, so that a
+ * wakeup only has to look at the entries that are due instead of walking
+ * every entry of the corresponding table. */
+struct pinctrl_timer {
+    struct heap_node heap_node;
+    long long int deadline;     /* LLONG_MAX if not scheduled. */
+};
+
+static void
+pinctrl_timer_init(struct pinctrl_timer *timer)
+{
+    timer->deadline = LLONG_MAX;
+}
+
+static void
+pinctrl_timer_schedule(struct heap *timers, struct pinctrl_timer *timer,
+                       long long int deadline)
+{
+    /* Earlier deadlines get a higher priority in the max-heap. */
+    uint64_t priority = LLONG_MAX - MAX(deadline, 0);
+
+    if (timer->deadline == LLONG_MAX) {
+        if (deadline != LLONG_MAX) {
+            heap_insert(timers, &timer->heap_node, priority);
+        }
+    } else if (deadline == LLONG_MAX) {
+        heap_remove(timers, &timer->heap_node);
+    } else {
+        heap_change(timers, &timer->heap_node, priority);
+    }
+    timer->deadline = deadline;
+}
+
+static void
+pinctrl_timer_cancel(struct heap *timers, struct pinctrl_timer *timer)
+{
+    pinctrl_timer_schedule(timers, timer, LLONG_MAX);
+}
+
+/* Returns the earliest deadline in 'timers', or LLONG_MAX if empty. */
+static long long int
+pinctrl_timers_next(const struct heap *timers)
+{
+    if (heap_is_empty(timers)) {
+        return LLONG_MAX;
+    }
+    struct pinctrl_timer *timer = CONTAINER_OF(heap_max(timers),
+                                               struct pinctrl_timer,
+                                               heap_node);
+    return timer->deadline;
+}
+
+/* Removes and returns the earliest timer in 'timers' if it is due at
+ * 'now', otherwise returns NULL. */
+static struct pinctrl_timer *
+pinctrl_timers_pop_due(struct heap *timers, long long int now)
+{
+    if (pinctrl_timers_next(timers) > now) {
+        return NULL;
+    }
+    struct pinctrl_timer *timer = CONTAINER_OF(heap_max(timers),
+                                               struct pinctrl_timer,
+                                               heap_node);
+    pinctrl_timer_cancel(timers, timer);
+    return timer;
+}
+
 /* Table of ipv6_ra_state structures, keyed on logical port name.
  * Protected by pinctrl_mutex. */
 static struct shash ipv6_ras;
 
+/* The 'ipv6_ras' entries ordered on their next announcement.  Protected by
+ * pinctrl_mutex. */
+static struct heap ipv6_ra_timers;
+
 struct ipv6_ra_config {
     time_t min_interval;
     time_t max_interval;
@@ -3558,6 +4358,7 @@ struct ipv6_ra_config {
 };
 
 struct ipv6_ra_state {
+    struct pinctrl_timer timer; /* In 'ipv6_ra_timers'. */
     long long int next_announce;
     struct ipv6_ra_config *config;
     int64_t port_key;
@@ -3569,6 +4370,7 @@ static void
 init_ipv6_ras(void)
 {
     shash_init(&ipv6_ras);
+    heap_init(&ipv6_ra_timers);
 }
 
 static void
@@ -3601,6 +4403,7 @@ destroy_ipv6_ras(void)
         shash_delete(&ipv6_ras, iter);
     }
     shash_destroy(&ipv6_ras);
+    heap_destroy(&ipv6_ra_timers);
 }
 
 static struct ipv6_ra_config *
@@ -3933,15 +4736,16 @@ static void
 send_ipv6_ras(struct rconn *swconn, long long int *send_ipv6_ra_time)
     OVS_REQUIRES(pinctrl_mutex)
 {
-    *send_ipv6_ra_time = LLONG_MAX;
-    struct shash_node *iter;
-    SHASH_FOR_EACH (iter, &ipv6_ras) {
-        struct ipv6_ra_state *ra = iter->data;
-        long long int next_ra = ipv6_ra_send(swconn, ra);
-        if (*send_ipv6_ra_time > next_ra) {
-            *send_ipv6_ra_time = next_ra;
-        }
+    long long int current_time = time_msec();
+    struct pinctrl_timer *timer;
+
+    while ((timer = pinctrl_timers_pop_due(&ipv6_ra_timers, current_time))) {
+        struct ipv6_ra_state *ra = CONTAINER_OF(timer, struct ipv6_ra_state,
+                                                timer);
+        pinctrl_timer_schedule(&ipv6_ra_timers, &ra->timer,
+                               ipv6_ra_send(swconn, ra));
     }
+    *send_ipv6_ra_time = pinctrl_timers_next(&ipv6_ra_timers);
 }
 
 /* Called by pinctrl_run(). Runs with in the main ovn-controller
@@ -3987,14 +4791,21 @@ prepare_ipv6_ras(const struct shash *local_active_ports_ras,
             ra->next_announce = ipv6_ra_calc_next_announce(
                 ra->config->min_interval,
                 ra->config->max_interval);
+            pinctrl_timer_init(&ra->timer);
+            pinctrl_timer_schedule(&ipv6_ra_timers, &ra->timer,
+                                   ra->next_announce);
             shash_add(&ipv6_ras, pb->logical_port, ra);
             changed = true;
         } else {
             if (config->min_interval != ra->config->min_interval ||
-                config->max_interval != ra->config->max_interval)
+                config->max_interval != ra->config->max_interval) {
                 ra->next_announce = ipv6_ra_calc_next_announce(
                     config->min_interval,
                     config->max_interval);
+                pinctrl_timer_schedule(&ipv6_ra_timers, &ra->timer,
+                                       ra->next_announce);
+                changed = true;
+            }
             ipv6_ra_config_delete(ra->config);
             ra->config = config;
         }
@@ -4014,6 +4825,7 @@ prepare_ipv6_ras(const struct shash *local_active_ports_ras,
     SHASH_FOR_EACH_SAFE (iter, &ipv6_ras) {
         struct ipv6_ra_state *ra = iter->data;
         if (ra->delete_me) {
+            pinctrl_timer_cancel(&ipv6_ra_timers, &ra->timer);
             shash_delete(&ipv6_ras, iter);
             ipv6_ra_delete(ra);
         }
@@ -4054,10 +4866,13 @@ pinctrl_destroy(void)
     destroy_put_mac_bindings();
     destroy_put_vport_bindings();
     destroy_dns_cache();
+    destroy_pin_queue();
+    rconn_packet_counter_destroy(pinctrl_tx_counter);
     ip_mcast_snoop_destroy();
     destroy_svc_monitors();
     bfd_monitor_destroy();
     destroy_fdb_entries();
+    destroy_learnt_aging();
     seq_destroy(pinctrl_main_seq);
     seq_destroy(pinctrl_handler_seq);
 }
@@ -4071,17 +4886,39 @@ pinctrl_destroy(void)
  * but in fact we can only update it when 'ovnsb_idl_txn' is nonnull.  Thus,
  * we buffer up a few put_mac_bindings (but we don't keep them longer
  * than 1 second) and apply them whenever a database transaction is
- * available. */
+ * available.
+ *
+ * Repeated bindings for the same IP are coalesced while they are buffered,
+ * and the ones that the Southbound database already has are not written
+ * again.  The rate at which the remaining ones are written can be limited,
+ * see pinctrl_set_mac_binding_rate_limit(), in which case the bindings that
+ * are over the limit stay buffered until the next transaction. */
 
 /* Buffered "put_mac_binding" operation. */
 
 /* Contains "struct mac_binding"s. */
 static struct hmap put_mac_bindings;
 
+/* Each MAC_Binding written to the SB costs PUT_MAC_BINDING_TOKENS from
+ * 'put_mac_bindings_tb', which gets 'put_mac_bindings_rate' tokens per
+ * millisecond, i.e. 'put_mac_bindings_rate' MAC_Bindings per second.
+ * There is no limit if 'put_mac_bindings_rate' is 0.  The burst is one
+ * second worth of MAC_Bindings. */
+#define PUT_MAC_BINDING_TOKENS 1000
+static struct token_bucket put_mac_bindings_tb;
+static unsigned int put_mac_bindings_rate;
+
+/* True if the last run_put_mac_bindings() left MAC_Bindings buffered
+ * because of the rate limit. */
+static bool put_mac_bindings_throttled;
+
 static void
 init_put_mac_bindings(void)
 {
     ovn_mac_bindings_init(&put_mac_bindings);
+    token_bucket_init(&put_mac_bindings_tb, 0, 0);
+    put_mac_bindings_rate = 0;
+    put_mac_bindings_throttled = false;
 }
 
 static void
@@ -4225,12 +5062,39 @@ send_garp_locally(struct ovsdb_idl_txn *ovnsb_idl_txn,
     }
 }
 
-static void
+/* Returns the number of MAC_Bindings of datapath 'dp', counting no further
+ * than 'max'. */
+static unsigned int
+mac_bindings_count(struct ovsdb_idl_index *sbrec_mac_binding_by_datapath,
+                   const struct sbrec_datapath_binding *dp, unsigned int max)
+{
+    struct sbrec_mac_binding *target =
+        sbrec_mac_binding_index_init_row(sbrec_mac_binding_by_datapath);
+    sbrec_mac_binding_index_set_datapath(target, dp);
+
+    unsigned int n = 0;
+    const struct sbrec_mac_binding *b;
+    SBREC_MAC_BINDING_FOR_EACH_EQUAL (b, target,
+                                      sbrec_mac_binding_by_datapath) {
+        if (++n >= max) {
+            break;
+        }
+    }
+    sbrec_mac_binding_index_destroy_row(target);
+
+    return n;
+}
+
+/* Writes 'mb' to the SB, unless the SB already has it.  Returns false if
+ * 'mb' has to stay buffered because of the rate limit. */
+static bool
 run_put_mac_binding(struct ovsdb_idl_txn *ovnsb_idl_txn,
                     struct ovsdb_idl_index *sbrec_datapath_binding_by_key,
                     struct ovsdb_idl_index *sbrec_port_binding_by_key,
                     struct ovsdb_idl_index *sbrec_mac_binding_by_lport_ip,
+                    struct ovsdb_idl_index *sbrec_mac_binding_by_datapath,
                     const struct mac_binding *mb)
+    OVS_REQUIRES(pinctrl_mutex)
 {
     /* Convert logical datapath and logical port key into lport. */
     const struct sbrec_port_binding *pb = lport_lookup_by_key(
@@ -4241,7 +5105,7 @@ run_put_mac_binding(struct ovsdb_idl_txn *ovnsb_idl_txn,
 
         VLOG_WARN_RL(&rl, "unknown logical port with datapath %"PRIu32" "
                      "and port %"PRIu32, mb->dp_key, mb->port_key);
-        return;
+        return true;
     }
 
     /* Convert ethernet argument to string form for database. */
@@ -4251,10 +5115,35 @@ run_put_mac_binding(struct ovsdb_idl_txn *ovnsb_idl_txn,
 
     struct ds ip_s = DS_EMPTY_INITIALIZER;
     ipv6_format_mapped(&mb->ip, &ip_s);
-    mac_binding_add_to_sb(ovnsb_idl_txn, sbrec_mac_binding_by_lport_ip,
-                          pb->logical_port, pb->datapath, mb->mac,
-                          ds_cstr(&ip_s), false);
+
+    bool done = true;
+    const struct sbrec_mac_binding *b =
+        mac_binding_lookup(sbrec_mac_binding_by_lport_ip, pb->logical_port,
+                           ds_cstr(&ip_s));
+    if (b && !strcmp(b->mac, mac_string)) {
+        /* E.g. a gratuitous ARP repeating a known binding. */
+        COVERAGE_INC(pinctrl_dedup_put_mac_binding);
+    } else if (!b && mac_binding_aging.max_per_dp
+               && mac_bindings_count(sbrec_mac_binding_by_datapath,
+                                     pb->datapath,
+                                     mac_binding_aging.max_per_dp)
+                  >= mac_binding_aging.max_per_dp) {
+        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+        VLOG_WARN_RL(&rl, "not learning MAC_Binding %s on port %s, its "
+                     "datapath already has %u of them", ds_cstr(&ip_s),
+                     pb->logical_port, mac_binding_aging.max_per_dp);
+        COVERAGE_INC(pinctrl_limit_put_mac_binding);
+    } else if (put_mac_bindings_rate
+               && !token_bucket_withdraw(&put_mac_bindings_tb,
+                                         PUT_MAC_BINDING_TOKENS)) {
+        done = false;
+    } else {
+        mac_binding_add_to_sb(ovnsb_idl_txn, sbrec_mac_binding_by_lport_ip,
+                              pb->logical_port, pb->datapath, mb->mac,
+                              ds_cstr(&ip_s), false);
+    }
     ds_destroy(&ip_s);
+    return done;
 }
 
 /* Called by pinctrl_run(). Runs with in the main ovn-controller
@@ -4263,21 +5152,48 @@ static void
 run_put_mac_bindings(struct ovsdb_idl_txn *ovnsb_idl_txn,
                      struct ovsdb_idl_index *sbrec_datapath_binding_by_key,
                      struct ovsdb_idl_index *sbrec_port_binding_by_key,
-                     struct ovsdb_idl_index *sbrec_mac_binding_by_lport_ip)
+                     struct ovsdb_idl_index *sbrec_mac_binding_by_lport_ip,
+                     struct ovsdb_idl_index *sbrec_mac_binding_by_datapath)
     OVS_REQUIRES(pinctrl_mutex)
 {
     if (!ovnsb_idl_txn) {
         return;
     }
 
-    const struct mac_binding *mb;
-    HMAP_FOR_EACH (mb, hmap_node, &put_mac_bindings) {
-        run_put_mac_binding(ovnsb_idl_txn, sbrec_datapath_binding_by_key,
-                            sbrec_port_binding_by_key,
-                            sbrec_mac_binding_by_lport_ip,
-                            mb);
+    /* All the MAC_Bindings that fit in the rate limit are written in this
+     * same transaction. */
+    struct mac_binding *mb;
+    put_mac_bindings_throttled = false;
+    HMAP_FOR_EACH_SAFE (mb, hmap_node, &put_mac_bindings) {
+        if (!run_put_mac_binding(ovnsb_idl_txn, sbrec_datapath_binding_by_key,
+                                 sbrec_port_binding_by_key,
+                                 sbrec_mac_binding_by_lport_ip,
+                                 sbrec_mac_binding_by_datapath,
+                                 mb)) {
+            put_mac_bindings_throttled = true;
+            COVERAGE_INC(pinctrl_defer_put_mac_binding);
+            continue;
+        }
+        hmap_remove(&put_mac_bindings, &mb->hmap_node);
+        free(mb);
     }
-    ovn_mac_bindings_flush(&put_mac_bindings);
+}
+
+/* Limits the number of MAC_Bindings learnt through put_arp/put_nd that are
+ * written to the SB to 'rate' per second.  0 means no limit. */
+void
+pinctrl_set_mac_binding_rate_limit(unsigned int rate)
+{
+    rate = MIN(rate, UINT_MAX / PUT_MAC_BINDING_TOKENS);
+
+    ovs_mutex_lock(&pinctrl_mutex);
+    if (put_mac_bindings_rate != rate) {
+        put_mac_bindings_rate = rate;
+        token_bucket_set(&put_mac_bindings_tb, rate,
+                         rate * PUT_MAC_BINDING_TOKENS);
+        put_mac_bindings_throttled = false;
+    }
+    ovs_mutex_unlock(&pinctrl_mutex);
 }
 
 static void
@@ -4286,8 +5202,13 @@ run_buffered_binding(struct ovsdb_idl_index *sbrec_mac_binding_by_lport_ip,
     OVS_REQUIRES(pinctrl_mutex)
 {
     const struct local_datapath *ld;
+    long long int now = time_msec();
     bool notify = false;
 
+    if (hmap_is_empty(&buffered_packets_map)) {
+        return;
+    }
+
     HMAP_FOR_EACH (ld, hmap_node, local_datapaths) {
         /* MAC_Binding.logical_port will always belong to a
          * a router datapath. Hence we can skip logical switch
@@ -4309,8 +5230,7 @@ run_buffered_binding(struct ovsdb_idl_index *sbrec_mac_binding_by_lport_ip,
                         ds_cstr(&ip_s));
                 if (b && ovs_scan(b->mac, ETH_ADDR_SCAN_FMT,
                                   ETH_ADDR_SCAN_ARGS(cur_qp->ea))) {
-                    hmap_remove(&buffered_packets_map, &cur_qp->hmap_node);
-                    ovs_list_push_back(&buffered_mac_bindings, &cur_qp->list);
+                    buffered_packets_resolved(cur_qp, now);
                     notify = true;
                 }
                 ds_destroy(&ip_s);
@@ -4327,7 +5247,13 @@ run_buffered_binding(struct ovsdb_idl_index *sbrec_mac_binding_by_lport_ip,
 static void
 wait_put_mac_bindings(struct ovsdb_idl_txn *ovnsb_idl_txn)
 {
-    if (ovnsb_idl_txn && !hmap_is_empty(&put_mac_bindings)) {
+    if (hmap_is_empty(&put_mac_bindings)) {
+        return;
+    }
+
+    if (put_mac_bindings_throttled) {
+        token_bucket_wait(&put_mac_bindings_tb, PUT_MAC_BINDING_TOKENS);
+    } else if (ovnsb_idl_txn) {
         poll_immediate_wake();
     }
 }
@@ -4342,6 +5268,7 @@ wait_put_mac_bindings(struct ovsdb_idl_txn *ovnsb_idl_txn)
  * their port-mac and ARP tables.
  */
 struct garp_rarp_data {
+    struct pinctrl_timer timer;  /* In 'send_garp_rarp_timers'. */
     struct eth_addr ea;          /* Ethernet address of port. */
     ovs_be32 ipv4;               /* Ipv4 address of port. */
     long long int announce_time; /* Next announcement in ms. */
@@ -4353,16 +5280,22 @@ struct garp_rarp_data {
 /* Contains GARPs/RARPs to be sent. Protected by pinctrl_mutex*/
 static struct shash send_garp_rarp_data;
 
+/* The 'send_garp_rarp_data' entries that still have announcements to send,
+ * ordered on their next announcement.  Protected by pinctrl_mutex. */
+static struct heap send_garp_rarp_timers;
+
 static void
 init_send_garps_rarps(void)
 {
     shash_init(&send_garp_rarp_data);
+    heap_init(&send_garp_rarp_timers);
 }
 
 static void
 destroy_send_garps_rarps(void)
 {
     shash_destroy_free_data(&send_garp_rarp_data);
+    heap_destroy(&send_garp_rarp_timers);
 }
 
 /* Runs with in the main ovn-controller thread context. */
@@ -4377,6 +5310,9 @@ add_garp_rarp(const char *name, const struct eth_addr ea, ovs_be32 ip,
     garp_rarp->backoff = 1;
     garp_rarp->dp_key = dp_key;
     garp_rarp->port_key = port_key;
+    pinctrl_timer_init(&garp_rarp->timer);
+    pinctrl_timer_schedule(&send_garp_rarp_timers, &garp_rarp->timer,
+                           garp_rarp->announce_time);
     shash_add(&send_garp_rarp_data, name, garp_rarp);
 
     /* Notify pinctrl_handler so that it can wakeup and process
@@ -4477,7 +5413,10 @@ send_garp_rarp_delete(const char *lport)
 {
     struct garp_rarp_data *garp_rarp = shash_find_and_delete
                                        (&send_garp_rarp_data, lport);
-    free(garp_rarp);
+    if (garp_rarp) {
+        pinctrl_timer_cancel(&send_garp_rarp_timers, &garp_rarp->timer);
+        free(garp_rarp);
+    }
     notify_pinctrl_handler();
 }
 
@@ -4623,11 +5562,19 @@ struct ip_mcast_snoop_cfg {
 struct ip_mcast_snoop {
     struct hmap_node hmap_node;    /* Linkage in the hash map. */
     struct ovs_list query_node;    /* Linkage in the query list. */
+    struct pinctrl_timer query_timer; /* In 'mcast_query_timers'. */
     struct ip_mcast_snoop_cfg cfg; /* Multicast configuration. */
     struct mcast_snooping *ms;     /* Multicast group state. */
     int64_t dp_key;                /* Datapath running the snooping. */
 
     long long int query_time_ms;   /* Next query time in ms. */
+
+    /* Set by pinctrl_handler when the groups in 'ms' changed, cleared by
+     * ip_mcast_sync() once they are synced to the IGMP_Group table. */
+    atomic_bool groups_changed;
+
+    /* Only used by ip_mcast_sync(). */
+    bool sync_groups;
 };
 
 /*
@@ -4657,6 +5604,11 @@ static struct hmap mcast_snoop_map OVS_GUARDED_BY(pinctrl_mutex);
  */
 static struct ovs_list mcast_query_list;
 
+/* The mcast_query_list entries ordered on their next query time.  Only used
+ * by pinctrl_handler so no locking needed.
+ */
+static struct heap mcast_query_timers;
+
 /* Multicast config information stored independently by datapath key.
  * Protected by pinctrl_mutex. pinctrl_handler has RO access and pinctrl_main
  * has RW access. Read accesses from pinctrl_ip_mcast_handle() can be
@@ -4883,10 +5835,16 @@ ip_mcast_snoop_configure(struct ip_mcast_snoop *ip_ms,
 
     if (old_querier_enabled && !querier_enabled) {
         ovs_list_remove(&ip_ms->query_node);
+        pinctrl_timer_cancel(&mcast_query_timers, &ip_ms->query_timer);
     } else if (!old_querier_enabled && querier_enabled) {
         ovs_list_push_back(&mcast_query_list, &ip_ms->query_node);
+        pinctrl_timer_schedule(&mcast_query_timers, &ip_ms->query_timer,
+                               ip_ms->query_time_ms);
     }
 
+    /* The learnt groups may have been flushed or the snooping disabled. */
+    atomic_store(&ip_ms->groups_changed, true);
+
     if (cfg->enabled) {
         if (!ip_mcast_snoop_enable(ip_ms)) {
             return false;
@@ -4914,6 +5872,10 @@ ip_mcast_snoop_configure(struct ip_mcast_snoop *ip_ms,
 
         if (ip_ms->query_time_ms > now + cfg->query_interval_s * 1000) {
             ip_ms->query_time_ms = now;
+            if (querier_enabled) {
+                pinctrl_timer_schedule(&mcast_query_timers,
+                                       &ip_ms->query_timer, now);
+            }
         }
     }
 
@@ -4929,6 +5891,8 @@ ip_mcast_snoop_add(int64_t dp_key, const struct ip_mcast_snoop_cfg *cfg)
     struct ip_mcast_snoop *ip_ms = xzalloc(sizeof *ip_ms);
 
     ip_ms->dp_key = dp_key;
+    pinctrl_timer_init(&ip_ms->query_timer);
+    atomic_init(&ip_ms->groups_changed, true);
     if (!ip_mcast_snoop_configure(ip_ms, cfg)) {
         free(ip_ms);
         return NULL;
@@ -4962,6 +5926,7 @@ ip_mcast_snoop_remove(struct ip_mcast_snoop *ip_ms)
 
     if (ip_ms->cfg.querier_v4_enabled || ip_ms->cfg.querier_v6_enabled) {
         ovs_list_remove(&ip_ms->query_node);
+        pinctrl_timer_cancel(&mcast_query_timers, &ip_ms->query_timer);
     }
 
     ip_mcast_snoop_disable(ip_ms);
@@ -4974,6 +5939,7 @@ ip_mcast_snoop_init(void)
 {
     hmap_init(&mcast_snoop_map);
     ovs_list_init(&mcast_query_list);
+    heap_init(&mcast_query_timers);
     hmap_init(&mcast_cfg_map);
 }
 
@@ -4987,6 +5953,7 @@ ip_mcast_snoop_destroy(void)
         ip_mcast_snoop_remove(ip_ms);
     }
     hmap_destroy(&mcast_snoop_map);
+    heap_destroy(&mcast_query_timers);
 
     struct ip_mcast_snoop_state *ip_ms_state;
 
@@ -5031,6 +5998,7 @@ ip_mcast_snoop_run(void)
         /* If enabled run the snooping instance to timeout old groups. */
         if (ip_ms->cfg.enabled) {
             if (mcast_snooping_run(ip_ms->ms)) {
+                atomic_store(&ip_ms->groups_changed, true);
                 notify = true;
             }
 
@@ -5113,6 +6081,22 @@ ip_mcast_sync(struct ovsdb_idl_txn *ovnsb_idl_txn,
         }
     }
 
+    /* Only the groups of the datapaths on which the learnt groups changed
+     * since the last sync need to be looked at. */
+    struct ip_mcast_snoop *ip_ms;
+
+    HMAP_FOR_EACH (ip_ms, hmap_node, &mcast_snoop_map) {
+        bool groups_changed;
+
+        atomic_read(&ip_ms->groups_changed, &groups_changed);
+        ip_ms->sync_groups =
+            groups_changed && get_local_datapath(local_datapaths,
+                                                 ip_ms->dp_key);
+        if (ip_ms->sync_groups) {
+            atomic_store(&ip_ms->groups_changed, false);
+        }
+    }
+
     const struct sbrec_igmp_group *sbrec_igmp;
 
     /* Then flush any IGMP_Group entries that are not needed anymore:
@@ -5138,7 +6122,7 @@ ip_mcast_sync(struct ovsdb_idl_txn *ovnsb_idl_txn,
             continue;
         }
 
-        struct ip_mcast_snoop *ip_ms = ip_mcast_snoop_find(dp_key);
+        ip_ms = ip_mcast_snoop_find(dp_key);
 
         /* If the datapath doesn't exist anymore or IGMP snooping was disabled
          * on it then delete the IGMP_Group entry.
@@ -5148,6 +6132,10 @@ ip_mcast_sync(struct ovsdb_idl_txn *ovnsb_idl_txn,
             continue;
         }
 
+        if (!ip_ms->sync_groups) {
+            continue;
+        }
+
         if (ip_parse(sbrec_igmp->address, &group_v4_addr)) {
             group_addr = in6_addr_mapped_ipv4(group_v4_addr);
         } else if (!ipv6_parse(sbrec_igmp->address, &group_addr)) {
@@ -5164,25 +6152,18 @@ ip_mcast_sync(struct ovsdb_idl_txn *ovnsb_idl_txn,
         ovs_rwlock_unlock(&ip_ms->ms->rwlock);
     }
 
-    struct ip_mcast_snoop *ip_ms;
-
     /* Last: write new IGMP_Groups to the southbound DB and update existing
-     * ones (if needed). We also flush any old per-datapath multicast snoop
-     * structures.
+     * ones (if needed).
      */
-    HMAP_FOR_EACH_SAFE (ip_ms, hmap_node, &mcast_snoop_map) {
-        /* Flush any non-local snooping datapaths (e.g., stale). */
-        struct local_datapath *local_dp =
-            get_local_datapath(local_datapaths, ip_ms->dp_key);
-
-        if (!local_dp) {
+    HMAP_FOR_EACH (ip_ms, hmap_node, &mcast_snoop_map) {
+        /* Skip non-local datapaths, datapaths on which snooping is disabled,
+         * and the ones that didn't change. */
+        if (!ip_ms->sync_groups || !ip_ms->cfg.enabled) {
             continue;
         }
 
-        /* Skip datapaths on which snooping is disabled. */
-        if (!ip_ms->cfg.enabled) {
-            continue;
-        }
+        struct local_datapath *local_dp =
+            get_local_datapath(local_datapaths, ip_ms->dp_key);
 
         struct mcast_group *mc_group;
 
@@ -5342,23 +6323,26 @@ pinctrl_ip_mcast_handle(struct rconn *swconn OVS_UNUSED,
     uint32_t port_key = md->flow.regs[MFF_LOG_INPORT - MFF_REG0];
     void *port_key_data = (void *)(uintptr_t)port_key;
 
+    bool group_change;
+
     switch (dl_type) {
     case ETH_TYPE_IP:
-        if (pinctrl_ip_mcast_handle_igmp(ip_ms, ip_flow, pkt_in,
-                                         port_key_data)) {
-            notify_pinctrl_main();
-        }
+        group_change = pinctrl_ip_mcast_handle_igmp(ip_ms, ip_flow, pkt_in,
+                                                    port_key_data);
         break;
     case ETH_TYPE_IPV6:
-        if (pinctrl_ip_mcast_handle_mld(ip_ms, ip_flow, pkt_in,
-                                        port_key_data)) {
-            notify_pinctrl_main();
-        }
+        group_change = pinctrl_ip_mcast_handle_mld(ip_ms, ip_flow, pkt_in,
+                                                   port_key_data);
         break;
     default:
         OVS_NOT_REACHED();
         break;
     }
+
+    if (group_change) {
+        atomic_store(&ip_ms->groups_changed, true);
+        notify_pinctrl_main();
+    }
 }
 
 static void
@@ -5483,19 +6467,24 @@ ip_mcast_querier_run(struct rconn *swconn, long long int *query_time)
         return;
     }
 
-    /* Send multicast queries and update the next query time. */
+    /* Send the multicast queries that are due and update their next query
+     * time. */
     long long int current_time = time_msec();
-    *query_time = LLONG_MAX;
-
-    struct ip_mcast_snoop *ip_ms;
+    struct pinctrl_timer *timer;
 
-    LIST_FOR_EACH (ip_ms, query_node, &mcast_query_list) {
+    while ((timer = pinctrl_timers_pop_due(&mcast_query_timers,
+                                           current_time))) {
+        struct ip_mcast_snoop *ip_ms =
+            CONTAINER_OF(timer, struct ip_mcast_snoop, query_timer);
         long long int next_query_time =
             ip_mcast_querier_send(swconn, ip_ms, current_time);
-        if (*query_time > next_query_time) {
-            *query_time = next_query_time;
-        }
+
+        /* Don't send more than one query per wakeup, even with a 0s query
+         * interval. */
+        pinctrl_timer_schedule(&mcast_query_timers, &ip_ms->query_timer,
+                               MAX(next_query_time, current_time + 1));
     }
+    *query_time = pinctrl_timers_next(&mcast_query_timers);
 }
 
 static void
@@ -5732,7 +6721,7 @@ send_garp_rarp_wait(long long int send_garp_rarp_time)
 {
     /* Set the poll timer for next garp/rarp only if there is data to
      * be sent. */
-    if (!shash_is_empty(&send_garp_rarp_data)) {
+    if (send_garp_rarp_time != LLONG_MAX) {
         poll_timer_wait_until(send_garp_rarp_time);
     }
 }
@@ -5742,21 +6731,20 @@ static void
 send_garp_rarp_run(struct rconn *swconn, long long int *send_garp_rarp_time)
     OVS_REQUIRES(pinctrl_mutex)
 {
-    if (shash_is_empty(&send_garp_rarp_data)) {
-        return;
-    }
-
-    /* Send GARPs, and update the next announcement. */
-    struct shash_node *iter;
+    /* Send the GARPs that are due, and update their next announcement.
+     * Entries that are done announcing are not rescheduled. */
     long long int current_time = time_msec();
-    *send_garp_rarp_time = LLONG_MAX;
-    SHASH_FOR_EACH (iter, &send_garp_rarp_data) {
-        long long int next_announce = send_garp_rarp(swconn, iter->data,
-                                                     current_time);
-        if (*send_garp_rarp_time > next_announce) {
-            *send_garp_rarp_time = next_announce;
-        }
+    struct pinctrl_timer *timer;
+
+    while ((timer = pinctrl_timers_pop_due(&send_garp_rarp_timers,
+                                           current_time))) {
+        struct garp_rarp_data *garp_rarp
+            = CONTAINER_OF(timer, struct garp_rarp_data, timer);
+        pinctrl_timer_schedule(&send_garp_rarp_timers, &garp_rarp->timer,
+                               send_garp_rarp(swconn, garp_rarp,
+                                              current_time));
     }
+    *send_garp_rarp_time = pinctrl_timers_next(&send_garp_rarp_timers);
 }
 
 /* Called by pinctrl_run(). Runs with in the main ovn-controller
@@ -6388,6 +7376,7 @@ enum svc_monitor_protocol {
 struct svc_monitor {
     struct hmap_node hmap_node;
     struct ovs_list list_node;
+    struct pinctrl_timer timer; /* In 'svc_monitor_timers'. */
 
     /* Should be accessed only with in the main ovn-controller
      * thread. */
@@ -6438,11 +7427,22 @@ struct svc_monitor {
 static struct hmap svc_monitors_map;
 static struct ovs_list svc_monitors;
 
+/* The service monitors ordered on the next time their state machine needs
+ * to run, see svc_monitors_run(). */
+static struct heap svc_monitor_timers;
+
 static void
 init_svc_monitors(void)
 {
     hmap_init(&svc_monitors_map);
     ovs_list_init(&svc_monitors);
+    heap_init(&svc_monitor_timers);
+}
+
+static void
+svc_monitor_schedule(struct svc_monitor *svc_mon, long long int deadline)
+{
+    pinctrl_timer_schedule(&svc_monitor_timers, &svc_mon->timer, deadline);
 }
 
 static void
@@ -6459,6 +7459,7 @@ destroy_svc_monitors(void)
         smap_destroy(&svc->options);
         free(svc);
     }
+    heap_destroy(&svc_monitor_timers);
 }
 
 
@@ -6587,6 +7588,8 @@ sync_svc_monitors(struct ovsdb_idl_txn *ovnsb_idl_txn,
 
             hmap_insert(&svc_monitors_map, &svc_mon->hmap_node, hash);
             ovs_list_push_back(&svc_monitors, &svc_mon->list_node);
+            pinctrl_timer_init(&svc_mon->timer);
+            svc_monitor_schedule(svc_mon, time_msec());
             changed = true;
         }
 
@@ -6603,6 +7606,8 @@ sync_svc_monitors(struct ovsdb_idl_txn *ovnsb_idl_txn,
                 smap_get_int(&svc_mon->options, "success_count", 1);
             svc_mon->failure_count =
                 smap_get_int(&svc_mon->options, "failure_count", 1);
+            /* Re-evaluate the state with the new thresholds. */
+            svc_monitor_schedule(svc_mon, time_msec());
             changed = true;
         }
 
@@ -6613,18 +7618,19 @@ sync_svc_monitors(struct ovsdb_idl_txn *ovnsb_idl_txn,
         if (svc_mon->delete) {
             hmap_remove(&svc_monitors_map, &svc_mon->hmap_node);
             ovs_list_remove(&svc_mon->list_node);
+            pinctrl_timer_cancel(&svc_monitor_timers, &svc_mon->timer);
             smap_destroy(&svc_mon->options);
             free(svc_mon);
             changed = true;
         } else if (ovnsb_idl_txn) {
-            /* Update the status of the service monitor. */
+            /* Update the status of the service monitor, if it changed. */
             if (svc_mon->status != SVC_MON_ST_UNKNOWN) {
-                if (svc_mon->status == SVC_MON_ST_ONLINE) {
-                    sbrec_service_monitor_set_status(svc_mon->sb_svc_mon,
-                                                     "online");
-                } else {
+                const char *status = svc_mon->status == SVC_MON_ST_ONLINE
+                                     ? "online" : "offline";
+                if (!svc_mon->sb_svc_mon->status
+                    || strcmp(svc_mon->sb_svc_mon->status, status)) {
                     sbrec_service_monitor_set_status(svc_mon->sb_svc_mon,
-                                                     "offline");
+                                                     status);
                 }
             }
         }
@@ -6680,6 +7686,7 @@ static long long bfd_last_update;
 
 struct bfd_entry {
     struct hmap_node node;
+    struct pinctrl_timer timer; /* In 'bfd_monitor_timers'. */
     bool erase;
 
     /* L2 source address */
@@ -6716,12 +7723,24 @@ struct bfd_entry {
     uint32_t detection_timeout;
     long long int last_rx;
     long long int next_tx;
+
+    /* Statistics, see pinctrl_bfd_get_stats(). */
+    uint64_t n_tx;
+    uint64_t n_rx;
+    uint64_t n_sched_tx;            /* Scheduled transmissions. */
+    long long int tx_jitter_total;  /* Sum of the delays of 'n_sched_tx'. */
+    long long int tx_jitter_max;    /* Largest delay of 'n_sched_tx'. */
 };
 
+/* The 'bfd_monitor_map' entries ordered on the next time they need to send
+ * a control packet or check their detection timeout. */
+static struct heap bfd_monitor_timers;
+
 static void
 bfd_monitor_init(void)
 {
     hmap_init(&bfd_monitor_map);
+    heap_init(&bfd_monitor_timers);
     bfd_last_update = time_msec();
 }
 
@@ -6733,6 +7752,43 @@ bfd_monitor_destroy(void)
         free(entry);
     }
     hmap_destroy(&bfd_monitor_map);
+    heap_destroy(&bfd_monitor_timers);
+}
+
+static bool
+bfd_entry_should_tx(const struct bfd_entry *entry)
+{
+    return (entry->remote_min_rx
+            && entry->state != BFD_STATE_ADMIN_DOWN
+            && !entry->remote_demand_mode);
+}
+
+/* Returns the next time 'entry' needs to be looked at: either its next
+ * transmission or the expiration of its detection timeout. */
+static long long int
+bfd_entry_next_deadline(const struct bfd_entry *entry)
+{
+    long long int deadline = LLONG_MAX;
+
+    if (bfd_entry_should_tx(entry)) {
+        deadline = entry->next_tx;
+    }
+    if (entry->detection_timeout
+        && entry->state != BFD_STATE_ADMIN_DOWN
+        && entry->state != BFD_STATE_DOWN) {
+        deadline = MIN(deadline,
+                       entry->last_rx + entry->detection_timeout);
+    }
+    return deadline;
+}
+
+/* Must be called whenever one of the fields bfd_entry_next_deadline() looks
+ * at changes. */
+static void
+bfd_entry_schedule(struct bfd_entry *entry)
+{
+    pinctrl_timer_schedule(&bfd_monitor_timers, &entry->timer,
+                           bfd_entry_next_deadline(entry));
 }
 
 static struct bfd_entry *
@@ -6766,21 +7822,17 @@ pinctrl_find_bfd_monitor_entry_by_disc(char *ip, ovs_be32 disc)
 static bool
 bfd_monitor_should_inject(void)
 {
-    long long int cur_time = time_msec();
-    struct bfd_entry *entry;
-
-    HMAP_FOR_EACH (entry, node, &bfd_monitor_map) {
-        if (entry->next_tx < cur_time) {
-            return true;
-        }
-    }
-    return false;
+    return pinctrl_timers_next(&bfd_monitor_timers) <= time_msec();
 }
 
 static void
-bfd_monitor_wait(long long int timeout)
+bfd_monitor_wait(void)
 {
-    if (!hmap_is_empty(&bfd_monitor_map)) {
+    ovs_mutex_lock(&pinctrl_mutex);
+    long long int timeout = pinctrl_timers_next(&bfd_monitor_timers);
+    ovs_mutex_unlock(&pinctrl_mutex);
+
+    if (timeout != LLONG_MAX) {
         poll_timer_wait_until(timeout);
     }
 }
@@ -6868,6 +7920,7 @@ pinctrl_send_bfd_tx_msg(struct rconn *swconn, struct bfd_entry *entry,
     queue_msg(swconn, ofputil_encode_packet_out(&po, proto));
     dp_packet_uninit(&packet);
     ofpbuf_uninit(&ofpacts);
+    entry->n_tx++;
 }
 
 
@@ -6917,46 +7970,37 @@ bfd_check_detection_timeout(struct bfd_entry *entry)
 }
 
 static void
-bfd_monitor_send_msg(struct rconn *swconn, long long int *bfd_time)
+bfd_monitor_send_msg(struct rconn *swconn)
     OVS_REQUIRES(pinctrl_mutex)
 {
     long long int cur_time = time_msec();
-    struct bfd_entry *entry;
+    struct pinctrl_timer *timer;
 
     if (bfd_monitor_need_update()) {
         notify_pinctrl_main();
     }
 
-    HMAP_FOR_EACH (entry, node, &bfd_monitor_map) {
-        unsigned long tx_timeout;
-
-        bfd_check_detection_timeout(entry);
-
-        if (cur_time < entry->next_tx) {
-            goto next;
-        }
-
-        if (!entry->remote_min_rx) {
-            continue;
-        }
+    while ((timer = pinctrl_timers_pop_due(&bfd_monitor_timers, cur_time))) {
+        struct bfd_entry *entry = CONTAINER_OF(timer, struct bfd_entry,
+                                               timer);
 
-        if (entry->state == BFD_STATE_ADMIN_DOWN) {
-            continue;
-        }
+        bfd_check_detection_timeout(entry);
 
-        if (entry->remote_demand_mode) {
-            continue;
-        }
+        if (bfd_entry_should_tx(entry) && cur_time >= entry->next_tx) {
+            long long int delay = cur_time - entry->next_tx;
+            unsigned long tx_timeout;
+
+            pinctrl_send_bfd_tx_msg(swconn, entry, false);
 
-        pinctrl_send_bfd_tx_msg(swconn, entry, false);
+            entry->n_sched_tx++;
+            entry->tx_jitter_total += delay;
+            entry->tx_jitter_max = MAX(entry->tx_jitter_max, delay);
 
-        tx_timeout = MAX(entry->local_min_tx, entry->remote_min_rx);
-        tx_timeout -= random_range((tx_timeout * 25) / 100);
-        entry->next_tx = cur_time + tx_timeout;
-next:
-        if (*bfd_time > entry->next_tx) {
-            *bfd_time = entry->next_tx;
+            tx_timeout = MAX(entry->local_min_tx, entry->remote_min_rx);
+            tx_timeout -= random_range((tx_timeout * 25) / 100);
+            entry->next_tx = cur_time + tx_timeout;
         }
+        bfd_entry_schedule(entry);
     }
 }
 
@@ -7060,6 +8104,7 @@ pinctrl_handle_bfd_msg(struct rconn *swconn, const struct flow *ip_flow,
     }
 
     bool change_state = false;
+    entry->n_rx++;
     entry->remote_disc = msg->my_disc;
     uint32_t remote_min_tx = ntohl(msg->min_tx) / 1000;
     entry->remote_min_rx = ntohl(msg->min_rx) / 1000;
@@ -7130,6 +8175,8 @@ pinctrl_handle_bfd_msg(struct rconn *swconn, const struct flow *ip_flow,
     }
 
 out:
+    bfd_entry_schedule(entry);
+
     /* let's try to bacth db updates */
     if (change_state) {
         entry->change_state = true;
@@ -7281,6 +8328,7 @@ bfd_monitor_run(struct ovsdb_idl_txn *ovnsb_idl_txn,
 
             uint32_t hash = hash_string(bt->dst_ip, 0);
             hmap_insert(&bfd_monitor_map, &entry->node, hash);
+            pinctrl_timer_init(&entry->timer);
         } else if (!strcmp(bt->status, "admin_down") &&
                    entry->state != BFD_STATE_ADMIN_DOWN) {
             entry->state = BFD_STATE_ADMIN_DOWN;
@@ -7300,11 +8348,13 @@ bfd_monitor_run(struct ovsdb_idl_txn *ovnsb_idl_txn,
             entry->change_state = false;
         }
         bfd_monitor_check_sb_conf(bt, entry);
+        bfd_entry_schedule(entry);
         entry->erase = false;
     }
 
     HMAP_FOR_EACH_SAFE (entry, node, &bfd_monitor_map) {
         if (entry->erase) {
+            pinctrl_timer_cancel(&bfd_monitor_timers, &entry->timer);
             hmap_remove(&bfd_monitor_map, &entry->node);
             free(entry);
         }
@@ -7315,6 +8365,29 @@ bfd_monitor_run(struct ovsdb_idl_txn *ovnsb_idl_txn,
     }
 }
 
+/* Appends the statistics of each BFD session to 'ds'. */
+void
+pinctrl_bfd_get_stats(struct ds *ds)
+{
+    struct bfd_entry *entry;
+
+    ovs_mutex_lock(&pinctrl_mutex);
+    HMAP_FOR_EACH (entry, node, &bfd_monitor_map) {
+        ds_put_cstr(ds, "dst_ip: ");
+        ipv6_format_mapped(&entry->ip_dst, ds);
+        ds_put_format(ds, ", src_port: %"PRIu16", state: %s\n",
+                      entry->udp_src, bfd_get_status(entry->state));
+        ds_put_format(ds, "  tx packets: %"PRIu64", rx packets: %"PRIu64"\n",
+                      entry->n_tx, entry->n_rx);
+        long long int avg = entry->n_sched_tx
+                            ? entry->tx_jitter_total / entry->n_sched_tx
+                            : 0;
+        ds_put_format(ds, "  tx jitter (ms): avg %lld, max %lld\n",
+                      avg, entry->tx_jitter_max);
+    }
+    ovs_mutex_unlock(&pinctrl_mutex);
+}
+
 static uint16_t
 get_random_src_port(void)
 {
@@ -7466,92 +8539,108 @@ svc_monitor_send_health_check(struct rconn *swconn,
 
     svc_mon->wait_time = time_msec() + svc_mon->svc_timeout;
     svc_mon->state = SVC_MON_S_WAITING;
+    COVERAGE_INC(pinctrl_svc_monitor_probes);
 }
 
-static void
-svc_monitors_run(struct rconn *swconn,
-                 long long int *svc_monitors_next_run_time)
+/* Runs the state machine of 'svc_mon' and returns the next time it needs
+ * to run. */
+static long long int
+svc_monitor_run(struct rconn *swconn, struct svc_monitor *svc_mon,
+                long long int current_time)
     OVS_REQUIRES(pinctrl_mutex)
 {
-    *svc_monitors_next_run_time = LLONG_MAX;
-    struct svc_monitor *svc_mon;
-    LIST_FOR_EACH (svc_mon, list_node, &svc_monitors) {
-        char ip_[INET6_ADDRSTRLEN + 1];
-        memset(ip_, 0, INET6_ADDRSTRLEN + 1);
-        ipv6_string_mapped(ip_, &svc_mon->ip);
-
-        long long int current_time = time_msec();
-        long long int next_run_time = LLONG_MAX;
-        enum svc_monitor_status old_status = svc_mon->status;
-        switch (svc_mon->state) {
-        case SVC_MON_S_INIT:
-            svc_monitor_send_health_check(swconn, svc_mon);
-            next_run_time = svc_mon->wait_time;
-            break;
-
-        case SVC_MON_S_WAITING:
-            if (current_time > svc_mon->wait_time) {
-                if (svc_mon->protocol ==  SVC_MON_PROTO_TCP) {
-                    svc_mon->n_failures++;
-                    svc_mon->state = SVC_MON_S_OFFLINE;
-                } else {
-                    svc_mon->n_success++;
-                    svc_mon->state = SVC_MON_S_ONLINE;
-                }
-                svc_mon->next_send_time = current_time + svc_mon->interval;
-                next_run_time = svc_mon->next_send_time;
-            } else {
-                next_run_time = svc_mon->wait_time - current_time;
-                next_run_time = svc_mon->wait_time;
-            }
-            break;
-
-        case SVC_MON_S_ONLINE:
-            if (svc_mon->n_success >= svc_mon->success_count) {
-                svc_mon->status = SVC_MON_ST_ONLINE;
-                svc_mon->n_success = 0;
-            }
-            if (current_time >= svc_mon->next_send_time) {
-                svc_monitor_send_health_check(swconn, svc_mon);
-                next_run_time = svc_mon->wait_time;
-            } else {
-                next_run_time = svc_mon->next_send_time;
-            }
-            break;
-
-        case SVC_MON_S_OFFLINE:
-            if (svc_mon->n_failures >= svc_mon->failure_count) {
-                svc_mon->status = SVC_MON_ST_OFFLINE;
-                svc_mon->n_failures = 0;
-            }
+    long long int next_run_time = LLONG_MAX;
+    enum svc_monitor_status old_status = svc_mon->status;
+    switch (svc_mon->state) {
+    case SVC_MON_S_INIT:
+        svc_monitor_send_health_check(swconn, svc_mon);
+        next_run_time = svc_mon->wait_time;
+        break;
 
-            if (current_time >= svc_mon->next_send_time) {
-                svc_monitor_send_health_check(swconn, svc_mon);
-                next_run_time = svc_mon->wait_time;
+    case SVC_MON_S_WAITING:
+        if (current_time > svc_mon->wait_time) {
+            COVERAGE_INC(pinctrl_svc_monitor_timeouts);
+            if (svc_mon->protocol ==  SVC_MON_PROTO_TCP) {
+                svc_mon->n_failures++;
+                svc_mon->state = SVC_MON_S_OFFLINE;
             } else {
-                next_run_time = svc_mon->next_send_time;
+                svc_mon->n_success++;
+                svc_mon->state = SVC_MON_S_ONLINE;
             }
-            break;
+            svc_mon->next_send_time = current_time + svc_mon->interval;
+            /* Let the new state thresholds be checked right away. */
+            next_run_time = current_time;
+        } else {
+            /* The timeout is only detected strictly after 'wait_time'. */
+            next_run_time = svc_mon->wait_time + 1;
+        }
+        break;
 
-        default:
-            OVS_NOT_REACHED();
+    case SVC_MON_S_ONLINE:
+        if (svc_mon->n_success >= svc_mon->success_count) {
+            svc_mon->status = SVC_MON_ST_ONLINE;
+            svc_mon->n_success = 0;
+        }
+        if (current_time >= svc_mon->next_send_time) {
+            svc_monitor_send_health_check(swconn, svc_mon);
+            next_run_time = svc_mon->wait_time;
+        } else {
+            next_run_time = svc_mon->next_send_time;
         }
+        break;
 
-        if (*svc_monitors_next_run_time > next_run_time) {
-            *svc_monitors_next_run_time = next_run_time;
+    case SVC_MON_S_OFFLINE:
+        if (svc_mon->n_failures >= svc_mon->failure_count) {
+            svc_mon->status = SVC_MON_ST_OFFLINE;
+            svc_mon->n_failures = 0;
         }
 
-        if (old_status != svc_mon->status) {
-            /* Notify the main thread to update the status in the SB DB. */
-            notify_pinctrl_main();
+        if (current_time >= svc_mon->next_send_time) {
+            svc_monitor_send_health_check(swconn, svc_mon);
+            next_run_time = svc_mon->wait_time;
+        } else {
+            next_run_time = svc_mon->next_send_time;
         }
+        break;
+
+    default:
+        OVS_NOT_REACHED();
+    }
+
+    if (old_status != svc_mon->status) {
+        COVERAGE_INC(pinctrl_svc_monitor_state_changes);
+        /* Notify the main thread to update the status in the SB DB. */
+        notify_pinctrl_main();
+    }
+
+    return next_run_time;
+}
+
+/* Runs the service monitors that are due.  The health checks they send are
+ * batched together with the other packets sent by this pinctrl_handler
+ * iteration, see tx_batch_start(). */
+static void
+svc_monitors_run(struct rconn *swconn,
+                 long long int *svc_monitors_next_run_time)
+    OVS_REQUIRES(pinctrl_mutex)
+{
+    long long int current_time = time_msec();
+    struct pinctrl_timer *timer;
+
+    while ((timer = pinctrl_timers_pop_due(&svc_monitor_timers,
+                                           current_time))) {
+        struct svc_monitor *svc_mon = CONTAINER_OF(timer, struct svc_monitor,
+                                                   timer);
+        svc_monitor_schedule(svc_mon,
+                             svc_monitor_run(swconn, svc_mon, current_time));
     }
+    *svc_monitors_next_run_time = pinctrl_timers_next(&svc_monitor_timers);
 }
 
 static void
 svc_monitors_wait(long long int svc_monitors_next_run_time)
 {
-    if (!ovs_list_is_empty(&svc_monitors)) {
+    if (svc_monitors_next_run_time != LLONG_MAX) {
         poll_timer_wait_until(svc_monitors_next_run_time);
     }
 }
@@ -7590,6 +8679,7 @@ pinctrl_handle_tcp_svc_check(struct rconn *swconn,
                                             htonl(tcp_seq + 1), th->tcp_dst);
         /* Calculate next_send_time. */
         svc_mon->next_send_time = time_msec() + svc_mon->interval;
+        svc_monitor_schedule(svc_mon, time_msec());
         return true;
     }
 
@@ -7600,6 +8690,7 @@ pinctrl_handle_tcp_svc_check(struct rconn *swconn,
 
         /* Calculate next_send_time. */
         svc_mon->next_send_time = time_msec() + svc_mon->interval;
+        svc_monitor_schedule(svc_mon, time_msec());
         return false;
     }
 
@@ -7724,6 +8815,7 @@ pinctrl_handle_svc_check(struct rconn *swconn, const struct flow *ip_flow,
 
         /* Calculate next_send_time. */
         svc_mon->next_send_time = time_msec() + svc_mon->interval;
+        svc_monitor_schedule(svc_mon, time_msec());
     }
 }
 
@@ -7760,10 +8852,33 @@ fdb_lookup(struct ovsdb_idl_index *sbrec_fdb_by_dp_key_mac, uint32_t dp_key,
     return retval;
 }
 
+/* Returns the number of FDB entries of datapath 'dp_key', counting no
+ * further than 'max'. */
+static unsigned int
+fdbs_count(struct ovsdb_idl_index *sbrec_fdb_by_dp_key, uint32_t dp_key,
+           unsigned int max)
+{
+    struct sbrec_fdb *target = sbrec_fdb_index_init_row(sbrec_fdb_by_dp_key);
+    sbrec_fdb_index_set_dp_key(target, dp_key);
+
+    unsigned int n = 0;
+    const struct sbrec_fdb *fdb;
+    SBREC_FDB_FOR_EACH_EQUAL (fdb, target, sbrec_fdb_by_dp_key) {
+        if (++n >= max) {
+            break;
+        }
+    }
+    sbrec_fdb_index_destroy_row(target);
+
+    return n;
+}
+
 static void
 run_put_fdb(struct ovsdb_idl_txn *ovnsb_idl_txn,
             struct ovsdb_idl_index *sbrec_fdb_by_dp_key_mac,
+            struct ovsdb_idl_index *sbrec_fdb_by_dp_key,
             const struct fdb_entry *fdb_e)
+    OVS_REQUIRES(pinctrl_mutex)
 {
     /* Convert ethernet argument to string form for database. */
     char mac_string[ETH_ADDR_STRLEN + 1];
@@ -7774,6 +8889,16 @@ run_put_fdb(struct ovsdb_idl_txn *ovnsb_idl_txn,
     const struct sbrec_fdb *sb_fdb =
         fdb_lookup(sbrec_fdb_by_dp_key_mac, fdb_e->dp_key, mac_string);
     if (!sb_fdb) {
+        if (fdb_aging.max_per_dp
+            && fdbs_count(sbrec_fdb_by_dp_key, fdb_e->dp_key,
+                          fdb_aging.max_per_dp) >= fdb_aging.max_per_dp) {
+            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+            VLOG_WARN_RL(&rl, "not learning FDB entry %s, datapath %"PRIu32
+                         " already has %u of them", mac_string,
+                         fdb_e->dp_key, fdb_aging.max_per_dp);
+            COVERAGE_INC(pinctrl_limit_put_fdb);
+            return;
+        }
         sb_fdb = sbrec_fdb_insert(ovnsb_idl_txn);
         sbrec_fdb_set_dp_key(sb_fdb, fdb_e->dp_key);
         sbrec_fdb_set_mac(sb_fdb, mac_string);
@@ -7783,7 +8908,8 @@ run_put_fdb(struct ovsdb_idl_txn *ovnsb_idl_txn,
 
 static void
 run_put_fdbs(struct ovsdb_idl_txn *ovnsb_idl_txn,
-             struct ovsdb_idl_index *sbrec_fdb_by_dp_key_mac)
+             struct ovsdb_idl_index *sbrec_fdb_by_dp_key_mac,
+             struct ovsdb_idl_index *sbrec_fdb_by_dp_key)
              OVS_REQUIRES(pinctrl_mutex)
 {
     if (!ovnsb_idl_txn) {
@@ -7792,7 +8918,8 @@ run_put_fdbs(struct ovsdb_idl_txn *ovnsb_idl_txn,
 
     const struct fdb_entry *fdb_e;
     HMAP_FOR_EACH (fdb_e, hmap_node, &put_fdbs) {
-        run_put_fdb(ovnsb_idl_txn, sbrec_fdb_by_dp_key_mac, fdb_e);
+        run_put_fdb(ovnsb_idl_txn, sbrec_fdb_by_dp_key_mac,
+                    sbrec_fdb_by_dp_key, fdb_e);
     }
     ovn_fdbs_flush(&put_fdbs);
 }
@@ -7817,3 +8944,385 @@ pinctrl_handle_put_fdb(const struct flow *md, const struct flow *headers)
     ovn_fdb_add(&put_fdbs, dp_key, headers->dl_src, port_key);
     notify_pinctrl_main();
 }
+
+/* Aging of the learnt MAC_Bindings and FDB entries.  The flow statistics
+ * are collected in the pinctrl_handler thread and the idle entries are
+ * deleted from the SB by the main ovn-controller thread. */
+
+static void
+learnt_aging_init__(struct learnt_aging *aging)
+{
+    hmap_init(&aging->entries);
+    aging->idle_timeout = 0;
+    aging->max_per_dp = 0;
+    aging->round = 0;
+    aging->next_dump = LLONG_MAX;
+    aging->xid = 0;
+    aging->check_idle = false;
+}
+
+static void
+learnt_aging_clear(struct learnt_aging *aging)
+{
+    struct learnt_aging_entry *e;
+    HMAP_FOR_EACH_POP (e, hmap_node, &aging->entries) {
+        free(e);
+    }
+    aging->xid = 0;
+    aging->check_idle = false;
+}
+
+static void
+init_learnt_aging(void)
+    OVS_NO_THREAD_SAFETY_ANALYSIS
+{
+    learnt_aging_init__(&mac_binding_aging);
+    learnt_aging_init__(&fdb_aging);
+}
+
+static void
+destroy_learnt_aging(void)
+    OVS_NO_THREAD_SAFETY_ANALYSIS
+{
+    learnt_aging_clear(&mac_binding_aging);
+    hmap_destroy(&mac_binding_aging.entries);
+    learnt_aging_clear(&fdb_aging);
+    hmap_destroy(&fdb_aging.entries);
+}
+
+static struct learnt_aging_entry *
+learnt_aging_find(const struct learnt_aging *aging, uint32_t cookie)
+{
+    struct learnt_aging_entry *e;
+    HMAP_FOR_EACH_WITH_HASH (e, hmap_node, hash_int(cookie, 0),
+                             &aging->entries) {
+        if (e->cookie == cookie) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void
+learnt_aging_set(struct learnt_aging *aging, unsigned int idle_timeout,
+                 unsigned int max_per_dp)
+    OVS_REQUIRES(pinctrl_mutex)
+{
+    idle_timeout = MIN(idle_timeout, UINT_MAX / 1000) * 1000;
+    if (aging->idle_timeout != idle_timeout) {
+        learnt_aging_clear(aging);
+        aging->idle_timeout = idle_timeout;
+        aging->next_dump = idle_timeout ? time_msec() : LLONG_MAX;
+        notify_pinctrl_handler();
+    }
+    aging->max_per_dp = max_per_dp;
+}
+
+/* Deletes the MAC_Bindings that were not used for 'idle_timeout' seconds,
+ * 0 disables it, and limits the number of MAC_Bindings learnt per datapath
+ * to 'max_per_dp', 0 means no limit. */
+void
+pinctrl_set_mac_binding_limits(unsigned int idle_timeout,
+                               unsigned int max_per_dp)
+{
+    ovs_mutex_lock(&pinctrl_mutex);
+    learnt_aging_set(&mac_binding_aging, idle_timeout, max_per_dp);
+    ovs_mutex_unlock(&pinctrl_mutex);
+}
+
+/* Same as pinctrl_set_mac_binding_limits() for the FDB entries. */
+void
+pinctrl_set_fdb_limits(unsigned int idle_timeout, unsigned int max_per_dp)
+{
+    ovs_mutex_lock(&pinctrl_mutex);
+    learnt_aging_set(&fdb_aging, idle_timeout, max_per_dp);
+    ovs_mutex_unlock(&pinctrl_mutex);
+}
+
+/* Called with in the pinctrl_handler thread context. */
+static void
+learnt_aging_send_dump(struct rconn *swconn, struct learnt_aging *aging,
+                       long long int now)
+    OVS_REQUIRES(pinctrl_mutex)
+{
+    if (now < aging->next_dump) {
+        return;
+    }
+
+    /* Dumping more often than the idle timeout bounds how late an entry
+     * gets aged to a fraction of the timeout. */
+    aging->next_dump = now + MAX(aging->idle_timeout / 2, 1000);
+
+    struct ofputil_flow_stats_request fsr = {
+        .out_port = OFPP_ANY,
+        .out_group = OFPG_ANY,
+        .table_id = aging->table_id,
+    };
+    enum ofputil_protocol proto =
+        ofputil_protocol_from_ofp_version(rconn_get_version(swconn));
+    aging->xid = queue_msg(swconn,
+                           ofputil_encode_flow_stats_request(&fsr, proto));
+    aging->round++;
+}
+
+/* Called with in the pinctrl_handler thread context. */
+static void
+learnt_aging_run(struct rconn *swconn, long long int *aging_next_run_time)
+    OVS_REQUIRES(pinctrl_mutex)
+{
+    long long int now = time_msec();
+
+    learnt_aging_send_dump(swconn, &mac_binding_aging, now);
+    learnt_aging_send_dump(swconn, &fdb_aging, now);
+    *aging_next_run_time = MIN(mac_binding_aging.next_dump,
+                               fdb_aging.next_dump);
+}
+
+static void
+learnt_aging_wait(long long int aging_next_run_time)
+{
+    if (aging_next_run_time != LLONG_MAX) {
+        poll_timer_wait_until(aging_next_run_time);
+    }
+}
+
+/* Marks the entries whose flows did not match any packet for the idle
+ * timeout as idle, and forgets the ones whose flows are gone, once 'aging'
+ * has received a whole dump. */
+static void
+learnt_aging_sweep(struct learnt_aging *aging, long long int now)
+    OVS_REQUIRES(pinctrl_mutex)
+{
+    struct learnt_aging_entry *e;
+    HMAP_FOR_EACH_SAFE (e, hmap_node, &aging->entries) {
+        if (e->round != aging->round) {
+            hmap_remove(&aging->entries, &e->hmap_node);
+            free(e);
+            continue;
+        }
+
+        if (e->dump_packets != e->n_packets) {
+            e->n_packets = e->dump_packets;
+            e->last_used = now;
+            e->idle = false;
+        } else if (now - e->last_used >= aging->idle_timeout) {
+            e->idle = true;
+            aging->check_idle = true;
+        }
+    }
+
+    if (aging->check_idle) {
+        notify_pinctrl_main();
+    }
+}
+
+/* Called with in the pinctrl_handler thread context. */
+static void
+learnt_aging_handle_stats_reply(const struct ofp_header *oh)
+{
+    ovs_mutex_lock(&pinctrl_mutex);
+
+    struct learnt_aging *aging;
+    if (mac_binding_aging.xid && oh->xid == mac_binding_aging.xid) {
+        aging = &mac_binding_aging;
+    } else if (fdb_aging.xid && oh->xid == fdb_aging.xid) {
+        aging = &fdb_aging;
+    } else {
+        /* A reply to a dump request that was superseded. */
+        ovs_mutex_unlock(&pinctrl_mutex);
+        return;
+    }
+
+    long long int now = time_msec();
+    struct ofpbuf msg = ofpbuf_const_initializer(oh, ntohs(oh->length));
+    uint64_t ofpacts_stub[1024 / 8];
+    struct ofpbuf ofpacts = OFPBUF_STUB_INITIALIZER(ofpacts_stub);
+    for (;;) {
+        struct ofputil_flow_stats fs;
+        int error = ofputil_decode_flow_stats_reply(&fs, &msg, false,
+                                                    &ofpacts);
+        if (error) {
+            if (error != EOF) {
+                static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+                VLOG_WARN_RL(&rl, "failed to decode %s flow stats (%s)",
+                             aging->name, ofperr_to_string(error));
+                aging->xid = 0;
+            }
+            break;
+        }
+
+        /* The cookie is the first 32 bits of the SB uuid. */
+        uint32_t cookie = ntohll(fs.cookie);
+        struct learnt_aging_entry *e = learnt_aging_find(aging, cookie);
+        if (!e) {
+            e = xzalloc(sizeof *e);
+            e->cookie = cookie;
+            e->last_used = now;
+            hmap_insert(&aging->entries, &e->hmap_node, hash_int(cookie, 0));
+        }
+
+        /* Several flows may share a cookie, e.g. one per Static_MAC_Binding
+         * and MAC_Binding of the same IP, so their counts add up. */
+        if (e->round != aging->round) {
+            e->round = aging->round;
+            e->dump_packets = 0;
+        }
+        e->dump_packets += fs.packet_count;
+        ofpbuf_clear(&ofpacts);
+    }
+    ofpbuf_uninit(&ofpacts);
+
+    if (aging->xid && !ofpmp_more(oh)) {
+        aging->xid = 0;
+        learnt_aging_sweep(aging, now);
+    }
+
+    ovs_mutex_unlock(&pinctrl_mutex);
+}
+
+static bool
+learnt_aging_is_idle(const struct learnt_aging *aging,
+                     const struct uuid *uuid)
+    OVS_REQUIRES(pinctrl_mutex)
+{
+    const struct learnt_aging_entry *e =
+        learnt_aging_find(aging, uuid->parts[0]);
+    return e && e->idle;
+}
+
+/* Only the chassis that learns on 'pb' ages the entries learnt on it,
+ * i.e. the chassis that 'pb' or its chassisredirect port is bound to.  The
+ * other chassis do not see the traffic that keeps these entries in use. */
+static bool
+learnt_port_is_local(struct ovsdb_idl_index *sbrec_port_binding_by_name,
+                     const struct sbrec_port_binding *pb,
+                     const struct sbrec_chassis *chassis,
+                     const struct sset *active_tunnels)
+{
+    if (lport_is_chassis_resident(sbrec_port_binding_by_name, chassis,
+                                  active_tunnels, pb->logical_port)) {
+        return true;
+    }
+
+    char *redirect_name = xasprintf("cr-%s", pb->logical_port);
+    bool resident = lport_is_chassis_resident(sbrec_port_binding_by_name,
+                                              chassis, active_tunnels,
+                                              redirect_name);
+    free(redirect_name);
+    return resident;
+}
+
+/* Deletes the idle MAC_Bindings and FDB entries from the SB.  Called with
+ * in the main ovn-controller thread context. */
+static void
+run_learnt_aging(struct ovsdb_idl_txn *ovnsb_idl_txn,
+                 struct ovsdb_idl_index *sbrec_datapath_binding_by_key,
+                 struct ovsdb_idl_index *sbrec_port_binding_by_key,
+                 struct ovsdb_idl_index *sbrec_port_binding_by_name,
+                 const struct sbrec_mac_binding_table *mac_binding_table,
+                 const struct sbrec_fdb_table *fdb_table,
+                 const struct sbrec_chassis *chassis,
+                 const struct sset *active_tunnels)
+    OVS_REQUIRES(pinctrl_mutex)
+{
+    if (!ovnsb_idl_txn || !chassis) {
+        return;
+    }
+
+    if (mac_binding_aging.check_idle) {
+        mac_binding_aging.check_idle = false;
+
+        const struct sbrec_mac_binding *b;
+        SBREC_MAC_BINDING_TABLE_FOR_EACH_SAFE (b, mac_binding_table) {
+            if (!learnt_aging_is_idle(&mac_binding_aging, &b->header_.uuid)) {
+                continue;
+            }
+
+            const struct sbrec_port_binding *pb =
+                lport_lookup_by_name(sbrec_port_binding_by_name,
+                                     b->logical_port);
+            if (pb && learnt_port_is_local(sbrec_port_binding_by_name, pb,
+                                           chassis, active_tunnels)) {
+                VLOG_DBG("aging out idle MAC_Binding %s %s on port %s",
+                         b->ip, b->mac, b->logical_port);
+                sbrec_mac_binding_delete(b);
+                COVERAGE_INC(pinctrl_age_mac_binding);
+            }
+        }
+    }
+
+    if (fdb_aging.check_idle) {
+        fdb_aging.check_idle = false;
+
+        const struct sbrec_fdb *fdb;
+        SBREC_FDB_TABLE_FOR_EACH_SAFE (fdb, fdb_table) {
+            if (!learnt_aging_is_idle(&fdb_aging, &fdb->header_.uuid)) {
+                continue;
+            }
+
+            const struct sbrec_port_binding *pb =
+                lport_lookup_by_key(sbrec_datapath_binding_by_key,
+                                    sbrec_port_binding_by_key,
+                                    fdb->dp_key, fdb->port_key);
+            if (pb && learnt_port_is_local(sbrec_port_binding_by_name, pb,
+                                           chassis, active_tunnels)) {
+                VLOG_DBG("aging out idle FDB entry %s on port %s",
+                         fdb->mac, pb->logical_port);
+                sbrec_fdb_delete(fdb);
+                COVERAGE_INC(pinctrl_age_fdb);
+            }
+        }
+    }
+}
+
+/* Sets up the state that process_packet_in() needs without starting the
+ * pinctrl_handler() thread.  This is only meant for the tests and benchmarks
+ * of the packet-in handlers, see pinctrl_process_packet_in_for_test(). */
+void
+pinctrl_init_for_test(void)
+{
+    init_buffered_packets_map();
+}
+
+void
+pinctrl_destroy_for_test(void)
+{
+    destroy_buffered_packets_map();
+    destroy_dns_cache();
+}
+
+/* Adds the DNS 'records' of the DNS row 'dns_id' for the datapath with tunnel
+ * key 'dp_key', as sync_dns_cache() does for the rows of the Southbound
+ * database. */
+void
+pinctrl_add_dns_for_test(const char *dns_id, uint64_t dp_key,
+                         const struct smap *records)
+{
+    struct dns_data *d = xmalloc(sizeof *d);
+    smap_clone(&d->records, records);
+    d->dps = xmemdup(&dp_key, sizeof dp_key);
+    d->n_dps = 1;
+    d->delete = false;
+
+    shash_add(&dns_cache, dns_id, d);
+    dns_answers_rebuild();
+}
+
+/* Handles the packet-in 'msg' as the pinctrl_handler() thread does, except
+ * that the messages sent in reply are discarded instead of being handed over
+ * to 'swconn', which only needs to be connected to provide the OpenFlow
+ * version.  Returns the number of messages sent in reply. */
+size_t
+pinctrl_process_packet_in_for_test(struct rconn *swconn,
+                                   const struct ofp_header *msg)
+{
+    struct ovs_list batch;
+
+    tx_batch_start(&batch);
+    process_packet_in(swconn, msg);
+    *tx_batch_get() = NULL;
+
+    size_t n_replies = ovs_list_size(&batch);
+    ofpbuf_list_delete(&batch);
+    return n_replies;
+}
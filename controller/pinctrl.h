@@ -17,22 +17,29 @@
 #ifndef PINCTRL_H
 #define PINCTRL_H 1
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "lib/sset.h"
 #include "openvswitch/meta-flow.h"
 
+struct ds;
 struct hmap;
 struct shash;
 struct lport_index;
 struct ovsdb_idl_index;
 struct ovsdb_idl_txn;
+struct ofp_header;
 struct ovsrec_bridge;
+struct rconn;
 struct sbrec_chassis;
 struct sbrec_dns_table;
 struct sbrec_controller_event_table;
 struct sbrec_service_monitor_table;
 struct sbrec_bfd_table;
+struct sbrec_mac_binding_table;
+struct sbrec_fdb_table;
+struct smap;
 
 void pinctrl_init(void);
 void pinctrl_run(struct ovsdb_idl_txn *ovnsb_idl_txn,
@@ -41,9 +48,13 @@ void pinctrl_run(struct ovsdb_idl_txn *ovnsb_idl_txn,
                  struct ovsdb_idl_index *sbrec_port_binding_by_key,
                  struct ovsdb_idl_index *sbrec_port_binding_by_name,
                  struct ovsdb_idl_index *sbrec_mac_binding_by_lport_ip,
+                 struct ovsdb_idl_index *sbrec_mac_binding_by_datapath,
                  struct ovsdb_idl_index *sbrec_igmp_groups,
                  struct ovsdb_idl_index *sbrec_ip_multicast_opts,
                  struct ovsdb_idl_index *sbrec_fdb_by_dp_key_mac,
+                 struct ovsdb_idl_index *sbrec_fdb_by_dp_key,
+                 const struct sbrec_mac_binding_table *,
+                 const struct sbrec_fdb_table *,
                  const struct sbrec_dns_table *,
                  const struct sbrec_controller_event_table *,
                  const struct sbrec_service_monitor_table *,
@@ -56,4 +67,20 @@ void pinctrl_run(struct ovsdb_idl_txn *ovnsb_idl_txn,
 void pinctrl_wait(struct ovsdb_idl_txn *ovnsb_idl_txn);
 void pinctrl_destroy(void);
 void pinctrl_set_br_int_name(char *br_int_name);
+void pinctrl_set_n_threads(size_t n_threads);
+void pinctrl_bfd_get_stats(struct ds *);
+bool pinctrl_activate_lazy_datapaths(void);
+void pinctrl_set_mac_binding_rate_limit(unsigned int rate);
+void pinctrl_set_mac_binding_limits(unsigned int idle_timeout,
+                                    unsigned int max_per_dp);
+void pinctrl_set_fdb_limits(unsigned int idle_timeout,
+                            unsigned int max_per_dp);
+
+void pinctrl_init_for_test(void);
+void pinctrl_destroy_for_test(void);
+void pinctrl_add_dns_for_test(const char *dns_id, uint64_t dp_key,
+                              const struct smap *records);
+size_t pinctrl_process_packet_in_for_test(struct rconn *swconn,
+                                          const struct ofp_header *);
+
 #endif /* controller/pinctrl.h */
@@ -55,15 +55,33 @@ test_lflow_cache_add__(struct lflow_cache *lc, const char *op_type,
         lflow_cache_add_matches(lc, lflow_uuid,
                                 conj_id_ofs, n_conjs, matches,
                                 TEST_LFLOW_CACHE_VALUE_SIZE);
+    } else if (!strcmp(op_type, "actions")) {
+        struct ofpbuf ovnacts;
+        ofpbuf_init(&ovnacts, 0);
+        lflow_cache_add_actions(lc, lflow_uuid, &ovnacts, expr_clone(e),
+                                TEST_LFLOW_CACHE_VALUE_SIZE);
     } else {
         OVS_NOT_REACHED();
     }
 }
 
 static void
-test_lflow_cache_lookup__(struct lflow_cache *lc,
+test_lflow_cache_lookup__(struct lflow_cache *lc, const char *op_type,
                           const struct uuid *lflow_uuid)
 {
+    if (!strcmp(op_type, "actions")) {
+        const struct lflow_cache_actions *actions =
+            lflow_cache_get_actions(lc, lflow_uuid);
+
+        printf("LOOKUP actions:\n");
+        if (!actions) {
+            printf("  not found\n");
+            return;
+        }
+        printf("  prereqs: %s\n", actions->prereqs ? "yes" : "no");
+        return;
+    }
+
     struct lflow_cache_value *lcv = lflow_cache_get(lc, lflow_uuid);
 
     printf("LOOKUP:\n");
@@ -80,7 +98,19 @@ test_lflow_cache_lookup__(struct lflow_cache *lc,
         break;
     case LCACHE_T_MATCHES:
         printf("  type: matches\n");
+        if (lcv->packed) {
+            const struct lflow_cache_packed_matches *pm = lcv->packed_matches;
+            struct expr_match m;
+
+            printf("  packed matches: %"PRIuSIZE"\n", pm->n);
+            for (size_t i = 0; i < pm->n; i++) {
+                lflow_cache_packed_match_expand(&pm->matches[i], &m);
+                printf("  match: %s\n",
+                       match_is_catchall(&m.match) ? "catchall" : "other");
+            }
+        }
         break;
+    case LCACHE_T_ACTIONS:
     case LCACHE_T_NONE:
         OVS_NOT_REACHED();
         break;
@@ -120,7 +150,7 @@ test_lflow_cache_operations(struct ovs_cmdl_context *ctx)
     lflow_cache_enable(lc, enabled, UINT32_MAX, UINT32_MAX,
                        TEST_LFLOW_CACHE_TRIM_LIMIT,
                        TEST_LFLOW_CACHE_TRIM_WMARK_PERC,
-                       TEST_LFLOW_CACHE_TRIM_TO_MS);
+                       TEST_LFLOW_CACHE_TRIM_TO_MS, false, false);
     test_lflow_cache_stats__(lc);
 
     if (!test_read_uint_value(ctx, shift++, "n_ops", &n_ops)) {
@@ -134,7 +164,7 @@ test_lflow_cache_operations(struct ovs_cmdl_context *ctx)
             goto done;
         }
 
-        if (!strcmp(op, "add")) {
+        if (!strcmp(op, "add") || !strcmp(op, "add-hot")) {
             const char *op_type = test_read_value(ctx, shift++, "op_type");
             if (!op_type) {
                 goto done;
@@ -152,6 +182,15 @@ test_lflow_cache_operations(struct ovs_cmdl_context *ctx)
                 goto done;
             }
 
+            /* "add-hot" looks the lflow up a few times before adding it, as
+             * if it had been recompiled that many times. */
+            unsigned int n_lookups = 0;
+            if (!strcmp(op, "add-hot")
+                && !test_read_uint_value(ctx, shift++, "n_lookups",
+                                         &n_lookups)) {
+                goto done;
+            }
+
             if (n_lflow_uuids == n_allocated_lflow_uuids) {
                 lflow_uuids = x2nrealloc(lflow_uuids, &n_allocated_lflow_uuids,
                                          sizeof *lflow_uuids);
@@ -159,9 +198,12 @@ test_lflow_cache_operations(struct ovs_cmdl_context *ctx)
             struct uuid *lflow_uuid = &lflow_uuids[n_lflow_uuids++];
 
             uuid_generate(lflow_uuid);
+            for (unsigned int j = 0; j < n_lookups; j++) {
+                test_lflow_cache_lookup__(lc, op_type, lflow_uuid);
+            }
             test_lflow_cache_add__(lc, op_type, lflow_uuid, conj_id_ofs,
                                    n_conjs, e);
-            test_lflow_cache_lookup__(lc, lflow_uuid);
+            test_lflow_cache_lookup__(lc, op_type, lflow_uuid);
         } else if (!strcmp(op, "add-del")) {
             const char *op_type = test_read_value(ctx, shift++, "op_type");
             if (!op_type) {
@@ -184,9 +226,9 @@ test_lflow_cache_operations(struct ovs_cmdl_context *ctx)
             uuid_generate(&lflow_uuid);
             test_lflow_cache_add__(lc, op_type, &lflow_uuid, conj_id_ofs,
                                    n_conjs, e);
-            test_lflow_cache_lookup__(lc, &lflow_uuid);
+            test_lflow_cache_lookup__(lc, op_type, &lflow_uuid);
             test_lflow_cache_delete__(lc, &lflow_uuid);
-            test_lflow_cache_lookup__(lc, &lflow_uuid);
+            test_lflow_cache_lookup__(lc, op_type, &lflow_uuid);
         } else if (!strcmp(op, "del")) {
             ovs_assert(n_lflow_uuids);
             test_lflow_cache_delete__(lc, &lflow_uuids[n_lflow_uuids - 1]);
@@ -196,6 +238,8 @@ test_lflow_cache_operations(struct ovs_cmdl_context *ctx)
             unsigned int mem_limit_kb;
             unsigned int trim_limit = TEST_LFLOW_CACHE_TRIM_LIMIT;
             unsigned int trim_wmark_perc = TEST_LFLOW_CACHE_TRIM_WMARK_PERC;
+            bool pack = false;
+            bool by_content = false;
             if (!test_read_uint_value(ctx, shift++, "limit", &limit)) {
                 goto done;
             }
@@ -217,15 +261,24 @@ test_lflow_cache_operations(struct ovs_cmdl_context *ctx)
                     goto done;
                 }
             }
+            if (shift < ctx->argc && !strcmp(ctx->argv[shift], "pack")) {
+                shift++;
+                pack = true;
+            }
+            if (shift < ctx->argc && !strcmp(ctx->argv[shift], "by-content")) {
+                shift++;
+                by_content = true;
+            }
             printf("ENABLE\n");
             lflow_cache_enable(lc, true, limit, mem_limit_kb, trim_limit,
-                               trim_wmark_perc, TEST_LFLOW_CACHE_TRIM_TO_MS);
+                               trim_wmark_perc, TEST_LFLOW_CACHE_TRIM_TO_MS,
+                               pack, by_content);
         } else if (!strcmp(op, "disable")) {
             printf("DISABLE\n");
             lflow_cache_enable(lc, false, UINT32_MAX, UINT32_MAX,
                                TEST_LFLOW_CACHE_TRIM_LIMIT,
                                TEST_LFLOW_CACHE_TRIM_WMARK_PERC,
-                               TEST_LFLOW_CACHE_TRIM_TO_MS);
+                               TEST_LFLOW_CACHE_TRIM_TO_MS, false, false);
         } else if (!strcmp(op, "flush")) {
             printf("FLUSH\n");
             lflow_cache_flush(lc);
@@ -248,7 +301,7 @@ test_lflow_cache_negative(struct ovs_cmdl_context *ctx OVS_UNUSED)
     lflow_cache_enable(NULL, true, UINT32_MAX, UINT32_MAX,
                        TEST_LFLOW_CACHE_TRIM_LIMIT,
                        TEST_LFLOW_CACHE_TRIM_WMARK_PERC,
-                       TEST_LFLOW_CACHE_TRIM_TO_MS);
+                       TEST_LFLOW_CACHE_TRIM_TO_MS, false, false);
     ovs_assert(!lflow_cache_is_enabled(NULL));
 
     struct ds ds = DS_EMPTY_INITIALIZER;
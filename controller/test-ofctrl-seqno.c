@@ -17,6 +17,7 @@
 
 #include "tests/ovstest.h"
 #include "tests/test-utils.h"
+#include "openvswitch/dynamic-string.h"
 #include "sort.h"
 #include "util.h"
 
@@ -93,7 +94,7 @@ test_ofctrl_seqno_add_type(struct ovs_cmdl_context *ctx)
         return;
     }
     for (unsigned int i = 0; i < n_types; i++) {
-        printf("%"PRIuSIZE"\n", ofctrl_seqno_add_type());
+        printf("%"PRIuSIZE"\n", ofctrl_seqno_add_type("test"));
     }
 }
 
@@ -113,7 +114,7 @@ test_ofctrl_seqno_ack_seqnos(struct ovs_cmdl_context *ctx)
     }
 
     for (unsigned int i = 0; i < n_types; i++) {
-        ovs_assert(ofctrl_seqno_add_type() == i);
+        ovs_assert(ofctrl_seqno_add_type("test") == i);
 
         /* Read number of app specific seqnos. */
         unsigned int n_app_seqnos;
@@ -158,6 +159,29 @@ test_ofctrl_seqno_ack_seqnos(struct ovs_cmdl_context *ctx)
     }
 }
 
+static void
+test_ofctrl_latency(struct ovs_cmdl_context *ctx)
+{
+    struct ofctrl_latency *latency = ofctrl_latency_get("test");
+    struct ds ds = DS_EMPTY_INITIALIZER;
+
+    for (unsigned int i = 1; i < ctx->argc; i++) {
+        unsigned int msec;
+
+        if (!test_read_uint_value(ctx, i, "msec", &msec)) {
+            return;
+        }
+        ofctrl_latency_record(latency, msec);
+    }
+
+    ofctrl_latency_format(&ds, false);
+    ofctrl_latency_format(&ds, true);
+    ofctrl_latency_clear();
+    ofctrl_latency_format(&ds, false);
+    printf("%s", ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
 static void
 test_ofctrl_seqno_main(int argc, char *argv[])
 {
@@ -167,6 +191,7 @@ test_ofctrl_seqno_main(int argc, char *argv[])
          test_ofctrl_seqno_add_type, OVS_RO},
         {"ofctrl_seqno_ack_seqnos", NULL, 2, INT_MAX,
          test_ofctrl_seqno_ack_seqnos, OVS_RO},
+        {"ofctrl_latency", NULL, 0, INT_MAX, test_ofctrl_latency, OVS_RO},
         {NULL, NULL, 0, 0, NULL, OVS_RO},
     };
     struct ovs_cmdl_context ctx;
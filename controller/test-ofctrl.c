@@ -0,0 +1,180 @@
+/* Copyright (c) 2022, Red Hat, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include "byte-order.h"
+#include "flow.h"
+#include "lib/uuid.h"
+#include "openvswitch/match.h"
+#include "openvswitch/ofp-actions.h"
+#include "openvswitch/ofpbuf.h"
+#include "simap.h"
+#include "tests/ovstest.h"
+#include "tests/test-utils.h"
+#include "timeval.h"
+#include "util.h"
+
+#include "ofctrl.h"
+
+/* Adds to 'flow_table' the flow of the logical flow number 'n', outputting
+ * to a port that depends on 'version', so that flows added with different
+ * versions only differ by their actions. */
+static void
+test_add_flow(struct ovn_desired_flow_table *flow_table, unsigned int n,
+              unsigned int version, struct ofpbuf *ofpacts)
+{
+    struct uuid sb_uuid = { .parts = { n + 1, 0, 0, 0 } };
+    struct match match;
+
+    match_init_catchall(&match);
+    match_set_metadata(&match, htonll(n / 256 + 1));
+    match_set_reg(&match, 14, n % 256 + 1);
+
+    ofpbuf_clear(ofpacts);
+    ofpact_put_OUTPUT(ofpacts)->port =
+        u16_to_ofp(version % ofp_to_u16(OFPP_MAX) + 1);
+
+    ofctrl_add_flow(flow_table, 8, 100, sb_uuid.parts[0], &match, ofpacts,
+                    &sb_uuid);
+}
+
+static void
+test_remove_flow(struct ovn_desired_flow_table *flow_table, unsigned int n)
+{
+    struct uuid sb_uuid = { .parts = { n + 1, 0, 0, 0 } };
+
+    ofctrl_remove_flows(flow_table, &sb_uuid);
+}
+
+static void
+test_print_sync(struct ovn_desired_flow_table *flow_table, const char *what,
+                unsigned int n_flows)
+{
+    long long int start = time_usec();
+    size_t n_msgs = ofctrl_sync_flows_for_test(flow_table);
+    long long int elapsed = time_usec() - start;
+
+    printf("%s: %u flows, %"PRIuSIZE" msgs, %lld.%03lld ms\n",
+           what, n_flows, n_msgs, elapsed / 1000, elapsed % 1000);
+}
+
+static void
+test_print_memory_usage(void)
+{
+    struct simap usage = SIMAP_INITIALIZER(&usage);
+
+    ofctrl_get_memory_usage(&usage);
+
+    const struct simap_node **nodes = simap_sort(&usage);
+    for (size_t i = 0; i < simap_count(&usage); i++) {
+        printf("memory: %s %u\n", nodes[i]->name, nodes[i]->data);
+    }
+    free(nodes);
+    simap_destroy(&usage);
+}
+
+/* Installs 'n_flows' flows, then updates 'churn' percent of them
+ * 'n_iterations' times, reconciling the installed flows by the tracked
+ * changes, and finally once more by a full recompute of the desired flows
+ * and a comparison of the tables.  Reports the number of OpenFlow messages
+ * and the time each reconciliation takes, and the memory used by the flow
+ * tables at the end. */
+static void
+test_ofctrl_benchmark(struct ovs_cmdl_context *ctx)
+{
+    unsigned int shift = 1;
+    unsigned int n_flows;
+    unsigned int churn;
+    unsigned int n_iterations;
+
+    if (!test_read_uint_value(ctx, shift++, "n_flows", &n_flows) ||
+        !test_read_uint_value(ctx, shift++, "churn", &churn) ||
+        !test_read_uint_value(ctx, shift++, "n_iterations", &n_iterations)) {
+        return;
+    }
+    if (churn > 100) {
+        printf("Expected churn percentage, got %u.\n", churn);
+        return;
+    }
+
+    struct ovn_desired_flow_table flow_table;
+    struct ofpbuf ofpacts;
+    unsigned int *versions = xcalloc(n_flows, sizeof *versions);
+    unsigned int n_changes = (uint64_t) n_flows * churn / 100;
+    unsigned int next = 0;
+
+    ofctrl_init(NULL, NULL, 0);
+    ovn_desired_flow_table_init(&flow_table);
+    ofpbuf_init(&ofpacts, 0);
+
+    for (unsigned int i = 0; i < n_flows; i++) {
+        test_add_flow(&flow_table, i, versions[i], &ofpacts);
+    }
+    test_print_sync(&flow_table, "initial", n_flows);
+
+    /* Each iteration removes the next 'n_changes' flows and adds them back,
+     * like the reprocessing of their logical flows does: every other one
+     * with new actions, the others unchanged, which are merged with their
+     * deleted copy instead of being reinstalled. */
+    for (unsigned int iter = 1; iter <= n_iterations; iter++) {
+        for (unsigned int i = 0; i < n_changes; i++) {
+            if (i % 2) {
+                versions[next]++;
+            }
+            test_remove_flow(&flow_table, next);
+            test_add_flow(&flow_table, next, versions[next], &ofpacts);
+            next = (next + 1) % n_flows;
+        }
+
+        char *what = xasprintf("track %u", iter);
+        test_print_sync(&flow_table, what, n_changes);
+        free(what);
+    }
+
+    /* A full recompute, where the next 'n_changes' flows change too. */
+    ovn_desired_flow_table_clear(&flow_table);
+    for (unsigned int i = 0; i < n_changes; i++) {
+        versions[next]++;
+        next = (next + 1) % n_flows;
+    }
+    for (unsigned int i = 0; i < n_flows; i++) {
+        test_add_flow(&flow_table, i, versions[i], &ofpacts);
+    }
+    test_print_sync(&flow_table, "compare", n_flows);
+
+    test_print_memory_usage();
+
+    ofpbuf_uninit(&ofpacts);
+    ovn_desired_flow_table_destroy(&flow_table);
+    ofctrl_destroy();
+    free(versions);
+}
+
+static void
+test_ofctrl_main(int argc, char *argv[])
+{
+    set_program_name(argv[0]);
+    static const struct ovs_cmdl_command commands[] = {
+        {"benchmark", NULL, 3, 3, test_ofctrl_benchmark, OVS_RO},
+        {NULL, NULL, 0, 0, NULL, OVS_RO},
+    };
+    struct ovs_cmdl_context ctx;
+    ctx.argc = argc - 1;
+    ctx.argv = argv + 1;
+    ovs_cmdl_run_command(&ctx, commands);
+}
+
+OVSTEST_REGISTER("test-ofctrl", test_ofctrl_main);
@@ -0,0 +1,445 @@
+/* Copyright (c) 2022, Red Hat, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+
+#include "byte-order.h"
+#include "dp-packet.h"
+#include "flow.h"
+#include "lib/dhcp.h"
+#include "lib/ovn-l7.h"
+#include "lib/ovn-util.h"
+#include "openvswitch/match.h"
+#include "openvswitch/ofp-actions.h"
+#include "openvswitch/ofp-packet.h"
+#include "openvswitch/ofpbuf.h"
+#include "openvswitch/poll-loop.h"
+#include "openvswitch/rconn.h"
+#include "openvswitch/shash.h"
+#include "openvswitch/vconn.h"
+#include "ovn/actions.h"
+#include "ovn/expr.h"
+#include "ovn/logical-fields.h"
+#include "packets.h"
+#include "smap.h"
+#include "socket-util.h"
+#include "tests/ovstest.h"
+#include "tests/test-utils.h"
+#include "timeval.h"
+#include "util.h"
+
+#include "lflow.h"
+#include "pinctrl.h"
+
+/* The logical switch and port that all the packet-ins come from. */
+#define TEST_DP_KEY 1
+#define TEST_PORT_KEY 1
+
+/* Number of DNS names in the DNS records, which the DNS queries cycle
+ * through. */
+#define TEST_N_DNS_NAMES 64
+
+struct test_opcode {
+    const char *name;
+    const char *actions;   /* The logical flow actions that send packet-ins. */
+
+    /* Composes the n'th packet sent to the controller by 'actions'. */
+    void (*compose)(struct dp_packet *, unsigned int n);
+};
+
+/* Initializes 'flow' as a UDP packet from the n'th VM of the switch. */
+static void
+test_init_udp_flow(struct flow *flow, unsigned int n)
+{
+    memset(flow, 0, sizeof *flow);
+    eth_addr_from_uint64(0x505400000000ULL + n % (1u << 24), &flow->dl_src);
+    eth_addr_from_uint64(0x00000000ff01ULL, &flow->dl_dst);
+    flow->dl_type = htons(ETH_TYPE_IP);
+    flow->nw_src = htonl(0x0a000002 + n % 65534);
+    flow->nw_dst = htonl(0x0a000001);
+    flow->nw_proto = IPPROTO_UDP;
+    flow->nw_ttl = 64;
+    flow->tp_src = htons(10000 + n % 50000);
+    flow->tp_dst = htons(9);
+}
+
+/* A DHCPDISCOVER from a new VM. */
+static void
+test_compose_dhcp(struct dp_packet *packet, unsigned int n)
+{
+    struct flow flow;
+
+    test_init_udp_flow(&flow, n);
+    flow.dl_dst = eth_addr_broadcast;
+    flow.nw_src = htonl(0);
+    flow.nw_dst = htonl(0xffffffff);
+    flow.tp_src = htons(DHCP_CLIENT_PORT);
+    flow.tp_dst = htons(DHCP_SERVER_PORT);
+
+    uint64_t l7_stub[512 / 8];
+    struct ofpbuf l7 = OFPBUF_STUB_INITIALIZER(l7_stub);
+    struct dhcp_header *dhcp = ofpbuf_put_zeros(&l7, sizeof *dhcp);
+    dhcp->op = DHCP_OP_REQUEST;
+    dhcp->htype = 1;
+    dhcp->hlen = ETH_ADDR_LEN;
+    dhcp->xid = htonl(n);
+    dhcp->chaddr = flow.dl_src;
+
+    ovs_be32 magic_cookie = htonl(DHCP_MAGIC_COOKIE);
+    ofpbuf_put(&l7, &magic_cookie, sizeof magic_cookie);
+    static const uint8_t options[] = {
+        DHCP_OPT_MSG_TYPE, 1, DHCP_MSG_DISCOVER, DHCP_OPT_END,
+    };
+    ofpbuf_put(&l7, options, sizeof options);
+
+    flow_compose(packet, &flow, l7.data, l7.size);
+    ofpbuf_uninit(&l7);
+}
+
+/* A packet to an IP address without a MAC binding, each time a different
+ * one. */
+static void
+test_compose_arp(struct dp_packet *packet, unsigned int n)
+{
+    struct flow flow;
+
+    test_init_udp_flow(&flow, n);
+    flow.nw_dst = htonl(0x0a010000 + n % 65536);
+    flow_compose(packet, &flow, NULL, 64);
+}
+
+static void
+test_put_dns_name(struct ofpbuf *buf, const char *name)
+{
+    while (*name) {
+        size_t len = strcspn(name, ".");
+        uint8_t label_len = len;
+
+        ofpbuf_put(buf, &label_len, sizeof label_len);
+        ofpbuf_put(buf, name, len);
+        name += len;
+        if (*name == '.') {
+            name++;
+        }
+    }
+    ofpbuf_put_zeros(buf, 1);
+}
+
+/* A DNS query of type A for one of the DNS names. */
+static void
+test_compose_dns(struct dp_packet *packet, unsigned int n)
+{
+    struct flow flow;
+
+    test_init_udp_flow(&flow, n);
+    flow.tp_dst = htons(53);
+
+    uint64_t l7_stub[128 / 8];
+    struct ofpbuf l7 = OFPBUF_STUB_INITIALIZER(l7_stub);
+    struct dns_header *dns = ofpbuf_put_zeros(&l7, sizeof *dns);
+    dns->id = htons(n);
+    dns->lo_flag = 0x01;    /* Recursion desired. */
+    dns->qdcount = htons(1);
+
+    char *name = xasprintf("vm%u.ovn.org", n % TEST_N_DNS_NAMES);
+    test_put_dns_name(&l7, name);
+    free(name);
+
+    ovs_be16 type_class[2] = { htons(DNS_QUERY_TYPE_A), htons(DNS_CLASS_IN) };
+    ofpbuf_put(&l7, type_class, sizeof type_class);
+
+    flow_compose(packet, &flow, l7.data, l7.size);
+    ofpbuf_uninit(&l7);
+}
+
+static const struct test_opcode test_opcodes[] = {
+    { "dhcp",
+      "reg0[3] = put_dhcp_opts(offerip = 10.0.0.4, router = 10.0.0.1, "
+      "netmask = 255.255.255.0, server_id = 10.0.0.1, lease_time = 3600);",
+      test_compose_dhcp },
+    { "arp",
+      "arp { eth.dst = ff:ff:ff:ff:ff:ff; arp.spa = 10.0.0.1; arp.op = 1; "
+      "output; };",
+      test_compose_arp },
+    { "dns",
+      "reg0[4] = dns_lookup();",
+      test_compose_dns },
+};
+
+/* Stores in 'userdata' the userdata of the packet-ins that 'actions' send to
+ * the controller, as ovn-controller would encode them. */
+static void
+test_encode_userdata(const char *actions, const struct shash *symtab,
+                     const struct hmap *dhcp_opts, struct ofpbuf *userdata)
+{
+    const struct ovnact_parse_params pp = {
+        .symtab = symtab,
+        .dhcp_opts = dhcp_opts,
+        .n_tables = LOG_PIPELINE_LEN,
+        .cur_ltable = 10,
+    };
+    struct ofpbuf ovnacts;
+    struct expr *prereqs = NULL;
+
+    ofpbuf_init(&ovnacts, 0);
+    char *error = ovnacts_parse_string(actions, &pp, &ovnacts, &prereqs);
+    if (error) {
+        ovs_fatal(0, "%s: %s", actions, error);
+    }
+
+    const struct ovnact_encode_params ep = {
+        .is_switch = true,
+        .pipeline = OVNACT_P_INGRESS,
+        .ingress_ptable = OFTABLE_LOG_INGRESS_PIPELINE,
+        .egress_ptable = OFTABLE_LOG_EGRESS_PIPELINE,
+        .output_ptable = OFTABLE_SAVE_INPORT,
+        .mac_bind_ptable = OFTABLE_MAC_BINDING,
+        .mac_lookup_ptable = OFTABLE_MAC_LOOKUP,
+    };
+    struct ofpbuf ofpacts;
+    ofpbuf_init(&ofpacts, 0);
+    ovnacts_encode(ovnacts.data, ovnacts.size, &ep, &ofpacts);
+
+    const struct ofpact *a;
+    ofpbuf_clear(userdata);
+    OFPACT_FOR_EACH (a, ofpacts.data, ofpacts.size) {
+        if (a->type == OFPACT_CONTROLLER) {
+            const struct ofpact_controller *oc = ofpact_get_CONTROLLER(a);
+            ofpbuf_put(userdata, oc->userdata, oc->userdata_len);
+            break;
+        }
+    }
+    ovs_assert(userdata->size);
+
+    ofpbuf_uninit(&ofpacts);
+    ovnacts_free(ovnacts.data, ovnacts.size);
+    ofpbuf_uninit(&ovnacts);
+    expr_destroy(prereqs);
+}
+
+/* Returns the NXT_PACKET_IN2 that the switch sends to the controller for
+ * 'packet', from the logical port TEST_PORT_KEY of the logical switch
+ * TEST_DP_KEY, with 'userdata'. */
+static struct ofpbuf *
+test_encode_packet_in(const struct dp_packet *packet,
+                      const struct ofpbuf *userdata)
+{
+    struct ofputil_packet_in_private pin = {
+        .base = {
+            .packet = CONST_CAST(void *, dp_packet_data(packet)),
+            .packet_len = dp_packet_size(packet),
+            .reason = OFPR_ACTION,
+            .table_id = OFTABLE_LOG_INGRESS_PIPELINE + 10,
+            .userdata = userdata->data,
+            .userdata_len = userdata->size,
+        },
+        /* Makes the packet-in carry a continuation, like the ones of the
+         * actions that pause the pipeline. */
+        .bridge = { .parts = { 1, 0, 0, 0 } },
+    };
+
+    match_init_catchall(&pin.base.flow_metadata);
+    match_set_metadata(&pin.base.flow_metadata, htonll(TEST_DP_KEY));
+    match_set_reg(&pin.base.flow_metadata, MFF_LOG_INPORT - MFF_REG0,
+                  TEST_PORT_KEY);
+    match_set_in_port(&pin.base.flow_metadata, u16_to_ofp(1));
+
+    return ofputil_encode_packet_in_private(&pin, OFPUTIL_P_OF15_OXM,
+                                            OFPUTIL_PACKET_IN_NXT2);
+}
+
+/* Returns a connection to a switch for the packet-in handlers, which only
+ * use it to get the negotiated OpenFlow version.  Stores in '*serverp' the
+ * other end of the connection. */
+static struct rconn *
+test_connect(struct vconn **serverp)
+{
+    struct pvconn *pvconn;
+    int error = pvconn_open("punix:test-pinctrl.sock", 1u << OFP15_VERSION,
+                            DSCP_DEFAULT, &pvconn);
+    if (error) {
+        ovs_fatal(error, "failed to listen on test-pinctrl.sock");
+    }
+
+    struct rconn *swconn = rconn_create(0, 0, DSCP_DEFAULT,
+                                        1u << OFP15_VERSION);
+    rconn_connect(swconn, "unix:test-pinctrl.sock", "test-pinctrl");
+
+    struct vconn *server = NULL;
+    for (;;) {
+        rconn_run(swconn);
+        if (!server) {
+            error = pvconn_accept(pvconn, &server);
+            if (error && error != EAGAIN) {
+                ovs_fatal(error, "failed to accept connection");
+            }
+        }
+        if (server) {
+            vconn_run(server);
+            error = vconn_connect(server);
+            if (error && error != EAGAIN) {
+                ovs_fatal(error, "failed to connect");
+            }
+            if (!error && rconn_is_connected(swconn)
+                && rconn_get_version(swconn) >= 0) {
+                break;
+            }
+            vconn_run_wait(server);
+            vconn_connect_wait(server);
+        } else {
+            pvconn_wait(pvconn);
+        }
+        rconn_run_wait(swconn);
+        poll_block();
+    }
+    pvconn_close(pvconn);
+
+    *serverp = server;
+    return swconn;
+}
+
+static int
+test_compare_latencies(const void *a_, const void *b_)
+{
+    const long long int *a = a_;
+    const long long int *b = b_;
+
+    return *a < *b ? -1 : *a > *b;
+}
+
+/* Handles 'n_packets' packet-ins of 'opcode', each with a different packet,
+ * and reports the number of replies, the throughput and the latency
+ * percentiles. */
+static void
+test_run_opcode(const struct test_opcode *opcode, unsigned int n_packets,
+                struct rconn *swconn, const struct shash *symtab,
+                const struct hmap *dhcp_opts)
+{
+    long long int *latencies = xmalloc(n_packets * sizeof *latencies);
+    long long int total = 0;
+    size_t n_replies = 0;
+    struct ofpbuf userdata;
+    struct dp_packet packet;
+
+    ofpbuf_init(&userdata, 0);
+    test_encode_userdata(opcode->actions, symtab, dhcp_opts, &userdata);
+    dp_packet_init(&packet, 0);
+
+    for (unsigned int i = 0; i < n_packets; i++) {
+        opcode->compose(&packet, i);
+        struct ofpbuf *msg = test_encode_packet_in(&packet, &userdata);
+
+        long long int start = time_usec();
+        n_replies += pinctrl_process_packet_in_for_test(swconn, msg->data);
+        latencies[i] = time_usec() - start;
+        total += latencies[i];
+
+        ofpbuf_delete(msg);
+    }
+
+    printf("%s: %u packet-ins, %"PRIuSIZE" replies", opcode->name, n_packets,
+           n_replies);
+    if (n_packets) {
+        qsort(latencies, n_packets, sizeof *latencies,
+              test_compare_latencies);
+        printf(", %lld packets/s, p50 %lld us, p99 %lld us, max %lld us",
+               n_packets * 1000000LL / MAX(total, 1),
+               latencies[n_packets / 2],
+               latencies[(uint64_t) n_packets * 99 / 100],
+               latencies[n_packets - 1]);
+    }
+    printf("\n");
+
+    dp_packet_uninit(&packet);
+    ofpbuf_uninit(&userdata);
+    free(latencies);
+}
+
+/* Sends 'n_packets' packet-ins of each of the opcodes in 'test_opcodes', or
+ * only of the ones named on the command line, through the packet-in handlers
+ * of pinctrl, as a boot storm would, and reports the replies, the throughput
+ * and the tail latency of each. */
+static void
+test_pinctrl_benchmark(struct ovs_cmdl_context *ctx)
+{
+    unsigned int n_packets;
+
+    if (!test_read_uint_value(ctx, 1, "n_packets", &n_packets)) {
+        return;
+    }
+
+    struct shash symtab = SHASH_INITIALIZER(&symtab);
+    struct hmap dhcp_opts = HMAP_INITIALIZER(&dhcp_opts);
+    struct smap dns_records = SMAP_INITIALIZER(&dns_records);
+    struct vconn *server;
+
+    ovn_init_symtab(&symtab);
+    dhcp_opt_add(&dhcp_opts, "offerip", 0, "ipv4");
+    dhcp_opt_add(&dhcp_opts, "netmask", 1, "ipv4");
+    dhcp_opt_add(&dhcp_opts, "router", 3, "ipv4");
+    dhcp_opt_add(&dhcp_opts, "lease_time", 51, "uint32");
+    dhcp_opt_add(&dhcp_opts, "server_id", 54, "ipv4");
+
+    pinctrl_init_for_test();
+    for (unsigned int i = 0; i < TEST_N_DNS_NAMES; i++) {
+        char *name = xasprintf("vm%u.ovn.org", i);
+        smap_add_format(&dns_records, name, "10.0.0.%u aef0::%u", i + 2,
+                        i + 2);
+        free(name);
+    }
+    pinctrl_add_dns_for_test("test", TEST_DP_KEY, &dns_records);
+
+    struct rconn *swconn = test_connect(&server);
+
+    for (size_t i = 0; i < ARRAY_SIZE(test_opcodes); i++) {
+        const struct test_opcode *opcode = &test_opcodes[i];
+        bool selected = ctx->argc <= 2;
+
+        for (int j = 2; j < ctx->argc; j++) {
+            if (!strcmp(ctx->argv[j], opcode->name)) {
+                selected = true;
+            }
+        }
+        if (selected) {
+            test_run_opcode(opcode, n_packets, swconn, &symtab, &dhcp_opts);
+        }
+    }
+
+    rconn_destroy(swconn);
+    vconn_close(server);
+    pinctrl_destroy_for_test();
+    smap_destroy(&dns_records);
+    dhcp_opts_destroy(&dhcp_opts);
+    expr_symtab_destroy(&symtab);
+    shash_destroy(&symtab);
+}
+
+static void
+test_pinctrl_main(int argc, char *argv[])
+{
+    set_program_name(argv[0]);
+    static const struct ovs_cmdl_command commands[] = {
+        {"benchmark", NULL, 1, INT_MAX, test_pinctrl_benchmark, OVS_RO},
+        {NULL, NULL, 0, 0, NULL, OVS_RO},
+    };
+    struct ovs_cmdl_context ctx;
+    ctx.argc = argc - 1;
+    ctx.argv = argv + 1;
+    ovs_cmdl_run_command(&ctx, commands);
+}
+
+OVSTEST_REGISTER("test-pinctrl", test_pinctrl_main);
@@ -17,9 +17,12 @@
 #include <config.h>
 
 /* OVS includes */
+#include "coverage.h"
 #include "lib/vswitch-idl.h"
 #include "openvswitch/shash.h"
 #include "openvswitch/vlog.h"
+#include "stopwatch.h"
+#include "timeval.h"
 
 /* OVN includes */
 #include "binding.h"
@@ -31,6 +34,11 @@
 
 VLOG_DEFINE_THIS_MODULE(vif_plug);
 
+COVERAGE_DEFINE(vif_plug_port_create);
+COVERAGE_DEFINE(vif_plug_port_update);
+COVERAGE_DEFINE(vif_plug_port_remove);
+COVERAGE_DEFINE(vif_plug_prepare_batch);
+
 #define OVN_PLUGGED_EXT_ID "ovn-plugged"
 #define VIF_PLUG_OPTION_TYPE "vif-plug-type"
 #define VIF_PLUG_OPTION_MTU_REQUEST "vif-plug-mtu-request"
@@ -70,6 +78,31 @@ vif_plug_port_prepare(const struct vif_plug_class *vif_plug_class,
     return vif_plug_class->vif_plug_port_prepare(ctx_in, ctx_out);
 }
 
+/* Prepare the 'n' logical ports identified by 'ctx_in' the same way as
+ * vif_plug_port_prepare, storing in 'prepared[i]' the value it returns for
+ * port 'i'.  'ctx_out[i]' is NULL for PLUG_OP_REMOVE operations.
+ *
+ * VIF plug providers that implement it get a single call for all the ports,
+ * the others one call per port. */
+void
+vif_plug_port_prepare_batch(const struct vif_plug_class *vif_plug_class,
+                            const struct vif_plug_port_ctx_in **ctx_in,
+                            struct vif_plug_port_ctx_out **ctx_out,
+                            bool *prepared, size_t n)
+{
+    if (vif_plug_class->vif_plug_port_prepare_batch) {
+        COVERAGE_INC(vif_plug_prepare_batch);
+        vif_plug_class->vif_plug_port_prepare_batch(ctx_in, ctx_out,
+                                                    prepared, n);
+        return;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        prepared[i] = vif_plug_port_prepare(vif_plug_class, ctx_in[i],
+                                            ctx_out[i]);
+    }
+}
+
 /* Notify the VIF plug implementation that a port creation, update or removal
  * has been committed to the database. */
 void
@@ -215,11 +248,45 @@ transact_update_port(const struct ovsrec_interface *iface_rec,
 }
 
 
+/* A port creation, update or removal found by vif_plug_run(), waiting to be
+ * prepared by its VIF plug provider before being added to the transaction.
+ *
+ * The operations of an iteration are collected first, so that each VIF plug
+ * provider gets to prepare all of its ports at once and all the resulting
+ * OVSDB changes go in the same transaction. */
+enum vif_plug_pending_op {
+    VIF_PLUG_PENDING_CREATE,
+    VIF_PLUG_PENDING_UPDATE,
+    VIF_PLUG_PENDING_REMOVE,
+};
+
+struct vif_plug_pending {
+    enum vif_plug_pending_op op;
+    struct vif_plug_port_ctx *vif_plug_port_ctx;
+    const char *vif_plug_type;             /* Create and update only. */
+    int64_t mtu_request;                   /* Create and update only. */
+    const struct ovsrec_interface *iface;  /* Update and removal only. */
+    const struct ovsrec_port *port;        /* Removal only. */
+    bool prepared;      /* Return value of vif_plug_port_prepare(). */
+};
+
+static struct vif_plug_pending *
+add_pending(struct shash *pending, enum vif_plug_pending_op op,
+            struct vif_plug_port_ctx *vif_plug_port_ctx)
+{
+    struct vif_plug_pending *p = xzalloc(sizeof *p);
+    p->op = op;
+    p->vif_plug_port_ctx = vif_plug_port_ctx;
+    shash_add(pending, vif_plug_port_ctx->vif_plug_port_ctx_in.lport_name,
+              p);
+    return p;
+}
+
 static bool
 consider_unplug_iface(const struct ovsrec_interface *iface,
                       const struct sbrec_port_binding *pb,
                       struct vif_plug_ctx_in *vif_plug_ctx_in,
-                      struct vif_plug_ctx_out *vif_plug_ctx_out)
+                      struct shash *pending)
 {
     const char *vif_plug_type = smap_get(&iface->external_ids,
                                          OVN_PLUGGED_EXT_ID);
@@ -261,26 +328,10 @@ consider_unplug_iface(const struct ovsrec_interface *iface,
         struct vif_plug_port_ctx *vif_plug_port_ctx = build_port_ctx(
             vif_plug, PLUG_OP_REMOVE, vif_plug_ctx_in, pb, iface, iface_id);
 
-        if (!vif_plug_port_prepare(vif_plug,
-                                   &vif_plug_port_ctx->vif_plug_port_ctx_in,
-                                   NULL)) {
-            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
-            VLOG_INFO_RL(&rl,
-                         "Not unplugging iface %s (iface-id %s) on direction "
-                         "from VIF plug provider.",
-                         iface->name, iface_id);
-            destroy_port_ctx(vif_plug_port_ctx);
-            return true;
-        }
-        VLOG_INFO("Unplugging port %s from %s for iface-id %s on this "
-                  "chassis.",
-                  port->name,
-                  vif_plug_ctx_in->br_int->name,
-                  iface_id);
-
-        /* Add and track delete operation to the transaction */
-        transact_delete_port(vif_plug_ctx_in, vif_plug_ctx_out,
-                             vif_plug_port_ctx, port);
+        struct vif_plug_pending *p = add_pending(
+            pending, VIF_PLUG_PENDING_REMOVE, vif_plug_port_ctx);
+        p->iface = iface;
+        p->port = port;
         return true;
     }
     return true;
@@ -294,10 +345,10 @@ get_plug_mtu_request(const struct smap *lport_options)
 
 static bool
 consider_plug_lport_create__(const struct vif_plug_class *vif_plug,
-                             const struct smap *iface_external_ids,
+                             const char *vif_plug_type,
                              const struct sbrec_port_binding *pb,
                              struct vif_plug_ctx_in *vif_plug_ctx_in,
-                             struct vif_plug_ctx_out *vif_plug_ctx_out)
+                             struct shash *pending)
 {
     if (!vif_plug_ctx_in->chassis_rec || !vif_plug_ctx_in->br_int
         || !vif_plug_ctx_in->ovs_idl_txn) {
@@ -318,37 +369,20 @@ consider_plug_lport_create__(const struct vif_plug_class *vif_plug,
     struct vif_plug_port_ctx *vif_plug_port_ctx = build_port_ctx(
         vif_plug, PLUG_OP_CREATE, vif_plug_ctx_in, pb, NULL, NULL);
 
-    if (!vif_plug_port_prepare(vif_plug,
-                           &vif_plug_port_ctx->vif_plug_port_ctx_in,
-                           &vif_plug_port_ctx->vif_plug_port_ctx_out)) {
-        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
-        VLOG_INFO_RL(&rl,
-                     "Not plugging lport %s on direction from VIF plug "
-                     "provider.",
-                     pb->logical_port);
-        destroy_port_ctx(vif_plug_port_ctx);
-        return true;
-    }
-
-    VLOG_INFO("Plugging port %s into %s for lport %s on this "
-              "chassis.",
-              vif_plug_port_ctx->vif_plug_port_ctx_out.name,
-              vif_plug_ctx_in->br_int->name,
-              pb->logical_port);
-    transact_create_port(vif_plug_ctx_in, vif_plug_ctx_out,
-                         vif_plug_port_ctx,
-                         iface_external_ids,
-                         get_plug_mtu_request(&pb->options));
+    struct vif_plug_pending *p = add_pending(
+        pending, VIF_PLUG_PENDING_CREATE, vif_plug_port_ctx);
+    p->vif_plug_type = vif_plug_type;
+    p->mtu_request = get_plug_mtu_request(&pb->options);
     return true;
 }
 
 static bool
 consider_plug_lport_update__(const struct vif_plug_class *vif_plug,
-                             const struct smap *iface_external_ids,
+                             const char *vif_plug_type,
                              const struct sbrec_port_binding *pb,
                              struct local_binding *lbinding,
                              struct vif_plug_ctx_in *vif_plug_ctx_in,
-                             struct vif_plug_ctx_out *vif_plug_ctx_out)
+                             struct shash *pending)
 {
     if (!vif_plug_ctx_in->chassis_rec || !vif_plug_ctx_in->br_int
         || !vif_plug_ctx_in->ovs_idl_txn) {
@@ -368,34 +402,11 @@ consider_plug_lport_update__(const struct vif_plug_class *vif_plug,
     struct vif_plug_port_ctx *vif_plug_port_ctx = build_port_ctx(
         vif_plug, PLUG_OP_CREATE, vif_plug_ctx_in, pb, NULL, NULL);
 
-    if (!vif_plug_port_prepare(vif_plug,
-                               &vif_plug_port_ctx->vif_plug_port_ctx_in,
-                               &vif_plug_port_ctx->vif_plug_port_ctx_out)) {
-        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
-        VLOG_INFO_RL(&rl,
-                     "Not updating lport %s on direction from VIF plug "
-                     "provider.",
-                     pb->logical_port);
-        destroy_port_ctx(vif_plug_port_ctx);
-        return true;
-    }
-
-    if (strcmp(lbinding->iface->name,
-               vif_plug_port_ctx->vif_plug_port_ctx_out.name)) {
-        VLOG_WARN("Attempt of incompatible change to existing "
-                  "port detected, please recreate port: %s",
-                   pb->logical_port);
-        vif_plug_port_ctx_destroy(vif_plug,
-                                  &vif_plug_port_ctx->vif_plug_port_ctx_in,
-                                  &vif_plug_port_ctx->vif_plug_port_ctx_out);
-        destroy_port_ctx(vif_plug_port_ctx);
-        return false;
-    }
-    VLOG_DBG("updating iface for: %s", pb->logical_port);
-    transact_update_port(lbinding->iface, vif_plug_ctx_in, vif_plug_ctx_out,
-                         vif_plug_port_ctx, iface_external_ids,
-                         get_plug_mtu_request(&pb->options));
-
+    struct vif_plug_pending *p = add_pending(
+        pending, VIF_PLUG_PENDING_UPDATE, vif_plug_port_ctx);
+    p->vif_plug_type = vif_plug_type;
+    p->mtu_request = get_plug_mtu_request(&pb->options);
+    p->iface = lbinding->iface;
     return true;
 }
 
@@ -403,7 +414,7 @@ static bool
 consider_plug_lport(const struct sbrec_port_binding *pb,
                     struct local_binding *lbinding,
                     struct vif_plug_ctx_in *vif_plug_ctx_in,
-                    struct vif_plug_ctx_out *vif_plug_ctx_out)
+                    struct shash *pending)
 {
     bool ret = true;
     if (lport_can_bind_on_this_chassis(vif_plug_ctx_in->chassis_rec, pb)
@@ -428,10 +439,6 @@ consider_plug_lport(const struct sbrec_port_binding *pb,
              * not change that fact. */
             return true;
         }
-        const struct smap iface_external_ids = SMAP_CONST2(
-                &iface_external_ids,
-                OVN_PLUGGED_EXT_ID, vif_plug_type,
-                "iface-id", pb->logical_port);
         if (lbinding && lbinding->iface) {
             if (!smap_get(&lbinding->iface->external_ids,
                           OVN_PLUGGED_EXT_ID))
@@ -444,13 +451,12 @@ consider_plug_lport(const struct sbrec_port_binding *pb,
                              UUID_ARGS(&lbinding->iface->header_.uuid));
                 return false;
             }
-            ret = consider_plug_lport_update__(vif_plug, &iface_external_ids,
-                                               pb, lbinding, vif_plug_ctx_in,
-                                               vif_plug_ctx_out);
+            ret = consider_plug_lport_update__(vif_plug, vif_plug_type, pb,
+                                               lbinding, vif_plug_ctx_in,
+                                               pending);
         } else {
-            ret = consider_plug_lport_create__(vif_plug, &iface_external_ids,
-                                               pb, vif_plug_ctx_in,
-                                               vif_plug_ctx_out);
+            ret = consider_plug_lport_create__(vif_plug, vif_plug_type, pb,
+                                               vif_plug_ctx_in, pending);
         }
     }
 
@@ -460,19 +466,23 @@ consider_plug_lport(const struct sbrec_port_binding *pb,
 static bool
 vif_plug_iface_touched_this_txn(
         const struct vif_plug_ctx_out *vif_plug_ctx_out,
+        const struct shash *pending,
         const char *iface_id)
 {
     return shash_find(vif_plug_ctx_out->changed_iface_ids, iface_id)
-           || shash_find(vif_plug_ctx_out->deleted_iface_ids, iface_id);
+           || shash_find(vif_plug_ctx_out->deleted_iface_ids, iface_id)
+           || shash_find(pending, iface_id);
 }
 
 static bool
 vif_plug_handle_lport_vif(const struct sbrec_port_binding *pb,
                           struct vif_plug_ctx_in *vif_plug_ctx_in,
                           struct vif_plug_ctx_out *vif_plug_ctx_out,
+                          struct shash *pending,
                           bool can_unplug)
 {
-    if (vif_plug_iface_touched_this_txn(vif_plug_ctx_out, pb->logical_port)) {
+    if (vif_plug_iface_touched_this_txn(vif_plug_ctx_out, pending,
+                                        pb->logical_port)) {
         return true;
     }
     bool handled = true;
@@ -480,11 +490,11 @@ vif_plug_handle_lport_vif(const struct sbrec_port_binding *pb,
         vif_plug_ctx_in->local_bindings, pb->logical_port);
 
     if (lport_can_bind_on_this_chassis(vif_plug_ctx_in->chassis_rec, pb)) {
-        handled &= consider_plug_lport(pb, lbinding,
-                                       vif_plug_ctx_in, vif_plug_ctx_out);
+        handled &= consider_plug_lport(pb, lbinding, vif_plug_ctx_in,
+                                       pending);
     } else if (can_unplug && lbinding && lbinding->iface) {
         handled &= consider_unplug_iface(lbinding->iface, pb,
-                                         vif_plug_ctx_in, vif_plug_ctx_out);
+                                         vif_plug_ctx_in, pending);
     }
     return handled;
 }
@@ -493,6 +503,7 @@ static bool
 vif_plug_handle_iface(const struct ovsrec_interface *iface_rec,
                       struct vif_plug_ctx_in *vif_plug_ctx_in,
                       struct vif_plug_ctx_out *vif_plug_ctx_out,
+                      struct shash *pending,
                       bool can_unplug)
 {
     bool handled = true;
@@ -500,7 +511,8 @@ vif_plug_handle_iface(const struct ovsrec_interface *iface_rec,
                                          OVN_PLUGGED_EXT_ID);
     const char *iface_id = smap_get(&iface_rec->external_ids, "iface-id");
     if (!vif_plug_type || !iface_id
-        || vif_plug_iface_touched_this_txn(vif_plug_ctx_out, iface_id)) {
+        || vif_plug_iface_touched_this_txn(vif_plug_ctx_out, pending,
+                                           iface_id)) {
         return true;
     }
     struct local_binding *lbinding = local_binding_find(
@@ -511,8 +523,8 @@ vif_plug_handle_iface(const struct ovsrec_interface *iface_rec,
         && lport_can_bind_on_this_chassis(vif_plug_ctx_in->chassis_rec, pb)) {
         /* Something changed on a interface we have previously plugged,
          * consider updating it */
-        handled &= consider_plug_lport(pb, lbinding,
-                                       vif_plug_ctx_in, vif_plug_ctx_out);
+        handled &= consider_plug_lport(pb, lbinding, vif_plug_ctx_in,
+                                       pending);
     } else if (can_unplug
                && (!pb
                    || !lport_can_bind_on_this_chassis(
@@ -520,11 +532,171 @@ vif_plug_handle_iface(const struct ovsrec_interface *iface_rec,
         /* No lport for this interface or it is destined for different chassis,
          * consuder unplugging it */
         handled &= consider_unplug_iface(iface_rec, pb,
-                                         vif_plug_ctx_in, vif_plug_ctx_out);
+                                         vif_plug_ctx_in, pending);
     }
     return handled;
 }
 
+/* Adds the operation 'p', once prepared by its VIF plug provider, to the
+ * transaction.  Returns true if it was added. */
+static bool
+transact_pending(const struct vif_plug_pending *p,
+                 const struct vif_plug_ctx_in *vif_plug_ctx_in,
+                 const struct vif_plug_ctx_out *vif_plug_ctx_out)
+{
+    static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
+    struct vif_plug_port_ctx *vif_plug_port_ctx = p->vif_plug_port_ctx;
+    const char *lport_name =
+        vif_plug_port_ctx->vif_plug_port_ctx_in.lport_name;
+
+    if (p->op == VIF_PLUG_PENDING_REMOVE) {
+        if (!p->prepared) {
+            VLOG_INFO_RL(&rl,
+                         "Not unplugging iface %s (iface-id %s) on direction "
+                         "from VIF plug provider.",
+                         p->iface->name, lport_name);
+            destroy_port_ctx(vif_plug_port_ctx);
+            return false;
+        }
+        VLOG_INFO("Unplugging port %s from %s for iface-id %s on this "
+                  "chassis.",
+                  p->port->name,
+                  vif_plug_ctx_in->br_int->name,
+                  lport_name);
+
+        /* Add and track delete operation to the transaction */
+        COVERAGE_INC(vif_plug_port_remove);
+        transact_delete_port(vif_plug_ctx_in, vif_plug_ctx_out,
+                             vif_plug_port_ctx, p->port);
+        return true;
+    }
+
+    if (!p->prepared) {
+        if (p->op == VIF_PLUG_PENDING_CREATE) {
+            VLOG_INFO_RL(&rl,
+                         "Not plugging lport %s on direction from VIF plug "
+                         "provider.",
+                         lport_name);
+        } else {
+            VLOG_INFO_RL(&rl,
+                         "Not updating lport %s on direction from VIF plug "
+                         "provider.",
+                         lport_name);
+        }
+        destroy_port_ctx(vif_plug_port_ctx);
+        return false;
+    }
+
+    const struct smap iface_external_ids = SMAP_CONST2(
+            &iface_external_ids,
+            OVN_PLUGGED_EXT_ID, p->vif_plug_type,
+            "iface-id", lport_name);
+
+    if (p->op == VIF_PLUG_PENDING_CREATE) {
+        VLOG_INFO("Plugging port %s into %s for lport %s on this "
+                  "chassis.",
+                  vif_plug_port_ctx->vif_plug_port_ctx_out.name,
+                  vif_plug_ctx_in->br_int->name,
+                  lport_name);
+        COVERAGE_INC(vif_plug_port_create);
+        transact_create_port(vif_plug_ctx_in, vif_plug_ctx_out,
+                             vif_plug_port_ctx, &iface_external_ids,
+                             p->mtu_request);
+        return true;
+    }
+
+    if (strcmp(p->iface->name,
+               vif_plug_port_ctx->vif_plug_port_ctx_out.name)) {
+        VLOG_WARN("Attempt of incompatible change to existing "
+                  "port detected, please recreate port: %s",
+                   lport_name);
+        vif_plug_port_ctx_destroy(vif_plug_port_ctx->vif_plug,
+                                  &vif_plug_port_ctx->vif_plug_port_ctx_in,
+                                  &vif_plug_port_ctx->vif_plug_port_ctx_out);
+        destroy_port_ctx(vif_plug_port_ctx);
+        return false;
+    }
+    VLOG_DBG("updating iface for: %s", lport_name);
+    COVERAGE_INC(vif_plug_port_update);
+    transact_update_port(p->iface, vif_plug_ctx_in, vif_plug_ctx_out,
+                         vif_plug_port_ctx, &iface_external_ids,
+                         p->mtu_request);
+    return true;
+}
+
+/* Set while the OVSDB changes made by vif_plug_run() are waiting for the
+ * transaction to commit, for the VIF_PLUG_COMMIT_STOPWATCH_NAME stopwatch. */
+static bool vif_plug_commit_pending = false;
+
+/* Has the VIF plug providers prepare the operations in 'pending', with one
+ * call per provider, and adds the prepared ones to the transaction. */
+static void
+vif_plug_run_pending(struct shash *pending,
+                     const struct vif_plug_ctx_in *vif_plug_ctx_in,
+                     const struct vif_plug_ctx_out *vif_plug_ctx_out)
+{
+    size_t n = shash_count(pending);
+    if (!n) {
+        return;
+    }
+
+    const struct shash_node **nodes = shash_sort(pending);
+    const struct vif_plug_port_ctx_in **ctx_in = xmalloc(n * sizeof *ctx_in);
+    struct vif_plug_port_ctx_out **ctx_out = xmalloc(n * sizeof *ctx_out);
+    struct vif_plug_pending **batch = xmalloc(n * sizeof *batch);
+    bool *prepared = xmalloc(n * sizeof *prepared);
+    bool *batched = xcalloc(n, sizeof *batched);
+
+    for (size_t i = 0; i < n; i++) {
+        if (batched[i]) {
+            continue;
+        }
+
+        struct vif_plug_pending *first = nodes[i]->data;
+        const struct vif_plug_class *vif_plug =
+            first->vif_plug_port_ctx->vif_plug;
+        size_t n_batch = 0;
+        for (size_t j = i; j < n; j++) {
+            struct vif_plug_pending *p = nodes[j]->data;
+            if (batched[j] || p->vif_plug_port_ctx->vif_plug != vif_plug) {
+                continue;
+            }
+
+            batched[j] = true;
+            batch[n_batch] = p;
+            ctx_in[n_batch] = &p->vif_plug_port_ctx->vif_plug_port_ctx_in;
+            ctx_out[n_batch] = p->op == VIF_PLUG_PENDING_REMOVE
+                               ? NULL
+                               : &p->vif_plug_port_ctx->vif_plug_port_ctx_out;
+            n_batch++;
+        }
+
+        vif_plug_port_prepare_batch(vif_plug, ctx_in, ctx_out, prepared,
+                                    n_batch);
+        for (size_t j = 0; j < n_batch; j++) {
+            batch[j]->prepared = prepared[j];
+        }
+    }
+
+    bool transacted = false;
+    for (size_t i = 0; i < n; i++) {
+        transacted |= transact_pending(nodes[i]->data, vif_plug_ctx_in,
+                                       vif_plug_ctx_out);
+    }
+    if (transacted && !vif_plug_commit_pending) {
+        stopwatch_start(VIF_PLUG_COMMIT_STOPWATCH_NAME, time_msec());
+        vif_plug_commit_pending = true;
+    }
+
+    free(nodes);
+    free(ctx_in);
+    free(ctx_out);
+    free(batch);
+    free(prepared);
+    free(batched);
+    shash_clear_free_data(pending);
+}
+
 /* On initial startup or on IDL reconnect, several rounds of the main loop may
  * run before data is actually loaded in the IDL, primarily depending on
  * conditional monitoring status and other events that could trigger main loop
@@ -553,11 +725,12 @@ vif_plug_run(struct vif_plug_ctx_in *vif_plug_ctx_in,
     if (!vif_plug_ctx_in->chassis_rec) {
         return;
     }
+    struct shash pending = SHASH_INITIALIZER(&pending);
     const struct ovsrec_interface *iface_rec;
     OVSREC_INTERFACE_TABLE_FOR_EACH (iface_rec,
                                      vif_plug_ctx_in->iface_table) {
         vif_plug_handle_iface(iface_rec, vif_plug_ctx_in, vif_plug_ctx_out,
-                              !vif_plug_prime_idl_count);
+                              &pending, !vif_plug_prime_idl_count);
     }
 
     struct sbrec_port_binding *target =
@@ -573,10 +746,22 @@ vif_plug_run(struct vif_plug_ctx_in *vif_plug_ctx_in,
         enum en_lport_type lport_type = get_lport_type(pb);
         if (lport_type == LP_VIF) {
             vif_plug_handle_lport_vif(pb, vif_plug_ctx_in, vif_plug_ctx_out,
-                                      !vif_plug_prime_idl_count);
+                                      &pending, !vif_plug_prime_idl_count);
         }
     }
     sbrec_port_binding_index_destroy_row(target);
+
+    vif_plug_run_pending(&pending, vif_plug_ctx_in, vif_plug_ctx_out);
+    shash_destroy(&pending);
+}
+
+static void
+vif_plug_commit_done(void)
+{
+    if (vif_plug_commit_pending) {
+        stopwatch_stop(VIF_PLUG_COMMIT_STOPWATCH_NAME, time_msec());
+        vif_plug_commit_pending = false;
+    }
 }
 
 static void
@@ -602,6 +787,7 @@ vif_plug_clear_deleted(struct shash *deleted_iface_ids) {
 
 void
 vif_plug_finish_deleted(struct shash *deleted_iface_ids) {
+    vif_plug_commit_done();
     vif_plug_finish_deleted__(deleted_iface_ids, true);
 }
 
@@ -631,5 +817,6 @@ vif_plug_clear_changed(struct shash *deleted_iface_ids) {
 
 void
 vif_plug_finish_changed(struct shash *deleted_iface_ids) {
+    vif_plug_commit_done();
     vif_plug_finish_changed__(deleted_iface_ids, true);
 }
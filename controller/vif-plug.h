@@ -29,6 +29,10 @@
 extern "C" {
 #endif
 
+/* Measures the time from the OVSDB changes made by vif_plug_run() until
+ * their transaction commits, retries included. */
+#define VIF_PLUG_COMMIT_STOPWATCH_NAME "vif-plug-commit"
+
 struct vif_plug_ctx_in {
     struct ovsdb_idl_txn *ovs_idl_txn;
     struct ovsdb_idl_index *sbrec_port_binding_by_name;
@@ -56,6 +60,10 @@ const struct sset * vif_plug_get_maintained_iface_options(
 bool vif_plug_port_prepare(const struct vif_plug_class *,
                            const struct vif_plug_port_ctx_in *,
                            struct vif_plug_port_ctx_out *);
+void vif_plug_port_prepare_batch(const struct vif_plug_class *,
+                                 const struct vif_plug_port_ctx_in **,
+                                 struct vif_plug_port_ctx_out **,
+                                 bool *prepared, size_t n);
 void vif_plug_port_finish(const struct vif_plug_class *,
                           const struct vif_plug_port_ctx_in *,
                           struct vif_plug_port_ctx_out *);
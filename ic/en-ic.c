@@ -0,0 +1,272 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include "en-ic.h"
+#include "hmapx.h"
+#include "lib/inc-proc-eng.h"
+#include "lib/ovn-ic-sb-idl.h"
+#include "lib/ovn-nb-idl.h"
+#include "lib/stopwatch-names.h"
+#include "ovn-ic.h"
+#include "sset.h"
+#include "stopwatch.h"
+#include "timeval.h"
+
+/* The ovn-ic engine nodes have no data of their own: each of them runs one
+ * of the synchronizations between the interconnection and the availability
+ * zone databases, from scratch, only when one of the tables it reads from
+ * changed.  The routes are the exception: the changes to the routers and to
+ * the routes only sync the routes of the routers they affect. */
+
+static struct ic_context *
+ic_context_get(void)
+{
+    return engine_get_context()->client_ctx;
+}
+
+/* Transit switches: IC-NB Transit_Switch to NB Logical_Switch and IC-SB
+ * Datapath_Binding. */
+void *
+en_ts_init(struct engine_node *node OVS_UNUSED,
+           struct engine_arg *arg OVS_UNUSED)
+{
+    return NULL;
+}
+
+void
+en_ts_run(struct engine_node *node, void *data OVS_UNUSED)
+{
+    stopwatch_start(IC_TS_RUN_STOPWATCH_NAME, time_msec());
+    ts_run(ic_context_get());
+    stopwatch_stop(IC_TS_RUN_STOPWATCH_NAME, time_msec());
+    engine_set_node_state(node, EN_UPDATED);
+}
+
+void
+en_ts_cleanup(void *data OVS_UNUSED)
+{
+}
+
+/* Gateways: SB Chassis to IC-SB Gateway and back. */
+void *
+en_gateway_init(struct engine_node *node OVS_UNUSED,
+                struct engine_arg *arg OVS_UNUSED)
+{
+    return NULL;
+}
+
+void
+en_gateway_run(struct engine_node *node, void *data OVS_UNUSED)
+{
+    struct ic_context *ctx = ic_context_get();
+
+    stopwatch_start(IC_GATEWAY_RUN_STOPWATCH_NAME, time_msec());
+    gateway_run(ctx, ctx->az);
+    stopwatch_stop(IC_GATEWAY_RUN_STOPWATCH_NAME, time_msec());
+    engine_set_node_state(node, EN_UPDATED);
+}
+
+void
+en_gateway_cleanup(void *data OVS_UNUSED)
+{
+}
+
+/* Ports of the transit switches: NB and SB to IC-SB Port_Binding and
+ * back. */
+void *
+en_port_binding_init(struct engine_node *node OVS_UNUSED,
+                     struct engine_arg *arg OVS_UNUSED)
+{
+    return NULL;
+}
+
+void
+en_port_binding_run(struct engine_node *node, void *data OVS_UNUSED)
+{
+    struct ic_context *ctx = ic_context_get();
+
+    stopwatch_start(IC_PORT_BINDING_RUN_STOPWATCH_NAME, time_msec());
+    port_binding_run(ctx, ctx->az);
+    stopwatch_stop(IC_PORT_BINDING_RUN_STOPWATCH_NAME, time_msec());
+    engine_set_node_state(node, EN_UPDATED);
+}
+
+void
+en_port_binding_cleanup(void *data OVS_UNUSED)
+{
+}
+
+/* Routes: advertisement of the NB routes to IC-SB Route and learning of
+ * the routes of the other availability zones. */
+void *
+en_route_init(struct engine_node *node OVS_UNUSED,
+              struct engine_arg *arg OVS_UNUSED)
+{
+    return NULL;
+}
+
+void
+en_route_run(struct engine_node *node, void *data OVS_UNUSED)
+{
+    struct ic_context *ctx = ic_context_get();
+
+    stopwatch_start(IC_ROUTE_RUN_STOPWATCH_NAME, time_msec());
+    route_run(ctx, ctx->az);
+    stopwatch_stop(IC_ROUTE_RUN_STOPWATCH_NAME, time_msec());
+    engine_set_node_state(node, EN_UPDATED);
+}
+
+void
+en_route_cleanup(void *data OVS_UNUSED)
+{
+}
+
+/* Only the options of NB_Global, which include the route advertisement and
+ * learning settings, matter to the routes.  Its name is the name of the
+ * availability zone, whose changes recompute everything anyway. */
+bool
+route_nb_nb_global_handler(struct engine_node *node, void *data OVS_UNUSED)
+{
+    const struct nbrec_nb_global_table *nb_global_table =
+        EN_OVSDB_GET(engine_get_input("NB_nb_global", node));
+
+    const struct nbrec_nb_global *nb;
+    NBREC_NB_GLOBAL_TABLE_FOR_EACH_TRACKED (nb, nb_global_table) {
+        if (nbrec_nb_global_is_new(nb) || nbrec_nb_global_is_deleted(nb)
+            || nbrec_nb_global_is_updated(nb, NBREC_NB_GLOBAL_COL_OPTIONS)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* A change to a logical router, including to the set of its static routes,
+ * only needs the routes of that router to be synced again. */
+bool
+route_nb_logical_router_handler(struct engine_node *node,
+                                void *data OVS_UNUSED)
+{
+    const struct nbrec_logical_router_table *lr_table =
+        EN_OVSDB_GET(engine_get_input("NB_logical_router", node));
+    struct hmapx lrs = HMAPX_INITIALIZER(&lrs);
+
+    const struct nbrec_logical_router *lr;
+    NBREC_LOGICAL_ROUTER_TABLE_FOR_EACH_TRACKED (lr, lr_table) {
+        if (!nbrec_logical_router_is_deleted(lr)) {
+            hmapx_add(&lrs, CONST_CAST(struct nbrec_logical_router *, lr));
+        }
+    }
+
+    struct ic_context *ctx = ic_context_get();
+    stopwatch_start(IC_ROUTE_RUN_STOPWATCH_NAME, time_msec());
+    route_run_for(ctx, ctx->az, &lrs, NULL);
+    stopwatch_stop(IC_ROUTE_RUN_STOPWATCH_NAME, time_msec());
+    hmapx_destroy(&lrs);
+    return true;
+}
+
+/* Static routes that are added or removed update their router, which its
+ * own handler takes care of, so only the routes updated in place need to
+ * be mapped back to their routers here. */
+bool
+route_nb_logical_router_static_route_handler(struct engine_node *node,
+                                             void *data OVS_UNUSED)
+{
+    const struct nbrec_logical_router_static_route_table *route_table =
+        EN_OVSDB_GET(engine_get_input("NB_logical_router_static_route",
+                                      node));
+    struct hmapx routes = HMAPX_INITIALIZER(&routes);
+
+    const struct nbrec_logical_router_static_route *route;
+    NBREC_LOGICAL_ROUTER_STATIC_ROUTE_TABLE_FOR_EACH_TRACKED (route,
+                                                              route_table) {
+        if (!nbrec_logical_router_static_route_is_new(route)
+            && !nbrec_logical_router_static_route_is_deleted(route)) {
+            hmapx_add(&routes,
+                      CONST_CAST(struct nbrec_logical_router_static_route *,
+                                 route));
+        }
+    }
+    if (hmapx_is_empty(&routes)) {
+        hmapx_destroy(&routes);
+        return true;
+    }
+
+    const struct nbrec_logical_router_table *lr_table =
+        EN_OVSDB_GET(engine_get_input("NB_logical_router", node));
+    struct hmapx lrs = HMAPX_INITIALIZER(&lrs);
+
+    const struct nbrec_logical_router *lr;
+    NBREC_LOGICAL_ROUTER_TABLE_FOR_EACH (lr, lr_table) {
+        for (size_t i = 0; i < lr->n_static_routes; i++) {
+            if (hmapx_contains(&routes, lr->static_routes[i])) {
+                hmapx_add(&lrs, CONST_CAST(struct nbrec_logical_router *, lr));
+                break;
+            }
+        }
+    }
+
+    struct ic_context *ctx = ic_context_get();
+    stopwatch_start(IC_ROUTE_RUN_STOPWATCH_NAME, time_msec());
+    route_run_for(ctx, ctx->az, &lrs, NULL);
+    stopwatch_stop(IC_ROUTE_RUN_STOPWATCH_NAME, time_msec());
+    hmapx_destroy(&lrs);
+    hmapx_destroy(&routes);
+    return true;
+}
+
+/* The routes in IC-SB are grouped by transit switch: only the routers with
+ * a port on a transit switch whose routes changed need to learn or advertise
+ * them again. */
+bool
+route_icsb_route_handler(struct engine_node *node, void *data OVS_UNUSED)
+{
+    const struct icsbrec_route_table *isb_route_table =
+        EN_OVSDB_GET(engine_get_input("ICSB_route", node));
+    struct sset ts_names = SSET_INITIALIZER(&ts_names);
+
+    const struct icsbrec_route *isb_route;
+    ICSBREC_ROUTE_TABLE_FOR_EACH_TRACKED (isb_route, isb_route_table) {
+        sset_add(&ts_names, isb_route->transit_switch);
+    }
+
+    struct ic_context *ctx = ic_context_get();
+    stopwatch_start(IC_ROUTE_RUN_STOPWATCH_NAME, time_msec());
+    route_run_for(ctx, ctx->az, NULL, &ts_names);
+    stopwatch_stop(IC_ROUTE_RUN_STOPWATCH_NAME, time_msec());
+    sset_destroy(&ts_names);
+    return true;
+}
+
+/* 'ic_output' is the root of the ovn-ic engine graph, it only makes sure
+ * all the other nodes are run. */
+void *
+en_ic_output_init(struct engine_node *node OVS_UNUSED,
+                  struct engine_arg *arg OVS_UNUSED)
+{
+    return NULL;
+}
+
+void
+en_ic_output_run(struct engine_node *node, void *data OVS_UNUSED)
+{
+    engine_set_node_state(node, EN_UPDATED);
+}
+
+void
+en_ic_output_cleanup(void *data OVS_UNUSED)
+{
+}
@@ -0,0 +1,33 @@
+#ifndef EN_IC_H
+#define EN_IC_H 1
+
+#include <config.h>
+
+#include "lib/inc-proc-eng.h"
+
+void *en_ts_init(struct engine_node *, struct engine_arg *);
+void en_ts_run(struct engine_node *, void *data);
+void en_ts_cleanup(void *data);
+
+void *en_gateway_init(struct engine_node *, struct engine_arg *);
+void en_gateway_run(struct engine_node *, void *data);
+void en_gateway_cleanup(void *data);
+
+void *en_port_binding_init(struct engine_node *, struct engine_arg *);
+void en_port_binding_run(struct engine_node *, void *data);
+void en_port_binding_cleanup(void *data);
+
+void *en_route_init(struct engine_node *, struct engine_arg *);
+void en_route_run(struct engine_node *, void *data);
+void en_route_cleanup(void *data);
+bool route_nb_nb_global_handler(struct engine_node *, void *data);
+bool route_nb_logical_router_handler(struct engine_node *, void *data);
+bool route_nb_logical_router_static_route_handler(struct engine_node *,
+                                                  void *data);
+bool route_icsb_route_handler(struct engine_node *, void *data);
+
+void *en_ic_output_init(struct engine_node *, struct engine_arg *);
+void en_ic_output_run(struct engine_node *, void *data);
+void en_ic_output_cleanup(void *data);
+
+#endif /* EN_IC_H */
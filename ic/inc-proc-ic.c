@@ -0,0 +1,219 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "en-ic.h"
+#include "inc-proc-ic.h"
+#include "lib/inc-proc-eng.h"
+#include "lib/ovn-ic-nb-idl.h"
+#include "lib/ovn-ic-sb-idl.h"
+#include "lib/ovn-nb-idl.h"
+#include "lib/ovn-sb-idl.h"
+#include "openvswitch/poll-loop.h"
+#include "openvswitch/vlog.h"
+#include "util.h"
+
+VLOG_DEFINE_THIS_MODULE(inc_proc_ic);
+
+#define NB_NODES \
+    NB_NODE(nb_global, "nb_global") \
+    NB_NODE(logical_switch, "logical_switch") \
+    NB_NODE(logical_switch_port, "logical_switch_port") \
+    NB_NODE(logical_router, "logical_router") \
+    NB_NODE(logical_router_port, "logical_router_port") \
+    NB_NODE(logical_router_static_route, "logical_router_static_route")
+
+#define SB_NODES \
+    SB_NODE(chassis, "chassis") \
+    SB_NODE(encap, "encap") \
+    SB_NODE(datapath_binding, "datapath_binding") \
+    SB_NODE(port_binding, "port_binding")
+
+#define ICNB_NODES \
+    ICNB_NODE(transit_switch, "transit_switch")
+
+#define ICSB_NODES \
+    ICSB_NODE(availability_zone, "availability_zone") \
+    ICSB_NODE(gateway, "gateway") \
+    ICSB_NODE(encap, "encap") \
+    ICSB_NODE(datapath_binding, "datapath_binding") \
+    ICSB_NODE(port_binding, "port_binding") \
+    ICSB_NODE(route, "route")
+
+/* Define engine node functions for nodes that represent the tables of the
+ * four databases
+ *
+ * en_<DB>_<TABLE_NAME>_run()
+ * en_<DB>_<TABLE_NAME>_init()
+ * en_<DB>_<TABLE_NAME>_cleanup()
+ */
+#define NB_NODE(NAME, NAME_STR) ENGINE_FUNC_NB(NAME);
+    NB_NODES
+#undef NB_NODE
+
+#define SB_NODE(NAME, NAME_STR) ENGINE_FUNC_SB(NAME);
+    SB_NODES
+#undef SB_NODE
+
+#define ICNB_NODE(NAME, NAME_STR) ENGINE_FUNC_ICNB(NAME);
+    ICNB_NODES
+#undef ICNB_NODE
+
+#define ICSB_NODE(NAME, NAME_STR) ENGINE_FUNC_ICSB(NAME);
+    ICSB_NODES
+#undef ICSB_NODE
+
+/* Define engine nodes for the tables
+ *
+ * struct engine_node en_<DB>_<TABLE_NAME>
+ *
+ * Define nodes as static to avoid sparse errors.
+ */
+#define NB_NODE(NAME, NAME_STR) static ENGINE_NODE_NB(NAME, NAME_STR);
+    NB_NODES
+#undef NB_NODE
+
+#define SB_NODE(NAME, NAME_STR) static ENGINE_NODE_SB(NAME, NAME_STR);
+    SB_NODES
+#undef SB_NODE
+
+#define ICNB_NODE(NAME, NAME_STR) static ENGINE_NODE_ICNB(NAME, NAME_STR);
+    ICNB_NODES
+#undef ICNB_NODE
+
+#define ICSB_NODE(NAME, NAME_STR) static ENGINE_NODE_ICSB(NAME, NAME_STR);
+    ICSB_NODES
+#undef ICSB_NODE
+
+/* Define engine nodes for other nodes. They should be defined as static to
+ * avoid sparse errors. */
+static ENGINE_NODE(ts, "ts");
+static ENGINE_NODE(gateway, "gateway");
+static ENGINE_NODE(port_binding, "port_binding");
+static ENGINE_NODE(route, "route");
+static ENGINE_NODE(ic_output, "ic_output");
+
+void inc_proc_ic_init(struct ovsdb_idl_loop *nb,
+                      struct ovsdb_idl_loop *sb,
+                      struct ovsdb_idl_loop *ic_nb,
+                      struct ovsdb_idl_loop *ic_sb)
+{
+    /* Define relationships between nodes where first argument is dependent
+     * on the second argument.  Each node recomputes its part of the
+     * synchronization when the tables it reads from change.  The changes
+     * to the availability zone of this ovn-ic force a full recompute. */
+    engine_add_input(&en_ts, &en_icnb_transit_switch, NULL);
+    engine_add_input(&en_ts, &en_icsb_datapath_binding, NULL);
+    engine_add_input(&en_ts, &en_nb_logical_switch, NULL);
+
+    engine_add_input(&en_gateway, &en_icsb_availability_zone, NULL);
+    engine_add_input(&en_gateway, &en_icsb_gateway, NULL);
+    engine_add_input(&en_gateway, &en_icsb_encap, NULL);
+    engine_add_input(&en_gateway, &en_sb_chassis, NULL);
+    engine_add_input(&en_gateway, &en_sb_encap, NULL);
+
+    /* The ports only read the NB_Global options that bound the size of
+     * their transactions, which take effect with the next batch. */
+    engine_add_input(&en_port_binding, &en_nb_nb_global, engine_noop_handler);
+    engine_add_input(&en_port_binding, &en_icsb_availability_zone, NULL);
+    engine_add_input(&en_port_binding, &en_icnb_transit_switch, NULL);
+    engine_add_input(&en_port_binding, &en_icsb_port_binding, NULL);
+    engine_add_input(&en_port_binding, &en_nb_logical_switch, NULL);
+    engine_add_input(&en_port_binding, &en_nb_logical_switch_port, NULL);
+    engine_add_input(&en_port_binding, &en_nb_logical_router_port, NULL);
+    engine_add_input(&en_port_binding, &en_sb_chassis, NULL);
+    engine_add_input(&en_port_binding, &en_sb_datapath_binding, NULL);
+    engine_add_input(&en_port_binding, &en_sb_port_binding, NULL);
+
+    engine_add_input(&en_route, &en_nb_nb_global,
+                     route_nb_nb_global_handler);
+    engine_add_input(&en_route, &en_icsb_availability_zone, NULL);
+    engine_add_input(&en_route, &en_icnb_transit_switch, NULL);
+    engine_add_input(&en_route, &en_icsb_port_binding, NULL);
+    engine_add_input(&en_route, &en_icsb_route, route_icsb_route_handler);
+    engine_add_input(&en_route, &en_nb_logical_switch_port, NULL);
+    engine_add_input(&en_route, &en_nb_logical_router,
+                     route_nb_logical_router_handler);
+    engine_add_input(&en_route, &en_nb_logical_router_port, NULL);
+    engine_add_input(&en_route, &en_nb_logical_router_static_route,
+                     route_nb_logical_router_static_route_handler);
+
+    engine_add_input(&en_ic_output, &en_ts, engine_noop_handler);
+    engine_add_input(&en_ic_output, &en_gateway, engine_noop_handler);
+    engine_add_input(&en_ic_output, &en_port_binding, engine_noop_handler);
+    engine_add_input(&en_ic_output, &en_route, engine_noop_handler);
+
+    struct engine_arg engine_arg = {
+        .nb_idl = nb->idl,
+        .sb_idl = sb->idl,
+        .icnb_idl = ic_nb->idl,
+        .icsb_idl = ic_sb->idl,
+    };
+
+    engine_init(&en_ic_output, &engine_arg);
+}
+
+void inc_proc_ic_run(struct ic_context *ctx, bool recompute)
+{
+    engine_init_run();
+
+    /* Force a full recompute if instructed to, for example, after a
+     * reconnection to one of the databases.  However, make sure we don't
+     * overwrite an existing force-recompute request if 'recompute' is
+     * false. */
+    if (recompute) {
+        engine_set_force_recompute(recompute);
+    }
+
+    struct engine_context eng_ctx = {
+        .ovnnb_idl_txn = ctx->ovnnb_txn,
+        .ovnsb_idl_txn = ctx->ovnsb_txn,
+        .client_ctx = ctx,
+    };
+
+    engine_set_context(&eng_ctx);
+
+    if (ctx->ovnnb_txn && ctx->ovnsb_txn &&
+        ctx->ovninb_txn && ctx->ovnisb_txn) {
+        engine_run(true);
+    }
+
+    if (!engine_has_run()) {
+        if (engine_need_run()) {
+            VLOG_DBG("engine did not run, force recompute next time.");
+            engine_set_force_recompute(true);
+            poll_immediate_wake();
+        } else {
+            VLOG_DBG("engine did not run, and it was not needed");
+        }
+    } else if (engine_aborted()) {
+        VLOG_DBG("engine was aborted, force recompute next time.");
+        engine_set_force_recompute(true);
+        poll_immediate_wake();
+    } else {
+        engine_set_force_recompute(false);
+    }
+
+    engine_set_context(NULL);
+}
+
+void inc_proc_ic_cleanup(void)
+{
+    engine_cleanup();
+    engine_set_context(NULL);
+}
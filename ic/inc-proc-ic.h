@@ -0,0 +1,16 @@
+#ifndef INC_PROC_IC_H
+#define INC_PROC_IC_H 1
+
+#include <config.h>
+
+#include "ovn-ic.h"
+#include "ovsdb-idl.h"
+
+void inc_proc_ic_init(struct ovsdb_idl_loop *nb,
+                      struct ovsdb_idl_loop *sb,
+                      struct ovsdb_idl_loop *ic_nb,
+                      struct ovsdb_idl_loop *ic_sb);
+void inc_proc_ic_run(struct ic_context *ctx, bool recompute);
+void inc_proc_ic_cleanup(void);
+
+#endif /* INC_PROC_IC_H */
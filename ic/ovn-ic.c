@@ -22,11 +22,14 @@
 
 #include "bitmap.h"
 #include "command-line.h"
+#include "coverage.h"
 #include "daemon.h"
 #include "dirs.h"
 #include "openvswitch/dynamic-string.h"
 #include "fatal-signal.h"
 #include "hash.h"
+#include "hmapx.h"
+#include "inc-proc-ic.h"
 #include "openvswitch/hmap.h"
 #include "lib/ovn-ic-nb-idl.h"
 #include "lib/ovn-ic-sb-idl.h"
@@ -34,12 +37,16 @@
 #include "lib/ovn-sb-idl.h"
 #include "lib/ovn-util.h"
 #include "memory.h"
+#include "ovn-ic.h"
 #include "openvswitch/poll-loop.h"
 #include "simap.h"
 #include "smap.h"
 #include "sset.h"
+#include "stopwatch.h"
+#include "lib/stopwatch-names.h"
 #include "stream.h"
 #include "stream-ssl.h"
+#include "timeval.h"
 #include "unixctl.h"
 #include "util.h"
 #include "uuid.h"
@@ -47,34 +54,17 @@
 
 VLOG_DEFINE_THIS_MODULE(ovn_ic);
 
+COVERAGE_DEFINE(ic_route_advertise);
+COVERAGE_DEFINE(ic_route_withdraw);
+COVERAGE_DEFINE(ic_route_learn);
+COVERAGE_DEFINE(ic_route_unlearn);
+
 static unixctl_cb_func ovn_ic_exit;
 static unixctl_cb_func ovn_ic_pause;
 static unixctl_cb_func ovn_ic_resume;
 static unixctl_cb_func ovn_ic_is_paused;
 static unixctl_cb_func ovn_ic_status;
 
-struct ic_context {
-    struct ovsdb_idl *ovnnb_idl;
-    struct ovsdb_idl *ovnsb_idl;
-    struct ovsdb_idl *ovninb_idl;
-    struct ovsdb_idl *ovnisb_idl;
-    struct ovsdb_idl_txn *ovnnb_txn;
-    struct ovsdb_idl_txn *ovnsb_txn;
-    struct ovsdb_idl_txn *ovninb_txn;
-    struct ovsdb_idl_txn *ovnisb_txn;
-    struct ovsdb_idl_index *nbrec_ls_by_name;
-    struct ovsdb_idl_index *nbrec_lrp_by_name;
-    struct ovsdb_idl_index *nbrec_port_by_name;
-    struct ovsdb_idl_index *sbrec_chassis_by_name;
-    struct ovsdb_idl_index *sbrec_port_binding_by_name;
-    struct ovsdb_idl_index *icnbrec_transit_switch_by_name;
-    struct ovsdb_idl_index *icsbrec_port_binding_by_az;
-    struct ovsdb_idl_index *icsbrec_port_binding_by_ts;
-    struct ovsdb_idl_index *icsbrec_port_binding_by_ts_az;
-    struct ovsdb_idl_index *icsbrec_route_by_ts;
-    struct ovsdb_idl_index *icsbrec_route_by_ts_az;
-};
-
 struct ic_state {
     bool had_lock;
     bool paused;
@@ -169,26 +159,39 @@ az_run(struct ic_context *ctx)
     return NULL;
 }
 
+/* Allocates a tunnel key for a new transit switch datapath.  The keys in
+ * use are only collected into 'dp_tnlids' the first time a key is needed,
+ * so that a run without any new transit switch does not have to go through
+ * all of them. */
 static uint32_t
-allocate_ts_dp_key(struct hmap *dp_tnlids)
+allocate_ts_dp_key(struct ic_context *ctx, struct ovn_tnlids *dp_tnlids,
+                   bool *dp_tnlids_built)
 {
+    if (!*dp_tnlids_built) {
+        const struct icsbrec_datapath_binding *isb_dp;
+        ICSBREC_DATAPATH_BINDING_FOR_EACH (isb_dp, ctx->ovnisb_idl) {
+            ovn_add_tnlid(dp_tnlids, isb_dp->tunnel_key);
+        }
+        *dp_tnlids_built = true;
+    }
+
     static uint32_t hint = OVN_MIN_DP_KEY_GLOBAL;
     return ovn_allocate_tnlid(dp_tnlids, "transit switch datapath",
                               OVN_MIN_DP_KEY_GLOBAL, OVN_MAX_DP_KEY_GLOBAL,
                               &hint);
 }
 
-static void
+void
 ts_run(struct ic_context *ctx)
 {
     const struct icnbrec_transit_switch *ts;
 
-    struct hmap dp_tnlids = HMAP_INITIALIZER(&dp_tnlids);
+    struct ovn_tnlids dp_tnlids = OVN_TNLIDS_INITIALIZER;
+    bool dp_tnlids_built = false;
     struct shash isb_dps = SHASH_INITIALIZER(&isb_dps);
     const struct icsbrec_datapath_binding *isb_dp;
     ICSBREC_DATAPATH_BINDING_FOR_EACH (isb_dp, ctx->ovnisb_idl) {
         shash_add(&isb_dps, isb_dp->transit_switch, isb_dp);
-        ovn_add_tnlid(&dp_tnlids, isb_dp->tunnel_key);
     }
 
     /* Sync INB TS to AZ NB */
@@ -249,7 +252,8 @@ ts_run(struct ic_context *ctx)
             isb_dp = shash_find_and_delete(&isb_dps, ts->name);
             if (!isb_dp) {
                 /* Allocate tunnel key */
-                int64_t dp_key = allocate_ts_dp_key(&dp_tnlids);
+                int64_t dp_key = allocate_ts_dp_key(ctx, &dp_tnlids,
+                                                    &dp_tnlids_built);
                 if (!dp_key) {
                     continue;
                 }
@@ -363,7 +367,7 @@ sync_sb_gw_to_isb(struct ic_context *ctx,
     free(isb_encaps);
 }
 
-static void
+void
 gateway_run(struct ic_context *ctx, const struct icsbrec_availability_zone *az)
 {
     if (!ctx->ovnisb_txn || !ctx->ovnsb_txn) {
@@ -730,15 +734,34 @@ find_lsp_in_sb(struct ic_context *ctx,
     return find_sb_pb_by_name(ctx->sbrec_port_binding_by_name, lsp->name);
 }
 
+/* Allocates a tunnel key for a new port of the transit switch named
+ * 'ts_name'.  As for the datapaths, the keys of the ports of the transit
+ * switch are only collected into 'pb_tnlids' when the first key is
+ * needed. */
 static uint32_t
-allocate_port_key(struct hmap *pb_tnlids)
+allocate_port_key(struct ic_context *ctx, const char *ts_name,
+                  struct ovn_tnlids *pb_tnlids, bool *pb_tnlids_built)
 {
+    if (!*pb_tnlids_built) {
+        const struct icsbrec_port_binding *isb_pb;
+        const struct icsbrec_port_binding *isb_pb_key =
+            icsbrec_port_binding_index_init_row(
+                ctx->icsbrec_port_binding_by_ts);
+        icsbrec_port_binding_index_set_transit_switch(isb_pb_key, ts_name);
+        ICSBREC_PORT_BINDING_FOR_EACH_EQUAL (isb_pb, isb_pb_key,
+                                             ctx->icsbrec_port_binding_by_ts) {
+            ovn_add_tnlid(pb_tnlids, isb_pb->tunnel_key);
+        }
+        icsbrec_port_binding_index_destroy_row(isb_pb_key);
+        *pb_tnlids_built = true;
+    }
+
     static uint32_t hint;
     return ovn_allocate_tnlid(pb_tnlids, "transit port",
                               1, (1u << 15) - 1, &hint);
 }
 
-static void
+void
 port_binding_run(struct ic_context *ctx,
                  const struct icsbrec_availability_zone *az)
 {
@@ -746,6 +769,18 @@ port_binding_run(struct ic_context *ctx,
         return;
     }
 
+    /* Bounds the number of ports created in a single transaction, e.g. when
+     * a new availability zone joins.  The ports left out are created once
+     * the transaction commits, since the ports it creates trigger another
+     * run. */
+    const struct nbrec_nb_global *nb_global =
+        nbrec_nb_global_first(ctx->ovnnb_idl);
+    int max_new_ports = nb_global
+        ? smap_get_int(&nb_global->options, "ic-max-new-ports-per-txn", 0)
+        : 0;
+    size_t n_new_ports_left = max_new_ports > 0 ? max_new_ports : SIZE_MAX;
+    size_t n_deferred_ports = 0;
+
     struct shash isb_all_local_pbs = SHASH_INITIALIZER(&isb_all_local_pbs);
     struct shash_node *node;
 
@@ -769,7 +804,8 @@ port_binding_run(struct ic_context *ctx,
         }
         struct shash local_pbs = SHASH_INITIALIZER(&local_pbs);
         struct shash remote_pbs = SHASH_INITIALIZER(&remote_pbs);
-        struct hmap pb_tnlids = HMAP_INITIALIZER(&pb_tnlids);
+        struct ovn_tnlids pb_tnlids = OVN_TNLIDS_INITIALIZER;
+        bool pb_tnlids_built = false;
         isb_pb_key = icsbrec_port_binding_index_init_row(
             ctx->icsbrec_port_binding_by_ts);
         icsbrec_port_binding_index_set_transit_switch(isb_pb_key, ts->name);
@@ -783,7 +819,6 @@ port_binding_run(struct ic_context *ctx,
             } else {
                 shash_add(&remote_pbs, isb_pb->logical_port, isb_pb);
             }
-            ovn_add_tnlid(&pb_tnlids, isb_pb->tunnel_key);
         }
         icsbrec_port_binding_index_destroy_row(isb_pb_key);
 
@@ -799,7 +834,14 @@ port_binding_run(struct ic_context *ctx,
                 }
                 isb_pb = shash_find_and_delete(&local_pbs, lsp->name);
                 if (!isb_pb) {
-                    uint32_t pb_tnl_key = allocate_port_key(&pb_tnlids);
+                    if (!n_new_ports_left) {
+                        n_deferred_ports++;
+                        continue;
+                    }
+                    n_new_ports_left--;
+                    uint32_t pb_tnl_key =
+                        allocate_port_key(ctx, ts->name, &pb_tnlids,
+                                          &pb_tnlids_built);
                     create_isb_pb(ctx, sb_pb, az, ts->name, pb_tnl_key);
                 } else {
                     sync_local_port(ctx, isb_pb, sb_pb, lsp);
@@ -828,6 +870,11 @@ port_binding_run(struct ic_context *ctx,
 
         /* Create lsp in NB for remote ports */
         SHASH_FOR_EACH (node, &remote_pbs) {
+            if (!n_new_ports_left) {
+                n_deferred_ports++;
+                continue;
+            }
+            n_new_ports_left--;
             create_nb_lsp(ctx, node->data, ls);
         }
 
@@ -841,6 +888,11 @@ port_binding_run(struct ic_context *ctx,
     }
 
     shash_destroy(&isb_all_local_pbs);
+
+    if (n_deferred_ports) {
+        VLOG_DBG("Creation of %"PRIuSIZE" transit switch ports deferred to "
+                 "the next transactions.", n_deferred_ports);
+    }
 }
 
 struct ic_router_info {
@@ -1004,21 +1056,48 @@ prefix_is_link_local(struct in6_addr *prefix, unsigned int plen)
             ((prefix->s6_addr[1] & 0xc0) == 0x80));
 }
 
-static bool
-prefix_is_black_listed(const struct smap *nb_options,
-                       struct in6_addr *prefix,
-                       unsigned int plen)
+/* The prefixes of the NB_Global options:ic-route-blacklist, parsed only
+ * when the option changes rather than for every route that is checked. */
+struct route_blacklist {
+    char *option;               /* The option the prefixes are parsed from. */
+    struct route_blacklist_prefix {
+        struct in6_addr prefix; /* Masked by 'mask'. */
+        struct in6_addr mask;
+        unsigned int plen;
+        bool is_v4;
+    } *prefixes;
+    size_t n_prefixes;
+};
+
+static struct route_blacklist route_blacklist;
+
+static void
+route_blacklist_clear(struct route_blacklist *bl)
 {
-    const char *blacklist = smap_get(nb_options, "ic-route-blacklist");
-    if (!blacklist || !blacklist[0]) {
-        return false;
+    free(bl->option);
+    free(bl->prefixes);
+    memset(bl, 0, sizeof *bl);
+}
+
+static void
+route_blacklist_update(struct route_blacklist *bl,
+                       const struct smap *nb_options)
+{
+    const char *blacklist = smap_get_def(nb_options, "ic-route-blacklist",
+                                         "");
+    if (bl->option && !strcmp(bl->option, blacklist)) {
+        return;
     }
-    struct in6_addr bl_prefix;
-    unsigned int bl_plen;
+
+    route_blacklist_clear(bl);
+    bl->option = xstrdup(blacklist);
+
+    size_t allocated_prefixes = 0;
     char *cur, *next, *start;
     next = start = xstrdup(blacklist);
-    bool matched = false;
     while ((cur = strsep(&next, ",")) && *cur) {
+        struct in6_addr bl_prefix;
+        unsigned int bl_plen;
         if (!ip46_parse_cidr(cur, &bl_prefix, &bl_plen)) {
             static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
             VLOG_WARN_RL(&rl, "Bad format in nb_global options:"
@@ -1026,37 +1105,46 @@ prefix_is_black_listed(const struct smap *nb_options,
             continue;
         }
 
-        if (IN6_IS_ADDR_V4MAPPED(&bl_prefix) != IN6_IS_ADDR_V4MAPPED(prefix)) {
+        if (bl->n_prefixes == allocated_prefixes) {
+            bl->prefixes = x2nrealloc(bl->prefixes, &allocated_prefixes,
+                                      sizeof *bl->prefixes);
+        }
+        struct route_blacklist_prefix *p = &bl->prefixes[bl->n_prefixes++];
+        p->is_v4 = IN6_IS_ADDR_V4MAPPED(&bl_prefix);
+        p->plen = bl_plen;
+        /* IPv4 prefixes are mapped, so their mask also covers the ::ffff:0:0
+         * prefix that every mapped address shares. */
+        p->mask = ipv6_create_mask(p->is_v4 ? 96 + bl_plen : bl_plen);
+        p->prefix = ipv6_addr_bitand(&bl_prefix, &p->mask);
+    }
+    free(start);
+}
+
+static bool
+prefix_is_black_listed(const struct route_blacklist *bl,
+                       struct in6_addr *prefix,
+                       unsigned int plen)
+{
+    bool is_v4 = IN6_IS_ADDR_V4MAPPED(prefix);
+
+    for (size_t i = 0; i < bl->n_prefixes; i++) {
+        const struct route_blacklist_prefix *p = &bl->prefixes[i];
+
+        if (p->is_v4 != is_v4) {
             continue;
         }
 
         /* 192.168.0.0/16 does not belong to 192.168.0.0/17 */
-        if (plen < bl_plen) {
+        if (plen < p->plen) {
             continue;
         }
 
-        if (IN6_IS_ADDR_V4MAPPED(prefix)) {
-            ovs_be32 bl_prefix_v4 = in6_addr_get_mapped_ipv4(&bl_prefix);
-            ovs_be32 prefix_v4 = in6_addr_get_mapped_ipv4(prefix);
-            ovs_be32 mask = be32_prefix_mask(bl_plen);
-
-            if ((prefix_v4 & mask) != (bl_prefix_v4 & mask)) {
-                continue;
-            }
-        } else {
-            struct in6_addr mask = ipv6_create_mask(bl_plen);
-            for (int i = 0; i < 16 && mask.s6_addr[i] != 0; i++) {
-                if ((prefix->s6_addr[i] & mask.s6_addr[i])
-                    != (bl_prefix.s6_addr[i] & mask.s6_addr[i])) {
-                    continue;
-                }
-            }
+        struct in6_addr masked = ipv6_addr_bitand(prefix, &p->mask);
+        if (ipv6_addr_equals(&masked, &p->prefix)) {
+            return true;
         }
-        matched = true;
-        break;
     }
-    free(start);
-    return matched;
+    return false;
 }
 
 static bool
@@ -1082,7 +1170,7 @@ route_need_advertise(const char *policy,
         return false;
     }
 
-    if (prefix_is_black_listed(nb_options, prefix, plen)) {
+    if (prefix_is_black_listed(&route_blacklist, prefix, plen)) {
         return false;
     }
     return true;
@@ -1243,7 +1331,7 @@ route_need_learn(const struct nbrec_logical_router *lr,
         return false;
     }
 
-    if (prefix_is_black_listed(nb_options, prefix, plen)) {
+    if (prefix_is_black_listed(&route_blacklist, prefix, plen)) {
         return false;
     }
 
@@ -1383,6 +1471,7 @@ sync_learned_routes(struct ic_context *ctx,
                 free(route_learned);
             } else {
                 /* Create the missing route in NB. */
+                COVERAGE_INC(ic_route_learn);
                 const struct nbrec_logical_router_static_route *nb_route =
                     nbrec_logical_router_static_route_insert(ctx->ovnnb_txn);
                 nbrec_logical_router_static_route_set_ip_prefix(nb_route,
@@ -1411,6 +1500,7 @@ sync_learned_routes(struct ic_context *ctx,
         VLOG_DBG("Delete route %s -> %s that is not in IC-SB from NB.",
                  route_learned->nb_route->ip_prefix,
                  route_learned->nb_route->nexthop);
+        COVERAGE_INC(ic_route_unlearn);
         nbrec_logical_router_update_static_routes_delvalue(
             ic_lr->lr, route_learned->nb_route);
         hmap_remove(&ic_lr->routes_learned, &route_learned->node);
@@ -1470,6 +1560,7 @@ advertise_routes(struct ic_context *ctx,
             VLOG_DBG("Delete route %s -> %s from IC-SB, which is not found"
                      " in local routes to be advertised.",
                      isb_route->ip_prefix, isb_route->nexthop);
+            COVERAGE_INC(ic_route_withdraw);
             icsbrec_route_delete(isb_route);
         } else {
             ad_route_sync_external_ids(route_adv, isb_route);
@@ -1483,6 +1574,7 @@ advertise_routes(struct ic_context *ctx,
     /* Create the missing routes in IC-SB */
     struct ic_route_info *route_adv;
     HMAP_FOR_EACH_SAFE (route_adv, node, routes_ad) {
+        COVERAGE_INC(ic_route_advertise);
         isb_route = icsbrec_route_insert(ctx->ovnisb_txn);
         icsbrec_route_set_transit_switch(isb_route, ts_name);
         icsbrec_route_set_availability_zone(isb_route, az);
@@ -1568,6 +1660,23 @@ build_ts_routes_to_adv(struct ic_context *ctx,
     }
 }
 
+static bool
+ic_router_is_selected(const struct ic_router_info *ic_lr,
+                      const struct hmapx *lrs, const struct sset *ts_names)
+{
+    if (lrs && hmapx_contains(lrs, ic_lr->lr)) {
+        return true;
+    }
+    if (ts_names) {
+        for (size_t i = 0; i < ic_lr->n_isb_pbs; i++) {
+            if (sset_contains(ts_names, ic_lr->isb_pbs[i]->transit_switch)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 static void
 advertise_lr_routes(struct ic_context *ctx,
                     const struct icsbrec_availability_zone *az,
@@ -1611,14 +1720,24 @@ advertise_lr_routes(struct ic_context *ctx,
     hmap_destroy(&routes_ad);
 }
 
+/* Syncs the routes of the interconnected logical routers of 'az'.  If 'lrs'
+ * or 'ts_names' is nonnull, only the routers in 'lrs' and the routers with a
+ * port on one of the transit switches named in 'ts_names' are synced,
+ * otherwise all of them are. */
 static void
-route_run(struct ic_context *ctx,
-          const struct icsbrec_availability_zone *az)
+route_sync(struct ic_context *ctx,
+           const struct icsbrec_availability_zone *az,
+           const struct hmapx *lrs, const struct sset *ts_names)
 {
     if (!ctx->ovnisb_txn || !ctx->ovnnb_txn) {
         return;
     }
 
+    const struct nbrec_nb_global *nb_global =
+        nbrec_nb_global_first(ctx->ovnnb_idl);
+    ovs_assert(nb_global);
+    route_blacklist_update(&route_blacklist, &nb_global->options);
+
     struct hmap ic_lrs = HMAP_INITIALIZER(&ic_lrs);
     const struct icsbrec_port_binding *isb_pb;
     const struct icsbrec_port_binding *isb_pb_key =
@@ -1675,8 +1794,11 @@ route_run(struct ic_context *ctx,
 
     struct ic_router_info *ic_lr;
     HMAP_FOR_EACH_SAFE (ic_lr, node, &ic_lrs) {
-        advertise_lr_routes(ctx, az, ic_lr);
-        sync_learned_routes(ctx, az, ic_lr);
+        if ((!lrs && !ts_names)
+            || ic_router_is_selected(ic_lr, lrs, ts_names)) {
+            advertise_lr_routes(ctx, az, ic_lr);
+            sync_learned_routes(ctx, az, ic_lr);
+        }
         free(ic_lr->isb_pbs);
         hmap_destroy(&ic_lr->routes_learned);
         hmap_remove(&ic_lrs, &ic_lr->node);
@@ -1685,22 +1807,149 @@ route_run(struct ic_context *ctx,
     hmap_destroy(&ic_lrs);
 }
 
+void
+route_run(struct ic_context *ctx,
+          const struct icsbrec_availability_zone *az)
+{
+    route_sync(ctx, az, NULL, NULL);
+}
+
+/* Syncs only the routes of the logical routers in 'lrs' and of the routers
+ * with a port on one of the transit switches named in 'ts_names', either of
+ * which may be null, after changes that cannot affect the other routers. */
+void
+route_run_for(struct ic_context *ctx,
+              const struct icsbrec_availability_zone *az,
+              const struct hmapx *lrs, const struct sset *ts_names)
+{
+    if ((lrs && !hmapx_is_empty(lrs))
+        || (ts_names && !sset_is_empty(ts_names))) {
+        route_sync(ctx, az, lrs, ts_names);
+    }
+}
+
+/* Adds to 'usage' the number of routes this availability zone advertises to
+ * the IC-SB and the number of routes it learned from the other zones. */
+static void
+get_route_usage(struct ovsdb_idl *ovnnb_idl, struct ovsdb_idl *ovnisb_idl,
+                struct simap *usage)
+{
+    const struct nbrec_nb_global *nb_global = nbrec_nb_global_first(ovnnb_idl);
+    if (!nb_global) {
+        return;
+    }
+
+    unsigned int n_advertised = 0;
+    const struct icsbrec_route *isb_route;
+    ICSBREC_ROUTE_FOR_EACH (isb_route, ovnisb_idl) {
+        if (isb_route->availability_zone
+            && !strcmp(isb_route->availability_zone->name, nb_global->name)) {
+            n_advertised++;
+        }
+    }
+
+    unsigned int n_learned = 0;
+    const struct nbrec_logical_router_static_route *nb_route;
+    NBREC_LOGICAL_ROUTER_STATIC_ROUTE_FOR_EACH (nb_route, ovnnb_idl) {
+        if (smap_get(&nb_route->external_ids, "ic-learned-route")) {
+            n_learned++;
+        }
+    }
+
+    simap_increase(usage, "ic-routes-advertised", n_advertised);
+    simap_increase(usage, "ic-routes-learned", n_learned);
+}
+
+/* The transit switches whose IC-SB routes are monitored, see
+ * update_isb_route_condition(). */
+static struct sset monitored_route_ts = SSET_INITIALIZER(&monitored_route_ts);
+static bool route_condition_set;
+
+/* Only the routes of the transit switches 'az' has ports on are advertised
+ * or learned, so only those are monitored in the IC-SB, instead of the
+ * routes of every availability zone of the deployment.  The routes of a
+ * transit switch show up, and are learned, once the first port of 'az' on
+ * it is created. */
 static void
-ovn_db_run(struct ic_context *ctx)
+update_isb_route_condition(struct ic_context *ctx,
+                           const struct icsbrec_availability_zone *az)
+{
+    struct sset ts_names = SSET_INITIALIZER(&ts_names);
+    const struct icsbrec_port_binding *isb_pb;
+    const struct icsbrec_port_binding *isb_pb_key =
+        icsbrec_port_binding_index_init_row(ctx->icsbrec_port_binding_by_az);
+    icsbrec_port_binding_index_set_availability_zone(isb_pb_key, az);
+    ICSBREC_PORT_BINDING_FOR_EACH_EQUAL (isb_pb, isb_pb_key,
+                                         ctx->icsbrec_port_binding_by_az) {
+        sset_add(&ts_names, isb_pb->transit_switch);
+    }
+    icsbrec_port_binding_index_destroy_row(isb_pb_key);
+
+    if (route_condition_set && sset_equals(&ts_names, &monitored_route_ts)) {
+        sset_destroy(&ts_names);
+        return;
+    }
+
+    struct ovsdb_idl_condition cond = OVSDB_IDL_CONDITION_INIT(&cond);
+    const char *ts_name;
+    SSET_FOR_EACH (ts_name, &ts_names) {
+        icsbrec_route_add_clause_transit_switch(&cond, OVSDB_F_EQ, ts_name);
+    }
+    icsbrec_route_set_condition(ctx->ovnisb_idl, &cond);
+    ovsdb_idl_condition_destroy(&cond);
+
+    sset_swap(&ts_names, &monitored_route_ts);
+    sset_destroy(&ts_names);
+    route_condition_set = true;
+}
+
+/* Runs the incremental processing engine, which syncs the transit switches,
+ * the gateways, the ports and the routes between the interconnection and the
+ * availability zone databases.  Returns false if it could not run, in which
+ * case a full recompute is needed the next time. */
+static bool
+ovn_db_run(struct ic_context *ctx, bool recompute)
 {
+    static struct uuid az_uuid;
+
     const struct icsbrec_availability_zone *az = az_run(ctx);
     VLOG_DBG("Availability zone: %s", az ? az->name : "not created yet.");
 
     if (!az) {
-        return;
+        return false;
+    }
+
+    /* Everything that is synced depends on the availability zone. */
+    if (!uuid_equals(&az->header_.uuid, &az_uuid)) {
+        az_uuid = az->header_.uuid;
+        recompute = true;
     }
 
-    ts_run(ctx);
-    gateway_run(ctx, az);
-    port_binding_run(ctx, az);
-    route_run(ctx, az);
+    ctx->az = az;
+    inc_proc_ic_run(ctx, recompute);
+    update_isb_route_condition(ctx, az);
+    return true;
 }
 
+/* Returns true if 'idl', connected to the database named 'db_name',
+ * reconnected since the last call, which resets its condition sequence
+ * number, stored in '*cond_seqno'. */
+static bool
+idl_reconnected(struct ovsdb_idl *idl, const char *db_name,
+                unsigned int *cond_seqno)
+{
+    unsigned int new_cond_seqno = ovsdb_idl_get_condition_seqno(idl);
+    if (new_cond_seqno == *cond_seqno) {
+        return false;
+    }
+    *cond_seqno = new_cond_seqno;
+    if (!new_cond_seqno) {
+        VLOG_INFO("%s IDL reconnected, force recompute.", db_name);
+        return true;
+    }
+    return false;
+}
+
 static void
 parse_options(int argc OVS_UNUSED, char *argv[] OVS_UNUSED)
 {
@@ -1873,6 +2122,13 @@ main(int argc, char *argv[])
     struct ovsdb_idl_loop ovnsb_idl_loop = OVSDB_IDL_LOOP_INITIALIZER(
         ovsdb_idl_create(ovnsb_db, &sbrec_idl_class, true, true));
 
+    /* The incremental processing engine relies on the changes tracked in
+     * the four databases. */
+    ovsdb_idl_track_add_all(ovninb_idl_loop.idl);
+    ovsdb_idl_track_add_all(ovnisb_idl_loop.idl);
+    ovsdb_idl_track_add_all(ovnnb_idl_loop.idl);
+    ovsdb_idl_track_add_all(ovnsb_idl_loop.idl);
+
     /* Create IDL indexes */
     struct ovsdb_idl_index *nbrec_ls_by_name
         = ovsdb_idl_index_create1(ovnnb_idl_loop.idl,
@@ -1916,17 +2172,33 @@ main(int argc, char *argv[])
                                   &icsbrec_route_col_transit_switch,
                                   &icsbrec_route_col_availability_zone);
 
+    inc_proc_ic_init(&ovnnb_idl_loop, &ovnsb_idl_loop,
+                     &ovninb_idl_loop, &ovnisb_idl_loop);
+
+    stopwatch_create(IC_LOOP_STOPWATCH_NAME, SW_MS);
+    stopwatch_create(IC_TS_RUN_STOPWATCH_NAME, SW_MS);
+    stopwatch_create(IC_GATEWAY_RUN_STOPWATCH_NAME, SW_MS);
+    stopwatch_create(IC_PORT_BINDING_RUN_STOPWATCH_NAME, SW_MS);
+    stopwatch_create(IC_ROUTE_RUN_STOPWATCH_NAME, SW_MS);
+
+    unsigned int ovnnb_cond_seqno = UINT_MAX;
+    unsigned int ovnsb_cond_seqno = UINT_MAX;
+    unsigned int ovninb_cond_seqno = UINT_MAX;
+    unsigned int ovnisb_cond_seqno = UINT_MAX;
+
     /* Main loop. */
     exiting = false;
     state.had_lock = false;
     state.paused = false;
+
+    bool recompute = false;
     while (!exiting) {
         update_ssl_config();
         memory_run();
         if (memory_should_report()) {
             struct simap usage = SIMAP_INITIALIZER(&usage);
 
-            /* Nothing special to report yet. */
+            get_route_usage(ovnnb_idl_loop.idl, ovnisb_idl_loop.idl, &usage);
             memory_report(&usage);
             simap_destroy(&usage);
         }
@@ -1965,6 +2237,19 @@ main(int argc, char *argv[])
                 .icsbrec_route_by_ts_az = icsbrec_route_by_ts_az,
             };
 
+            /* Check all of them, to keep their sequence numbers current. */
+            bool reconnected =
+                idl_reconnected(ctx.ovnnb_idl, "OVN NB", &ovnnb_cond_seqno);
+            reconnected |=
+                idl_reconnected(ctx.ovnsb_idl, "OVN SB", &ovnsb_cond_seqno);
+            reconnected |= idl_reconnected(ctx.ovninb_idl, "OVN IC-NB",
+                                           &ovninb_cond_seqno);
+            reconnected |= idl_reconnected(ctx.ovnisb_idl, "OVN IC-SB",
+                                           &ovnisb_cond_seqno);
+            if (reconnected) {
+                recompute = true;
+            }
+
             if (!state.had_lock && ovsdb_idl_has_lock(ovnsb_idl_loop.idl)) {
                 VLOG_INFO("ovn-ic lock acquired. "
                         "This ovn-ic instance is now active.");
@@ -1981,13 +2266,32 @@ main(int argc, char *argv[])
                 ovsdb_idl_has_ever_connected(ctx.ovnsb_idl) &&
                 ovsdb_idl_has_ever_connected(ctx.ovninb_idl) &&
                 ovsdb_idl_has_ever_connected(ctx.ovnisb_idl)) {
-                ovn_db_run(&ctx);
+                recompute = !ovn_db_run(&ctx, recompute);
+            } else {
+                /* Force a full recompute next time we become active. */
+                recompute = true;
             }
 
-            ovsdb_idl_loop_commit_and_wait(&ovnnb_idl_loop);
-            ovsdb_idl_loop_commit_and_wait(&ovnsb_idl_loop);
-            ovsdb_idl_loop_commit_and_wait(&ovninb_idl_loop);
-            ovsdb_idl_loop_commit_and_wait(&ovnisb_idl_loop);
+            /* If there are any errors, we force a full recompute in order
+             * to ensure we handle all changes. */
+            if (!ovsdb_idl_loop_commit_and_wait(&ovnnb_idl_loop)) {
+                VLOG_INFO("OVNNB commit failed, force recompute next time.");
+                recompute = true;
+            }
+            if (!ovsdb_idl_loop_commit_and_wait(&ovnsb_idl_loop)) {
+                VLOG_INFO("OVNSB commit failed, force recompute next time.");
+                recompute = true;
+            }
+            if (!ovsdb_idl_loop_commit_and_wait(&ovninb_idl_loop)) {
+                VLOG_INFO("OVN IC-NB commit failed, "
+                          "force recompute next time.");
+                recompute = true;
+            }
+            if (!ovsdb_idl_loop_commit_and_wait(&ovnisb_idl_loop)) {
+                VLOG_INFO("OVN IC-SB commit failed, "
+                          "force recompute next time.");
+                recompute = true;
+            }
         } else {
             /* ovn-ic is paused
              *    - we still want to handle any db updates and update the
@@ -2012,8 +2316,16 @@ main(int argc, char *argv[])
             ovsdb_idl_wait(ovnsb_idl_loop.idl);
             ovsdb_idl_wait(ovninb_idl_loop.idl);
             ovsdb_idl_wait(ovnisb_idl_loop.idl);
+
+            /* Force a full recompute next time we become active. */
+            recompute = true;
         }
 
+        ovsdb_idl_track_clear(ovnnb_idl_loop.idl);
+        ovsdb_idl_track_clear(ovnsb_idl_loop.idl);
+        ovsdb_idl_track_clear(ovninb_idl_loop.idl);
+        ovsdb_idl_track_clear(ovnisb_idl_loop.idl);
+
         unixctl_server_run(unixctl);
         unixctl_server_wait(unixctl);
         memory_wait();
@@ -2021,12 +2333,18 @@ main(int argc, char *argv[])
             poll_immediate_wake();
         }
 
+        stopwatch_stop(IC_LOOP_STOPWATCH_NAME, time_msec());
         poll_block();
         if (should_service_stop()) {
             exiting = true;
         }
+        stopwatch_start(IC_LOOP_STOPWATCH_NAME, time_msec());
     }
 
+    inc_proc_ic_cleanup();
+    route_blacklist_clear(&route_blacklist);
+    sset_destroy(&monitored_route_ts);
+
     unixctl_server_destroy(unixctl);
     ovsdb_idl_loop_destroy(&ovnnb_idl_loop);
     ovsdb_idl_loop_destroy(&ovnsb_idl_loop);
@@ -0,0 +1,59 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef OVN_IC_H
+#define OVN_IC_H 1
+
+#include "ovsdb-idl.h"
+
+struct hmapx;
+struct icsbrec_availability_zone;
+struct sset;
+
+struct ic_context {
+    struct ovsdb_idl *ovnnb_idl;
+    struct ovsdb_idl *ovnsb_idl;
+    struct ovsdb_idl *ovninb_idl;
+    struct ovsdb_idl *ovnisb_idl;
+    struct ovsdb_idl_txn *ovnnb_txn;
+    struct ovsdb_idl_txn *ovnsb_txn;
+    struct ovsdb_idl_txn *ovninb_txn;
+    struct ovsdb_idl_txn *ovnisb_txn;
+    struct ovsdb_idl_index *nbrec_ls_by_name;
+    struct ovsdb_idl_index *nbrec_lrp_by_name;
+    struct ovsdb_idl_index *nbrec_port_by_name;
+    struct ovsdb_idl_index *sbrec_chassis_by_name;
+    struct ovsdb_idl_index *sbrec_port_binding_by_name;
+    struct ovsdb_idl_index *icnbrec_transit_switch_by_name;
+    struct ovsdb_idl_index *icsbrec_port_binding_by_az;
+    struct ovsdb_idl_index *icsbrec_port_binding_by_ts;
+    struct ovsdb_idl_index *icsbrec_port_binding_by_ts_az;
+    struct ovsdb_idl_index *icsbrec_route_by_ts;
+    struct ovsdb_idl_index *icsbrec_route_by_ts_az;
+
+    /* The availability zone of this ovn-ic, set before the engine runs. */
+    const struct icsbrec_availability_zone *az;
+};
+
+void ts_run(struct ic_context *);
+void gateway_run(struct ic_context *,
+                 const struct icsbrec_availability_zone *);
+void port_binding_run(struct ic_context *,
+                      const struct icsbrec_availability_zone *);
+void route_run(struct ic_context *,
+               const struct icsbrec_availability_zone *);
+void route_run_for(struct ic_context *,
+                   const struct icsbrec_availability_zone *,
+                   const struct hmapx *lrs, const struct sset *ts_names);
+
+#endif /* OVN_IC_H */
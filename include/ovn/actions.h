@@ -683,6 +683,12 @@ enum action_opcode {
     /* put_fdb(inport, eth.src).
      */
     ACTION_OPCODE_PUT_FDB,
+
+    /* No OVN action generates this opcode: ovn-controller sends the packets
+     * that enter a lazy datapath to pinctrl with it, the datapath's tunnel
+     * key being in the metadata.
+     */
+    ACTION_OPCODE_LAZY_DATAPATH,
 };
 
 /* Header. */
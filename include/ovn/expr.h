@@ -262,6 +262,11 @@ struct expr_symbol {
     bool must_crossproduct;
     enum expr_write_scope rw; /* Bit map indicating in which nested contexts
                                * the symbol is writeable */
+
+    /* 'prereqs' and 'predicate' parsed and annotated once by
+     * expr_symtab_compile(), or NULL to parse them on each use. */
+    struct expr *prereqs_expr;
+    struct expr *predicate_expr;
 };
 
 void expr_symbol_format(const struct expr_symbol *, struct ds *);
@@ -316,6 +321,7 @@ struct expr_symbol *expr_symtab_add_predicate(struct shash *symtab,
 struct expr_symbol *expr_symtab_add_ovn_field(struct shash *symtab,
                                               const char *name,
                                               enum ovn_field_id id);
+void expr_symtab_compile(struct shash *symtab);
 void expr_symtab_destroy(struct shash *symtab);
 
 /* Expression type. */
@@ -461,6 +467,26 @@ bool expr_evaluate(const struct expr *, const struct flow *uflow,
                    bool (*lookup_port)(const void *aux, const char *port_name,
                                        unsigned int *portp),
                    const void *aux);
+
+/* An expression compiled for repeated evaluation, see
+ * expr_program_compile(). */
+struct expr_program;
+
+struct expr_program *expr_program_compile(const struct expr *);
+void expr_program_destroy(struct expr_program *);
+bool expr_program_evaluate(const struct expr_program *,
+                           const struct flow *uflow,
+                           bool (*lookup_port)(const void *aux,
+                                               const char *port_name,
+                                               unsigned int *portp),
+                           const void *aux);
+void expr_program_evaluate_batch(const struct expr_program *,
+                                 const struct flow *uflows, size_t n,
+                                 bool *results,
+                                 bool (*lookup_port)(const void *aux,
+                                                     const char *port_name,
+                                                     unsigned int *portp),
+                                 const void *aux);
 
 /* Converting expressions to OpenFlow flows. */
 
@@ -484,6 +510,7 @@ uint32_t expr_to_matches(const struct expr *,
                                              unsigned int *portp),
                          const void *aux,
                          struct hmap *matches);
+bool expr_set_flow_optimization(bool enable);
 void expr_match_destroy(struct expr_match *);
 void expr_matches_destroy(struct hmap *matches);
 size_t expr_matches_prepare(struct hmap *matches, uint32_t conj_id_ofs);
@@ -548,6 +575,12 @@ void expr_constant_set_integers_diff(
                                 struct expr_constant_set *new,
                                 struct expr_constant_set **p_diff_added,
                                 struct expr_constant_set **p_diff_deleted);
+void expr_constant_set_integers_update(
+                                struct expr_constant_set *cs,
+                                const char *const *added, size_t n_added,
+                                const char *const *deleted, size_t n_deleted,
+                                struct expr_constant_set **p_diff_added,
+                                struct expr_constant_set **p_diff_deleted);
 
 
 /* Constant sets.
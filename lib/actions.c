@@ -1370,29 +1370,36 @@ encode_ct_lb(const struct ovnact_ct_lb *cl,
     BUILD_ASSERT(MFF_LOG_CT_ZONE < MFF_REG0 + FLOW_N_REGS);
     BUILD_ASSERT(MFF_LOG_DNAT_ZONE >= MFF_REG0);
     BUILD_ASSERT(MFF_LOG_DNAT_ZONE < MFF_REG0 + FLOW_N_REGS);
+
+    /* The buckets only differ by their id and NAT destination, so format the
+     * rest of their actions once.  Load balancers can have thousands of
+     * backends and this is done for each datapath that uses them. */
+    struct ds bucket_suffix = DS_EMPTY_INITIALIZER;
+    ds_put_format(&bucket_suffix,
+                  "),commit,table=%d,zone=NXM_NX_REG%d[0..15],"
+                  "exec(set_field:"
+                    OVN_CT_MASKED_STR(OVN_CT_NATTED)
+                  "->%s))",
+                  recirc_table, zone_reg,
+                  ct_lb_mark ? "ct_mark" : "ct_label");
+
+    /* Room for the bucket id, "[ipv6]:port" and the fixed text. */
+    ds_reserve(&ds, ds.length + cl->n_dsts * (bucket_suffix.length + 112));
     for (size_t bucket_id = 0; bucket_id < cl->n_dsts; bucket_id++) {
         const struct ovnact_ct_lb_dst *dst = &cl->dsts[bucket_id];
-        char ip_addr[INET6_ADDRSTRLEN];
+        ds_put_format(&ds, ",bucket=bucket_id=%"PRIuSIZE",weight:100,actions="
+                      "ct(nat(dst=", bucket_id);
         if (dst->family == AF_INET) {
-            inet_ntop(AF_INET, &dst->ipv4, ip_addr, sizeof ip_addr);
+            ds_put_format(&ds, IP_FMT, IP_ARGS(dst->ipv4));
         } else {
-            inet_ntop(AF_INET6, &dst->ipv6, ip_addr, sizeof ip_addr);
+            ipv6_format_addr_bracket(&dst->ipv6, &ds, dst->port != 0);
         }
-        ds_put_format(&ds, ",bucket=bucket_id=%"PRIuSIZE",weight:100,actions="
-                      "ct(nat(dst=%s%s%s", bucket_id,
-                      dst->family == AF_INET6 && dst->port ? "[" : "",
-                      ip_addr,
-                      dst->family == AF_INET6 && dst->port ? "]" : "");
         if (dst->port) {
             ds_put_format(&ds, ":%"PRIu16, dst->port);
         }
-        ds_put_format(&ds, "),commit,table=%d,zone=NXM_NX_REG%d[0..15],"
-                      "exec(set_field:"
-                        OVN_CT_MASKED_STR(OVN_CT_NATTED)
-                      "->%s))",
-                      recirc_table, zone_reg,
-                      ct_lb_mark ? "ct_mark" : "ct_label");
+        ds_put_buffer(&ds, bucket_suffix.string, bucket_suffix.length);
     }
+    ds_destroy(&bucket_suffix);
 
     table_id = ovn_extend_table_assign_id(ep->group_table, ds_cstr(&ds),
                                           ep->lflow_uuid);
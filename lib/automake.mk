@@ -33,6 +33,7 @@ lib_libovn_la_SOURCES = \
 	lib/ovn-l7.c \
 	lib/ovn-util.c \
 	lib/ovn-util.h \
+	lib/ovn-usdt-probes.h \
 	lib/logical-fields.c \
 	lib/inc-proc-eng.c \
 	lib/inc-proc-eng.h \
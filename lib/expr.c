@@ -16,6 +16,8 @@
 
 #include <config.h>
 #include "byte-order.h"
+#include "coverage.h"
+#include "hash.h"
 #include "openvswitch/json.h"
 #include "nx-match.h"
 #include "openvswitch/dynamic-string.h"
@@ -33,10 +35,22 @@
 
 VLOG_DEFINE_THIS_MODULE(expr);
 
+/* Number of OpenFlow flows avoided by the flow optimizations that
+ * expr_set_flow_optimization() enables. */
+COVERAGE_DEFINE(expr_flows_saved);
+
+/* If true, expr_normalize() merges the constants of disjunctions into
+ * prefixes and expr_to_matches() prefers a cross product over a conjunctive
+ * match when that results in fewer flows. */
+static bool flow_optimization = false;
+
 static struct expr *parse_and_annotate(const char *s,
                                        const struct shash *symtab,
                                        struct ovs_list *nesting,
                                        char **errorp);
+static struct expr *symbol_expand(const char *s, const struct expr *compiled,
+                                  const struct shash *symtab,
+                                  struct ovs_list *nesting, char **errorp);
 
 /* Returns the name of measurement level 'level'. */
 const char *
@@ -1209,6 +1223,108 @@ expr_constant_set_integers_diff(struct expr_constant_set *old,
     *p_diff_deleted = diff_deleted;
 }
 
+static bool
+expr_constant_set_integers_contains(const struct expr_constant_set *cs,
+                                    const union expr_constant *c)
+{
+    return bsearch(c, cs->values, cs->n_values, sizeof *cs->values,
+                   compare_expr_constant_integer_cb) != NULL;
+}
+
+/* Updates 'cs', an integer constant set sorted as by
+ * expr_constant_set_create_integers(), by removing the constants that the
+ * strings in 'deleted' convert to and adding the ones that the strings in
+ * 'added' convert to, without converting the unchanged constants again.  'cs'
+ * stays sorted.  This takes time linear in the size of 'cs' for moving the
+ * constants, but only converts and searches the changes, so it is much cheaper
+ * than rebuilding a large set for a small change.
+ *
+ * 'cs' keeps one constant per string it was built from, even if several
+ * strings convert to the same constant, e.g. "10.0.0.1" and "10.0.0.01", so
+ * that deleting one of the strings doesn't delete the constant.
+ *
+ * The constants that were not in 'cs' before and the ones that are not in it
+ * anymore are stored in '*p_diff_added' and '*p_diff_deleted' respectively,
+ * as by expr_constant_set_integers_diff(). */
+void
+expr_constant_set_integers_update(struct expr_constant_set *cs,
+                                  const char *const *added, size_t n_added,
+                                  const char *const *deleted, size_t n_deleted,
+                                  struct expr_constant_set **p_diff_added,
+                                  struct expr_constant_set **p_diff_deleted)
+{
+    struct expr_constant_set *add = expr_constant_set_create_integers(
+        added, n_added);
+    struct expr_constant_set *del = expr_constant_set_create_integers(
+        deleted, n_deleted);
+    struct expr_constant_set *diff_added = NULL;
+    struct expr_constant_set *diff_deleted = NULL;
+    size_t added_n_allocated = 0, deleted_n_allocated = 0;
+
+    /* Constants that are new to 'cs', once each. */
+    for (size_t i = 0; i < add->n_values; i++) {
+        if ((!i || compare_expr_constant_integer_cb(&add->values[i - 1],
+                                                    &add->values[i]))
+            && !expr_constant_set_integers_contains(cs, &add->values[i])) {
+            expr_constant_set_add_value(&diff_added, &add->values[i],
+                                        &added_n_allocated);
+        }
+    }
+
+    /* Remove one instance of each deleted constant, in place. */
+    size_t n = 0;
+    size_t di = 0;
+    for (size_t oi = 0; oi < cs->n_values; oi++) {
+        int d = -1;
+        while (di < del->n_values
+               && (d = compare_expr_constant_integer_cb(&del->values[di],
+                                                        &cs->values[oi]))
+                  < 0) {
+            /* Not in 'cs', e.g. it failed to convert when it was added. */
+            di++;
+        }
+        if (di < del->n_values && !d) {
+            di++;
+        } else {
+            cs->values[n++] = cs->values[oi];
+        }
+    }
+
+    /* Merge the added constants, from the end, in place. */
+    cs->values = xrealloc(cs->values,
+                          (n + add->n_values) * sizeof *cs->values);
+    size_t oi = n;
+    size_t ai = add->n_values;
+    cs->n_values = n + add->n_values;
+    for (size_t i = cs->n_values; ai > 0; i--) {
+        if (oi > 0 && compare_expr_constant_integer_cb(&cs->values[oi - 1],
+                                                       &add->values[ai - 1])
+                      > 0) {
+            cs->values[i - 1] = cs->values[--oi];
+        } else {
+            cs->values[i - 1] = add->values[--ai];
+        }
+    }
+
+    /* Constants that are gone from 'cs', once each. */
+    for (size_t i = 0; i < del->n_values; i++) {
+        if ((!i || compare_expr_constant_integer_cb(&del->values[i - 1],
+                                                    &del->values[i]))
+            && !expr_constant_set_integers_contains(cs, &del->values[i])) {
+            expr_constant_set_add_value(&diff_deleted, &del->values[i],
+                                        &deleted_n_allocated);
+        }
+    }
+
+    expr_constant_set_destroy(add);
+    free(add);
+    expr_constant_set_destroy(del);
+    free(del);
+
+    *p_diff_added = diff_added;
+    *p_diff_deleted = diff_deleted;
+}
+
 
 /* Adds an constant set named 'name' to 'const_sets', replacing any existing
  * constant set entry with the given name. */
@@ -1573,8 +1689,9 @@ expr_field_parse(struct lexer *lexer, const struct shash *symtab,
             if (symbol->prereqs) {
                 char *error;
                 struct ovs_list nesting = OVS_LIST_INITIALIZER(&nesting);
-                struct expr *e = parse_and_annotate(symbol->prereqs, symtab,
-                                                    &nesting, &error);
+                struct expr *e = symbol_expand(symbol->prereqs,
+                                               symbol->prereqs_expr, symtab,
+                                               &nesting, &error);
                 if (error) {
                     lexer_error(lexer, "%s", error);
                     free(error);
@@ -1830,6 +1947,8 @@ expr_symtab_destroy(struct shash *symtab)
         free(symbol->name);
         free(symbol->prereqs);
         free(symbol->predicate);
+        expr_destroy(symbol->prereqs_expr);
+        expr_destroy(symbol->predicate_expr);
         free(symbol);
     }
 }
@@ -1964,6 +2083,55 @@ parse_and_annotate(const char *s, const struct shash *symtab,
     return expr;
 }
 
+/* Returns the annotated expression for 'compiled', the parsed form of 's'
+ * if it was precompiled by expr_symtab_compile(), otherwise parses 's'. */
+static struct expr *
+symbol_expand(const char *s, const struct expr *compiled,
+              const struct shash *symtab, struct ovs_list *nesting,
+              char **errorp)
+{
+    if (compiled) {
+        *errorp = NULL;
+        return expr_clone(CONST_CAST(struct expr *, compiled));
+    }
+    return parse_and_annotate(s, symtab, nesting, errorp);
+}
+
+/* Parses and annotates once the prerequisites and the predicates of the
+ * symbols in 'symtab', so that annotating an expression clones them instead
+ * of lexing and parsing their strings again for each reference to the
+ * symbols.  Must be called after adding all the symbols to 'symtab' and
+ * before using it from several threads.
+ *
+ * Symbols whose expansion fails, e.g. because it's recursive, are left
+ * alone, so that the error is reported when they are used. */
+void
+expr_symtab_compile(struct shash *symtab)
+{
+    struct shash_node *node;
+
+    SHASH_FOR_EACH (node, symtab) {
+        struct expr_symbol *symbol = node->data;
+        struct ovs_list nesting = OVS_LIST_INITIALIZER(&nesting);
+        struct annotation_nesting an = { .symbol = symbol };
+        char *error;
+
+        ovs_list_push_back(&nesting, &an.node);
+        if (symbol->prereqs && !symbol->prereqs_expr) {
+            symbol->prereqs_expr = parse_and_annotate(symbol->prereqs, symtab,
+                                                      &nesting, &error);
+            free(error);
+        }
+        if (symbol->predicate && !symbol->predicate_expr) {
+            symbol->predicate_expr = parse_and_annotate(symbol->predicate,
+                                                        symtab, &nesting,
+                                                        &error);
+            free(error);
+        }
+        ovs_list_remove(&an.node);
+    }
+}
+
 static struct expr *
 expr_annotate_cmp(struct expr *expr, const struct shash *symtab,
                   bool append_prereqs, struct ovs_list *nesting, char **errorp)
@@ -1985,7 +2153,8 @@ expr_annotate_cmp(struct expr *expr, const struct shash *symtab,
 
     struct expr *prereqs = NULL;
     if (append_prereqs && symbol->prereqs) {
-        prereqs = parse_and_annotate(symbol->prereqs, symtab, nesting, errorp);
+        prereqs = symbol_expand(symbol->prereqs, symbol->prereqs_expr, symtab,
+                                nesting, errorp);
         if (!prereqs) {
             goto error;
         }
@@ -1998,8 +2167,8 @@ expr_annotate_cmp(struct expr *expr, const struct shash *symtab,
     } else if (symbol->predicate) {
         struct expr *predicate;
 
-        predicate = parse_and_annotate(symbol->predicate, symtab,
-                                       nesting, errorp);
+        predicate = symbol_expand(symbol->predicate, symbol->predicate_expr,
+                                  symtab, nesting, errorp);
         if (!predicate) {
             goto error;
         }
@@ -2034,7 +2203,8 @@ expr_append_prereqs(struct expr *expr, const struct expr_symbol *symbol,
     struct expr *prereqs = NULL;
 
     if (symbol->prereqs) {
-        prereqs = parse_and_annotate(symbol->prereqs, symtab, nesting, errorp);
+        prereqs = symbol_expand(symbol->prereqs, symbol->prereqs_expr, symtab,
+                                nesting, errorp);
         if (!prereqs) {
             expr_destroy(expr);
             return NULL;
@@ -2705,6 +2875,257 @@ compare_cmps_cb(const void *a_, const void *b_)
     return compare_cmps_3way(a, b);
 }
 
+/* Minimum number of cmps in a disjunction for crush_or() to sort them with
+ * sort_unique_packed_cmps() instead of qsort(). */
+#define PACKED_CMPS_MIN 64
+
+/* A numeric cmp against a symbol at most 128 bits wide, packed for
+ * sort_unique_packed_cmps().  'words' holds the last 128 bits of the value
+ * and then of the mask, most significant word first and in host byte order,
+ * so that comparing the words in order gives the same result as
+ * compare_cmps_3way(): all the other bits are zero. */
+struct packed_cmp {
+    uint64_t words[4];
+    struct expr *cmp;
+};
+
+static bool
+packed_cmps_equal(const struct packed_cmp *a, const struct packed_cmp *b)
+{
+    return !((a->words[0] ^ b->words[0]) | (a->words[1] ^ b->words[1])
+             | (a->words[2] ^ b->words[2]) | (a->words[3] ^ b->words[3]));
+}
+
+/* Sorts the 'n' numeric cmps in 'subs', which must all be against the same
+ * symbol at most 128 bits wide, in the order of compare_cmps_cb(), and
+ * destroys the duplicates.  Returns the number of cmps left at the beginning
+ * of 'subs'.
+ *
+ * This is a least significant digit radix sort on the packed cmps, one byte
+ * at a time.  The bytes that are the same in all the cmps, such as the mask
+ * of a set of host addresses or all but the last 4 bytes of the value of an
+ * IPv4 address, don't need a pass, so a large IPv4 address set only takes 4
+ * linear passes. */
+static size_t
+sort_unique_packed_cmps(struct expr **subs, size_t n)
+{
+    struct packed_cmp *cmps = xmalloc(n * sizeof *cmps);
+    struct packed_cmp *tmp = xmalloc(n * sizeof *tmp);
+
+    for (size_t i = 0; i < n; i++) {
+        const union mf_subvalue *value = &subs[i]->cmp.value;
+        const union mf_subvalue *mask = &subs[i]->cmp.mask;
+        size_t last = ARRAY_SIZE(value->be64) - 1;
+
+        cmps[i].words[0] = ntohll(value->be64[last - 1]);
+        cmps[i].words[1] = ntohll(value->be64[last]);
+        cmps[i].words[2] = ntohll(mask->be64[last - 1]);
+        cmps[i].words[3] = ntohll(mask->be64[last]);
+        cmps[i].cmp = subs[i];
+    }
+
+    /* Find the bits that differ between at least two of the cmps. */
+    uint64_t diff[4] = { 0, 0, 0, 0 };
+    for (size_t i = 1; i < n; i++) {
+        for (size_t w = 0; w < 4; w++) {
+            diff[w] |= cmps[i].words[w] ^ cmps[0].words[w];
+        }
+    }
+
+    for (int w = 3; w >= 0; w--) {
+        for (int shift = 0; shift < 64; shift += 8) {
+            if (!((diff[w] >> shift) & 0xff)) {
+                continue;
+            }
+
+            size_t ofs[256];
+            memset(ofs, 0, sizeof ofs);
+            for (size_t i = 0; i < n; i++) {
+                ofs[(cmps[i].words[w] >> shift) & 0xff]++;
+            }
+            for (size_t d = 0, total = 0; d < 256; d++) {
+                size_t count = ofs[d];
+                ofs[d] = total;
+                total += count;
+            }
+            for (size_t i = 0; i < n; i++) {
+                tmp[ofs[(cmps[i].words[w] >> shift) & 0xff]++] = cmps[i];
+            }
+
+            struct packed_cmp *swap = cmps;
+            cmps = tmp;
+            tmp = swap;
+        }
+    }
+
+    /* Duplicates are now adjacent. */
+    size_t n_unique = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (n_unique && packed_cmps_equal(&cmps[i], &cmps[i - 1])) {
+            expr_destroy(cmps[i].cmp);
+        } else {
+            subs[n_unique++] = cmps[i].cmp;
+        }
+    }
+
+    free(cmps);
+    free(tmp);
+    return n_unique;
+}
+
+/* A cmp in the hash table used by crush_or_merge(), keyed on its value and
+ * mask. */
+struct cmp_node {
+    struct hmap_node hmap_node;
+    struct expr *cmp;
+};
+
+static uint32_t
+hash_cmp_value_mask(const union mf_subvalue *value,
+                    const union mf_subvalue *mask)
+{
+    return hash_bytes(value, sizeof *value,
+                      hash_bytes(mask, sizeof *mask, 0));
+}
+
+static struct cmp_node *
+cmp_node_find(const struct hmap *cmps, const union mf_subvalue *value,
+              const union mf_subvalue *mask)
+{
+    struct cmp_node *node;
+    HMAP_FOR_EACH_WITH_HASH (node, hmap_node,
+                             hash_cmp_value_mask(value, mask), cmps) {
+        if (!memcmp(&node->cmp->cmp.value, value, sizeof *value)
+            && !memcmp(&node->cmp->cmp.mask, mask, sizeof *mask)) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+static void
+cmp_node_destroy(struct hmap *cmps, struct cmp_node *node)
+{
+    hmap_remove(cmps, &node->hmap_node);
+    expr_destroy(node->cmp);
+    free(node);
+}
+
+/* Takes ownership of 'expr', a disjunction of distinct numeric cmps against
+ * 'symbol', and rewrites it into as few masked cmps as possible:
+ *
+ *     - Two cmps with the same mask whose values only differ in the lowest
+ *       bit of the mask are replaced by a single cmp that doesn't match on
+ *       that bit, repeatedly, so that e.g. "tcp.dst == {4, 5, 6, 7}" becomes
+ *       "tcp.dst == 4/0xfffc".
+ *
+ *     - A cmp that is covered by a wider one, e.g. "ip4.src == 10.0.0.1" next
+ *       to "ip4.src == 10.0.0.0/24", is dropped.
+ *
+ * Each cmp eliminated this way saves one flow (or more, if the disjunction
+ * ends up in a cross product).  Returns the rewritten expression. */
+static struct expr *
+crush_or_merge(struct expr *expr, const struct expr_symbol *symbol)
+{
+    struct hmap cmps = HMAP_INITIALIZER(&cmps);
+    size_t n = ovs_list_size(&expr->andor);
+    unsigned int width = symbol->width;
+    bool multiple_masks = false;
+
+    struct expr *sub;
+    LIST_FOR_EACH_POP (sub, node, &expr->andor) {
+        union mf_subvalue *value = &sub->cmp.value;
+        union mf_subvalue *mask = &sub->cmp.mask;
+
+        unsigned int low = bitwise_scan(mask, sizeof *mask, true, 0, width);
+        if (low < width) {
+            union mf_subvalue buddy = *value;
+            bitwise_toggle_bit(&buddy, sizeof buddy, low);
+
+            struct cmp_node *node = cmp_node_find(&cmps, &buddy, mask);
+            if (node) {
+                cmp_node_destroy(&cmps, node);
+                bitwise_zero(value, sizeof *value, low, 1);
+                bitwise_zero(mask, sizeof *mask, low, 1);
+
+                /* The merged cmp might have a buddy of its own. */
+                ovs_list_push_back(&expr->andor, &sub->node);
+                multiple_masks = true;
+                continue;
+            }
+        }
+
+        if (cmp_node_find(&cmps, value, mask)) {
+            /* Merging produced a cmp that was already there. */
+            expr_destroy(sub);
+            continue;
+        }
+
+        struct cmp_node *node = xmalloc(sizeof *node);
+        node->cmp = sub;
+        hmap_insert(&cmps, &node->hmap_node, hash_cmp_value_mask(value, mask));
+
+        if (!multiple_masks && hmap_count(&cmps) > 1) {
+            struct cmp_node *first = CONTAINER_OF(hmap_first(&cmps),
+                                                  struct cmp_node, hmap_node);
+            multiple_masks = memcmp(&first->cmp->cmp.mask, mask,
+                                    sizeof *mask) != 0;
+        }
+    }
+
+    /* Drop the cmps covered by a wider one.  That can only happen if not all
+     * of the cmps have the same mask. */
+    if (multiple_masks) {
+        struct cmp_node *node;
+        HMAP_FOR_EACH_SAFE (node, hmap_node, &cmps) {
+            union mf_subvalue value = node->cmp->cmp.value;
+            union mf_subvalue mask = node->cmp->cmp.mask;
+
+            for (unsigned int i = bitwise_scan(&mask, sizeof mask, true, 0,
+                                               width);
+                 i < width;
+                 i = bitwise_scan(&mask, sizeof mask, true, i + 1, width)) {
+                bitwise_zero(&value, sizeof value, i, 1);
+                bitwise_zero(&mask, sizeof mask, i, 1);
+                if (cmp_node_find(&cmps, &value, &mask)) {
+                    cmp_node_destroy(&cmps, node);
+                    break;
+                }
+            }
+        }
+    }
+
+    /* Put the remaining cmps back in the usual sorted order. */
+    size_t n_subs = hmap_count(&cmps);
+    struct expr **subs = xmalloc(n_subs * sizeof *subs);
+    struct cmp_node *node;
+    size_t i = 0;
+    HMAP_FOR_EACH_POP (node, hmap_node, &cmps) {
+        subs[i++] = node->cmp;
+        free(node);
+    }
+    hmap_destroy(&cmps);
+
+    qsort(subs, n_subs, sizeof *subs, compare_cmps_cb);
+    for (i = 0; i < n_subs; i++) {
+        ovs_list_push_back(&expr->andor, &subs[i]->node);
+    }
+    free(subs);
+
+    COVERAGE_ADD(expr_flows_saved, n - n_subs);
+
+    /* If everything merged into a single cmp that doesn't match on any bit,
+     * then the disjunction is always true. */
+    if (n_subs == 1) {
+        sub = expr_from_node(ovs_list_front(&expr->andor));
+        if (is_all_zeros(&sub->cmp.mask, sizeof sub->cmp.mask)) {
+            expr_destroy(expr);
+            return expr_create_boolean(true);
+        }
+    }
+    return expr;
+}
+
 /* Implementation of crush_cmps() for expr->type == EXPR_T_OR. */
 static struct expr *
 crush_or(struct expr *expr, const struct expr_symbol *symbol)
@@ -2734,24 +3155,44 @@ crush_or(struct expr *expr, const struct expr_symbol *symbol)
     }
     ovs_assert(i == n);
 
-    qsort(subs, n, sizeof *subs, compare_cmps_cb);
-
-    /* Eliminate duplicates. */
     ovs_list_init(&expr->andor);
-    ovs_list_push_back(&expr->andor, &subs[0]->node);
-    for (i = 1; i < n; i++) {
-        struct expr *a = expr_from_node(ovs_list_back(&expr->andor));
-        struct expr *b = subs[i];
-        if (compare_cmps_3way(a, b)) {
-            ovs_list_push_back(&expr->andor, &b->node);
-        } else {
-            expr_destroy(b);
+    if (symbol->width && symbol->width <= 128 && n >= PACKED_CMPS_MIN) {
+        /* Large sets of numeric constants, typically from address sets, are
+         * faster to sort and deduplicate in packed form. */
+        size_t n_unique = sort_unique_packed_cmps(subs, n);
+        for (i = 0; i < n_unique; i++) {
+            ovs_list_push_back(&expr->andor, &subs[i]->node);
+        }
+        if (n_unique < n) {
             /* Member modified, so untrack address set. */
             free(expr->as_name);
             expr->as_name = NULL;
         }
+    } else {
+        qsort(subs, n, sizeof *subs, compare_cmps_cb);
+
+        /* Eliminate duplicates. */
+        ovs_list_push_back(&expr->andor, &subs[0]->node);
+        for (i = 1; i < n; i++) {
+            struct expr *a = expr_from_node(ovs_list_back(&expr->andor));
+            struct expr *b = subs[i];
+            if (compare_cmps_3way(a, b)) {
+                ovs_list_push_back(&expr->andor, &b->node);
+            } else {
+                expr_destroy(b);
+                /* Member modified, so untrack address set. */
+                free(expr->as_name);
+                expr->as_name = NULL;
+            }
+        }
     }
     free(subs);
+
+    /* Tracked address sets are left alone, so that their members can still
+     * be added and removed incrementally, flow by flow. */
+    if (flow_optimization && symbol->width && !expr->as_name) {
+        expr = crush_or_merge(expr, symbol);
+    }
     return expr_fix(expr);
 }
 
@@ -3167,6 +3608,71 @@ add_disjunction(const struct expr *or,
     return n > 0;
 }
 
+/* Adds to 'matches' one flow, on top of 'm', for each combination of the
+ * cmps in the 'n_ors' disjunctions in 'ors'. */
+static void
+add_crossproduct(const struct expr **ors, size_t n_ors,
+                 bool (*lookup_port)(const void *aux, const char *port_name,
+                                     unsigned int *portp),
+                 const void *aux, const struct match *m,
+                 struct hmap *matches)
+{
+    if (!n_ors) {
+        expr_match_add(matches, expr_match_new(m, 0, 0, 0));
+        return;
+    }
+
+    const struct expr *sub;
+    LIST_FOR_EACH (sub, node, &ors[0]->andor) {
+        struct match match = *m;
+        if (constrain_match(sub, lookup_port, aux, &match)) {
+            add_crossproduct(ors + 1, n_ors - 1, lookup_port, aux, &match,
+                             matches);
+        }
+    }
+}
+
+/* Returns true if the 'n_ors' disjunctions in 'ors' take fewer flows as a
+ * cross product than as a conjunctive match, which takes one flow per cmp
+ * plus the conj_id flow.  That's only considered with flow optimization
+ * enabled, and only if the disjunctions are on different fields and none of
+ * them is a tracked address set. */
+static bool
+use_crossproduct(const struct expr **ors, size_t n_ors)
+{
+    if (!flow_optimization) {
+        return false;
+    }
+
+    size_t n_conj_flows = 1;
+    for (size_t i = 0; i < n_ors; i++) {
+        if (ors[i]->as_name) {
+            return false;
+        }
+
+        const struct expr *a = expr_from_node(ovs_list_front(&ors[i]->andor));
+        for (size_t j = 0; j < i; j++) {
+            const struct expr *b
+                = expr_from_node(ovs_list_front(&ors[j]->andor));
+            if (a->cmp.symbol->field == b->cmp.symbol->field) {
+                return false;
+            }
+        }
+        n_conj_flows += ovs_list_size(&ors[i]->andor);
+    }
+
+    size_t n_product_flows = 1;
+    for (size_t i = 0; i < n_ors; i++) {
+        n_product_flows *= ovs_list_size(&ors[i]->andor);
+        if (n_product_flows >= n_conj_flows) {
+            return false;
+        }
+    }
+
+    COVERAGE_ADD(expr_flows_saved, n_conj_flows - n_product_flows);
+    return true;
+}
+
 static void
 add_conjunction(const struct expr *and,
                 bool (*lookup_port)(const void *aux, const char *port_name,
@@ -3208,7 +3714,22 @@ add_conjunction(const struct expr *and,
             }
         }
     } else {
+        const struct expr **ors = xmalloc(n_clauses * sizeof *ors);
         int clause = 0;
+        LIST_FOR_EACH (sub, node, &and->andor) {
+            if (sub->type == EXPR_T_OR) {
+                ors[clause++] = sub;
+            }
+        }
+        if (use_crossproduct(ors, n_clauses)) {
+            add_crossproduct(ors, n_clauses, lookup_port, aux, &match,
+                             matches);
+            free(ors);
+            return;
+        }
+        free(ors);
+
+        clause = 0;
         (*n_conjsp)++;
         LIST_FOR_EACH (sub, node, &and->andor) {
             if (sub->type == EXPR_T_OR) {
@@ -3245,6 +3766,22 @@ add_cmp_flow(const struct expr *cmp,
     }
 }
 
+/* Enables or disables the optimizations that make expr_normalize() and
+ * expr_to_matches() produce fewer OpenFlow flows for the same expression, at
+ * some extra cost in CPU time.  Their savings are counted by the
+ * "expr_flows_saved" coverage counter.  Returns true if the setting changed,
+ * in which case previously generated flows might differ from the ones
+ * generated from now on. */
+bool
+expr_set_flow_optimization(bool enable)
+{
+    if (flow_optimization == enable) {
+        return false;
+    }
+    flow_optimization = enable;
+    return true;
+}
+
 /* Converts 'expr', which must be in the form returned by expr_normalize(), to
  * a collection of Open vSwitch flows in 'matches', which this function
  * initializes to an hmap of "struct expr_match" structures.  Returns the
@@ -3591,6 +4128,191 @@ expr_evaluate(const struct expr *e, const struct flow *uflow,
     }
 }
 
+/* Compiled expressions.
+ *
+ * expr_program_compile() flattens an expression into an array of
+ * comparisons, each of which names the comparison to evaluate next, or the
+ * result, depending on its outcome.  The program gives the same results as
+ * expr_evaluate(), short-circuits the same way, but evaluating it needs
+ * neither recursion nor walking lists, and the constants are already laid out
+ * the way mf_get_value() returns the fields.  This is meant for evaluating the
+ * same expression against many microflows, as ovn-trace and the exhaustive
+ * tests do. */
+
+/* Targets of 'struct expr_insn' that are results rather than other
+ * comparisons. */
+#define EXPR_PROGRAM_FALSE UINT32_MAX
+#define EXPR_PROGRAM_TRUE (UINT32_MAX - 1)
+
+struct expr_insn {
+    const struct mf_field *field;
+    enum expr_relop relop;
+    char *string;               /* Port name, for a string field. */
+    union mf_value value;       /* Masked constant, for other fields. */
+    union mf_value mask;
+    uint32_t if_true;           /* Next comparison, or result, if true. */
+    uint32_t if_false;          /* Same, if false. */
+};
+
+struct expr_program {
+    struct expr_insn *insns;
+    size_t n_insns, allocated_insns;
+    uint32_t start;             /* First comparison, or the result. */
+};
+
+/* Compiles 'e' into 'prog' so that it continues at 'if_true' or 'if_false'
+ * depending on its value, and returns where its evaluation starts.  The
+ * comparisons only ever jump to comparisons added before them. */
+static uint32_t
+expr_program_compile__(struct expr_program *prog, const struct expr *e,
+                       uint32_t if_true, uint32_t if_false)
+{
+    switch (e->type) {
+    case EXPR_T_CMP: {
+        if (prog->n_insns >= prog->allocated_insns) {
+            prog->insns = x2nrealloc(prog->insns, &prog->allocated_insns,
+                                     sizeof *prog->insns);
+        }
+
+        const struct mf_field *field = e->cmp.symbol->field;
+        struct expr_insn *insn = &prog->insns[prog->n_insns];
+        memset(insn, 0, sizeof *insn);
+        insn->field = field;
+        insn->relop = e->cmp.relop;
+        if (e->cmp.symbol->width) {
+            int n_bytes = field->n_bytes;
+            memcpy(&insn->value,
+                   &e->cmp.value.u8[sizeof e->cmp.value - n_bytes], n_bytes);
+            memcpy(&insn->mask,
+                   &e->cmp.mask.u8[sizeof e->cmp.mask - n_bytes], n_bytes);
+        } else {
+            insn->string = xstrdup(e->cmp.string);
+        }
+        insn->if_true = if_true;
+        insn->if_false = if_false;
+        return prog->n_insns++;
+    }
+
+    case EXPR_T_AND:
+    case EXPR_T_OR: {
+        /* Compile the terms from last to first, so that each term knows where
+         * to continue when it doesn't decide the result. */
+        uint32_t next = e->type == EXPR_T_AND ? if_true : if_false;
+        const struct expr *sub;
+
+        LIST_FOR_EACH_REVERSE (sub, node, &e->andor) {
+            next = (e->type == EXPR_T_AND
+                    ? expr_program_compile__(prog, sub, next, if_false)
+                    : expr_program_compile__(prog, sub, if_true, next));
+        }
+        return next;
+    }
+
+    case EXPR_T_BOOLEAN:
+        return e->boolean ? if_true : if_false;
+
+    case EXPR_T_CONDITION:
+        /* Same assumption as expr_evaluate(). */
+        return e->cond.not ? if_false : if_true;
+
+    default:
+        OVS_NOT_REACHED();
+    }
+}
+
+/* Returns 'e' compiled for repeated evaluation with expr_program_evaluate()
+ * and expr_program_evaluate_batch().  'e' may be in any form, it doesn't have
+ * to be normalized, and the caller keeps ownership of it.  The caller must
+ * eventually free the program with expr_program_destroy(). */
+struct expr_program *
+expr_program_compile(const struct expr *e)
+{
+    struct expr_program *prog = xzalloc(sizeof *prog);
+    prog->start = expr_program_compile__(prog, e, EXPR_PROGRAM_TRUE,
+                                         EXPR_PROGRAM_FALSE);
+    return prog;
+}
+
+void
+expr_program_destroy(struct expr_program *prog)
+{
+    if (prog) {
+        for (size_t i = 0; i < prog->n_insns; i++) {
+            free(prog->insns[i].string);
+        }
+        free(prog->insns);
+        free(prog);
+    }
+}
+
+static bool
+expr_insn_evaluate(const struct expr_insn *insn, const struct flow *f,
+                   bool (*lookup_port)(const void *aux, const char *port_name,
+                                       unsigned int *portp),
+                   const void *aux)
+{
+    const struct mf_field *field = insn->field;
+
+    int cmp;
+    if (!insn->string) {
+        union mf_value value;
+        mf_get_value(field, f, &value);
+        for (int i = 0; i < field->n_bytes; i++) {
+            value.b[i] &= insn->mask.b[i];
+        }
+        cmp = memcmp(&value, &insn->value, field->n_bytes);
+    } else {
+        struct mf_subfield sf = { .field = field, .ofs = 0,
+                                  .n_bits = field->n_bits };
+        uint64_t value = mf_get_subfield(&sf, f);
+
+        unsigned int cst;
+        if (!lookup_port(aux, insn->string, &cst)) {
+            return false;
+        }
+        cmp = value < cst ? -1 : value > cst;
+    }
+
+    return expr_relop_test(insn->relop, cmp);
+}
+
+/* Evaluates 'prog' against microflow 'uflow' and returns the result, which is
+ * the same as expr_evaluate() would return for the expression that 'prog' was
+ * compiled from.  'lookup_port' and 'aux' are as for expr_evaluate(). */
+bool
+expr_program_evaluate(const struct expr_program *prog,
+                      const struct flow *uflow,
+                      bool (*lookup_port)(const void *aux,
+                                          const char *port_name,
+                                          unsigned int *portp),
+                      const void *aux)
+{
+    uint32_t pc = prog->start;
+
+    while (pc < prog->n_insns) {
+        const struct expr_insn *insn = &prog->insns[pc];
+        pc = (expr_insn_evaluate(insn, uflow, lookup_port, aux)
+              ? insn->if_true : insn->if_false);
+    }
+    return pc == EXPR_PROGRAM_TRUE;
+}
+
+/* Evaluates 'prog' against each of the 'n' microflows in 'uflows' and stores
+ * the results in the corresponding elements of 'results'. */
+void
+expr_program_evaluate_batch(const struct expr_program *prog,
+                            const struct flow *uflows, size_t n,
+                            bool *results,
+                            bool (*lookup_port)(const void *aux,
+                                                const char *port_name,
+                                                unsigned int *portp),
+                            const void *aux)
+{
+    for (size_t i = 0; i < n; i++) {
+        results[i] = expr_program_evaluate(prog, &uflows[i], lookup_port, aux);
+    }
+}
+
 /* Action parsing helper. */
 
 /* Checks that 'f' is 'n_bits' wide (where 'n_bits == 0' means that 'f' must be
@@ -37,6 +37,8 @@ ovn_extend_table_init(struct ovn_extend_table *table)
     hmap_init(&table->desired);
     hmap_init(&table->lflow_to_desired);
     hmap_init(&table->existing);
+    hmapx_init(&table->uninstalled);
+    hmapx_init(&table->unreferenced);
 }
 
 static struct ovn_extend_table_info *
@@ -66,6 +68,27 @@ ovn_extend_table_info_destroy(struct ovn_extend_table_info *e)
     free(e);
 }
 
+/* Removes the desired item 'e' from 'table' and frees it.  The installed
+ * item with the same id, if any, becomes a candidate for removal. */
+static void
+ovn_extend_table_desired_destroy(struct ovn_extend_table *table,
+                                 struct ovn_extend_table_info *e)
+{
+    hmap_remove(&table->desired, &e->hmap_node);
+    hmapx_find_and_delete(&table->uninstalled, e);
+
+    struct ovn_extend_table_info *existing =
+        ovn_extend_table_lookup(&table->existing, e);
+    if (existing) {
+        hmapx_add(&table->unreferenced, existing);
+    }
+
+    if (e->new_table_id) {
+        bitmap_set0(table->table_ids, e->table_id);
+    }
+    ovn_extend_table_info_destroy(e);
+}
+
 /* Finds and returns a group_info in 'existing' whose key is identical
  * to 'target''s key, or NULL if there is none. */
 struct ovn_extend_table_info *
@@ -191,6 +214,20 @@ ovn_extend_table_clear(struct ovn_extend_table *table, bool existing)
         }
         ovn_extend_table_info_destroy(g);
     }
+
+    /* Whatever is left on the other side is now out of sync. */
+    if (existing) {
+        hmapx_clear(&table->unreferenced);
+        hmapx_clear(&table->uninstalled);
+        HMAP_FOR_EACH (g, hmap_node, &table->desired) {
+            hmapx_add(&table->uninstalled, g);
+        }
+    } else {
+        hmapx_clear(&table->uninstalled);
+        HMAP_FOR_EACH (g, hmap_node, &table->existing) {
+            hmapx_add(&table->unreferenced, g);
+        }
+    }
 }
 
 void
@@ -201,6 +238,8 @@ ovn_extend_table_destroy(struct ovn_extend_table *table)
     hmap_destroy(&table->lflow_to_desired);
     ovn_extend_table_clear(table, true);
     hmap_destroy(&table->existing);
+    hmapx_destroy(&table->uninstalled);
+    hmapx_destroy(&table->unreferenced);
     bitmap_free(table->table_ids);
 }
 
@@ -211,6 +250,7 @@ ovn_extend_table_remove_existing(struct ovn_extend_table *table,
 {
     /* Remove 'existing' from 'groups->existing' */
     hmap_remove(&table->existing, &existing->hmap_node);
+    hmapx_find_and_delete(&table->unreferenced, existing);
 
     /* Dealloc group_id. */
     bitmap_set0(table->table_ids, existing->table_id);
@@ -229,11 +269,7 @@ ovn_extend_table_delete_desired(struct ovn_extend_table *table,
         if (hmap_is_empty(&e->references)) {
             VLOG_DBG("%s: %s, "UUID_FMT, __func__,
                      e->name, UUID_ARGS(&l->lflow_uuid));
-            hmap_remove(&table->desired, &e->hmap_node);
-            if (e->new_table_id) {
-                bitmap_set0(table->table_ids, e->table_id);
-            }
-            ovn_extend_table_info_destroy(e);
+            ovn_extend_table_desired_destroy(table, e);
         }
     }
     free(l);
@@ -254,6 +290,29 @@ ovn_extend_table_remove_desired(struct ovn_extend_table *table,
     ovn_extend_table_delete_desired(table, l);
 }
 
+/* Adds an entry named 'name' with id 'table_id' to 'table->existing', for an
+ * item that is known to be installed in the switch already.  Returns false
+ * if 'table_id' is invalid or already in use. */
+bool
+ovn_extend_table_add_existing(struct ovn_extend_table *table,
+                              const char *name, uint32_t table_id)
+{
+    if (table_id == EXT_TABLE_ID_INVALID || table_id >= MAX_EXT_TABLE_ID
+        || bitmap_is_set(table->table_ids, table_id)) {
+        return false;
+    }
+
+    bitmap_set1(table->table_ids, table_id);
+    struct ovn_extend_table_info *existing =
+        ovn_extend_table_info_alloc(name, table_id, false,
+                                    hash_string(name, 0));
+    hmap_insert(&table->existing, &existing->hmap_node,
+                existing->hmap_node.hash);
+    /* Removed on the next sync, unless it becomes desired again. */
+    hmapx_add(&table->unreferenced, existing);
+    return true;
+}
+
 static struct ovn_extend_table_info*
 ovn_extend_info_clone(struct ovn_extend_table_info *source)
 {
@@ -268,10 +327,11 @@ ovn_extend_info_clone(struct ovn_extend_table_info *source)
 void
 ovn_extend_table_sync(struct ovn_extend_table *table)
 {
-    struct ovn_extend_table_info *desired;
+    struct hmapx_node *node;
 
-    /* Copy the contents of desired to existing. */
-    HMAP_FOR_EACH_SAFE (desired, hmap_node, &table->desired) {
+    /* Copy the new contents of desired to existing. */
+    HMAPX_FOR_EACH (node, &table->uninstalled) {
+        struct ovn_extend_table_info *desired = node->data;
         if (!ovn_extend_table_lookup(&table->existing, desired)) {
             desired->new_table_id = false;
             struct ovn_extend_table_info *clone =
@@ -280,6 +340,8 @@ ovn_extend_table_sync(struct ovn_extend_table *table)
                         clone->hmap_node.hash);
         }
     }
+    hmapx_clear(&table->uninstalled);
+    hmapx_clear(&table->unreferenced);
 }
 
 /* Assign a new table ID for the table information from the bitmap.
@@ -332,6 +394,7 @@ ovn_extend_table_assign_id(struct ovn_extend_table *table, const char *name,
 
     hmap_insert(&table->desired,
                 &table_info->hmap_node, table_info->hmap_node.hash);
+    hmapx_add(&table->uninstalled, table_info);
 
     ovn_extend_info_add_lflow_ref(table, table_info, &lflow_uuid);
 
@@ -20,6 +20,7 @@
 #define MAX_EXT_TABLE_ID 65535
 #define EXT_TABLE_ID_INVALID 0
 
+#include "lib/hmapx.h"
 #include "openvswitch/hmap.h"
 #include "openvswitch/list.h"
 #include "openvswitch/uuid.h"
@@ -36,6 +37,13 @@ struct ovn_extend_table {
                                    * ovn_extend_table_lflow_to_desired nodes.
                                    */
     struct hmap existing;
+
+    /* Change tracking, so that the switch can be synced without walking all
+     * the items.  Both sets are emptied by ovn_extend_table_sync(). */
+    struct hmapx uninstalled;   /* Items in 'desired' that may be missing
+                                 * from 'existing'. */
+    struct hmapx unreferenced;  /* Items in 'existing' that may be missing
+                                 * from 'desired'. */
 };
 
 struct ovn_extend_table_lflow_to_desired {
@@ -87,7 +95,11 @@ void ovn_extend_table_remove_existing(struct ovn_extend_table *,
 void ovn_extend_table_remove_desired(struct ovn_extend_table *,
                                      const struct uuid *lflow_uuid);
 
-/* Copy the contents of desired to existing. */
+bool ovn_extend_table_add_existing(struct ovn_extend_table *,
+                                   const char *name, uint32_t table_id);
+
+/* Copy the new contents of desired to existing and reset the change
+ * tracking. */
 void ovn_extend_table_sync(struct ovn_extend_table *);
 
 uint32_t ovn_extend_table_assign_id(struct ovn_extend_table *,
@@ -98,18 +110,21 @@ struct ovn_extend_table_info *
 ovn_extend_table_desired_lookup_by_name(struct ovn_extend_table * table,
                                         const char *name);
 
-/* Iterates 'DESIRED' through all of the 'ovn_extend_table_info's in
- * 'TABLE'->desired that are not in 'TABLE'->existing.  (The loop body
- * presumably adds them.) */
-#define EXTEND_TABLE_FOR_EACH_UNINSTALLED(DESIRED, TABLE) \
-    HMAP_FOR_EACH (DESIRED, hmap_node, &(TABLE)->desired) \
-        if (!ovn_extend_table_lookup(&(TABLE)->existing, DESIRED))
-
-/* Iterates 'EXISTING' through all of the 'ovn_extend_table_info's in
- * 'TABLE'->existing that are not in 'TABLE'->desired.  (The loop body
- * presumably removes them.) */
-#define EXTEND_TABLE_FOR_EACH_INSTALLED(EXISTING, TABLE)               \
-    HMAP_FOR_EACH_SAFE (EXISTING, hmap_node, &(TABLE)->existing)        \
-        if (!ovn_extend_table_lookup(&(TABLE)->desired, EXISTING))
+/* Iterates 'NODE' through the 'ovn_extend_table_info's in 'TABLE'->desired
+ * that are not in 'TABLE'->existing, with 'NODE'->data pointing to each of
+ * them.  Only the items added since the last ovn_extend_table_sync() are
+ * visited.  (The loop body presumably adds them.) */
+#define EXTEND_TABLE_FOR_EACH_UNINSTALLED(NODE, TABLE)              \
+    HMAPX_FOR_EACH (NODE, &(TABLE)->uninstalled)                    \
+        if (!ovn_extend_table_lookup(&(TABLE)->existing, (NODE)->data))
+
+/* Iterates 'NODE' through the 'ovn_extend_table_info's in 'TABLE'->existing
+ * that are not in 'TABLE'->desired, with 'NODE'->data pointing to each of
+ * them.  Only the items whose desired counterpart went away since the last
+ * ovn_extend_table_sync() are visited.  (The loop body presumably removes
+ * them with ovn_extend_table_remove_existing().) */
+#define EXTEND_TABLE_FOR_EACH_INSTALLED(NODE, TABLE)                \
+    HMAPX_FOR_EACH_SAFE (NODE, &(TABLE)->unreferenced)              \
+        if (!ovn_extend_table_lookup(&(TABLE)->desired, (NODE)->data))
 
 #endif /* lib/extend-table.h */
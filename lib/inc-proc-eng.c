@@ -28,18 +28,31 @@
 #include "openvswitch/poll-loop.h"
 #include "openvswitch/vlog.h"
 #include "inc-proc-eng.h"
+#include "ovn-usdt-probes.h"
+#include "ovs-atomic.h"
+#include "ovs-thread.h"
+#include "simap.h"
 #include "timeval.h"
 #include "unixctl.h"
 
 VLOG_DEFINE_THIS_MODULE(inc_proc_eng);
 
 static bool engine_force_recompute = false;
+static uint64_t engine_run_id = 0;
 static bool engine_run_aborted = false;
+static atomic_bool engine_run_yielded = ATOMIC_VAR_INIT(false);
 static const struct engine_context *engine_context;
 
 static struct engine_node **engine_nodes;
 static size_t engine_n_nodes;
 
+/* The nodes sorted by their depth in the graph, i.e., the length of the
+ * longest path from a leaf node.  Nodes at the same depth don't depend on
+ * each other. */
+static struct engine_node **engine_nodes_by_level;
+static size_t *engine_node_levels;
+static struct engine_node **engine_parallel_nodes;
+
 static const char *engine_node_state_name[EN_STATE_MAX] = {
     [EN_STALE]     = "Stale",
     [EN_UPDATED]   = "Updated",
@@ -49,9 +62,62 @@ static const char *engine_node_state_name[EN_STATE_MAX] = {
 
 static long long engine_compute_log_timeout_msec = 500;
 
-static void
-engine_recompute(struct engine_node *node, bool allowed,
-                 const char *reason_fmt, ...) OVS_PRINTF_FORMAT(3, 4);
+static const char *engine_latency_bucket_name[ENGINE_LATENCY_N_BUCKETS] = {
+    "<10us", "<100us", "<1ms", "<10ms", "<100ms", "<1s", ">=1s",
+};
+
+enum engine_recompute_reason {
+    ENGINE_RECOMPUTE_FORCED,
+    ENGINE_RECOMPUTE_MISSING_HANDLER,
+    ENGINE_RECOMPUTE_FAILED_HANDLER,
+    ENGINE_RECOMPUTE_RESUMED,          /* The node yielded the last time. */
+    ENGINE_RECOMPUTE_RESTARTED,        /* Same, but its inputs changed. */
+    ENGINE_RECOMPUTE_INPUT_YIELDED,    /* The node missed input changes. */
+};
+
+/* Ring buffer of the last recomputes triggered for nodes that have inputs,
+ * to find out which change handlers are missing or fall back to a
+ * recompute. */
+#define ENGINE_RECOMPUTE_TRACE_SIZE 32
+
+struct engine_recompute_trace {
+    uint64_t run_id;
+    long long int when;                 /* Wall clock time, in msec. */
+    const struct engine_node *node;
+    const struct engine_node *input;    /* NULL if forced. */
+    enum engine_recompute_reason reason;
+    long long int handler_usec;         /* Time spent in the failed handler. */
+    long long int recompute_usec;
+    bool aborted;
+    bool yielded;
+};
+
+static struct ovs_mutex engine_trace_mutex = OVS_MUTEX_INITIALIZER;
+static struct engine_recompute_trace
+    engine_recompute_traces[ENGINE_RECOMPUTE_TRACE_SIZE]
+    OVS_GUARDED_BY(engine_trace_mutex);
+static size_t engine_n_recompute_traces OVS_GUARDED_BY(engine_trace_mutex);
+
+/* Worker threads that run the thread-safe nodes of a level concurrently,
+ * see engine_set_n_threads().  The thread that calls engine_run() runs
+ * nodes as well, so there are 'engine_n_threads' - 1 workers. */
+#define ENGINE_MAX_N_THREADS 64
+
+static struct ovs_mutex engine_pool_mutex = OVS_MUTEX_INITIALIZER;
+static pthread_cond_t engine_pool_work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t engine_pool_done_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t *engine_pool_threads;
+static size_t engine_n_threads = 1;
+
+static struct engine_node **engine_pool_jobs
+    OVS_GUARDED_BY(engine_pool_mutex);
+static size_t engine_pool_n_jobs OVS_GUARDED_BY(engine_pool_mutex);
+static size_t engine_pool_next_job OVS_GUARDED_BY(engine_pool_mutex);
+static size_t engine_pool_n_pending OVS_GUARDED_BY(engine_pool_mutex);
+static bool engine_pool_recompute_allowed OVS_GUARDED_BY(engine_pool_mutex);
+static bool engine_pool_exit OVS_GUARDED_BY(engine_pool_mutex);
+
+static void engine_run_node(struct engine_node *, bool recompute_allowed);
 
 void
 engine_set_force_recompute(bool val)
@@ -59,6 +125,18 @@ engine_set_force_recompute(bool val)
     engine_force_recompute = val;
 }
 
+bool
+engine_get_force_recompute(void)
+{
+    return engine_force_recompute;
+}
+
+uint64_t
+engine_get_run_id(void)
+{
+    return engine_run_id;
+}
+
 const struct engine_context *
 engine_get_context(void)
 {
@@ -111,6 +189,152 @@ engine_get_nodes(struct engine_node *node, size_t *n_count)
     return engine_topo_sort(node, NULL, n_count, &n_size);
 }
 
+/* Builds 'engine_nodes_by_level' and 'engine_node_levels' from the
+ * topologically sorted 'engine_nodes'.  Like the topological sort, this is
+ * done only once at startup so walking the array of nodes for each input is
+ * ok.
+ */
+static void
+engine_sort_by_level(void)
+{
+    size_t *levels = xcalloc(engine_n_nodes, sizeof *levels);
+    size_t max_level = 0;
+
+    for (size_t i = 0; i < engine_n_nodes; i++) {
+        struct engine_node *node = engine_nodes[i];
+
+        for (size_t j = 0; j < node->n_inputs; j++) {
+            for (size_t k = 0; k < i; k++) {
+                if (engine_nodes[k] == node->inputs[j].node) {
+                    levels[i] = MAX(levels[i], levels[k] + 1);
+                    break;
+                }
+            }
+        }
+        max_level = MAX(max_level, levels[i]);
+    }
+
+    engine_nodes_by_level = xmalloc(engine_n_nodes
+                                    * sizeof *engine_nodes_by_level);
+    engine_node_levels = xmalloc(engine_n_nodes * sizeof *engine_node_levels);
+    engine_parallel_nodes = xmalloc(engine_n_nodes
+                                    * sizeof *engine_parallel_nodes);
+
+    size_t n = 0;
+    for (size_t level = 0; level <= max_level; level++) {
+        for (size_t i = 0; i < engine_n_nodes; i++) {
+            if (levels[i] == level) {
+                engine_nodes_by_level[n] = engine_nodes[i];
+                engine_node_levels[n] = level;
+                n++;
+            }
+        }
+    }
+    free(levels);
+}
+
+static void
+engine_latency_stats_add(struct engine_latency_stats *stats, uint64_t usec)
+{
+    uint64_t limit = 10;
+    size_t bucket = 0;
+
+    while (bucket < ENGINE_LATENCY_N_BUCKETS - 1 && usec >= limit) {
+        limit *= 10;
+        bucket++;
+    }
+    stats->buckets[bucket]++;
+    stats->count++;
+    stats->total_usec += usec;
+    stats->max_usec = MAX(stats->max_usec, usec);
+}
+
+static void
+engine_latency_stats_format(struct ds *s, const char *name,
+                            const struct engine_latency_stats *stats)
+{
+    ds_put_format(s, "- %s (us): count %"PRIu64", avg %"PRIu64
+                  ", max %"PRIu64"\n", name, stats->count,
+                  stats->count ? stats->total_usec / stats->count : 0,
+                  stats->max_usec);
+    ds_put_cstr(s, " ");
+    for (size_t i = 0; i < ENGINE_LATENCY_N_BUCKETS; i++) {
+        ds_put_format(s, " %s: %"PRIu64, engine_latency_bucket_name[i],
+                      stats->buckets[i]);
+    }
+    ds_put_char(s, '\n');
+}
+
+static void
+engine_recompute_reason_format(struct ds *s,
+                               enum engine_recompute_reason reason,
+                               const struct engine_node *input)
+{
+    switch (reason) {
+    case ENGINE_RECOMPUTE_FORCED:
+        ds_put_cstr(s, "forced");
+        break;
+    case ENGINE_RECOMPUTE_MISSING_HANDLER:
+        ds_put_format(s, "missing handler for input %s", input->name);
+        break;
+    case ENGINE_RECOMPUTE_FAILED_HANDLER:
+        ds_put_format(s, "failed handler for input %s", input->name);
+        break;
+    case ENGINE_RECOMPUTE_RESUMED:
+        ds_put_cstr(s, "resumed");
+        break;
+    case ENGINE_RECOMPUTE_RESTARTED:
+        ds_put_cstr(s, "inputs changed while yielded");
+        break;
+    case ENGINE_RECOMPUTE_INPUT_YIELDED:
+        ds_put_cstr(s, "input yielded");
+        break;
+    default:
+        OVS_NOT_REACHED();
+    }
+}
+
+static void
+engine_recompute_trace_add(struct engine_node *node,
+                           enum engine_recompute_reason reason,
+                           const struct engine_node *input,
+                           long long int handler_usec,
+                           long long int recompute_usec, bool aborted,
+                           bool yielded)
+{
+    ovs_mutex_lock(&engine_trace_mutex);
+    struct engine_recompute_trace *trace =
+        &engine_recompute_traces[engine_n_recompute_traces++
+                                 % ENGINE_RECOMPUTE_TRACE_SIZE];
+
+    *trace = (struct engine_recompute_trace) {
+        .run_id = engine_run_id,
+        .when = time_wall_msec(),
+        .node = node,
+        .input = input,
+        .reason = reason,
+        .handler_usec = handler_usec,
+        .recompute_usec = recompute_usec,
+        .aborted = aborted,
+        .yielded = yielded,
+    };
+    ovs_mutex_unlock(&engine_trace_mutex);
+}
+
+static void
+engine_memory_usage_format(struct ds *s, const struct simap *usage)
+{
+    const struct simap_node **nodes = simap_sort(usage);
+    size_t n = simap_count(usage);
+
+    ds_put_cstr(s, "- memory:");
+    for (size_t i = 0; i < n; i++) {
+        ds_put_format(s, " %s:%u", nodes[i]->name, nodes[i]->data);
+    }
+    ds_put_char(s, '\n');
+    free(nodes);
+}
+
 static void
 engine_clear_stats(struct unixctl_conn *conn, int argc OVS_UNUSED,
                    const char *argv[] OVS_UNUSED, void *arg OVS_UNUSED)
@@ -120,6 +344,9 @@ engine_clear_stats(struct unixctl_conn *conn, int argc OVS_UNUSED,
 
         memset(&node->stats, 0, sizeof node->stats);
     }
+    ovs_mutex_lock(&engine_trace_mutex);
+    engine_n_recompute_traces = 0;
+    ovs_mutex_unlock(&engine_trace_mutex);
     unixctl_command_reply(conn, NULL);
 }
 
@@ -139,7 +366,48 @@ engine_dump_stats(struct unixctl_conn *conn, int argc OVS_UNUSED,
                       "- abort:     %12"PRIu64"\n",
                       node->name, node->stats.recompute,
                       node->stats.compute, node->stats.abort);
+        engine_latency_stats_format(&dump, "run", &node->stats.run);
+        if (node->n_inputs) {
+            engine_latency_stats_format(&dump, "handler",
+                                        &node->stats.handler);
+        }
+        if (node->get_memory_usage && node->data) {
+            struct simap usage = SIMAP_INITIALIZER(&usage);
+            node->get_memory_usage(node->data, &usage);
+            engine_memory_usage_format(&dump, &usage);
+            simap_destroy(&usage);
+        }
+    }
+
+    /* Most recent recomputes first. */
+    ovs_mutex_lock(&engine_trace_mutex);
+    size_t n_traces = MIN(engine_n_recompute_traces,
+                          ENGINE_RECOMPUTE_TRACE_SIZE);
+    ds_put_format(&dump, "Last %"PRIuSIZE" recompute triggers:\n", n_traces);
+    for (size_t i = 1; i <= n_traces; i++) {
+        const struct engine_recompute_trace *trace =
+            &engine_recompute_traces[(engine_n_recompute_traces - i)
+                                     % ENGINE_RECOMPUTE_TRACE_SIZE];
+
+        ds_put_format(&dump, "- run %"PRIu64", ", trace->run_id);
+        ds_put_strftime_msec(&dump, "%H:%M:%S.###", trace->when, false);
+        ds_put_format(&dump, ", node %s: ", trace->node->name);
+        engine_recompute_reason_format(&dump, trace->reason, trace->input);
+        if (trace->reason == ENGINE_RECOMPUTE_FAILED_HANDLER) {
+            ds_put_format(&dump, " (handler took %lldus)",
+                          trace->handler_usec);
+        }
+        if (trace->aborted) {
+            ds_put_cstr(&dump, ", aborted\n");
+        } else if (trace->yielded) {
+            ds_put_format(&dump, ", yielded after %lldus\n",
+                          trace->recompute_usec);
+        } else {
+            ds_put_format(&dump, ", recompute took %lldus\n",
+                          trace->recompute_usec);
+        }
     }
+    ovs_mutex_unlock(&engine_trace_mutex);
     unixctl_command_reply(conn, ds_cstr(&dump));
 
     ds_destroy(&dump);
@@ -172,6 +440,7 @@ void
 engine_init(struct engine_node *node, struct engine_arg *arg)
 {
     engine_nodes = engine_get_nodes(node, &engine_n_nodes);
+    engine_sort_by_level();
 
     for (size_t i = 0; i < engine_n_nodes; i++) {
         if (engine_nodes[i]->init) {
@@ -192,9 +461,23 @@ engine_init(struct engine_node *node, struct engine_arg *arg)
                              engine_set_log_timeout_cmd, NULL);
 }
 
+void
+engine_get_memory_usage(struct simap *usage)
+{
+    for (size_t i = 0; i < engine_n_nodes; i++) {
+        struct engine_node *node = engine_nodes[i];
+
+        if (node->get_memory_usage && node->data) {
+            node->get_memory_usage(node->data, usage);
+        }
+    }
+}
+
 void
 engine_cleanup(void)
 {
+    engine_set_n_threads(1);
+
     for (size_t i = 0; i < engine_n_nodes; i++) {
         if (engine_nodes[i]->clear_tracked_data) {
             engine_nodes[i]->clear_tracked_data(engine_nodes[i]->data);
@@ -208,6 +491,113 @@ engine_cleanup(void)
     free(engine_nodes);
     engine_nodes = NULL;
     engine_n_nodes = 0;
+    free(engine_nodes_by_level);
+    engine_nodes_by_level = NULL;
+    free(engine_node_levels);
+    engine_node_levels = NULL;
+    free(engine_parallel_nodes);
+    engine_parallel_nodes = NULL;
+
+    ovs_mutex_lock(&engine_trace_mutex);
+    engine_n_recompute_traces = 0;
+    ovs_mutex_unlock(&engine_trace_mutex);
+}
+
+/* Runs the jobs handed over to the pool by engine_pool_run() until there
+ * are none left to start. */
+static void
+engine_pool_run_jobs(void)
+    OVS_REQUIRES(engine_pool_mutex)
+{
+    while (engine_pool_next_job < engine_pool_n_jobs) {
+        struct engine_node *node = engine_pool_jobs[engine_pool_next_job++];
+        bool recompute_allowed = engine_pool_recompute_allowed;
+
+        ovs_mutex_unlock(&engine_pool_mutex);
+        engine_run_node(node, recompute_allowed);
+        ovs_mutex_lock(&engine_pool_mutex);
+
+        if (!--engine_pool_n_pending) {
+            xpthread_cond_signal(&engine_pool_done_cond);
+        }
+    }
+}
+
+static void *
+engine_pool_thread(void *arg OVS_UNUSED)
+{
+    ovs_mutex_lock(&engine_pool_mutex);
+    while (!engine_pool_exit) {
+        engine_pool_run_jobs();
+        if (!engine_pool_exit) {
+            ovs_mutex_cond_wait(&engine_pool_work_cond, &engine_pool_mutex);
+        }
+    }
+    ovs_mutex_unlock(&engine_pool_mutex);
+    return NULL;
+}
+
+/* Runs the 'n_nodes' independent 'nodes' concurrently in the worker threads
+ * and in the calling thread, and waits until all of them are done. */
+static void
+engine_pool_run(struct engine_node **nodes, size_t n_nodes,
+                bool recompute_allowed)
+{
+    ovs_mutex_lock(&engine_pool_mutex);
+    engine_pool_jobs = nodes;
+    engine_pool_n_jobs = n_nodes;
+    engine_pool_next_job = 0;
+    engine_pool_n_pending = n_nodes;
+    engine_pool_recompute_allowed = recompute_allowed;
+    xpthread_cond_broadcast(&engine_pool_work_cond);
+
+    engine_pool_run_jobs();
+    while (engine_pool_n_pending) {
+        ovs_mutex_cond_wait(&engine_pool_done_cond, &engine_pool_mutex);
+    }
+
+    engine_pool_jobs = NULL;
+    engine_pool_n_jobs = 0;
+    engine_pool_next_job = 0;
+    ovs_mutex_unlock(&engine_pool_mutex);
+}
+
+void
+engine_set_n_threads(size_t n_threads)
+{
+    n_threads = MIN(MAX(n_threads, 1), ENGINE_MAX_N_THREADS);
+    if (n_threads == engine_n_threads) {
+        return;
+    }
+
+    if (engine_pool_threads) {
+        ovs_mutex_lock(&engine_pool_mutex);
+        engine_pool_exit = true;
+        xpthread_cond_broadcast(&engine_pool_work_cond);
+        ovs_mutex_unlock(&engine_pool_mutex);
+
+        for (size_t i = 0; i < engine_n_threads - 1; i++) {
+            xpthread_join(engine_pool_threads[i], NULL);
+        }
+        free(engine_pool_threads);
+        engine_pool_threads = NULL;
+
+        ovs_mutex_lock(&engine_pool_mutex);
+        engine_pool_exit = false;
+        ovs_mutex_unlock(&engine_pool_mutex);
+    }
+
+    VLOG_INFO("Running the engine nodes with %"PRIuSIZE" threads", n_threads);
+    engine_n_threads = n_threads;
+    if (n_threads > 1) {
+        engine_pool_threads = xmalloc((n_threads - 1)
+                                      * sizeof *engine_pool_threads);
+        for (size_t i = 0; i < n_threads - 1; i++) {
+            engine_pool_threads[i] = ovs_thread_create("inc_proc_eng",
+                                                       engine_pool_thread,
+                                                       NULL);
+        }
+    }
 }
 
 struct engine_node *
@@ -318,6 +708,27 @@ engine_aborted(void)
     return engine_run_aborted;
 }
 
+void
+engine_yield(struct engine_node *node)
+{
+    node->yielded = true;
+}
+
+bool
+engine_node_resuming(const struct engine_node *node)
+{
+    return node->resuming;
+}
+
+bool
+engine_yielded(void)
+{
+    bool yielded;
+
+    atomic_read_relaxed(&engine_run_yielded, &yielded);
+    return yielded;
+}
+
 void *
 engine_get_data(struct engine_node *node)
 {
@@ -337,6 +748,7 @@ void
 engine_init_run(void)
 {
     VLOG_DBG("Initializing new run");
+    engine_run_id++;
     for (size_t i = 0; i < engine_n_nodes; i++) {
         engine_set_node_state(engine_nodes[i], EN_STALE);
 
@@ -346,23 +758,42 @@ engine_init_run(void)
     }
 }
 
+/* Runs the 'run' method of 'node' and accounts for the time it took.
+ * Returns the time spent, in microseconds. */
+static long long int
+engine_run_node_handler(struct engine_node *node)
+{
+    long long int now = time_usec();
+    OVN_USDT_PROBE(inc_proc_eng, node_run_begin, node->name);
+    node->run(node, node->data);
+    node->stats.recompute++;
+    long long int delta_time = time_usec() - now;
+    OVN_USDT_PROBE(inc_proc_eng, node_run_end, node->name, node->state,
+                   delta_time);
+    engine_latency_stats_add(&node->stats.run, delta_time);
+    return delta_time;
+}
+
 /* Do a full recompute (or at least try). If we're not allowed then
- * mark the node as "aborted".
+ * mark the node as "aborted".  'input' is the input node that triggered
+ * the recompute, if any, and 'handler_usec' the time spent in its failed
+ * change handler.
  */
 static void
 engine_recompute(struct engine_node *node, bool allowed,
-                 const char *reason_fmt, ...)
+                 enum engine_recompute_reason reason_code,
+                 const struct engine_node *input, long long int handler_usec)
 {
-    char *reason = NULL;
-    va_list reason_args;
+    struct ds reason = DS_EMPTY_INITIALIZER;
 
-    va_start(reason_args, reason_fmt);
-    reason = xvasprintf(reason_fmt, reason_args);
-    va_end(reason_args);
+    engine_recompute_reason_format(&reason, reason_code, input);
 
     if (!allowed) {
-        VLOG_DBG("node: %s, recompute (%s) aborted", node->name, reason);
+        VLOG_DBG("node: %s, recompute (%s) aborted", node->name,
+                 ds_cstr(&reason));
         engine_set_node_state(node, EN_ABORTED);
+        engine_recompute_trace_add(node, reason_code, input, handler_usec,
+                                   0, true, false);
         goto done;
     }
 
@@ -373,20 +804,29 @@ engine_recompute(struct engine_node *node, bool allowed,
     }
 
     /* Run the node handler which might change state. */
-    long long int now = time_msec();
-    node->run(node, node->data);
-    node->stats.recompute++;
-    long long int delta_time = time_msec() - now;
+    node->yielded = false;
+    node->resuming = reason_code == ENGINE_RECOMPUTE_RESUMED;
+    long long int delta_usec = engine_run_node_handler(node);
+    long long int delta_time = delta_usec / 1000;
+    node->resuming = false;
+    node->need_recompute = false;
+    if (node->yielded) {
+        /* The data of the node stays invalid until it's done. */
+        engine_set_node_state(node, EN_STALE);
+        atomic_store_relaxed(&engine_run_yielded, true);
+    }
+    engine_recompute_trace_add(node, reason_code, input, handler_usec,
+                               delta_usec, false, node->yielded);
     if (delta_time > engine_compute_log_timeout_msec) {
         static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(20, 10);
         VLOG_INFO_RL(&rl, "node: %s, recompute (%s) took %lldms", node->name,
-                     reason, delta_time);
+                     ds_cstr(&reason), delta_time);
     } else {
-        VLOG_DBG("node: %s, recompute (%s) took %lldms", node->name, reason,
-                 delta_time);
+        VLOG_DBG("node: %s, recompute (%s) took %lldms", node->name,
+                 ds_cstr(&reason), delta_time);
     }
 done:
-    free(reason);
+    ds_destroy(&reason);
 }
 
 /* Return true if the node could be computed, false otherwise. */
@@ -399,9 +839,16 @@ engine_compute(struct engine_node *node, bool recompute_allowed)
             /* If the input change can't be handled incrementally, run
              * the node handler.
              */
-            long long int now = time_msec();
+            const char *input_name = node->inputs[i].node->name;
+            long long int now = time_usec();
+            OVN_USDT_PROBE(inc_proc_eng, node_handler_begin, node->name,
+                           input_name);
             bool handled = node->inputs[i].change_handler(node, node->data);
-            long long int delta_time = time_msec() - now;
+            long long int delta_usec = time_usec() - now;
+            OVN_USDT_PROBE(inc_proc_eng, node_handler_end, node->name,
+                           input_name, handled, delta_usec);
+            long long int delta_time = delta_usec / 1000;
+            engine_latency_stats_add(&node->stats.handler, delta_usec);
             if (delta_time > engine_compute_log_timeout_msec) {
                 static struct vlog_rate_limit rl =
                     VLOG_RATE_LIMIT_INIT(20, 10);
@@ -414,8 +861,8 @@ engine_compute(struct engine_node *node, bool recompute_allowed)
             }
             if (!handled) {
                 engine_recompute(node, recompute_allowed,
-                                 "failed handler for input %s",
-                                 node->inputs[i].node->name);
+                                 ENGINE_RECOMPUTE_FAILED_HANDLER,
+                                 node->inputs[i].node, delta_usec);
                 return (node->state != EN_ABORTED);
             }
         }
@@ -425,18 +872,82 @@ engine_compute(struct engine_node *node, bool recompute_allowed)
     return true;
 }
 
+/* Returns true if running 'node' in the current run does more than marking
+ * it as unchanged. */
+static bool
+engine_node_need_compute(const struct engine_node *node)
+{
+    if (engine_force_recompute) {
+        return true;
+    }
+    for (size_t i = 0; i < node->n_inputs; i++) {
+        if (node->inputs[i].node->state == EN_UPDATED) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Returns true if 'node' yielded, or couldn't run because one of its inputs
+ * did, so that the nodes that depend on it can't run either. */
+static bool
+engine_node_blocked(const struct engine_node *node)
+{
+    return node->yielded || node->need_recompute;
+}
+
+/* Returns true if engine_run_parallel() hands 'node' over to a thread. Input
+ * nodes only check the tracked changes of their table, it isn't worth it
+ * for them. */
+static bool
+engine_node_run_in_thread(const struct engine_node *node)
+{
+    return node->thread_safe && node->n_inputs
+           && engine_node_need_compute(node);
+}
+
 static void
 engine_run_node(struct engine_node *node, bool recompute_allowed)
 {
     if (!node->n_inputs) {
         /* Run the node handler which might change state. */
-        node->run(node, node->data);
-        node->stats.recompute++;
+        engine_run_node_handler(node);
+        return;
+    }
+
+    /* Don't run the nodes that depend on a node that yielded until it's
+     * done.  They then need a recompute, since they missed the changes of
+     * their other inputs in the meantime. */
+    for (size_t i = 0; i < node->n_inputs; i++) {
+        if (engine_node_blocked(node->inputs[i].node)) {
+            node->need_recompute = true;
+            return;
+        }
+    }
+
+    if (node->yielded) {
+        if (engine_node_need_compute(node)) {
+            /* The partial result is stale, start over. */
+            engine_recompute(node, recompute_allowed,
+                             engine_force_recompute
+                             ? ENGINE_RECOMPUTE_FORCED
+                             : ENGINE_RECOMPUTE_RESTARTED, NULL, 0);
+        } else if (recompute_allowed) {
+            engine_recompute(node, true, ENGINE_RECOMPUTE_RESUMED, NULL, 0);
+        }
+        /* Otherwise, wait for a run in which it can be resumed. */
+        return;
+    }
+
+    if (node->need_recompute) {
+        engine_recompute(node, recompute_allowed,
+                         ENGINE_RECOMPUTE_INPUT_YIELDED, NULL, 0);
         return;
     }
 
     if (engine_force_recompute) {
-        engine_recompute(node, recompute_allowed, "forced");
+        engine_recompute(node, recompute_allowed, ENGINE_RECOMPUTE_FORCED,
+                         NULL, 0);
         return;
     }
 
@@ -451,8 +962,8 @@ engine_run_node(struct engine_node *node, bool recompute_allowed)
             /* Trigger a recompute if we don't have a change handler. */
             if (!node->inputs[i].change_handler) {
                 engine_recompute(node, recompute_allowed,
-                                 "missing handler for input %s",
-                                 node->inputs[i].node->name);
+                                 ENGINE_RECOMPUTE_MISSING_HANDLER,
+                                 node->inputs[i].node, 0);
                 return;
             }
         }
@@ -475,6 +986,62 @@ engine_run_node(struct engine_node *node, bool recompute_allowed)
     }
 }
 
+/* Same as the serial loop in engine_run(), but goes through the nodes level
+ * by level and runs the thread-safe nodes of a level that have work to do
+ * concurrently.  The other nodes of the level are then run by the calling
+ * thread. */
+static void
+engine_run_parallel(bool recompute_allowed)
+{
+    size_t end;
+
+    for (size_t start = 0; start < engine_n_nodes; start = end) {
+        size_t n_parallel = 0;
+
+        for (end = start; end < engine_n_nodes
+             && engine_node_levels[end] == engine_node_levels[start]; end++) {
+            struct engine_node *node = engine_nodes_by_level[end];
+
+            if (engine_node_run_in_thread(node)) {
+                engine_parallel_nodes[n_parallel++] = node;
+            }
+        }
+
+        /* The inputs of the nodes of a level all belong to the previous
+         * levels, so running a node doesn't change which other nodes of the
+         * level are handed over to the threads. */
+        bool parallel = n_parallel > 1;
+        if (parallel) {
+            engine_pool_run(engine_parallel_nodes, n_parallel,
+                            recompute_allowed);
+            for (size_t i = 0; i < n_parallel; i++) {
+                if (engine_parallel_nodes[i]->state == EN_ABORTED) {
+                    engine_parallel_nodes[i]->stats.abort++;
+                    engine_run_aborted = true;
+                }
+            }
+            if (engine_run_aborted) {
+                return;
+            }
+        }
+
+        for (size_t i = start; i < end; i++) {
+            struct engine_node *node = engine_nodes_by_level[i];
+
+            if (parallel && engine_node_run_in_thread(node)) {
+                continue;
+            }
+
+            engine_run_node(node, recompute_allowed);
+            if (node->state == EN_ABORTED) {
+                node->stats.abort++;
+                engine_run_aborted = true;
+                return;
+            }
+        }
+    }
+}
+
 void
 engine_run(bool recompute_allowed)
 {
@@ -486,6 +1053,12 @@ engine_run(bool recompute_allowed)
     }
 
     engine_run_aborted = false;
+    atomic_store_relaxed(&engine_run_yielded, false);
+    if (engine_n_threads > 1) {
+        engine_run_parallel(recompute_allowed);
+        return;
+    }
+
     for (size_t i = 0; i < engine_n_nodes; i++) {
         engine_run_node(engine_nodes[i], recompute_allowed);
 
@@ -506,8 +1079,7 @@ engine_need_run(void)
             continue;
         }
 
-        engine_nodes[i]->run(engine_nodes[i], engine_nodes[i]->data);
-        engine_nodes[i]->stats.recompute++;
+        engine_run_node_handler(engine_nodes[i]);
         VLOG_DBG("input node: %s, state: %s", engine_nodes[i]->name,
                  engine_node_state_name[engine_nodes[i]->state]);
         if (engine_nodes[i]->state == EN_UPDATED) {
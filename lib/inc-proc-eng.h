@@ -68,6 +68,8 @@
 
 #include "compiler.h"
 
+struct simap;
+
 struct engine_context {
     struct ovsdb_idl_txn *ovs_idl_txn;
     struct ovsdb_idl_txn *ovnsb_idl_txn;
@@ -81,6 +83,9 @@ struct engine_arg {
     struct ovsdb_idl *sb_idl;
     struct ovsdb_idl *nb_idl;
     struct ovsdb_idl *ovs_idl;
+    struct ovsdb_idl *icsb_idl;
+    struct ovsdb_idl *icnb_idl;
+    struct ovsdb_idl *vtep_idl;
 };
 
 struct engine_node;
@@ -115,10 +120,26 @@ enum engine_node_state {
     EN_STATE_MAX,
 };
 
+/* Latency histogram buckets, in powers of ten microseconds: "<10us",
+ * "<100us", "<1ms", "<10ms", "<100ms", "<1s" and ">=1s". */
+#define ENGINE_LATENCY_N_BUCKETS 7
+
+struct engine_latency_stats {
+    uint64_t count;
+    uint64_t total_usec;
+    uint64_t max_usec;
+    uint64_t buckets[ENGINE_LATENCY_N_BUCKETS];
+};
+
 struct engine_stats {
     uint64_t recompute;
     uint64_t compute;
     uint64_t abort;
+
+    /* Time spent in the 'run' method and in the change handlers of all
+     * inputs of the node. */
+    struct engine_latency_stats run;
+    struct engine_latency_stats handler;
 };
 
 struct engine_node {
@@ -169,6 +190,30 @@ struct engine_node {
      * engine 'data'. It may be NULL. */
     void (*clear_tracked_data)(void *tracked_data);
 
+    /* Method to report the memory held by the node data, as counters added
+     * to 'usage' like the other *_get_memory_usage() functions.  It may be
+     * NULL. */
+    void (*get_memory_usage)(const void *data, struct simap *usage);
+
+    /* True if 'run' and the change handlers of the node's inputs only
+     * modify the node's own data and only read the data of its inputs and
+     * the databases, so that they can run in a worker thread concurrently
+     * with the other nodes that don't depend on it.  See
+     * engine_set_n_threads(). */
+    bool thread_safe;
+
+    /* Set when 'run' called engine_yield(), until the node is resumed or
+     * recomputed.  While set, the data of the node is not valid and the
+     * nodes that depend on it are not run. */
+    bool yielded;
+
+    /* True while 'run' is called to resume the work it yielded. */
+    bool resuming;
+
+    /* True if the node missed changes of its inputs because one of them
+     * yielded, so that it must be recomputed once that input is done. */
+    bool need_recompute;
+
     /* Engine stats. */
     struct engine_stats stats;
 };
@@ -195,6 +240,16 @@ void engine_run(bool recompute_allowed);
  * terminates. */
 void engine_cleanup(void);
 
+/* Adds to 'usage' the counters reported by the get_memory_usage() method of
+ * each engine node, e.g. for memory/show. */
+void engine_get_memory_usage(struct simap *usage);
+
+/* Sets the number of threads used by engine_run().  With more than one
+ * thread, the nodes that are marked 'thread_safe' and that don't depend on
+ * each other are run concurrently, the other nodes are still run by the
+ * calling thread.  With 1, the default, all the nodes run serially. */
+void engine_set_n_threads(size_t n_threads);
+
 /* Check if engine needs to run but didn't. */
 bool engine_need_run(void);
 
@@ -218,6 +273,14 @@ void engine_add_input(struct engine_node *node, struct engine_node *input,
  * iteration, and the change can't be tracked across iterations */
 void engine_set_force_recompute(bool val);
 
+/* Returns true if the current run was requested to recompute everything. */
+bool engine_get_force_recompute(void);
+
+/* Returns an identifier of the current run, incremented by each
+ * engine_init_run().  It allows nodes to tell whether something they
+ * remembered happened in the current run. */
+uint64_t engine_get_run_id(void);
+
 /* Return the current engine_context. The values in the context can be NULL
  * if the engine is run with allow_recompute == false in the current
  * iteration.
@@ -241,6 +304,24 @@ bool engine_has_run(void);
 /* Returns true if during the last engine run we had to abort processing. */
 bool engine_aborted(void);
 
+/* To be called by the 'run' method of 'node' when it returns before having
+ * processed all its inputs, e.g., because it has been running for too long,
+ * so that the main loop can do other work in the meantime.  The engine calls
+ * 'run' again in the next runs to resume it, with engine_node_resuming()
+ * returning true, until it returns without yielding.  Until then the data of
+ * 'node' is not valid and the nodes that depend on it are not run, but the
+ * other nodes are.  If the inputs of 'node' change in the meantime, 'run' is
+ * called to recompute it from scratch instead. */
+void engine_yield(struct engine_node *node);
+
+/* Returns true if the 'run' method of 'node' is called to resume the work it
+ * yielded in a previous engine run. */
+bool engine_node_resuming(const struct engine_node *node);
+
+/* Returns true if a node yielded during the last engine run, in which case
+ * the engine should run again soon to resume it. */
+bool engine_yielded(void);
+
 /* Return a pointer to node data accessible for users outside the processing
  * engine. If the node data is not valid (e.g., last engine_run() failed or
  * didn't happen), the node's is_valid() method is used to determine if the
@@ -297,30 +378,36 @@ engine_noop_handler(struct engine_node *node OVS_UNUSED, void *data OVS_UNUSED)
 void engine_ovsdb_node_add_index(struct engine_node *, const char *name,
                                  struct ovsdb_idl_index *);
 
-/* Macro to define an engine node. */
-#define ENGINE_NODE_DEF(NAME, NAME_STR) \
+/* Macros to define an engine node.  The optional methods ('is_valid',
+ * 'clear_tracked_data' and 'get_memory_usage') default to NULL, and
+ * 'thread_safe' to false.  They can be set between ENGINE_NODE_DEF_START()
+ * and ENGINE_NODE_DEF_END, so that the nodes can be defined both at file
+ * scope and within a function. */
+#define ENGINE_NODE_DEF_START(NAME, NAME_STR) \
     struct engine_node en_##NAME = { \
         .name = NAME_STR, \
         .data = NULL, \
         .state = EN_STALE, \
         .init = en_##NAME##_init, \
         .run = en_##NAME##_run, \
-        .cleanup = en_##NAME##_cleanup, \
-        .is_valid = NULL, \
-        .clear_tracked_data = NULL, \
-    };
+        .cleanup = en_##NAME##_cleanup,
 
-#define ENGINE_NODE_WITH_CLEAR_TRACK_DATA_IS_VALID(NAME, NAME_STR) \
-    ENGINE_NODE(NAME, NAME_STR) \
-    en_##NAME.clear_tracked_data = en_##NAME##_clear_tracked_data; \
-    en_##NAME.is_valid = en_##NAME##_is_valid;
+#define ENGINE_NODE_DEF_END };
 
 #define ENGINE_NODE(NAME, NAME_STR) \
-    ENGINE_NODE_DEF(NAME, NAME_STR)
+    ENGINE_NODE_DEF_START(NAME, NAME_STR) \
+    ENGINE_NODE_DEF_END
+
+#define ENGINE_NODE_WITH_CLEAR_TRACK_DATA_IS_VALID(NAME, NAME_STR) \
+    ENGINE_NODE_DEF_START(NAME, NAME_STR) \
+        .clear_tracked_data = en_##NAME##_clear_tracked_data, \
+        .is_valid = en_##NAME##_is_valid, \
+    ENGINE_NODE_DEF_END
 
 #define ENGINE_NODE_WITH_CLEAR_TRACK_DATA(NAME, NAME_STR) \
-    ENGINE_NODE(NAME, NAME_STR) \
-    en_##NAME.clear_tracked_data = en_##NAME##_clear_tracked_data;
+    ENGINE_NODE_DEF_START(NAME, NAME_STR) \
+        .clear_tracked_data = en_##NAME##_clear_tracked_data, \
+    ENGINE_NODE_DEF_END
 
 /* Macro to define member functions of an engine node which represents
  * a table of OVSDB */
@@ -365,6 +452,21 @@ static void en_##DB_NAME##_##TBL_NAME##_cleanup(void *data OVS_UNUSED) \
 #define ENGINE_FUNC_OVS(TBL_NAME) \
     ENGINE_FUNC_OVSDB(ovs, TBL_NAME)
 
+/* Macro to define member functions of an engine node which represents
+ * a table of OVN IC SB DB */
+#define ENGINE_FUNC_ICSB(TBL_NAME) \
+    ENGINE_FUNC_OVSDB(icsb, TBL_NAME)
+
+/* Macro to define member functions of an engine node which represents
+ * a table of OVN IC NB DB */
+#define ENGINE_FUNC_ICNB(TBL_NAME) \
+    ENGINE_FUNC_OVSDB(icnb, TBL_NAME)
+
+/* Macro to define member functions of an engine node which represents
+ * a table of hardware_vtep DB */
+#define ENGINE_FUNC_VTEP(TBL_NAME) \
+    ENGINE_FUNC_OVSDB(vtep, TBL_NAME)
+
 /* Macro to define an engine node which represents a table of OVSDB */
 #define ENGINE_NODE_OVSDB(DB_NAME, DB_NAME_STR, TBL_NAME, TBL_NAME_STR) \
     ENGINE_NODE(DB_NAME##_##TBL_NAME, DB_NAME_STR"_"TBL_NAME_STR)
@@ -382,4 +484,17 @@ static void en_##DB_NAME##_##TBL_NAME##_cleanup(void *data OVS_UNUSED) \
 #define ENGINE_NODE_OVS(TBL_NAME, TBL_NAME_STR) \
     ENGINE_NODE_OVSDB(ovs, "OVS", TBL_NAME, TBL_NAME_STR);
 
+/* Macro to define an engine node which represents a table of OVN IC SB DB */
+#define ENGINE_NODE_ICSB(TBL_NAME, TBL_NAME_STR) \
+    ENGINE_NODE_OVSDB(icsb, "ICSB", TBL_NAME, TBL_NAME_STR);
+
+/* Macro to define an engine node which represents a table of OVN IC NB DB */
+#define ENGINE_NODE_ICNB(TBL_NAME, TBL_NAME_STR) \
+    ENGINE_NODE_OVSDB(icnb, "ICNB", TBL_NAME, TBL_NAME_STR);
+
+/* Macro to define an engine node which represents a table of hardware_vtep
+ * DB */
+#define ENGINE_NODE_VTEP(TBL_NAME, TBL_NAME_STR) \
+    ENGINE_NODE_OVSDB(vtep, "VTEP", TBL_NAME, TBL_NAME_STR);
+
 #endif /* lib/inc-proc-eng.h */
@@ -21,30 +21,23 @@
 #include "lib/ovn-util.h"
 
 /* OpenvSwitch lib includes. */
+#include "coverage.h"
+#include "openvswitch/shash.h"
 #include "openvswitch/vlog.h"
 #include "lib/smap.h"
 
 VLOG_DEFINE_THIS_MODULE(lb);
 
-static
-bool ovn_lb_vip_init(struct ovn_lb_vip *lb_vip, const char *lb_key,
-                     const char *lb_value)
-{
-    int addr_family;
-
-    if (!ip_address_and_port_from_lb_key(lb_key, &lb_vip->vip_str,
-                                         &lb_vip->vip_port, &addr_family)) {
-        return false;
-    }
-
-    if (addr_family == AF_INET) {
-        ovs_be32 vip4;
-        ip_parse(lb_vip->vip_str, &vip4);
-        in6_addr_set_mapped_ipv4(&lb_vip->vip, vip4);
-    } else {
-        ipv6_parse(lb_vip->vip_str, &lb_vip->vip);
-    }
+COVERAGE_DEFINE(lb_vip_cache_hit);
+COVERAGE_DEFINE(lb_vip_cache_miss);
+COVERAGE_DEFINE(lb_vip_cache_backends_update);
 
+/* Parses the backends 'lb_value', of address family 'addr_family', of
+ * 'lb_vip'. */
+static void
+ovn_lb_vip_backends_init(struct ovn_lb_vip *lb_vip, const char *lb_value,
+                         int addr_family)
+{
     /* Format for backend ips: "IP1:port1,IP2:port2,...". */
     size_t n_backends = 0;
     size_t n_allocated_backends = 0;
@@ -84,6 +77,39 @@ bool ovn_lb_vip_init(struct ovn_lb_vip *lb_vip, const char *lb_key,
     }
     free(tokstr);
     lb_vip->n_backends = n_backends;
+}
+
+static void
+ovn_lb_vip_backends_destroy(struct ovn_lb_vip *vip)
+{
+    for (size_t i = 0; i < vip->n_backends; i++) {
+        free(vip->backends[i].ip_str);
+    }
+    free(vip->backends);
+    vip->backends = NULL;
+    vip->n_backends = 0;
+}
+
+static
+bool ovn_lb_vip_parse(struct ovn_lb_vip *lb_vip, const char *lb_key,
+                      const char *lb_value)
+{
+    int addr_family;
+
+    if (!ip_address_and_port_from_lb_key(lb_key, &lb_vip->vip_str,
+                                         &lb_vip->vip_port, &addr_family)) {
+        return false;
+    }
+
+    if (addr_family == AF_INET) {
+        ovs_be32 vip4;
+        ip_parse(lb_vip->vip_str, &vip4);
+        in6_addr_set_mapped_ipv4(&lb_vip->vip, vip4);
+    } else {
+        ipv6_parse(lb_vip->vip_str, &lb_vip->vip);
+    }
+
+    ovn_lb_vip_backends_init(lb_vip, lb_value, addr_family);
     return true;
 }
 
@@ -91,10 +117,189 @@ static
 void ovn_lb_vip_destroy(struct ovn_lb_vip *vip)
 {
     free(vip->vip_str);
-    for (size_t i = 0; i < vip->n_backends; i++) {
-        free(vip->backends[i].ip_str);
+    ovn_lb_vip_backends_destroy(vip);
+}
+
+/* Cache of the parsed VIPs of the load balancers.
+ *
+ * The load balancers are created again from their database row on most of
+ * their changes, and in ovn-controller every time their flows are computed,
+ * so the VIPs and backends, parsed with ip_address_and_port_from_lb_key(),
+ * are kept per load balancer, by Load_Balancer UUID, and copied from the
+ * cache unless they changed.  When only the backends of a VIP changed, only
+ * the backends are parsed again.
+ *
+ * The entries of the load balancers that are gone are removed by
+ * ovn_lb_cache_remove() or ovn_lb_cache_sweep(). */
+struct lb_cache_entry {
+    struct hmap_node hmap_node;  /* In 'lb_cache', by uuid_hash(&uuid). */
+    struct uuid uuid;            /* Load_Balancer UUID. */
+    unsigned int seqno;          /* Change seqno of the row 'vips' were
+                                  * last checked against. */
+    bool used;                   /* Used since the last sweep. */
+    struct shash vips;           /* Of "struct lb_cache_vip", by the 'vips'
+                                  * key, e.g. "10.0.0.10:80". */
+};
+
+struct lb_cache_vip {
+    char *backends;              /* 'vips' value, e.g. "10.0.0.3:80,...". */
+    bool valid;                  /* False if the VIP failed to parse. */
+    struct ovn_lb_vip vip;       /* Parsed 'vip', if 'valid'. */
+};
+
+static struct hmap lb_cache = HMAP_INITIALIZER(&lb_cache);
+
+static void
+lb_cache_vip_destroy(struct lb_cache_vip *cvip)
+{
+    if (cvip->valid) {
+        ovn_lb_vip_destroy(&cvip->vip);
+    }
+    free(cvip->backends);
+    free(cvip);
+}
+
+static void
+lb_cache_entry_destroy(struct lb_cache_entry *entry)
+{
+    struct shash_node *node;
+    SHASH_FOR_EACH_SAFE (node, &entry->vips) {
+        lb_cache_vip_destroy(node->data);
+        shash_delete(&entry->vips, node);
+    }
+    shash_destroy(&entry->vips);
+    hmap_remove(&lb_cache, &entry->hmap_node);
+    free(entry);
+}
+
+static struct lb_cache_entry *
+lb_cache_find(const struct uuid *lb_uuid)
+{
+    struct lb_cache_entry *entry;
+    HMAP_FOR_EACH_WITH_HASH (entry, hmap_node, uuid_hash(lb_uuid),
+                             &lb_cache) {
+        if (uuid_equals(&entry->uuid, lb_uuid)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/* Returns the cache entry of the load balancer 'row', whose VIPs are
+ * 'vips', after dropping the cached VIPs that are not in 'vips' anymore if
+ * the row changed since the entry was last used. */
+static struct lb_cache_entry *
+lb_cache_get(const struct ovsdb_idl_row *row, const struct smap *vips)
+{
+    unsigned int seqno = MAX(
+        ovsdb_idl_row_get_seqno(row, OVSDB_IDL_CHANGE_INSERT),
+        ovsdb_idl_row_get_seqno(row, OVSDB_IDL_CHANGE_MODIFY));
+    struct lb_cache_entry *entry = lb_cache_find(&row->uuid);
+
+    if (!entry) {
+        entry = xmalloc(sizeof *entry);
+        entry->uuid = row->uuid;
+        shash_init(&entry->vips);
+        hmap_insert(&lb_cache, &entry->hmap_node, uuid_hash(&row->uuid));
+    } else if (entry->seqno != seqno) {
+        struct shash_node *node;
+        SHASH_FOR_EACH_SAFE (node, &entry->vips) {
+            if (!smap_get(vips, node->name)) {
+                lb_cache_vip_destroy(node->data);
+                shash_delete(&entry->vips, node);
+            }
+        }
+    }
+    entry->seqno = seqno;
+    entry->used = true;
+    return entry;
+}
+
+/* Copies the parsed VIP 'src' into 'dst', except for 'empty_backend_rej'
+ * that is set by the callers. */
+static void
+ovn_lb_vip_clone(struct ovn_lb_vip *dst, const struct ovn_lb_vip *src)
+{
+    dst->vip = src->vip;
+    dst->vip_str = xstrdup(src->vip_str);
+    dst->vip_port = src->vip_port;
+    dst->n_backends = src->n_backends;
+    dst->backends = xmemdup(src->backends,
+                            src->n_backends * sizeof *src->backends);
+    for (size_t i = 0; i < src->n_backends; i++) {
+        dst->backends[i].ip_str = xstrdup(src->backends[i].ip_str);
+    }
+}
+
+/* Initializes 'lb_vip' from the 'vips' key 'lb_key' and value 'lb_value' of
+ * the load balancer of the cache 'entry', parsing them only if they are not
+ * in the cache yet.  Returns false if the VIP is invalid. */
+static bool
+ovn_lb_vip_init(struct lb_cache_entry *entry, struct ovn_lb_vip *lb_vip,
+                const char *lb_key, const char *lb_value)
+{
+    struct lb_cache_vip *cvip = shash_find_data(&entry->vips, lb_key);
+
+    if (!cvip) {
+        COVERAGE_INC(lb_vip_cache_miss);
+        cvip = xzalloc(sizeof *cvip);
+        cvip->backends = xstrdup(lb_value);
+        cvip->valid = ovn_lb_vip_parse(&cvip->vip, lb_key, lb_value);
+        shash_add(&entry->vips, lb_key, cvip);
+    } else if (cvip->valid && strcmp(cvip->backends, lb_value)) {
+        /* Only the backends of the VIP changed. */
+        COVERAGE_INC(lb_vip_cache_backends_update);
+        ovn_lb_vip_backends_destroy(&cvip->vip);
+        ovn_lb_vip_backends_init(&cvip->vip, lb_value,
+                                 IN6_IS_ADDR_V4MAPPED(&cvip->vip.vip)
+                                 ? AF_INET : AF_INET6);
+        free(cvip->backends);
+        cvip->backends = xstrdup(lb_value);
+    } else {
+        COVERAGE_INC(lb_vip_cache_hit);
+    }
+
+    if (!cvip->valid) {
+        return false;
+    }
+    ovn_lb_vip_clone(lb_vip, &cvip->vip);
+    return true;
+}
+
+/* Removes the cached VIPs of the load balancer 'lb_uuid', e.g. because it
+ * was deleted. */
+void
+ovn_lb_cache_remove(const struct uuid *lb_uuid)
+{
+    struct lb_cache_entry *entry = lb_cache_find(lb_uuid);
+    if (entry) {
+        lb_cache_entry_destroy(entry);
+    }
+}
+
+/* Removes the cached VIPs of the load balancers that were not created since
+ * the previous call.  To be called after creating all the load balancers
+ * that are still needed. */
+void
+ovn_lb_cache_sweep(void)
+{
+    struct lb_cache_entry *entry;
+    HMAP_FOR_EACH_SAFE (entry, hmap_node, &lb_cache) {
+        if (!entry->used) {
+            lb_cache_entry_destroy(entry);
+        } else {
+            entry->used = false;
+        }
+    }
+}
+
+void
+ovn_lb_cache_clear(void)
+{
+    struct lb_cache_entry *entry;
+    HMAP_FOR_EACH_SAFE (entry, hmap_node, &lb_cache) {
+        lb_cache_entry_destroy(entry);
     }
-    free(vip->backends);
 }
 
 static
@@ -175,6 +380,9 @@ ovn_northd_lb_create(const struct nbrec_load_balancer *nbrec_lb)
     lb->vips_nb = xcalloc(lb->n_vips, sizeof *lb->vips_nb);
     sset_init(&lb->ips_v4);
     sset_init(&lb->ips_v6);
+    ovs_list_init(&lb->lflows);
+    struct lb_cache_entry *entry = lb_cache_get(&nbrec_lb->header_,
+                                                &nbrec_lb->vips);
     struct smap_node *node;
     size_t n_vips = 0;
 
@@ -184,7 +392,7 @@ ovn_northd_lb_create(const struct nbrec_load_balancer *nbrec_lb)
 
         lb_vip->empty_backend_rej = smap_get_bool(&nbrec_lb->options,
                                                   "reject", false);
-        if (!ovn_lb_vip_init(lb_vip, node->key, node->value)) {
+        if (!ovn_lb_vip_init(entry, lb_vip, node->key, node->value)) {
             continue;
         }
         ovn_northd_lb_vip_init(lb_vip_nb, lb_vip, nbrec_lb,
@@ -284,13 +492,15 @@ ovn_controller_lb_create(const struct sbrec_load_balancer *sbrec_lb)
     lb->n_vips = smap_count(&sbrec_lb->vips);
     lb->vips = xcalloc(lb->n_vips, sizeof *lb->vips);
 
+    struct lb_cache_entry *entry = lb_cache_get(&sbrec_lb->header_,
+                                                &sbrec_lb->vips);
     struct smap_node *node;
     size_t n_vips = 0;
 
     SMAP_FOR_EACH (node, &sbrec_lb->vips) {
         struct ovn_lb_vip *lb_vip = &lb->vips[n_vips];
 
-        if (!ovn_lb_vip_init(lb_vip, node->key, node->value)) {
+        if (!ovn_lb_vip_init(entry, lb_vip, node->key, node->value)) {
             continue;
         }
         n_vips++;
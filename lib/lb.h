@@ -20,6 +20,7 @@
 #include <sys/types.h>
 #include <netinet/in.h>
 #include "openvswitch/hmap.h"
+#include "openvswitch/list.h"
 #include "sset.h"
 #include "ovn-util.h"
 
@@ -50,6 +51,10 @@ struct ovn_northd_lb {
     size_t n_nb_lr;
     size_t n_allocated_nb_lr;
     struct ovn_datapath **nb_lr;
+
+    /* List of struct lflow_ref_node, the logical flows generated by
+     * ovn-northd for this load balancer. */
+    struct ovs_list lflows;
 };
 
 struct ovn_lb_vip {
@@ -112,4 +117,10 @@ struct ovn_controller_lb *ovn_controller_lb_create(
     const struct sbrec_load_balancer *);
 void ovn_controller_lb_destroy(struct ovn_controller_lb *);
 
+/* Cache of the parsed VIPs, used by ovn_northd_lb_create() and
+ * ovn_controller_lb_create(). */
+void ovn_lb_cache_remove(const struct uuid *lb_uuid);
+void ovn_lb_cache_sweep(void);
+void ovn_lb_cache_clear(void);
+
 #endif /* OVN_LIB_LB_H 1 */
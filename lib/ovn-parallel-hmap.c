@@ -33,6 +33,7 @@
 #include "ovs-thread.h"
 #include "ovs-numa.h"
 #include "random.h"
+#include "timeval.h"
 
 VLOG_DEFINE_THIS_MODULE(ovn_parallel_hmap);
 
@@ -55,6 +56,9 @@ static struct ovs_mutex init_mutex = OVS_MUTEX_INITIALIZER;
 
 static size_t pool_size = 1;
 
+/* CPU mask of the cores the workers are pinned to, or NULL. */
+static char *worker_cpu_mask;
+
 static int sembase;
 
 static void worker_pool_hook(void *aux OVS_UNUSED);
@@ -138,6 +142,65 @@ free_pool(struct worker_pool *pool)
     free(pool);
 }
 
+static int
+compare_cores(const void *a_, const void *b_)
+{
+    const struct ovs_numa_info_core *const *a = a_;
+    const struct ovs_numa_info_core *const *b = b_;
+
+    if ((*a)->numa_id != (*b)->numa_id) {
+        return (*a)->numa_id < (*b)->numa_id ? -1 : 1;
+    }
+    return (*a)->core_id < (*b)->core_id ? -1 : (*a)->core_id > (*b)->core_id;
+}
+
+/* Assigns to the workers of 'pool' the cores of 'worker_cpu_mask', sorted by
+ * NUMA node, so that neighbor workers, which share the most work, are on the
+ * same node. */
+static void
+assign_cores(struct worker_pool *pool)
+{
+    for (size_t i = 0; i < pool->size; i++) {
+        pool->controls[i].core_id = -1;
+        pool->controls[i].numa_id = -1;
+    }
+    if (!worker_cpu_mask) {
+        return;
+    }
+
+    ovs_numa_init();
+    struct ovs_numa_dump *dump =
+        ovs_numa_dump_cores_with_cmask(worker_cpu_mask);
+    size_t n_cores = ovs_numa_dump_count(dump);
+    if (!n_cores) {
+        VLOG_WARN("No core in CPU mask %s, worker threads are not pinned",
+                  worker_cpu_mask);
+        ovs_numa_dump_destroy(dump);
+        return;
+    }
+
+    const struct ovs_numa_info_core **cores = xmalloc(n_cores
+                                                      * sizeof *cores);
+    const struct ovs_numa_info_core *core;
+    size_t n = 0;
+    FOR_EACH_CORE_ON_DUMP (core, dump) {
+        cores[n++] = core;
+    }
+    qsort(cores, n_cores, sizeof *cores, compare_cores);
+
+    if (pool->size > n_cores) {
+        VLOG_WARN("%"PRIuSIZE" worker threads for %"PRIuSIZE" cores in CPU "
+                  "mask %s, some threads share a core",
+                  pool->size, n_cores, worker_cpu_mask);
+    }
+    for (size_t i = 0; i < pool->size; i++) {
+        pool->controls[i].core_id = cores[i % n_cores]->core_id;
+        pool->controls[i].numa_id = cores[i % n_cores]->numa_id;
+    }
+    free(cores);
+    ovs_numa_dump_destroy(dump);
+}
+
 static int
 init_controls(struct worker_pool *pool)
 {
@@ -157,6 +220,10 @@ init_controls(struct worker_pool *pool)
         new_control->worker = 0;
         ovs_mutex_init(&new_control->mutex);
         new_control->finished = ATOMIC_VAR_INIT(false);
+        new_control->task_next = 0;
+        new_control->task_end = 0;
+        new_control->task_start = 0;
+        memset(&new_control->stats, 0, sizeof new_control->stats);
         sprintf(sem_name, WORKER_SEM_NAME, sembase, pool, i);
         new_control->fire = sem_open(sem_name, O_CREAT, S_IRWXU, 0);
         if (new_control->fire == SEM_FAILED) {
@@ -164,19 +231,56 @@ init_controls(struct worker_pool *pool)
             return -1;
         }
     }
+    assign_cores(pool);
     return 0;
 }
 
+static void *
+worker_main(void *control_)
+{
+    struct worker_control *control = control_;
+
+    if (control->core_id >= 0) {
+        int error = ovs_numa_thread_setaffinity_core(control->core_id);
+        if (error) {
+            VLOG_WARN("Failed to pin worker thread %d to core %d: %s",
+                      control->id, control->core_id, ovs_strerror(error));
+        }
+    }
+    return control->pool->start(control);
+}
+
 static void
 init_threads(struct worker_pool *pool, void *(*start)(void *))
 {
+    pool->start = start;
     for (size_t i = 0; i < pool_size; i++) {
         pool->controls[i].worker =
-            ovs_thread_create("worker pool helper", start, &pool->controls[i]);
+            ovs_thread_create("worker pool helper", worker_main,
+                              &pool->controls[i]);
     }
     ovs_list_push_back(&worker_pools, &pool->list_node);
 }
 
+void
+ovn_set_worker_cpu_mask(const char *cmask)
+{
+    struct worker_pool *pool;
+
+    ovs_mutex_lock(&init_mutex);
+    free(worker_cpu_mask);
+    worker_cpu_mask = cmask && cmask[0] ? xstrdup(cmask) : NULL;
+
+    /* A thread can only pin itself, so the threads are restarted. */
+    LIST_FOR_EACH_SAFE (pool, list_node, &worker_pools) {
+        stop_controls(pool);
+        ovs_list_remove(&pool->list_node);
+        assign_cores(pool);
+        init_threads(pool, pool->start);
+    }
+    ovs_mutex_unlock(&init_mutex);
+}
+
 enum pool_update_status
 ovn_update_worker_pool(size_t requested_pool_size,
                        struct worker_pool **pool, void *(*start)(void *))
@@ -206,6 +310,9 @@ ovn_update_worker_pool(size_t requested_pool_size,
             *pool = xmalloc(sizeof(struct worker_pool));
             (*pool)->size = pool_size;
             (*pool)->controls = NULL;
+            (*pool)->start = start;
+            (*pool)->has_tasks = false;
+            (*pool)->run_usec = 0;
             sprintf(sem_name, MAIN_SEM_NAME, sembase, *pool);
             (*pool)->done = sem_open(sem_name, O_CREAT, S_IRWXU, 0);
             if ((*pool)->done == SEM_FAILED) {
@@ -224,6 +331,8 @@ ovn_update_worker_pool(size_t requested_pool_size,
             free_controls(*pool);
             ovs_list_remove(&(*pool)->list_node);
             (*pool)->size = pool_size;
+            (*pool)->has_tasks = false;
+            (*pool)->run_usec = 0;
             if (init_controls(*pool) == -1) {
                 goto cleanup;
             }
@@ -300,6 +409,7 @@ ovn_run_pool_callback(struct worker_pool *pool,
                                           void *fin_result,
                                           void *result_frags, size_t index))
 {
+    long long int start = pool->has_tasks ? time_usec() : 0;
     size_t index, completed;
 
     /* Ensure that all worker threads see the same data as the
@@ -353,6 +463,11 @@ ovn_run_pool_callback(struct worker_pool *pool,
             }
         }
     } while (completed < pool->size);
+
+    if (pool->has_tasks) {
+        pool->run_usec += time_usec() - start;
+        pool->has_tasks = false;
+    }
 }
 
 /* Run a thread pool - basic, does not do results processing.
@@ -363,6 +478,129 @@ ovn_run_pool(struct worker_pool *pool)
     run_pool_callback(pool, NULL, NULL, NULL);
 }
 
+/* Spreads the tasks 0 to 'n_tasks' - 1 over the queues of the workers of
+ * 'pool', for its next run.  Must be called while the workers are idle. */
+void
+ovn_pool_set_tasks(struct worker_pool *pool, size_t n_tasks)
+{
+    for (size_t i = 0; i < pool->size; i++) {
+        struct worker_control *control = &pool->controls[i];
+
+        ovs_mutex_lock(&control->mutex);
+        control->task_next = n_tasks * i / pool->size;
+        control->task_end = n_tasks * (i + 1) / pool->size;
+        ovs_mutex_unlock(&control->mutex);
+        control->task_start = 0;
+        control->stats.n_runs++;
+    }
+    pool->has_tasks = true;
+}
+
+/* Moves half of the remaining tasks of the most loaded worker of the pool of
+ * 'thief' to the, empty, queue of 'thief'.  Only one queue is locked at a
+ * time.  Returns false if there was no task left to steal. */
+static bool
+worker_steal_tasks(struct worker_control *thief)
+{
+    struct worker_pool *pool = thief->pool;
+
+    for (;;) {
+        struct worker_control *victim = NULL;
+        size_t max_left = 0;
+
+        for (size_t i = 0; i < pool->size; i++) {
+            struct worker_control *control = &pool->controls[i];
+            size_t left;
+
+            if (control == thief) {
+                continue;
+            }
+            ovs_mutex_lock(&control->mutex);
+            left = control->task_end - control->task_next;
+            ovs_mutex_unlock(&control->mutex);
+            if (left > max_left) {
+                max_left = left;
+                victim = control;
+            }
+        }
+        if (!victim) {
+            return false;
+        }
+
+        /* The victim may have made progress since it was picked, so the
+         * number of tasks to steal is computed again under its lock. */
+        size_t end, n;
+
+        ovs_mutex_lock(&victim->mutex);
+        end = victim->task_end;
+        n = (end - victim->task_next + 1) / 2;
+        victim->task_end -= n;
+        ovs_mutex_unlock(&victim->mutex);
+        if (!n) {
+            continue;
+        }
+
+        ovs_mutex_lock(&thief->mutex);
+        thief->task_next = end - n;
+        thief->task_end = end;
+        ovs_mutex_unlock(&thief->mutex);
+        thief->stats.n_stolen += n;
+        return true;
+    }
+}
+
+/* Stores in '*task' the next task to be processed by the worker 'control',
+ * taken from its own queue or, if that is empty, stolen from another worker
+ * of the pool, and returns true.  Returns false once all the tasks of the
+ * pool are taken. */
+bool
+ovn_worker_next_task(struct worker_control *control, size_t *task)
+{
+    if (!control->task_start) {
+        control->task_start = time_usec();
+    }
+
+    do {
+        ovs_mutex_lock(&control->mutex);
+        if (control->task_next < control->task_end) {
+            *task = control->task_next++;
+            ovs_mutex_unlock(&control->mutex);
+            control->stats.n_tasks++;
+            return true;
+        }
+        ovs_mutex_unlock(&control->mutex);
+    } while (worker_steal_tasks(control));
+
+    control->stats.busy_usec += time_usec() - control->task_start;
+    control->task_start = 0;
+    return false;
+}
+
+void
+ovn_pool_format_stats(const struct worker_pool *pool, struct ds *s)
+{
+    ds_put_format(s, "Wall time: %llu usec\n", pool->run_usec);
+    for (size_t i = 0; i < pool->size; i++) {
+        const struct worker_control *control = &pool->controls[i];
+        const struct worker_stats *stats = &control->stats;
+
+        ds_put_format(s, "Worker %"PRIuSIZE, i);
+        if (control->core_id >= 0) {
+            ds_put_format(s, " (core %d, NUMA %d)",
+                          control->core_id, control->numa_id);
+        }
+        ds_put_format(s, ": %llu runs, %llu tasks (%llu stolen), "
+                      "busy %llu usec",
+                      stats->n_runs, stats->n_tasks, stats->n_stolen,
+                      stats->busy_usec);
+        if (pool->run_usec) {
+            ds_put_format(s, " (%llu%%)",
+                          MIN(stats->busy_usec * 100 / pool->run_usec, 100));
+        }
+        ds_put_char(s, '\n');
+    }
+}
+
 /* Brute force merge of a hashmap into another hashmap.
  * Intended for use in parallel processing. The destination
  * hashmap MUST be the same size as the one being merged.
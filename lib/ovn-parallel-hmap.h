@@ -29,6 +29,7 @@ extern "C" {
 #include <stdlib.h>
 #include <semaphore.h>
 #include <errno.h>
+#include "openvswitch/dynamic-string.h"
 #include "openvswitch/util.h"
 #include "openvswitch/hmap.h"
 #include "openvswitch/thread.h"
@@ -74,15 +75,32 @@ extern "C" {
 
 /* Work "Handle" */
 
+/* Statistics of a worker thread, cumulative since the pool was (re)sized. */
+struct worker_stats {
+    unsigned long long n_runs;    /* Runs of the pool that used tasks. */
+    unsigned long long n_tasks;   /* Tasks processed by the worker. */
+    unsigned long long n_stolen;  /* Tasks stolen from other workers. */
+    unsigned long long busy_usec; /* Time spent processing tasks. */
+};
+
 struct worker_control {
     int id; /* Used as a modulo when iterating over a hash. */
     atomic_bool finished; /* Set to true after achunk of work is complete. */
     sem_t *fire; /* Work start semaphore - sem_post starts the worker. */
     sem_t *done; /* Work completion semaphore - sem_post on completion. */
-    struct ovs_mutex mutex; /* Guards the data. */
+    struct ovs_mutex mutex; /* Guards the data and the task queue. */
     void *data; /* Pointer to data to be processed. */
     pthread_t worker;
     struct worker_pool *pool;
+    int core_id; /* Core the worker is pinned to, or -1. */
+    int numa_id; /* NUMA node of 'core_id', or -1. */
+
+    /* Task queue, see ovn_worker_next_task().  The worker takes tasks from
+     * the front of [task_next, task_end), thieves from the back. */
+    size_t task_next;
+    size_t task_end;
+    long long int task_start; /* Time of the first task of the run. */
+    struct worker_stats stats;
 };
 
 struct worker_pool {
@@ -90,6 +108,9 @@ struct worker_pool {
     struct ovs_list list_node; /* List of pools - used in cleanup/exit. */
     struct worker_control *controls; /* "Handles" in this pool. */
     sem_t *done; /* Work completion semaphorew. */
+    void *(*start)(void *); /* Thread function of the workers. */
+    bool has_tasks; /* Set by ovn_pool_set_tasks() for the next run. */
+    unsigned long long run_usec; /* Wall time of the runs that used tasks. */
 };
 
 /* Return pool size; bigger than 1 means parallelization has been enabled. */
@@ -107,6 +128,13 @@ enum pool_update_status ovn_update_worker_pool(size_t requested_pool_size,
                                                struct worker_pool **,
                                                void *(*start)(void *));
 
+/* Pins the worker threads to the cores in 'cmask', a hexadecimal CPU mask
+ * as in ovs-vswitchd's pmd-cpu-mask, or lets them run on any core if 'cmask'
+ * is NULL or empty.  The workers are assigned the cores by NUMA node, so that
+ * a pool is spread over as few nodes as possible.  The threads of the
+ * existing pools are restarted to apply the change. */
+void ovn_set_worker_cpu_mask(const char *cmask);
+
 /* Setting this to true will make all processing threads exit */
 
 bool ovn_stop_parallel_processing(void);
@@ -153,6 +181,37 @@ void ovn_run_pool_callback(struct worker_pool *pool, void *fin_result,
                            void *fin_result, void *result_frags,
                            size_t index));
 
+/* Work-stealing task queues.
+ *
+ * Rather than walking a fixed slice of the work, e.g. every pool->size'th
+ * bucket of a hash map, the workers of a pool may process tasks numbered
+ * from 0 to 'n_tasks' - 1, where a task is whatever unit of work the caller
+ * chooses, e.g. a single bucket.  ovn_pool_set_tasks() hands out the tasks in
+ * contiguous ranges, one per worker, and a worker whose range is exhausted
+ * steals half of the remaining tasks of the most loaded worker, so that a few
+ * expensive tasks do not leave the other threads idle:
+ *
+ *     ovn_pool_set_tasks(pool, n_tasks);
+ *     ovn_run_pool(pool);
+ *
+ * and in the worker thread:
+ *
+ *     size_t task;
+ *     while (ovn_worker_next_task(control, &task)) {
+ *         ...process 'task'...
+ *     }
+ *
+ * The tasks must be independent of each other, since any worker may process
+ * any of them, in any order.  ovn_pool_set_tasks() must be called before
+ * every run of the pool that uses the tasks. */
+
+void ovn_pool_set_tasks(struct worker_pool *pool, size_t n_tasks);
+
+bool ovn_worker_next_task(struct worker_control *control, size_t *task);
+
+/* Appends the per worker statistics of 'pool' to 's'. */
+
+void ovn_pool_format_stats(const struct worker_pool *pool, struct ds *s);
 
 /* Returns the first node in 'hmap' in the bucket in which the given 'hash'
  * would land, or a null pointer if that bucket is empty. */
@@ -272,6 +331,8 @@ static inline void init_hash_row_locks(struct hashrow_locks *hrl)
 
 #define get_worker_pool_size() ovn_get_worker_pool_size()
 
+#define set_worker_cpu_mask(cmask) ovn_set_worker_cpu_mask(cmask)
+
 #define update_hashrow_locks(lflows, hrl) ovn_update_hashrow_locks(lflows, hrl)
 
 #define stop_parallel_processing() ovn_stop_parallel_processing()
@@ -297,6 +358,12 @@ static inline void init_hash_row_locks(struct hashrow_locks *hrl)
 #define run_pool_callback(pool, fin_result, result_frags, helper_func) \
     ovn_run_pool_callback(pool, fin_result, result_frags, helper_func)
 
+#define pool_set_tasks(pool, n_tasks) ovn_pool_set_tasks(pool, n_tasks)
+
+#define worker_next_task(control, task) ovn_worker_next_task(control, task)
+
+#define pool_format_stats(pool, s) ovn_pool_format_stats(pool, s)
+
 
 
 #ifdef __clang__
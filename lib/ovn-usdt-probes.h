@@ -0,0 +1,36 @@
+/* Copyright (c) 2022, Red Hat, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef OVN_USDT_PROBES_H
+#define OVN_USDT_PROBES_H 1
+
+/* User Statically Defined Tracing (USDT) probes.
+ *
+ * The probes are only compiled in if OVN was configured with
+ * --enable-usdt-probes, otherwise OVN_USDT_PROBE() expands to nothing.  A
+ * probe is a single no-op instruction while no tracer is attached to it, but
+ * its arguments are still computed, so they should be values that are at hand
+ * already.  The available probes are listed in
+ * Documentation/topics/usdt-probes.rst. */
+
+#ifdef HAVE_USDT_PROBES
+#include <sys/sdt.h>
+
+#define OVN_USDT_PROBE(provider, name, ...) \
+    STAP_PROBEV(provider, name, ##__VA_ARGS__)
+#else
+#define OVN_USDT_PROBE(...)
+#endif
+
+#endif /* lib/ovn-usdt-probes.h */
@@ -19,20 +19,29 @@
 #include <ctype.h>
 #include <unistd.h>
 
+#include "bitmap.h"
+#include "coverage.h"
 #include "daemon.h"
+#include "hash.h"
 #include "include/ovn/actions.h"
+#include "openvswitch/dynamic-string.h"
+#include "openvswitch/json.h"
 #include "openvswitch/ofp-parse.h"
 #include "openvswitch/vlog.h"
 #include "lib/vswitch-idl.h"
 #include "ovn-dirs.h"
 #include "ovn-nb-idl.h"
 #include "ovn-sb-idl.h"
+#include "ovs-thread.h"
 #include "socket-util.h"
 #include "svec.h"
 #include "unixctl.h"
 
 VLOG_DEFINE_THIS_MODULE(ovn_util);
 
+COVERAGE_DEFINE(lport_addresses_cache_hit);
+COVERAGE_DEFINE(lport_addresses_cache_miss);
+
 void ovn_conn_show(struct unixctl_conn *conn, int argc OVS_UNUSED,
                    const char *argv[] OVS_UNUSED, void *idl_)
 {
@@ -119,9 +128,176 @@ is_dynamic_lsp_address(const char *address)
                          ETH_ADDR_SCAN_ARGS(ea), &n) && address[n] == '\0'));
 }
 
+/* Cache of the parsed addresses, by the string they were parsed from.
+ *
+ * The addresses of the ports are parsed again on every full recompute of
+ * ovn-northd and ovn-controller, although they rarely change, so the results
+ * of the parsing are kept here and copied into the callers' 'struct
+ * lport_addresses'.  The cache is used by several threads, e.g. by the
+ * ovn-northd parallel build and the ovn-controller pinctrl thread, so it is
+ * split in shards, each with its own lock.  The entries that are not used
+ * between two calls to lport_addresses_cache_sweep() are dropped.
+ *
+ * The cache is only used by the daemons that enable it with
+ * lport_addresses_cache_enable(), since they must also sweep it. */
+#define ADDR_CACHE_N_SHARDS 16
+
+enum addr_cache_kind {
+    ADDR_CACHE_LSP,             /* "MAC [IP1 IP2 ..]". */
+    ADDR_CACHE_IPS,             /* "IP1 IP2 ..". */
+    ADDR_CACHE_LRP,             /* Router port "MAC NETWORK1 NETWORK2 ..". */
+};
+
+struct addr_cache_node {
+    struct hmap_node hmap_node;  /* In 'struct addr_cache_shard's 'nodes'. */
+    enum addr_cache_kind kind;
+    bool used;                   /* Used since the last sweep. */
+    bool ok;                     /* Result of the parsing. */
+    int ofs;                     /* Offset of the unparsed content. */
+    struct lport_addresses laddrs;
+    char key[];                  /* String that was parsed. */
+};
+
+struct addr_cache_shard {
+    struct ovs_mutex mutex;
+    struct hmap nodes;           /* Guarded by 'mutex'. */
+};
+
+static struct addr_cache_shard addr_cache[ADDR_CACHE_N_SHARDS];
+static bool addr_cache_enabled = false;
+
+/* Enables the cache of the parsed addresses.  Must be called before the
+ * threads that parse addresses are started. */
+void
+lport_addresses_cache_enable(void)
+{
+    addr_cache_enabled = true;
+}
+
+static struct addr_cache_shard *
+addr_cache_get_shard(uint32_t hash)
+{
+    static struct ovsthread_once once = OVSTHREAD_ONCE_INITIALIZER;
+
+    if (ovsthread_once_start(&once)) {
+        for (size_t i = 0; i < ADDR_CACHE_N_SHARDS; i++) {
+            ovs_mutex_init(&addr_cache[i].mutex);
+            hmap_init(&addr_cache[i].nodes);
+        }
+        ovsthread_once_done(&once);
+    }
+    return &addr_cache[hash % ADDR_CACHE_N_SHARDS];
+}
+
+static void
+lport_addresses_clone(struct lport_addresses *dst,
+                      const struct lport_addresses *src)
+{
+    *dst = *src;
+    dst->ipv4_addrs = (src->n_ipv4_addrs
+                       ? xmemdup(src->ipv4_addrs, src->n_ipv4_addrs
+                                                  * sizeof *src->ipv4_addrs)
+                       : NULL);
+    dst->ipv6_addrs = (src->n_ipv6_addrs
+                       ? xmemdup(src->ipv6_addrs, src->n_ipv6_addrs
+                                                  * sizeof *src->ipv6_addrs)
+                       : NULL);
+}
+
+static struct addr_cache_node *
+addr_cache_find(struct addr_cache_shard *shard, enum addr_cache_kind kind,
+                const char *key, uint32_t hash)
+    OVS_REQUIRES(shard->mutex)
+{
+    struct addr_cache_node *node;
+    HMAP_FOR_EACH_WITH_HASH (node, hmap_node, hash, &shard->nodes) {
+        if (node->kind == kind && !strcmp(node->key, key)) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+/* Looks up the result of the parsing of 'key' as 'kind'.  If it is cached,
+ * copies it into '*laddrs', '*ofs' and '*ok' and returns true. */
 static bool
-parse_and_store_addresses(const char *address, struct lport_addresses *laddrs,
-                          int *ofs, bool extract_eth_addr)
+addr_cache_lookup(enum addr_cache_kind kind, const char *key,
+                  struct lport_addresses *laddrs, int *ofs, bool *ok)
+{
+    uint32_t hash = hash_string(key, kind);
+    struct addr_cache_shard *shard = addr_cache_get_shard(hash);
+    struct addr_cache_node *node;
+
+    ovs_mutex_lock(&shard->mutex);
+    node = addr_cache_find(shard, kind, key, hash);
+    if (node) {
+        node->used = true;
+        lport_addresses_clone(laddrs, &node->laddrs);
+        *ofs = node->ofs;
+        *ok = node->ok;
+    }
+    ovs_mutex_unlock(&shard->mutex);
+
+    if (node) {
+        COVERAGE_INC(lport_addresses_cache_hit);
+        return true;
+    }
+    COVERAGE_INC(lport_addresses_cache_miss);
+    return false;
+}
+
+static void
+addr_cache_insert(enum addr_cache_kind kind, const char *key,
+                  const struct lport_addresses *laddrs, int ofs, bool ok)
+{
+    uint32_t hash = hash_string(key, kind);
+    struct addr_cache_shard *shard = addr_cache_get_shard(hash);
+
+    ovs_mutex_lock(&shard->mutex);
+    /* Another thread may have parsed the same string meanwhile. */
+    if (!addr_cache_find(shard, kind, key, hash)) {
+        size_t key_len = strlen(key) + 1;
+        struct addr_cache_node *node = xmalloc(sizeof *node + key_len);
+
+        node->kind = kind;
+        node->used = true;
+        node->ok = ok;
+        node->ofs = ofs;
+        lport_addresses_clone(&node->laddrs, laddrs);
+        memcpy(node->key, key, key_len);
+        hmap_insert(&shard->nodes, &node->hmap_node, hash);
+    }
+    ovs_mutex_unlock(&shard->mutex);
+}
+
+/* Drops the cached addresses that were not used since the previous call.
+ * To be called after a full recompute, which parses all the addresses that
+ * are still needed. */
+void
+lport_addresses_cache_sweep(void)
+{
+    for (size_t i = 0; i < ADDR_CACHE_N_SHARDS; i++) {
+        struct addr_cache_shard *shard = addr_cache_get_shard(i);
+        struct addr_cache_node *node;
+
+        ovs_mutex_lock(&shard->mutex);
+        HMAP_FOR_EACH_SAFE (node, hmap_node, &shard->nodes) {
+            if (!node->used) {
+                hmap_remove(&shard->nodes, &node->hmap_node);
+                destroy_lport_addresses(&node->laddrs);
+                free(node);
+            } else {
+                node->used = false;
+            }
+        }
+        ovs_mutex_unlock(&shard->mutex);
+    }
+}
+
+static bool
+parse_and_store_addresses__(const char *address,
+                            struct lport_addresses *laddrs,
+                            int *ofs, bool extract_eth_addr)
 {
     memset(laddrs, 0, sizeof *laddrs);
 
@@ -174,6 +350,26 @@ parse_and_store_addresses(const char *address, struct lport_addresses *laddrs,
     return true;
 }
 
+static bool
+parse_and_store_addresses(const char *address, struct lport_addresses *laddrs,
+                          int *ofs, bool extract_eth_addr)
+{
+    enum addr_cache_kind kind = (extract_eth_addr ? ADDR_CACHE_LSP
+                                 : ADDR_CACHE_IPS);
+    bool ok;
+
+    if (!addr_cache_enabled) {
+        return parse_and_store_addresses__(address, laddrs, ofs,
+                                           extract_eth_addr);
+    }
+    if (!addr_cache_lookup(kind, address, laddrs, ofs, &ok)) {
+        ok = parse_and_store_addresses__(address, laddrs, ofs,
+                                         extract_eth_addr);
+        addr_cache_insert(kind, address, laddrs, *ofs, ok);
+    }
+    return ok;
+}
+
 /* Extracts the mac, IPv4 and IPv6 addresses from * 'address' which
  * should be of the format "MAC [IP1 IP2 ..] .." where IPn should be a
  * valid IPv4 or IPv6 address and stores them in the 'ipv4_addrs' and
@@ -272,11 +468,9 @@ extract_lrp_networks(const struct nbrec_logical_router_port *lrp,
                                   laddrs);
 }
 
-/* Separate out the body of 'extract_lrp_networks()' for use from DDlog,
- * which does not know the 'nbrec_logical_router_port' type. */
-bool
-extract_lrp_networks__(char *mac, char **networks, size_t n_networks,
-                       struct lport_addresses *laddrs)
+static bool
+extract_lrp_networks___(const char *mac, char **networks, size_t n_networks,
+                        struct lport_addresses *laddrs)
 {
     memset(laddrs, 0, sizeof *laddrs);
 
@@ -325,6 +519,33 @@ extract_lrp_networks__(char *mac, char **networks, size_t n_networks,
     return true;
 }
 
+/* Separate out the body of 'extract_lrp_networks()' for use from DDlog,
+ * which does not know the 'nbrec_logical_router_port' type. */
+bool
+extract_lrp_networks__(char *mac, char **networks, size_t n_networks,
+                       struct lport_addresses *laddrs)
+{
+    if (!addr_cache_enabled) {
+        return extract_lrp_networks___(mac, networks, n_networks, laddrs);
+    }
+
+    struct ds key = DS_EMPTY_INITIALIZER;
+    bool ok;
+    int ofs;
+
+    ds_put_cstr(&key, mac);
+    for (size_t i = 0; i < n_networks; i++) {
+        ds_put_format(&key, " %s", networks[i]);
+    }
+    if (!addr_cache_lookup(ADDR_CACHE_LRP, ds_cstr(&key), laddrs, &ofs,
+                           &ok)) {
+        ok = extract_lrp_networks___(mac, networks, n_networks, laddrs);
+        addr_cache_insert(ADDR_CACHE_LRP, ds_cstr(&key), laddrs, 0, ok);
+    }
+    ds_destroy(&key);
+    return ok;
+}
+
 bool
 extract_sbrec_binding_first_mac(const struct sbrec_port_binding *binding,
                                 struct eth_addr *ea)
@@ -559,74 +780,151 @@ ovn_logical_flow_hash_datapath(const struct uuid *logical_datapath,
     return hash_add(hash, uuid_hash(logical_datapath));
 }
 
+bool
+sbrec_logical_flow_is_port_template(const struct sbrec_logical_flow *lflow)
+{
+    return smap_get_bool(&lflow->tags, "port_template", false);
+}
+
+/* Returns a copy of 's', the match or the actions of a port template logical
+ * flow, expanded for 'port' and 'mac'.  The caller must free it. */
+char *
+ovn_port_template_expand(const char *s, const char *port,
+                         const struct eth_addr *mac)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+
+    while (*s) {
+        if (!strncmp(s, OVN_PORT_TEMPLATE_PORT,
+                     strlen(OVN_PORT_TEMPLATE_PORT))) {
+            json_string_escape(port, &ds);
+            s += strlen(OVN_PORT_TEMPLATE_PORT);
+        } else if (!strncmp(s, OVN_PORT_TEMPLATE_MAC,
+                            strlen(OVN_PORT_TEMPLATE_MAC))) {
+            ds_put_format(&ds, ETH_ADDR_FMT, ETH_ADDR_ARGS(*mac));
+            s += strlen(OVN_PORT_TEMPLATE_MAC);
+        } else {
+            ds_put_char(&ds, *s++);
+        }
+    }
+    return ds_steal_cstr(&ds);
+}
+
 
-struct tnlid_node {
-    struct hmap_node hmap_node;
-    uint32_t tnlid;
-};
+void
+ovn_init_tnlids(struct ovn_tnlids *tnlids)
+{
+    tnlids->bitmap = NULL;
+    tnlids->n_bits = 0;
+}
 
 void
-ovn_destroy_tnlids(struct hmap *tnlids)
+ovn_destroy_tnlids(struct ovn_tnlids *tnlids)
 {
-    struct tnlid_node *node;
-    HMAP_FOR_EACH_POP (node, hmap_node, tnlids) {
-        free(node);
-    }
-    hmap_destroy(tnlids);
+    bitmap_free(tnlids->bitmap);
+    ovn_init_tnlids(tnlids);
 }
 
-/* Returns true if 'tnlid' is present in the hmap 'tnlids'. */
+/* Returns true if 'tnlid' is present in 'tnlids'. */
 bool
-ovn_tnlid_present(struct hmap *tnlids, uint32_t tnlid)
+ovn_tnlid_present(const struct ovn_tnlids *tnlids, uint32_t tnlid)
 {
-    uint32_t hash = hash_int(tnlid, 0);
-    struct tnlid_node *node;
-    HMAP_FOR_EACH_IN_BUCKET (node, hmap_node, hash, tnlids) {
-        if (node->tnlid == tnlid) {
-            return true;
-        }
-    }
-
-    return false;
+    return tnlid < tnlids->n_bits && bitmap_is_set(tnlids->bitmap, tnlid);
 }
 
 bool
-ovn_add_tnlid(struct hmap *set, uint32_t tnlid)
+ovn_add_tnlid(struct ovn_tnlids *tnlids, uint32_t tnlid)
 {
-    if (ovn_tnlid_present(set, tnlid)) {
+    if (ovn_tnlid_present(tnlids, tnlid)) {
         return false;
     }
 
-    uint32_t hash = hash_int(tnlid, 0);
-    struct tnlid_node *node = xmalloc(sizeof *node);
-    hmap_insert(set, &node->hmap_node, hash);
-    node->tnlid = tnlid;
+    if (tnlid >= tnlids->n_bits) {
+        /* Grow geometrically, in whole words, so that the bits past 'n_bits'
+         * never need to be checked. */
+        size_t n_bits = MAX(tnlid + 1, 2 * tnlids->n_bits);
+        n_bits = ROUND_UP(n_bits, BITMAP_ULONG_BITS);
+
+        size_t old_n_bytes = bitmap_n_bytes(tnlids->n_bits);
+        size_t n_bytes = bitmap_n_bytes(n_bits);
+        tnlids->bitmap = xrealloc(tnlids->bitmap, n_bytes);
+        memset((char *) tnlids->bitmap + old_n_bytes, 0,
+               n_bytes - old_n_bytes);
+        tnlids->n_bits = n_bits;
+    }
+    bitmap_set1(tnlids->bitmap, tnlid);
     return true;
 }
 
+/* Removes 'tnlid' from 'tnlids', if it is present. */
+void
+ovn_free_tnlid(struct ovn_tnlids *tnlids, uint32_t tnlid)
+{
+    if (tnlid < tnlids->n_bits) {
+        bitmap_set0(tnlids->bitmap, tnlid);
+    }
+}
+
+/* Returns the lowest tunnel id in [start, end) that is not in 'tnlids', or
+ * 'end' if there is none. */
+static uint32_t
+ovn_tnlids_scan_free(const struct ovn_tnlids *tnlids, uint32_t start,
+                     uint32_t end)
+{
+    if (start >= end || start >= tnlids->n_bits) {
+        return start;
+    }
+    /* All the ids from 'n_bits' on are free. */
+    return bitmap_scan(tnlids->bitmap, false, start,
+                       MIN(end, tnlids->n_bits));
+}
+
 static uint32_t
 next_tnlid(uint32_t tnlid, uint32_t min, uint32_t max)
 {
     return tnlid + 1 <= max ? tnlid + 1 : min;
 }
 
+/* Allocates the first free tunnel id in [min, max] that follows '*hint',
+ * wrapping around, and updates '*hint' to it.  The bitmap is scanned a word
+ * at a time, so allocating mostly sequential ids is amortized O(1) even when
+ * the key space is dense.  Returns 0, without logging, if all the ids are in
+ * use. */
 uint32_t
-ovn_allocate_tnlid(struct hmap *set, const char *name, uint32_t min,
-                   uint32_t max, uint32_t *hint)
+ovn_tnlids_allocate(struct ovn_tnlids *tnlids, uint32_t min, uint32_t max,
+                    uint32_t *hint)
 {
-    for (uint32_t tnlid = next_tnlid(*hint, min, max); tnlid != *hint;
-         tnlid = next_tnlid(tnlid, min, max)) {
-        if (ovn_add_tnlid(set, tnlid)) {
-            *hint = tnlid;
-            return tnlid;
+    uint32_t start = next_tnlid(*hint, min, max);
+    uint32_t tnlid = ovn_tnlids_scan_free(tnlids, start, max + 1);
+    if (tnlid > max) {
+        tnlid = ovn_tnlids_scan_free(tnlids, min, start);
+        if (tnlid == start) {
+            tnlid = max + 1;
         }
     }
 
-    static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
-    VLOG_WARN_RL(&rl, "all %s tunnel ids exhausted", name);
+    if (tnlid <= max) {
+        ovn_add_tnlid(tnlids, tnlid);
+        *hint = tnlid;
+        return tnlid;
+    }
     return 0;
 }
 
+/* Same as ovn_tnlids_allocate(), but logs a warning mentioning 'name' if all
+ * the ids are in use. */
+uint32_t
+ovn_allocate_tnlid(struct ovn_tnlids *tnlids, const char *name, uint32_t min,
+                   uint32_t max, uint32_t *hint)
+{
+    uint32_t tnlid = ovn_tnlids_allocate(tnlids, min, max, hint);
+    if (!tnlid) {
+        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
+        VLOG_WARN_RL(&rl, "all %s tunnel ids exhausted", name);
+    }
+    return tnlid;
+}
+
 char *
 ovn_chassis_redirect_name(const char *port_name)
 {
@@ -86,6 +86,8 @@ bool extract_lrp_networks__(char *mac, char **networks, size_t n_networks,
 
 bool lport_addresses_is_empty(struct lport_addresses *);
 void destroy_lport_addresses(struct lport_addresses *);
+void lport_addresses_cache_enable(void);
+void lport_addresses_cache_sweep(void);
 
 void split_addresses(const char *addresses, struct svec *ipv4_addrs,
                      struct svec *ipv6_addrs);
@@ -117,6 +119,17 @@ uint32_t ovn_logical_flow_hash(uint8_t table_id, enum ovn_pipeline pipeline,
                                const char *match, const char *actions);
 uint32_t ovn_logical_flow_hash_datapath(const struct uuid *logical_datapath,
                                         uint32_t hash);
+
+/* A logical flow with tags:port_template=true stands for one logical flow per
+ * Ethernet address of every VIF of its datapath, with OVN_PORT_TEMPLATE_PORT
+ * and OVN_PORT_TEMPLATE_MAC in its match and actions replaced by the name of
+ * the port, as a quoted string, and by the address. */
+#define OVN_PORT_TEMPLATE_PORT "{port}"
+#define OVN_PORT_TEMPLATE_MAC "{mac}"
+
+bool sbrec_logical_flow_is_port_template(const struct sbrec_logical_flow *);
+char *ovn_port_template_expand(const char *, const char *port,
+                               const struct eth_addr *mac);
 void ovn_conn_show(struct unixctl_conn *conn, int argc OVS_UNUSED,
                    const char *argv[] OVS_UNUSED, void *idl_);
 
@@ -130,20 +143,24 @@ void ovn_conn_show(struct unixctl_conn *conn, int argc OVS_UNUSED,
 #define OVN_MAX_DP_VXLAN_KEY ((1u << 12) - 1)
 #define OVN_MAX_DP_VXLAN_KEY_LOCAL (OVN_MAX_DP_KEY - OVN_MAX_DP_GLOBAL_NUM)
 
-struct hmap;
-void ovn_destroy_tnlids(struct hmap *tnlids);
-bool ovn_add_tnlid(struct hmap *set, uint32_t tnlid);
-bool ovn_tnlid_present(struct hmap *tnlids, uint32_t tnlid);
-uint32_t ovn_allocate_tnlid(struct hmap *set, const char *name, uint32_t min,
-                            uint32_t max, uint32_t *hint);
+/* A set of tunnel ids, as a bitmap that grows up to the highest id that was
+ * added to it. */
+struct ovn_tnlids {
+    unsigned long *bitmap;
+    size_t n_bits;              /* Multiple of BITMAP_ULONG_BITS. */
+};
 
-static inline void
-get_unique_lport_key(uint64_t dp_tunnel_key, uint64_t lport_tunnel_key,
-                     char *buf, size_t buf_size)
-{
-    snprintf(buf, buf_size, "%"PRId64"_%"PRId64, dp_tunnel_key,
-             lport_tunnel_key);
-}
+#define OVN_TNLIDS_INITIALIZER { NULL, 0 }
+
+void ovn_init_tnlids(struct ovn_tnlids *tnlids);
+void ovn_destroy_tnlids(struct ovn_tnlids *tnlids);
+bool ovn_add_tnlid(struct ovn_tnlids *tnlids, uint32_t tnlid);
+bool ovn_tnlid_present(const struct ovn_tnlids *tnlids, uint32_t tnlid);
+void ovn_free_tnlid(struct ovn_tnlids *tnlids, uint32_t tnlid);
+uint32_t ovn_tnlids_allocate(struct ovn_tnlids *tnlids, uint32_t min,
+                             uint32_t max, uint32_t *hint);
+uint32_t ovn_allocate_tnlid(struct ovn_tnlids *tnlids, const char *name,
+                            uint32_t min, uint32_t max, uint32_t *hint);
 
 static inline void
 get_mc_group_key(const char *mg_name, int64_t dp_tunnel_key,
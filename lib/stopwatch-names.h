@@ -30,4 +30,19 @@
 #define LFLOWS_IGMP_STOPWATCH_NAME "lflows_igmp"
 #define LFLOWS_DP_GROUPS_STOPWATCH_NAME "lflows_dp_groups"
 
+/* Time spent by the build_* functions of a feature, summed over all the
+ * datapaths, ports or load balancers and over all the worker threads. */
+#define LFLOWS_ACLS_STOPWATCH_NAME "lflows_acls"
+#define LFLOWS_LB_RULES_STOPWATCH_NAME "lflows_lb_rules"
+#define LFLOWS_NAT_STOPWATCH_NAME "lflows_nat"
+#define LFLOWS_ROUTES_STOPWATCH_NAME "lflows_routes"
+#define LFLOWS_ARP_ND_STOPWATCH_NAME "lflows_arp_nd"
+
+/* ovn-ic. */
+#define IC_LOOP_STOPWATCH_NAME "ovn-ic-loop"
+#define IC_TS_RUN_STOPWATCH_NAME "ts_run"
+#define IC_GATEWAY_RUN_STOPWATCH_NAME "gateway_run"
+#define IC_PORT_BINDING_RUN_STOPWATCH_NAME "port_binding_run"
+#define IC_ROUTE_RUN_STOPWATCH_NAME "route_run"
+
 #endif
@@ -133,6 +133,21 @@ struct vif_plug_class {
     bool (*vif_plug_port_prepare)(const struct vif_plug_port_ctx_in *,
                                   struct vif_plug_port_ctx_out *);
 
+    /* Same as vif_plug_port_prepare for 'n' ports at once, so that the VIF
+     * plug provider implementation can perform its lookups or per port
+     * initialization in bulk, e.g. when bringing up a host with hundreds of
+     * representor ports.
+     *
+     * 'ctx_out[i]' is NULL when 'ctx_in[i]->op_type' is PLUG_OP_REMOVE.  The
+     * VIF plug implementation should set 'prepared[i]' to the value
+     * vif_plug_port_prepare would return for port 'i'.
+     *
+     * This function may be set to null, in which case vif_plug_port_prepare
+     * is called for each port. */
+    void (*vif_plug_port_prepare_batch)(
+        const struct vif_plug_port_ctx_in **ctx_in,
+        struct vif_plug_port_ctx_out **ctx_out, bool *prepared, size_t n);
+
     /* Notify VIF plug provider that port update is committed to OVSDB. */
     void (*vif_plug_port_finish)(const struct vif_plug_port_ctx_in *,
                                  struct vif_plug_port_ctx_out *);
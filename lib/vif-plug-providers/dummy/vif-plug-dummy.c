@@ -82,6 +82,18 @@ vif_plug_dummy_port_prepare(const struct vif_plug_port_ctx_in *ctx_in,
     return true;
 }
 
+static void
+vif_plug_dummy_port_prepare_batch(const struct vif_plug_port_ctx_in **ctx_in,
+                                  struct vif_plug_port_ctx_out **ctx_out,
+                                  bool *prepared, size_t n)
+{
+    VLOG_DBG("vif_plug_dummy_port_prepare_batch: %"PRIuSIZE" ports", n);
+
+    for (size_t i = 0; i < n; i++) {
+        prepared[i] = vif_plug_dummy_port_prepare(ctx_in[i], ctx_out[i]);
+    }
+}
+
 static void
 vif_plug_dummy_port_finish(const struct vif_plug_port_ctx_in *ctx_in,
                            struct vif_plug_port_ctx_out *ctx_out OVS_UNUSED)
@@ -108,6 +120,7 @@ const struct vif_plug_class vif_plug_dummy_class = {
         vif_plug_dummy_get_maintained_iface_options,
     .run = vif_plug_dummy_run,
     .vif_plug_port_prepare = vif_plug_dummy_port_prepare,
+    .vif_plug_port_prepare_batch = vif_plug_dummy_port_prepare_batch,
     .vif_plug_port_finish = vif_plug_dummy_port_finish,
     .vif_plug_port_ctx_destroy = vif_plug_dummy_port_ctx_destroy,
 };
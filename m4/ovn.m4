@@ -296,6 +296,34 @@ dnl Defines HAVE_PERF_EVENT if linux/perf_event.h is found.
 AC_DEFUN([OVN_CHECK_PERF_EVENT],
   [AC_CHECK_HEADERS([linux/perf_event.h])])
 
+dnl Checks for --enable-usdt-probes and sys/sdt.h.  Defines
+dnl HAVE_USDT_PROBES if the USDT probes are enabled.
+AC_DEFUN([OVN_CHECK_USDT],
+  [AC_ARG_ENABLE(
+     [usdt-probes],
+     [AC_HELP_STRING([--enable-usdt-probes],
+                     [Enable User Statically Defined Tracing (USDT) probes])],
+     [case "${enableval}" in
+        (yes) usdt=true ;;
+        (no)  usdt=false ;;
+        (*) AC_MSG_ERROR([bad value ${enableval} for --enable-usdt-probes]) ;;
+      esac],
+     [usdt=false])
+
+   AC_MSG_CHECKING([whether USDT probes are enabled])
+   if test "$usdt" != true; then
+     AC_MSG_RESULT([no])
+   else
+     AC_MSG_RESULT([yes])
+
+     AC_CHECK_HEADER([sys/sdt.h], [],
+       [AC_MSG_ERROR([USDT probes require sys/sdt.h, which is part of the \
+systemtap-sdt-devel (or systemtap-sdt-dev) package])])
+
+     AC_DEFINE([HAVE_USDT_PROBES], [1],
+               [Define to 1 if USDT probes are enabled.])
+   fi])
+
 dnl Checks for valgrind/valgrind.h.
 AC_DEFUN([OVN_CHECK_VALGRIND],
   [AC_CHECK_HEADERS([valgrind/valgrind.h])])
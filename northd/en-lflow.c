@@ -23,6 +23,7 @@
 
 #include "lib/inc-proc-eng.h"
 #include "northd.h"
+#include "simap.h"
 #include "stopwatch.h"
 #include "lib/stopwatch-names.h"
 #include "timeval.h"
@@ -30,55 +31,193 @@
 
 VLOG_DEFINE_THIS_MODULE(en_lflow);
 
-void en_lflow_run(struct engine_node *node, void *data OVS_UNUSED)
+static void
+lflow_get_input_data(struct engine_node *node,
+                     struct lflow_input *lflow_input)
 {
-    const struct engine_context *eng_ctx = engine_get_context();
-
-    struct lflow_input lflow_input;
-
     struct northd_data *northd_data = engine_get_input_data("northd", node);
+    struct lflow_data *lflow_data = engine_get_internal_data(node);
 
-    lflow_input.nbrec_bfd_table =
+    lflow_input->nbrec_bfd_table =
         EN_OVSDB_GET(engine_get_input("NB_bfd", node));
-    lflow_input.sbrec_bfd_table =
+    lflow_input->sbrec_bfd_table =
         EN_OVSDB_GET(engine_get_input("SB_bfd", node));
-    lflow_input.sbrec_logical_flow_table =
+    lflow_input->sbrec_logical_flow_table =
         EN_OVSDB_GET(engine_get_input("SB_logical_flow", node));
-    lflow_input.sbrec_multicast_group_table =
+    lflow_input->sbrec_multicast_group_table =
         EN_OVSDB_GET(engine_get_input("SB_multicast_group", node));
-    lflow_input.sbrec_igmp_group_table =
+    lflow_input->sbrec_igmp_group_table =
         EN_OVSDB_GET(engine_get_input("SB_igmp_group", node));
 
-    lflow_input.sbrec_mcast_group_by_name_dp =
+    lflow_input->sbrec_mcast_group_by_name_dp =
            engine_ovsdb_node_get_index(
                           engine_get_input("SB_multicast_group", node),
                          "sbrec_mcast_group_by_name");
 
-    lflow_input.datapaths = &northd_data->datapaths;
-    lflow_input.ports = &northd_data->ports;
-    lflow_input.port_groups = &northd_data->port_groups;
-    lflow_input.meter_groups = &northd_data->meter_groups;
-    lflow_input.lbs = &northd_data->lbs;
-    lflow_input.bfd_connections = &northd_data->bfd_connections;
-    lflow_input.ovn_internal_version_changed =
+    lflow_input->datapaths = &northd_data->datapaths;
+    lflow_input->ports = &northd_data->ports;
+    lflow_input->port_groups = &northd_data->port_groups;
+    lflow_input->meter_groups = &northd_data->meter_groups;
+    lflow_input->lbs = &northd_data->lbs;
+    lflow_input->bfd_connections = &northd_data->bfd_connections;
+    lflow_input->ovn_internal_version_changed =
                       northd_data->ovn_internal_version_changed;
+    lflow_input->sb_lflow_index = &lflow_data->sb_lflow_index;
+}
+
+/* Returns true if Logical_Flow records were inserted or deleted in the SB
+ * txn earlier in the current engine run.  The index must not pick those up,
+ * the rows inserted by the txn are freed when it is committed. */
+static bool
+lflow_sb_txn_changed(const struct lflow_data *lflow_data)
+{
+    return lflow_data->sb_txn_run_id == engine_get_run_id();
+}
+
+void en_lflow_run(struct engine_node *node, void *data)
+{
+    const struct engine_context *eng_ctx = engine_get_context();
+
+    struct lflow_input lflow_input;
+    struct lflow_data *lflow_data = data;
+
+    struct northd_data *northd_data = engine_get_input_data("northd", node);
+
+    lflow_get_input_data(node, &lflow_input);
 
     stopwatch_start(BUILD_LFLOWS_STOPWATCH_NAME, time_msec());
     build_bfd_table(&lflow_input, eng_ctx->ovnsb_idl_txn,
                     &northd_data->bfd_connections,
                     &northd_data->ports);
-    build_lflows(&lflow_input, eng_ctx->ovnsb_idl_txn);
+
+    /* On a forced recompute the tracked changes of the SB Logical_Flow table
+     * may have been missed, so the index is rebuilt. */
+    struct sb_lflow_index *sb_lflow_index = &lflow_data->sb_lflow_index;
+    if (engine_get_force_recompute() || lflow_sb_txn_changed(lflow_data)) {
+        sb_lflow_index->valid = false;
+    }
+    sb_lflow_index_update(sb_lflow_index,
+                          lflow_input.sbrec_logical_flow_table);
+
+    lflows_destroy(&lflow_data->lflows);
+    lflow_data->sb_sync_pending = !build_lflows(&lflow_input,
+                                                eng_ctx->ovnsb_idl_txn,
+                                                &lflow_data->lflows);
+    if (lflow_sb_txn_changed(lflow_data)) {
+        sb_lflow_index->valid = false;
+    }
     bfd_cleanup_connections(&lflow_input, &northd_data->bfd_connections);
     stopwatch_stop(BUILD_LFLOWS_STOPWATCH_NAME, time_msec());
 
     engine_set_node_state(node, EN_UPDATED);
 }
+
+bool
+lflow_northd_handler(struct engine_node *node, void *data)
+{
+    const struct engine_context *eng_ctx = engine_get_context();
+    struct northd_data *northd_data = engine_get_input_data("northd", node);
+    struct lflow_data *lflow_data = data;
+
+    /* Only the VIF, load balancer backend and Copp changes handled
+     * incrementally by 'en-northd' are tracked, anything else was a
+     * recompute.  The logical flows can't be updated incrementally either
+     * while they are not fully in sync with the SB. */
+    if (!northd_data->change_tracked || !eng_ctx->ovnsb_idl_txn
+        || lflow_data->sb_sync_pending) {
+        return false;
+    }
+
+    struct lflow_input lflow_input;
+
+    lflow_get_input_data(node, &lflow_input);
+
+    /* Set even on failure, some records may have been changed already. */
+    lflow_data->sb_txn_run_id = engine_get_run_id();
+    if (!lflow_handle_northd_ls_changes(eng_ctx->ovnsb_idl_txn,
+                                        &northd_data->tracked_ls_changes,
+                                        &lflow_input, &lflow_data->lflows)) {
+        return false;
+    }
+    if (!lflow_handle_northd_lb_changes(eng_ctx->ovnsb_idl_txn,
+                                        &northd_data->tracked_lb_changes,
+                                        &lflow_input, &lflow_data->lflows)) {
+        return false;
+    }
+    if (!lflow_handle_northd_copp_changes(eng_ctx->ovnsb_idl_txn,
+                                          &northd_data->tracked_copp_changes,
+                                          &lflow_data->lflows)) {
+        return false;
+    }
+
+    engine_set_node_state(node, EN_UPDATED);
+    return true;
+}
+
+bool
+lflow_sb_logical_flow_handler(struct engine_node *node, void *data)
+{
+    const struct engine_context *eng_ctx = engine_get_context();
+    struct northd_data *northd_data = engine_get_input_data("northd", node);
+    struct lflow_data *lflow_data = data;
+
+    /* The SB changes committed by the previous part of the Logical_Flow
+     * changes trigger the build of the next part. */
+    if (!eng_ctx->ovnsb_idl_txn || lflow_data->sb_sync_pending) {
+        return false;
+    }
+
+    const struct sbrec_logical_flow_table *sbrec_logical_flow_table =
+        EN_OVSDB_GET(engine_get_input("SB_logical_flow", node));
+
+    if (lflow_sb_txn_changed(lflow_data)) {
+        lflow_data->sb_lflow_index.valid = false;
+    } else {
+        sb_lflow_index_update(&lflow_data->sb_lflow_index,
+                              sbrec_logical_flow_table);
+    }
+
+    return lflow_handle_sb_logical_flow_changes(
+        sbrec_logical_flow_table,
+        ovsdb_idl_txn_get_idl(eng_ctx->ovnsb_idl_txn),
+        &northd_data->datapaths, &lflow_data->lflows);
+}
+
+bool
+lflow_sb_multicast_group_handler(struct engine_node *node,
+                                 void *data OVS_UNUSED)
+{
+    const struct sbrec_multicast_group_table *sbrec_multicast_group_table =
+        EN_OVSDB_GET(engine_get_input("SB_multicast_group", node));
+
+    return lflow_handle_sb_multicast_group_changes(
+        sbrec_multicast_group_table);
+}
+
 void *en_lflow_init(struct engine_node *node OVS_UNUSED,
                      struct engine_arg *arg OVS_UNUSED)
 {
-    return NULL;
+    struct lflow_data *data = xmalloc(sizeof *data);
+    hmap_init(&data->lflows);
+    sb_lflow_index_init(&data->sb_lflow_index);
+    data->sb_txn_run_id = 0;
+    data->sb_sync_pending = false;
+    return data;
+}
+
+void en_lflow_cleanup(void *data_)
+{
+    struct lflow_data *data = data_;
+    lflows_destroy(&data->lflows);
+    sb_lflow_index_destroy(&data->sb_lflow_index);
+    nat_lflow_caches_destroy();
 }
 
-void en_lflow_cleanup(void *data OVS_UNUSED)
+void
+en_lflow_get_memory_usage(const void *data_, struct simap *usage)
 {
+    const struct lflow_data *data = data_;
+    lflows_get_memory_usage(&data->lflows, usage);
+    simap_increase(usage, "sb_lflow_index",
+                   hmap_count(&data->sb_lflow_index.rows));
 }
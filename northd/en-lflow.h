@@ -8,9 +8,24 @@
 #include <stdio.h>
 
 #include "lib/inc-proc-eng.h"
+#include "openvswitch/hmap.h"
+#include "northd.h"
+
+struct lflow_data {
+    struct hmap lflows;  /* All the logical flows, 'struct ovn_lflow'. */
+    struct sb_lflow_index sb_lflow_index;
+    uint64_t sb_txn_run_id;  /* Last engine run in which a handler changed
+                              * Logical_Flow records in the SB txn. */
+    bool sb_sync_pending;    /* The last build_lflows() only made part of the
+                              * Logical_Flow changes, see build_lflows(). */
+};
 
 void en_lflow_run(struct engine_node *node, void *data);
 void *en_lflow_init(struct engine_node *node, struct engine_arg *arg);
 void en_lflow_cleanup(void *data);
+void en_lflow_get_memory_usage(const void *data, struct simap *usage);
+bool lflow_northd_handler(struct engine_node *, void *data);
+bool lflow_sb_logical_flow_handler(struct engine_node *, void *data);
+bool lflow_sb_multicast_group_handler(struct engine_node *, void *data);
 
 #endif /* EN_LFLOW_H */
@@ -30,87 +30,102 @@
 
 VLOG_DEFINE_THIS_MODULE(en_northd);
 
-void en_northd_run(struct engine_node *node, void *data)
+static void
+northd_get_input_data(struct engine_node *node,
+                      struct northd_input *input_data)
 {
-    const struct engine_context *eng_ctx = engine_get_context();
-
-    struct northd_input input_data;
-
-    northd_destroy(data);
-    northd_init(data);
-
-    input_data.sbrec_chassis_by_name =
+    input_data->sbrec_chassis_by_name =
         engine_ovsdb_node_get_index(
             engine_get_input("SB_chassis", node),
             "sbrec_chassis_by_name");
-    input_data.sbrec_chassis_by_hostname =
+    input_data->sbrec_chassis_by_hostname =
         engine_ovsdb_node_get_index(
             engine_get_input("SB_chassis", node),
             "sbrec_chassis_by_hostname");
-    input_data.sbrec_ha_chassis_grp_by_name =
+    input_data->sbrec_ha_chassis_grp_by_name =
         engine_ovsdb_node_get_index(
             engine_get_input("SB_ha_chassis_group", node),
             "sbrec_ha_chassis_grp_by_name");
-    input_data.sbrec_ip_mcast_by_dp =
+    input_data->sbrec_ip_mcast_by_dp =
         engine_ovsdb_node_get_index(
             engine_get_input("SB_ip_multicast", node),
             "sbrec_ip_mcast_by_dp");
-    input_data.sbrec_static_mac_binding_by_lport_ip =
+    input_data->sbrec_static_mac_binding_by_lport_ip =
         engine_ovsdb_node_get_index(
             engine_get_input("SB_static_mac_binding", node),
             "sbrec_static_mac_binding_by_lport_ip");
+    input_data->nbrec_static_mac_binding_by_lport_ip =
+        engine_ovsdb_node_get_index(
+            engine_get_input("NB_static_mac_binding", node),
+            "nbrec_static_mac_binding_by_lport_ip");
 
-    input_data.nbrec_nb_global_table =
+    input_data->nbrec_nb_global_table =
         EN_OVSDB_GET(engine_get_input("NB_nb_global", node));
-    input_data.nbrec_logical_switch =
+    input_data->nbrec_logical_switch =
         EN_OVSDB_GET(engine_get_input("NB_logical_switch", node));
-    input_data.nbrec_logical_router =
+    input_data->nbrec_logical_router =
         EN_OVSDB_GET(engine_get_input("NB_logical_router", node));
-    input_data.nbrec_load_balancer_table =
+    input_data->nbrec_load_balancer_table =
         EN_OVSDB_GET(engine_get_input("NB_load_balancer", node));
-    input_data.nbrec_port_group_table =
+    input_data->nbrec_port_group_table =
         EN_OVSDB_GET(engine_get_input("NB_port_group", node));
-    input_data.nbrec_address_set_table =
+    input_data->nbrec_address_set_table =
         EN_OVSDB_GET(engine_get_input("NB_address_set", node));
-    input_data.nbrec_meter_table =
+    input_data->nbrec_meter_table =
         EN_OVSDB_GET(engine_get_input("NB_meter", node));
-    input_data.nbrec_acl_table =
+    input_data->nbrec_meter_band_table =
+        EN_OVSDB_GET(engine_get_input("NB_meter_band", node));
+    input_data->nbrec_copp_table =
+        EN_OVSDB_GET(engine_get_input("NB_copp", node));
+    input_data->nbrec_acl_table =
         EN_OVSDB_GET(engine_get_input("NB_acl", node));
-    input_data.nbrec_static_mac_binding_table =
+    input_data->nbrec_static_mac_binding_table =
         EN_OVSDB_GET(engine_get_input("NB_static_mac_binding", node));
 
-    input_data.sbrec_sb_global_table =
+    input_data->sbrec_sb_global_table =
         EN_OVSDB_GET(engine_get_input("SB_sb_global", node));
-    input_data.sbrec_datapath_binding_table =
+    input_data->sbrec_datapath_binding_table =
         EN_OVSDB_GET(engine_get_input("SB_datapath_binding", node));
-    input_data.sbrec_port_binding_table =
+    input_data->sbrec_port_binding_table =
         EN_OVSDB_GET(engine_get_input("SB_port_binding", node));
-    input_data.sbrec_mac_binding_table =
+    input_data->sbrec_mac_binding_table =
         EN_OVSDB_GET(engine_get_input("SB_mac_binding", node));
-    input_data.sbrec_ha_chassis_group_table =
+    input_data->sbrec_ha_chassis_group_table =
         EN_OVSDB_GET(engine_get_input("SB_ha_chassis_group", node));
-    input_data.sbrec_chassis =
+    input_data->sbrec_chassis =
         EN_OVSDB_GET(engine_get_input("SB_chassis", node));
-    input_data.sbrec_fdb_table =
+    input_data->sbrec_fdb_table =
         EN_OVSDB_GET(engine_get_input("SB_fdb", node));
-    input_data.sbrec_load_balancer_table =
+    input_data->sbrec_load_balancer_table =
         EN_OVSDB_GET(engine_get_input("SB_load_balancer", node));
-    input_data.sbrec_service_monitor_table =
+    input_data->sbrec_service_monitor_table =
         EN_OVSDB_GET(engine_get_input("SB_service_monitor", node));
-    input_data.sbrec_address_set_table =
+    input_data->sbrec_address_set_table =
         EN_OVSDB_GET(engine_get_input("SB_address_set", node));
-    input_data.sbrec_port_group_table =
+    input_data->sbrec_port_group_table =
         EN_OVSDB_GET(engine_get_input("SB_port_group", node));
-    input_data.sbrec_meter_table =
+    input_data->sbrec_meter_table =
         EN_OVSDB_GET(engine_get_input("SB_meter", node));
-    input_data.sbrec_dns_table =
+    input_data->sbrec_dns_table =
         EN_OVSDB_GET(engine_get_input("SB_dns", node));
-    input_data.sbrec_ip_multicast_table =
+    input_data->sbrec_ip_multicast_table =
         EN_OVSDB_GET(engine_get_input("SB_ip_multicast", node));
-    input_data.sbrec_chassis_private_table =
+    input_data->sbrec_chassis_private_table =
         EN_OVSDB_GET(engine_get_input("SB_chassis_private", node));
-    input_data.sbrec_static_mac_binding_table =
+    input_data->sbrec_static_mac_binding_table =
         EN_OVSDB_GET(engine_get_input("SB_static_mac_binding", node));
+}
+
+void en_northd_run(struct engine_node *node, void *data)
+{
+    const struct engine_context *eng_ctx = engine_get_context();
+
+    struct northd_input input_data;
+
+    northd_destroy(data);
+    northd_init(data);
+
+    northd_get_input_data(node, &input_data);
 
     northd_run(&input_data, data,
                eng_ctx->ovnnb_idl_txn,
@@ -118,6 +133,249 @@ void en_northd_run(struct engine_node *node, void *data)
     engine_set_node_state(node, EN_UPDATED);
 
 }
+
+bool
+northd_nb_nb_global_handler(struct engine_node *node,
+                            void *data OVS_UNUSED)
+{
+    const struct nbrec_nb_global_table *nb_global_table =
+        EN_OVSDB_GET(engine_get_input("NB_nb_global", node));
+
+    return northd_handle_nb_global_changes(nb_global_table);
+}
+
+bool
+northd_sb_sb_global_handler(struct engine_node *node,
+                            void *data OVS_UNUSED)
+{
+    const struct sbrec_sb_global_table *sb_global_table =
+        EN_OVSDB_GET(engine_get_input("SB_sb_global", node));
+
+    return northd_handle_sb_global_changes(sb_global_table);
+}
+
+bool
+northd_nb_logical_switch_handler(struct engine_node *node,
+                                 void *data)
+{
+    const struct engine_context *eng_ctx = engine_get_context();
+    struct northd_data *nd = data;
+
+    if (!eng_ctx->ovnsb_idl_txn) {
+        return false;
+    }
+
+    struct northd_input input_data;
+
+    northd_get_input_data(node, &input_data);
+
+    if (!northd_handle_ls_changes(eng_ctx->ovnsb_idl_txn, &input_data, nd)) {
+        return false;
+    }
+
+    if (nd->change_tracked) {
+        engine_set_node_state(node, EN_UPDATED);
+    }
+
+    return true;
+}
+
+bool
+northd_nb_logical_switch_port_handler(struct engine_node *node,
+                                      void *data)
+{
+    const struct engine_context *eng_ctx = engine_get_context();
+    struct northd_data *nd = data;
+
+    if (!eng_ctx->ovnsb_idl_txn) {
+        return false;
+    }
+
+    struct northd_input input_data;
+
+    northd_get_input_data(node, &input_data);
+
+    const struct nbrec_logical_switch_port_table *nbrec_lsp_table =
+        EN_OVSDB_GET(engine_get_input("NB_logical_switch_port", node));
+    if (!northd_handle_lsp_changes(eng_ctx->ovnsb_idl_txn, nbrec_lsp_table,
+                                   &input_data, nd)) {
+        return false;
+    }
+
+    if (nd->change_tracked) {
+        engine_set_node_state(node, EN_UPDATED);
+    }
+
+    return true;
+}
+
+bool
+northd_nb_load_balancer_handler(struct engine_node *node,
+                                void *data)
+{
+    const struct engine_context *eng_ctx = engine_get_context();
+    struct northd_data *nd = data;
+
+    if (!eng_ctx->ovnsb_idl_txn) {
+        return false;
+    }
+
+    const struct nbrec_load_balancer_table *nbrec_load_balancer_table =
+        EN_OVSDB_GET(engine_get_input("NB_load_balancer", node));
+    if (!northd_handle_lb_changes(nbrec_load_balancer_table, nd)) {
+        return false;
+    }
+
+    if (nd->change_tracked) {
+        engine_set_node_state(node, EN_UPDATED);
+    }
+
+    return true;
+}
+
+bool
+northd_nb_copp_handler(struct engine_node *node, void *data)
+{
+    const struct engine_context *eng_ctx = engine_get_context();
+    struct northd_data *nd = data;
+
+    if (!eng_ctx->ovnsb_idl_txn) {
+        return false;
+    }
+
+    const struct nbrec_copp_table *nbrec_copp_table =
+        EN_OVSDB_GET(engine_get_input("NB_copp", node));
+    if (!northd_handle_copp_changes(nbrec_copp_table, nd)) {
+        return false;
+    }
+
+    if (nd->change_tracked) {
+        engine_set_node_state(node, EN_UPDATED);
+    }
+
+    return true;
+}
+
+/* Handles the changes of both the Meter and the Meter_Band tables. */
+bool
+northd_nb_meter_handler(struct engine_node *node, void *data)
+{
+    const struct engine_context *eng_ctx = engine_get_context();
+    struct northd_data *nd = data;
+
+    if (!eng_ctx->ovnsb_idl_txn) {
+        return false;
+    }
+
+    struct northd_input input_data;
+
+    northd_get_input_data(node, &input_data);
+
+    return northd_handle_meter_changes(eng_ctx->ovnsb_idl_txn, &input_data,
+                                       nd);
+}
+
+bool
+northd_nb_static_mac_binding_handler(struct engine_node *node, void *data)
+{
+    const struct engine_context *eng_ctx = engine_get_context();
+    struct northd_data *nd = data;
+
+    if (!eng_ctx->ovnsb_idl_txn) {
+        return false;
+    }
+
+    struct northd_input input_data;
+
+    northd_get_input_data(node, &input_data);
+
+    return northd_handle_nb_static_mac_binding_changes(
+        eng_ctx->ovnsb_idl_txn, &input_data, nd);
+}
+
+bool
+northd_nb_address_set_handler(struct engine_node *node,
+                              void *data OVS_UNUSED)
+{
+    const struct engine_context *eng_ctx = engine_get_context();
+
+    if (!eng_ctx->ovnsb_idl_txn) {
+        return false;
+    }
+
+    const struct nbrec_address_set_table *nbrec_address_set_table =
+        EN_OVSDB_GET(engine_get_input("NB_address_set", node));
+    struct ovsdb_idl_index *sbrec_address_set_by_name =
+        engine_ovsdb_node_get_index(
+            engine_get_input("SB_address_set", node),
+            "sbrec_address_set_by_name");
+
+    return northd_handle_nb_address_set_changes(eng_ctx->ovnsb_idl_txn,
+                                                nbrec_address_set_table,
+                                                sbrec_address_set_by_name);
+}
+
+bool
+northd_sb_load_balancer_handler(struct engine_node *node,
+                                void *data)
+{
+    struct northd_data *nd = data;
+
+    const struct sbrec_load_balancer_table *sbrec_load_balancer_table =
+        EN_OVSDB_GET(engine_get_input("SB_load_balancer", node));
+
+    return northd_handle_sb_lb_changes(sbrec_load_balancer_table, &nd->lbs);
+}
+
+bool
+northd_sb_logical_dp_group_handler(struct engine_node *node,
+                                   void *data OVS_UNUSED)
+{
+    const struct sbrec_logical_dp_group_table *sbrec_logical_dp_group_table =
+        EN_OVSDB_GET(engine_get_input("SB_logical_dp_group", node));
+
+    return northd_handle_sb_logical_dp_group_changes(
+        sbrec_logical_dp_group_table);
+}
+
+bool
+northd_sb_port_binding_handler(struct engine_node *node,
+                               void *data)
+{
+    struct northd_data *nd = data;
+
+    const struct sbrec_port_binding_table *sbrec_port_binding_table =
+        EN_OVSDB_GET(engine_get_input("SB_port_binding", node));
+
+    return northd_handle_sb_port_binding_changes(sbrec_port_binding_table,
+                                                 &nd->ports);
+}
+
+bool
+northd_sb_ha_chassis_group_handler(struct engine_node *node,
+                                   void *data OVS_UNUSED)
+{
+    const struct sbrec_ha_chassis_group_table *sb_ha_ch_grp_table =
+        EN_OVSDB_GET(engine_get_input("SB_ha_chassis_group", node));
+
+    return northd_handle_sb_ha_chassis_group_changes(sb_ha_ch_grp_table);
+}
+
+bool
+northd_sb_fdb_handler(struct engine_node *node, void *data)
+{
+    const struct engine_context *eng_ctx = engine_get_context();
+    struct northd_data *nd = data;
+
+    if (!eng_ctx->ovnsb_idl_txn) {
+        return false;
+    }
+
+    const struct sbrec_fdb_table *sbrec_fdb_table =
+        EN_OVSDB_GET(engine_get_input("SB_fdb", node));
+
+    return northd_handle_sb_fdb_changes(sbrec_fdb_table, &nd->datapaths);
+}
 void *en_northd_init(struct engine_node *node OVS_UNUSED,
                      struct engine_arg *arg OVS_UNUSED)
 {
@@ -132,3 +390,16 @@ void en_northd_cleanup(void *data)
 {
     northd_destroy(data);
 }
+
+void
+en_northd_clear_tracked_data(void *data_)
+{
+    struct northd_data *data = data_;
+    destroy_northd_data_tracked_changes(data);
+}
+
+void
+en_northd_get_memory_usage(const void *data, struct simap *usage)
+{
+    northd_get_memory_usage(data, usage);
+}
@@ -13,5 +13,21 @@ void en_northd_run(struct engine_node *node OVS_UNUSED, void *data OVS_UNUSED);
 void *en_northd_init(struct engine_node *node OVS_UNUSED,
                      struct engine_arg *arg);
 void en_northd_cleanup(void *data);
+void en_northd_clear_tracked_data(void *data);
+void en_northd_get_memory_usage(const void *data, struct simap *usage);
+bool northd_nb_nb_global_handler(struct engine_node *, void *data);
+bool northd_sb_sb_global_handler(struct engine_node *, void *data);
+bool northd_nb_logical_switch_handler(struct engine_node *, void *data);
+bool northd_nb_logical_switch_port_handler(struct engine_node *, void *data);
+bool northd_nb_load_balancer_handler(struct engine_node *, void *data);
+bool northd_nb_copp_handler(struct engine_node *, void *data);
+bool northd_nb_meter_handler(struct engine_node *, void *data);
+bool northd_nb_static_mac_binding_handler(struct engine_node *, void *data);
+bool northd_nb_address_set_handler(struct engine_node *, void *data);
+bool northd_sb_load_balancer_handler(struct engine_node *, void *data);
+bool northd_sb_logical_dp_group_handler(struct engine_node *, void *data);
+bool northd_sb_port_binding_handler(struct engine_node *, void *data);
+bool northd_sb_ha_chassis_group_handler(struct engine_node *, void *data);
+bool northd_sb_fdb_handler(struct engine_node *, void *data);
 
 #endif /* EN_NORTHD_H */
@@ -0,0 +1,115 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "en-sync-from-sb.h"
+#include "lib/inc-proc-eng.h"
+#include "lib/ovn-nb-idl.h"
+#include "lib/ovn-sb-idl.h"
+#include "northd.h"
+#include "stopwatch.h"
+#include "lib/stopwatch-names.h"
+#include "timeval.h"
+#include "openvswitch/vlog.h"
+
+VLOG_DEFINE_THIS_MODULE(en_sync_from_sb);
+
+/* Synchronizes the SB state that ovn-controllers report back into the NB
+ * database (e.g., Logical_Switch_Port 'up') and the HA chassis group
+ * 'ref_chassis'.  This is split out of 'en-northd' so that Port_Binding
+ * updates done by ovn-controllers don't require a recompute of the northd
+ * data. */
+void *
+en_sync_from_sb_init(struct engine_node *node OVS_UNUSED,
+                     struct engine_arg *arg OVS_UNUSED)
+{
+    struct ha_ref_chassis_data *data = xmalloc(sizeof *data);
+
+    ha_ref_chassis_data_init(data);
+
+    return data;
+}
+
+void
+en_sync_from_sb_run(struct engine_node *node, void *data)
+{
+    const struct engine_context *eng_ctx = engine_get_context();
+    struct northd_data *nd = engine_get_input_data("northd", node);
+
+    const struct sbrec_port_binding_table *sb_pb_table =
+        EN_OVSDB_GET(engine_get_input("SB_port_binding", node));
+    const struct sbrec_ha_chassis_group_table *sb_ha_ch_grp_table =
+        EN_OVSDB_GET(engine_get_input("SB_ha_chassis_group", node));
+    struct ovsdb_idl_index *sb_ha_ch_grp_by_name =
+        engine_ovsdb_node_get_index(
+            engine_get_input("SB_ha_chassis_group", node),
+            "sbrec_ha_chassis_grp_by_name");
+
+    stopwatch_start(OVNSB_DB_RUN_STOPWATCH_NAME, time_msec());
+    ovnsb_db_run(eng_ctx->ovnnb_idl_txn, eng_ctx->ovnsb_idl_txn,
+                 sb_pb_table, sb_ha_ch_grp_table, sb_ha_ch_grp_by_name,
+                 &nd->ports, data);
+    stopwatch_stop(OVNSB_DB_RUN_STOPWATCH_NAME, time_msec());
+
+    engine_set_node_state(node, EN_UPDATED);
+}
+
+/* Handles the changes of the Port_Binding rows that ovn-controllers claim or
+ * mark 'up', e.g. during mass VM boots, without walking the whole table. */
+bool
+sync_from_sb_sb_port_binding_handler(struct engine_node *node, void *data)
+{
+    const struct engine_context *eng_ctx = engine_get_context();
+    struct northd_data *nd = engine_get_input_data("northd", node);
+
+    const struct sbrec_port_binding_table *sb_pb_table =
+        EN_OVSDB_GET(engine_get_input("SB_port_binding", node));
+    struct ovsdb_idl_index *sb_ha_ch_grp_by_name =
+        engine_ovsdb_node_get_index(
+            engine_get_input("SB_ha_chassis_group", node),
+            "sbrec_ha_chassis_grp_by_name");
+
+    if (!ovnsb_handle_port_binding_changes(eng_ctx->ovnnb_idl_txn,
+                                           eng_ctx->ovnsb_idl_txn,
+                                           sb_pb_table, sb_ha_ch_grp_by_name,
+                                           &nd->ports, data)) {
+        return false;
+    }
+
+    engine_set_node_state(node, EN_UPDATED);
+    return true;
+}
+
+/* The only changes to HA_Chassis_Group that don't require a recompute are
+ * the ones to 'ref_chassis', which this node writes itself. */
+bool
+sync_from_sb_sb_ha_chassis_group_handler(struct engine_node *node,
+                                         void *data OVS_UNUSED)
+{
+    const struct sbrec_ha_chassis_group_table *sb_ha_ch_grp_table =
+        EN_OVSDB_GET(engine_get_input("SB_ha_chassis_group", node));
+
+    return northd_handle_sb_ha_chassis_group_changes(sb_ha_ch_grp_table);
+}
+
+void
+en_sync_from_sb_cleanup(void *data)
+{
+    ha_ref_chassis_data_destroy(data);
+}
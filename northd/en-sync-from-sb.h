@@ -0,0 +1,13 @@
+#ifndef EN_SYNC_FROM_SB_H
+#define EN_SYNC_FROM_SB_H 1
+
+#include "lib/inc-proc-eng.h"
+
+void *en_sync_from_sb_init(struct engine_node *, struct engine_arg *);
+void en_sync_from_sb_run(struct engine_node *, void *data);
+void en_sync_from_sb_cleanup(void *data);
+bool sync_from_sb_sb_port_binding_handler(struct engine_node *, void *data);
+bool sync_from_sb_sb_ha_chassis_group_handler(struct engine_node *,
+                                              void *data);
+
+#endif /* EN_SYNC_FROM_SB_H */
@@ -25,11 +25,14 @@
 #include "lib/ovn-nb-idl.h"
 #include "lib/ovn-sb-idl.h"
 #include "mcast-group-index.h"
+#include "simap.h"
 #include "openvswitch/poll-loop.h"
 #include "openvswitch/vlog.h"
 #include "inc-proc-northd.h"
 #include "en-northd.h"
 #include "en-lflow.h"
+#include "en-northd-output.h"
+#include "en-sync-from-sb.h"
 #include "util.h"
 
 VLOG_DEFINE_THIS_MODULE(inc_proc_northd);
@@ -147,29 +150,41 @@ enum sb_engine_node {
 
 /* Define engine nodes for other nodes. They should be defined as static to
  * avoid sparse errors. */
-static ENGINE_NODE(northd, "northd");
-static ENGINE_NODE(lflow, "lflow");
+static ENGINE_NODE_DEF_START(northd, "northd")
+    .clear_tracked_data = en_northd_clear_tracked_data,
+    .get_memory_usage = en_northd_get_memory_usage,
+ENGINE_NODE_DEF_END
+static ENGINE_NODE_DEF_START(lflow, "lflow")
+    .get_memory_usage = en_lflow_get_memory_usage,
+ENGINE_NODE_DEF_END
+static ENGINE_NODE(sync_from_sb, "sync_from_sb");
+static ENGINE_NODE(northd_output, "northd_output");
 
 void inc_proc_northd_init(struct ovsdb_idl_loop *nb,
                           struct ovsdb_idl_loop *sb)
 {
     /* Define relationships between nodes where first argument is dependent
      * on the second argument */
-    engine_add_input(&en_northd, &en_nb_nb_global, NULL);
-    engine_add_input(&en_northd, &en_nb_copp, NULL);
-    engine_add_input(&en_northd, &en_nb_logical_switch, NULL);
-    engine_add_input(&en_northd, &en_nb_logical_switch_port, NULL);
+    engine_add_input(&en_northd, &en_nb_nb_global,
+                     northd_nb_nb_global_handler);
+    engine_add_input(&en_northd, &en_nb_copp, northd_nb_copp_handler);
+    engine_add_input(&en_northd, &en_nb_logical_switch,
+                     northd_nb_logical_switch_handler);
+    engine_add_input(&en_northd, &en_nb_logical_switch_port,
+                     northd_nb_logical_switch_port_handler);
     engine_add_input(&en_northd, &en_nb_forwarding_group, NULL);
-    engine_add_input(&en_northd, &en_nb_address_set, NULL);
+    engine_add_input(&en_northd, &en_nb_address_set,
+                     northd_nb_address_set_handler);
     engine_add_input(&en_northd, &en_nb_port_group, NULL);
-    engine_add_input(&en_northd, &en_nb_load_balancer, NULL);
+    engine_add_input(&en_northd, &en_nb_load_balancer,
+                     northd_nb_load_balancer_handler);
     engine_add_input(&en_northd, &en_nb_load_balancer_group, NULL);
     engine_add_input(&en_northd, &en_nb_load_balancer_health_check, NULL);
     engine_add_input(&en_northd, &en_nb_acl, NULL);
     engine_add_input(&en_northd, &en_nb_logical_router, NULL);
     engine_add_input(&en_northd, &en_nb_qos, NULL);
-    engine_add_input(&en_northd, &en_nb_meter, NULL);
-    engine_add_input(&en_northd, &en_nb_meter_band, NULL);
+    engine_add_input(&en_northd, &en_nb_meter, northd_nb_meter_handler);
+    engine_add_input(&en_northd, &en_nb_meter_band, northd_nb_meter_handler);
     engine_add_input(&en_northd, &en_nb_logical_router_port, NULL);
     engine_add_input(&en_northd, &en_nb_logical_router_static_route, NULL);
     engine_add_input(&en_northd, &en_nb_logical_router_policy, NULL);
@@ -181,19 +196,29 @@ void inc_proc_northd_init(struct ovsdb_idl_loop *nb,
     engine_add_input(&en_northd, &en_nb_gateway_chassis, NULL);
     engine_add_input(&en_northd, &en_nb_ha_chassis_group, NULL);
     engine_add_input(&en_northd, &en_nb_ha_chassis, NULL);
-    engine_add_input(&en_northd, &en_nb_static_mac_binding, NULL);
+    engine_add_input(&en_northd, &en_nb_static_mac_binding,
+                     northd_nb_static_mac_binding_handler);
 
-    engine_add_input(&en_northd, &en_sb_sb_global, NULL);
+    engine_add_input(&en_northd, &en_sb_sb_global,
+                     northd_sb_sb_global_handler);
     engine_add_input(&en_northd, &en_sb_chassis, NULL);
-    engine_add_input(&en_northd, &en_sb_chassis_private, NULL);
+    engine_add_input(&en_northd, &en_sb_chassis_private,
+                     engine_noop_handler);
     engine_add_input(&en_northd, &en_sb_encap, NULL);
-    engine_add_input(&en_northd, &en_sb_address_set, NULL);
+    /* The SB address sets are only written by northd, either from
+     * northd_nb_address_set_handler() or on a full recompute, so there is
+     * no need to recompute when they change. */
+    engine_add_input(&en_northd, &en_sb_address_set, engine_noop_handler);
     engine_add_input(&en_northd, &en_sb_port_group, NULL);
-    engine_add_input(&en_northd, &en_sb_logical_dp_group, NULL);
-    engine_add_input(&en_northd, &en_sb_meter, NULL);
-    engine_add_input(&en_northd, &en_sb_meter_band, NULL);
+    engine_add_input(&en_northd, &en_sb_logical_dp_group,
+                     northd_sb_logical_dp_group_handler);
+    /* The SB meters are only written by northd, either from
+     * northd_nb_meter_handler() or on a full recompute. */
+    engine_add_input(&en_northd, &en_sb_meter, engine_noop_handler);
+    engine_add_input(&en_northd, &en_sb_meter_band, engine_noop_handler);
     engine_add_input(&en_northd, &en_sb_datapath_binding, NULL);
-    engine_add_input(&en_northd, &en_sb_port_binding, NULL);
+    engine_add_input(&en_northd, &en_sb_port_binding,
+                     northd_sb_port_binding_handler);
     engine_add_input(&en_northd, &en_sb_mac_binding, NULL);
     engine_add_input(&en_northd, &en_sb_dhcp_options, NULL);
     engine_add_input(&en_northd, &en_sb_dhcpv6_options, NULL);
@@ -204,19 +229,35 @@ void inc_proc_northd_init(struct ovsdb_idl_loop *nb,
     engine_add_input(&en_northd, &en_sb_rbac_permission, NULL);
     engine_add_input(&en_northd, &en_sb_gateway_chassis, NULL);
     engine_add_input(&en_northd, &en_sb_ha_chassis, NULL);
-    engine_add_input(&en_northd, &en_sb_ha_chassis_group, NULL);
+    engine_add_input(&en_northd, &en_sb_ha_chassis_group,
+                     northd_sb_ha_chassis_group_handler);
     engine_add_input(&en_northd, &en_sb_controller_event, NULL);
     engine_add_input(&en_northd, &en_sb_ip_multicast, NULL);
     engine_add_input(&en_northd, &en_sb_service_monitor, NULL);
-    engine_add_input(&en_northd, &en_sb_load_balancer, NULL);
-    engine_add_input(&en_northd, &en_sb_fdb, NULL);
+    engine_add_input(&en_northd, &en_sb_load_balancer,
+                     northd_sb_load_balancer_handler);
+    engine_add_input(&en_northd, &en_sb_fdb, northd_sb_fdb_handler);
     engine_add_input(&en_northd, &en_sb_static_mac_binding, NULL);
+    /* 'northd' must be the first input of 'lflow', so that the other
+     * change handlers never run with the data of a recomputed 'northd'. */
+    engine_add_input(&en_lflow, &en_northd, lflow_northd_handler);
     engine_add_input(&en_lflow, &en_nb_bfd, NULL);
     engine_add_input(&en_lflow, &en_sb_bfd, NULL);
-    engine_add_input(&en_lflow, &en_sb_logical_flow, NULL);
-    engine_add_input(&en_lflow, &en_sb_multicast_group, NULL);
+    engine_add_input(&en_lflow, &en_sb_logical_flow,
+                     lflow_sb_logical_flow_handler);
+    engine_add_input(&en_lflow, &en_sb_multicast_group,
+                     lflow_sb_multicast_group_handler);
     engine_add_input(&en_lflow, &en_sb_igmp_group, NULL);
-    engine_add_input(&en_lflow, &en_northd, NULL);
+
+    engine_add_input(&en_sync_from_sb, &en_northd, NULL);
+    engine_add_input(&en_sync_from_sb, &en_sb_port_binding,
+                     sync_from_sb_sb_port_binding_handler);
+    engine_add_input(&en_sync_from_sb, &en_sb_ha_chassis_group,
+                     sync_from_sb_sb_ha_chassis_group_handler);
+
+    engine_add_input(&en_northd_output, &en_sync_from_sb,
+                     engine_noop_handler);
+    engine_add_input(&en_northd_output, &en_lflow, engine_noop_handler);
 
     struct engine_arg engine_arg = {
         .nb_idl = nb->idl,
@@ -235,8 +276,14 @@ void inc_proc_northd_init(struct ovsdb_idl_loop *nb,
         chassis_hostname_index_create(sb->idl);
     struct ovsdb_idl_index *sbrec_static_mac_binding_by_lport_ip
         = static_mac_binding_index_create(sb->idl);
+    struct ovsdb_idl_index *sbrec_address_set_by_name
+        = ovsdb_idl_index_create1(sb->idl, &sbrec_address_set_col_name);
+    struct ovsdb_idl_index *nbrec_static_mac_binding_by_lport_ip
+        = ovsdb_idl_index_create2(nb->idl,
+                                  &nbrec_static_mac_binding_col_logical_port,
+                                  &nbrec_static_mac_binding_col_ip);
 
-    engine_init(&en_lflow, &engine_arg);
+    engine_init(&en_northd_output, &engine_arg);
 
     engine_ovsdb_node_add_index(&en_sb_chassis,
                                 "sbrec_chassis_by_name",
@@ -256,6 +303,12 @@ void inc_proc_northd_init(struct ovsdb_idl_loop *nb,
     engine_ovsdb_node_add_index(&en_sb_static_mac_binding,
                                 "sbrec_static_mac_binding_by_lport_ip",
                                 sbrec_static_mac_binding_by_lport_ip);
+    engine_ovsdb_node_add_index(&en_sb_address_set,
+                                "sbrec_address_set_by_name",
+                                sbrec_address_set_by_name);
+    engine_ovsdb_node_add_index(&en_nb_static_mac_binding,
+                                "nbrec_static_mac_binding_by_lport_ip",
+                                nbrec_static_mac_binding_by_lport_ip);
 }
 
 void inc_proc_northd_run(struct ovsdb_idl_txn *ovnnb_txn,
@@ -299,6 +352,19 @@ void inc_proc_northd_run(struct ovsdb_idl_txn *ovnnb_txn,
     }
 }
 
+/* Returns true if the last run only made part of the Logical_Flow changes in
+ * the SB, in which case the SB doesn't reflect the current NB contents yet. */
+bool inc_proc_northd_sb_sync_pending(void)
+{
+    const struct lflow_data *lflow_data = engine_get_internal_data(&en_lflow);
+    return lflow_data->sb_sync_pending;
+}
+
+void inc_proc_northd_get_memory_usage(struct simap *usage)
+{
+    engine_get_memory_usage(usage);
+}
+
 void inc_proc_northd_cleanup(void)
 {
     engine_cleanup();
@@ -11,6 +11,8 @@ void inc_proc_northd_init(struct ovsdb_idl_loop *nb,
 void inc_proc_northd_run(struct ovsdb_idl_txn *ovnnb_txn,
                          struct ovsdb_idl_txn *ovnsb_txn,
                          bool recompute);
+bool inc_proc_northd_sb_sync_pending(void);
+void inc_proc_northd_get_memory_usage(struct simap *usage);
 void inc_proc_northd_cleanup(void);
 
 #endif /* INC_PROC_NORTHD */
@@ -8,6 +8,7 @@
 #include "ipam.h"
 #include "ovn/lex.h"
 
+#include "simap.h"
 #include "smap.h"
 #include "packets.h"
 #include "bitmap.h"
@@ -88,19 +89,25 @@ ipam_get_unused_ip(struct ipam_info *info)
     return info->start_ipv4 + new_ip_index;
 }
 
-/* MAC address management (macam) table of "struct eth_addr"s, that holds the
- * MAC addresses allocated by the OVN ipam module. */
-static struct hmap macam = HMAP_INITIALIZER(&macam);
-
-struct macam_node {
-    struct hmap_node hmap_node;
-    struct eth_addr mac_addr; /* Allocated MAC address. */
-};
-
+/* MAC address management (macam) bitmap of the suffixes of the MAC addresses
+ * allocated by the OVN ipam module, i.e. of the MAC addresses that start with
+ * 'mac_prefix'.  It is allocated on first use and only cleared afterwards, so
+ * that it doesn't have to be rebuilt from scratch on every run, and unused
+ * MACs are found by scanning it a word at a time. */
 #define MAC_ADDR_SPACE 0xffffff
+static unsigned long *macam;
 static struct eth_addr mac_prefix;
 static char mac_prefix_str[18];
 
+static unsigned long *
+macam_get(void)
+{
+    if (!macam) {
+        macam = bitmap_allocate(MAC_ADDR_SPACE + 1);
+    }
+    return macam;
+}
+
 void
 ipam_insert_mac(struct eth_addr *ea, bool check)
 {
@@ -113,52 +120,60 @@ ipam_insert_mac(struct eth_addr *ea, bool check)
 
     /* If the new MAC was not assigned by this address management system or
      * check is true and the new MAC is a duplicate, do not insert it into the
-     * macam hmap. */
+     * macam bitmap. */
     if (((mac64 ^ prefix) >> 24)
         || (check && ipam_is_duplicate_mac(ea, mac64, true))) {
         return;
     }
 
-    struct macam_node *new_macam_node = xmalloc(sizeof *new_macam_node);
-    new_macam_node->mac_addr = *ea;
-    hmap_insert(&macam, &new_macam_node->hmap_node, hash_uint64(mac64));
+    bitmap_set1(macam_get(), mac64 & MAC_ADDR_SPACE);
 }
 
 uint64_t
 ipam_get_unused_mac(ovs_be32 ip)
 {
-    uint32_t mac_addr_suffix, i, base_addr = ntohl(ip) & MAC_ADDR_SPACE;
-    struct eth_addr mac;
-    uint64_t mac64;
-
-    for (i = 0; i < MAC_ADDR_SPACE - 1; i++) {
-        /* The tentative MAC's suffix will be in the interval (1, 0xfffffe). */
-        mac_addr_suffix = ((base_addr + i) % (MAC_ADDR_SPACE - 1)) + 1;
-        mac64 =  eth_addr_to_uint64(mac_prefix) | mac_addr_suffix;
-        eth_addr_from_uint64(mac64, &mac);
-        if (!ipam_is_duplicate_mac(&mac, mac64, false)) {
-            break;
+    unsigned long *bitmap = macam_get();
+
+    /* The MAC's suffix is in the interval [1, 0xfffffe].  The search starts
+     * from the suffix derived from 'ip' and wraps around. */
+    size_t start = ((ntohl(ip) & MAC_ADDR_SPACE) % (MAC_ADDR_SPACE - 1)) + 1;
+    size_t suffix = bitmap_scan(bitmap, 0, start, MAC_ADDR_SPACE);
+    if (suffix == MAC_ADDR_SPACE) {
+        suffix = bitmap_scan(bitmap, 0, 1, start);
+        if (suffix == start) {
+            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
+            VLOG_WARN_RL(&rl, "MAC address space exhausted.");
+            return 0;
         }
     }
 
-    if (i == MAC_ADDR_SPACE) {
-        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
-        VLOG_WARN_RL(&rl, "MAC address space exhausted.");
-        mac64 = 0;
-    }
-
-    return mac64;
+    return eth_addr_to_uint64(mac_prefix) | suffix;
 }
 
 void
 cleanup_macam(void)
 {
-    struct macam_node *node;
-    HMAP_FOR_EACH_POP (node, hmap_node, &macam) {
-        free(node);
+    if (macam) {
+        memset(macam, 0, bitmap_n_bytes(MAC_ADDR_SPACE + 1));
     }
 }
 
+/* Returns the number of bytes used by the IPv4 allocation bitmap of 'info'. */
+size_t
+ipam_info_get_memory_usage(const struct ipam_info *info)
+{
+    return info->allocated_ipv4s ? bitmap_n_bytes(info->total_ipv4s) : 0;
+}
+
+void
+ipam_get_memory_usage(struct simap *usage)
+{
+    size_t macam_usage = macam ? bitmap_n_bytes(MAC_ADDR_SPACE + 1) : 0;
+
+    simap_increase(usage, "ipam_macam_usage-KB",
+                   ROUND_UP(macam_usage, 1024) / 1024);
+}
+
 struct eth_addr
 get_mac_prefix(void)
 {
@@ -323,18 +338,13 @@ init_ipam_ipv4(const char *subnet_str, const char *exclude_ip_list,
 static bool
 ipam_is_duplicate_mac(struct eth_addr *ea, uint64_t mac64, bool warn)
 {
-    struct macam_node *macam_node;
-    HMAP_FOR_EACH_WITH_HASH (macam_node, hmap_node, hash_uint64(mac64),
-                             &macam) {
-        if (eth_addr_equals(*ea, macam_node->mac_addr)) {
-            if (warn) {
-                static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
-                VLOG_WARN_RL(&rl, "Duplicate MAC set: "ETH_ADDR_FMT,
-                             ETH_ADDR_ARGS(macam_node->mac_addr));
-            }
-            return true;
+    if (macam && bitmap_is_set(macam, mac64 & MAC_ADDR_SPACE)) {
+        if (warn) {
+            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
+            VLOG_WARN_RL(&rl, "Duplicate MAC set: "ETH_ADDR_FMT,
+                         ETH_ADDR_ARGS(*ea));
         }
+        return true;
     }
     return false;
 }
-
@@ -32,6 +32,11 @@ uint64_t ipam_get_unused_mac(ovs_be32 ip);
 
 void cleanup_macam(void);
 
+size_t ipam_info_get_memory_usage(const struct ipam_info *info);
+
+struct simap;
+void ipam_get_memory_usage(struct simap *usage);
+
 struct eth_addr get_mac_prefix(void);
 
 const char *set_mac_prefix(const char *hint);
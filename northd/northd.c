@@ -35,6 +35,7 @@
 #include "lib/ovn-nb-idl.h"
 #include "lib/ovn-sb-idl.h"
 #include "lib/ovn-util.h"
+#include "lib/ovn-usdt-probes.h"
 #include "lib/lb.h"
 #include "memory.h"
 #include "northd.h"
@@ -59,10 +60,21 @@
 VLOG_DEFINE_THIS_MODULE(northd);
 
 static bool controller_event_en;
-static bool lflow_hash_lock_initialized = false;
 
 static bool check_lsp_is_up;
 
+/* If this option is 'true' northd replies to ARP requests and ND
+ * solicitations for all the IPv4, respectively IPv6, addresses that share an
+ * Ethernet address of a logical switch port with a single logical flow,
+ * instead of one per address.  The default is false. */
+static bool group_arp_nd_responder;
+
+/* If this option is 'true' northd replaces the destination lookup flows of
+ * the static Ethernet addresses of the VIFs of a logical switch with a single
+ * port template logical flow, that every ovn-controller expands for the
+ * ports of the switch.  The default is false. */
+static bool parameterized_lflows;
+
 /* MAC allocated for service monitor usage. Just one mac is allocated
  * for this purpose and ovn-controller's on each chassis will make use
  * of this mac when sending out the packets to monitor the services
@@ -81,6 +93,13 @@ static bool use_ct_inv_match = true;
  */
 static bool default_acl_drop;
 
+/* If nonzero, the logs of the ACLs that don't have a meter of their own are
+ * rate limited to this number of packets per second, through a private
+ * meter for each ACL, so that the packets over the limit are dropped in the
+ * datapath instead of being sent to ovn-controller. */
+static uint32_t acl_log_rate_limit;
+static uint32_t acl_log_burst_size;
+
 #define MAX_OVN_TAGS 4096
 
 /* Pipeline stages. */
@@ -398,16 +417,50 @@ ovn_stage_to_datapath_type(enum ovn_stage stage)
     }
 }
 
+/* The qdisc queue ids in use on a chassis, or on a localnet port, as a
+ * bitmap.  They are kept in 'northd_data' across incremental runs and
+ * rebuilt from the SB Port_Bindings on recomputes. */
 struct ovn_chassis_qdisc_queues {
     struct hmap_node key_node;
-    uint32_t queue_id;
     struct uuid chassis_uuid;
+    struct ovn_tnlids queue_ids;
+    uint32_t hint;              /* Last allocated queue id. */
 };
 
-static uint32_t
-hash_chassis_queue(const struct uuid *chassis_uuid, uint32_t queue_id)
+/* Statistics of the queue id allocations, see qdisc_queue_stats_format(). */
+static struct {
+    uint64_t n_allocated;
+    uint64_t n_freed;
+    uint64_t n_failed;          /* Allocations with all the ids in use. */
+    size_t n_in_use;
+} qdisc_queue_stats;
+
+static struct ovn_chassis_qdisc_queues *
+chassis_queues_find(const struct hmap *set, const struct uuid *chassis_uuid)
+{
+    struct ovn_chassis_qdisc_queues *node;
+    HMAP_FOR_EACH_WITH_HASH (node, key_node, uuid_hash(chassis_uuid), set) {
+        if (uuid_equals(chassis_uuid, &node->chassis_uuid)) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+static struct ovn_chassis_qdisc_queues *
+chassis_queues_find_or_create(struct hmap *set,
+                              const struct uuid *chassis_uuid)
 {
-    return hash_2words(uuid_hash(chassis_uuid), queue_id);
+    struct ovn_chassis_qdisc_queues *node = chassis_queues_find(set,
+                                                                chassis_uuid);
+    if (!node) {
+        node = xmalloc(sizeof *node);
+        node->chassis_uuid = *chassis_uuid;
+        ovn_init_tnlids(&node->queue_ids);
+        node->hint = QDISC_MIN_QUEUE_ID;
+        hmap_insert(set, &node->key_node, uuid_hash(chassis_uuid));
+    }
+    return node;
 }
 
 static void
@@ -415,35 +468,22 @@ destroy_chassis_queues(struct hmap *set)
 {
     struct ovn_chassis_qdisc_queues *node;
     HMAP_FOR_EACH_POP (node, key_node, set) {
+        ovn_destroy_tnlids(&node->queue_ids);
         free(node);
     }
     hmap_destroy(set);
+    qdisc_queue_stats.n_in_use = 0;
 }
 
 static void
 add_chassis_queue(struct hmap *set, const struct uuid *chassis_uuid,
                   uint32_t queue_id)
 {
-    struct ovn_chassis_qdisc_queues *node = xmalloc(sizeof *node);
-    node->queue_id = queue_id;
-    node->chassis_uuid = *chassis_uuid;
-    hmap_insert(set, &node->key_node,
-                hash_chassis_queue(chassis_uuid, queue_id));
-}
-
-static bool
-chassis_queueid_in_use(const struct hmap *set, const struct uuid *chassis_uuid,
-                       uint32_t queue_id)
-{
-    const struct ovn_chassis_qdisc_queues *node;
-    HMAP_FOR_EACH_WITH_HASH (node, key_node,
-                             hash_chassis_queue(chassis_uuid, queue_id), set) {
-        if (uuid_equals(chassis_uuid, &node->chassis_uuid)
-            && node->queue_id == queue_id) {
-            return true;
-        }
+    struct ovn_chassis_qdisc_queues *node
+        = chassis_queues_find_or_create(set, chassis_uuid);
+    if (ovn_add_tnlid(&node->queue_ids, queue_id)) {
+        qdisc_queue_stats.n_in_use++;
     }
-    return false;
 }
 
 static uint32_t
@@ -453,15 +493,18 @@ allocate_chassis_queueid(struct hmap *set, const struct uuid *uuid, char *name)
         return 0;
     }
 
-    for (uint32_t queue_id = QDISC_MIN_QUEUE_ID + 1;
-         queue_id <= QDISC_MAX_QUEUE_ID;
-         queue_id++) {
-        if (!chassis_queueid_in_use(set, uuid, queue_id)) {
-            add_chassis_queue(set, uuid, queue_id);
-            return queue_id;
-        }
+    struct ovn_chassis_qdisc_queues *node
+        = chassis_queues_find_or_create(set, uuid);
+    uint32_t queue_id = ovn_tnlids_allocate(&node->queue_ids,
+                                            QDISC_MIN_QUEUE_ID + 1,
+                                            QDISC_MAX_QUEUE_ID, &node->hint);
+    if (queue_id) {
+        qdisc_queue_stats.n_allocated++;
+        qdisc_queue_stats.n_in_use++;
+        return queue_id;
     }
 
+    qdisc_queue_stats.n_failed++;
     static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
     VLOG_WARN_RL(&rl, "all %s queue ids exhausted", name);
     return 0;
@@ -475,18 +518,26 @@ free_chassis_queueid(struct hmap *set, const struct uuid *uuid,
         return;
     }
 
-    struct ovn_chassis_qdisc_queues *node;
-    HMAP_FOR_EACH_WITH_HASH (node, key_node,
-                             hash_chassis_queue(uuid, queue_id), set) {
-        if (uuid_equals(uuid, &node->chassis_uuid)
-            && node->queue_id == queue_id) {
-            hmap_remove(set, &node->key_node);
-            free(node);
-            break;
-        }
+    struct ovn_chassis_qdisc_queues *node = chassis_queues_find(set, uuid);
+    if (node && ovn_tnlid_present(&node->queue_ids, queue_id)) {
+        ovn_free_tnlid(&node->queue_ids, queue_id);
+        qdisc_queue_stats.n_freed++;
+        qdisc_queue_stats.n_in_use--;
     }
 }
 
+void
+qdisc_queue_stats_format(struct ds *s)
+{
+    ds_put_format(s, "Queue ids in use: %"PRIuSIZE"\n",
+                  qdisc_queue_stats.n_in_use);
+    ds_put_format(s, "Allocations: %"PRIu64"\n",
+                  qdisc_queue_stats.n_allocated);
+    ds_put_format(s, "Frees: %"PRIu64"\n", qdisc_queue_stats.n_freed);
+    ds_put_format(s, "Allocation failures: %"PRIu64"\n",
+                  qdisc_queue_stats.n_failed);
+}
+
 static inline bool
 port_has_qos_params(const struct smap *opts)
 {
@@ -546,7 +597,7 @@ struct mcast_router_info {
 
 struct mcast_info {
 
-    struct hmap group_tnlids;  /* Group tunnel IDs in use on this DP. */
+    struct ovn_tnlids group_tnlids; /* Group tunnel IDs in use on this DP. */
     uint32_t group_tnlid_hint; /* Hint for allocating next group tunnel ID. */
     struct ovs_list groups;    /* List of groups learnt on this DP. */
 
@@ -604,6 +655,8 @@ struct ovn_datapath {
 
     struct ovs_list list;       /* In list of similar records. */
 
+    size_t index;               /* Index in 'datapaths_array'. */
+
     uint32_t tunnel_key;
 
     /* Logical switch data. */
@@ -611,7 +664,7 @@ struct ovn_datapath {
     size_t n_router_ports;
     size_t n_allocated_router_ports;
 
-    struct hmap port_tnlids;
+    struct ovn_tnlids port_tnlids;
     uint32_t port_key_hint;
 
     bool has_stateful_acl;
@@ -676,8 +729,17 @@ struct ovn_datapath {
     struct hmap nb_pgs;
 
     struct ovs_list port_list;
+
+    /* Logical router only, see nat_lflow_caches_prepare(). */
+    struct nat_lflow_cache *nat_lflow_cache;
 };
 
+/* All the datapaths built by the last build_datapaths(), by their 'index', so
+ * that sets of datapaths can be represented as bitmaps of 'n_datapaths'
+ * bits. */
+static struct ovn_datapath **datapaths_array = NULL;
+static size_t n_datapaths = 0;
+
 /* Contains a NAT entry with the external addresses pre-parsed. */
 struct ovn_nat {
     const struct nbrec_nat *nb;
@@ -995,7 +1057,7 @@ ovn_datapath_create(struct hmap *datapaths, const struct uuid *key,
     od->sb = sb;
     od->nbs = nbs;
     od->nbr = nbr;
-    hmap_init(&od->port_tnlids);
+    ovn_init_tnlids(&od->port_tnlids);
     hmap_init(&od->nb_pgs);
     od->port_key_hint = 0;
     hmap_insert(datapaths, &od->key_node, uuid_hash(&od->key));
@@ -1187,7 +1249,7 @@ init_mcast_info_for_datapath(struct ovn_datapath *od)
         return;
     }
 
-    hmap_init(&od->mcast_info.group_tnlids);
+    ovn_init_tnlids(&od->mcast_info.group_tnlids);
     od->mcast_info.group_tnlid_hint = OVN_MIN_IP_MULTICAST;
     ovs_list_init(&od->mcast_info.groups);
 
@@ -1433,7 +1495,8 @@ get_ovn_max_dp_key_local(struct northd_input *input_data)
 
 static void
 ovn_datapath_allocate_key(struct northd_input *input_data,
-                          struct hmap *datapaths, struct hmap *dp_tnlids,
+                          struct hmap *datapaths,
+                          struct ovn_tnlids *dp_tnlids,
                           struct ovn_datapath *od, uint32_t *hint)
 {
     if (!od->tunnel_key) {
@@ -1453,7 +1516,7 @@ ovn_datapath_allocate_key(struct northd_input *input_data,
 
 static void
 ovn_datapath_assign_requested_tnl_id(struct northd_input *input_data,
-                                     struct hmap *dp_tnlids,
+                                     struct ovn_tnlids *dp_tnlids,
                                      struct ovn_datapath *od)
 {
     const struct smap *other_config = (od->nbs
@@ -1499,7 +1562,7 @@ build_datapaths(struct northd_input *input_data,
                    datapaths, &sb_only, &nb_only, &both, lr_list);
 
     /* Assign explicitly requested tunnel ids first. */
-    struct hmap dp_tnlids = HMAP_INITIALIZER(&dp_tnlids);
+    struct ovn_tnlids dp_tnlids = OVN_TNLIDS_INITIALIZER;
     struct ovn_datapath *od;
     LIST_FOR_EACH (od, list, &both) {
         ovn_datapath_assign_requested_tnl_id(input_data, &dp_tnlids, od);
@@ -1546,6 +1609,16 @@ build_datapaths(struct northd_input *input_data,
         sbrec_datapath_binding_delete(od->sb);
         ovn_datapath_destroy(datapaths, od);
     }
+
+    /* Assign the datapath indexes, used by the datapath group bitmaps. */
+    n_datapaths = hmap_count(datapaths);
+    datapaths_array = xrealloc(datapaths_array,
+                               n_datapaths * sizeof *datapaths_array);
+    size_t index = 0;
+    HMAP_FOR_EACH (od, key_node, datapaths) {
+        od->index = index;
+        datapaths_array[index++] = od;
+    }
 }
 
 /* Structure representing logical router port
@@ -1561,6 +1634,19 @@ struct ovn_port_routable_addresses {
     size_t n_addrs;
 };
 
+/* A reference from an ovn_port to one of the logical flows that were
+ * generated for it.  An ovn_lflow may be referenced by multiple ports, e.g.,
+ * if they generate the same flow.  This allows regenerating the logical flows
+ * of a single port without rebuilding the whole logical flow table. */
+struct lflow_ref_node {
+    struct ovs_list lflow_list_node; /* In the 'lflows' of an ovn_port or of
+                                      * an ovn_northd_lb. */
+    struct ovs_list ref_list_node;   /* In ovn_lflow's 'referenced_by'. */
+    struct ovn_lflow *lflow;
+};
+
+static void lflow_ref_node_destroy(struct lflow_ref_node *);
+
 /* A logical switch port or logical router port.
  *
  * In steady state, an ovn_port points to a northbound Logical_Switch_Port
@@ -1641,6 +1727,20 @@ struct ovn_port {
     struct ovs_list list;       /* In list of similar records. */
 
     struct ovs_list dp_node;
+
+    /* True if the logical switch port can be added, updated and deleted
+     * without a full recompute of 'en-northd'.  See
+     * lsp_can_be_inc_processed(). */
+    bool lsp_can_be_inc_processed;
+
+    /* Temporarily used when comparing old and new ports of a logical
+     * switch. */
+    bool visited;
+
+    /* List of struct lflow_ref_node, the logical flows generated for this
+     * port.  Only maintained for ports that can be incrementally processed,
+     * see 'lsp_can_be_inc_processed'. */
+    struct ovs_list lflows;
 };
 
 static bool
@@ -1722,10 +1822,50 @@ ovn_port_create(struct hmap *ports, const char *key,
     op->sb = sb;
     ovn_port_set_nb(op, nbsp, nbrp);
     op->l3dgw_port = op->cr_port = NULL;
+    ovs_list_init(&op->lflows);
     hmap_insert(ports, &op->key_node, hash_string(op->key, 0));
     return op;
 }
 
+static void
+ovn_port_cleanup_lsp_addresses(struct ovn_port *port)
+{
+    for (int i = 0; i < port->n_lsp_addrs; i++) {
+        destroy_lport_addresses(&port->lsp_addrs[i]);
+    }
+    free(port->lsp_addrs);
+    port->lsp_addrs = NULL;
+    port->n_lsp_addrs = 0;
+
+    for (int i = 0; i < port->n_ps_addrs; i++) {
+        destroy_lport_addresses(&port->ps_addrs[i]);
+    }
+    free(port->ps_addrs);
+    port->ps_addrs = NULL;
+    port->n_ps_addrs = 0;
+
+    port->has_unknown = false;
+}
+
+/* Frees 'port', which must already have been removed from the 'ports'
+ * hmap, e.g. by the incremental processing of logical switch changes. */
+static void
+ovn_port_destroy_orphan(struct ovn_port *port)
+{
+    struct lflow_ref_node *lfrn;
+    LIST_FOR_EACH_SAFE (lfrn, lflow_list_node, &port->lflows) {
+        lflow_ref_node_destroy(lfrn);
+    }
+
+    ovn_port_cleanup_lsp_addresses(port);
+    destroy_routable_addresses(&port->routables);
+
+    destroy_lport_addresses(&port->lrp_networks);
+    free(port->json_key);
+    free(port->key);
+    free(port);
+}
+
 static void
 ovn_port_destroy(struct hmap *ports, struct ovn_port *port)
 {
@@ -1734,23 +1874,7 @@ ovn_port_destroy(struct hmap *ports, struct ovn_port *port)
          * private list and once we've exited that function it is not safe to
          * use it. */
         hmap_remove(ports, &port->key_node);
-
-        for (int i = 0; i < port->n_lsp_addrs; i++) {
-            destroy_lport_addresses(&port->lsp_addrs[i]);
-        }
-        free(port->lsp_addrs);
-
-        for (int i = 0; i < port->n_ps_addrs; i++) {
-            destroy_lport_addresses(&port->ps_addrs[i]);
-        }
-        free(port->ps_addrs);
-
-        destroy_routable_addresses(&port->routables);
-
-        destroy_lport_addresses(&port->lrp_networks);
-        free(port->json_key);
-        free(port->key);
-        free(port);
+        ovn_port_destroy_orphan(port);
     }
 }
 
@@ -2505,6 +2629,89 @@ tag_alloc_create_new_tag(struct hmap *tag_alloc_table,
 }
 
 
+/* Parses the 'addresses' and 'port_security' columns of 'nbsp' into
+ * 'op->lsp_addrs' and 'op->ps_addrs'. */
+static void
+ovn_port_init_lsp_addresses(struct ovn_port *op,
+                            const struct nbrec_logical_switch_port *nbsp)
+{
+    op->lsp_addrs = xmalloc(sizeof *op->lsp_addrs * nbsp->n_addresses);
+    for (size_t j = 0; j < nbsp->n_addresses; j++) {
+        if (!strcmp(nbsp->addresses[j], "unknown")) {
+            op->has_unknown = true;
+            continue;
+        }
+        if (!strcmp(nbsp->addresses[j], "router")) {
+            continue;
+        }
+        if (is_dynamic_lsp_address(nbsp->addresses[j])) {
+            continue;
+        } else if (!extract_lsp_addresses(nbsp->addresses[j],
+                                          &op->lsp_addrs[op->n_lsp_addrs])) {
+            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
+            VLOG_INFO_RL(&rl, "invalid syntax '%s' in logical "
+                              "switch port addresses. No MAC "
+                              "address found",
+                              nbsp->addresses[j]);
+            continue;
+        }
+        op->n_lsp_addrs++;
+    }
+
+    op->ps_addrs = xmalloc(sizeof *op->ps_addrs * nbsp->n_port_security);
+    for (size_t j = 0; j < nbsp->n_port_security; j++) {
+        if (!extract_lsp_addresses(nbsp->port_security[j],
+                                   &op->ps_addrs[op->n_ps_addrs])) {
+            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
+            VLOG_INFO_RL(&rl, "invalid syntax '%s' in port "
+                              "security. No MAC address found",
+                              nbsp->port_security[j]);
+            continue;
+        }
+        op->n_ps_addrs++;
+    }
+}
+
+/* Returns true if the logical switch port 'nbsp' is a regular VIF whose
+ * addition, deletion and update can be handled incrementally by
+ * northd_handle_ls_changes() and northd_handle_lsp_changes(). */
+static bool
+lsp_can_be_inc_processed(const struct nbrec_logical_switch_port *nbsp)
+{
+    /* Support only normal VIFs for now. */
+    if (nbsp->type[0]) {
+        return false;
+    }
+
+    /* Tag allocation is not supported for now. */
+    if ((nbsp->parent_name && nbsp->parent_name[0]) || nbsp->n_tag ||
+        nbsp->n_tag_request) {
+        return false;
+    }
+
+    /* Ports with QoS settings need a chassis queue id. */
+    if (port_has_qos_params(&nbsp->options)) {
+        return false;
+    }
+
+    /* Ports with dynamic or "unknown" addresses are not supported. */
+    for (size_t j = 0; j < nbsp->n_addresses; j++) {
+        if (is_dynamic_lsp_address(nbsp->addresses[j]) ||
+            !strcmp(nbsp->addresses[j], "unknown") ||
+            !strcmp(nbsp->addresses[j], "router")) {
+            return false;
+        }
+    }
+
+    if (nbsp->ha_chassis_group) {
+        return false;
+    }
+
+    return true;
+}
+
+static void ovn_ports_init_lsp_addresses(struct hmap *ports);
+
 static void
 join_logical_ports(struct northd_input *input_data,
                    struct hmap *datapaths, struct hmap *ports,
@@ -2573,9 +2780,15 @@ join_logical_ports(struct northd_input *input_data,
                         ovn_port_set_nb(op, nbsp, NULL);
                         ovs_list_remove(&op->list);
 
+                        /* Localnet ports have queue ids of their own, see
+                         * ovn_port_update_sbrec(). */
                         uint32_t queue_id = smap_get_int(&op->sb->options,
                                                          "qdisc_queue_id", 0);
-                        if (queue_id && op->sb->chassis) {
+                        if (queue_id && !strcmp(nbsp->type, "localnet")) {
+                            add_chassis_queue(chassis_qdisc_queues,
+                                              &op->sb->header_.uuid,
+                                              queue_id);
+                        } else if (queue_id && op->sb->chassis) {
                             add_chassis_queue(
                                  chassis_qdisc_queues,
                                  &op->sb->chassis->header_.uuid,
@@ -2602,46 +2815,6 @@ join_logical_ports(struct northd_input *input_data,
                    od->localnet_ports[od->n_localnet_ports++] = op;
                 }
 
-                op->lsp_addrs
-                    = xmalloc(sizeof *op->lsp_addrs * nbsp->n_addresses);
-                for (size_t j = 0; j < nbsp->n_addresses; j++) {
-                    if (!strcmp(nbsp->addresses[j], "unknown")) {
-                        op->has_unknown = true;
-                        continue;
-                    }
-                    if (!strcmp(nbsp->addresses[j], "router")) {
-                        continue;
-                    }
-                    if (is_dynamic_lsp_address(nbsp->addresses[j])) {
-                        continue;
-                    } else if (!extract_lsp_addresses(nbsp->addresses[j],
-                                           &op->lsp_addrs[op->n_lsp_addrs])) {
-                        static struct vlog_rate_limit rl
-                            = VLOG_RATE_LIMIT_INIT(1, 1);
-                        VLOG_INFO_RL(&rl, "invalid syntax '%s' in logical "
-                                          "switch port addresses. No MAC "
-                                          "address found",
-                                          op->nbsp->addresses[j]);
-                        continue;
-                    }
-                    op->n_lsp_addrs++;
-                }
-
-                op->ps_addrs
-                    = xmalloc(sizeof *op->ps_addrs * nbsp->n_port_security);
-                for (size_t j = 0; j < nbsp->n_port_security; j++) {
-                    if (!extract_lsp_addresses(nbsp->port_security[j],
-                                               &op->ps_addrs[op->n_ps_addrs])) {
-                        static struct vlog_rate_limit rl
-                            = VLOG_RATE_LIMIT_INIT(1, 1);
-                        VLOG_INFO_RL(&rl, "invalid syntax '%s' in port "
-                                          "security. No MAC address found",
-                                          op->nbsp->port_security[j]);
-                        continue;
-                    }
-                    op->n_ps_addrs++;
-                }
-
                 op->od = od;
                 ovs_list_push_back(&od->port_list, &op->dp_node);
                 tag_alloc_add_existing_tags(tag_alloc_table, nbsp);
@@ -2737,6 +2910,10 @@ join_logical_ports(struct northd_input *input_data,
         }
     }
 
+    /* Parse the addresses of all the logical switch ports at once, which can
+     * be done in parallel. */
+    ovn_ports_init_lsp_addresses(ports);
+
     /* Connect logical router ports, and logical switch ports of type "router",
      * to their peers. */
     struct ovn_port *op;
@@ -3729,7 +3906,8 @@ create_or_get_service_mon(struct ovsdb_idl_txn *ovnsb_txn,
 
 static void
 ovn_lb_svc_create(struct ovsdb_idl_txn *ovnsb_txn, struct ovn_northd_lb *lb,
-                  struct hmap *monitor_map, struct hmap *ports)
+                  struct hmap *monitor_map, struct hmap *ports,
+                  struct sset *svc_monitor_lsps)
 {
     for (size_t i = 0; i < lb->n_vips; i++) {
         struct ovn_lb_vip *lb_vip = &lb->vips[i];
@@ -3750,6 +3928,7 @@ ovn_lb_svc_create(struct ovsdb_idl_txn *ovnsb_txn, struct ovn_northd_lb *lb,
                 if (p) {
                     *p = 0;
                     p++;
+                    sset_add(svc_monitor_lsps, port_name);
                     op = ovn_port_find(ports, port_name);
                     svc_mon_src_ip = xstrdup(p);
                 }
@@ -3894,6 +4073,7 @@ build_lbs(struct northd_input *input_data, struct hmap *datapaths,
         hmap_insert(lbs, &lb_nb->hmap_node,
                     uuid_hash(&nbrec_lb->header_.uuid));
     }
+    ovn_lb_cache_sweep();
 
     struct ovn_datapath *od;
     HMAP_FOR_EACH (od, key_node, datapaths) {
@@ -3951,7 +4131,8 @@ static void
 build_lb_svcs(struct northd_input *input_data,
               struct ovsdb_idl_txn *ovnsb_txn,
               struct hmap *ports,
-              struct hmap *lbs)
+              struct hmap *lbs,
+              struct sset *svc_monitor_lsps)
 {
     struct hmap monitor_map = HMAP_INITIALIZER(&monitor_map);
 
@@ -3969,7 +4150,8 @@ build_lb_svcs(struct northd_input *input_data,
 
     struct ovn_northd_lb *lb;
     HMAP_FOR_EACH (lb, hmap_node, lbs) {
-        ovn_lb_svc_create(ovnsb_txn, lb, &monitor_map, ports);
+        ovn_lb_svc_create(ovnsb_txn, lb, &monitor_map, ports,
+                          svc_monitor_lsps);
     }
 
     struct service_monitor_info *mon_info;
@@ -4095,11 +4277,12 @@ build_lrouter_lbs_reachable_ips(struct hmap *datapaths, struct hmap *lbs)
 static void
 build_lb_port_related_data(struct hmap *datapaths, struct hmap *ports,
                            struct hmap *lbs, struct northd_input *input_data,
-                           struct ovsdb_idl_txn *ovnsb_txn)
+                           struct ovsdb_idl_txn *ovnsb_txn,
+                           struct sset *svc_monitor_lsps)
 {
     build_lrouter_lbs_check(datapaths);
     build_lrouter_lbs_reachable_ips(datapaths, lbs);
-    build_lb_svcs(input_data, ovnsb_txn, ports, lbs);
+    build_lb_svcs(input_data, ovnsb_txn, ports, lbs, svc_monitor_lsps);
 }
 
 /* Syncs relevant load balancers (applied to logical switches) to the
@@ -4267,18 +4450,18 @@ build_ports(struct northd_input *input_data,
             struct ovsdb_idl_txn *ovnsb_txn,
             struct ovsdb_idl_index *sbrec_chassis_by_name,
             struct ovsdb_idl_index *sbrec_chassis_by_hostname,
-            struct hmap *datapaths, struct hmap *ports)
+            struct hmap *datapaths, struct hmap *ports,
+            struct hmap *chassis_qdisc_queues)
 {
     struct ovs_list sb_only, nb_only, both;
     struct hmap tag_alloc_table = HMAP_INITIALIZER(&tag_alloc_table);
-    struct hmap chassis_qdisc_queues = HMAP_INITIALIZER(&chassis_qdisc_queues);
 
     /* sset which stores the set of ha chassis group names used. */
     struct sset active_ha_chassis_grps =
         SSET_INITIALIZER(&active_ha_chassis_grps);
 
     join_logical_ports(input_data,
-                       datapaths, ports, &chassis_qdisc_queues,
+                       datapaths, ports, chassis_qdisc_queues,
                        &tag_alloc_table, &sb_only, &nb_only, &both);
 
     /* Purge stale Mac_Bindings if ports are deleted. */
@@ -4325,7 +4508,7 @@ build_ports(struct northd_input *input_data,
         ovn_port_update_sbrec(input_data,
                               ovnsb_txn, sbrec_chassis_by_name,
                               sbrec_chassis_by_hostname,
-                              op, &chassis_qdisc_queues,
+                              op, chassis_qdisc_queues,
                               &active_ha_chassis_grps);
     }
 
@@ -4335,7 +4518,7 @@ build_ports(struct northd_input *input_data,
         ovn_port_update_sbrec(input_data,
                               ovnsb_txn, sbrec_chassis_by_name,
                               sbrec_chassis_by_hostname, op,
-                              &chassis_qdisc_queues,
+                              chassis_qdisc_queues,
                               &active_ha_chassis_grps);
         sbrec_port_binding_set_logical_port(op->sb, op->key);
     }
@@ -4353,7 +4536,6 @@ build_ports(struct northd_input *input_data,
     }
 
     tag_alloc_destroy(&tag_alloc_table);
-    destroy_chassis_queues(&chassis_qdisc_queues);
     cleanup_sb_ha_chassis_groups(input_data, &active_ha_chassis_grps);
     sset_destroy(&active_ha_chassis_grps);
 }
@@ -4482,8 +4664,8 @@ ovn_multicast_destroy(struct hmap *mcgroups, struct ovn_multicast *mc)
 }
 
 static void
-ovn_multicast_update_sbrec(const struct ovn_multicast *mc,
-                           const struct sbrec_multicast_group *sb)
+ovn_multicast_set_sbrec(const struct ovn_multicast *mc,
+                        const struct sbrec_multicast_group *sb)
 {
     struct sbrec_port_binding **ports = xmalloc(mc->n_ports * sizeof *ports);
     for (size_t i = 0; i < mc->n_ports; i++) {
@@ -4493,6 +4675,31 @@ ovn_multicast_update_sbrec(const struct ovn_multicast *mc,
     free(ports);
 }
 
+/* Only sends the ports that were added to or removed from 'sb', so that a
+ * port change doesn't rewrite the whole 'ports' column of big groups like
+ * _MC_flood. */
+static void
+ovn_multicast_update_sbrec(const struct ovn_multicast *mc,
+                           const struct sbrec_multicast_group *sb)
+{
+    struct hmapx ports = HMAPX_INITIALIZER(&ports);
+    for (size_t i = 0; i < mc->n_ports; i++) {
+        hmapx_add(&ports, CONST_CAST(struct sbrec_port_binding *,
+                                     mc->ports[i]->sb));
+    }
+    for (size_t i = 0; i < sb->n_ports; i++) {
+        if (!hmapx_find_and_delete(&ports, sb->ports[i])) {
+            sbrec_multicast_group_update_ports_delvalue(sb, sb->ports[i]);
+        }
+    }
+
+    struct hmapx_node *node;
+    HMAPX_FOR_EACH (node, &ports) {
+        sbrec_multicast_group_update_ports_addvalue(sb, node->data);
+    }
+    hmapx_destroy(&ports);
+}
+
 /*
  * IGMP group entry (1:1 mapping to SB database).
  */
@@ -4718,8 +4925,9 @@ struct ovn_lflow {
     struct hmap_node hmap_node;
 
     struct ovn_datapath *od;     /* 'logical_datapath' in SB schema.  */
-    struct ovs_mutex odg_lock;   /* Lock guarding access to od_group */
-    struct hmapx od_group;       /* Hash map of 'struct ovn_datapath *'. */
+    unsigned long *dpg_bitmap;   /* Bitmap of all datapaths by their 'index',
+                                  * NULL once 'od' is set. */
+    size_t n_ods;                /* Number of datapaths in 'dpg_bitmap'. */
     enum ovn_stage stage;
     uint16_t priority;
     char *match;
@@ -4729,8 +4937,128 @@ struct ovn_lflow {
     char *ctrl_meter;
     struct ovn_dp_group *dpg;    /* Link to unique Sb datapath group. */
     const char *where;
+
+    struct uuid sb_uuid;         /* SB Logical_Flow, all-zero if not synced
+                                  * yet. */
+    struct ovs_list referenced_by; /* List of struct lflow_ref_node. */
+    bool untracked_ref;          /* Also generated for an object that doesn't
+                                  * track its logical flows. */
+    bool in_arena;               /* The lflow and its strings are allocated in
+                                  * the lflow arena. */
+};
+
+/* Logical flow arena.
+ *
+ * A full build of the logical flows allocates millions of ovn_lflows and
+ * small strings for their matches, actions, etc., which all stay alive until
+ * the next full build.  They are carved out of big chunks instead of being
+ * allocated one by one, and freed all at once by lflow_arena_clear().  Every
+ * thread allocates from its own chunk, so only the allocation of a new chunk
+ * needs the mutex.  Logical flows that are added incrementally between full
+ * builds are allocated with malloc(), as they may be removed one by one. */
+#define LFLOW_ARENA_CHUNK_SIZE (64 * 1024)
+
+struct lflow_arena_chunk {
+    struct ovs_list list_node;   /* In 'lflow_arena_chunks'. */
+    size_t size;
+    size_t used;
+    char data[];
+};
+
+static struct ovs_mutex lflow_arena_mutex = OVS_MUTEX_INITIALIZER;
+static struct ovs_list lflow_arena_chunks OVS_GUARDED_BY(lflow_arena_mutex)
+    = OVS_LIST_INITIALIZER(&lflow_arena_chunks);
+static size_t lflow_arena_usage OVS_GUARDED_BY(lflow_arena_mutex) = 0;
+
+/* True while the logical flows are allocated in the arena.  Only changed by
+ * the main thread while the worker threads are idle. */
+static bool lflow_arena_enabled = false;
+
+/* Incremented by lflow_arena_clear() to invalidate the current chunk of all
+ * the threads. */
+static uint64_t lflow_arena_seqno = 0;
+static thread_local struct lflow_arena_chunk *lflow_arena_cur = NULL;
+static thread_local uint64_t lflow_arena_cur_seqno = 0;
+
+static void *
+lflow_arena_alloc(size_t size, size_t align)
+{
+    struct lflow_arena_chunk *chunk = lflow_arena_cur;
+    if (lflow_arena_cur_seqno != lflow_arena_seqno) {
+        lflow_arena_cur_seqno = lflow_arena_seqno;
+        chunk = lflow_arena_cur = NULL;
+    }
+
+    size_t ofs = chunk ? ROUND_UP(chunk->used, align) : 0;
+    if (!chunk || ofs + size > chunk->size) {
+        size_t chunk_size = MAX(size, LFLOW_ARENA_CHUNK_SIZE);
+        chunk = xmalloc(sizeof *chunk + chunk_size);
+        chunk->size = chunk_size;
+        chunk->used = 0;
+        ofs = 0;
+
+        ovs_mutex_lock(&lflow_arena_mutex);
+        ovs_list_push_back(&lflow_arena_chunks, &chunk->list_node);
+        lflow_arena_usage += sizeof *chunk + chunk_size;
+        ovs_mutex_unlock(&lflow_arena_mutex);
+
+        if (size < LFLOW_ARENA_CHUNK_SIZE) {
+            lflow_arena_cur = chunk;
+        }
+    }
+
+    chunk->used = ofs + size;
+    return &chunk->data[ofs];
+}
+
+static char *
+lflow_arena_strdup(const char *s)
+{
+    if (!s) {
+        return NULL;
+    }
+
+    size_t len = strlen(s) + 1;
+    return memcpy(lflow_arena_alloc(len, 1), s, len);
+}
+
+/* Matches and actions that are used by a large share of the logical flows,
+ * which don't need a copy at all. */
+static const char *const lflow_interned_strs[] = {
+    "1", "next;", "drop;", "output;",
 };
 
+static char *
+lflow_arena_intern(const char *s)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(lflow_interned_strs); i++) {
+        if (!strcmp(s, lflow_interned_strs[i])) {
+            return CONST_CAST(char *, lflow_interned_strs[i]);
+        }
+    }
+    return lflow_arena_strdup(s);
+}
+
+/* Frees all the memory allocated in the arena.  The logical flows allocated
+ * in it must have been destroyed already. */
+static void
+lflow_arena_clear(void)
+{
+    struct lflow_arena_chunk *chunk;
+
+    ovs_mutex_lock(&lflow_arena_mutex);
+    LIST_FOR_EACH_POP (chunk, list_node, &lflow_arena_chunks) {
+        free(chunk);
+    }
+    lflow_arena_usage = 0;
+    ovs_mutex_unlock(&lflow_arena_mutex);
+    lflow_arena_seqno++;
+}
+
+/* The 'lflows' list of the ovn_port or ovn_northd_lb for which logical flows
+ * are being generated by the current thread, if the flows are tracked. */
+static thread_local struct ovs_list *lflow_ref_list = NULL;
+
 static void ovn_lflow_destroy(struct hmap *lflows, struct ovn_lflow *lflow);
 static struct ovn_lflow *ovn_lflow_find(const struct hmap *lflows,
                                         const struct ovn_datapath *od,
@@ -4765,6 +5093,11 @@ ovn_lflow_equal(const struct ovn_lflow *a, const struct ovn_datapath *od,
  * logical datapath only by creating a datapath group. */
 static bool use_logical_dp_groups = false;
 
+/* Maximum number of Logical_Flow records that build_lflows() inserts, deletes
+ * or moves to another datapath group in a single SB transaction, 0 if there
+ * is no limit. */
+static size_t max_lflow_changes_per_sb_txn = 0;
+
 enum {
     STATE_NULL,               /* parallelization is off */
     STATE_INIT_HASH_SIZES,    /* parallelization is on; hashes sizing needed */
@@ -4778,7 +5111,8 @@ ovn_lflow_init(struct ovn_lflow *lflow, struct ovn_datapath *od,
                char *match, char *actions, char *io_port, char *ctrl_meter,
                char *stage_hint, const char *where)
 {
-    hmapx_init(&lflow->od_group);
+    lflow->dpg_bitmap = bitmap_allocate(n_datapaths);
+    lflow->n_ods = 0;
     lflow->od = od;
     lflow->stage = stage;
     lflow->priority = priority;
@@ -4789,75 +5123,89 @@ ovn_lflow_init(struct ovn_lflow *lflow, struct ovn_datapath *od,
     lflow->ctrl_meter = ctrl_meter;
     lflow->dpg = NULL;
     lflow->where = where;
-    if ((parallelization_state != STATE_NULL)
-        && use_logical_dp_groups) {
-        ovs_mutex_init(&lflow->odg_lock);
-    }
+    uuid_zero(&lflow->sb_uuid);
+    ovs_list_init(&lflow->referenced_by);
+    lflow->untracked_ref = false;
+    lflow->in_arena = false;
 }
 
-static bool
-ovn_dp_group_add_with_reference(struct ovn_lflow *lflow_ref,
-                                struct ovn_datapath *od)
-                                OVS_NO_THREAD_SAFETY_ANALYSIS
+/* Records that 'lflow' was generated for the owner of 'lflow_ref_list', if
+ * set. */
+static void
+ovn_lflow_add_ref(struct ovn_lflow *lflow)
 {
-    if (!use_logical_dp_groups || !lflow_ref) {
-        return false;
-    }
-
-    if (parallelization_state == STATE_USE_PARALLELIZATION) {
-        ovs_mutex_lock(&lflow_ref->odg_lock);
-        hmapx_add(&lflow_ref->od_group, od);
-        ovs_mutex_unlock(&lflow_ref->odg_lock);
-    } else {
-        hmapx_add(&lflow_ref->od_group, od);
+    if (!lflow_ref_list) {
+        lflow->untracked_ref = true;
+        return;
     }
 
-    return true;
+    struct lflow_ref_node *lfrn = xmalloc(sizeof *lfrn);
+    lfrn->lflow = lflow;
+    ovs_list_push_back(lflow_ref_list, &lfrn->lflow_list_node);
+    ovs_list_push_back(&lflow->referenced_by, &lfrn->ref_list_node);
 }
 
-/* The lflow_hash_lock is a mutex array that protects updates to the shared
- * lflow table across threads when parallel lflow build and dp-group are both
- * enabled. To avoid high contention between threads, a big array of mutexes
- * are used instead of just one. This is possible because when parallel build
- * is used we only use hmap_insert_fast() to update the hmap, which would not
- * touch the bucket array but only the list in a single bucket. We only need to
- * make sure that when adding lflows to the same hash bucket, the same lock is
- * used, so that no two threads can add to the bucket at the same time.  It is
- * ok that the same lock is used to protect multiple buckets, so a fixed sized
- * mutex array is used instead of 1-1 mapping to the hash buckets. This
- * simplies the implementation while effectively reduces lock contention
- * because the chance that different threads contending the same lock amongst
- * the big number of locks is very low. */
-#define LFLOW_HASH_LOCK_MASK 0xFFFF
-static struct ovs_mutex lflow_hash_locks[LFLOW_HASH_LOCK_MASK + 1];
+static void
+lflow_ref_node_destroy(struct lflow_ref_node *lfrn)
+{
+    ovs_list_remove(&lfrn->lflow_list_node);
+    ovs_list_remove(&lfrn->ref_list_node);
+    free(lfrn);
+}
 
+/* Moves all the references of logical flow 'from' to 'to', which is an
+ * identical logical flow. */
 static void
-lflow_hash_lock_init(void)
+ovn_lflow_move_refs(struct ovn_lflow *to, struct ovn_lflow *from)
 {
-    if (!lflow_hash_lock_initialized) {
-        for (size_t i = 0; i < LFLOW_HASH_LOCK_MASK + 1; i++) {
-            ovs_mutex_init(&lflow_hash_locks[i]);
-        }
-        lflow_hash_lock_initialized = true;
+    struct lflow_ref_node *lfrn;
+    LIST_FOR_EACH_SAFE (lfrn, ref_list_node, &from->referenced_by) {
+        ovs_list_remove(&lfrn->ref_list_node);
+        lfrn->lflow = to;
+        ovs_list_push_back(&to->referenced_by, &lfrn->ref_list_node);
     }
+    to->untracked_ref |= from->untracked_ref;
 }
 
+/* Adds 'od' to the datapath group of 'lflow'. */
 static void
-lflow_hash_lock_destroy(void)
+ovn_lflow_add_od(struct ovn_lflow *lflow, const struct ovn_datapath *od)
 {
-    if (lflow_hash_lock_initialized) {
-        for (size_t i = 0; i < LFLOW_HASH_LOCK_MASK + 1; i++) {
-            ovs_mutex_destroy(&lflow_hash_locks[i]);
-        }
+    if (!bitmap_is_set(lflow->dpg_bitmap, od->index)) {
+        bitmap_set1(lflow->dpg_bitmap, od->index);
+        lflow->n_ods++;
+    }
+}
+
+/* Returns the only datapath of 'lflow', which must have exactly one. */
+static struct ovn_datapath *
+ovn_lflow_get_single_od(const struct ovn_lflow *lflow)
+{
+    ovs_assert(lflow->n_ods == 1);
+    return datapaths_array[bitmap_scan(lflow->dpg_bitmap, true, 0,
+                                       n_datapaths)];
+}
+
+static bool
+ovn_dp_group_add_with_reference(struct ovn_lflow *lflow_ref,
+                                struct ovn_datapath *od)
+{
+    if (!use_logical_dp_groups || !lflow_ref) {
+        return false;
     }
-    lflow_hash_lock_initialized = false;
+
+    ovn_lflow_add_od(lflow_ref, od);
+    return true;
 }
 
 /* This thread-local var is used for parallel lflow building when dp-groups is
- * enabled. It maintains the number of lflows inserted by the current thread to
- * the shared lflow hmap in the current iteration. It is needed because the
- * lflow_hash_lock cannot protect current update of the hmap's size (hmap->n)
- * by different threads.
+ * enabled.  Every thread builds its logical flows into its own segment of the
+ * lflow table, with hmap_insert_fast(), and then merges a slice of the buckets
+ * of all the segments into the shared lflow hmap (see
+ * build_lflows_merge_segs()).  It maintains the number of lflows inserted by
+ * the current thread to the shared lflow hmap in the current iteration,
+ * because the concurrent updates of the hmap's size (hmap->n) by different
+ * threads are not accurate.
  *
  * When all threads complete the tasks of an iteration, the counters of all the
  * threads are collected to fix the lflow hmap's size (by the function
@@ -4865,9 +5213,76 @@ lflow_hash_lock_destroy(void)
  * */
 static thread_local size_t thread_lflow_counter = 0;
 
-/* Adds a row with the specified contents to the Logical_Flow table.
- * Version to use when hash bucket locking is NOT required.
- */
+/* Number of calls to do_ovn_lflow_add() by the current thread, including the
+ * ones that only added a datapath to an existing logical flow. */
+static thread_local size_t thread_lflow_add_counter = 0;
+
+/* Logical flows recorded while they were generated, so that they can be added
+ * again to the lflow table later without generating them again. */
+struct lflow_bundle_flow {
+    enum ovn_stage stage;
+    uint16_t priority;
+    char *match;
+    char *actions;
+    char *io_port;
+    char *ctrl_meter;
+    const char *where;
+    uint32_t hash;
+};
+
+struct lflow_bundle {
+    struct lflow_bundle_flow *flows;
+    size_t n_flows;
+    size_t allocated_flows;
+};
+
+/* If set, the logical flows added by the current thread are also recorded in
+ * this bundle. */
+static thread_local struct lflow_bundle *lflow_bundle_recording = NULL;
+
+static void
+lflow_bundle_add(struct lflow_bundle *bundle, enum ovn_stage stage,
+                 uint16_t priority, const char *match, const char *actions,
+                 const char *io_port, const char *ctrl_meter,
+                 const char *where, uint32_t hash)
+{
+    if (bundle->n_flows == bundle->allocated_flows) {
+        bundle->flows = x2nrealloc(bundle->flows, &bundle->allocated_flows,
+                                   sizeof *bundle->flows);
+    }
+
+    struct lflow_bundle_flow *flow = &bundle->flows[bundle->n_flows++];
+    flow->stage = stage;
+    flow->priority = priority;
+    flow->match = xstrdup(match);
+    flow->actions = xstrdup(actions);
+    flow->io_port = nullable_xstrdup(io_port);
+    flow->ctrl_meter = nullable_xstrdup(ctrl_meter);
+    flow->where = where;
+    flow->hash = hash;
+}
+
+static void
+lflow_bundle_clear(struct lflow_bundle *bundle)
+{
+    for (size_t i = 0; i < bundle->n_flows; i++) {
+        struct lflow_bundle_flow *flow = &bundle->flows[i];
+        free(flow->match);
+        free(flow->actions);
+        free(flow->io_port);
+        free(flow->ctrl_meter);
+    }
+    bundle->n_flows = 0;
+}
+
+static void
+lflow_bundle_destroy(struct lflow_bundle *bundle)
+{
+    lflow_bundle_clear(bundle);
+    free(bundle->flows);
+}
+
+/* Adds a row with the specified contents to the Logical_Flow table. */
 static struct ovn_lflow *
 do_ovn_lflow_add(struct hmap *lflow_map, struct ovn_datapath *od,
                  uint32_t hash, enum ovn_stage stage, uint16_t priority,
@@ -4879,25 +5294,47 @@ do_ovn_lflow_add(struct hmap *lflow_map, struct ovn_datapath *od,
     struct ovn_lflow *old_lflow;
     struct ovn_lflow *lflow;
 
+    thread_lflow_add_counter++;
+    if (lflow_bundle_recording) {
+        lflow_bundle_add(lflow_bundle_recording, stage, priority, match,
+                         actions, io_port, ctrl_meter, where, hash);
+    }
     if (use_logical_dp_groups) {
         old_lflow = ovn_lflow_find(lflow_map, NULL, stage, priority, match,
                                    actions, ctrl_meter, hash);
         if (old_lflow) {
             ovn_dp_group_add_with_reference(old_lflow, od);
+            ovn_lflow_add_ref(old_lflow);
             return old_lflow;
         }
     }
 
-    lflow = xmalloc(sizeof *lflow);
     /* While adding new logical flows we're not setting single datapath, but
      * collecting a group.  'od' will be updated later for all flows with only
      * one datapath in a group, so it could be hashed correctly. */
-    ovn_lflow_init(lflow, NULL, stage, priority,
-                   xstrdup(match), xstrdup(actions),
-                   io_port ? xstrdup(io_port) : NULL,
-                   nullable_xstrdup(ctrl_meter),
-                   ovn_lflow_hint(stage_hint), where);
-    hmapx_add(&lflow->od_group, od);
+    if (lflow_arena_enabled) {
+        char hint[9] = "";
+        if (stage_hint) {
+            snprintf(hint, sizeof hint, "%08x", stage_hint->uuid.parts[0]);
+        }
+
+        lflow = lflow_arena_alloc(sizeof *lflow, sizeof(uint64_t));
+        ovn_lflow_init(lflow, NULL, stage, priority,
+                       lflow_arena_intern(match), lflow_arena_intern(actions),
+                       lflow_arena_strdup(io_port),
+                       lflow_arena_strdup(ctrl_meter),
+                       stage_hint ? lflow_arena_strdup(hint) : NULL, where);
+        lflow->in_arena = true;
+    } else {
+        lflow = xmalloc(sizeof *lflow);
+        ovn_lflow_init(lflow, NULL, stage, priority,
+                       xstrdup(match), xstrdup(actions),
+                       io_port ? xstrdup(io_port) : NULL,
+                       nullable_xstrdup(ctrl_meter),
+                       ovn_lflow_hint(stage_hint), where);
+    }
+    ovn_lflow_add_od(lflow, od);
+    ovn_lflow_add_ref(lflow);
     if (parallelization_state != STATE_USE_PARALLELIZATION) {
         hmap_insert(lflow_map, &lflow->hmap_node, hash);
     } else {
@@ -4907,29 +5344,6 @@ do_ovn_lflow_add(struct hmap *lflow_map, struct ovn_datapath *od,
     return lflow;
 }
 
-/* Adds a row with the specified contents to the Logical_Flow table.
- * Version to use when hash bucket locking IS required.
- */
-static struct ovn_lflow *
-do_ovn_lflow_add_pd(struct hmap *lflow_map, struct ovn_datapath *od,
-                    uint32_t hash, enum ovn_stage stage, uint16_t priority,
-                    const char *match, const char *actions,
-                    const char *io_port,
-                    const struct ovsdb_idl_row *stage_hint,
-                    const char *where, const char *ctrl_meter)
-{
-
-    struct ovn_lflow *lflow;
-    struct ovs_mutex *hash_lock =
-        &lflow_hash_locks[hash & lflow_map->mask & LFLOW_HASH_LOCK_MASK];
-
-    ovs_mutex_lock(hash_lock);
-    lflow = do_ovn_lflow_add(lflow_map, od, hash, stage, priority, match,
-                             actions, io_port, stage_hint, where, ctrl_meter);
-    ovs_mutex_unlock(hash_lock);
-    return lflow;
-}
-
 static struct ovn_lflow *
 ovn_lflow_add_at_with_hash(struct hmap *lflow_map, struct ovn_datapath *od,
                            enum ovn_stage stage, uint16_t priority,
@@ -4938,19 +5352,9 @@ ovn_lflow_add_at_with_hash(struct hmap *lflow_map, struct ovn_datapath *od,
                            const struct ovsdb_idl_row *stage_hint,
                            const char *where, uint32_t hash)
 {
-    struct ovn_lflow *lflow;
-
     ovs_assert(ovn_stage_to_datapath_type(stage) == ovn_datapath_get_type(od));
-    if (use_logical_dp_groups
-        && (parallelization_state == STATE_USE_PARALLELIZATION)) {
-        lflow = do_ovn_lflow_add_pd(lflow_map, od, hash, stage, priority,
-                                    match, actions, io_port, stage_hint, where,
-                                    ctrl_meter);
-    } else {
-        lflow = do_ovn_lflow_add(lflow_map, od, hash, stage, priority, match,
-                         actions, io_port, stage_hint, where, ctrl_meter);
-    }
-    return lflow;
+    return do_ovn_lflow_add(lflow_map, od, hash, stage, priority, match,
+                            actions, io_port, stage_hint, where, ctrl_meter);
 }
 
 /* Adds a row with the specified contents to the Logical_Flow table. */
@@ -5028,25 +5432,249 @@ static void
 ovn_lflow_destroy(struct hmap *lflows, struct ovn_lflow *lflow)
 {
     if (lflow) {
-        if ((parallelization_state != STATE_NULL)
-            && use_logical_dp_groups) {
-            ovs_mutex_destroy(&lflow->odg_lock);
-        }
         if (lflows) {
             hmap_remove(lflows, &lflow->hmap_node);
         }
-        hmapx_destroy(&lflow->od_group);
-        free(lflow->match);
-        free(lflow->actions);
-        free(lflow->io_port);
-        free(lflow->stage_hint);
-        free(lflow->ctrl_meter);
-        free(lflow);
+        struct lflow_ref_node *lfrn;
+        LIST_FOR_EACH_SAFE (lfrn, ref_list_node, &lflow->referenced_by) {
+            lflow_ref_node_destroy(lfrn);
+        }
+        bitmap_free(lflow->dpg_bitmap);
+        if (!lflow->in_arena) {
+            free(lflow->match);
+            free(lflow->actions);
+            free(lflow->io_port);
+            free(lflow->stage_hint);
+            free(lflow->ctrl_meter);
+            free(lflow);
+        }
+    }
+}
+
+/* The parts of the DHCPv4 or DHCPv6 options actions that only depend on a
+ * DHCP_Options row, so that they are formatted once per row rather than once
+ * per logical switch port that uses it.  Must be built, with
+ * build_dhcp_opts_templates(), before the logical switch flows are built,
+ * possibly in parallel. */
+struct dhcp_opts_template {
+    struct hmap_node hmap_node;    /* In 'dhcp_opts_templates'. */
+    const struct nbrec_dhcp_options *row;
+    bool is_ipv6;                  /* Used as DHCPv6 options? */
+
+    bool cidr_ok;                  /* Is 'row->cidr' valid? */
+    bool opts_ok;                  /* Are the required options present? */
+
+    /* The sorted "key = value, " options, ready to be appended to the
+     * put_dhcp_opts() or put_dhcpv6_opts() action.  For DHCPv4, the
+     * "hostname" option can be overridden by the logical switch port, so
+     * 'opts' only has the options sorted before it, and 'opts_after_hostname'
+     * the options sorted after it. */
+    char *opts;
+    char *opts_after_hostname;
+    const char *hostname;
+
+    char *response_action;
+
+    /* DHCPv4. */
+    ovs_be32 host_ip4, mask4;
+    const char *server_ip;
+
+    /* DHCPv6. */
+    struct in6_addr host_ip6, mask6;
+    bool stateful;                 /* Offer the port address (ia_addr)? */
+};
+
+static uint32_t
+dhcp_opts_template_hash(const struct nbrec_dhcp_options *row, bool is_ipv6)
+{
+    return hash_boolean(is_ipv6, uuid_hash(&row->header_.uuid));
+}
+
+static const struct dhcp_opts_template *
+dhcp_opts_template_find(const struct hmap *dhcp_opts_templates,
+                        const struct nbrec_dhcp_options *row, bool is_ipv6)
+{
+    struct dhcp_opts_template *template;
+    HMAP_FOR_EACH_WITH_HASH (template, hmap_node,
+                             dhcp_opts_template_hash(row, is_ipv6),
+                             dhcp_opts_templates) {
+        if (template->row == row && template->is_ipv6 == is_ipv6) {
+            return template;
+        }
+    }
+    return NULL;
+}
+
+static void
+dhcpv4_opts_template_init(struct dhcp_opts_template *template)
+{
+    const struct nbrec_dhcp_options *row = template->row;
+
+    char *error = ip_parse_masked(row->cidr, &template->host_ip4,
+                                  &template->mask4);
+    if (error) {
+        free(error);
+        return;
+    }
+    template->cidr_ok = true;
+
+    const char *server_ip = smap_get(&row->options, "server_id");
+    const char *server_mac = smap_get(&row->options, "server_mac");
+    const char *lease_time = smap_get(&row->options, "lease_time");
+    if (!(server_ip && server_mac && lease_time)) {
+        return;
+    }
+    template->opts_ok = true;
+    template->server_ip = server_ip;
+    template->hostname = smap_get(&row->options, "hostname");
+
+    struct smap dhcpv4_options = SMAP_INITIALIZER(&dhcpv4_options);
+    smap_clone(&dhcpv4_options, &row->options);
+
+    /* server_mac is not DHCPv4 option, delete it from the smap. */
+    smap_remove(&dhcpv4_options, "server_mac");
+    smap_remove(&dhcpv4_options, "hostname");
+    char *netmask = xasprintf(IP_FMT, IP_ARGS(template->mask4));
+    smap_add(&dhcpv4_options, "netmask", netmask);
+    free(netmask);
+
+    /* We're not using SMAP_FOR_EACH because we want a consistent order of the
+     * options on different architectures (big or little endian, SSE4.2) */
+    struct ds opts = DS_EMPTY_INITIALIZER;
+    struct ds opts_after_hostname = DS_EMPTY_INITIALIZER;
+    const struct smap_node **sorted_opts = smap_sort(&dhcpv4_options);
+    for (size_t i = 0; i < smap_count(&dhcpv4_options); i++) {
+        const struct smap_node *node = sorted_opts[i];
+        ds_put_format(strcmp(node->key, "hostname") < 0
+                      ? &opts : &opts_after_hostname,
+                      "%s = %s, ", node->key, node->value);
+    }
+    free(sorted_opts);
+    smap_destroy(&dhcpv4_options);
+
+    template->opts = ds_steal_cstr(&opts);
+    template->opts_after_hostname = ds_steal_cstr(&opts_after_hostname);
+    template->response_action = xasprintf(
+        "eth.dst = eth.src; eth.src = %s; "
+        "ip4.src = %s; udp.src = 67; udp.dst = 68; "
+        "outport = inport; flags.loopback = 1; output;",
+        server_mac, server_ip);
+}
+
+static void
+dhcpv6_opts_template_init(struct dhcp_opts_template *template)
+{
+    const struct nbrec_dhcp_options *row = template->row;
+
+    char *error = ipv6_parse_masked(row->cidr, &template->host_ip6,
+                                    &template->mask6);
+    if (error) {
+        free(error);
+        return;
+    }
+    template->cidr_ok = true;
+
+    /* "server_id" should be the MAC address. */
+    const char *server_mac = smap_get(&row->options, "server_id");
+    struct eth_addr ea;
+    if (!server_mac || !eth_addr_from_string(server_mac, &ea)) {
+        return;
+    }
+    template->opts_ok = true;
+
+    /* Get the link local IP of the DHCPv6 server from the server MAC. */
+    struct in6_addr lla;
+    in6_generate_lla(ea, &lla);
+
+    char server_ip[INET6_ADDRSTRLEN + 1];
+    ipv6_string_mapped(server_ip, &lla);
+
+    /* Check whether the dhcpv6 options should be configured as stateful.
+     * Only reply with ia_addr option for dhcpv6 stateful address mode. */
+    template->stateful = !smap_get_bool(&row->options, "dhcpv6_stateless",
+                                        false);
+
+    /* We're not using SMAP_FOR_EACH because we want a consistent order of the
+     * options on different architectures (big or little endian, SSE4.2) */
+    struct ds opts = DS_EMPTY_INITIALIZER;
+    const struct smap_node **sorted_opts = smap_sort(&row->options);
+    for (size_t i = 0; i < smap_count(&row->options); i++) {
+        const struct smap_node *node = sorted_opts[i];
+        if (strcmp(node->key, "dhcpv6_stateless")) {
+            ds_put_format(&opts, "%s = %s, ", node->key, node->value);
+        }
+    }
+    free(sorted_opts);
+
+    template->opts = ds_steal_cstr(&opts);
+    template->response_action = xasprintf(
+        "eth.dst = eth.src; eth.src = %s; "
+        "ip6.dst = ip6.src; ip6.src = %s; udp.src = 547; "
+        "udp.dst = 546; outport = inport; flags.loopback = 1; "
+        "output;",
+        server_mac, server_ip);
+}
+
+static void
+dhcp_opts_template_build(struct hmap *dhcp_opts_templates,
+                         const struct nbrec_dhcp_options *row, bool is_ipv6)
+{
+    if (!row || dhcp_opts_template_find(dhcp_opts_templates, row, is_ipv6)) {
+        return;
+    }
+
+    struct dhcp_opts_template *template = xzalloc(sizeof *template);
+    template->row = row;
+    template->is_ipv6 = is_ipv6;
+    if (is_ipv6) {
+        dhcpv6_opts_template_init(template);
+    } else {
+        dhcpv4_opts_template_init(template);
+    }
+    hmap_insert(dhcp_opts_templates, &template->hmap_node,
+                dhcp_opts_template_hash(row, is_ipv6));
+}
+
+/* Builds the templates of the DHCP options used by logical switch port
+ * 'op'. */
+static void
+build_dhcp_opts_templates_for_port(const struct ovn_port *op,
+                                   struct hmap *dhcp_opts_templates)
+{
+    if (op->nbsp) {
+        dhcp_opts_template_build(dhcp_opts_templates,
+                                 op->nbsp->dhcpv4_options, false);
+        dhcp_opts_template_build(dhcp_opts_templates,
+                                 op->nbsp->dhcpv6_options, true);
+    }
+}
+
+static void
+build_dhcp_opts_templates(const struct hmap *ports,
+                          struct hmap *dhcp_opts_templates)
+{
+    const struct ovn_port *op;
+    HMAP_FOR_EACH (op, key_node, ports) {
+        build_dhcp_opts_templates_for_port(op, dhcp_opts_templates);
+    }
+}
+
+static void
+destroy_dhcp_opts_templates(struct hmap *dhcp_opts_templates)
+{
+    struct dhcp_opts_template *template;
+    HMAP_FOR_EACH_POP (template, hmap_node, dhcp_opts_templates) {
+        free(template->opts);
+        free(template->opts_after_hostname);
+        free(template->response_action);
+        free(template);
     }
+    hmap_destroy(dhcp_opts_templates);
 }
 
 static bool
 build_dhcpv4_action(struct ovn_port *op, ovs_be32 offer_ip,
+                    const struct hmap *dhcp_opts_templates,
                     struct ds *options_action, struct ds *response_action,
                     struct ds *ipv4_addr_match)
 {
@@ -5055,27 +5683,22 @@ build_dhcpv4_action(struct ovn_port *op, ovs_be32 offer_ip,
         return false;
     }
 
-    ovs_be32 host_ip, mask;
-    char *error = ip_parse_masked(op->nbsp->dhcpv4_options->cidr, &host_ip,
-                                  &mask);
-    if (error || ((offer_ip ^ host_ip) & mask)) {
+    const struct dhcp_opts_template *template
+        = dhcp_opts_template_find(dhcp_opts_templates,
+                                  op->nbsp->dhcpv4_options, false);
+    ovs_assert(template);
+
+    if (!template->cidr_ok
+        || ((offer_ip ^ template->host_ip4) & template->mask4)) {
        /* Either
         *  - cidr defined is invalid or
         *  - the offer ip of the logical port doesn't belong to the cidr
         *    defined in the DHCPv4 options.
         *  */
-        free(error);
         return false;
     }
 
-    const char *server_ip = smap_get(
-        &op->nbsp->dhcpv4_options->options, "server_id");
-    const char *server_mac = smap_get(
-        &op->nbsp->dhcpv4_options->options, "server_mac");
-    const char *lease_time = smap_get(
-        &op->nbsp->dhcpv4_options->options, "lease_time");
-
-    if (!(server_ip && server_mac && lease_time)) {
+    if (!template->opts_ok) {
         /* "server_id", "server_mac" and "lease_time" should be
          * present in the dhcp_options. */
         static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
@@ -5084,54 +5707,38 @@ build_dhcpv4_action(struct ovn_port *op, ovs_be32 offer_ip,
         return false;
     }
 
-    struct smap dhcpv4_options = SMAP_INITIALIZER(&dhcpv4_options);
-    smap_clone(&dhcpv4_options, &op->nbsp->dhcpv4_options->options);
-
-    /* server_mac is not DHCPv4 option, delete it from the smap. */
-    smap_remove(&dhcpv4_options, "server_mac");
-    char *netmask = xasprintf(IP_FMT, IP_ARGS(mask));
-    smap_add(&dhcpv4_options, "netmask", netmask);
-    free(netmask);
-
     ds_put_format(options_action,
                   REGBIT_DHCP_OPTS_RESULT" = put_dhcp_opts(offerip = "
                   IP_FMT", ", IP_ARGS(offer_ip));
+    ds_put_cstr(options_action, template->opts);
 
     /* Try to get hostname DHCP option from ovn_port as it can be passed there
      * instead of DHCP_Options set. Logical_Switch_Port options:hostname takes
      precedence over DHCP_Options options:hostname. */
     const char *hostname = smap_get(&op->nbsp->options, "hostname");
-    if (hostname) {
-        smap_replace(&dhcpv4_options, "hostname", hostname);
+    if (!hostname) {
+        hostname = template->hostname;
     }
-
-    /* We're not using SMAP_FOR_EACH because we want a consistent order of the
-     * options on different architectures (big or little endian, SSE4.2) */
-    const struct smap_node **sorted_opts = smap_sort(&dhcpv4_options);
-    for (size_t i = 0; i < smap_count(&dhcpv4_options); i++) {
-        const struct smap_node *node = sorted_opts[i];
-        ds_put_format(options_action, "%s = %s, ", node->key, node->value);
+    if (hostname) {
+        ds_put_format(options_action, "hostname = %s, ", hostname);
     }
-    free(sorted_opts);
+    ds_put_cstr(options_action, template->opts_after_hostname);
 
     ds_chomp(options_action, ' ');
     ds_chomp(options_action, ',');
     ds_put_cstr(options_action, "); next;");
 
-    ds_put_format(response_action, "eth.dst = eth.src; eth.src = %s; "
-                  "ip4.src = %s; udp.src = 67; udp.dst = 68; "
-                  "outport = inport; flags.loopback = 1; output;",
-                  server_mac, server_ip);
+    ds_put_cstr(response_action, template->response_action);
 
     ds_put_format(ipv4_addr_match,
                   "ip4.src == "IP_FMT" && ip4.dst == {%s, 255.255.255.255}",
-                  IP_ARGS(offer_ip), server_ip);
-    smap_destroy(&dhcpv4_options);
+                  IP_ARGS(offer_ip), template->server_ip);
     return true;
 }
 
 static bool
 build_dhcpv6_action(struct ovn_port *op, struct in6_addr *offer_ip,
+                    const struct hmap *dhcp_opts_templates,
                     struct ds *options_action, struct ds *response_action)
 {
     if (!op->nbsp->dhcpv6_options) {
@@ -5139,27 +5746,24 @@ build_dhcpv6_action(struct ovn_port *op, struct in6_addr *offer_ip,
         return false;
     }
 
-    struct in6_addr host_ip, mask;
+    const struct dhcp_opts_template *template
+        = dhcp_opts_template_find(dhcp_opts_templates,
+                                  op->nbsp->dhcpv6_options, true);
+    ovs_assert(template);
 
-    char *error = ipv6_parse_masked(op->nbsp->dhcpv6_options->cidr, &host_ip,
-                                        &mask);
-    if (error) {
-        free(error);
+    if (!template->cidr_ok) {
         return false;
     }
-    struct in6_addr ip6_mask = ipv6_addr_bitxor(offer_ip, &host_ip);
-    ip6_mask = ipv6_addr_bitand(&ip6_mask, &mask);
+    struct in6_addr ip6_mask = ipv6_addr_bitxor(offer_ip,
+                                                &template->host_ip6);
+    ip6_mask = ipv6_addr_bitand(&ip6_mask, &template->mask6);
     if (!ipv6_mask_is_any(&ip6_mask)) {
         /* offer_ip doesn't belongs to the cidr defined in lport's DHCPv6
          * options.*/
         return false;
     }
 
-    const struct smap *options_map = &op->nbsp->dhcpv6_options->options;
-    /* "server_id" should be the MAC address. */
-    const char *server_mac = smap_get(options_map, "server_id");
-    struct eth_addr ea;
-    if (!server_mac || !eth_addr_from_string(server_mac, &ea)) {
+    if (!template->opts_ok) {
         /* "server_id" should be present in the dhcpv6_options. */
         static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
         VLOG_WARN_RL(&rl, "server_id not present in the DHCPv6 options"
@@ -5167,47 +5771,21 @@ build_dhcpv6_action(struct ovn_port *op, struct in6_addr *offer_ip,
         return false;
     }
 
-    /* Get the link local IP of the DHCPv6 server from the server MAC. */
-    struct in6_addr lla;
-    in6_generate_lla(ea, &lla);
-
-    char server_ip[INET6_ADDRSTRLEN + 1];
-    ipv6_string_mapped(server_ip, &lla);
-
-    char ia_addr[INET6_ADDRSTRLEN + 1];
-    ipv6_string_mapped(ia_addr, offer_ip);
-
-    ds_put_format(options_action,
-                  REGBIT_DHCP_OPTS_RESULT" = put_dhcpv6_opts(");
+    ds_put_cstr(options_action,
+                REGBIT_DHCP_OPTS_RESULT" = put_dhcpv6_opts(");
 
-    /* Check whether the dhcpv6 options should be configured as stateful.
-     * Only reply with ia_addr option for dhcpv6 stateful address mode. */
-    if (!smap_get_bool(options_map, "dhcpv6_stateless", false)) {
+    if (template->stateful) {
+        char ia_addr[INET6_ADDRSTRLEN + 1];
         ipv6_string_mapped(ia_addr, offer_ip);
         ds_put_format(options_action, "ia_addr = %s, ", ia_addr);
     }
-
-    /* We're not using SMAP_FOR_EACH because we want a consistent order of the
-     * options on different architectures (big or little endian, SSE4.2) */
-    const struct smap_node **sorted_opts = smap_sort(options_map);
-    for (size_t i = 0; i < smap_count(options_map); i++) {
-        const struct smap_node *node = sorted_opts[i];
-        if (strcmp(node->key, "dhcpv6_stateless")) {
-            ds_put_format(options_action, "%s = %s, ", node->key, node->value);
-        }
-    }
-    free(sorted_opts);
+    ds_put_cstr(options_action, template->opts);
 
     ds_chomp(options_action, ' ');
     ds_chomp(options_action, ',');
     ds_put_cstr(options_action, "); next;");
 
-    ds_put_format(response_action, "eth.dst = eth.src; eth.src = %s; "
-                  "ip6.dst = ip6.src; ip6.src = %s; udp.src = 547; "
-                  "udp.dst = 546; outport = inport; flags.loopback = 1; "
-                  "output;",
-                  server_mac, server_ip);
-
+    ds_put_cstr(response_action, template->response_action);
     return true;
 }
 
@@ -5936,11 +6514,28 @@ alloc_acl_log_unique_meter_name(const struct nbrec_acl *acl)
                      acl->meter, UUID_ARGS(&acl->header_.uuid));
 }
 
+/* Returns the name of the private meter that rate limits the log of 'acl'
+ * if it doesn't have a meter of its own, or NULL if it doesn't need one.
+ * The caller must free the returned name. */
+static char *
+alloc_acl_log_default_meter_name(const struct nbrec_acl *acl)
+{
+    if (!acl->log || acl->meter || !acl_log_rate_limit) {
+        return NULL;
+    }
+    return xasprintf("__acl_log__" UUID_FMT, UUID_ARGS(&acl->header_.uuid));
+}
+
 static void
 build_acl_log_meter(struct ds *actions, const struct nbrec_acl *acl,
                     const struct shash *meter_groups)
 {
     if (!acl->meter) {
+        char *meter_name = alloc_acl_log_default_meter_name(acl);
+        if (meter_name) {
+            ds_put_format(actions, "meter=\"%s\", ", meter_name);
+            free(meter_name);
+        }
         return;
     }
 
@@ -5992,11 +6587,67 @@ build_acl_log(struct ds *actions, const struct nbrec_acl *acl,
     ds_put_cstr(actions, "); ");
 }
 
+/* A logical flow generated for an ACL.  It only depends on the ACL and on
+ * whether the logical switch has stateful ACLs or load balancers, so it is
+ * built once and added to every logical switch that the ACL applies to. */
+struct acl_lflow {
+    enum ovn_stage stage;
+    uint16_t priority;
+    char *match;
+    char *actions;
+    bool reject;        /* Uses the COPP_REJECT meter of the datapath. */
+    uint32_t hash;
+    const char *where;
+};
+
+/* The logical flows of an ACL for the logical switches that don't have
+ * ('variants[0]') or that have ('variants[1]') stateful ACLs or load
+ * balancers, see build_acl_templates(). */
+struct acl_template {
+    struct hmap_node hmap_node;     /* In the templates, by ACL uuid. */
+    const struct nbrec_acl *acl;
+    struct acl_lflows {
+        struct acl_lflow *flows;
+        size_t n_flows;
+        size_t allocated_flows;
+        bool built;
+    } variants[2];
+};
+
+static void
+acl_lflows_add_at(struct acl_lflows *lflows, enum ovn_stage stage,
+                  uint16_t priority, const char *match, const char *actions,
+                  bool reject, const char *where)
+{
+    if (lflows->n_flows == lflows->allocated_flows) {
+        lflows->flows = x2nrealloc(lflows->flows, &lflows->allocated_flows,
+                                   sizeof *lflows->flows);
+    }
+
+    struct acl_lflow *flow = &lflows->flows[lflows->n_flows++];
+    flow->stage = stage;
+    flow->priority = priority;
+    flow->match = xstrdup(match);
+    flow->actions = xstrdup(actions);
+    flow->reject = reject;
+    flow->hash = ovn_logical_flow_hash(ovn_stage_get_table(stage),
+                                       ovn_stage_get_pipeline(stage),
+                                       priority, match, actions);
+    flow->where = where;
+}
+
+#define acl_lflows_add(LFLOWS, STAGE, PRIORITY, MATCH, ACTIONS) \
+    acl_lflows_add_at(LFLOWS, STAGE, PRIORITY, MATCH, ACTIONS, false, \
+                      OVS_SOURCE_LOCATOR)
+
+#define acl_lflows_add_reject(LFLOWS, STAGE, PRIORITY, MATCH, ACTIONS) \
+    acl_lflows_add_at(LFLOWS, STAGE, PRIORITY, MATCH, ACTIONS, true, \
+                      OVS_SOURCE_LOCATOR)
+
 static void
-build_reject_acl_rules(struct ovn_datapath *od, struct hmap *lflows,
-                       enum ovn_stage stage, struct nbrec_acl *acl,
-                       struct ds *extra_match, struct ds *extra_actions,
-                       const struct ovsdb_idl_row *stage_hint,
+build_reject_acl_rules(struct acl_lflows *lflows, enum ovn_stage stage,
+                       const struct nbrec_acl *acl, struct ds *extra_match,
+                       struct ds *extra_actions,
                        const struct shash *meter_groups)
 {
     struct ds match = DS_EMPTY_INITIALIZER;
@@ -6023,23 +6674,20 @@ build_reject_acl_rules(struct ovn_datapath *od, struct hmap *lflows,
                   "reject { "
                   "/* eth.dst <-> eth.src; ip.dst <-> ip.src; is implicit. */ "
                   "outport <-> inport; %s };", next_action);
-    ovn_lflow_add_with_hint__(lflows, od, stage,
-                              acl->priority + OVN_ACL_PRI_OFFSET,
-                              ds_cstr(&match), ds_cstr(&actions), NULL,
-                              copp_meter_get(COPP_REJECT, od->nbs->copp,
-                                             meter_groups),
-                              stage_hint);
+    acl_lflows_add_reject(lflows, stage, acl->priority + OVN_ACL_PRI_OFFSET,
+                          ds_cstr(&match), ds_cstr(&actions));
 
     free(next_action);
     ds_destroy(&match);
     ds_destroy(&actions);
 }
 
+/* Builds the logical flows of 'acl' into 'lflows', for logical switches that
+ * have stateful ACLs or load balancers if 'has_stateful' is true. */
 static void
-consider_acl(struct hmap *lflows, struct ovn_datapath *od,
-             struct nbrec_acl *acl, bool has_stateful,
-             const struct shash *meter_groups, struct ds *match,
-             struct ds *actions)
+consider_acl(struct acl_lflows *lflows, const struct nbrec_acl *acl,
+             bool has_stateful, const struct shash *meter_groups,
+             struct ds *match, struct ds *actions)
 {
     bool ingress = !strcmp(acl->direction, "from-lport") ? true :false;
     enum ovn_stage stage;
@@ -6056,10 +6704,8 @@ consider_acl(struct hmap *lflows, struct ovn_datapath *od,
         ds_clear(actions);
         build_acl_log(actions, acl, meter_groups);
         ds_put_cstr(actions, "next;");
-        ovn_lflow_add_with_hint(lflows, od, stage,
-                                acl->priority + OVN_ACL_PRI_OFFSET,
-                                acl->match, ds_cstr(actions),
-                                &acl->header_);
+        acl_lflows_add(lflows, stage, acl->priority + OVN_ACL_PRI_OFFSET,
+                       acl->match, ds_cstr(actions));
     } else if (!strcmp(acl->action, "allow")
         || !strcmp(acl->action, "allow-related")) {
         /* If there are any stateful flows, we must even commit "allow"
@@ -6071,10 +6717,8 @@ consider_acl(struct hmap *lflows, struct ovn_datapath *od,
             ds_clear(actions);
             build_acl_log(actions, acl, meter_groups);
             ds_put_cstr(actions, "next;");
-            ovn_lflow_add_with_hint(lflows, od, stage,
-                                    acl->priority + OVN_ACL_PRI_OFFSET,
-                                    acl->match, ds_cstr(actions),
-                                    &acl->header_);
+            acl_lflows_add(lflows, stage, acl->priority + OVN_ACL_PRI_OFFSET,
+                           acl->match, ds_cstr(actions));
         } else {
             /* Commit the connection tracking entry if it's a new
              * connection that matches this ACL.  After this commit,
@@ -6100,11 +6744,8 @@ consider_acl(struct hmap *lflows, struct ovn_datapath *od,
             }
             build_acl_log(actions, acl, meter_groups);
             ds_put_cstr(actions, "next;");
-            ovn_lflow_add_with_hint(lflows, od, stage,
-                                    acl->priority + OVN_ACL_PRI_OFFSET,
-                                    ds_cstr(match),
-                                    ds_cstr(actions),
-                                    &acl->header_);
+            acl_lflows_add(lflows, stage, acl->priority + OVN_ACL_PRI_OFFSET,
+                           ds_cstr(match), ds_cstr(actions));
 
             /* Match on traffic in the request direction for an established
              * connection tracking entry that has not been marked for
@@ -6125,10 +6766,8 @@ consider_acl(struct hmap *lflows, struct ovn_datapath *od,
             }
             build_acl_log(actions, acl, meter_groups);
             ds_put_cstr(actions, "next;");
-            ovn_lflow_add_with_hint(lflows, od, stage,
-                                    acl->priority + OVN_ACL_PRI_OFFSET,
-                                    ds_cstr(match), ds_cstr(actions),
-                                    &acl->header_);
+            acl_lflows_add(lflows, stage, acl->priority + OVN_ACL_PRI_OFFSET,
+                           ds_cstr(match), ds_cstr(actions));
 
             /* Related and reply traffic are universally allowed by priority
              * 65532 flows created in build_acls(). If logging is enabled on
@@ -6161,10 +6800,8 @@ consider_acl(struct hmap *lflows, struct ovn_datapath *od,
                               acl->label);
                 build_acl_log(actions, acl, meter_groups);
                 ds_put_cstr(actions, "next;");
-                ovn_lflow_add_with_hint(lflows, od, log_related_stage,
-                                        UINT16_MAX - 2,
-                                        ds_cstr(match), ds_cstr(actions),
-                                        &acl->header_);
+                acl_lflows_add(lflows, log_related_stage, UINT16_MAX - 2,
+                               ds_cstr(match), ds_cstr(actions));
 
                 ds_clear(match);
                 ds_put_format(match, "!ct.est && ct.rel && !ct.new%s && "
@@ -6172,10 +6809,8 @@ consider_acl(struct hmap *lflows, struct ovn_datapath *od,
                                      "ct_label.label == %" PRId64,
                                      use_ct_inv_match ? " && !ct.inv" : "",
                                      acl->label);
-                ovn_lflow_add_with_hint(lflows, od, log_related_stage,
-                                        UINT16_MAX - 2,
-                                        ds_cstr(match), ds_cstr(actions),
-                                        &acl->header_);
+                acl_lflows_add(lflows, log_related_stage, UINT16_MAX - 2,
+                               ds_cstr(match), ds_cstr(actions));
             }
 
         }
@@ -6192,16 +6827,15 @@ consider_acl(struct hmap *lflows, struct ovn_datapath *od,
             ds_clear(actions);
             ds_put_cstr(match, REGBIT_ACL_HINT_DROP " == 1");
             if (!strcmp(acl->action, "reject")) {
-                build_reject_acl_rules(od, lflows, stage, acl, match,
-                                       actions, &acl->header_, meter_groups);
+                build_reject_acl_rules(lflows, stage, acl, match, actions,
+                                       meter_groups);
             } else {
                 ds_put_format(match, " && (%s)", acl->match);
                 build_acl_log(actions, acl, meter_groups);
                 ds_put_cstr(actions, "/* drop */");
-                ovn_lflow_add_with_hint(lflows, od, stage,
-                                        acl->priority + OVN_ACL_PRI_OFFSET,
-                                        ds_cstr(match), ds_cstr(actions),
-                                        &acl->header_);
+                acl_lflows_add(lflows, stage,
+                               acl->priority + OVN_ACL_PRI_OFFSET,
+                               ds_cstr(match), ds_cstr(actions));
             }
             /* For an existing connection without ct_mark.blocked set, we've
              * encountered a policy change. ACLs previously allowed
@@ -6219,16 +6853,15 @@ consider_acl(struct hmap *lflows, struct ovn_datapath *od,
             ds_put_cstr(match, REGBIT_ACL_HINT_BLOCK " == 1");
             ds_put_cstr(actions, "ct_commit { ct_mark.blocked = 1; }; ");
             if (!strcmp(acl->action, "reject")) {
-                build_reject_acl_rules(od, lflows, stage, acl, match,
-                                       actions, &acl->header_, meter_groups);
+                build_reject_acl_rules(lflows, stage, acl, match, actions,
+                                       meter_groups);
             } else {
                 ds_put_format(match, " && (%s)", acl->match);
                 build_acl_log(actions, acl, meter_groups);
                 ds_put_cstr(actions, "/* drop */");
-                ovn_lflow_add_with_hint(lflows, od, stage,
-                                        acl->priority + OVN_ACL_PRI_OFFSET,
-                                        ds_cstr(match), ds_cstr(actions),
-                                        &acl->header_);
+                acl_lflows_add(lflows, stage,
+                               acl->priority + OVN_ACL_PRI_OFFSET,
+                               ds_cstr(match), ds_cstr(actions));
             }
         } else {
             /* There are no stateful ACLs in use on this datapath,
@@ -6237,20 +6870,142 @@ consider_acl(struct hmap *lflows, struct ovn_datapath *od,
             ds_clear(match);
             ds_clear(actions);
             if (!strcmp(acl->action, "reject")) {
-                build_reject_acl_rules(od, lflows, stage, acl, match,
-                                       actions, &acl->header_, meter_groups);
+                build_reject_acl_rules(lflows, stage, acl, match, actions,
+                                       meter_groups);
             } else {
                 build_acl_log(actions, acl, meter_groups);
                 ds_put_cstr(actions, "/* drop */");
-                ovn_lflow_add_with_hint(lflows, od, stage,
-                                        acl->priority + OVN_ACL_PRI_OFFSET,
-                                        acl->match, ds_cstr(actions),
-                                        &acl->header_);
+                acl_lflows_add(lflows, stage,
+                               acl->priority + OVN_ACL_PRI_OFFSET, acl->match,
+                               ds_cstr(actions));
             }
         }
     }
 }
 
+static void
+acl_lflows_destroy(struct acl_lflows *lflows)
+{
+    for (size_t i = 0; i < lflows->n_flows; i++) {
+        free(lflows->flows[i].match);
+        free(lflows->flows[i].actions);
+    }
+    free(lflows->flows);
+}
+
+static struct acl_template *
+acl_template_find(const struct hmap *acl_templates,
+                  const struct nbrec_acl *acl)
+{
+    struct acl_template *template;
+    HMAP_FOR_EACH_WITH_HASH (template, hmap_node,
+                             uuid_hash(&acl->header_.uuid), acl_templates) {
+        if (template->acl == acl) {
+            return template;
+        }
+    }
+    return NULL;
+}
+
+/* Builds, if not done yet, the logical flows of 'acl' for logical switches
+ * with ('has_stateful' true) or without stateful ACLs or load balancers. */
+static void
+acl_template_build(struct hmap *acl_templates, const struct nbrec_acl *acl,
+                   bool has_stateful, const struct shash *meter_groups,
+                   struct ds *match, struct ds *actions)
+{
+    struct acl_template *template = acl_template_find(acl_templates, acl);
+    if (!template) {
+        template = xzalloc(sizeof *template);
+        template->acl = acl;
+        hmap_insert(acl_templates, &template->hmap_node,
+                    uuid_hash(&acl->header_.uuid));
+    }
+
+    struct acl_lflows *lflows = &template->variants[has_stateful];
+    if (!lflows->built) {
+        consider_acl(lflows, acl, has_stateful, meter_groups, match, actions);
+        lflows->built = true;
+    }
+}
+
+/* Computes the ACL flags of every logical switch and builds the logical flows
+ * of each ACL in use once, so that build_acls() only has to add them to the
+ * logical switches.  Must be called before the logical switch flows are
+ * built, possibly in parallel. */
+static void
+build_acl_templates(const struct hmap *datapaths,
+                    const struct shash *meter_groups,
+                    struct hmap *acl_templates)
+{
+    struct ds match = DS_EMPTY_INITIALIZER;
+    struct ds actions = DS_EMPTY_INITIALIZER;
+    struct ovn_datapath *od;
+
+    HMAP_FOR_EACH (od, key_node, datapaths) {
+        if (!od->nbs) {
+            continue;
+        }
+
+        ls_get_acl_flags(od);
+        bool has_stateful = od->has_stateful_acl || od->has_lb_vip;
+
+        for (size_t i = 0; i < od->nbs->n_acls; i++) {
+            acl_template_build(acl_templates, od->nbs->acls[i], has_stateful,
+                               meter_groups, &match, &actions);
+        }
+
+        struct ovn_ls_port_group *ls_pg;
+        HMAP_FOR_EACH (ls_pg, key_node, &od->nb_pgs) {
+            for (size_t i = 0; i < ls_pg->nb_pg->n_acls; i++) {
+                acl_template_build(acl_templates, ls_pg->nb_pg->acls[i],
+                                   has_stateful, meter_groups,
+                                   &match, &actions);
+            }
+        }
+    }
+
+    ds_destroy(&match);
+    ds_destroy(&actions);
+}
+
+static void
+destroy_acl_templates(struct hmap *acl_templates)
+{
+    struct acl_template *template;
+    HMAP_FOR_EACH_POP (template, hmap_node, acl_templates) {
+        acl_lflows_destroy(&template->variants[0]);
+        acl_lflows_destroy(&template->variants[1]);
+        free(template);
+    }
+    hmap_destroy(acl_templates);
+}
+
+/* Adds the logical flows of 'acl' to logical switch 'od'. */
+static void
+build_acl_for_datapath(struct ovn_datapath *od, struct hmap *lflows,
+                       const struct nbrec_acl *acl, bool has_stateful,
+                       const struct hmap *acl_templates,
+                       const struct shash *meter_groups)
+{
+    const struct acl_template *template
+        = acl_template_find(acl_templates, acl);
+    ovs_assert(template && template->variants[has_stateful].built);
+
+    const struct acl_lflows *acl_lflows = &template->variants[has_stateful];
+    for (size_t i = 0; i < acl_lflows->n_flows; i++) {
+        const struct acl_lflow *f = &acl_lflows->flows[i];
+        const char *ctrl_meter = NULL;
+        if (f->reject) {
+            ctrl_meter = copp_meter_get(COPP_REJECT, od->nbs->copp,
+                                        meter_groups);
+        }
+        ovn_lflow_add_at_with_hash(lflows, od, f->stage, f->priority,
+                                   f->match, f->actions, NULL, ctrl_meter,
+                                   &acl->header_, f->where, f->hash);
+    }
+}
+
 static struct ovn_port_group *
 ovn_port_group_create(struct hmap *pgs,
                       const struct nbrec_port_group *nb_pg)
@@ -6386,7 +7141,8 @@ build_port_group_lswitches(struct northd_input *input_data,
 
 static void
 build_acls(struct ovn_datapath *od, struct hmap *lflows,
-           const struct hmap *port_groups, const struct shash *meter_groups)
+           const struct hmap *port_groups, const struct hmap *acl_templates,
+           const struct shash *meter_groups)
 {
     const char *default_acl_action = default_acl_drop ? "drop;" : "next;";
     bool has_stateful = od->has_stateful_acl || od->has_lb_vip;
@@ -6524,16 +7280,16 @@ build_acls(struct ovn_datapath *od, struct hmap *lflows,
 
     /* Ingress or Egress ACL Table (Various priorities). */
     for (size_t i = 0; i < od->nbs->n_acls; i++) {
-        struct nbrec_acl *acl = od->nbs->acls[i];
-        consider_acl(lflows, od, acl, has_stateful, meter_groups, &match,
-                     &actions);
+        build_acl_for_datapath(od, lflows, od->nbs->acls[i], has_stateful,
+                               acl_templates, meter_groups);
     }
     struct ovn_port_group *pg;
     HMAP_FOR_EACH (pg, key_node, port_groups) {
         if (ovn_port_group_ls_find(pg, &od->nbs->header_.uuid)) {
             for (size_t i = 0; i < pg->nb_pg->n_acls; i++) {
-                consider_acl(lflows, od, pg->nb_pg->acls[i], has_stateful,
-                             meter_groups, &match, &actions);
+                build_acl_for_datapath(od, lflows, pg->nb_pg->acls[i],
+                                       has_stateful, acl_templates,
+                                       meter_groups);
             }
         }
     }
@@ -6972,66 +7728,25 @@ build_fwd_group_lflows(struct ovn_datapath *od, struct hmap *lflows)
     }
 }
 
-static void
-build_lrouter_groups__(struct hmap *ports, struct ovn_datapath *od)
+/* Returns the representative of the set of the datapath with 'index' in the
+ * union-find forest 'parents', halving the path on the way. */
+static size_t
+lrouter_groups_find(size_t *parents, size_t index)
 {
-    ovs_assert((od && od->nbr && od->lr_group));
-
-    /* For logical router with distributed gateway ports. If it
-     * has HA_Chassis_Group associated to it in SB DB, then store the
-     * ha chassis group name. */
-    for (size_t i = 0; i < od->n_l3dgw_ports; i++) {
-        struct ovn_port *crp = od->l3dgw_ports[i]->cr_port;
-        if (crp->sb->ha_chassis_group &&
-            crp->sb->ha_chassis_group->n_ha_chassis > 1) {
-            sset_add(&od->lr_group->ha_chassis_groups,
-                     crp->sb->ha_chassis_group->name);
-        }
+    while (parents[index] != index) {
+        parents[index] = parents[parents[index]];
+        index = parents[index];
     }
+    return index;
+}
 
-    for (size_t i = 0; i < od->nbr->n_ports; i++) {
-        struct ovn_port *router_port =
-            ovn_port_find(ports, od->nbr->ports[i]->name);
-
-        if (!router_port || !router_port->peer) {
-            continue;
-        }
-
-        /* Get the peer logical switch/logical router datapath. */
-        struct ovn_datapath *peer_dp = router_port->peer->od;
-        if (peer_dp->nbr) {
-            if (!peer_dp->lr_group) {
-                peer_dp->lr_group = od->lr_group;
-                od->lr_group->router_dps[od->lr_group->n_router_dps++]
-                    = peer_dp;
-                build_lrouter_groups__(ports, peer_dp);
-            }
-        } else {
-            for (size_t j = 0; j < peer_dp->n_router_ports; j++) {
-                if (!peer_dp->router_ports[j]->peer) {
-                    /* If there is no peer port connecting to the
-                    * router port, ignore it. */
-                    continue;
-                }
-
-                struct ovn_datapath *router_dp;
-                router_dp = peer_dp->router_ports[j]->peer->od;
-                if (router_dp == od) {
-                    continue;
-                }
-
-                if (router_dp->lr_group == od->lr_group) {
-                    /* 'router_dp' and 'od' already belong to the same
-                    * lrouter group. Nothing to be done. */
-                    continue;
-                }
-
-                router_dp->lr_group = od->lr_group;
-                od->lr_group->router_dps[od->lr_group->n_router_dps++]
-                    = router_dp;
-                build_lrouter_groups__(ports, router_dp);
-            }
-        }
+static void
+lrouter_groups_union(size_t *parents, size_t a, size_t b)
+{
+    a = lrouter_groups_find(parents, a);
+    b = lrouter_groups_find(parents, b);
+    if (a != b) {
+        parents[MAX(a, b)] = MIN(a, b);
     }
 }
 
@@ -7059,21 +7774,64 @@ build_lrouter_groups__(struct hmap *ports, struct ovn_datapath *od)
 static void
 build_lrouter_groups(struct hmap *ports, struct ovs_list *lr_list)
 {
+    /* Join each router with the datapaths, routers or switches, that its
+     * ports are connected to.  The routers of a group then end up in the same
+     * set, without walking the router ports of a switch once per router
+     * connected to it. */
+    size_t *parents = xmalloc(n_datapaths * sizeof *parents);
+    for (size_t i = 0; i < n_datapaths; i++) {
+        parents[i] = i;
+    }
+
     struct ovn_datapath *od;
-    size_t n_router_dps = ovs_list_size(lr_list);
+    LIST_FOR_EACH (od, lr_list, lr_list) {
+        for (size_t i = 0; i < od->nbr->n_ports; i++) {
+            struct ovn_port *router_port =
+                ovn_port_find(ports, od->nbr->ports[i]->name);
+
+            if (router_port && router_port->peer) {
+                lrouter_groups_union(parents, od->index,
+                                     router_port->peer->od->index);
+            }
+        }
+    }
+
+    /* Allocate each group for the exact number of its routers. */
+    size_t *n_router_dps = xcalloc(n_datapaths, sizeof *n_router_dps);
+    LIST_FOR_EACH (od, lr_list, lr_list) {
+        n_router_dps[lrouter_groups_find(parents, od->index)]++;
+    }
 
+    struct lrouter_group **lr_groups = xcalloc(n_datapaths,
+                                               sizeof *lr_groups);
     LIST_FOR_EACH (od, lr_list, lr_list) {
-        if (!od->lr_group) {
-            od->lr_group = xzalloc(sizeof *od->lr_group);
-            /* Each logical router group can have max
-             * 'n_router_dps'. So allocate enough memory. */
-            od->lr_group->router_dps = xcalloc(sizeof *od, n_router_dps);
-            od->lr_group->router_dps[0] = od;
-            od->lr_group->n_router_dps = 1;
-            sset_init(&od->lr_group->ha_chassis_groups);
-            build_lrouter_groups__(ports, od);
+        size_t root = lrouter_groups_find(parents, od->index);
+        struct lrouter_group *lr_group = lr_groups[root];
+        if (!lr_group) {
+            lr_group = lr_groups[root] = xzalloc(sizeof *lr_group);
+            lr_group->router_dps = xcalloc(n_router_dps[root],
+                                           sizeof *lr_group->router_dps);
+            sset_init(&lr_group->ha_chassis_groups);
+        }
+        lr_group->router_dps[lr_group->n_router_dps++] = od;
+        od->lr_group = lr_group;
+
+        /* For logical router with distributed gateway ports. If it
+         * has HA_Chassis_Group associated to it in SB DB, then store the
+         * ha chassis group name. */
+        for (size_t i = 0; i < od->n_l3dgw_ports; i++) {
+            struct ovn_port *crp = od->l3dgw_ports[i]->cr_port;
+            if (crp->sb->ha_chassis_group &&
+                crp->sb->ha_chassis_group->n_ha_chassis > 1) {
+                sset_add(&lr_group->ha_chassis_groups,
+                         crp->sb->ha_chassis_group->name);
+            }
         }
     }
+
+    free(lr_groups);
+    free(n_router_dps);
+    free(parents);
 }
 
 /*
@@ -7226,6 +7984,38 @@ build_lswitch_rport_arp_req_flow(const char *ips,
     ds_destroy(&actions);
 }
 
+/* Same as build_lswitch_rport_arp_req_flow() for all the addresses in 'ips',
+ * which are of the same 'addr_family', with a single flow. */
+static void
+build_lswitch_rport_arp_req_ips_flow(const struct sset *ips,
+    int addr_family, struct ovn_port *patch_op, struct ovn_datapath *od,
+    uint32_t priority, struct hmap *lflows,
+    const struct ovsdb_idl_row *stage_hint)
+{
+    size_t n_ips = sset_count(ips);
+    if (!n_ips) {
+        return;
+    }
+
+    /* Sorted, so that the match doesn't change from one run to the next. */
+    const char **sorted_ips = sset_sort(ips);
+    struct ds ips_s = DS_EMPTY_INITIALIZER;
+    if (n_ips == 1) {
+        ds_put_cstr(&ips_s, sorted_ips[0]);
+    } else {
+        ds_put_char(&ips_s, '{');
+        for (size_t i = 0; i < n_ips; i++) {
+            ds_put_format(&ips_s, "%s%s", i ? ", " : "", sorted_ips[i]);
+        }
+        ds_put_char(&ips_s, '}');
+    }
+    free(sorted_ips);
+
+    build_lswitch_rport_arp_req_flow(ds_cstr(&ips_s), addr_family, patch_op,
+                                     od, priority, lflows, stage_hint);
+    ds_destroy(&ips_s);
+}
+
 /*
  * Ingress table 24: Flows that forward ARP/ND requests only to the routers
  * that own the addresses.
@@ -7249,9 +8039,13 @@ build_lswitch_rport_arp_req_flows(struct ovn_port *op,
     }
 
     /* Forward ARP requests for owned IP addresses (L3, VIP, NAT) only to this
-     * router port.
+     * router port.  All the addresses of a family are matched by a single
+     * flow, so that the number of flows on the switch doesn't grow with the
+     * number of addresses of the routers attached to it.
      * Priority: 80.
      */
+    struct sset ips_v4 = SSET_INITIALIZER(&ips_v4);
+    struct sset ips_v6 = SSET_INITIALIZER(&ips_v6);
 
     const char *ip_addr;
     SSET_FOR_EACH (ip_addr, &op->od->lb_ips_v4) {
@@ -7262,9 +8056,7 @@ build_lswitch_rport_arp_req_flows(struct ovn_port *op,
          */
         if (ip_parse(ip_addr, &ipv4_addr) &&
             lrouter_port_ipv4_reachable(op, ipv4_addr)) {
-            build_lswitch_rport_arp_req_flow(
-                ip_addr, AF_INET, sw_op, sw_od, 80, lflows,
-                stage_hint);
+            sset_add(&ips_v4, ip_addr);
         }
     }
     SSET_FOR_EACH (ip_addr, &op->od->lb_ips_v6) {
@@ -7275,9 +8067,7 @@ build_lswitch_rport_arp_req_flows(struct ovn_port *op,
          */
         if (ipv6_parse(ip_addr, &ipv6_addr) &&
             lrouter_port_ipv6_reachable(op, &ipv6_addr)) {
-            build_lswitch_rport_arp_req_flow(
-                ip_addr, AF_INET6, sw_op, sw_od, 80, lflows,
-                stage_hint);
+            sset_add(&ips_v6, ip_addr);
         }
     }
 
@@ -7298,30 +8088,29 @@ build_lswitch_rport_arp_req_flows(struct ovn_port *op,
          */
         if (nat_entry_is_v6(nat_entry)) {
             if (!sset_contains(&op->od->lb_ips_v6, nat->external_ip)) {
-                build_lswitch_rport_arp_req_flow(
-                    nat->external_ip, AF_INET6, sw_op, sw_od, 80, lflows,
-                    stage_hint);
+                sset_add(&ips_v6, nat->external_ip);
             }
         } else {
             if (!sset_contains(&op->od->lb_ips_v4, nat->external_ip)) {
-                build_lswitch_rport_arp_req_flow(
-                    nat->external_ip, AF_INET, sw_op, sw_od, 80, lflows,
-                    stage_hint);
+                sset_add(&ips_v4, nat->external_ip);
             }
         }
     }
 
     for (size_t i = 0; i < op->lrp_networks.n_ipv4_addrs; i++) {
-        build_lswitch_rport_arp_req_flow(
-            op->lrp_networks.ipv4_addrs[i].addr_s, AF_INET, sw_op, sw_od, 80,
-            lflows, stage_hint);
+        sset_add(&ips_v4, op->lrp_networks.ipv4_addrs[i].addr_s);
     }
     for (size_t i = 0; i < op->lrp_networks.n_ipv6_addrs; i++) {
-        build_lswitch_rport_arp_req_flow(
-            op->lrp_networks.ipv6_addrs[i].addr_s, AF_INET6, sw_op, sw_od, 80,
-            lflows, stage_hint);
+        sset_add(&ips_v6, op->lrp_networks.ipv6_addrs[i].addr_s);
     }
 
+    build_lswitch_rport_arp_req_ips_flow(&ips_v4, AF_INET, sw_op, sw_od, 80,
+                                         lflows, stage_hint);
+    build_lswitch_rport_arp_req_ips_flow(&ips_v6, AF_INET6, sw_op, sw_od, 80,
+                                         lflows, stage_hint);
+    sset_destroy(&ips_v4);
+    sset_destroy(&ips_v6);
+
     /* Self originated ARP requests/ND need to be flooded as usual.
      *
      * However, if the switch doesn't have any non-router ports we shouldn't
@@ -7338,6 +8127,7 @@ static void
 build_dhcpv4_options_flows(struct ovn_port *op,
                            struct lport_addresses *lsp_addrs,
                            struct ovn_port *inport, bool is_external,
+                           const struct hmap *dhcp_opts_templates,
                            const struct shash *meter_groups,
                            struct hmap *lflows)
 {
@@ -7348,7 +8138,7 @@ build_dhcpv4_options_flows(struct ovn_port *op,
         struct ds response_action = DS_EMPTY_INITIALIZER;
         struct ds ipv4_addr_match = DS_EMPTY_INITIALIZER;
         if (build_dhcpv4_action(
-                op, lsp_addrs->ipv4_addrs[j].addr,
+                op, lsp_addrs->ipv4_addrs[j].addr, dhcp_opts_templates,
                 &options_action, &response_action, &ipv4_addr_match)) {
             ds_clear(&match);
             ds_put_format(
@@ -7431,6 +8221,7 @@ static void
 build_dhcpv6_options_flows(struct ovn_port *op,
                            struct lport_addresses *lsp_addrs,
                            struct ovn_port *inport, bool is_external,
+                           const struct hmap *dhcp_opts_templates,
                            const struct shash *meter_groups,
                            struct hmap *lflows)
 {
@@ -7440,7 +8231,7 @@ build_dhcpv6_options_flows(struct ovn_port *op,
         struct ds options_action = DS_EMPTY_INITIALIZER;
         struct ds response_action = DS_EMPTY_INITIALIZER;
         if (build_dhcpv6_action(
-                op, &lsp_addrs->ipv6_addrs[j].addr,
+                op, &lsp_addrs->ipv6_addrs[j].addr, dhcp_opts_templates,
                 &options_action, &response_action)) {
             ds_clear(&match);
             ds_put_format(
@@ -7583,17 +8374,16 @@ build_lswitch_flows(const struct hmap *datapaths,
 static void
 build_lswitch_lflows_pre_acl_and_acl(struct ovn_datapath *od,
                                      const struct hmap *port_groups,
+                                     const struct hmap *acl_templates,
                                      struct hmap *lflows,
                                      const struct shash *meter_groups)
 {
     if (od->nbs) {
-        ls_get_acl_flags(od);
-
         build_pre_acls(od, port_groups, lflows);
         build_pre_lb(od, meter_groups, lflows);
         build_pre_stateful(od, lflows);
         build_acl_hints(od, lflows);
-        build_acls(od, lflows, port_groups, meter_groups);
+        build_acls(od, lflows, port_groups, acl_templates, meter_groups);
         build_qos(od, lflows);
         build_stateful(od, lflows);
         build_lb_hairpin(od, lflows);
@@ -7649,6 +8439,101 @@ build_lswitch_arp_nd_responder_skip_local(struct ovn_port *op,
     }
 }
 
+/* Ingress table 18: ARP/ND responder, reply for all the known IPs of
+ * 'laddrs', an Ethernet address of 'op', with one flow for IPv4 and one for
+ * IPv6, see 'group_arp_nd_responder'.  The reply takes the address to reply
+ * for from the request.  (priority 50). */
+static void
+build_lswitch_arp_nd_responder_grouped(struct ovn_port *op,
+                                       const struct lport_addresses *laddrs,
+                                       struct hmap *lflows,
+                                       const struct shash *meter_groups,
+                                       struct ds *actions,
+                                       struct ds *match)
+{
+    if (laddrs->n_ipv4_addrs) {
+        ds_clear(match);
+        ds_put_cstr(match, "arp.tpa == {");
+        for (size_t j = 0; j < laddrs->n_ipv4_addrs; j++) {
+            ds_put_format(match, "%s, ", laddrs->ipv4_addrs[j].addr_s);
+        }
+        ds_chomp(match, ' ');
+        ds_chomp(match, ',');
+        ds_put_cstr(match, "} && arp.op == 1");
+
+        ds_clear(actions);
+        ds_put_format(actions,
+            "eth.dst = eth.src; "
+            "eth.src = %s; "
+            "arp.op = 2; /* ARP reply */ "
+            "arp.tha = arp.sha; "
+            "arp.sha = %s; "
+            "arp.tpa <-> arp.spa; "
+            "outport = inport; "
+            "flags.loopback = 1; "
+            "output;",
+            laddrs->ea_s, laddrs->ea_s);
+        ovn_lflow_add_with_hint(lflows, op->od, S_SWITCH_IN_ARP_ND_RSP, 50,
+                                ds_cstr(match), ds_cstr(actions),
+                                &op->nbsp->header_);
+
+        /* Do not reply to an ARP request from the port that owns the
+         * address, see build_lswitch_arp_nd_responder_known_ips(). */
+        ds_put_format(match, " && inport == %s", op->json_key);
+        ovn_lflow_add_with_lport_and_hint(lflows, op->od,
+                                          S_SWITCH_IN_ARP_ND_RSP, 100,
+                                          ds_cstr(match), "next;", op->key,
+                                          &op->nbsp->header_);
+    }
+
+    if (laddrs->n_ipv6_addrs) {
+        /* A solicitation sent to one of the addresses for another one of
+         * them gets a reply too, which is harmless since they all resolve
+         * to the same Ethernet address. */
+        struct ds targets = DS_EMPTY_INITIALIZER;
+        ds_clear(match);
+        ds_put_cstr(match, "nd_ns && ip6.dst == {");
+        for (size_t j = 0; j < laddrs->n_ipv6_addrs; j++) {
+            ds_put_format(match, "%s, %s, ", laddrs->ipv6_addrs[j].addr_s,
+                          laddrs->ipv6_addrs[j].sn_addr_s);
+            ds_put_format(&targets, "%s, ", laddrs->ipv6_addrs[j].addr_s);
+        }
+        ds_chomp(match, ' ');
+        ds_chomp(match, ',');
+        ds_chomp(&targets, ' ');
+        ds_chomp(&targets, ',');
+        ds_put_format(match, "} && nd.target == {%s}", ds_cstr(&targets));
+        ds_destroy(&targets);
+
+        ds_clear(actions);
+        ds_put_format(actions,
+                "%s { "
+                "eth.src = %s; "
+                "ip6.src = nd.target; "
+                "nd.tll = %s; "
+                "outport = inport; "
+                "flags.loopback = 1; "
+                "output; "
+                "};",
+                lsp_is_router(op->nbsp) ? "nd_na_router" : "nd_na",
+                laddrs->ea_s, laddrs->ea_s);
+        ovn_lflow_add_with_hint__(lflows, op->od, S_SWITCH_IN_ARP_ND_RSP, 50,
+                                  ds_cstr(match), ds_cstr(actions), NULL,
+                                  copp_meter_get(COPP_ND_NA,
+                                                 op->od->nbs->copp,
+                                                 meter_groups),
+                                  &op->nbsp->header_);
+
+        /* Do not reply to a solicitation from the port that owns the
+         * address (otherwise DAD detection will fail). */
+        ds_put_format(match, " && inport == %s", op->json_key);
+        ovn_lflow_add_with_lport_and_hint(lflows, op->od,
+                                          S_SWITCH_IN_ARP_ND_RSP, 100,
+                                          ds_cstr(match), "next;", op->key,
+                                          &op->nbsp->header_);
+    }
+}
+
 /* Ingress table 18: ARP/ND responder, reply for known IPs.
  * (priority 50). */
 static void
@@ -7772,6 +8657,13 @@ build_lswitch_arp_nd_responder_known_ips(struct ovn_port *op,
             }
 
             for (size_t i = 0; i < op->n_lsp_addrs; i++) {
+                if (group_arp_nd_responder) {
+                    build_lswitch_arp_nd_responder_grouped(
+                        op, &op->lsp_addrs[i], lflows, meter_groups,
+                        actions, match);
+                    continue;
+                }
+
                 for (size_t j = 0; j < op->lsp_addrs[i].n_ipv4_addrs; j++) {
                     ds_clear(match);
                     ds_put_format(match, "arp.tpa == %s && arp.op == 1",
@@ -7973,6 +8865,7 @@ build_lswitch_arp_nd_service_monitor(struct ovn_northd_lb *lb,
 static void
 build_lswitch_dhcp_options_and_response(struct ovn_port *op,
                                         struct hmap *lflows,
+                                        const struct hmap *dhcp_opts_templates,
                                         const struct shash *meter_groups)
 {
     if (op->nbsp) {
@@ -8002,19 +8895,19 @@ build_lswitch_dhcp_options_and_response(struct ovn_port *op,
                     build_dhcpv4_options_flows(
                         op, &op->lsp_addrs[i],
                         op->od->localnet_ports[j], is_external,
-                        meter_groups, lflows);
+                        dhcp_opts_templates, meter_groups, lflows);
                     build_dhcpv6_options_flows(
                         op, &op->lsp_addrs[i],
                         op->od->localnet_ports[j], is_external,
-                        meter_groups, lflows);
+                        dhcp_opts_templates, meter_groups, lflows);
                 }
             } else {
                 build_dhcpv4_options_flows(op, &op->lsp_addrs[i], op,
-                                           is_external, meter_groups,
-                                           lflows);
+                                           is_external, dhcp_opts_templates,
+                                           meter_groups, lflows);
                 build_dhcpv6_options_flows(op, &op->lsp_addrs[i], op,
-                                           is_external, meter_groups,
-                                           lflows);
+                                           is_external, dhcp_opts_templates,
+                                           meter_groups, lflows);
             }
         }
     }
@@ -8172,6 +9065,14 @@ build_lswitch_destination_lookup_bmcast(struct ovn_datapath *od,
 
         ovn_lflow_add(lflows, od, S_SWITCH_IN_L2_LKUP, 70, "eth.mcast",
                       "outport = \""MC_FLOOD"\"; output;");
+
+        /* Stands for the unicast lookup flows of the VIFs, see
+         * build_lswitch_ip_unicast_lookup(). */
+        if (parameterized_lflows) {
+            ovn_lflow_add(lflows, od, S_SWITCH_IN_L2_LKUP, 50,
+                          "eth.dst == "OVN_PORT_TEMPLATE_MAC,
+                          "outport = "OVN_PORT_TEMPLATE_PORT"; output;");
+        }
     }
 }
 
@@ -8280,6 +9181,10 @@ build_lswitch_ip_unicast_lookup(struct ovn_port *op,
             struct eth_addr mac;
             if (ovs_scan(op->nbsp->addresses[i],
                         ETH_ADDR_SCAN_FMT, ETH_ADDR_SCAN_ARGS(mac))) {
+                if (parameterized_lflows && !op->nbsp->type[0]) {
+                    /* Covered by the port template flow of the switch. */
+                    continue;
+                }
                 ds_clear(match);
                 ds_put_format(match, "eth.dst == "ETH_ADDR_FMT,
                               ETH_ADDR_ARGS(mac));
@@ -8914,6 +9819,12 @@ struct parsed_route {
     const struct nbrec_logical_router_static_route *route;
     bool ecmp_symmetric_reply;
     bool is_discard_route;
+
+    /* The router port that the route goes out through and its address on the
+     * network of the next hop, as found by find_static_route_outport().  Not
+     * set for discard routes. */
+    struct ovn_port *out_port;
+    const char *lrp_addr_s;
 };
 
 static uint32_t
@@ -8984,10 +9895,12 @@ parsed_routes_add(struct ovn_datapath *od, const struct hmap *ports,
     }
 
     /* Verify that ip_prefix and nexthop are on the same network. */
+    const char *lrp_addr_s = NULL;
+    struct ovn_port *out_port = NULL;
     if (!is_discard_route &&
         !find_static_route_outport(od, ports, route,
                                    IN6_IS_ADDR_V4MAPPED(&prefix),
-                                   NULL, NULL)) {
+                                   &lrp_addr_s, &out_port)) {
         return NULL;
     }
 
@@ -9024,6 +9937,8 @@ parsed_routes_add(struct ovn_datapath *od, const struct hmap *ports,
     pr->ecmp_symmetric_reply = smap_get_bool(&route->options,
                                              "ecmp_symmetric_reply", false);
     pr->is_discard_route = is_discard_route;
+    pr->out_port = out_port;
+    pr->lrp_addr_s = lrp_addr_s;
     ovs_list_insert(routes, &pr->list_node);
     return pr;
 }
@@ -9425,10 +10340,11 @@ build_ecmp_route_flow(struct hmap *lflows, struct ovn_datapath *od,
         const struct parsed_route *route_ = er->route;
         const struct nbrec_logical_router_static_route *route = route_->route;
         /* Find the outgoing port. */
-        const char *lrp_addr_s = NULL;
-        struct ovn_port *out_port = NULL;
-        if (!find_static_route_outport(od, ports, route, is_ipv4, &lrp_addr_s,
-                                       &out_port)) {
+        const char *lrp_addr_s = route_->lrp_addr_s;
+        struct ovn_port *out_port = route_->out_port;
+        if (route_->is_discard_route
+            && !find_static_route_outport(od, ports, route, is_ipv4,
+                                          &lrp_addr_s, &out_port)) {
             continue;
         }
         /* Symmetric ECMP reply is only usable on gateway routers.
@@ -9531,23 +10447,13 @@ add_route(struct hmap *lflows, struct ovn_datapath *od,
 
 static void
 build_static_route_flow(struct hmap *lflows, struct ovn_datapath *od,
-                        const struct hmap *ports,
                         const struct parsed_route *route_)
 {
-    const char *lrp_addr_s = NULL;
-    struct ovn_port *out_port = NULL;
+    const char *lrp_addr_s = route_->lrp_addr_s;
+    struct ovn_port *out_port = route_->out_port;
 
     const struct nbrec_logical_router_static_route *route = route_->route;
 
-    /* Find the outgoing port. */
-    if (!route_->is_discard_route) {
-        if (!find_static_route_outport(od, ports, route,
-                                       IN6_IS_ADDR_V4MAPPED(&route_->prefix),
-                                       &lrp_addr_s, &out_port)) {
-            return;
-        }
-    }
-
     int ofs = !strcmp(smap_get_def(&route->options, "origin", ""),
                       ROUTE_ORIGIN_CONNECTED) ? ROUTE_PRIO_OFFSET_CONNECTED
                                               : ROUTE_PRIO_OFFSET_STATIC;
@@ -11210,7 +12116,7 @@ build_static_route_flows_for_lrouter(
         }
         const struct unique_routes_node *ur;
         HMAP_FOR_EACH (ur, hmap_node, &unique_routes) {
-            build_static_route_flow(lflows, od, ports, ur->route);
+            build_static_route_flow(lflows, od, ur->route);
         }
         ecmp_groups_destroy(&ecmp_groups);
         unique_routes_destroy(&unique_routes);
@@ -13282,6 +14188,233 @@ lrouter_check_nat_entry(struct ovn_datapath *od, const struct nbrec_nat *nat,
     return 0;
 }
 
+/* Cache of the logical flows generated for the NAT rules of the logical
+ * routers, kept across the builds of the logical flows.  The flows of a NAT
+ * rule are generated again only if the NAT row or one of the other inputs of
+ * these flows changed, see nat_lflow_deps_format().
+ *
+ * The caches of the routers are looked up by nat_lflow_caches_prepare()
+ * before the logical flows are built, possibly in parallel, so that the thread
+ * that builds the flows of a router only accesses the cache of that router. */
+struct nat_lflow_cache_entry {
+    struct hmap_node hmap_node;   /* In 'entries' of a nat_lflow_cache. */
+    struct uuid nat_uuid;
+    const struct nbrec_nat *nat;
+    unsigned int nat_seqno;       /* See nat_lflow_nat_seqno(). */
+    char *deps;                   /* See nat_lflow_deps_format(). */
+    uint64_t build_seqno;         /* Last build that used the entry. */
+    struct lflow_bundle lflows;   /* All of them hinted with 'nat'. */
+};
+
+struct nat_lflow_cache {
+    struct hmap_node hmap_node;   /* In 'nat_lflow_caches'. */
+    struct uuid router_uuid;
+    struct hmap entries;          /* Contains "struct nat_lflow_cache_entry"s,
+                                   * by NAT uuid. */
+    uint64_t build_seqno;         /* Last build that used the cache. */
+};
+
+static struct hmap nat_lflow_caches = HMAP_INITIALIZER(&nat_lflow_caches);
+static uint64_t nat_lflow_build_seqno = 0;
+
+static void
+nat_lflow_cache_entry_destroy(struct nat_lflow_cache_entry *entry)
+{
+    free(entry->deps);
+    lflow_bundle_destroy(&entry->lflows);
+    free(entry);
+}
+
+static void
+nat_lflow_cache_destroy(struct nat_lflow_cache *cache)
+{
+    struct nat_lflow_cache_entry *entry;
+    HMAP_FOR_EACH_POP (entry, hmap_node, &cache->entries) {
+        nat_lflow_cache_entry_destroy(entry);
+    }
+    hmap_destroy(&cache->entries);
+    free(cache);
+}
+
+/* Sets the 'nat_lflow_cache' of the logical routers in 'datapaths' that can
+ * have NAT rules, and drops the caches of the other routers.  Must be called
+ * before the logical router flows are built. */
+static void
+nat_lflow_caches_prepare(const struct hmap *datapaths)
+{
+    struct ovn_datapath *od;
+
+    nat_lflow_build_seqno++;
+    HMAP_FOR_EACH (od, key_node, datapaths) {
+        od->nat_lflow_cache = NULL;
+        if (!od->nbr || !od->nbr->n_nat
+            || (!od->is_gw_router && !od->n_l3dgw_ports)) {
+            continue;
+        }
+
+        struct nat_lflow_cache *cache;
+        uint32_t hash = uuid_hash(&od->key);
+        HMAP_FOR_EACH_WITH_HASH (cache, hmap_node, hash, &nat_lflow_caches) {
+            if (uuid_equals(&cache->router_uuid, &od->key)) {
+                break;
+            }
+        }
+        if (!cache) {
+            cache = xmalloc(sizeof *cache);
+            cache->router_uuid = od->key;
+            hmap_init(&cache->entries);
+            hmap_insert(&nat_lflow_caches, &cache->hmap_node, hash);
+        }
+        cache->build_seqno = nat_lflow_build_seqno;
+        od->nat_lflow_cache = cache;
+    }
+
+    struct nat_lflow_cache *cache;
+    HMAP_FOR_EACH_SAFE (cache, hmap_node, &nat_lflow_caches) {
+        if (cache->build_seqno != nat_lflow_build_seqno) {
+            hmap_remove(&nat_lflow_caches, &cache->hmap_node);
+            nat_lflow_cache_destroy(cache);
+        }
+    }
+}
+
+/* Drops the entries of 'cache' for the NAT rules that were not used by the
+ * current build. */
+static void
+nat_lflow_cache_prune(struct nat_lflow_cache *cache)
+{
+    struct nat_lflow_cache_entry *entry;
+    HMAP_FOR_EACH_SAFE (entry, hmap_node, &cache->entries) {
+        if (entry->build_seqno != nat_lflow_build_seqno) {
+            hmap_remove(&cache->entries, &entry->hmap_node);
+            nat_lflow_cache_entry_destroy(entry);
+        }
+    }
+}
+
+/* Returns the last IDL change sequence number of 'nat', which changes when
+ * the row is modified but also when it is deleted and inserted again. */
+static unsigned int
+nat_lflow_nat_seqno(const struct nbrec_nat *nat)
+{
+    return MAX(nbrec_nat_row_get_seqno(nat, OVSDB_IDL_CHANGE_INSERT),
+               nbrec_nat_row_get_seqno(nat, OVSDB_IDL_CHANGE_MODIFY));
+}
+
+/* Formats in 'deps' all the inputs of the logical flows of 'nat' on router
+ * 'od', other than the columns of the NAT row itself: the router type, the
+ * selected gateway port and the external IP address sets, meters and logical
+ * port that the flows refer to. */
+static void
+nat_lflow_deps_format(struct ds *deps, const struct ovn_datapath *od,
+                      const struct nbrec_nat *nat,
+                      struct ovn_port *l3dgw_port, const struct hmap *ports,
+                      const struct shash *meter_groups)
+{
+    const char *icmp4_meter = copp_meter_get(COPP_ICMP4_ERR, od->nbr->copp,
+                                             meter_groups);
+    const char *icmp6_meter = copp_meter_get(COPP_ICMP6_ERR, od->nbr->copp,
+                                             meter_groups);
+
+    ds_clear(deps);
+    ds_put_format(deps, "%d %"PRIuSIZE" %d %s %s %s %s",
+                  od->is_gw_router, od->n_l3dgw_ports,
+                  !lport_addresses_is_empty(&od->dnat_force_snat_addrs),
+                  nat->allowed_ext_ips ? nat->allowed_ext_ips->name : "",
+                  nat->exempted_ext_ips ? nat->exempted_ext_ips->name : "",
+                  icmp4_meter ? icmp4_meter : "",
+                  icmp6_meter ? icmp6_meter : "");
+
+    if (l3dgw_port) {
+        const struct smap *options = &l3dgw_port->nbrp->options;
+        ds_put_format(deps, " %s %s %d %s %s", l3dgw_port->key,
+                      l3dgw_port->lrp_networks.ea_s,
+                      build_gateway_get_l2_hdr_size(l3dgw_port),
+                      smap_get_def(options, "gateway_mtu", ""),
+                      smap_get_def(options, "gateway_mtu_bypass", ""));
+    }
+
+    if (nat->logical_port) {
+        const struct ovn_port *op = ovn_port_find(ports, nat->logical_port);
+        ds_put_format(deps, " %d",
+                      op && op->nbsp && !strcmp(op->nbsp->type, "virtual"));
+    }
+}
+
+/* Returns the entry of 'cache' for 'nat', whose other inputs are 'deps',
+ * creating it if needed.  Sets '*valid' to true if the logical flows recorded
+ * in the entry are up to date, otherwise clears them so that they are recorded
+ * again. */
+static struct nat_lflow_cache_entry *
+nat_lflow_cache_get(struct nat_lflow_cache *cache,
+                    const struct nbrec_nat *nat, const char *deps,
+                    bool *valid)
+{
+    uint32_t hash = uuid_hash(&nat->header_.uuid);
+    unsigned int nat_seqno = nat_lflow_nat_seqno(nat);
+    struct nat_lflow_cache_entry *entry;
+
+    HMAP_FOR_EACH_WITH_HASH (entry, hmap_node, hash, &cache->entries) {
+        if (uuid_equals(&entry->nat_uuid, &nat->header_.uuid)) {
+            break;
+        }
+    }
+    if (!entry) {
+        entry = xzalloc(sizeof *entry);
+        entry->nat_uuid = nat->header_.uuid;
+        hmap_insert(&cache->entries, &entry->hmap_node, hash);
+    }
+
+    *valid = (entry->nat == nat && entry->nat_seqno == nat_seqno
+              && entry->deps && !strcmp(entry->deps, deps));
+    if (!*valid) {
+        entry->nat = nat;
+        entry->nat_seqno = nat_seqno;
+        free(entry->deps);
+        entry->deps = xstrdup(deps);
+        lflow_bundle_clear(&entry->lflows);
+    }
+    entry->build_seqno = nat_lflow_build_seqno;
+    return entry;
+}
+
+/* Adds to 'lflows' the logical flows of router 'od' recorded in 'entry'. */
+static void
+nat_lflow_cache_entry_add_lflows(const struct nat_lflow_cache_entry *entry,
+                                 struct ovn_datapath *od, struct hmap *lflows)
+{
+    for (size_t i = 0; i < entry->lflows.n_flows; i++) {
+        const struct lflow_bundle_flow *f = &entry->lflows.flows[i];
+        ovn_lflow_add_at_with_hash(lflows, od, f->stage, f->priority,
+                                   f->match, f->actions, f->io_port,
+                                   f->ctrl_meter, &entry->nat->header_,
+                                   f->where, f->hash);
+    }
+}
+
+/* Destroys the NAT logical flow caches of all the routers. */
+void
+nat_lflow_caches_destroy(void)
+{
+    struct nat_lflow_cache *cache;
+    HMAP_FOR_EACH_POP (cache, hmap_node, &nat_lflow_caches) {
+        nat_lflow_cache_destroy(cache);
+    }
+}
+
+/* Returns the number of NAT rules that have logical flows in the caches. */
+static size_t
+nat_lflow_caches_count(void)
+{
+    const struct nat_lflow_cache *cache;
+    size_t n = 0;
+
+    HMAP_FOR_EACH (cache, hmap_node, &nat_lflow_caches) {
+        n += hmap_count(&cache->entries);
+    }
+    return n;
+}
+
 /* NAT, Defrag and load balancing. */
 static void
 build_lrouter_nat_defrag_and_lb(struct ovn_datapath *od, struct hmap *lflows,
@@ -13335,6 +14468,7 @@ build_lrouter_nat_defrag_and_lb(struct ovn_datapath *od, struct hmap *lflows,
     }
 
     struct sset nat_entries = SSET_INITIALIZER(&nat_entries);
+    struct ds deps = DS_EMPTY_INITIALIZER;
 
     bool dnat_force_snat_ip =
         !lport_addresses_is_empty(&od->dnat_force_snat_addrs);
@@ -13354,13 +14488,6 @@ build_lrouter_nat_defrag_and_lb(struct ovn_datapath *od, struct hmap *lflows,
             continue;
         }
 
-        /* S_ROUTER_IN_UNSNAT */
-        build_lrouter_in_unsnat_flow(lflows, od, nat, match, actions, distributed,
-                                     is_v6, l3dgw_port);
-        /* S_ROUTER_IN_DNAT */
-        build_lrouter_in_dnat_flow(lflows, od, nat, match, actions, distributed,
-                                   cidr_bits, is_v6, l3dgw_port);
-
         /* ARP resolve for NAT IPs. */
         if (od->is_gw_router) {
             /* Add the NAT external_ip to the nat_entries for
@@ -13389,6 +14516,29 @@ build_lrouter_nat_defrag_and_lb(struct ovn_datapath *od, struct hmap *lflows,
             }
         }
 
+        /* The other flows of the NAT rule are taken from the cache if
+         * neither the rule nor the other inputs of these flows changed. */
+        struct nat_lflow_cache_entry *entry = NULL;
+        bool cached = false;
+        if (od->nat_lflow_cache) {
+            nat_lflow_deps_format(&deps, od, nat, l3dgw_port, ports,
+                                  meter_groups);
+            entry = nat_lflow_cache_get(od->nat_lflow_cache, nat,
+                                        ds_cstr(&deps), &cached);
+        }
+        if (cached) {
+            nat_lflow_cache_entry_add_lflows(entry, od, lflows);
+            continue;
+        }
+        lflow_bundle_recording = entry ? &entry->lflows : NULL;
+
+        /* S_ROUTER_IN_UNSNAT */
+        build_lrouter_in_unsnat_flow(lflows, od, nat, match, actions,
+                                     distributed, is_v6, l3dgw_port);
+        /* S_ROUTER_IN_DNAT */
+        build_lrouter_in_dnat_flow(lflows, od, nat, match, actions,
+                                   distributed, cidr_bits, is_v6, l3dgw_port);
+
         /* S_ROUTER_OUT_DNAT_LOCAL */
         build_lrouter_out_is_dnat_local(lflows, od, nat, match, actions,
                                         distributed, is_v6, l3dgw_port);
@@ -13479,6 +14629,10 @@ build_lrouter_nat_defrag_and_lb(struct ovn_datapath *od, struct hmap *lflows,
                                     ds_cstr(match), ds_cstr(actions),
                                     &nat->header_);
         }
+        lflow_bundle_recording = NULL;
+    }
+    if (od->nat_lflow_cache) {
+        nat_lflow_cache_prune(od->nat_lflow_cache);
     }
 
     /* Handle force SNAT options set in the gateway router. */
@@ -13508,14 +14662,65 @@ build_lrouter_nat_defrag_and_lb(struct ovn_datapath *od, struct hmap *lflows,
     }
 
     sset_destroy(&nat_entries);
+    ds_destroy(&deps);
 }
 
 
+/* Features whose logical flows are timed and counted separately, see
+ * lflow_build_stats_format(). */
+enum lflow_build_feature {
+    LFLOW_BUILD_ACLS,
+    LFLOW_BUILD_LB_RULES,
+    LFLOW_BUILD_NAT,
+    LFLOW_BUILD_ROUTES,
+    LFLOW_BUILD_ARP_ND,
+    LFLOW_BUILD_N_FEATURES
+};
+
+static const char *lflow_build_feature_stopwatches[LFLOW_BUILD_N_FEATURES] = {
+    [LFLOW_BUILD_ACLS] = LFLOWS_ACLS_STOPWATCH_NAME,
+    [LFLOW_BUILD_LB_RULES] = LFLOWS_LB_RULES_STOPWATCH_NAME,
+    [LFLOW_BUILD_NAT] = LFLOWS_NAT_STOPWATCH_NAME,
+    [LFLOW_BUILD_ROUTES] = LFLOWS_ROUTES_STOPWATCH_NAME,
+    [LFLOW_BUILD_ARP_ND] = LFLOWS_ARP_ND_STOPWATCH_NAME,
+};
+
+struct lflow_build_stats {
+    long long int usec;  /* Time spent in the build_* functions. */
+    size_t n_lflows;     /* Logical flows generated by them. */
+};
+
+/* Statistics of the last build_lswitch_and_lrouter_flows(). */
+static struct lflow_build_stats lflow_build_stats[LFLOW_BUILD_N_FEATURES];
+
+/* Start time and lflow counter when a timed build_* function was called. */
+struct lflow_build_timer {
+    long long int start;
+    size_t n_lflows;
+};
+
+static void
+lflow_build_timer_start(struct lflow_build_timer *timer)
+{
+    timer->start = time_usec();
+    timer->n_lflows = thread_lflow_add_counter;
+}
+
+static void
+lflow_build_timer_stop(const struct lflow_build_timer *timer,
+                       struct lflow_build_stats *stats)
+{
+    stats->usec += time_usec() - timer->start;
+    stats->n_lflows += thread_lflow_add_counter - timer->n_lflows;
+}
 
 struct lswitch_flow_build_info {
     const struct hmap *datapaths;
     const struct hmap *ports;
     const struct hmap *port_groups;
+    const struct hmap *acl_templates;  /* See build_acl_templates(). */
+    /* See build_dhcp_opts_templates(). */
+    const struct hmap *dhcp_opts_templates;
     struct hmap *lflows;
     struct hmap *mcgroups;
     struct hmap *igmp_groups;
@@ -13526,6 +14731,29 @@ struct lswitch_flow_build_info {
     struct ds match;
     struct ds actions;
     size_t thread_lflow_counter;
+
+    /* If true, the worker thread initializes 'lflows' itself, with mask
+     * 'lflows_mask', before building logical flows into it, so that the
+     * buckets are first touched, and thus allocated, on the NUMA node of the
+     * thread. */
+    bool init_lflows;
+    size_t lflows_mask;
+
+    /* If true, the worker threads parse the addresses of the logical switch
+     * ports in 'ports' instead of building logical flows. */
+    bool init_lsp_addresses;
+
+    /* If set, the worker threads merge the 'n_lflow_segs' segments of the
+     * lflow table into 'lflows' instead of building logical flows. */
+    struct hmap *lflow_segs;
+    size_t n_lflow_segs;
+
+    /* If set, the worker threads compare the logical flows with their SB
+     * records, see lflow_sync_compare(), instead of building logical
+     * flows. */
+    struct lflow_sync_info *sync;
+
+    struct lflow_build_stats stats[LFLOW_BUILD_N_FEATURES];
 };
 
 /* Helper function to combine all lflow generation which is iterated by
@@ -13539,14 +14767,21 @@ static void
 build_lswitch_and_lrouter_iterate_by_od(struct ovn_datapath *od,
                                         struct lswitch_flow_build_info *lsi)
 {
+    struct lflow_build_timer timer;
+
     /* Build Logical Switch Flows. */
-    build_lswitch_lflows_pre_acl_and_acl(od, lsi->port_groups, lsi->lflows,
+    lflow_build_timer_start(&timer);
+    build_lswitch_lflows_pre_acl_and_acl(od, lsi->port_groups,
+                                         lsi->acl_templates, lsi->lflows,
                                          lsi->meter_groups);
+    lflow_build_timer_stop(&timer, &lsi->stats[LFLOW_BUILD_ACLS]);
 
     build_fwd_group_lflows(od, lsi->lflows);
     build_lswitch_lflows_admission_control(od, lsi->lflows);
     build_lswitch_learn_fdb_od(od, lsi->lflows);
+    lflow_build_timer_start(&timer);
     build_lswitch_arp_nd_responder_default(od, lsi->lflows);
+    lflow_build_timer_stop(&timer, &lsi->stats[LFLOW_BUILD_ARP_ND]);
     build_lswitch_dns_lookup_and_response(od, lsi->lflows, lsi->meter_groups);
     build_lswitch_dhcp_and_dns_defaults(od, lsi->lflows);
     build_lswitch_destination_lookup_bmcast(od, lsi->lflows, &lsi->actions,
@@ -13558,24 +14793,34 @@ build_lswitch_and_lrouter_iterate_by_od(struct ovn_datapath *od,
     build_neigh_learning_flows_for_lrouter(od, lsi->lflows, &lsi->match,
                                            &lsi->actions, lsi->meter_groups);
     build_ND_RA_flows_for_lrouter(od, lsi->lflows);
+    lflow_build_timer_start(&timer);
     build_ip_routing_pre_flows_for_lrouter(od, lsi->lflows);
     build_static_route_flows_for_lrouter(od, lsi->lflows, lsi->ports,
                                          lsi->bfd_connections);
+    lflow_build_timer_stop(&timer, &lsi->stats[LFLOW_BUILD_ROUTES]);
     build_mcast_lookup_flows_for_lrouter(od, lsi->lflows, &lsi->match,
                                          &lsi->actions);
     build_ingress_policy_flows_for_lrouter(od, lsi->lflows, lsi->ports);
+    lflow_build_timer_start(&timer);
     build_arp_resolve_flows_for_lrouter(od, lsi->lflows);
+    lflow_build_timer_stop(&timer, &lsi->stats[LFLOW_BUILD_ARP_ND]);
     build_check_pkt_len_flows_for_lrouter(od, lsi->lflows, lsi->ports,
                                           &lsi->match, &lsi->actions,
                                           lsi->meter_groups);
     build_gateway_redirect_flows_for_lrouter(od, lsi->lflows, &lsi->match,
                                              &lsi->actions);
+    lflow_build_timer_start(&timer);
     build_arp_request_flows_for_lrouter(od, lsi->lflows, &lsi->match,
                                         &lsi->actions, lsi->meter_groups);
+    lflow_build_timer_stop(&timer, &lsi->stats[LFLOW_BUILD_ARP_ND]);
     build_misc_local_traffic_drop_flows_for_lrouter(od, lsi->lflows);
+    lflow_build_timer_start(&timer);
     build_lrouter_arp_nd_for_datapath(od, lsi->lflows, lsi->meter_groups);
+    lflow_build_timer_stop(&timer, &lsi->stats[LFLOW_BUILD_ARP_ND]);
+    lflow_build_timer_start(&timer);
     build_lrouter_nat_defrag_and_lb(od, lsi->lflows, lsi->ports, &lsi->match,
                                     &lsi->actions, lsi->meter_groups);
+    lflow_build_timer_stop(&timer, &lsi->stats[LFLOW_BUILD_NAT]);
 }
 
 /* Helper function to combine all lflow generation which is iterated by port.
@@ -13584,10 +14829,17 @@ static void
 build_lswitch_and_lrouter_iterate_by_op(struct ovn_port *op,
                                         struct lswitch_flow_build_info *lsi)
 {
+    struct lflow_build_timer timer;
+
+    /* Track the generated flows for the ports that can be handled
+     * incrementally, see lflow_handle_northd_ls_changes(). */
+    lflow_ref_list = op->lsp_can_be_inc_processed ? &op->lflows : NULL;
+
     /* Build Logical Switch Flows. */
     build_lswitch_port_sec_op(op, lsi->lflows, &lsi->actions, &lsi->match);
     build_lswitch_learn_fdb_op(op, lsi->lflows, &lsi->actions,
                                &lsi->match);
+    lflow_build_timer_start(&timer);
     build_lswitch_arp_nd_responder_skip_local(op, lsi->lflows,
                                               &lsi->match);
     build_lswitch_arp_nd_responder_known_ips(op, lsi->lflows,
@@ -13595,7 +14847,9 @@ build_lswitch_and_lrouter_iterate_by_op(struct ovn_port *op,
                                              lsi->meter_groups,
                                              &lsi->actions,
                                              &lsi->match);
+    lflow_build_timer_stop(&timer, &lsi->stats[LFLOW_BUILD_ARP_ND]);
     build_lswitch_dhcp_options_and_response(op, lsi->lflows,
+                                            lsi->dhcp_opts_templates,
                                             lsi->meter_groups);
     build_lswitch_external_port(op, lsi->lflows);
     build_lswitch_ip_unicast_lookup(op, lsi->lflows, lsi->mcgroups,
@@ -13606,11 +14860,15 @@ build_lswitch_and_lrouter_iterate_by_op(struct ovn_port *op,
                                           &lsi->actions);
     build_neigh_learning_flows_for_lrouter_port(op, lsi->lflows, &lsi->match,
                                                 &lsi->actions);
+    lflow_build_timer_start(&timer);
     build_ip_routing_flows_for_lrouter_port(op, lsi->ports, lsi->lflows);
+    lflow_build_timer_stop(&timer, &lsi->stats[LFLOW_BUILD_ROUTES]);
     build_ND_RA_flows_for_lrouter_port(op, lsi->lflows, &lsi->match,
                                        &lsi->actions, lsi->meter_groups);
+    lflow_build_timer_start(&timer);
     build_arp_resolve_flows_for_lrouter_port(op, lsi->lflows, lsi->ports,
                                              &lsi->match, &lsi->actions);
+    lflow_build_timer_stop(&timer, &lsi->stats[LFLOW_BUILD_ARP_ND]);
     build_egress_delivery_flows_for_lrouter_port(op, lsi->lflows, &lsi->match,
                                                  &lsi->actions);
     build_dhcpv6_reply_flows_for_lrouter_port(op, lsi->lflows, &lsi->match);
@@ -13619,21 +14877,153 @@ build_lswitch_and_lrouter_iterate_by_op(struct ovn_port *op,
                                             lsi->meter_groups);
     build_lrouter_ipv4_ip_input(op, lsi->lflows,
                                 &lsi->match, &lsi->actions, lsi->meter_groups);
+    lflow_build_timer_start(&timer);
     build_lrouter_force_snat_flows_op(op, lsi->lflows, &lsi->match,
                                       &lsi->actions);
+    lflow_build_timer_stop(&timer, &lsi->stats[LFLOW_BUILD_NAT]);
+
+    lflow_ref_list = NULL;
 }
 
-static void *
-build_lflows_thread(void *arg)
+/* Helper function to combine all lflow generation which is iterated by load
+ * balancer. */
+static void
+build_lb_lflows(struct ovn_northd_lb *lb, struct lswitch_flow_build_info *lsi)
 {
-    struct worker_control *control = (struct worker_control *) arg;
-    struct lswitch_flow_build_info *lsi;
+    struct lflow_build_timer timer;
+
+    /* Track the generated flows, see lflow_handle_northd_lb_changes(). */
+    lflow_ref_list = &lb->lflows;
+
+    lflow_build_timer_start(&timer);
+    build_lswitch_arp_nd_service_monitor(lb, lsi->lflows, &lsi->actions,
+                                         &lsi->match);
+    build_lrouter_defrag_flows_for_lb(lb, lsi->lflows, &lsi->match);
+    build_lrouter_flows_for_lb(lb, lsi->lflows, lsi->meter_groups,
+                               &lsi->match, &lsi->actions);
+    build_lswitch_flows_for_lb(lb, lsi->lflows, lsi->meter_groups,
+                               &lsi->match, &lsi->actions);
+    lflow_build_timer_stop(&timer, &lsi->stats[LFLOW_BUILD_LB_RULES]);
+
+    lflow_ref_list = NULL;
+}
+
+/* Merges the bucket 'bnum' of all the segments 'lsi->lflow_segs' into
+ * 'lsi->lflows'.  The segments have the same mask as 'lsi->lflows', so each
+ * bucket of the shared lflow hmap is only touched by the worker thread that
+ * took it as a task and no locking is needed.  A logical flow that was
+ * generated by several threads, for different datapaths, is merged into a
+ * single one with all the datapaths in its group. */
+static void
+build_lflows_merge_segs(struct lswitch_flow_build_info *lsi, size_t bnum)
+{
+    struct hmap *lflows = lsi->lflows;
+
+    for (size_t i = 0; i < lsi->n_lflow_segs; i++) {
+        struct hmap *seg = &lsi->lflow_segs[i];
+        struct hmap_node *node = seg->buckets[bnum];
+
+        ovs_assert(seg->mask == lflows->mask);
+        seg->buckets[bnum] = NULL;
+        while (node) {
+            struct hmap_node *next = node->next;
+            struct ovn_lflow *lflow =
+                CONTAINER_OF(node, struct ovn_lflow, hmap_node);
+            struct ovn_lflow *old_lflow =
+                ovn_lflow_find(lflows, NULL, lflow->stage,
+                               lflow->priority, lflow->match,
+                               lflow->actions, lflow->ctrl_meter,
+                               node->hash);
+            if (old_lflow) {
+                bitmap_or(old_lflow->dpg_bitmap, lflow->dpg_bitmap,
+                          n_datapaths);
+                old_lflow->n_ods = bitmap_count1(old_lflow->dpg_bitmap,
+                                                 n_datapaths);
+                ovn_lflow_move_refs(old_lflow, lflow);
+                ovn_lflow_destroy(NULL, lflow);
+            } else {
+                hmap_insert_fast(lflows, node, node->hash);
+                thread_lflow_counter++;
+            }
+            node = next;
+        }
+    }
+}
+
+/* Parses the addresses of 'op', if it is a logical switch port.  This only
+ * touches 'op', so it can be done for several ports in parallel. */
+static void
+ovn_port_init_lsp(struct ovn_port *op)
+{
+    if (op->nbsp) {
+        ovn_port_init_lsp_addresses(op, op->nbsp);
+        op->lsp_can_be_inc_processed = lsp_can_be_inc_processed(op->nbsp);
+    }
+}
+
+/* Returns the number of tasks of the logical flow build, one per hash bucket
+ * of 'lsi->datapaths', 'lsi->ports', 'lsi->lbs' and 'lsi->igmp_groups'. */
+static size_t
+build_lflows_n_tasks(const struct lswitch_flow_build_info *lsi)
+{
+    return (lsi->datapaths->mask + 1) + (lsi->ports->mask + 1)
+           + (lsi->lbs->mask + 1) + (lsi->igmp_groups->mask + 1);
+}
 
+/* Builds the logical flows of the objects in the hash bucket that 'task'
+ * stands for, the buckets of 'lsi->datapaths', 'lsi->ports', 'lsi->lbs' and
+ * 'lsi->igmp_groups' being numbered in that order. */
+static void
+build_lflows_task(struct lswitch_flow_build_info *lsi, size_t task)
+{
     struct ovn_datapath *od;
     struct ovn_port *op;
     struct ovn_northd_lb *lb;
     struct ovn_igmp_group *igmp_group;
-    int bnum;
+
+    if (task <= lsi->datapaths->mask) {
+        HMAP_FOR_EACH_IN_PARALLEL (od, key_node, task, lsi->datapaths) {
+            build_lswitch_and_lrouter_iterate_by_od(od, lsi);
+        }
+        return;
+    }
+    task -= lsi->datapaths->mask + 1;
+
+    if (task <= lsi->ports->mask) {
+        HMAP_FOR_EACH_IN_PARALLEL (op, key_node, task, lsi->ports) {
+            build_lswitch_and_lrouter_iterate_by_op(op, lsi);
+        }
+        return;
+    }
+    task -= lsi->ports->mask + 1;
+
+    if (task <= lsi->lbs->mask) {
+        HMAP_FOR_EACH_IN_PARALLEL (lb, hmap_node, task, lsi->lbs) {
+            build_lb_lflows(lb, lsi);
+        }
+        return;
+    }
+    task -= lsi->lbs->mask + 1;
+
+    HMAP_FOR_EACH_IN_PARALLEL (igmp_group, hmap_node, task,
+                               lsi->igmp_groups) {
+        build_lswitch_ip_mcast_igmp_mld(igmp_group, lsi->lflows,
+                                        &lsi->match, &lsi->actions);
+    }
+}
+
+static void lflow_sync_compare_bucket(struct lflow_sync_info *, size_t bnum);
+
+/* Worker thread of 'build_lflows_pool'.  The work is split in tasks, taken
+ * with worker_next_task(), so that the threads that are done with their share
+ * help the others instead of waiting for them. */
+static void *
+build_lflows_thread(void *arg)
+{
+    struct worker_control *control = (struct worker_control *) arg;
+    struct lswitch_flow_build_info *lsi;
+    struct ovn_port *op;
+    size_t task;
 
     while (!stop_parallel_processing()) {
         wait_for_work(control);
@@ -13642,64 +15032,23 @@ build_lflows_thread(void *arg)
             return NULL;
         }
         thread_lflow_counter = 0;
-        if (lsi) {
-            /* Iterate over bucket ThreadID, ThreadID+size, ... */
-            for (bnum = control->id;
-                    bnum <= lsi->datapaths->mask;
-                    bnum += control->pool->size)
-            {
-                HMAP_FOR_EACH_IN_PARALLEL (od, key_node, bnum, lsi->datapaths) {
-                    if (stop_parallel_processing()) {
-                        return NULL;
-                    }
-                    build_lswitch_and_lrouter_iterate_by_od(od, lsi);
-                }
-            }
-            for (bnum = control->id;
-                    bnum <= lsi->ports->mask;
-                    bnum += control->pool->size)
-            {
-                HMAP_FOR_EACH_IN_PARALLEL (op, key_node, bnum, lsi->ports) {
-                    if (stop_parallel_processing()) {
-                        return NULL;
-                    }
-                    build_lswitch_and_lrouter_iterate_by_op(op, lsi);
-                }
-            }
-            for (bnum = control->id;
-                    bnum <= lsi->lbs->mask;
-                    bnum += control->pool->size)
-            {
-                HMAP_FOR_EACH_IN_PARALLEL (lb, hmap_node, bnum, lsi->lbs) {
-                    if (stop_parallel_processing()) {
-                        return NULL;
-                    }
-                    build_lswitch_arp_nd_service_monitor(lb, lsi->lflows,
-                                                         &lsi->match,
-                                                         &lsi->actions);
-                    build_lrouter_defrag_flows_for_lb(lb, lsi->lflows,
-                                                      &lsi->match);
-                    build_lrouter_flows_for_lb(lb, lsi->lflows,
-                                               lsi->meter_groups, &lsi->match,
-                                               &lsi->actions);
-                    build_lswitch_flows_for_lb(lb, lsi->lflows,
-                                               lsi->meter_groups,
-                                               &lsi->match, &lsi->actions);
-                }
+        if (lsi && lsi->init_lflows) {
+            fast_hmap_init(lsi->lflows, lsi->lflows_mask);
+        }
+        while (lsi && worker_next_task(control, &task)) {
+            if (stop_parallel_processing()) {
+                return NULL;
             }
-            for (bnum = control->id;
-                    bnum <= lsi->igmp_groups->mask;
-                    bnum += control->pool->size)
-            {
-                HMAP_FOR_EACH_IN_PARALLEL (
-                        igmp_group, hmap_node, bnum, lsi->igmp_groups) {
-                    if (stop_parallel_processing()) {
-                        return NULL;
-                    }
-                    build_lswitch_ip_mcast_igmp_mld(igmp_group, lsi->lflows,
-                                                    &lsi->match,
-                                                    &lsi->actions);
+            if (lsi->init_lsp_addresses) {
+                HMAP_FOR_EACH_IN_PARALLEL (op, key_node, task, lsi->ports) {
+                    ovn_port_init_lsp(op);
                 }
+            } else if (lsi->lflow_segs) {
+                build_lflows_merge_segs(lsi, task);
+            } else if (lsi->sync) {
+                lflow_sync_compare_bucket(lsi->sync, task);
+            } else {
+                build_lflows_task(lsi, task);
             }
         }
         lsi->thread_lflow_counter = thread_lflow_counter;
@@ -13710,19 +15059,44 @@ build_lflows_thread(void *arg)
 
 static struct worker_pool *build_lflows_pool = NULL;
 
+/* Parses the addresses of all the logical switch ports in 'ports', using the
+ * worker threads of 'build_lflows_pool' if parallelization is enabled. */
 static void
-noop_callback(struct worker_pool *pool OVS_UNUSED,
-              void *fin_result OVS_UNUSED,
-              void *result_frags OVS_UNUSED,
-              size_t index OVS_UNUSED)
+ovn_ports_init_lsp_addresses(struct hmap *ports)
+{
+    if (parallelization_state == STATE_NULL || !build_lflows_pool) {
+        struct ovn_port *op;
+        HMAP_FOR_EACH (op, key_node, ports) {
+            ovn_port_init_lsp(op);
+        }
+        return;
+    }
+
+    struct lswitch_flow_build_info *lsiv;
+    lsiv = xcalloc(sizeof *lsiv, build_lflows_pool->size);
+    for (size_t index = 0; index < build_lflows_pool->size; index++) {
+        lsiv[index].ports = ports;
+        lsiv[index].init_lsp_addresses = true;
+        build_lflows_pool->controls[index].data = &lsiv[index];
+    }
+    pool_set_tasks(build_lflows_pool, ports->mask + 1);
+    run_pool(build_lflows_pool);
+    free(lsiv);
+}
+
+static void
+noop_callback(struct worker_pool *pool OVS_UNUSED,
+              void *fin_result OVS_UNUSED,
+              void *result_frags OVS_UNUSED,
+              size_t index OVS_UNUSED)
 {
     /* Do nothing */
 }
 
-/* Fixes the hmap size (hmap->n) after parallel building the lflow_map when
- * dp-groups is enabled, because in that case all threads are updating the
- * global lflow hmap. Although the lflow_hash_lock prevents currently inserting
- * to the same hash bucket, the hmap->n is updated currently by all threads and
+/* Fixes the hmap size (hmap->n) after merging the segments of the lflow_map
+ * in parallel when dp-groups is enabled, because in that case all threads are
+ * updating the global lflow hmap. Although every thread only inserts to its
+ * own hash buckets, the hmap->n is updated concurrently by all threads and
  * may not be accurate at the end of each iteration. This function collects the
  * thread-local lflow counters maintained by each thread and update the hmap
  * size with the aggregated value. This function must be called immediately
@@ -13740,6 +15114,42 @@ fix_flow_map_size(struct hmap *lflow_map,
     lflow_map->n = total;
 }
 
+/* Adds the statistics collected by 'lsi' to 'lflow_build_stats'. */
+static void
+lflow_build_stats_add(const struct lswitch_flow_build_info *lsi)
+{
+    for (size_t i = 0; i < LFLOW_BUILD_N_FEATURES; i++) {
+        lflow_build_stats[i].usec += lsi->stats[i].usec;
+        lflow_build_stats[i].n_lflows += lsi->stats[i].n_lflows;
+    }
+}
+
+/* Records the 'lflow_build_stats' as samples of their stopwatches. */
+static void
+lflow_build_stats_record(void)
+{
+    for (size_t i = 0; i < LFLOW_BUILD_N_FEATURES; i++) {
+        stopwatch_start(lflow_build_feature_stopwatches[i], 0);
+        stopwatch_stop(lflow_build_feature_stopwatches[i],
+                       lflow_build_stats[i].usec);
+        OVN_USDT_PROBE(northd, build_lflows_feature,
+                       lflow_build_feature_stopwatches[i],
+                       lflow_build_stats[i].usec,
+                       lflow_build_stats[i].n_lflows);
+    }
+}
+
+void
+lflow_build_stats_format(struct ds *s)
+{
+    for (size_t i = 0; i < LFLOW_BUILD_N_FEATURES; i++) {
+        ds_put_format(s, "%s: %lld usec, %"PRIuSIZE" lflows\n",
+                      lflow_build_feature_stopwatches[i],
+                      lflow_build_stats[i].usec,
+                      lflow_build_stats[i].n_lflows);
+    }
+}
+
 static void
 build_lswitch_and_lrouter_flows(const struct hmap *datapaths,
                                 const struct hmap *ports,
@@ -13753,34 +15163,35 @@ build_lswitch_and_lrouter_flows(const struct hmap *datapaths,
 {
 
     char *svc_check_match = xasprintf("eth.dst == %s", svc_monitor_mac);
+    struct hmap acl_templates = HMAP_INITIALIZER(&acl_templates);
+    struct hmap dhcp_opts_templates = HMAP_INITIALIZER(&dhcp_opts_templates);
 
+    memset(lflow_build_stats, 0, sizeof lflow_build_stats);
+    build_acl_templates(datapaths, meter_groups, &acl_templates);
+    build_dhcp_opts_templates(ports, &dhcp_opts_templates);
+    nat_lflow_caches_prepare(datapaths);
     if (parallelization_state == STATE_USE_PARALLELIZATION) {
         struct hmap *lflow_segs;
         struct lswitch_flow_build_info *lsiv;
         int index;
 
         lsiv = xcalloc(sizeof(*lsiv), build_lflows_pool->size);
-        if (use_logical_dp_groups) {
-            lflow_segs = NULL;
-        } else {
-            lflow_segs = xcalloc(sizeof(*lflow_segs), build_lflows_pool->size);
-        }
+        lflow_segs = xcalloc(sizeof(*lflow_segs), build_lflows_pool->size);
 
         /* Set up "work chunks" for each thread to work on. */
 
         for (index = 0; index < build_lflows_pool->size; index++) {
-            if (use_logical_dp_groups) {
-                /* if dp_groups are in use we lock a shared lflows hash
-                 * on a per-bucket level instead of merging hash frags */
-                lsiv[index].lflows = lflows;
-            } else {
-                fast_hmap_init(&lflow_segs[index], lflows->mask);
-                lsiv[index].lflows = &lflow_segs[index];
-            }
+            /* Every thread builds its logical flows into its own segment,
+             * which are merged into 'lflows' afterwards. */
+            lsiv[index].lflows = &lflow_segs[index];
+            lsiv[index].init_lflows = true;
+            lsiv[index].lflows_mask = lflows->mask;
 
             lsiv[index].datapaths = datapaths;
             lsiv[index].ports = ports;
             lsiv[index].port_groups = port_groups;
+            lsiv[index].acl_templates = &acl_templates;
+            lsiv[index].dhcp_opts_templates = &dhcp_opts_templates;
             lsiv[index].mcgroups = mcgroups;
             lsiv[index].igmp_groups = igmp_groups;
             lsiv[index].meter_groups = meter_groups;
@@ -13795,15 +15206,37 @@ build_lswitch_and_lrouter_flows(const struct hmap *datapaths,
         }
 
         /* Run thread pool. */
+        pool_set_tasks(build_lflows_pool, build_lflows_n_tasks(&lsiv[0]));
         if (use_logical_dp_groups) {
+            run_pool_callback(build_lflows_pool, NULL, NULL,
+                              noop_callback);
+
+            /* The same logical flow may have been generated by several
+             * threads for different datapaths, so the segments need to be
+             * merged flow by flow.  The merge is done in parallel too, one
+             * task per hash bucket. */
+            for (index = 0; index < build_lflows_pool->size; index++) {
+                lsiv[index].lflows = lflows;
+                lsiv[index].init_lflows = false;
+                lsiv[index].lflow_segs = lflow_segs;
+                lsiv[index].n_lflow_segs = build_lflows_pool->size;
+                lsiv[index].thread_lflow_counter = 0;
+                build_lflows_pool->controls[index].data = &lsiv[index];
+            }
+            pool_set_tasks(build_lflows_pool, lflows->mask + 1);
             run_pool_callback(build_lflows_pool, NULL, NULL,
                               noop_callback);
             fix_flow_map_size(lflows, lsiv, build_lflows_pool->size);
+
+            for (index = 0; index < build_lflows_pool->size; index++) {
+                hmap_destroy(&lflow_segs[index]);
+            }
         } else {
             run_pool_hash(build_lflows_pool, lflows, lflow_segs);
         }
 
         for (index = 0; index < build_lflows_pool->size; index++) {
+            lflow_build_stats_add(&lsiv[index]);
             ds_destroy(&lsiv[index].match);
             ds_destroy(&lsiv[index].actions);
         }
@@ -13818,6 +15251,8 @@ build_lswitch_and_lrouter_flows(const struct hmap *datapaths,
             .datapaths = datapaths,
             .ports = ports,
             .port_groups = port_groups,
+            .acl_templates = &acl_templates,
+            .dhcp_opts_templates = &dhcp_opts_templates,
             .lflows = lflows,
             .mcgroups = mcgroups,
             .igmp_groups = igmp_groups,
@@ -13833,58 +15268,78 @@ build_lswitch_and_lrouter_flows(const struct hmap *datapaths,
          * will move here and will be reogranized by iterator type.
          */
         stopwatch_start(LFLOWS_DATAPATHS_STOPWATCH_NAME, time_msec());
+        OVN_USDT_PROBE(northd, build_lflows_stage_begin,
+                       LFLOWS_DATAPATHS_STOPWATCH_NAME);
         HMAP_FOR_EACH (od, key_node, datapaths) {
             build_lswitch_and_lrouter_iterate_by_od(od, &lsi);
         }
+        OVN_USDT_PROBE(northd, build_lflows_stage_end,
+                       LFLOWS_DATAPATHS_STOPWATCH_NAME, hmap_count(lflows));
         stopwatch_stop(LFLOWS_DATAPATHS_STOPWATCH_NAME, time_msec());
         stopwatch_start(LFLOWS_PORTS_STOPWATCH_NAME, time_msec());
+        OVN_USDT_PROBE(northd, build_lflows_stage_begin,
+                       LFLOWS_PORTS_STOPWATCH_NAME);
         HMAP_FOR_EACH (op, key_node, ports) {
             build_lswitch_and_lrouter_iterate_by_op(op, &lsi);
         }
+        OVN_USDT_PROBE(northd, build_lflows_stage_end,
+                       LFLOWS_PORTS_STOPWATCH_NAME, hmap_count(lflows));
         stopwatch_stop(LFLOWS_PORTS_STOPWATCH_NAME, time_msec());
         stopwatch_start(LFLOWS_LBS_STOPWATCH_NAME, time_msec());
+        OVN_USDT_PROBE(northd, build_lflows_stage_begin,
+                       LFLOWS_LBS_STOPWATCH_NAME);
         HMAP_FOR_EACH (lb, hmap_node, lbs) {
-            build_lswitch_arp_nd_service_monitor(lb, lsi.lflows,
-                                                 &lsi.actions,
-                                                 &lsi.match);
-            build_lrouter_defrag_flows_for_lb(lb, lsi.lflows, &lsi.match);
-            build_lrouter_flows_for_lb(lb, lsi.lflows, lsi.meter_groups,
-                                       &lsi.match, &lsi.actions);
-            build_lswitch_flows_for_lb(lb, lsi.lflows, lsi.meter_groups,
-                                       &lsi.match, &lsi.actions);
+            build_lb_lflows(lb, &lsi);
         }
+        OVN_USDT_PROBE(northd, build_lflows_stage_end,
+                       LFLOWS_LBS_STOPWATCH_NAME, hmap_count(lflows));
         stopwatch_stop(LFLOWS_LBS_STOPWATCH_NAME, time_msec());
         stopwatch_start(LFLOWS_IGMP_STOPWATCH_NAME, time_msec());
+        OVN_USDT_PROBE(northd, build_lflows_stage_begin,
+                       LFLOWS_IGMP_STOPWATCH_NAME);
         HMAP_FOR_EACH (igmp_group, hmap_node, igmp_groups) {
             build_lswitch_ip_mcast_igmp_mld(igmp_group,
                                             lsi.lflows,
                                             &lsi.actions,
                                             &lsi.match);
         }
+        OVN_USDT_PROBE(northd, build_lflows_stage_end,
+                       LFLOWS_IGMP_STOPWATCH_NAME, hmap_count(lflows));
         stopwatch_stop(LFLOWS_IGMP_STOPWATCH_NAME, time_msec());
 
+        lflow_build_stats_add(&lsi);
         ds_destroy(&lsi.match);
         ds_destroy(&lsi.actions);
     }
+    lflow_build_stats_record();
 
+    destroy_acl_templates(&acl_templates);
+    destroy_dhcp_opts_templates(&dhcp_opts_templates);
     free(svc_check_match);
     build_lswitch_flows(datapaths, lflows);
 }
 
 struct ovn_dp_group {
-    struct hmapx map;
+    unsigned long *bitmap;       /* Datapaths by their 'index'. */
+    size_t n_ods;                /* Number of datapaths in 'bitmap'. */
     struct sbrec_logical_dp_group *dp_group;
     struct hmap_node node;
 };
 
+static uint32_t
+ovn_dp_group_hash(const unsigned long *dpg_bitmap)
+{
+    return hash_bytes(dpg_bitmap, bitmap_n_bytes(n_datapaths), 0);
+}
+
 static struct ovn_dp_group *
 ovn_dp_group_find(const struct hmap *dp_groups,
-                  const struct hmapx *od, uint32_t hash)
+                  const unsigned long *dpg_bitmap, uint32_t hash)
 {
     struct ovn_dp_group *dpg;
 
     HMAP_FOR_EACH_WITH_HASH (dpg, node, hash, dp_groups) {
-        if (hmapx_equals(&dpg->map, od)) {
+        if (bitmap_equal(dpg->bitmap, dpg_bitmap, n_datapaths)) {
             return dpg;
         }
     }
@@ -13893,16 +15348,16 @@ ovn_dp_group_find(const struct hmap *dp_groups,
 
 static struct sbrec_logical_dp_group *
 ovn_sb_insert_logical_dp_group(struct ovsdb_idl_txn *ovnsb_txn,
-                               const struct hmapx *od)
+                               const unsigned long *dpg_bitmap, size_t n_ods)
 {
     struct sbrec_logical_dp_group *dp_group;
     const struct sbrec_datapath_binding **sb;
-    const struct hmapx_node *node;
+    size_t index;
     int n = 0;
 
-    sb = xmalloc(hmapx_count(od) * sizeof *sb);
-    HMAPX_FOR_EACH (node, od) {
-        sb[n++] = ((struct ovn_datapath *) node->data)->sb;
+    sb = xmalloc(n_ods * sizeof *sb);
+    BITMAP_FOR_EACH_1 (index, n_datapaths, dpg_bitmap) {
+        sb[n++] = datapaths_array[index]->sb;
     }
     dp_group = sbrec_logical_dp_group_insert(ovnsb_txn);
     sbrec_logical_dp_group_set_datapaths(
@@ -13917,28 +15372,38 @@ ovn_sb_set_lflow_logical_dp_group(
     struct ovsdb_idl_txn *ovnsb_txn,
     struct hmap *dp_groups,
     const struct sbrec_logical_flow *sbflow,
-    const struct hmapx *od_group)
+    const unsigned long *dpg_bitmap)
 {
     struct ovn_dp_group *dpg;
 
-    if (!hmapx_count(od_group)) {
+    if (!dpg_bitmap) {
         sbrec_logical_flow_set_logical_dp_group(sbflow, NULL);
         return;
     }
 
-    ovs_assert(hmapx_count(od_group) != 1);
-
-    dpg = ovn_dp_group_find(dp_groups, od_group,
-                            hash_int(hmapx_count(od_group), 0));
+    dpg = ovn_dp_group_find(dp_groups, dpg_bitmap,
+                            ovn_dp_group_hash(dpg_bitmap));
     ovs_assert(dpg != NULL);
+    ovs_assert(dpg->n_ods > 1);
 
     if (!dpg->dp_group) {
-        dpg->dp_group = ovn_sb_insert_logical_dp_group(ovnsb_txn, &dpg->map);
+        dpg->dp_group = ovn_sb_insert_logical_dp_group(ovnsb_txn, dpg->bitmap,
+                                                       dpg->n_ods);
     }
     sbrec_logical_flow_set_logical_dp_group(sbflow, dpg->dp_group);
 }
 
 static ssize_t max_seen_lflow_size = 128;
+/* Number of datapath groups used by the last lflow build. */
+static size_t lflow_n_dp_groups = 0;
+
+/* Sets the CPU mask of the threads used for building logical flows, see
+ * ovn_set_worker_cpu_mask(). */
+void
+run_set_worker_cpu_mask(const char *cmask)
+{
+    set_worker_cpu_mask(cmask);
+}
 
 void run_update_worker_pool(int n_threads)
 {
@@ -13948,12 +15413,9 @@ void run_update_worker_pool(int n_threads)
                            build_lflows_thread) != POOL_UNCHANGED) {
         /* worker pool was updated */
         if (get_worker_pool_size() <= 1) {
-            /* destroy potentially created lflow_hash_lock */
-            lflow_hash_lock_destroy();
             parallelization_state = STATE_NULL;
         } else if (parallelization_state != STATE_USE_PARALLELIZATION) {
             if (use_logical_dp_groups) {
-                lflow_hash_lock_init();
                 parallelization_state = STATE_INIT_HASH_SIZES;
             } else {
                 parallelization_state = STATE_USE_PARALLELIZATION;
@@ -13962,13 +15424,24 @@ void run_update_worker_pool(int n_threads)
     }
 }
 
+/* Appends to 's' the statistics of the threads used for building logical
+ * flows, if parallelization is enabled. */
+void
+worker_pool_stats_format(struct ds *s)
+{
+    if (!build_lflows_pool) {
+        ds_put_cstr(s, "Parallel build is disabled\n");
+        return;
+    }
+    pool_format_stats(build_lflows_pool, s);
+}
+
 static void worker_pool_init_for_ldp(void)
 {
-    /* If parallelization is enabled, make sure locks are initialized
-     * when ldp are used.
+    /* If parallelization is enabled, make sure the hashes are sized
+     * before building the logical flows in parallel when ldp are used.
      */
     if (parallelization_state != STATE_NULL) {
-        lflow_hash_lock_init();
         parallelization_state = STATE_INIT_HASH_SIZES;
     }
 }
@@ -13980,25 +15453,510 @@ build_mcast_groups(struct lflow_input *data,
                    struct hmap *mcast_groups,
                    struct hmap *igmp_groups);
 
+/* Returns one valid datapath of 'sbflow', which is enough to get the
+ * datapath type, or NULL if the flow has no valid logical datapaths. */
+static struct ovn_datapath *
+sbflow_get_valid_od(const struct hmap *datapaths,
+                    const struct sbrec_logical_flow *sbflow)
+{
+    const struct sbrec_logical_dp_group *dp_group = sbflow->logical_dp_group;
+    struct ovn_datapath *od = NULL;
+
+    if (sbflow->logical_datapath) {
+        od = ovn_datapath_from_sbrec(datapaths, sbflow->logical_datapath);
+        if (od && ovn_datapath_is_stale(od)) {
+            od = NULL;
+        }
+    }
+    for (size_t i = 0; dp_group && i < dp_group->n_datapaths; i++) {
+        od = ovn_datapath_from_sbrec(datapaths, dp_group->datapaths[i]);
+        if (od && !ovn_datapath_is_stale(od)) {
+            break;
+        }
+        od = NULL;
+    }
+    return od;
+}
+
+/* Returns true if 'sbflow' is the SB record of 'lflow'. */
+static bool
+ovn_lflow_matches_sbflow(const struct ovn_lflow *lflow,
+                         const struct sbrec_logical_flow *sbflow,
+                         const struct hmap *datapaths)
+{
+    if (sbflow->logical_dp_group) {
+        if (lflow->od) {
+            return false;
+        }
+
+        /* The same flow may exist for both switches and routers. */
+        struct ovn_datapath *od = sbflow_get_valid_od(datapaths, sbflow);
+        if (!od || ovn_stage_to_datapath_type(lflow->stage)
+                   != ovn_datapath_get_type(od)) {
+            return false;
+        }
+    } else if (!lflow->od || sbflow->logical_datapath != lflow->od->sb) {
+        return false;
+    }
+
+    return (sbflow->table_id == ovn_stage_get_table(lflow->stage)
+            && !strcmp(sbflow->pipeline,
+                       ovn_stage_get_pipeline_name(lflow->stage))
+            && sbflow->priority == lflow->priority
+            && !strcmp(sbflow->match, lflow->match)
+            && !strcmp(sbflow->actions, lflow->actions)
+            && nullable_string_is_equal(sbflow->controller_meter,
+                                        lflow->ctrl_meter));
+}
+
+/* Node of 'struct sb_lflow_index'. */
+struct sb_lflow_index_node {
+    struct hmap_node hmap_node;  /* In 'rows', by 'sbflow->hash'. */
+    const struct sbrec_logical_flow *sbflow;
+    uint64_t seqno;              /* 'seqno' of the last build_lflows() that
+                                  * synced a logical flow with 'sbflow'. */
+};
+
+static struct sb_lflow_index_node *
+sb_lflow_index_find(const struct sb_lflow_index *index,
+                    const struct sbrec_logical_flow *sbflow)
+{
+    struct sb_lflow_index_node *node;
+    HMAP_FOR_EACH_WITH_HASH (node, hmap_node, sbflow->hash, &index->rows) {
+        if (node->sbflow == sbflow) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+static void
+sb_lflow_index_add(struct sb_lflow_index *index,
+                   const struct sbrec_logical_flow *sbflow)
+{
+    struct sb_lflow_index_node *node = xmalloc(sizeof *node);
+    node->sbflow = sbflow;
+    node->seqno = 0;
+    hmap_insert(&index->rows, &node->hmap_node, sbflow->hash);
+}
+
+static void
+sb_lflow_index_clear(struct sb_lflow_index *index)
+{
+    struct sb_lflow_index_node *node;
+    HMAP_FOR_EACH_POP (node, hmap_node, &index->rows) {
+        free(node);
+    }
+}
+
+void
+sb_lflow_index_init(struct sb_lflow_index *index)
+{
+    hmap_init(&index->rows);
+    index->seqno = 0;
+    index->valid = false;
+}
+
+void
+sb_lflow_index_destroy(struct sb_lflow_index *index)
+{
+    sb_lflow_index_clear(index);
+    hmap_destroy(&index->rows);
+}
+
+/* Updates 'index' with the tracked changes of 'sbrec_logical_flow_table', or
+ * rebuilds it from the whole table if it isn't valid.  Applying the same
+ * tracked changes more than once is harmless. */
+void
+sb_lflow_index_update(
+    struct sb_lflow_index *index,
+    const struct sbrec_logical_flow_table *sbrec_logical_flow_table)
+{
+    const struct sbrec_logical_flow *sbflow;
+
+    if (index->valid) {
+        SBREC_LOGICAL_FLOW_TABLE_FOR_EACH_TRACKED (sbflow,
+                                                   sbrec_logical_flow_table) {
+            struct sb_lflow_index_node *node =
+                sb_lflow_index_find(index, sbflow);
+
+            if (sbrec_logical_flow_is_deleted(sbflow)) {
+                if (node) {
+                    hmap_remove(&index->rows, &node->hmap_node);
+                    free(node);
+                }
+            } else if (sbrec_logical_flow_is_new(sbflow)) {
+                if (!node) {
+                    sb_lflow_index_add(index, sbflow);
+                }
+            } else if (!node) {
+                /* The columns that 'hash' depends on were updated. */
+                index->valid = false;
+                break;
+            }
+        }
+        if (index->valid) {
+            return;
+        }
+    }
+
+    sb_lflow_index_clear(index);
+    SBREC_LOGICAL_FLOW_TABLE_FOR_EACH (sbflow, sbrec_logical_flow_table) {
+        sb_lflow_index_add(index, sbflow);
+    }
+    index->valid = true;
+}
+
+/* Returns true if the datapath group of 'sbflow' doesn't have the same
+ * datapaths as 'lflow'. */
+static bool
+ovn_lflow_dp_group_differs(const struct ovn_lflow *lflow,
+                           const struct sbrec_logical_flow *sbflow,
+                           const struct hmap *datapaths)
+{
+    const struct sbrec_logical_dp_group *dp_group = sbflow->logical_dp_group;
+
+    if (!lflow->dpg || !dp_group) {
+        /* Need to add or delete datapath group, unless none is needed. */
+        return !lflow->dpg != !dp_group;
+    }
+
+    unsigned long *dpg_bitmap = bitmap_allocate(n_datapaths);
+    size_t n_ods = 0;
+
+    /* Check all logical datapaths from the group. */
+    for (size_t i = 0; i < dp_group->n_datapaths; i++) {
+        struct ovn_datapath *od = ovn_datapath_from_sbrec(
+                datapaths, dp_group->datapaths[i]);
+        if (!od || ovn_datapath_is_stale(od)
+            || bitmap_is_set(dpg_bitmap, od->index)) {
+            continue;
+        }
+        bitmap_set1(dpg_bitmap, od->index);
+        n_ods++;
+    }
+
+    bool differs = (n_ods != lflow->n_ods
+                    || !bitmap_equal(dpg_bitmap, lflow->dpg_bitmap,
+                                     n_datapaths));
+    bitmap_free(dpg_bitmap);
+    return differs;
+}
+
+/* A logical flow that claimed the SB record 'sbflow', see
+ * lflow_sync_compare(). */
+struct lflow_sync_result {
+    struct ovn_lflow *lflow;
+    const struct sbrec_logical_flow *sbflow;
+    bool dp_group_differs;  /* The SB datapath group must be updated. */
+};
+
+/* Node of 'struct lflow_sync_info's 'dpg_cache'. */
+struct lflow_sync_dpg_node {
+    struct hmap_node hmap_node;  /* By hash_pointer('dpg'). */
+    const struct ovn_dp_group *dpg;
+    const struct sbrec_logical_dp_group *dp_group;
+};
+
+/* State of one thread of lflow_sync_compare(). */
+struct lflow_sync_info {
+    struct hmap *lflows;
+    struct sb_lflow_index *sb_index;
+    const struct hmap *datapaths;
+
+    /* SB datapath group known to be in sync with each 'struct ovn_dp_group',
+     * which is shared between threads and so can't cache it itself. */
+    struct hmap dpg_cache;
+
+    struct lflow_sync_result *results;
+    size_t n_results;
+    size_t allocated_results;
+};
+
+static const struct sbrec_logical_dp_group *
+lflow_sync_dpg_cache_find(const struct lflow_sync_info *info,
+                          const struct ovn_dp_group *dpg)
+{
+    struct lflow_sync_dpg_node *node;
+    HMAP_FOR_EACH_WITH_HASH (node, hmap_node, hash_pointer(dpg, 0),
+                             &info->dpg_cache) {
+        if (node->dpg == dpg) {
+            return node->dp_group;
+        }
+    }
+    return NULL;
+}
+
+/* Makes the logical flows in the hash bucket 'bnum' of 'info->lflows' claim
+ * their SB records and compares their datapath groups, without modifying
+ * the SB records.  A logical flow and the SB records it may claim have the
+ * same hash, so they are all handled with the same bucket and the buckets
+ * may be handled by different threads. */
+static void
+lflow_sync_compare_bucket(struct lflow_sync_info *info, size_t bnum)
+{
+    struct sb_lflow_index *sb_index = info->sb_index;
+    struct ovn_lflow *lflow;
+
+    HMAP_FOR_EACH_IN_PARALLEL (lflow, hmap_node, bnum, info->lflows) {
+        const struct sbrec_logical_flow *sbflow = NULL;
+        struct sb_lflow_index_node *node;
+
+        HMAP_FOR_EACH_WITH_HASH (node, hmap_node,
+                                 hmap_node_hash(&lflow->hmap_node),
+                                 &sb_index->rows) {
+            if (node->seqno != sb_index->seqno
+                && ovn_lflow_matches_sbflow(lflow, node->sbflow,
+                                            info->datapaths)) {
+                node->seqno = sb_index->seqno;
+                sbflow = node->sbflow;
+                break;
+            }
+        }
+        if (!sbflow) {
+            continue;
+        }
+
+        bool differs;
+        const struct sbrec_logical_dp_group *known_dp_group =
+            lflow->dpg ? lflow_sync_dpg_cache_find(info, lflow->dpg) : NULL;
+        if (known_dp_group) {
+            /* We know the datapath group in SB that should be used. */
+            differs = known_dp_group != sbflow->logical_dp_group;
+        } else {
+            differs = ovn_lflow_dp_group_differs(lflow, sbflow,
+                                                 info->datapaths);
+            if (!differs && lflow->dpg) {
+                struct lflow_sync_dpg_node *dpg_node = xmalloc(
+                    sizeof *dpg_node);
+                dpg_node->dpg = lflow->dpg;
+                dpg_node->dp_group = sbflow->logical_dp_group;
+                hmap_insert(&info->dpg_cache, &dpg_node->hmap_node,
+                            hash_pointer(lflow->dpg, 0));
+            }
+        }
+
+        if (info->n_results >= info->allocated_results) {
+            info->results = x2nrealloc(info->results,
+                                       &info->allocated_results,
+                                       sizeof *info->results);
+        }
+        struct lflow_sync_result *result = &info->results[info->n_results++];
+        result->lflow = lflow;
+        result->sbflow = sbflow;
+        result->dp_group_differs = differs;
+    }
+}
+
+static void
+lflow_sync_infos_destroy(struct lflow_sync_info *infos, size_t n_infos)
+{
+    for (size_t i = 0; i < n_infos; i++) {
+        struct lflow_sync_dpg_node *node;
+        HMAP_FOR_EACH_POP (node, hmap_node, &infos[i].dpg_cache) {
+            free(node);
+        }
+        hmap_destroy(&infos[i].dpg_cache);
+        free(infos[i].results);
+    }
+    free(infos);
+}
+
+/* Makes every logical flow in 'lflows' claim the first SB record of
+ * 'sb_index' with the same hash that matches it and that was not claimed
+ * yet, and compares their datapath groups.  This is the read-only part of
+ * the sync of the Logical_Flow table, so it is done in the threads of
+ * 'build_lflows_pool' if parallelization is enabled.  Returns '*n_infos'
+ * lflow_sync_info, one per thread, that hold the results, to be freed with
+ * lflow_sync_infos_destroy(). */
+static struct lflow_sync_info *
+lflow_sync_compare(struct hmap *lflows, struct sb_lflow_index *sb_index,
+                   const struct hmap *datapaths, size_t *n_infos)
+{
+    bool parallel = parallelization_state == STATE_USE_PARALLELIZATION;
+    size_t n = parallel ? build_lflows_pool->size : 1;
+    struct lflow_sync_info *infos = xcalloc(n, sizeof *infos);
+
+    for (size_t i = 0; i < n; i++) {
+        infos[i].lflows = lflows;
+        infos[i].sb_index = sb_index;
+        infos[i].datapaths = datapaths;
+        hmap_init(&infos[i].dpg_cache);
+    }
+
+    if (parallel) {
+        struct lswitch_flow_build_info *lsiv = xcalloc(n, sizeof *lsiv);
+
+        for (size_t i = 0; i < n; i++) {
+            lsiv[i].sync = &infos[i];
+            build_lflows_pool->controls[i].data = &lsiv[i];
+        }
+        pool_set_tasks(build_lflows_pool, lflows->mask + 1);
+        run_pool(build_lflows_pool);
+        free(lsiv);
+    } else {
+        for (size_t bnum = 0; bnum <= lflows->mask; bnum++) {
+            lflow_sync_compare_bucket(&infos[0], bnum);
+        }
+    }
+
+    *n_infos = n;
+    return infos;
+}
+
+/* Updates the SB record claimed by the logical flow of 'result', based on
+ * the comparison made by lflow_sync_compare().  Returns the number of
+ * changes that count against max_lflow_changes_per_sb_txn. */
+static size_t
+lflow_sync_apply(struct ovsdb_idl_txn *ovnsb_txn, struct hmap *dp_groups,
+                 const struct lflow_sync_result *result,
+                 bool ovn_internal_version_changed)
+{
+    const struct sbrec_logical_flow *sbflow = result->sbflow;
+    struct ovn_lflow *lflow = result->lflow;
+    struct sbrec_logical_dp_group *dp_group = sbflow->logical_dp_group;
+    size_t n_changes = 0;
+
+    if (ovn_internal_version_changed) {
+        const char *stage_name = smap_get_def(&sbflow->external_ids,
+                                          "stage-name", "");
+        const char *stage_hint = smap_get_def(&sbflow->external_ids,
+                                          "stage-hint", "");
+        const char *source = smap_get_def(&sbflow->external_ids,
+                                          "source", "");
+
+        if (strcmp(stage_name, ovn_stage_to_str(lflow->stage))) {
+            sbrec_logical_flow_update_external_ids_setkey(sbflow,
+             "stage-name", ovn_stage_to_str(lflow->stage));
+        }
+        if (lflow->stage_hint) {
+            if (strcmp(stage_hint, lflow->stage_hint)) {
+                sbrec_logical_flow_update_external_ids_setkey(sbflow,
+                "stage-hint", lflow->stage_hint);
+            }
+        }
+        if (lflow->where) {
+            if (strcmp(source, lflow->where)) {
+                sbrec_logical_flow_update_external_ids_setkey(sbflow,
+                "source", lflow->where);
+            }
+        }
+    }
+
+    /* The threads may have found different SB datapath groups in sync with
+     * the same 'lflow->dpg', only the first one is kept. */
+    bool update_dp_group = result->dp_group_differs;
+    if (!update_dp_group && lflow->dpg && lflow->dpg->dp_group) {
+        update_dp_group = lflow->dpg->dp_group != dp_group;
+    }
+
+    if (update_dp_group) {
+        ovn_sb_set_lflow_logical_dp_group(ovnsb_txn, dp_groups,
+                                          sbflow, lflow->dpg_bitmap);
+        n_changes++;
+    } else if (lflow->dpg && !lflow->dpg->dp_group) {
+        /* Setting relation between unique datapath group and
+         * Sb DB datapath goup. */
+        lflow->dpg->dp_group = dp_group;
+    }
+
+    /* This lflow is now in sync with 'sbflow'. */
+    lflow->sb_uuid = sbflow->header_.uuid;
+    return n_changes;
+}
+
+/* Inserts a new SB Logical_Flow for 'lflow'.  'dp_groups' is only used for
+ * logical flows that apply to more than one datapath. */
+static void
+ovn_lflow_insert_sbrec(struct ovsdb_idl_txn *ovnsb_txn,
+                       struct hmap *dp_groups, struct ovn_lflow *lflow)
+{
+    const char *pipeline = ovn_stage_get_pipeline_name(lflow->stage);
+    uint8_t table = ovn_stage_get_table(lflow->stage);
+
+    const struct sbrec_logical_flow *sbflow =
+        sbrec_logical_flow_insert(ovnsb_txn);
+    if (lflow->od) {
+        sbrec_logical_flow_set_logical_datapath(sbflow, lflow->od->sb);
+    }
+    ovn_sb_set_lflow_logical_dp_group(ovnsb_txn, dp_groups,
+                                      sbflow, lflow->dpg_bitmap);
+    sbrec_logical_flow_set_pipeline(sbflow, pipeline);
+    sbrec_logical_flow_set_table_id(sbflow, table);
+    sbrec_logical_flow_set_priority(sbflow, lflow->priority);
+    sbrec_logical_flow_set_match(sbflow, lflow->match);
+    sbrec_logical_flow_set_actions(sbflow, lflow->actions);
+    if (lflow->io_port || strstr(lflow->actions, OVN_PORT_TEMPLATE_PORT)) {
+        struct smap tags = SMAP_INITIALIZER(&tags);
+        if (lflow->io_port) {
+            smap_add(&tags, "in_out_port", lflow->io_port);
+        }
+        if (strstr(lflow->actions, OVN_PORT_TEMPLATE_PORT)) {
+            smap_add(&tags, "port_template", "true");
+        }
+        sbrec_logical_flow_set_tags(sbflow, &tags);
+        smap_destroy(&tags);
+    }
+    sbrec_logical_flow_set_controller_meter(sbflow, lflow->ctrl_meter);
+
+    /* Trim the source locator lflow->where, which looks something like
+     * "ovn/northd/northd.c:1234", down to just the part following the
+     * last slash, e.g. "northd.c:1234". */
+    const char *slash = strrchr(lflow->where, '/');
+#if _WIN32
+    const char *backslash = strrchr(lflow->where, '\\');
+    if (!slash || backslash > slash) {
+        slash = backslash;
+    }
+#endif
+    const char *where = slash ? slash + 1 : lflow->where;
+
+    struct smap ids = SMAP_INITIALIZER(&ids);
+    smap_add(&ids, "stage-name", ovn_stage_to_str(lflow->stage));
+    smap_add(&ids, "source", where);
+    if (lflow->stage_hint) {
+        smap_add(&ids, "stage-hint", lflow->stage_hint);
+    }
+    sbrec_logical_flow_set_external_ids(sbflow, &ids);
+    smap_destroy(&ids);
+
+    lflow->sb_uuid = sbflow->header_.uuid;
+}
+
 /* Updates the Logical_Flow and Multicast_Group tables in the OVN_SB database,
- * constructing their contents based on the OVN_NB database. */
-void build_lflows(struct lflow_input *input_data,
-                  struct ovsdb_idl_txn *ovnsb_txn)
+ * constructing their contents based on the OVN_NB database.
+ *
+ * 'lflows' is initialized here and keeps all the logical flows once they are
+ * in sync with the OVN_SB database, so that they can be incrementally updated
+ * afterwards by lflow_handle_northd_ls_changes().
+ *
+ * Returns false if only part of the Logical_Flow changes were made in
+ * 'ovnsb_txn', because of NB_Global options:max_lflow_changes_per_sb_txn.
+ * build_lflows() must then be called again once 'ovnsb_txn' committed, to
+ * make the next part of the changes. */
+bool build_lflows(struct lflow_input *input_data,
+                  struct ovsdb_idl_txn *ovnsb_txn,
+                  struct hmap *lflows)
 {
-    struct hmap lflows;
     struct hmap mcast_groups;
     struct hmap igmp_groups;
 
     build_mcast_groups(input_data, input_data->datapaths, input_data->ports,
                        &mcast_groups, &igmp_groups);
 
-    fast_hmap_size_for(&lflows, max_seen_lflow_size);
+    fast_hmap_size_for(lflows, max_seen_lflow_size);
 
+    lflow_arena_enabled = true;
+    OVN_USDT_PROBE(northd, build_lflows_begin,
+                   hmap_count(input_data->datapaths),
+                   hmap_count(input_data->ports));
     build_lswitch_and_lrouter_flows(input_data->datapaths, input_data->ports,
-                                    input_data->port_groups, &lflows,
+                                    input_data->port_groups, lflows,
                                     &mcast_groups, &igmp_groups,
                                     input_data->meter_groups, input_data->lbs,
                                     input_data->bfd_connections);
+    OVN_USDT_PROBE(northd, build_lflows_end, hmap_count(lflows));
+    lflow_arena_enabled = false;
 
     if (parallelization_state == STATE_INIT_HASH_SIZES) {
         parallelization_state = STATE_USE_PARALLELIZATION;
@@ -14007,13 +15965,15 @@ void build_lflows(struct lflow_input *input_data,
     /* Parallel build may result in a suboptimal hash. Resize the
      * hash to a correct size before doing lookups */
 
-    hmap_expand(&lflows);
+    hmap_expand(lflows);
 
-    if (hmap_count(&lflows) > max_seen_lflow_size) {
-        max_seen_lflow_size = hmap_count(&lflows);
+    if (hmap_count(lflows) > max_seen_lflow_size) {
+        max_seen_lflow_size = hmap_count(lflows);
     }
 
     stopwatch_start(LFLOWS_DP_GROUPS_STOPWATCH_NAME, time_msec());
+    OVN_USDT_PROBE(northd, build_lflows_stage_begin,
+                   LFLOWS_DP_GROUPS_STOPWATCH_NAME);
     /* Collecting all unique datapath groups. */
     struct hmap dp_groups = HMAP_INITIALIZER(&dp_groups);
     struct hmap single_dp_lflows;
@@ -14027,26 +15987,23 @@ void build_lflows(struct lflow_input *input_data,
     fast_hmap_size_for(&single_dp_lflows, max_seen_lflow_size);
 
     struct ovn_lflow *lflow;
-    struct hmapx_node *node;
-    HMAP_FOR_EACH_SAFE (lflow, hmap_node, &lflows) {
+    HMAP_FOR_EACH_SAFE (lflow, hmap_node, lflows) {
         uint32_t hash;
         struct ovn_dp_group *dpg;
 
-        ovs_assert(hmapx_count(&lflow->od_group));
+        ovs_assert(lflow->n_ods);
 
-        if (hmapx_count(&lflow->od_group) == 1) {
+        if (lflow->n_ods == 1) {
             /* There is only one datapath, so it should be moved out of the
              * group to a single 'od'. */
-            HMAPX_FOR_EACH (node, &lflow->od_group) {
-                lflow->od = node->data;
-                break;
-            }
-            hmapx_clear(&lflow->od_group);
+            lflow->od = ovn_lflow_get_single_od(lflow);
+            bitmap_free(lflow->dpg_bitmap);
+            lflow->dpg_bitmap = NULL;
 
             /* Logical flow should be re-hashed to allow lookups. */
             hash = hmap_node_hash(&lflow->hmap_node);
             /* Remove from lflows. */
-            hmap_remove(&lflows, &lflow->hmap_node);
+            hmap_remove(lflows, &lflow->hmap_node);
             hash = ovn_logical_flow_hash_datapath(&lflow->od->sb->header_.uuid,
                                                   hash);
             /* Add to single_dp_lflows. */
@@ -14054,11 +16011,12 @@ void build_lflows(struct lflow_input *input_data,
             continue;
         }
 
-        hash = hash_int(hmapx_count(&lflow->od_group), 0);
-        dpg = ovn_dp_group_find(&dp_groups, &lflow->od_group, hash);
+        hash = ovn_dp_group_hash(lflow->dpg_bitmap);
+        dpg = ovn_dp_group_find(&dp_groups, lflow->dpg_bitmap, hash);
         if (!dpg) {
             dpg = xzalloc(sizeof *dpg);
-            hmapx_clone(&dpg->map, &lflow->od_group);
+            dpg->bitmap = bitmap_clone(lflow->dpg_bitmap, n_datapaths);
+            dpg->n_ods = lflow->n_ods;
             hmap_insert(&dp_groups, &dpg->node, hash);
         }
         lflow->dpg = dpg;
@@ -14066,197 +16024,76 @@ void build_lflows(struct lflow_input *input_data,
 
     /* Merge multiple and single dp hashes. */
 
-    fast_hmap_merge(&lflows, &single_dp_lflows);
+    fast_hmap_merge(lflows, &single_dp_lflows);
 
     hmap_destroy(&single_dp_lflows);
 
-    /* Push changes to the Logical_Flow table to database. */
-    const struct sbrec_logical_flow *sbflow;
-    SBREC_LOGICAL_FLOW_TABLE_FOR_EACH_SAFE (sbflow,
-                                     input_data->sbrec_logical_flow_table) {
-        struct sbrec_logical_dp_group *dp_group = sbflow->logical_dp_group;
-        struct ovn_datapath *logical_datapath_od = NULL;
-        size_t i;
-
-        /* Find one valid datapath to get the datapath type. */
-        struct sbrec_datapath_binding *dp = sbflow->logical_datapath;
-        if (dp) {
-            logical_datapath_od = ovn_datapath_from_sbrec(
-                                            input_data->datapaths, dp);
-            if (logical_datapath_od
-                && ovn_datapath_is_stale(logical_datapath_od)) {
-                logical_datapath_od = NULL;
-            }
-        }
-        for (i = 0; dp_group && i < dp_group->n_datapaths; i++) {
-            logical_datapath_od = ovn_datapath_from_sbrec(
-                             input_data->datapaths, dp_group->datapaths[i]);
-            if (logical_datapath_od
-                && !ovn_datapath_is_stale(logical_datapath_od)) {
+    /* Push changes to the Logical_Flow table to database.  Every logical flow
+     * claims the first SB record with the same hash that matches it and that
+     * was not claimed yet, the records left unclaimed are stale. */
+    struct sb_lflow_index *sb_index = input_data->sb_lflow_index;
+    struct sb_lflow_index_node *node;
+    size_t max_changes = max_lflow_changes_per_sb_txn
+                         ? max_lflow_changes_per_sb_txn : SIZE_MAX;
+    size_t n_changes = 0;
+    bool complete = true;
+
+    sb_index->seqno++;
+    size_t n_infos;
+    struct lflow_sync_info *infos = lflow_sync_compare(lflows, sb_index,
+                                                       input_data->datapaths,
+                                                       &n_infos);
+    for (size_t i = 0; i < n_infos; i++) {
+        for (size_t j = 0; j < infos[i].n_results; j++) {
+            n_changes += lflow_sync_apply(
+                ovnsb_txn, &dp_groups, &infos[i].results[j],
+                input_data->ovn_internal_version_changed);
+        }
+    }
+    lflow_sync_infos_destroy(infos, n_infos);
+
+    /* The changes left over once 'max_changes' is reached are made by the
+     * next build_lflows(), in a new transaction. */
+    HMAP_FOR_EACH (node, hmap_node, &sb_index->rows) {
+        if (node->seqno != sb_index->seqno) {
+            if (n_changes >= max_changes) {
+                complete = false;
                 break;
             }
-            logical_datapath_od = NULL;
+            sbrec_logical_flow_delete(node->sbflow);
+            n_changes++;
         }
+    }
 
-        if (!logical_datapath_od) {
-            /* This lflow has no valid logical datapaths. */
-            sbrec_logical_flow_delete(sbflow);
-            continue;
+    OVN_USDT_PROBE(northd, build_lflows_stage_end,
+                   LFLOWS_DP_GROUPS_STOPWATCH_NAME, hmap_count(lflows));
+    stopwatch_stop(LFLOWS_DP_GROUPS_STOPWATCH_NAME, time_msec());
+    HMAP_FOR_EACH (lflow, hmap_node, lflows) {
+        if (uuid_is_zero(&lflow->sb_uuid)) {
+            if (n_changes < max_changes) {
+                ovn_lflow_insert_sbrec(ovnsb_txn, &dp_groups, lflow);
+                n_changes++;
+            } else {
+                complete = false;
+            }
         }
+        /* 'dp_groups' is destroyed below. */
+        lflow->dpg = NULL;
+    }
+    if (!complete) {
+        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
+        VLOG_DBG_RL(&rl, "Logical_Flow changes limited to %"PRIuSIZE" in "
+                    "this transaction, continuing in the next one.",
+                    max_changes);
+    }
 
-        enum ovn_pipeline pipeline
-            = !strcmp(sbflow->pipeline, "ingress") ? P_IN : P_OUT;
-
-        lflow = ovn_lflow_find(
-            &lflows, dp_group ? NULL : logical_datapath_od,
-            ovn_stage_build(ovn_datapath_get_type(logical_datapath_od),
-                            pipeline, sbflow->table_id),
-            sbflow->priority, sbflow->match, sbflow->actions,
-            sbflow->controller_meter, sbflow->hash);
-        if (lflow) {
-            if (input_data->ovn_internal_version_changed) {
-                const char *stage_name = smap_get_def(&sbflow->external_ids,
-                                                  "stage-name", "");
-                const char *stage_hint = smap_get_def(&sbflow->external_ids,
-                                                  "stage-hint", "");
-                const char *source = smap_get_def(&sbflow->external_ids,
-                                                  "source", "");
-
-                if (strcmp(stage_name, ovn_stage_to_str(lflow->stage))) {
-                    sbrec_logical_flow_update_external_ids_setkey(sbflow,
-                     "stage-name", ovn_stage_to_str(lflow->stage));
-                }
-                if (lflow->stage_hint) {
-                    if (strcmp(stage_hint, lflow->stage_hint)) {
-                        sbrec_logical_flow_update_external_ids_setkey(sbflow,
-                        "stage-hint", lflow->stage_hint);
-                    }
-                }
-                if (lflow->where) {
-                    if (strcmp(source, lflow->where)) {
-                        sbrec_logical_flow_update_external_ids_setkey(sbflow,
-                        "source", lflow->where);
-                    }
-                }
-            }
-
-            /* This is a valid lflow.  Checking if the datapath group needs
-             * updates. */
-            bool update_dp_group = false;
-
-            if ((!lflow->dpg && dp_group) || (lflow->dpg && !dp_group)) {
-                /* Need to add or delete datapath group. */
-                update_dp_group = true;
-            } else if (!lflow->dpg && !dp_group) {
-                /* No datapath group and not needed. */
-            } else if (lflow->dpg->dp_group) {
-                /* We know the datapath group in Sb that should be used. */
-                if (lflow->dpg->dp_group != dp_group) {
-                    /* Flow has different datapath group in the database.  */
-                    update_dp_group = true;
-                }
-                /* Datapath group is already up to date. */
-            } else {
-                /* There is a datapath group and we need to perform
-                 * a full comparison. */
-                struct ovn_datapath **od;
-                int n_datapaths = 0;
-
-                od = xmalloc(dp_group->n_datapaths * sizeof *od);
-                /* Check all logical datapaths from the group. */
-                for (i = 0; i < dp_group->n_datapaths; i++) {
-                    od[n_datapaths] = ovn_datapath_from_sbrec(
-                            input_data->datapaths, dp_group->datapaths[i]);
-                    if (!od[n_datapaths]
-                        || ovn_datapath_is_stale(od[n_datapaths])) {
-                        continue;
-                    }
-                    n_datapaths++;
-                }
-
-                if (n_datapaths != hmapx_count(&lflow->od_group)) {
-                    update_dp_group = true;
-                }
-                /* Have to compare datapath groups in full. */
-                for (i = 0; !update_dp_group && i < n_datapaths; i++) {
-                    if (od[i] && !hmapx_contains(&lflow->od_group, od[i])) {
-                        update_dp_group = true;
-                    }
-                }
-                free(od);
-            }
-
-            if (update_dp_group) {
-                ovn_sb_set_lflow_logical_dp_group(ovnsb_txn, &dp_groups,
-                                                  sbflow, &lflow->od_group);
-            } else if (lflow->dpg && !lflow->dpg->dp_group) {
-                /* Setting relation between unique datapath group and
-                 * Sb DB datapath goup. */
-                lflow->dpg->dp_group = dp_group;
-            }
-
-            /* This lflow updated.  Not needed anymore. */
-            ovn_lflow_destroy(&lflows, lflow);
-        } else {
-            sbrec_logical_flow_delete(sbflow);
-        }
-    }
-
-    stopwatch_stop(LFLOWS_DP_GROUPS_STOPWATCH_NAME, time_msec());
-    HMAP_FOR_EACH_SAFE (lflow, hmap_node, &lflows) {
-        const char *pipeline = ovn_stage_get_pipeline_name(lflow->stage);
-        uint8_t table = ovn_stage_get_table(lflow->stage);
-
-        sbflow = sbrec_logical_flow_insert(ovnsb_txn);
-        if (lflow->od) {
-            sbrec_logical_flow_set_logical_datapath(sbflow, lflow->od->sb);
-        }
-        ovn_sb_set_lflow_logical_dp_group(ovnsb_txn, &dp_groups,
-                                          sbflow, &lflow->od_group);
-        sbrec_logical_flow_set_pipeline(sbflow, pipeline);
-        sbrec_logical_flow_set_table_id(sbflow, table);
-        sbrec_logical_flow_set_priority(sbflow, lflow->priority);
-        sbrec_logical_flow_set_match(sbflow, lflow->match);
-        sbrec_logical_flow_set_actions(sbflow, lflow->actions);
-        if (lflow->io_port) {
-            struct smap tags = SMAP_INITIALIZER(&tags);
-            smap_add(&tags, "in_out_port", lflow->io_port);
-            sbrec_logical_flow_set_tags(sbflow, &tags);
-            smap_destroy(&tags);
-        }
-        sbrec_logical_flow_set_controller_meter(sbflow, lflow->ctrl_meter);
-
-        /* Trim the source locator lflow->where, which looks something like
-         * "ovn/northd/northd.c:1234", down to just the part following the
-         * last slash, e.g. "northd.c:1234". */
-        const char *slash = strrchr(lflow->where, '/');
-#if _WIN32
-        const char *backslash = strrchr(lflow->where, '\\');
-        if (!slash || backslash > slash) {
-            slash = backslash;
-        }
-#endif
-        const char *where = slash ? slash + 1 : lflow->where;
-
-        struct smap ids = SMAP_INITIALIZER(&ids);
-        smap_add(&ids, "stage-name", ovn_stage_to_str(lflow->stage));
-        smap_add(&ids, "source", where);
-        if (lflow->stage_hint) {
-            smap_add(&ids, "stage-hint", lflow->stage_hint);
-        }
-        sbrec_logical_flow_set_external_ids(sbflow, &ids);
-        smap_destroy(&ids);
-
-        ovn_lflow_destroy(&lflows, lflow);
-    }
-    hmap_destroy(&lflows);
-
-    struct ovn_dp_group *dpg;
-    HMAP_FOR_EACH_POP (dpg, node, &dp_groups) {
-        hmapx_destroy(&dpg->map);
-        free(dpg);
-    }
-    hmap_destroy(&dp_groups);
+    lflow_n_dp_groups = hmap_count(&dp_groups);
+    struct ovn_dp_group *dpg;
+    HMAP_FOR_EACH_POP (dpg, node, &dp_groups) {
+        bitmap_free(dpg->bitmap);
+        free(dpg);
+    }
+    hmap_destroy(&dp_groups);
 
     /* Push changes to the Multicast_Group table to database. */
     const struct sbrec_multicast_group *sbmc;
@@ -14291,7 +16128,7 @@ void build_lflows(struct lflow_input *input_data,
         sbrec_multicast_group_set_datapath(sbmc, mc->datapath->sb);
         sbrec_multicast_group_set_name(sbmc, mc->group->name);
         sbrec_multicast_group_set_tunnel_key(sbmc, mc->group->key);
-        ovn_multicast_update_sbrec(mc, sbmc);
+        ovn_multicast_set_sbrec(mc, sbmc);
         ovn_multicast_destroy(&mcast_groups, mc);
     }
 
@@ -14303,990 +16140,2838 @@ void build_lflows(struct lflow_input *input_data,
 
     hmap_destroy(&igmp_groups);
     hmap_destroy(&mcast_groups);
+
+    return complete;
 }
 
-static void
-sync_address_set(struct ovsdb_idl_txn *ovnsb_txn, const char *name,
-                 const char **addrs, size_t n_addrs,
-                 struct shash *sb_address_sets)
+/* Destroys all the logical flows in 'lflows' as built by build_lflows(),
+ * including the memory of the lflow arena. */
+void
+lflows_destroy(struct hmap *lflows)
 {
-    const struct sbrec_address_set *sb_address_set;
-    sb_address_set = shash_find_and_delete(sb_address_sets,
-                                           name);
-    if (!sb_address_set) {
-        sb_address_set = sbrec_address_set_insert(ovnsb_txn);
-        sbrec_address_set_set_name(sb_address_set, name);
+    struct ovn_lflow *lflow;
+    HMAP_FOR_EACH_SAFE (lflow, hmap_node, lflows) {
+        ovn_lflow_destroy(lflows, lflow);
     }
+    hmap_destroy(lflows);
+    lflow_arena_clear();
+}
+
+void
+lflows_get_memory_usage(const struct hmap *lflows, struct simap *usage)
+{
+    simap_increase(usage, "lflows", hmap_count(lflows));
+    simap_increase(usage, "lflow_dp_groups", lflow_n_dp_groups);
+    simap_increase(usage, "lflow_nat_cache", nat_lflow_caches_count());
 
-    sbrec_address_set_set_addresses(sb_address_set,
-                                    addrs, n_addrs);
+    ovs_mutex_lock(&lflow_arena_mutex);
+    simap_increase(usage, "lflow_arena_usage-KB",
+                   ROUND_UP(lflow_arena_usage, 1024) / 1024);
+    ovs_mutex_unlock(&lflow_arena_mutex);
 }
 
-/* OVN_Southbound Address_Set table contains same records as in north
- * bound, plus the records generated from Port_Group table in north bound.
- *
- * There are 2 records generated from each port group, one for IPv4, and
- * one for IPv6, named in the format: <port group name>_ip4 and
- * <port group name>_ip6 respectively. MAC addresses are ignored.
- *
- * We always update OVN_Southbound to match the Address_Set and Port_Group
- * in OVN_Northbound, so that the address sets used in Logical_Flows in
- * OVN_Southbound is checked against the proper set.*/
+/* Returns true if the logical flows of 'op' can be removed without touching
+ * the flows of other datapaths, i.e., if none of them is shared through a
+ * datapath group. */
+static bool
+ovn_port_lflows_can_be_removed(const struct ovn_port *op)
+{
+    const struct lflow_ref_node *lfrn;
+    LIST_FOR_EACH (lfrn, lflow_list_node, &op->lflows) {
+        if (!lfrn->lflow->od) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Removes the references of 'op' to its logical flows, and deletes the flows
+ * that are not needed by any other object from 'lflows' and from the SB. */
 static void
-sync_address_sets(struct northd_input *input_data,
-                  struct ovsdb_idl_txn *ovnsb_txn,
-                  struct hmap *datapaths)
+ovn_port_remove_lflows(struct ovn_port *op, struct ovsdb_idl *ovnsb_idl,
+                       struct hmap *lflows)
 {
-    struct shash sb_address_sets = SHASH_INITIALIZER(&sb_address_sets);
+    struct lflow_ref_node *lfrn;
+    LIST_FOR_EACH_SAFE (lfrn, lflow_list_node, &op->lflows) {
+        struct ovn_lflow *lflow = lfrn->lflow;
 
-    const struct sbrec_address_set *sb_address_set;
-    SBREC_ADDRESS_SET_TABLE_FOR_EACH (sb_address_set,
-                                   input_data->sbrec_address_set_table) {
-        shash_add(&sb_address_sets, sb_address_set->name, sb_address_set);
+        lflow_ref_node_destroy(lfrn);
+        if (lflow->untracked_ref
+            || !ovs_list_is_empty(&lflow->referenced_by)) {
+            continue;
+        }
+
+        const struct sbrec_logical_flow *sbflow =
+            sbrec_logical_flow_get_for_uuid(ovnsb_idl, &lflow->sb_uuid);
+        if (sbflow) {
+            sbrec_logical_flow_delete(sbflow);
+        }
+        ovn_lflow_destroy(lflows, lflow);
     }
+}
 
-    /* Service monitor MAC. */
-    const char *svc_monitor_macp = svc_monitor_mac;
-    sync_address_set(ovnsb_txn, "svc_monitor_mac", &svc_monitor_macp, 1,
-                     &sb_address_sets);
+/* Generates the logical flows of 'op', adds the ones that don't exist yet to
+ * 'lflows' and to the SB and links all of them to 'op'.  Returns false if the
+ * new flows can't be added incrementally. */
+static bool
+ovn_port_add_lflows(struct ovn_port *op, struct lflow_input *lflow_input,
+                    struct ovsdb_idl_txn *ovnsb_txn, struct hmap *lflows)
+{
+    struct hmap tmp_lflows;
+    struct hmap tmp_mcgroups = HMAP_INITIALIZER(&tmp_mcgroups);
+    struct hmap tmp_igmp_groups = HMAP_INITIALIZER(&tmp_igmp_groups);
+    struct hmap dhcp_opts_templates = HMAP_INITIALIZER(&dhcp_opts_templates);
+    struct lswitch_flow_build_info lsi = {
+        .datapaths = lflow_input->datapaths,
+        .ports = lflow_input->ports,
+        .port_groups = lflow_input->port_groups,
+        .dhcp_opts_templates = &dhcp_opts_templates,
+        .lflows = &tmp_lflows,
+        .mcgroups = &tmp_mcgroups,
+        .igmp_groups = &tmp_igmp_groups,
+        .meter_groups = lflow_input->meter_groups,
+        .lbs = lflow_input->lbs,
+        .bfd_connections = lflow_input->bfd_connections,
+        .match = DS_EMPTY_INITIALIZER,
+        .actions = DS_EMPTY_INITIALIZER,
+    };
 
-    /* sync port group generated address sets first */
-    const struct nbrec_port_group *nb_port_group;
-    NBREC_PORT_GROUP_TABLE_FOR_EACH (nb_port_group,
-                                     input_data->nbrec_port_group_table) {
-        struct svec ipv4_addrs = SVEC_EMPTY_INITIALIZER;
-        struct svec ipv6_addrs = SVEC_EMPTY_INITIALIZER;
-        for (size_t i = 0; i < nb_port_group->n_ports; i++) {
-            for (size_t j = 0; j < nb_port_group->ports[i]->n_addresses; j++) {
-                const char *addrs = nb_port_group->ports[i]->addresses[j];
-                if (!is_dynamic_lsp_address(addrs)) {
-                    split_addresses(addrs, &ipv4_addrs, &ipv6_addrs);
-                }
-            }
-            if (nb_port_group->ports[i]->dynamic_addresses) {
-                split_addresses(nb_port_group->ports[i]->dynamic_addresses,
-                                &ipv4_addrs, &ipv6_addrs);
-            }
-        }
-        char *ipv4_addrs_name = xasprintf("%s_ip4", nb_port_group->name);
-        char *ipv6_addrs_name = xasprintf("%s_ip6", nb_port_group->name);
-        sync_address_set(ovnsb_txn, ipv4_addrs_name,
-                         /* "char **" is not compatible with "const char **" */
-                         (const char **)ipv4_addrs.names,
-                         ipv4_addrs.n, &sb_address_sets);
-        sync_address_set(ovnsb_txn, ipv6_addrs_name,
-                         /* "char **" is not compatible with "const char **" */
-                         (const char **)ipv6_addrs.names,
-                         ipv6_addrs.n, &sb_address_sets);
-        free(ipv4_addrs_name);
-        free(ipv6_addrs_name);
-        svec_destroy(&ipv4_addrs);
-        svec_destroy(&ipv6_addrs);
+    /* The flows are first generated in a separate table, so that they can
+     * be compared with the existing ones. */
+    fast_hmap_size_for(&tmp_lflows, 128);
+    thread_lflow_counter = 0;
+    build_dhcp_opts_templates_for_port(op, &dhcp_opts_templates);
+    build_lswitch_and_lrouter_iterate_by_op(op, &lsi);
+    destroy_dhcp_opts_templates(&dhcp_opts_templates);
+    if (parallelization_state == STATE_USE_PARALLELIZATION) {
+        /* hmap_insert_fast() doesn't maintain the hmap size. */
+        tmp_lflows.n = thread_lflow_counter;
     }
+    ds_destroy(&lsi.match);
+    ds_destroy(&lsi.actions);
 
-    /* Sync router load balancer VIP generated address sets. */
-    struct ovn_datapath *od;
-    HMAP_FOR_EACH (od, key_node, datapaths) {
-        if (!od->nbr) {
+    bool ret = hmap_is_empty(&tmp_mcgroups);
+    struct ovn_lflow *lflow;
+    HMAP_FOR_EACH_SAFE (lflow, hmap_node, &tmp_lflows) {
+        uint32_t hash = hmap_node_hash(&lflow->hmap_node);
+        hmap_remove(&tmp_lflows, &lflow->hmap_node);
+
+        if (!ret || lflow->n_ods != 1) {
+            ret = false;
+            ovn_lflow_destroy(NULL, lflow);
             continue;
         }
 
-        if (sset_count(&od->lb_ips_v4_reachable)) {
-            char *ipv4_addrs_name = lr_lb_address_set_name(od, AF_INET);
-            const char **ipv4_addrs = sset_array(&od->lb_ips_v4_reachable);
+        /* Logical flows of a single datapath don't use datapath groups,
+         * see build_lflows(). */
+        struct ovn_datapath *od = ovn_lflow_get_single_od(lflow);
+        bitmap_free(lflow->dpg_bitmap);
+        lflow->dpg_bitmap = NULL;
+        lflow->od = od;
 
-            sync_address_set(ovnsb_txn, ipv4_addrs_name, ipv4_addrs,
-                             sset_count(&od->lb_ips_v4_reachable),
-                             &sb_address_sets);
-            free(ipv4_addrs_name);
-            free(ipv4_addrs);
+        struct ovn_lflow *old_lflow =
+            ovn_lflow_find(lflows, NULL, lflow->stage, lflow->priority,
+                           lflow->match, lflow->actions, lflow->ctrl_meter,
+                           hash);
+        if (!old_lflow || !bitmap_is_set(old_lflow->dpg_bitmap, od->index)) {
+            hash = ovn_logical_flow_hash_datapath(&od->sb->header_.uuid,
+                                                  hash);
+            old_lflow = ovn_lflow_find(lflows, od, lflow->stage,
+                                       lflow->priority, lflow->match,
+                                       lflow->actions, lflow->ctrl_meter,
+                                       hash);
         }
 
-        if (sset_count(&od->lb_ips_v6_reachable)) {
-            char *ipv6_addrs_name = lr_lb_address_set_name(od, AF_INET6);
-            const char **ipv6_addrs = sset_array(&od->lb_ips_v6_reachable);
-
-            sync_address_set(ovnsb_txn, ipv6_addrs_name, ipv6_addrs,
-                             sset_count(&od->lb_ips_v6_reachable),
-                             &sb_address_sets);
-            free(ipv6_addrs_name);
-            free(ipv6_addrs);
+        if (old_lflow) {
+            /* The flow already exists, e.g., a port with the same addresses,
+             * only move the references. */
+            ovn_lflow_move_refs(old_lflow, lflow);
+            ovn_lflow_destroy(NULL, lflow);
+        } else {
+            hmap_insert(lflows, &lflow->hmap_node, hash);
+            ovn_lflow_insert_sbrec(ovnsb_txn, NULL, lflow);
         }
     }
+    hmap_destroy(&tmp_lflows);
 
-    /* sync user defined address sets, which may overwrite port group
-     * generated address sets if same name is used */
-    const struct nbrec_address_set *nb_address_set;
-    NBREC_ADDRESS_SET_TABLE_FOR_EACH (nb_address_set,
-                              input_data->nbrec_address_set_table) {
-        sync_address_set(ovnsb_txn, nb_address_set->name,
-            /* "char **" is not compatible with "const char **" */
-            (const char **)nb_address_set->addresses,
-            nb_address_set->n_addresses, &sb_address_sets);
+    struct ovn_multicast *mc;
+    HMAP_FOR_EACH_SAFE (mc, hmap_node, &tmp_mcgroups) {
+        ovn_multicast_destroy(&tmp_mcgroups, mc);
     }
+    hmap_destroy(&tmp_mcgroups);
+    hmap_destroy(&tmp_igmp_groups);
 
-    struct shash_node *node;
-    SHASH_FOR_EACH_SAFE (node, &sb_address_sets) {
-        sbrec_address_set_delete(node->data);
-        shash_delete(&sb_address_sets, node);
-    }
-    shash_destroy(&sb_address_sets);
+    return ret;
 }
 
-/* Each port group in Port_Group table in OVN_Northbound has a corresponding
- * entry in Port_Group table in OVN_Southbound. In OVN_Northbound the entries
- * contains lport uuids, while in OVN_Southbound we store the lport names.
- */
-static void
-sync_port_groups(struct northd_input *input_data,
-                struct ovsdb_idl_txn *ovnsb_txn,
-                 struct hmap *pgs)
+/* Returns the datapath group of 'dpg_bitmap' in 'dp_groups', adding it if it
+ * doesn't exist yet.  'sb_dp_group', if nonnull, is the SB record of the
+ * group. */
+static struct ovn_dp_group *
+ovn_dp_group_get(struct hmap *dp_groups, const unsigned long *dpg_bitmap,
+                 size_t n_ods, struct sbrec_logical_dp_group *sb_dp_group)
 {
-    struct shash sb_port_groups = SHASH_INITIALIZER(&sb_port_groups);
-
-    const struct sbrec_port_group *sb_port_group;
-    SBREC_PORT_GROUP_TABLE_FOR_EACH (sb_port_group,
-                               input_data->sbrec_port_group_table) {
-        shash_add(&sb_port_groups, sb_port_group->name, sb_port_group);
+    uint32_t hash = ovn_dp_group_hash(dpg_bitmap);
+    struct ovn_dp_group *dpg = ovn_dp_group_find(dp_groups, dpg_bitmap, hash);
+    if (!dpg) {
+        dpg = xzalloc(sizeof *dpg);
+        dpg->bitmap = bitmap_clone(dpg_bitmap, n_datapaths);
+        dpg->n_ods = n_ods;
+        hmap_insert(dp_groups, &dpg->node, hash);
     }
+    if (!dpg->dp_group) {
+        dpg->dp_group = sb_dp_group;
+    }
+    return dpg;
+}
 
-    struct ds sb_name = DS_EMPTY_INITIALIZER;
-
-    struct ovn_port_group *pg;
-    HMAP_FOR_EACH (pg, key_node, pgs) {
-
-        struct ovn_port_group_ls *pg_ls;
-        HMAP_FOR_EACH (pg_ls, key_node, &pg->nb_lswitches) {
-            get_sb_port_group_name(pg->nb_pg->name, pg_ls->od->sb->tunnel_key,
-                                   &sb_name);
-            sb_port_group = shash_find_and_delete(&sb_port_groups,
-                                                  ds_cstr(&sb_name));
-            if (!sb_port_group) {
-                sb_port_group = sbrec_port_group_insert(ovnsb_txn);
-                sbrec_port_group_set_name(sb_port_group, ds_cstr(&sb_name));
-            }
-
-            const char **nb_port_names = xcalloc(pg_ls->n_ports,
-                                                 sizeof *nb_port_names);
-            for (size_t i = 0; i < pg_ls->n_ports; i++) {
-                nb_port_names[i] = pg_ls->ports[i]->nbsp->name;
-            }
-            sbrec_port_group_set_ports(sb_port_group,
-                                       nb_port_names,
-                                       pg_ls->n_ports);
-            free(nb_port_names);
+/* Looks up the logical flow of 'lflows' that is identical to 'lflow', which
+ * is not in 'lflows' and whose hash is 'hash'.  Returns true, with '*found'
+ * set to the existing flow or to NULL, if 'lflow' can be added to 'lflows'
+ * as it is.  Returns false if the flows with the same contents would have
+ * to be merged into a different datapath group, which isn't handled
+ * incrementally. */
+static bool
+ovn_lflow_find_for_update(const struct hmap *lflows,
+                          const struct ovn_lflow *lflow, uint32_t hash,
+                          struct ovn_lflow **found)
+{
+    uint32_t dpg_hash = ovn_logical_flow_hash(
+        ovn_stage_get_table(lflow->stage),
+        ovn_stage_get_pipeline(lflow->stage), lflow->priority,
+        lflow->match, lflow->actions);
+    struct ovn_lflow *group_lflow =
+        ovn_lflow_find(lflows, NULL, lflow->stage, lflow->priority,
+                       lflow->match, lflow->actions, lflow->ctrl_meter,
+                       dpg_hash);
+
+    *found = NULL;
+    if (lflow->od) {
+        if (group_lflow) {
+            return false;
         }
+        *found = ovn_lflow_find(lflows, lflow->od, lflow->stage,
+                                lflow->priority, lflow->match,
+                                lflow->actions, lflow->ctrl_meter, hash);
+        return true;
     }
-    ds_destroy(&sb_name);
 
-    struct shash_node *node;
-    SHASH_FOR_EACH_SAFE (node, &sb_port_groups) {
-        sbrec_port_group_delete(node->data);
-        shash_delete(&sb_port_groups, node);
+    if (group_lflow) {
+        *found = group_lflow;
+        return bitmap_equal(group_lflow->dpg_bitmap, lflow->dpg_bitmap,
+                            n_datapaths);
     }
-    shash_destroy(&sb_port_groups);
-}
-
-struct band_entry {
-    int64_t rate;
-    int64_t burst_size;
-    const char *action;
-};
-
-static int
-band_cmp(const void *band1_, const void *band2_)
-{
-    const struct band_entry *band1p = band1_;
-    const struct band_entry *band2p = band2_;
 
-    if (band1p->rate != band2p->rate) {
-        return band1p->rate > band2p->rate ? -1 : 1;
-    } else if (band1p->burst_size != band2p->burst_size) {
-        return band1p->burst_size > band2p->burst_size ? -1 : 1;
-    } else {
-        return strcmp(band1p->action, band2p->action);
+    size_t index;
+    BITMAP_FOR_EACH_1 (index, n_datapaths, lflow->dpg_bitmap) {
+        struct ovn_datapath *od = datapaths_array[index];
+        uint32_t od_hash =
+            ovn_logical_flow_hash_datapath(&od->sb->header_.uuid, dpg_hash);
+        if (ovn_lflow_find(lflows, od, lflow->stage, lflow->priority,
+                           lflow->match, lflow->actions, lflow->ctrl_meter,
+                           od_hash)) {
+            return false;
+        }
     }
+    return true;
 }
 
+/* Regenerates the logical flows of 'lb' and applies the differences with the
+ * current ones to 'lflows' and to the SB.  Returns false, without modifying
+ * anything, if the new flows can't be applied incrementally, i.e., if they
+ * differ from flows that are shared with other objects or that use a larger
+ * datapath group. */
 static bool
-bands_need_update(const struct nbrec_meter *nb_meter,
-                  const struct sbrec_meter *sb_meter)
+ovn_northd_lb_update_lflows(struct ovn_northd_lb *lb,
+                            struct lflow_input *lflow_input,
+                            struct ovsdb_idl_txn *ovnsb_txn,
+                            struct hmap *lflows)
 {
-    if (nb_meter->n_bands != sb_meter->n_bands) {
-        return true;
-    }
+    struct ovsdb_idl *ovnsb_idl = ovsdb_idl_txn_get_idl(ovnsb_txn);
+    struct hmapx old_lflows = HMAPX_INITIALIZER(&old_lflows);
+    struct hmapx old_refs = HMAPX_INITIALIZER(&old_refs);
+    struct hmap dp_groups = HMAP_INITIALIZER(&dp_groups);
+    struct lflow_ref_node *lfrn;
+    struct hmapx_node *node;
 
-    /* A single band is the most common scenario, so speed up that
-     * check. */
-    if (nb_meter->n_bands == 1) {
-        struct nbrec_meter_band *nb_band = nb_meter->bands[0];
-        struct sbrec_meter_band *sb_band = sb_meter->bands[0];
+    /* The new flows are referenced by 'lb->lflows', keep the current
+     * references aside until the new flows are applied. */
+    struct ovs_list old_lflow_refs;
+    ovs_list_move(&old_lflow_refs, &lb->lflows);
+    ovs_list_init(&lb->lflows);
+    LIST_FOR_EACH (lfrn, lflow_list_node, &old_lflow_refs) {
+        hmapx_add(&old_refs, lfrn);
+        if (!hmapx_add(&old_lflows, lfrn->lflow) || !lfrn->lflow->dpg_bitmap) {
+            continue;
+        }
 
-        return !(nb_band->rate == sb_band->rate
-                 && nb_band->burst_size == sb_band->burst_size
-                 && !strcmp(sb_band->action, nb_band->action));
+        /* Reuse the SB datapath groups of the current flows, the groups of
+         * the new flows are most likely the same. */
+        const struct sbrec_logical_flow *sbflow =
+            sbrec_logical_flow_get_for_uuid(ovnsb_idl, &lfrn->lflow->sb_uuid);
+        ovn_dp_group_get(&dp_groups, lfrn->lflow->dpg_bitmap,
+                         lfrn->lflow->n_ods,
+                         sbflow ? sbflow->logical_dp_group : NULL);
+    }
+
+    struct hmap tmp_lflows;
+    struct hmap tmp_mcgroups = HMAP_INITIALIZER(&tmp_mcgroups);
+    struct hmap tmp_igmp_groups = HMAP_INITIALIZER(&tmp_igmp_groups);
+    struct lswitch_flow_build_info lsi = {
+        .datapaths = lflow_input->datapaths,
+        .ports = lflow_input->ports,
+        .port_groups = lflow_input->port_groups,
+        .lflows = &tmp_lflows,
+        .mcgroups = &tmp_mcgroups,
+        .igmp_groups = &tmp_igmp_groups,
+        .meter_groups = lflow_input->meter_groups,
+        .lbs = lflow_input->lbs,
+        .bfd_connections = lflow_input->bfd_connections,
+        .match = DS_EMPTY_INITIALIZER,
+        .actions = DS_EMPTY_INITIALIZER,
+    };
+
+    fast_hmap_size_for(&tmp_lflows, 128);
+    thread_lflow_counter = 0;
+    build_lb_lflows(lb, &lsi);
+    if (parallelization_state == STATE_USE_PARALLELIZATION) {
+        /* hmap_insert_fast() doesn't maintain the hmap size. */
+        tmp_lflows.n = thread_lflow_counter;
     }
+    ds_destroy(&lsi.match);
+    ds_destroy(&lsi.actions);
+    hmap_destroy(&tmp_mcgroups);
+    hmap_destroy(&tmp_igmp_groups);
 
-    /* Place the Northbound entries in sorted order. */
-    struct band_entry *nb_bands;
-    nb_bands = xmalloc(sizeof *nb_bands * nb_meter->n_bands);
-    for (size_t i = 0; i < nb_meter->n_bands; i++) {
-        struct nbrec_meter_band *nb_band = nb_meter->bands[i];
+    /* Logical flows of a single datapath don't use datapath groups, see
+     * build_lflows(). */
+    struct hmap new_lflows = HMAP_INITIALIZER(&new_lflows);
+    struct ovn_lflow *lflow;
+    HMAP_FOR_EACH_POP (lflow, hmap_node, &tmp_lflows) {
+        uint32_t hash = hmap_node_hash(&lflow->hmap_node);
+        if (lflow->n_ods == 1) {
+            lflow->od = ovn_lflow_get_single_od(lflow);
+            bitmap_free(lflow->dpg_bitmap);
+            lflow->dpg_bitmap = NULL;
+            hash = ovn_logical_flow_hash_datapath(&lflow->od->sb->header_.uuid,
+                                                  hash);
+        }
+        hmap_insert(&new_lflows, &lflow->hmap_node, hash);
+    }
+    hmap_destroy(&tmp_lflows);
 
-        nb_bands[i].rate = nb_band->rate;
-        nb_bands[i].burst_size = nb_band->burst_size;
-        nb_bands[i].action = nb_band->action;
+    /* Check all the differences first.  The current flows that are not
+     * generated anymore are deleted, so they must be used by 'lb' only. */
+    struct hmapx kept_lflows = HMAPX_INITIALIZER(&kept_lflows);
+    bool ret = true;
+    HMAP_FOR_EACH (lflow, hmap_node, &new_lflows) {
+        struct ovn_lflow *old_lflow;
+        if (!ovn_lflow_find_for_update(lflows, lflow,
+                                       hmap_node_hash(&lflow->hmap_node),
+                                       &old_lflow)) {
+            ret = false;
+            break;
+        }
+        if (old_lflow) {
+            hmapx_add(&kept_lflows, old_lflow);
+        }
+    }
+    HMAPX_FOR_EACH (node, &old_lflows) {
+        struct ovn_lflow *old_lflow = node->data;
+        if (!ret || hmapx_contains(&kept_lflows, old_lflow)) {
+            continue;
+        }
+        if (old_lflow->untracked_ref) {
+            ret = false;
+            break;
+        }
+        LIST_FOR_EACH (lfrn, ref_list_node, &old_lflow->referenced_by) {
+            if (!hmapx_contains(&old_refs, lfrn)) {
+                ret = false;
+                break;
+            }
+        }
     }
-    qsort(nb_bands, nb_meter->n_bands, sizeof *nb_bands, band_cmp);
 
-    /* Place the Southbound entries in sorted order. */
-    struct band_entry *sb_bands;
-    sb_bands = xmalloc(sizeof *sb_bands * sb_meter->n_bands);
-    for (size_t i = 0; i < sb_meter->n_bands; i++) {
-        struct sbrec_meter_band *sb_band = sb_meter->bands[i];
+    if (!ret) {
+        /* Drop the new flows and their references and restore the current
+         * ones. */
+        HMAP_FOR_EACH_SAFE (lflow, hmap_node, &new_lflows) {
+            ovn_lflow_destroy(&new_lflows, lflow);
+        }
+        ovs_list_move(&lb->lflows, &old_lflow_refs);
+        goto out;
+    }
 
-        sb_bands[i].rate = sb_band->rate;
-        sb_bands[i].burst_size = sb_band->burst_size;
-        sb_bands[i].action = sb_band->action;
+    LIST_FOR_EACH_SAFE (lfrn, lflow_list_node, &old_lflow_refs) {
+        lflow_ref_node_destroy(lfrn);
     }
-    qsort(sb_bands, sb_meter->n_bands, sizeof *sb_bands, band_cmp);
+    HMAPX_FOR_EACH (node, &old_lflows) {
+        struct ovn_lflow *old_lflow = node->data;
+        if (hmapx_contains(&kept_lflows, old_lflow)) {
+            continue;
+        }
 
-    bool need_update = false;
-    for (size_t i = 0; i < nb_meter->n_bands; i++) {
-        if (nb_bands[i].rate != sb_bands[i].rate
-            || nb_bands[i].burst_size != sb_bands[i].burst_size
-            || strcmp(nb_bands[i].action, sb_bands[i].action)) {
-            need_update = true;
-            goto done;
+        const struct sbrec_logical_flow *sbflow =
+            sbrec_logical_flow_get_for_uuid(ovnsb_idl, &old_lflow->sb_uuid);
+        if (sbflow) {
+            sbrec_logical_flow_delete(sbflow);
         }
+        ovn_lflow_destroy(lflows, old_lflow);
     }
 
-done:
-    free(nb_bands);
-    free(sb_bands);
+    HMAP_FOR_EACH_POP (lflow, hmap_node, &new_lflows) {
+        uint32_t hash = hmap_node_hash(&lflow->hmap_node);
+        struct ovn_lflow *old_lflow =
+            ovn_lflow_find(lflows, lflow->od, lflow->stage, lflow->priority,
+                           lflow->match, lflow->actions, lflow->ctrl_meter,
+                           hash);
+        if (old_lflow) {
+            ovn_lflow_move_refs(old_lflow, lflow);
+            ovn_lflow_destroy(NULL, lflow);
+            continue;
+        }
 
-    return need_update;
-}
+        hmap_insert(lflows, &lflow->hmap_node, hash);
+        if (lflow->dpg_bitmap) {
+            ovn_dp_group_get(&dp_groups, lflow->dpg_bitmap, lflow->n_ods,
+                             NULL);
+        }
+        ovn_lflow_insert_sbrec(ovnsb_txn, &dp_groups, lflow);
+    }
 
-static void
-sync_meters_iterate_nb_meter(struct ovsdb_idl_txn *ovnsb_txn,
-                             const char *meter_name,
-                             const struct nbrec_meter *nb_meter,
-                             struct shash *sb_meters,
-                             struct sset *used_sb_meters)
-{
-    const struct sbrec_meter *sb_meter;
-    bool new_sb_meter = false;
+out:
+    hmap_destroy(&new_lflows);
+    hmapx_destroy(&kept_lflows);
+    hmapx_destroy(&old_lflows);
+    hmapx_destroy(&old_refs);
 
-    sb_meter = shash_find_data(sb_meters, meter_name);
-    if (!sb_meter) {
-        sb_meter = sbrec_meter_insert(ovnsb_txn);
-        sbrec_meter_set_name(sb_meter, meter_name);
-        shash_add(sb_meters, sb_meter->name, sb_meter);
-        new_sb_meter = true;
+    struct ovn_dp_group *dpg;
+    HMAP_FOR_EACH_POP (dpg, node, &dp_groups) {
+        bitmap_free(dpg->bitmap);
+        free(dpg);
     }
-    sset_add(used_sb_meters, meter_name);
+    hmap_destroy(&dp_groups);
 
-    if (new_sb_meter || bands_need_update(nb_meter, sb_meter)) {
-        struct sbrec_meter_band **sb_bands;
-        sb_bands = xcalloc(nb_meter->n_bands, sizeof *sb_bands);
-        for (size_t i = 0; i < nb_meter->n_bands; i++) {
-            const struct nbrec_meter_band *nb_band = nb_meter->bands[i];
+    return ret;
+}
 
-            sb_bands[i] = sbrec_meter_band_insert(ovnsb_txn);
+/* Adds 'op' to, or removes it from, the flood multicast groups of its
+ * logical switch, as build_mcast_groups() would do for a regular VIF.
+ * Returns false if the groups don't exist in the SB. */
+static bool
+ovn_port_sync_flood_mcast_groups(const struct ovn_port *op,
+                                 struct lflow_input *lflow_input)
+{
+    const struct sbrec_multicast_group *sbmc_flood =
+        mcast_group_lookup(lflow_input->sbrec_mcast_group_by_name_dp,
+                           MC_FLOOD, op->od->sb);
+    const struct sbrec_multicast_group *sbmc_flood_l2 =
+        mcast_group_lookup(lflow_input->sbrec_mcast_group_by_name_dp,
+                           MC_FLOOD_L2, op->od->sb);
+    if (!sbmc_flood || !sbmc_flood_l2) {
+        return false;
+    }
 
-            sbrec_meter_band_set_action(sb_bands[i], nb_band->action);
-            sbrec_meter_band_set_rate(sb_bands[i], nb_band->rate);
-            sbrec_meter_band_set_burst_size(sb_bands[i],
-                                            nb_band->burst_size);
+    if (lsp_is_enabled(op->nbsp)) {
+        sbrec_multicast_group_update_ports_addvalue(sbmc_flood, op->sb);
+        sbrec_multicast_group_update_ports_addvalue(sbmc_flood_l2, op->sb);
+    } else {
+        sbrec_multicast_group_update_ports_delvalue(sbmc_flood, op->sb);
+        sbrec_multicast_group_update_ports_delvalue(sbmc_flood_l2, op->sb);
+    }
+    return true;
+}
+
+/* Updates 'lflows' and the SB Logical_Flow and Multicast_Group tables for
+ * the VIFs that were added, updated or deleted incrementally by
+ * northd_handle_ls_changes() and northd_handle_lsp_changes().  Only the
+ * logical flows that were generated for these ports are regenerated.
+ *
+ * Returns false if a full recompute is needed, in which case 'lflows' may
+ * have been partially updated. */
+bool
+lflow_handle_northd_ls_changes(struct ovsdb_idl_txn *ovnsb_txn,
+                               struct tracked_ls_changes *ls_changes,
+                               struct lflow_input *lflow_input,
+                               struct hmap *lflows)
+{
+    struct ovsdb_idl *ovnsb_idl = ovsdb_idl_txn_get_idl(ovnsb_txn);
+    struct ls_change *ls_change;
+    struct ovn_port *op;
+
+    /* Check all the changes first, so that nothing is modified if a
+     * recompute is needed. */
+    HMAP_FOR_EACH (ls_change, hmap_node, &ls_changes->updated) {
+        LIST_FOR_EACH (op, list, &ls_change->deleted_ports) {
+            if (!ovn_port_lflows_can_be_removed(op)) {
+                return false;
+            }
+        }
+        LIST_FOR_EACH (op, list, &ls_change->updated_ports) {
+            if (!ovn_port_lflows_can_be_removed(op)
+                || op->mcast_info.flood || op->mcast_info.flood_reports) {
+                return false;
+            }
+        }
+        LIST_FOR_EACH (op, list, &ls_change->added_ports) {
+            if (op->mcast_info.flood || op->mcast_info.flood_reports) {
+                return false;
+            }
         }
-        sbrec_meter_set_bands(sb_meter, sb_bands, nb_meter->n_bands);
-        free(sb_bands);
     }
 
-    sbrec_meter_set_unit(sb_meter, nb_meter->unit);
-}
+    HMAP_FOR_EACH (ls_change, hmap_node, &ls_changes->updated) {
+        /* The SB Port_Binding of the deleted ports is removed from the
+         * Multicast_Group ports by the SB database, as they are weak
+         * references. */
+        LIST_FOR_EACH (op, list, &ls_change->deleted_ports) {
+            ovn_port_remove_lflows(op, ovnsb_idl, lflows);
+        }
 
-static void
-sync_acl_fair_meter(struct ovsdb_idl_txn *ovnsb_txn,
-                    struct shash *meter_groups,
-                    const struct nbrec_acl *acl, struct shash *sb_meters,
-                    struct sset *used_sb_meters)
-{
-    const struct nbrec_meter *nb_meter =
-        fair_meter_lookup_by_name(meter_groups, acl->meter);
+        LIST_FOR_EACH (op, list, &ls_change->updated_ports) {
+            ovn_port_remove_lflows(op, ovnsb_idl, lflows);
+            if (!ovn_port_add_lflows(op, lflow_input, ovnsb_txn, lflows)
+                || !ovn_port_sync_flood_mcast_groups(op, lflow_input)) {
+                return false;
+            }
+        }
 
-    if (!nb_meter) {
-        return;
+        LIST_FOR_EACH (op, list, &ls_change->added_ports) {
+            if (!ovn_port_add_lflows(op, lflow_input, ovnsb_txn, lflows)
+                || !ovn_port_sync_flood_mcast_groups(op, lflow_input)) {
+                return false;
+            }
+        }
     }
 
-    char *meter_name = alloc_acl_log_unique_meter_name(acl);
-    sync_meters_iterate_nb_meter(ovnsb_txn, meter_name, nb_meter, sb_meters,
-                                 used_sb_meters);
-    free(meter_name);
+    return true;
 }
 
-/* Each entry in the Meter and Meter_Band tables in OVN_Northbound have
- * a corresponding entries in the Meter and Meter_Band tables in
- * OVN_Southbound. Additionally, ACL logs that use fair meters have
- * a private copy of its meter in the SB table.
- */
-static void
-sync_meters(struct northd_input *input_data,
-            struct ovsdb_idl_txn *ovnsb_txn,
-            struct shash *meter_groups)
+/* Regenerates the logical flows of the load balancers whose backends were
+ * updated incrementally by northd_handle_lb_changes().
+ *
+ * Returns false if a full recompute is needed, in which case 'lflows' may
+ * have been partially updated. */
+bool
+lflow_handle_northd_lb_changes(struct ovsdb_idl_txn *ovnsb_txn,
+                               struct tracked_lb_changes *lb_changes,
+                               struct lflow_input *lflow_input,
+                               struct hmap *lflows)
 {
-    struct shash sb_meters = SHASH_INITIALIZER(&sb_meters);
-    struct sset used_sb_meters = SSET_INITIALIZER(&used_sb_meters);
+    struct hmapx_node *node;
+    HMAPX_FOR_EACH (node, &lb_changes->updated) {
+        if (!ovn_northd_lb_update_lflows(node->data, lflow_input,
+                                         ovnsb_txn, lflows)) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    const struct sbrec_meter *sb_meter;
-    SBREC_METER_TABLE_FOR_EACH (sb_meter, input_data->sbrec_meter_table) {
-        shash_add(&sb_meters, sb_meter->name, sb_meter);
+/* Returns the Copp of 'od' if it's in 'updated', otherwise NULL. */
+static const struct ovn_copp *
+ovn_datapath_get_updated_copp(const struct ovn_datapath *od,
+                              const struct hmapx *updated)
+{
+    const struct nbrec_copp *nb_copp = od->nbs ? od->nbs->copp
+                                               : od->nbr->copp;
+    if (!nb_copp) {
+        return NULL;
     }
 
-    const struct nbrec_meter *nb_meter;
-    NBREC_METER_TABLE_FOR_EACH (nb_meter, input_data->nbrec_meter_table) {
-        sync_meters_iterate_nb_meter(ovnsb_txn, nb_meter->name, nb_meter,
-                                     &sb_meters, &used_sb_meters);
+    struct hmapx_node *node;
+    HMAPX_FOR_EACH (node, updated) {
+        const struct ovn_copp *copp = node->data;
+        if (copp->nb == nb_copp) {
+            return copp;
+        }
     }
+    return NULL;
+}
 
-    /*
-     * In addition to creating Meters in the SB from the block above, check
-     * and see if additional rows are needed to get ACLs logs individually
-     * rate-limited.
-     */
-    const struct nbrec_acl *acl;
-    NBREC_ACL_TABLE_FOR_EACH (acl, input_data->nbrec_acl_table) {
-        sync_acl_fair_meter(ovnsb_txn, meter_groups, acl,
-                            &sb_meters, &used_sb_meters);
+/* Returns the meter that the logical flows of 'od' that were metered with
+ * 'old_meter' must now use, which is 'old_meter' itself if the Copp of 'od'
+ * didn't change it. */
+static const char *
+ovn_datapath_get_new_copp_meter(const struct ovn_datapath *od,
+                                const struct hmapx *updated,
+                                const char *old_meter)
+{
+    const struct ovn_copp *copp = ovn_datapath_get_updated_copp(od, updated);
+    if (copp) {
+        for (size_t i = 0; i < COPP_PROTO_MAX; i++) {
+            if (nullable_string_is_equal(copp->old_meters[i], old_meter)) {
+                return copp->meters[i];
+            }
+        }
     }
+    return old_meter;
+}
 
-    const char *used_meter;
-    SSET_FOR_EACH_SAFE (used_meter, &used_sb_meters) {
-        shash_find_and_delete(&sb_meters, used_meter);
-        sset_delete(&used_sb_meters, SSET_NODE_FROM_NAME(used_meter));
+/* Stores in '*new_meter' the controller meter that 'lflow' must now use.
+ * Returns false if the datapaths of 'lflow' don't all need the same one, in
+ * which case the datapath group of the flow would have to be split. */
+static bool
+ovn_lflow_get_new_copp_meter(const struct ovn_lflow *lflow,
+                             const struct hmapx *updated,
+                             const char **new_meter)
+{
+    if (lflow->od) {
+        *new_meter = ovn_datapath_get_new_copp_meter(lflow->od, updated,
+                                                     lflow->ctrl_meter);
+        return true;
     }
-    sset_destroy(&used_sb_meters);
 
-    struct shash_node *node;
-    SHASH_FOR_EACH_SAFE (node, &sb_meters) {
-        sbrec_meter_delete(node->data);
-        shash_delete(&sb_meters, node);
+    bool first = true;
+    size_t index;
+    BITMAP_FOR_EACH_1 (index, n_datapaths, lflow->dpg_bitmap) {
+        const char *meter = ovn_datapath_get_new_copp_meter(
+            datapaths_array[index], updated, lflow->ctrl_meter);
+        if (first) {
+            *new_meter = meter;
+            first = false;
+        } else if (!nullable_string_is_equal(meter, *new_meter)) {
+            return false;
+        }
     }
-    shash_destroy(&sb_meters);
+    if (first) {
+        *new_meter = lflow->ctrl_meter;
+    }
+    return true;
 }
 
-/*
- * struct 'dns_info' is used to sync the DNS records between OVN Northbound db
- * and Southbound db.
- */
-struct dns_info {
-    struct hmap_node hmap_node;
-    const struct nbrec_dns *nb_dns; /* DNS record in the Northbound db. */
-    const struct sbrec_dns *sb_dns; /* DNS record in the Southbound db. */
-
-    /* Datapaths to which the DNS entry is associated with it. */
-    const struct sbrec_datapath_binding **sbs;
-    size_t n_sbs;
+struct copp_lflow_update {
+    struct ovn_lflow *lflow;
+    const struct sbrec_logical_flow *sbflow;
+    const char *ctrl_meter;
 };
 
-static inline struct dns_info *
-get_dns_info_from_hmap(struct hmap *dns_map, struct uuid *uuid)
-{
-    struct dns_info *dns_info;
-    size_t hash = uuid_hash(uuid);
-    HMAP_FOR_EACH_WITH_HASH (dns_info, hmap_node, hash, dns_map) {
-        if (uuid_equals(&dns_info->nb_dns->header_.uuid, uuid)) {
-            return dns_info;
+/* Updates the controller meters of the logical flows of the datapaths whose
+ * Copp changed, as tracked by northd_handle_copp_changes(), in 'lflows' and
+ * in the SB Logical_Flow table.  The flows of a control plane protocol are
+ * found through the meter they were built with, so the changes of protocols
+ * that had no meter, or that had the same meter as another protocol of the
+ * Copp that didn't change the same way, can't be handled incrementally.
+ *
+ * Returns false if a full recompute is needed, in which case nothing was
+ * updated. */
+bool
+lflow_handle_northd_copp_changes(struct ovsdb_idl_txn *ovnsb_txn,
+                                 struct tracked_copp_changes *copp_changes,
+                                 struct hmap *lflows)
+{
+    const struct hmapx *updated = &copp_changes->updated;
+    struct hmapx_node *node;
+
+    if (hmapx_is_empty(updated)) {
+        return true;
+    }
+
+    HMAPX_FOR_EACH (node, updated) {
+        const struct ovn_copp *copp = node->data;
+        for (size_t i = 0; i < COPP_PROTO_MAX; i++) {
+            if (nullable_string_is_equal(copp->old_meters[i],
+                                         copp->meters[i])) {
+                continue;
+            }
+            if (!copp->old_meters[i]) {
+                return false;
+            }
+            for (size_t j = 0; j < COPP_PROTO_MAX; j++) {
+                if (nullable_string_is_equal(copp->old_meters[j],
+                                             copp->old_meters[i])
+                    && !nullable_string_is_equal(copp->meters[j],
+                                                 copp->meters[i])) {
+                    return false;
+                }
+            }
         }
     }
 
-    return NULL;
-}
+    struct ovsdb_idl *ovnsb_idl = ovsdb_idl_txn_get_idl(ovnsb_txn);
+    struct copp_lflow_update *updates = NULL;
+    size_t n_updates = 0, allocated_updates = 0;
+    bool ret = true;
 
-static void
-sync_dns_entries(struct northd_input *input_data,
-                 struct ovsdb_idl_txn *ovnsb_txn,
-                 struct hmap *datapaths)
-{
-    struct hmap dns_map = HMAP_INITIALIZER(&dns_map);
-    struct ovn_datapath *od;
-    HMAP_FOR_EACH (od, key_node, datapaths) {
-        if (!od->nbs || !od->nbs->n_dns_records) {
+    /* Check all the flows first, so that nothing is modified if a recompute
+     * is needed. */
+    struct ovn_lflow *lflow;
+    HMAP_FOR_EACH (lflow, hmap_node, lflows) {
+        const char *new_meter;
+
+        if (!lflow->ctrl_meter) {
+            continue;
+        }
+        if (!ovn_lflow_get_new_copp_meter(lflow, updated, &new_meter)) {
+            ret = false;
+            break;
+        }
+        if (nullable_string_is_equal(new_meter, lflow->ctrl_meter)) {
             continue;
         }
 
-        for (size_t i = 0; i < od->nbs->n_dns_records; i++) {
-            struct dns_info *dns_info = get_dns_info_from_hmap(
-                &dns_map, &od->nbs->dns_records[i]->header_.uuid);
-            if (!dns_info) {
-                size_t hash = uuid_hash(
-                    &od->nbs->dns_records[i]->header_.uuid);
-                dns_info = xzalloc(sizeof *dns_info);;
-                dns_info->nb_dns = od->nbs->dns_records[i];
-                hmap_insert(&dns_map, &dns_info->hmap_node, hash);
+        /* A full build would merge the flow with an identical flow that
+         * already has the new meter. */
+        struct ovn_lflow *other;
+        HMAP_FOR_EACH_WITH_HASH (other, hmap_node,
+                                 hmap_node_hash(&lflow->hmap_node), lflows) {
+            if (other != lflow
+                && ovn_lflow_equal(other, other->od, lflow->stage,
+                                   lflow->priority, lflow->match,
+                                   lflow->actions, new_meter)) {
+                ret = false;
+                break;
             }
+        }
 
-            dns_info->n_sbs++;
-            dns_info->sbs = xrealloc(dns_info->sbs,
-                                     dns_info->n_sbs * sizeof *dns_info->sbs);
-            dns_info->sbs[dns_info->n_sbs - 1] = od->sb;
+        const struct sbrec_logical_flow *sbflow =
+            sbrec_logical_flow_get_for_uuid(ovnsb_idl, &lflow->sb_uuid);
+        if (!ret || !sbflow) {
+            ret = false;
+            break;
         }
-    }
 
-    const struct sbrec_dns *sbrec_dns;
-    SBREC_DNS_TABLE_FOR_EACH_SAFE (sbrec_dns, input_data->sbrec_dns_table) {
-        const char *nb_dns_uuid = smap_get(&sbrec_dns->external_ids, "dns_id");
-        struct uuid dns_uuid;
-        if (!nb_dns_uuid || !uuid_from_string(&dns_uuid, nb_dns_uuid)) {
-            sbrec_dns_delete(sbrec_dns);
-            continue;
+        if (n_updates >= allocated_updates) {
+            updates = x2nrealloc(updates, &allocated_updates,
+                                 sizeof *updates);
         }
+        updates[n_updates++] = (struct copp_lflow_update) {
+            .lflow = lflow,
+            .sbflow = sbflow,
+            .ctrl_meter = new_meter,
+        };
+    }
 
-        struct dns_info *dns_info =
-            get_dns_info_from_hmap(&dns_map, &dns_uuid);
-        if (dns_info) {
-            dns_info->sb_dns = sbrec_dns;
+    for (size_t i = 0; ret && i < n_updates; i++) {
+        struct copp_lflow_update *u = &updates[i];
+
+        if (u->lflow->in_arena) {
+            u->lflow->ctrl_meter = lflow_arena_strdup(u->ctrl_meter);
         } else {
-            sbrec_dns_delete(sbrec_dns);
+            free(u->lflow->ctrl_meter);
+            u->lflow->ctrl_meter = nullable_xstrdup(u->ctrl_meter);
         }
+        sbrec_logical_flow_set_controller_meter(u->sbflow, u->ctrl_meter);
     }
+    free(updates);
 
-    struct dns_info *dns_info;
-    HMAP_FOR_EACH_POP (dns_info, hmap_node, &dns_map) {
-        if (!dns_info->sb_dns) {
-            sbrec_dns = sbrec_dns_insert(ovnsb_txn);
-            dns_info->sb_dns = sbrec_dns;
-            char *dns_id = xasprintf(
-                UUID_FMT, UUID_ARGS(&dns_info->nb_dns->header_.uuid));
-            const struct smap external_ids =
-                SMAP_CONST1(&external_ids, "dns_id", dns_id);
-            sbrec_dns_set_external_ids(sbrec_dns, &external_ids);
-            free(dns_id);
+    return ret;
+}
+
+/* Handles the SB Logical_Flow changes, which are most likely the result of
+ * ovn-northd's own transactions.  The logical flows in 'lflows' are linked to
+ * the newly inserted SB records, whose UUIDs are only known once the
+ * transaction is committed.  Returns false if a full recompute is needed,
+ * e.g., if a logical flow was deleted from the SB by someone else. */
+bool
+lflow_handle_sb_logical_flow_changes(
+    const struct sbrec_logical_flow_table *sbrec_logical_flow_table,
+    struct ovsdb_idl *ovnsb_idl, const struct hmap *datapaths,
+    struct hmap *lflows)
+{
+    const struct sbrec_logical_flow *sbflow;
+    SBREC_LOGICAL_FLOW_TABLE_FOR_EACH_TRACKED (sbflow,
+                                               sbrec_logical_flow_table) {
+        bool is_new = sbrec_logical_flow_is_new(sbflow);
+        bool is_deleted = sbrec_logical_flow_is_deleted(sbflow);
+        if (!is_new && !is_deleted) {
+            continue;
         }
 
-        /* Set the datapaths and records. If nothing has changed, then
-         * this will be a no-op.
-         */
-        sbrec_dns_set_datapaths(
-            dns_info->sb_dns,
-            (struct sbrec_datapath_binding **)dns_info->sbs,
-            dns_info->n_sbs);
+        struct ovn_datapath *od = sbflow_get_valid_od(datapaths, sbflow);
+        if (!od) {
+            if (is_new) {
+                return false;
+            }
+            continue;
+        }
 
-        /* DNS lookups are case-insensitive. Convert records to lowercase so
-         * we can do consistent lookups when DNS requests arrive
-         */
-        struct smap lower_records = SMAP_INITIALIZER(&lower_records);
-        struct smap_node *node;
-        SMAP_FOR_EACH (node, &dns_info->nb_dns->records) {
-            smap_add_nocopy(&lower_records, xstrdup(node->key),
-                            str_tolower(node->value));
+        enum ovn_pipeline pipeline
+            = !strcmp(sbflow->pipeline, "ingress") ? P_IN : P_OUT;
+        enum ovn_stage stage = ovn_stage_build(ovn_datapath_get_type(od),
+                                               pipeline, sbflow->table_id);
+        const struct ovn_datapath *lflow_od =
+            sbflow->logical_dp_group ? NULL : od;
+        bool found = false;
+
+        struct ovn_lflow *lflow;
+        HMAP_FOR_EACH_WITH_HASH (lflow, hmap_node, sbflow->hash, lflows) {
+            if (!ovn_lflow_equal(lflow, lflow_od, stage, sbflow->priority,
+                                 sbflow->match, sbflow->actions,
+                                 sbflow->controller_meter)) {
+                continue;
+            }
+            if (is_deleted) {
+                if (uuid_equals(&lflow->sb_uuid, &sbflow->header_.uuid)) {
+                    return false;
+                }
+                continue;
+            }
+
+            /* Link the first flow that isn't already linked to an existing
+             * SB record, the UUIDs of the records inserted by ovn-northd
+             * don't exist anymore. */
+            if (uuid_equals(&lflow->sb_uuid, &sbflow->header_.uuid)
+                || !sbrec_logical_flow_get_for_uuid(ovnsb_idl,
+                                                    &lflow->sb_uuid)) {
+                lflow->sb_uuid = sbflow->header_.uuid;
+                found = true;
+                break;
+            }
         }
 
-        sbrec_dns_set_records(dns_info->sb_dns, &lower_records);
+        if (is_new && !found) {
+            return false;
+        }
+    }
+    return true;
+}
 
-        smap_destroy(&lower_records);
-        free(dns_info->sbs);
-        free(dns_info);
+/* Returns true if only the 'ports' of existing multicast groups changed,
+ * which is the result of lflow_handle_northd_ls_changes(). */
+bool
+lflow_handle_sb_multicast_group_changes(
+    const struct sbrec_multicast_group_table *sbrec_multicast_group_table)
+{
+    const struct sbrec_multicast_group *sbmc;
+    SBREC_MULTICAST_GROUP_TABLE_FOR_EACH_TRACKED (
+            sbmc, sbrec_multicast_group_table) {
+        if (sbrec_multicast_group_is_new(sbmc)
+            || sbrec_multicast_group_is_deleted(sbmc)) {
+            return false;
+        }
+        for (enum sbrec_multicast_group_column_id col = 0;
+             col < SBREC_MULTICAST_GROUP_N_COLUMNS; col++) {
+            if (col != SBREC_MULTICAST_GROUP_COL_PORTS &&
+                sbrec_multicast_group_is_updated(sbmc, col)) {
+                return false;
+            }
+        }
     }
-    hmap_destroy(&dns_map);
+    return true;
 }
-
+
+/* Updates the addresses of the existing 'sb_as' to 'addrs'.  Only the
+ * addresses that were added or removed are sent to the SB, instead of the
+ * whole set. */
 static void
-destroy_datapaths_and_ports(struct hmap *datapaths, struct hmap *ports,
-                            struct ovs_list *lr_list)
+sb_address_set_update_addresses(const struct sbrec_address_set *sb_as,
+                                const char **addrs, size_t n_addrs)
 {
-    struct ovn_datapath *router_dp;
-    LIST_FOR_EACH_POP (router_dp, lr_list, lr_list) {
-        if (router_dp->lr_group) {
-            struct lrouter_group *lr_group = router_dp->lr_group;
-
-            for (size_t i = 0; i < lr_group->n_router_dps; i++) {
-                lr_group->router_dps[i]->lr_group = NULL;
-            }
+    struct sset new_addrs = SSET_INITIALIZER(&new_addrs);
+    for (size_t i = 0; i < n_addrs; i++) {
+        sset_add(&new_addrs, addrs[i]);
+    }
 
-            free(lr_group->router_dps);
-            sset_destroy(&lr_group->ha_chassis_groups);
-            free(lr_group);
+    for (size_t i = 0; i < sb_as->n_addresses; i++) {
+        if (!sset_find_and_delete(&new_addrs, sb_as->addresses[i])) {
+            sbrec_address_set_update_addresses_delvalue(sb_as,
+                                                        sb_as->addresses[i]);
         }
     }
 
-    struct ovn_datapath *dp;
-    HMAP_FOR_EACH_SAFE (dp, key_node, datapaths) {
-        ovn_datapath_destroy(datapaths, dp);
+    const char *addr;
+    SSET_FOR_EACH (addr, &new_addrs) {
+        sbrec_address_set_update_addresses_addvalue(sb_as, addr);
     }
-    hmap_destroy(datapaths);
+    sset_destroy(&new_addrs);
+}
 
-    struct ovn_port *port;
-    HMAP_FOR_EACH_SAFE (port, key_node, ports) {
-        ovn_port_destroy(ports, port);
+static void
+sync_address_set(struct ovsdb_idl_txn *ovnsb_txn, const char *name,
+                 const char **addrs, size_t n_addrs,
+                 struct shash *sb_address_sets)
+{
+    const struct sbrec_address_set *sb_address_set;
+    sb_address_set = shash_find_and_delete(sb_address_sets,
+                                           name);
+    if (!sb_address_set) {
+        sb_address_set = sbrec_address_set_insert(ovnsb_txn);
+        sbrec_address_set_set_name(sb_address_set, name);
+        sbrec_address_set_set_addresses(sb_address_set,
+                                        addrs, n_addrs);
+    } else {
+        sb_address_set_update_addresses(sb_address_set, addrs, n_addrs);
     }
-    hmap_destroy(ports);
 }
 
-static void
-build_ip_mcast(struct northd_input *input_data,
-               struct ovsdb_idl_txn *ovnsb_txn,
-               struct hmap *datapaths)
+static const struct sbrec_address_set *
+sb_address_set_lookup_by_name(struct ovsdb_idl_index *sbrec_as_by_name,
+                              const char *name)
 {
-    struct ovn_datapath *od;
+    struct sbrec_address_set *target =
+        sbrec_address_set_index_init_row(sbrec_as_by_name);
+    sbrec_address_set_index_set_name(target, name);
 
-    HMAP_FOR_EACH (od, key_node, datapaths) {
-        if (!od->nbs) {
-            continue;
-        }
+    const struct sbrec_address_set *retval =
+        sbrec_address_set_index_find(sbrec_as_by_name, target);
 
-        const struct sbrec_ip_multicast *ip_mcast =
-            ip_mcast_lookup(input_data->sbrec_ip_mcast_by_dp, od->sb);
+    sbrec_address_set_index_destroy_row(target);
 
-        if (!ip_mcast) {
-            ip_mcast = sbrec_ip_multicast_insert(ovnsb_txn);
+    return retval;
+}
+
+/* Syncs the changes of the NB Address_Set rows to the SB directly, as no
+ * other NB or SB data depends on them.  Returns false if a full recompute
+ * is needed instead, i.e. if an address set was deleted or renamed, because
+ * the SB row may have to be replaced by one generated from a port group. */
+bool
+northd_handle_nb_address_set_changes(
+    struct ovsdb_idl_txn *ovnsb_txn,
+    const struct nbrec_address_set_table *nbrec_address_set_table,
+    struct ovsdb_idl_index *sbrec_address_set_by_name)
+{
+    const struct nbrec_address_set *nb_as;
+    NBREC_ADDRESS_SET_TABLE_FOR_EACH_TRACKED (nb_as,
+                                              nbrec_address_set_table) {
+        if (nbrec_address_set_is_deleted(nb_as)) {
+            return false;
         }
-        store_mcast_info_for_switch_datapath(ip_mcast, od);
-    }
 
-    /* Delete southbound records without northbound matches. */
-    const struct sbrec_ip_multicast *sb;
+        bool is_new = nbrec_address_set_is_new(nb_as);
+        if (!is_new
+            && nbrec_address_set_is_updated(nb_as,
+                                            NBREC_ADDRESS_SET_COL_NAME)) {
+            return false;
+        }
 
-    SBREC_IP_MULTICAST_TABLE_FOR_EACH_SAFE (sb,
-                                   input_data->sbrec_ip_multicast_table) {
-        od = ovn_datapath_from_sbrec(datapaths, sb->datapath);
-        if (!od || ovn_datapath_is_stale(od)) {
-            sbrec_ip_multicast_delete(sb);
+        const struct sbrec_address_set *sb_as =
+            sb_address_set_lookup_by_name(sbrec_address_set_by_name,
+                                          nb_as->name);
+        if (!sb_as) {
+            if (!is_new) {
+                return false;
+            }
+            sb_as = sbrec_address_set_insert(ovnsb_txn);
+            sbrec_address_set_set_name(sb_as, nb_as->name);
+            sbrec_address_set_set_addresses(sb_as,
+                /* "char **" is not compatible with "const char **" */
+                (const char **) nb_as->addresses, nb_as->n_addresses);
+        } else {
+            sb_address_set_update_addresses(sb_as,
+                /* "char **" is not compatible with "const char **" */
+                (const char **) nb_as->addresses, nb_as->n_addresses);
         }
     }
+    return true;
 }
 
+/* OVN_Southbound Address_Set table contains same records as in north
+ * bound, plus the records generated from Port_Group table in north bound.
+ *
+ * There are 2 records generated from each port group, one for IPv4, and
+ * one for IPv6, named in the format: <port group name>_ip4 and
+ * <port group name>_ip6 respectively. MAC addresses are ignored.
+ *
+ * We always update OVN_Southbound to match the Address_Set and Port_Group
+ * in OVN_Northbound, so that the address sets used in Logical_Flows in
+ * OVN_Southbound is checked against the proper set.*/
 static void
-build_mcast_groups(struct lflow_input *input_data,
-                   const struct hmap *datapaths,
-                   const struct hmap *ports,
-                   struct hmap *mcast_groups,
-                   struct hmap *igmp_groups)
+sync_address_sets(struct northd_input *input_data,
+                  struct ovsdb_idl_txn *ovnsb_txn,
+                  struct hmap *datapaths)
 {
-    struct ovn_port *op;
-
-    hmap_init(mcast_groups);
-    hmap_init(igmp_groups);
-
-    HMAP_FOR_EACH (op, key_node, ports) {
-        if (op->nbrp && lrport_is_enabled(op->nbrp)) {
-            /* If this port is configured to always flood multicast traffic
-             * add it to the MC_STATIC group.
-             */
-            if (op->mcast_info.flood) {
-                ovn_multicast_add(mcast_groups, &mc_static, op);
-                op->od->mcast_info.rtr.flood_static = true;
-            }
-        } else if (op->nbsp && lsp_is_enabled(op->nbsp)) {
-            ovn_multicast_add(mcast_groups, &mc_flood, op);
+    struct shash sb_address_sets = SHASH_INITIALIZER(&sb_address_sets);
 
-            if (!lsp_is_router(op->nbsp)) {
-                ovn_multicast_add(mcast_groups, &mc_flood_l2, op);
-            }
+    const struct sbrec_address_set *sb_address_set;
+    SBREC_ADDRESS_SET_TABLE_FOR_EACH (sb_address_set,
+                                   input_data->sbrec_address_set_table) {
+        shash_add(&sb_address_sets, sb_address_set->name, sb_address_set);
+    }
 
-            /* If this port is connected to a multicast router then add it
-             * to the MC_MROUTER_FLOOD group.
-             */
-            if (op->od->mcast_info.sw.flood_relay && op->peer &&
-                    op->peer->od && op->peer->od->mcast_info.rtr.relay) {
-                ovn_multicast_add(mcast_groups, &mc_mrouter_flood, op);
-            }
+    /* Service monitor MAC. */
+    const char *svc_monitor_macp = svc_monitor_mac;
+    sync_address_set(ovnsb_txn, "svc_monitor_mac", &svc_monitor_macp, 1,
+                     &sb_address_sets);
 
-            /* If this port is configured to always flood multicast reports
-             * add it to the MC_MROUTER_STATIC group.
-             */
-            if (op->mcast_info.flood_reports) {
-                ovn_multicast_add(mcast_groups, &mc_mrouter_static, op);
-                op->od->mcast_info.sw.flood_reports = true;
+    /* sync port group generated address sets first */
+    const struct nbrec_port_group *nb_port_group;
+    NBREC_PORT_GROUP_TABLE_FOR_EACH (nb_port_group,
+                                     input_data->nbrec_port_group_table) {
+        struct svec ipv4_addrs = SVEC_EMPTY_INITIALIZER;
+        struct svec ipv6_addrs = SVEC_EMPTY_INITIALIZER;
+        for (size_t i = 0; i < nb_port_group->n_ports; i++) {
+            for (size_t j = 0; j < nb_port_group->ports[i]->n_addresses; j++) {
+                const char *addrs = nb_port_group->ports[i]->addresses[j];
+                if (!is_dynamic_lsp_address(addrs)) {
+                    split_addresses(addrs, &ipv4_addrs, &ipv6_addrs);
+                }
             }
-
-            /* If this port is configured to always flood multicast traffic
-             * add it to the MC_STATIC group.
-             */
-            if (op->mcast_info.flood) {
-                ovn_multicast_add(mcast_groups, &mc_static, op);
-                op->od->mcast_info.sw.flood_static = true;
+            if (nb_port_group->ports[i]->dynamic_addresses) {
+                split_addresses(nb_port_group->ports[i]->dynamic_addresses,
+                                &ipv4_addrs, &ipv6_addrs);
             }
         }
+        char *ipv4_addrs_name = xasprintf("%s_ip4", nb_port_group->name);
+        char *ipv6_addrs_name = xasprintf("%s_ip6", nb_port_group->name);
+        sync_address_set(ovnsb_txn, ipv4_addrs_name,
+                         /* "char **" is not compatible with "const char **" */
+                         (const char **)ipv4_addrs.names,
+                         ipv4_addrs.n, &sb_address_sets);
+        sync_address_set(ovnsb_txn, ipv6_addrs_name,
+                         /* "char **" is not compatible with "const char **" */
+                         (const char **)ipv6_addrs.names,
+                         ipv6_addrs.n, &sb_address_sets);
+        free(ipv4_addrs_name);
+        free(ipv6_addrs_name);
+        svec_destroy(&ipv4_addrs);
+        svec_destroy(&ipv6_addrs);
     }
 
-    const struct sbrec_igmp_group *sb_igmp;
+    /* Sync router load balancer VIP generated address sets. */
+    struct ovn_datapath *od;
+    HMAP_FOR_EACH (od, key_node, datapaths) {
+        if (!od->nbr) {
+            continue;
+        }
+
+        if (sset_count(&od->lb_ips_v4_reachable)) {
+            char *ipv4_addrs_name = lr_lb_address_set_name(od, AF_INET);
+            const char **ipv4_addrs = sset_array(&od->lb_ips_v4_reachable);
+
+            sync_address_set(ovnsb_txn, ipv4_addrs_name, ipv4_addrs,
+                             sset_count(&od->lb_ips_v4_reachable),
+                             &sb_address_sets);
+            free(ipv4_addrs_name);
+            free(ipv4_addrs);
+        }
+
+        if (sset_count(&od->lb_ips_v6_reachable)) {
+            char *ipv6_addrs_name = lr_lb_address_set_name(od, AF_INET6);
+            const char **ipv6_addrs = sset_array(&od->lb_ips_v6_reachable);
+
+            sync_address_set(ovnsb_txn, ipv6_addrs_name, ipv6_addrs,
+                             sset_count(&od->lb_ips_v6_reachable),
+                             &sb_address_sets);
+            free(ipv6_addrs_name);
+            free(ipv6_addrs);
+        }
+    }
+
+    /* sync user defined address sets, which may overwrite port group
+     * generated address sets if same name is used */
+    const struct nbrec_address_set *nb_address_set;
+    NBREC_ADDRESS_SET_TABLE_FOR_EACH (nb_address_set,
+                              input_data->nbrec_address_set_table) {
+        sync_address_set(ovnsb_txn, nb_address_set->name,
+            /* "char **" is not compatible with "const char **" */
+            (const char **)nb_address_set->addresses,
+            nb_address_set->n_addresses, &sb_address_sets);
+    }
+
+    struct shash_node *node;
+    SHASH_FOR_EACH_SAFE (node, &sb_address_sets) {
+        sbrec_address_set_delete(node->data);
+        shash_delete(&sb_address_sets, node);
+    }
+    shash_destroy(&sb_address_sets);
+}
+
+/* Each port group in Port_Group table in OVN_Northbound has a corresponding
+ * entry in Port_Group table in OVN_Southbound. In OVN_Northbound the entries
+ * contains lport uuids, while in OVN_Southbound we store the lport names.
+ */
+static void
+sync_port_groups(struct northd_input *input_data,
+                struct ovsdb_idl_txn *ovnsb_txn,
+                 struct hmap *pgs)
+{
+    struct shash sb_port_groups = SHASH_INITIALIZER(&sb_port_groups);
+
+    const struct sbrec_port_group *sb_port_group;
+    SBREC_PORT_GROUP_TABLE_FOR_EACH (sb_port_group,
+                               input_data->sbrec_port_group_table) {
+        shash_add(&sb_port_groups, sb_port_group->name, sb_port_group);
+    }
+
+    struct ds sb_name = DS_EMPTY_INITIALIZER;
+
+    struct ovn_port_group *pg;
+    HMAP_FOR_EACH (pg, key_node, pgs) {
+
+        struct ovn_port_group_ls *pg_ls;
+        HMAP_FOR_EACH (pg_ls, key_node, &pg->nb_lswitches) {
+            get_sb_port_group_name(pg->nb_pg->name, pg_ls->od->sb->tunnel_key,
+                                   &sb_name);
+            sb_port_group = shash_find_and_delete(&sb_port_groups,
+                                                  ds_cstr(&sb_name));
+            if (!sb_port_group) {
+                sb_port_group = sbrec_port_group_insert(ovnsb_txn);
+                sbrec_port_group_set_name(sb_port_group, ds_cstr(&sb_name));
+
+                const char **nb_port_names = xcalloc(pg_ls->n_ports,
+                                                     sizeof *nb_port_names);
+                for (size_t i = 0; i < pg_ls->n_ports; i++) {
+                    nb_port_names[i] = pg_ls->ports[i]->nbsp->name;
+                }
+                sbrec_port_group_set_ports(sb_port_group,
+                                           nb_port_names,
+                                           pg_ls->n_ports);
+                free(nb_port_names);
+                continue;
+            }
+
+            /* Only send the ports that were added or removed. */
+            struct sset nb_port_names = SSET_INITIALIZER(&nb_port_names);
+            for (size_t i = 0; i < pg_ls->n_ports; i++) {
+                sset_add(&nb_port_names, pg_ls->ports[i]->nbsp->name);
+            }
+            for (size_t i = 0; i < sb_port_group->n_ports; i++) {
+                if (!sset_find_and_delete(&nb_port_names,
+                                          sb_port_group->ports[i])) {
+                    sbrec_port_group_update_ports_delvalue(
+                        sb_port_group, sb_port_group->ports[i]);
+                }
+            }
+            const char *port_name;
+            SSET_FOR_EACH (port_name, &nb_port_names) {
+                sbrec_port_group_update_ports_addvalue(sb_port_group,
+                                                       port_name);
+            }
+            sset_destroy(&nb_port_names);
+        }
+    }
+    ds_destroy(&sb_name);
+
+    struct shash_node *node;
+    SHASH_FOR_EACH_SAFE (node, &sb_port_groups) {
+        sbrec_port_group_delete(node->data);
+        shash_delete(&sb_port_groups, node);
+    }
+    shash_destroy(&sb_port_groups);
+}
+
+struct band_entry {
+    int64_t rate;
+    int64_t burst_size;
+    const char *action;
+};
+
+static int
+band_cmp(const void *band1_, const void *band2_)
+{
+    const struct band_entry *band1p = band1_;
+    const struct band_entry *band2p = band2_;
+
+    if (band1p->rate != band2p->rate) {
+        return band1p->rate > band2p->rate ? -1 : 1;
+    } else if (band1p->burst_size != band2p->burst_size) {
+        return band1p->burst_size > band2p->burst_size ? -1 : 1;
+    } else {
+        return strcmp(band1p->action, band2p->action);
+    }
+}
+
+static bool
+bands_need_update(const struct nbrec_meter *nb_meter,
+                  const struct sbrec_meter *sb_meter)
+{
+    if (nb_meter->n_bands != sb_meter->n_bands) {
+        return true;
+    }
+
+    /* A single band is the most common scenario, so speed up that
+     * check. */
+    if (nb_meter->n_bands == 1) {
+        struct nbrec_meter_band *nb_band = nb_meter->bands[0];
+        struct sbrec_meter_band *sb_band = sb_meter->bands[0];
+
+        return !(nb_band->rate == sb_band->rate
+                 && nb_band->burst_size == sb_band->burst_size
+                 && !strcmp(sb_band->action, nb_band->action));
+    }
+
+    /* Place the Northbound entries in sorted order. */
+    struct band_entry *nb_bands;
+    nb_bands = xmalloc(sizeof *nb_bands * nb_meter->n_bands);
+    for (size_t i = 0; i < nb_meter->n_bands; i++) {
+        struct nbrec_meter_band *nb_band = nb_meter->bands[i];
+
+        nb_bands[i].rate = nb_band->rate;
+        nb_bands[i].burst_size = nb_band->burst_size;
+        nb_bands[i].action = nb_band->action;
+    }
+    qsort(nb_bands, nb_meter->n_bands, sizeof *nb_bands, band_cmp);
+
+    /* Place the Southbound entries in sorted order. */
+    struct band_entry *sb_bands;
+    sb_bands = xmalloc(sizeof *sb_bands * sb_meter->n_bands);
+    for (size_t i = 0; i < sb_meter->n_bands; i++) {
+        struct sbrec_meter_band *sb_band = sb_meter->bands[i];
+
+        sb_bands[i].rate = sb_band->rate;
+        sb_bands[i].burst_size = sb_band->burst_size;
+        sb_bands[i].action = sb_band->action;
+    }
+    qsort(sb_bands, sb_meter->n_bands, sizeof *sb_bands, band_cmp);
+
+    bool need_update = false;
+    for (size_t i = 0; i < nb_meter->n_bands; i++) {
+        if (nb_bands[i].rate != sb_bands[i].rate
+            || nb_bands[i].burst_size != sb_bands[i].burst_size
+            || strcmp(nb_bands[i].action, sb_bands[i].action)) {
+            need_update = true;
+            goto done;
+        }
+    }
+
+done:
+    free(nb_bands);
+    free(sb_bands);
+
+    return need_update;
+}
+
+static void
+sync_meters_iterate_nb_meter(struct ovsdb_idl_txn *ovnsb_txn,
+                             const char *meter_name,
+                             const struct nbrec_meter *nb_meter,
+                             struct shash *sb_meters,
+                             struct sset *used_sb_meters)
+{
+    const struct sbrec_meter *sb_meter;
+    bool new_sb_meter = false;
+
+    sb_meter = shash_find_data(sb_meters, meter_name);
+    if (!sb_meter) {
+        sb_meter = sbrec_meter_insert(ovnsb_txn);
+        sbrec_meter_set_name(sb_meter, meter_name);
+        shash_add(sb_meters, sb_meter->name, sb_meter);
+        new_sb_meter = true;
+    }
+    sset_add(used_sb_meters, meter_name);
+
+    if (new_sb_meter || bands_need_update(nb_meter, sb_meter)) {
+        struct sbrec_meter_band **sb_bands;
+        sb_bands = xcalloc(nb_meter->n_bands, sizeof *sb_bands);
+        for (size_t i = 0; i < nb_meter->n_bands; i++) {
+            const struct nbrec_meter_band *nb_band = nb_meter->bands[i];
+
+            sb_bands[i] = sbrec_meter_band_insert(ovnsb_txn);
+
+            sbrec_meter_band_set_action(sb_bands[i], nb_band->action);
+            sbrec_meter_band_set_rate(sb_bands[i], nb_band->rate);
+            sbrec_meter_band_set_burst_size(sb_bands[i],
+                                            nb_band->burst_size);
+        }
+        sbrec_meter_set_bands(sb_meter, sb_bands, nb_meter->n_bands);
+        free(sb_bands);
+    }
+
+    sbrec_meter_set_unit(sb_meter, nb_meter->unit);
+}
+
+static void
+sync_acl_fair_meter(struct ovsdb_idl_txn *ovnsb_txn,
+                    struct shash *meter_groups,
+                    const struct nbrec_acl *acl, struct shash *sb_meters,
+                    struct sset *used_sb_meters)
+{
+    const struct nbrec_meter *nb_meter =
+        fair_meter_lookup_by_name(meter_groups, acl->meter);
+
+    if (!nb_meter) {
+        return;
+    }
+
+    char *meter_name = alloc_acl_log_unique_meter_name(acl);
+    sync_meters_iterate_nb_meter(ovnsb_txn, meter_name, nb_meter, sb_meters,
+                                 used_sb_meters);
+    free(meter_name);
+}
+
+/* Syncs the private meter that rate limits the log of 'acl' if it doesn't
+ * have a meter of its own, see NB_Global options:acl_log_rate_limit. */
+static void
+sync_acl_log_default_meter(struct ovsdb_idl_txn *ovnsb_txn,
+                           const struct nbrec_acl *acl,
+                           struct shash *sb_meters,
+                           struct sset *used_sb_meters)
+{
+    char *meter_name = alloc_acl_log_default_meter_name(acl);
+    if (!meter_name) {
+        return;
+    }
+
+    const struct sbrec_meter *sb_meter = shash_find_data(sb_meters,
+                                                         meter_name);
+    if (!sb_meter) {
+        sb_meter = sbrec_meter_insert(ovnsb_txn);
+        sbrec_meter_set_name(sb_meter, meter_name);
+        shash_add(sb_meters, sb_meter->name, sb_meter);
+    }
+    sset_add(used_sb_meters, meter_name);
+
+    if (sb_meter->n_bands != 1
+        || sb_meter->bands[0]->rate != acl_log_rate_limit
+        || sb_meter->bands[0]->burst_size != acl_log_burst_size
+        || strcmp(sb_meter->bands[0]->action, "drop")) {
+        struct sbrec_meter_band *sb_band = sbrec_meter_band_insert(ovnsb_txn);
+
+        sbrec_meter_band_set_action(sb_band, "drop");
+        sbrec_meter_band_set_rate(sb_band, acl_log_rate_limit);
+        sbrec_meter_band_set_burst_size(sb_band, acl_log_burst_size);
+        sbrec_meter_set_bands(sb_meter, &sb_band, 1);
+    }
+    if (!sb_meter->unit || strcmp(sb_meter->unit, "pktps")) {
+        sbrec_meter_set_unit(sb_meter, "pktps");
+    }
+    free(meter_name);
+}
+
+/* Each entry in the Meter and Meter_Band tables in OVN_Northbound have
+ * a corresponding entries in the Meter and Meter_Band tables in
+ * OVN_Southbound. Additionally, ACL logs that use fair meters have
+ * a private copy of its meter in the SB table, and so do the ACL logs
+ * without a meter if options:acl_log_rate_limit is set.
+ */
+static void
+sync_meters(struct northd_input *input_data,
+            struct ovsdb_idl_txn *ovnsb_txn,
+            struct shash *meter_groups)
+{
+    struct shash sb_meters = SHASH_INITIALIZER(&sb_meters);
+    struct sset used_sb_meters = SSET_INITIALIZER(&used_sb_meters);
+
+    const struct sbrec_meter *sb_meter;
+    SBREC_METER_TABLE_FOR_EACH (sb_meter, input_data->sbrec_meter_table) {
+        shash_add(&sb_meters, sb_meter->name, sb_meter);
+    }
+
+    const struct nbrec_meter *nb_meter;
+    NBREC_METER_TABLE_FOR_EACH (nb_meter, input_data->nbrec_meter_table) {
+        sync_meters_iterate_nb_meter(ovnsb_txn, nb_meter->name, nb_meter,
+                                     &sb_meters, &used_sb_meters);
+    }
+
+    /*
+     * In addition to creating Meters in the SB from the block above, check
+     * and see if additional rows are needed to get ACLs logs individually
+     * rate-limited.
+     */
+    const struct nbrec_acl *acl;
+    NBREC_ACL_TABLE_FOR_EACH (acl, input_data->nbrec_acl_table) {
+        sync_acl_fair_meter(ovnsb_txn, meter_groups, acl,
+                            &sb_meters, &used_sb_meters);
+        sync_acl_log_default_meter(ovnsb_txn, acl,
+                                   &sb_meters, &used_sb_meters);
+    }
+
+    const char *used_meter;
+    SSET_FOR_EACH_SAFE (used_meter, &used_sb_meters) {
+        shash_find_and_delete(&sb_meters, used_meter);
+        sset_delete(&used_sb_meters, SSET_NODE_FROM_NAME(used_meter));
+    }
+    sset_destroy(&used_sb_meters);
+
+    struct shash_node *node;
+    SHASH_FOR_EACH_SAFE (node, &sb_meters) {
+        sbrec_meter_delete(node->data);
+        shash_delete(&sb_meters, node);
+    }
+    shash_destroy(&sb_meters);
+}
+
+/*
+ * struct 'dns_info' is used to sync the DNS records between OVN Northbound db
+ * and Southbound db.
+ */
+struct dns_info {
+    struct hmap_node hmap_node;
+    const struct nbrec_dns *nb_dns; /* DNS record in the Northbound db. */
+    const struct sbrec_dns *sb_dns; /* DNS record in the Southbound db. */
+
+    /* Datapaths to which the DNS entry is associated with it. */
+    const struct sbrec_datapath_binding **sbs;
+    size_t n_sbs;
+};
+
+static inline struct dns_info *
+get_dns_info_from_hmap(struct hmap *dns_map, struct uuid *uuid)
+{
+    struct dns_info *dns_info;
+    size_t hash = uuid_hash(uuid);
+    HMAP_FOR_EACH_WITH_HASH (dns_info, hmap_node, hash, dns_map) {
+        if (uuid_equals(&dns_info->nb_dns->header_.uuid, uuid)) {
+            return dns_info;
+        }
+    }
+
+    return NULL;
+}
+
+static void
+sync_dns_entries(struct northd_input *input_data,
+                 struct ovsdb_idl_txn *ovnsb_txn,
+                 struct hmap *datapaths)
+{
+    struct hmap dns_map = HMAP_INITIALIZER(&dns_map);
+    struct ovn_datapath *od;
+    HMAP_FOR_EACH (od, key_node, datapaths) {
+        if (!od->nbs || !od->nbs->n_dns_records) {
+            continue;
+        }
+
+        for (size_t i = 0; i < od->nbs->n_dns_records; i++) {
+            struct dns_info *dns_info = get_dns_info_from_hmap(
+                &dns_map, &od->nbs->dns_records[i]->header_.uuid);
+            if (!dns_info) {
+                size_t hash = uuid_hash(
+                    &od->nbs->dns_records[i]->header_.uuid);
+                dns_info = xzalloc(sizeof *dns_info);;
+                dns_info->nb_dns = od->nbs->dns_records[i];
+                hmap_insert(&dns_map, &dns_info->hmap_node, hash);
+            }
+
+            dns_info->n_sbs++;
+            dns_info->sbs = xrealloc(dns_info->sbs,
+                                     dns_info->n_sbs * sizeof *dns_info->sbs);
+            dns_info->sbs[dns_info->n_sbs - 1] = od->sb;
+        }
+    }
+
+    const struct sbrec_dns *sbrec_dns;
+    SBREC_DNS_TABLE_FOR_EACH_SAFE (sbrec_dns, input_data->sbrec_dns_table) {
+        const char *nb_dns_uuid = smap_get(&sbrec_dns->external_ids, "dns_id");
+        struct uuid dns_uuid;
+        if (!nb_dns_uuid || !uuid_from_string(&dns_uuid, nb_dns_uuid)) {
+            sbrec_dns_delete(sbrec_dns);
+            continue;
+        }
+
+        struct dns_info *dns_info =
+            get_dns_info_from_hmap(&dns_map, &dns_uuid);
+        if (dns_info) {
+            dns_info->sb_dns = sbrec_dns;
+        } else {
+            sbrec_dns_delete(sbrec_dns);
+        }
+    }
+
+    struct dns_info *dns_info;
+    HMAP_FOR_EACH_POP (dns_info, hmap_node, &dns_map) {
+        if (!dns_info->sb_dns) {
+            sbrec_dns = sbrec_dns_insert(ovnsb_txn);
+            dns_info->sb_dns = sbrec_dns;
+            char *dns_id = xasprintf(
+                UUID_FMT, UUID_ARGS(&dns_info->nb_dns->header_.uuid));
+            const struct smap external_ids =
+                SMAP_CONST1(&external_ids, "dns_id", dns_id);
+            sbrec_dns_set_external_ids(sbrec_dns, &external_ids);
+            free(dns_id);
+        }
+
+        /* Set the datapaths and records. If nothing has changed, then
+         * this will be a no-op.
+         */
+        sbrec_dns_set_datapaths(
+            dns_info->sb_dns,
+            (struct sbrec_datapath_binding **)dns_info->sbs,
+            dns_info->n_sbs);
+
+        /* DNS lookups are case-insensitive. Convert records to lowercase so
+         * we can do consistent lookups when DNS requests arrive
+         */
+        struct smap lower_records = SMAP_INITIALIZER(&lower_records);
+        struct smap_node *node;
+        SMAP_FOR_EACH (node, &dns_info->nb_dns->records) {
+            smap_add_nocopy(&lower_records, xstrdup(node->key),
+                            str_tolower(node->value));
+        }
+
+        sbrec_dns_set_records(dns_info->sb_dns, &lower_records);
+
+        smap_destroy(&lower_records);
+        free(dns_info->sbs);
+        free(dns_info);
+    }
+    hmap_destroy(&dns_map);
+}
+
+static void
+destroy_datapaths_and_ports(struct hmap *datapaths, struct hmap *ports,
+                            struct ovs_list *lr_list)
+{
+    struct ovn_datapath *router_dp;
+    LIST_FOR_EACH_POP (router_dp, lr_list, lr_list) {
+        if (router_dp->lr_group) {
+            struct lrouter_group *lr_group = router_dp->lr_group;
+
+            for (size_t i = 0; i < lr_group->n_router_dps; i++) {
+                lr_group->router_dps[i]->lr_group = NULL;
+            }
+
+            free(lr_group->router_dps);
+            sset_destroy(&lr_group->ha_chassis_groups);
+            free(lr_group);
+        }
+    }
+
+    struct ovn_datapath *dp;
+    HMAP_FOR_EACH_SAFE (dp, key_node, datapaths) {
+        ovn_datapath_destroy(datapaths, dp);
+    }
+    hmap_destroy(datapaths);
+
+    struct ovn_port *port;
+    HMAP_FOR_EACH_SAFE (port, key_node, ports) {
+        ovn_port_destroy(ports, port);
+    }
+    hmap_destroy(ports);
+}
+
+static void
+build_ip_mcast(struct northd_input *input_data,
+               struct ovsdb_idl_txn *ovnsb_txn,
+               struct hmap *datapaths)
+{
+    struct ovn_datapath *od;
+
+    HMAP_FOR_EACH (od, key_node, datapaths) {
+        if (!od->nbs) {
+            continue;
+        }
+
+        const struct sbrec_ip_multicast *ip_mcast =
+            ip_mcast_lookup(input_data->sbrec_ip_mcast_by_dp, od->sb);
+
+        if (!ip_mcast) {
+            ip_mcast = sbrec_ip_multicast_insert(ovnsb_txn);
+        }
+        store_mcast_info_for_switch_datapath(ip_mcast, od);
+    }
+
+    /* Delete southbound records without northbound matches. */
+    const struct sbrec_ip_multicast *sb;
+
+    SBREC_IP_MULTICAST_TABLE_FOR_EACH_SAFE (sb,
+                                   input_data->sbrec_ip_multicast_table) {
+        od = ovn_datapath_from_sbrec(datapaths, sb->datapath);
+        if (!od || ovn_datapath_is_stale(od)) {
+            sbrec_ip_multicast_delete(sb);
+        }
+    }
+}
+
+static void
+build_mcast_groups(struct lflow_input *input_data,
+                   const struct hmap *datapaths,
+                   const struct hmap *ports,
+                   struct hmap *mcast_groups,
+                   struct hmap *igmp_groups)
+{
+    struct ovn_port *op;
+
+    hmap_init(mcast_groups);
+    hmap_init(igmp_groups);
+
+    HMAP_FOR_EACH (op, key_node, ports) {
+        if (op->nbrp && lrport_is_enabled(op->nbrp)) {
+            /* If this port is configured to always flood multicast traffic
+             * add it to the MC_STATIC group.
+             */
+            if (op->mcast_info.flood) {
+                ovn_multicast_add(mcast_groups, &mc_static, op);
+                op->od->mcast_info.rtr.flood_static = true;
+            }
+        } else if (op->nbsp && lsp_is_enabled(op->nbsp)) {
+            ovn_multicast_add(mcast_groups, &mc_flood, op);
+
+            if (!lsp_is_router(op->nbsp)) {
+                ovn_multicast_add(mcast_groups, &mc_flood_l2, op);
+            }
+
+            /* If this port is connected to a multicast router then add it
+             * to the MC_MROUTER_FLOOD group.
+             */
+            if (op->od->mcast_info.sw.flood_relay && op->peer &&
+                    op->peer->od && op->peer->od->mcast_info.rtr.relay) {
+                ovn_multicast_add(mcast_groups, &mc_mrouter_flood, op);
+            }
+
+            /* If this port is configured to always flood multicast reports
+             * add it to the MC_MROUTER_STATIC group.
+             */
+            if (op->mcast_info.flood_reports) {
+                ovn_multicast_add(mcast_groups, &mc_mrouter_static, op);
+                op->od->mcast_info.sw.flood_reports = true;
+            }
+
+            /* If this port is configured to always flood multicast traffic
+             * add it to the MC_STATIC group.
+             */
+            if (op->mcast_info.flood) {
+                ovn_multicast_add(mcast_groups, &mc_static, op);
+                op->od->mcast_info.sw.flood_static = true;
+            }
+        }
+    }
+
+    const struct sbrec_igmp_group *sb_igmp;
+
+    SBREC_IGMP_GROUP_TABLE_FOR_EACH_SAFE (sb_igmp,
+                                     input_data->sbrec_igmp_group_table) {
+        /* If this is a stale group (e.g., controller had crashed,
+         * purge it).
+         */
+        if (!sb_igmp->chassis || !sb_igmp->datapath) {
+            sbrec_igmp_group_delete(sb_igmp);
+            continue;
+        }
+
+        /* If the datapath value is stale, purge the group. */
+        struct ovn_datapath *od =
+            ovn_datapath_from_sbrec(datapaths, sb_igmp->datapath);
+
+        if (!od || ovn_datapath_is_stale(od)) {
+            sbrec_igmp_group_delete(sb_igmp);
+            continue;
+        }
+
+        struct in6_addr group_address;
+        if (!ovn_igmp_group_get_address(sb_igmp, &group_address)) {
+            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
+            VLOG_WARN_RL(&rl, "invalid IGMP group address: %s",
+                         sb_igmp->address);
+            continue;
+        }
+
+        /* Extract the IGMP group ports from the SB entry. */
+        size_t n_igmp_ports;
+        struct ovn_port **igmp_ports =
+            ovn_igmp_group_get_ports(sb_igmp, &n_igmp_ports, ports);
+
+        /* It can be that all ports in the IGMP group record already have
+         * mcast_flood=true and then we can skip the group completely.
+         */
+        if (!igmp_ports) {
+            continue;
+        }
+
+        /* Add the IGMP group entry. Will also try to allocate an ID for it
+         * if the multicast group already exists.
+         */
+        struct ovn_igmp_group *igmp_group =
+            ovn_igmp_group_add(input_data, igmp_groups, od, &group_address,
+                               sb_igmp->address);
+
+        /* Add the extracted ports to the IGMP group. */
+        ovn_igmp_group_add_entry(igmp_group, igmp_ports, n_igmp_ports);
+    }
+
+    /* Build IGMP groups for multicast routers with relay enabled. The router
+     * IGMP groups are based on the groups learnt by their multicast enabled
+     * peers.
+     */
+    struct ovn_datapath *od;
+    HMAP_FOR_EACH (od, key_node, datapaths) {
+
+        if (ovs_list_is_empty(&od->mcast_info.groups)) {
+            continue;
+        }
+
+        for (size_t i = 0; i < od->n_router_ports; i++) {
+            struct ovn_port *router_port = od->router_ports[i]->peer;
+
+            /* If the router the port connects to doesn't have multicast
+             * relay enabled or if it was already configured to flood
+             * multicast traffic then skip it.
+             */
+            if (!router_port || !router_port->od ||
+                    !router_port->od->mcast_info.rtr.relay ||
+                    router_port->mcast_info.flood) {
+                continue;
+            }
+
+            struct ovn_igmp_group *igmp_group;
+            LIST_FOR_EACH (igmp_group, list_node, &od->mcast_info.groups) {
+                struct in6_addr *address = &igmp_group->address;
+
+                /* For IPv6 only relay routable multicast groups
+                 * (RFC 4291 2.7).
+                 */
+                if (!IN6_IS_ADDR_V4MAPPED(address) &&
+                        !ipv6_addr_is_routable_multicast(address)) {
+                    continue;
+                }
+
+                struct ovn_igmp_group *igmp_group_rtr =
+                    ovn_igmp_group_add(input_data,
+                                       igmp_groups, router_port->od,
+                                       address, igmp_group->mcgroup.name);
+                struct ovn_port **router_igmp_ports =
+                    xmalloc(sizeof *router_igmp_ports);
+                /* Store the chassis redirect port  otherwise traffic will not
+                 * be tunneled properly.
+                 */
+                router_igmp_ports[0] = router_port->cr_port
+                                       ? router_port->cr_port
+                                       : router_port;
+                ovn_igmp_group_add_entry(igmp_group_rtr, router_igmp_ports, 1);
+            }
+        }
+    }
+
+    /* Walk the aggregated IGMP groups and allocate IDs for new entries.
+     * Then store the ports in the associated multicast group.
+     */
+    struct ovn_igmp_group *igmp_group;
+    HMAP_FOR_EACH_SAFE (igmp_group, hmap_node, igmp_groups) {
+
+        if (!ovn_igmp_group_allocate_id(igmp_group)) {
+            /* If we ran out of keys just destroy the entry. */
+            ovn_igmp_group_destroy(igmp_groups, igmp_group);
+            continue;
+        }
+
+        /* Aggregate the ports from all entries corresponding to this
+         * group.
+         */
+        ovn_igmp_group_aggregate_ports(igmp_group, mcast_groups);
+    }
+}
+
+static void
+build_meter_groups(struct northd_input *input_data,
+                   struct shash *meter_groups)
+{
+    const struct nbrec_meter *nb_meter;
+    NBREC_METER_TABLE_FOR_EACH (nb_meter, input_data->nbrec_meter_table) {
+        shash_add(meter_groups, nb_meter->name, nb_meter);
+    }
+}
+
+/* The meters that the control plane protocols of a Copp resolve to, see
+ * copp_meter_get(), as of the last build of the logical flows or incremental
+ * update of their controller meters. */
+struct ovn_copp {
+    struct hmap_node hmap_node;   /* In northd_data 'copps', by uuid. */
+    const struct nbrec_copp *nb;
+    char *meters[COPP_PROTO_MAX];
+    char *old_meters[COPP_PROTO_MAX]; /* While in 'tracked_copp_changes'. */
+};
+
+static struct ovn_copp *
+ovn_copp_find(const struct hmap *copps, const struct uuid *uuid)
+{
+    struct ovn_copp *copp;
+    HMAP_FOR_EACH_WITH_HASH (copp, hmap_node, uuid_hash(uuid), copps) {
+        if (uuid_equals(&copp->nb->header_.uuid, uuid)) {
+            return copp;
+        }
+    }
+    return NULL;
+}
+
+static void
+ovn_copp_clear_old_meters(struct ovn_copp *copp)
+{
+    for (size_t i = 0; i < COPP_PROTO_MAX; i++) {
+        free(copp->old_meters[i]);
+        copp->old_meters[i] = NULL;
+    }
+}
+
+static void
+ovn_copp_destroy(struct ovn_copp *copp)
+{
+    for (size_t i = 0; i < COPP_PROTO_MAX; i++) {
+        free(copp->meters[i]);
+    }
+    ovn_copp_clear_old_meters(copp);
+    free(copp);
+}
+
+static void
+build_copps(struct northd_input *input_data, const struct shash *meter_groups,
+            struct hmap *copps)
+{
+    const struct nbrec_copp *nb_copp;
+    NBREC_COPP_TABLE_FOR_EACH (nb_copp, input_data->nbrec_copp_table) {
+        struct ovn_copp *copp = xzalloc(sizeof *copp);
+        copp->nb = nb_copp;
+        for (size_t i = 0; i < COPP_PROTO_MAX; i++) {
+            copp->meters[i] = nullable_xstrdup(copp_meter_get(i, nb_copp,
+                                                              meter_groups));
+        }
+        hmap_insert(copps, &copp->hmap_node,
+                    uuid_hash(&nb_copp->header_.uuid));
+    }
+}
+
+static const struct nbrec_static_mac_binding *
+static_mac_binding_by_port_ip(struct ovsdb_idl_index *nbrec_smb_by_lport_ip,
+                              const char *logical_port, const char *ip)
+{
+    struct nbrec_static_mac_binding *target =
+        nbrec_static_mac_binding_index_init_row(nbrec_smb_by_lport_ip);
+    nbrec_static_mac_binding_index_set_logical_port(target, logical_port);
+    nbrec_static_mac_binding_index_set_ip(target, ip);
+
+    const struct nbrec_static_mac_binding *nb_smb =
+        nbrec_static_mac_binding_index_find(nbrec_smb_by_lport_ip, target);
+    nbrec_static_mac_binding_index_destroy_row(target);
+
+    return nb_smb;
+}
+
+/* Creates or updates the SB Static_MAC_Binding of 'nb_smb', if its logical
+ * port is a router port. */
+static void
+sync_static_mac_binding(struct northd_input *input_data,
+                        struct ovsdb_idl_txn *ovnsb_txn,
+                        const struct nbrec_static_mac_binding *nb_smb,
+                        const struct hmap *ports)
+{
+    struct ovn_port *op = ovn_port_find(ports, nb_smb->logical_port);
+    if (!op || !op->nbrp || !op->od || !op->od->sb) {
+        return;
+    }
+
+    const struct sbrec_static_mac_binding *mb =
+        static_mac_binding_lookup(
+            input_data->sbrec_static_mac_binding_by_lport_ip,
+            nb_smb->logical_port, nb_smb->ip);
+    if (!mb) {
+        /* Create new entry */
+        mb = sbrec_static_mac_binding_insert(ovnsb_txn);
+        sbrec_static_mac_binding_set_logical_port(mb, nb_smb->logical_port);
+        sbrec_static_mac_binding_set_ip(mb, nb_smb->ip);
+        sbrec_static_mac_binding_set_mac(mb, nb_smb->mac);
+        sbrec_static_mac_binding_set_override_dynamic_mac(
+            mb, nb_smb->override_dynamic_mac);
+        sbrec_static_mac_binding_set_datapath(mb, op->od->sb);
+    } else {
+        /* Update existing entry if there is a change*/
+        if (strcmp(mb->mac, nb_smb->mac)) {
+            sbrec_static_mac_binding_set_mac(mb, nb_smb->mac);
+        }
+        if (mb->override_dynamic_mac != nb_smb->override_dynamic_mac) {
+            sbrec_static_mac_binding_set_override_dynamic_mac(
+                mb, nb_smb->override_dynamic_mac);
+        }
+    }
+}
+
+static void
+build_static_mac_binding_table(struct northd_input *input_data,
+                               struct ovsdb_idl_txn *ovnsb_txn,
+                               struct hmap *ports)
+{
+    /* Cleanup SB Static_MAC_Binding entries which do not have corresponding
+     * NB Static_MAC_Binding entries. */
+    const struct nbrec_static_mac_binding *nb_smb;
+    const struct sbrec_static_mac_binding *sb_smb;
+    SBREC_STATIC_MAC_BINDING_TABLE_FOR_EACH_SAFE (sb_smb,
+        input_data->sbrec_static_mac_binding_table) {
+        nb_smb = static_mac_binding_by_port_ip(
+            input_data->nbrec_static_mac_binding_by_lport_ip,
+            sb_smb->logical_port, sb_smb->ip);
+        if (!nb_smb) {
+            sbrec_static_mac_binding_delete(sb_smb);
+        }
+    }
+
+    /* Create/Update SB Static_MAC_Binding entries with corresponding values
+     * from NB Static_MAC_Binding entries. */
+    NBREC_STATIC_MAC_BINDING_TABLE_FOR_EACH (
+        nb_smb, input_data->nbrec_static_mac_binding_table) {
+        sync_static_mac_binding(input_data, ovnsb_txn, nb_smb, ports);
+    }
+}
+
+/* Syncs the changes of the NB Static_MAC_Binding rows to the SB directly, as
+ * no other NB or SB data depends on them.  Returns false if a full recompute
+ * is needed instead, i.e. if the port or the IP of a binding changed. */
+bool
+northd_handle_nb_static_mac_binding_changes(struct ovsdb_idl_txn *ovnsb_txn,
+                                            struct northd_input *input_data,
+                                            struct northd_data *nd)
+{
+    const struct nbrec_static_mac_binding *nb_smb;
+    NBREC_STATIC_MAC_BINDING_TABLE_FOR_EACH_TRACKED (
+        nb_smb, input_data->nbrec_static_mac_binding_table) {
+        if (nbrec_static_mac_binding_is_deleted(nb_smb)) {
+            /* The row may have been replaced by a new one with the same
+             * port and IP. */
+            if (static_mac_binding_by_port_ip(
+                    input_data->nbrec_static_mac_binding_by_lport_ip,
+                    nb_smb->logical_port, nb_smb->ip)) {
+                continue;
+            }
+            const struct sbrec_static_mac_binding *sb_smb =
+                static_mac_binding_lookup(
+                    input_data->sbrec_static_mac_binding_by_lport_ip,
+                    nb_smb->logical_port, nb_smb->ip);
+            if (sb_smb) {
+                sbrec_static_mac_binding_delete(sb_smb);
+            }
+            continue;
+        }
+
+        if (!nbrec_static_mac_binding_is_new(nb_smb)
+            && (nbrec_static_mac_binding_is_updated(
+                    nb_smb, NBREC_STATIC_MAC_BINDING_COL_LOGICAL_PORT)
+                || nbrec_static_mac_binding_is_updated(
+                    nb_smb, NBREC_STATIC_MAC_BINDING_COL_IP))) {
+            return false;
+        }
+
+        sync_static_mac_binding(input_data, ovnsb_txn, nb_smb, &nd->ports);
+    }
+    return true;
+}
+
+void
+northd_init(struct northd_data *data)
+{
+    hmap_init(&data->datapaths);
+    hmap_init(&data->ports);
+    hmap_init(&data->port_groups);
+    shash_init(&data->meter_groups);
+    hmap_init(&data->copps);
+    hmap_init(&data->lbs);
+    hmap_init(&data->bfd_connections);
+    hmap_init(&data->chassis_qdisc_queues);
+    ovs_list_init(&data->lr_list);
+    data->ovn_internal_version_changed = false;
+    sset_init(&data->svc_monitor_lsps);
+    data->change_tracked = false;
+    hmap_init(&data->tracked_ls_changes.updated);
+    hmapx_init(&data->tracked_lb_changes.updated);
+    hmapx_init(&data->tracked_copp_changes.updated);
+}
 
-    SBREC_IGMP_GROUP_TABLE_FOR_EACH_SAFE (sb_igmp,
-                                     input_data->sbrec_igmp_group_table) {
-        /* If this is a stale group (e.g., controller had crashed,
-         * purge it).
-         */
-        if (!sb_igmp->chassis || !sb_igmp->datapath) {
-            sbrec_igmp_group_delete(sb_igmp);
-            continue;
+void
+northd_destroy(struct northd_data *data)
+{
+    struct ovn_northd_lb *lb;
+    HMAP_FOR_EACH_POP (lb, hmap_node, &data->lbs) {
+        struct lflow_ref_node *lfrn;
+        LIST_FOR_EACH_SAFE (lfrn, lflow_list_node, &lb->lflows) {
+            lflow_ref_node_destroy(lfrn);
+        }
+        ovn_northd_lb_destroy(lb);
+    }
+    hmap_destroy(&data->lbs);
+
+    struct ovn_port_group *pg;
+    HMAP_FOR_EACH_SAFE (pg, key_node, &data->port_groups) {
+        ovn_port_group_destroy(&data->port_groups, pg);
+    }
+
+    hmap_destroy(&data->port_groups);
+    hmap_destroy(&data->bfd_connections);
+    destroy_chassis_queues(&data->chassis_qdisc_queues);
+
+    struct shash_node *node;
+    SHASH_FOR_EACH_SAFE (node, &data->meter_groups) {
+        shash_delete(&data->meter_groups, node);
+    }
+    shash_destroy(&data->meter_groups);
+
+    struct ovn_copp *copp;
+    HMAP_FOR_EACH_POP (copp, hmap_node, &data->copps) {
+        ovn_copp_destroy(copp);
+    }
+    hmap_destroy(&data->copps);
+
+    /* XXX Having to explicitly clean up macam here
+     * is a bit strange. We don't explicitly initialize
+     * macam in this module, but this is the logical place
+     * to clean it up. Ideally, more IPAM logic can be factored
+     * out of ovn-northd and this can be taken care of there
+     * as well.
+     */
+    cleanup_macam();
+
+    destroy_northd_data_tracked_changes(data);
+    hmap_destroy(&data->tracked_ls_changes.updated);
+    hmapx_destroy(&data->tracked_lb_changes.updated);
+    hmapx_destroy(&data->tracked_copp_changes.updated);
+    sset_destroy(&data->svc_monitor_lsps);
+
+    destroy_datapaths_and_ports(&data->datapaths, &data->ports,
+                                &data->lr_list);
+}
+
+void
+northd_get_memory_usage(const struct northd_data *data, struct simap *usage)
+{
+    size_t ipam_usage = 0;
+    const struct ovn_datapath *od;
+    HMAP_FOR_EACH (od, key_node, &data->datapaths) {
+        ipam_usage += ipam_info_get_memory_usage(&od->ipam_info);
+    }
+
+    size_t n_lb_vips = 0;
+    const struct ovn_northd_lb *lb;
+    HMAP_FOR_EACH (lb, hmap_node, &data->lbs) {
+        n_lb_vips += lb->n_vips;
+    }
+
+    simap_increase(usage, "datapaths", hmap_count(&data->datapaths));
+    simap_increase(usage, "ports", hmap_count(&data->ports));
+    simap_increase(usage, "port_groups", hmap_count(&data->port_groups));
+    simap_increase(usage, "lbs", hmap_count(&data->lbs));
+    simap_increase(usage, "lb_vips", n_lb_vips);
+    simap_increase(usage, "qdisc_queue_ids", qdisc_queue_stats.n_in_use);
+    simap_increase(usage, "ipam_usage-KB", ROUND_UP(ipam_usage, 1024) / 1024);
+    ipam_get_memory_usage(usage);
+}
+
+static void
+ovnnb_db_run(struct northd_input *input_data,
+             struct northd_data *data,
+             struct ovsdb_idl_txn *ovnnb_txn,
+             struct ovsdb_idl_txn *ovnsb_txn,
+             struct ovsdb_idl_index *sbrec_chassis_by_name,
+             struct ovsdb_idl_index *sbrec_chassis_by_hostname)
+{
+    if (!ovnsb_txn || !ovnnb_txn) {
+        return;
+    }
+    stopwatch_start(BUILD_LFLOWS_CTX_STOPWATCH_NAME, time_msec());
+
+    /* Sync ipsec configuration.
+     * Copy nb_cfg from northbound to southbound database.
+     * Also set up to update sb_cfg once our southbound transaction commits. */
+    const struct nbrec_nb_global *nb = nbrec_nb_global_table_first(
+                                       input_data->nbrec_nb_global_table);
+    if (!nb) {
+        nb = nbrec_nb_global_insert(ovnnb_txn);
+    }
+    const struct sbrec_sb_global *sb = sbrec_sb_global_table_first(
+                                       input_data->sbrec_sb_global_table);
+    if (!sb) {
+        sb = sbrec_sb_global_insert(ovnsb_txn);
+    }
+    if (nb->ipsec != sb->ipsec) {
+        sbrec_sb_global_set_ipsec(sb, nb->ipsec);
+    }
+    sbrec_sb_global_set_options(sb, &nb->options);
+
+    const char *mac_addr_prefix = set_mac_prefix(smap_get(&nb->options,
+                                                          "mac_prefix"));
+
+    const char *monitor_mac = smap_get(&nb->options, "svc_monitor_mac");
+    if (monitor_mac) {
+        if (eth_addr_from_string(monitor_mac, &svc_monitor_mac_ea)) {
+            snprintf(svc_monitor_mac, sizeof svc_monitor_mac,
+                     ETH_ADDR_FMT, ETH_ADDR_ARGS(svc_monitor_mac_ea));
+        } else {
+            monitor_mac = NULL;
+        }
+    }
+
+    struct smap options;
+    smap_clone(&options, &nb->options);
+
+    smap_replace(&options, "mac_prefix", mac_addr_prefix);
+
+    if (!monitor_mac) {
+        eth_addr_random(&svc_monitor_mac_ea);
+        snprintf(svc_monitor_mac, sizeof svc_monitor_mac,
+                 ETH_ADDR_FMT, ETH_ADDR_ARGS(svc_monitor_mac_ea));
+        smap_replace(&options, "svc_monitor_mac", svc_monitor_mac);
+    }
+
+    char *max_tunid = xasprintf("%d", get_ovn_max_dp_key_local(input_data));
+    smap_replace(&options, "max_tunid", max_tunid);
+    free(max_tunid);
+
+    char *ovn_internal_version = ovn_get_internal_version();
+    if (!strcmp(ovn_internal_version,
+                smap_get_def(&options, "northd_internal_version", ""))) {
+        data->ovn_internal_version_changed = false;
+    } else {
+        smap_replace(&options, "northd_internal_version",
+                     ovn_internal_version);
+    }
+    free(ovn_internal_version);
+
+    if (!smap_equal(&nb->options, &options)) {
+        nbrec_nb_global_verify_options(nb);
+        nbrec_nb_global_set_options(nb, &options);
+    }
+
+    smap_destroy(&options);
+
+    bool old_use_ldp = use_logical_dp_groups;
+    use_logical_dp_groups = smap_get_bool(&nb->options,
+                                          "use_logical_dp_groups", true);
+    if (use_logical_dp_groups && !old_use_ldp) {
+        worker_pool_init_for_ldp();
+    }
+
+    use_ct_inv_match = smap_get_bool(&nb->options,
+                                     "use_ct_inv_match", true);
+
+    max_lflow_changes_per_sb_txn =
+        MAX(smap_get_int(&nb->options, "max_lflow_changes_per_sb_txn", 0), 0);
+
+    /* deprecated, use --event instead */
+    controller_event_en = smap_get_bool(&nb->options,
+                                        "controller_event", false);
+    check_lsp_is_up = !smap_get_bool(&nb->options,
+                                     "ignore_lsp_down", true);
+    group_arp_nd_responder = smap_get_bool(&nb->options,
+                                           "group_arp_nd_responder", false);
+    parameterized_lflows = smap_get_bool(&nb->options,
+                                         "parameterized_lflows", false);
+    default_acl_drop = smap_get_bool(&nb->options, "default_acl_drop", false);
+    acl_log_rate_limit = ovn_smap_get_uint(&nb->options,
+                                           "acl_log_rate_limit", 0);
+    acl_log_burst_size = ovn_smap_get_uint(&nb->options,
+                                           "acl_log_burst_size", 0);
+
+    build_datapaths(input_data, ovnsb_txn, &data->datapaths, &data->lr_list);
+    build_lbs(input_data, &data->datapaths, &data->lbs);
+    build_ports(input_data, ovnsb_txn, sbrec_chassis_by_name,
+                sbrec_chassis_by_hostname,
+                &data->datapaths, &data->ports, &data->chassis_qdisc_queues);
+    build_lb_port_related_data(&data->datapaths, &data->ports, &data->lbs,
+                               input_data, ovnsb_txn,
+                               &data->svc_monitor_lsps);
+    build_ipam(&data->datapaths, &data->ports);
+    build_port_group_lswitches(input_data, &data->port_groups, &data->ports);
+    build_lrouter_groups(&data->ports, &data->lr_list);
+    build_ip_mcast(input_data, ovnsb_txn, &data->datapaths);
+    build_meter_groups(input_data, &data->meter_groups);
+    build_copps(input_data, &data->meter_groups, &data->copps);
+    build_static_mac_binding_table(input_data, ovnsb_txn, &data->ports);
+    stopwatch_stop(BUILD_LFLOWS_CTX_STOPWATCH_NAME, time_msec());
+    stopwatch_start(CLEAR_LFLOWS_CTX_STOPWATCH_NAME, time_msec());
+    ovn_update_ipv6_options(&data->ports);
+    ovn_update_ipv6_prefix(&data->ports);
+
+    sync_lbs(input_data, ovnsb_txn, &data->datapaths, &data->lbs);
+    sync_address_sets(input_data, ovnsb_txn, &data->datapaths);
+    sync_port_groups(input_data, ovnsb_txn, &data->port_groups);
+    sync_meters(input_data, ovnsb_txn, &data->meter_groups);
+    sync_dns_entries(input_data, ovnsb_txn, &data->datapaths);
+    cleanup_stale_fdb_entries(input_data, &data->datapaths);
+    stopwatch_stop(CLEAR_LFLOWS_CTX_STOPWATCH_NAME, time_msec());
+}
+
+void
+destroy_northd_data_tracked_changes(struct northd_data *nd)
+{
+    struct ls_change *ls_change;
+    HMAP_FOR_EACH_POP (ls_change, hmap_node,
+                       &nd->tracked_ls_changes.updated) {
+        struct ovn_port *op;
+        LIST_FOR_EACH_SAFE (op, list, &ls_change->deleted_ports) {
+            ovs_list_remove(&op->list);
+            ovn_port_destroy_orphan(op);
+        }
+        free(ls_change);
+    }
+    hmapx_clear(&nd->tracked_lb_changes.updated);
+
+    struct hmapx_node *node;
+    HMAPX_FOR_EACH_SAFE (node, &nd->tracked_copp_changes.updated) {
+        ovn_copp_clear_old_meters(node->data);
+        hmapx_delete(&nd->tracked_copp_changes.updated, node);
+    }
+    nd->change_tracked = false;
+}
+
+static struct ls_change *
+ls_change_find_or_create(struct northd_data *nd, struct ovn_datapath *od)
+{
+    struct ls_change *ls_change;
+    uint32_t hash = uuid_hash(&od->key);
+    HMAP_FOR_EACH_WITH_HASH (ls_change, hmap_node, hash,
+                             &nd->tracked_ls_changes.updated) {
+        if (ls_change->od == od) {
+            return ls_change;
+        }
+    }
+
+    ls_change = xzalloc(sizeof *ls_change);
+    ls_change->od = od;
+    ovs_list_init(&ls_change->added_ports);
+    ovs_list_init(&ls_change->deleted_ports);
+    ovs_list_init(&ls_change->updated_ports);
+    hmap_insert(&nd->tracked_ls_changes.updated, &ls_change->hmap_node, hash);
+    return ls_change;
+}
+
+/* Returns true if the changes to NB_Global can be ignored by 'en-northd',
+ * i.e., if only the sequence number columns, which are handled by
+ * ovn-northd's main loop, changed. */
+bool
+northd_handle_nb_global_changes(
+    const struct nbrec_nb_global_table *nb_global_table)
+{
+    const struct nbrec_nb_global *nb;
+    NBREC_NB_GLOBAL_TABLE_FOR_EACH_TRACKED (nb, nb_global_table) {
+        if (nbrec_nb_global_is_new(nb) || nbrec_nb_global_is_deleted(nb)) {
+            return false;
+        }
+        for (enum nbrec_nb_global_column_id col = 0;
+             col < NBREC_NB_GLOBAL_N_COLUMNS; col++) {
+            if (col == NBREC_NB_GLOBAL_COL_NB_CFG ||
+                col == NBREC_NB_GLOBAL_COL_NB_CFG_TIMESTAMP ||
+                col == NBREC_NB_GLOBAL_COL_SB_CFG ||
+                col == NBREC_NB_GLOBAL_COL_SB_CFG_TIMESTAMP ||
+                col == NBREC_NB_GLOBAL_COL_HV_CFG ||
+                col == NBREC_NB_GLOBAL_COL_HV_CFG_TIMESTAMP) {
+                continue;
+            }
+            if (nbrec_nb_global_is_updated(nb, col)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/* Same as northd_handle_nb_global_changes() for SB_Global, whose 'nb_cfg'
+ * column is written by ovn-northd itself. */
+bool
+northd_handle_sb_global_changes(
+    const struct sbrec_sb_global_table *sb_global_table)
+{
+    const struct sbrec_sb_global *sb;
+    SBREC_SB_GLOBAL_TABLE_FOR_EACH_TRACKED (sb, sb_global_table) {
+        if (sbrec_sb_global_is_new(sb) || sbrec_sb_global_is_deleted(sb)) {
+            return false;
+        }
+        for (enum sbrec_sb_global_column_id col = 0;
+             col < SBREC_SB_GLOBAL_N_COLUMNS; col++) {
+            if (col != SBREC_SB_GLOBAL_COL_NB_CFG &&
+                sbrec_sb_global_is_updated(sb, col)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/* Returns true if columns of 'ls' other than 'ports' were updated. */
+static bool
+check_ls_changes_other_than_lsp(const struct nbrec_logical_switch *ls)
+{
+    for (enum nbrec_logical_switch_column_id col = 0;
+         col < NBREC_LOGICAL_SWITCH_N_COLUMNS; col++) {
+        if (col != NBREC_LOGICAL_SWITCH_COL_PORTS &&
+            nbrec_logical_switch_is_updated(ls, col)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool
+od_has_ipam(const struct ovn_datapath *od)
+{
+    return od->ipam_info.allocated_ipv4s || od->ipam_info.ipv6_prefix_set
+           || od->ipam_info.mac_only;
+}
+
+/* Returns true if 'nbsp' is referenced by any NB Port_Group.  The addresses
+ * of such ports are synced to the port group's generated address sets by
+ * sync_address_sets(), which only runs on a recompute. */
+static bool
+lsp_is_in_port_group(const struct nbrec_port_group_table *nb_pg_table,
+                     const struct nbrec_logical_switch_port *nbsp)
+{
+    const struct nbrec_port_group *nb_pg;
+    NBREC_PORT_GROUP_TABLE_FOR_EACH (nb_pg, nb_pg_table) {
+        for (size_t i = 0; i < nb_pg->n_ports; i++) {
+            if (nb_pg->ports[i] == nbsp) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/* Creates the SB Port_Binding for the new VIF 'nbsp' of logical switch 'od'
+ * and the corresponding ovn_port.  Returns NULL if no tunnel key could be
+ * allocated for the port. */
+static struct ovn_port *
+ls_port_create(struct ovsdb_idl_txn *ovnsb_txn,
+               struct northd_input *ni, struct northd_data *nd,
+               const struct nbrec_logical_switch_port *nbsp,
+               struct ovn_datapath *od)
+{
+    struct ovn_port *op = ovn_port_create(&nd->ports, nbsp->name, nbsp, NULL,
+                                          NULL);
+    ovn_port_init_lsp_addresses(op, nbsp);
+    op->lsp_can_be_inc_processed = true;
+    op->od = od;
+
+    ovn_port_assign_requested_tnl_id(ni, op);
+    if (!op->tunnel_key) {
+        uint8_t key_bits = is_vxlan_mode(ni) ? 12 : 16;
+        op->tunnel_key = ovn_allocate_tnlid(&od->port_tnlids, "port",
+                                            1, (1u << (key_bits - 1)) - 1,
+                                            &od->port_key_hint);
+        if (!op->tunnel_key) {
+            ovn_port_destroy(&nd->ports, op);
+            return NULL;
+        }
+    }
+    ovs_list_push_back(&od->port_list, &op->dp_node);
+
+    struct sset active_ha_chassis_grps =
+        SSET_INITIALIZER(&active_ha_chassis_grps);
+    op->sb = sbrec_port_binding_insert(ovnsb_txn);
+    ovn_port_update_sbrec(ni, ovnsb_txn, ni->sbrec_chassis_by_name,
+                          ni->sbrec_chassis_by_hostname, op,
+                          &nd->chassis_qdisc_queues, &active_ha_chassis_grps);
+    sbrec_port_binding_set_logical_port(op->sb, op->key);
+    sset_destroy(&active_ha_chassis_grps);
+
+    ipam_add_port_addresses(od, op);
+    return op;
+}
+
+/* Deletes the SB Port_Binding and the FDB entries of 'op' and removes 'op'
+ * from 'ports' and from its datapath.  The caller takes ownership of 'op'. */
+static void
+ls_port_delete(struct northd_input *ni, struct hmap *ports,
+               struct ovn_port *op)
+{
+    struct ovn_datapath *od = op->od;
+
+    hmap_remove(ports, &op->key_node);
+    ovs_list_remove(&op->dp_node);
+    ovn_free_tnlid(&od->port_tnlids, op->tunnel_key);
+    sbrec_port_binding_delete(op->sb);
+
+    const struct sbrec_fdb *fdb_e;
+    SBREC_FDB_TABLE_FOR_EACH_SAFE (fdb_e, ni->sbrec_fdb_table) {
+        if (fdb_e->dp_key == od->tunnel_key &&
+            fdb_e->port_key == op->tunnel_key) {
+            sbrec_fdb_delete(fdb_e);
         }
+    }
+}
 
-        /* If the datapath value is stale, purge the group. */
-        struct ovn_datapath *od =
-            ovn_datapath_from_sbrec(datapaths, sb_igmp->datapath);
+/* Handles additions and deletions of VIFs in the tracked logical switches
+ * without recomputing all of 'nd'.  Returns false, after which the caller
+ * must fall back to a full recompute, if any change cannot be handled
+ * incrementally. */
+bool
+northd_handle_ls_changes(struct ovsdb_idl_txn *ovnsb_txn,
+                         struct northd_input *ni,
+                         struct northd_data *nd)
+{
+    const struct nbrec_logical_switch *changed_ls;
 
-        if (!od || ovn_datapath_is_stale(od)) {
-            sbrec_igmp_group_delete(sb_igmp);
-            continue;
+    NBREC_LOGICAL_SWITCH_TABLE_FOR_EACH_TRACKED (changed_ls,
+                                                ni->nbrec_logical_switch) {
+        if (nbrec_logical_switch_is_new(changed_ls) ||
+            nbrec_logical_switch_is_deleted(changed_ls)) {
+            return false;
         }
-
-        struct in6_addr group_address;
-        if (!ovn_igmp_group_get_address(sb_igmp, &group_address)) {
+        struct ovn_datapath *od = ovn_datapath_find(&nd->datapaths,
+                                                    &changed_ls->header_.uuid);
+        if (!od || od->nbs != changed_ls) {
             static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
-            VLOG_WARN_RL(&rl, "invalid IGMP group address: %s",
-                         sb_igmp->address);
-            continue;
+            VLOG_WARN_RL(&rl, "Internal error: a tracked updated LS doesn't "
+                         "exist in datapaths: "UUID_FMT,
+                         UUID_ARGS(&changed_ls->header_.uuid));
+            return false;
         }
 
-        /* Extract the IGMP group ports from the SB entry. */
-        size_t n_igmp_ports;
-        struct ovn_port **igmp_ports =
-            ovn_igmp_group_get_ports(sb_igmp, &n_igmp_ports, ports);
-
-        /* It can be that all ports in the IGMP group record already have
-         * mcast_flood=true and then we can skip the group completely.
-         */
-        if (!igmp_ports) {
-            continue;
+        /* Only port additions and deletions can be handled for now. */
+        if (check_ls_changes_other_than_lsp(changed_ls) || od_has_ipam(od)) {
+            return false;
         }
 
-        /* Add the IGMP group entry. Will also try to allocate an ID for it
-         * if the multicast group already exists.
-         */
-        struct ovn_igmp_group *igmp_group =
-            ovn_igmp_group_add(input_data, igmp_groups, od, &group_address,
-                               sb_igmp->address);
+        struct ovn_port *op;
+        LIST_FOR_EACH (op, dp_node, &od->port_list) {
+            op->visited = false;
+        }
 
-        /* Add the extracted ports to the IGMP group. */
-        ovn_igmp_group_add_entry(igmp_group, igmp_ports, n_igmp_ports);
-    }
+        /* First make sure all added and deleted ports are supported so that
+         * nothing is modified if we need to fall back to a recompute. */
+        bool has_new_ports = false;
+        for (size_t i = 0; i < changed_ls->n_ports; i++) {
+            const struct nbrec_logical_switch_port *nbsp =
+                changed_ls->ports[i];
+            op = ovn_port_find(&nd->ports, nbsp->name);
+            if (!op) {
+                if (!lsp_can_be_inc_processed(nbsp) ||
+                    sset_contains(&nd->svc_monitor_lsps, nbsp->name)) {
+                    return false;
+                }
+                has_new_ports = true;
+            } else if (op->od != od || op->nbsp != nbsp) {
+                return false;
+            } else {
+                op->visited = true;
+            }
+        }
 
-    /* Build IGMP groups for multicast routers with relay enabled. The router
-     * IGMP groups are based on the groups learnt by their multicast enabled
-     * peers.
-     */
-    struct ovn_datapath *od;
-    HMAP_FOR_EACH (od, key_node, datapaths) {
+        bool has_deleted_ports = false;
+        LIST_FOR_EACH (op, dp_node, &od->port_list) {
+            if (!op->visited) {
+                if (!op->lsp_can_be_inc_processed ||
+                    sset_contains(&nd->svc_monitor_lsps, op->key)) {
+                    return false;
+                }
+                has_deleted_ports = true;
+            }
+        }
 
-        if (ovs_list_is_empty(&od->mcast_info.groups)) {
+        if (!has_new_ports && !has_deleted_ports) {
             continue;
         }
 
-        for (size_t i = 0; i < od->n_router_ports; i++) {
-            struct ovn_port *router_port = od->router_ports[i]->peer;
+        struct ls_change *ls_change = ls_change_find_or_create(nd, od);
+        LIST_FOR_EACH_SAFE (op, dp_node, &od->port_list) {
+            if (!op->visited) {
+                ls_port_delete(ni, &nd->ports, op);
+                ovs_list_push_back(&ls_change->deleted_ports, &op->list);
+            }
+        }
 
-            /* If the router the port connects to doesn't have multicast
-             * relay enabled or if it was already configured to flood
-             * multicast traffic then skip it.
-             */
-            if (!router_port || !router_port->od ||
-                    !router_port->od->mcast_info.rtr.relay ||
-                    router_port->mcast_info.flood) {
+        for (size_t i = 0; i < changed_ls->n_ports && has_new_ports; i++) {
+            const struct nbrec_logical_switch_port *nbsp =
+                changed_ls->ports[i];
+            if (ovn_port_find(&nd->ports, nbsp->name)) {
                 continue;
             }
-
-            struct ovn_igmp_group *igmp_group;
-            LIST_FOR_EACH (igmp_group, list_node, &od->mcast_info.groups) {
-                struct in6_addr *address = &igmp_group->address;
-
-                /* For IPv6 only relay routable multicast groups
-                 * (RFC 4291 2.7).
-                 */
-                if (!IN6_IS_ADDR_V4MAPPED(address) &&
-                        !ipv6_addr_is_routable_multicast(address)) {
-                    continue;
-                }
-
-                struct ovn_igmp_group *igmp_group_rtr =
-                    ovn_igmp_group_add(input_data,
-                                       igmp_groups, router_port->od,
-                                       address, igmp_group->mcgroup.name);
-                struct ovn_port **router_igmp_ports =
-                    xmalloc(sizeof *router_igmp_ports);
-                /* Store the chassis redirect port  otherwise traffic will not
-                 * be tunneled properly.
-                 */
-                router_igmp_ports[0] = router_port->cr_port
-                                       ? router_port->cr_port
-                                       : router_port;
-                ovn_igmp_group_add_entry(igmp_group_rtr, router_igmp_ports, 1);
+            op = ls_port_create(ovnsb_txn, ni, nd, nbsp, od);
+            if (!op) {
+                return false;
             }
+            ovs_list_push_back(&ls_change->added_ports, &op->list);
         }
+        nd->change_tracked = true;
     }
 
-    /* Walk the aggregated IGMP groups and allocate IDs for new entries.
-     * Then store the ports in the associated multicast group.
-     */
-    struct ovn_igmp_group *igmp_group;
-    HMAP_FOR_EACH_SAFE (igmp_group, hmap_node, igmp_groups) {
+    return true;
+}
 
-        if (!ovn_igmp_group_allocate_id(igmp_group)) {
-            /* If we ran out of keys just destroy the entry. */
-            ovn_igmp_group_destroy(igmp_groups, igmp_group);
+/* Handles updates of existing VIFs.  Additions and deletions are tracked as
+ * updates of the 'ports' column of the logical switch and are handled by
+ * northd_handle_ls_changes(). */
+bool
+northd_handle_lsp_changes(
+    struct ovsdb_idl_txn *ovnsb_txn,
+    const struct nbrec_logical_switch_port_table *nbrec_lsp_table,
+    struct northd_input *ni,
+    struct northd_data *nd)
+{
+    const struct nbrec_logical_switch_port *nbsp;
+
+    /* Check all the updates first so that nothing is modified if we need to
+     * fall back to a recompute. */
+    NBREC_LOGICAL_SWITCH_PORT_TABLE_FOR_EACH_TRACKED (nbsp, nbrec_lsp_table) {
+        if (nbrec_logical_switch_port_is_new(nbsp) ||
+            nbrec_logical_switch_port_is_deleted(nbsp)) {
             continue;
         }
 
-        /* Aggregate the ports from all entries corresponding to this
-         * group.
-         */
-        ovn_igmp_group_aggregate_ports(igmp_group, mcast_groups);
-    }
-}
+        struct ovn_port *op = ovn_port_find(&nd->ports, nbsp->name);
+        if (!op || op->nbsp != nbsp || !op->od || od_has_ipam(op->od) ||
+            !op->lsp_can_be_inc_processed ||
+            !lsp_can_be_inc_processed(nbsp) ||
+            sset_contains(&nd->svc_monitor_lsps, nbsp->name)) {
+            return false;
+        }
 
-static void
-build_meter_groups(struct northd_input *input_data,
-                   struct shash *meter_groups)
-{
-    const struct nbrec_meter *nb_meter;
-    NBREC_METER_TABLE_FOR_EACH (nb_meter, input_data->nbrec_meter_table) {
-        shash_add(meter_groups, nb_meter->name, nb_meter);
-    }
-}
+        /* Renaming a port changes its key in 'ports'. */
+        if (nbrec_logical_switch_port_is_updated(
+                nbsp, NBREC_LOGICAL_SWITCH_PORT_COL_NAME)) {
+            return false;
+        }
 
-static const struct nbrec_static_mac_binding *
-static_mac_binding_by_port_ip(struct northd_input *input_data,
-                       const char *logical_port, const char *ip)
-{
-    const struct nbrec_static_mac_binding *nb_smb = NULL;
+        uint32_t requested_key = smap_get_int(&nbsp->options,
+                                              "requested-tnl-key", 0);
+        if (requested_key && requested_key != op->tunnel_key) {
+            return false;
+        }
 
-    NBREC_STATIC_MAC_BINDING_TABLE_FOR_EACH (
-        nb_smb, input_data->nbrec_static_mac_binding_table) {
-        if (!strcmp(nb_smb->logical_port, logical_port) &&
-            !strcmp(nb_smb->ip, ip)) {
-            break;
+        if (nbrec_logical_switch_port_is_updated(
+                nbsp, NBREC_LOGICAL_SWITCH_PORT_COL_ADDRESSES) &&
+            lsp_is_in_port_group(ni->nbrec_port_group_table, nbsp)) {
+            return false;
         }
     }
 
-    return nb_smb;
-}
-
-static void
-build_static_mac_binding_table(struct northd_input *input_data,
-                               struct ovsdb_idl_txn *ovnsb_txn,
-                               struct hmap *ports)
-{
-    /* Cleanup SB Static_MAC_Binding entries which do not have corresponding
-     * NB Static_MAC_Binding entries. */
-    const struct nbrec_static_mac_binding *nb_smb;
-    const struct sbrec_static_mac_binding *sb_smb;
-    SBREC_STATIC_MAC_BINDING_TABLE_FOR_EACH_SAFE (sb_smb,
-        input_data->sbrec_static_mac_binding_table) {
-        nb_smb = static_mac_binding_by_port_ip(input_data,
-                                               sb_smb->logical_port,
-                                               sb_smb->ip);
-        if (!nb_smb) {
-            sbrec_static_mac_binding_delete(sb_smb);
+    NBREC_LOGICAL_SWITCH_PORT_TABLE_FOR_EACH_TRACKED (nbsp, nbrec_lsp_table) {
+        if (nbrec_logical_switch_port_is_new(nbsp) ||
+            nbrec_logical_switch_port_is_deleted(nbsp)) {
+            continue;
         }
-    }
 
-    /* Create/Update SB Static_MAC_Binding entries with corresponding values
-     * from NB Static_MAC_Binding entries. */
-    NBREC_STATIC_MAC_BINDING_TABLE_FOR_EACH (
-        nb_smb, input_data->nbrec_static_mac_binding_table) {
-        struct ovn_port *op = ovn_port_find(ports, nb_smb->logical_port);
-        if (op && op->nbrp) {
-            struct ovn_datapath *od = op->od;
-            if (od && od->sb) {
-                const struct sbrec_static_mac_binding *mb =
-                    static_mac_binding_lookup(
-                        input_data->sbrec_static_mac_binding_by_lport_ip,
-                        nb_smb->logical_port, nb_smb->ip);
-                if (!mb) {
-                    /* Create new entry */
-                    mb = sbrec_static_mac_binding_insert(ovnsb_txn);
-                    sbrec_static_mac_binding_set_logical_port(
-                        mb, nb_smb->logical_port);
-                    sbrec_static_mac_binding_set_ip(mb, nb_smb->ip);
-                    sbrec_static_mac_binding_set_mac(mb, nb_smb->mac);
-                    sbrec_static_mac_binding_set_override_dynamic_mac(mb,
-                        nb_smb->override_dynamic_mac);
-                    sbrec_static_mac_binding_set_datapath(mb, od->sb);
-                } else {
-                    /* Update existing entry if there is a change*/
-                    if (strcmp(mb->mac, nb_smb->mac)) {
-                        sbrec_static_mac_binding_set_mac(mb, nb_smb->mac);
-                    }
-                    if (mb->override_dynamic_mac !=
-                        nb_smb->override_dynamic_mac) {
-                        sbrec_static_mac_binding_set_override_dynamic_mac(mb,
-                            nb_smb->override_dynamic_mac);
-                    }
-                }
+        /* The 'up' column is written by ovn-northd itself and only matters
+         * for the logical flows if "ignore_lsp_down" is disabled. */
+        bool only_up_changed = true;
+        for (enum nbrec_logical_switch_port_column_id col = 0;
+             col < NBREC_LOGICAL_SWITCH_PORT_N_COLUMNS; col++) {
+            if (col != NBREC_LOGICAL_SWITCH_PORT_COL_UP &&
+                nbrec_logical_switch_port_is_updated(nbsp, col)) {
+                only_up_changed = false;
+                break;
             }
         }
+        if (only_up_changed && !check_lsp_is_up) {
+            continue;
+        }
+
+        struct ovn_port *op = ovn_port_find(&nd->ports, nbsp->name);
+        ovn_port_cleanup_lsp_addresses(op);
+        ovn_port_init_lsp_addresses(op, nbsp);
+        ovn_port_set_nb(op, nbsp, NULL);
+
+        struct sset active_ha_chassis_grps =
+            SSET_INITIALIZER(&active_ha_chassis_grps);
+        ovn_port_update_sbrec(ni, ovnsb_txn, ni->sbrec_chassis_by_name,
+                              ni->sbrec_chassis_by_hostname, op,
+                              &nd->chassis_qdisc_queues,
+                              &active_ha_chassis_grps);
+        sset_destroy(&active_ha_chassis_grps);
+        ipam_add_port_addresses(op->od, op);
+
+        struct ls_change *ls_change = ls_change_find_or_create(nd, op->od);
+        ovs_list_push_back(&ls_change->updated_ports, &op->list);
+        nd->change_tracked = true;
     }
-}
 
-void
-northd_init(struct northd_data *data)
-{
-    hmap_init(&data->datapaths);
-    hmap_init(&data->ports);
-    hmap_init(&data->port_groups);
-    shash_init(&data->meter_groups);
-    hmap_init(&data->lbs);
-    hmap_init(&data->bfd_connections);
-    ovs_list_init(&data->lr_list);
-    data->ovn_internal_version_changed = false;
+    return true;
 }
 
-void
-northd_destroy(struct northd_data *data)
+/* Returns true if 'a' and 'b', which were parsed from two versions of the
+ * same NB Load_Balancer, have the same VIPs, regardless of their backends. */
+static bool
+ovn_northd_lb_vips_equal(const struct ovn_northd_lb *a,
+                         const struct ovn_northd_lb *b)
 {
-    struct ovn_northd_lb *lb;
-    HMAP_FOR_EACH_POP (lb, hmap_node, &data->lbs) {
-        ovn_northd_lb_destroy(lb);
+    if (a->n_vips != b->n_vips
+        || !sset_equals(&a->ips_v4, &b->ips_v4)
+        || !sset_equals(&a->ips_v6, &b->ips_v6)) {
+        return false;
     }
-    hmap_destroy(&data->lbs);
 
-    struct ovn_port_group *pg;
-    HMAP_FOR_EACH_SAFE (pg, key_node, &data->port_groups) {
-        ovn_port_group_destroy(&data->port_groups, pg);
+    struct sset vips = SSET_INITIALIZER(&vips);
+    for (size_t i = 0; i < a->n_vips; i++) {
+        sset_add(&vips, a->vips_nb[i].vip_port_str);
     }
 
-    hmap_destroy(&data->port_groups);
-    hmap_destroy(&data->bfd_connections);
-
-    struct shash_node *node;
-    SHASH_FOR_EACH_SAFE (node, &data->meter_groups) {
-        shash_delete(&data->meter_groups, node);
+    bool equal = true;
+    for (size_t i = 0; i < b->n_vips; i++) {
+        if (!sset_contains(&vips, b->vips_nb[i].vip_port_str)) {
+            equal = false;
+            break;
+        }
     }
-    shash_destroy(&data->meter_groups);
-
-    /* XXX Having to explicitly clean up macam here
-     * is a bit strange. We don't explicitly initialize
-     * macam in this module, but this is the logical place
-     * to clean it up. Ideally, more IPAM logic can be factored
-     * out of ovn-northd and this can be taken care of there
-     * as well.
-     */
-    cleanup_macam();
-
-    destroy_datapaths_and_ports(&data->datapaths, &data->ports,
-                                &data->lr_list);
+    sset_destroy(&vips);
+    return equal;
 }
 
-static void
-ovnnb_db_run(struct northd_input *input_data,
-             struct northd_data *data,
-             struct ovsdb_idl_txn *ovnnb_txn,
-             struct ovsdb_idl_txn *ovnsb_txn,
-             struct ovsdb_idl_index *sbrec_chassis_by_name,
-             struct ovsdb_idl_index *sbrec_chassis_by_hostname)
+/* Handles the updates of the backends of existing load balancers, which are
+ * tracked in 'nd->tracked_lb_changes' so that only their logical flows are
+ * regenerated.  Any other change needs a full recompute, including changes
+ * of the VIPs, of the health checks and of the datapaths that the load
+ * balancers are applied to, which are changes of the Logical_Switch,
+ * Logical_Router and Load_Balancer_Group tables. */
+bool
+northd_handle_lb_changes(
+    const struct nbrec_load_balancer_table *nbrec_load_balancer_table,
+    struct northd_data *nd)
 {
-    if (!ovnsb_txn || !ovnnb_txn) {
-        return;
-    }
-    stopwatch_start(BUILD_LFLOWS_CTX_STOPWATCH_NAME, time_msec());
+    const struct nbrec_load_balancer *nbrec_lb;
 
-    /* Sync ipsec configuration.
-     * Copy nb_cfg from northbound to southbound database.
-     * Also set up to update sb_cfg once our southbound transaction commits. */
-    const struct nbrec_nb_global *nb = nbrec_nb_global_table_first(
-                                       input_data->nbrec_nb_global_table);
-    if (!nb) {
-        nb = nbrec_nb_global_insert(ovnnb_txn);
-    }
-    const struct sbrec_sb_global *sb = sbrec_sb_global_table_first(
-                                       input_data->sbrec_sb_global_table);
-    if (!sb) {
-        sb = sbrec_sb_global_insert(ovnsb_txn);
-    }
-    if (nb->ipsec != sb->ipsec) {
-        sbrec_sb_global_set_ipsec(sb, nb->ipsec);
+    /* First make sure that only the backends changed, so that nothing is
+     * modified if we need to fall back to a recompute. */
+    NBREC_LOAD_BALANCER_TABLE_FOR_EACH_TRACKED (nbrec_lb,
+                                               nbrec_load_balancer_table) {
+        if (nbrec_load_balancer_is_new(nbrec_lb) ||
+            nbrec_load_balancer_is_deleted(nbrec_lb)) {
+            return false;
+        }
+
+        for (enum nbrec_load_balancer_column_id col = 0;
+             col < NBREC_LOAD_BALANCER_N_COLUMNS; col++) {
+            if (col != NBREC_LOAD_BALANCER_COL_VIPS &&
+                nbrec_load_balancer_is_updated(nbrec_lb, col)) {
+                return false;
+            }
+        }
+
+        /* The backends of health checked load balancers are used by the
+         * service monitors. */
+        if (nbrec_lb->n_health_check ||
+            !smap_is_empty(&nbrec_lb->ip_port_mappings)) {
+            return false;
+        }
+
+        struct ovn_northd_lb *lb =
+            ovn_northd_lb_find(&nd->lbs, &nbrec_lb->header_.uuid);
+        if (!lb || lb->nlb != nbrec_lb) {
+            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
+            VLOG_WARN_RL(&rl, "Internal error: a tracked updated load "
+                         "balancer doesn't exist in lbs: "UUID_FMT,
+                         UUID_ARGS(&nbrec_lb->header_.uuid));
+            return false;
+        }
     }
-    sbrec_sb_global_set_options(sb, &nb->options);
 
-    const char *mac_addr_prefix = set_mac_prefix(smap_get(&nb->options,
-                                                          "mac_prefix"));
+    NBREC_LOAD_BALANCER_TABLE_FOR_EACH_TRACKED (nbrec_lb,
+                                               nbrec_load_balancer_table) {
+        struct ovn_northd_lb *lb =
+            ovn_northd_lb_find(&nd->lbs, &nbrec_lb->header_.uuid);
+        struct ovn_northd_lb *new_lb = ovn_northd_lb_create(nbrec_lb);
+        if (!ovn_northd_lb_vips_equal(lb, new_lb)) {
+            ovn_northd_lb_destroy(new_lb);
+            return false;
+        }
+
+        /* 'lb' is referenced by the datapaths and the load balancer groups,
+         * so only take the newly parsed VIPs and backends. */
+        struct ovn_lb_vip *vips = lb->vips;
+        struct ovn_northd_lb_vip *vips_nb = lb->vips_nb;
+        lb->vips = new_lb->vips;
+        lb->vips_nb = new_lb->vips_nb;
+        new_lb->vips = vips;
+        new_lb->vips_nb = vips_nb;
+        ovn_northd_lb_destroy(new_lb);
 
-    const char *monitor_mac = smap_get(&nb->options, "svc_monitor_mac");
-    if (monitor_mac) {
-        if (eth_addr_from_string(monitor_mac, &svc_monitor_mac_ea)) {
-            snprintf(svc_monitor_mac, sizeof svc_monitor_mac,
-                     ETH_ADDR_FMT, ETH_ADDR_ARGS(svc_monitor_mac_ea));
-        } else {
-            monitor_mac = NULL;
+        if (lb->slb) {
+            sbrec_load_balancer_set_vips(lb->slb, &nbrec_lb->vips);
         }
+
+        hmapx_add(&nd->tracked_lb_changes.updated, lb);
+        nd->change_tracked = true;
     }
 
-    struct smap options;
-    smap_clone(&options, &nb->options);
+    return true;
+}
 
-    smap_replace(&options, "mac_prefix", mac_addr_prefix);
+/* Handles the Load_Balancer changes that are the result of ovn-northd's own
+ * transactions, i.e., of sync_lbs() and northd_handle_lb_changes().  Returns
+ * false if a full recompute is needed. */
+bool
+northd_handle_sb_lb_changes(
+    const struct sbrec_load_balancer_table *sbrec_load_balancer_table,
+    struct hmap *lbs)
+{
+    const struct sbrec_load_balancer *sbrec_lb;
+    SBREC_LOAD_BALANCER_TABLE_FOR_EACH_TRACKED (sbrec_lb,
+                                               sbrec_load_balancer_table) {
+        const char *nb_lb_uuid = smap_get(&sbrec_lb->external_ids, "lb_id");
+        struct uuid lb_uuid;
+        if (!nb_lb_uuid || !uuid_from_string(&lb_uuid, nb_lb_uuid)) {
+            return false;
+        }
 
-    if (!monitor_mac) {
-        eth_addr_random(&svc_monitor_mac_ea);
-        snprintf(svc_monitor_mac, sizeof svc_monitor_mac,
-                 ETH_ADDR_FMT, ETH_ADDR_ARGS(svc_monitor_mac_ea));
-        smap_replace(&options, "svc_monitor_mac", svc_monitor_mac);
+        struct ovn_northd_lb *lb = ovn_northd_lb_find(lbs, &lb_uuid);
+        if (sbrec_load_balancer_is_deleted(sbrec_lb)) {
+            /* Stale and duplicate records are deleted by sync_lbs(). */
+            if (lb && lb->slb == sbrec_lb) {
+                return false;
+            }
+        } else if (!lb || !lb->n_nb_ls) {
+            return false;
+        } else if (sbrec_load_balancer_is_new(sbrec_lb)) {
+            /* Most likely the record was created by sync_lbs() and this is
+             * the notification of that transaction, so just update the
+             * pointer to the (now committed) record. */
+            lb->slb = sbrec_lb;
+        } else if (lb->slb != sbrec_lb
+                   || sbrec_lb->n_datapaths != lb->n_nb_ls
+                   || !smap_equal(&sbrec_lb->vips, &lb->nlb->vips)) {
+            return false;
+        }
     }
+    return true;
+}
 
-    char *max_tunid = xasprintf("%d", get_ovn_max_dp_key_local(input_data));
-    smap_replace(&options, "max_tunid", max_tunid);
-    free(max_tunid);
+/* Handles the updates of the Copp records referenced by the logical switches
+ * and routers.  The meters that the control plane protocols resolve to are
+ * compared with the ones that the logical flows were built with, and the
+ * Copps whose meters changed are tracked in 'nd->tracked_copp_changes' so
+ * that only the controller meters of their logical flows are updated.
+ * Returns false if a full recompute is needed. */
+bool
+northd_handle_copp_changes(const struct nbrec_copp_table *nbrec_copp_table,
+                           struct northd_data *nd)
+{
+    const struct nbrec_copp *nb_copp;
 
-    char *ovn_internal_version = ovn_get_internal_version();
-    if (!strcmp(ovn_internal_version,
-                smap_get_def(&options, "northd_internal_version", ""))) {
-        data->ovn_internal_version_changed = false;
-    } else {
-        smap_replace(&options, "northd_internal_version",
-                     ovn_internal_version);
+    /* A new Copp isn't used until a logical switch or router refers to it,
+     * which is a recompute, but a deleted one is cleared from them. */
+    NBREC_COPP_TABLE_FOR_EACH_TRACKED (nb_copp, nbrec_copp_table) {
+        if (nbrec_copp_is_new(nb_copp) || nbrec_copp_is_deleted(nb_copp)) {
+            return false;
+        }
+
+        struct ovn_copp *copp = ovn_copp_find(&nd->copps,
+                                              &nb_copp->header_.uuid);
+        if (!copp || copp->nb != nb_copp) {
+            return false;
+        }
     }
-    free(ovn_internal_version);
 
-    if (!smap_equal(&nb->options, &options)) {
-        nbrec_nb_global_verify_options(nb);
-        nbrec_nb_global_set_options(nb, &options);
+    NBREC_COPP_TABLE_FOR_EACH_TRACKED (nb_copp, nbrec_copp_table) {
+        struct ovn_copp *copp = ovn_copp_find(&nd->copps,
+                                              &nb_copp->header_.uuid);
+        bool tracked = hmapx_contains(&nd->tracked_copp_changes.updated,
+                                      copp);
+
+        for (size_t i = 0; i < COPP_PROTO_MAX; i++) {
+            const char *meter = copp_meter_get(i, nb_copp,
+                                               &nd->meter_groups);
+            if (nullable_string_is_equal(meter, copp->meters[i])) {
+                continue;
+            }
+            if (!tracked) {
+                /* Keep the meters that the logical flows were built with,
+                 * until they are updated. */
+                for (size_t j = 0; j < COPP_PROTO_MAX; j++) {
+                    copp->old_meters[j] = nullable_xstrdup(copp->meters[j]);
+                }
+                hmapx_add(&nd->tracked_copp_changes.updated, copp);
+                nd->change_tracked = true;
+                tracked = true;
+            }
+            free(copp->meters[i]);
+            copp->meters[i] = nullable_xstrdup(meter);
+        }
     }
 
-    smap_destroy(&options);
+    return true;
+}
 
-    bool old_use_ldp = use_logical_dp_groups;
-    use_logical_dp_groups = smap_get_bool(&nb->options,
-                                          "use_logical_dp_groups", true);
-    if (use_logical_dp_groups && !old_use_ldp) {
-        worker_pool_init_for_ldp();
+/* Handles the updates of the Meter and Meter_Band records, other than their
+ * names or fairness, which the logical flows depend on.  Only the Meter and
+ * Meter_Band tables of the OVN_Southbound database need an update then.
+ * Returns false if a full recompute is needed. */
+bool
+northd_handle_meter_changes(struct ovsdb_idl_txn *ovnsb_txn,
+                            struct northd_input *input_data,
+                            struct northd_data *nd)
+{
+    const struct nbrec_meter *nb_meter;
+    NBREC_METER_TABLE_FOR_EACH_TRACKED (nb_meter,
+                                        input_data->nbrec_meter_table) {
+        if (nbrec_meter_is_new(nb_meter)
+            || nbrec_meter_is_deleted(nb_meter)
+            || nbrec_meter_is_updated(nb_meter, NBREC_METER_COL_NAME)
+            || nbrec_meter_is_updated(nb_meter, NBREC_METER_COL_FAIR)) {
+            return false;
+        }
     }
 
-    use_ct_inv_match = smap_get_bool(&nb->options,
-                                     "use_ct_inv_match", true);
+    sync_meters(input_data, ovnsb_txn, &nd->meter_groups);
+    return true;
+}
 
-    /* deprecated, use --event instead */
-    controller_event_en = smap_get_bool(&nb->options,
-                                        "controller_event", false);
-    check_lsp_is_up = !smap_get_bool(&nb->options,
-                                     "ignore_lsp_down", true);
-    default_acl_drop = smap_get_bool(&nb->options, "default_acl_drop", false);
+/* Logical_DP_Group records are only created by ovn-northd, together with the
+ * Logical_Flows that use them, and are garbage collected by the database once
+ * they are not used anymore.  Both are handled by the Logical_Flow changes,
+ * so only updates need a recompute. */
+bool
+northd_handle_sb_logical_dp_group_changes(
+    const struct sbrec_logical_dp_group_table *sbrec_logical_dp_group_table)
+{
+    const struct sbrec_logical_dp_group *dpg;
+    SBREC_LOGICAL_DP_GROUP_TABLE_FOR_EACH_TRACKED (
+            dpg, sbrec_logical_dp_group_table) {
+        if (!sbrec_logical_dp_group_is_new(dpg) &&
+            !sbrec_logical_dp_group_is_deleted(dpg)) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    build_datapaths(input_data, ovnsb_txn, &data->datapaths, &data->lr_list);
-    build_lbs(input_data, &data->datapaths, &data->lbs);
-    build_ports(input_data, ovnsb_txn, sbrec_chassis_by_name,
-                sbrec_chassis_by_hostname,
-                &data->datapaths, &data->ports);
-    build_lb_port_related_data(&data->datapaths, &data->ports, &data->lbs,
-                               input_data, ovnsb_txn);
-    build_ipam(&data->datapaths, &data->ports);
-    build_port_group_lswitches(input_data, &data->port_groups, &data->ports);
-    build_lrouter_groups(&data->ports, &data->lr_list);
-    build_ip_mcast(input_data, ovnsb_txn, &data->datapaths);
-    build_meter_groups(input_data, &data->meter_groups);
-    build_static_mac_binding_table(input_data, ovnsb_txn, &data->ports);
-    stopwatch_stop(BUILD_LFLOWS_CTX_STOPWATCH_NAME, time_msec());
-    stopwatch_start(CLEAR_LFLOWS_CTX_STOPWATCH_NAME, time_msec());
-    ovn_update_ipv6_options(&data->ports);
-    ovn_update_ipv6_prefix(&data->ports);
+/* Handles the Port_Binding changes that are the result of ovn-northd's own
+ * transactions or of ovn-controller claiming VIFs.  Returns false if a full
+ * recompute is needed. */
+bool
+northd_handle_sb_port_binding_changes(
+    const struct sbrec_port_binding_table *sbrec_port_binding_table,
+    struct hmap *ports)
+{
+    static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
+    const struct sbrec_port_binding *pb;
+
+    SBREC_PORT_BINDING_TABLE_FOR_EACH_TRACKED (pb, sbrec_port_binding_table) {
+        struct ovn_port *op = ovn_port_find(ports, pb->logical_port);
+        if (sbrec_port_binding_is_new(pb)) {
+            /* Most likely the Port_Binding was created by ovn-northd and
+             * this is the notification of that transaction, so just update
+             * the pointer to the (now committed) record.  Fall back to a
+             * recompute otherwise. */
+            if (!op) {
+                VLOG_WARN_RL(&rl, "A port-binding for %s is created but the "
+                             "logical port is not found.", pb->logical_port);
+                return false;
+            }
+            op->sb = pb;
+        } else if (sbrec_port_binding_is_deleted(pb)) {
+            /* Most likely the Port_Binding was deleted by ovn-northd and
+             * this is the notification of that transaction.  Fall back to a
+             * recompute otherwise, to avoid dangling IDL pointers. */
+            if (op && op->sb == pb) {
+                VLOG_WARN_RL(&rl, "A port-binding for %s is deleted but the "
+                             "logical port still exists.", pb->logical_port);
+                return false;
+            }
+        } else if (!op || op->sb != pb || !op->lsp_can_be_inc_processed) {
+            /* Updates of router ports and of the special switch port types
+             * may change the northd data, e.g., IPv6 prefix delegation or
+             * virtual parents. */
+            return false;
+        }
+    }
+    return true;
+}
 
-    sync_lbs(input_data, ovnsb_txn, &data->datapaths, &data->lbs);
-    sync_address_sets(input_data, ovnsb_txn, &data->datapaths);
-    sync_port_groups(input_data, ovnsb_txn, &data->port_groups);
-    sync_meters(input_data, ovnsb_txn, &data->meter_groups);
-    sync_dns_entries(input_data, ovnsb_txn, &data->datapaths);
-    cleanup_stale_fdb_entries(input_data, &data->datapaths);
-    stopwatch_stop(CLEAR_LFLOWS_CTX_STOPWATCH_NAME, time_msec());
+/* The 'ref_chassis' column of HA_Chassis_Group is maintained by
+ * ovnsb_db_run() and isn't used by 'en-northd'. */
+bool
+northd_handle_sb_ha_chassis_group_changes(
+    const struct sbrec_ha_chassis_group_table *sb_ha_ch_grp_table)
+{
+    const struct sbrec_ha_chassis_group *ha_ch_grp;
+    SBREC_HA_CHASSIS_GROUP_TABLE_FOR_EACH_TRACKED (ha_ch_grp,
+                                                   sb_ha_ch_grp_table) {
+        if (sbrec_ha_chassis_group_is_new(ha_ch_grp) ||
+            sbrec_ha_chassis_group_is_deleted(ha_ch_grp)) {
+            return false;
+        }
+        for (enum sbrec_ha_chassis_group_column_id col = 0;
+             col < SBREC_HA_CHASSIS_GROUP_N_COLUMNS; col++) {
+            if (col != SBREC_HA_CHASSIS_GROUP_COL_REF_CHASSIS &&
+                sbrec_ha_chassis_group_is_updated(ha_ch_grp, col)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/* FDB entries are learnt by ovn-controller.  Only the ones that refer to a
+ * nonexistent datapath or port need processing, they are deleted as done by
+ * cleanup_stale_fdb_entries(). */
+bool
+northd_handle_sb_fdb_changes(const struct sbrec_fdb_table *sbrec_fdb_table,
+                             struct hmap *datapaths)
+{
+    const struct sbrec_fdb *fdb_e;
+    SBREC_FDB_TABLE_FOR_EACH_TRACKED (fdb_e, sbrec_fdb_table) {
+        if (sbrec_fdb_is_deleted(fdb_e)) {
+            continue;
+        }
+        struct ovn_datapath *od
+            = ovn_datapath_find_by_key(datapaths, fdb_e->dp_key);
+        if (!od || !ovn_tnlid_present(&od->port_tnlids, fdb_e->port_key)) {
+            sbrec_fdb_delete(fdb_e);
+        }
+    }
+    return true;
 }
 
 /* Stores the list of chassis which references an ha_chassis_group.
@@ -15329,16 +19014,16 @@ struct ha_chassis_group_node {
 };
 
 static void
-update_sb_ha_group_ref_chassis(struct northd_input *input_data,
-                               struct shash *ha_ref_chassis_map)
+update_sb_ha_group_ref_chassis(
+    const struct sbrec_ha_chassis_group_table *sb_ha_ch_grp_table,
+    struct shash *ha_ref_chassis_map)
 {
     struct hmap ha_ch_grps = HMAP_INITIALIZER(&ha_ch_grps);
     struct ha_chassis_group_node *ha_ch_grp_node;
 
     /* Initialize a set of all ha_chassis_groups in SB. */
     const struct sbrec_ha_chassis_group *ha_ch_grp;
-    SBREC_HA_CHASSIS_GROUP_TABLE_FOR_EACH (ha_ch_grp,
-                                    input_data->sbrec_ha_chassis_group_table) {
+    SBREC_HA_CHASSIS_GROUP_TABLE_FOR_EACH (ha_ch_grp, sb_ha_ch_grp_table) {
         ha_ch_grp_node = xzalloc(sizeof *ha_ch_grp_node);
         ha_ch_grp_node->ha_ch_grp = ha_ch_grp;
         hmap_insert(&ha_ch_grps, &ha_ch_grp_node->hmap_node,
@@ -15380,6 +19065,53 @@ update_sb_ha_group_ref_chassis(struct northd_input *input_data,
     hmap_destroy(&ha_ch_grps);
 }
 
+void
+ha_ref_chassis_data_init(struct ha_ref_chassis_data *data)
+{
+    shash_init(&data->groups);
+    smap_init(&data->pb_chassis);
+    data->valid = false;
+}
+
+static void
+ha_ref_chassis_data_clear(struct ha_ref_chassis_data *data)
+{
+    struct shash_node *node;
+    SHASH_FOR_EACH_SAFE (node, &data->groups) {
+        simap_destroy(node->data);
+        free(node->data);
+        shash_delete(&data->groups, node);
+    }
+    smap_clear(&data->pb_chassis);
+    data->valid = false;
+}
+
+void
+ha_ref_chassis_data_destroy(struct ha_ref_chassis_data *data)
+{
+    ha_ref_chassis_data_clear(data);
+    shash_destroy(&data->groups);
+    smap_destroy(&data->pb_chassis);
+}
+
+/* Returns the logical router group that the logical switch 'od' is connected
+ * to, if any. */
+static struct lrouter_group *
+ls_get_lr_group(const struct ovn_datapath *od)
+{
+    for (size_t i = 0; i < od->n_router_ports; i++) {
+        if (!od->router_ports[i]->peer) {
+            continue;
+        }
+
+        /* If a logical switch has multiple router ports, then
+         * all the logical routers belong to the same logical
+         * router group. */
+        return od->router_ports[i]->peer->od->lr_group;
+    }
+    return NULL;
+}
+
 /* This function checks if the port binding 'sb' references
  * a HA chassis group.
  * Eg. Suppose a distributed logical router port - lr0-public
@@ -15398,72 +19130,100 @@ update_sb_ha_group_ref_chassis(struct northd_input *input_data,
  *  transit logical switches) and 'sb' is claimed by chassis - 'c1' then
  * this function adds c1 to the list of the reference chassis
  *  - 'ref_chassis' of hagrp1.
- */
+ *
+ * The port binding is also counted in 'ha_ref_data', so that later changes
+ * can be handled by ovnsb_handle_port_binding_changes(). */
 static void
-build_ha_chassis_group_ref_chassis(struct northd_input *input_data,
+build_ha_chassis_group_ref_chassis(struct ovsdb_idl_index *ha_ch_grp_by_name,
                                    const struct sbrec_port_binding *sb,
                                    struct ovn_port *op,
-                                   struct shash *ha_ref_chassis_map)
+                                   struct shash *ha_ref_chassis_map,
+                                   struct ha_ref_chassis_data *ha_ref_data)
 {
-    struct lrouter_group *lr_group = NULL;
-    for (size_t i = 0; i < op->od->n_router_ports; i++) {
-        if (!op->od->router_ports[i]->peer) {
-            continue;
-        }
-
-        lr_group = op->od->router_ports[i]->peer->od->lr_group;
-        /* If a logical switch has multiple router ports, then
-         * all the logical routers belong to the same logical
-         * router group. */
-        break;
-    }
-
+    struct lrouter_group *lr_group = ls_get_lr_group(op->od);
     if (!lr_group) {
         return;
     }
 
+    bool counted = false;
     const char *ha_group_name;
     SSET_FOR_EACH (ha_group_name, &lr_group->ha_chassis_groups) {
         const struct sbrec_ha_chassis_group *sb_ha_chassis_grp;
         sb_ha_chassis_grp = ha_chassis_group_lookup_by_name(
-            input_data->sbrec_ha_chassis_grp_by_name, ha_group_name);
+            ha_ch_grp_by_name, ha_group_name);
 
         if (sb_ha_chassis_grp) {
             struct ha_ref_chassis_info *ref_ch_info =
             shash_find_data(ha_ref_chassis_map, sb_ha_chassis_grp->name);
             ovs_assert(ref_ch_info);
             add_to_ha_ref_chassis_info(ref_ch_info, sb->chassis);
+
+            struct simap *counts = shash_find_data(&ha_ref_data->groups,
+                                                   sb_ha_chassis_grp->name);
+            simap_increase(counts, sb->chassis->name, 1);
+            counted = true;
         }
     }
+
+    if (counted) {
+        smap_replace(&ha_ref_data->pb_chassis, sb->logical_port,
+                     sb->chassis->name);
+    }
+}
+
+/* Sets the 'up' column of the NB logical switch port 'op' according to its
+ * port binding 'sb'. */
+static void
+lsp_update_up(struct ovn_port *op, const struct sbrec_port_binding *sb)
+{
+    bool up = false;
+
+    if (lsp_is_router(op->nbsp)) {
+        up = true;
+    } else if (sb->chassis) {
+        up = smap_get_bool(&sb->chassis->other_config,
+                           OVN_FEATURE_PORT_UP_NOTIF, false)
+             ? sb->n_up && sb->up[0]
+             : true;
+    }
+
+    if (!op->nbsp->up || *op->nbsp->up != up) {
+        nbrec_logical_switch_port_set_up(op->nbsp, &up, 1);
+    }
 }
 
 /* Handle changes to the 'chassis' column of the 'Port_Binding' table.  When
  * this column is not empty, it means we need to set the corresponding logical
  * port as 'up' in the northbound DB. */
 static void
-handle_port_binding_changes(struct northd_input *input_data,
-                            struct ovsdb_idl_txn *ovnsb_txn,
-                            struct hmap *ports,
-                            struct shash *ha_ref_chassis_map)
+handle_port_binding_changes(struct ovsdb_idl_txn *ovnsb_txn,
+                const struct sbrec_port_binding_table *sb_pb_table,
+                const struct sbrec_ha_chassis_group_table *sb_ha_ch_grp_table,
+                struct ovsdb_idl_index *sb_ha_ch_grp_by_name,
+                struct hmap *ports,
+                struct shash *ha_ref_chassis_map,
+                struct ha_ref_chassis_data *ha_ref_data)
 {
     const struct sbrec_port_binding *sb;
     bool build_ha_chassis_ref = false;
     if (ovnsb_txn) {
         const struct sbrec_ha_chassis_group *ha_ch_grp;
-        SBREC_HA_CHASSIS_GROUP_TABLE_FOR_EACH (ha_ch_grp,
-                                    input_data->sbrec_ha_chassis_group_table) {
+        SBREC_HA_CHASSIS_GROUP_TABLE_FOR_EACH (ha_ch_grp, sb_ha_ch_grp_table) {
             if (ha_ch_grp->n_ha_chassis > 1) {
                 struct ha_ref_chassis_info *ref_ch_info =
                     xzalloc(sizeof *ref_ch_info);
                 ref_ch_info->ha_chassis_group = ha_ch_grp;
                 build_ha_chassis_ref = true;
                 shash_add(ha_ref_chassis_map, ha_ch_grp->name, ref_ch_info);
+
+                struct simap *counts = xmalloc(sizeof *counts);
+                simap_init(counts);
+                shash_add(&ha_ref_data->groups, ha_ch_grp->name, counts);
             }
         }
     }
 
-    SBREC_PORT_BINDING_TABLE_FOR_EACH (sb,
-                                       input_data->sbrec_port_binding_table) {
+    SBREC_PORT_BINDING_TABLE_FOR_EACH (sb, sb_pb_table) {
         struct ovn_port *op = ovn_port_find(ports, sb->logical_port);
 
         if (!op || !op->nbsp) {
@@ -15473,52 +19233,180 @@ handle_port_binding_changes(struct northd_input *input_data,
             continue;
         }
 
-        bool up = false;
-
-        if (lsp_is_router(op->nbsp)) {
-            up = true;
-        } else if (sb->chassis) {
-            up = smap_get_bool(&sb->chassis->other_config,
-                               OVN_FEATURE_PORT_UP_NOTIF, false)
-                 ? sb->n_up && sb->up[0]
-                 : true;
-        }
-
-        if (!op->nbsp->up || *op->nbsp->up != up) {
-            nbrec_logical_switch_port_set_up(op->nbsp, &up, 1);
-        }
+        lsp_update_up(op, sb);
 
         if (build_ha_chassis_ref && ovnsb_txn && sb->chassis) {
             /* Check and add the chassis which has claimed this 'sb'
              * to the ha chassis group's ref_chassis if required. */
-            build_ha_chassis_group_ref_chassis(input_data, sb, op,
-                                               ha_ref_chassis_map);
+            build_ha_chassis_group_ref_chassis(sb_ha_ch_grp_by_name, sb, op,
+                                               ha_ref_chassis_map,
+                                               ha_ref_data);
         }
     }
 }
 
 /* Handle a fairly small set of changes in the southbound database. */
-static void
-ovnsb_db_run(struct northd_input *input_data,
-             struct ovsdb_idl_txn *ovnnb_txn,
+void
+ovnsb_db_run(struct ovsdb_idl_txn *ovnnb_txn,
              struct ovsdb_idl_txn *ovnsb_txn,
-             struct hmap *ports)
+             const struct sbrec_port_binding_table *sb_pb_table,
+             const struct sbrec_ha_chassis_group_table *sb_ha_ch_grp_table,
+             struct ovsdb_idl_index *sb_ha_ch_grp_by_name,
+             struct hmap *ports,
+             struct ha_ref_chassis_data *ha_ref_data)
 {
+    ha_ref_chassis_data_clear(ha_ref_data);
+
     if (!ovnnb_txn ||
         !ovsdb_idl_has_ever_connected(ovsdb_idl_txn_get_idl(ovnsb_txn))) {
         return;
     }
 
     struct shash ha_ref_chassis_map = SHASH_INITIALIZER(&ha_ref_chassis_map);
-    handle_port_binding_changes(input_data,
-                                ovnsb_txn, ports, &ha_ref_chassis_map);
+    handle_port_binding_changes(ovnsb_txn, sb_pb_table, sb_ha_ch_grp_table,
+                                sb_ha_ch_grp_by_name, ports,
+                                &ha_ref_chassis_map, ha_ref_data);
     if (ovnsb_txn) {
-        update_sb_ha_group_ref_chassis(input_data,
+        update_sb_ha_group_ref_chassis(sb_ha_ch_grp_table,
                                        &ha_ref_chassis_map);
+        ha_ref_data->valid = true;
     }
     shash_destroy(&ha_ref_chassis_map);
 }
 
+/* Moves the count of the port binding 'sb' of 'op' in 'ha_ref_data' from the
+ * chassis that claimed it before to the one that claims it now.  Adds the
+ * names of the HA chassis groups whose reference chassis may have changed to
+ * 'updated_groups'. */
+static void
+ha_ref_chassis_update_pb(struct ha_ref_chassis_data *ha_ref_data,
+                         const struct sbrec_port_binding *sb,
+                         const struct ovn_port *op,
+                         struct sset *updated_groups)
+{
+    const char *old_chassis = smap_get(&ha_ref_data->pb_chassis,
+                                       sb->logical_port);
+    const char *new_chassis = sb->chassis ? sb->chassis->name : NULL;
+    if (nullable_string_is_equal(old_chassis, new_chassis)) {
+        return;
+    }
+
+    struct lrouter_group *lr_group = ls_get_lr_group(op->od);
+    if (!lr_group) {
+        return;
+    }
+
+    bool counted = false;
+    const char *ha_group_name;
+    SSET_FOR_EACH (ha_group_name, &lr_group->ha_chassis_groups) {
+        struct simap *counts = shash_find_data(&ha_ref_data->groups,
+                                               ha_group_name);
+        if (!counts) {
+            continue;
+        }
+
+        if (old_chassis) {
+            struct simap_node *node = simap_find(counts, old_chassis);
+            if (node && !--node->data) {
+                simap_delete(counts, node);
+            }
+        }
+        if (new_chassis) {
+            simap_increase(counts, new_chassis, 1);
+            counted = true;
+        }
+        sset_add(updated_groups, ha_group_name);
+    }
+
+    if (counted) {
+        smap_replace(&ha_ref_data->pb_chassis, sb->logical_port,
+                     new_chassis);
+    } else {
+        smap_remove(&ha_ref_data->pb_chassis, sb->logical_port);
+    }
+}
+
+/* Incremental version of ovnsb_db_run(): only processes the Port_Binding rows
+ * that changed.  Returns false if ovnsb_db_run() must be called instead. */
+bool
+ovnsb_handle_port_binding_changes(
+    struct ovsdb_idl_txn *ovnnb_txn,
+    struct ovsdb_idl_txn *ovnsb_txn,
+    const struct sbrec_port_binding_table *sb_pb_table,
+    struct ovsdb_idl_index *sb_ha_ch_grp_by_name,
+    struct hmap *ports,
+    struct ha_ref_chassis_data *ha_ref_data)
+{
+    if (!ovnnb_txn || !ovnsb_txn || !ha_ref_data->valid) {
+        return false;
+    }
+
+    struct sset updated_groups = SSET_INITIALIZER(&updated_groups);
+    struct shash new_chassis = SHASH_INITIALIZER(&new_chassis);
+    const struct sbrec_port_binding *sb;
+    SBREC_PORT_BINDING_TABLE_FOR_EACH_TRACKED (sb, sb_pb_table) {
+        if (sbrec_port_binding_is_deleted(sb)) {
+            if (smap_get(&ha_ref_data->pb_chassis, sb->logical_port)) {
+                /* The logical switch of the port may not exist anymore. */
+                sset_destroy(&updated_groups);
+                shash_destroy(&new_chassis);
+                return false;
+            }
+            continue;
+        }
+
+        struct ovn_port *op = ovn_port_find(ports, sb->logical_port);
+        if (!op || !op->nbsp) {
+            continue;
+        }
+
+        lsp_update_up(op, sb);
+        ha_ref_chassis_update_pb(ha_ref_data, sb, op, &updated_groups);
+        if (sb->chassis) {
+            shash_replace(&new_chassis, sb->chassis->name, sb->chassis);
+        }
+    }
+
+    /* Bring the 'ref_chassis' of the groups in line with the counts, adding
+     * and removing only the chassis that changed. */
+    const char *ha_group_name;
+    SSET_FOR_EACH (ha_group_name, &updated_groups) {
+        const struct sbrec_ha_chassis_group *ha_ch_grp =
+            ha_chassis_group_lookup_by_name(sb_ha_ch_grp_by_name,
+                                            ha_group_name);
+        if (!ha_ch_grp) {
+            continue;
+        }
+
+        struct simap *counts = shash_find_data(&ha_ref_data->groups,
+                                               ha_group_name);
+        struct sset ref_chassis = SSET_INITIALIZER(&ref_chassis);
+        for (size_t i = 0; i < ha_ch_grp->n_ref_chassis; i++) {
+            const struct sbrec_chassis *chassis = ha_ch_grp->ref_chassis[i];
+            if (!simap_contains(counts, chassis->name)) {
+                sbrec_ha_chassis_group_update_ref_chassis_delvalue(ha_ch_grp,
+                                                                   chassis);
+            }
+            sset_add(&ref_chassis, chassis->name);
+        }
+
+        struct simap_node *node;
+        SIMAP_FOR_EACH (node, counts) {
+            const struct sbrec_chassis *chassis =
+                shash_find_data(&new_chassis, node->name);
+            if (chassis && !sset_contains(&ref_chassis, node->name)) {
+                sbrec_ha_chassis_group_update_ref_chassis_addvalue(ha_ch_grp,
+                                                                   chassis);
+            }
+        }
+        sset_destroy(&ref_chassis);
+    }
+
+    sset_destroy(&updated_groups);
+    shash_destroy(&new_chassis);
+    return true;
+}
+
 void northd_run(struct northd_input *input_data,
                 struct northd_data *data,
                 struct ovsdb_idl_txn *ovnnb_txn,
@@ -15528,9 +19416,7 @@ void northd_run(struct northd_input *input_data,
     ovnnb_db_run(input_data, data, ovnnb_txn, ovnsb_txn,
                  input_data->sbrec_chassis_by_name,
                  input_data->sbrec_chassis_by_hostname);
+    lport_addresses_cache_sweep();
     stopwatch_stop(OVNNB_DB_RUN_STOPWATCH_NAME, time_msec());
-    stopwatch_start(OVNSB_DB_RUN_STOPWATCH_NAME, time_msec());
-    ovnsb_db_run(input_data, ovnnb_txn, ovnsb_txn, &data->ports);
-    stopwatch_stop(OVNSB_DB_RUN_STOPWATCH_NAME, time_msec());
 }
 
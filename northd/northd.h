@@ -16,7 +16,15 @@
 
 #include "ovsdb-idl.h"
 
+#include "openvswitch/dynamic-string.h"
 #include "openvswitch/hmap.h"
+#include "openvswitch/list.h"
+#include "openvswitch/shash.h"
+#include "hmapx.h"
+#include "smap.h"
+#include "sset.h"
+
+struct simap;
 
 struct northd_input {
     /* Northbound table references */
@@ -27,6 +35,8 @@ struct northd_input {
     const struct nbrec_port_group_table *nbrec_port_group_table;
     const struct nbrec_address_set_table *nbrec_address_set_table;
     const struct nbrec_meter_table *nbrec_meter_table;
+    const struct nbrec_meter_band_table *nbrec_meter_band_table;
+    const struct nbrec_copp_table *nbrec_copp_table;
     const struct nbrec_acl_table *nbrec_acl_table;
     const struct nbrec_static_mac_binding_table
         *nbrec_static_mac_binding_table;
@@ -56,6 +66,38 @@ struct northd_input {
     struct ovsdb_idl_index *sbrec_ha_chassis_grp_by_name;
     struct ovsdb_idl_index *sbrec_ip_mcast_by_dp;
     struct ovsdb_idl_index *sbrec_static_mac_binding_by_lport_ip;
+    struct ovsdb_idl_index *nbrec_static_mac_binding_by_lport_ip;
+};
+
+/* Changes of the logical switch ports of a single logical switch that were
+ * processed incrementally by 'en-northd'. The lists contain 'struct ovn_port'
+ * records linked through their 'list' member. */
+struct ls_change {
+    struct hmap_node hmap_node;    /* In tracked_ls_changes 'updated'. */
+    struct ovn_datapath *od;
+    struct ovs_list added_ports;
+    struct ovs_list deleted_ports; /* Ports already removed from 'ports', they
+                                    * are destroyed when the tracked data is
+                                    * cleared. */
+    struct ovs_list updated_ports;
+};
+
+/* Track what's changed in logical switches. */
+struct tracked_ls_changes {
+    struct hmap updated; /* Contains 'struct ls_change', hashed by the
+                          * datapath's NB uuid. */
+};
+
+/* Track what's changed in load balancers. */
+struct tracked_lb_changes {
+    struct hmapx updated; /* Contains the 'struct ovn_northd_lb's whose
+                           * backends changed. */
+};
+
+/* Track what's changed in the control plane protection policies. */
+struct tracked_copp_changes {
+    struct hmapx updated; /* Contains the 'struct ovn_copp's whose resolved
+                           * meters changed. */
 };
 
 struct northd_data {
@@ -64,10 +106,46 @@ struct northd_data {
     struct hmap ports;
     struct hmap port_groups;
     struct shash meter_groups;
+    struct hmap copps;            /* Contains "struct ovn_copp"s. */
     struct hmap lbs;
     struct hmap bfd_connections;
+    struct hmap chassis_qdisc_queues; /* "struct ovn_chassis_qdisc_queues"s. */
     struct ovs_list lr_list;
     bool ovn_internal_version_changed;
+
+    /* Names of the logical switch ports that are referenced by load balancer
+     * 'ip_port_mappings'.  Changes to these ports are not handled
+     * incrementally. */
+    struct sset svc_monitor_lsps;
+
+    /* Change tracking data. */
+    bool change_tracked;
+    struct tracked_ls_changes tracked_ls_changes;
+    struct tracked_lb_changes tracked_lb_changes;
+    struct tracked_copp_changes tracked_copp_changes;
+};
+
+/* State of 'en-sync-from-sb' that lets it update the 'ref_chassis' of the SB
+ * HA_Chassis_Groups from the changed Port_Bindings only. */
+struct ha_ref_chassis_data {
+    /* For each SB HA_Chassis_Group with more than one chassis, by name, a
+     * "struct simap" with, by chassis name, the number of port bindings that
+     * make that chassis a reference chassis of the group. */
+    struct shash groups;
+
+    /* The chassis that claimed each of the port bindings counted in 'groups',
+     * by logical port name. */
+    struct smap pb_chassis;
+
+    bool valid;        /* False if the state must be rebuilt from scratch. */
+};
+
+/* Southbound Logical_Flow records by their 'hash', kept across runs so that
+ * build_lflows() doesn't have to walk and hash the whole table every time. */
+struct sb_lflow_index {
+    struct hmap rows;  /* Contains "struct sb_lflow_index_node"s. */
+    uint64_t seqno;    /* Incremented by each build_lflows(). */
+    bool valid;        /* False if 'rows' must be rebuilt from the table. */
 };
 
 struct lflow_input {
@@ -90,6 +168,7 @@ struct lflow_input {
     const struct hmap *lbs;
     const struct hmap *bfd_connections;
     bool ovn_internal_version_changed;
+    struct sb_lflow_index *sb_lflow_index;
 };
 
 void northd_run(struct northd_input *input_data,
@@ -98,15 +177,96 @@ void northd_run(struct northd_input *input_data,
                 struct ovsdb_idl_txn *ovnsb_txn);
 void northd_destroy(struct northd_data *data);
 void northd_init(struct northd_data *data);
+void northd_get_memory_usage(const struct northd_data *data,
+                             struct simap *usage);
+void destroy_northd_data_tracked_changes(struct northd_data *data);
+bool northd_handle_nb_global_changes(
+    const struct nbrec_nb_global_table *);
+bool northd_handle_sb_global_changes(
+    const struct sbrec_sb_global_table *);
+bool northd_handle_ls_changes(struct ovsdb_idl_txn *,
+                              struct northd_input *,
+                              struct northd_data *);
+bool northd_handle_lsp_changes(struct ovsdb_idl_txn *,
+                               const struct nbrec_logical_switch_port_table *,
+                               struct northd_input *,
+                               struct northd_data *);
+bool northd_handle_lb_changes(const struct nbrec_load_balancer_table *,
+                              struct northd_data *);
+bool northd_handle_sb_lb_changes(const struct sbrec_load_balancer_table *,
+                                 struct hmap *lbs);
+bool northd_handle_copp_changes(const struct nbrec_copp_table *,
+                                struct northd_data *);
+bool northd_handle_meter_changes(struct ovsdb_idl_txn *,
+                                 struct northd_input *,
+                                 struct northd_data *);
+bool northd_handle_sb_logical_dp_group_changes(
+    const struct sbrec_logical_dp_group_table *);
+bool northd_handle_nb_static_mac_binding_changes(struct ovsdb_idl_txn *,
+                                                 struct northd_input *,
+                                                 struct northd_data *);
+bool northd_handle_nb_address_set_changes(
+    struct ovsdb_idl_txn *,
+    const struct nbrec_address_set_table *,
+    struct ovsdb_idl_index *sbrec_address_set_by_name);
+bool northd_handle_sb_port_binding_changes(
+    const struct sbrec_port_binding_table *, struct hmap *ports);
+bool northd_handle_sb_ha_chassis_group_changes(
+    const struct sbrec_ha_chassis_group_table *);
+bool northd_handle_sb_fdb_changes(const struct sbrec_fdb_table *,
+                                  struct hmap *datapaths);
+void ovnsb_db_run(struct ovsdb_idl_txn *ovnnb_txn,
+                  struct ovsdb_idl_txn *ovnsb_txn,
+                  const struct sbrec_port_binding_table *,
+                  const struct sbrec_ha_chassis_group_table *,
+                  struct ovsdb_idl_index *sb_ha_ch_grp_by_name,
+                  struct hmap *ports,
+                  struct ha_ref_chassis_data *);
+bool ovnsb_handle_port_binding_changes(
+    struct ovsdb_idl_txn *ovnnb_txn,
+    struct ovsdb_idl_txn *ovnsb_txn,
+    const struct sbrec_port_binding_table *,
+    struct ovsdb_idl_index *sb_ha_ch_grp_by_name,
+    struct hmap *ports,
+    struct ha_ref_chassis_data *);
+void ha_ref_chassis_data_init(struct ha_ref_chassis_data *);
+void ha_ref_chassis_data_destroy(struct ha_ref_chassis_data *);
 void northd_indices_create(struct northd_data *data,
                            struct ovsdb_idl *ovnsb_idl);
-void build_lflows(struct lflow_input *input_data,
-                  struct ovsdb_idl_txn *ovnsb_txn);
+bool build_lflows(struct lflow_input *input_data,
+                  struct ovsdb_idl_txn *ovnsb_txn, struct hmap *lflows);
+void lflows_destroy(struct hmap *lflows);
+void lflows_get_memory_usage(const struct hmap *lflows, struct simap *usage);
+void nat_lflow_caches_destroy(void);
+void lflow_build_stats_format(struct ds *);
+void qdisc_queue_stats_format(struct ds *);
+void sb_lflow_index_init(struct sb_lflow_index *);
+void sb_lflow_index_destroy(struct sb_lflow_index *);
+void sb_lflow_index_update(struct sb_lflow_index *,
+                           const struct sbrec_logical_flow_table *);
+bool lflow_handle_northd_ls_changes(struct ovsdb_idl_txn *ovnsb_txn,
+                                    struct tracked_ls_changes *,
+                                    struct lflow_input *,
+                                    struct hmap *lflows);
+bool lflow_handle_northd_lb_changes(struct ovsdb_idl_txn *ovnsb_txn,
+                                    struct tracked_lb_changes *,
+                                    struct lflow_input *,
+                                    struct hmap *lflows);
+bool lflow_handle_northd_copp_changes(struct ovsdb_idl_txn *ovnsb_txn,
+                                      struct tracked_copp_changes *,
+                                      struct hmap *lflows);
+bool lflow_handle_sb_logical_flow_changes(
+    const struct sbrec_logical_flow_table *, struct ovsdb_idl *ovnsb_idl,
+    const struct hmap *datapaths, struct hmap *lflows);
+bool lflow_handle_sb_multicast_group_changes(
+    const struct sbrec_multicast_group_table *);
 void build_bfd_table(struct lflow_input *input_data,
                      struct ovsdb_idl_txn *ovnsb_txn,
                      struct hmap *bfd_connections, struct hmap *ports);
 void bfd_cleanup_connections(struct lflow_input *input_data,
                              struct hmap *bfd_map);
 void run_update_worker_pool(int n_threads);
+void run_set_worker_cpu_mask(const char *cmask);
+void worker_pool_stats_format(struct ds *);
 
 #endif /* NORTHD_H */
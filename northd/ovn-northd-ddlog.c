@@ -135,6 +135,19 @@ struct northd_ctx {
     struct json *output_only_data;
     const char *lock_name;      /* Name of lock we need, NULL if none. */
     bool paused;
+
+    /* Splitting of large updates.
+     *
+     * If 'max_output_only_changes' is nonzero, then each transaction
+     * includes at most that many operations on the output-only tables, and
+     * the rest of the operations are kept in 'queued_txns', a JSON array of
+     * transactions, to be sent one after the other starting from the one
+     * at index 'next_queued_txn'.  The changes to 'cfg_relation', if
+     * nonnull, go in the last transaction. */
+    size_t max_output_only_changes;
+    const char *cfg_relation;   /* e.g. "SB_Global". */
+    struct json *queued_txns;
+    size_t next_queued_txn;
 };
 
 static struct ovsdb_cs_ops northd_cs_ops;
@@ -211,6 +224,7 @@ northd_ctx_destroy(struct northd_ctx *ctx)
         ovsdb_cs_destroy(ctx->cs);
         json_destroy(ctx->request_id);
         json_destroy(ctx->output_only_data);
+        json_destroy(ctx->queued_txns);
         free(ctx->prefix);
         free(ctx);
     }
@@ -546,6 +560,11 @@ northd_run(struct northd_ctx *ctx)
         case OVSDB_CS_EVENT_TYPE_RECONNECT:
             json_destroy(ctx->request_id);
             ctx->state = S_INITIAL;
+
+            /* The output-only tables get fully resynchronized and the
+             * other changes recomputed from the new database contents. */
+            json_destroy(ctx->queued_txns);
+            ctx->queued_txns = NULL;
             break;
 
         case OVSDB_CS_EVENT_TYPE_LOCKED:
@@ -573,7 +592,30 @@ northd_run(struct northd_ctx *ctx)
     }
 }
 
-/* Pass the changes for 'ctx' to its database server. */
+/* Removes and returns the next of the transactions queued on 'ctx', or
+ * returns NULL if there is none. */
+static struct json *
+northd_pop_queued_txn(struct northd_ctx *ctx)
+{
+    struct json *txns = ctx->queued_txns;
+    if (!txns) {
+        return NULL;
+    }
+
+    struct json *ops = txns->array.elems[ctx->next_queued_txn];
+    txns->array.elems[ctx->next_queued_txn++] = NULL;
+    if (ctx->next_queued_txn >= txns->array.n) {
+        json_destroy(txns);
+        ctx->queued_txns = NULL;
+    }
+    return ops;
+}
+
+/* Pass the changes for 'ctx' to its database server.
+ *
+ * If the previous changes were split into several transactions, this sends
+ * the next one of them instead, and the new changes wait in 'ctx->delta'
+ * until the last one was sent. */
 static void
 northd_send_deltas(struct northd_ctx *ctx)
 {
@@ -581,7 +623,10 @@ northd_send_deltas(struct northd_ctx *ctx)
         return;
     }
 
-    struct json *ops = get_database_ops(ctx);
+    struct json *ops = northd_pop_queued_txn(ctx);
+    if (!ops) {
+        ops = get_database_ops(ctx);
+    }
     if (!ops) {
         return;
     }
@@ -609,6 +654,40 @@ northd_update_probe_interval_cb(
                         : x);
 }
 
+static void
+northd_update_max_output_only_changes_cb(
+    uintptr_t maxp_,
+    table_id table OVS_UNUSED,
+    const ddlog_record *rec,
+    ssize_t weight)
+{
+    int64_t *maxp = (int64_t *) maxp_;
+
+    int64_t x = ddlog_get_i64(rec);
+    if (weight > 0) {
+        *maxp = x;
+    } else if (*maxp == x) {
+        *maxp = 0;
+    }
+}
+
+/* Updates the maximum number of output-only changes per transaction on 'sb'
+ * from NB_Global options:max_lflow_changes_per_sb_txn. */
+static void
+northd_update_max_output_only_changes(struct northd_ctx *nb,
+                                      struct northd_ctx *sb)
+{
+    int64_t max = sb->max_output_only_changes;
+    table_id tid = ddlog_get_table_id(nb->ddlog,
+                                      "Max_Lflow_Changes_Per_Sb_Txn");
+    ddlog_delta *max_delta = ddlog_delta_remove_table(nb->delta, tid);
+    ddlog_delta_enumerate(max_delta, northd_update_max_output_only_changes_cb,
+                          (uintptr_t) &max);
+    ddlog_free_delta(max_delta);
+
+    sb->max_output_only_changes = MAX(max, 0);
+}
+
 static void
 northd_update_probe_interval(struct northd_ctx *nb, struct northd_ctx *sb)
 {
@@ -897,6 +976,125 @@ northd_update_sb_cfg_cb(
     }
 }
 
+/* Parses the comma-separated database operations in 'ops_s', starting at
+ * offset 'start', and appends them to 'ops', a JSON array. */
+static void
+append_parsed_ops(struct json *ops, const struct ds *ops_s, size_t start)
+{
+    if (ops_s->length <= start) {
+        return;
+    }
+
+    struct ds s = DS_EMPTY_INITIALIZER;
+    ds_put_char(&s, '[');
+    ds_put_buffer(&s, &ops_s->string[start], ops_s->length - start);
+    ds_chomp(&s, ',');
+    ds_put_char(&s, ']');
+    struct json *array = json_from_string(ds_cstr(&s));
+    ds_destroy(&s);
+
+    if (array->type == JSON_ARRAY) {
+        for (size_t i = 0; i < array->array.n; i++) {
+            json_array_add(ops, array->array.elems[i]);
+        }
+        array->array.n = 0;
+    } else {
+        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+        VLOG_WARN_RL(&rl, "could not parse database operations (%s)",
+                     array->type == JSON_STRING ? json_string(array) : "");
+    }
+    json_destroy(array);
+}
+
+/* Adds 'op' to the last of the transactions queued on 'ctx', or to a new
+ * one if there is none yet or if 'op' is an output-only change and the last
+ * transaction already has as many of those as allowed.  '*n_output_only' is
+ * the number of output-only changes in the last transaction. */
+static void
+queue_op(struct northd_ctx *ctx, struct json *op, bool output_only,
+         size_t *n_output_only)
+{
+    struct json *txns = ctx->queued_txns;
+    if (!txns->array.n
+        || (output_only && *n_output_only >= ctx->max_output_only_changes)) {
+        json_array_add(txns, json_array_create_1(
+                           json_string_create(ctx->db_name)));
+        *n_output_only = 0;
+    }
+    json_array_add(txns->array.elems[txns->array.n - 1], op);
+    *n_output_only += output_only;
+}
+
+/* Queues the operations in 'ops_s' (starting at offset 'start'),
+ * 'output_only_s' and 'cfg_s' on 'ctx' as a series of transactions with at
+ * most 'ctx->max_output_only_changes' output-only changes each.
+ *
+ * Rows in output-only tables may refer to the rows of the other tables, but
+ * not the other way around, so the output-only deletions go first, then the
+ * other changes, then the output-only insertions and updates.  The changes
+ * in 'cfg_s' go last, so that the southbound nb_cfg only moves forward once
+ * all the changes are committed. */
+static void
+queue_split_ops(struct northd_ctx *ctx, const struct ds *ops_s, size_t start,
+                const struct ds *output_only_s, const struct ds *cfg_s)
+{
+    struct json *other_ops = json_array_create_empty();
+    struct json *output_only_ops = json_array_create_empty();
+    struct json *cfg_ops = json_array_create_empty();
+    append_parsed_ops(other_ops, ops_s, start);
+    append_parsed_ops(output_only_ops, output_only_s, 0);
+    append_parsed_ops(cfg_ops, cfg_s, 0);
+
+    ovs_assert(!ctx->queued_txns);
+    ctx->queued_txns = json_array_create_empty();
+    ctx->next_queued_txn = 0;
+    size_t n_output_only = 0;
+
+    /* Deletions of output-only rows. */
+    for (size_t i = 0; i < output_only_ops->array.n; i++) {
+        struct json *op = output_only_ops->array.elems[i];
+        const struct json *type = json_object_get(op, "op");
+        if (type && type->type == JSON_STRING
+            && !strcmp(json_string(type), "delete")) {
+            queue_op(ctx, op, true, &n_output_only);
+            output_only_ops->array.elems[i] = NULL;
+        }
+    }
+
+    /* Other changes. */
+    for (size_t i = 0; i < other_ops->array.n; i++) {
+        queue_op(ctx, other_ops->array.elems[i], false, &n_output_only);
+    }
+    other_ops->array.n = 0;
+
+    /* Insertions and updates of output-only rows. */
+    for (size_t i = 0; i < output_only_ops->array.n; i++) {
+        struct json *op = output_only_ops->array.elems[i];
+        if (op) {
+            queue_op(ctx, op, true, &n_output_only);
+        }
+    }
+    output_only_ops->array.n = 0;
+
+    /* Configuration sequence number. */
+    for (size_t i = 0; i < cfg_ops->array.n; i++) {
+        queue_op(ctx, cfg_ops->array.elems[i], false, &n_output_only);
+    }
+    cfg_ops->array.n = 0;
+
+    json_destroy(other_ops);
+    json_destroy(output_only_ops);
+    json_destroy(cfg_ops);
+
+    if (!ctx->queued_txns->array.n) {
+        json_destroy(ctx->queued_txns);
+        ctx->queued_txns = NULL;
+    } else if (ctx->queued_txns->array.n > 1) {
+        VLOG_INFO("%s: splitting update into %"PRIuSIZE" transactions",
+                  ctx->db_name, ctx->queued_txns->array.n);
+    }
+}
+
 static struct json *
 get_database_ops(struct northd_ctx *ctx)
 {
@@ -906,9 +1104,19 @@ get_database_ops(struct northd_ctx *ctx)
     ds_put_char(&ops_s, ',');
     size_t start_len = ops_s.length;
 
+    /* If the output-only changes have to be split across several
+     * transactions, then collect them, and the changes to 'cfg_relation',
+     * apart from the other changes. */
+    bool split = ctx->max_output_only_changes > 0;
+    struct ds output_only_s = DS_EMPTY_INITIALIZER;
+    struct ds cfg_s = DS_EMPTY_INITIALIZER;
+    struct ds *output_only_ds = split ? &output_only_s : &ops_s;
+
     for (const char **p = ctx->output_relations; *p; p++) {
-        ddlog_table_update_deltas(&ops_s, ctx->ddlog, ctx->delta,
-                                  ctx->db_name, *p);
+        bool is_cfg = (split && ctx->cfg_relation
+                       && !strcmp(*p, ctx->cfg_relation));
+        ddlog_table_update_deltas(is_cfg ? &cfg_s : &ops_s, ctx->ddlog,
+                                  ctx->delta, ctx->db_name, *p);
     }
 
     if (ctx->output_only_data) {
@@ -972,7 +1180,7 @@ get_database_ops(struct northd_ctx *ctx)
             /* For each row in the index, update a corresponding OVSDB row, if
              * there is one, otherwise insert a new row. */
             struct dump_index_data cbdata = {
-                ctx->ddlog, &rows_present, table, &ops_s
+                ctx->ddlog, &rows_present, table, output_only_ds
             };
             ddlog_dump_index(ctx->ddlog, idxid, index_cb, (uintptr_t) &cbdata);
 
@@ -980,7 +1188,7 @@ get_database_ops(struct northd_ctx *ctx)
              * but not DDlog.  Delete them from OVSDB. */
             struct uuidset_node *node;
             HMAP_FOR_EACH (node, hmap_node, &rows_present) {
-                add_delete_row_op(table, &node->uuid, &ops_s);
+                add_delete_row_op(table, &node->uuid, output_only_ds);
             }
             uuidset_destroy(&rows_present);
 
@@ -996,8 +1204,8 @@ get_database_ops(struct northd_ctx *ctx)
         ctx->output_only_data = NULL;
     } else {
         for (const char **p = ctx->output_only_relations; *p; p++) {
-            ddlog_table_update_output(&ops_s, ctx->ddlog, ctx->delta,
-                                      ctx->db_name, *p);
+            ddlog_table_update_output(output_only_ds, ctx->ddlog,
+                                      ctx->delta, ctx->db_name, *p);
         }
     }
 
@@ -1028,7 +1236,10 @@ get_database_ops(struct northd_ctx *ctx)
     }
 
     struct json *ops;
-    if (ops_s.length > start_len) {
+    if (split) {
+        queue_split_ops(ctx, &ops_s, start_len, &output_only_s, &cfg_s);
+        ops = northd_pop_queued_txn(ctx);
+    } else if (ops_s.length > start_len) {
         ds_chomp(&ops_s, ',');
         ds_put_char(&ops_s, ']');
         ops = json_from_string(ds_cstr(&ops_s));
@@ -1037,6 +1248,8 @@ get_database_ops(struct northd_ctx *ctx)
     }
 
     ds_destroy(&ops_s);
+    ds_destroy(&output_only_s);
+    ds_destroy(&cfg_s);
 
     return ops;
 }
@@ -1251,6 +1464,7 @@ main(int argc, char *argv[])
         ovnsb_db, "OVN_Southbound", "sb", "ovn_northd", ddlog, delta,
         sb_input_relations, sb_output_relations, sb_output_only_relations,
         status.pause);
+    sb_ctx->cfg_relation = "SB_Global";
 
     unixctl_command_register("pause", "", 0, 0, ovn_northd_pause, sb_ctx);
     unixctl_command_register("resume", "", 0, 0, ovn_northd_resume, sb_ctx);
@@ -1300,6 +1514,7 @@ main(int argc, char *argv[])
         northd_run(sb_ctx);
         stopwatch_stop(OVNSB_DB_RUN_STOPWATCH_NAME, time_msec());
         northd_update_probe_interval(nb_ctx, sb_ctx);
+        northd_update_max_output_only_changes(nb_ctx, sb_ctx);
         if (ovsdb_cs_has_lock(sb_ctx->cs) &&
             sb_ctx->state == S_UPDATE &&
             nb_ctx->state == S_UPDATE &&
@@ -22,8 +22,10 @@
 #include "command-line.h"
 #include "daemon.h"
 #include "fatal-signal.h"
+#include "heap.h"
 #include "inc-proc-northd.h"
 #include "lib/ip-mcast-index.h"
+#include "lib/lb.h"
 #include "lib/mcast-group-index.h"
 #include "memory.h"
 #include "northd.h"
@@ -32,6 +34,7 @@
 #include "lib/ovn-l7.h"
 #include "lib/ovn-nb-idl.h"
 #include "lib/ovn-sb-idl.h"
+#include "lib/ovn-util.h"
 #include "openvswitch/poll-loop.h"
 #include "simap.h"
 #include "stopwatch.h"
@@ -53,10 +56,17 @@ static unixctl_cb_func ovn_northd_status;
 static unixctl_cb_func cluster_state_reset_cmd;
 static unixctl_cb_func ovn_northd_set_thread_count_cmd;
 static unixctl_cb_func ovn_northd_get_thread_count_cmd;
+static unixctl_cb_func ovn_northd_lflow_stats_cmd;
+static unixctl_cb_func ovn_northd_worker_stats_cmd;
+static unixctl_cb_func ovn_northd_set_thread_cpu_mask_cmd;
+static unixctl_cb_func ovn_northd_run_coalesce_show_cmd;
+static unixctl_cb_func ovn_northd_qdisc_queue_stats_cmd;
+static unixctl_cb_func ovn_northd_run_coalesce_clear_cmd;
 
 struct northd_state {
     bool had_lock;
     bool paused;
+    bool hot_standby;   /* Keep processing the databases while on standby. */
 };
 
 #define OVN_MAX_SUPPORTED_THREADS 256
@@ -446,6 +456,188 @@ check_and_add_supported_dhcpv6_opts_to_sb_db(struct ovsdb_idl_txn *ovnsb_txn,
     hmap_destroy(&dhcpv6_opts_to_add);
 }
 
+/* Aborts the transaction that 'loop' opened for the current iteration, if
+ * any, instead of committing it. */
+static void
+discard_open_txn(struct ovsdb_idl_loop *loop)
+{
+    if (loop->open_txn) {
+        ovsdb_idl_txn_abort(loop->open_txn);
+        ovsdb_idl_txn_destroy(loop->open_txn);
+        loop->open_txn = NULL;
+    }
+}
+
+/* The nb_cfg of the Chassis_Private rows that count for the northbound
+ * hv_cfg, that is, all of them except the ones of remote chassis.  The rows
+ * are kept in a heap ordered on their nb_cfg and updated from the tracked
+ * database changes, so that finding the hypervisor that lags the most does
+ * not require a walk of the whole Chassis_Private table on every run. */
+struct hv_cfg_tracker {
+    struct hmap chassis;        /* Contains "struct hv_cfg_chassis". */
+    struct heap heap;           /* Lowest nb_cfg first. */
+    struct ovsdb_idl_index *chassis_private_by_name;
+    bool valid;                 /* False if a full rebuild is needed. */
+};
+
+struct hv_cfg_chassis {
+    struct hmap_node hmap_node; /* In 'chassis', by Chassis_Private UUID. */
+    struct heap_node heap_node; /* In 'heap'. */
+    struct uuid uuid;
+    int64_t nb_cfg;
+    int64_t nb_cfg_timestamp;
+};
+
+static void
+hv_cfg_tracker_init(struct hv_cfg_tracker *tracker,
+                    struct ovsdb_idl *ovnsb_idl)
+{
+    hmap_init(&tracker->chassis);
+    heap_init(&tracker->heap);
+    tracker->chassis_private_by_name = chassis_private_index_create(ovnsb_idl);
+    tracker->valid = false;
+}
+
+static void
+hv_cfg_tracker_clear(struct hv_cfg_tracker *tracker)
+{
+    struct hv_cfg_chassis *hc;
+    HMAP_FOR_EACH_POP (hc, hmap_node, &tracker->chassis) {
+        free(hc);
+    }
+    heap_clear(&tracker->heap);
+}
+
+static void
+hv_cfg_tracker_destroy(struct hv_cfg_tracker *tracker)
+{
+    hv_cfg_tracker_clear(tracker);
+    hmap_destroy(&tracker->chassis);
+    heap_destroy(&tracker->heap);
+}
+
+static struct hv_cfg_chassis *
+hv_cfg_chassis_find(const struct hv_cfg_tracker *tracker,
+                    const struct uuid *uuid)
+{
+    struct hv_cfg_chassis *hc;
+    HMAP_FOR_EACH_WITH_HASH (hc, hmap_node, uuid_hash(uuid),
+                             &tracker->chassis) {
+        if (uuid_equals(&hc->uuid, uuid)) {
+            return hc;
+        }
+    }
+    return NULL;
+}
+
+static void
+hv_cfg_chassis_remove(struct hv_cfg_tracker *tracker, const struct uuid *uuid)
+{
+    struct hv_cfg_chassis *hc = hv_cfg_chassis_find(tracker, uuid);
+    if (hc) {
+        hmap_remove(&tracker->chassis, &hc->hmap_node);
+        heap_remove(&tracker->heap, &hc->heap_node);
+        free(hc);
+    }
+}
+
+/* Adds, updates or removes the entry for 'chassis_priv' in 'tracker'
+ * according to its current contents. */
+static void
+hv_cfg_chassis_update(struct hv_cfg_tracker *tracker,
+                      const struct sbrec_chassis_private *chassis_priv)
+{
+    const struct uuid *uuid = &chassis_priv->header_.uuid;
+    const struct sbrec_chassis *chassis = chassis_priv->chassis;
+    if (chassis) {
+        if (smap_get_bool(&chassis->other_config, "is-remote", false)) {
+            /* Skip remote chassises. */
+            hv_cfg_chassis_remove(tracker, uuid);
+            return;
+        }
+    } else {
+        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
+        VLOG_WARN_RL(&rl, "Chassis does not exist for "
+                     "Chassis_Private record, name: %s",
+                     chassis_priv->name);
+    }
+
+    /* Lower nb_cfg values get a higher priority in the max-heap. */
+    uint64_t priority = INT64_MAX - MAX(chassis_priv->nb_cfg, 0);
+
+    struct hv_cfg_chassis *hc = hv_cfg_chassis_find(tracker, uuid);
+    if (!hc) {
+        hc = xmalloc(sizeof *hc);
+        hc->uuid = *uuid;
+        hmap_insert(&tracker->chassis, &hc->hmap_node, uuid_hash(uuid));
+        heap_insert(&tracker->heap, &hc->heap_node, priority);
+    } else if (hc->nb_cfg != chassis_priv->nb_cfg) {
+        heap_change(&tracker->heap, &hc->heap_node, priority);
+    }
+    hc->nb_cfg = chassis_priv->nb_cfg;
+    hc->nb_cfg_timestamp = chassis_priv->nb_cfg_timestamp;
+}
+
+/* Brings 'tracker' up to date with the changes to the Chassis_Private and
+ * Chassis tables tracked by 'ovnsb_idl'.  Must be called on every iteration
+ * of the main loop that runs 'ovnsb_idl', before the tracked changes are
+ * cleared, otherwise 'tracker' must be marked invalid. */
+static void
+hv_cfg_tracker_run(struct hv_cfg_tracker *tracker,
+                   struct ovsdb_idl *ovnsb_idl)
+{
+    const struct sbrec_chassis_private *chassis_priv;
+
+    if (!tracker->valid) {
+        hv_cfg_tracker_clear(tracker);
+        SBREC_CHASSIS_PRIVATE_FOR_EACH (chassis_priv, ovnsb_idl) {
+            hv_cfg_chassis_update(tracker, chassis_priv);
+        }
+        tracker->valid = true;
+        return;
+    }
+
+    SBREC_CHASSIS_PRIVATE_FOR_EACH_TRACKED (chassis_priv, ovnsb_idl) {
+        if (sbrec_chassis_private_is_deleted(chassis_priv)) {
+            hv_cfg_chassis_remove(tracker, &chassis_priv->header_.uuid);
+        } else {
+            hv_cfg_chassis_update(tracker, chassis_priv);
+        }
+    }
+
+    /* A change to a chassis may make its Chassis_Private row count or not
+     * anymore. */
+    const struct sbrec_chassis *chassis;
+    SBREC_CHASSIS_FOR_EACH_TRACKED (chassis, ovnsb_idl) {
+        chassis_priv = chassis_private_lookup_by_name(
+            tracker->chassis_private_by_name, chassis->name);
+        if (chassis_priv) {
+            hv_cfg_chassis_update(tracker, chassis_priv);
+        }
+    }
+}
+
+/* Returns the latest nb_cfg_timestamp among the nodes of 'heap' with the
+ * lowest nb_cfg.  They have the same priority as the root, so they form a
+ * subtree of the heap that contains it, rooted at the node at 'idx'. */
+static int64_t
+hv_cfg_heap_max_timestamp(const struct heap *heap, size_t idx)
+{
+    struct hv_cfg_chassis *hc = CONTAINER_OF(heap->array[idx],
+                                             struct hv_cfg_chassis,
+                                             heap_node);
+    int64_t timestamp = hc->nb_cfg_timestamp;
+
+    for (size_t child = idx * 2; child <= idx * 2 + 1; child++) {
+        if (child <= heap->n
+            && heap->array[child]->priority == heap->array[idx]->priority) {
+            timestamp = MAX(timestamp,
+                            hv_cfg_heap_max_timestamp(heap, child));
+        }
+    }
+    return timestamp;
+}
+
 /* Updates the nb_cfg, sb_cfg and hv_cfg columns in NB/SB databases. */
 static void
 update_sequence_numbers(int64_t loop_start_time,
@@ -453,7 +645,8 @@ update_sequence_numbers(int64_t loop_start_time,
                         struct ovsdb_idl *ovnsb_idl,
                         struct ovsdb_idl_txn *ovnnb_idl_txn,
                         struct ovsdb_idl_txn *ovnsb_idl_txn,
-                        struct ovsdb_idl_loop *sb_loop)
+                        struct ovsdb_idl_loop *sb_loop,
+                        const struct hv_cfg_tracker *hv_cfg_tracker)
 {
     /* Create rows in global tables if neccessary */
     const struct nbrec_nb_global *nb = nbrec_nb_global_first(ovnnb_idl);
@@ -466,12 +659,16 @@ update_sequence_numbers(int64_t loop_start_time,
     }
 
     /* Copy nb_cfg from northbound to southbound database.
-     * Also set up to update sb_cfg once our southbound transaction commits. */
-    if (nb->nb_cfg != sb->nb_cfg) {
-        sbrec_sb_global_set_nb_cfg(sb, nb->nb_cfg);
-        nbrec_nb_global_set_nb_cfg_timestamp(nb, loop_start_time);
+     * Also set up to update sb_cfg once our southbound transaction commits.
+     * While the logical flow changes are split into several southbound
+     * transactions, this waits for the last one. */
+    if (!inc_proc_northd_sb_sync_pending()) {
+        if (nb->nb_cfg != sb->nb_cfg) {
+            sbrec_sb_global_set_nb_cfg(sb, nb->nb_cfg);
+            nbrec_nb_global_set_nb_cfg_timestamp(nb, loop_start_time);
+        }
+        sb_loop->next_cfg = nb->nb_cfg;
     }
-    sb_loop->next_cfg = nb->nb_cfg;
 
     /* Update northbound sb_cfg if appropriate. */
     int64_t sb_cfg = sb_loop->cur_cfg;
@@ -483,35 +680,27 @@ update_sequence_numbers(int64_t loop_start_time,
     /* Update northbound hv_cfg if appropriate. */
     if (nb) {
         /* Find minimum nb_cfg among all chassis. */
-        const struct sbrec_chassis_private *chassis_priv;
+        const struct heap *heap = &hv_cfg_tracker->heap;
         int64_t hv_cfg = nb->nb_cfg;
-        int64_t hv_cfg_ts = 0;
-        SBREC_CHASSIS_PRIVATE_FOR_EACH (chassis_priv, ovnsb_idl) {
-            const struct sbrec_chassis *chassis = chassis_priv->chassis;
-            if (chassis) {
-                if (smap_get_bool(&chassis->other_config,
-                                  "is-remote", false)) {
-                    /* Skip remote chassises. */
-                    continue;
-                }
-            } else {
-                static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
-                VLOG_WARN_RL(&rl, "Chassis does not exist for "
-                             "Chassis_Private record, name: %s",
-                             chassis_priv->name);
-            }
-
-            if (chassis_priv->nb_cfg < hv_cfg) {
-                hv_cfg = chassis_priv->nb_cfg;
-                hv_cfg_ts = chassis_priv->nb_cfg_timestamp;
-            } else if (chassis_priv->nb_cfg == hv_cfg &&
-                       chassis_priv->nb_cfg_timestamp > hv_cfg_ts) {
-                hv_cfg_ts = chassis_priv->nb_cfg_timestamp;
-            }
+        if (!heap_is_empty(heap)) {
+            struct hv_cfg_chassis *hc = CONTAINER_OF(heap_max(heap),
+                                                     struct hv_cfg_chassis,
+                                                     heap_node);
+            hv_cfg = MIN(hv_cfg, hc->nb_cfg);
         }
 
-        /* Update hv_cfg. */
+        /* Update hv_cfg.  Its timestamp is the one of the last chassis that
+         * caught up with it, which only needs to be looked up when it
+         * changes. */
         if (nb->hv_cfg != hv_cfg) {
+            int64_t hv_cfg_ts = 0;
+            if (!heap_is_empty(heap)) {
+                struct hv_cfg_chassis *hc = CONTAINER_OF(
+                    heap_max(heap), struct hv_cfg_chassis, heap_node);
+                if (hc->nb_cfg == hv_cfg) {
+                    hv_cfg_ts = hv_cfg_heap_max_timestamp(heap, 1);
+                }
+            }
             nbrec_nb_global_set_hv_cfg(nb, hv_cfg);
             nbrec_nb_global_set_hv_cfg_timestamp(nb, hv_cfg_ts);
         }
@@ -532,6 +721,8 @@ Options:\n\
                             (default: %s)\n\
   --dry-run                 start in paused state (do not commit db changes)\n\
   --n-threads=N             specify number of threads\n\
+  --n-threads-cpu-mask=MASK pin the threads to the cores in hex CPU MASK\n\
+  --hot-standby             keep processing changes while on standby\n\
   --unixctl=SOCKET          override default control socket name\n\
   -h, --help                display this help message\n\
   -o, --options             list available options\n\
@@ -544,7 +735,7 @@ Options:\n\
 
 static void
 parse_options(int argc OVS_UNUSED, char *argv[] OVS_UNUSED,
-              bool *paused, int *n_threads)
+              bool *paused, bool *hot_standby, int *n_threads)
 {
     enum {
         OVN_DAEMON_OPTION_ENUMS,
@@ -552,6 +743,8 @@ parse_options(int argc OVS_UNUSED, char *argv[] OVS_UNUSED,
         SSL_OPTION_ENUMS,
         OPT_DRY_RUN,
         OPT_N_THREADS,
+        OPT_N_THREADS_CPU_MASK,
+        OPT_HOT_STANDBY,
     };
     static const struct option long_options[] = {
         {"ovnsb-db", required_argument, NULL, 'd'},
@@ -562,6 +755,9 @@ parse_options(int argc OVS_UNUSED, char *argv[] OVS_UNUSED,
         {"version", no_argument, NULL, 'V'},
         {"dry-run", no_argument, NULL, OPT_DRY_RUN},
         {"n-threads", required_argument, NULL, OPT_N_THREADS},
+        {"n-threads-cpu-mask", required_argument, NULL,
+         OPT_N_THREADS_CPU_MASK},
+        {"hot-standby", no_argument, NULL, OPT_HOT_STANDBY},
         OVN_DAEMON_LONG_OPTIONS,
         VLOG_LONG_OPTIONS,
         STREAM_SSL_LONG_OPTIONS,
@@ -634,10 +830,18 @@ parse_options(int argc OVS_UNUSED, char *argv[] OVS_UNUSED,
             }
             break;
 
+        case OPT_N_THREADS_CPU_MASK:
+            run_set_worker_cpu_mask(optarg);
+            break;
+
         case OPT_DRY_RUN:
             *paused = true;
             break;
 
+        case OPT_HOT_STANDBY:
+            *hot_standby = true;
+            break;
+
         default:
             break;
         }
@@ -680,6 +884,96 @@ get_probe_interval(const char *db, const struct nbrec_nb_global *nb)
     return interval;
 }
 
+/* Coalescing of the runs under a high rate of database changes, see
+ * options:northd_min_run_interval and options:northd_max_batch_delay in the
+ * NB_Global table.
+ *
+ * The next run after one that processed changes is held back until
+ * 'interval' msec have elapsed, so that the changes received in the meantime
+ * are processed together, while a change received after a quiet period is
+ * processed right away.  For as long as the runs with changes follow each
+ * other within twice 'interval', the interval doubles, up to 'max_delay'.
+ * Otherwise it goes back to 'min_interval'.  The databases are not read
+ * while a run is held back, which is why the delays are capped at
+ * RUN_COALESCE_MAX_MSEC, well below the inactivity probe intervals. */
+#define RUN_COALESCE_MAX_MSEC 1000
+
+static struct {
+    unsigned int min_interval;  /* Configured minimum, 0 disables. */
+    unsigned int max_delay;     /* Configured maximum. */
+    unsigned int interval;      /* Current interval. */
+    long long int last_run;     /* End of the last run with changes. */
+    unsigned int nb_seqno;
+    unsigned int sb_seqno;
+
+    /* Statistics. */
+    uint64_t n_runs;            /* Runs that processed changes. */
+    uint64_t n_changes;         /* Database changes processed by them. */
+    uint64_t n_held_wakeups;    /* Wakeups that were held back. */
+    unsigned int peak_interval;
+} run_coalesce;
+
+static void
+run_coalesce_set(unsigned int min_interval, unsigned int max_delay)
+{
+    run_coalesce.min_interval = MIN(min_interval, RUN_COALESCE_MAX_MSEC);
+    run_coalesce.max_delay = MIN(MAX(max_delay, run_coalesce.min_interval),
+                                 RUN_COALESCE_MAX_MSEC);
+    if (run_coalesce.interval < run_coalesce.min_interval
+        || run_coalesce.interval > run_coalesce.max_delay) {
+        run_coalesce.interval = run_coalesce.min_interval;
+    }
+}
+
+/* Returns true if this main loop iteration has to be held back, in which
+ * case it arranges for the poll loop to wake up once it's no longer the
+ * case. */
+static bool
+run_coalesce_hold(void)
+{
+    long long int next_run = run_coalesce.last_run + run_coalesce.interval;
+
+    if (!run_coalesce.interval || time_msec() >= next_run) {
+        return false;
+    }
+    run_coalesce.n_held_wakeups++;
+    poll_timer_wait_until(next_run);
+    return true;
+}
+
+/* Accounts for a run started at 'run_start' and adapts the interval if the
+ * run processed changes of 'nb_idl' or 'sb_idl'. */
+static void
+run_coalesce_run(struct ovsdb_idl *nb_idl, struct ovsdb_idl *sb_idl,
+                 long long int run_start)
+{
+    unsigned int nb_seqno = ovsdb_idl_get_seqno(nb_idl);
+    unsigned int sb_seqno = ovsdb_idl_get_seqno(sb_idl);
+
+    if (nb_seqno == run_coalesce.nb_seqno
+        && sb_seqno == run_coalesce.sb_seqno) {
+        return;
+    }
+
+    run_coalesce.n_runs++;
+    run_coalesce.n_changes += (nb_seqno - run_coalesce.nb_seqno)
+                              + (sb_seqno - run_coalesce.sb_seqno);
+    run_coalesce.nb_seqno = nb_seqno;
+    run_coalesce.sb_seqno = sb_seqno;
+
+    if (run_coalesce.min_interval) {
+        if (run_start - run_coalesce.last_run < 2 * run_coalesce.interval) {
+            run_coalesce.interval = MIN(2 * run_coalesce.interval,
+                                        run_coalesce.max_delay);
+        } else {
+            run_coalesce.interval = run_coalesce.min_interval;
+        }
+        run_coalesce.peak_interval = MAX(run_coalesce.peak_interval,
+                                         run_coalesce.interval);
+    }
+    run_coalesce.last_run = time_msec();
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -690,14 +984,16 @@ main(int argc, char *argv[])
     int n_threads = 1;
     struct northd_state state = {
         .had_lock = false,
-        .paused = false
+        .paused = false,
+        .hot_standby = false,
     };
 
     fatal_ignore_sigpipe();
     ovs_cmdl_proctitle_init(argc, argv);
     ovn_set_program_name(argv[0]);
     service_start(&argc, &argv);
-    parse_options(argc, argv, &state.paused, &n_threads);
+    parse_options(argc, argv, &state.paused, &state.hot_standby, &n_threads);
+    lport_addresses_cache_enable();
 
     daemonize_start(false);
 
@@ -730,6 +1026,18 @@ main(int argc, char *argv[])
     unixctl_command_register("parallel-build/get-n-threads", "", 0, 0,
                              ovn_northd_get_thread_count_cmd,
                              NULL);
+    unixctl_command_register("parallel-build/show-stats", "", 0, 0,
+                             ovn_northd_worker_stats_cmd, NULL);
+    unixctl_command_register("parallel-build/set-cpu-mask", "[MASK]", 0, 1,
+                             ovn_northd_set_thread_cpu_mask_cmd, NULL);
+    unixctl_command_register("lflow-stats/show", "", 0, 0,
+                             ovn_northd_lflow_stats_cmd, NULL);
+    unixctl_command_register("qdisc-queue/show-stats", "", 0, 0,
+                             ovn_northd_qdisc_queue_stats_cmd, NULL);
+    unixctl_command_register("run-coalesce/show-stats", "", 0, 0,
+                             ovn_northd_run_coalesce_show_cmd, NULL);
+    unixctl_command_register("run-coalesce/clear-stats", "", 0, 0,
+                             ovn_northd_run_coalesce_clear_cmd, NULL);
 
     daemonize_complete();
 
@@ -762,6 +1070,9 @@ main(int argc, char *argv[])
     /* Disable alerting for pure write-only columns. */
     ovsdb_idl_omit_alert(ovnsb_idl_loop.idl, &sbrec_sb_global_col_nb_cfg);
 
+    struct hv_cfg_tracker hv_cfg_tracker;
+    hv_cfg_tracker_init(&hv_cfg_tracker, ovnsb_idl_loop.idl);
+
     unixctl_command_register("sb-connection-status", "", 0, 0,
                              ovn_conn_show, ovnsb_idl_loop.idl);
 
@@ -780,6 +1091,11 @@ main(int argc, char *argv[])
     stopwatch_create(LFLOWS_LBS_STOPWATCH_NAME, SW_MS);
     stopwatch_create(LFLOWS_IGMP_STOPWATCH_NAME, SW_MS);
     stopwatch_create(LFLOWS_DP_GROUPS_STOPWATCH_NAME, SW_MS);
+    stopwatch_create(LFLOWS_ACLS_STOPWATCH_NAME, SW_US);
+    stopwatch_create(LFLOWS_LB_RULES_STOPWATCH_NAME, SW_US);
+    stopwatch_create(LFLOWS_NAT_STOPWATCH_NAME, SW_US);
+    stopwatch_create(LFLOWS_ROUTES_STOPWATCH_NAME, SW_US);
+    stopwatch_create(LFLOWS_ARP_ND_STOPWATCH_NAME, SW_US);
 
     /* Initialize incremental processing engine for ovn-northd */
     inc_proc_northd_init(&ovnnb_idl_loop, &ovnsb_idl_loop);
@@ -787,6 +1103,10 @@ main(int argc, char *argv[])
     unsigned int ovnnb_cond_seqno = UINT_MAX;
     unsigned int ovnsb_cond_seqno = UINT_MAX;
 
+    /* Database contents last processed while on hot standby. */
+    unsigned int standby_nb_seqno = 0;
+    unsigned int standby_sb_seqno = 0;
+
     run_update_worker_pool(n_threads);
 
     /* Main loop. */
@@ -799,12 +1119,16 @@ main(int argc, char *argv[])
         if (memory_should_report()) {
             struct simap usage = SIMAP_INITIALIZER(&usage);
 
-            /* Nothing special to report yet. */
+            inc_proc_northd_get_memory_usage(&usage);
+            ovsdb_idl_get_memory_usage(ovnnb_idl_loop.idl, &usage);
+            ovsdb_idl_get_memory_usage(ovnsb_idl_loop.idl, &usage);
             memory_report(&usage);
             simap_destroy(&usage);
         }
 
-        if (!state.paused) {
+        if (!state.paused && run_coalesce_hold()) {
+            /* Let the database changes accumulate until the next run. */
+        } else if (!state.paused) {
             if (!ovsdb_idl_has_lock(ovnsb_idl_loop.idl) &&
                 !ovsdb_idl_is_lock_contended(ovnsb_idl_loop.idl))
             {
@@ -836,9 +1160,11 @@ main(int argc, char *argv[])
                 if (!new_ovnsb_cond_seqno) {
                     VLOG_INFO("OVN SB IDL reconnected, force recompute.");
                     recompute = true;
+                    hv_cfg_tracker.valid = false;
                 }
                 ovnsb_cond_seqno = new_ovnsb_cond_seqno;
             }
+            hv_cfg_tracker_run(&hv_cfg_tracker, ovnsb_idl_loop.idl);
 
             if (!state.had_lock && ovsdb_idl_has_lock(ovnsb_idl_loop.idl)) {
                 VLOG_INFO("ovn-northd lock acquired. "
@@ -854,6 +1180,7 @@ main(int argc, char *argv[])
 
             if (ovsdb_idl_has_lock(ovnsb_idl_loop.idl)) {
                 int64_t loop_start_time = time_wall_msec();
+                long long int run_start = time_msec();
                 inc_proc_northd_run(ovnnb_txn, ovnsb_txn, recompute);
                 recompute = false;
                 if (ovnsb_txn) {
@@ -870,8 +1197,11 @@ main(int argc, char *argv[])
                                             ovnnb_idl_loop.idl,
                                             ovnsb_idl_loop.idl,
                                             ovnnb_txn, ovnsb_txn,
-                                            &ovnsb_idl_loop);
+                                            &ovnsb_idl_loop,
+                                            &hv_cfg_tracker);
                 }
+                run_coalesce_run(ovnnb_idl_loop.idl, ovnsb_idl_loop.idl,
+                                 run_start);
 
                 /* If there are any errors, we force a full recompute in order
                  * to ensure we handle all changes. */
@@ -886,6 +1216,32 @@ main(int argc, char *argv[])
                               "force recompute next time.");
                     recompute = true;
                 }
+            } else if (state.hot_standby && ovnnb_txn && ovnsb_txn) {
+                /* Process the database changes as if this instance was
+                 * active, to keep its state warm, but throw away the
+                 * resulting transactions. */
+                unsigned int nb_seqno =
+                    ovsdb_idl_get_seqno(ovnnb_idl_loop.idl);
+                unsigned int sb_seqno =
+                    ovsdb_idl_get_seqno(ovnsb_idl_loop.idl);
+                if (nb_seqno != standby_nb_seqno
+                    || sb_seqno != standby_sb_seqno) {
+                    inc_proc_northd_run(ovnnb_txn, ovnsb_txn, true);
+                    standby_nb_seqno = nb_seqno;
+                    standby_sb_seqno = sb_seqno;
+                }
+                discard_open_txn(&ovnnb_idl_loop);
+                discard_open_txn(&ovnsb_idl_loop);
+
+                /* Make sure we send any pending requests, e.g., lock. */
+                ovsdb_idl_loop_commit_and_wait(&ovnnb_idl_loop);
+                ovsdb_idl_loop_commit_and_wait(&ovnsb_idl_loop);
+
+                /* The changes thrown away were not made by the active
+                 * instance yet, if ever, so the state may not match the
+                 * databases: force a full recompute next time we become
+                 * active. */
+                recompute = true;
             } else {
                 /* Make sure we send any pending requests, e.g., lock. */
                 ovsdb_idl_loop_commit_and_wait(&ovnnb_idl_loop);
@@ -917,6 +1273,7 @@ main(int argc, char *argv[])
 
             /* Force a full recompute next time we become active. */
             recompute = true;
+            hv_cfg_tracker.valid = false;
         }
 
         ovsdb_idl_track_clear(ovnnb_idl_loop.idl);
@@ -935,6 +1292,9 @@ main(int argc, char *argv[])
         if (nb) {
             northd_probe_interval_nb = get_probe_interval(ovnnb_db, nb);
             northd_probe_interval_sb = get_probe_interval(ovnsb_db, nb);
+            run_coalesce_set(
+                smap_get_uint(&nb->options, "northd_min_run_interval", 0),
+                smap_get_uint(&nb->options, "northd_max_batch_delay", 0));
         }
         ovsdb_idl_set_probe_interval(ovnnb_idl_loop.idl,
                                      northd_probe_interval_nb);
@@ -961,6 +1321,8 @@ main(int argc, char *argv[])
         stopwatch_start(NORTHD_LOOP_STOPWATCH_NAME, time_msec());
     }
     inc_proc_northd_cleanup();
+    ovn_lb_cache_clear();
+    hv_cfg_tracker_destroy(&hv_cfg_tracker);
 
     unixctl_server_destroy(unixctl);
     ovsdb_idl_loop_destroy(&ovnnb_idl_loop);
@@ -1072,3 +1434,99 @@ ovn_northd_get_thread_count_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
     unixctl_command_reply(conn, ds_cstr(&s));
     ds_destroy(&s);
 }
+
+static void
+ovn_northd_set_thread_cpu_mask_cmd(struct unixctl_conn *conn, int argc,
+                                   const char *argv[], void *aux OVS_UNUSED)
+{
+    const char *cmask = argc > 1 ? argv[1] : NULL;
+
+    if (cmask) {
+        const char *digits = cmask;
+
+        if (digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X')) {
+            digits += 2;
+        }
+        if (!digits[0] || digits[strspn(digits, "0123456789abcdefABCDEF")]) {
+            struct ds s = DS_EMPTY_INITIALIZER;
+            ds_put_format(&s, "invalid CPU mask: %s\n", cmask);
+            unixctl_command_reply_error(conn, ds_cstr(&s));
+            ds_destroy(&s);
+            return;
+        }
+    }
+    run_set_worker_cpu_mask(cmask);
+    unixctl_command_reply(conn, NULL);
+}
+
+static void
+ovn_northd_worker_stats_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                            const char *argv[] OVS_UNUSED,
+                            void *aux OVS_UNUSED)
+{
+    struct ds s = DS_EMPTY_INITIALIZER;
+    worker_pool_stats_format(&s);
+    unixctl_command_reply(conn, ds_cstr(&s));
+    ds_destroy(&s);
+}
+
+static void
+ovn_northd_lflow_stats_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                           const char *argv[] OVS_UNUSED,
+                           void *aux OVS_UNUSED)
+{
+    struct ds s = DS_EMPTY_INITIALIZER;
+    lflow_build_stats_format(&s);
+    unixctl_command_reply(conn, ds_cstr(&s));
+    ds_destroy(&s);
+}
+
+static void
+ovn_northd_qdisc_queue_stats_cmd(struct unixctl_conn *conn,
+                                 int argc OVS_UNUSED,
+                                 const char *argv[] OVS_UNUSED,
+                                 void *aux OVS_UNUSED)
+{
+    struct ds s = DS_EMPTY_INITIALIZER;
+    qdisc_queue_stats_format(&s);
+    unixctl_command_reply(conn, ds_cstr(&s));
+    ds_destroy(&s);
+}
+
+static void
+ovn_northd_run_coalesce_show_cmd(struct unixctl_conn *conn,
+                                 int argc OVS_UNUSED,
+                                 const char *argv[] OVS_UNUSED,
+                                 void *aux OVS_UNUSED)
+{
+    struct ds s = DS_EMPTY_INITIALIZER;
+
+    ds_put_format(&s, "Minimum run interval: %u ms\n",
+                  run_coalesce.min_interval);
+    ds_put_format(&s, "Maximum batch delay: %u ms\n",
+                  run_coalesce.max_delay);
+    ds_put_format(&s, "Current interval: %u ms\n", run_coalesce.interval);
+    ds_put_format(&s, "Peak interval: %u ms\n", run_coalesce.peak_interval);
+    ds_put_format(&s, "Runs with changes: %"PRIu64"\n", run_coalesce.n_runs);
+    ds_put_format(&s, "Changes processed: %"PRIu64"\n",
+                  run_coalesce.n_changes);
+    ds_put_format(&s, "Changes coalesced: %"PRIu64"\n",
+                  run_coalesce.n_changes - run_coalesce.n_runs);
+    ds_put_format(&s, "Wakeups held back: %"PRIu64"\n",
+                  run_coalesce.n_held_wakeups);
+    unixctl_command_reply(conn, ds_cstr(&s));
+    ds_destroy(&s);
+}
+
+static void
+ovn_northd_run_coalesce_clear_cmd(struct unixctl_conn *conn,
+                                  int argc OVS_UNUSED,
+                                  const char *argv[] OVS_UNUSED,
+                                  void *aux OVS_UNUSED)
+{
+    run_coalesce.n_runs = 0;
+    run_coalesce.n_changes = 0;
+    run_coalesce.n_held_wakeups = 0;
+    run_coalesce.peak_interval = 0;
+    unixctl_command_reply(conn, NULL);
+}
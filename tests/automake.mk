@@ -34,7 +34,9 @@ TESTSUITE_AT = \
 	tests/ovn-ic.at \
 	tests/ovn-macros.at \
 	tests/ovn-performance.at \
+	tests/ovn-ofctrl.at \
 	tests/ovn-ofctrl-seqno.at \
+	tests/ovn-pinctrl.at \
 	tests/ovn-ipam.at \
 	tests/ovn-features.at \
 	tests/ovn-lflow-cache.at \
@@ -59,7 +61,8 @@ SYSTEM_TESTSUITE_AT = \
 
 PERF_TESTSUITE_AT = \
 	tests/perf-testsuite.at \
-	tests/perf-northd.at
+	tests/perf-northd.at \
+	tests/perf-e2e.at
 
 check_SCRIPTS += tests/atlocal
 
@@ -195,6 +198,11 @@ check-perf: all
 	@echo  '## -------------------- ##'
 	@cat $(PERF_TESTSUITE_RESULTS)
 	@echo
+	@echo  '## ------------------------ ##'
+	@echo  '##  Side-by-side Comparison ##'
+	@echo  '## ------------------------ ##'
+	@$(PYTHON3) $(srcdir)/tests/perf-northd-compare.py $(PERF_TESTSUITE_RESULTS)
+	@echo
 	@echo "Results can be found in $(PERF_TESTSUITE_RESULTS)"
 
 
@@ -245,7 +253,9 @@ tests_ovstest_SOURCES = \
 	tests/test-ovn.c \
 	controller/test-lflow-cache.c \
 	controller/test-lflow-conj-ids.c \
+	controller/test-ofctrl.c \
 	controller/test-ofctrl-seqno.c \
+	controller/test-pinctrl.c \
 	controller/test-vif-plug.c \
 	lib/test-ovn-features.c \
 	northd/test-ipam.c
@@ -256,13 +266,17 @@ tests_ovstest_LDADD = $(OVS_LIBDIR)/daemon.lo \
 	controller/encaps.$(OBJEXT) \
 	controller/ha-chassis.$(OBJEXT) \
 	controller/if-status.$(OBJEXT) \
+	controller/ip-mcast.$(OBJEXT) \
 	controller/lflow-cache.$(OBJEXT) \
 	controller/lflow-conj-ids.$(OBJEXT) \
 	controller/local_data.$(OBJEXT) \
 	controller/lport.$(OBJEXT) \
+	controller/mac-learn.$(OBJEXT) \
+	controller/ofctrl.$(OBJEXT) \
 	controller/ofctrl-seqno.$(OBJEXT) \
 	controller/ovsport.$(OBJEXT) \
 	controller/patch.$(OBJEXT) \
+	controller/pinctrl.$(OBJEXT) \
 	controller/vif-plug.$(OBJEXT) \
 	northd/ipam.$(OBJEXT)
 
@@ -278,6 +292,10 @@ PYCOV_CLEAN_FILES += $(CHECK_PYFILES:.py=.py,cover) .coverage
 
 FLAKE8_PYFILES += $(CHECK_PYFILES)
 
+# Performance testsuite report.
+EXTRA_DIST += tests/perf-northd-compare.py
+FLAKE8_PYFILES += tests/perf-northd-compare.py
+
 if HAVE_OPENSSL
 OVS_PKI_DIR = $(CURDIR)/tests/pki
 # NOTE: Certificate generation has to be done serially, and each one adds a few
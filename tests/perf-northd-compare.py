@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+"""Print the results of the ovn-northd performance tests side by side.
+
+The performance testsuite runs each scenario once per northd variant, that
+is, per backend (ovn-northd or ovn-northd-ddlog) and per setting of the
+datapath groups and parallelization options, and appends the metrics of each
+run to its results file, one block per run.  This groups them by scenario and
+by metric, so that the variants can be compared directly."""
+import argparse
+import collections
+import re
+
+# Matches the title of a run, e.g. "  1: ovn-northd basic scale test -- 200
+# Hypervisors -- ovn-northd -- dp-groups=yes -- parallelization=yes".
+TITLE_RE = re.compile(r'^\s*\d+: (.*?) -- (ovn-northd\S*)((?: -- \S+)*)\s*$')
+
+# Matches a metric, e.g. "  Logical flows: 12345".
+METRIC_RE = re.compile(r'^  ([^:]+): (.*)$')
+
+
+def parse_results(lines):
+    """Returns an ordered mapping from scenario to an ordered mapping from
+    metric to an ordered mapping from variant to value."""
+    scenarios = collections.OrderedDict()
+    metrics = None
+    variant = None
+    for line in lines:
+        line = line.rstrip('\n')
+        m = TITLE_RE.match(line)
+        if m:
+            scenario, backend, options = m.groups()
+            options = [o for o in options.split(' -- ') if o]
+            variant = backend
+            if options:
+                variant += ' (%s)' % ', '.join(options)
+            metrics = scenarios.setdefault(scenario,
+                                           collections.OrderedDict())
+            continue
+
+        m = METRIC_RE.match(line)
+        if m and metrics is not None:
+            metric, value = m.groups()
+            metrics.setdefault(metric, collections.OrderedDict())[variant] \
+                = value.strip()
+    return scenarios
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('results',
+                        help='results file of the performance testsuite')
+    args = parser.parse_args()
+
+    with open(args.results) as f:
+        scenarios = parse_results(f)
+
+    for scenario, metrics in scenarios.items():
+        print()
+        print(scenario)
+        print('-' * len(scenario))
+        for metric, values in metrics.items():
+            print('  %s:' % metric)
+            width = max(len(v) for v in values)
+            for variant, value in values.items():
+                print('    %-*s  %s' % (width, variant, value))
+
+
+if __name__ == '__main__':
+    main()
@@ -38,6 +38,8 @@
 #include "ovstest.h"
 #include "openvswitch/shash.h"
 #include "simap.h"
+#include "svec.h"
+#include "timeval.h"
 #include "util.h"
 #include "controller/lflow.h"
 
@@ -60,6 +62,10 @@ static enum { OP_CONVERT, OP_SIMPLIFY, OP_NORMALIZE, OP_FLOW } operation
 /* --parallel: Number of parallel processes to use in test. */
 static int test_parallel = 1;
 
+/* --no-compile: Parse the prerequisites and predicates of the symbols on
+ * each use instead of cloning the trees built by expr_symtab_compile(). */
+static bool compile_symtab = true;
+
 /* -m, --more: Message verbosity */
 static int verbosity;
 
@@ -154,6 +160,22 @@ create_symtab(struct shash *symtab)
     expr_symtab_add_field(symtab, "mutual_recurse_2", MFF_XREG0,
                           "mutual_recurse_1 != 0", false);
     expr_symtab_add_string(symtab, "big_string", MFF_XREG0, NULL);
+
+    /* Like ovn-controller, use the precompiled prerequisites.  The symbols
+     * above fail to compile and are still expanded on each use. */
+    if (compile_symtab) {
+        expr_symtab_compile(symtab);
+    } else {
+        struct shash_node *node;
+        SHASH_FOR_EACH (node, symtab) {
+            struct expr_symbol *symbol = node->data;
+
+            expr_destroy(symbol->prereqs_expr);
+            symbol->prereqs_expr = NULL;
+            expr_destroy(symbol->predicate_expr);
+            symbol->predicate_expr = NULL;
+        }
+    }
 }
 
 static void
@@ -874,6 +896,22 @@ tree_shape_is_chassis_resident_cb(const void *c_aux OVS_UNUSED,
     return true;
 }
 
+/* Sets the registers of 'f' to the values of the variables encoded in
+ * 'subst'. */
+static void
+set_subst_flow(struct flow *f, int subst, int n_nvars, int n_bits,
+               int n_svars)
+{
+    const unsigned int var_mask = (1u << n_bits) - 1;
+
+    for (int i = 0; i < n_nvars; i++) {
+        f->regs[i] = (subst >> (i * n_bits)) & var_mask;
+    }
+    for (int i = 0; i < n_svars; i++) {
+        f->regs[n_nvars + i] = (subst >> (n_nvars * n_bits + i)) & 1;
+    }
+}
+
 static int
 test_tree_shape_exhaustively(struct expr *expr, struct shash *symtab,
                              struct expr *terminals[], int n_terminals,
@@ -891,9 +929,16 @@ test_tree_shape_exhaustively(struct expr *expr, struct shash *symtab,
     struct ds s = DS_EMPTY_INITIALIZER;
     struct flow f;
     memset(&f, 0, sizeof f);
+
+    const int n_substs = 1 << (n_bits * n_nvars + n_svars);
+    bool *actuals = xmalloc(n_substs * sizeof *actuals);
+    const size_t batch_size = 64;
+    struct flow *batch = xzalloc(batch_size * sizeof *batch);
     for (;;) {
         for (int i = n_terminals - 1; ; i--) {
             if (!i) {
+                free(batch);
+                free(actuals);
                 ds_destroy(&s);
                 return n_tested;
             }
@@ -950,18 +995,26 @@ test_tree_shape_exhaustively(struct expr *expr, struct shash *symtab,
                                   m->conjunctions, m->n);
             }
         }
-        for (int subst = 0; subst < 1 << (n_bits * n_nvars + n_svars);
-             subst++) {
-            for (int i = 0; i < n_nvars; i++) {
-                f.regs[i] = (subst >> (i * n_bits)) & var_mask;
-            }
-            for (int i = 0; i < n_svars; i++) {
-                f.regs[n_nvars + i] = ((subst >> (n_nvars * n_bits + i))
-                                       & 1);
+
+        /* Evaluate 'modified' compiled, in batches, and 'expr' with the tree
+         * walker below, so that the compiler is checked too. */
+        struct expr_program *prog = expr_program_compile(modified);
+        for (int subst = 0; subst < n_substs; subst += batch_size) {
+            size_t n = MIN(n_substs - subst, batch_size);
+            for (size_t i = 0; i < n; i++) {
+                set_subst_flow(&batch[i], subst + i, n_nvars, n_bits,
+                               n_svars);
             }
+            expr_program_evaluate_batch(prog, batch, n, &actuals[subst],
+                                        lookup_atoi_cb, NULL);
+        }
+        expr_program_destroy(prog);
+
+        for (int subst = 0; subst < n_substs; subst++) {
+            set_subst_flow(&f, subst, n_nvars, n_bits, n_svars);
 
             bool expected = expr_evaluate(expr, &f, lookup_atoi_cb, NULL);
-            bool actual = expr_evaluate(modified, &f, lookup_atoi_cb, NULL);
+            bool actual = actuals[subst];
             if (actual != expected) {
                 struct ds expr_s, modified_s;
 
@@ -1250,6 +1303,218 @@ test_expr_to_packets(struct ovs_cmdl_context *ctx OVS_UNUSED)
     shash_destroy(&symtab);
 }
 
+/* Benchmark. */
+
+enum benchmark_phase {
+    BENCH_LEX,
+    BENCH_PARSE,
+    BENCH_ANNOTATE,
+    BENCH_SIMPLIFY,
+    BENCH_NORMALIZE,
+    BENCH_TO_MATCHES,
+    BENCH_N_PHASES
+};
+
+static const char *benchmark_phase_names[BENCH_N_PHASES] = {
+    [BENCH_LEX] = "lex",
+    [BENCH_PARSE] = "parse",
+    [BENCH_ANNOTATE] = "annotate",
+    [BENCH_SIMPLIFY] = "simplify",
+    [BENCH_NORMALIZE] = "normalize",
+    [BENCH_TO_MATCHES] = "expr_to_matches",
+};
+
+/* Returns the number of nodes, that is of allocations, in 'expr'. */
+static size_t
+benchmark_expr_n_nodes(const struct expr *expr)
+{
+    const struct expr *sub;
+    size_t n = 1;
+
+    if (!expr) {
+        return 0;
+    }
+    if (expr->type == EXPR_T_AND || expr->type == EXPR_T_OR) {
+        LIST_FOR_EACH (sub, node, &expr->andor) {
+            n += benchmark_expr_n_nodes(sub);
+        }
+    }
+    return n;
+}
+
+static bool
+benchmark_lookup_port_cb(const void *aux OVS_UNUSED,
+                         const char *port_name OVS_UNUSED,
+                         unsigned int *portp)
+{
+    /* Real corpora reference ports that don't exist here, give them all a
+     * key so that their matches are generated anyway. */
+    *portp = 1;
+    return true;
+}
+
+static bool
+benchmark_is_chassis_resident_cb(const void *aux OVS_UNUSED,
+                                 const char *port_name OVS_UNUSED)
+{
+    return true;
+}
+
+static void
+test_benchmark_expr(struct ovs_cmdl_context *ctx)
+{
+    int n_iterations = 1;
+    if (ctx->argc > 1 && !str_to_int(ctx->argv[1], 10, &n_iterations)) {
+        ovs_fatal(0, "%s: invalid number of iterations", ctx->argv[1]);
+    }
+    if (n_iterations < 1) {
+        ovs_fatal(0, "number of iterations must be at least 1");
+    }
+
+    struct shash symtab;
+    struct shash addr_sets;
+    struct shash port_groups;
+    create_symtab(&symtab);
+    create_addr_sets(&addr_sets);
+    create_port_groups(&port_groups);
+
+    struct svec corpus = SVEC_EMPTY_INITIALIZER;
+    struct ds input = DS_EMPTY_INITIALIZER;
+    while (!ds_get_test_line(&input, stdin)) {
+        svec_add(&corpus, ds_cstr(&input));
+    }
+    ds_destroy(&input);
+
+    size_t n = corpus.n;
+    struct expr **exprs = xcalloc(MAX(n, 1), sizeof *exprs);
+    long long int usecs[BENCH_N_PHASES] = { 0 };
+    size_t n_nodes = 0;
+    size_t n_tokens = 0;
+    size_t n_matches = 0;
+    size_t n_errors = 0;
+
+    for (int iter = 0; iter < n_iterations; iter++) {
+        bool first = !iter;
+        long long int start;
+
+        start = time_usec();
+        for (size_t i = 0; i < n; i++) {
+            struct lexer lexer;
+            lexer_init(&lexer, corpus.names[i]);
+            for (;;) {
+                enum lex_type type = lexer_get(&lexer);
+                if (type == LEX_T_END || type == LEX_T_ERROR) {
+                    break;
+                }
+                n_tokens += first;
+            }
+            lexer_destroy(&lexer);
+        }
+        usecs[BENCH_LEX] += time_usec() - start;
+
+        /* Parsing lexes the input again, on the fly. */
+        start = time_usec();
+        for (size_t i = 0; i < n; i++) {
+            char *error;
+            exprs[i] = expr_parse_string(corpus.names[i], &symtab, &addr_sets,
+                                         &port_groups, NULL, NULL, 0, &error);
+            if (error) {
+                if (first) {
+                    fprintf(stderr, "%s: %s\n", corpus.names[i], error);
+                    n_errors++;
+                }
+                free(error);
+            }
+        }
+        usecs[BENCH_PARSE] += time_usec() - start;
+
+        start = time_usec();
+        for (size_t i = 0; i < n; i++) {
+            if (exprs[i]) {
+                char *error;
+                exprs[i] = expr_annotate(exprs[i], &symtab, &error);
+                if (error) {
+                    if (first) {
+                        fprintf(stderr, "%s: %s\n", corpus.names[i], error);
+                        n_errors++;
+                    }
+                    free(error);
+                }
+            }
+        }
+        usecs[BENCH_ANNOTATE] += time_usec() - start;
+
+        start = time_usec();
+        for (size_t i = 0; i < n; i++) {
+            if (exprs[i]) {
+                exprs[i] = expr_simplify(exprs[i]);
+                exprs[i] = expr_evaluate_condition(
+                    exprs[i], benchmark_is_chassis_resident_cb, NULL);
+            }
+        }
+        usecs[BENCH_SIMPLIFY] += time_usec() - start;
+
+        start = time_usec();
+        for (size_t i = 0; i < n; i++) {
+            if (exprs[i]) {
+                exprs[i] = expr_normalize(exprs[i]);
+            }
+        }
+        usecs[BENCH_NORMALIZE] += time_usec() - start;
+
+        if (first) {
+            for (size_t i = 0; i < n; i++) {
+                n_nodes += benchmark_expr_n_nodes(exprs[i]);
+            }
+        }
+
+        start = time_usec();
+        for (size_t i = 0; i < n; i++) {
+            if (exprs[i]) {
+                struct hmap matches;
+                expr_to_matches(exprs[i], benchmark_lookup_port_cb, NULL,
+                                &matches);
+                if (first) {
+                    n_matches += hmap_count(&matches);
+                }
+                expr_matches_destroy(&matches);
+            }
+        }
+        usecs[BENCH_TO_MATCHES] += time_usec() - start;
+
+        for (size_t i = 0; i < n; i++) {
+            expr_destroy(exprs[i]);
+            exprs[i] = NULL;
+        }
+    }
+
+    printf("expressions: %"PRIuSIZE", errors: %"PRIuSIZE", "
+           "iterations: %d\n", n, n_errors, n_iterations);
+    printf("tokens: %"PRIuSIZE", expression nodes after normalization: "
+           "%"PRIuSIZE", matches: %"PRIuSIZE"\n",
+           n_tokens, n_nodes, n_matches);
+
+    long long int total = 0;
+    for (size_t i = 0; i < BENCH_N_PHASES; i++) {
+        total += i != BENCH_LEX ? usecs[i] : 0;
+    }
+    for (size_t i = 0; i < BENCH_N_PHASES; i++) {
+        double per_expr_ns = n ? usecs[i] * 1000.0 / n / n_iterations : 0;
+        printf("%-16s: %10.3f ms, %10.1f ns/expr, %5.1f%%\n",
+               benchmark_phase_names[i], usecs[i] / 1000.0, per_expr_ns,
+               total ? usecs[i] * 100.0 / total : 0);
+    }
+
+    free(exprs);
+    svec_destroy(&corpus);
+    expr_symtab_destroy(&symtab);
+    shash_destroy(&symtab);
+    expr_const_sets_destroy(&addr_sets);
+    shash_destroy(&addr_sets);
+    expr_const_sets_destroy(&port_groups);
+    shash_destroy(&port_groups);
+}
+
 /* Actions. */
 
 static void
@@ -1466,12 +1731,21 @@ normalize-expr\n\
 expr-to-flows\n\
   Parses OVN expressions from stdin and prints them back on stdout after\n\
   differing degrees of analysis.  Available fields are based on packet\n\
-  headers.\n\
+  headers.  With --optimize, expr-to-flows applies the optimizations that\n\
+  reduce the number of flows.  With --no-compile, the prerequisites and\n\
+  predicates of the fields are parsed on each use instead of precompiled.\n\
 \n\
 expr-to-packets\n\
   Parses OVN expressions from stdin and prints out matching packets in\n\
   hexadecimal on stdout.\n\
 \n\
+benchmark-expr [ITERATIONS]\n\
+  Compiles the OVN expressions from stdin, e.g. the matches of the logical\n\
+  flows dumped with \"ovn-sbctl --bare --columns=match list Logical_Flow\",\n\
+  ITERATIONS times (default 1) and prints the time spent in each phase\n\
+  (lex, parse, annotate, simplify, normalize, expr_to_matches) and the\n\
+  number of tokens, expression nodes and matches produced.\n\
+\n\
 evaluate-expr MICROFLOW\n\
   Parses OVN expressions from stdin and evaluates them against the flow\n\
   specified in MICROFLOW, which must be an expression that constrains\n\
@@ -1497,6 +1771,7 @@ exhaustive N\n\
         normalize, flow.  Default: flow.  'normalize' includes 'simplify',\n\
         'flow' includes 'simplify' and 'normalize'.\n\
     --parallel=N  Number of processes to use in parallel, default 1.\n\
+    --optimize  Apply the optimizations that reduce the number of flows.\n\
    Numeric vars:\n\
     --nvars=N  Number of numeric vars to test, in range 0...4, default 2.\n\
     --bits=N  Number of bits per variable, in range 1...3, default 3.\n\
@@ -1523,7 +1798,9 @@ test_ovn_main(int argc, char *argv[])
         OPT_SVARS,
         OPT_BITS,
         OPT_OPERATION,
-        OPT_PARALLEL
+        OPT_PARALLEL,
+        OPT_OPTIMIZE,
+        OPT_NO_COMPILE
     };
     static const struct option long_options[] = {
         {"relops", required_argument, NULL, OPT_RELOPS},
@@ -1532,6 +1809,8 @@ test_ovn_main(int argc, char *argv[])
         {"bits", required_argument, NULL, OPT_BITS},
         {"operation", required_argument, NULL, OPT_OPERATION},
         {"parallel", required_argument, NULL, OPT_PARALLEL},
+        {"optimize", no_argument, NULL, OPT_OPTIMIZE},
+        {"no-compile", no_argument, NULL, OPT_NO_COMPILE},
         {"more", no_argument, NULL, 'm'},
         {"help", no_argument, NULL, 'h'},
         {NULL, 0, NULL, 0},
@@ -1595,6 +1874,14 @@ test_ovn_main(int argc, char *argv[])
             test_parallel = atoi(optarg);
             break;
 
+        case OPT_OPTIMIZE:
+            expr_set_flow_optimization(true);
+            break;
+
+        case OPT_NO_COMPILE:
+            compile_symtab = false;
+            break;
+
         case 'm':
             verbosity++;
             break;
@@ -1630,6 +1917,7 @@ test_ovn_main(int argc, char *argv[])
         {"tree-shape", NULL, 1, 1, test_tree_shape, OVS_RO},
         {"exhaustive", NULL, 1, 1, test_exhaustive, OVS_RO},
         {"expr-to-packets", NULL, 0, 0, test_expr_to_packets, OVS_RO},
+        {"benchmark-expr", NULL, 0, 1, test_benchmark_expr, OVS_RO},
 
         /* Actions. */
         {"parse-actions", NULL, 0, 0, test_parse_actions, OVS_RO},
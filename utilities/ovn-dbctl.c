@@ -80,6 +80,10 @@ static int shuffle_remotes = true;
 /* --unixctl-path: Path to use for unixctl server socket, for daemon mode. */
 static char *unixctl_path;
 
+/* --coalesce-requests: Maximum number of concurrent requests that daemon mode
+ * executes in a single transaction. */
+static unsigned int coalesce_requests = 1;
+
 static unixctl_cb_func server_cmd_exit;
 static unixctl_cb_func server_cmd_run;
 
@@ -97,14 +101,27 @@ static void apply_options_direct(const struct ovn_dbctl_options *dbctl_options,
 static char * OVS_WARN_UNUSED_RESULT run_prerequisites(
     const struct ovn_dbctl_options *dbctl_options,
     struct ctl_command[], size_t n_commands, struct ovsdb_idl *);
+
+/* The commands given on a single command line.  In daemon mode, the commands
+ * of several command lines may be executed in a single transaction. */
+struct dbctl_cmdline {
+    const char *args;           /* The command line, for logging. */
+    struct ctl_command *commands;
+    size_t n_commands;
+
+    /* Set by do_dbctl() if the commands failed after the transaction was
+     * committed. */
+    char *error;
+};
+
 static char * OVS_WARN_UNUSED_RESULT do_dbctl(
     const struct ovn_dbctl_options *dbctl_options,
-    const char *args, struct ctl_command *, size_t n,
-    struct ovsdb_idl *, const struct timer *, bool *retry);
+    struct dbctl_cmdline *, size_t n_cmdlines,
+    struct ovsdb_idl *, const struct timer *, bool *retry, size_t *failed);
 static char * OVS_WARN_UNUSED_RESULT main_loop(
-    const struct ovn_dbctl_options *, const char *args,
-    struct ctl_command *commands, size_t n_commands,
-    struct ovsdb_idl *idl, const struct timer *);
+    const struct ovn_dbctl_options *,
+    struct dbctl_cmdline *, size_t n_cmdlines,
+    struct ovsdb_idl *idl, const struct timer *, size_t *failed);
 static void server_loop(const struct ovn_dbctl_options *dbctl_options,
                         struct ovsdb_idl *idl, int argc, char *argv[]);
 static void ovn_dbctl_exit(int status);
@@ -216,7 +233,16 @@ ovn_dbctl_main(int argc, char *argv[],
             goto cleanup;
         }
 
-        error = main_loop(dbctl_options, args, commands, n_commands, idl, NULL);
+        struct dbctl_cmdline cmdline = {
+            .args = args,
+            .commands = commands,
+            .n_commands = n_commands,
+        };
+        size_t failed;
+        error = main_loop(dbctl_options, &cmdline, 1, idl, NULL, &failed);
+        if (!error) {
+            error = cmdline.error;
+        }
 
 cleanup:
         free(args);
@@ -244,10 +270,19 @@ cleanup:
     exit(EXIT_SUCCESS);
 }
 
+/* Executes the commands in the 'n_cmdlines' command lines in 'cmdlines' in a
+ * single transaction, retrying it as long as the database changes under it.
+ *
+ * Returns NULL if the transaction was committed, in which case the 'error'
+ * member of a command line is set if its commands failed afterward.
+ * Otherwise, returns an error and sets '*failed' to the index of the command
+ * line that caused it, or to 'n_cmdlines' if it applies to the transaction as
+ * a whole. */
 static char *
 main_loop(const struct ovn_dbctl_options *dbctl_options,
-          const char *args, struct ctl_command *commands, size_t n_commands,
-          struct ovsdb_idl *idl, const struct timer *wait_timeout)
+          struct dbctl_cmdline *cmdlines, size_t n_cmdlines,
+          struct ovsdb_idl *idl, const struct timer *wait_timeout,
+          size_t *failed)
 {
     unsigned int seqno;
     bool idl_ready;
@@ -278,9 +313,8 @@ main_loop(const struct ovn_dbctl_options *dbctl_options,
             seqno = ovsdb_idl_get_seqno(idl);
 
             bool retry;
-            char *error = do_dbctl(dbctl_options,
-                                   args, commands, n_commands, idl,
-                                   wait_timeout, &retry);
+            char *error = do_dbctl(dbctl_options, cmdlines, n_cmdlines, idl,
+                                   wait_timeout, &retry, failed);
             if (error) {
                 return error;
             }
@@ -325,6 +359,7 @@ enum {
     OPT_SHUFFLE_REMOTES,
     OPT_NO_SHUFFLE_REMOTES,
     OPT_BOOTSTRAP_CA_CERT,
+    OPT_COALESCE_REQUESTS,
     MAIN_LOOP_OPTION_ENUMS,
     OVN_DAEMON_OPTION_ENUMS,
     VLOG_OPTION_ENUMS,
@@ -442,6 +477,7 @@ get_all_options(void)
         {"no-shuffle-remotes", no_argument, NULL, OPT_NO_SHUFFLE_REMOTES},
         {"version", no_argument, NULL, 'V'},
         {"unixctl", required_argument, NULL, 'u'},
+        {"coalesce-requests", required_argument, NULL, OPT_COALESCE_REQUESTS},
         MAIN_LOOP_LONG_OPTIONS,
         OVN_DAEMON_LONG_OPTIONS,
         VLOG_LONG_OPTIONS,
@@ -571,6 +607,14 @@ apply_options_direct(const struct ovn_dbctl_options *dbctl_options,
             unixctl_path = optarg;
             break;
 
+        case OPT_COALESCE_REQUESTS:
+            if (!str_to_uint(po->arg, 10, &coalesce_requests)
+                || !coalesce_requests) {
+                ctl_fatal("value %s on --coalesce-requests is invalid",
+                          po->arg);
+            }
+            break;
+
         case 'V':
             ovn_print_version(0, 0);
             printf("DB Schema %s\n", dbctl_options->db_version);
@@ -678,91 +722,130 @@ oneline_print(struct ds *lines)
     ds_destroy(&s);
 }
 
+static char * OVS_WARN_UNUSED_RESULT
+check_symbols(struct ovsdb_symbol_table *symtab)
+{
+    struct shash_node *node;
+
+    SHASH_FOR_EACH (node, &symtab->sh) {
+        struct ovsdb_symbol *symbol = node->data;
+        if (!symbol->created) {
+            return xasprintf("row id \"%s\" is referenced but never created "
+                             "(e.g. with \"-- --id=%s create ...\")",
+                             node->name, node->name);
+        }
+        if (!symbol->strong_ref) {
+            if (!symbol->weak_ref) {
+                VLOG_WARN("row id \"%s\" was created but no reference to it "
+                          "was inserted, so it will not actually appear in "
+                          "the database", node->name);
+            } else {
+                VLOG_WARN("row id \"%s\" was created but only a weak "
+                          "reference to it was inserted, so it will not "
+                          "actually appear in the database", node->name);
+            }
+        }
+    }
+    return NULL;
+}
+
 static char *
 do_dbctl(const struct ovn_dbctl_options *dbctl_options,
-         const char *args, struct ctl_command *commands, size_t n_commands,
-         struct ovsdb_idl *idl, const struct timer *wait_timeout, bool *retry)
+         struct dbctl_cmdline *cmdlines, size_t n_cmdlines,
+         struct ovsdb_idl *idl, const struct timer *wait_timeout,
+         bool *retry, size_t *failed)
 {
     struct ovsdb_idl_txn *txn;
     enum ovsdb_idl_txn_status status;
-    struct ovsdb_symbol_table *symtab;
-    struct shash_node *node;
+    struct ovsdb_symbol_table **symtabs;
     char *error = NULL;
 
     ovs_assert(retry);
+    ovs_assert(failed);
+    *failed = n_cmdlines;
 
     txn = the_idl_txn = ovsdb_idl_txn_create(idl);
     if (dry_run) {
         ovsdb_idl_txn_set_dry_run(txn);
     }
 
-    ovsdb_idl_txn_add_comment(txn, "%s: %s", program_name, args);
+    for (size_t i = 0; i < n_cmdlines; i++) {
+        ovsdb_idl_txn_add_comment(txn, "%s: %s",
+                                  program_name, cmdlines[i].args);
+    }
 
     dbctl_options->pre_execute(idl, txn, wait_type);
 
-    symtab = ovsdb_symbol_table_create();
-    for (size_t i = 0; i < n_commands; i++) {
-        struct ctl_command *c = &commands[i];
-        ds_init(&c->output);
-        c->table = NULL;
+    /* Each command line has its own symbol table, so that the row ids of
+     * one do not clash with those of another executed in the same
+     * transaction. */
+    symtabs = xmalloc(n_cmdlines * sizeof *symtabs);
+    for (size_t i = 0; i < n_cmdlines; i++) {
+        struct dbctl_cmdline *cl = &cmdlines[i];
+
+        symtabs[i] = ovsdb_symbol_table_create();
+        cl->error = NULL;
+        for (size_t j = 0; j < cl->n_commands; j++) {
+            struct ctl_command *c = &cl->commands[j];
+            ds_init(&c->output);
+            c->table = NULL;
+        }
     }
     struct ctl_context *ctx = dbctl_options->ctx_create();
-    ctl_context_init(ctx, NULL, idl, txn, symtab, NULL);
-    for (size_t i = 0; i < n_commands; i++) {
-        struct ctl_command *c = &commands[i];
-        ctl_context_init_command(ctx, c);
-        if (c->syntax->run) {
-            (c->syntax->run)(ctx);
-        }
-        if (ctx->error) {
-            error = xstrdup(ctx->error);
-            ctl_context_done(ctx, c);
-            goto out_error;
-        }
-        ctl_context_done_command(ctx, c);
+    for (size_t i = 0; i < n_cmdlines; i++) {
+        struct dbctl_cmdline *cl = &cmdlines[i];
+
+        ctl_context_init(ctx, NULL, idl, txn, symtabs[i],
+                         dbctl_options->invalidate_cache);
+        for (size_t j = 0; j < cl->n_commands; j++) {
+            struct ctl_command *c = &cl->commands[j];
+            ctl_context_init_command(ctx, c);
+            if (c->syntax->run) {
+                (c->syntax->run)(ctx);
+            }
+            if (ctx->error) {
+                error = xstrdup(ctx->error);
+                *failed = i;
+                ctl_context_done(ctx, c);
+                goto out_error;
+            }
+            ctl_context_done_command(ctx, c);
 
-        if (ctx->try_again) {
-            ctl_context_done(ctx, NULL);
-            goto try_again;
+            if (ctx->try_again) {
+                ctl_context_done(ctx, NULL);
+                goto try_again;
+            }
         }
     }
     ctl_context_done(ctx, NULL);
 
-    SHASH_FOR_EACH (node, &symtab->sh) {
-        struct ovsdb_symbol *symbol = node->data;
-        if (!symbol->created) {
-            error = xasprintf("row id \"%s\" is referenced but never created "
-                              "(e.g. with \"-- --id=%s create ...\")",
-                              node->name, node->name);
+    for (size_t i = 0; i < n_cmdlines; i++) {
+        error = check_symbols(symtabs[i]);
+        if (error) {
+            *failed = i;
             goto out_error;
         }
-        if (!symbol->strong_ref) {
-            if (!symbol->weak_ref) {
-                VLOG_WARN("row id \"%s\" was created but no reference to it "
-                          "was inserted, so it will not actually appear in "
-                          "the database", node->name);
-            } else {
-                VLOG_WARN("row id \"%s\" was created but only a weak "
-                          "reference to it was inserted, so it will not "
-                          "actually appear in the database", node->name);
-            }
-        }
     }
 
     long long int start_time = time_wall_msec();
     status = ovsdb_idl_txn_commit_block(txn);
     if (status == TXN_UNCHANGED || status == TXN_SUCCESS) {
-        for (size_t i = 0; i < n_commands; i++) {
-            struct ctl_command *c = &commands[i];
-            if (c->syntax->postprocess) {
-                ctl_context_init(ctx, c, idl, txn, symtab, NULL);
-                (c->syntax->postprocess)(ctx);
-                if (ctx->error) {
-                    error = xstrdup(ctx->error);
+        for (size_t i = 0; i < n_cmdlines; i++) {
+            struct dbctl_cmdline *cl = &cmdlines[i];
+
+            for (size_t j = 0; j < cl->n_commands; j++) {
+                struct ctl_command *c = &cl->commands[j];
+                if (c->syntax->postprocess) {
+                    ctl_context_init(ctx, c, idl, txn, symtabs[i],
+                                     dbctl_options->invalidate_cache);
+                    (c->syntax->postprocess)(ctx);
+                    if (ctx->error) {
+                        cl->error = xstrdup(ctx->error);
+                        ctl_context_done(ctx, c);
+                        break;
+                    }
                     ctl_context_done(ctx, c);
-                    goto out_error;
                 }
-                ctl_context_done(ctx, c);
             }
         }
     }
@@ -798,30 +881,50 @@ do_dbctl(const struct ovn_dbctl_options *dbctl_options,
         OVS_NOT_REACHED();
     }
 
-    for (size_t i = 0; i < n_commands; i++) {
-        struct ctl_command *c = &commands[i];
-        struct ds *ds = &c->output;
+    bool any_ok = false;
+    for (size_t i = 0; i < n_cmdlines; i++) {
+        struct dbctl_cmdline *cl = &cmdlines[i];
 
-        if (c->table) {
-            table_print(c->table, &table_style);
-        } else if (oneline) {
-            oneline_print(ds);
-        } else {
-            fputs(ds_cstr(ds), stdout);
+        if (cl->error) {
+            continue;
+        }
+        any_ok = true;
+        for (size_t j = 0; j < cl->n_commands; j++) {
+            struct ctl_command *c = &cl->commands[j];
+            struct ds *ds = &c->output;
+
+            if (c->table) {
+                table_print(c->table, &table_style);
+            } else if (oneline) {
+                oneline_print(ds);
+            } else {
+                fputs(ds_cstr(ds), stdout);
+            }
         }
     }
 
-    if (dbctl_options->post_execute) {
+    if (any_ok && dbctl_options->post_execute) {
         error = dbctl_options->post_execute(idl, txn, status, wait_type,
                                             wait_timeout, start_time,
                                             print_wait_time);
         if (error) {
-            goto out_error;
+            /* The transaction was committed, so the error belongs to every
+             * command line that did not fail on its own. */
+            for (size_t i = 0; i < n_cmdlines; i++) {
+                if (!cmdlines[i].error) {
+                    cmdlines[i].error = xstrdup(error);
+                }
+            }
+            free(error);
+            error = NULL;
         }
     }
 
     dbctl_options->ctx_destroy(ctx);
-    ovsdb_symbol_table_destroy(symtab);
+    for (size_t i = 0; i < n_cmdlines; i++) {
+        ovsdb_symbol_table_destroy(symtabs[i]);
+    }
+    free(symtabs);
     ovsdb_idl_txn_destroy(txn);
     the_idl_txn = NULL;
 
@@ -839,7 +942,10 @@ out_error:
     the_idl_txn = NULL;
 
     dbctl_options->ctx_destroy(ctx);
-    ovsdb_symbol_table_destroy(symtab);
+    for (size_t i = 0; i < n_cmdlines; i++) {
+        ovsdb_symbol_table_destroy(symtabs[i]);
+    }
+    free(symtabs);
     return error;
 }
 
@@ -977,11 +1083,178 @@ server_cmd_exit(struct unixctl_conn *conn, int argc OVS_UNUSED,
     unixctl_command_reply(conn, NULL);
 }
 
+/* A "run" request that was received by the daemon and is waiting to be
+ * executed, possibly in the same transaction as other requests. */
+struct server_request {
+    struct unixctl_conn *conn;
+
+    int argc;
+    char **argv;                /* The commands point into these. */
+    char *args;
+    struct shash local_options;
+    struct ctl_command *commands;
+    size_t n_commands;
+
+    /* Options that apply to the request as a whole. */
+    bool oneline;
+    bool dry_run;
+    enum nbctl_wait_type wait_type;
+    bool print_wait_time;
+    unsigned int timeout;
+    struct table_style table_style;
+};
+
 struct server_cmd_run_ctx {
     struct ovsdb_idl *idl;
     const struct ovn_dbctl_options *dbctl_options;
+
+    /* Requests received in the current iteration of the server loop. */
+    struct server_request **requests;
+    size_t n_requests;
+    size_t allocated_requests;
 };
 
+static void
+server_request_destroy(struct server_request *req)
+{
+    if (!req) {
+        return;
+    }
+
+    for (size_t i = 0; i < req->n_commands; i++) {
+        struct ctl_command *c = &req->commands[i];
+        ds_destroy(&c->output);
+        table_destroy(c->table);
+        free(c->table);
+        shash_destroy_free_data(&c->options);
+    }
+    free(req->commands);
+    shash_destroy_free_data(&req->local_options);
+    free(req->args);
+    for (int i = 0; i < req->argc; i++) {
+        free(req->argv[i]);
+    }
+    free(req->argv);
+    free(req);
+}
+
+/* Discards the output of the commands in 'req', so that they can be executed
+ * again. */
+static void
+server_request_clear_output(struct server_request *req)
+{
+    for (size_t i = 0; i < req->n_commands; i++) {
+        struct ctl_command *c = &req->commands[i];
+        ds_destroy(&c->output);
+        ds_init(&c->output);
+        table_destroy(c->table);
+        free(c->table);
+        c->table = NULL;
+    }
+}
+
+static void
+server_request_reply(struct server_request *req, const char *error)
+{
+    if (error) {
+        unixctl_command_reply_error(req->conn, error);
+        return;
+    }
+
+    struct ds output = DS_EMPTY_INITIALIZER;
+    table_format_reset();
+    for (size_t i = 0; i < req->n_commands; i++) {
+        struct ctl_command *c = &req->commands[i];
+        if (c->table) {
+            table_format(c->table, &req->table_style, &output);
+        } else if (req->oneline) {
+            oneline_format(&c->output, &output);
+        } else {
+            ds_put_cstr(&output, ds_cstr_ro(&c->output));
+        }
+    }
+    unixctl_command_reply(req->conn, ds_cstr_ro(&output));
+    ds_destroy(&output);
+}
+
+/* Returns true if 'a' and 'b' may be executed in the same transaction, that
+ * is, if the options that apply to the transaction as a whole agree. */
+static bool
+server_requests_compatible(const struct server_request *a,
+                           const struct server_request *b)
+{
+    return (a->dry_run == b->dry_run
+            && a->wait_type == b->wait_type
+            && a->print_wait_time == b->print_wait_time
+            && a->timeout == b->timeout);
+}
+
+/* Executes the 'n' requests in 'reqs' in a single transaction and replies to
+ * them.  If one of them fails before the transaction is committed, then
+ * nothing is committed, so only the requests before it are retried; the
+ * failing request is only replied to with its error when it comes first,
+ * that is, when it failed against the database as it would see it when
+ * executed on its own.
+ *
+ * Returns the number of requests, at the beginning of 'reqs', that were
+ * replied to. */
+static size_t
+server_run_requests(const struct ovn_dbctl_options *dbctl_options,
+                    struct ovsdb_idl *idl, struct server_request **reqs,
+                    size_t n)
+{
+    const struct server_request *first = reqs[0];
+
+    dry_run = first->dry_run;
+    wait_type = first->wait_type;
+    print_wait_time = first->print_wait_time;
+
+    struct timer *wait_timeout = NULL;
+    struct timer wait_timeout_;
+    if (first->timeout) {
+        wait_timeout = &wait_timeout_;
+        timer_set_duration(wait_timeout, first->timeout * 1000);
+    }
+
+    struct dbctl_cmdline *cmdlines = xmalloc(n * sizeof *cmdlines);
+    for (;;) {
+        for (size_t i = 0; i < n; i++) {
+            cmdlines[i] = (struct dbctl_cmdline) {
+                .args = reqs[i]->args,
+                .commands = reqs[i]->commands,
+                .n_commands = reqs[i]->n_commands,
+            };
+        }
+
+        size_t failed;
+        char *error = main_loop(dbctl_options, cmdlines, n, idl,
+                                wait_timeout, &failed);
+        if (!error) {
+            for (size_t i = 0; i < n; i++) {
+                server_request_reply(reqs[i], cmdlines[i].error);
+                free(cmdlines[i].error);
+            }
+            break;
+        } else if (n == 1 || !failed) {
+            server_request_reply(reqs[0], error);
+            free(error);
+            n = 1;
+            break;
+        }
+        free(error);
+
+        VLOG_DBG("retrying %"PRIuSIZE" of %"PRIuSIZE" coalesced requests",
+                 failed < n ? failed : 1, n);
+        for (size_t i = 0; i < n; i++) {
+            server_request_clear_output(reqs[i]);
+        }
+        n = failed < n ? failed : 1;
+    }
+    free(cmdlines);
+
+    return n;
+}
+
 static void
 server_cmd_run(struct unixctl_conn *conn, int argc, const char **argv_,
                void *ctx_)
@@ -990,93 +1263,99 @@ server_cmd_run(struct unixctl_conn *conn, int argc, const char **argv_,
     struct ovsdb_idl *idl = ctx->idl;
     const struct ovn_dbctl_options *dbctl_options = ctx->dbctl_options;
 
-    struct ctl_command *commands = NULL;
-    struct shash local_options;
-    size_t n_commands = 0;
+    struct server_request *req = xzalloc(sizeof *req);
     int n_options = 0;
     char *error = NULL;
 
+    req->conn = conn;
+
     /* Copy args so that getopt() can permute them. Leave last entry NULL. */
-    char **argv = xcalloc(argc + 1, sizeof *argv);
+    req->argc = argc;
+    req->argv = xcalloc(argc + 1, sizeof *req->argv);
     for (int i = 0; i < argc; i++) {
-        argv[i] = xstrdup(argv_[i]);
+        req->argv[i] = xstrdup(argv_[i]);
     }
 
     /* Reset global state. */
     oneline = false;
     dry_run = false;
     wait_type = NBCTL_WAIT_NONE;
+    print_wait_time = false;
     timeout = 0;
     table_style = table_style_default;
 
     /* Parse commands & options. */
-    char *args = process_escape_args(argv);
-    shash_init(&local_options);
-    error = server_parse_options(dbctl_options,
-                                 argc, argv, &local_options, &n_options);
+    req->args = process_escape_args(req->argv);
+    shash_init(&req->local_options);
+    error = server_parse_options(dbctl_options, argc, req->argv,
+                                 &req->local_options, &n_options);
     if (error) {
-        unixctl_command_reply_error(conn, error);
-        goto out;
+        goto out_error;
     }
-    error = ctl_parse_commands(argc - n_options, argv + n_options,
-                               &local_options, &commands, &n_commands);
+    error = ctl_parse_commands(argc - n_options, req->argv + n_options,
+                               &req->local_options,
+                               &req->commands, &req->n_commands);
     if (error) {
-        unixctl_command_reply_error(conn, error);
-        goto out;
-    }
-    VLOG(ctl_might_write_to_db(commands, n_commands) ? VLL_INFO : VLL_DBG,
-         "Running command %s", args);
-
-    struct timer *wait_timeout = NULL;
-    struct timer wait_timeout_;
-    if (timeout) {
-        wait_timeout = &wait_timeout_;
-        timer_set_duration(wait_timeout, timeout * 1000);
+        goto out_error;
     }
-
-    error = run_prerequisites(dbctl_options, commands, n_commands, idl);
-    if (error) {
-        unixctl_command_reply_error(conn, error);
-        goto out;
+    for (size_t i = 0; i < req->n_commands; i++) {
+        ds_init(&req->commands[i].output);
+        req->commands[i].table = NULL;
     }
-    error = main_loop(dbctl_options, args, commands, n_commands, idl, wait_timeout);
+    VLOG(ctl_might_write_to_db(req->commands, req->n_commands)
+         ? VLL_INFO : VLL_DBG, "Running command %s", req->args);
+
+    req->oneline = oneline;
+    req->dry_run = dry_run;
+    req->wait_type = wait_type;
+    req->print_wait_time = print_wait_time;
+    req->timeout = timeout;
+    req->table_style = table_style;
+
+    error = run_prerequisites(dbctl_options, req->commands, req->n_commands,
+                              idl);
     if (error) {
-        unixctl_command_reply_error(conn, error);
-        goto out;
+        goto out_error;
     }
 
-    struct ds output = DS_EMPTY_INITIALIZER;
-    table_format_reset();
-    for (size_t i = 0; i < n_commands; i++) {
-        struct ctl_command *c = &commands[i];
-        if (c->table) {
-            table_format(c->table, &table_style, &output);
-        } else if (oneline) {
-            oneline_format(&c->output, &output);
-        } else {
-            ds_put_cstr(&output, ds_cstr_ro(&c->output));
-        }
+    /* The request is executed, and replied to, by server_loop() once it has
+     * received all of the requests that are currently pending. */
+    if (ctx->n_requests >= ctx->allocated_requests) {
+        ctx->requests = x2nrealloc(ctx->requests, &ctx->allocated_requests,
+                                   sizeof *ctx->requests);
     }
-    unixctl_command_reply(conn, ds_cstr_ro(&output));
-    ds_destroy(&output);
+    ctx->requests[ctx->n_requests++] = req;
+    return;
 
-out:
+out_error:
+    unixctl_command_reply_error(conn, error);
     free(error);
+    server_request_destroy(req);
+}
 
-    for (size_t i = 0; i < n_commands; i++) {
-        struct ctl_command *c = &commands[i];
-        ds_destroy(&c->output);
-        table_destroy(c->table);
-        free(c->table);
-        shash_destroy_free_data(&c->options);
-    }
-    free(commands);
-    shash_destroy_free_data(&local_options);
-    free(args);
-    for (int i = 0; i < argc; i++) {
-        free(argv[i]);
+/* Executes and replies to the requests received in the current iteration of
+ * the server loop, in order.  Up to --coalesce-requests consecutive requests
+ * that are compatible are executed in a single transaction. */
+static void
+server_run_pending_requests(struct server_cmd_run_ctx *ctx)
+{
+    size_t i = 0;
+    while (i < ctx->n_requests) {
+        size_t n = 1;
+        while (n < coalesce_requests && i + n < ctx->n_requests
+               && server_requests_compatible(ctx->requests[i],
+                                             ctx->requests[i + n])) {
+            n++;
+        }
+
+        n = server_run_requests(ctx->dbctl_options, ctx->idl,
+                                &ctx->requests[i], n);
+        for (size_t j = i; j < i + n; j++) {
+            server_request_destroy(ctx->requests[j]);
+        }
+        i += n;
     }
-    free(argv);
+    ctx->n_requests = 0;
 }
 
 static void
@@ -1102,7 +1381,7 @@ server_loop(const struct ovn_dbctl_options *dbctl_options,
 
     struct server_cmd_run_ctx server_cmd_run_ctx = {
         .idl = idl,
-        .dbctl_options = dbctl_options
+        .dbctl_options = dbctl_options,
     };
     unixctl_command_register("run", "", 0, INT_MAX, server_cmd_run,
                              &server_cmd_run_ctx);
@@ -1130,6 +1409,7 @@ server_loop(const struct ovn_dbctl_options *dbctl_options,
             daemonize_complete();
         }
         unixctl_server_run(server);
+        server_run_pending_requests(&server_cmd_run_ctx);
 
         if (exiting) {
             break;
@@ -1142,6 +1422,7 @@ server_loop(const struct ovn_dbctl_options *dbctl_options,
     }
 
     unixctl_server_destroy(server);
+    free(server_cmd_run_ctx.requests);
 }
 
 static void
@@ -1183,6 +1464,7 @@ dbctl_client(const struct ovn_dbctl_options *dbctl_options,
         case OPT_SHUFFLE_REMOTES:
         case OPT_NO_SHUFFLE_REMOTES:
         case OPT_BOOTSTRAP_CA_CERT:
+        case OPT_COALESCE_REQUESTS:
         STREAM_SSL_CASES
         OVN_DAEMON_OPTION_CASES
             VLOG_INFO("using %s daemon, ignoring %s option",
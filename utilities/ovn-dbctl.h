@@ -54,6 +54,10 @@ struct ovn_dbctl_options {
 
     struct ctl_context *(*ctx_create)(void);
     void (*ctx_destroy)(struct ctl_context *);
+
+    /* Optional.  Called after a generic database command modifies the
+     * database, to drop whatever the context caches about its rows. */
+    void (*invalidate_cache)(struct ctl_context *);
 };
 
 int ovn_dbctl_main(int argc, char *argv[], const struct ovn_dbctl_options *);
@@ -14,6 +14,7 @@
 
 #include <config.h>
 
+#include <errno.h>
 #include <getopt.h>
 #include <inttypes.h>
 #include <stdlib.h>
@@ -32,6 +33,7 @@
 #include "lib/ovn-util.h"
 #include "memory.h"
 #include "ovn-dbctl.h"
+#include "ovsdb-data.h"
 #include "packets.h"
 #include "openvswitch/poll-loop.h"
 #include "process.h"
@@ -157,7 +159,8 @@ static char * OVS_WARN_UNUSED_RESULT dhcp_options_get(
     const struct nbrec_dhcp_options **);
 
 /* A context for keeping track of which switch/router certain ports are
- * connected to.
+ * connected to, and for looking up switches, routers and their ports by name
+ * without scanning their tables for every command of a batch.
  *
  * It is required to track changes that we did within current set of commands
  * because partial updates of sets in database are not reflected in the idl
@@ -168,8 +171,74 @@ struct nbctl_context {
     bool context_valid;
     struct shash lsp_to_ls_map;
     struct shash lrp_to_lr_map;
+
+    /* Name indexes, containing "struct nbctl_named_row"s. */
+    bool names_valid;
+    struct hmap ls_by_name;
+    struct hmap lr_by_name;
+    struct hmap lsp_by_name;
+    struct hmap lrp_by_name;
+};
+
+/* A row in one of the name indexes of struct nbctl_context.  Logical switch
+ * and router names are not unique, so a name may have several rows. */
+struct nbctl_named_row {
+    struct hmap_node hmap_node;
+    char *name;
+    const void *row;
 };
 
+static void
+named_row_add(struct hmap *index, const char *name, const void *row)
+{
+    struct nbctl_named_row *nr = xmalloc(sizeof *nr);
+    nr->name = xstrdup(name);
+    nr->row = row;
+    hmap_insert(index, &nr->hmap_node, hash_string(name, 0));
+}
+
+static void
+named_row_remove(struct hmap *index, const char *name, const void *row)
+{
+    struct nbctl_named_row *nr;
+    HMAP_FOR_EACH_WITH_HASH (nr, hmap_node, hash_string(name, 0), index) {
+        if (nr->row == row) {
+            hmap_remove(index, &nr->hmap_node);
+            free(nr->name);
+            free(nr);
+            return;
+        }
+    }
+}
+
+/* Returns the number of rows named 'name' in 'index' and stores one of them
+ * in '*rowp', or NULL if there is none. */
+static size_t
+named_row_find(const struct hmap *index, const char *name, const void **rowp)
+{
+    const struct nbctl_named_row *nr;
+    size_t n = 0;
+
+    *rowp = NULL;
+    HMAP_FOR_EACH_WITH_HASH (nr, hmap_node, hash_string(name, 0), index) {
+        if (!strcmp(nr->name, name)) {
+            *rowp = nr->row;
+            n++;
+        }
+    }
+    return n;
+}
+
+static void
+named_rows_clear(struct hmap *index)
+{
+    struct nbctl_named_row *nr;
+    HMAP_FOR_EACH_POP (nr, hmap_node, index) {
+        free(nr->name);
+        free(nr);
+    }
+}
+
 static struct ctl_context *
 nbctl_ctx_create(void)
 {
@@ -178,10 +247,33 @@ nbctl_ctx_create(void)
         .context_valid = false,
         .lsp_to_ls_map = SHASH_INITIALIZER(&nbctx->lsp_to_ls_map),
         .lrp_to_lr_map = SHASH_INITIALIZER(&nbctx->lrp_to_lr_map),
+        .names_valid = false,
+        .ls_by_name = HMAP_INITIALIZER(&nbctx->ls_by_name),
+        .lr_by_name = HMAP_INITIALIZER(&nbctx->lr_by_name),
+        .lsp_by_name = HMAP_INITIALIZER(&nbctx->lsp_by_name),
+        .lrp_by_name = HMAP_INITIALIZER(&nbctx->lrp_by_name),
     };
     return &nbctx->base;
 }
 
+/* Drops the name indexes of 'base', so that they get rebuilt from the IDL
+ * when needed.  Called after the generic database commands, which may
+ * insert, delete or rename rows. */
+static void
+nbctl_context_invalidate_cache(struct ctl_context *base)
+{
+    struct nbctl_context *nbctx
+        = CONTAINER_OF(base, struct nbctl_context, base);
+    if (!nbctx->names_valid) {
+        return;
+    }
+    nbctx->names_valid = false;
+    named_rows_clear(&nbctx->ls_by_name);
+    named_rows_clear(&nbctx->lr_by_name);
+    named_rows_clear(&nbctx->lsp_by_name);
+    named_rows_clear(&nbctx->lrp_by_name);
+}
+
 static void
 nbctl_ctx_destroy(struct ctl_context *base)
 {
@@ -190,6 +282,11 @@ nbctl_ctx_destroy(struct ctl_context *base)
     nbctx->context_valid = false;
     shash_destroy(&nbctx->lsp_to_ls_map);
     shash_destroy(&nbctx->lrp_to_lr_map);
+    nbctl_context_invalidate_cache(base);
+    hmap_destroy(&nbctx->ls_by_name);
+    hmap_destroy(&nbctx->lr_by_name);
+    hmap_destroy(&nbctx->lsp_by_name);
+    hmap_destroy(&nbctx->lrp_by_name);
     free(nbctx);
 }
 
@@ -213,25 +310,51 @@ nbctl_context_get(struct ctl_context *base)
 {
     struct nbctl_context *nbctx
         = CONTAINER_OF(base, struct nbctl_context, base);
-    if (nbctx->context_valid) {
-        return nbctx;
-    }
+    if (!nbctx->context_valid) {
+        const struct nbrec_logical_switch *ls;
+        NBREC_LOGICAL_SWITCH_FOR_EACH (ls, base->idl) {
+            for (size_t i = 0; i < ls->n_ports; i++) {
+                shash_add_once(&nbctx->lsp_to_ls_map, ls->ports[i]->name, ls);
+            }
+        }
 
-    const struct nbrec_logical_switch *ls;
-    NBREC_LOGICAL_SWITCH_FOR_EACH (ls, base->idl) {
-        for (size_t i = 0; i < ls->n_ports; i++) {
-            shash_add_once(&nbctx->lsp_to_ls_map, ls->ports[i]->name, ls);
+        const struct nbrec_logical_router *lr;
+        NBREC_LOGICAL_ROUTER_FOR_EACH (lr, base->idl) {
+            for (size_t i = 0; i < lr->n_ports; i++) {
+                shash_add_once(&nbctx->lrp_to_lr_map, lr->ports[i]->name, lr);
+            }
         }
+
+        nbctx->context_valid = true;
     }
 
-    const struct nbrec_logical_router *lr;
-    NBREC_LOGICAL_ROUTER_FOR_EACH (lr, base->idl) {
-        for (size_t i = 0; i < lr->n_ports; i++) {
-            shash_add_once(&nbctx->lrp_to_lr_map, lr->ports[i]->name, lr);
+    /* Unlike the partial updates of the 'ports' columns, the rows inserted
+     * or deleted and the names set within the current transaction are
+     * visible in the IDL, so the name indexes can be rebuilt from it at any
+     * time. */
+    if (!nbctx->names_valid) {
+        const struct nbrec_logical_switch *ls;
+        NBREC_LOGICAL_SWITCH_FOR_EACH (ls, base->idl) {
+            named_row_add(&nbctx->ls_by_name, ls->name, ls);
         }
-    }
 
-    nbctx->context_valid = true;
+        const struct nbrec_logical_router *lr;
+        NBREC_LOGICAL_ROUTER_FOR_EACH (lr, base->idl) {
+            named_row_add(&nbctx->lr_by_name, lr->name, lr);
+        }
+
+        const struct nbrec_logical_switch_port *lsp;
+        NBREC_LOGICAL_SWITCH_PORT_FOR_EACH (lsp, base->idl) {
+            named_row_add(&nbctx->lsp_by_name, lsp->name, lsp);
+        }
+
+        const struct nbrec_logical_router_port *lrp;
+        NBREC_LOGICAL_ROUTER_PORT_FOR_EACH (lrp, base->idl) {
+            named_row_add(&nbctx->lrp_by_name, lrp->name, lrp);
+        }
+
+        nbctx->names_valid = true;
+    }
     return nbctx;
 }
 
@@ -257,10 +380,13 @@ ACL commands:\n\
   [--type={switch | port-group}] [--log] [--severity=SEVERITY] [--name=NAME] [--may-exist]\n\
   acl-add {SWITCH | PORTGROUP} DIRECTION PRIORITY MATCH ACTION\n\
                             add an ACL to SWITCH/PORTGROUP\n\
+  [--type={switch | port-group}] [--may-exist]\n\
+  acl-add-batch {SWITCH | PORTGROUP} FILE\n\
+                            add the ACLs listed in FILE to SWITCH/PORTGROUP\n\
   [--type={switch | port-group}]\n\
   acl-del {SWITCH | PORTGROUP} [DIRECTION [PRIORITY MATCH]]\n\
                             remove ACLs from SWITCH/PORTGROUP\n\
-  [--type={switch | port-group}]\n\
+  [--type={switch | port-group}] [LIST-OPTIONS]\n\
   acl-list {SWITCH | PORTGROUP}\n\
                             print ACLs for SWITCH\n\
 \n\
@@ -283,6 +409,7 @@ Logical switch port commands:\n\
   lsp-add SWITCH PORT PARENT TAG\n\
                             add logical port PORT on SWITCH with PARENT\n\
                             on TAG\n\
+  lsp-add-batch SWITCH FILE add the logical ports listed in FILE on SWITCH\n\
   lsp-del PORT              delete PORT from its attached switch\n\
   lsp-list SWITCH           print the names of all logical ports on SWITCH\n\
   lsp-get-parent PORT       get the parent of PORT if set\n\
@@ -363,7 +490,7 @@ Route commands:\n\
   [--route-table=ROUTE_TABLE]\n\
   lr-route-del ROUTER [PREFIX [NEXTHOP [PORT]]]\n\
                             remove routes from ROUTER\n\
-  [--route-table=ROUTE_TABLE]\n\
+  [--route-table=ROUTE_TABLE] [LIST-OPTIONS]\n\
   lr-route-list ROUTER      print routes for ROUTER\n\
 \n\
 Policy commands:\n\
@@ -385,6 +512,7 @@ NAT commands:\n\
                             add a NAT to ROUTER\n\
   lr-nat-del ROUTER [TYPE [IP] [GATEWAY_PORT]]\n\
                             remove NATs from ROUTER\n\
+  [LIST-OPTIONS]\n\
   lr-nat-list ROUTER        print NATs for ROUTER\n\
 \n\
 LB commands:\n\
@@ -393,6 +521,7 @@ LB commands:\n\
                             existing load balancer\n\
   lb-del LB [VIP]           remove a load-balancer or just the VIP from\n\
                             the load balancer\n\
+  [LIST-OPTIONS]\n\
   lb-list [LB]              print load-balancers\n\
   lr-lb-add ROUTER LB       add a load-balancer to ROUTER\n\
   lr-lb-del ROUTER [LB]     remove load-balancers from ROUTER\n\
@@ -463,6 +592,11 @@ MAC_Binding commands:\n\
 %s\
 %s\
 \n\
+LIST-OPTIONS (for acl-list, lr-route-list, lr-nat-list and lb-list):\n\
+  --filter=COLUMN=VALUE       only list rows whose COLUMN equals VALUE\n\
+  --offset=N                  skip the first N rows\n\
+  --limit=N                   list at most N rows\n\
+\n\
 Synchronization command (use with --wait=sb|hv):\n\
   sync                     wait even for earlier changes to take effect\n\
 \n\
@@ -477,7 +611,9 @@ Options:\n\
   --print-wait-time           print time spent on waiting\n\
   -t, --timeout=SECS          wait at most SECS seconds\n\
   --dry-run                   do not commit changes to database\n\
-  --oneline                   print exactly one line of output per command\n",
+  --oneline                   print exactly one line of output per command\n\
+  --coalesce-requests=N       in daemon mode, commit up to N concurrent\n\
+                              requests in a single transaction\n",
            ctl_get_db_cmd_usage(),
            ctl_list_db_tables_usage(), default_nb_db());
     table_usage();
@@ -514,18 +650,14 @@ lr_by_name_or_uuid(struct ctl_context *ctx, const char *id,
     }
 
     if (!lr) {
-        const struct nbrec_logical_router *iter;
+        struct nbctl_context *nbctx = nbctl_context_get(ctx);
+        const void *row;
 
-        NBREC_LOGICAL_ROUTER_FOR_EACH(iter, ctx->idl) {
-            if (strcmp(iter->name, id)) {
-                continue;
-            }
-            if (lr) {
-                return xasprintf("Multiple logical routers named '%s'.  "
-                                 "Use a UUID.", id);
-            }
-            lr = iter;
+        if (named_row_find(&nbctx->lr_by_name, id, &row) > 1) {
+            return xasprintf("Multiple logical routers named '%s'.  "
+                             "Use a UUID.", id);
         }
+        lr = row;
     }
 
     if (!lr && must_exist) {
@@ -591,18 +723,14 @@ ls_by_name_or_uuid(struct ctl_context *ctx, const char *id, bool must_exist,
     }
 
     if (!ls) {
-        const struct nbrec_logical_switch *iter;
+        struct nbctl_context *nbctx = nbctl_context_get(ctx);
+        const void *row;
 
-        NBREC_LOGICAL_SWITCH_FOR_EACH(iter, ctx->idl) {
-            if (strcmp(iter->name, id)) {
-                continue;
-            }
-            if (ls) {
-                return xasprintf("Multiple logical switches named '%s'.  "
-                                 "Use a UUID.", id);
-            }
-            ls = iter;
+        if (named_row_find(&nbctx->ls_by_name, id, &row) > 1) {
+            return xasprintf("Multiple logical switches named '%s'.  "
+                             "Use a UUID.", id);
         }
+        ls = row;
     }
 
     if (!ls && must_exist) {
@@ -944,19 +1072,17 @@ nbctl_ls_add(struct ctl_context *ctx)
         return;
     }
 
+    struct nbctl_context *nbctx = nbctl_context_get(ctx);
     if (ls_name) {
-        if (!add_duplicate) {
-            const struct nbrec_logical_switch *ls;
-            NBREC_LOGICAL_SWITCH_FOR_EACH (ls, ctx->idl) {
-                if (!strcmp(ls->name, ls_name)) {
-                    if (may_exist) {
-                        return;
-                    }
-                    ctl_error(ctx, "%s: a switch with this name already "
-                              "exists", ls_name);
-                    return;
-                }
+        const void *row;
+        if (!add_duplicate
+            && named_row_find(&nbctx->ls_by_name, ls_name, &row)) {
+            if (may_exist) {
+                return;
             }
+            ctl_error(ctx, "%s: a switch with this name already exists",
+                      ls_name);
+            return;
         }
     } else if (may_exist) {
         ctl_error(ctx, "--may-exist requires specifying a name");
@@ -971,6 +1097,9 @@ nbctl_ls_add(struct ctl_context *ctx)
     if (ls_name) {
         nbrec_logical_switch_set_name(ls, ls_name);
     }
+
+    /* Updating runtime cache. */
+    named_row_add(&nbctx->ls_by_name, ls->name, ls);
 }
 
 static void
@@ -1000,6 +1129,7 @@ nbctl_ls_del(struct ctl_context *ctx)
     for (size_t i = 0; i < ls->n_ports; i++) {
         shash_find_and_delete(&nbctx->lsp_to_ls_map, ls->ports[i]->name);
     }
+    named_row_remove(&nbctx->ls_by_name, ls->name, ls);
 
     nbrec_logical_switch_delete(ls);
 }
@@ -1045,11 +1175,11 @@ lsp_by_name_or_uuid(struct ctl_context *ctx, const char *id,
     }
 
     if (!lsp) {
-        NBREC_LOGICAL_SWITCH_PORT_FOR_EACH(lsp, ctx->idl) {
-            if (!strcmp(lsp->name, id)) {
-                break;
-            }
-        }
+        struct nbctl_context *nbctx = nbctl_context_get(ctx);
+        const void *row;
+
+        named_row_find(&nbctx->lsp_by_name, id, &row);
+        lsp = row;
     }
 
     if (!lsp && must_exist) {
@@ -1209,6 +1339,7 @@ nbctl_lsp_add(struct ctl_context *ctx)
 
     /* Updating runtime cache. */
     shash_add(&nbctx->lsp_to_ls_map, lsp_name, ls);
+    named_row_add(&nbctx->lsp_by_name, lsp_name, lsp);
 }
 
 static void
@@ -1232,6 +1363,7 @@ remove_lsp(struct ctl_context *ctx,
 
     /* Updating runtime cache. */
     shash_find_and_delete(&nbctx->lsp_to_ls_map, lsp->name);
+    named_row_remove(&nbctx->lsp_by_name, lsp->name, lsp);
 
     /* First remove 'lsp' from the array of ports.  This is what will
      * actually cause the logical port to be deleted when the transaction is
@@ -1440,6 +1572,28 @@ err_out: ;
     return error;
 }
 
+/* Returns an error if 'address' is not a valid address for the 'addresses'
+ * column of a logical switch port. */
+static char * OVS_WARN_UNUSED_RESULT
+lsp_check_address(const char *address)
+{
+    char ipv6_s[IPV6_SCAN_LEN + 1];
+    struct eth_addr ea;
+    ovs_be32 ip;
+
+    if (strcmp(address, "unknown") && strcmp(address, "dynamic")
+        && strcmp(address, "router")
+        && !ovs_scan(address, ETH_ADDR_SCAN_FMT, ETH_ADDR_SCAN_ARGS(ea))
+        && !ovs_scan(address, "dynamic "IPV6_SCAN_FMT, ipv6_s)
+        && !ovs_scan(address, "dynamic "IP_SCAN_FMT, IP_SCAN_ARGS(&ip))) {
+        return xasprintf("%s: Invalid address format. See ovn-nb(5). "
+                         "Hint: An Ethernet address must be "
+                         "listed before an IP address, together as a single "
+                         "argument.", address);
+    }
+    return NULL;
+}
+
 static void
 nbctl_lsp_set_addresses(struct ctl_context *ctx)
 {
@@ -1461,21 +1615,9 @@ nbctl_lsp_set_addresses(struct ctl_context *ctx)
 
     int i;
     for (i = 2; i < ctx->argc; i++) {
-        char ipv6_s[IPV6_SCAN_LEN + 1];
-        struct eth_addr ea;
-        ovs_be32 ip;
-
-        if (strcmp(ctx->argv[i], "unknown") && strcmp(ctx->argv[i], "dynamic")
-            && strcmp(ctx->argv[i], "router")
-            && !ovs_scan(ctx->argv[i], ETH_ADDR_SCAN_FMT,
-                         ETH_ADDR_SCAN_ARGS(ea))
-            && !ovs_scan(ctx->argv[i], "dynamic "IPV6_SCAN_FMT, ipv6_s)
-            && !ovs_scan(ctx->argv[i], "dynamic "IP_SCAN_FMT,
-                         IP_SCAN_ARGS(&ip))) {
-            ctl_error(ctx, "%s: Invalid address format. See ovn-nb(5). "
-                      "Hint: An Ethernet address must be "
-                      "listed before an IP address, together as a single "
-                      "argument.", ctx->argv[i]);
+        error = lsp_check_address(ctx->argv[i]);
+        if (error) {
+            ctx->error = error;
             return;
         }
 
@@ -1491,6 +1633,287 @@ nbctl_lsp_set_addresses(struct ctl_context *ctx)
             (const char **) ctx->argv + 2, ctx->argc - 2);
 }
 
+/* The words of a line of a batch file. */
+struct batch_line {
+    struct svec words;
+    int line_number;
+};
+
+static void
+batch_lines_destroy(struct batch_line *lines, size_t n_lines)
+{
+    for (size_t i = 0; i < n_lines; i++) {
+        svec_destroy(&lines[i].words);
+    }
+    free(lines);
+}
+
+/* Reads the batch file 'file_name', or the standard input if it is "-", and
+ * stores its lines in '*linesp' and their number in '*n_linesp'.  Each line
+ * is split into words with shell-like quoting.  Empty lines and comments,
+ * which start with '#', are skipped. */
+static char * OVS_WARN_UNUSED_RESULT
+read_batch_file(const char *file_name, struct batch_line **linesp,
+                size_t *n_linesp)
+{
+    FILE *file = !strcmp(file_name, "-") ? stdin : fopen(file_name, "r");
+    if (!file) {
+        return xasprintf("%s: open failed (%s)",
+                         file_name, ovs_strerror(errno));
+    }
+
+    struct batch_line *lines = NULL;
+    size_t n_lines = 0;
+    size_t allocated_lines = 0;
+    struct ds line = DS_EMPTY_INITIALIZER;
+    int line_number = 0;
+    while (!ds_get_preprocessed_line(&line, file, &line_number)) {
+        if (n_lines >= allocated_lines) {
+            lines = x2nrealloc(lines, &allocated_lines, sizeof *lines);
+        }
+        struct batch_line *bl = &lines[n_lines];
+        svec_init(&bl->words);
+        svec_parse_words(&bl->words, ds_cstr(&line));
+        bl->line_number = line_number;
+        if (bl->words.n) {
+            n_lines++;
+        } else {
+            svec_destroy(&bl->words);
+        }
+    }
+    ds_destroy(&line);
+    if (file != stdin) {
+        fclose(file);
+    }
+
+    *linesp = lines;
+    *n_linesp = n_lines;
+    return NULL;
+}
+
+/* An IP address used by a logical switch port. */
+struct lsp_ip {
+    struct hmap_node hmap_node;
+    struct in6_addr ip;         /* IPv4 addresses are IPv4-mapped. */
+    const char *lsp_name;
+};
+
+/* Adds to 'ips' the IP addresses in 'laddrs', which belong to 'lsp_name'. */
+static void
+lsp_ips_add(struct hmap *ips, const struct lport_addresses *laddrs,
+            const char *lsp_name)
+{
+    for (size_t i = 0; i < laddrs->n_ipv4_addrs + laddrs->n_ipv6_addrs; i++) {
+        struct lsp_ip *ip = xmalloc(sizeof *ip);
+        if (i < laddrs->n_ipv4_addrs) {
+            ip->ip = in6_addr_mapped_ipv4(laddrs->ipv4_addrs[i].addr);
+        } else {
+            ip->ip = laddrs->ipv6_addrs[i - laddrs->n_ipv4_addrs].addr;
+        }
+        ip->lsp_name = lsp_name;
+        hmap_insert(ips, &ip->hmap_node,
+                    hash_bytes(&ip->ip, sizeof ip->ip, 0));
+    }
+}
+
+/* Returns an error if one of the IP addresses in 'laddrs' is in 'ips'.  This
+ * is the hashed equivalent of lsp_contains_duplicates(). */
+static char * OVS_WARN_UNUSED_RESULT
+lsp_ips_find_duplicate(const struct hmap *ips,
+                       const struct nbrec_logical_switch *ls,
+                       const struct lport_addresses *laddrs)
+{
+    for (size_t i = 0; i < laddrs->n_ipv4_addrs + laddrs->n_ipv6_addrs; i++) {
+        bool is_ipv4 = i < laddrs->n_ipv4_addrs;
+        struct in6_addr addr;
+        const char *addr_s;
+        if (is_ipv4) {
+            addr = in6_addr_mapped_ipv4(laddrs->ipv4_addrs[i].addr);
+            addr_s = laddrs->ipv4_addrs[i].addr_s;
+        } else {
+            size_t j = i - laddrs->n_ipv4_addrs;
+            addr = laddrs->ipv6_addrs[j].addr;
+            addr_s = laddrs->ipv6_addrs[j].addr_s;
+        }
+
+        const struct lsp_ip *ip;
+        HMAP_FOR_EACH_WITH_HASH (ip, hmap_node,
+                                 hash_bytes(&addr, sizeof addr, 0), ips) {
+            if (ipv6_addr_equals(&ip->ip, &addr)) {
+                return xasprintf("Error on switch %s: duplicate %s address "
+                                 "'%s' found on logical switch port '%s'",
+                                 ls->name, is_ipv4 ? "IPv4" : "IPv6",
+                                 addr_s, ip->lsp_name);
+            }
+        }
+    }
+    return NULL;
+}
+
+static void
+nbctl_pre_lsp_add_batch(struct ctl_context *ctx)
+{
+    nbctl_pre_lsp_add(ctx);
+    nbctl_pre_lsp_set_addresses(ctx);
+}
+
+/* Checks the line of lsp-add-batch whose words are in 'words' against the
+ * existing ports and the previous lines, whose port names are in 'names' and
+ * whose IP addresses, together with those of the ports of 'ls', are in
+ * 'ips'.  On success, adds the line's port name and addresses to them and
+ * sets '*skip' to true if the port already exists. */
+static char * OVS_WARN_UNUSED_RESULT
+lsp_add_batch_check_line(struct ctl_context *ctx,
+                         const struct nbrec_logical_switch *ls,
+                         bool may_exist, const struct svec *words,
+                         struct sset *names, struct hmap *ips, bool *skip)
+{
+    const char *lsp_name = words->names[0];
+    if (!sset_add(names, lsp_name)) {
+        return xasprintf("%s: duplicate port name", lsp_name);
+    }
+
+    const struct nbrec_logical_switch_port *lsp;
+    char *error = lsp_by_name_or_uuid(ctx, lsp_name, false, &lsp);
+    if (error) {
+        return error;
+    }
+    if (lsp) {
+        if (!may_exist) {
+            return xasprintf("%s: a port with this name already exists",
+                             lsp_name);
+        }
+
+        const struct nbrec_logical_switch *lsw;
+        error = lsp_to_ls(ctx, lsp, &lsw);
+        if (error) {
+            return error;
+        }
+        if (lsw != ls) {
+            char uuid_s[UUID_LEN + 1];
+            return xasprintf("%s: port already exists but in switch %s",
+                             lsp_name,
+                             ls_get_name(lsw, uuid_s, sizeof uuid_s));
+        }
+        if (lsp->parent_name) {
+            return xasprintf("%s: port already exists but has parent %s",
+                             lsp_name, lsp->parent_name);
+        }
+        *skip = true;
+        return NULL;
+    }
+
+    for (size_t i = 1; i < words->n; i++) {
+        error = lsp_check_address(words->names[i]);
+        if (error) {
+            return error;
+        }
+
+        struct lport_addresses laddrs;
+        if (extract_lsp_addresses(words->names[i], &laddrs)) {
+            error = lsp_ips_find_duplicate(ips, ls, &laddrs);
+            destroy_lport_addresses(&laddrs);
+            if (error) {
+                return error;
+            }
+        }
+    }
+    for (size_t i = 1; i < words->n; i++) {
+        struct lport_addresses laddrs;
+        if (extract_lsp_addresses(words->names[i], &laddrs)) {
+            lsp_ips_add(ips, &laddrs, lsp_name);
+            destroy_lport_addresses(&laddrs);
+        }
+    }
+    return NULL;
+}
+
+static void
+nbctl_lsp_add_batch(struct ctl_context *ctx)
+{
+    bool may_exist = shash_find(&ctx->options, "--may-exist") != NULL;
+    struct nbctl_context *nbctx = nbctl_context_get(ctx);
+    const char *file_name = ctx->argv[2];
+
+    const struct nbrec_logical_switch *ls = NULL;
+    char *error = ls_by_name_or_uuid(ctx, ctx->argv[1], true, &ls);
+    if (error) {
+        ctx->error = error;
+        return;
+    }
+
+    struct batch_line *lines;
+    size_t n_lines;
+    error = read_batch_file(file_name, &lines, &n_lines);
+    if (error) {
+        ctx->error = error;
+        return;
+    }
+
+    /* Index the IP addresses of the ports of 'ls' once, instead of checking
+     * each new address against all of them. */
+    struct hmap ips = HMAP_INITIALIZER(&ips);
+    for (size_t i = 0; i < ls->n_ports; i++) {
+        const struct nbrec_logical_switch_port *lsp = ls->ports[i];
+        for (size_t j = 0; j < lsp->n_addresses; j++) {
+            const char *addr = lsp->addresses[j];
+            if (is_dynamic_lsp_address(addr) && lsp->dynamic_addresses) {
+                addr = lsp->dynamic_addresses;
+            }
+
+            struct lport_addresses laddrs;
+            if (extract_lsp_addresses(addr, &laddrs)) {
+                lsp_ips_add(&ips, &laddrs, lsp->name);
+                destroy_lport_addresses(&laddrs);
+            }
+        }
+    }
+
+    /* Validate all of the lines before changing anything. */
+    struct sset names = SSET_INITIALIZER(&names);
+    bool *skip = xcalloc(n_lines, sizeof *skip);
+    for (size_t i = 0; i < n_lines; i++) {
+        error = lsp_add_batch_check_line(ctx, ls, may_exist, &lines[i].words,
+                                         &names, &ips, &skip[i]);
+        if (error) {
+            ctl_error(ctx, "%s:%d: %s",
+                      file_name, lines[i].line_number, error);
+            free(error);
+            goto out;
+        }
+    }
+
+    /* Create the logical ports and insert them into the logical switch. */
+    for (size_t i = 0; i < n_lines; i++) {
+        if (skip[i]) {
+            continue;
+        }
+
+        const struct svec *words = &lines[i].words;
+        const char *lsp_name = words->names[0];
+        struct nbrec_logical_switch_port *lsp
+            = nbrec_logical_switch_port_insert(ctx->txn);
+        nbrec_logical_switch_port_set_name(lsp, lsp_name);
+        nbrec_logical_switch_port_set_addresses(
+            lsp, (const char **) words->names + 1, words->n - 1);
+        nbrec_logical_switch_update_ports_addvalue(ls, lsp);
+
+        /* Updating runtime cache. */
+        shash_add(&nbctx->lsp_to_ls_map, lsp_name, ls);
+        named_row_add(&nbctx->lsp_by_name, lsp_name, lsp);
+    }
+
+out:
+    free(skip);
+    sset_destroy(&names);
+    struct lsp_ip *ip;
+    HMAP_FOR_EACH_POP (ip, hmap_node, &ips) {
+        free(ip);
+    }
+    hmap_destroy(&ips);
+    batch_lines_destroy(lines, n_lines);
+}
+
 static void
 nbctl_pre_lsp_get_addresses(struct ctl_context *ctx)
 {
@@ -1934,6 +2357,147 @@ enum {
     DIR_TO_LPORT
 };
 
+/* Pagination and filtering of the rows printed by a list command, as given
+ * by its "--offset=N", "--limit=N" and "--filter=COLUMN=VALUE" options.  The
+ * rows are filtered before they are sorted, and only the rows on the
+ * requested page are formatted. */
+struct list_opts {
+    size_t offset;              /* Number of rows to skip. */
+    size_t limit;               /* Maximum number of rows, or SIZE_MAX. */
+
+    /* If nonnull, only the rows whose 'filter_column' equals 'filter_value'
+     * are listed. */
+    const struct ovsdb_idl_column *filter_column;
+    struct ovsdb_datum filter_value;
+};
+
+/* Parses the "--filter=COLUMN=VALUE" option in 'ctx', if any, for the rows of
+ * 'table'.  Stores the column in '*columnp', or NULL if there is no filter,
+ * and the value in '*valuep'. */
+static char * OVS_WARN_UNUSED_RESULT
+list_filter_parse(const struct ctl_context *ctx,
+                  const struct ovsdb_idl_table_class *table,
+                  const struct ovsdb_idl_column **columnp,
+                  const char **valuep)
+{
+    const char *filter = shash_find_data(&ctx->options, "--filter");
+
+    *columnp = NULL;
+    *valuep = NULL;
+    if (!filter) {
+        return NULL;
+    }
+
+    const char *value = strchr(filter, '=');
+    if (!value) {
+        return xasprintf("%s: argument to --filter must be COLUMN=VALUE",
+                         filter);
+    }
+
+    size_t name_len = value - filter;
+    for (size_t i = 0; i < table->n_columns; i++) {
+        const struct ovsdb_idl_column *column = &table->columns[i];
+        if (strlen(column->name) == name_len
+            && !strncmp(column->name, filter, name_len)) {
+            *columnp = column;
+            *valuep = value + 1;
+            return NULL;
+        }
+    }
+    return xasprintf("%.*s: no such column in table %s",
+                     (int) name_len, filter, table->name);
+}
+
+/* Adds the column that the "--filter" option in 'ctx' refers to, if any, to
+ * the columns of 'table' that the IDL replicates. */
+static void
+nbctl_pre_list_opts(struct ctl_context *ctx,
+                    const struct ovsdb_idl_table_class *table)
+{
+    const struct ovsdb_idl_column *column;
+    const char *value;
+
+    ctx->error = list_filter_parse(ctx, table, &column, &value);
+    if (column) {
+        ovsdb_idl_add_column(ctx->idl, column);
+    }
+}
+
+static char * OVS_WARN_UNUSED_RESULT
+list_opts_init(struct list_opts *opts, const struct ctl_context *ctx,
+               const struct ovsdb_idl_table_class *table)
+{
+    const char *offset = shash_find_data(&ctx->options, "--offset");
+    const char *limit = shash_find_data(&ctx->options, "--limit");
+    unsigned int n;
+
+    opts->offset = 0;
+    opts->limit = SIZE_MAX;
+    opts->filter_column = NULL;
+
+    if (offset) {
+        if (!str_to_uint(offset, 10, &n)) {
+            return xasprintf("%s: invalid value for --offset", offset);
+        }
+        opts->offset = n;
+    }
+    if (limit) {
+        if (!str_to_uint(limit, 10, &n)) {
+            return xasprintf("%s: invalid value for --limit", limit);
+        }
+        opts->limit = n;
+    }
+
+    const struct ovsdb_idl_column *column;
+    const char *value;
+    char *error = list_filter_parse(ctx, table, &column, &value);
+    if (error) {
+        return error;
+    }
+    if (column) {
+        error = ovsdb_datum_from_string(&opts->filter_value, &column->type,
+                                        value, NULL);
+        if (error) {
+            char *s = xasprintf("%s: invalid value for column %s (%s)",
+                                value, column->name, error);
+            free(error);
+            return s;
+        }
+        opts->filter_column = column;
+    }
+    return NULL;
+}
+
+static void
+list_opts_destroy(struct list_opts *opts)
+{
+    if (opts->filter_column) {
+        ovsdb_datum_destroy(&opts->filter_value, &opts->filter_column->type);
+    }
+}
+
+/* Returns true if 'row' passes the filter in 'opts'. */
+static bool
+list_opts_match(const struct list_opts *opts, const struct ovsdb_idl_row *row)
+{
+    return (!opts->filter_column
+            || ovsdb_datum_equals(ovsdb_idl_read(row, opts->filter_column),
+                                  &opts->filter_value,
+                                  &opts->filter_column->type));
+}
+
+/* Returns the index just past the last of 'n' sorted rows to list according
+ * to the pagination in 'opts', and stores the index of the first one in
+ * '*startp'. */
+static size_t
+list_opts_page(const struct list_opts *opts, size_t n, size_t *startp)
+{
+    size_t start = MIN(opts->offset, n);
+
+    *startp = start;
+    return n - start > opts->limit ? start + opts->limit : n;
+}
+
 static int
 dir_encode(const char *dir)
 {
@@ -2025,17 +2589,29 @@ nbctl_acl_list(struct ctl_context *ctx)
         return;
     }
 
-    size_t n_acls = pg ? pg->n_acls : ls->n_acls;
+    struct list_opts opts;
+    error = list_opts_init(&opts, ctx, &nbrec_table_acl);
+    if (error) {
+        ctx->error = error;
+        return;
+    }
+
+    size_t n_nb_acls = pg ? pg->n_acls : ls->n_acls;
     struct nbrec_acl **nb_acls = pg ? pg->acls : ls->acls;
+    size_t n_acls = 0;
 
-    acls = xmalloc(sizeof *acls * n_acls);
-    for (i = 0; i < n_acls; i++) {
-        acls[i] = nb_acls[i];
+    acls = xmalloc(sizeof *acls * n_nb_acls);
+    for (i = 0; i < n_nb_acls; i++) {
+        if (list_opts_match(&opts, &nb_acls[i]->header_)) {
+            acls[n_acls++] = nb_acls[i];
+        }
     }
 
     qsort(acls, n_acls, sizeof *acls, acl_cmp);
 
-    for (i = 0; i < n_acls; i++) {
+    size_t start;
+    size_t end = list_opts_page(&opts, n_acls, &start);
+    for (i = start; i < end; i++) {
         const struct nbrec_acl *acl = acls[i];
         ds_put_format(&ctx->output, "%10s %5"PRId64" (%s) %s",
                       acl->direction, acl->priority, acl->match,
@@ -2061,6 +2637,7 @@ nbctl_acl_list(struct ctl_context *ctx)
     }
 
     free(acls);
+    list_opts_destroy(&opts);
 }
 
 static int
@@ -2128,6 +2705,19 @@ parse_acl_label(const char *arg, int64_t *label_p)
     return NULL;
 }
 
+static char * OVS_WARN_UNUSED_RESULT
+parse_acl_action(const char *action)
+{
+    if (strcmp(action, "allow") && strcmp(action, "allow-related")
+        && strcmp(action, "allow-stateless") && strcmp(action, "drop")
+        && strcmp(action, "reject")) {
+        return xasprintf("%s: action must be one of \"allow\", "
+                         "\"allow-related\", \"allow-stateless\", "
+                         "\"drop\", and \"reject\"", action);
+    }
+    return NULL;
+}
+
 static void
 nbctl_pre_acl(struct ctl_context *ctx)
 {
@@ -2155,6 +2745,8 @@ nbctl_pre_acl_list(struct ctl_context *ctx)
     ovsdb_idl_add_column(ctx->idl, &nbrec_acl_col_meter);
     ovsdb_idl_add_column(ctx->idl, &nbrec_acl_col_label);
     ovsdb_idl_add_column(ctx->idl, &nbrec_acl_col_options);
+
+    nbctl_pre_list_opts(ctx, &nbrec_table_acl);
 }
 
 static void
@@ -2183,13 +2775,9 @@ nbctl_acl_add(struct ctl_context *ctx)
         return;
     }
 
-    /* Validate action. */
-    if (strcmp(action, "allow") && strcmp(action, "allow-related")
-        && strcmp(action, "allow-stateless") && strcmp(action, "drop")
-        && strcmp(action, "reject")) {
-        ctl_error(ctx, "%s: action must be one of \"allow\", "
-                  "\"allow-related\", \"allow-stateless\", \"drop\", "
-                  "and \"reject\"", action);
+    error = parse_acl_action(action);
+    if (error) {
+        ctx->error = error;
         return;
     }
 
@@ -2271,6 +2859,160 @@ nbctl_acl_add(struct ctl_context *ctx)
     }
 }
 
+/* The fields that acl_cmp() compares, for hashed duplicate checks. */
+struct acl_key {
+    struct hmap_node hmap_node;
+    const char *direction;
+    int64_t priority;
+    const char *match;
+};
+
+static uint32_t
+acl_key_hash(const char *direction, int64_t priority, const char *match)
+{
+    return hash_string(match, hash_uint64_basis(priority,
+                                                dir_encode(direction)));
+}
+
+/* Adds the key of an ACL to 'keys', unless it is already there, in which
+ * case returns false. */
+static bool
+acl_key_add(struct hmap *keys, const char *direction, int64_t priority,
+            const char *match)
+{
+    uint32_t hash = acl_key_hash(direction, priority, match);
+    struct acl_key *key;
+    HMAP_FOR_EACH_WITH_HASH (key, hmap_node, hash, keys) {
+        if (key->priority == priority && !strcmp(key->direction, direction)
+            && !strcmp(key->match, match)) {
+            return false;
+        }
+    }
+
+    key = xmalloc(sizeof *key);
+    key->direction = direction;
+    key->priority = priority;
+    key->match = match;
+    hmap_insert(keys, &key->hmap_node, hash);
+    return true;
+}
+
+/* A line of acl-add-batch, once parsed. */
+struct acl_batch_entry {
+    const char *direction;
+    int64_t priority;
+    const char *match;
+    const char *action;
+    bool skip;                  /* Already exists. */
+};
+
+static char * OVS_WARN_UNUSED_RESULT
+acl_add_batch_parse_line(const struct svec *words, bool may_exist,
+                         const char *entity, struct hmap *keys,
+                         struct acl_batch_entry *entry)
+{
+    if (words->n != 4) {
+        return xstrdup("expected DIRECTION PRIORITY MATCH ACTION");
+    }
+
+    char *error = parse_direction(words->names[0], &entry->direction);
+    if (!error) {
+        error = parse_priority(words->names[1], &entry->priority);
+    }
+    if (!error) {
+        error = parse_acl_action(words->names[3]);
+    }
+    if (error) {
+        return error;
+    }
+    entry->match = words->names[2];
+    entry->action = words->names[3];
+
+    if (!acl_key_add(keys, entry->direction, entry->priority, entry->match)) {
+        if (!may_exist) {
+            return xasprintf("Same ACL already existed on the ls %s.",
+                             entity);
+        }
+        entry->skip = true;
+    }
+    return NULL;
+}
+
+static void
+nbctl_acl_add_batch(struct ctl_context *ctx)
+{
+    bool may_exist = shash_find(&ctx->options, "--may-exist") != NULL;
+    const struct nbrec_logical_switch *ls = NULL;
+    const struct nbrec_port_group *pg = NULL;
+    const char *file_name = ctx->argv[2];
+
+    char *error = acl_cmd_get_pg_or_ls(ctx, &ls, &pg);
+    if (error) {
+        ctx->error = error;
+        return;
+    }
+
+    struct batch_line *lines;
+    size_t n_lines;
+    error = read_batch_file(file_name, &lines, &n_lines);
+    if (error) {
+        ctx->error = error;
+        return;
+    }
+
+    /* Index the existing ACLs once, instead of comparing each new ACL with
+     * all of them. */
+    struct hmap keys = HMAP_INITIALIZER(&keys);
+    size_t n_acls = pg ? pg->n_acls : ls->n_acls;
+    struct nbrec_acl **acls = pg ? pg->acls : ls->acls;
+    for (size_t i = 0; i < n_acls; i++) {
+        acl_key_add(&keys, acls[i]->direction, acls[i]->priority,
+                    acls[i]->match);
+    }
+
+    /* Validate all of the lines before changing anything. */
+    struct acl_batch_entry *entries = xcalloc(n_lines, sizeof *entries);
+    for (size_t i = 0; i < n_lines; i++) {
+        error = acl_add_batch_parse_line(&lines[i].words, may_exist,
+                                         ctx->argv[1], &keys, &entries[i]);
+        if (error) {
+            ctl_error(ctx, "%s:%d: %s",
+                      file_name, lines[i].line_number, error);
+            free(error);
+            goto out;
+        }
+    }
+
+    /* Create the ACLs and insert them into the logical switch or port
+     * group. */
+    for (size_t i = 0; i < n_lines; i++) {
+        const struct acl_batch_entry *entry = &entries[i];
+        if (entry->skip) {
+            continue;
+        }
+
+        struct nbrec_acl *acl = nbrec_acl_insert(ctx->txn);
+        nbrec_acl_set_priority(acl, entry->priority);
+        nbrec_acl_set_direction(acl, entry->direction);
+        nbrec_acl_set_match(acl, entry->match);
+        nbrec_acl_set_action(acl, entry->action);
+        if (pg) {
+            nbrec_port_group_update_acls_addvalue(pg, acl);
+        } else {
+            nbrec_logical_switch_update_acls_addvalue(ls, acl);
+        }
+    }
+
+out:
+    free(entries);
+    struct acl_key *key;
+    HMAP_FOR_EACH_POP (key, hmap_node, &keys) {
+        free(key);
+    }
+    hmap_destroy(&keys);
+    batch_lines_destroy(lines, n_lines);
+}
+
 static void
 nbctl_acl_del(struct ctl_context *ctx)
 {
@@ -3027,49 +3769,65 @@ nbctl_pre_lb_list(struct ctl_context *ctx)
     ovsdb_idl_add_column(ctx->idl, &nbrec_load_balancer_col_name);
     ovsdb_idl_add_column(ctx->idl, &nbrec_load_balancer_col_protocol);
     ovsdb_idl_add_column(ctx->idl, &nbrec_load_balancer_col_vips);
+
+    nbctl_pre_list_opts(ctx, &nbrec_table_load_balancer);
 }
 
+/* Formats the VIPs of 'lb', which must have at least one, into 'val'. */
 static void
-lb_info_add_smap(const struct nbrec_load_balancer *lb,
-                 struct smap *lbs, int vip_width)
+lb_info_format(const struct nbrec_load_balancer *lb, struct ds *val,
+               int vip_width)
 {
     const struct smap_node **nodes = smap_sort(&lb->vips);
-    if (nodes) {
-        struct ds val = DS_EMPTY_INITIALIZER;
-        for (int i = 0; i < smap_count(&lb->vips); i++) {
-            const struct smap_node *node = nodes[i];
-
-            struct sockaddr_storage ss;
-            if (!inet_parse_active(node->key, 0, &ss, false, NULL)) {
-                continue;
-            }
+    for (int i = 0; i < smap_count(&lb->vips); i++) {
+        const struct smap_node *node = nodes[i];
 
-            char *protocol = ss_get_port(&ss) ? lb->protocol : "tcp";
-            i == 0 ? ds_put_format(&val,
-                        UUID_FMT "    %-20.16s%-11.7s%-*.*s%s",
-                        UUID_ARGS(&lb->header_.uuid),
-                        lb->name, protocol,
-                        vip_width + 4, vip_width,
-                        node->key, node->value)
-                   : ds_put_format(&val, "\n%60s%-11.7s%-*.*s%s",
-                        "", protocol,
-                        vip_width + 4, vip_width,
-                        node->key, node->value);
+        struct sockaddr_storage ss;
+        if (!inet_parse_active(node->key, 0, &ss, false, NULL)) {
+            continue;
         }
 
+        char *protocol = ss_get_port(&ss) ? lb->protocol : "tcp";
+        i == 0 ? ds_put_format(val,
+                    UUID_FMT "    %-20.16s%-11.7s%-*.*s%s",
+                    UUID_ARGS(&lb->header_.uuid),
+                    lb->name, protocol,
+                    vip_width + 4, vip_width,
+                    node->key, node->value)
+               : ds_put_format(val, "\n%60s%-11.7s%-*.*s%s",
+                    "", protocol,
+                    vip_width + 4, vip_width,
+                    node->key, node->value);
+    }
+    free(nodes);
+}
+
+static void
+lb_info_add_smap(const struct nbrec_load_balancer *lb,
+                 struct smap *lbs, int vip_width)
+{
+    if (!smap_is_empty(&lb->vips)) {
+        struct ds val = DS_EMPTY_INITIALIZER;
+        lb_info_format(lb, &val, vip_width);
         smap_add_nocopy(lbs, xasprintf("%-20.16s", lb->name),
                         ds_steal_cstr(&val));
-        free(nodes);
     }
 }
 
+static void
+lb_info_print_header(struct ctl_context *ctx, int vip_width)
+{
+    ds_put_format(&ctx->output, "%-40.36s%-20.16s%-11.7s%-*.*s%s\n",
+                  "UUID", "LB", "PROTO", vip_width + 4, vip_width, "VIP",
+                  "IPs");
+}
+
 static void
 lb_info_print(struct ctl_context *ctx, struct smap *lbs, int vip_width)
 {
     const struct smap_node **nodes = smap_sort(lbs);
     if (nodes) {
-        ds_put_format(&ctx->output, "%-40.36s%-20.16s%-11.7s%-*.*s%s\n",
-                "UUID", "LB", "PROTO", vip_width + 4, vip_width, "VIP", "IPs");
+        lb_info_print_header(ctx, vip_width);
         for (size_t i = 0; i < smap_count(lbs); i++) {
             const struct smap_node *node = nodes[i];
             ds_put_format(&ctx->output, "%s\n", node->value);
@@ -3095,40 +3853,73 @@ lb_get_max_vip_length(const struct nbrec_load_balancer *lb, int vip_width)
     return max_length;
 }
 
+static int
+lb_cmp(const void *lb1_, const void *lb2_)
+{
+    const struct nbrec_load_balancer *const *lb1p = lb1_;
+    const struct nbrec_load_balancer *const *lb2p = lb2_;
+    const struct nbrec_load_balancer *lb1 = *lb1p;
+    const struct nbrec_load_balancer *lb2 = *lb2p;
+
+    int cmp = strcmp(lb1->name, lb2->name);
+    return cmp ? cmp : uuid_compare_3way(&lb1->header_.uuid,
+                                         &lb2->header_.uuid);
+}
+
+/* Lists the load balancers with VIPs that are named 'lb_name', or all of them
+ * if 'lb_name' is NULL.  The load balancers are sorted by name, and only the
+ * ones on the requested page are formatted. */
 static void
-lb_info_list_all(struct ctl_context *ctx,
-                 const char *lb_name, bool lb_check)
+lb_info_list_all(struct ctl_context *ctx, const char *lb_name)
 {
     const struct nbrec_load_balancer *lb;
-    struct smap lbs = SMAP_INITIALIZER(&lbs);
-    int vip_width = 0;
+    const struct nbrec_load_balancer **lbs = NULL;
+    size_t n_lbs = 0;
+    size_t allocated_lbs = 0;
+
+    struct list_opts opts;
+    char *error = list_opts_init(&opts, ctx, &nbrec_table_load_balancer);
+    if (error) {
+        ctx->error = error;
+        return;
+    }
 
     NBREC_LOAD_BALANCER_FOR_EACH (lb, ctx->idl) {
-        if (lb_check && strcmp(lb->name, lb_name)) {
+        if ((lb_name && strcmp(lb->name, lb_name))
+            || smap_is_empty(&lb->vips)
+            || !list_opts_match(&opts, &lb->header_)) {
             continue;
         }
-        vip_width = lb_get_max_vip_length(lb, vip_width);
+        if (n_lbs >= allocated_lbs) {
+            lbs = x2nrealloc(lbs, &allocated_lbs, sizeof *lbs);
+        }
+        lbs[n_lbs++] = lb;
     }
+    qsort(lbs, n_lbs, sizeof *lbs, lb_cmp);
 
-    NBREC_LOAD_BALANCER_FOR_EACH(lb, ctx->idl) {
-        if (lb_check && strcmp(lb->name, lb_name)) {
-            continue;
+    size_t start;
+    size_t end = list_opts_page(&opts, n_lbs, &start);
+    if (start < end) {
+        int vip_width = 0;
+        for (size_t i = start; i < end; i++) {
+            vip_width = lb_get_max_vip_length(lbs[i], vip_width);
+        }
+
+        lb_info_print_header(ctx, vip_width);
+        for (size_t i = start; i < end; i++) {
+            lb_info_format(lbs[i], &ctx->output, vip_width);
+            ds_put_char(&ctx->output, '\n');
         }
-        lb_info_add_smap(lb, &lbs, vip_width);
     }
 
-    lb_info_print(ctx, &lbs, vip_width);
-    smap_destroy(&lbs);
+    free(lbs);
+    list_opts_destroy(&opts);
 }
 
 static void
 nbctl_lb_list(struct ctl_context *ctx)
 {
-    if (ctx->argc == 1) {
-        lb_info_list_all(ctx, NULL, false);
-    } else if (ctx->argc == 2) {
-        lb_info_list_all(ctx, ctx->argv[1], true);
-    }
+    lb_info_list_all(ctx, ctx->argc == 2 ? ctx->argv[1] : NULL);
 }
 
 static void
@@ -3476,19 +4267,17 @@ nbctl_lr_add(struct ctl_context *ctx)
         return;
     }
 
+    struct nbctl_context *nbctx = nbctl_context_get(ctx);
     if (lr_name) {
-        if (!add_duplicate) {
-            const struct nbrec_logical_router *lr;
-            NBREC_LOGICAL_ROUTER_FOR_EACH (lr, ctx->idl) {
-                if (!strcmp(lr->name, lr_name)) {
-                    if (may_exist) {
-                        return;
-                    }
-                    ctl_error(ctx, "%s: a router with this name already "
-                              "exists", lr_name);
-                    return;
-                }
+        const void *row;
+        if (!add_duplicate
+            && named_row_find(&nbctx->lr_by_name, lr_name, &row)) {
+            if (may_exist) {
+                return;
             }
+            ctl_error(ctx, "%s: a router with this name already exists",
+                      lr_name);
+            return;
         }
     } else if (may_exist) {
         ctl_error(ctx, "--may-exist requires specifying a name");
@@ -3503,6 +4292,9 @@ nbctl_lr_add(struct ctl_context *ctx)
     if (lr_name) {
         nbrec_logical_router_set_name(lr, lr_name);
     }
+
+    /* Updating runtime cache. */
+    named_row_add(&nbctx->lr_by_name, lr->name, lr);
 }
 
 static void
@@ -3534,6 +4326,7 @@ nbctl_lr_del(struct ctl_context *ctx)
     for (size_t i = 0; i < lr->n_ports; i++) {
         shash_find_and_delete(&nbctx->lrp_to_lr_map, lr->ports[i]->name);
     }
+    named_row_remove(&nbctx->lr_by_name, lr->name, lr);
 
     nbrec_logical_router_delete(lr);
 }
@@ -5080,6 +5873,38 @@ nbctl_pre_lr_nat_list(struct ctl_context *ctx)
     ovsdb_idl_add_column(ctx->idl, &nbrec_nat_col_gateway_port);
 
     ovsdb_idl_add_column(ctx->idl, &nbrec_logical_router_port_col_name);
+
+    nbctl_pre_list_opts(ctx, &nbrec_table_nat);
+}
+
+static int
+nullable_strcmp(const char *a, const char *b)
+{
+    return a && b ? strcmp(a, b) : (a != NULL) - (b != NULL);
+}
+
+/* Orders NATs by type, gateway port and external IP, which are the columns
+ * that lr-nat-list prints first. */
+static int
+nat_cmp(const void *nat1_, const void *nat2_)
+{
+    const struct nbrec_nat *const *nat1p = nat1_;
+    const struct nbrec_nat *const *nat2p = nat2_;
+    const struct nbrec_nat *nat1 = *nat1p;
+    const struct nbrec_nat *nat2 = *nat2p;
+    int cmp;
+
+    if ((cmp = strcmp(nat1->type, nat2->type))
+        || (cmp = strcmp(nat1->gateway_port ? nat1->gateway_port->name : "",
+                         nat2->gateway_port ? nat2->gateway_port->name : ""))
+        || (cmp = strcmp(nat1->external_ip, nat2->external_ip))
+        || (cmp = strcmp(nat1->external_port_range,
+                         nat2->external_port_range))
+        || (cmp = strcmp(nat1->logical_ip, nat2->logical_ip))
+        || (cmp = nullable_strcmp(nat1->external_mac, nat2->external_mac))) {
+        return cmp;
+    }
+    return nullable_strcmp(nat1->logical_port, nat2->logical_port);
 }
 
 static void
@@ -5092,44 +5917,56 @@ nbctl_lr_nat_list(struct ctl_context *ctx)
         return;
     }
 
-    struct smap lr_nats = SMAP_INITIALIZER(&lr_nats);
+    struct list_opts opts;
+    error = list_opts_init(&opts, ctx, &nbrec_table_nat);
+    if (error) {
+        ctx->error = error;
+        return;
+    }
+
+    const struct nbrec_nat **nats = xmalloc(lr->n_nat * sizeof *nats);
+    size_t n_nats = 0;
     for (size_t i = 0; i < lr->n_nat; i++) {
-        const struct nbrec_nat *nat = lr->nat[i];
+        if (list_opts_match(&opts, &lr->nat[i]->header_)) {
+            nats[n_nats++] = lr->nat[i];
+        }
+    }
+    qsort(nats, n_nats, sizeof *nats, nat_cmp);
+
+    size_t start;
+    size_t end = list_opts_page(&opts, n_nats, &start);
+    if (start < end) {
+        ds_put_format(&ctx->output,
+                "%-17.13s%-22.18s%-19.15s%-17.13s%-20.16s%-21.17s%s\n",
+                "TYPE", "GATEWAY_PORT", "EXTERNAL_IP", "EXTERNAL_PORT",
+                "LOGICAL_IP", "EXTERNAL_MAC", "LOGICAL_PORT");
+    }
+    for (size_t i = start; i < end; i++) {
+        const struct nbrec_nat *nat = nats[i];
         char *key = xasprintf("%-17.13s%-22.18s%s",
                               nat->type,
                               nat->gateway_port
                               ? nat->gateway_port->name
                               : "",
                               nat->external_ip);
+        ds_put_format(&ctx->output, "%-58.54s", key);
+        free(key);
+
         if (nat->external_mac && nat->logical_port) {
-            smap_add_format(&lr_nats, key,
-                            "%-17.13s%-20.16s%-21.17s%s",
-                            nat->external_port_range,
-                            nat->logical_ip,
-                            nat->external_mac,
-                            nat->logical_port);
+            ds_put_format(&ctx->output, "%-17.13s%-20.16s%-21.17s%s\n",
+                          nat->external_port_range,
+                          nat->logical_ip,
+                          nat->external_mac,
+                          nat->logical_port);
         } else {
-            smap_add_format(&lr_nats, key, "%-17.13s%s",
-                            nat->external_port_range,
-                            nat->logical_ip);
+            ds_put_format(&ctx->output, "%-17.13s%s\n",
+                          nat->external_port_range,
+                          nat->logical_ip);
         }
-        free(key);
     }
 
-    const struct smap_node **nodes = smap_sort(&lr_nats);
-    if (nodes) {
-        ds_put_format(&ctx->output,
-                "%-17.13s%-22.18s%-19.15s%-17.13s%-20.16s%-21.17s%s\n",
-                "TYPE", "GATEWAY_PORT", "EXTERNAL_IP", "EXTERNAL_PORT",
-                "LOGICAL_IP", "EXTERNAL_MAC", "LOGICAL_PORT");
-        for (size_t i = 0; i < smap_count(&lr_nats); i++) {
-            const struct smap_node *node = nodes[i];
-            ds_put_format(&ctx->output, "%-58.54s%s\n",
-                    node->key, node->value);
-        }
-        free(nodes);
-    }
-    smap_destroy(&lr_nats);
+    free(nats);
+    list_opts_destroy(&opts);
 }
 
 static void
@@ -5238,11 +6075,11 @@ lrp_by_name_or_uuid(struct ctl_context *ctx, const char *id, bool must_exist,
     }
 
     if (!lrp) {
-        NBREC_LOGICAL_ROUTER_PORT_FOR_EACH(lrp, ctx->idl) {
-            if (!strcmp(lrp->name, id)) {
-                break;
-            }
-        }
+        struct nbctl_context *nbctx = nbctl_context_get(ctx);
+        const void *row;
+
+        named_row_find(&nbctx->lrp_by_name, id, &row);
+        lrp = row;
     }
 
     if (!lrp && must_exist) {
@@ -5695,6 +6532,7 @@ nbctl_lrp_add(struct ctl_context *ctx)
 
     /* Updating runtime cache. */
     shash_add(&nbctx->lrp_to_lr_map, lrp->name, lr);
+    named_row_add(&nbctx->lrp_by_name, lrp->name, lrp);
 }
 
 /* Removes logical router port 'lrp' from logical router 'lr'. */
@@ -5707,6 +6545,7 @@ remove_lrp(struct ctl_context *ctx,
 
     /* Updating runtime cache. */
     shash_find_and_delete(&nbctx->lrp_to_lr_map, lrp->name);
+    named_row_remove(&nbctx->lrp_by_name, lrp->name, lrp);
 
     /* First remove 'lrp' from the array of ports.  This is what will
      * actually cause the logical port to be deleted when the transaction is
@@ -6477,6 +7316,8 @@ nbctl_pre_lr_route_list(struct ctl_context *ctx)
                          &nbrec_logical_router_static_route_col_bfd);
     ovsdb_idl_add_column(ctx->idl,
                          &nbrec_logical_router_static_route_col_route_table);
+
+    nbctl_pre_list_opts(ctx, &nbrec_table_logical_router_static_route);
 }
 
 static void
@@ -6496,6 +7337,14 @@ nbctl_lr_route_list(struct ctl_context *ctx)
 
     char *route_table = shash_find_data(&ctx->options, "--route-table");
 
+    struct list_opts opts;
+    error = list_opts_init(&opts, ctx,
+                           &nbrec_table_logical_router_static_route);
+    if (error) {
+        ctx->error = error;
+        return;
+    }
+
     ipv4_routes = xmalloc(sizeof *ipv4_routes * lr->n_static_routes);
     ipv6_routes = xmalloc(sizeof *ipv6_routes * lr->n_static_routes);
 
@@ -6505,6 +7354,9 @@ nbctl_lr_route_list(struct ctl_context *ctx)
         if (route_table && strcmp(route->route_table, route_table)) {
             continue;
         }
+        if (!list_opts_match(&opts, &route->header_)) {
+            continue;
+        }
         unsigned int plen;
         ovs_be32 ipv4;
         const char *policy = route->policy ? route->policy : "dst-ip";
@@ -6542,11 +7394,20 @@ nbctl_lr_route_list(struct ctl_context *ctx)
     qsort(ipv4_routes, n_ipv4_routes, sizeof *ipv4_routes, ipv4_route_cmp);
     qsort(ipv6_routes, n_ipv6_routes, sizeof *ipv6_routes, ipv6_route_cmp);
 
-    if (n_ipv4_routes) {
+    /* The page spans the IPv4 routes followed by the IPv6 routes. */
+    size_t start;
+    size_t end = list_opts_page(&opts, n_ipv4_routes + n_ipv6_routes,
+                                &start);
+    size_t ipv4_start = MIN(start, n_ipv4_routes);
+    size_t ipv4_end = MIN(end, n_ipv4_routes);
+    size_t ipv6_start = MAX(start, n_ipv4_routes) - n_ipv4_routes;
+    size_t ipv6_end = MAX(end, n_ipv4_routes) - n_ipv4_routes;
+
+    if (ipv4_start < ipv4_end) {
         ds_put_cstr(&ctx->output, "IPv4 Routes\n");
     }
     const struct nbrec_logical_router_static_route *route;
-    for (int i = 0; i < n_ipv4_routes; i++) {
+    for (size_t i = ipv4_start; i < ipv4_end; i++) {
         bool ecmp = false;
         if (i < n_ipv4_routes - 1 &&
             !__ipv4_route_cmp(&ipv4_routes[i], &ipv4_routes[i + 1])) {
@@ -6558,9 +7419,11 @@ nbctl_lr_route_list(struct ctl_context *ctx)
         }
 
         route = ipv4_routes[i].route;
-        if (!i || (i > 0 && strcmp(route->route_table,
-                                   ipv4_routes[i - 1].route->route_table))) {
-            ds_put_format(&ctx->output, "%sRoute Table %s:\n", i ? "\n" : "",
+        if (i == ipv4_start
+            || strcmp(route->route_table,
+                      ipv4_routes[i - 1].route->route_table)) {
+            ds_put_format(&ctx->output, "%sRoute Table %s:\n",
+                          i > ipv4_start ? "\n" : "",
                           strlen(route->route_table) ? route->route_table
                                                      : "<main>");
         }
@@ -6568,11 +7431,11 @@ nbctl_lr_route_list(struct ctl_context *ctx)
         print_route(ipv4_routes[i].route, &ctx->output, ecmp);
     }
 
-    if (n_ipv6_routes) {
+    if (ipv6_start < ipv6_end) {
         ds_put_format(&ctx->output, "%sIPv6 Routes\n",
-                      n_ipv4_routes ?  "\n" : "");
+                      ipv4_start < ipv4_end ?  "\n" : "");
     }
-    for (int i = 0; i < n_ipv6_routes; i++) {
+    for (size_t i = ipv6_start; i < ipv6_end; i++) {
         bool ecmp = false;
         if (i < n_ipv6_routes - 1 &&
             !__ipv6_route_cmp(&ipv6_routes[i], &ipv6_routes[i + 1])) {
@@ -6584,9 +7447,11 @@ nbctl_lr_route_list(struct ctl_context *ctx)
         }
 
         route = ipv6_routes[i].route;
-        if (!i || (i > 0 && strcmp(route->route_table,
-                                   ipv6_routes[i - 1].route->route_table))) {
-            ds_put_format(&ctx->output, "%sRoute Table %s:\n", i ? "\n" : "",
+        if (i == ipv6_start
+            || strcmp(route->route_table,
+                      ipv6_routes[i - 1].route->route_table)) {
+            ds_put_format(&ctx->output, "%sRoute Table %s:\n",
+                          i > ipv6_start ? "\n" : "",
                           strlen(route->route_table) ? route->route_table
                                                      : "<main>");
         }
@@ -6596,6 +7461,7 @@ nbctl_lr_route_list(struct ctl_context *ctx)
 
     free(ipv4_routes);
     free(ipv6_routes);
+    list_opts_destroy(&opts);
 }
 
 static void
@@ -7297,10 +8163,13 @@ static const struct ctl_command_syntax nbctl_commands[] = {
       nbctl_pre_acl, nbctl_acl_add, NULL,
       "--log,--may-exist,--type=,--name=,--severity=,--meter=,--label=,"
       "--apply-after-lb", RW },
+    { "acl-add-batch", 2, 2, "{SWITCH | PORTGROUP} FILE",
+      nbctl_pre_acl, nbctl_acl_add_batch, NULL, "--may-exist,--type=", RW },
     { "acl-del", 1, 4, "{SWITCH | PORTGROUP} [DIRECTION [PRIORITY MATCH]]",
       nbctl_pre_acl, nbctl_acl_del, NULL, "--type=", RW },
     { "acl-list", 1, 1, "{SWITCH | PORTGROUP}",
-      nbctl_pre_acl_list, nbctl_acl_list, NULL, "--type=", RO },
+      nbctl_pre_acl_list, nbctl_acl_list, NULL,
+      "--type=,--offset=,--limit=,--filter=", RO },
 
     /* qos commands. */
     { "qos-add", 5, 7,
@@ -7322,6 +8191,8 @@ static const struct ctl_command_syntax nbctl_commands[] = {
     /* logical switch port commands. */
     { "lsp-add", 2, 4, "SWITCH PORT [PARENT] [TAG]",
       nbctl_pre_lsp_add, nbctl_lsp_add, NULL, "--may-exist", RW },
+    { "lsp-add-batch", 2, 2, "SWITCH FILE",
+      nbctl_pre_lsp_add_batch, nbctl_lsp_add_batch, NULL, "--may-exist", RW },
     { "lsp-del", 1, 1, "PORT", nbctl_pre_lsp_del, nbctl_lsp_del,
       NULL, "--if-exists", RW },
     { "lsp-list", 1, 1, "SWITCH", nbctl_pre_lsp_list, nbctl_lsp_list,
@@ -7420,7 +8291,8 @@ static const struct ctl_command_syntax nbctl_commands[] = {
       nbctl_pre_lr_route_del, nbctl_lr_route_del, NULL,
       "--if-exists,--policy=,--route-table=", RW },
     { "lr-route-list", 1, 1, "ROUTER", nbctl_pre_lr_route_list,
-      nbctl_lr_route_list, NULL, "--route-table=", RO },
+      nbctl_lr_route_list, NULL,
+      "--route-table=,--offset=,--limit=,--filter=", RO },
 
     /* Policy commands */
     { "lr-policy-add", 4, INT_MAX,
@@ -7441,7 +8313,7 @@ static const struct ctl_command_syntax nbctl_commands[] = {
     { "lr-nat-del", 1, 4, "ROUTER [TYPE [IP] [GATEWAY_PORT]]",
       nbctl_pre_lr_nat_del, nbctl_lr_nat_del, NULL, "--if-exists", RW },
     { "lr-nat-list", 1, 1, "ROUTER", nbctl_pre_lr_nat_list,
-      nbctl_lr_nat_list, NULL, "", RO },
+      nbctl_lr_nat_list, NULL, "--offset=,--limit=,--filter=", RO },
     { "lr-nat-update-ext-ip", 4, 4, "ROUTER TYPE IP ADDRESS_SET",
       nbctl_pre_lr_nat_set_ext_ips, nbctl_lr_nat_set_ext_ips,
       NULL, "--is-exempted", RW},
@@ -7451,7 +8323,8 @@ static const struct ctl_command_syntax nbctl_commands[] = {
       "--may-exist,--add-duplicate,--reject,--event,--add-route", RW },
     { "lb-del", 1, 2, "LB [VIP]", nbctl_pre_lb_del, nbctl_lb_del, NULL,
         "--if-exists", RW },
-    { "lb-list", 0, 1, "[LB]", nbctl_pre_lb_list, nbctl_lb_list, NULL, "", RO },
+    { "lb-list", 0, 1, "[LB]", nbctl_pre_lb_list, nbctl_lb_list, NULL,
+      "--offset=,--limit=,--filter=", RO },
     { "lr-lb-add", 2, 2, "ROUTER LB", nbctl_pre_lr_lb_add,
       nbctl_lr_lb_add, NULL, "--may-exist", RW },
     { "lr-lb-del", 1, 2, "ROUTER [LB]", nbctl_pre_lr_lb_del,
@@ -7562,6 +8435,7 @@ main(int argc, char *argv[])
 
         .ctx_create = nbctl_ctx_create,
         .ctx_destroy = nbctl_ctx_destroy,
+        .invalidate_cache = nbctl_context_invalidate_cache,
     };
 
     return ovn_dbctl_main(argc, argv, &dbctl_options);
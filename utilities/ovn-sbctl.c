@@ -34,6 +34,7 @@
 #include "daemon.h"
 #include "dirs.h"
 #include "fatal-signal.h"
+#include "hmapx.h"
 #include "jsonrpc.h"
 #include "openvswitch/dynamic-string.h"
 #include "openvswitch/json.h"
@@ -130,7 +131,9 @@ Options:\n\
   --no-leader-only            accept any cluster member, not just the leader\n\
   -t, --timeout=SECS          wait at most SECS seconds\n\
   --dry-run                   do not commit changes to database\n\
-  --oneline                   print exactly one line of output per command\n",
+  --oneline                   print exactly one line of output per command\n\
+  --coalesce-requests=N       in daemon mode, commit up to N concurrent\n\
+                              requests in a single transaction\n",
            program_name, program_name, ctl_get_db_cmd_usage(),
            ctl_list_db_tables_usage(), default_sb_db());
     table_usage();
@@ -509,6 +512,8 @@ pipeline_encode(const char *pl)
 struct sbctl_lflow {
     const struct sbrec_logical_flow *lflow;
     const struct sbrec_datapath_binding *dp;
+    const char *dp_name;        /* 'dp''s "name" external-id, or "". */
+    int pipeline;               /* 'lflow''s encoded pipeline. */
 };
 
 static int
@@ -522,27 +527,27 @@ sbctl_lflow_cmp(const void *a_, const void *b_)
 
     const struct sbrec_datapath_binding *adb = a_ctl_lflow->dp;
     const struct sbrec_datapath_binding *bdb = b_ctl_lflow->dp;
-    const char *a_name = smap_get_def(&adb->external_ids, "name", "");
-    const char *b_name = smap_get_def(&bdb->external_ids, "name", "");
-    int cmp = strcmp(a_name, b_name);
-    if (cmp) {
-        return cmp;
-    }
-
-    cmp = uuid_compare_3way(&adb->header_.uuid, &bdb->header_.uuid);
-    if (cmp) {
-        return cmp;
-    }
-
-    int a_pipeline = pipeline_encode(a->pipeline);
-    int b_pipeline = pipeline_encode(b->pipeline);
-    cmp = (a_pipeline > b_pipeline ? 1
-           : a_pipeline < b_pipeline ? -1
-           : a->table_id > b->table_id ? 1
-           : a->table_id < b->table_id ? -1
-           : a->priority > b->priority ? -1
-           : a->priority < b->priority ? 1
-           : strcmp(a->match, b->match));
+    if (adb != bdb) {
+        int cmp = strcmp(a_ctl_lflow->dp_name, b_ctl_lflow->dp_name);
+        if (cmp) {
+            return cmp;
+        }
+
+        cmp = uuid_compare_3way(&adb->header_.uuid, &bdb->header_.uuid);
+        if (cmp) {
+            return cmp;
+        }
+    }
+
+    int a_pipeline = a_ctl_lflow->pipeline;
+    int b_pipeline = b_ctl_lflow->pipeline;
+    int cmp = (a_pipeline > b_pipeline ? 1
+               : a_pipeline < b_pipeline ? -1
+               : a->table_id > b->table_id ? 1
+               : a->table_id < b->table_id ? -1
+               : a->priority > b->priority ? -1
+               : a->priority < b->priority ? 1
+               : strcmp(a->match, b->match));
     return cmp ? cmp : strcmp(a->actions, b->actions);
 }
 
@@ -903,11 +908,62 @@ sbctl_lflow_add(struct sbctl_lflow **lflows,
     if (*n_flows == *n_capacity) {
         *lflows = x2nrealloc(*lflows, n_capacity, sizeof **lflows);
     }
-    (*lflows)[*n_flows].lflow = lflow;
-    (*lflows)[*n_flows].dp = dp;
+    (*lflows)[*n_flows] = (struct sbctl_lflow) {
+        .lflow = lflow,
+        .dp = dp,
+        .dp_name = smap_get_def(&dp->external_ids, "name", ""),
+        .pipeline = pipeline_encode(lflow->pipeline),
+    };
     (*n_flows)++;
 }
 
+/* Adds 'lflow' to 'lflows' once for each of its datapaths or, if 'datapath'
+ * is nonnull, only for 'datapath' if 'lflow' applies to it.  In that case,
+ * 'dp_groups' must contain the datapath groups that contain 'datapath'. */
+static void
+sbctl_lflow_add_for_datapaths(struct sbctl_lflow **lflows,
+                              size_t *n_flows, size_t *n_capacity,
+                              const struct sbrec_logical_flow *lflow,
+                              const struct sbrec_datapath_binding *datapath,
+                              const struct hmapx *dp_groups)
+{
+    if (datapath) {
+        if (lflow->logical_datapath == datapath
+            || (lflow->logical_dp_group
+                && hmapx_contains(dp_groups, lflow->logical_dp_group))) {
+            sbctl_lflow_add(lflows, n_flows, n_capacity, lflow, datapath);
+        }
+        return;
+    }
+
+    if (lflow->logical_datapath) {
+        sbctl_lflow_add(lflows, n_flows, n_capacity,
+                        lflow, lflow->logical_datapath);
+    }
+    const struct sbrec_logical_dp_group *dp_group = lflow->logical_dp_group;
+    for (size_t i = 0; dp_group && i < dp_group->n_datapaths; i++) {
+        sbctl_lflow_add(lflows, n_flows, n_capacity,
+                        lflow, dp_group->datapaths[i]);
+    }
+}
+
+/* Returns true if 'lflow' matches one of the partial UUIDs in 'args', or if
+ * 'args' is empty. */
+static bool
+sbctl_lflow_is_selected(const struct sbrec_logical_flow *lflow,
+                        char **args, size_t n_args)
+{
+    if (!n_args) {
+        return true;
+    }
+    for (size_t i = 0; i < n_args; i++) {
+        if (is_partial_uuid_match(&lflow->header_.uuid, args[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
 static void
 print_datapath_prompt(const struct sbrec_datapath_binding *dp,
                       const struct uuid *uuid, char *pipeline,
@@ -1024,32 +1080,62 @@ cmd_lflow_list(struct ctl_context *ctx)
     struct vconn *vconn = sbctl_open_vconn(&ctx->options);
     bool stats = shash_find(&ctx->options, "--stats") != NULL;
 
+    /* Find the datapath groups that contain 'datapath' once, instead of
+     * searching the group of every logical flow. */
+    struct hmapx dp_groups = HMAPX_INITIALIZER(&dp_groups);
+    if (datapath) {
+        const struct sbrec_logical_dp_group *dp_group;
+        SBREC_LOGICAL_DP_GROUP_FOR_EACH (dp_group, ctx->idl) {
+            if (datapath_group_contains_datapath(dp_group, datapath)) {
+                hmapx_add(&dp_groups, CONST_CAST(void *, dp_group));
+            }
+        }
+    }
+
+    /* Only the selected logical flows are collected and sorted.  If every
+     * LFLOW argument is a full UUID, look them up instead of scanning all of
+     * the logical flows. */
+    char **uuid_args = &ctx->argv[1];
+    size_t n_uuid_args = ctx->argc - 1;
+    bool lookup_by_uuid = n_uuid_args > 0;
+    for (size_t i = 0; i < n_uuid_args; i++) {
+        struct uuid uuid;
+        if (!uuid_from_string(&uuid, uuid_args[i])) {
+            lookup_by_uuid = false;
+            break;
+        }
+    }
+
     struct sbctl_lflow *lflows = NULL;
     size_t n_flows = 0;
     size_t n_capacity = 0;
     const struct sbrec_logical_flow *lflow;
-    const struct sbrec_logical_dp_group *dp_group;
-    SBREC_LOGICAL_FLOW_FOR_EACH (lflow, ctx->idl) {
-        if (datapath
-            && lflow->logical_datapath != datapath
-            && !datapath_group_contains_datapath(lflow->logical_dp_group,
-                                                 datapath)) {
-            continue;
-        }
-        if (datapath) {
-            sbctl_lflow_add(&lflows, &n_flows, &n_capacity, lflow, datapath);
-            continue;
+    if (lookup_by_uuid) {
+        struct hmapx selected = HMAPX_INITIALIZER(&selected);
+        for (size_t i = 0; i < n_uuid_args; i++) {
+            struct uuid uuid;
+            uuid_from_string(&uuid, uuid_args[i]);
+            lflow = sbrec_logical_flow_get_for_uuid(ctx->idl, &uuid);
+            if (lflow) {
+                hmapx_add(&selected, CONST_CAST(void *, lflow));
+            }
         }
-        if (lflow->logical_datapath) {
-            sbctl_lflow_add(&lflows, &n_flows, &n_capacity,
-                            lflow, lflow->logical_datapath);
+
+        struct hmapx_node *node;
+        HMAPX_FOR_EACH (node, &selected) {
+            sbctl_lflow_add_for_datapaths(&lflows, &n_flows, &n_capacity,
+                                          node->data, datapath, &dp_groups);
         }
-        dp_group = lflow->logical_dp_group;
-        for (size_t i = 0; dp_group && i < dp_group->n_datapaths; i++) {
-            sbctl_lflow_add(&lflows, &n_flows, &n_capacity,
-                            lflow, dp_group->datapaths[i]);
+        hmapx_destroy(&selected);
+    } else {
+        SBREC_LOGICAL_FLOW_FOR_EACH (lflow, ctx->idl) {
+            if (sbctl_lflow_is_selected(lflow, uuid_args, n_uuid_args)) {
+                sbctl_lflow_add_for_datapaths(&lflows, &n_flows, &n_capacity,
+                                              lflow, datapath, &dp_groups);
+            }
         }
     }
+    hmapx_destroy(&dp_groups);
 
     if (n_flows) {
         qsort(lflows, n_flows, sizeof *lflows, sbctl_lflow_cmp);
@@ -1066,26 +1152,6 @@ cmd_lflow_list(struct ctl_context *ctx)
     for (size_t i = 0; i < n_flows; i++) {
         curr = &lflows[i];
 
-        /* Figure out whether to print this particular flow.  By default, we
-         * print all flows, but if any UUIDs were listed on the command line
-         * then we only print the matching ones. */
-        bool include;
-        if (ctx->argc > 1) {
-            include = false;
-            for (size_t j = 1; j < ctx->argc; j++) {
-                if (is_partial_uuid_match(&curr->lflow->header_.uuid,
-                                          ctx->argv[j])) {
-                    include = true;
-                    break;
-                }
-            }
-        } else {
-            include = true;
-        }
-        if (!include) {
-            continue;
-        }
-
         /* Print a header line for this datapath or pipeline, if we haven't
          * already done so. */
         if (!prev
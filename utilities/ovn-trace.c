@@ -16,7 +16,12 @@
 
 #include <config.h>
 
+#include <errno.h>
 #include <getopt.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "command-line.h"
 #include "compiler.h"
@@ -24,6 +29,7 @@
 #include "dirs.h"
 #include "fatal-signal.h"
 #include "flow.h"
+#include "hmapx.h"
 #include "nx-match.h"
 #include "openvswitch/dynamic-string.h"
 #include "openvswitch/json.h"
@@ -42,8 +48,10 @@
 #include "lib/ovn-util.h"
 #include "ovsdb-idl.h"
 #include "openvswitch/poll-loop.h"
+#include "process.h"
 #include "stream-ssl.h"
 #include "stream.h"
+#include "timeval.h"
 #include "unixctl.h"
 #include "util.h"
 #include "random.h"
@@ -53,6 +61,15 @@ VLOG_DEFINE_THIS_MODULE(ovntrace);
 /* --db: The database server to contact. */
 static const char *db;
 
+/* --db-file: A copy of the southbound database to trace against, served by
+ * an ovsdb-server that ovn-trace starts in a private directory and kills on
+ * exit. */
+static const char *db_file;
+static struct process *db_file_server;
+static char *db_file_dir;
+static char *db_file_sock;
+static char *db_file_ctl;
+
 /* --unixctl-path: Path to use for unixctl server, for "monitor" and "snoop"
      commands. */
 static char *unixctl_path;
@@ -69,6 +86,13 @@ static bool summary;
 /* --minimal: Show a trace with only minimal information. */
 static bool minimal;
 
+/* --batch: File to read the microflows to trace from, one per line, "-" for
+ * stdin. */
+static const char *batch_file;
+
+/* --json: Show each trace as a JSON object. */
+static bool json_output;
+
 /* --ovs: OVS instance to contact to get OpenFlow flows. */
 static const char *ovs;
 static struct vconn *vconn;
@@ -92,7 +116,11 @@ static bool use_friendly_names = true;
 OVS_NO_RETURN static void usage(void);
 static void parse_options(int argc, char *argv[]);
 static char *trace(const char *datapath, const char *flow);
+static char *trace_json(const char *datapath, const char *flow);
+static void trace_batch(const char *datapath);
 static void read_db(void);
+static void update_db(void);
+static const char *db_file_server_start(const char *file);
 static unixctl_cb_func ovntrace_exit;
 static unixctl_cb_func ovntrace_trace;
 
@@ -114,6 +142,11 @@ main(int argc, char *argv[])
             ovs_fatal(0, "non-option arguments not supported with --detach "
                       "(use --help for help)");
         }
+    } else if (batch_file) {
+        if (argc > 1) {
+            ovs_fatal(0, "at most one non-option argument is allowed with "
+                      "--batch (use --help for help)");
+        }
     } else {
         if (argc != 1 && argc != 2) {
             ovs_fatal(0, "one or two non-option arguments are required "
@@ -137,12 +170,43 @@ main(int argc, char *argv[])
         unixctl_command_register("trace", "[OPTIONS] [DATAPATH] MICROFLOW",
                                  1, INT_MAX, ovntrace_trace, NULL);
     }
-    ovnsb_idl = ovsdb_idl_create(db, &sbrec_idl_class, true, false);
+    if (db_file) {
+        db = db_file_server_start(db_file);
+    }
+
+    /* Only fetch the tables that are traced through, which are a fraction of
+     * the southbound database in large deployments. */
+    static const struct ovsdb_idl_table_class *tables[] = {
+        &sbrec_table_address_set,
+        &sbrec_table_datapath_binding,
+        &sbrec_table_dhcp_options,
+        &sbrec_table_dhcpv6_options,
+        &sbrec_table_fdb,
+        &sbrec_table_logical_dp_group,
+        &sbrec_table_logical_flow,
+        &sbrec_table_mac_binding,
+        &sbrec_table_multicast_group,
+        &sbrec_table_port_binding,
+        &sbrec_table_port_group,
+    };
+    ovnsb_idl = ovsdb_idl_create(db, &sbrec_idl_class, false, true);
+    for (size_t i = 0; i < ARRAY_SIZE(tables); i++) {
+        /* Replicate all the columns of the traced tables.  Adding only the
+         * tables would replicate their rows without any column. */
+        for (size_t j = 0; j < tables[i]->n_columns; j++) {
+            const struct ovsdb_idl_column *column = &tables[i]->columns[j];
+
+            ovsdb_idl_add_column(ovnsb_idl, column);
+            if (get_detach()) {
+                /* The daemon follows the changes to the database. */
+                ovsdb_idl_track_add_column(ovnsb_idl, column);
+            }
+        }
+    }
 
     bool already_read = false;
     for (;;) {
         ovsdb_idl_run(ovnsb_idl);
-        unixctl_server_run(server);
         if (!ovsdb_idl_is_alive(ovnsb_idl)) {
             int retval = ovsdb_idl_get_last_error(ovnsb_idl);
             ovs_fatal(0, "%s: database connection failed (%s)",
@@ -153,19 +217,30 @@ main(int argc, char *argv[])
             if (!already_read) {
                 already_read = true;
                 read_db();
+            } else if (get_detach()) {
+                update_db();
             }
+            ovsdb_idl_track_clear(ovnsb_idl);
 
             daemonize_complete();
-            if (!get_detach()) {
+            if (batch_file) {
+                trace_batch(argc ? argv[0] : NULL);
+                return 0;
+            } else if (!get_detach()) {
                 const char *dp_s = argc > 1 ? argv[0] : NULL;
                 const char *flow_s = argv[argc - 1];
-                char *output = trace(dp_s, flow_s);
+                char *output = (json_output
+                                ? trace_json(dp_s, flow_s)
+                                : trace(dp_s, flow_s));
                 fputs(output, stdout);
                 free(output);
                 return 0;
             }
         }
 
+        /* Run the commands after updating the database, so that they trace
+         * against its current contents. */
+        unixctl_server_run(server);
         if (exiting) {
             break;
         }
@@ -181,6 +256,70 @@ default_ovs(void)
     return xasprintf("unix:%s/br-int.mgmt", ovs_rundir());
 }
 
+static void
+db_file_server_stop(void *aux OVS_UNUSED)
+{
+    if (db_file_server) {
+        process_kill(db_file_server, SIGTERM);
+        process_destroy(db_file_server);
+        db_file_server = NULL;
+    }
+    unlink(db_file_sock);
+    unlink(db_file_ctl);
+    rmdir(db_file_dir);
+}
+
+/* Starts an ovsdb-server that serves the database in 'file' on a Unix socket
+ * in a new temporary directory and returns the remote to connect to it.  The
+ * server is killed, and the directory removed, when ovn-trace exits.
+ *
+ * This runs after daemonizing, so that the server is the child of the process
+ * that kills it. */
+static const char *
+db_file_server_start(const char *file)
+{
+    const char *tmpdir = getenv("TMPDIR");
+    db_file_dir = xasprintf("%s/ovn-trace.XXXXXX", tmpdir ? tmpdir : "/tmp");
+    if (!mkdtemp(db_file_dir)) {
+        ovs_fatal(errno, "%s: failed to create directory", db_file_dir);
+    }
+    db_file_sock = xasprintf("%s/db.sock", db_file_dir);
+    db_file_ctl = xasprintf("%s/ovsdb-server.ctl", db_file_dir);
+    fatal_signal_add_hook(db_file_server_stop, NULL, NULL, true);
+
+    char *remote_arg = xasprintf("--remote=punix:%s", db_file_sock);
+    char *unixctl_arg = xasprintf("--unixctl=%s", db_file_ctl);
+    char *argv[] = {
+        CONST_CAST(char *, "ovsdb-server"), remote_arg, unixctl_arg,
+        CONST_CAST(char *, "-vconsole:err"), CONST_CAST(char *, file), NULL
+    };
+    int error = process_start(argv, &db_file_server);
+    free(remote_arg);
+    free(unixctl_arg);
+    if (error) {
+        ovs_fatal(error, "%s: failed to start ovsdb-server", file);
+    }
+
+    /* Wait until the server listens, so that the first connection attempt
+     * succeeds instead of backing off. */
+    long long int deadline = time_msec() + 10000;
+    struct stat st;
+    while (stat(db_file_sock, &st)) {
+        process_run();
+        if (process_exited(db_file_server)) {
+            char *status = process_status_msg(
+                process_status(db_file_server));
+            ovs_fatal(0, "%s: ovsdb-server %s", file, status);
+        }
+        if (time_msec() > deadline) {
+            ovs_fatal(0, "%s: timeout waiting for ovsdb-server", file);
+        }
+        xnanosleep(10 * 1000 * 1000);
+    }
+
+    return xasprintf("unix:%s", db_file_sock);
+}
+
 static void
 parse_ct_option(const char *state_s_)
 {
@@ -243,6 +382,7 @@ parse_options(int argc, char *argv[])
 {
     enum {
         OPT_DB = UCHAR_MAX + 1,
+        OPT_DB_FILE,
         OPT_UNIXCTL,
         OPT_DETAILED,
         OPT_SUMMARY,
@@ -256,10 +396,13 @@ parse_options(int argc, char *argv[])
         SSL_OPTION_ENUMS,
         VLOG_OPTION_ENUMS,
         OPT_LB_DST,
-        OPT_SELECT_ID
+        OPT_SELECT_ID,
+        OPT_BATCH,
+        OPT_JSON,
     };
     static const struct option long_options[] = {
         {"db", required_argument, NULL, OPT_DB},
+        {"db-file", required_argument, NULL, OPT_DB_FILE},
         {"unixctl", required_argument, NULL, OPT_UNIXCTL},
         {"detailed", no_argument, NULL, OPT_DETAILED},
         {"summary", no_argument, NULL, OPT_SUMMARY},
@@ -273,6 +416,8 @@ parse_options(int argc, char *argv[])
         {"version", no_argument, NULL, 'V'},
         {"lb-dst", required_argument, NULL, OPT_LB_DST},
         {"select-id", required_argument, NULL, OPT_SELECT_ID},
+        {"batch", optional_argument, NULL, OPT_BATCH},
+        {"json", no_argument, NULL, OPT_JSON},
         OVN_DAEMON_LONG_OPTIONS,
         VLOG_LONG_OPTIONS,
         STREAM_SSL_LONG_OPTIONS,
@@ -294,6 +439,10 @@ parse_options(int argc, char *argv[])
             db = optarg;
             break;
 
+        case OPT_DB_FILE:
+            db_file = optarg;
+            break;
+
         case OPT_UNIXCTL:
             unixctl_path = optarg;
             break;
@@ -338,6 +487,14 @@ parse_options(int argc, char *argv[])
             parse_select_option(optarg);
             break;
 
+        case OPT_BATCH:
+            batch_file = optarg ? optarg : "-";
+            break;
+
+        case OPT_JSON:
+            json_output = true;
+            break;
+
         case 'h':
             usage();
 
@@ -359,7 +516,16 @@ parse_options(int argc, char *argv[])
     }
     free(short_options);
 
-    if (!db) {
+    if (batch_file && get_detach()) {
+        ovs_fatal(0, "--batch is not supported with --detach "
+                  "(use --help for help)");
+    }
+
+    if (db_file && db) {
+        ovs_fatal(0, "--db and --db-file are mutually exclusive "
+                  "(use --help for help)");
+    }
+    if (!db && !db_file) {
         db = default_sb_db();
     }
 
@@ -374,6 +540,7 @@ usage(void)
     printf("\
 %s: OVN trace utility\n\
 usage: %s [OPTIONS] [DATAPATH] MICROFLOW\n\
+       %s [OPTIONS] --batch[=FILE] [DATAPATH]\n\
        %s [OPTIONS] --detach\n\
 \n\
 Output format options:\n\
@@ -382,14 +549,19 @@ Output format options:\n\
   --minimal               minimum to explain externally visible behavior\n\
   --all                   provide all forms of output\n\
 Output style options:\n\
-  --no-friendly-names     do not substitute human friendly names for UUIDs\n",
-           program_name, program_name, program_name);
+  --no-friendly-names     do not substitute human friendly names for UUIDs\n\
+  --json                  output each trace as a JSON object\n\
+Batch options:\n\
+  --batch[=FILE]          trace each MICROFLOW in FILE, one per line\n\
+                          (default: stdin)\n",
+           program_name, program_name, program_name, program_name);
     daemon_usage();
     vlog_usage();
     printf("\n\
 Other options:\n\
   --db=DATABASE           connect to DATABASE\n\
                           (default: %s)\n\
+  --db-file=FILE          trace against the database copy in FILE\n\
   --ovs[=REMOTE]          obtain corresponding OpenFlow flows from REMOTE\n\
                           (default: %s)\n\
   --unixctl=SOCKET        set control socket name\n\
@@ -448,6 +620,10 @@ struct ovntrace_mcgroup {
 };
 
 struct ovntrace_flow {
+    struct hmap_node uuid_node; /* In 'flows_by_uuid'. */
+    struct ovntrace_datapath *dp;
+    bool deleted;               /* To be removed from 'dp->flows'. */
+
     struct uuid uuid;
     enum ovnact_pipeline pipeline;
     int table_id;
@@ -456,6 +632,7 @@ struct ovntrace_flow {
     int priority;
     char *match_s;
     struct expr *match;
+    struct expr_program *match_prog; /* 'match' compiled for evaluation. */
     struct ovnact *ovnacts;
     size_t ovnacts_len;
 };
@@ -491,6 +668,10 @@ static struct hmap datapaths;
 /* Every ovntrace_port, by name. */
 static struct shash ports;
 
+/* Every ovntrace_flow, by southbound Logical_Flow record UUID.  A logical
+ * flow applied to a datapath group has one ovntrace_flow per datapath. */
+static struct hmap flows_by_uuid;
+
 /* Symbol table for expressions and actions. */
 static struct shash symtab;
 
@@ -942,7 +1123,10 @@ ovntrace_make_names_friendly(const char *in)
     return ds_steal_cstr(&out);
 }
 
-static void
+/* Parses 'sblf' for datapath 'sbdb' and appends it to the datapath's
+ * flows, without sorting them.  Returns the datapath, or NULL if the flow
+ * could not be added. */
+static struct ovntrace_datapath *
 parse_lflow_for_datapath(const struct sbrec_logical_flow *sblf,
                         const struct sbrec_datapath_binding *sbdb)
 {
@@ -950,7 +1134,7 @@ parse_lflow_for_datapath(const struct sbrec_logical_flow *sblf,
             = ovntrace_datapath_find_by_sb_uuid(&sbdb->header_.uuid);
         if (!dp) {
             VLOG_WARN("logical flow missing datapath");
-            return;
+            return NULL;
         }
 
         char *error;
@@ -962,7 +1146,7 @@ parse_lflow_for_datapath(const struct sbrec_logical_flow *sblf,
             VLOG_WARN("%s: parsing expression failed (%s)",
                       sblf->match, error);
             free(error);
-            return;
+            return NULL;
         }
 
         struct ovnact_parse_params pp = {
@@ -985,7 +1169,7 @@ parse_lflow_for_datapath(const struct sbrec_logical_flow *sblf,
             VLOG_WARN("%s: parsing actions failed (%s)", sblf->actions, error);
             free(error);
             expr_destroy(match);
-            return;
+            return NULL;
         }
 
         match = expr_combine(EXPR_T_AND, match, prereqs);
@@ -996,7 +1180,7 @@ parse_lflow_for_datapath(const struct sbrec_logical_flow *sblf,
             expr_destroy(match);
             ovnacts_free(ovnacts.data, ovnacts.size);
             ofpbuf_uninit(&ovnacts);
-            return;
+            return NULL;
         }
         if (match) {
             match = expr_simplify(match);
@@ -1006,6 +1190,7 @@ parse_lflow_for_datapath(const struct sbrec_logical_flow *sblf,
         }
 
         struct ovntrace_flow *flow = xzalloc(sizeof *flow);
+        flow->dp = dp;
         flow->uuid = sblf->header_.uuid;
         flow->pipeline = (!strcmp(sblf->pipeline, "ingress")
                           ? OVNACT_P_INGRESS
@@ -1018,6 +1203,7 @@ parse_lflow_for_datapath(const struct sbrec_logical_flow *sblf,
         flow->priority = sblf->priority;
         flow->match_s = ovntrace_make_names_friendly(sblf->match);
         flow->match = match;
+        flow->match_prog = match ? expr_program_compile(match) : NULL;
         flow->ovnacts_len = ovnacts.size;
         flow->ovnacts = ofpbuf_steal_data(&ovnacts);
 
@@ -1026,30 +1212,102 @@ parse_lflow_for_datapath(const struct sbrec_logical_flow *sblf,
                                    sizeof *dp->flows);
         }
         dp->flows[dp->n_flows++] = flow;
+        hmap_insert(&flows_by_uuid, &flow->uuid_node,
+                    uuid_hash(&flow->uuid));
+        return dp;
 }
 
+/* Parses the port template 'sblf' expanded for every Ethernet address of the
+ * VIFs of its datapaths, like ovn-controller does.  Adds the datapaths whose
+ * flows changed to 'changed_dps', if nonnull. */
 static void
-read_flows(void)
+read_port_template_flow(const struct sbrec_logical_flow *sblf,
+                        struct hmapx *changed_dps)
 {
-    ovn_init_symtab(&symtab);
+    struct hmapx sbdbs = HMAPX_INITIALIZER(&sbdbs);
+    if (sblf->logical_datapath) {
+        hmapx_add(&sbdbs, CONST_CAST(void *, sblf->logical_datapath));
+    }
+    const struct sbrec_logical_dp_group *g = sblf->logical_dp_group;
+    for (size_t i = 0; g && i < g->n_datapaths; i++) {
+        hmapx_add(&sbdbs, CONST_CAST(void *, g->datapaths[i]));
+    }
 
-    const struct sbrec_logical_flow *sblf;
-    SBREC_LOGICAL_FLOW_FOR_EACH (sblf, ovnsb_idl) {
-        bool missing_datapath = true;
+    const struct sbrec_port_binding *sbpb;
+    SBREC_PORT_BINDING_FOR_EACH (sbpb, ovnsb_idl) {
+        if (sbpb->type[0] || !sbpb->datapath
+            || !hmapx_contains(&sbdbs, sbpb->datapath)) {
+            continue;
+        }
+        for (size_t i = 0; i < sbpb->n_mac; i++) {
+            struct eth_addr mac;
+            if (!ovs_scan(sbpb->mac[i], ETH_ADDR_SCAN_FMT,
+                          ETH_ADDR_SCAN_ARGS(mac))) {
+                continue;
+            }
 
-        if (sblf->logical_datapath) {
-            parse_lflow_for_datapath(sblf, sblf->logical_datapath);
-            missing_datapath = false;
+            struct sbrec_logical_flow expansion = *sblf;
+            expansion.match = ovn_port_template_expand(sblf->match,
+                                                       sbpb->logical_port,
+                                                       &mac);
+            expansion.actions = ovn_port_template_expand(sblf->actions,
+                                                         sbpb->logical_port,
+                                                         &mac);
+            struct ovntrace_datapath *dp
+                = parse_lflow_for_datapath(&expansion, sbpb->datapath);
+            if (dp && changed_dps) {
+                hmapx_add(changed_dps, dp);
+            }
+            free(expansion.match);
+            free(expansion.actions);
         }
+    }
+    hmapx_destroy(&sbdbs);
+}
+
+/* Parses 'sblf' for each of its datapaths.  Adds the datapaths whose flows
+ * changed to 'changed_dps', if nonnull. */
+static void
+read_flow(const struct sbrec_logical_flow *sblf, struct hmapx *changed_dps)
+{
+    bool missing_datapath = true;
+    struct ovntrace_datapath *dp;
 
-        const struct sbrec_logical_dp_group *g = sblf->logical_dp_group;
-        for (size_t i = 0; g && i < g->n_datapaths; i++) {
-            parse_lflow_for_datapath(sblf, g->datapaths[i]);
-            missing_datapath = false;
+    if (sbrec_logical_flow_is_port_template(sblf)) {
+        read_port_template_flow(sblf, changed_dps);
+        return;
+    }
+
+    if (sblf->logical_datapath) {
+        dp = parse_lflow_for_datapath(sblf, sblf->logical_datapath);
+        if (dp && changed_dps) {
+            hmapx_add(changed_dps, dp);
         }
-        if (missing_datapath) {
-            VLOG_WARN("logical flow missing datapath");
+        missing_datapath = false;
+    }
+
+    const struct sbrec_logical_dp_group *g = sblf->logical_dp_group;
+    for (size_t i = 0; g && i < g->n_datapaths; i++) {
+        dp = parse_lflow_for_datapath(sblf, g->datapaths[i]);
+        if (dp && changed_dps) {
+            hmapx_add(changed_dps, dp);
         }
+        missing_datapath = false;
+    }
+    if (missing_datapath) {
+        VLOG_WARN("logical flow missing datapath");
+    }
+}
+
+static void
+read_flows(void)
+{
+    ovn_init_symtab(&symtab);
+    hmap_init(&flows_by_uuid);
+
+    const struct sbrec_logical_flow *sblf;
+    SBREC_LOGICAL_FLOW_FOR_EACH (sblf, ovnsb_idl) {
+        read_flow(sblf, NULL);
     }
 
     const struct ovntrace_datapath *dp;
@@ -1159,6 +1417,257 @@ read_db(void)
     read_fdbs();
 }
 
+static void
+ovntrace_flow_destroy(struct ovntrace_flow *flow)
+{
+    free(flow->stage_name);
+    free(flow->source);
+    free(flow->match_s);
+    expr_destroy(flow->match);
+    expr_program_destroy(flow->match_prog);
+    ovnacts_free(flow->ovnacts, flow->ovnacts_len);
+    free(flow->ovnacts);
+    free(flow);
+}
+
+static void
+clear_mcgroups(struct ovntrace_datapath *dp)
+{
+    struct ovntrace_mcgroup *mcgroup;
+    LIST_FOR_EACH_POP (mcgroup, list_node, &dp->mcgroups) {
+        free(mcgroup->name);
+        free(mcgroup->ports);
+        free(mcgroup);
+    }
+}
+
+static void
+clear_mac_bindings(struct ovntrace_datapath *dp)
+{
+    struct ovntrace_mac_binding *binding;
+    HMAP_FOR_EACH_POP (binding, node, &dp->mac_bindings) {
+        free(binding);
+    }
+}
+
+static void
+clear_fdbs(struct ovntrace_datapath *dp)
+{
+    struct ovntrace_fdb *fdb;
+    HMAP_FOR_EACH_POP (fdb, node, &dp->fdbs) {
+        free(fdb);
+    }
+}
+
+/* Frees everything read_db() read, so that it may be called again. */
+static void
+free_db(void)
+{
+    struct ovntrace_datapath *dp;
+    HMAP_FOR_EACH_POP (dp, sb_uuid_node, &datapaths) {
+        for (size_t i = 0; i < dp->n_flows; i++) {
+            ovntrace_flow_destroy(dp->flows[i]);
+        }
+        free(dp->flows);
+        clear_mcgroups(dp);
+        clear_mac_bindings(dp);
+        hmap_destroy(&dp->mac_bindings);
+        clear_fdbs(dp);
+        hmap_destroy(&dp->fdbs);
+        free(dp->name);
+        free(dp->name2);
+        free(dp->friendly_name);
+        free(dp);
+    }
+    hmap_destroy(&datapaths);
+    hmap_destroy(&flows_by_uuid);
+
+    struct shash_node *node;
+    SHASH_FOR_EACH (node, &ports) {
+        struct ovntrace_port *port = node->data;
+        for (size_t i = 0; i < port->n_ps_addrs; i++) {
+            destroy_lport_addresses(&port->ps_addrs[i]);
+        }
+        free(port->ps_addrs);
+        free(port->name);
+        free(port->name2);
+        free(CONST_CAST(char *, port->friendly_name));
+        free(port->type);
+        free(port);
+    }
+    shash_destroy(&ports);
+
+    expr_const_sets_destroy(&address_sets);
+    shash_destroy(&address_sets);
+    expr_const_sets_destroy(&port_groups);
+    shash_destroy(&port_groups);
+    expr_symtab_destroy(&symtab);
+    shash_destroy(&symtab);
+
+    dhcp_opts_destroy(&dhcp_opts);
+    dhcp_opts_destroy(&dhcpv6_opts);
+    nd_ra_opts_destroy(&nd_ra_opts);
+    controller_event_opts_destroy(&event_opts);
+}
+
+/* Returns true if the tracked changes to the southbound database require
+ * reading it again from scratch, because the datapaths, the ports or the
+ * tables that logical flows are parsed against changed. */
+static bool
+db_needs_reload(void)
+{
+    if (sbrec_datapath_binding_track_get_first(ovnsb_idl)
+        || sbrec_address_set_track_get_first(ovnsb_idl)
+        || sbrec_port_group_track_get_first(ovnsb_idl)
+        || sbrec_dhcp_options_track_get_first(ovnsb_idl)
+        || sbrec_dhcpv6_options_track_get_first(ovnsb_idl)) {
+        return true;
+    }
+
+    /* Port_Binding rows change a lot at runtime, e.g. when ports get bound
+     * to chassis, but ovn-trace only cares about a few of their columns. */
+    const struct sbrec_port_binding *sbpb;
+    SBREC_PORT_BINDING_FOR_EACH_TRACKED (sbpb, ovnsb_idl) {
+        if (sbrec_port_binding_is_new(sbpb)
+            || sbrec_port_binding_is_deleted(sbpb)
+            || sbrec_port_binding_is_updated(
+                   sbpb, SBREC_PORT_BINDING_COL_LOGICAL_PORT)
+            || sbrec_port_binding_is_updated(sbpb, SBREC_PORT_BINDING_COL_TYPE)
+            || sbrec_port_binding_is_updated(sbpb, SBREC_PORT_BINDING_COL_MAC)
+            || sbrec_port_binding_is_updated(
+                   sbpb, SBREC_PORT_BINDING_COL_TUNNEL_KEY)
+            || sbrec_port_binding_is_updated(
+                   sbpb, SBREC_PORT_BINDING_COL_DATAPATH)
+            || sbrec_port_binding_is_updated(
+                   sbpb, SBREC_PORT_BINDING_COL_OPTIONS)
+            || sbrec_port_binding_is_updated(
+                   sbpb, SBREC_PORT_BINDING_COL_EXTERNAL_IDS)
+            || sbrec_port_binding_is_updated(
+                   sbpb, SBREC_PORT_BINDING_COL_PORT_SECURITY)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Removes every ovntrace_flow of the logical flow with 'uuid' from
+ * 'flows_by_uuid' and marks it deleted, adding its datapath to
+ * 'changed_dps'. */
+static void
+remove_flows(const struct uuid *uuid, struct hmapx *changed_dps)
+{
+    for (;;) {
+        struct ovntrace_flow *flow, *found = NULL;
+        HMAP_FOR_EACH_WITH_HASH (flow, uuid_node, uuid_hash(uuid),
+                                 &flows_by_uuid) {
+            if (uuid_equals(&flow->uuid, uuid)) {
+                found = flow;
+                break;
+            }
+        }
+        if (!found) {
+            return;
+        }
+        hmap_remove(&flows_by_uuid, &found->uuid_node);
+        found->deleted = true;
+        hmapx_add(changed_dps, found->dp);
+    }
+}
+
+/* Re-parses the logical flows that changed since the last call. */
+static void
+update_flows(void)
+{
+    struct hmapx changed_dps = HMAPX_INITIALIZER(&changed_dps);
+
+    /* A logical flow does not change when the datapath group it applies to
+     * does, so look for the flows of the updated groups separately. */
+    struct hmapx changed_groups = HMAPX_INITIALIZER(&changed_groups);
+    const struct sbrec_logical_dp_group *g;
+    SBREC_LOGICAL_DP_GROUP_FOR_EACH_TRACKED (g, ovnsb_idl) {
+        if (!sbrec_logical_dp_group_is_new(g)
+            && !sbrec_logical_dp_group_is_deleted(g)) {
+            hmapx_add(&changed_groups, CONST_CAST(void *, g));
+        }
+    }
+
+    struct hmapx changed_lflows = HMAPX_INITIALIZER(&changed_lflows);
+    const struct sbrec_logical_flow *sblf;
+    if (!hmapx_is_empty(&changed_groups)) {
+        SBREC_LOGICAL_FLOW_FOR_EACH (sblf, ovnsb_idl) {
+            if (sblf->logical_dp_group
+                && hmapx_contains(&changed_groups, sblf->logical_dp_group)) {
+                remove_flows(&sblf->header_.uuid, &changed_dps);
+                hmapx_add(&changed_lflows, CONST_CAST(void *, sblf));
+            }
+        }
+    }
+    hmapx_destroy(&changed_groups);
+
+    SBREC_LOGICAL_FLOW_FOR_EACH_TRACKED (sblf, ovnsb_idl) {
+        remove_flows(&sblf->header_.uuid, &changed_dps);
+        if (!sbrec_logical_flow_is_deleted(sblf)) {
+            hmapx_add(&changed_lflows, CONST_CAST(void *, sblf));
+        }
+    }
+
+    struct hmapx_node *node;
+    HMAPX_FOR_EACH (node, &changed_lflows) {
+        read_flow(node->data, &changed_dps);
+    }
+    hmapx_destroy(&changed_lflows);
+
+    HMAPX_FOR_EACH (node, &changed_dps) {
+        struct ovntrace_datapath *dp = node->data;
+        size_t n = 0;
+        for (size_t i = 0; i < dp->n_flows; i++) {
+            if (dp->flows[i]->deleted) {
+                ovntrace_flow_destroy(dp->flows[i]);
+            } else {
+                dp->flows[n++] = dp->flows[i];
+            }
+        }
+        dp->n_flows = n;
+        qsort(dp->flows, dp->n_flows, sizeof *dp->flows, compare_flow);
+    }
+    hmapx_destroy(&changed_dps);
+}
+
+/* Brings the state read by read_db() up to date with the changes tracked in
+ * the southbound database.  Only the logical flows that changed are parsed
+ * again, unless the changes affect how every flow is parsed. */
+static void
+update_db(void)
+{
+    if (db_needs_reload()) {
+        free_db();
+        read_db();
+        return;
+    }
+
+    struct ovntrace_datapath *dp;
+    if (sbrec_multicast_group_track_get_first(ovnsb_idl)) {
+        HMAP_FOR_EACH (dp, sb_uuid_node, &datapaths) {
+            clear_mcgroups(dp);
+        }
+        read_mcgroups();
+    }
+    if (sbrec_mac_binding_track_get_first(ovnsb_idl)) {
+        HMAP_FOR_EACH (dp, sb_uuid_node, &datapaths) {
+            clear_mac_bindings(dp);
+        }
+        read_mac_bindings();
+    }
+    if (sbrec_fdb_track_get_first(ovnsb_idl)) {
+        HMAP_FOR_EACH (dp, sb_uuid_node, &datapaths) {
+            clear_fdbs(dp);
+        }
+        read_fdbs();
+    }
+
+    update_flows();
+}
+
 static const struct ovntrace_port *
 ovntrace_port_lookup_by_name(const char *name)
 {
@@ -1248,7 +1757,8 @@ ovntrace_flow_lookup(const struct ovntrace_datapath *dp,
         const struct ovntrace_flow *flow = dp->flows[i];
         if (flow->pipeline == pipeline &&
             flow->table_id == table_id &&
-            expr_evaluate(flow->match, uflow, ovntrace_lookup_port, dp)) {
+            expr_program_evaluate(flow->match_prog, uflow,
+                                  ovntrace_lookup_port, dp)) {
             return flow;
         }
     }
@@ -3391,8 +3901,14 @@ trace_parse(const char *dp_s, const char *flow_s,
     return NULL;
 }
 
-static char *
-trace(const char *dp_s, const char *flow_s)
+/* Traces 'flow_s' from datapath 'dp_s', or from the datapath of its inport
+ * if 'dp_s' is NULL.  Stores the microflow into 'uflow_s', and the trace in
+ * each of the forms selected by the output format options into 'detailed_s',
+ * 'summary_s' and 'minimal_s'.  Returns NULL if successful, otherwise an
+ * error message that the caller must free. */
+static char * OVS_WARN_UNUSED_RESULT
+trace_run(const char *dp_s, const char *flow_s, struct ds *uflow_s,
+          struct ds *detailed_s, struct ds *summary_s, struct ds *minimal_s)
 {
     const struct ovntrace_datapath *dp;
     struct flow uflow;
@@ -3407,17 +3923,16 @@ trace(const char *dp_s, const char *flow_s)
     const struct ovntrace_port *inport = ovntrace_port_find_by_key(dp, in_key);
     const char *inport_name = inport ? inport->friendly_name : "(unnamed)";
 
-    struct ds output = DS_EMPTY_INITIALIZER;
-
-    ds_put_cstr(&output, "# ");
-    flow_format(&output, &uflow, NULL);
-    ds_put_char(&output, '\n');
+    flow_format(uflow_s, &uflow, NULL);
 
-    if (ovs) {
+    /* In batch mode, the connection is opened once for all the traces. */
+    bool close_vconn = false;
+    if (ovs && !vconn) {
         int retval = vconn_open_block(ovs, 1 << OFP15_VERSION, 0, -1, &vconn);
         if (retval) {
             VLOG_WARN("%s: connection failed (%s)", ovs, ovs_strerror(retval));
         }
+        close_vconn = true;
     }
 
     struct ovs_list root = OVS_LIST_INITIALIZER(&root);
@@ -3426,40 +3941,181 @@ trace(const char *dp_s, const char *flow_s)
         dp->friendly_name, inport_name);
     trace__(dp, &uflow, 0, OVNACT_P_INGRESS, &node->subs);
 
+    if (detailed) {
+        ovntrace_node_print_details(detailed_s, &root, 0);
+    }
+
+    if (summary) {
+        struct ovs_list clone = OVS_LIST_INITIALIZER(&clone);
+        ovntrace_node_clone(&root, &clone);
+        ovntrace_node_prune_summary(&clone);
+        ovntrace_node_print_summary(summary_s, &clone, 0);
+        ovntrace_node_list_destroy(&clone);
+    }
+
+    if (minimal) {
+        ovntrace_node_prune_hard(&root);
+        ovntrace_node_print_summary(minimal_s, &root, 0);
+    }
+
+    ovntrace_node_list_destroy(&root);
+
+    if (close_vconn) {
+        vconn_close(vconn);
+        vconn = NULL;
+    }
+
+    return NULL;
+}
+
+static char *
+trace(const char *dp_s, const char *flow_s)
+{
+    struct ds uflow_s = DS_EMPTY_INITIALIZER;
+    struct ds detailed_s = DS_EMPTY_INITIALIZER;
+    struct ds summary_s = DS_EMPTY_INITIALIZER;
+    struct ds minimal_s = DS_EMPTY_INITIALIZER;
+    char *error = trace_run(dp_s, flow_s, &uflow_s,
+                            &detailed_s, &summary_s, &minimal_s);
+    if (error) {
+        ds_destroy(&uflow_s);
+        return error;
+    }
+
+    struct ds output = DS_EMPTY_INITIALIZER;
+
+    ds_put_format(&output, "# %s\n", ds_cstr(&uflow_s));
+
     bool multiple = (detailed + summary + minimal) > 1;
     if (detailed) {
         if (multiple) {
             ds_put_cstr(&output, "# Detailed trace.\n");
         }
-        ovntrace_node_print_details(&output, &root, 0);
+        ds_put_cstr(&output, ds_cstr(&detailed_s));
     }
 
     if (summary) {
         if (multiple) {
             ds_put_cstr(&output, "# Summary trace.\n");
         }
-        struct ovs_list clone = OVS_LIST_INITIALIZER(&clone);
-        ovntrace_node_clone(&root, &clone);
-        ovntrace_node_prune_summary(&clone);
-        ovntrace_node_print_summary(&output, &clone, 0);
-        ovntrace_node_list_destroy(&clone);
+        ds_put_cstr(&output, ds_cstr(&summary_s));
     }
 
     if (minimal) {
         if (multiple) {
             ds_put_cstr(&output, "# Minimal trace.\n");
         }
-        ovntrace_node_prune_hard(&root);
-        ovntrace_node_print_summary(&output, &root, 0);
+        ds_put_cstr(&output, ds_cstr(&minimal_s));
     }
 
-    ovntrace_node_list_destroy(&root);
+    ds_destroy(&uflow_s);
+    ds_destroy(&detailed_s);
+    ds_destroy(&summary_s);
+    ds_destroy(&minimal_s);
 
-    vconn_close(vconn);
+    return ds_steal_cstr(&output);
+}
+
+/* Same as trace(), but returns the trace as a JSON object on a single line,
+ * with members for the microflow, the flow it parsed into and each form of
+ * output selected, or an "error" member if 'flow_s' could not be traced. */
+static char *
+trace_json(const char *dp_s, const char *flow_s)
+{
+    struct ds uflow_s = DS_EMPTY_INITIALIZER;
+    struct ds detailed_s = DS_EMPTY_INITIALIZER;
+    struct ds summary_s = DS_EMPTY_INITIALIZER;
+    struct ds minimal_s = DS_EMPTY_INITIALIZER;
+    char *error = trace_run(dp_s, flow_s, &uflow_s,
+                            &detailed_s, &summary_s, &minimal_s);
+
+    struct json *json = json_object_create();
+    json_object_put_string(json, "microflow", flow_s);
+    if (dp_s) {
+        json_object_put_string(json, "datapath", dp_s);
+    }
+    if (error) {
+        size_t len = strlen(error);
+        if (len && error[len - 1] == '\n') {
+            error[len - 1] = '\0';
+        }
+        json_object_put_string(json, "error", error);
+        free(error);
+    } else {
+        json_object_put_string(json, "flow", ds_cstr(&uflow_s));
+        if (detailed) {
+            json_object_put_string(json, "detailed", ds_cstr(&detailed_s));
+        }
+        if (summary) {
+            json_object_put_string(json, "summary", ds_cstr(&summary_s));
+        }
+        if (minimal) {
+            json_object_put_string(json, "minimal", ds_cstr(&minimal_s));
+        }
+    }
+
+    struct ds output = DS_EMPTY_INITIALIZER;
+    json_to_ds(json, JSSF_SORT, &output);
+    ds_put_char(&output, '\n');
+    json_destroy(json);
+
+    ds_destroy(&uflow_s);
+    ds_destroy(&detailed_s);
+    ds_destroy(&summary_s);
+    ds_destroy(&minimal_s);
 
     return ds_steal_cstr(&output);
 }
-
+
+/* Traces each of the microflows read from 'batch_file', one per line, from
+ * datapath 'dp_s' or, if it is NULL, from the datapath of their inport, and
+ * prints the traces in order.  Blank lines and comments starting with '#'
+ * are skipped.  The database is only read, and its logical flows parsed,
+ * once for all of them. */
+static void
+trace_batch(const char *dp_s)
+{
+    FILE *stream = !strcmp(batch_file, "-") ? stdin : fopen(batch_file, "r");
+    if (!stream) {
+        ovs_fatal(errno, "%s: open failed", batch_file);
+    }
+
+    if (ovs) {
+        int retval = vconn_open_block(ovs, 1 << OFP15_VERSION, 0, -1, &vconn);
+        if (retval) {
+            VLOG_WARN("%s: connection failed (%s)", ovs, ovs_strerror(retval));
+            vconn = NULL;
+        }
+    }
+
+    struct ds line = DS_EMPTY_INITIALIZER;
+    int line_number = 0;
+    while (!ds_get_preprocessed_line(&line, stream, &line_number)) {
+        if (!line.length) {
+            continue;
+        }
+
+        /* Each microflow sees the same --ct states. */
+        ct_state_idx = 0;
+
+        const char *flow_s = ds_cstr(&line);
+        char *output = (json_output
+                        ? trace_json(dp_s, flow_s)
+                        : trace(dp_s, flow_s));
+        fputs(output, stdout);
+        free(output);
+    }
+    ds_destroy(&line);
+
+    if (vconn) {
+        vconn_close(vconn);
+        vconn = NULL;
+    }
+    if (stream != stdin) {
+        fclose(stream);
+    }
+}
+
 static void
 ovntrace_exit(struct unixctl_conn *conn, int argc OVS_UNUSED,
               const char *argv[] OVS_UNUSED, void *exiting_)